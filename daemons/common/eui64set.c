@@ -31,8 +31,88 @@
 ******************************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 #include "eui64set.h"
 
+/* bits in the prefilter per entry of capacity, rounded up to a power of 2 */
+#define EUI64SET_BLOOM_BITS_PER_ENTRY 8
+
+static uint64_t eui64set_hash(uint64_t value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+static void eui64set_bloom_add(struct eui64set *self, uint64_t value)
+{
+	uint64_t h;
+	uint32_t bit;
+
+	if (!self->bloom)
+		return;
+	h = eui64set_hash(value);
+	bit = (uint32_t)h & self->bloom_mask;
+	self->bloom[bit >> 6] |= (uint64_t)1 << (bit & 63);
+	bit = (uint32_t)(h >> 32) & self->bloom_mask;
+	self->bloom[bit >> 6] |= (uint64_t)1 << (bit & 63);
+}
+
+static int eui64set_bloom_test(const struct eui64set *self, uint64_t value)
+{
+	uint64_t h;
+	uint32_t bit;
+
+	if (!self->bloom)
+		return 1;
+	h = eui64set_hash(value);
+	bit = (uint32_t)h & self->bloom_mask;
+	if (!(self->bloom[bit >> 6] & ((uint64_t)1 << (bit & 63))))
+		return 0;
+	bit = (uint32_t)(h >> 32) & self->bloom_mask;
+	return (self->bloom[bit >> 6] & ((uint64_t)1 << (bit & 63))) != 0;
+}
+
+static void eui64set_bloom_clear(struct eui64set *self)
+{
+	if (self->bloom)
+		memset(self->bloom, 0, ((size_t)self->bloom_mask + 1) / 8);
+	self->bloom_stale = 0;
+}
+
+/*
+ * A Bloom filter cannot forget a value, so removed entries leave their
+ * bits set. Rebuild from the storage once they outnumber the live ones.
+ */
+static void eui64set_bloom_rebuild(struct eui64set *self)
+{
+	int i;
+
+	eui64set_bloom_clear(self);
+	for (i = 0; i < self->num_entries; i++)
+		eui64set_bloom_add(self, self->storage[i].eui64);
+}
+
+/* index of the first entry not less than value in the sorted storage */
+static int eui64set_lower_bound(const struct eui64set *self, uint64_t value)
+{
+	int lo = 0;
+	int hi = self->num_entries;
+	int mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (self->storage[mid].eui64 < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 uint64_t eui64_read(const uint8_t network_order_buf[8])
 {
 	uint64_t v = 0;
@@ -81,6 +161,9 @@ int eui64set_init(struct eui64set *self, int max_entries)
 	self->num_entries = 0;
 	self->max_entries = max_entries;
 	self->storage = 0;
+	self->bloom = 0;
+	self->bloom_mask = 0;
+	self->bloom_stale = 0;
 	/* Are we to allocate storage? */
 	if (max_entries > 0) {
 		/* Yes, try */
@@ -90,6 +173,17 @@ int eui64set_init(struct eui64set *self, int max_entries)
 		if (self->storage == 0) {
 			/* Failure to allocate storage */
 			r = -1;
+		} else {
+			uint32_t bits = 64;
+
+			while (bits < (uint32_t)max_entries *
+			       EUI64SET_BLOOM_BITS_PER_ENTRY && bits < (1u << 31))
+				bits <<= 1;
+			/* Without a prefilter every find searches the storage */
+			self->bloom = (uint64_t *)calloc(bits / 64,
+							 sizeof(uint64_t));
+			if (self->bloom)
+				self->bloom_mask = bits - 1;
 		}
 	}
 	return r;
@@ -101,12 +195,16 @@ void eui64set_free(struct eui64set *self)
 		if (self->storage) {
 			free(self->storage);
 		}
+		if (self->bloom) {
+			free(self->bloom);
+		}
 	}
 }
 
 void eui64set_clear(struct eui64set *self)
 {
 	self->num_entries = 0;
+	eui64set_bloom_clear(self);
 }
 
 int eui64set_num_entries(struct eui64set *self)
@@ -131,6 +229,7 @@ int eui64set_insert(struct eui64set *self, uint64_t value, void *p)
 		self->storage[self->num_entries].eui64 = value;
 		self->storage[self->num_entries].p = p;
 		++self->num_entries;
+		eui64set_bloom_add(self, value);
 		r = 1;
 	}
 	return r;
@@ -145,11 +244,20 @@ void eui64set_sort(struct eui64set *self)
 
 int eui64set_insert_and_sort(struct eui64set *self, uint64_t value, void *p)
 {
-	int r;
+	int r = 0;
+	int pos;
 
-	r = eui64set_insert(self, value, p);
-	if (1 == r) {
-		eui64set_sort(self);
+	/* Do we have space? */
+	if (self->num_entries < self->max_entries) {
+		pos = eui64set_lower_bound(self, value);
+		memmove(&self->storage[pos + 1], &self->storage[pos],
+			(self->num_entries - pos) *
+			sizeof(struct eui64set_entry));
+		self->storage[pos].eui64 = value;
+		self->storage[pos].p = p;
+		++self->num_entries;
+		eui64set_bloom_add(self, value);
+		r = 1;
 	}
 	return r;
 }
@@ -157,35 +265,35 @@ int eui64set_insert_and_sort(struct eui64set *self, uint64_t value, void *p)
 const struct eui64set_entry *eui64set_find(const struct eui64set *self,
 					   uint64_t value)
 {
-	const struct eui64set_entry *result;
-	struct eui64set_entry key;
-	key.eui64 = value;
-	key.p = 0;
-	result = bsearch(&key,
-			 self->storage,
-			 self->num_entries, sizeof(key), eui64set_compare);
-	return result;
+	int pos;
+
+	if (!eui64set_bloom_test(self, value))
+		return 0;
+	pos = eui64set_lower_bound(self, value);
+	if (pos < self->num_entries && self->storage[pos].eui64 == value)
+		return &self->storage[pos];
+	return 0;
 }
 
 int eui64set_remove_and_sort(struct eui64set *self, uint64_t value)
 {
 	int r = 0;
+	int pos;
 	struct eui64set_entry *item;
-	struct eui64set_entry key;
-	key.eui64 = value;
-	key.p = 0;
-	item = bsearch(&key,
-		       self->storage,
-		       self->num_entries, sizeof(key), eui64set_compare);
-	if (item) {
-		// Set value to highest value
-		item->eui64 = ~((uint64_t) 0);
+
+	pos = eui64set_lower_bound(self, value);
+	if (pos < self->num_entries && self->storage[pos].eui64 == value) {
+		item = &self->storage[pos];
 		if (item->p) {
 			free(item->p);
 		}
 
-		eui64set_sort(self);
 		--self->num_entries;
+		memmove(item, item + 1,
+			(self->num_entries - pos) *
+			sizeof(struct eui64set_entry));
+		if (++self->bloom_stale > self->num_entries)
+			eui64set_bloom_rebuild(self);
 		r = 1;
 	}
 	return r;
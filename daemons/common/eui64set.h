@@ -73,6 +73,15 @@ struct eui64set {
 
 	/** The maximum number of entries in this set */
 	int max_entries;
+
+	/** Bloom prefilter consulted by eui64set_find, one bit per hash */
+	uint64_t *bloom;
+
+	/** The number of bits in the prefilter, minus one */
+	uint32_t bloom_mask;
+
+	/** Removals still set in the prefilter since it was last rebuilt */
+	int bloom_stale;
 };
 
 /**
@@ -118,7 +127,8 @@ int eui64set_insert(struct eui64set *self, uint64_t value, void *p);
 void eui64set_sort(struct eui64set *self);
 
 /**
- * Insert a single eui64 into a eui64set structure and sort it afterwards.
+ * Insert a single eui64 into a sorted eui64set structure at its sorted
+ * position, without re-sorting the whole set.
  * Returns 1 on success
  * Returns 0 if the storage area was full
  */
@@ -126,14 +136,15 @@ int eui64set_insert_and_sort(struct eui64set *self, uint64_t value, void *p);
 
 /**
  * Find a eui64 in the eui64set structure. Returns a pointer to the
- * eui64set_entry, or 0 if not found.
+ * eui64set_entry, or 0 if not found. Values that were never inserted are
+ * normally rejected by the prefilter without searching the storage.
  */
 const struct eui64set_entry *eui64set_find(const struct eui64set *self,
 					   uint64_t value);
 
 /**
  * Remove the specified eui64 from the eui64set structure and frees any
- * associated p data
+ * associated p data. The remaining entries stay sorted.
  *
  * Returns 1 if found and removed.
  *
@@ -100,5 +100,44 @@ TEST(Eui64SetGroup, Find)
 
 TEST(Eui64SetGroup, Remove)
 {
+	eui64set my_set;
+	int size = 64;
+	CHECK(eui64set_init(&my_set, size) == 0);
+
+	/* insert out of order, the set must stay sorted */
+	for (int i = 0; i < size; ++i) {
+		uint64_t v = ((uint64_t)((i * 37) % size) << 32) | 0x1234;
+		CHECK(eui64set_insert_and_sort(&my_set, v, 0) == 1);
+	}
+	for (int i = 1; i < size; ++i)
+		CHECK(my_set.storage[i - 1].eui64 < my_set.storage[i].eui64);
+
+	for (int i = 0; i < size; i += 2) {
+		uint64_t v = ((uint64_t)i << 32) | 0x1234;
+		CHECK(eui64set_remove_and_sort(&my_set, v) == 1);
+		CHECK(eui64set_remove_and_sort(&my_set, v) == 0);
+	}
+	CHECK(eui64set_num_entries(&my_set) == size / 2);
 
+	for (int i = 0; i < size; ++i) {
+		uint64_t v = ((uint64_t)i << 32) | 0x1234;
+		const eui64set_entry *entry = eui64set_find(&my_set, v);
+		if (i & 1) {
+			CHECK(entry != 0);
+			if (entry) {
+				CHECK(entry->eui64 == v);
+			}
+		} else {
+			CHECK(entry == 0);
+		}
+	}
+
+	/* a removed value can be inserted again */
+	CHECK(eui64set_insert_and_sort(&my_set, 0x1234, 0) == 1);
+	CHECK(eui64set_find(&my_set, 0x1234) != 0);
+
+	eui64set_clear(&my_set);
+	CHECK(eui64set_find(&my_set, 0x1234) == 0);
+
+	eui64set_free(&my_set);
 }
@@ -38,7 +38,9 @@
 #include <ieee1588.hpp>
 #include <common_port.hpp>
 #include <avbts_ostimerq.hpp>
+#include <avbts_pool.hpp>
 #include <avbts_osipc.hpp>
+#include <gptp_servo.hpp>
 
 /**@file*/
 
@@ -52,6 +54,7 @@
 
 #define UPPER_LIMIT_PPM 250
 #define LOWER_LIMIT_PPM -250
+#define US_PER_SEC 1000000
 #define PPM_OFFSET_TO_RATIO(ppm) ((ppm) / ((FrequencyRatio)US_PER_SEC) + 1)
 
 /* This is the threshold in ns for which frequency adjustments will be made */
@@ -85,11 +88,26 @@ struct ClockQuality {
 										  precision and frequency stability of the clock
 										  master. The PTP variance is the square of
 										  PTPDEV (See B.1.3.2). */
+
+	AVBTS_POOLED_NEW
 };
 
+/* Sync information older than this is not relayed (ns) */
+#define SYNC_RELAY_MAX_AGE_NS (4000000000ULL)
+
 /**
- * @brief Provides the 1588 clock interface
+ * @brief Last synchronization received on the slave port of a
+ * time-aware relay. Master ports use it to forward the grandmaster
+ * time instead of originating their own.
  */
+struct SyncRelayInfo {
+	bool valid;				/*!< Set when a slave port has synchronized */
+	CommonPort *port;		/*!< Slave port the sync was received on */
+	Timestamp origin;		/*!< Grandmaster time at sync arrival */
+	uint64_t system_at_rx;	/*!< System time (ns) at sync arrival */
+	FrequencyRatio gm_system_rate;	/*!< Grandmaster to system clock rate */
+};
+
 class IEEE1588Clock {
 private:
 	ClockIdentity clock_identity;
@@ -124,6 +142,9 @@ private:
 	float _ppm;
 	int _phase_error_violation;
 
+	bool _fast_lock;
+	bool _fast_lock_pending;
+
 	CommonPort *port_list[MAX_PORTS];
 
 	static Timestamp start_time;
@@ -131,7 +152,7 @@ private:
 
 	bool _master_local_freq_offset_init;
 	Timestamp _prev_master_time;
-	Timestamp _prev_sync_time;
+	RateServo *rate_servo;
 
 	bool _local_system_freq_offset_init;
 	Timestamp _prev_local_time;
@@ -162,6 +183,9 @@ private:
 
     OSLock *timerq_lock;
 
+	SyncRelayInfo relay_info;
+	OSLock *relay_lock;
+
 	/**
 	 * @brief  Add a new event to the timer queue
 	 * @param  target EtherPort target
@@ -228,11 +252,17 @@ public:
   Timestamp getPreciseTime(void);
 
   /**
-   * @brief  Compares the 1588 Clock to the grandmaster clock
-   * @param  msg [in] PTP announce message
-   * @return TRUE if the 1588 clock
+   * @brief  Gets the BMCA comparison key of the 1588 clock
+   * @return BmcaKey built from the clock's own data set
    */
-  bool isBetterThan(PTPMessageAnnounce * msg);
+  BmcaKey getBmcaKey(void);
+
+  /**
+   * @brief  Compares the 1588 Clock to a foreign master
+   * @param  fm [in] Foreign master, NULL if there is none
+   * @return TRUE if the 1588 clock is better
+   */
+  bool isBetterThan(const ForeignMaster * fm);
 
   /**
    * @brief  Gets the Last Best clock identity
@@ -488,6 +518,82 @@ public:
 	  return;
   }
 
+  /**
+   * @brief  Enables fast-lock mode. Restored syntonization state is
+   * only used when set. Must be called before restoreSerializedState()
+   * @param  enable TRUE to use restored state immediately
+   * @return void
+   */
+  void setFastLock( bool enable ) {
+	  _fast_lock = enable;
+  }
+
+  /**
+   * @brief  Applies the restored clock rate adjustment on power up
+   * @param  port [in] Port used to adjust the clock
+   * @return void
+   */
+  void fastLockStart( CommonPort *port );
+
+  /**
+   * @brief  Discards restored syntonization state that turned out not
+   * to match the network
+   * @return void
+   */
+  void fastLockRollback( void );
+
+  /**
+   * @brief  Replaces the master to local rate servo. Must be called
+   * before restoreSerializedState()
+   * @param  config Servo configuration
+   * @return void
+   */
+  void setRateServo( const ServoConfig &config );
+
+  /**
+   * @brief  Checks whether the clock bridges more than one port
+   * @return TRUE if the clock acts as a time-aware relay
+   */
+  bool isRelay( void ) {
+	  return number_ports > 1;
+  }
+
+  /**
+   * @brief  Records the synchronization received on a slave port
+   * @param  info [in] Sync information to be relayed
+   * @return void
+   */
+  void setSyncRelayInfo( const SyncRelayInfo &info ) {
+	  relay_lock->lock();
+	  relay_info = info;
+	  relay_info.valid = true;
+	  relay_lock->unlock();
+  }
+
+  /**
+   * @brief  Gets the synchronization to relay on master ports
+   * @param  info [out] Last recorded sync information
+   * @return TRUE if valid sync information is available
+   */
+  bool getSyncRelayInfo( SyncRelayInfo &info ) {
+	  relay_lock->lock();
+	  info = relay_info;
+	  relay_lock->unlock();
+	  return info.valid;
+  }
+
+  /**
+   * @brief  Invalidates relay information received on a port
+   * @param  port [in] Port that stopped being the slave port
+   * @return void
+   */
+  void clearSyncRelayInfo( CommonPort *port ) {
+	  relay_lock->lock();
+	  if( relay_info.port == port )
+		  relay_info.valid = false;
+	  relay_lock->unlock();
+  }
+
   /**
    * @brief  Gets current system time
    * @return Instance of a Timestamp object
@@ -634,17 +740,13 @@ public:
    * @brief  Gets the timer queue lock
    * @return OSLockResult structure
    */
-  OSLockResult getTimerQLock() {
-	  return timerq_lock->lock();
-  }
+  OSLockResult getTimerQLock();
 
   /**
    * @brief  Releases the timer queue lock
    * @return OSLockResult structure
    */
-  OSLockResult putTimerQLock() {
-	  return timerq_lock->unlock();
-  }
+  OSLockResult putTimerQLock();
 
   /**
    * @brief  Gets a pointer to the timer queue lock object
@@ -37,6 +37,8 @@
 #include <stdint.h>
 #include <avbts_osnet.hpp>
 #include <ieee1588.hpp>
+#include <avbts_pool.hpp>
+#include <foreign_master.hpp>
 
 #include <list>
 #include <algorithm>
@@ -276,6 +278,14 @@ protected:
 		return messageType;
 	}
 
+	/**
+	 * @brief  Gets the domainNumber field within the PTP message.
+	 * @return PTP domain number
+	 */
+	unsigned char getDomainNumber(void) {
+		return domainNumber;
+	}
+
 	/**
 	 * @brief Check if message type is event
 	 * @return true if an event message
@@ -520,6 +530,8 @@ class PTPMessageAnnounce:public PTPMessageCommon {
 
 	 PTPMessageAnnounce(void);
  public:
+	AVBTS_POOLED_NEW
+
 	 /**
 	  * @brief Creates the PTPMessageAnnounce interface
 	  */
@@ -538,6 +550,12 @@ class PTPMessageAnnounce:public PTPMessageCommon {
 	 */
 	bool isBetterThan(PTPMessageAnnounce * msg);
 
+	/**
+	 * @brief  Gets the BMCA comparison key of the announced grandmaster
+	 * @return BmcaKey
+	 */
+	BmcaKey getBmcaKey(void);
+
 	/**
 	 * @brief  Gets grandmaster's priority1 value
 	 * @return Grandmaster priority1
@@ -621,6 +639,8 @@ class PTPMessageSync : public PTPMessageCommon {
 
 	PTPMessageSync();
  public:
+	AVBTS_POOLED_NEW
+
 	/**
 	 * @brief Default constructor. Creates PTPMessageSync
 	 * @param port EtherPort
@@ -863,6 +883,8 @@ private:
 
 	PTPMessageFollowUp(void) { }
 public:
+	AVBTS_POOLED_NEW
+
 	/**
 	 * @brief Builds the PTPMessageFollowUP object
 	 */
@@ -931,6 +953,8 @@ class PTPMessagePathDelayReq : public PTPMessageCommon {
 		return;
 	}
  public:
+	AVBTS_POOLED_NEW
+
 	/**
 	 * @brief Destroys the PTPMessagePathDelayReq object
 	 */
@@ -984,6 +1008,8 @@ private:
 	PTPMessagePathDelayResp(void) {
 	}
 public:
+	AVBTS_POOLED_NEW
+
 	/**
 	 * @brief Destroys the PTPMessagePathDelayResp object
 	 */
@@ -1057,6 +1083,8 @@ class PTPMessagePathDelayRespFollowUp:public PTPMessageCommon {
 	PTPMessagePathDelayRespFollowUp(void) { }
 
 public:
+	AVBTS_POOLED_NEW
+
 	/**
 	 * @brief Builds the PTPMessagePathDelayRespFollowUp object
 	 */
@@ -1233,6 +1261,8 @@ private:
 
 	PTPMessageSignalling(void);
 public:
+	AVBTS_POOLED_NEW
+
 	static const int8_t sigMsgInterval_Initial =  126;
 	static const int8_t sigMsgInterval_NoSend =  127;
 	static const int8_t sigMsgInterval_NoChange =  -128;
@@ -37,6 +37,7 @@
 #include <stdint.h>
 #include <ptptypes.hpp>
 #include <ether_port.hpp>
+#include <gptp_stats.hpp>
 
 /**@file*/
 
@@ -129,6 +130,41 @@ public:
 		int8_t   log_pdelay_interval,
 		uint16_t port_number ) = 0;
 
+	/**
+	 * @brief  Gets externally visible storage for a port's statistics
+	 * @param  index Port index, starting at 0
+	 * @return Storage to attach to the port's PortStatistics, or NULL
+	 * if the IPC does not export statistics
+	 */
+	virtual gPtpPortStats *getPortStats( unsigned index )
+	{
+		return NULL;
+	}
+
+	/**
+	 * @brief  Publishes the sync result of an additional gPTP domain
+	 * @param  index Domain slot, starting at 1 (0 is the domain the clock
+	 * is disciplined to)
+	 * @param  domain_number gPTP domain number
+	 * @param  gptp_grandmaster_id Grandmaster of the domain (all 0's if unknown)
+	 * @param  ml_phoffset Master to local phase offset
+	 * @param  ml_freqoffset Master to local frequency offset
+	 * @param  local_time Local time of the sync
+	 * @param  sync_count Sync messages of the domain used so far
+	 * @return FALSE if the IPC does not publish additional domains
+	 */
+	virtual bool update_domain(
+		unsigned index,
+		uint8_t domain_number,
+		uint8_t gptp_grandmaster_id[],
+		int64_t ml_phoffset,
+		FrequencyRatio ml_freqoffset,
+		uint64_t local_time,
+		uint32_t sync_count )
+	{
+		return false;
+	}
+
 	/*
 	 * Destroys IPC
 	 */
@@ -36,6 +36,8 @@
 
 /**@file*/
 
+#include <stdint.h>
+
 /**
  * @brief thread exit codes. Possible values are:
  * 	- osthread_ok;
@@ -49,6 +51,36 @@ typedef enum { osthread_ok, osthread_error } OSThreadExitCode;
 typedef OSThreadExitCode(*OSThreadFunction) (void *);
 typedef void *OSThreadFunctionArg;
 
+/**
+ * @brief What a thread is used for, so that each kind can be scheduled on
+ * its own. Possible values are:
+ * 	- OSTHREAD_ROLE_DEFAULT: any other thread;
+ * 	- OSTHREAD_ROLE_EVENT: port receive path, RX timestamps and the events
+ * 	  they drive;
+ * 	- OSTHREAD_ROLE_TIMER: timer queue, which sends the timed messages and
+ * 	  collects their TX timestamps;
+ * 	- OSTHREAD_ROLE_LINK: link state watcher;
+ * 	- OSTHREAD_ROLE_IPC: system model updates of the shared memory.
+ */
+typedef enum {
+	OSTHREAD_ROLE_DEFAULT,
+	OSTHREAD_ROLE_EVENT,
+	OSTHREAD_ROLE_TIMER,
+	OSTHREAD_ROLE_LINK,
+	OSTHREAD_ROLE_IPC,
+	OSTHREAD_ROLE_COUNT
+} OSThreadRole;
+
+/**
+ * @brief Scheduling of the threads of one role
+ */
+struct OSThreadSched {
+	int priority;		//!< Real time (FIFO) priority, 0 keeps the default policy
+	uint64_t cpus;		//!< CPUs the threads may run on, a bit per CPU, 0 for any
+
+	OSThreadSched() : priority( 0 ), cpus( 0 ) {}
+};
+
 /**
  * @brief Provides a generic interface for threads
  */
@@ -80,9 +112,11 @@ class OSThreadFactory {
 public:
 	/**
 	 * @brief Creates a new thread
+	 * @param role What the thread is used for
 	 * @return Pointer to OSThread object
 	 */
-	virtual OSThread * createThread() const = 0;
+	virtual OSThread * createThread
+	( OSThreadRole role = OSTHREAD_ROLE_DEFAULT ) const = 0;
 
 	/**
 	 * @brief Destroys the new thread
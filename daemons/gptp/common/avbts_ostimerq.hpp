@@ -76,10 +76,11 @@ public:
 	/**
 	 * @brief Removes an event from the timer queue
 	 * @param type Event type
+	 * @param port Only remove events of this port, NULL for every port
 	 * @param event [inout] Pointer to the event
 	 * @return TRUE success, FALSE fail
 	 */
-	virtual bool cancelEvent(int type, unsigned *event) = 0;
+	virtual bool cancelEvent(int type, CommonPort *port, unsigned *event) = 0;
 	virtual ~OSTimerQueue() = 0;
 };
 
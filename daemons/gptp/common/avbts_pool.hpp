@@ -0,0 +1,139 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifndef AVBTS_POOL_HPP
+#define AVBTS_POOL_HPP
+
+/**@file*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <mutex>
+
+#define PTP_MESSAGE_POOL_SIZE 32	/*!< Preallocated objects per PTP message type */
+#define PORT_IDENTITY_POOL_SIZE 128	/*!< Preallocated PortIdentity objects */
+#define CLOCK_QUALITY_POOL_SIZE 64	/*!< Preallocated ClockQuality objects */
+
+/**
+ * @brief Fixed size object pool backing class specific new/delete.
+ *
+ * The objects are carved out of static storage, so allocating and freeing
+ * them in steady state never reaches the heap. Requests that are larger than
+ * the block size, or that arrive while the pool is empty, fall back to the
+ * global operator new and are told apart on release by their address.
+ */
+template <size_t BLOCK, unsigned COUNT>
+class AvbtsPool {
+private:
+	union Slot {
+		Slot *next;
+		char data[BLOCK];
+		long double ld;
+		uint64_t u64;
+		void *ptr;
+	};
+	Slot slots[COUNT];
+	Slot *free_list;
+	std::mutex lock;
+public:
+	/**
+	 * @brief Puts all the slots on the free list
+	 */
+	AvbtsPool() : free_list(NULL) {
+		for( unsigned i = 0; i < COUNT; ++i ) {
+			slots[i].next = free_list;
+			free_list = &slots[i];
+		}
+	}
+
+	/**
+	 * @brief  Allocates one object
+	 * @param  size Size requested by operator new
+	 * @return Pointer to the storage, never NULL
+	 */
+	void *alloc( size_t size ) {
+		if( size <= BLOCK ) {
+			std::lock_guard<std::mutex> guard( lock );
+			Slot *slot = free_list;
+			if( slot != NULL ) {
+				free_list = slot->next;
+				return slot;
+			}
+		}
+		return ::operator new( size );
+	}
+
+	/**
+	 * @brief  Frees an object returned by alloc()
+	 * @param  p Pointer to the storage, may be NULL
+	 * @return void
+	 */
+	void release( void *p ) {
+		Slot *slot = (Slot *) p;
+		if( slot >= slots && slot < slots + COUNT ) {
+			std::lock_guard<std::mutex> guard( lock );
+			slot->next = free_list;
+			free_list = slot;
+			return;
+		}
+		::operator delete( p );
+	}
+};
+
+/**
+ * @brief Declares pooled operator new/delete in a class body
+ */
+#define AVBTS_POOLED_NEW					\
+	static void *operator new( size_t size );		\
+	static void operator delete( void *p );
+
+/**
+ * @brief Defines the pooled operator new/delete declared with
+ * AVBTS_POOLED_NEW, backed by a pool of count objects. The pool is a
+ * function local static so that it exists before any static object
+ * allocates from it.
+ */
+#define AVBTS_POOL_DEFINE(name, count)					\
+	static AvbtsPool<sizeof(name), count> &name##Pool() {		\
+		static AvbtsPool<sizeof(name), count> pool;		\
+		return pool;						\
+	}								\
+	void *name::operator new( size_t size ) {			\
+		return name##Pool().alloc( size );			\
+	}								\
+	void name::operator delete( void *p ) {				\
+		name##Pool().release( p );				\
+	}
+
+#endif
@@ -36,6 +36,7 @@
 #include <avbts_clock.hpp>
 #include <common_tstamper.hpp>
 #include <gptp_cfg.hpp>
+#include <gptp_hal.hpp>
 
 CommonPort::CommonPort( PortInit_t *portInit ) :
 	thread_factory( portInit->thread_factory ),
@@ -50,17 +51,22 @@ CommonPort::CommonPort( PortInit_t *portInit ) :
 	one_way_delay = ONE_WAY_DELAY_DEFAULT;
 	neighbor_prop_delay_thresh = portInit->neighborPropDelayThreshold;
 	net_label = portInit->net_label;
-	link_thread = thread_factory->createThread();
-	listening_thread = thread_factory->createThread();
+	link_thread = thread_factory->createThread( OSTHREAD_ROLE_LINK );
+	listening_thread = thread_factory->createThread( OSTHREAD_ROLE_EVENT );
 	sync_receipt_thresh = portInit->syncReceiptThreshold;
 	wrongSeqIDCounter = 0;
 	_peer_rate_offset = 1.0;
 	_peer_offset_init = false;
+	restored_link_delay = false;
+	link_partner_valid = false;
+	restored_partner_valid = false;
+	link_flap_window = portInit->linkFlapWindow * 1000000ULL;
+	link_flap_pending = false;
+	link_flap_deadline = 0;
 	ifindex = portInit->index;
 	testMode = false;
 	port_state = PTP_INITIALIZING;
 	clock->registerPort(this, ifindex);
-	qualified_announce = NULL;
 	announce_sequence_id = 0;
 	signal_sequence_id = 0;
 	sync_sequence_id = 0;
@@ -73,7 +79,6 @@ CommonPort::CommonPort( PortInit_t *portInit ) :
 
 CommonPort::~CommonPort()
 {
-	delete qualified_announce;
 }
 
 bool CommonPort::init_port( void )
@@ -86,7 +91,9 @@ bool CommonPort::init_port( void )
 		return false;
 
 	this->net_iface->getLinkLayerAddress(&local_addr);
-	clock->setClockIdentity(&local_addr);
+	/* A relay is identified by the address of its first port */
+	if( ifindex == 1 )
+		clock->setClockIdentity(&local_addr);
 
 	this->timestamper_init();
 
@@ -123,9 +130,20 @@ void CommonPort::timestamper_reset( void )
 	}
 }
 
-PTPMessageAnnounce *CommonPort::calculateERBest( void )
+ForeignMaster *CommonPort::calculateERBest( void )
 {
-	return qualified_announce;
+	return foreign_masters.getBest();
+}
+
+bool CommonPort::updateForeignMaster( PTPMessageAnnounce *annc )
+{
+	Timestamp now = clock->getSystemTime();
+
+	return foreign_masters.update
+		( annc, TIMESTAMP_TO_NS( now ),
+		  (uint64_t)( ANNOUNCE_RECEIPT_TIMEOUT_MULTIPLIER *
+			      pow( (double) 2, getAnnounceInterval() ) *
+			      1000000000.0 ));
 }
 
 void CommonPort::recommendState
@@ -163,7 +181,10 @@ void CommonPort::recommendState
 		     "1588Port::recommendState()");
 		break;
 	}
-	if( reset_sync ) sync_count = 0;
+	if( reset_sync ) {
+		sync_count = 0;
+		stats.bmcaChange();
+	}
 	return;
 }
 
@@ -239,6 +260,13 @@ bool CommonPort::restoreSerializedState
 ( void *buf, off_t *count )
 {
 	bool ret = true;
+	FrequencyRatio upper_ratio_limit, lower_ratio_limit;
+
+	/* Keep the current state to roll back to if validation fails */
+	bool prev_asCapable = asCapable;
+	PortState prev_port_state = port_state;
+	int64_t prev_one_way_delay = one_way_delay;
+	FrequencyRatio prev_peer_rate_offset = _peer_rate_offset;
 
 	/* asCapable */
 	if( ret && *count >= (off_t) sizeof( asCapable )) {
@@ -288,9 +316,125 @@ bool CommonPort::restoreSerializedState
 		ret = false;
 	}
 
+	upper_ratio_limit = PPM_OFFSET_TO_RATIO(UPPER_LIMIT_PPM);
+	lower_ratio_limit = PPM_OFFSET_TO_RATIO(LOWER_LIMIT_PPM);
+	if( ret &&
+	    (( port_state != PTP_MASTER && port_state != PTP_SLAVE ) ||
+	     one_way_delay < -neighbor_prop_delay_thresh ||
+	     one_way_delay > neighbor_prop_delay_thresh ||
+	     !( _peer_rate_offset > lower_ratio_limit &&
+		_peer_rate_offset < upper_ratio_limit )))
+	{
+		GPTP_LOG_ERROR( "Restored port state out of range, ignoring it" );
+		ret = false;
+	}
+
+	if( !ret ) {
+		asCapable = prev_asCapable;
+		port_state = prev_port_state;
+		one_way_delay = prev_one_way_delay;
+		_peer_rate_offset = prev_peer_rate_offset;
+	} else {
+		restored_link_delay = true;
+		restored_partner_valid = false;
+	}
+
 	return ret;
 }
 
+void CommonPort::checkRestoredLinkDelay
+( int64_t measured, ClockIdentity partner )
+{
+	int64_t diff;
+
+	link_partner = partner;
+	link_partner_valid = true;
+
+	if( !restored_link_delay )
+		return;
+	restored_link_delay = false;
+
+	if( restored_partner_valid && partner != restored_partner ) {
+		GPTP_LOG_STATUS
+			( "Link partner changed from %s to %s",
+			  restored_partner.getIdentityString().c_str(),
+			  partner.getIdentityString().c_str() );
+	} else {
+		diff = measured - one_way_delay;
+		if( diff < 0 )
+			diff = -diff;
+		if( diff <= RESTORED_LINK_DELAY_TOLERANCE )
+			return;
+
+		GPTP_LOG_STATUS
+			( "Restored link delay %lld ns does not match measured "
+			  "%lld ns", (long long) one_way_delay,
+			  (long long) measured );
+	}
+	_peer_rate_offset = 1.0;
+	clock->fastLockRollback();
+}
+
+void CommonPort::linkFlapStart( void )
+{
+	if( link_flap_window == 0 || !asCapable || !link_partner_valid )
+		return;
+
+	Timestamp system_time;
+	Timestamp device_time;
+	uint32_t local_clock, nominal_clock_rate;
+
+	getDeviceTime( system_time, device_time, local_clock,
+		       nominal_clock_rate );
+
+	/* one_way_delay and _peer_rate_offset are left alone on link down */
+	link_flap_pending = true;
+	link_flap_deadline = TIMESTAMP_TO_NS( device_time ) + link_flap_window;
+	clock->deleteEventTimerLocked( this, LINK_FLAP_WINDOW_EXPIRES );
+	clock->addEventTimerLocked
+		( this, LINK_FLAP_WINDOW_EXPIRES, link_flap_window );
+}
+
+bool CommonPort::linkFlapHolding( void )
+{
+	Timestamp system_time;
+	Timestamp device_time;
+	uint32_t local_clock, nominal_clock_rate;
+
+	if( !link_flap_pending )
+		return false;
+
+	getDeviceTime( system_time, device_time, local_clock,
+		       nominal_clock_rate );
+	if( TIMESTAMP_TO_NS( device_time ) < link_flap_deadline )
+		return true;
+
+	GPTP_LOG_STATUS( "Link down for longer than the link flap window" );
+	link_flap_pending = false;
+	clock->deleteEventTimerLocked( this, LINK_FLAP_WINDOW_EXPIRES );
+	return false;
+}
+
+bool CommonPort::linkFlapResume( void )
+{
+	if( !link_flap_pending )
+		return false;
+
+	link_flap_pending = false;
+	clock->deleteEventTimerLocked( this, LINK_FLAP_WINDOW_EXPIRES );
+
+	GPTP_LOG_STATUS
+		( "Link back within the link flap window, resuming with link "
+		  "delay %lld ns", (long long) one_way_delay );
+
+	restored_link_delay = true;
+	restored_partner = link_partner;
+	restored_partner_valid = true;
+	setAsCapable( true );
+
+	return true;
+}
+
 void CommonPort::startSyncReceiptTimer
 ( long long unsigned int waitTime )
 {
@@ -334,7 +478,7 @@ bool CommonPort::processStateChange( Event e )
 	bool changed_external_master;
 	uint8_t LastEBestClockIdentity[PTP_CLOCK_IDENTITY_LENGTH];
 	int number_ports, j;
-	PTPMessageAnnounce *EBest = NULL;
+	ForeignMaster *EBest = NULL;
 	char EBestClockIdentity[PTP_CLOCK_IDENTITY_LENGTH];
 	CommonPort **ports;
 
@@ -433,7 +577,7 @@ bool CommonPort::processStateChange( Event e )
 				ClockIdentity clock_identity;
 				unsigned char priority1;
 				unsigned char priority2;
-				ClockQuality *clock_quality;
+				ClockQuality clock_quality;
 
 				ports[j]->recommendState
 					( PTP_SLAVE, changed_external_master );
@@ -451,7 +595,7 @@ bool CommonPort::processStateChange( Event e )
 				clock_quality =
 					EBest->getGrandmasterClockQuality();
 				getClock()->setGrandmasterClockQuality
-					(*clock_quality);
+					(clock_quality);
 			} else {
 				/* Otherwise we are the master because we have
 				   sync'd to a better clock */
@@ -465,6 +609,24 @@ bool CommonPort::processStateChange( Event e )
 }
 
 
+void CommonPort::restartReceiptTimer( Event e )
+{
+	if( e == ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES ) {
+		clock->addEventTimerLocked
+			(this, ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES,
+			 (ANNOUNCE_RECEIPT_TIMEOUT_MULTIPLIER*
+			  (unsigned long long)
+			  (pow((double)2,getAnnounceInterval())*
+			   1000000000.0)));
+	} else {
+		startSyncReceiptTimer
+			((unsigned long long)
+			 (SYNC_RECEIPT_TIMEOUT_MULTIPLIER *
+			  ((double) pow((double)2, getSyncInterval()) *
+			   1000000000.0)));
+	}
+}
+
 bool CommonPort::processSyncAnnounceTimeout( Event e )
 {
 	// We're Grandmaster, set grandmaster info to me
@@ -481,21 +643,7 @@ bool CommonPort::processSyncAnnounceTimeout( Event e )
 	if( clock->getPriority1() == 255 )
 		return true;
 
-	// Restart timer
-	if( e == ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES ) {
-		clock->addEventTimerLocked
-			(this, ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES,
-			 (ANNOUNCE_RECEIPT_TIMEOUT_MULTIPLIER*
-			  (unsigned long long)
-			  (pow((double)2,getAnnounceInterval())*
-			   1000000000.0)));
-	} else {
-		startSyncReceiptTimer
-			((unsigned long long)
-			 (SYNC_RECEIPT_TIMEOUT_MULTIPLIER *
-			  ((double) pow((double)2, getSyncInterval()) *
-			   1000000000.0)));
-	}
+	restartReceiptTimer( e );
 
 	if( getPortState() == PTP_MASTER )
 		return true;
@@ -522,7 +670,7 @@ bool CommonPort::processSyncAnnounceTimeout( Event e )
 	(void) clock->calcLocalSystemClockRateDifference
 		( device_time, system_time );
 
-	setQualifiedAnnounce( NULL );
+	clearForeignMasters();
 
 	clock->addEventTimerLocked
 		( this, SYNC_INTERVAL_TIMEOUT_EXPIRES,
@@ -565,6 +713,8 @@ bool CommonPort::processEvent( Event e )
 			startAnnounce();
 		}
 
+		clock->fastLockStart( this );
+
 		// Do any media specific initialization
 		ret = _processEvent( e );
 		break;
@@ -587,6 +737,13 @@ bool CommonPort::processEvent( Event e )
 			incCounter_ieee8021AsPortStatRxSyncReceiptTimeouts();
 		}
 
+		// Hold the port state while the link may still come back
+		if( linkFlapHolding() ) {
+			restartReceiptTimer( e );
+			ret = true;
+			break;
+		}
+
 		ret = _processEvent( e );
 
 		// If this event wasn't handled in a media specific way, call
@@ -595,6 +752,15 @@ bool CommonPort::processEvent( Event e )
 			ret = processSyncAnnounceTimeout( e );
 		break;
 
+	case LINK_FLAP_WINDOW_EXPIRES:
+		if( link_flap_pending ) {
+			GPTP_LOG_STATUS
+				( "Link down for longer than the link flap window" );
+			link_flap_pending = false;
+		}
+		ret = true;
+		break;
+
 	case ANNOUNCE_INTERVAL_TIMEOUT_EXPIRES:
 		GPTP_LOG_DEBUG("ANNOUNCE_INTERVAL_TIMEOUT_EXPIRES occured");
 		if( !asCapable )
@@ -752,3 +918,21 @@ Timestamp CommonPort::getRxPhyDelay( uint32_t link_speed ) const
 
 	return Timestamp(0, 0, 0);
 }
+
+net_result CommonPort::recv
+( LinkLayerAddress *addr, uint8_t *payload, size_t &length,
+  uint32_t &link_speed )
+{
+	net_result result = halNetworkInterface( net_iface )->
+		nrecv( addr, payload, length );
+	link_speed = this->link_speed;
+	return result;
+}
+
+net_result CommonPort::send
+( LinkLayerAddress *addr, uint16_t etherType, uint8_t *payload,
+  size_t length, bool timestamp )
+{
+	return halNetworkInterface( net_iface )->send
+		( addr, etherType, payload, length, timestamp );
+}
@@ -41,6 +41,9 @@
 #include <avbts_ostimer.hpp>
 #include <avbts_oslock.hpp>
 #include <avbts_osnet.hpp>
+#include <avbts_pool.hpp>
+#include <gptp_stats.hpp>
+#include <foreign_master.hpp>
 #include <unordered_map>
 
 #include <math.h>
@@ -61,6 +64,8 @@ public:
 	 */
 	PortIdentity() { };
 
+	AVBTS_POOLED_NEW
+
 	/**
 	 * @brief  Constructs PortIdentity interface.
 	 * @param  clock_id Clock ID value as defined at IEEE 802.1AS Clause
@@ -261,6 +266,9 @@ typedef struct {
 
 	/* neighbor delay threshold */
 	int64_t neighborPropDelayThreshold;
+
+	/* link flap window in ms, 0 disables the link flap fast path */
+	unsigned int linkFlapWindow;
 } PortInit_t;
 
 
@@ -323,6 +331,7 @@ private:
 	unsigned int wrongSeqIDCounter;
 
 	PortCounters_t counters;
+	PortStatistics stats;
 
 	OSThread *listening_thread;
 	OSThread *link_thread;
@@ -332,11 +341,22 @@ private:
 	Timestamp _peer_offset_ts_mine;
 	bool _peer_offset_init;
 	bool asCapable;
+	bool restored_link_delay;	/* Link delay came from persisted state
+					   or from before a link flap */
+	ClockIdentity link_partner;	/* Sender of the last pdelay response */
+	bool link_partner_valid;
+	ClockIdentity restored_partner;	/* Partner the restored delay was
+					   measured with */
+	bool restored_partner_valid;
+	uint64_t link_flap_window;	/* ns, 0 disables the fast path */
+	bool link_flap_pending;		/* Link down, state kept until the
+					   window expires */
+	uint64_t link_flap_deadline;	/* Device time (ns) the window ends */
 	unsigned sync_count;  /* 0 for master, increment for each sync
 			       * received as slave */
 	unsigned pdelay_count;
 
-	PTPMessageAnnounce *qualified_announce;
+	ForeignMasterTable foreign_masters;
 
 	uint16_t announce_sequence_id;
 	uint16_t signal_sequence_id;
@@ -351,6 +371,9 @@ private:
 protected:
 	static const int64_t INVALID_LINKDELAY = 3600000000000;
 	static const int64_t ONE_WAY_DELAY_DEFAULT = INVALID_LINKDELAY;
+	/* Largest difference between a restored link delay and the first
+	   measured one for which the restored state is kept (ns) */
+	static const int64_t RESTORED_LINK_DELAY_TOLERANCE = 100;
 
 	OSThreadFactory const * const thread_factory;
 	OSTimerFactory const * const timer_factory;
@@ -498,6 +521,8 @@ public:
 	 *  - Port State;
 	 *  - Link Delay;
 	 *  - Neighbor Rate Ratio
+	 * The values are validated and, if any is out of range, the port
+	 * state is left as it was before the call.
 	 * @param  buf Buffer containing the serialized state.
 	 * @param  count Buffer lenght. It is decremented by the same size of
 	 * the variables that are
@@ -506,6 +531,41 @@ public:
 	 */
 	bool restoreSerializedState( void *buf, long *count );
 
+	/**
+	 * @brief  Compares the first measured link delay after a restore
+	 * with the restored one, discarding the restored state if they
+	 * disagree or the link partner changed
+	 * @param  measured Measured link delay in ns
+	 * @param  partner Clock identity of the responder
+	 * @return void
+	 */
+	void checkRestoredLinkDelay
+	( int64_t measured, ClockIdentity partner );
+
+	/**
+	 * @brief  Called on link down. If the link flap window is enabled
+	 * the link delay, neighbor rate ratio and servo state are kept and
+	 * sync/announce receipt timeouts are held off for the window.
+	 * @return void
+	 */
+	void linkFlapStart( void );
+
+	/**
+	 * @brief  Called on link up. Resumes with the state kept by
+	 * linkFlapStart() if the link came back within the window; the
+	 * first pdelay then validates it.
+	 * @return TRUE if the port resumed, FALSE if it restarts normally
+	 */
+	bool linkFlapResume( void );
+
+	/**
+	 * @brief  Whether receipt timeouts are still held off by a link
+	 * flap. Ends the window once its deadline has passed, in case the
+	 * LINK_FLAP_WINDOW_EXPIRES timer never fires.
+	 * @return TRUE while the window runs
+	 */
+	bool linkFlapHolding( void );
+
 	/**
 	 * @brief  Sets the internal variabl sync_receipt_thresh, which is the
 	 * flag that monitors the amount of wrong syncs enabled before
@@ -780,6 +840,15 @@ public:
 		counters.ieee8021AsPortStatTxAnnounce++;
 	}
 
+	/**
+	 * @brief  Gets the port performance statistics
+	 * @return Port statistics
+	 */
+	PortStatistics *getStats( void )
+	{
+		return &stats;
+	}
+
 	/**
 	 * @brief  Logs port counters
 	 * @return void
@@ -992,23 +1061,14 @@ public:
 	 */
 	net_result recv
 	( LinkLayerAddress *addr, uint8_t *payload, size_t &length,
-	  uint32_t &link_speed )
-	{
-		net_result result = net_iface->nrecv( addr, payload, length );
-		link_speed = this->link_speed;
-		return result;
-	}
+	  uint32_t &link_speed );
 
 	/**
 	 * @brief Send frame
 	 */
 	net_result send
 	( LinkLayerAddress *addr, uint16_t etherType, uint8_t *payload,
-	  size_t length, bool timestamp )
-	{
-		return net_iface->send
-		( addr, etherType, payload, length, timestamp );
-	}
+	  size_t length, bool timestamp );
 
 	/**
 	 * @brief Get the payload offset inside a packet
@@ -1056,10 +1116,10 @@ public:
 	}
 
 	/**
-	 * @brief  Gets the "best" announce
-	 * @return Pointer to PTPMessageAnnounce
+	 * @brief  Gets the best foreign master heard on the port
+	 * @return Pointer to ForeignMaster, NULL if there is none
 	 */
-	PTPMessageAnnounce *calculateERBest( void );
+	ForeignMaster *calculateERBest( void );
 
 	/**
 	 * @brief  Changes the port state
@@ -1089,15 +1149,20 @@ public:
 	}
 
 	/**
-	 * @brief  Adds a new qualified announce the port. IEEE 802.1AS
-	 * Clause 10.3.10.2
+	 * @brief  Records a qualified announce in the foreign master table.
+	 * IEEE 802.1AS Clause 10.3.10.2. The announce is not kept.
 	 * @param  annc PTP announce message
+	 * @return TRUE if the best foreign master changed. FALSE otherwise.
+	 */
+	bool updateForeignMaster( PTPMessageAnnounce *annc );
+
+	/**
+	 * @brief  Forgets all foreign masters
 	 * @return void
 	 */
-	void setQualifiedAnnounce( PTPMessageAnnounce *annc )
+	void clearForeignMasters( void )
 	{
-		delete qualified_announce;
-		qualified_announce = annc;
+		foreign_masters.clear();
 	}
 
 	/**
@@ -1322,6 +1387,13 @@ public:
 	 */
 	bool processSyncAnnounceTimeout( Event e );
 
+	/**
+	 * @brief Restarts the sync or announce receipt timer
+	 * @param e Timeout event that expired
+	 * @return void
+	 */
+	void restartReceiptTimer( Event e );
+
 
 	/**
 	 * @brief Perform default event action, can be overridden by media
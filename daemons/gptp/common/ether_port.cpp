@@ -41,6 +41,8 @@
 #include <avbts_osnet.hpp>
 #include <avbts_oscondition.hpp>
 #include <ether_tstamper.hpp>
+#include <gptp_domain.hpp>
+#include <gptp_hal.hpp>
 
 #include <gptp_log.hpp>
 
@@ -80,11 +82,16 @@ OSThreadExitCode openPortWrapper(void *arg)
 EtherPort::~EtherPort()
 {
 	delete port_ready_condition;
+	while( !domain_followers.empty() ) {
+		delete domain_followers.front();
+		domain_followers.pop_front();
+	}
 }
 
 EtherPort::EtherPort( PortInit_t *portInit ) :
 	CommonPort( portInit )
 {
+	ether_tstamper = dynamic_cast<EtherTimestamper *>( _hw_timestamper );
 	automotive_profile = portInit->automotive_profile;
 	linkUp = portInit->linkUp;
 	setTestMode( portInit->testMode );
@@ -235,6 +242,21 @@ void EtherPort::processMessage
 		msg->setTimestamp( rx_timestamp );
 	}
 
+	if( !domain_followers.empty() &&
+	    msg->getDomainNumber() != getClock()->getDomain() )
+	{
+		std::list<DomainFollower *>::iterator it;
+
+		for( it = domain_followers.begin();
+		     it != domain_followers.end(); ++it ) {
+			if( (*it)->getDomain() == msg->getDomainNumber() ) {
+				(*it)->processMessage( this, msg );
+				delete msg;
+				return;
+			}
+		}
+	}
+
 	msg->processMessage(this);
 	if (msg->garbage())
 		delete msg;
@@ -401,6 +423,7 @@ bool EtherPort::_processEvent( Event e )
 		}
 		else {
 			GPTP_LOG_STATUS("LINKUP");
+			linkFlapResume();
 		}
 
 		if (automotive_profile) {
@@ -463,6 +486,7 @@ bool EtherPort::_processEvent( Event e )
 			GPTP_LOG_EXCEPTION("LINK DOWN");
 		}
 		else {
+			linkFlapStart();
 			setAsCapable(false);
 			GPTP_LOG_STATUS("LINK DOWN");
 		}
@@ -583,11 +607,10 @@ bool EtherPort::_processEvent( Event e )
 			{
 				Timestamp sync_timestamp = sync->getTimestamp();
 
-				GPTP_LOG_VERBOSE("Successful Sync timestamp");
-				GPTP_LOG_VERBOSE("Seconds: %u",
-						 sync_timestamp.seconds_ls);
-				GPTP_LOG_VERBOSE("Nanoseconds: %u",
-						 sync_timestamp.nanoseconds);
+				GPTP_LOG_VERBOSE_BIN("Successful Sync timestamp, "
+						     "Seconds: %llu Nanoseconds: %llu",
+						     sync_timestamp.seconds_ls,
+						     sync_timestamp.nanoseconds);
 
 				PTPMessageFollowUp *follow_up = new PTPMessageFollowUp(this);
 				PortIdentity dest_id;
@@ -596,8 +619,9 @@ bool EtherPort::_processEvent( Event e )
 				follow_up->setClockSourceTime(getClock()->getFUPInfo());
 				follow_up->setPortIdentity(&dest_id);
 				follow_up->setSequenceId(sync->getSequenceId());
-				follow_up->setPreciseOriginTimestamp
-					(sync_timestamp);
+				if( !relaySyncTime( follow_up, sync_timestamp ))
+					follow_up->setPreciseOriginTimestamp
+						(sync_timestamp);
 				follow_up->sendPort(this, NULL);
 				delete follow_up;
 			} else {
@@ -702,8 +726,48 @@ void EtherPort::recoverPort( void )
 	return;
 }
 
+bool EtherPort::relaySyncTime
+( PTPMessageFollowUp *follow_up, Timestamp sync_timestamp )
+{
+	SyncRelayInfo relay;
+	Timestamp system_time;
+	Timestamp device_time;
+	uint32_t local_clock, nominal_clock_rate;
+	uint64_t tx_system;
+	int64_t residence;
+	int64_t correction;
+
+	if( !clock->getSyncRelayInfo( relay ) || relay.port == this )
+		return false;
+
+	/* Convert the sync transmit time on this port's device clock into
+	   system time, the common timebase of all ports */
+	getDeviceTime( system_time, device_time, local_clock,
+		       nominal_clock_rate );
+	tx_system = TIMESTAMP_TO_NS( system_time ) -
+		(TIMESTAMP_TO_NS( device_time ) -
+		 TIMESTAMP_TO_NS( sync_timestamp ));
+
+	residence = (int64_t) (tx_system - relay.system_at_rx);
+	if( residence < 0 || (uint64_t) residence > SYNC_RELAY_MAX_AGE_NS )
+		return false;
+
+	/* Residence time is measured on the system clock; express it in
+	   grandmaster time and carry it in the correction field */
+	correction = (int64_t) (residence * relay.gm_system_rate);
+
+	follow_up->setPreciseOriginTimestamp( relay.origin );
+	follow_up->setCorrectionField( correction << 16 );
+
+	GPTP_LOG_VERBOSE( "Relaying sync, residence time: %lld ns",
+			  (long long) residence );
+
+	return true;
+}
+
 void EtherPort::becomeMaster( bool annc ) {
 	setPortState( PTP_MASTER );
+	clock->clearSyncRelayInfo( this );
 	// Stop announce receipt timeout timer
 	clock->deleteEventTimerLocked( this, ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES );
 
@@ -783,11 +847,10 @@ int EtherPort::getTxTimestamp
 (PortIdentity *sourcePortIdentity, PTPMessageId messageId,
  Timestamp &timestamp, unsigned &counter_value, bool last )
 {
-	EtherTimestamper *timestamper =
-		dynamic_cast<EtherTimestamper *>(_hw_timestamper);
-	if (timestamper)
+	if (ether_tstamper)
 	{
-		return timestamper->HWTimestamper_txtimestamp
+		return halEtherTimestamper( ether_tstamper )->
+			HWTimestamper_txtimestamp
 			( sourcePortIdentity, messageId, timestamp,
 			  counter_value, last );
 	}
@@ -799,11 +862,10 @@ int EtherPort::getRxTimestamp
 ( PortIdentity * sourcePortIdentity, PTPMessageId messageId,
   Timestamp &timestamp, unsigned &counter_value, bool last )
 {
-	EtherTimestamper *timestamper =
-		dynamic_cast<EtherTimestamper *>(_hw_timestamper);
-	if (timestamper)
+	if (ether_tstamper)
 	{
-		return timestamper->HWTimestamper_rxtimestamp
+		return halEtherTimestamper( ether_tstamper )->
+			HWTimestamper_rxtimestamp
 		    (sourcePortIdentity, messageId, timestamp, counter_value,
 		     last);
 	}
@@ -811,6 +873,31 @@ int EtherPort::getRxTimestamp
 	return 0;
 }
 
+bool EtherPort::getPDelayRxLock()
+{
+	return halLock( pdelay_rx_lock )->lock() == oslock_ok;
+}
+
+bool EtherPort::tryPDelayRxLock()
+{
+	return halLock( pdelay_rx_lock )->trylock() == oslock_ok;
+}
+
+bool EtherPort::putPDelayRxLock()
+{
+	return halLock( pdelay_rx_lock )->unlock() == oslock_ok;
+}
+
+bool EtherPort::getTxLock()
+{
+	return halLock( port_tx_lock )->lock() == oslock_ok;
+}
+
+bool EtherPort::putTxLock()
+{
+	return halLock( port_tx_lock )->unlock() == oslock_ok;
+}
+
 void EtherPort::startPDelayIntervalTimer
 ( long long unsigned int waitTime )
 {
@@ -85,7 +85,10 @@ typedef std::map < PortIdentity, LinkLayerAddress > IdentityMap_t;
 /**
  * @brief Ethernet specific port functions
  */
-class EtherPort : public CommonPort
+class DomainFollower;
+class EtherTimestamper;
+
+class EtherPort final : public CommonPort
 {
 	static LinkLayerAddress other_multicast;
 	static LinkLayerAddress pdelay_multicast;
@@ -126,6 +129,9 @@ class EtherPort : public CommonPort
 	// Automotive Profile AVB SYNC state indicator. > 0 will inditate valid AVB SYNC state
 	uint32_t avbSyncState;
 
+	/* Additional gPTP domains followed on this port */
+	std::list<DomainFollower *> domain_followers;
+
 	uint16_t pdelay_sequence_id;
 	PTPMessagePathDelayReq *last_pdelay_req;
 	PTPMessagePathDelayResp *last_pdelay_resp;
@@ -140,6 +146,9 @@ class EtherPort : public CommonPort
 	OSLock *pdelay_rx_lock;
 	OSLock *port_tx_lock;
 
+	/* _hw_timestamper, looked up once for the timestamp requests */
+	EtherTimestamper *ether_tstamper;
+
 	OSLock *pDelayIntervalTimerLock;
 
 	net_result port_send
@@ -150,6 +159,16 @@ class EtherPort : public CommonPort
 	bool pdelay_halted;
 	bool sync_rate_interval_timer_started;
 
+	/**
+	 * @brief  Fills a follow-up with the time received on the relay's
+	 * slave port, adding the residence time to the correction field
+	 * @param  follow_up [in] Follow-up message being sent
+	 * @param  sync_timestamp Device transmit time of the paired sync
+	 * @return TRUE if relay information was applied
+	 */
+	bool relaySyncTime
+	( PTPMessageFollowUp *follow_up, Timestamp sync_timestamp );
+
 protected:
 	static const unsigned int DUPLICATE_RESP_THRESH = 3;
 
@@ -279,29 +298,6 @@ protected:
 	 */
 	bool _processEvent(Event e);
 
-	/**
-	 * @brief  Adds a foreign master.
-	 * @param  msg [in] PTP announce message
-	 * @return void
-	 * @todo Currently not implemented
-	 */
-	void addForeignMaster(PTPMessageAnnounce * msg);
-
-	/**
-	 * @brief  Remove a foreign master.
-	 * @param  msg [in] PTP announce message
-	 * @return void
-	 * @todo Currently not implemented
-	 */
-	void removeForeignMaster(PTPMessageAnnounce * msg);
-
-	/**
-	 * @brief  Remove all foreign masters.
-	 * @return void
-	 * @todo Currently not implemented
-	 */
-	void removeForeignMasterAll(void);
-
 	/**
 	 * @brief  Gets the pDelay minimum interval
 	 * @return PDelay interval
@@ -357,6 +353,18 @@ protected:
 	 */
 	void setParentLastSyncSequenceNumber(uint16_t num);
 
+	/**
+	 * @brief  Follows an additional gPTP domain on this port. Messages
+	 * of the domain go to the follower instead of the port. The port
+	 * takes ownership of the follower.
+	 * @param  follower [in] Follower of the domain
+	 * @return void
+	 */
+	void addDomainFollower( DomainFollower *follower )
+	{
+		domain_followers.push_back( follower );
+	}
+
 	/**
 	 * @brief  Sets last sync ptp message
 	 * @param  msg [in] PTP sync message
@@ -378,33 +386,23 @@ protected:
 	 * @brief  Locks PDelay RX
 	 * @return TRUE if acquired the lock. FALSE otherwise
 	 */
-	bool getPDelayRxLock() {
-		return pdelay_rx_lock->lock() == oslock_ok ? true : false;
-	}
+	bool getPDelayRxLock();
 
 	/**
 	 * @brief  Do a trylock on the PDelay RX
 	 * @return TRUE if acquired the lock. FALSE otherwise.
 	 */
-	bool tryPDelayRxLock() {
-		return pdelay_rx_lock->trylock() == oslock_ok ? true : false;
-	}
+	bool tryPDelayRxLock();
 
 	/**
 	 * @brief  Unlocks PDelay RX.
 	 * @return TRUE if success. FALSE otherwise
 	 */
-	bool putPDelayRxLock() {
-		return pdelay_rx_lock->unlock() == oslock_ok ? true : false;
-	}
+	bool putPDelayRxLock();
 
-	bool getTxLock() {
-		return port_tx_lock->lock() == oslock_ok ? true : false;
-	}
+	bool getTxLock();
 
-	bool putTxLock() {
-		return port_tx_lock->unlock() == oslock_ok ? true : false;
-	}
+	bool putTxLock();
 
 	/**
 	 * @brief  Sets the last_pdelay_req message
@@ -0,0 +1,182 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+
+/**@file*/
+
+#include <foreign_master.hpp>
+#include <avbts_clock.hpp>
+#include <avbts_message.hpp>
+
+BmcaKey BmcaKey::make
+( uint8_t priority1, uint8_t cq_class, uint8_t accuracy, int16_t variance,
+  uint8_t priority2, const uint8_t *identity )
+{
+	BmcaKey key;
+	int i;
+
+	/* Same order as the octet compare of Clause 10.3.5 */
+	key.hi = ((uint64_t) priority1 << 40) |
+		((uint64_t) cq_class << 32) |
+		((uint64_t) accuracy << 24) |
+		((uint64_t) (uint16_t) variance << 8) |
+		(uint64_t) priority2;
+	key.lo = 0;
+	for( i = 0; i < PTP_CLOCK_IDENTITY_LENGTH; ++i )
+		key.lo = (key.lo << 8) | identity[i];
+
+	return key;
+}
+
+ClockQuality ForeignMaster::getGrandmasterClockQuality( void ) const
+{
+	ClockQuality quality;
+
+	quality.cq_class = cq_class;
+	quality.clockAccuracy = accuracy;
+	quality.offsetScaledLogVariance = variance;
+
+	return quality;
+}
+
+void ForeignMasterTable::findBest( void )
+{
+	unsigned i;
+
+	best = count ? 0 : -1;
+	for( i = 1; i < count; ++i )
+		if( entries[i].key < entries[best].key )
+			best = i;
+}
+
+void ForeignMasterTable::remove( unsigned i )
+{
+	entries[i] = entries[--count];
+}
+
+bool ForeignMasterTable::expire( uint64_t now, uint64_t timeout )
+{
+	ForeignMaster *prev = getBest();
+	BmcaKey prev_key;
+	bool removed = false;
+	unsigned i;
+
+	if( prev != NULL )
+		prev_key = prev->key;
+
+	for( i = 0; i < count; ) {
+		if( now - entries[i].last_seen > timeout ) {
+			remove( i );
+			removed = true;
+		} else
+			++i;
+	}
+	if( !removed )
+		return false;
+
+	findBest();
+	return best < 0 || entries[best].key != prev_key;
+}
+
+bool ForeignMasterTable::update
+( PTPMessageAnnounce *annc, uint64_t now, uint64_t timeout )
+{
+	ClockQuality *quality = annc->getGrandmasterClockQuality();
+	PortIdentity source;
+	ClockIdentity source_id;
+	uint16_t source_port;
+	uint8_t gm[PTP_CLOCK_IDENTITY_LENGTH];
+	ForeignMaster *fm = NULL;
+	BmcaKey key, prev_key;
+	bool had_best;
+	unsigned i;
+
+	had_best = best >= 0;
+	if( had_best )
+		prev_key = entries[best].key;
+	expire( now, timeout );
+
+	annc->getPortIdentity( &source );
+	source_id = source.getClockIdentity();
+	source.getPortNumber( &source_port );
+	annc->getGrandmasterIdentity( (char *) gm );
+	key = BmcaKey::make
+		( annc->getGrandmasterPriority1(), quality->cq_class,
+		  quality->clockAccuracy, quality->offsetScaledLogVariance,
+		  annc->getGrandmasterPriority2(), gm );
+
+	for( i = 0; i < count; ++i ) {
+		if( entries[i].source_port == source_port &&
+		    entries[i].source == source_id ) {
+			fm = &entries[i];
+			break;
+		}
+	}
+
+	if( fm == NULL ) {
+		if( count < FOREIGN_MASTER_MAX ) {
+			i = count++;
+		} else {
+			unsigned worst = 0;
+
+			for( i = 1; i < count; ++i )
+				if( entries[worst].key < entries[i].key )
+					worst = i;
+			/* A full table only lets in a better system */
+			if( !( key < entries[worst].key ))
+				return !had_best || entries[best].key != prev_key;
+			i = worst;
+		}
+		fm = &entries[i];
+		fm->source = source_id;
+		fm->source_port = source_port;
+	}
+
+	fm->key = key;
+	memcpy( fm->grandmaster_identity, gm, sizeof( gm ));
+	fm->priority1 = annc->getGrandmasterPriority1();
+	fm->priority2 = annc->getGrandmasterPriority2();
+	fm->cq_class = quality->cq_class;
+	fm->accuracy = quality->clockAccuracy;
+	fm->variance = quality->offsetScaledLogVariance;
+	fm->steps_removed = annc->getStepsRemoved();
+	fm->last_seen = now;
+
+	if( best < 0 || key < entries[best].key )
+		best = i;
+	else if( best == (int) i && key != prev_key )
+		/* The best system got worse, another may win now */
+		findBest();
+
+	return !had_best || entries[best].key != prev_key;
+}
@@ -0,0 +1,233 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+
+#ifndef FOREIGN_MASTER_HPP
+#define FOREIGN_MASTER_HPP
+
+/**@file*/
+
+#include <stdint.h>
+#include <ieee1588.hpp>
+
+#define FOREIGN_MASTER_MAX 8	/*!< Foreign masters tracked per port */
+
+/**
+ * @brief BMCA comparison key of a grandmaster (IEEE 802.1AS-2011 Clause
+ * 10.3.5). priority1, clockClass, clockAccuracy, offsetScaledLogVariance
+ * and priority2 are packed into hi, the grandmaster identity into lo, so
+ * comparing two systems is two integer compares. The smaller key wins.
+ */
+struct BmcaKey {
+	uint64_t hi;	//!< priority1 .. priority2, 48 bits
+	uint64_t lo;	//!< Grandmaster clock identity, big endian
+
+	/**
+	 * @brief  Builds the key of a system
+	 * @param  priority1 Grandmaster priority1
+	 * @param  cq_class Grandmaster clockClass
+	 * @param  accuracy Grandmaster clockAccuracy
+	 * @param  variance Grandmaster offsetScaledLogVariance
+	 * @param  priority2 Grandmaster priority2
+	 * @param  identity Grandmaster clock identity (PTP_CLOCK_IDENTITY_LENGTH)
+	 * @return The key
+	 */
+	static BmcaKey make
+	( uint8_t priority1, uint8_t cq_class, uint8_t accuracy,
+	  int16_t variance, uint8_t priority2, const uint8_t *identity );
+
+	bool operator<( const BmcaKey &cmp ) const {
+		return hi < cmp.hi || ( hi == cmp.hi && lo < cmp.lo );
+	}
+
+	bool operator==( const BmcaKey &cmp ) const {
+		return hi == cmp.hi && lo == cmp.lo;
+	}
+
+	bool operator!=( const BmcaKey &cmp ) const {
+		return !( *this == cmp );
+	}
+};
+
+/**
+ * @brief A system announced on a port, the data set of IEEE 802.1AS-2011
+ * Clause 10.3.10.2 that BMCA needs. It is kept up to date from the
+ * announces of its source in place, the announces themselves are not
+ * kept.
+ */
+class ForeignMaster {
+	friend class ForeignMasterTable;
+
+	BmcaKey key;
+	ClockIdentity source;		/* Sender of the announces */
+	uint16_t source_port;
+	uint8_t grandmaster_identity[PTP_CLOCK_IDENTITY_LENGTH];
+	uint8_t priority1;
+	uint8_t priority2;
+	uint8_t cq_class;
+	uint8_t accuracy;
+	int16_t variance;
+	uint16_t steps_removed;
+	uint64_t last_seen;		/* ns, system time of the last announce */
+public:
+	/**
+	 * @brief  Gets the BMCA comparison key
+	 * @return Reference to the key
+	 */
+	const BmcaKey &getKey( void ) const {
+		return key;
+	}
+
+	/**
+	 * @brief  Compares this system against another
+	 * @param  fm [in] Foreign master to compare with
+	 * @return TRUE if this system is better. FALSE otherwise.
+	 */
+	bool isBetterThan( const ForeignMaster *fm ) const {
+		return key < fm->key;
+	}
+
+	/**
+	 * @brief  Gets grandmaster's priority1 value
+	 * @return Grandmaster priority1
+	 */
+	unsigned char getGrandmasterPriority1( void ) const {
+		return priority1;
+	}
+
+	/**
+	 * @brief  Gets grandmaster's priority2 value
+	 * @return Grandmaster priority2
+	 */
+	unsigned char getGrandmasterPriority2( void ) const {
+		return priority2;
+	}
+
+	/**
+	 * @brief  Gets grandmaster clock quality
+	 * @return Grandmaster ClockQuality
+	 */
+	ClockQuality getGrandmasterClockQuality( void ) const;
+
+	/**
+	 * @brief  Gets the steps removed value
+	 * @return steps removed value
+	 */
+	uint16_t getStepsRemoved( void ) const {
+		return steps_removed;
+	}
+
+	/**
+	 * @brief  Gets grandmaster identity value
+	 * @param  identity [out] Grandmaster identity
+	 * @return void
+	 */
+	void getGrandmasterIdentity( char *identity ) const {
+		memcpy( identity, grandmaster_identity,
+			PTP_CLOCK_IDENTITY_LENGTH );
+	}
+
+	/**
+	 * @brief  Gets grandmaster's clockIdentity value
+	 * @return Grandmaster ClockIdentity
+	 */
+	ClockIdentity getGrandmasterClockIdentity( void ) const {
+		ClockIdentity ret;
+		ret.set( (uint8_t *) grandmaster_identity );
+		return ret;
+	}
+};
+
+/**
+ * @brief Foreign masters heard on one port. A fixed array, updated in
+ * place on every announce; the best entry is tracked as entries change,
+ * so neither an announce nor a BMCA run allocates or scans more than
+ * FOREIGN_MASTER_MAX entries. An entry that has not announced within the
+ * announce receipt timeout is dropped.
+ */
+class ForeignMasterTable {
+	ForeignMaster entries[FOREIGN_MASTER_MAX];
+	unsigned count;
+	int best;			/* Index of the best entry, -1 if empty */
+
+	void findBest( void );
+	void remove( unsigned i );
+public:
+	ForeignMasterTable() : count(0), best(-1) { }
+
+	/**
+	 * @brief  Records an announce. Known sources are updated in place; a
+	 * new source takes a free entry or replaces the worst one if it is
+	 * better than that.
+	 * @param  annc [in] Qualified announce
+	 * @param  now System time (ns)
+	 * @param  timeout Announce receipt timeout (ns), older entries expire
+	 * @return TRUE if the best entry changed. FALSE otherwise.
+	 */
+	bool update( PTPMessageAnnounce *annc, uint64_t now, uint64_t timeout );
+
+	/**
+	 * @brief  Drops the entries not heard from since now - timeout
+	 * @param  now System time (ns)
+	 * @param  timeout Announce receipt timeout (ns)
+	 * @return TRUE if the best entry changed. FALSE otherwise.
+	 */
+	bool expire( uint64_t now, uint64_t timeout );
+
+	/**
+	 * @brief  Drops all entries
+	 * @return void
+	 */
+	void clear( void ) {
+		count = 0;
+		best = -1;
+	}
+
+	/**
+	 * @brief  Gets the best foreign master
+	 * @return Pointer to the entry, NULL if the table is empty
+	 */
+	ForeignMaster *getBest( void ) {
+		return best < 0 ? NULL : &entries[best];
+	}
+
+	/**
+	 * @brief  Gets the number of foreign masters
+	 * @return Entries in use
+	 */
+	unsigned size( void ) const {
+		return count;
+	}
+};
+
+#endif/*FOREIGN_MASTER_HPP*/
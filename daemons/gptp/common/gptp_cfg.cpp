@@ -39,19 +39,28 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 /* need Microsoft version for strcasecmp() from GCC strings.h */
 #ifdef _MSC_VER
 #define strcasecmp _stricmp
+#define strncasecmp _strnicmp
 #else
 #include <strings.h>
 #endif
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "gptp_cfg.hpp"
 
 uint32_t findSpeedByName( const char *name, const char **end );
 
+/* [threads] key prefixes, indexed by OSThreadRole */
+static const char *thread_role_names[OSTHREAD_ROLE_COUNT] =
+{
+    NULL, "event", "timer", "link", "ipc"
+};
+
 GptpIniParser::GptpIniParser(std::string filename)
 {
+    _config.linkFlapWindow = 0;
     _error = ini_parse(filename.c_str(), iniCallBack, this);
 }
 
@@ -85,6 +94,42 @@ int GptpIniParser::iniCallBack(void *user, const char *section, const char *name
                 parser->_config.priority1 = p1;
             }
         }
+        else if( parseMatch(name, "servo") )
+        {
+            valOK = RateServo::typeByName
+                ( value, parser->_config.servo.type );
+        }
+        else if( parseMatch(name, "servo_window") )
+        {
+            errno = 0;
+            char *pEnd;
+            unsigned int win = strtoul(value, &pEnd, 10);
+            if( *pEnd == '\0' && errno == 0 && win >= 2 &&
+                win <= SERVO_MAX_WINDOW ) {
+                valOK = true;
+                parser->_config.servo.window = win;
+            }
+        }
+        else if( parseMatch(name, "servo_pi_kp") ||
+                 parseMatch(name, "servo_pi_ki") ||
+                 parseMatch(name, "servo_kalman_q") ||
+                 parseMatch(name, "servo_kalman_r") )
+        {
+            errno = 0;
+            char *pEnd;
+            FrequencyRatio v = strtold(value, &pEnd);
+            if( *pEnd == '\0' && errno == 0 && v >= 0.0 ) {
+                valOK = true;
+                if( parseMatch(name, "servo_pi_kp") )
+                    parser->_config.servo.pi_kp = v;
+                else if( parseMatch(name, "servo_pi_ki") )
+                    parser->_config.servo.pi_ki = v;
+                else if( parseMatch(name, "servo_kalman_q") )
+                    parser->_config.servo.kalman_q = v;
+                else
+                    parser->_config.servo.kalman_r = v;
+            }
+        }
     }
     else if( parseMatch(section, "port") )
     {
@@ -148,6 +193,44 @@ int GptpIniParser::iniCallBack(void *user, const char *section, const char *name
                 parser->_config.lostPdelayRespThresh = lostpdelayth;
             }
         }
+        else if( parseMatch(name, "linkFlapWindow") )
+        {
+            errno = 0;
+            char *pEnd;
+            unsigned int lfw = strtoul(value, &pEnd, 10);
+            if( *pEnd == '\0' && errno == 0) {
+                valOK = true;
+                parser->_config.linkFlapWindow = lfw;
+            }
+        }
+    }
+    else if( parseMatch(section, "threads") )
+    {
+        for( int role = 1; role < OSTHREAD_ROLE_COUNT; ++role )
+        {
+            const char *prefix = thread_role_names[role];
+            size_t len = strlen(prefix);
+
+            if( strncasecmp(name, prefix, len) != 0 || name[len] != '_' )
+                continue;
+
+            OSThreadSched &sched = parser->_config.thread_sched[role];
+            if( parseMatch(name + len + 1, "priority") )
+            {
+                errno = 0;
+                char *pEnd;
+                unsigned int prio = strtoul(value, &pEnd, 10);
+                if( *pEnd == '\0' && errno == 0 && prio <= 99 ) {
+                    valOK = true;
+                    sched.priority = prio;
+                }
+            }
+            else if( parseMatch(name + len + 1, "cpus") )
+            {
+                valOK = parseCpuList(value, sched.cpus);
+            }
+            break;
+        }
     }
     else if( parseMatch(section, "eth") )
     {
@@ -235,6 +318,61 @@ bool GptpIniParser::parseMatch(const char *s1, const char *s2)
     return strcasecmp(s1, s2) == 0;
 }
 
+/* Comma separated CPUs and CPU ranges, e.g. "2,4-5", below 64 */
+bool GptpIniParser::parseCpuList(const char *value, uint64_t &cpus)
+{
+    uint64_t set = 0;
+    const char *p = value;
+
+    while( *p != '\0' )
+    {
+        char *pEnd;
+        unsigned long first, last;
+
+        errno = 0;
+        first = strtoul(p, &pEnd, 10);
+        if( pEnd == p || errno != 0 )
+            return false;
+        last = first;
+        if( *pEnd == '-' )
+        {
+            p = pEnd + 1;
+            last = strtoul(p, &pEnd, 10);
+            if( pEnd == p || errno != 0 )
+                return false;
+        }
+        if( first > last || last >= 64 )
+            return false;
+        for( unsigned long cpu = first; cpu <= last; ++cpu )
+            set |= (uint64_t)1 << cpu;
+
+        p = pEnd;
+        if( *p == ',' )
+            ++p;
+        else if( *p != '\0' )
+            return false;
+    }
+
+    if( set == 0 )
+        return false;
+    cpus = set;
+    return true;
+}
+
+void GptpIniParser::print_thread_sched( void )
+{
+    for( int role = 1; role < OSTHREAD_ROLE_COUNT; ++role )
+    {
+        const OSThreadSched &sched = _config.thread_sched[role];
+
+        if( sched.priority == 0 && sched.cpus == 0 )
+            continue;
+        GPTP_LOG_INFO("%s thread: priority %d, CPUs 0x%llx",
+                      thread_role_names[role], sched.priority,
+                      (unsigned long long) sched.cpus);
+    }
+}
+
 #define PHY_DELAY_DESC_LEN 21
 
 void GptpIniParser::print_phy_delay( void )
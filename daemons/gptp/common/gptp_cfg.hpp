@@ -39,6 +39,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "ini.h"
 #include <limits.h>
 #include <common_port.hpp>
+#include <gptp_servo.hpp>
+#include <avbts_osthread.hpp>
 
 const uint32_t LINKSPEED_10G =		10000000;
 const uint32_t LINKSPEED_2_5G =		2500000;
@@ -67,6 +69,7 @@ class GptpIniParser
         {
             /*ptp data set*/
             unsigned char priority1;
+            ServoConfig servo;		//!< Master to local rate servo
 
             /*port data set*/
             unsigned int announceReceiptTimeout;
@@ -75,11 +78,15 @@ class GptpIniParser
             int64_t neighborPropDelayThresh;
             unsigned int seqIdAsCapableThresh;
             uint16_t lostPdelayRespThresh;
+            unsigned int linkFlapWindow;		//!< Link flap fast path window in ms, 0 disables it
             PortState port_state;
 
             /*ethernet adapter data set*/
 	    std::string ifname;
 		phy_delay_map_t phy_delay;
+
+            /*thread scheduling, indexed by OSThreadRole*/
+            OSThreadSched thread_sched[OSTHREAD_ROLE_COUNT];
         } gptp_cfg_t;
 
         /*public methods*/
@@ -103,6 +110,16 @@ class GptpIniParser
             return _config.priority1;
         }
 
+        /**
+         * @brief  Reads the rate servo configuration
+         * @param  void
+         * @return Servo configuration, defaults if not in the .ini file
+         */
+        const ServoConfig getServoConfig(void)
+        {
+            return _config.servo;
+        }
+
         /**
          * @brief  Reads the announceReceiptTimeout configuration value
          * @param  void
@@ -152,16 +169,41 @@ class GptpIniParser
             return _config.syncReceiptThresh;
         }
 
+        /**
+         * @brief  Reads the link flap window from the configuration file
+         * @return linkFlapWindow value from the .ini file, in ms
+         */
+        unsigned int getLinkFlapWindow(void)
+        {
+            return _config.linkFlapWindow;
+        }
+
+        /**
+         * @brief  Reads the scheduling of a kind of thread
+         * @param  role Thread role
+         * @return Scheduling from the .ini file, default if not set
+         */
+        const OSThreadSched getThreadSched(OSThreadRole role)
+        {
+            return _config.thread_sched[role];
+        }
+
 	/**
 	 * @brief Dump PHY delays to screen
 	 */
 	void print_phy_delay( void );
 
+	/**
+	 * @brief Dump thread scheduling to screen
+	 */
+	void print_thread_sched( void );
+
     private:
         int _error;
         gptp_cfg_t _config;
 
         static int iniCallBack(void *user, const char *section, const char *name, const char *value);
         static bool parseMatch(const char *s1, const char *s2);
+        static bool parseCpuList(const char *value, uint64_t &cpus);
 };
 
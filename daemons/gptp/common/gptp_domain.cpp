@@ -0,0 +1,171 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+/**@file*/
+
+#include <gptp_domain.hpp>
+#include <avbts_message.hpp>
+#include <avbts_osipc.hpp>
+#include <ether_port.hpp>
+#include <gptp_log.hpp>
+
+#include <string.h>
+
+DomainFollower::DomainFollower
+( uint8_t domain, unsigned index, OS_IPC *ipc, const ServoConfig &config )
+{
+	this->domain = domain;
+	this->index = index;
+	this->ipc = ipc;
+	rate_servo = RateServo::create( config );
+	master_known = false;
+	memset( grandmaster_id, 0, sizeof( grandmaster_id ));
+	sync_count = 0;
+	restart();
+}
+
+DomainFollower::~DomainFollower()
+{
+	delete rate_servo;
+}
+
+void DomainFollower::restart( void )
+{
+	sync_valid = false;
+	ml_freqoffset = 1.0;
+	prev_master_ns = 0;
+	rate_servo->clear();
+}
+
+void DomainFollower::processMessage( EtherPort *port, PTPMessageCommon *msg )
+{
+	switch( msg->getMessageType() ) {
+	case SYNC_MESSAGE:
+		processSync( port, (PTPMessageSync *) msg );
+		break;
+	case FOLLOWUP_MESSAGE:
+		processFollowUp( port, (PTPMessageFollowUp *) msg );
+		break;
+	case ANNOUNCE_MESSAGE:
+		processAnnounce( (PTPMessageAnnounce *) msg );
+		break;
+	default:
+		/* Peer delay is measured in the port's own domain */
+		break;
+	}
+}
+
+void DomainFollower::processSync( EtherPort *port, PTPMessageSync *msg )
+{
+	PortIdentity source;
+
+	msg->getPortIdentity( &source );
+	if( !master_known || source != master ) {
+		GPTP_LOG_STATUS( "Domain %u: following a new master port",
+				 (unsigned) domain );
+		master = source;
+		master_known = true;
+		restart();
+	}
+
+	sync_source = source;
+	sync_sequence_id = msg->getSequenceId();
+	sync_arrival = msg->getTimestamp();
+	sync_valid = true;
+}
+
+void DomainFollower::processFollowUp( EtherPort *port, PTPMessageFollowUp *msg )
+{
+	PortIdentity source;
+	Timestamp origin;
+	uint64_t delay;
+	uint64_t master_ns, local_ns;
+	int64_t correction;
+
+	msg->getPortIdentity( &source );
+	if( !sync_valid || msg->getSequenceId() != sync_sequence_id ||
+	    source != sync_source ) {
+		GPTP_LOG_VERBOSE( "Domain %u: Follow Up without a matching Sync",
+				  (unsigned) domain );
+		return;
+	}
+	sync_valid = false;
+
+	if( sync_arrival._version != port->getTimestampVersion() ||
+	    !port->getLinkDelay( &delay ))
+		return;
+
+	correction = (int64_t) ( delay * ml_freqoffset ) +
+		msg->getCorrectionField() / ( 1 << 16 );
+	origin = msg->getPreciseOriginTimestamp();
+	master_ns = TIMESTAMP_TO_NS( origin ) + correction;
+	local_ns = TIMESTAMP_TO_NS( sync_arrival );
+
+	if( master_ns < prev_master_ns ) {
+		GPTP_LOG_ERROR( "Domain %u: negative time jump detected",
+				(unsigned) domain );
+		restart();
+		return;
+	}
+	prev_master_ns = master_ns;
+
+	ml_freqoffset = rate_servo->sample( master_ns, local_ns );
+	++sync_count;
+
+	GPTP_LOG_VERBOSE( "Domain %u: offset %lld ns, rate %.12Lf",
+			  (unsigned) domain, (long long) ( local_ns - master_ns ),
+			  (long double) ml_freqoffset );
+
+	if( ipc != NULL )
+		ipc->update_domain
+			( index, domain, grandmaster_id,
+			  (int64_t) ( local_ns - master_ns ), ml_freqoffset,
+			  local_ns, sync_count );
+}
+
+void DomainFollower::processAnnounce( PTPMessageAnnounce *msg )
+{
+	uint8_t gm[PTP_CLOCK_IDENTITY_LENGTH];
+
+	msg->getGrandmasterIdentity( (char *) gm );
+	if( memcmp( gm, grandmaster_id, sizeof( gm )) == 0 )
+		return;
+
+	memcpy( grandmaster_id, gm, sizeof( gm ));
+	GPTP_LOG_STATUS
+		( "Domain %u: grandmaster %02x%02x%02x%02x%02x%02x%02x%02x",
+		  (unsigned) domain, gm[0], gm[1], gm[2], gm[3], gm[4], gm[5],
+		  gm[6], gm[7] );
+	/* The rate is relative to the old grandmaster */
+	restart();
+}
@@ -0,0 +1,121 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifndef GPTP_DOMAIN_HPP
+#define GPTP_DOMAIN_HPP
+
+/**@file*/
+
+#include <stdint.h>
+#include <ieee1588.hpp>
+#include <common_port.hpp>
+#include <gptp_servo.hpp>
+
+class EtherPort;
+class OS_IPC;
+class PTPMessageCommon;
+class PTPMessageSync;
+class PTPMessageFollowUp;
+class PTPMessageAnnounce;
+
+/**
+ * @brief Follows an additional gPTP domain on a port. Sync, Follow_Up and
+ * Announce messages of the domain arrive on the port's socket and are
+ * timestamped by the port's timestamper like those of the port's own
+ * domain, and the link delay the port measures is common to all domains.
+ * The follower only listens: it never transmits and never adjusts the
+ * local clock, which stays disciplined to the port's own domain. Its sync
+ * results are published with OS_IPC::update_domain().
+ */
+class DomainFollower {
+private:
+	uint8_t domain;
+	unsigned index;
+	OS_IPC *ipc;
+	RateServo *rate_servo;
+
+	/* Sync waiting for its Follow_Up */
+	bool sync_valid;
+	uint16_t sync_sequence_id;
+	PortIdentity sync_source;
+	Timestamp sync_arrival;
+
+	bool master_known;
+	PortIdentity master;
+	uint8_t grandmaster_id[PTP_CLOCK_IDENTITY_LENGTH];
+	FrequencyRatio ml_freqoffset;
+	uint64_t prev_master_ns;
+	uint32_t sync_count;
+
+	void processSync( EtherPort *port, PTPMessageSync *msg );
+	void processFollowUp( EtherPort *port, PTPMessageFollowUp *msg );
+	void processAnnounce( PTPMessageAnnounce *msg );
+
+	/**
+	 * @brief  Starts over with a new master or after a time jump
+	 * @return void
+	 */
+	void restart( void );
+public:
+	/**
+	 * @brief  Creates a follower
+	 * @param  domain gPTP domain number to follow
+	 * @param  index IPC domain slot, starting at 1
+	 * @param  ipc IPC to publish to, may be NULL
+	 * @param  config Rate servo configuration
+	 */
+	DomainFollower
+	( uint8_t domain, unsigned index, OS_IPC *ipc,
+	  const ServoConfig &config );
+	~DomainFollower();
+
+	/**
+	 * @brief  Gets the domain followed
+	 * @return gPTP domain number
+	 */
+	uint8_t getDomain( void )
+	{
+		return domain;
+	}
+
+	/**
+	 * @brief  Processes a message of the domain received on the port.
+	 * The caller keeps ownership of the message.
+	 * @param  port Port the message arrived on
+	 * @param  msg Message, RX timestamp already PHY compensated
+	 * @return void
+	 */
+	void processMessage( EtherPort *port, PTPMessageCommon *msg );
+};
+
+#endif/*GPTP_DOMAIN_HPP*/
@@ -0,0 +1,105 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifndef GPTP_HAL_HPP
+#define GPTP_HAL_HPP
+
+/**@file*/
+
+/*
+ * The common code reaches the OS through abstract classes created by
+ * factories. On the message path (receive, timestamp, process, timers) it
+ * calls them through the Hal* types below instead. Normally these are the
+ * abstract classes themselves and the calls stay virtual.
+ *
+ * A platform built with GPTP_STATIC_HAL provides gptp_hal_static.hpp, which
+ * defines each Hal* type as its final implementation class. The casts below
+ * then turn the message path calls into direct ones that the compiler can
+ * inline, across files when building with -flto. Such a build must only
+ * ever create those implementations.
+ *
+ * Include this from source files only: the platform headers it pulls in
+ * include the common headers in turn.
+ */
+
+#ifdef GPTP_STATIC_HAL
+
+#include <gptp_hal_static.hpp>
+
+#else
+
+#include <avbts_osnet.hpp>
+#include <avbts_oslock.hpp>
+#include <avbts_ostimerq.hpp>
+#include <ether_tstamper.hpp>
+
+typedef OSNetworkInterface HalNetworkInterface;	/*!< Network interface of the message path */
+typedef OSLock HalLock;							/*!< Lock of the message path */
+typedef OSTimerQueue HalTimerQueue;				/*!< Timer queue of the message path */
+typedef EtherTimestamper HalEtherTimestamper;	/*!< Timestamper of the message path */
+
+#endif
+
+/**
+ * @brief  Network interface as seen by the message path
+ */
+inline HalNetworkInterface *halNetworkInterface( OSNetworkInterface *iface )
+{
+	return static_cast<HalNetworkInterface *>( iface );
+}
+
+/**
+ * @brief  Lock as seen by the message path
+ */
+inline HalLock *halLock( OSLock *lock )
+{
+	return static_cast<HalLock *>( lock );
+}
+
+/**
+ * @brief  Timer queue as seen by the message path
+ */
+inline HalTimerQueue *halTimerQueue( OSTimerQueue *timerq )
+{
+	return static_cast<HalTimerQueue *>( timerq );
+}
+
+/**
+ * @brief  Ethernet timestamper as seen by the message path
+ */
+inline HalEtherTimestamper *halEtherTimestamper( EtherTimestamper *timestamper )
+{
+	return static_cast<HalEtherTimestamper *>( timestamper );
+}
+
+#endif/*GPTP_HAL_HPP*/
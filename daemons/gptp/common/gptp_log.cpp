@@ -33,10 +33,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // MS VC++ 2013 has C++11 but not C11 support, use this to get millisecond resolution
 #include <chrono>
 
+/* thread_local arrived with MS VC++ 2015 */
+#if !defined(_MSC_VER) || _MSC_VER >= 1900
+#define GPTP_LOG_ASYNC_SUPPORTED
+#include <atomic>
+#include <mutex>
+#include <thread>
+#endif
+
 #ifdef GENIVI_DLT
 DLT_DECLARE_CONTEXT(dlt_con_gptp);
 #endif
 
+#define GPTP_LOG_MSG_SIZE 1024
+
 void gptplogRegister(void)
 {
 #ifdef GENIVI_DLT
@@ -47,26 +57,22 @@ void gptplogRegister(void)
 
 void gptplogUnregister(void)
 {
+	gptplogAsync(false);
 #ifdef GENIVI_DLT
 	DLT_UNREGISTER_CONTEXT(dlt_con_gptp);
 	DLT_UNREGISTER_APP();
 #endif
 }
 
-void gptpLog(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line, const char *fmt, ...)
+/* Writes one formatted message; 'when' is the time it was logged */
+static void x_emit(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line,
+		   std::chrono::system_clock::time_point when, const char *msg)
 {
-	char msg[1024];
-
-	va_list args;
-	va_start(args, fmt);
-	vsprintf(msg, fmt, args);
-
 #ifndef GENIVI_DLT
-	std::chrono::system_clock::time_point cNow = std::chrono::system_clock::now();
-	time_t tNow = std::chrono::system_clock::to_time_t(cNow);
+	time_t tNow = std::chrono::system_clock::to_time_t(when);
 	struct tm tmNow;
 	PLAT_localtime(&tNow, &tmNow);
-	std::chrono::system_clock::duration roundNow = cNow - std::chrono::system_clock::from_time_t(tNow);
+	std::chrono::system_clock::duration roundNow = when - std::chrono::system_clock::from_time_t(tNow);
 	long int millis = (long int) std::chrono::duration_cast<std::chrono::milliseconds>(roundNow).count();
 
 	if (path) {
@@ -108,6 +114,246 @@ void gptpLog(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line,
 
 	DLT_LOG(dlt_con_gptp, dlt_level, DLT_STRING(msg));
 #endif
+}
+
+static void x_formatBinary(char *msg, size_t size, const char *fmt, unsigned nargs, const int64_t *args)
+{
+	int64_t a[GPTP_LOG_BIN_MAX_ARGS] = { 0 };
+	unsigned i;
+
+	for (i = 0; i < nargs && i < GPTP_LOG_BIN_MAX_ARGS; i++)
+		a[i] = args[i];
+	snprintf(msg, size, fmt, (long long) a[0], (long long) a[1], (long long) a[2], (long long) a[3]);
+}
+
+#ifdef GPTP_LOG_ASYNC_SUPPORTED
+
+/*
+ * Asynchronous backend. Every logging thread owns a single producer ring;
+ * logging reserves the next slot, fills it and publishes it with a release
+ * store of head, so callers never block, lock or do I/O. The writer thread
+ * polls all rings, formats the records and outputs them. When a ring is
+ * full the record is dropped and counted.
+ */
+#define GPTP_LOG_RING_SIZE 256		/* entries per thread, power of 2 */
+#define GPTP_LOG_RING_MSG_SIZE 256	/* longer text messages are truncated */
+#define GPTP_LOG_WRITER_PERIOD_MS 5
+
+struct GptpLogEntry {
+	GPTP_LOG_LEVEL level;
+	const char *tag;
+	const char *path;
+	int line;
+	std::chrono::system_clock::time_point when;
+	const char *fmt;	/* binary record when non-NULL */
+	unsigned nargs;
+	int64_t args[GPTP_LOG_BIN_MAX_ARGS];
+	char msg[GPTP_LOG_RING_MSG_SIZE];
+};
+
+struct GptpLogRing {
+	std::atomic<uint32_t> head;		/* written by the owning thread */
+	std::atomic<uint32_t> tail;		/* written by the writer thread */
+	std::atomic<uint32_t> dropped;
+	std::atomic<bool> orphaned;		/* owning thread has exited */
+	GptpLogRing *next;
+	GptpLogEntry entries[GPTP_LOG_RING_SIZE];
+
+	GptpLogRing() : head(0), tail(0), dropped(0), orphaned(false), next(NULL) { }
+};
+
+/* Marks the thread's ring for release by the writer when the thread exits */
+struct GptpLogRingHolder {
+	GptpLogRing *ring;
+	~GptpLogRingHolder() {
+		if (ring)
+			ring->orphaned.store(true, std::memory_order_release);
+	}
+};
+
+static thread_local GptpLogRingHolder tRing;
+static std::mutex ringListLock;
+static GptpLogRing *ringList = NULL;
+static std::atomic<bool> asyncOn(false);
+static std::atomic<bool> writerStop(false);
+static std::thread writerThread;
+
+static GptpLogEntry *x_reserve(GptpLogRing **pring)
+{
+	GptpLogRing *ring = tRing.ring;
+	uint32_t head;
+
+	if (!ring) {
+		/* first record from this thread */
+		ring = new GptpLogRing();
+		std::lock_guard<std::mutex> guard(ringListLock);
+		ring->next = ringList;
+		ringList = ring;
+		tRing.ring = ring;
+	}
+
+	head = ring->head.load(std::memory_order_relaxed);
+	if (head - ring->tail.load(std::memory_order_acquire) >= GPTP_LOG_RING_SIZE) {
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	*pring = ring;
+	return &ring->entries[head & (GPTP_LOG_RING_SIZE - 1)];
+}
+
+static void x_commit(GptpLogRing *ring)
+{
+	ring->head.store(ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/* Outputs everything queued in a ring; returns true if it is now empty */
+static bool x_drain(GptpLogRing *ring)
+{
+	uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+	uint32_t head = ring->head.load(std::memory_order_acquire);
+	uint32_t dropped;
+	char msg[GPTP_LOG_MSG_SIZE];
+
+	while (tail != head) {
+		GptpLogEntry *e = &ring->entries[tail & (GPTP_LOG_RING_SIZE - 1)];
+
+		if (e->fmt) {
+			x_formatBinary(msg, sizeof(msg), e->fmt, e->nargs, e->args);
+			x_emit(e->level, e->tag, e->path, e->line, e->when, msg);
+		}
+		else {
+			x_emit(e->level, e->tag, e->path, e->line, e->when, e->msg);
+		}
+		++tail;
+		ring->tail.store(tail, std::memory_order_release);
+	}
+
+	dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped) {
+		snprintf(msg, sizeof(msg), "%u log messages dropped", dropped);
+		x_emit(GPTP_LOG_LVL_WARNING, "WARNING  ", NULL, 0, std::chrono::system_clock::now(), msg);
+	}
+
+	return ring->head.load(std::memory_order_acquire) == tail;
+}
+
+static void x_drainAll(void)
+{
+	std::lock_guard<std::mutex> guard(ringListLock);
+	GptpLogRing **link = &ringList;
+
+	while (*link) {
+		GptpLogRing *ring = *link;
+		bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+
+		if (x_drain(ring) && orphaned) {
+			*link = ring->next;
+			delete ring;
+			continue;
+		}
+		link = &ring->next;
+	}
+}
+
+static void x_writer(void)
+{
+	while (!writerStop.load(std::memory_order_acquire)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(GPTP_LOG_WRITER_PERIOD_MS));
+		x_drainAll();
+	}
+	x_drainAll();
+}
+
+bool gptplogAsync(bool enable)
+{
+	if (enable == asyncOn.load())
+		return true;
+
+	if (enable) {
+		writerStop.store(false);
+		writerThread = std::thread(x_writer);
+		asyncOn.store(true, std::memory_order_release);
+	}
+	else {
+		/* later records go out synchronously, then flush the rings */
+		asyncOn.store(false, std::memory_order_release);
+		writerStop.store(true, std::memory_order_release);
+		writerThread.join();
+	}
+	return true;
+}
+
+#else
+
+bool gptplogAsync(bool enable)
+{
+	return !enable;
+}
+
+#endif
+
+void gptpLog(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line, const char *fmt, ...)
+{
+	std::chrono::system_clock::time_point cNow = std::chrono::system_clock::now();
+	va_list args;
 
+	va_start(args, fmt);
+
+#ifdef GPTP_LOG_ASYNC_SUPPORTED
+	if (asyncOn.load(std::memory_order_acquire)) {
+		GptpLogRing *ring;
+		GptpLogEntry *e = x_reserve(&ring);
+
+		if (e) {
+			e->level = level;
+			e->tag = tag;
+			e->path = path;
+			e->line = line;
+			e->when = cNow;
+			e->fmt = NULL;
+			vsnprintf(e->msg, sizeof(e->msg), fmt, args);
+			x_commit(ring);
+		}
+		va_end(args);
+		return;
+	}
+#endif
+
+	char msg[GPTP_LOG_MSG_SIZE];
+	vsnprintf(msg, sizeof(msg), fmt, args);
+	va_end(args);
+
+	x_emit(level, tag, path, line, cNow, msg);
 }
 
+void gptpLogBinary(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line, const char *fmt, unsigned nargs, const int64_t *args)
+{
+	std::chrono::system_clock::time_point cNow = std::chrono::system_clock::now();
+
+#ifdef GPTP_LOG_ASYNC_SUPPORTED
+	if (asyncOn.load(std::memory_order_acquire)) {
+		GptpLogRing *ring;
+		GptpLogEntry *e = x_reserve(&ring);
+		unsigned i;
+
+		if (e) {
+			e->level = level;
+			e->tag = tag;
+			e->path = path;
+			e->line = line;
+			e->when = cNow;
+			e->fmt = fmt;
+			e->nargs = nargs;
+			for (i = 0; i < nargs && i < GPTP_LOG_BIN_MAX_ARGS; i++)
+				e->args[i] = args[i];
+			x_commit(ring);
+		}
+		return;
+	}
+#endif
+
+	char msg[GPTP_LOG_MSG_SIZE];
+	x_formatBinary(msg, sizeof(msg), fmt, nargs, args);
+	x_emit(level, tag, path, line, cNow, msg);
+}
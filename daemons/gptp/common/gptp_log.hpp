@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <time.h>
 
 #ifdef GENIVI_DLT
@@ -61,6 +62,32 @@ void gptplogRegister(void);
 void gptplogUnregister(void);
 void gptpLog(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line, const char *fmt, ...);
 
+#define GPTP_LOG_BIN_MAX_ARGS 4		/*!< Integer arguments kept by a binary log record */
+
+/**
+ * @brief  Logs a binary record: fmt must be a string literal whose
+ * conversions all take a 64 bit integer (%lld, %llu, %llx). Formatting is
+ * deferred to the writer thread when logging is asynchronous.
+ */
+void gptpLogBinary(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line, const char *fmt, unsigned nargs, const int64_t *args);
+
+/**
+ * @brief  Switches between synchronous logging and the asynchronous
+ * backend, where callers only copy the record into a per-thread lock free
+ * ring and a writer thread formats and outputs it
+ * @param  enable TRUE to start the writer thread, FALSE to drain and stop it
+ * @return FALSE if asynchronous logging is not available
+ */
+bool gptplogAsync(bool enable);
+
+template <typename... Args>
+inline void gptpLogBin(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line, const char *fmt, Args... args)
+{
+	static_assert(sizeof...(Args) <= GPTP_LOG_BIN_MAX_ARGS, "too many binary log arguments");
+	int64_t v[sizeof...(Args) + 1] = { ((int64_t) args)... };
+	gptpLogBinary(level, tag, path, line, fmt, sizeof...(Args), v);
+}
+
 
 #define GPTP_LOG_REGISTER() gptplogRegister()
 
@@ -104,14 +131,18 @@ void gptpLog(GPTP_LOG_LEVEL level, const char *tag, const char *path, int line,
 
 #ifdef GPTP_LOG_DEBUG_ON
 #define GPTP_LOG_DEBUG(fmt,...) gptpLog(GPTP_LOG_LVL_DEBUG, "DEBUG    ", __FILE__, __LINE__, fmt, ## __VA_ARGS__)
+#define GPTP_LOG_DEBUG_BIN(fmt,...) gptpLogBin(GPTP_LOG_LVL_DEBUG, "DEBUG    ", __FILE__, __LINE__, fmt, ## __VA_ARGS__)
 #else
 #define GPTP_LOG_DEBUG(fmt,...)
+#define GPTP_LOG_DEBUG_BIN(fmt,...)
 #endif
 
 #ifdef GPTP_LOG_VERBOSE_ON
 #define GPTP_LOG_VERBOSE(fmt,...) gptpLog(GPTP_LOG_LVL_VERBOSE, "VERBOSE  ", __FILE__, __LINE__, fmt, ## __VA_ARGS__)
+#define GPTP_LOG_VERBOSE_BIN(fmt,...) gptpLogBin(GPTP_LOG_LVL_VERBOSE, "VERBOSE  ", __FILE__, __LINE__, fmt, ## __VA_ARGS__)
 #else
 #define GPTP_LOG_VERBOSE(fmt,...)
+#define GPTP_LOG_VERBOSE_BIN(fmt,...)
 #endif
 
 #endif
@@ -0,0 +1,237 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+/**@file*/
+
+#include <gptp_servo.hpp>
+#include <gptp_log.hpp>
+
+#include <string.h>
+
+/* need Microsoft version for strcasecmp() from GCC strings.h */
+#ifdef _MSC_VER
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif
+
+/**
+ * @brief Proportional-integral loop tracking the two-sample ratio
+ */
+class PIServo : public RateServo {
+protected:
+	FrequencyRatio filter( FrequencyRatio raw ) {
+		FrequencyRatio error;
+
+		if( state.estimate == 0.0 )
+			return raw;
+
+		error = raw - state.estimate;
+		state.integral += config.pi_ki * error;
+		return state.estimate + config.pi_kp * error + state.integral;
+	}
+public:
+	PIServo( const ServoConfig &config ) : RateServo( config ) { }
+};
+
+/**
+ * @brief Least squares slope over the last window samples
+ */
+class LinRegServo : public RateServo {
+protected:
+	unsigned history() {
+		if( config.window < 2 )
+			return 2;
+		if( config.window > SERVO_MAX_WINDOW )
+			return SERVO_MAX_WINDOW;
+		return config.window;
+	}
+
+	FrequencyRatio filter( FrequencyRatio raw ) {
+		uint64_t master0, local0;
+		FrequencyRatio mean_x = 0.0, mean_y = 0.0;
+		FrequencyRatio sxx = 0.0, sxy = 0.0;
+		unsigned i;
+
+		/* Work relative to the oldest sample to keep precision */
+		at( 0, master0, local0 );
+		for( i = 0; i < state.count; ++i ) {
+			uint64_t master, local;
+
+			at( i, master, local );
+			mean_x += (FrequencyRatio) (int64_t) (local - local0);
+			mean_y += (FrequencyRatio) (int64_t) (master - master0);
+		}
+		mean_x /= state.count;
+		mean_y /= state.count;
+
+		for( i = 0; i < state.count; ++i ) {
+			uint64_t master, local;
+			FrequencyRatio dx, dy;
+
+			at( i, master, local );
+			dx = (FrequencyRatio) (int64_t) (local - local0) - mean_x;
+			dy = (FrequencyRatio) (int64_t) (master - master0) - mean_y;
+			sxx += dx * dx;
+			sxy += dx * dy;
+		}
+
+		return sxx != 0.0 ? sxy / sxx : raw;
+	}
+public:
+	LinRegServo( const ServoConfig &config ) : RateServo( config ) { }
+};
+
+/**
+ * @brief Scalar Kalman filter with a random walk rate model. The
+ * integral field of the state holds the estimate variance.
+ */
+class KalmanServo : public RateServo {
+protected:
+	FrequencyRatio filter( FrequencyRatio raw ) {
+		FrequencyRatio gain;
+
+		if( state.estimate == 0.0 ) {
+			state.integral = config.kalman_r;
+			return raw;
+		}
+
+		state.integral += config.kalman_q;
+		gain = state.integral / ( state.integral + config.kalman_r );
+		state.integral *= 1.0 - gain;
+		return state.estimate + gain * ( raw - state.estimate );
+	}
+public:
+	KalmanServo( const ServoConfig &config ) : RateServo( config ) { }
+};
+
+RateServo::RateServo( const ServoConfig &config )
+{
+	this->config = config;
+	clear();
+}
+
+RateServo *RateServo::create( const ServoConfig &config )
+{
+	switch( config.type ) {
+	case SERVO_LINREG:
+		return new LinRegServo( config );
+	case SERVO_KALMAN:
+		return new KalmanServo( config );
+	case SERVO_PI:
+	default:
+		return new PIServo( config );
+	}
+}
+
+bool RateServo::typeByName( const char *name, ServoType &type )
+{
+	if( strcasecmp( name, "pi" ) == 0 )
+		type = SERVO_PI;
+	else if( strcasecmp( name, "linreg" ) == 0 )
+		type = SERVO_LINREG;
+	else if( strcasecmp( name, "kalman" ) == 0 )
+		type = SERVO_KALMAN;
+	else
+		return false;
+
+	return true;
+}
+
+void RateServo::reset( void )
+{
+	state.count = 0;
+	state.head = 0;
+}
+
+void RateServo::clear( void )
+{
+	memset( &state, 0, sizeof( state ));
+	state.type = config.type;
+}
+
+void RateServo::push( uint64_t master_ns, uint64_t local_ns )
+{
+	unsigned n = history();
+
+	state.master[state.head] = master_ns;
+	state.local[state.head] = local_ns;
+	state.head = ( state.head + 1 ) % n;
+	if( state.count < n )
+		++state.count;
+}
+
+void RateServo::at( unsigned i, uint64_t &master_ns, uint64_t &local_ns )
+{
+	unsigned n = history();
+	unsigned slot = ( state.head + n - state.count + i ) % n;
+
+	master_ns = state.master[slot];
+	local_ns = state.local[slot];
+}
+
+FrequencyRatio RateServo::sample( uint64_t master_ns, uint64_t local_ns )
+{
+	uint64_t prev_master, prev_local;
+	FrequencyRatio raw;
+
+	push( master_ns, local_ns );
+	if( state.count < 2 )
+		return state.estimate != 0.0 ? state.estimate : 1.0;
+
+	at( state.count - 2, prev_master, prev_local );
+	if( local_ns != prev_local ) {
+		raw = ((FrequencyRatio) ( master_ns - prev_master )) /
+			( local_ns - prev_local );
+	} else {
+		raw = 1.0;
+	}
+
+	state.estimate = filter( raw );
+
+	GPTP_LOG_VERBOSE( "Rate servo raw ratio: %.12Lf, filtered: %.12Lf",
+			  (long double) raw, (long double) state.estimate );
+
+	return state.estimate;
+}
+
+void RateServo::setState( const ServoState &saved )
+{
+	if( saved.type != (uint32_t) config.type ||
+	    saved.count > history() || saved.head >= history() ) {
+		clear();
+		return;
+	}
+
+	state = saved;
+}
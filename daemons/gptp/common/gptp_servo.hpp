@@ -0,0 +1,179 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifndef GPTP_SERVO_HPP
+#define GPTP_SERVO_HPP
+
+/**@file*/
+
+#include <stdint.h>
+#include <ptptypes.hpp>
+
+#define SERVO_MAX_WINDOW 32	/*!< Maximum linear regression window */
+
+/**
+ * @brief Rate servo algorithms
+ */
+typedef enum {
+	SERVO_PI,		/*!< Proportional-integral tracking loop */
+	SERVO_LINREG,	/*!< Least squares fit over a sample window */
+	SERVO_KALMAN	/*!< Scalar Kalman filter on the rate ratio */
+} ServoType;
+
+/**
+ * @brief Rate servo configuration. The defaults make the PI servo pass
+ * the two-sample ratio through unfiltered.
+ */
+struct ServoConfig {
+	ServoType type;			/*!< Algorithm */
+	FrequencyRatio pi_kp;	/*!< PI proportional gain */
+	FrequencyRatio pi_ki;	/*!< PI integral gain */
+	unsigned window;		/*!< Linear regression window (samples) */
+	FrequencyRatio kalman_q;	/*!< Kalman process noise variance */
+	FrequencyRatio kalman_r;	/*!< Kalman measurement noise variance */
+
+	ServoConfig() :
+		type( SERVO_PI ), pi_kp( 1.0 ), pi_ki( 0.0 ), window( 8 ),
+		kalman_q( 1e-15 ), kalman_r( 1e-12 ) { }
+};
+
+/**
+ * @brief Servo state carried across restarts by the clock's
+ * serializeState(). Its size does not depend on the algorithm.
+ */
+struct ServoState {
+	uint32_t type;						/*!< ServoType that wrote it */
+	uint32_t count;						/*!< Valid samples */
+	uint32_t head;						/*!< Next sample slot */
+	uint64_t master[SERVO_MAX_WINDOW];	/*!< Master times (ns) */
+	uint64_t local[SERVO_MAX_WINDOW];	/*!< Local times (ns) */
+	FrequencyRatio estimate;			/*!< Filtered rate ratio */
+	FrequencyRatio integral;			/*!< PI integrator / Kalman variance */
+};
+
+/**
+ * @brief Estimates the master to local clock rate ratio from
+ * (master time, local time) pairs taken at sync arrival
+ */
+class RateServo {
+protected:
+	ServoConfig config;
+	ServoState state;
+
+	/**
+	 * @brief  Appends a sample to the sample history
+	 * @param  master_ns Master time
+	 * @param  local_ns Local time
+	 * @return void
+	 */
+	void push( uint64_t master_ns, uint64_t local_ns );
+
+	/**
+	 * @brief  Gets a sample, 0 being the oldest
+	 * @return void
+	 */
+	void at( unsigned i, uint64_t &master_ns, uint64_t &local_ns );
+
+	/**
+	 * @brief  Number of samples kept in the history
+	 */
+	virtual unsigned history() { return 2; }
+
+	/**
+	 * @brief  Filters a new sample
+	 * @param  raw Ratio of the two most recent samples
+	 * @return Filtered ratio
+	 */
+	virtual FrequencyRatio filter( FrequencyRatio raw ) = 0;
+public:
+	/**
+	 * @brief Creates a servo
+	 * @param config Servo configuration
+	 */
+	RateServo( const ServoConfig &config );
+	virtual ~RateServo() { }
+
+	/**
+	 * @brief  Creates a servo of the configured type
+	 * @param  config Servo configuration
+	 * @return New rate servo instance
+	 */
+	static RateServo *create( const ServoConfig &config );
+
+	/**
+	 * @brief  Gets a servo type by its configuration name
+	 * @param  name pi, linreg or kalman
+	 * @param  type [out] Servo type
+	 * @return FALSE if the name is unknown
+	 */
+	static bool typeByName( const char *name, ServoType &type );
+
+	/**
+	 * @brief  Discards the sample history, keeping the filtered estimate
+	 * so the servo resumes from it
+	 * @return void
+	 */
+	void reset( void );
+
+	/**
+	 * @brief  Discards the sample history and the filter state
+	 * @return void
+	 */
+	void clear( void );
+
+	/**
+	 * @brief  Adds a sample and returns the updated rate ratio.
+	 * The first sample after reset() returns the previous estimate,
+	 * or 1.0 if there is none.
+	 * @param  master_ns Master time at sync arrival
+	 * @param  local_ns Local time at sync arrival
+	 * @return Master to local rate ratio
+	 */
+	FrequencyRatio sample( uint64_t master_ns, uint64_t local_ns );
+
+	/**
+	 * @brief  Gets the servo state for serialization
+	 * @return Servo state
+	 */
+	const ServoState &getState( void ) { return state; }
+
+	/**
+	 * @brief  Restores the servo state. State saved by a different
+	 * algorithm is discarded.
+	 * @param  saved [in] Saved servo state
+	 * @return void
+	 */
+	void setState( const ServoState &saved );
+};
+
+#endif/*GPTP_SERVO_HPP*/
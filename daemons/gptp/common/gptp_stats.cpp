@@ -0,0 +1,214 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+/**@file*/
+
+#include <gptp_stats.hpp>
+
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* A sync interval this far from nominal is a gap, not jitter */
+#define SYNC_JITTER_MAX_INTERVALS 4
+
+static inline uint64_t x_load( const uint64_t *p )
+{
+#ifdef _MSC_VER
+	return (uint64_t) _InterlockedOr64( (volatile __int64 *) p, 0 );
+#else
+	return __atomic_load_n( p, __ATOMIC_RELAXED );
+#endif
+}
+
+static inline void x_store( uint64_t *p, uint64_t v )
+{
+#ifdef _MSC_VER
+	_InterlockedExchange64( (volatile __int64 *) p, (__int64) v );
+#else
+	__atomic_store_n( p, v, __ATOMIC_RELAXED );
+#endif
+}
+
+static inline void x_add( uint64_t *p, uint64_t v )
+{
+#ifdef _MSC_VER
+	_InterlockedExchangeAdd64( (volatile __int64 *) p, (__int64) v );
+#else
+	__atomic_fetch_add( p, v, __ATOMIC_RELAXED );
+#endif
+}
+
+static inline void x_max( uint64_t *p, uint64_t v )
+{
+	uint64_t cur = x_load( p );
+
+	while( v > cur ) {
+#ifdef _MSC_VER
+		uint64_t seen = (uint64_t) _InterlockedCompareExchange64
+			( (volatile __int64 *) p, (__int64) v, (__int64) cur );
+		if( seen == cur )
+			break;
+		cur = seen;
+#else
+		if( __atomic_compare_exchange_n
+		    ( p, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ))
+			break;
+#endif
+	}
+}
+
+static unsigned x_bucket( uint64_t value )
+{
+	unsigned bucket = 0;
+
+	while( value > 1 && bucket < GPTP_STATS_HIST_BUCKETS - 1 ) {
+		value >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+PortStatistics::PortStatistics()
+{
+	memset( &local, 0, sizeof( local ));
+	stats = &local;
+	prev_bmca_changes = 0;
+	prev_sync_valid = false;
+	prev_sync_ns = 0;
+	prev_offset_valid = false;
+	prev_offset = 0;
+	prev_offset_local_ns = 0;
+	prev_offset_rate = 1.0;
+}
+
+void PortStatistics::attach( gPtpPortStats *shared )
+{
+	if( shared == NULL || shared == stats )
+		return;
+
+	memcpy( shared, stats, sizeof( *shared ));
+	stats = shared;
+}
+
+void PortStatistics::record( gPtpStatsHist *hist, uint64_t value )
+{
+	x_add( &hist->count, 1 );
+	x_add( &hist->sum, value );
+	x_max( &hist->max, value );
+	x_store( &hist->last, value );
+	x_add( &hist->buckets[x_bucket( value )], 1 );
+}
+
+void PortStatistics::inc( uint64_t *counter )
+{
+	x_add( counter, 1 );
+}
+
+void PortStatistics::checkBmcaChange()
+{
+	uint64_t changes = x_load( &stats->bmca_changes );
+
+	if( changes != prev_bmca_changes ) {
+		prev_bmca_changes = changes;
+		prev_sync_valid = false;
+		prev_offset_valid = false;
+	}
+}
+
+void PortStatistics::pdelayTurnaround( int64_t turnaround_ns )
+{
+	record( &stats->pdelay_turnaround,
+		turnaround_ns > 0 ? (uint64_t) turnaround_ns : 0 );
+}
+
+void PortStatistics::syncReceived( uint64_t rx_ns, int8_t log_interval )
+{
+	int64_t nominal;
+	int64_t jitter;
+
+	checkBmcaChange();
+	if( log_interval < -16 || log_interval > 16 ) {
+		prev_sync_valid = false;
+		return;
+	}
+	nominal = log_interval >= 0 ?
+		1000000000LL << log_interval : 1000000000LL >> -log_interval;
+
+	if( prev_sync_valid && rx_ns > prev_sync_ns &&
+	    rx_ns - prev_sync_ns < (uint64_t) nominal * SYNC_JITTER_MAX_INTERVALS )
+	{
+		jitter = (int64_t) (rx_ns - prev_sync_ns) - nominal;
+		record( &stats->sync_jitter, jitter < 0 ? -jitter : jitter );
+	}
+	prev_sync_ns = rx_ns;
+	prev_sync_valid = true;
+}
+
+void PortStatistics::txTimestamp( uint64_t latency_ns, bool success )
+{
+	record( &stats->tx_ts_latency, latency_ns );
+	if( !success )
+		inc( &stats->tx_ts_failures );
+}
+
+void PortStatistics::servoOffset
+( int64_t offset_ns, uint64_t local_ns, FrequencyRatio rate )
+{
+	checkBmcaChange();
+	if( prev_offset_valid && local_ns > prev_offset_local_ns ) {
+		/* master time advances by rate per local ns */
+		int64_t predicted = prev_offset + (int64_t)
+			((local_ns - prev_offset_local_ns) * (1.0 - prev_offset_rate));
+		int64_t error = offset_ns - predicted;
+
+		record( &stats->servo_offset, error < 0 ? -error : error );
+		x_store( (uint64_t *) &stats->servo_offset_last, (uint64_t) error );
+	}
+	prev_offset = offset_ns;
+	prev_offset_local_ns = local_ns;
+	prev_offset_rate = rate;
+	prev_offset_valid = true;
+}
+
+void PortStatistics::missedFollowUp()
+{
+	inc( &stats->missed_follow_ups );
+}
+
+void PortStatistics::bmcaChange()
+{
+	inc( &stats->bmca_changes );
+}
@@ -0,0 +1,174 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifndef GPTP_STATS_HPP
+#define GPTP_STATS_HPP
+
+/**@file*/
+
+#include <stdint.h>
+#include <ptptypes.hpp>
+
+/*
+ * Per-port performance statistics. gPtpPortStats is a plain C layout so
+ * external tools can read it from the shared memory stats region (see
+ * linux_ipc.hpp). New fields are only ever appended; readers use the
+ * region's port_size as the stride between ports.
+ *
+ * Every field is updated with a relaxed atomic operation and may be read
+ * at any time without locking. A reader sees each field consistently
+ * but not a snapshot across fields; counters only ever increase, so
+ * tools should compute deltas between two reads.
+ */
+#define GPTP_STATS_HIST_BUCKETS 32	/*!< log2 histogram buckets, the last one is open ended */
+
+/**
+ * @brief Distribution of a nanosecond quantity. Bucket 0 counts values
+ * below 2 ns, bucket i (i > 0) counts values in [2^i, 2^(i+1)) ns.
+ */
+typedef struct {
+	uint64_t count;			//!< Number of samples
+	uint64_t sum;			//!< Sum of the samples (ns)
+	uint64_t max;			//!< Largest sample (ns)
+	uint64_t last;			//!< Most recent sample (ns)
+	uint64_t buckets[GPTP_STATS_HIST_BUCKETS];	//!< log2 histogram
+} gPtpStatsHist;
+
+/**
+ * @brief Statistics for one port
+ */
+typedef struct {
+	gPtpStatsHist pdelay_turnaround;	//!< Local PDelay request receipt to response transmit
+	gPtpStatsHist sync_jitter;			//!< |Sync receipt interval - nominal sync interval|
+	gPtpStatsHist tx_ts_latency;		//!< Time taken to retrieve a TX timestamp
+	gPtpStatsHist servo_offset;			//!< |Master offset - offset predicted by the rate servo|
+	int64_t servo_offset_last;			//!< Last signed servo offset (ns)
+	uint64_t missed_follow_ups;			//!< Sync messages never matched by a Follow-Up
+	uint64_t tx_ts_failures;			//!< TX timestamps that could not be retrieved
+	uint64_t bmca_changes;				//!< Port state or grandmaster changes
+} gPtpPortStats;
+
+/**
+ * @brief Updates a port's gPtpPortStats. Until attach() is called the
+ * statistics are kept in a private copy.
+ */
+class PortStatistics {
+private:
+	gPtpPortStats local;
+	gPtpPortStats *stats;
+
+	/*
+	 * Sync jitter and servo offset state, only used by the receive path.
+	 * It is restarted whenever bmca_changes differs from prev_bmca_changes.
+	 */
+	uint64_t prev_bmca_changes;
+	bool prev_sync_valid;
+	uint64_t prev_sync_ns;
+	bool prev_offset_valid;
+	int64_t prev_offset;
+	uint64_t prev_offset_local_ns;
+	FrequencyRatio prev_offset_rate;
+
+	static void record( gPtpStatsHist *hist, uint64_t value );
+	static void inc( uint64_t *counter );
+	void checkBmcaChange();
+public:
+	PortStatistics();
+
+	/**
+	 * @brief  Moves the statistics to externally visible storage. The
+	 * counts gathered so far are copied. Call before the port runs.
+	 * @param  shared Storage to use, NULL keeps the private copy
+	 * @return void
+	 */
+	void attach( gPtpPortStats *shared );
+
+	/**
+	 * @brief  Gets the statistics
+	 * @return Current statistics storage
+	 */
+	const gPtpPortStats *get() const
+	{
+		return stats;
+	}
+
+	/**
+	 * @brief  Records the time our PDelay response left after its request
+	 * arrived
+	 * @param  turnaround_ns Response TX timestamp - request RX timestamp
+	 * @return void
+	 */
+	void pdelayTurnaround( int64_t turnaround_ns );
+
+	/**
+	 * @brief  Records the receipt of a sync message
+	 * @param  rx_ns Sync receive timestamp
+	 * @param  log_interval Log base 2 sync interval advertised in the message
+	 * @return void
+	 */
+	void syncReceived( uint64_t rx_ns, int8_t log_interval );
+
+	/**
+	 * @brief  Records a TX timestamp retrieval
+	 * @param  latency_ns Time from the first retrieval attempt until it
+	 * finished
+	 * @param  success FALSE if no timestamp was obtained
+	 * @return void
+	 */
+	void txTimestamp( uint64_t latency_ns, bool success );
+
+	/**
+	 * @brief  Records the master to local offset computed from a sync and
+	 * compares it with the offset predicted from the previous sample
+	 * @param  offset_ns Local - master time (ns)
+	 * @param  local_ns Local time of the sync receipt
+	 * @param  rate Master to local rate ratio
+	 * @return void
+	 */
+	void servoOffset( int64_t offset_ns, uint64_t local_ns, FrequencyRatio rate );
+
+	/**
+	 * @brief  Counts a sync message discarded without its Follow-Up
+	 * @return void
+	 */
+	void missedFollowUp();
+
+	/**
+	 * @brief  Counts a BMCA result that changed the port state or master.
+	 * The receive path then restarts its interval and offset tracking.
+	 * @return void
+	 */
+	void bmcaChange();
+};
+
+#endif/*GPTP_STATS_HPP*/
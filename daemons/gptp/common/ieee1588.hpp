@@ -99,6 +99,7 @@ typedef enum {
 	PDELAY_RESP_RECEIPT_TIMEOUT_EXPIRES,	//!< Pdelay response message timeout
 	PDELAY_RESP_PEER_MISBEHAVING_TIMEOUT_EXPIRES,	//!< Timeout for peer misbehaving. This even will re-enable the PDelay Requests
 	SYNC_RATE_INTERVAL_TIMEOUT_EXPIRED,  //!< Sync rate signal timeout for the Automotive Profile
+	LINK_FLAP_WINDOW_EXPIRES,			//!< Link stayed down for longer than the link flap window
 } Event;
 
 /**
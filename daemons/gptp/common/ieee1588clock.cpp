@@ -36,6 +36,7 @@
 #include <avbts_clock.hpp>
 #include <avbts_oslock.hpp>
 #include <avbts_ostimerq.hpp>
+#include <gptp_hal.hpp>
 
 #include <stdio.h>
 
@@ -47,6 +48,10 @@
 
 #include <math.h>
 
+/* Leads the serialized clock state. Files written before it hold only
+ * the two frequency offsets and LastEBestIdentity. */
+#define CLOCK_STATE_TAG 0x47505331	/* "GPS1" */
+
 std::string ClockIdentity::getIdentityString()
 {
 	uint8_t cid[PTP_CLOCK_IDENTITY_LENGTH];
@@ -104,8 +109,12 @@ IEEE1588Clock::IEEE1588Clock
 
 	_phase_error_violation = 0;
 
+	_fast_lock = false;
+	_fast_lock_pending = false;
+
 	_master_local_freq_offset_init = false;
 	_local_system_freq_offset_init = false;
+	rate_servo = RateServo::create( ServoConfig() );
 
 	this->ipc = ipc;
 
@@ -113,6 +122,10 @@ IEEE1588Clock::IEEE1588Clock
 
 	timerq_lock = lock_factory->createLock( oslock_recursive );
 
+	relay_info.valid = false;
+	relay_info.port = NULL;
+	relay_lock = lock_factory->createLock( oslock_nonrecursive );
+
 	// This should be done LAST!! to pass fully initialized clock object
 	timerq = timerq_factory->createOSTimerQueue( this );
 
@@ -124,12 +137,23 @@ IEEE1588Clock::IEEE1588Clock
 
 bool IEEE1588Clock::serializeState( void *buf, off_t *count ) {
   bool ret = true;
+  uint32_t tag = CLOCK_STATE_TAG;
 
   if( buf == NULL ) {
-    *count = sizeof( _master_local_freq_offset ) + sizeof( _local_system_freq_offset ) + sizeof( LastEBestIdentity );
+    *count = sizeof( tag ) + sizeof( _master_local_freq_offset ) + sizeof( _local_system_freq_offset ) + sizeof( LastEBestIdentity ) + sizeof( ServoState ) + sizeof( _ppm );
     return true;
   }
 
+  // Format tag
+  if( ret && *count >= (off_t) sizeof( tag )) {
+    memcpy( buf, &tag, sizeof( tag ));
+    *count -= sizeof( tag );
+    buf = ((char *)buf) + sizeof( tag );
+  } else {
+    *count = sizeof( tag )-*count;
+    ret = false;
+  }
+
   // Master-Local Frequency Offset
   if( ret && *count >= (off_t) sizeof( _master_local_freq_offset )) {
 	  memcpy
@@ -170,11 +194,57 @@ bool IEEE1588Clock::serializeState( void *buf, off_t *count ) {
     ret = false;
   }
 
+  // Rate servo
+  if( ret && *count >= (off_t) sizeof( ServoState )) {
+    memcpy( buf, &rate_servo->getState(), sizeof( ServoState ));
+    *count -= sizeof( ServoState );
+    buf = ((char *)buf) + sizeof( ServoState );
+  } else if( ret == false ) {
+    *count += sizeof( ServoState );
+  } else {
+    *count = sizeof( ServoState )-*count;
+    ret = false;
+  }
+
+  // Rate adjustment (PI integrator)
+  if( ret && *count >= (off_t) sizeof( _ppm )) {
+    memcpy( buf, &_ppm, sizeof( _ppm ));
+    *count -= sizeof( _ppm );
+    buf = ((char *)buf) + sizeof( _ppm );
+  } else if( ret == false ) {
+    *count += sizeof( _ppm );
+  } else {
+    *count = sizeof( _ppm )-*count;
+    ret = false;
+  }
+
   return ret;
 }
 
 bool IEEE1588Clock::restoreSerializedState( void *buf, off_t *count ) {
 	bool ret = true;
+	FrequencyRatio upper_ratio_limit, lower_ratio_limit;
+
+	/* Keep the current state to roll back to if validation fails */
+	FrequencyRatio prev_master_local_freq_offset = _master_local_freq_offset;
+	FrequencyRatio prev_local_system_freq_offset = _local_system_freq_offset;
+	ClockIdentity prev_LastEBestIdentity = LastEBestIdentity;
+	ServoState prev_servo_state = rate_servo->getState();
+	float prev_ppm = _ppm;
+	uint32_t tag = 0;
+	bool legacy = false;
+
+	/* Format tag, missing from files that predate the servo state */
+	if( *count >= (off_t) sizeof( tag )) {
+		memcpy( &tag, buf, sizeof( tag ));
+	}
+	if( tag == CLOCK_STATE_TAG ) {
+		*count -= sizeof( tag );
+		buf = ((char *)buf) + sizeof( tag );
+	} else {
+		legacy = true;
+		GPTP_LOG_INFO( "Restoring clock state saved without rate servo state" );
+	}
 
 	/* Master-Local Frequency Offset */
 	if( ret && *count >= (off_t) sizeof( _master_local_freq_offset )) {
@@ -216,6 +286,70 @@ bool IEEE1588Clock::restoreSerializedState( void *buf, off_t *count ) {
 	  ret = false;
   }
 
+	/* Rate servo */
+  if( legacy ) {
+	  /* Left at its defaults */
+  } else if( ret && *count >= (off_t) sizeof( ServoState )) {
+	  ServoState servo_state;
+
+	  memcpy( &servo_state, buf, sizeof( ServoState ));
+	  rate_servo->setState( servo_state );
+	  *count -= sizeof( ServoState );
+	  buf = ((char *)buf) + sizeof( ServoState );
+  } else if( ret == false ) {
+	  *count += sizeof( ServoState );
+  } else {
+	  *count = sizeof( ServoState )-*count;
+	  ret = false;
+  }
+
+	/* Rate adjustment (PI integrator) */
+  if( legacy ) {
+	  /* Left at its default */
+  } else if( ret && *count >= (off_t) sizeof( _ppm )) {
+	  memcpy( &_ppm, buf, sizeof( _ppm ));
+	  *count -= sizeof( _ppm );
+	  buf = ((char *)buf) + sizeof( _ppm );
+  } else if( ret == false ) {
+	  *count += sizeof( _ppm );
+  } else {
+	  *count = sizeof( _ppm )-*count;
+	  ret = false;
+  }
+
+	/* Validate, a corrupt or stale file must not steer the clock */
+	upper_ratio_limit = PPM_OFFSET_TO_RATIO(UPPER_LIMIT_PPM);
+	lower_ratio_limit = PPM_OFFSET_TO_RATIO(LOWER_LIMIT_PPM);
+	if( ret &&
+	    ( !( _master_local_freq_offset > lower_ratio_limit &&
+		 _master_local_freq_offset < upper_ratio_limit ) ||
+	      !( _local_system_freq_offset > lower_ratio_limit &&
+		 _local_system_freq_offset < upper_ratio_limit ) ||
+	      !( _ppm >= LOWER_FREQ_LIMIT && _ppm <= UPPER_FREQ_LIMIT ) ||
+	      ( rate_servo->getState().estimate != 0.0 &&
+		!( rate_servo->getState().estimate > lower_ratio_limit &&
+		   rate_servo->getState().estimate < upper_ratio_limit ))))
+	{
+		GPTP_LOG_ERROR( "Restored clock state out of range, ignoring it" );
+		ret = false;
+	}
+
+	if( !ret ) {
+		_master_local_freq_offset = prev_master_local_freq_offset;
+		_local_system_freq_offset = prev_local_system_freq_offset;
+		LastEBestIdentity = prev_LastEBestIdentity;
+		rate_servo->setState( prev_servo_state );
+		_ppm = prev_ppm;
+	} else if( !_fast_lock || legacy ) {
+		/* Syntonization restarts from scratch */
+		rate_servo->clear();
+		_ppm = 0;
+	} else {
+		_fast_lock_pending = true;
+		GPTP_LOG_STATUS( "Fast lock from restored state, rate: %f ppm",
+				 _ppm );
+	}
+
   return ret;
 }
 
@@ -231,13 +365,23 @@ void timerq_handler(void *arg)
 	event_descriptor->port->processEvent(event_descriptor->event);
 }
 
+OSLockResult IEEE1588Clock::getTimerQLock()
+{
+	return halLock( timerq_lock )->lock();
+}
+
+OSLockResult IEEE1588Clock::putTimerQLock()
+{
+	return halLock( timerq_lock )->unlock();
+}
+
 void IEEE1588Clock::addEventTimer
 ( CommonPort *target, Event e, unsigned long long time_ns )
 {
 	event_descriptor_t *event_descriptor = new event_descriptor_t();
 	event_descriptor->event = e;
 	event_descriptor->port = target;
-	timerq->addEvent
+	halTimerQueue( timerq )->addEvent
 		((unsigned)(time_ns / 1000), (int)e, timerq_handler, event_descriptor,
 		 true, NULL);
 }
@@ -255,7 +399,7 @@ void IEEE1588Clock::addEventTimerLocked
 void IEEE1588Clock::deleteEventTimer
 ( CommonPort *target, Event event )
 {
-	timerq->cancelEvent((int)event, NULL);
+	halTimerQueue( timerq )->cancelEvent((int)event, target, NULL);
 }
 
 void IEEE1588Clock::deleteEventTimerLocked
@@ -263,7 +407,7 @@ void IEEE1588Clock::deleteEventTimerLocked
 {
     if( getTimerQLock() == oslock_fail ) return;
 
-	timerq->cancelEvent((int)event, NULL);
+	halTimerQueue( timerq )->cancelEvent((int)event, target, NULL);
 
     if( putTimerQLock() == oslock_fail ) return;
 }
@@ -304,49 +448,73 @@ FrequencyRatio IEEE1588Clock::calcLocalSystemClockRateDifference( Timestamp loca
 
 
 FrequencyRatio IEEE1588Clock::calcMasterLocalClockRateDifference( Timestamp master_time, Timestamp sync_time ) {
-	unsigned long long inter_sync_time;
-	unsigned long long inter_master_time;
 	FrequencyRatio ppt_offset;
 
 	GPTP_LOG_DEBUG( "Calculated master to local clock rate difference" );
 
 	if( !_master_local_freq_offset_init ) {
-		_prev_sync_time = sync_time;
 		_prev_master_time = master_time;
+		rate_servo->reset();
+		ppt_offset = rate_servo->sample
+			( TIMESTAMP_TO_NS(master_time), TIMESTAMP_TO_NS(sync_time) );
 
 		_master_local_freq_offset_init = true;
 
-		return 1.0;
+		return ppt_offset;
 	}
 
-	inter_sync_time =
-		TIMESTAMP_TO_NS(sync_time) - TIMESTAMP_TO_NS(_prev_sync_time);
-
 	uint64_t master_time_ns = TIMESTAMP_TO_NS(master_time);
 	uint64_t prev_master_time_ns = TIMESTAMP_TO_NS(_prev_master_time);
 
-	inter_master_time = master_time_ns - prev_master_time_ns;
-
-	if( inter_sync_time != 0 ) {
-		ppt_offset = ((FrequencyRatio)inter_master_time)/inter_sync_time;
-	} else {
-		ppt_offset = 1.0;
-	}
-
 	if( master_time_ns < prev_master_time_ns ) {
-		GPTP_LOG_ERROR("Negative time jump detected - inter_master_time: %lld, inter_sync_time: %lld, incorrect ppt_offset: %Lf",
-					   inter_master_time, inter_sync_time, ppt_offset);
+		GPTP_LOG_ERROR("Negative time jump detected - master time: %llu, previous master time: %llu",
+					   master_time_ns, prev_master_time_ns);
 		_master_local_freq_offset_init = false;
+		rate_servo->clear();
 
 		return NEGATIVE_TIME_JUMP;
 	}
 
-	_prev_sync_time = sync_time;
+	ppt_offset = rate_servo->sample
+		( master_time_ns, TIMESTAMP_TO_NS(sync_time) );
+
 	_prev_master_time = master_time;
 
 	return ppt_offset;
 }
 
+void IEEE1588Clock::fastLockStart( CommonPort *port )
+{
+	/* The restored rate was learned on the first port's clock */
+	if( !_fast_lock_pending || !_syntonize || port != port_list[0] )
+		return;
+
+	if( !port->adjustClockRate( _ppm ) ) {
+		GPTP_LOG_ERROR( "Failed to apply restored clock rate" );
+		fastLockRollback();
+	}
+}
+
+void IEEE1588Clock::fastLockRollback( void )
+{
+	if( !_fast_lock_pending )
+		return;
+
+	GPTP_LOG_STATUS( "Restored syntonization state rejected, relocking" );
+
+	_fast_lock_pending = false;
+	_ppm = 0;
+	rate_servo->clear();
+	_master_local_freq_offset_init = false;
+}
+
+void IEEE1588Clock::setRateServo( const ServoConfig &config )
+{
+	delete rate_servo;
+	rate_servo = RateServo::create( config );
+	_master_local_freq_offset_init = false;
+}
+
 void IEEE1588Clock::setMasterOffset
 ( CommonPort *port, int64_t master_local_offset,
   Timestamp local_time, FrequencyRatio master_local_freq_offset,
@@ -415,6 +583,12 @@ void IEEE1588Clock::setMasterOffset
 
 		// Adjust for frequency offset
 		long double phase_error = (long double) -master_local_offset;
+		if( _fast_lock_pending ) {
+			/* The first sync tells whether the restored rate applies */
+			if( fabsl(phase_error) > PHASE_ERROR_THRESHOLD )
+				fastLockRollback();
+			_fast_lock_pending = false;
+		}
 		if( fabsl(phase_error) > PHASE_ERROR_THRESHOLD ) {
 			++_phase_error_violation;
 		} else {
@@ -451,47 +625,23 @@ Timestamp IEEE1588Clock::getPreciseTime(void)
 	return getSystemTime();
 }
 
-bool IEEE1588Clock::isBetterThan(PTPMessageAnnounce * msg)
+BmcaKey IEEE1588Clock::getBmcaKey(void)
 {
-	unsigned char this1[14];
-	unsigned char that1[14];
-	uint16_t tmp;
+	uint8_t identity[PTP_CLOCK_IDENTITY_LENGTH];
 
-	if (msg == NULL)
-		return true;
-
-	this1[0] = priority1;
-	that1[0] = msg->getGrandmasterPriority1();
-
-	this1[1] = clock_quality.cq_class;
-	that1[1] = msg->getGrandmasterClockQuality()->cq_class;
-
-	this1[2] = clock_quality.clockAccuracy;
-	that1[2] = msg->getGrandmasterClockQuality()->clockAccuracy;
-
-	tmp = clock_quality.offsetScaledLogVariance;
-	tmp = PLAT_htons(tmp);
-	memcpy(this1 + 3, &tmp, sizeof(tmp));
-	tmp = msg->getGrandmasterClockQuality()->offsetScaledLogVariance;
-	tmp = PLAT_htons(tmp);
-	memcpy(that1 + 3, &tmp, sizeof(tmp));
-
-	this1[5] = priority2;
-	that1[5] = msg->getGrandmasterPriority2();
-
-	clock_identity.getIdentityString(this1 + 6);
-	msg->getGrandmasterIdentity((char *)that1 + 6);
+	clock_identity.getIdentityString(identity);
+	return BmcaKey::make(priority1, clock_quality.cq_class,
+			     clock_quality.clockAccuracy,
+			     clock_quality.offsetScaledLogVariance,
+			     priority2, identity);
+}
 
-#if 0
-	GPTP_LOG_DEBUG("(Clk)Us: ");
-	for (int i = 0; i < 14; ++i)
-		GPTP_LOG_DEBUG("%hhx ", this1[i]);
-	GPTP_LOG_DEBUG("(Clk)Them: ");
-	for (int i = 0; i < 14; ++i)
-		GPTP_LOG_DEBUG("%hhx ", that1[i]);
-#endif
+bool IEEE1588Clock::isBetterThan(const ForeignMaster * fm)
+{
+	if (fm == NULL)
+		return true;
 
-	return (memcmp(this1, that1, 14) < 0) ? true : false;
+	return getBmcaKey() < fm->getKey();
 }
 
 IEEE1588Clock::~IEEE1588Clock(void)
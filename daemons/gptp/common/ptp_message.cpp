@@ -42,6 +42,18 @@
 #include <string.h>
 #include <math.h>
 
+#include <chrono>
+
+AVBTS_POOL_DEFINE(PTPMessageAnnounce, PTP_MESSAGE_POOL_SIZE)
+AVBTS_POOL_DEFINE(PTPMessageSync, PTP_MESSAGE_POOL_SIZE)
+AVBTS_POOL_DEFINE(PTPMessageFollowUp, PTP_MESSAGE_POOL_SIZE)
+AVBTS_POOL_DEFINE(PTPMessagePathDelayReq, PTP_MESSAGE_POOL_SIZE)
+AVBTS_POOL_DEFINE(PTPMessagePathDelayResp, PTP_MESSAGE_POOL_SIZE)
+AVBTS_POOL_DEFINE(PTPMessagePathDelayRespFollowUp, PTP_MESSAGE_POOL_SIZE)
+AVBTS_POOL_DEFINE(PTPMessageSignalling, PTP_MESSAGE_POOL_SIZE)
+AVBTS_POOL_DEFINE(PortIdentity, PORT_IDENTITY_POOL_SIZE)
+AVBTS_POOL_DEFINE(ClockQuality, CLOCK_QUALITY_POOL_SIZE)
+
 PTPMessageCommon::PTPMessageCommon( CommonPort *port )
 {
 	// Fill in fields using port/clock dataset as a template
@@ -69,7 +81,7 @@ PTPMessageCommon *buildPTPMessage
 ( char *buf, int size, LinkLayerAddress *remote,
   EtherPort *port )
 {
-	OSTimer *timer = port->getTimerFactory()->createTimer();
+	OSTimer *timer = NULL;		// Only needed when the RX timestamp is late
 	PTPMessageCommon *msg = NULL;
 	PTPMessageId messageId;
 	MessageType messageType;
@@ -128,6 +140,8 @@ PTPMessageCommon *buildPTPMessage
 			(sourcePortIdentity, messageId, timestamp, counter_value, false);
 		while (ts_good != GPTP_EC_SUCCESS && iter-- != 0) {
 			// Waits at least 1 time slice regardless of size of 'req'
+			if (timer == NULL)
+				timer = port->getTimerFactory()->createTimer();
 			timer->sleep(req);
 			if (ts_good != GPTP_EC_EAGAIN)
 				GPTP_LOG_ERROR(
@@ -551,6 +565,8 @@ bool PTPMessageCommon::getTxTimestamp( EtherPort *port, uint32_t link_speed )
 	uint32_t unused;
 	unsigned req = TX_TIMEOUT_BASE;
 	int iter = TX_TIMEOUT_ITER;
+	std::chrono::steady_clock::time_point start =
+		std::chrono::steady_clock::now();
 
 	ts_good = port->getTxTimestamp
 		( this, tx_timestamp, unused, false );
@@ -565,6 +581,10 @@ bool PTPMessageCommon::getTxTimestamp( EtherPort *port, uint32_t link_speed )
 			( this, tx_timestamp, unused , iter == 0 );
 		req *= 2;
 	}
+	port->getStats()->txTimestamp
+		( std::chrono::duration_cast<std::chrono::nanoseconds>
+		  ( std::chrono::steady_clock::now() - start ).count(),
+		  ts_good == GPTP_EC_SUCCESS );
 
 	if( ts_good == GPTP_EC_SUCCESS )
 	{
@@ -662,46 +682,18 @@ PTPMessageAnnounce::~PTPMessageAnnounce(void)
 	delete grandmasterClockQuality;
 }
 
-bool PTPMessageAnnounce::isBetterThan(PTPMessageAnnounce * msg)
+BmcaKey PTPMessageAnnounce::getBmcaKey(void)
 {
-	unsigned char this1[14];
-	unsigned char that1[14];
-	uint16_t tmp;
-
-	this1[0] = grandmasterPriority1;
-	that1[0] = msg->getGrandmasterPriority1();
-
-	this1[1] = grandmasterClockQuality->cq_class;
-	that1[1] = msg->getGrandmasterClockQuality()->cq_class;
-
-	this1[2] = grandmasterClockQuality->clockAccuracy;
-	that1[2] = msg->getGrandmasterClockQuality()->clockAccuracy;
-
-	tmp = grandmasterClockQuality->offsetScaledLogVariance;
-	tmp = PLAT_htons(tmp);
-	memcpy(this1 + 3, &tmp, sizeof(tmp));
-	tmp = msg->getGrandmasterClockQuality()->offsetScaledLogVariance;
-	tmp = PLAT_htons(tmp);
-	memcpy(that1 + 3, &tmp, sizeof(tmp));
-
-	this1[5] = grandmasterPriority2;
-	that1[5] = msg->getGrandmasterPriority2();
-
-	this->getGrandmasterIdentity((char *)this1 + 6);
-	msg->getGrandmasterIdentity((char *)that1 + 6);
-
-#if 0
-	GPTP_LOG_VERBOSE("Us: ");
-	for (int i = 0; i < 14; ++i)
-		GPTP_LOG_VERBOSE("%hhx", this1[i]);
-	GPTP_LOG_VERBOSE("\n");
-	GPTP_LOG_VERBOSE("Them: ");
-	for (int i = 0; i < 14; ++i)
-		GPTP_LOG_VERBOSE("%hhx", that1[i]);
-	GPTP_LOG_VERBOSE("\n");
-#endif
+	return BmcaKey::make(grandmasterPriority1,
+			     grandmasterClockQuality->cq_class,
+			     grandmasterClockQuality->clockAccuracy,
+			     grandmasterClockQuality->offsetScaledLogVariance,
+			     grandmasterPriority2, grandmasterIdentity);
+}
 
-	return (memcmp(this1, that1, 14) < 0) ? true : false;
+bool PTPMessageAnnounce::isBetterThan(PTPMessageAnnounce * msg)
+{
+	return getBmcaKey() < msg->getBmcaKey();
 }
 
 
@@ -860,11 +852,16 @@ void PTPMessageAnnounce::processMessage( EtherPort *port )
 		goto bail;
 	}
 
-	// Add message to the list
-	port->setQualifiedAnnounce( this );
-
-	port->getClock()->addEventTimerLocked(port, STATE_CHANGE_EVENT, 16000000);
+	// Update the foreign master table. A slave port whose best system
+	// is unchanged would come out of BMCA the same, skip the run.
+	if( port->updateForeignMaster( this ) ||
+	    port->getPortState() != PTP_SLAVE )
+		port->getClock()->addEventTimerLocked
+			(port, STATE_CHANGE_EVENT, 16000000);
  bail:
+	// The table keeps a copy of what it needs
+	_gc = true;
+
 	port->getClock()->addEventTimerLocked
 		(port, ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES,
 		 (unsigned long long)
@@ -895,9 +892,12 @@ void PTPMessageSync::processMessage( EtherPort *port )
 		PTPMessageSync *old_sync = port->getLastSync();
 
 		if (old_sync != NULL) {
+			port->getStats()->missedFollowUp();
 			delete old_sync;
 		}
 		port->setLastSync(this);
+		port->getStats()->syncReceived
+			( TIMESTAMP_TO_NS(_timestamp), logMeanMessageInterval );
 		_gc = false;
 		goto done;
 #if CHECK_ASSIST_BIT
@@ -1036,6 +1036,7 @@ void PTPMessageFollowUp::processMessage( EtherPort *port )
 		}
 		GPTP_LOG_ERROR
 		    ("Received Follow Up %d times but cannot find corresponding Sync", cnt);
+		port->getStats()->missedFollowUp();
 		goto done;
 	}
 
@@ -1132,6 +1133,22 @@ void PTPMessageFollowUp::processMessage( EtherPort *port )
 		local_system_offset =
 			TIMESTAMP_TO_NS(system_time) - TIMESTAMP_TO_NS(sync_arrival);
 
+		if( port->getClock()->isRelay() )
+		{
+			SyncRelayInfo relay;
+
+			relay.port = port;
+			relay.origin = preciseOriginTimestamp;
+			relay.system_at_rx = TIMESTAMP_TO_NS( system_time );
+			relay.gm_system_rate =
+				local_clock_adjustment * local_system_freq_offset;
+			port->getClock()->setSyncRelayInfo( relay );
+		}
+
+		port->getStats()->servoOffset
+			( scalar_offset, TIMESTAMP_TO_NS( sync_arrival ),
+			  local_clock_adjustment );
+
 		port->getClock()->setMasterOffset
 			( port, scalar_offset, sync_arrival, local_clock_adjustment,
 			  local_system_offset, system_time, local_system_freq_offset,
@@ -1247,6 +1264,9 @@ void PTPMessagePathDelayReq::processMessage( EtherPort *port )
 
 	GPTP_LOG_VERBOSE("#3 Correction Field: %Ld", turnaround);
 
+	if( resp->getTimestamp()._version == _timestamp._version )
+		port->getStats()->pdelayTurnaround( turnaround );
+
 	resp_fwup->setCorrectionField(0);
 	resp_fwup->sendPort(port, sourcePortIdentity);
 
@@ -1465,7 +1485,6 @@ PTPMessagePathDelayRespFollowUp::~PTPMessagePathDelayRespFollowUp()
 	delete requestingPortIdentity;
 }
 
-#define US_PER_SEC 1000000
 void PTPMessagePathDelayRespFollowUp::processMessage
 ( EtherPort *port )
 {
@@ -1685,6 +1704,8 @@ void PTPMessagePathDelayRespFollowUp::processMessage
 			}
 		}
 	}
+	port->checkRestoredLinkDelay
+		( link_delay, resp_sourcePortIdentity.getClockIdentity() );
 	if( !port->setLinkDelay( link_delay ) ) {
 		if (!port->getAutomotiveProfile()) {
 			GPTP_LOG_ERROR("Link delay %ld beyond neighborPropDelayThresh; not AsCapable", link_delay);
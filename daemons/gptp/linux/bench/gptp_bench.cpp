@@ -0,0 +1,1279 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+/**@file*/
+
+/*
+ * gPTP message path and servo benchmark.
+ *
+ * A grandmaster and a slave run in one process, each a real
+ * IEEE1588Clock and EtherPort, on virtual time. Only the OS layer is
+ * replaced: the timestampers read simulated oscillators, the network
+ * interfaces hand frames to each other after a link delay plus packet
+ * delay variation, timers fire in virtual time order and no thread is
+ * started. Frame reception calls EtherPort::processMessage() just like
+ * the receive thread does, and timers are fired with the timer queue
+ * lock held just like the timer thread does.
+ *
+ * Reported are the time taken per received message type and per timer
+ * event, how long OSLocks were held, and the slave's servo quality: the
+ * offset and rate it publishes through the IPC interface compared with
+ * the simulated clocks, and how long it takes to converge after start
+ * and after each grandmaster time base change.
+ *
+ * With -T it instead checks that the timers of two ports on one clock,
+ * as in relay mode, don't cancel each other.
+ */
+
+#include "ieee1588.hpp"
+#include "avbts_clock.hpp"
+#include "avbts_osnet.hpp"
+#include "avbts_oslock.hpp"
+#include "avbts_oscondition.hpp"
+#include "avbts_osthread.hpp"
+#include "avbts_ostimer.hpp"
+#include "avbts_ostimerq.hpp"
+#include "avbts_osipc.hpp"
+#include "ether_port.hpp"
+#include "ether_tstamper.hpp"
+#include "gptp_cfg.hpp"
+#include "gptp_log.hpp"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <math.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#define SIM_NODES 2						/* Grandmaster and slave */
+#define SIM_GM 0
+#define SIM_SLAVE 1
+#define SIM_START_NS (1000ULL * NS_PER_SECOND)	/* Virtual time at start */
+#define SIM_FRAME_SIZE 128				/* Same as the receive thread buffer */
+#define SIM_MESSAGE_TYPES 16
+#define SIM_EVENTS (LINK_FLAP_WINDOW_EXPIRES + 1)
+#define SIM_CONVERGED_SYNCS 8			/* Syncs within thresholds to call it converged */
+
+class SimNode;
+class SimTimerQueue;
+
+/* Command line options */
+struct SimOptions {
+	unsigned seconds;
+	bool syntonize;
+	bool automotive;
+	signed char log_sync_interval;
+	uint64_t link_delay_ns;
+	uint64_t pdv_uniform_ns;
+	uint64_t pdv_queue_ns;
+	uint64_t ts_resolution_ns;
+	long double slave_ppm;
+	long double gm_ppm;
+	uint64_t gm_change_ns;
+	uint64_t gm_step_ns;
+	int64_t conv_offset_ns;
+	int64_t conv_rate_ppb;
+	bool lock_timing;
+	bool async_log;
+	uint32_t seed;
+	bool timer_check;
+};
+
+/* Distribution of a quantity; percentiles are taken of the magnitude */
+class SimSamples {
+private:
+	std::vector<int64_t> samples;
+public:
+	struct Summary {
+		int64_t mean;		/* Signed mean */
+		int64_t p50;
+		int64_t p99;
+		int64_t max;
+	};
+
+	void add( int64_t value )
+	{
+		samples.push_back( value );
+	}
+
+	size_t count() const
+	{
+		return samples.size();
+	}
+
+	void summarize( Summary &s ) const
+	{
+		size_t n = samples.size();
+		long double sum = 0;
+
+		memset( &s, 0, sizeof( s ));
+		if( n == 0 )
+			return;
+
+		std::vector<int64_t> mag( n );
+		for( size_t i = 0; i < n; ++i ) {
+			sum += samples[i];
+			mag[i] = samples[i] < 0 ? -samples[i] : samples[i];
+		}
+		std::sort( mag.begin(), mag.end() );
+
+		s.mean = (int64_t)( sum / n );
+		s.p50 = mag[( n - 1 ) * 50 / 100];
+		s.p99 = mag[( n - 1 ) * 99 / 100];
+		s.max = mag[n - 1];
+	}
+};
+
+/* Something due at a virtual time: a timer or a frame arriving */
+struct SimEvent {
+	enum { TIMER, FRAME, GM_CHANGE } kind;
+	SimNode *node;				/* Node it happens on */
+
+	/* TIMER */
+	SimTimerQueue *timerq;
+	int type;
+	ostimerq_handler func;
+	event_descriptor_t *arg;
+	bool rm;
+
+	/* FRAME */
+	uint8_t buf[SIM_FRAME_SIZE];
+	size_t length;
+};
+
+typedef std::multimap<uint64_t, SimEvent> SimEventMap;
+
+/* Simulation state shared with the OS layer replacements */
+static struct {
+	SimOptions opt;
+	uint64_t now;				/* Virtual time (ns) */
+	SimEventMap events;
+	uint32_t rnd;
+
+	/* Message path cost per received message type and per timer event */
+	SimSamples msg_ns[SIM_MESSAGE_TYPES];
+	SimSamples msg_lock_ns[SIM_MESSAGE_TYPES];
+	SimSamples event_ns[SIM_EVENTS];
+	SimSamples event_lock_ns[SIM_EVENTS];
+
+	/* OSLock use */
+	uint64_t lock_acquisitions;
+	uint64_t lock_contended;
+	uint64_t lock_hold_ns;		/* Only with lock timing */
+	uint64_t lock_hold_max_ns;
+
+	/* Servo quality, from the slave's IPC updates */
+	SimSamples offset_err_ns;	/* Published - true master to local offset */
+	SimSamples rate_err_ppb;	/* Published - true master to local rate ratio */
+	SimSamples clock_offset_ns;	/* Slave - master clock at sync arrival */
+	std::vector<uint64_t> epochs;	/* Start and grandmaster change times */
+	std::vector<int64_t> converged;	/* Per epoch, ns after its start, -1 if not */
+	unsigned good_syncs;
+	uint64_t good_since;
+	uint64_t syncs;
+	uint64_t unmatched_syncs;
+} sim;
+
+static inline uint64_t simWallNow( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (uint64_t)ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+
+/* xorshift32, seeded from the command line so runs repeat */
+static uint32_t simRand( void )
+{
+	sim.rnd ^= sim.rnd << 13;
+	sim.rnd ^= sim.rnd >> 17;
+	sim.rnd ^= sim.rnd << 5;
+	return sim.rnd;
+}
+
+/* Uniform in [0, 1) */
+static long double simUniform( void )
+{
+	return simRand() / 4294967296.0L;
+}
+
+static Timestamp simTimestamp( uint64_t ns, uint8_t version )
+{
+	Timestamp ts( 0, 0, 0, version );
+	ts.set64( ns );
+	return ts;
+}
+
+/* Free running oscillator, optionally steered by the servo */
+class SimOscillator {
+private:
+	uint64_t base_true;
+	long double base_local;
+	long double ppm;			/* Offset from true time */
+	long double adj_ppm;		/* Servo adjustment */
+
+	void rebase( uint64_t t )
+	{
+		base_local = at( t );
+		base_true = t;
+	}
+public:
+	SimOscillator() : base_true( 0 ), base_local( 0 ), ppm( 0 ), adj_ppm( 0 ) { }
+
+	void init( uint64_t t, long double local, long double offset_ppm )
+	{
+		base_true = t;
+		base_local = local;
+		ppm = offset_ppm;
+	}
+
+	long double at( uint64_t t ) const
+	{
+		return base_local + (long double)( t - base_true ) * rate();
+	}
+
+	long double rate() const
+	{
+		return 1.0L + ( ppm + adj_ppm ) / 1000000.0L;
+	}
+
+	void adjust( uint64_t t, long double new_adj_ppm )
+	{
+		rebase( t );
+		adj_ppm = new_adj_ppm;
+	}
+
+	void setOffset( uint64_t t, long double new_ppm )
+	{
+		rebase( t );
+		ppm = new_ppm;
+	}
+
+	void step( uint64_t t, long double phase_ns )
+	{
+		rebase( t );
+		base_local += phase_ns;
+	}
+};
+
+/* Instrumented pthread mutex */
+class SimLock : public OSLock {
+private:
+	pthread_mutex_t mutex;
+	unsigned depth;
+	uint64_t taken;
+
+	void acquired( void )
+	{
+		++sim.lock_acquisitions;
+		if( depth++ == 0 && sim.opt.lock_timing )
+			taken = simWallNow();
+	}
+public:
+	SimLock( OSLockType type ) : depth( 0 ), taken( 0 )
+	{
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init( &attr );
+		pthread_mutexattr_settype( &attr, type == oslock_recursive ?
+			PTHREAD_MUTEX_RECURSIVE : PTHREAD_MUTEX_NORMAL );
+		pthread_mutex_init( &mutex, &attr );
+		pthread_mutexattr_destroy( &attr );
+	}
+
+	~SimLock()
+	{
+		pthread_mutex_destroy( &mutex );
+	}
+
+	OSLockResult lock()
+	{
+		if( pthread_mutex_trylock( &mutex ) != 0 ) {
+			++sim.lock_contended;
+			if( pthread_mutex_lock( &mutex ) != 0 )
+				return oslock_fail;
+		}
+		acquired();
+		return oslock_ok;
+	}
+
+	OSLockResult trylock()
+	{
+		if( pthread_mutex_trylock( &mutex ) != 0 )
+			return oslock_fail;
+		acquired();
+		return oslock_ok;
+	}
+
+	OSLockResult unlock()
+	{
+		if( --depth == 0 && sim.opt.lock_timing ) {
+			uint64_t held = simWallNow() - taken;
+			sim.lock_hold_ns += held;
+			if( held > sim.lock_hold_max_ns )
+				sim.lock_hold_max_ns = held;
+		}
+		if( pthread_mutex_unlock( &mutex ) != 0 )
+			return oslock_fail;
+		return oslock_ok;
+	}
+};
+
+class SimLockFactory : public OSLockFactory {
+public:
+	OSLock *createLock( OSLockType type ) const
+	{
+		return new SimLock( type );
+	}
+};
+
+/* Everything runs on one thread, nothing ever waits */
+class SimCondition : public OSCondition {
+public:
+	bool wait() { return true; }
+	bool wait_prelock() { return true; }
+	bool signal() { return true; }
+};
+
+class SimConditionFactory : public OSConditionFactory {
+public:
+	OSCondition *createCondition() const
+	{
+		return new SimCondition();
+	}
+};
+
+/* The receive and link watch threads are replaced by the event loop */
+class SimThread : public OSThread {
+public:
+	bool start( OSThreadFunction function, void *arg ) { return true; }
+	bool join( OSThreadExitCode &exit_code )
+	{
+		exit_code = osthread_ok;
+		return true;
+	}
+};
+
+class SimThreadFactory : public OSThreadFactory {
+public:
+	OSThread *createThread( OSThreadRole role = OSTHREAD_ROLE_DEFAULT ) const
+	{
+		return new SimThread();
+	}
+};
+
+/* Timestamps are always ready, so only retry sleeps get here */
+class SimTimer : public OSTimer {
+public:
+	unsigned long sleep( unsigned long micros ) { return micros; }
+};
+
+class SimTimerFactory : public OSTimerFactory {
+public:
+	OSTimer *createTimer() const
+	{
+		return new SimTimer();
+	}
+};
+
+class SimTimerQueue : public OSTimerQueue {
+private:
+	SimNode *node;
+public:
+	SimTimerQueue( SimNode *node ) : node( node ) { }
+
+	bool addEvent
+	( unsigned long micros, int type, ostimerq_handler func,
+	  event_descriptor_t *arg, bool rm, unsigned *event )
+	{
+		SimEvent ev;
+
+		ev.kind = SimEvent::TIMER;
+		ev.node = node;
+		ev.timerq = this;
+		ev.type = type;
+		ev.func = func;
+		ev.arg = arg;
+		ev.rm = rm;
+		ev.length = 0;
+		sim.events.insert
+			( std::make_pair( sim.now + (uint64_t)micros * 1000, ev ));
+		return true;
+	}
+
+	bool cancelEvent( int type, CommonPort *port, unsigned *event )
+	{
+		SimEventMap::iterator it = sim.events.begin();
+		while( it != sim.events.end() ) {
+			SimEvent &ev = it->second;
+			if( ev.kind == SimEvent::TIMER && ev.timerq == this &&
+			    ev.type == type &&
+			    ( port == NULL || ev.arg == NULL || ev.arg->port == port )) {
+				if( ev.rm )
+					delete ev.arg;
+				it = sim.events.erase( it );
+			} else {
+				++it;
+			}
+		}
+		return true;
+	}
+};
+
+class SimTimerQueueFactory : public OSTimerQueueFactory {
+public:
+	/* Set before creating a node's clock */
+	SimNode *node;
+
+	OSTimerQueue *createOSTimerQueue( IEEE1588Clock *clock )
+	{
+		return new SimTimerQueue( node );
+	}
+};
+
+class SimTimestamper;
+class SimNetworkInterface;
+class SimIPC;
+
+class SimNode {
+public:
+	unsigned index;
+	SimOscillator osc;
+	int64_t system_offset;		/* System clock - true time */
+	uint8_t mac[ETHER_ADDR_OCTETS];
+	SimNode *peer;
+	uint64_t last_arrival;		/* Keeps the link to the peer in order */
+
+	InterfaceName *label;
+	SimTimestamper *timestamper;
+	SimIPC *ipc;
+	IEEE1588Clock *clock;
+	EtherPort *port;
+
+	/* Last TX timestamp per event message type */
+	uint64_t tx_ns[SIM_MESSAGE_TYPES];
+	uint16_t tx_seq[SIM_MESSAGE_TYPES];
+	bool tx_valid[SIM_MESSAGE_TYPES];
+
+	/* RX timestamp of the frame being received */
+	uint64_t rx_ns;
+
+	/* The truth at the last Sync arrival */
+	uint64_t sync_rx_ns;
+	long double sync_master_ns;
+	long double sync_ratio;
+
+	uint64_t quantize( long double ns ) const
+	{
+		uint64_t t = (uint64_t) ns;
+		return t - t % sim.opt.ts_resolution_ns;
+	}
+
+	uint64_t deviceNow() const
+	{
+		return quantize( osc.at( sim.now ));
+	}
+
+	/* Called by the network interface for every frame sent */
+	void transmit( const uint8_t *payload, size_t length );
+};
+
+class SimTimestamper : public EtherTimestamper {
+private:
+	SimNode *node;
+public:
+	SimTimestamper( SimNode *node ) : node( node ) { }
+
+	SimNode *getNode() const
+	{
+		return node;
+	}
+
+	bool HWTimestamper_adjclockrate( float frequency_offset ) const
+	{
+		node->osc.adjust( sim.now, frequency_offset );
+		return true;
+	}
+
+	bool HWTimestamper_adjclockphase( int64_t phase_adjust )
+	{
+		node->osc.step( sim.now, phase_adjust );
+		return true;
+	}
+
+	bool HWTimestamper_gettime
+	( Timestamp *system_time, Timestamp *device_time,
+	  uint32_t *local_clock, uint32_t *nominal_clock_rate ) const
+	{
+		*system_time = simTimestamp
+			( sim.now + node->system_offset, version );
+		*device_time = simTimestamp( node->deviceNow(), version );
+		*local_clock = 0;
+		*nominal_clock_rate = 0;
+		return true;
+	}
+
+	int HWTimestamper_txtimestamp
+	( PortIdentity *identity, PTPMessageId messageId,
+	  Timestamp &timestamp, unsigned &clock_value, bool last )
+	{
+		unsigned type = messageId.getMessageType() & 0xF;
+
+		if( !node->tx_valid[type] ||
+		    node->tx_seq[type] != messageId.getSequenceId() )
+			return GPTP_EC_FAILURE;
+
+		timestamp = simTimestamp( node->tx_ns[type], version );
+		clock_value = 0;
+		return GPTP_EC_SUCCESS;
+	}
+
+	int HWTimestamper_rxtimestamp
+	( PortIdentity *identity, PTPMessageId messageId,
+	  Timestamp &timestamp, unsigned &clock_value, bool last )
+	{
+		timestamp = simTimestamp( node->rx_ns, version );
+		clock_value = 0;
+		return GPTP_EC_SUCCESS;
+	}
+};
+
+class SimNetworkInterface : public OSNetworkInterface {
+private:
+	SimNode *node;
+public:
+	SimNetworkInterface( SimNode *node ) : node( node ) { }
+
+	net_result send
+	( LinkLayerAddress *addr, uint16_t etherType, uint8_t *payload,
+	  size_t length, bool timestamp )
+	{
+		node->transmit( payload, length );
+		return net_succeed;
+	}
+
+	net_result nrecv
+	( LinkLayerAddress *addr, uint8_t *payload, size_t &length )
+	{
+		return net_trfail;
+	}
+
+	void getLinkLayerAddress( LinkLayerAddress *addr )
+	{
+		*addr = LinkLayerAddress( node->mac );
+	}
+
+	void watchNetLink( CommonPort *pPort ) { }
+
+	unsigned getPayloadOffset()
+	{
+		return 0;
+	}
+};
+
+class SimNetworkInterfaceFactory : public OSNetworkInterfaceFactory {
+private:
+	bool createInterface
+	( OSNetworkInterface **iface, InterfaceLabel *iflabel,
+	  CommonTimestamper *timestamper )
+	{
+		SimTimestamper *sim_timestamper =
+			dynamic_cast<SimTimestamper *>( timestamper );
+		if( sim_timestamper == NULL )
+			return false;
+		*iface = new SimNetworkInterface( sim_timestamper->getNode() );
+		return true;
+	}
+};
+
+/* Compares what the slave publishes with the simulated clocks */
+class SimIPC : public OS_IPC {
+private:
+	SimNode *node;
+public:
+	SimIPC( SimNode *node ) : node( node ) { }
+
+	bool init( OS_IPC_ARG *arg ) { return true; }
+
+	bool update
+	( int64_t ml_phoffset, int64_t ls_phoffset,
+	  FrequencyRatio ml_freqoffset, FrequencyRatio ls_freq_offset,
+	  uint64_t local_time, uint32_t sync_count, uint32_t pdelay_count,
+	  PortState port_state, bool asCapable );
+
+	bool update_grandmaster
+	( uint8_t gptp_grandmaster_id[], uint8_t gptp_domain_number )
+	{
+		return true;
+	}
+
+	bool update_network_interface
+	( uint8_t clock_identity[], uint8_t priority1, uint8_t clock_class,
+	  int16_t offset_scaled_log_variance, uint8_t clock_accuracy,
+	  uint8_t priority2, uint8_t domain_number, int8_t log_sync_interval,
+	  int8_t log_announce_interval, int8_t log_pdelay_interval,
+	  uint16_t port_number )
+	{
+		return true;
+	}
+};
+
+bool SimIPC::update
+( int64_t ml_phoffset, int64_t ls_phoffset, FrequencyRatio ml_freqoffset,
+  FrequencyRatio ls_freq_offset, uint64_t local_time, uint32_t sync_count,
+  uint32_t pdelay_count, PortState port_state, bool asCapable )
+{
+	if( port_state != PTP_SLAVE )
+		return true;
+
+	if( local_time != node->sync_rx_ns ) {
+		++sim.unmatched_syncs;
+		return true;
+	}
+	++sim.syncs;
+
+	int64_t true_offset =
+		(int64_t)( (long double) local_time - node->sync_master_ns );
+	int64_t offset_err = ml_phoffset - true_offset;
+	int64_t rate_err = (int64_t)
+		(( ml_freqoffset - node->sync_ratio ) * 1000000000.0L );
+
+	sim.offset_err_ns.add( offset_err );
+	sim.rate_err_ppb.add( rate_err );
+	sim.clock_offset_ns.add( true_offset );
+
+	if( llabs( offset_err ) <= sim.opt.conv_offset_ns &&
+	    llabs( rate_err ) <= sim.opt.conv_rate_ppb ) {
+		if( sim.good_syncs++ == 0 )
+			sim.good_since = sim.now;
+		if( sim.good_syncs == SIM_CONVERGED_SYNCS &&
+		    sim.converged.back() < 0 )
+			sim.converged.back() = sim.good_since - sim.epochs.back();
+	} else {
+		sim.good_syncs = 0;
+	}
+
+	return true;
+}
+
+void SimNode::transmit( const uint8_t *payload, size_t length )
+{
+	SimEvent ev;
+	unsigned type = payload[PTP_COMMON_HDR_TRANSSPEC_MSGTYPE
+				( PTP_COMMON_HDR_OFFSET )] & 0xF;
+	uint16_t seq;
+
+	memcpy( &seq, payload + PTP_COMMON_HDR_SEQUENCE_ID
+		( PTP_COMMON_HDR_OFFSET ), sizeof( seq ));
+
+	// Event messages are timestamped as they leave
+	if( !( type >> 3 )) {
+		tx_ns[type] = deviceNow();
+		tx_seq[type] = ntohs( seq );
+		tx_valid[type] = true;
+	}
+
+	if( length > SIM_FRAME_SIZE )
+		length = SIM_FRAME_SIZE;
+
+	ev.kind = SimEvent::FRAME;
+	ev.node = peer;
+	ev.timerq = NULL;
+	ev.arg = NULL;
+	memcpy( ev.buf, payload, length );
+	ev.length = length;
+
+	uint64_t delay = sim.opt.link_delay_ns;
+	if( sim.opt.pdv_uniform_ns )
+		delay += (uint64_t)( simUniform() * sim.opt.pdv_uniform_ns );
+	if( sim.opt.pdv_queue_ns )
+		delay += (uint64_t)
+			( -logl( 1.0L - simUniform() ) * sim.opt.pdv_queue_ns );
+
+	// Frames on a link never overtake each other
+	uint64_t arrival = std::max( sim.now + delay, last_arrival );
+	last_arrival = arrival;
+
+	sim.events.insert( std::make_pair( arrival, ev ));
+}
+
+/*
+ * Event handling, timed the same way for every message type and timer
+ * event. The cost includes what the simulated OS layer does on behalf of
+ * the stack, which is a copy and a map insert per frame sent.
+ */
+static void simReceive( SimEvent &ev )
+{
+	SimNode *node = ev.node;
+	unsigned type = ev.buf[PTP_COMMON_HDR_TRANSSPEC_MSGTYPE
+				( PTP_COMMON_HDR_OFFSET )] & 0xF;
+	LinkLayerAddress remote( node->peer->mac );
+
+	node->rx_ns = node->deviceNow();
+	if( type == SYNC_MESSAGE ) {
+		node->sync_rx_ns = node->rx_ns;
+		node->sync_master_ns = node->peer->osc.at( sim.now );
+		node->sync_ratio = node->peer->osc.rate() / node->osc.rate();
+	}
+
+	uint64_t lock_ns = sim.lock_hold_ns;
+	uint64_t start = simWallNow();
+	node->port->processMessage
+		( (char *) ev.buf, (int) ev.length, &remote, LINKSPEED_1G );
+	sim.msg_ns[type].add( simWallNow() - start );
+	if( sim.opt.lock_timing )
+		sim.msg_lock_ns[type].add( sim.lock_hold_ns - lock_ns );
+}
+
+static void simTimer( SimEvent &ev )
+{
+	IEEE1588Clock *clock = ev.node->clock;
+	unsigned type = ev.type < SIM_EVENTS ? ev.type : NULL_EVENT;
+
+	uint64_t lock_ns = sim.lock_hold_ns;
+	uint64_t start = simWallNow();
+	if( clock->getTimerQLock() == oslock_fail )
+		return;
+	ev.func( ev.arg );
+	clock->putTimerQLock();
+	sim.event_ns[type].add( simWallNow() - start );
+	if( sim.opt.lock_timing )
+		sim.event_lock_ns[type].add( sim.lock_hold_ns - lock_ns );
+
+	if( ev.rm )
+		delete ev.arg;
+}
+
+/* The grandmaster's time base jumps and its frequency changes */
+static void simGmChange( SimNode *gm )
+{
+	long double step = ( simUniform() * 2 - 1 ) * sim.opt.gm_step_ns;
+	long double ppm = ( simUniform() * 2 - 1 ) * sim.opt.gm_ppm;
+
+	gm->osc.step( sim.now, step );
+	gm->osc.setOffset( sim.now, ppm );
+	gm->clock->updateFUPInfo();
+
+	sim.epochs.push_back( sim.now );
+	sim.converged.push_back( -1 );
+	sim.good_syncs = 0;
+
+	SimEvent ev;
+	ev.kind = SimEvent::GM_CHANGE;
+	ev.node = gm;
+	ev.timerq = NULL;
+	ev.arg = NULL;
+	ev.length = 0;
+	sim.events.insert( std::make_pair( sim.now + sim.opt.gm_change_ns, ev ));
+}
+
+static const char *simMessageName( unsigned type )
+{
+	switch( type ) {
+	case SYNC_MESSAGE: return "Sync";
+	case PATH_DELAY_REQ_MESSAGE: return "PDelay_Req";
+	case PATH_DELAY_RESP_MESSAGE: return "PDelay_Resp";
+	case FOLLOWUP_MESSAGE: return "Follow_Up";
+	case PATH_DELAY_FOLLOWUP_MESSAGE: return "PDelay_Resp_FUp";
+	case ANNOUNCE_MESSAGE: return "Announce";
+	case SIGNALLING_MESSAGE: return "Signalling";
+	default: return "Other";
+	}
+}
+
+static const char *simEventName( unsigned type )
+{
+	switch( type ) {
+	case STATE_CHANGE_EVENT: return "State change";
+	case SYNC_INTERVAL_TIMEOUT_EXPIRES: return "Sync interval";
+	case PDELAY_INTERVAL_TIMEOUT_EXPIRES: return "PDelay interval";
+	case SYNC_RECEIPT_TIMEOUT_EXPIRES: return "Sync receipt TO";
+	case ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES: return "Announce rcpt TO";
+	case ANNOUNCE_INTERVAL_TIMEOUT_EXPIRES: return "Announce interval";
+	case PDELAY_DEFERRED_PROCESSING: return "PDelay deferred";
+	case PDELAY_RESP_RECEIPT_TIMEOUT_EXPIRES: return "PDelay resp TO";
+	case PDELAY_RESP_PEER_MISBEHAVING_TIMEOUT_EXPIRES: return "PDelay misbehaving";
+	case SYNC_RATE_INTERVAL_TIMEOUT_EXPIRED: return "Sync rate interval";
+	case LINK_FLAP_WINDOW_EXPIRES: return "Link flap window";
+	default: return "Other";
+	}
+}
+
+static void simPrintRow
+( const char *name, const SimSamples &cost, const SimSamples &lock )
+{
+	SimSamples::Summary c, l;
+
+	if( cost.count() == 0 )
+		return;
+	cost.summarize( c );
+	lock.summarize( l );
+	printf( "  %-20s %8zu %10" PRId64 " %10" PRId64 " %10" PRId64 " %10" PRId64,
+		name, cost.count(), c.mean, c.p50, c.p99, c.max );
+	if( sim.opt.lock_timing )
+		printf( " %10" PRId64, l.mean );
+	printf( "\n" );
+}
+
+static void simPrintError( const char *name, const SimSamples &samples )
+{
+	SimSamples::Summary s;
+
+	samples.summarize( s );
+	printf( "  %-20s %10" PRId64 " %10" PRId64 " %10" PRId64 " %10" PRId64 "\n",
+		name, s.mean, s.p50, s.p99, s.max );
+}
+
+static void simReport( const char *servo_name, SimNode *slave, uint64_t wall_ns )
+{
+	unsigned i;
+	uint64_t messages = 0;
+
+	for( i = 0; i < SIM_MESSAGE_TYPES; ++i )
+		messages += sim.msg_ns[i].count();
+
+	printf( "\n%u s simulated in %.3f s, %" PRIu64 " messages received, "
+		"servo %s, syntonize %s%s\n", sim.opt.seconds,
+		(double) wall_ns / NS_PER_SECOND, messages, servo_name,
+		sim.opt.syntonize ? "on" : "off",
+		sim.opt.automotive ? ", automotive profile" : "" );
+	printf( "  link delay %" PRIu64 " ns, PDV uniform %" PRIu64
+		" ns + queueing mean %" PRIu64 " ns, timestamp resolution %"
+		PRIu64 " ns\n", sim.opt.link_delay_ns, sim.opt.pdv_uniform_ns,
+		sim.opt.pdv_queue_ns, sim.opt.ts_resolution_ns );
+	printf( "  GM %+.3Lf ppm, slave %+.3Lf ppm", sim.opt.gm_ppm,
+		sim.opt.slave_ppm );
+	if( sim.opt.gm_change_ns )
+		printf( ", GM change every %" PRIu64 " s (phase +-%" PRIu64
+			" ns)", sim.opt.gm_change_ns / NS_PER_SECOND,
+			sim.opt.gm_step_ns );
+	printf( "\n\n" );
+
+	printf( "  %-20s %8s %10s %10s %10s %10s%s\n", "received ns", "count",
+		"mean", "p50", "p99", "max",
+		sim.opt.lock_timing ? "    lock ns" : "" );
+	for( i = 0; i < SIM_MESSAGE_TYPES; ++i )
+		simPrintRow( simMessageName( i ), sim.msg_ns[i], sim.msg_lock_ns[i] );
+	printf( "\n  %-20s\n", "timer events ns" );
+	for( i = 0; i < SIM_EVENTS; ++i )
+		simPrintRow( simEventName( i ), sim.event_ns[i], sim.event_lock_ns[i] );
+
+	printf( "\n  OSLocks: %" PRIu64 " acquisitions, %" PRIu64 " contended",
+		sim.lock_acquisitions, sim.lock_contended );
+	if( sim.opt.lock_timing && sim.lock_acquisitions )
+		printf( ", held %" PRIu64 " ns mean, %" PRIu64 " ns max",
+			sim.lock_hold_ns / sim.lock_acquisitions,
+			sim.lock_hold_max_ns );
+	printf( "\n\n" );
+
+	printf( "  %-20s %10s %10s %10s %10s\n", "servo (slave)", "mean",
+		"|p50|", "|p99|", "|max|" );
+	simPrintError( "offset error ns", sim.offset_err_ns );
+	simPrintError( "rate error ppb", sim.rate_err_ppb );
+	simPrintError( "clock offset ns", sim.clock_offset_ns );
+	printf( "  %" PRIu64 " syncs, %" PRIu64 " updates not from a Sync\n",
+		sim.syncs, sim.unmatched_syncs );
+
+	unsigned converged = 0;
+	int64_t conv_sum = 0, conv_max = 0;
+	for( i = 0; i < sim.converged.size(); ++i ) {
+		if( sim.converged[i] < 0 )
+			continue;
+		++converged;
+		conv_sum += sim.converged[i];
+		conv_max = std::max( conv_max, sim.converged[i] );
+	}
+	printf( "  converged (%" PRId64 " ns, %" PRId64 " ppb for %u syncs) "
+		"%u of %zu times", sim.opt.conv_offset_ns, sim.opt.conv_rate_ppb,
+		SIM_CONVERGED_SYNCS, converged, sim.converged.size() );
+	if( converged )
+		printf( ", after %.3f s mean, %.3f s max",
+			(double) conv_sum / converged / NS_PER_SECOND,
+			(double) conv_max / NS_PER_SECOND );
+	printf( "\n" );
+
+	const gPtpPortStats *stats = slave->port->getStats()->get();
+	printf( "  slave port: %s, asCapable %s, link delay %" PRId64 " ns\n",
+		slave->port->getPortState() == PTP_SLAVE ? "slave" : "not slave",
+		slave->port->getAsCapable() ? "on" : "off",
+		(int64_t) slave->port->getLinkDelay() );
+	printf( "  port stats: %" PRIu64 " missed Follow_Ups, servo offset "
+		"prediction %" PRIu64 " ns mean\n\n", stats->missed_follow_ups,
+		stats->servo_offset.count ?
+		stats->servo_offset.sum / stats->servo_offset.count : 0 );
+}
+
+/*
+ * Two ports on one clock share its timer queue. Each port re-arms its
+ * PDelay interval timer in turn; both timers must keep firing. Frames
+ * are dropped, only the timers matter here.
+ */
+static int simTimerCheck
+( PortInit_t &portInit, SimTimerQueueFactory &timerq_factory )
+{
+	SimNode nodes[SIM_NODES];
+	std::map<CommonPort *, unsigned> fired;
+	IEEE1588Clock *clock = NULL;
+	bool ok = true;
+
+	sim.now = SIM_START_NS;
+	for( unsigned i = 0; i < SIM_NODES; ++i ) {
+		SimNode *node = &nodes[i];
+		char name[8];
+		uint8_t mac[ETHER_ADDR_OCTETS] = { 0x02, 0x00, 0x5e, 0x00, 0x01, (uint8_t)( i + 1 ) };
+
+		memset( node->tx_valid, 0, sizeof( node->tx_valid ));
+		node->index = i;
+		memcpy( node->mac, mac, sizeof( mac ));
+		node->peer = &nodes[( i + 1 ) % SIM_NODES];
+		node->last_arrival = 0;
+		node->rx_ns = 0;
+		node->sync_rx_ns = 0;
+		node->osc.init( sim.now, (long double) sim.now, sim.opt.slave_ppm );
+		node->system_offset = 0;
+
+		snprintf( name, sizeof( name ), "relay%u", i );
+		node->label = new InterfaceName( name, strlen( name ));
+		node->timestamper = new SimTimestamper( node );
+		node->ipc = new SimIPC( node );
+
+		if( clock == NULL ) {
+			timerq_factory.node = node;
+			clock = new IEEE1588Clock
+				( false, false, 248, &timerq_factory, node->ipc,
+				  portInit.lock_factory );
+		}
+		node->clock = clock;
+
+		portInit.clock = clock;
+		portInit.index = i + 1;
+		portInit.timestamper = node->timestamper;
+		portInit.net_label = node->label;
+		portInit.isGM = false;
+		node->port = new EtherPort( &portInit );
+		if( !node->port->init_port() ) {
+			fprintf( stderr, "Failed to initialize relay port %u\n", i + 1 );
+			return -1;
+		}
+		node->port->setLinkSpeed( LINKSPEED_1G );
+		node->port->setAsCapable( true );
+	}
+
+	for( unsigned i = 0; i < SIM_NODES; ++i )
+		nodes[i].port->processEvent( POWERUP );
+	// A restart of one port's interval must leave the other's alone
+	for( unsigned i = 0; i < SIM_NODES; ++i )
+		nodes[i].port->startPDelayIntervalTimer( 16000000 );
+
+	uint64_t end = sim.now + 8ULL * NS_PER_SECOND;
+	while( !sim.events.empty() && sim.events.begin()->first < end ) {
+		SimEvent ev = sim.events.begin()->second;
+		sim.now = sim.events.begin()->first;
+		sim.events.erase( sim.events.begin() );
+
+		if( ev.kind != SimEvent::TIMER )
+			continue;
+		if( ev.type == PDELAY_INTERVAL_TIMEOUT_EXPIRES && ev.arg != NULL )
+			++fired[ev.arg->port];
+		simTimer( ev );
+	}
+
+	// At the default 1 s PDelay interval each port fires about 8 times
+	for( unsigned i = 0; i < SIM_NODES; ++i ) {
+		unsigned n = fired[nodes[i].port];
+		printf( "relay port %u: %u PDelay interval timeouts\n", i + 1, n );
+		if( n < 4 )
+			ok = false;
+	}
+	printf( "timer check %s\n", ok ? "passed" : "FAILED" );
+
+	return ok ? 0 : 1;
+}
+
+static void simUsage( char *arg0 )
+{
+	fprintf( stderr,
+		"%s [options]\n"
+		"  -d <sec>     Virtual seconds to run (default 300)\n"
+		"  -F <file>    gptp .ini file with the servo and threshold settings\n"
+		"  -r <servo>   Rate servo: pi, linreg or kalman (overrides -F)\n"
+		"  -S           Syntonize the slave clock, as the daemon's -S\n"
+		"  -A           Automotive profile, fixed grandmaster and slave\n"
+		"  -i <log2>    Initial log2 sync interval (default -3)\n"
+		"  -D <ns>      Link delay (default 500)\n"
+		"  -n <ns>      neighborPropDelayThresh, raise it along with the PDV\n"
+		"               (overrides -F)\n"
+		"  -j <ns>      PDV, uniform extra delay from 0 to <ns> (default 0)\n"
+		"  -q <ns>      PDV, exponential queueing delay of mean <ns> (default 0)\n"
+		"  -R <ns>      Timestamp resolution (default 8)\n"
+		"  -f <ppm>     Slave oscillator frequency offset (default -20)\n"
+		"  -g <ppm>     Grandmaster oscillator frequency offset (default 10),\n"
+		"               drawn again from +-<ppm> at every grandmaster change\n"
+		"  -c <sec>     Change the grandmaster time base every <sec> (default never)\n"
+		"  -p <ns>      Phase step at a grandmaster change, random within +-<ns>\n"
+		"               (default 1000000)\n"
+		"  -t <ns,ppb>  Offset and rate errors counted as converged (default 500,100)\n"
+		"  -L           Time how long OSLocks are held (adds clock reads per lock)\n"
+		"  -a           Asynchronous logging, keeps log output off the timed paths\n"
+		"  -s <seed>    Random seed (default 1)\n"
+		"  -T           Check the timers of two ports on one clock, then exit\n"
+		"Log output goes to stderr.\n", arg0 );
+}
+
+int main( int argc, char **argv )
+{
+	SimOptions &opt = sim.opt;
+	const char *ini_file = NULL;
+	const char *servo_name = NULL;
+	int64_t prop_delay_thresh = -1;
+	int c;
+
+	opt.seconds = 300;
+	opt.syntonize = false;
+	opt.automotive = false;
+	opt.log_sync_interval = -3;
+	opt.link_delay_ns = 500;
+	opt.pdv_uniform_ns = 0;
+	opt.pdv_queue_ns = 0;
+	opt.ts_resolution_ns = 8;
+	opt.slave_ppm = -20;
+	opt.gm_ppm = 10;
+	opt.gm_change_ns = 0;
+	opt.gm_step_ns = 1000000;
+	opt.conv_offset_ns = 500;
+	opt.conv_rate_ppb = 100;
+	opt.lock_timing = false;
+	opt.async_log = false;
+	opt.seed = 1;
+	opt.timer_check = false;
+
+	while(( c = getopt( argc, argv, "d:F:r:SAi:D:n:j:q:R:f:g:c:p:t:Las:Th" )) != -1 ) {
+		switch( c ) {
+		case 'd': opt.seconds = strtoul( optarg, NULL, 0 ); break;
+		case 'F': ini_file = optarg; break;
+		case 'r': servo_name = optarg; break;
+		case 'S': opt.syntonize = true; break;
+		case 'A': opt.automotive = true; break;
+		case 'i': opt.log_sync_interval = (signed char) atoi( optarg ); break;
+		case 'D': opt.link_delay_ns = strtoull( optarg, NULL, 0 ); break;
+		case 'n': prop_delay_thresh = strtoll( optarg, NULL, 0 ); break;
+		case 'j': opt.pdv_uniform_ns = strtoull( optarg, NULL, 0 ); break;
+		case 'q': opt.pdv_queue_ns = strtoull( optarg, NULL, 0 ); break;
+		case 'R': opt.ts_resolution_ns = strtoull( optarg, NULL, 0 ); break;
+		case 'f': opt.slave_ppm = strtold( optarg, NULL ); break;
+		case 'g': opt.gm_ppm = strtold( optarg, NULL ); break;
+		case 'c': opt.gm_change_ns = strtoull( optarg, NULL, 0 ) * NS_PER_SECOND; break;
+		case 'p': opt.gm_step_ns = strtoull( optarg, NULL, 0 ); break;
+		case 't':
+			if( sscanf( optarg, "%" SCNd64 ",%" SCNd64,
+				    &opt.conv_offset_ns, &opt.conv_rate_ppb ) != 2 ) {
+				simUsage( argv[0] );
+				return -1;
+			}
+			break;
+		case 'L': opt.lock_timing = true; break;
+		case 'a': opt.async_log = true; break;
+		case 's': opt.seed = strtoul( optarg, NULL, 0 ); break;
+		case 'T': opt.timer_check = true; break;
+		default:
+			simUsage( argv[0] );
+			return -1;
+		}
+	}
+	if( opt.seconds == 0 || opt.ts_resolution_ns == 0 ) {
+		simUsage( argv[0] );
+		return -1;
+	}
+	sim.rnd = opt.seed ? opt.seed : 1;
+
+	GPTP_LOG_REGISTER();
+	if( opt.async_log && !gptplogAsync( true ))
+		fprintf( stderr, "Asynchronous logging is not available\n" );
+
+	ServoConfig servo_config;
+	PortInit_t portInit;
+	phy_delay_map_t phy_delay;
+
+	memset( &portInit, 0, sizeof( portInit ));
+	portInit.automotive_profile = opt.automotive;
+	portInit.initialLogSyncInterval = opt.log_sync_interval;
+	portInit.initialLogPdelayReqInterval = LOG2_INTERVAL_INVALID;
+	portInit.operLogPdelayReqInterval = LOG2_INTERVAL_INVALID;
+	portInit.operLogSyncInterval = LOG2_INTERVAL_INVALID;
+	portInit.syncReceiptThreshold = CommonPort::DEFAULT_SYNC_RECEIPT_THRESH;
+	portInit.neighborPropDelayThreshold = CommonPort::NEIGHBOR_PROP_DELAY_THRESH;
+
+	if( ini_file != NULL ) {
+		GptpIniParser iniParser( ini_file );
+
+		if( iniParser.parserError() < 0 ) {
+			fprintf( stderr, "Can't parse %s\n", ini_file );
+			return -1;
+		}
+		servo_config = iniParser.getServoConfig();
+		portInit.neighborPropDelayThreshold =
+			iniParser.getNeighborPropDelayThresh();
+		portInit.syncReceiptThreshold = iniParser.getSyncReceiptThresh();
+	}
+	if( prop_delay_thresh >= 0 )
+		portInit.neighborPropDelayThreshold = prop_delay_thresh;
+	if( servo_name != NULL &&
+	    !RateServo::typeByName( servo_name, servo_config.type )) {
+		fprintf( stderr, "Unknown rate servo %s\n", servo_name );
+		return -1;
+	}
+	if( servo_name == NULL )
+		servo_name = servo_config.type == SERVO_LINREG ? "linreg" :
+			servo_config.type == SERVO_KALMAN ? "kalman" : "pi";
+
+	SimLockFactory lock_factory;
+	SimConditionFactory condition_factory;
+	SimThreadFactory thread_factory;
+	SimTimerFactory timer_factory;
+	SimTimerQueueFactory timerq_factory;
+	SimNetworkInterfaceFactory net_factory;
+	OSNetworkInterfaceFactory::registerFactory
+		( factory_name_t( "default" ), &net_factory );
+
+	portInit.condition_factory = &condition_factory;
+	portInit.thread_factory = &thread_factory;
+	portInit.timer_factory = &timer_factory;
+	portInit.lock_factory = &lock_factory;
+	portInit.phy_delay = &phy_delay;
+
+	if( opt.timer_check ) {
+		int ret = simTimerCheck( portInit, timerq_factory );
+		GPTP_LOG_UNREGISTER();
+		return ret;
+	}
+
+	SimNode nodes[SIM_NODES];
+	sim.now = SIM_START_NS;
+	for( unsigned i = 0; i < SIM_NODES; ++i ) {
+		SimNode *node = &nodes[i];
+		char name[8];
+		uint8_t mac[ETHER_ADDR_OCTETS] = { 0x02, 0x00, 0x5e, 0x00, 0x00, (uint8_t)( i + 1 ) };
+
+		memset( node->tx_valid, 0, sizeof( node->tx_valid ));
+		node->index = i;
+		memcpy( node->mac, mac, sizeof( mac ));
+		node->peer = &nodes[( i + 1 ) % SIM_NODES];
+		node->last_arrival = 0;
+		node->rx_ns = 0;
+		node->sync_rx_ns = 0;
+		// Unrelated clocks: seconds apart, different frequencies
+		node->osc.init( sim.now, (long double)( sim.now + i * 1234567891ULL ),
+				i == SIM_GM ? opt.gm_ppm : opt.slave_ppm );
+		node->system_offset = (int64_t) i * 987654321;
+
+		snprintf( name, sizeof( name ), "sim%u", i );
+		node->label = new InterfaceName( name, strlen( name ));
+		node->timestamper = new SimTimestamper( node );
+		node->ipc = new SimIPC( node );
+
+		// The grandmaster wins the BMCA
+		timerq_factory.node = node;
+		node->clock = new IEEE1588Clock
+			( false, opt.syntonize, i == SIM_GM ? 100 : 248,
+			  &timerq_factory, node->ipc, &lock_factory );
+		node->clock->setRateServo( servo_config );
+
+		portInit.clock = node->clock;
+		portInit.index = 1;
+		portInit.timestamper = node->timestamper;
+		portInit.net_label = node->label;
+		portInit.isGM = i == SIM_GM;
+		node->port = new EtherPort( &portInit );
+		if( !node->port->init_port() ) {
+			fprintf( stderr, "Failed to initialize node %u\n", i );
+			return -1;
+		}
+		node->port->setLinkSpeed( LINKSPEED_1G );
+		// Announces are only sent once asCapable, and the first one is
+		// due before the first PDelay exchange ends. Start asCapable as
+		// a daemon restoring its saved state does, so the BMCA runs.
+		if( opt.automotive )
+			node->port->setPortState( i == SIM_GM ? PTP_MASTER : PTP_SLAVE );
+		else
+			node->port->setAsCapable( true );
+	}
+
+	sim.epochs.push_back( sim.now );
+	sim.converged.push_back( -1 );
+	sim.good_syncs = 0;
+
+	for( unsigned i = 0; i < SIM_NODES; ++i )
+		nodes[i].port->processEvent( POWERUP );
+
+	if( opt.gm_change_ns ) {
+		SimEvent ev;
+		ev.kind = SimEvent::GM_CHANGE;
+		ev.node = &nodes[SIM_GM];
+		ev.timerq = NULL;
+		ev.arg = NULL;
+		ev.length = 0;
+		sim.events.insert( std::make_pair( sim.now + opt.gm_change_ns, ev ));
+	}
+
+	uint64_t end = sim.now + (uint64_t) opt.seconds * NS_PER_SECOND;
+	uint64_t wall_start = simWallNow();
+
+	while( !sim.events.empty() && sim.events.begin()->first < end ) {
+		SimEvent ev = sim.events.begin()->second;
+		sim.now = sim.events.begin()->first;
+		sim.events.erase( sim.events.begin() );
+
+		switch( ev.kind ) {
+		case SimEvent::TIMER:
+			simTimer( ev );
+			break;
+		case SimEvent::FRAME:
+			simReceive( ev );
+			break;
+		case SimEvent::GM_CHANGE:
+			simGmChange( ev.node );
+			break;
+		}
+	}
+
+	simReport( servo_name, &nodes[SIM_SLAVE], simWallNow() - wall_start );
+
+	GPTP_LOG_UNREGISTER();
+	return 0;
+}
@@ -43,6 +43,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "linux_ipc.hpp"
 
@@ -71,9 +78,631 @@ static inline uint64_t getCpuFrequency(void)
     return freq;
 }
 
-int main(int argc, char *argv[])
+/*
+ * Clock read contention benchmark
+ *
+ * Reader threads (or processes with -p) read gPTP time the way clients do,
+ * at a fixed rate or back to back, while gptp publishes updates. Either the
+ * running daemon's segment is used, or with -s a private segment and a
+ * writer thread that publishes like the daemon does: legacy copy and
+ * seqlock block under the shared mutex, then the update counter, plus the
+ * system model.
+ *
+ * Read methods, each ending in a gPTP time computed from CLOCK_REALTIME:
+ *   mutex    lock the shared mutex and copy the legacy data
+ *   seqlock  lock free copy of the seqlock block (gptpgetdata)
+ *   cached   refresh a private copy only when update_count moved
+ *   model    seqlock read of the system model
+ *
+ * Reported are the read latency percentiles, seqlock retries, stale reads
+ * (data superseded by a new publish before the read returned) and writer
+ * stall: how long the simulated writer waited for the mutex, and how long
+ * mutex readers held it, which is what the daemon would wait.
+ */
+
+#define BENCH_SHM_NAME      "/ptp_shm_test"
+#define BENCH_MAX_READERS   256
+#define NS_PER_SECOND       1000000000ULL
+
+enum ReadMethod { READ_MUTEX, READ_SEQLOCK, READ_CACHED, READ_MODEL };
+
+static const char *methodNames[] = { "mutex", "seqlock", "cached", "model" };
+
+/* Log-linear histogram, 32 buckets per power of two (about 3% resolution) */
+#define HIST_SUB_BITS   5
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS    ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+struct Histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t bucket[HIST_BUCKETS];
+};
+
+static inline unsigned histIndex(uint64_t v)
+{
+    if (v < HIST_SUB)
+        return (unsigned)v;
+    unsigned e = 63 - __builtin_clzll(v);
+    return (e - HIST_SUB_BITS + 1) * HIST_SUB +
+        (unsigned)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* Middle of the bucket */
+static uint64_t histValue(unsigned index)
+{
+    if (index < HIST_SUB)
+        return index;
+    unsigned e = index / HIST_SUB + HIST_SUB_BITS - 1;
+    uint64_t low = (uint64_t)(HIST_SUB + index % HIST_SUB) << (e - HIST_SUB_BITS);
+    return low + ((1ULL << (e - HIST_SUB_BITS)) >> 1);
+}
+
+static inline void histAdd(Histogram *h, uint64_t v)
+{
+    h->count++;
+    h->sum += v;
+    if (v > h->max)
+        h->max = v;
+    h->bucket[histIndex(v)]++;
+}
+
+static void histMerge(Histogram *to, const Histogram *from)
+{
+    to->count += from->count;
+    to->sum += from->sum;
+    if (from->max > to->max)
+        to->max = from->max;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++)
+        to->bucket[i] += from->bucket[i];
+}
+
+/* pct in tenths of a percent */
+static uint64_t histPercentile(const Histogram *h, unsigned pct)
+{
+    uint64_t rank, seen = 0;
+
+    if (h->count == 0)
+        return 0;
+    rank = (h->count - 1) * pct / 1000;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->bucket[i];
+        if (seen > rank)
+            return histValue(i) < h->max ? histValue(i) : h->max;
+    }
+    return h->max;
+}
+
+static void histPrint(const char *name, const Histogram *h)
+{
+    if (h->count == 0) {
+        fprintf(stdout, "%-16s no samples\n", name);
+        return;
+    }
+    fprintf(stdout, "%-16s mean %6llu  p50 %6llu  p90 %6llu  p99 %6llu  "
+            "p99.9 %7llu  max %8llu ns\n", name,
+            (unsigned long long)(h->sum / h->count),
+            (unsigned long long)histPercentile(h, 500),
+            (unsigned long long)histPercentile(h, 900),
+            (unsigned long long)histPercentile(h, 990),
+            (unsigned long long)histPercentile(h, 999),
+            (unsigned long long)h->max);
+}
+
+/* Per reader results, in shared memory so reader processes can fill them */
+struct ReaderStats {
+    uint64_t reads;
+    uint64_t failed;
+    uint64_t retries;       /* Seqlock copies redone */
+    uint64_t stale;
+    uint64_t refreshes;     /* Cached: private copy updated */
+    uint64_t late;          /* Paced: read started a period or more late */
+    Histogram latency;
+    Histogram hold;         /* Mutex: time the shared mutex was held */
+};
+
+struct BenchShared {
+    volatile int go;
+    volatile int stop;
+    ReaderStats reader[BENCH_MAX_READERS];
+};
+
+struct BenchOptions {
+    ReadMethod method;
+    unsigned readers;
+    bool processes;
+    unsigned rate;          /* Reads per second per reader, 0 back to back */
+    unsigned seconds;
+    unsigned writer_rate;   /* Simulated updates per second, 0 live daemon */
+};
+
+struct WriterStats {
+    uint64_t updates;
+    Histogram lock_wait;    /* Waiting for the shared mutex */
+    Histogram publish;      /* Mutex held to write both copies */
+};
+
+static char *benchMap;
+static BenchShared *benchShared;
+static BenchOptions benchOpt;
+static WriterStats writerStats;
+
+static inline uint64_t monoNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+
+static inline uint64_t realNow(void)
 {
-    int shm_fd = shm_open(SHM_NAME, O_RDONLY, 0666);
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+
+static inline void sleepUntil(uint64_t when)
+{
+    struct timespec ts;
+    ts.tv_sec = when / NS_PER_SECOND;
+    ts.tv_nsec = when % NS_PER_SECOND;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static inline gPtpTimeData *legacyData(void)
+{
+    return (gPtpTimeData *)(benchMap + sizeof(pthread_mutex_t));
+}
+
+static inline gPtpSeqlockData *seqlockData(void)
+{
+    gPtpSeqlockData *sl = (gPtpSeqlockData *)(benchMap + GPTP_SHM_SEQLOCK_OFFSET);
+    return __atomic_load_n(&sl->magic, __ATOMIC_ACQUIRE) == GPTP_SHM_SEQLOCK_MAGIC ?
+        sl : NULL;
+}
+
+static inline gPtpSysModel *modelData(void)
+{
+    gPtpSysModel *m = (gPtpSysModel *)(benchMap + GPTP_SHM_MODEL_OFFSET);
+    return __atomic_load_n(&m->magic, __ATOMIC_ACQUIRE) == GPTP_SHM_MODEL_MAGIC ?
+        m : NULL;
+}
+
+static inline gPtpNotify *notifyData(void)
+{
+    gPtpNotify *n = (gPtpNotify *)(benchMap + GPTP_SHM_NOTIFY_OFFSET);
+    return __atomic_load_n(&n->magic, __ATOMIC_ACQUIRE) == GPTP_SHM_NOTIFY_MAGIC ?
+        n : NULL;
+}
+
+/* Same protocol as gptpgetdata(), counting the copies that had to be redone */
+template <typename T>
+static inline uint32_t seqlockRead(const uint32_t *pseq, const T *src, T *dst,
+                                   ReaderStats *st)
+{
+    uint32_t seq;
+
+    for (;;) {
+        seq = __atomic_load_n(pseq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            st->retries++;
+            sched_yield();
+            continue;
+        }
+        memcpy(dst, src, sizeof(*dst));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(pseq, __ATOMIC_RELAXED) == seq)
+            return seq;
+        st->retries++;
+    }
+}
+
+/* gPTP time from the last sync, as x_getPTPTime() extrapolates it */
+static inline uint64_t ptpFromSync(const gPtpTimeData *td)
+{
+    int64_t delta_system = realNow() - (td->local_time + td->ls_phoffset);
+    int64_t delta_local = td->ls_freqoffset * delta_system;
+    int64_t delta_8021as = td->ml_freqoffset * delta_local;
+    return td->local_time - td->ml_phoffset + delta_8021as;
+}
+
+struct ReadCache {
+    bool valid;
+    uint32_t count;
+    int64_t base_sys;
+    int64_t base_ptp;
+    double rate_adj;
+};
+
+/*
+ * One clock read. Returns false if no time is available, and in gen and
+ * cur what the data came from and what is published once the time is
+ * computed; they differ for a stale read.
+ */
+static inline bool readClock(ReaderStats *st, ReadCache *cache, uint64_t *ptp,
+                             uint32_t *gen, uint32_t *cur)
+{
+    gPtpSeqlockData *sl = seqlockData();
+
+    switch (benchOpt.method) {
+    case READ_MUTEX: {
+        gPtpTimeData td;
+        pthread_mutex_lock((pthread_mutex_t *)benchMap);
+        uint64_t locked = monoNow();
+        memcpy(&td, legacyData(), sizeof(td));
+        /* stable while the mutex is held, both copies are written under it */
+        *gen = sl != NULL ? sl->seq : td.sync_count;
+        uint64_t unlocked = monoNow();
+        pthread_mutex_unlock((pthread_mutex_t *)benchMap);
+        histAdd(&st->hold, unlocked - locked);
+        *ptp = ptpFromSync(&td);
+        *cur = sl != NULL ? __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE) :
+            __atomic_load_n(&legacyData()->sync_count, __ATOMIC_RELAXED);
+        return true;
+    }
+    case READ_SEQLOCK: {
+        gPtpTimeData td;
+        *gen = seqlockRead(&sl->seq, &sl->data, &td, st);
+        *ptp = ptpFromSync(&td);
+        *cur = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE);
+        return true;
+    }
+    case READ_CACHED: {
+        gPtpNotify *n = notifyData();
+        uint32_t count = __atomic_load_n(&n->update_count, __ATOMIC_ACQUIRE);
+        if (!cache->valid || count != cache->count) {
+            gPtpTimeData td;
+            seqlockRead(&sl->seq, &sl->data, &td, st);
+            cache->count = count;
+            cache->base_sys = td.local_time + td.ls_phoffset;
+            cache->base_ptp = td.local_time - td.ml_phoffset;
+            cache->rate_adj = (double)(td.ml_freqoffset * td.ls_freqoffset - 1.0L);
+            cache->valid = true;
+            st->refreshes++;
+        }
+        int64_t delta = realNow() - cache->base_sys;
+        *ptp = cache->base_ptp + delta + (int64_t)(delta * cache->rate_adj);
+        *gen = cache->count;
+        *cur = __atomic_load_n(&n->update_count, __ATOMIC_ACQUIRE);
+        return true;
+    }
+    case READ_MODEL: {
+        gPtpSysModel *m = modelData();
+        gPtpSysModel model;
+        *gen = seqlockRead(&m->seq, m, &model, st);
+        if (!model.valid)
+            return false;
+        int64_t delta = realNow() - model.sys_base;
+        *ptp = model.ptp_base + delta + (int64_t)(delta * (double)(model.rate - 1.0L));
+        *cur = __atomic_load_n(&m->seq, __ATOMIC_ACQUIRE);
+        return true;
+    }
+    }
+    return false;
+}
+
+static void readerRun(ReaderStats *st)
+{
+    ReadCache cache;
+    uint64_t period = benchOpt.rate ? NS_PER_SECOND / benchOpt.rate : 0;
+    uint64_t next, start, end;
+    volatile uint64_t sink = 0;
+
+    memset(&cache, 0, sizeof(cache));
+    while (!benchShared->go)
+        sched_yield();
+
+    next = monoNow();
+    while (!benchShared->stop) {
+        uint64_t ptp;
+        uint32_t gen, cur;
+
+        if (period) {
+            next += period;
+            sleepUntil(next);
+        }
+        start = monoNow();
+        if (period && start >= next + period) {
+            /* behind: count it and resume the pace from here */
+            st->late++;
+            next = start;
+        }
+        bool ok = readClock(st, &cache, &ptp, &gen, &cur);
+        end = monoNow();
+
+        histAdd(&st->latency, end - start);
+        st->reads++;
+        if (!ok) {
+            st->failed++;
+            continue;
+        }
+        if (gen != cur)
+            st->stale++;
+        sink += ptp;
+    }
+    (void)sink;
+}
+
+static void *readerThread(void *arg)
+{
+    readerRun((ReaderStats *)arg);
+    return NULL;
+}
+
+/* Publishes like LinuxSharedMemoryIPC::update() and the system model refresh */
+static void *writerThread(void *arg)
+{
+    gPtpSeqlockData *sl = seqlockData();
+    gPtpSysModel *model = modelData();
+    gPtpNotify *notify = notifyData();
+    uint64_t period = NS_PER_SECOND / benchOpt.writer_rate;
+    uint64_t next = monoNow();
+
+    while (!benchShared->stop) {
+        uint64_t now = realNow();
+        uint64_t t0 = monoNow();
+        pthread_mutex_lock((pthread_mutex_t *)benchMap);
+        uint64_t t1 = monoNow();
+
+        gPtpTimeData *td = legacyData();
+        td->ml_phoffset = -37000000000LL;
+        td->ls_phoffset = 0;
+        td->ml_freqoffset = 1.0L;
+        td->ls_freqoffset = 1.0L;
+        td->local_time = now;
+        td->sync_count++;
+        td->asCapable = true;
+        td->port_state = PTP_SLAVE;
+        td->process_id = getpid();
+
+        uint32_t seq = __atomic_load_n(&sl->seq, __ATOMIC_RELAXED);
+        __atomic_store_n(&sl->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(&sl->data, td, sizeof(sl->data));
+        __atomic_store_n(&sl->seq, seq + 2, __ATOMIC_RELEASE);
+
+        uint64_t t2 = monoNow();
+        pthread_mutex_unlock((pthread_mutex_t *)benchMap);
+
+        __atomic_add_fetch(&notify->update_count, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&notify->waiters, __ATOMIC_SEQ_CST) != 0)
+            syscall(SYS_futex, &notify->update_count, FUTEX_WAKE, INT_MAX,
+                    NULL, NULL, 0);
+
+        seq = __atomic_load_n(&model->seq, __ATOMIC_RELAXED);
+        __atomic_store_n(&model->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        model->sys_base = now;
+        model->ptp_base = now + 37000000000LL;
+        model->rate = 1.0L;
+        model->valid = 1;
+        __atomic_store_n(&model->seq, seq + 2, __ATOMIC_RELEASE);
+
+        histAdd(&writerStats.lock_wait, t1 - t0);
+        histAdd(&writerStats.publish, t2 - t1);
+        writerStats.updates++;
+
+        next += period;
+        sleepUntil(next);
+    }
+    return arg;
+}
+
+/* Lays the segment out like LinuxSharedMemoryIPC::init() */
+static bool simInit(int shm_fd)
+{
+    pthread_mutexattr_t shared;
+
+    if (ftruncate(shm_fd, SHM_SIZE) == -1) {
+        fprintf(stderr, "ftruncate(). %s\n", strerror(errno));
+        return false;
+    }
+    benchMap = (char *)mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, shm_fd, 0);
+    if (benchMap == MAP_FAILED) {
+        fprintf(stderr, "Error on mmap. %s\n", strerror(errno));
+        return false;
+    }
+    memset(benchMap, 0, SHM_SIZE);
+    pthread_mutexattr_init(&shared);
+    pthread_mutexattr_setpshared(&shared, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init((pthread_mutex_t *)benchMap, &shared);
+    pthread_mutexattr_destroy(&shared);
+
+    gPtpSeqlockData *sl = (gPtpSeqlockData *)(benchMap + GPTP_SHM_SEQLOCK_OFFSET);
+    sl->version = GPTP_SHM_SEQLOCK_VERSION;
+    sl->data_size = sizeof(gPtpTimeData);
+    __atomic_store_n(&sl->magic, GPTP_SHM_SEQLOCK_MAGIC, __ATOMIC_RELEASE);
+
+    gPtpSysModel *model = (gPtpSysModel *)(benchMap + GPTP_SHM_MODEL_OFFSET);
+    model->version = GPTP_SHM_MODEL_VERSION;
+    model->interval_us = 1000000 / benchOpt.writer_rate;
+    __atomic_store_n(&model->magic, GPTP_SHM_MODEL_MAGIC, __ATOMIC_RELEASE);
+
+    gPtpNotify *notify = (gPtpNotify *)(benchMap + GPTP_SHM_NOTIFY_OFFSET);
+    notify->version = GPTP_SHM_NOTIFY_VERSION;
+    __atomic_store_n(&notify->magic, GPTP_SHM_NOTIFY_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool liveInit(int shm_fd, bool writable)
+{
+    benchMap = (char *)mmap(NULL, SHM_SIZE,
+                            writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                            MAP_SHARED, shm_fd, 0);
+    if (benchMap == MAP_FAILED) {
+        fprintf(stderr, "Error on mmap. %s\n", strerror(errno));
+        return false;
+    }
+    if (benchOpt.method != READ_MUTEX && seqlockData() == NULL) {
+        fprintf(stderr, "No seqlock block, gptp is too old for %s reads\n",
+                methodNames[benchOpt.method]);
+        return false;
+    }
+    if (benchOpt.method == READ_CACHED && notifyData() == NULL) {
+        fprintf(stderr, "No update counter, gptp is too old for cached reads\n");
+        return false;
+    }
+    if (benchOpt.method == READ_MODEL && modelData() == NULL) {
+        fprintf(stderr, "No system model, gptp is too old for model reads\n");
+        return false;
+    }
+    return true;
+}
+
+static int runBench(const char *shm_name, bool named)
+{
+    const char *name = benchOpt.writer_rate && !named ? BENCH_SHM_NAME : shm_name;
+    pthread_t threads[BENCH_MAX_READERS];
+    pid_t pids[BENCH_MAX_READERS];
+    pthread_t writer;
+    uint32_t updates0 = 0;
+    int shm_fd, ret = 0;
+    unsigned i;
+
+    if (benchOpt.writer_rate) {
+        shm_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (shm_fd < 0) {
+            fprintf(stderr, "shm_open(%s). %s\n", name, strerror(errno));
+            return -1;
+        }
+        if (!simInit(shm_fd)) {
+            shm_unlink(name);
+            return -1;
+        }
+    } else {
+        /* locking the mutex needs write access to the segment */
+        bool writable = benchOpt.method == READ_MUTEX;
+        shm_fd = shm_open(name, writable ? O_RDWR : O_RDONLY, 0666);
+        if (shm_fd < 0) {
+            fprintf(stderr, "shm_open(%s). %s\n", name, strerror(errno));
+            return -1;
+        }
+        if (!liveInit(shm_fd, writable))
+            return -1;
+    }
+
+    benchShared = (BenchShared *)mmap(NULL, sizeof(BenchShared),
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (benchShared == MAP_FAILED) {
+        fprintf(stderr, "Error on mmap. %s\n", strerror(errno));
+        ret = -1;
+        goto out;
+    }
+
+    fprintf(stdout, "%u %s %s reading %s, %s, %s for %u s\n",
+            benchOpt.readers, benchOpt.processes ? "processes" : "threads",
+            methodNames[benchOpt.method], name,
+            benchOpt.writer_rate ? "simulated writer" : "live daemon",
+            benchOpt.rate ? "paced" : "back to back", benchOpt.seconds);
+
+    /* readers wait for go, fork before any thread exists */
+    for (i = 0; i < benchOpt.readers; i++) {
+        ReaderStats *st = &benchShared->reader[i];
+        if (benchOpt.processes) {
+            pids[i] = fork();
+            if (pids[i] == 0) {
+                readerRun(st);
+                _exit(0);
+            }
+            if (pids[i] < 0) {
+                fprintf(stderr, "fork(). %s\n", strerror(errno));
+                break;
+            }
+        } else if (pthread_create(&threads[i], NULL, readerThread, st) != 0) {
+            fprintf(stderr, "pthread_create() failed\n");
+            break;
+        }
+    }
+    benchOpt.readers = i;
+    if (benchOpt.writer_rate &&
+        pthread_create(&writer, NULL, writerThread, NULL) != 0) {
+        fprintf(stderr, "pthread_create() failed\n");
+        benchOpt.writer_rate = 0;
+        ret = -1;
+    }
+
+    /* readers start once the simulated writer has published */
+    while (benchOpt.writer_rate && notifyData()->update_count == 0)
+        sched_yield();
+    if (notifyData() != NULL)
+        updates0 = __atomic_load_n(&notifyData()->update_count, __ATOMIC_ACQUIRE);
+    benchShared->go = 1;
+    sleep(benchOpt.seconds);
+    benchShared->stop = 1;
+
+    for (i = 0; i < benchOpt.readers; i++) {
+        if (benchOpt.processes)
+            waitpid(pids[i], NULL, 0);
+        else
+            pthread_join(threads[i], NULL);
+    }
+    if (benchOpt.writer_rate)
+        pthread_join(writer, NULL);
+
+    if (ret == 0) {
+        static Histogram latency, hold;
+        ReaderStats total;
+
+        memset(&total, 0, sizeof(total));
+        for (i = 0; i < benchOpt.readers; i++) {
+            ReaderStats *st = &benchShared->reader[i];
+            total.reads += st->reads;
+            total.failed += st->failed;
+            total.retries += st->retries;
+            total.stale += st->stale;
+            total.refreshes += st->refreshes;
+            total.late += st->late;
+            histMerge(&latency, &st->latency);
+            histMerge(&hold, &st->hold);
+        }
+        uint64_t reads = total.reads ? total.reads : 1;
+
+        fprintf(stdout, "--------------------------------------------\n");
+        fprintf(stdout, "reads %llu (%.0f/s), failed %llu\n",
+                (unsigned long long)total.reads,
+                (double)total.reads / benchOpt.seconds,
+                (unsigned long long)total.failed);
+        histPrint("read latency", &latency);
+        if (benchOpt.method != READ_MUTEX)
+            fprintf(stdout, "seqlock retries %llu (%.4f%%)\n",
+                    (unsigned long long)total.retries, 100.0 * total.retries / reads);
+        fprintf(stdout, "stale reads %llu (%.4f%%)\n",
+                (unsigned long long)total.stale, 100.0 * total.stale / reads);
+        if (benchOpt.method == READ_CACHED)
+            fprintf(stdout, "cache refreshes %llu\n",
+                    (unsigned long long)total.refreshes);
+        if (benchOpt.rate)
+            fprintf(stdout, "late reads %llu\n", (unsigned long long)total.late);
+        if (benchOpt.method == READ_MUTEX)
+            histPrint("mutex hold", &hold);
+        if (benchOpt.writer_rate) {
+            fprintf(stdout, "writer updates %llu\n",
+                    (unsigned long long)writerStats.updates);
+            histPrint("writer stall", &writerStats.lock_wait);
+            histPrint("writer publish", &writerStats.publish);
+            fprintf(stdout, "writer stall total %llu ns\n",
+                    (unsigned long long)writerStats.lock_wait.sum);
+        } else if (notifyData() != NULL) {
+            fprintf(stdout, "daemon updates %u\n",
+                    __atomic_load_n(&notifyData()->update_count, __ATOMIC_ACQUIRE) - updates0);
+        }
+    }
+    munmap(benchShared, sizeof(BenchShared));
+out:
+    munmap(benchMap, SHM_SIZE);
+    close(shm_fd);
+    if (benchOpt.writer_rate)
+        shm_unlink(name);
+    return ret;
+}
+
+static int dumpShm(const char *shm_name)
+{
+    int shm_fd = shm_open(shm_name, O_RDONLY, 0666);
 
     if( shm_fd < 0) {
         fprintf(stderr, "shm_open(). %s\n", strerror(errno));
@@ -128,6 +757,81 @@ int main(int argc, char *argv[])
     fprintf(stdout, "Port State %d\n", (int)ptpData->port_state);
     fprintf(stdout, "process_id %d\n\n", (int)ptpData->process_id);
 
+    gPtpNotify *notify = (gPtpNotify*)(addr+GPTP_SHM_NOTIFY_OFFSET);
+    if (notify->magic == GPTP_SHM_NOTIFY_MAGIC) {
+        fprintf(stdout, "update count %u\n", notify->update_count);
+        fprintf(stdout, "grandmaster changes %u\n\n", notify->gm_count);
+    }
+
     return 0;
 }
 
+
+static void usage(const char *arg0)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "Prints the gPTP shared memory contents, or with -b measures clock reads.\n"
+            "  -N <name>    Shared memory name (default " SHM_NAME ")\n"
+            "  -b           Run the clock read benchmark\n"
+            "  -m <method>  mutex, seqlock, cached or model (default seqlock)\n"
+            "  -n <count>   Readers (default 4, at most %d)\n"
+            "  -p           Readers are processes instead of threads\n"
+            "  -r <rate>    Reads per second per reader, 0 back to back (default 0)\n"
+            "  -d <secs>    Duration (default 10)\n"
+            "  -s <rate>    Simulate gptp publishing <rate> updates per second in a\n"
+            "               private segment (" BENCH_SHM_NAME " unless -N is given)\n"
+            "               instead of reading the running daemon\n",
+            arg0, BENCH_MAX_READERS);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *shm_name = SHM_NAME;
+    bool named = false;
+    bool bench = false;
+    int c;
+
+    benchOpt.method = READ_SEQLOCK;
+    benchOpt.readers = 4;
+    benchOpt.processes = false;
+    benchOpt.rate = 0;
+    benchOpt.seconds = 10;
+    benchOpt.writer_rate = 0;
+
+    while ((c = getopt(argc, argv, "N:bm:n:pr:d:s:h")) != -1) {
+        switch (c) {
+        case 'N': shm_name = optarg; named = true; break;
+        case 'b': bench = true; break;
+        case 'm':
+            for (c = 0; c <= READ_MODEL; c++) {
+                if (strcmp(optarg, methodNames[c]) == 0)
+                    break;
+            }
+            if (c > READ_MODEL) {
+                usage(argv[0]);
+                return -1;
+            }
+            benchOpt.method = (ReadMethod)c;
+            break;
+        case 'n': benchOpt.readers = strtoul(optarg, NULL, 0); break;
+        case 'p': benchOpt.processes = true; break;
+        case 'r': benchOpt.rate = strtoul(optarg, NULL, 0); break;
+        case 'd': benchOpt.seconds = strtoul(optarg, NULL, 0); break;
+        case 's': benchOpt.writer_rate = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (!bench)
+        return dumpShm(shm_name);
+
+    if (benchOpt.readers == 0 || benchOpt.readers > BENCH_MAX_READERS ||
+        benchOpt.seconds == 0 || benchOpt.rate > NS_PER_SECOND ||
+        benchOpt.writer_rate > NS_PER_SECOND) {
+        usage(argv[0]);
+        return -1;
+    }
+    return runBench(shm_name, named);
+}
@@ -37,6 +37,7 @@
 #include "avbts_oslock.hpp"
 #include "avbts_persist.hpp"
 #include "gptp_cfg.hpp"
+#include "gptp_domain.hpp"
 
 #ifdef ARCH_INTELCE
 #include "linux_hal_intelce.hpp"
@@ -45,6 +46,7 @@
 #endif
 
 #include "linux_hal_persist_file.hpp"
+#include "linux_ipc.hpp"
 #include <ctype.h>
 #include <inttypes.h>
 #include <signal.h>
@@ -69,20 +71,26 @@ void gPTPPersistWriteCB(char *bufPtr, uint32_t bufSize);
 
 void print_usage( char *arg0 ) {
 	fprintf( stderr,
-			"%s <network interface> [-S] [-P] [-M <filename>] "
-			"[-G <group>] [-R <priority 1>] "
+			"%s <network interface[,network interface...]> [-S] [-P] [-M <filename>] [-W] "
+			"[-G <group>] [-SHM <name>] [-DOMAIN <n[,n...]>] [-R <priority 1>] "
 			"[-D <gb_tx_delay,gb_rx_delay,mb_tx_delay,mb_rx_delay>] "
 			"[-T] [-L] [-E] [-GM] [-INITSYNC <value>] [-OPERSYNC <value>] "
-			"[-INITPDELAY <value>] [-OPERPDELAY <value>] "
+			"[-INITPDELAY <value>] [-OPERPDELAY <value>] [-SYSMODEL <us>] [-A] "
 			"[-F <path to gptp_cfg.ini file>] "
 			"\n",
 			arg0 );
 	fprintf
 		( stderr,
+		  "\tMore than one interface runs the daemon as a time-aware relay\n"
 		  "\t-S start syntonization\n"
 		  "\t-P pulse per second\n"
 		  "\t-M <filename> save/restore state\n"
+		  "\t-W fast lock: resume syntonization from restored state (with -M)\n"
 		  "\t-G <group> group id for shared memory\n"
+		  "\t-SHM <name> shared memory name (default /ptp), e.g. /ptp_eth1\n"
+		  "\t     for one daemon per network in a multi-interface host\n"
+		  "\t-DOMAIN <n[,n...]> also follow these gPTP domains on the first\n"
+		  "\t     interface and publish them in the same shared memory\n"
 		  "\t-R <priority 1> priority 1 value\n"
 		  "\t-D Phy Delay <gb_tx_delay,gb_rx_delay,mb_tx_delay,mb_rx_delay>\n"
 		  "\t-T force master (ignored when Automotive Profile set)\n"
@@ -94,6 +102,8 @@ void print_usage( char *arg0 ) {
 		  "\t-OPERSYNC <value> operational sync interval (Log base 2. 0 = 1 second)\n"
 		  "\t-INITPDELAY <value> initial pdelay interval (Log base 2. 0 = 1 second)\n"
 		  "\t-OPERPDELAY <value> operational pdelay interval (Log base 2. 0 = 1 sec)\n"
+		  "\t-SYSMODEL <us> system to gPTP time model update period (0 = off)\n"
+		  "\t-A log asynchronously from a dedicated writer thread\n"
 		  "\t-F <path-to-ini-file>\n"
 		);
 }
@@ -125,19 +135,24 @@ int watchdog_setup(OSThreadFactory *thread_factory)
 }
 
 static IEEE1588Clock *pClock = NULL;
-static EtherPort *pPort = NULL;
+static EtherPort *pPorts[MAX_PORTS];
+static int nPorts = 0;
 
 int main(int argc, char **argv)
 {
 	PortInit_t portInit;
 
 	sigset_t set;
-	InterfaceName *ifname;
+	InterfaceName *ifnames[MAX_PORTS];
+	int nIfnames = 0;
 	int sig;
 
 	bool syntonize = false;
 	int i;
 	bool pps = false;
+	bool fast_lock = false;
+	unsigned sysmodel_interval = SYSTEM_MODEL_INTERVAL_US;
+	bool async_log = false;
 	uint8_t priority1 = 248;
 	bool override_portstate = false;
 	PortState port_state = PTP_SLAVE;
@@ -147,6 +162,10 @@ int main(int argc, char **argv)
 	off_t restoredatacount = 0;
 	bool restorefailed = false;
 	LinuxIPCArg *ipc_arg = NULL;
+	const char *ipc_group_name = NULL;
+	const char *ipc_shm_name = NULL;
+	uint8_t domains[GPTP_SHM_MAX_DOMAINS - 1];
+	int nDomains = 0;
 	bool use_config_file = false;
 	char config_file_path[512];
 	memset(config_file_path, 0, 512);
@@ -194,6 +213,7 @@ int main(int argc, char **argv)
 		CommonPort::DEFAULT_SYNC_RECEIPT_THRESH;
 	portInit.neighborPropDelayThreshold =
 		CommonPort::NEIGHBOR_PROP_DELAY_THRESH;
+	portInit.linkFlapWindow = 0;
 
 	LinuxNetworkInterfaceFactory *default_factory =
 		new LinuxNetworkInterfaceFactory;
@@ -210,7 +230,30 @@ int main(int argc, char **argv)
 		print_usage( argv[0] );
 		return -1;
 	}
-	ifname = new InterfaceName( argv[1], strlen(argv[1]) );
+	/* A comma separated list of interfaces makes this a relay */
+	size_t argv1_len = strlen( argv[1] );
+	for( char *ifstart = argv[1]; ifstart < argv[1] + argv1_len; ) {
+		size_t iflen = strcspn( ifstart, "," );
+
+		if( ifstart[iflen] == ',' )
+			ifstart[iflen] = '\0';
+		if( iflen > 0 ) {
+			if( nIfnames >= MAX_PORTS - 1 ) {
+				printf( "Too many interfaces\n" );
+				print_usage( argv[0] );
+				return -1;
+			}
+			ifnames[nIfnames++] = new InterfaceName( ifstart, iflen );
+		}
+		ifstart += iflen;
+		if( ifstart < argv[1] + argv1_len )
+			++ifstart;
+	}
+	if( nIfnames == 0 ) {
+		printf( "Interface name required\n" );
+		print_usage( argv[0] );
+		return -1;
+	}
 
 	/* Process optional arguments */
 	for( i = 2; i < argc; ++i ) {
@@ -220,6 +263,10 @@ int main(int argc, char **argv)
 				// Get syntonize directive from command line
 				syntonize = true;
 			}
+			else if( strcmp(argv[i] + 1,  "W" ) == 0 ) {
+				// Use restored state immediately on restart
+				fast_lock = true;
+			}
 			else if( strcmp(argv[i] + 1,  "T" ) == 0 ) {
 				override_portstate = true;
 				port_state = PTP_MASTER;
@@ -243,11 +290,38 @@ int main(int argc, char **argv)
 			}
 			else if( strcmp(argv[i] + 1,  "G") == 0 ) {
 				if( i+1 < argc ) {
-					ipc_arg = new LinuxIPCArg(argv[++i]);
+					ipc_group_name = argv[++i];
 				} else {
 					printf( "Must specify group name on the command line\n" );
 				}
 			}
+			else if( strcmp(argv[i] + 1,  "SHM") == 0 ) {
+				if( i+1 < argc ) {
+					ipc_shm_name = argv[++i];
+				} else {
+					printf( "Must specify shared memory name on the command line\n" );
+				}
+			}
+			else if( strcmp(argv[i] + 1,  "DOMAIN") == 0 ) {
+				if( i+1 < argc ) {
+					char *cli_domains = argv[++i];
+					char *domain_tok = strtok( cli_domains, "," );
+					while( domain_tok != NULL ) {
+						int domain = atoi( domain_tok );
+						if( domain <= 0 || domain > 127 ) {
+							printf( "Invalid domain %s, the clock uses domain 0\n", domain_tok );
+						} else if( nDomains >= GPTP_SHM_MAX_DOMAINS - 1 ) {
+							printf( "Too many domains\n" );
+							break;
+						} else {
+							domains[nDomains++] = (uint8_t) domain;
+						}
+						domain_tok = strtok( NULL, "," );
+					}
+				} else {
+					printf( "Must specify domain numbers on the command line\n" );
+				}
+			}
 			else if( strcmp(argv[i] + 1,  "P") == 0 ) {
 				pps = true;
 			}
@@ -321,6 +395,12 @@ int main(int argc, char **argv)
 			else if (strcmp(argv[i] + 1, "OPERPDELAY") == 0) {
 				portInit.operLogPdelayReqInterval = atoi(argv[++i]);
 			}
+			else if (strcmp(argv[i] + 1, "SYSMODEL") == 0) {
+				sysmodel_interval = atoi(argv[++i]);
+			}
+			else if (strcmp(argv[i] + 1, "A") == 0) {
+				async_log = true;
+			}
 			else if (strcmp(argv[i] + 1, "F") == 0)
 			{
 				if( i+1 < argc ) {
@@ -342,6 +422,8 @@ int main(int argc, char **argv)
 	}
 	portInit.phy_delay = &ether_phy_delay;
 
+	if( ipc_group_name != NULL || ipc_shm_name != NULL )
+		ipc_arg = new LinuxIPCArg( ipc_group_name, ipc_shm_name );
 	if( !ipc->init( ipc_arg ) ) {
 		delete ipc;
 		ipc = NULL;
@@ -357,11 +439,16 @@ int main(int argc, char **argv)
 		restoredataptr = (char *)restoredata;
 	}
 
+	EtherTimestamper *timestampers[MAX_PORTS];
+	for( i = 0; i < nIfnames; ++i ) {
 #ifdef ARCH_INTELCE
-	EtherTimestamper *timestamper = new LinuxTimestamperIntelCE();
+		timestampers[i] = new LinuxTimestamperIntelCE();
 #else
-	EtherTimestamper *timestamper = new LinuxTimestamperGeneric();
+		timestampers[i] = new LinuxTimestamperGeneric();
 #endif
+	}
+	// PPS is driven from the first port's device
+	EtherTimestamper *timestamper = timestampers[0];
 
 	sigemptyset(&set);
 	sigaddset(&set, SIGINT);
@@ -374,27 +461,12 @@ int main(int argc, char **argv)
 		return -1;
 	}
 
-	pClock = new IEEE1588Clock
-		( false, syntonize, priority1, timerq_factory, ipc,
-		  lock_factory );
-
-	if( restoredataptr != NULL ) {
-		if( !restorefailed )
-			restorefailed =
-				!pClock->restoreSerializedState( restoredataptr, &restoredatacount );
-		restoredataptr = ((char *)restoredata) + (restoredatalength - restoredatacount);
+	// Start the writer once signals are blocked so it never takes them
+	if( async_log && !gptplogAsync( true )) {
+		GPTP_LOG_ERROR( "Asynchronous logging is not available" );
 	}
 
-	// TODO: The setting of values into temporary variables should be changed to
-	// just set directly into the portInit struct.
-	portInit.clock = pClock;
-	portInit.index = 1;
-	portInit.timestamper = timestamper;
-	portInit.net_label = ifname;
-	portInit.condition_factory = condition_factory;
-	portInit.thread_factory = thread_factory;
-	portInit.timer_factory = timer_factory;
-	portInit.lock_factory = lock_factory;
+	ServoConfig servo_config;
 
 	if(use_config_file)
 	{
@@ -411,6 +483,11 @@ int main(int argc, char **argv)
 			iniParser.print_phy_delay();
 			GPTP_LOG_INFO("neighborPropDelayThresh: %ld", iniParser.getNeighborPropDelayThresh());
 			GPTP_LOG_INFO("syncReceiptThreshold: %d", iniParser.getSyncReceiptThresh());
+			GPTP_LOG_INFO("linkFlapWindow: %u ms", iniParser.getLinkFlapWindow());
+			iniParser.print_thread_sched();
+
+			servo_config = iniParser.getServoConfig();
+			GPTP_LOG_INFO("rate servo: %d", servo_config.type);
 
 			/* If using config file, set the neighborPropDelayThresh.
 			 * Otherwise it will use its default value (800ns) */
@@ -423,6 +500,19 @@ int main(int argc, char **argv)
 			portInit.syncReceiptThreshold =
 				iniParser.getSyncReceiptThresh();
 
+			portInit.linkFlapWindow = iniParser.getLinkFlapWindow();
+
+			/* Threads are created later with these */
+			thread_factory->setSched( OSTHREAD_ROLE_EVENT,
+				iniParser.getThreadSched( OSTHREAD_ROLE_EVENT ));
+			thread_factory->setSched( OSTHREAD_ROLE_LINK,
+				iniParser.getThreadSched( OSTHREAD_ROLE_LINK ));
+			timerq_factory->setSched
+				( iniParser.getThreadSched( OSTHREAD_ROLE_TIMER ));
+			if( ipc )
+				ipc->setSystemModelSched
+					( iniParser.getThreadSched( OSTHREAD_ROLE_IPC ));
+
 			/*Only overwrites phy_delay default values if not input_delay switch enabled*/
 			if(!input_delay)
 			{
@@ -432,21 +522,60 @@ int main(int argc, char **argv)
 
 	}
 
-	pPort = new EtherPort(&portInit);
+	pClock = new IEEE1588Clock
+		( false, syntonize, priority1, timerq_factory, ipc,
+		  lock_factory );
+	pClock->setRateServo( servo_config );
+	pClock->setFastLock( fast_lock );
 
-	if (!pPort->init_port()) {
-		GPTP_LOG_ERROR("failed to initialize port");
-		GPTP_LOG_UNREGISTER();
-		return -1;
+	if( restoredataptr != NULL ) {
+		if( !restorefailed )
+			restorefailed =
+				!pClock->restoreSerializedState( restoredataptr, &restoredatacount );
+		restoredataptr = ((char *)restoredata) + (restoredatalength - restoredatacount);
 	}
 
-	if( restoredataptr != NULL ) {
-		if( !restorefailed ) {
-			restorefailed = !pPort->restoreSerializedState( restoredataptr, &restoredatacount );
-			GPTP_LOG_INFO("Persistent port data restored: asCapable:%d, port_state:%d, one_way_delay:%lld",
-						  pPort->getAsCapable(), pPort->getPortState(), pPort->getLinkDelay());
+	// TODO: The setting of values into temporary variables should be changed to
+	// just set directly into the portInit struct.
+	portInit.clock = pClock;
+	portInit.condition_factory = condition_factory;
+	portInit.thread_factory = thread_factory;
+	portInit.timer_factory = timer_factory;
+	portInit.lock_factory = lock_factory;
+
+	for( nPorts = 0; nPorts < nIfnames; ++nPorts ) {
+		EtherPort *pPort;
+
+		portInit.index = nPorts + 1;
+		portInit.timestamper = timestampers[nPorts];
+		portInit.net_label = ifnames[nPorts];
+
+		pPort = new EtherPort(&portInit);
+		pPorts[nPorts] = pPort;
+		if( ipc )
+			pPort->getStats()->attach( ipc->getPortStats( nPorts ));
+
+		if (!pPort->init_port()) {
+			GPTP_LOG_ERROR("failed to initialize port %d", nPorts + 1);
+			GPTP_LOG_UNREGISTER();
+			return -1;
+		}
+
+		if( restoredataptr != NULL ) {
+			if( !restorefailed ) {
+				restorefailed = !pPort->restoreSerializedState( restoredataptr, &restoredatacount );
+				GPTP_LOG_INFO("Persistent port data restored: asCapable:%d, port_state:%d, one_way_delay:%lld",
+							  pPort->getAsCapable(), pPort->getPortState(), pPort->getLinkDelay());
+			}
+			restoredataptr = ((char *)restoredata) + (restoredatalength - restoredatacount);
 		}
-		restoredataptr = ((char *)restoredata) + (restoredatalength - restoredatacount);
+	}
+
+	// Additional domains share the first port's socket and link delay
+	for( i = 0; i < nDomains; ++i ) {
+		pPorts[0]->addDomainFollower
+			( new DomainFollower( domains[i], i + 1, ipc, servo_config ));
+		GPTP_LOG_STATUS( "Following gPTP domain %u", (unsigned) domains[i] );
 	}
 
 	if (portInit.automotive_profile) {
@@ -460,7 +589,8 @@ int main(int argc, char **argv)
 	}
 
 	if( override_portstate ) {
-		pPort->setPortState( port_state );
+		for( i = 0; i < nPorts; ++i )
+			pPorts[i]->setPortState( port_state );
 	}
 
 	// Start PPS if requested
@@ -476,13 +606,20 @@ int main(int argc, char **argv)
 		restoredatacount = 0;
 		pClock->serializeState(NULL, &len);
 		restoredatacount += len;
-		pPort->serializeState(NULL, &len);
-		restoredatacount += len;
+		for( i = 0; i < nPorts; ++i ) {
+			pPorts[i]->serializeState(NULL, &len);
+			restoredatacount += len;
+		}
 		pGPTPPersist->setWriteSize((uint32_t)restoredatacount);
 		pGPTPPersist->registerWriteCB(gPTPPersistWriteCB);
 	}
 
-	pPort->processEvent(POWERUP);
+	for( i = 0; i < nPorts; ++i )
+		pPorts[i]->processEvent(POWERUP);
+
+	// The clock is disciplined from the first port
+	if( ipc && sysmodel_interval > 0 )
+		ipc->startSystemModel( timestamper, sysmodel_interval );
 
 	do {
 		sig = 0;
@@ -496,14 +633,15 @@ int main(int argc, char **argv)
 		if (sig == SIGHUP) {
 			if (pGPTPPersist) {
 			  // If port is either master or slave, save clock and then port state
-			  if (pPort->getPortState() == PTP_MASTER || pPort->getPortState() == PTP_SLAVE) {
+			  if (pPorts[0]->getPortState() == PTP_MASTER || pPorts[0]->getPortState() == PTP_SLAVE) {
 				pGPTPPersist->triggerWriteStorage();
 			  }
 			}
 		}
 
 		if (sig == SIGUSR2) {
-			pPort->logIEEEPortCounters();
+			for( i = 0; i < nPorts; ++i )
+				pPorts[i]->logIEEEPortCounters();
 		}
 	} while (sig == SIGHUP || sig == SIGUSR2);
 
@@ -537,6 +675,8 @@ void gPTPPersistWriteCB(char *bufPtr, uint32_t bufSize)
 	restoredataptr = (char *)bufPtr;
 	pClock->serializeState(restoredataptr, &restoredatacount);
 	restoredataptr = ((char *)bufPtr) + (restoredatalength - restoredatacount);
-	pPort->serializeState(restoredataptr, &restoredatacount);
-	restoredataptr = ((char *)bufPtr) + (restoredatalength - restoredatacount);
+	for( int i = 0; i < nPorts; ++i ) {
+		pPorts[i]->serializeState(restoredataptr, &restoredatacount);
+		restoredataptr = ((char *)bufPtr) + (restoredatalength - restoredatacount);
+	}
 }
@@ -0,0 +1,55 @@
+/******************************************************************************
+
+  Copyright (c) 2009-2012, Intel Corporation 
+  All rights reserved.
+  
+  Redistribution and use in source and binary forms, with or without 
+  modification, are permitted provided that the following conditions are met:
+  
+   1. Redistributions of source code must retain the above copyright notice, 
+      this list of conditions and the following disclaimer.
+  
+   2. Redistributions in binary form must reproduce the above copyright 
+      notice, this list of conditions and the following disclaimer in the 
+      documentation and/or other materials provided with the distribution.
+  
+   3. Neither the name of the Intel Corporation nor the names of its 
+      contributors may be used to endorse or promote products derived from 
+      this software without specific prior written permission.
+  
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifndef GPTP_HAL_STATIC_HPP
+#define GPTP_HAL_STATIC_HPP
+
+/**@file*/
+
+/*
+ * Message path types of the generic and I210 Linux HAL for builds with
+ * GPTP_STATIC_HAL (make STATIC_HAL=1), see gptp_hal.hpp.
+ */
+
+#ifdef ARCH_INTELCE
+#error "GPTP_STATIC_HAL supports the generic and I210 Linux HAL only"
+#endif
+
+#include <linux_hal_generic.hpp>
+
+typedef LinuxNetworkInterface HalNetworkInterface;		/*!< Network interface of the message path */
+typedef LinuxLock HalLock;								/*!< Lock of the message path */
+typedef LinuxTimerQueue HalTimerQueue;					/*!< Timer queue of the message path */
+typedef LinuxTimestamperGeneric HalEtherTimestamper;	/*!< Timestamper of the message path */
+
+#endif/*GPTP_HAL_STATIC_HPP*/
@@ -37,6 +37,7 @@
 #include <ether_port.hpp>
 
 #include <pthread.h>
+#include <sched.h>
 #include <linux_ipc.hpp>
 
 #include <sys/mman.h>
@@ -48,6 +49,8 @@
 #include <errno.h>
 
 #include <signal.h>
+#include <poll.h>
+#include <sys/timerfd.h>
 #include <net/ethernet.h> /* the L2 protocols */
 
 #include <netpacket/packet.h>
@@ -61,6 +64,10 @@
 #include <linux/rtnetlink.h>
 #include <linux/sockios.h>
 #include <gptp_cfg.hpp>
+#include <gptp_hal.hpp>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <limits.h>
 
 Timestamp tsToTimestamp(struct timespec *ts)
 {
@@ -85,29 +92,34 @@ LinuxNetworkInterface::~LinuxNetworkInterface() {
 
 net_result LinuxNetworkInterface::send
 ( LinkLayerAddress *addr, uint16_t etherType, uint8_t *payload, size_t length, bool timestamp ) {
-	sockaddr_ll *remote = NULL;
+	sockaddr_ll remote;
 	int err;
-	remote = new struct sockaddr_ll;
-	memset( remote, 0, sizeof( *remote ));
-	remote->sll_family = AF_PACKET;
-	remote->sll_protocol = PLAT_htons( etherType );
-	remote->sll_ifindex = ifindex;
-	remote->sll_halen = ETH_ALEN;
-	addr->toOctetArray( remote->sll_addr );
+	memset( &remote, 0, sizeof( remote ));
+	remote.sll_family = AF_PACKET;
+	remote.sll_protocol = PLAT_htons( etherType );
+	remote.sll_ifindex = ifindex;
+	remote.sll_halen = ETH_ALEN;
+	addr->toOctetArray( remote.sll_addr );
 
 	if( timestamp ) {
 #ifndef ARCH_INTELCE
 		net_lock.lock();
 #endif
 		err = sendto
-			( sd_event, payload, length, 0, (sockaddr *) remote,
-			  sizeof( *remote ));
+			( sd_event, payload, length, 0, (sockaddr *) &remote,
+			  sizeof( remote ));
+		if( err != -1 && timestamper != NULL ) {
+#ifdef GPTP_STATIC_HAL
+			static_cast<LinuxTimestamperGeneric *>( timestamper )->txSent();
+#else
+			timestamper->txSent();
+#endif
+		}
 	} else {
 		err = sendto
-			( sd_general, payload, length, 0, (sockaddr *) remote,
-			  sizeof( *remote ));
+			( sd_general, payload, length, 0, (sockaddr *) &remote,
+			  sizeof( remote ));
 	}
-	delete remote;
 	if( err == -1 ) {
 		GPTP_LOG_ERROR( "Failed to send: %s(%d)", strerror(errno), errno );
 		return net_fatal;
@@ -149,6 +161,8 @@ void LinuxNetworkInterface::clear_reenable_rx_queue() {
 	int err;
 
 	while( recvfrom( sd_event, buf, 256, MSG_DONTWAIT, NULL, 0 ) != -1 );
+	rx_batch.count = 0;
+	rx_batch.next = 0;
 
 	memset( &mr_8021as, 0, sizeof( mr_8021as ));
 	mr_8021as.mr_ifindex = ifindex;
@@ -396,62 +410,191 @@ void LinuxNetworkInterface::watchNetLink( CommonPort *iPort )
 }
 
 
-struct LinuxTimerQueuePrivate {
-	pthread_t signal_thread;
-};
-
 struct LinuxTimerQueueActionArg {
-	timer_t timer_handle;
-	struct sigevent sevp;
+	uint64_t deadline;		// CLOCK_MONOTONIC expiry in ns
+	unsigned heap_pos;
+	LinuxTimerQueueActionArg *type_prev;	// Events in the same type bucket
+	LinuxTimerQueueActionArg *type_next;
 	event_descriptor_t *inner_arg;
 	ostimerq_handler func;
 	int type;
 	bool rm;
+	bool in_use;
+};
+
+struct LinuxTimerQueuePrivate {
+	pthread_t signal_thread;
+	int timer_fd;
+	LinuxTimerQueueActionArg slots[LINUX_TIMERQ_SLOTS];
+	LinuxTimerQueueActionArg *heap[LINUX_TIMERQ_SLOTS];
+	unsigned heap_size;
+	LinuxTimerQueueActionArg *free_slots[LINUX_TIMERQ_SLOTS];
+	unsigned free_count;
+	LinuxTimerQueueActionArg *type_heads[LINUX_TIMERQ_TYPE_BUCKETS];
+	uint64_t armed;			// Deadline the timerfd is armed for, 0 if disarmed
 };
 
+static inline unsigned timerQueueBucket( int type )
+{
+	return (unsigned)type % LINUX_TIMERQ_TYPE_BUCKETS;
+}
+
+static uint64_t timerQueueNow()
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 LinuxTimerQueue::~LinuxTimerQueue() {
+	stop = true;
 	pthread_join(_private->signal_thread,NULL);
-	if( _private != NULL ) delete _private;
+	if( _private != NULL ) {
+		close( _private->timer_fd );
+		delete _private;
+	}
 }
 
 bool LinuxTimerQueue::init() {
 	_private = new LinuxTimerQueuePrivate;
 	if( _private == NULL ) return false;
 
+	_private->timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+	if( _private->timer_fd == -1 ) {
+		GPTP_LOG_ERROR("timerfd_create failed - %s", strerror(errno));
+		delete _private;
+		_private = NULL;
+		return false;
+	}
+
+	_private->heap_size = 0;
+	_private->armed = 0;
+	_private->free_count = LINUX_TIMERQ_SLOTS;
+	for( unsigned i = 0; i < LINUX_TIMERQ_SLOTS; ++i ) {
+		_private->slots[i].in_use = false;
+		_private->free_slots[i] = &_private->slots[LINUX_TIMERQ_SLOTS - 1 - i];
+	}
+	for( unsigned i = 0; i < LINUX_TIMERQ_TYPE_BUCKETS; ++i ) {
+		_private->type_heads[i] = NULL;
+	}
+
 	return true;
 }
 
+void LinuxTimerQueue::heapSwap( unsigned i, unsigned j ) {
+	LinuxTimerQueueActionArg **heap = _private->heap;
+	LinuxTimerQueueActionArg *tmp = heap[i];
+	heap[i] = heap[j];
+	heap[j] = tmp;
+	heap[i]->heap_pos = i;
+	heap[j]->heap_pos = j;
+}
+
+void LinuxTimerQueue::heapUp( unsigned pos ) {
+	LinuxTimerQueueActionArg **heap = _private->heap;
+	while( pos > 0 ) {
+		unsigned parent = (pos - 1) / 2;
+		if( heap[parent]->deadline <= heap[pos]->deadline ) break;
+		heapSwap( pos, parent );
+		pos = parent;
+	}
+}
+
+void LinuxTimerQueue::heapDown( unsigned pos ) {
+	LinuxTimerQueueActionArg **heap = _private->heap;
+	unsigned size = _private->heap_size;
+	for( ;; ) {
+		unsigned smallest = pos;
+		unsigned left = 2 * pos + 1;
+		unsigned right = left + 1;
+		if( left < size && heap[left]->deadline < heap[smallest]->deadline )
+			smallest = left;
+		if( right < size && heap[right]->deadline < heap[smallest]->deadline )
+			smallest = right;
+		if( smallest == pos ) break;
+		heapSwap( pos, smallest );
+		pos = smallest;
+	}
+}
+
+// Take the slot at heap position pos out of the heap and give it back
+void LinuxTimerQueue::heapRemove( unsigned pos ) {
+	LinuxTimerQueueActionArg *slot = _private->heap[pos];
+	unsigned last = --_private->heap_size;
+
+	if( pos != last ) {
+		heapSwap( pos, last );
+		heapDown( pos );
+		heapUp( pos );
+	}
+
+	if( slot->type_prev != NULL ) {
+		slot->type_prev->type_next = slot->type_next;
+	} else {
+		_private->type_heads[timerQueueBucket( slot->type )] = slot->type_next;
+	}
+	if( slot->type_next != NULL ) {
+		slot->type_next->type_prev = slot->type_prev;
+	}
+
+	slot->in_use = false;
+	_private->free_slots[_private->free_count++] = slot;
+}
+
+// Arm the timerfd for the earliest deadline, or disarm it when the heap is empty
+void LinuxTimerQueue::arm() {
+	struct itimerspec its;
+	uint64_t deadline = _private->heap_size > 0 ? _private->heap[0]->deadline : 0;
+
+	if( deadline == _private->armed ) return;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = deadline / 1000000000ULL;
+	its.it_value.tv_nsec = deadline % 1000000000ULL;
+	if( timerfd_settime( _private->timer_fd, TFD_TIMER_ABSTIME, &its, NULL ) == -1 ) {
+		GPTP_LOG_ERROR("Failed to arm timer: %s", strerror(errno));
+		return;
+	}
+	_private->armed = deadline;
+}
+
 void *LinuxTimerQueueHandler( void *arg ) {
 	LinuxTimerQueue *timerq = (LinuxTimerQueue *) arg;
-	sigset_t waitfor;
-	struct timespec timeout;
-	timeout.tv_sec = 0; timeout.tv_nsec = 100000000; /* 100 ms */
+	struct pollfd pfd;
 
-	sigemptyset( &waitfor );
+	pfd.fd = timerq->_private->timer_fd;
+	pfd.events = POLLIN;
 
 	while( !timerq->stop ) {
-		siginfo_t info;
-		LinuxTimerQueueMap_t::iterator iter;
-		sigaddset( &waitfor, SIGUSR1 );
-		if( sigtimedwait( &waitfor, &info, &timeout ) == -1 ) {
-			if( errno == EAGAIN ) continue;
+		uint64_t expirations;
+		int ret = poll( &pfd, 1, 100 );		/* 100 ms, to notice stop */
+		if( ret == 0 ) continue;
+		if( ret == -1 ) {
+			if( errno == EINTR ) continue;
 			else break;
 		}
+		if( read( pfd.fd, &expirations, sizeof(expirations) ) == -1 && errno != EAGAIN ) {
+			break;
+		}
 		if( timerq->lock->lock() != oslock_ok ) {
 			break;
 		}
 
-		iter = timerq->timerQueueMap.find(info.si_value.sival_int);
-		if( iter != timerq->timerQueueMap.end() ) {
-		    struct LinuxTimerQueueActionArg *arg = iter->second;
-			timerq->timerQueueMap.erase(iter);
-			timerq->LinuxTimerQueueAction( arg );
-			if( arg->rm ) {
-				delete arg->inner_arg;
+		// Fire everything that is due. An action may add or cancel
+		// events, so the heap top is looked up again every time.
+		timerq->_private->armed = 0;
+		uint64_t now = timerQueueNow();
+		while( timerq->_private->heap_size > 0 &&
+		       timerq->_private->heap[0]->deadline <= now ) {
+			LinuxTimerQueueActionArg fired = *timerq->_private->heap[0];
+			timerq->heapRemove( 0 );
+			timerq->LinuxTimerQueueAction( &fired );
+			if( fired.rm ) {
+				delete fired.inner_arg;
 			}
-			timer_delete(arg->timer_handle);
-			delete arg;
 		}
+		timerq->arm();
+
 		if( timerq->lock->unlock() != oslock_ok ) {
 			break;
 		}
@@ -474,17 +617,19 @@ OSTimerQueue *LinuxTimerQueueFactory::createOSTimerQueue
 		return NULL;
 	}
 
-	if( pthread_create
+	ret->stop = false;
+	ret->lock = clock->timerQLock();
+
+	if( linuxThreadCreate
 		( &(ret->_private->signal_thread),
-		  NULL, LinuxTimerQueueHandler, ret ) != 0 ) {
+		  sched, LinuxTimerQueueHandler, ret ) != 0 ) {
+		close( ret->_private->timer_fd );
+		delete ret->_private;
+		ret->_private = NULL;
 		delete ret;
 		return NULL;
 	}
 
-	ret->stop = false;
-	ret->key = 0;
-	ret->lock = clock->timerQLock();
-
 	return ret;
 }
 
@@ -494,67 +639,62 @@ bool LinuxTimerQueue::addEvent
 ( unsigned long micros, int type, ostimerq_handler func,
   event_descriptor_t * arg, bool rm, unsigned *event) {
 	LinuxTimerQueueActionArg *outer_arg;
-	int err;
-	LinuxTimerQueueMap_t::iterator iter;
 
+	if( _private->free_count == 0 ) {
+		GPTP_LOG_ERROR("Timer queue full, dropping event %d", type);
+		return false;
+	}
 
-	outer_arg = new LinuxTimerQueueActionArg;
+	outer_arg = _private->free_slots[--_private->free_count];
+	outer_arg->in_use = true;
 	outer_arg->inner_arg = arg;
 	outer_arg->rm = rm;
 	outer_arg->func = func;
 	outer_arg->type = type;
+	outer_arg->deadline = timerQueueNow() + (uint64_t)micros * 1000;
 
-	// Find key that we can use
-	while( timerQueueMap.find( key ) != timerQueueMap.end() ) {
-		++key;
+	LinuxTimerQueueActionArg **head = &_private->type_heads[timerQueueBucket( type )];
+	outer_arg->type_prev = NULL;
+	outer_arg->type_next = *head;
+	if( *head != NULL ) {
+		(*head)->type_prev = outer_arg;
 	}
+	*head = outer_arg;
 
-	{
-		struct itimerspec its;
-		memset(&(outer_arg->sevp), 0, sizeof(outer_arg->sevp));
-		outer_arg->sevp.sigev_notify = SIGEV_SIGNAL;
-		outer_arg->sevp.sigev_signo  = SIGUSR1;
-		outer_arg->sevp.sigev_value.sival_int = key;
-		if ( timer_create
-			 (CLOCK_MONOTONIC, &outer_arg->sevp, &outer_arg->timer_handle)
-			 == -1) {
-			GPTP_LOG_ERROR("timer_create failed - %s", strerror(errno));
-			return false;
-		}
-		timerQueueMap[key] = outer_arg;
-
-		memset(&its, 0, sizeof(its));
-		its.it_value.tv_sec = micros / 1000000;
-		its.it_value.tv_nsec = (micros % 1000000) * 1000;
-		err = timer_settime( outer_arg->timer_handle, 0, &its, NULL );
-		if( err < 0 ) {
-			fprintf
-				( stderr, "Failed to arm timer: %s\n",
-				  strerror( errno ));
-			return false;
-		}
+	outer_arg->heap_pos = _private->heap_size;
+	_private->heap[_private->heap_size++] = outer_arg;
+	heapUp( outer_arg->heap_pos );
+
+	// Only a new earliest deadline needs the timerfd moved
+	if( outer_arg->heap_pos == 0 ) {
+		arm();
 	}
 
 	return true;
 }
 
 
-bool LinuxTimerQueue::cancelEvent( int type, unsigned *event ) {
-	LinuxTimerQueueMap_t::iterator iter;
-	for( iter = timerQueueMap.begin(); iter != timerQueueMap.end();) {
-		if( (iter->second)->type == type ) {
+bool LinuxTimerQueue::cancelEvent
+( int type, CommonPort *port, unsigned *event ) {
+	// Only the events hashed to this type's bucket are looked at. Ports
+	// sharing a clock share the queue, so leave other ports' events be.
+	LinuxTimerQueueActionArg *slot = _private->type_heads[timerQueueBucket( type )];
+	while( slot != NULL ) {
+		LinuxTimerQueueActionArg *next = slot->type_next;
+		if( slot->type == type &&
+		    ( port == NULL || slot->inner_arg == NULL ||
+		      slot->inner_arg->port == port )) {
 			// Delete element
-			if( (iter->second)->rm ) {
-				delete (iter->second)->inner_arg;
+			if( slot->rm ) {
+				delete slot->inner_arg;
 			}
-			timer_delete(iter->second->timer_handle);
-			delete iter->second;
-			timerQueueMap.erase(iter++);
-		} else {
-			++iter;
+			heapRemove( slot->heap_pos );
 		}
+		slot = next;
 	}
 
+	// A timerfd armed for a cancelled event just wakes the handler
+	// early, it re-arms for whatever is left.
 	return true;
 }
 
@@ -791,6 +931,49 @@ struct LinuxThreadPrivate {
 	pthread_t thread_id;
 };
 
+int linuxThreadCreate
+( pthread_t *thread, const OSThreadSched &sched, void *(*func)( void * ),
+  void *arg )
+{
+	pthread_attr_t attr;
+	int err;
+
+	if( sched.priority == 0 && sched.cpus == 0 )
+		return pthread_create( thread, NULL, func, arg );
+
+	pthread_attr_init( &attr );
+	if( sched.priority > 0 ) {
+		struct sched_param param;
+
+		memset( &param, 0, sizeof( param ));
+		param.sched_priority = sched.priority;
+		pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+		pthread_attr_setschedpolicy( &attr, SCHED_FIFO );
+		pthread_attr_setschedparam( &attr, &param );
+	}
+	if( sched.cpus != 0 ) {
+		cpu_set_t set;
+
+		CPU_ZERO( &set );
+		for( int cpu = 0; cpu < 64; ++cpu ) {
+			if( sched.cpus & ((uint64_t) 1 << cpu ))
+				CPU_SET( cpu, &set );
+		}
+		pthread_attr_setaffinity_np( &attr, sizeof( set ), &set );
+	}
+
+	err = pthread_create( thread, &attr, func, arg );
+	pthread_attr_destroy( &attr );
+	if( err == EPERM || err == EINVAL ) {
+		GPTP_LOG_ERROR( "Thread scheduling (priority %d, CPUs 0x%llx) "
+				"not applied: %s", sched.priority,
+				(unsigned long long) sched.cpus, strerror( err ));
+		err = pthread_create( thread, NULL, func, arg );
+	}
+
+	return err;
+}
+
 bool LinuxThread::start(OSThreadFunction function, void *arg) {
 	sigset_t set;
 	sigset_t oset;
@@ -810,8 +993,8 @@ bool LinuxThread::start(OSThreadFunction function, void *arg) {
 			("Add timer pthread_sigmask( SIG_BLOCK ... )");
 		return false;
 	}
-	err = pthread_create(&_private->thread_id, NULL, OSThreadCallback,
-						 arg_inner);
+	err = linuxThreadCreate(&_private->thread_id, sched, OSThreadCallback,
+							arg_inner);
 	if (err != 0)
 		return false;
 	sigdelset(&oset, SIGALRM);
@@ -844,8 +1027,9 @@ LinuxThread::~LinuxThread() {
 }
 
 LinuxSharedMemoryIPC::~LinuxSharedMemoryIPC() {
+	stopSystemModel();
 	munmap(master_offset_buffer, SHM_SIZE);
-	shm_unlink(SHM_NAME);
+	shm_unlink(shm_name);
 }
 
 bool LinuxSharedMemoryIPC::init( OS_IPC_ARG *barg ) {
@@ -864,14 +1048,17 @@ bool LinuxSharedMemoryIPC::init( OS_IPC_ARG *barg ) {
 			goto exit_error;
 		} else {
 			group_name = arg->group_name;
+			strncpy( shm_name, arg->shm_name, sizeof(shm_name) );
 		}
 	}
+	if( shm_name[0] == '\0' )
+		strncpy( shm_name, SHM_NAME, sizeof(shm_name) );
 	grp = getgrnam( group_name );
 	if( grp == NULL ) {
 		GPTP_LOG_ERROR( "Group %s not found, will try root (0) instead", group_name );
 	}
 
-	shm_fd = shm_open( SHM_NAME, O_RDWR | O_CREAT, 0660 );
+	shm_fd = shm_open( shm_name, O_RDWR | O_CREAT, 0660 );
 	if( shm_fd == -1 ) {
 		GPTP_LOG_ERROR( "shm_open(): %s", strerror(errno) );
 		goto exit_error;
@@ -908,13 +1095,134 @@ bool LinuxSharedMemoryIPC::init( OS_IPC_ARG *barg ) {
 			 strerror(errno));
 		goto exit_unlink;
 	}
+	seqlock_init();
 	return true;
  exit_unlink:
-	shm_unlink( SHM_NAME );
+	shm_unlink( shm_name );
  exit_error:
 	return false;
 }
 
+static_assert( sizeof(pthread_mutex_t) + sizeof(gPtpTimeData) <= GPTP_SHM_SEQLOCK_OFFSET,
+	       "legacy shared memory block overlaps the seqlock block" );
+static_assert( GPTP_SHM_SEQLOCK_OFFSET + sizeof(gPtpSeqlockData) <= GPTP_SHM_MODEL_OFFSET,
+	       "seqlock block overlaps the system model block" );
+static_assert( GPTP_SHM_MODEL_OFFSET + sizeof(gPtpSysModel) <= GPTP_SHM_NOTIFY_OFFSET,
+	       "system model block overlaps the notification block" );
+static_assert( GPTP_SHM_NOTIFY_OFFSET + sizeof(gPtpNotify) <= GPTP_SHM_DOMAIN_OFFSET,
+	       "notification block overlaps the domain region" );
+static_assert( GPTP_SHM_DOMAIN_OFFSET + sizeof(gPtpDomainRegion) <= GPTP_SHM_STATS_OFFSET,
+	       "domain region overlaps the statistics region" );
+static_assert( offsetof(gPtpDomainRegion, domains) == 4 * sizeof(uint32_t),
+	       "domain slots do not follow the region header" );
+
+void LinuxSharedMemoryIPC::seqlock_init()
+{
+	gPtpSeqlockData *sl = (gPtpSeqlockData *)
+		(master_offset_buffer + GPTP_SHM_SEQLOCK_OFFSET);
+
+	memset(sl, 0, sizeof(*sl));
+	sl->version = GPTP_SHM_SEQLOCK_VERSION;
+	sl->data_size = sizeof(gPtpTimeData);
+	/* readers only trust the block once the magic is visible */
+	__atomic_store_n(&sl->magic, GPTP_SHM_SEQLOCK_MAGIC, __ATOMIC_RELEASE);
+
+	gPtpSysModel *model = (gPtpSysModel *)
+		(master_offset_buffer + GPTP_SHM_MODEL_OFFSET);
+
+	memset(model, 0, sizeof(*model));
+	model->version = GPTP_SHM_MODEL_VERSION;
+	__atomic_store_n(&model->magic, GPTP_SHM_MODEL_MAGIC, __ATOMIC_RELEASE);
+
+	gPtpNotify *notify = (gPtpNotify *)
+		(master_offset_buffer + GPTP_SHM_NOTIFY_OFFSET);
+
+	memset(notify, 0, sizeof(*notify));
+	notify->version = GPTP_SHM_NOTIFY_VERSION;
+	__atomic_store_n(&notify->magic, GPTP_SHM_NOTIFY_MAGIC, __ATOMIC_RELEASE);
+
+	gPtpDomainRegion *domains = (gPtpDomainRegion *)
+		(master_offset_buffer + GPTP_SHM_DOMAIN_OFFSET);
+
+	memset(domains, 0, sizeof(*domains));
+	domains->version = GPTP_SHM_DOMAIN_VERSION;
+	domains->domain_count = 1;
+	domains->slot_size = sizeof(gPtpDomainSlot);
+	__atomic_store_n(&domains->magic, GPTP_SHM_DOMAIN_MAGIC, __ATOMIC_RELEASE);
+
+	gPtpStatsRegion *region = (gPtpStatsRegion *)
+		(master_offset_buffer + GPTP_SHM_STATS_OFFSET);
+
+	memset(region, 0, sizeof(*region));
+	region->version = GPTP_SHM_STATS_VERSION;
+	region->port_size = sizeof(gPtpPortStats);
+	__atomic_store_n(&region->magic, GPTP_SHM_STATS_MAGIC, __ATOMIC_RELEASE);
+}
+
+gPtpPortStats *LinuxSharedMemoryIPC::getPortStats( unsigned index )
+{
+	gPtpStatsRegion *region;
+
+	if( master_offset_buffer == NULL || index >= GPTP_SHM_STATS_MAX_PORTS )
+		return NULL;
+
+	region = (gPtpStatsRegion *)
+		(master_offset_buffer + GPTP_SHM_STATS_OFFSET);
+	if( region->port_count < index + 1 )
+		__atomic_store_n(&region->port_count, index + 1, __ATOMIC_RELEASE);
+
+	return &region->ports[index];
+}
+
+void LinuxSharedMemoryIPC::seqlock_publish( const gPtpTimeData *ptimedata )
+{
+	gPtpSeqlockData *sl = (gPtpSeqlockData *)
+		(master_offset_buffer + GPTP_SHM_SEQLOCK_OFFSET);
+	uint32_t seq = __atomic_load_n(&sl->seq, __ATOMIC_RELAXED);
+
+	/* writers are serialized by the legacy mutex */
+	__atomic_store_n(&sl->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&sl->data, ptimedata, sizeof(sl->data));
+	__atomic_store_n(&sl->seq, seq + 2, __ATOMIC_RELEASE);
+
+	domain_publish( 0, ptimedata, ptimedata->local_time != 0 );
+}
+
+void LinuxSharedMemoryIPC::domain_publish
+( unsigned index, const gPtpTimeData *ptimedata, bool valid )
+{
+	gPtpDomainRegion *region = (gPtpDomainRegion *)
+		(master_offset_buffer + GPTP_SHM_DOMAIN_OFFSET);
+	gPtpDomainSlot *slot = &region->domains[index];
+	uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+	/* writers are serialized by the legacy mutex */
+	__atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&slot->data, ptimedata, sizeof(slot->data));
+	slot->valid = valid;
+	__atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+
+	if( region->domain_count < index + 1 )
+		__atomic_store_n(&region->domain_count, index + 1, __ATOMIC_RELEASE);
+}
+
+void LinuxSharedMemoryIPC::notify( bool gm_changed )
+{
+	gPtpNotify *n = (gPtpNotify *)
+		(master_offset_buffer + GPTP_SHM_NOTIFY_OFFSET);
+
+	if( gm_changed )
+		__atomic_add_fetch(&n->gm_count, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&n->update_count, 1, __ATOMIC_SEQ_CST);
+
+	/* pairs with the waiter's increment before it re-checks the count */
+	if( __atomic_load_n(&n->waiters, __ATOMIC_SEQ_CST) != 0 )
+		syscall(SYS_futex, &n->update_count, FUTEX_WAKE, INT_MAX,
+			NULL, NULL, 0);
+}
+
 bool LinuxSharedMemoryIPC::update(
 	int64_t ml_phoffset,
 	int64_t ls_phoffset,
@@ -945,9 +1253,20 @@ bool LinuxSharedMemoryIPC::update(
 		ptimedata->asCapable = asCapable;
 		ptimedata->port_state   = port_state;
 		ptimedata->process_id   = process_id;
+		seqlock_publish(ptimedata);
 		/* unlock */
 		pthread_mutex_unlock((pthread_mutex_t *) shm_buffer);
+		notify(false);
 	}
+
+	pthread_mutex_lock( &model_lock );
+	model_ml_phoffset = ml_phoffset;
+	model_ml_freqoffset = ml_freqoffset;
+	model_ls_freqoffset = ls_freqoffset;
+	model_local_time = local_time;
+	model_sync_valid = true;
+	pthread_mutex_unlock( &model_lock );
+
 	return true;
 }
 
@@ -958,15 +1277,24 @@ bool LinuxSharedMemoryIPC::update_grandmaster(
 	int buf_offset = 0;
 	char *shm_buffer = master_offset_buffer;
 	gPtpTimeData *ptimedata;
+	bool gm_changed;
 	if( shm_buffer != NULL ) {
 		/* lock */
 		pthread_mutex_lock((pthread_mutex_t *) shm_buffer);
 		buf_offset += sizeof(pthread_mutex_t);
 		ptimedata   = (gPtpTimeData *) (shm_buffer + buf_offset);
-		memcpy(ptimedata->gptp_grandmaster_id, gptp_grandmaster_id, PTP_CLOCK_IDENTITY_LENGTH);
-		ptimedata->gptp_domain_number = gptp_domain_number;
+		gm_changed = memcmp(ptimedata->gptp_grandmaster_id, gptp_grandmaster_id,
+				    PTP_CLOCK_IDENTITY_LENGTH) != 0 ||
+			ptimedata->gptp_domain_number != gptp_domain_number;
+		if( gm_changed ) {
+			memcpy(ptimedata->gptp_grandmaster_id, gptp_grandmaster_id, PTP_CLOCK_IDENTITY_LENGTH);
+			ptimedata->gptp_domain_number = gptp_domain_number;
+			seqlock_publish(ptimedata);
+		}
 		/* unlock */
 		pthread_mutex_unlock((pthread_mutex_t *) shm_buffer);
+		if( gm_changed )
+			notify(true);
 	}
 	return true;
 }
@@ -1003,16 +1331,181 @@ bool LinuxSharedMemoryIPC::update_network_interface(
 		ptimedata->log_announce_interval = log_announce_interval;
 		ptimedata->log_pdelay_interval = log_pdelay_interval;
 		ptimedata->port_number   = port_number;
+		seqlock_publish(ptimedata);
 		/* unlock */
 		pthread_mutex_unlock((pthread_mutex_t *) shm_buffer);
 	}
 	return true;
 }
 
+bool LinuxSharedMemoryIPC::update_domain(
+	unsigned index,
+	uint8_t domain_number,
+	uint8_t gptp_grandmaster_id[],
+	int64_t ml_phoffset,
+	FrequencyRatio ml_freqoffset,
+	uint64_t local_time,
+	uint32_t sync_count )
+{
+	char *shm_buffer = master_offset_buffer;
+	gPtpTimeData timedata;
+
+	if( shm_buffer == NULL || index == 0 || index >= GPTP_SHM_MAX_DOMAINS )
+		return false;
+
+	pthread_mutex_lock((pthread_mutex_t *) shm_buffer);
+	/* Interface data and the local to system relation are shared with
+	   the disciplined domain */
+	timedata = *(gPtpTimeData *) (shm_buffer + sizeof(pthread_mutex_t));
+	if( timedata.local_time != 0 && timedata.ls_freqoffset != 0 ) {
+		/* system ~= local + ls_phoffset, moved to this domain's sync */
+		int64_t delta = (int64_t) ( local_time - timedata.local_time );
+		timedata.ls_phoffset += (int64_t)
+			( delta * ( 1.0 / timedata.ls_freqoffset - 1.0 ));
+	}
+	timedata.ml_phoffset = ml_phoffset;
+	timedata.ml_freqoffset = ml_freqoffset;
+	timedata.local_time = local_time;
+	memcpy(timedata.gptp_grandmaster_id, gptp_grandmaster_id,
+	       PTP_CLOCK_IDENTITY_LENGTH);
+	timedata.gptp_domain_number = domain_number;
+	timedata.sync_count = sync_count;
+	domain_publish( index, &timedata, true );
+	pthread_mutex_unlock((pthread_mutex_t *) shm_buffer);
+	notify(false);
+
+	return true;
+}
+
+/* System model servo gains, per update */
+#define SYSTEM_MODEL_KP 0.25		/*!< Phase error fraction folded into the base */
+#define SYSTEM_MODEL_KI 0.01		/*!< Phase error fraction folded into the rate */
+/* Errors beyond this are a step (new grandmaster, phase adjustment) */
+#define SYSTEM_MODEL_STEP_NS 1000000
+
+void *LinuxSharedMemoryIPC::modelThread( void *arg )
+{
+	LinuxSharedMemoryIPC *ipc = (LinuxSharedMemoryIPC *) arg;
+	struct timespec next;
+
+	clock_gettime( CLOCK_MONOTONIC, &next );
+	while( ipc->model_running ) {
+		next.tv_nsec += ipc->model_interval_us * 1000;
+		while( next.tv_nsec >= 1000000000 ) {
+			next.tv_nsec -= 1000000000;
+			++next.tv_sec;
+		}
+		clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL );
+
+		ipc->modelUpdate();
+	}
+
+	return NULL;
+}
+
+void LinuxSharedMemoryIPC::modelUpdate( void )
+{
+	gPtpSysModel *model = (gPtpSysModel *)
+		(master_offset_buffer + GPTP_SHM_MODEL_OFFSET);
+	Timestamp system_time, device_time;
+	uint32_t local_clock, nominal_clock_rate;
+	int64_t ml_phoffset;
+	FrequencyRatio ml_freqoffset, ls_freqoffset;
+	uint64_t local_time;
+	int64_t sys_ns, ptp_ns, dev_ns;
+	int64_t predicted, error;
+	int64_t sys_base, ptp_base;
+	FrequencyRatio rate;
+	uint32_t seq;
+
+	pthread_mutex_lock( &model_lock );
+	if( !model_sync_valid ) {
+		pthread_mutex_unlock( &model_lock );
+		return;
+	}
+	ml_phoffset = model_ml_phoffset;
+	ml_freqoffset = model_ml_freqoffset;
+	ls_freqoffset = model_ls_freqoffset;
+	local_time = model_local_time;
+	pthread_mutex_unlock( &model_lock );
+
+	if( !model_timestamper->HWTimestamper_gettime
+	    ( &system_time, &device_time, &local_clock, &nominal_clock_rate ))
+		return;
+
+	/* gPTP time at the cross timestamp, from the last sync */
+	sys_ns = TIMESTAMP_TO_NS( system_time );
+	dev_ns = TIMESTAMP_TO_NS( device_time );
+	ptp_ns = local_time - ml_phoffset +
+		(int64_t) ( ml_freqoffset * (int64_t) ( dev_ns - local_time ));
+
+	sys_base = model->sys_base;
+	ptp_base = model->ptp_base;
+	rate = model->rate;
+
+	/* Second order loop: the phase error is split between the base and
+	   the rate, keeping PHC/system cross timestamp noise out of readers */
+	predicted = ptp_base + (int64_t) ( rate * ( sys_ns - sys_base ));
+	error = ptp_ns - predicted;
+	if( !model->valid || error > SYSTEM_MODEL_STEP_NS ||
+	    error < -SYSTEM_MODEL_STEP_NS ) {
+		rate = ml_freqoffset * ls_freqoffset;
+		ptp_base = ptp_ns;
+	} else {
+		if( sys_ns != sys_base )
+			rate += SYSTEM_MODEL_KI *
+				((FrequencyRatio) error) / ( sys_ns - sys_base );
+		ptp_base = predicted + (int64_t) ( SYSTEM_MODEL_KP * error );
+	}
+	sys_base = sys_ns;
+
+	/* Only this thread writes the block */
+	seq = __atomic_load_n( &model->seq, __ATOMIC_RELAXED );
+	__atomic_store_n( &model->seq, seq + 1, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+	model->interval_us = model_interval_us;
+	model->sys_base = sys_base;
+	model->ptp_base = ptp_base;
+	model->rate = rate;
+	model->valid = 1;
+	__atomic_store_n( &model->seq, seq + 2, __ATOMIC_RELEASE );
+}
+
+bool LinuxSharedMemoryIPC::startSystemModel
+( CommonTimestamper *timestamper, unsigned interval_us )
+{
+	if( master_offset_buffer == NULL || timestamper == NULL ||
+	    interval_us == 0 || model_running )
+		return false;
+
+	model_timestamper = timestamper;
+	model_interval_us = interval_us;
+	model_running = true;
+	if( linuxThreadCreate( &model_thread, model_sched, modelThread, this )
+	    != 0 ) {
+		GPTP_LOG_ERROR( "Failed to start system model thread" );
+		model_running = false;
+		return false;
+	}
+
+	GPTP_LOG_STATUS( "System model updated every %u us", interval_us );
+	return true;
+}
+
+void LinuxSharedMemoryIPC::stopSystemModel( void )
+{
+	if( !model_running )
+		return;
+
+	model_running = false;
+	pthread_join( model_thread, NULL );
+}
+
 void LinuxSharedMemoryIPC::stop() {
+	stopSystemModel();
 	if( master_offset_buffer != NULL ) {
 		munmap( master_offset_buffer, SHM_SIZE );
-		shm_unlink( SHM_NAME );
+		shm_unlink( shm_name );
 	}
 }
 
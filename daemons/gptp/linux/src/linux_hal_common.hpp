@@ -46,6 +46,7 @@
 #include "ieee1588.hpp"
 #include <ether_tstamper.hpp>
 #include <linux/ethtool.h>
+#include <sys/socket.h>
 
 #include <list>
 
@@ -64,6 +65,20 @@ struct timespec;
  */
 extern Timestamp tsToTimestamp(struct timespec *ts);
 
+/**
+ * @brief  Creates a thread with the given scheduling. When the policy or CPU
+ * set can't be applied, for lack of privileges or an absent CPU, the thread
+ * is created with the default scheduling instead.
+ * @param  thread [out] Thread id
+ * @param  sched Scheduling of the thread
+ * @param  func Thread function
+ * @param  arg Thread function argument
+ * @return 0 on success, pthread_create() error otherwise
+ */
+int linuxThreadCreate
+( pthread_t *thread, const OSThreadSched &sched, void *(*func)( void * ),
+  void *arg );
+
 struct TicketingLockPrivate;
 
 /**
@@ -140,12 +155,39 @@ public:
 	 * @return TRUE if success, FALSE in case of error
 	 */
 	virtual bool post_init( int ifindex, int sd, TicketingLock *lock ) = 0;
+
+	/**
+	 * @brief  Called after a frame was sent for TX timestamping
+	 * @return void
+	 */
+	virtual void txSent() { }
+};
+
+#define LINUX_RX_BATCH 8			/*!< Event frames read with one recvmmsg() */
+#define LINUX_RX_FRAME_SIZE 256		/*!< Longest event frame kept */
+#define LINUX_RX_CONTROL_SIZE 256	/*!< Control message space per frame */
+
+/**
+ * @brief Event frames read by one recvmmsg() call, each with its receive
+ * timestamp in its control messages, handed out one per nrecv()
+ */
+struct LinuxRxBatch {
+	struct mmsghdr msgs[LINUX_RX_BATCH];
+	struct iovec iov[LINUX_RX_BATCH];
+	struct sockaddr_storage remote[LINUX_RX_BATCH];
+	uint8_t frame[LINUX_RX_BATCH][LINUX_RX_FRAME_SIZE];
+	union {
+		size_t align;	// as struct cmsghdr
+		char buf[LINUX_RX_CONTROL_SIZE];
+	} control[LINUX_RX_BATCH];
+	unsigned count;		//!< Frames read
+	unsigned next;		//!< Next frame to hand out
 };
 
 /**
  * @brief Provides a Linux network generic interface
  */
-class LinuxNetworkInterface : public OSNetworkInterface {
+class LinuxNetworkInterface final : public OSNetworkInterface {
 	friend class LinuxNetworkInterfaceFactory;
 private:
 	LinkLayerAddress local_addr;
@@ -155,6 +197,14 @@ private:
 	int ifindex;
 
 	TicketingLock net_lock;
+	LinuxRxBatch rx_batch;
+
+	/**
+	 * @brief  Reads the event frames waiting on the socket into rx_batch
+	 * @return net_succeed if at least one was read, net_trfail if there were
+	 * none, net_fatal on error
+	 */
+	net_result readRxBatch();
 public:
 	/**
 	 * @brief Sends a packet to a remote address
@@ -231,7 +281,10 @@ protected:
 	/**
 	 * @brief Default constructor
 	 */
-	LinuxNetworkInterface() {};
+	LinuxNetworkInterface() {
+		rx_batch.count = 0;
+		rx_batch.next = 0;
+	};
 };
 
 /**
@@ -248,7 +301,7 @@ typedef LinuxLockPrivate * LinuxLockPrivate_t;
 /**
  * @brief Extends OSLock generic interface to Linux
  */
-class LinuxLock : public OSLock {
+class LinuxLock final : public OSLock {
 	friend class LinuxLockFactory;
 private:
 	OSLockType type;
@@ -274,6 +327,7 @@ protected:
 	 */
 	~LinuxLock();
 
+public:
 	/**
 	 * @brief  Provides a simple lock mechanism.
 	 * @return oslock_fail if lock has failed, oslock_ok otherwise.
@@ -384,15 +438,14 @@ public:
 	}
 };
 
-struct LinuxTimerQueueActionArg;
+#define LINUX_TIMERQ_SLOTS 128	/*!< Number of timer events that can be pending at once */
+#define LINUX_TIMERQ_TYPE_BUCKETS 32	/*!< Event type hash buckets; covers every Event value */
 
-/**
- * @brief Provides a map type for the LinuxTimerQueue class
- */
-typedef std::map < int, struct LinuxTimerQueueActionArg *> LinuxTimerQueueMap_t;
+struct LinuxTimerQueueActionArg;
 
 /**
- * @brief  Linux timer queue handler. Deals with linux queues
+ * @brief  Linux timer queue handler. Waits on the queue's timerfd and
+ * fires the expired events.
  * @param  arg [in] LinuxTimerQueue arguments
  * @return void
  */
@@ -406,17 +459,27 @@ typedef struct LinuxTimerQueuePrivate * LinuxTimerQueuePrivate_t;
 
 /**
  * @brief Extends OSTimerQueue to Linux
+ *
+ * All events share one timerfd that is armed for the earliest deadline
+ * of a min-heap. Events live in LINUX_TIMERQ_SLOTS preallocated slots,
+ * so adding, cancelling and firing them does not allocate. Each slot
+ * keeps its heap position and sits on a list per event type, so
+ * cancelEvent() only visits the events of that type and removes each
+ * one of the given port in O(log n).
  */
-class LinuxTimerQueue : public OSTimerQueue {
+class LinuxTimerQueue final : public OSTimerQueue {
 	friend class LinuxTimerQueueFactory;
 	friend void *LinuxTimerQueueHandler( void * arg );
 private:
-	LinuxTimerQueueMap_t timerQueueMap;
-	int key;
 	bool stop;
 	LinuxTimerQueuePrivate_t _private;
 	OSLock *lock;
 	void LinuxTimerQueueAction( LinuxTimerQueueActionArg *arg );
+	void heapSwap( unsigned i, unsigned j );
+	void heapUp( unsigned pos );
+	void heapDown( unsigned pos );
+	void heapRemove( unsigned pos );
+	void arm();
 protected:
 	/**
 	 * @brief Default constructor
@@ -453,16 +516,19 @@ public:
 	/**
 	 * @brief Removes an event from the timer queue
 	 * @param type Event type
+	 * @param port Only remove events of this port, NULL for every port
 	 * @param event [inout] Pointer to the event
 	 * @return TRUE success, FALSE fail
 	 */
-	bool cancelEvent( int type, unsigned *event );
+	bool cancelEvent( int type, CommonPort *port, unsigned *event );
 };
 
 /**
  * @brief Implements factory design pattern for linux
  */
 class LinuxTimerQueueFactory : public OSTimerQueueFactory {
+private:
+	OSThreadSched sched;
 public:
 	/**
 	 * @brief Creates Linux timer queue
@@ -470,6 +536,14 @@ public:
 	 * @return Pointer to OSTimerQueue
 	 */
 	virtual OSTimerQueue *createOSTimerQueue( IEEE1588Clock *clock );
+
+	/**
+	 * @brief Sets the scheduling of the timer queue threads created afterwards
+	 * @param sched_cfg Scheduling
+	 */
+	void setSched( const OSThreadSched &sched_cfg ) {
+		sched = sched_cfg;
+	}
 };
 
 /**
@@ -536,6 +610,7 @@ class LinuxThread : public OSThread {
  private:
 	LinuxThreadPrivate_t _private;
 	OSThreadArg *arg_inner;
+	OSThreadSched sched;
  public:
 	/**
 	 * @brief  Starts a new thread
@@ -560,13 +635,27 @@ class LinuxThread : public OSThread {
  * @brief Provides factory design pattern for LinuxThread class
  */
 class LinuxThreadFactory:public OSThreadFactory {
+ private:
+	 OSThreadSched sched[OSTHREAD_ROLE_COUNT];
  public:
 	 /**
 	  * @brief Creates a new LinuxThread
+	  * @param role What the thread is used for, selects its scheduling
 	  * @return Pointer to LinuxThread object
 	  */
-	 OSThread *createThread() const {
-		 return new LinuxThread();
+	 OSThread *createThread( OSThreadRole role = OSTHREAD_ROLE_DEFAULT ) const {
+		 LinuxThread *thread = new LinuxThread();
+		 thread->sched = sched[role];
+		 return thread;
+	 }
+
+	 /**
+	  * @brief Sets the scheduling of threads created afterwards
+	  * @param role Threads to schedule
+	  * @param sched_cfg Scheduling
+	  */
+	 void setSched( OSThreadRole role, const OSThreadSched &sched_cfg ) {
+		 sched[role] = sched_cfg;
 	 }
 };
 
@@ -590,39 +679,106 @@ public:
 /**
  * @brief Extends IPC ARG generic interface to linux
  */
+#define DEFAULT_GROUPNAME "ptp"		/*!< Default groupname for the shared memory interface*/
+#define MAX_SHM_NAME 32				/*!< Longest shared memory name accepted*/
+
 class LinuxIPCArg : public OS_IPC_ARG {
 private:
 	char *group_name;
+	char shm_name[MAX_SHM_NAME];
 public:
 	/**
 	 * @brief  Initializes IPCArg object
-	 * @param group_name [in] Group's name
+	 * @param group_name [in] Group's name, NULL for DEFAULT_GROUPNAME
+	 * @param shm_name [in] Shared memory name, NULL for SHM_NAME
 	 */
-	LinuxIPCArg( char *group_name ) {
+	LinuxIPCArg( const char *group_name, const char *shm_name = NULL ) {
+		if( group_name == NULL )
+			group_name = DEFAULT_GROUPNAME;
 		int len = strnlen(group_name,16);
 		this->group_name = new char[len+1];
 		strncpy( this->group_name, group_name, len+1 );
 		this->group_name[len] = '\0';
+		setShmName( shm_name );
+	}
+	/**
+	 * @brief  Sets the shared memory name, a leading '/' is added if missing
+	 * @param  shm_name [in] Shared memory name, NULL for SHM_NAME
+	 * @return void
+	 */
+	void setShmName( const char *shm_name ) {
+		this->shm_name[0] = '\0';
+		if( shm_name != NULL && shm_name[0] != '\0' )
+			snprintf( this->shm_name, sizeof(this->shm_name), "%s%s",
+				  shm_name[0] == '/' ? "" : "/", shm_name );
 	}
 	/**
 	 * @brief Destroys IPCArg internal variables
 	 */
 	virtual ~LinuxIPCArg() {
-		delete group_name;
+		delete [] group_name;
 	}
 	friend class LinuxSharedMemoryIPC;
 };
 
-#define DEFAULT_GROUPNAME "ptp"		/*!< Default groupname for the shared memory interface*/
-
 /**
  * @brief Linux shared memory interface
  */
+#define SYSTEM_MODEL_INTERVAL_US 10000	/*!< Default system model update period*/
+
 class LinuxSharedMemoryIPC:public OS_IPC {
 private:
 	int shm_fd;
 	char *master_offset_buffer;
+	char shm_name[MAX_SHM_NAME];
 	int err;
+
+	/* System model servo */
+	CommonTimestamper *model_timestamper;
+	unsigned model_interval_us;
+	pthread_t model_thread;
+	OSThreadSched model_sched;
+	bool model_running;
+	pthread_mutex_t model_lock;		/* Guards the sync values below */
+	bool model_sync_valid;
+	int64_t model_ml_phoffset;
+	FrequencyRatio model_ml_freqoffset;
+	FrequencyRatio model_ls_freqoffset;
+	uint64_t model_local_time;
+
+	static void *modelThread( void *arg );
+
+	/**
+	 * @brief  Runs one system model servo iteration and publishes it
+	 * @return void
+	 */
+	void modelUpdate( void );
+
+	/**
+	 * @brief  Marks the seqlock block valid for lock free readers
+	 */
+	void seqlock_init();
+
+	/**
+	 * @brief  Copies the time data into the seqlock block
+	 * @param  ptimedata Legacy copy, updated with the mutex held
+	 */
+	void seqlock_publish( const gPtpTimeData *ptimedata );
+
+	/**
+	 * @brief  Copies time data into a slot of the domain region
+	 * @param  index Domain slot
+	 * @param  ptimedata Time data of the domain
+	 * @param  valid The data holds a sync result
+	 */
+	void domain_publish
+	( unsigned index, const gPtpTimeData *ptimedata, bool valid );
+
+	/**
+	 * @brief  Bumps the notification counters and wakes waiting clients
+	 * @param  gm_changed Also count a grandmaster change
+	 */
+	void notify( bool gm_changed );
 public:
 	/**
 	 * @brief Initializes the internal flags
@@ -631,6 +787,12 @@ public:
 		shm_fd = 0;
 		err = 0;
 		master_offset_buffer = NULL;
+		shm_name[0] = '\0';
+		model_timestamper = NULL;
+		model_interval_us = 0;
+		model_running = false;
+		model_sync_valid = false;
+		pthread_mutex_init( &model_lock, NULL );
 	};
 	/**
 	 * @brief Destroys and unlinks shared memory
@@ -712,6 +874,60 @@ public:
 		int8_t   log_pdelay_interval,
 		uint16_t port_number );
 
+	/**
+	 * @brief  Publishes the sync result of an additional gPTP domain. The
+	 * local to system values are taken from the disciplined domain.
+	 * @param  index Domain slot, starting at 1
+	 * @param  domain_number gPTP domain number
+	 * @param  gptp_grandmaster_id Grandmaster of the domain
+	 * @param  ml_phoffset Master to local phase offset
+	 * @param  ml_freqoffset Master to local frequency offset
+	 * @param  local_time Local time of the sync
+	 * @param  sync_count Sync messages of the domain used so far
+	 * @return FALSE if the slot is out of range
+	 */
+	virtual bool update_domain(
+		unsigned index,
+		uint8_t domain_number,
+		uint8_t gptp_grandmaster_id[],
+		int64_t ml_phoffset,
+		FrequencyRatio ml_freqoffset,
+		uint64_t local_time,
+		uint32_t sync_count );
+
+	/**
+	 * @brief  Starts the thread that keeps the system to gPTP time model
+	 * in shared memory up to date
+	 * @param  timestamper Timestamper of the port whose clock is disciplined
+	 * @param  interval_us Update period
+	 * @return TRUE if the thread was started
+	 */
+	bool startSystemModel
+	( CommonTimestamper *timestamper, unsigned interval_us );
+
+	/**
+	 * @brief  Sets the scheduling of the system model thread
+	 * @param  sched Scheduling, applied when the thread is started
+	 * @return void
+	 */
+	void setSystemModelSched( const OSThreadSched &sched ) {
+		model_sched = sched;
+	}
+
+	/**
+	 * @brief  Stops the system model thread
+	 * @return void
+	 */
+	void stopSystemModel( void );
+
+	/**
+	 * @brief  Gets a port's slot in the shared memory stats region
+	 * @param  index Port index, starting at 0
+	 * @return Port statistics storage, NULL if index is out of range or the
+	 * shared memory is not mapped
+	 */
+	virtual gPtpPortStats *getPortStats( unsigned index );
+
 	/**
 	 * @brief unmaps and unlink shared memory
 	 * @return void
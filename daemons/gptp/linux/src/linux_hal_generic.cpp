@@ -47,92 +47,130 @@
 #include <linux/ptp_clock.h>
 #include <syscall.h>
 #include <limits.h>
+#include <poll.h>
+#include <linux/errqueue.h>
 
 #define TX_PHY_TIME 184
 #define RX_PHY_TIME 382
 
-net_result LinuxNetworkInterface::nrecv
-( LinkLayerAddress *addr, uint8_t *payload, size_t &length )
+net_result LinuxNetworkInterface::readRxBatch()
 {
 	fd_set readfds;
 	int err;
-	struct msghdr msg;
-	struct cmsghdr *cmsg;
-	struct {
-		struct cmsghdr cm;
-		char control[256];
-	} control;
-	struct sockaddr_ll remote;
-	struct iovec sgentry;
-	net_result ret = net_succeed;
-	bool got_net_lock;
-
-	LinuxTimestamperGeneric *gtimestamper;
+	unsigned i;
 
 	struct timeval timeout = { 0, 16000 }; // 16 ms
 
-	if( !net_lock.lock( &got_net_lock )) {
-		GPTP_LOG_ERROR("A Failed to lock mutex");
-		return net_fatal;
-	}
-	if( !got_net_lock ) {
-		return net_trfail;
-	}
-
 	FD_ZERO( &readfds );
 	FD_SET( sd_event, &readfds );
 
 	err = select( sd_event+1, &readfds, NULL, NULL, &timeout );
 	if( err == 0 ) {
-		ret = net_trfail;
-		goto done;
+		return net_trfail;
 	} else if( err == -1 ) {
 		if( err == EINTR ) {
 			// Caught signal
 			GPTP_LOG_ERROR("select() recv signal");
-			ret = net_trfail;
-			goto done;
+			return net_trfail;
 		} else {
 			GPTP_LOG_ERROR("select() failed");
-			ret = net_fatal;
-			goto done;
-    }
+			return net_fatal;
+		}
 	} else if( !FD_ISSET( sd_event, &readfds )) {
-		ret = net_trfail;
-		goto done;
+		return net_trfail;
 	}
 
-	memset( &msg, 0, sizeof( msg ));
-
-	msg.msg_iov = &sgentry;
-	msg.msg_iovlen = 1;
+	for( i = 0; i < LINUX_RX_BATCH; ++i ) {
+		struct msghdr *msg = &rx_batch.msgs[i].msg_hdr;
 
-	sgentry.iov_base = payload;
-	sgentry.iov_len = length;
+		rx_batch.iov[i].iov_base = rx_batch.frame[i];
+		rx_batch.iov[i].iov_len = LINUX_RX_FRAME_SIZE;
 
-	memset( &remote, 0, sizeof(remote));
-	msg.msg_name = (caddr_t) &remote;
-	msg.msg_namelen = sizeof( remote );
-	msg.msg_control = &control;
-	msg.msg_controllen = sizeof(control);
+		memset( msg, 0, sizeof( *msg ));
+		msg->msg_iov = &rx_batch.iov[i];
+		msg->msg_iovlen = 1;
+		msg->msg_name = &rx_batch.remote[i];
+		msg->msg_namelen = sizeof( rx_batch.remote[i] );
+		msg->msg_control = &rx_batch.control[i];
+		msg->msg_controllen = sizeof( rx_batch.control[i] );
+	}
 
-	err = recvmsg( sd_event, &msg, 0 );
+	// Everything already queued, a burst from fast sync and pdelay
+	// exchanges costs one call
+	err = recvmmsg( sd_event, rx_batch.msgs, LINUX_RX_BATCH, MSG_DONTWAIT, NULL );
 	if( err < 0 ) {
-		if( errno == ENOMSG ) {
-			GPTP_LOG_ERROR("Got ENOMSG: %s:%d", __FILE__, __LINE__);
-			ret = net_trfail;
-			goto done;
+		if( errno == ENOMSG || errno == EAGAIN || errno == EWOULDBLOCK ) {
+			if( errno == ENOMSG )
+				GPTP_LOG_ERROR("Got ENOMSG: %s:%d", __FILE__, __LINE__);
+			return net_trfail;
 		}
-		GPTP_LOG_ERROR("recvmsg() failed: %s", strerror(errno));
-		ret = net_fatal;
-		goto done;
+		GPTP_LOG_ERROR("recvmmsg() failed: %s", strerror(errno));
+		return net_fatal;
+	}
+	if( err == 0 ) {
+		return net_trfail;
 	}
-	*addr = LinkLayerAddress( remote.sll_addr );
 
+	rx_batch.count = err;
+	rx_batch.next = 0;
+
+	return net_succeed;
+}
+
+net_result LinuxNetworkInterface::nrecv
+( LinkLayerAddress *addr, uint8_t *payload, size_t &length )
+{
+	struct msghdr *msg;
+	struct cmsghdr *cmsg;
+	struct sockaddr_ll *remote;
+	uint8_t *frame;
+	size_t frame_len;
+	net_result ret = net_succeed;
+	bool got_net_lock;
+
+	LinuxTimestamperGeneric *gtimestamper;
+
+	if( !net_lock.lock( &got_net_lock )) {
+		GPTP_LOG_ERROR("A Failed to lock mutex");
+		return net_fatal;
+	}
+	if( !got_net_lock ) {
+		return net_trfail;
+	}
+
+	if( rx_batch.next == rx_batch.count ) {
+		ret = readRxBatch();
+		if( ret != net_succeed )
+			goto done;
+	}
+
+	msg = &rx_batch.msgs[rx_batch.next].msg_hdr;
+	frame = rx_batch.frame[rx_batch.next];
+	frame_len = rx_batch.msgs[rx_batch.next].msg_len;
+	remote = (struct sockaddr_ll *) &rx_batch.remote[rx_batch.next];
+	++rx_batch.next;
+
+	if( frame_len > length )
+		frame_len = length;
+	memcpy( payload, frame, frame_len );
+	*addr = LinkLayerAddress( remote->sll_addr );
+
+#ifdef GPTP_STATIC_HAL
+	gtimestamper = static_cast<LinuxTimestamperGeneric *>(timestamper);
+#else
 	gtimestamper = dynamic_cast<LinuxTimestamperGeneric *>(timestamper);
-	if( err > 0 && !(payload[0] & 0x8) && gtimestamper != NULL ) {
-		/* Retrieve the timestamp */
-		cmsg = CMSG_FIRSTHDR(&msg);
+#endif
+	if( frame_len >= PTP_COMMON_HDR_LENGTH && !(payload[0] & 0x8) && gtimestamper != NULL ) {
+		MessageType messageType = (MessageType)
+			(payload[PTP_COMMON_HDR_TRANSSPEC_MSGTYPE(PTP_COMMON_HDR_OFFSET)] & 0xF);
+		uint16_t sequenceId;
+		memcpy( &sequenceId,
+			payload + PTP_COMMON_HDR_SEQUENCE_ID(PTP_COMMON_HDR_OFFSET),
+			sizeof(sequenceId) );
+		sequenceId = PLAT_ntohs( sequenceId );
+
+		/* The timestamp came with the frame */
+		cmsg = CMSG_FIRSTHDR(msg);
 		while( cmsg != NULL ) {
 			if
 				( cmsg->cmsg_level == SOL_SOCKET &&
@@ -142,18 +180,18 @@ net_result LinuxNetworkInterface::nrecv
 				ts_system = ((struct timespec *) CMSG_DATA(cmsg)) + 1;
 				system = tsToTimestamp( ts_system );
 				ts_device = ts_system + 1; device = tsToTimestamp( ts_device );
-				gtimestamper->pushRXTimestamp( &device );
+				gtimestamper->pushRXTimestamp( &device, messageType, sequenceId );
 				break;
 			}
-			cmsg = CMSG_NXTHDR(&msg,cmsg);
+			cmsg = CMSG_NXTHDR(msg,cmsg);
 		}
 	}
 
-	length = err;
+	length = frame_len;
 
  done:
 	if( !net_lock.unlock()) {
-		GPTP_LOG_ERROR("A Failed to unlock, %d", err);
+		GPTP_LOG_ERROR("A Failed to unlock");
 		return net_fatal;
 	}
 
@@ -206,6 +244,10 @@ LinuxTimestamperGeneric::LinuxTimestamperGeneric() {
 	igb_private = NULL;
 #endif
 	sd = -1;
+	tx_opt_id = false;
+	tx_key_next = 0;
+	tx_key_expected = 0;
+	clearRxTimestamps();
 }
 
 bool LinuxTimestamperGeneric::Adjust( void *tmx ) const {
@@ -281,6 +323,7 @@ int LinuxTimestamperGeneric::HWTimestamper_txtimestamp
 {
 	int err;
 	int ret = GPTP_EC_EAGAIN;
+	bool waited = false;
 	struct msghdr msg;
 	struct cmsghdr *cmsg;
 	struct sockaddr_ll remote;
@@ -291,53 +334,93 @@ int LinuxTimestamperGeneric::HWTimestamper_txtimestamp
 	} control;
 
     if( sd == -1 ) return -1;
-	memset( &msg, 0, sizeof( msg ));
-
-	msg.msg_iov = &sgentry;
-	msg.msg_iovlen = 1;
-
-	sgentry.iov_base = NULL;
-	sgentry.iov_len = 0;
 
-	memset( &remote, 0, sizeof(remote));
-	msg.msg_name = (caddr_t) &remote;
-	msg.msg_namelen = sizeof( remote );
-	msg.msg_control = &control;
-	msg.msg_controllen = sizeof(control);
-
-	err = recvmsg( sd, &msg, MSG_ERRQUEUE );
-	if( err == -1 ) {
-		if( errno == EAGAIN ) {
-			ret = GPTP_EC_EAGAIN;
-			goto done;
+	for( ;; ) {
+		bool have_key = false;
+		uint32_t key = 0;
+
+		memset( &msg, 0, sizeof( msg ));
+
+		msg.msg_iov = &sgentry;
+		msg.msg_iovlen = 1;
+
+		sgentry.iov_base = NULL;
+		sgentry.iov_len = 0;
+
+		memset( &remote, 0, sizeof(remote));
+		msg.msg_name = (caddr_t) &remote;
+		msg.msg_namelen = sizeof( remote );
+		msg.msg_control = &control;
+		msg.msg_controllen = sizeof(control);
+
+		err = recvmsg( sd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT );
+		if( err == -1 ) {
+			if( errno == EAGAIN && !waited ) {
+				// Sleep until the error queue has something (POLLERR)
+				// rather than having the caller poll it on a timer
+				struct pollfd pfd;
+				struct timespec timeout;
+				pfd.fd = sd;
+				pfd.events = 0;
+				timeout.tv_sec = 0;
+				timeout.tv_nsec = TX_TIMESTAMP_WAIT_USEC * 1000;
+				waited = true;
+				if( ppoll( &pfd, 1, &timeout, NULL ) > 0 )
+					continue;
+				ret = GPTP_EC_EAGAIN;
+				goto done;
+			}
+			else if( errno == EAGAIN ) {
+				ret = GPTP_EC_EAGAIN;
+				goto done;
+			}
+			else {
+				ret = GPTP_EC_FAILURE;
+				goto done;
+			}
 		}
-		else {
-			ret = GPTP_EC_FAILURE;
-			goto done;
+
+		// Retrieve the timestamp and, with SOF_TIMESTAMPING_OPT_ID, its key
+		cmsg = CMSG_FIRSTHDR(&msg);
+		while( cmsg != NULL ) {
+			if( cmsg->cmsg_level == SOL_SOCKET &&
+				cmsg->cmsg_type == SO_TIMESTAMPING ) {
+				struct timespec *ts_device, *ts_system;
+				Timestamp device, system;
+				ts_system = ((struct timespec *) CMSG_DATA(cmsg)) + 1;
+				system = tsToTimestamp( ts_system );
+				ts_device = ts_system + 1; device = tsToTimestamp( ts_device );
+				system._version = version;
+				device._version = version;
+				timestamp = device;
+				ret = 0;
+			}
+			else if( cmsg->cmsg_level == SOL_PACKET &&
+				 cmsg->cmsg_type == PACKET_TX_TIMESTAMP ) {
+				struct sock_extended_err *serr =
+					(struct sock_extended_err *) CMSG_DATA(cmsg);
+				if( serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING ) {
+					key = serr->ee_data;
+					have_key = true;
+				}
+			}
+			cmsg = CMSG_NXTHDR(&msg,cmsg);
 		}
-	}
 
-	// Retrieve the timestamp
-	cmsg = CMSG_FIRSTHDR(&msg);
-	while( cmsg != NULL ) {
-		if( cmsg->cmsg_level == SOL_SOCKET &&
-			cmsg->cmsg_type == SO_TIMESTAMPING ) {
-			struct timespec *ts_device, *ts_system;
-			Timestamp device, system;
-			ts_system = ((struct timespec *) CMSG_DATA(cmsg)) + 1;
-			system = tsToTimestamp( ts_system );
-			ts_device = ts_system + 1; device = tsToTimestamp( ts_device );
-			system._version = version;
-			device._version = version;
-			timestamp = device;
-			ret = 0;
+		if( ret != 0 ) {
+			GPTP_LOG_ERROR("Received a error message, but didn't find a valid timestamp");
 			break;
 		}
-		cmsg = CMSG_NXTHDR(&msg,cmsg);
-	}
 
-	if( ret != 0 ) {
-		GPTP_LOG_ERROR("Received a error message, but didn't find a valid timestamp");
+		// A timestamp for a frame sent before the current one belongs
+		// to a message whose retrieval already gave up, skip it
+		if( tx_opt_id && have_key && (int32_t)(key - tx_key_expected) < 0 ) {
+			GPTP_LOG_VERBOSE("Dropping stale TX timestamp (key %u, expected %u)",
+					 key, tx_key_expected );
+			ret = GPTP_EC_EAGAIN;
+			continue;
+		}
+		break;
 	}
 
  done:
@@ -381,9 +464,24 @@ bool LinuxTimestamperGeneric::post_init( int ifindex, int sd, TicketingLock *loc
 	timestamp_flags |= SOF_TIMESTAMPING_RX_HARDWARE;
 	timestamp_flags |= SOF_TIMESTAMPING_SYS_HARDWARE;
 	timestamp_flags |= SOF_TIMESTAMPING_RAW_HARDWARE;
-	err = setsockopt
-		( sd, SOL_SOCKET, SO_TIMESTAMPING, &timestamp_flags,
-		  sizeof(timestamp_flags) );
+
+	// Tag TX timestamps with a per-socket send counter so they can be
+	// matched to the message sent. Kernels older than 3.19 lack these.
+	{
+		int opt_id_flags = timestamp_flags |
+			SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+		err = setsockopt
+			( sd, SOL_SOCKET, SO_TIMESTAMPING, &opt_id_flags,
+			  sizeof(opt_id_flags) );
+		tx_opt_id = err != -1;
+		tx_key_next = 0;
+	}
+	if( !tx_opt_id ) {
+		GPTP_LOG_INFO("SOF_TIMESTAMPING_OPT_ID not supported, TX timestamps are not matched");
+		err = setsockopt
+			( sd, SOL_SOCKET, SO_TIMESTAMPING, &timestamp_flags,
+			  sizeof(timestamp_flags) );
+	}
 	if( err == -1 ) {
 		GPTP_LOG_ERROR
 			("Failed to configure timestamping on socket: %s",
@@ -44,6 +44,19 @@ struct LinuxTimestamperGenericPrivate;
  */
 typedef struct LinuxTimestamperGenericPrivate * LinuxTimestamperGenericPrivate_t;
 
+#define TX_TIMESTAMP_WAIT_USEC 1000	/*!< Longest wait for a TX timestamp per HWTimestamper_txtimestamp call */
+#define RX_TIMESTAMP_RING_SIZE 64	/*!< RX timestamps kept, must be a power of 2 */
+
+/**
+ * @brief RX timestamp waiting to be claimed by the message it belongs to
+ */
+struct RxTimestampEntry {
+	Timestamp timestamp;
+	uint16_t sequenceId;
+	MessageType messageType;
+	bool valid;
+};
+
 #ifdef WITH_IGBLIB
 struct LinuxTimestamperIGBPrivate;
 typedef struct LinuxTimestamperIGBPrivate * LinuxTimestamperIGBPrivate_t;
@@ -52,7 +65,7 @@ typedef struct LinuxTimestamperIGBPrivate * LinuxTimestamperIGBPrivate_t;
 /**
  * @brief Linux timestamper generic interface
  */
-class LinuxTimestamperGeneric : public LinuxTimestamper {
+class LinuxTimestamperGeneric final : public LinuxTimestamper {
 private:
 	int sd;
 	int phc_fd;
@@ -60,7 +73,10 @@ private:
 	Timestamp crstamp_device;
 	LinuxTimestamperGenericPrivate_t _private;
 	bool cross_stamp_good;
-	std::list<Timestamp> rxTimestampList;
+	RxTimestampEntry rxTimestampRing[RX_TIMESTAMP_RING_SIZE];
+	bool tx_opt_id;
+	uint32_t tx_key_next;
+	uint32_t tx_key_expected;
 	LinuxNetworkInterfaceList iface_list;
 #ifdef PTP_HW_CROSSTSTAMP
 	bool precise_timestamp_enabled;
@@ -109,14 +125,44 @@ public:
 	virtual void HWTimestamper_reset();
 
 	/**
-	 * @brief  Inserts a new timestamp to the beginning of the
-	 * RX timestamp list.
+	 * @brief  Gets the RX timestamp ring slot of a message. The low
+	 * bits of the message type keep sync, pdelay request and pdelay
+	 * response with the same sequence ID apart, so the ring holds the
+	 * last RX_TIMESTAMP_RING_SIZE / 4 sequence IDs of each.
+	 * @param  messageType Message type
+	 * @param  sequenceId Sequence ID
+	 * @return Slot index
+	 */
+	static unsigned rxTimestampSlot( MessageType messageType, uint16_t sequenceId ) {
+		return (((unsigned) sequenceId << 2) | ((unsigned) messageType & 0x3))
+			& (RX_TIMESTAMP_RING_SIZE - 1);
+	}
+
+	/**
+	 * @brief  Drops every RX timestamp waiting in the ring
+	 * @return void
+	 */
+	void clearRxTimestamps() {
+		for( unsigned i = 0; i < RX_TIMESTAMP_RING_SIZE; ++i ) {
+			rxTimestampRing[i].valid = false;
+		}
+	}
+
+	/**
+	 * @brief  Stores the RX timestamp of an event message, replacing
+	 * whatever stale timestamp was in its slot.
 	 * @param tstamp [in] RX timestamp
+	 * @param messageType Type of the received message
+	 * @param sequenceId Sequence ID of the received message
 	 * @return void
 	 */
-	void pushRXTimestamp( Timestamp *tstamp ) {
+	void pushRXTimestamp( Timestamp *tstamp, MessageType messageType, uint16_t sequenceId ) {
+		RxTimestampEntry *entry = &rxTimestampRing[rxTimestampSlot( messageType, sequenceId )];
 		tstamp->_version = version;
-		rxTimestampList.push_front(*tstamp);
+		entry->timestamp = *tstamp;
+		entry->messageType = messageType;
+		entry->sequenceId = sequenceId;
+		entry->valid = true;
 	}
 
 	/**
@@ -128,6 +174,15 @@ public:
 	 */
 	bool post_init( int ifindex, int sd, TicketingLock *lock );
 
+	/**
+	 * @brief  Records the SOF_TIMESTAMPING_OPT_ID key of the frame just
+	 * sent, so HWTimestamper_txtimestamp can skip stale timestamps.
+	 * @return void
+	 */
+	void txSent() {
+		tx_key_expected = tx_key_next++;
+	}
+
 	/**
 	 * @brief  Gets the ptp clock time information
 	 * @param  system_time [out] System time
@@ -166,10 +221,16 @@ public:
 	virtual int HWTimestamper_rxtimestamp
 	( PortIdentity *identity, PTPMessageId messageId, Timestamp &timestamp,
 	  unsigned &clock_value, bool last ) {
+		RxTimestampEntry *entry = &rxTimestampRing
+			[rxTimestampSlot( messageId.getMessageType(), messageId.getSequenceId() )];
+
 		/* This shouldn't happen. Ever. */
-		if( rxTimestampList.empty() ) return GPTP_EC_EAGAIN;
-		timestamp = rxTimestampList.back();
-		rxTimestampList.pop_back();
+		if( !entry->valid ||
+		    entry->messageType != messageId.getMessageType() ||
+		    entry->sequenceId != messageId.getSequenceId() )
+			return GPTP_EC_EAGAIN;
+		timestamp = entry->timestamp;
+		entry->valid = false;
 
 		return GPTP_EC_SUCCESS;
 	}
@@ -62,7 +62,7 @@ bool LinuxTimestamperGeneric::HWTimestamper_adjclockphase( int64_t phase_adjust
 		(*iface_iter)->disable_rx_queue();
 	}
 		
-	rxTimestampList.clear();
+	clearRxTimestamps();
 		
 	/* Wait 180 ms - This is plenty of time for any time sync frames
 	   to clear the queue */
@@ -35,8 +35,153 @@
 #define LINUXIPC_HPP
 
 #include "ipcdef.hpp"
+#include "gptp_stats.hpp"
 
-#define SHM_SIZE (sizeof(gPtpTimeData) + sizeof(pthread_mutex_t))   /*!< Shared memory size*/
+#include <pthread.h>
+
+/*
+ * Shared memory layout:
+ *
+ *   offset 0                        pthread_mutex_t + gPtpTimeData (legacy,
+ *                                   for clients that lock the mutex)
+ *   offset GPTP_SHM_SEQLOCK_OFFSET  gPtpSeqlockData (lock free readers)
+ *   offset GPTP_SHM_MODEL_OFFSET    gPtpSysModel (system to gPTP time model)
+ *   offset GPTP_SHM_NOTIFY_OFFSET   gPtpNotify (update counters, futex)
+ *   offset GPTP_SHM_DOMAIN_OFFSET   gPtpDomainRegion (time data per domain)
+ *   offset GPTP_SHM_STATS_OFFSET    gPtpStatsRegion (per-port statistics)
+ *
+ * Both copies are updated together. Seqlock readers sample seq, copy the
+ * data and retry if seq was odd or changed meanwhile; they never block the
+ * daemon. The seqlock block sits inside the first page so a new client that
+ * maps an older daemon's segment reads zeros there and falls back to the
+ * mutex.
+ */
+#define GPTP_SHM_SEQLOCK_OFFSET		512			/*!< Offset of the seqlock block*/
+#define GPTP_SHM_SEQLOCK_MAGIC		0x67505453	/*!< "gPTS", set once the block is valid*/
+#define GPTP_SHM_SEQLOCK_VERSION	1			/*!< Seqlock block layout version*/
+
+/**
+ * @brief Seqlock protected copy of the gPTP time data
+ */
+typedef struct {
+	uint32_t magic;			//!< GPTP_SHM_SEQLOCK_MAGIC when initialized
+	uint32_t version;		//!< GPTP_SHM_SEQLOCK_VERSION
+	uint32_t seq;			//!< Odd while the daemon is writing
+	uint32_t data_size;		//!< sizeof(gPtpTimeData) as seen by the daemon
+	gPtpTimeData data;		//!< Same contents as the legacy copy
+} gPtpSeqlockData;
+
+/*
+ * The system model maps CLOCK_REALTIME to gPTP time:
+ *
+ *   ptp ~= ptp_base + (realtime - sys_base) * rate
+ *
+ * It is refreshed every interval_us from a PHC/system cross timestamp and
+ * the last sync, so readers need no extrapolation from the sync time. It is
+ * published with the same seqlock protocol and is only meaningful while
+ * valid is set.
+ */
+#define GPTP_SHM_MODEL_OFFSET		1024		/*!< Offset of the system model block*/
+#define GPTP_SHM_MODEL_MAGIC		0x6750544D	/*!< "gPTM", set once the block is initialized*/
+#define GPTP_SHM_MODEL_VERSION		1			/*!< System model layout version*/
+
+/**
+ * @brief Filtered CLOCK_REALTIME to gPTP time model
+ */
+typedef struct {
+	uint32_t magic;			//!< GPTP_SHM_MODEL_MAGIC when initialized
+	uint32_t version;		//!< GPTP_SHM_MODEL_VERSION
+	uint32_t seq;			//!< Odd while the daemon is writing
+	uint32_t interval_us;	//!< Update period
+	int64_t sys_base;		//!< CLOCK_REALTIME at the model base (ns)
+	int64_t ptp_base;		//!< gPTP time at sys_base (ns)
+	FrequencyRatio rate;	//!< gPTP time elapsed per system time
+	uint32_t valid;			//!< Non-zero once synchronized
+} gPtpSysModel;
+
+/*
+ * Update notification. update_count goes up by one each time the daemon
+ * publishes a new sync result and gm_count each time the grandmaster
+ * changes; a grandmaster change also bumps update_count. Clients cache what
+ * they read and refresh it only when update_count moved, and can block on
+ * update_count with FUTEX_WAIT (not the private variant, the segment is
+ * shared between processes). A client increments waiters before it
+ * re-checks update_count and waits, and decrements it afterwards, so the
+ * daemon only calls FUTEX_WAKE when somebody is waiting.
+ */
+#define GPTP_SHM_NOTIFY_OFFSET		1536		/*!< Offset of the notification block*/
+#define GPTP_SHM_NOTIFY_MAGIC		0x6750544E	/*!< "gPTN", set once the block is initialized*/
+#define GPTP_SHM_NOTIFY_VERSION		1			/*!< Notification block layout version*/
+
+/**
+ * @brief Update counters for clients to poll or wait on
+ */
+typedef struct {
+	uint32_t magic;			//!< GPTP_SHM_NOTIFY_MAGIC when initialized
+	uint32_t version;		//!< GPTP_SHM_NOTIFY_VERSION
+	uint32_t update_count;	//!< New sync result published (futex word)
+	uint32_t gm_count;		//!< Grandmaster changed
+	uint32_t waiters;		//!< Clients blocked on update_count
+} gPtpNotify;
+
+/*
+ * Per-domain time data, one slot per gPTP domain the daemon follows, each
+ * published with the seqlock protocol. Slot 0 is the domain the clock is
+ * disciplined to and carries the same data as the seqlock block; the other
+ * slots are domains followed with -DOMAIN. All slots describe the same
+ * local clock, so the local to system fields of every slot come from the
+ * disciplined domain. A new sync result of any domain also moves
+ * update_count in the notification block. The region lies in the first page
+ * like the blocks above, so clients of an older daemon find no magic.
+ */
+#define GPTP_SHM_DOMAIN_OFFSET		2048		/*!< Offset of the domain region*/
+#define GPTP_SHM_DOMAIN_MAGIC		0x67505444	/*!< "gPTD", set once the region is initialized*/
+#define GPTP_SHM_DOMAIN_VERSION		1			/*!< Domain region layout version*/
+#define GPTP_SHM_MAX_DOMAINS		4			/*!< Domains the region has room for*/
+
+/**
+ * @brief Seqlock protected time data of one gPTP domain
+ */
+typedef struct {
+	uint32_t seq;			//!< Odd while the daemon is writing
+	uint32_t valid;			//!< Non-zero once the domain has a sync result
+	gPtpTimeData data;		//!< gptp_domain_number identifies the domain
+} gPtpDomainSlot;
+
+/**
+ * @brief Per-domain time data region
+ */
+typedef struct {
+	uint32_t magic;			//!< GPTP_SHM_DOMAIN_MAGIC when initialized
+	uint32_t version;		//!< GPTP_SHM_DOMAIN_VERSION
+	uint32_t domain_count;	//!< Slots in use
+	uint32_t slot_size;		//!< sizeof(gPtpDomainSlot) as seen by the daemon
+	gPtpDomainSlot domains[GPTP_SHM_MAX_DOMAINS];	//!< Time data per domain
+} gPtpDomainRegion;
+
+/*
+ * The stats region holds one gPtpPortStats (see gptp_stats.hpp) per port,
+ * port_size bytes apart, in the order of the interfaces on the command
+ * line. Fields are updated atomically, without a seqlock. The version only
+ * changes when existing fields move; appended fields just grow port_size.
+ */
+#define GPTP_SHM_STATS_OFFSET		4096		/*!< Offset of the statistics region*/
+#define GPTP_SHM_STATS_MAGIC		0x67505443	/*!< "gPTC", set once the region is initialized*/
+#define GPTP_SHM_STATS_VERSION		1			/*!< Statistics region layout version*/
+#define GPTP_SHM_STATS_MAX_PORTS	32			/*!< Ports the region has room for*/
+
+/**
+ * @brief Per-port statistics region
+ */
+typedef struct {
+	uint32_t magic;			//!< GPTP_SHM_STATS_MAGIC when initialized
+	uint32_t version;		//!< GPTP_SHM_STATS_VERSION
+	uint32_t port_count;	//!< Ports in use
+	uint32_t port_size;		//!< sizeof(gPtpPortStats) as seen by the daemon
+	gPtpPortStats ports[GPTP_SHM_STATS_MAX_PORTS];	//!< Statistics per port
+} gPtpStatsRegion;
+
+#define SHM_SIZE (GPTP_SHM_STATS_OFFSET + sizeof(gPtpStatsRegion))   /*!< Shared memory size*/
 #define SHM_NAME  "/ptp"                                            /*!< Shared memory name*/
 
 
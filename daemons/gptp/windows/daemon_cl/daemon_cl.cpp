@@ -123,6 +123,7 @@ int _tmain(int argc, _TCHAR* argv[])
 	portInit.lock_factory = NULL;
 	portInit.neighborPropDelayThreshold =
 		CommonPort::NEIGHBOR_PROP_DELAY_THRESH;
+	portInit.linkFlapWindow = 0;
 
 	bool syntonize = false;
 	uint8_t priority1 = 248;
@@ -133,9 +133,86 @@ bool WindowsNamedPipeIPC::init(OS_IPC_ARG *arg) {
 		GPTP_LOG_INFO("Starting IPC listener thread succeeded");
 	}
 
+	// Clients may still use the pipe if the mapping is unavailable
+	if (!shm_init()) {
+		GPTP_LOG_ERROR("Creating shared memory time data failed");
+	}
+
 	return true;
 }
 
+bool WindowsNamedPipeIPC::shm_init() {
+	const char *name = GPTP_SHM_GLOBAL_PREFIX P802_1AS_SHMNAME;
+
+	shm_map_ = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		0, GPTP_SHM_SIZE, name);
+	if (shm_map_ == NULL) {
+		// Global objects need SeCreateGlobalPrivilege
+		GPTP_LOG_INFO("Unable to create %s (%u), using the session namespace",
+			name, GetLastError());
+		name = GPTP_SHM_LOCAL_PREFIX P802_1AS_SHMNAME;
+		shm_map_ = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+			0, GPTP_SHM_SIZE, name);
+	}
+	if (shm_map_ == NULL) {
+		GPTP_LOG_ERROR("CreateFileMapping(%s) failed: %u", name, GetLastError());
+		return false;
+	}
+
+	shm_ = (gPtpSeqlockData *)MapViewOfFile(shm_map_, FILE_MAP_ALL_ACCESS,
+		0, 0, GPTP_SHM_SIZE);
+	if (shm_ == NULL) {
+		GPTP_LOG_ERROR("MapViewOfFile(%s) failed: %u", name, GetLastError());
+		CloseHandle(shm_map_);
+		shm_map_ = NULL;
+		return false;
+	}
+
+	memset(shm_, 0, sizeof(*shm_));
+	shm_->version = GPTP_SHM_SEQLOCK_VERSION;
+	shm_->data_size = sizeof(gPtpTimeData);
+	// Readers only trust the block once the magic is visible
+	InterlockedExchange((volatile LONG *)&shm_->magic, GPTP_SHM_SEQLOCK_MAGIC);
+
+	GPTP_LOG_INFO("Publishing time data in %s", name);
+	return true;
+}
+
+void WindowsNamedPipeIPC::shm_publish() {
+	volatile LONG *seq;
+
+	if (shm_ == NULL)
+		return;
+
+	seq = (volatile LONG *)&shm_->seq;
+	InterlockedIncrement(seq);
+	shm_->data.ml_phoffset = lOffset_.ml_phoffset;
+	shm_->data.ls_phoffset = lOffset_.ls_phoffset;
+	shm_->data.ml_freqoffset = lOffset_.ml_freqoffset;
+	shm_->data.ls_freqoffset = lOffset_.ls_freqoffset;
+	shm_->data.local_time = lOffset_.local_time;
+	memcpy(shm_->data.gptp_grandmaster_id, lOffset_.gptp_grandmaster_id, PTP_CLOCK_IDENTITY_LENGTH);
+	shm_->data.gptp_domain_number = lOffset_.gptp_domain_number;
+	memcpy(shm_->data.clock_identity, lOffset_.clock_identity, PTP_CLOCK_IDENTITY_LENGTH);
+	shm_->data.priority1 = lOffset_.priority1;
+	shm_->data.clock_class = lOffset_.clock_class;
+	shm_->data.offset_scaled_log_variance = lOffset_.offset_scaled_log_variance;
+	shm_->data.clock_accuracy = lOffset_.clock_accuracy;
+	shm_->data.priority2 = lOffset_.priority2;
+	shm_->data.domain_number = lOffset_.domain_number;
+	shm_->data.log_sync_interval = lOffset_.log_sync_interval;
+	shm_->data.log_announce_interval = lOffset_.log_announce_interval;
+	shm_->data.log_pdelay_interval = lOffset_.log_pdelay_interval;
+	shm_->data.port_number = lOffset_.port_number;
+	shm_->data.sync_count = sync_count_;
+	shm_->data.pdelay_count = pdelay_count_;
+	shm_->data.asCapable = asCapable_;
+	shm_->data.port_state = port_state_;
+	shm_->data.process_id = GetCurrentProcessId();
+	// Interlocked operations are full barriers
+	InterlockedIncrement(seq);
+}
+
 bool WindowsNamedPipeIPC::update(
 	int64_t ml_phoffset,
 	int64_t ls_phoffset,
@@ -153,8 +230,13 @@ bool WindowsNamedPipeIPC::update(
 	lOffset_.ml_phoffset = ml_phoffset;
 	lOffset_.ls_freqoffset = ls_freq_offset;
 	lOffset_.ls_phoffset = ls_phoffset;
+	sync_count_ = sync_count;
+	pdelay_count_ = pdelay_count;
+	asCapable_ = asCapable;
+	port_state_ = port_state;
 
 	if (!lOffset_.isReady()) lOffset_.setReady(true);
+	shm_publish();
 	lOffset_.put();
 	return true;
 }
@@ -168,6 +250,7 @@ bool WindowsNamedPipeIPC::update_grandmaster(
 	lOffset_.gptp_domain_number = gptp_domain_number;
 
 	if (!lOffset_.isReady()) lOffset_.setReady(true);
+	shm_publish();
 	lOffset_.put();
 	return true;
 }
@@ -199,6 +282,7 @@ bool WindowsNamedPipeIPC::update_network_interface(
 	lOffset_.port_number = port_number;
 
 	if (!lOffset_.isReady()) lOffset_.setReady(true);
+	shm_publish();
 	lOffset_.put();
 	return true;
 }
@@ -442,23 +442,34 @@ public:
 	/**
 	 * @brief  Cancels an event from the queue
 	 * @param  type ::Event type
+	 * @param  port Only cancel events of this port, NULL for every port
 	 * @param  event [in] Pointer to the event to be removed
 	 * @return Always returns true.
 	 */
-	bool cancelEvent( int type, unsigned *event ) {
+	bool cancelEvent( int type, CommonPort *port, unsigned *event ) {
 		TimerQueueMap_t::iterator iter = timerQueueMap.find( type );
 		if( iter == timerQueueMap.end() ) return false;
+		// Ports sharing a clock share the queue; only take this port's timers
+		TimerArgList_t del_list;
 		AcquireSRWLockExclusive( &timerQueueMap[type].lock );
-		while( ! timerQueueMap[type].arg_list.empty() ) {
-			WindowsTimerQueueHandlerArg *del_arg = timerQueueMap[type].arg_list.front();
-			timerQueueMap[type].arg_list.pop_front();
-			ReleaseSRWLockExclusive( &timerQueueMap[type].lock );
+		TimerArgList_t::iterator arg_iter = timerQueueMap[type].arg_list.begin();
+		while( arg_iter != timerQueueMap[type].arg_list.end() ) {
+			WindowsTimerQueueHandlerArg *del_arg = *arg_iter;
+			if( port == NULL || del_arg->inner_arg == NULL || del_arg->inner_arg->port == port ) {
+				del_list.push_back( del_arg );
+				arg_iter = timerQueueMap[type].arg_list.erase( arg_iter );
+			} else {
+				++arg_iter;
+			}
+		}
+		ReleaseSRWLockExclusive( &timerQueueMap[type].lock );
+		while( ! del_list.empty() ) {
+			WindowsTimerQueueHandlerArg *del_arg = del_list.front();
+			del_list.pop_front();
 			DeleteTimerQueueTimer( del_arg->queue_handle, del_arg->timer_handle, INVALID_HANDLE_VALUE );
 			if( del_arg->rm ) delete del_arg->inner_arg;
 			delete del_arg;
-			AcquireSRWLockExclusive( &timerQueueMap[type].lock );
 		}
-		ReleaseSRWLockExclusive( &timerQueueMap[type].lock );
 
 		return true;
 	}
@@ -583,9 +594,10 @@ class WindowsThreadFactory : public OSThreadFactory {
 public:
 	/**
 	 * @brief  Creates a new windows thread
+	 * @param  role Not used, threads get the default scheduling
 	 * @return New thread of type OSThread
 	 */
-	OSThread *createThread() const {
+	OSThread *createThread( OSThreadRole role = OSTHREAD_ROLE_DEFAULT ) const {
 		return new WindowsThread();
 	}
 };
@@ -773,11 +785,34 @@ private:
 	HANDLE pipe_;
 	LockableOffset lOffset_;
 	PeerList peerList_;
+	HANDLE shm_map_;
+	gPtpSeqlockData *shm_;
+
+	/**
+	 * @brief  Creates the time data file mapping
+	 * @return TRUE if the mapping is available; FALSE otherwise
+	 */
+	bool shm_init();
+
+	/**
+	 * @brief  Copies the offset into the file mapping. Must be called
+	 * with lOffset_ held, which serializes the writers.
+	 * @return void
+	 */
+	void shm_publish();
+
+	/* Fields of gPtpTimeData that are not part of Offset */
+	uint32_t sync_count_;
+	uint32_t pdelay_count_;
+	bool asCapable_;
+	PortState port_state_;
 public:
 	/**
 	 * @brief Default constructor. Initializes the IPC interface
 	 */
-	WindowsNamedPipeIPC() : pipe_(INVALID_HANDLE_VALUE) { };
+	WindowsNamedPipeIPC() : pipe_(INVALID_HANDLE_VALUE), shm_map_(NULL),
+		shm_(NULL), sync_count_(0), pdelay_count_(0), asCapable_(false),
+		port_state_(PTP_INITIALIZING) { };
 
 	/**
 	 * @brief Destroys the IPC interface
@@ -785,6 +820,10 @@ public:
 	~WindowsNamedPipeIPC() {
 		if (pipe_ != 0 && pipe_ != INVALID_HANDLE_VALUE)
 			::CloseHandle(pipe_);
+		if (shm_ != NULL)
+			::UnmapViewOfFile(shm_);
+		if (shm_map_ != NULL)
+			::CloseHandle(shm_map_);
 	}
 
 	/**
@@ -412,5 +412,68 @@ typedef union {
 
 #pragma pack(pop)
 
+/*
+ * Besides answering queries on the named pipe the daemon publishes the
+ * time data in a named file mapping, so clients can read it without a
+ * round trip. The mapping holds one gPtpSeqlockData block at offset 0,
+ * in the same format as the seqlock block of the Linux shared memory
+ * segment: readers sample seq, copy the data and retry if seq was odd or
+ * changed meanwhile. They never block the daemon.
+ *
+ * The mapping is created in the Global namespace when the daemon has the
+ * privilege to do so, otherwise in the session's Local namespace.
+ */
+#define GPTP_SHM_GLOBAL_PREFIX "Global\\"	/*!< Mapping name prefix, all sessions */
+#define GPTP_SHM_LOCAL_PREFIX "Local\\"		/*!< Mapping name prefix, this session */
+#define P802_1AS_SHMNAME "gptp-shm"			/*!< Mapping name */
+#define GPTP_SHM_SIZE 4096					/*!< Size of the mapping */
+
+#define GPTP_SHM_SEQLOCK_MAGIC		0x67505453	/*!< "gPTS", set once the block is valid*/
+#define GPTP_SHM_SEQLOCK_VERSION	1			/*!< Seqlock block layout version*/
+
+/**
+ * @brief Seqlock protected copy of the gPTP time data
+ */
+typedef struct {
+	uint32_t magic;			//!< GPTP_SHM_SEQLOCK_MAGIC when initialized
+	uint32_t version;		//!< GPTP_SHM_SEQLOCK_VERSION
+	uint32_t seq;			//!< Odd while the daemon is writing
+	uint32_t data_size;		//!< sizeof(gPtpTimeData) as seen by the daemon
+	gPtpTimeData data;		//!< Time data
+} gPtpSeqlockData;
+
+/**
+ * @brief  Takes a consistent copy of the published time data
+ * @param  sl [in] Seqlock block in the mapping
+ * @param  data [out] Copy of the time data
+ * @return TRUE on success, FALSE if the block is not initialized or the
+ * daemon kept writing while it was read
+ */
+inline bool gptpSeqlockRead( const gPtpSeqlockData *sl, gPtpTimeData *data )
+{
+	volatile LONG *seqp = (volatile LONG *) &sl->seq;
+	LONG seq;
+	int tries;
+
+	if( *(volatile LONG *) &sl->magic != GPTP_SHM_SEQLOCK_MAGIC ||
+		sl->version != GPTP_SHM_SEQLOCK_VERSION ||
+		sl->data_size != sizeof( *data ))
+		return false;
+
+	for( tries = 0; tries < 1000; ++tries ) {
+		seq = *seqp;
+		MemoryBarrier();
+		if( seq & 1 ) {
+			YieldProcessor();
+			continue;
+		}
+		memcpy( data, (const void *) &sl->data, sizeof( *data ));
+		MemoryBarrier();
+		if( *seqp == seq )
+			return true;
+	}
+	return false;
+}
+
 #endif /*WINDOWSIPC_HPP*/
 
@@ -54,6 +54,49 @@ uint64_t scaleTSCClockToNanoseconds( uint64_t tsc_value, uint64_t tsc_frequency
 	return (uint64_t) scaled_output;
 }
 
+/* Reads the time data from the daemon's file mapping, no pipe round trip */
+static bool read_shm( void ) {
+    const char *names[] = {
+        GPTP_SHM_GLOBAL_PREFIX P802_1AS_SHMNAME,
+        GPTP_SHM_LOCAL_PREFIX P802_1AS_SHMNAME
+    };
+    HANDLE map = NULL;
+    const gPtpSeqlockData *sl;
+    gPtpTimeData td;
+    bool ret;
+    int i;
+
+    for( i = 0; i < 2 && map == NULL; ++i ) {
+        map = OpenFileMapping( FILE_MAP_READ, FALSE, names[i] );
+    }
+    if( map == NULL ) {
+        printf( "No gptp shared memory, %d\n", GetLastError() );
+        return false;
+    }
+    sl = (const gPtpSeqlockData *) MapViewOfFile( map, FILE_MAP_READ, 0, 0, GPTP_SHM_SIZE );
+    if( sl == NULL ) {
+        printf( "Failed to map gptp shared memory, %d\n", GetLastError() );
+        CloseHandle( map );
+        return false;
+    }
+
+    ret = gptpSeqlockRead( sl, &td );
+    if( ret ) {
+        printf( "Shared memory, process %u:\n", td.process_id );
+        printf( "Master-Local Offset = %lld\n", td.ml_phoffset );
+        printf( "Master-Local Frequency Offset = %Lf\n", td.ml_freqoffset );
+        printf( "Local-System Offset = %lld\n", td.ls_phoffset );
+        printf( "Local-System Frequency Offset = %Lf\n", td.ls_freqoffset );
+        printf( "Local Time = %llu\n\n", td.local_time );
+    } else {
+        printf( "gptp shared memory not ready\n" );
+    }
+
+    UnmapViewOfFile( sl );
+    CloseHandle( map );
+    return ret;
+}
+
 int _tmain(int argc, _TCHAR* argv[])
 {
     char pipename[64];
@@ -73,6 +116,8 @@ int _tmain(int argc, _TCHAR* argv[])
         printf( "Failed to open gptp handle, %d\n", GetLastError() );
     }
 
+	read_shm();
+
 	printf( "TSC Frequency: %llu\n", tsc_frequency );
     while( !exit_flag ) {
 		uint64_t now_tscns, now_8021as;
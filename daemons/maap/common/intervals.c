@@ -26,6 +26,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include "intervals.h"
 
+#define INTERVAL_BLACK 0
+#define INTERVAL_RED   1
+
 static int check_overlap(Interval *a, Interval *b) {
 	return (a->low <= b->high && b->low <= a->high);
 }
@@ -44,11 +47,165 @@ void free_interval(Interval *node) {
 	free(node);
 }
 
+static int is_red(Interval *node) {
+	return node && node->color == INTERVAL_RED;
+}
+
+static void rotate_left(Interval **root, Interval *node) {
+	Interval *pivot = node->right_child;
+
+	node->right_child = pivot->left_child;
+	if (pivot->left_child) {
+		pivot->left_child->parent = node;
+	}
+	pivot->parent = node->parent;
+	if (!node->parent) {
+		*root = pivot;
+	} else if (node == node->parent->left_child) {
+		node->parent->left_child = pivot;
+	} else {
+		node->parent->right_child = pivot;
+	}
+	pivot->left_child = node;
+	node->parent = pivot;
+}
+
+static void rotate_right(Interval **root, Interval *node) {
+	Interval *pivot = node->left_child;
+
+	node->left_child = pivot->right_child;
+	if (pivot->right_child) {
+		pivot->right_child->parent = node;
+	}
+	pivot->parent = node->parent;
+	if (!node->parent) {
+		*root = pivot;
+	} else if (node == node->parent->right_child) {
+		node->parent->right_child = pivot;
+	} else {
+		node->parent->left_child = pivot;
+	}
+	pivot->right_child = node;
+	node->parent = pivot;
+}
+
+/* Restore the red-black properties after linking in a red node */
+static void insert_fixup(Interval **root, Interval *node) {
+	Interval *parent, *grandparent, *uncle;
+
+	while ((parent = node->parent) != NULL && is_red(parent)) {
+		/* A red parent is never the root, so the grandparent exists */
+		grandparent = parent->parent;
+		if (parent == grandparent->left_child) {
+			uncle = grandparent->right_child;
+			if (is_red(uncle)) {
+				parent->color = INTERVAL_BLACK;
+				uncle->color = INTERVAL_BLACK;
+				grandparent->color = INTERVAL_RED;
+				node = grandparent;
+				continue;
+			}
+			if (node == parent->right_child) {
+				rotate_left(root, parent);
+				node = parent;
+				parent = node->parent;
+			}
+			parent->color = INTERVAL_BLACK;
+			grandparent->color = INTERVAL_RED;
+			rotate_right(root, grandparent);
+		} else {
+			uncle = grandparent->left_child;
+			if (is_red(uncle)) {
+				parent->color = INTERVAL_BLACK;
+				uncle->color = INTERVAL_BLACK;
+				grandparent->color = INTERVAL_RED;
+				node = grandparent;
+				continue;
+			}
+			if (node == parent->left_child) {
+				rotate_right(root, parent);
+				node = parent;
+				parent = node->parent;
+			}
+			parent->color = INTERVAL_BLACK;
+			grandparent->color = INTERVAL_RED;
+			rotate_left(root, grandparent);
+		}
+	}
+	(*root)->color = INTERVAL_BLACK;
+}
+
+/* Restore the red-black properties after unlinking a black node. The node
+   that took its place may be NULL, so its parent is passed separately. */
+static void remove_fixup(Interval **root, Interval *node, Interval *parent) {
+	Interval *sibling;
+
+	while (node != *root && !is_red(node)) {
+		if (node == parent->left_child) {
+			sibling = parent->right_child;
+			if (is_red(sibling)) {
+				sibling->color = INTERVAL_BLACK;
+				parent->color = INTERVAL_RED;
+				rotate_left(root, parent);
+				sibling = parent->right_child;
+			}
+			if (!is_red(sibling->left_child) && !is_red(sibling->right_child)) {
+				sibling->color = INTERVAL_RED;
+				node = parent;
+				parent = node->parent;
+			} else {
+				if (!is_red(sibling->right_child)) {
+					sibling->left_child->color = INTERVAL_BLACK;
+					sibling->color = INTERVAL_RED;
+					rotate_right(root, sibling);
+					sibling = parent->right_child;
+				}
+				sibling->color = parent->color;
+				parent->color = INTERVAL_BLACK;
+				sibling->right_child->color = INTERVAL_BLACK;
+				rotate_left(root, parent);
+				node = *root;
+			}
+		} else {
+			sibling = parent->left_child;
+			if (is_red(sibling)) {
+				sibling->color = INTERVAL_BLACK;
+				parent->color = INTERVAL_RED;
+				rotate_right(root, parent);
+				sibling = parent->left_child;
+			}
+			if (!is_red(sibling->left_child) && !is_red(sibling->right_child)) {
+				sibling->color = INTERVAL_RED;
+				node = parent;
+				parent = node->parent;
+			} else {
+				if (!is_red(sibling->left_child)) {
+					sibling->right_child->color = INTERVAL_BLACK;
+					sibling->color = INTERVAL_RED;
+					rotate_left(root, sibling);
+					sibling = parent->left_child;
+				}
+				sibling->color = parent->color;
+				parent->color = INTERVAL_BLACK;
+				sibling->left_child->color = INTERVAL_BLACK;
+				rotate_right(root, parent);
+				node = *root;
+			}
+		}
+	}
+	if (node) {
+		node->color = INTERVAL_BLACK;
+	}
+}
+
 int insert_interval(Interval **root, Interval *node) {
 	Interval *current;
 
+	node->color = INTERVAL_RED;
 	if (*root == NULL) {
+		node->parent = NULL;
 		*root = node;
+		insert_fixup(root, node);
 		return INTERVAL_SUCCESS;
 	}
 	current = *root;
@@ -75,11 +232,12 @@ int insert_interval(Interval **root, Interval *node) {
 		}
 	}
 
+	insert_fixup(root, node);
 	return INTERVAL_SUCCESS;
 }
 
 Interval *remove_interval(Interval **root, Interval *node) {
-	Interval *snip, *child;
+	Interval *snip, *child, *parent;
 
 	/* If the node to remove does not have two children, we will snip it,
 	   otherwise we will swap it with its successor and snip that one */
@@ -96,20 +254,21 @@ Interval *remove_interval(Interval **root, Interval *node) {
 	} else {
 		child = snip->right_child;
 	}
+	parent = snip->parent;
 	if (child) {
-		child->parent = snip->parent;
+		child->parent = parent;
 	}
 
 	/* If the snipped node has no parent, it is the root node and we use the
 	   provided root pointer to point to the child. Otherwise, we find if the
 	   snipped node was a left or right child and set the appropriate link in the
 	   parent node */
-	if (!snip->parent) {
+	if (!parent) {
 		*root = child;
-	} else if (snip == snip->parent->left_child) {
-		snip->parent->left_child = child;
+	} else if (snip == parent->left_child) {
+		parent->left_child = child;
 	} else {
-		snip->parent->right_child = child;
+		parent->right_child = child;
 	}
 
 	/* Swap the contents of the node passed in to remove with the one chosen to be
@@ -122,6 +281,11 @@ Interval *remove_interval(Interval **root, Interval *node) {
 		snip->data = old_data;
 	}
 
+	/* Removing a black node shortens the black height of one path */
+	if (snip->color == INTERVAL_BLACK) {
+		remove_fixup(root, child, parent);
+	}
+
 	return snip;
 }
 
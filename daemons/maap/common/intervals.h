@@ -26,10 +26,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /**
  * @file
  *
- * @brief Augmented Binary Search Tree for Intervals
+ * @brief Red-Black Balanced Binary Search Tree for Intervals
  *
  * This library will keep track of non-overlapping intervals in the uint32 range
  *
+ * The tree is kept balanced, so insert, remove and search stay logarithmic in
+ * the number of intervals even when they are inserted in ascending order.
+ *
  * It supports insert, remove, minimum, maximum, next, previous, search, and
  * traverse operations. All updates occur in-place.
  *
@@ -78,6 +81,7 @@ struct interval_node {
 	Interval *parent;      /**< Pointer to the parent of the current tree, or NULL if this is the root node */
 	Interval *left_child;  /**< Pointer to a subtree with smaller intervals, or NULL if none */
 	Interval *right_child; /**< Pointer to a subtree with larger intervals, or NULL if none */
+	int color;             /**< Red-black balancing color, maintained by the library */
 };
 
 /**
@@ -244,11 +244,96 @@ static int inform_yielded(Maap_Client *mc, const void *sender, int id, Range *ra
 
 static void start_timer(Maap_Client *mc) {
 
-	if (mc->timer_queue) {
-		Time_setTimer(mc->timer, &mc->timer_queue->next_act_time);
+	if (mc->timer_count) {
+		Time_setTimer(mc->timer, &mc->timer_queue[0]->next_act_time);
 	}
 }
 
+/* Returns non-zero if range a expires before range b */
+static int timer_before(const Range *a, const Range *b) {
+	int cmp = Time_cmp(&a->next_act_time, &b->next_act_time);
+
+	if (cmp != 0) {
+		return cmp < 0;
+	}
+	/* Wrap-safe comparison of the scheduling order */
+	return (int) (a->timer_seq - b->timer_seq) < 0;
+}
+
+static void timer_place(Maap_Client *mc, Range *range, int index) {
+	mc->timer_queue[index] = range;
+	range->timer_index = index;
+}
+
+static void timer_sift_up(Maap_Client *mc, int index) {
+	Range *range = mc->timer_queue[index];
+	int parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (!timer_before(range, mc->timer_queue[parent])) {
+			break;
+		}
+		timer_place(mc, mc->timer_queue[parent], index);
+		index = parent;
+	}
+	timer_place(mc, range, index);
+}
+
+static void timer_sift_down(Maap_Client *mc, int index) {
+	Range *range = mc->timer_queue[index];
+	int child;
+
+	while ((child = 2 * index + 1) < mc->timer_count) {
+		if (child + 1 < mc->timer_count &&
+			timer_before(mc->timer_queue[child + 1], mc->timer_queue[child])) {
+			child++;
+		}
+		if (!timer_before(mc->timer_queue[child], range)) {
+			break;
+		}
+		timer_place(mc, mc->timer_queue[child], index);
+		index = child;
+	}
+	timer_place(mc, range, index);
+}
+
+static void timer_queue_remove(Maap_Client *mc, Range *range) {
+	int index = range->timer_index;
+	Range *moved;
+
+	if (index < 0) {
+		return;
+	}
+	assert(index < mc->timer_count && mc->timer_queue[index] == range);
+	range->timer_index = -1;
+	if (--mc->timer_count == index) {
+		return;
+	}
+
+	/* Move the last range into the hole and restore the heap order. */
+	moved = mc->timer_queue[mc->timer_count];
+	timer_place(mc, moved, index);
+	timer_sift_up(mc, index);
+	timer_sift_down(mc, moved->timer_index);
+}
+
+static int timer_queue_push(Maap_Client *mc, Range *range) {
+	if (mc->timer_count >= mc->timer_size) {
+		int new_size = (mc->timer_size ? mc->timer_size * 2 : 16);
+		Range **new_queue = realloc(mc->timer_queue, new_size * sizeof(Range *));
+		if (!new_queue) {
+			return -1;
+		}
+		mc->timer_queue = new_queue;
+		mc->timer_size = new_size;
+	}
+	range->timer_seq = ++(mc->timer_seq);
+	timer_place(mc, range, mc->timer_count++);
+	timer_sift_up(mc, range->timer_index);
+	return 0;
+}
+
 static void remove_range_interval(Interval **root, Interval *node) {
 	Range *old_range = node->data;
 	Interval *free_inter, *test_inter;
@@ -273,10 +358,12 @@ static void remove_range_interval(Interval **root, Interval *node) {
 }
 
 
-void add_notify(Maap_Client *mc, const void *sender, const Maap_Notify *mn) {
+static void queue_notify(Maap_Client *mc, const void *sender, const Maap_Notify *mn, uint64_t *addresses, int num_addresses) {
 	Maap_Notify_List *tmp, *li = calloc(1, sizeof (Maap_Notify_List));
 	memcpy(&li->notify, mn, sizeof (Maap_Notify));
 	li->sender = sender;
+	li->addresses = addresses;
+	li->num_addresses = num_addresses;
 
 	if (mc->notifies == NULL) {
 		mc->notifies = li;
@@ -289,13 +376,30 @@ void add_notify(Maap_Client *mc, const void *sender, const Maap_Notify *mn) {
 	}
 }
 
+void add_notify(Maap_Client *mc, const void *sender, const Maap_Notify *mn) {
+	queue_notify(mc, sender, mn, NULL, 0);
+}
+
 int get_notify(Maap_Client *mc, const void **sender, Maap_Notify *mn) {
+	uint64_t *addresses;
+	int num_addresses;
+
+	if (get_notify_addresses(mc, sender, mn, &addresses, &num_addresses)) {
+		free(addresses);
+		return 1;
+	}
+	return 0;
+}
+
+int get_notify_addresses(Maap_Client *mc, const void **sender, Maap_Notify *mn, uint64_t **addresses, int *num_addresses) {
 	Maap_Notify_List *tmp;
 
 	if (mc->notifies) {
 		tmp = mc->notifies;
 		if (mn) { memcpy(mn, &(tmp->notify), sizeof (Maap_Notify)); }
 		if (sender) { *sender = tmp->sender; }
+		*addresses = tmp->addresses;
+		*num_addresses = tmp->num_addresses;
 		mc->notifies = tmp->next;
 		free(tmp);
 		return 1;
@@ -439,6 +543,21 @@ void print_notify(Maap_Notify *mn, print_notify_callback_t notify_callback, void
 			notify_callback(callback_data, MAAP_LOG_LEVEL_ERROR, szOutput);
 		}
 		break;
+	case MAAP_NOTIFY_ACQUIRED_BULK:
+		if (mn->result == MAAP_NOTIFY_ERROR_NONE) {
+			sprintf(szOutput, "Address ranges starting with %d acquired (Size %d each)",
+				mn->id, mn->count);
+			notify_callback(callback_data, MAAP_LOG_LEVEL_INFO, szOutput);
+		} else if (mn->id != -1) {
+			sprintf(szOutput, "Some address ranges starting with %d of size %d not acquired",
+				mn->id, mn->count);
+			notify_callback(callback_data, MAAP_LOG_LEVEL_ERROR, szOutput);
+		} else {
+			sprintf(szOutput, "Address ranges of size %d not acquired",
+				mn->count);
+			notify_callback(callback_data, MAAP_LOG_LEVEL_ERROR, szOutput);
+		}
+		break;
 	default:
 		sprintf(szOutput, "Notification type %d not recognized", mn->kind);
 		notify_callback(callback_data, MAAP_LOG_LEVEL_ERROR, szOutput);
@@ -446,6 +565,29 @@ void print_notify(Maap_Notify *mn, print_notify_callback_t notify_callback, void
 	}
 }
 
+void print_notify_addresses(const Maap_Notify *mn, const uint64_t *addresses, int num_addresses,
+	print_notify_callback_t notify_callback, void *callback_data)
+{
+	char szOutput[300];
+	int i;
+
+	assert(mn);
+
+	for (i = 0; i < num_addresses; ++i) {
+		if (addresses[i] != 0) {
+			sprintf(szOutput, "Address range %d:  0x%012llx-0x%012llx (Size %d)",
+				mn->id + i,
+				(unsigned long long) addresses[i],
+				(unsigned long long) addresses[i] + mn->count - 1,
+				mn->count);
+			notify_callback(callback_data, MAAP_LOG_LEVEL_INFO, szOutput);
+		} else {
+			sprintf(szOutput, "Address range %d not acquired", mn->id + i);
+			notify_callback(callback_data, MAAP_LOG_LEVEL_ERROR, szOutput);
+		}
+	}
+}
+
 
 int maap_init_client(Maap_Client *mc, const void *sender, uint64_t range_address_base, uint32_t range_len) {
 
@@ -475,8 +617,12 @@ int maap_init_client(Maap_Client *mc, const void *sender, uint64_t range_address
 	mc->range_len = range_len;
 	mc->ranges = NULL;
 	mc->timer_queue = NULL;
+	mc->timer_count = 0;
+	mc->timer_size = 0;
+	mc->timer_seq = 0;
 	mc->maxid = 0;
 	mc->notifies = NULL;
+	mc->bulks = NULL;
 
 	mc->initialized = 1;
 
@@ -488,11 +634,21 @@ int maap_init_client(Maap_Client *mc, const void *sender, uint64_t range_address
 
 void maap_deinit_client(Maap_Client *mc) {
 	if (mc->initialized) {
-		while (mc->timer_queue) {
-			Range * pDel = mc->timer_queue;
-			mc->timer_queue = mc->timer_queue->next_timer;
+		while (mc->timer_count) {
+			Range * pDel = mc->timer_queue[--(mc->timer_count)];
+			pDel->timer_index = -1;
 			if (pDel->state == MAAP_STATE_RELEASED) { free(pDel); }
 		}
+		free(mc->timer_queue);
+		mc->timer_queue = NULL;
+		mc->timer_size = 0;
+
+		while (mc->bulks) {
+			Maap_Bulk *pDel = mc->bulks;
+			mc->bulks = pDel->next;
+			free(pDel->starts);
+			free(pDel);
+		}
 
 		while (mc->ranges) {
 			Range *range = mc->ranges->data;
@@ -522,8 +678,30 @@ int rand_ms(int variation) {
 	return random() % (variation - 1) + 1;
 }
 
+static int queue_timer(Maap_Client *mc, Range *range) {
+	/* Remove the range from the timer queue, if it is already in it,
+	 * and add it back at the position for its new expiration time. */
+	timer_queue_remove(mc, range);
+	if (timer_queue_push(mc, range) < 0) {
+		MAAP_LOG_ERROR("Unable to grow the timer queue");
+		return -1;
+	}
+
+#ifdef DEBUG_TIMER_MSG
+	/* Perform a sanity test on the timer queue. */
+	{
+		int i;
+		for (i = 0; i < mc->timer_count; ++i) {
+			assert(mc->timer_queue[i]->timer_index == i);
+			assert(i == 0 || !timer_before(mc->timer_queue[i], mc->timer_queue[(i - 1) / 2]));
+		}
+	}
+#endif
+
+	return 0;
+}
+
 int schedule_timer(Maap_Client *mc, Range *range) {
-	Range *rp, *prev_rp;
 	unsigned long long int ns;
 	Time ts;
 
@@ -563,59 +741,30 @@ int schedule_timer(Maap_Client *mc, Range *range) {
 #endif
 	}
 
-	/* Remove the range from the timer queue, if it is already in it. */
-	if (mc->timer_queue == range) {
-		/* Range was at the front of the queue. */
-		mc->timer_queue = range->next_timer;
-	} else if (mc->timer_queue) {
-		/* Search the rest of the queue. */
-		prev_rp = mc->timer_queue;
-		rp = prev_rp->next_timer;
-		while (rp && rp != range) {
-			prev_rp = rp;
-			rp = rp->next_timer;
-		}
-		if (rp) {
-			/* Range was found.  Remove it. */
-			prev_rp->next_timer = rp->next_timer;
-			rp->next_timer = NULL;
-		}
-	}
+	return queue_timer(mc, range);
+}
 
-	/* Add the range to the timer queue. */
-	if (mc->timer_queue == NULL ||
-		Time_cmp(&range->next_act_time, &mc->timer_queue->next_act_time) < 0) {
-		range->next_timer = mc->timer_queue;
-		mc->timer_queue = range;
-	} else {
-		rp = mc->timer_queue;
-		while (rp->next_timer &&
-			Time_cmp(&rp->next_timer->next_act_time, &range->next_act_time) <= 0)
-		{
-			rp = rp->next_timer;
-		}
-		range->next_timer = rp->next_timer;
-		rp->next_timer = range;
+static int schedule_bulk_timer(Maap_Client *mc, Range *range) {
+	Maap_Bulk *bulk = range->bulk;
+	int rv;
+
+	if (!bulk) {
+		return schedule_timer(mc, range);
 	}
 
-#ifdef DEBUG_TIMER_MSG
-	/* Perform a sanity test on the timer queue. */
-	{
-		Range *test = mc->timer_queue;
-		int i;
-		for (i = 0; test && i < 100000; ++i) {
-			assert(test->next_timer != test);
-			assert(test->next_timer == NULL || Time_cmp(&test->next_act_time, &test->next_timer->next_act_time) <= 0);
-			test = test->next_timer;
-		}
-		if (test) {
-			MAAP_LOG_ERROR("Timer infinite loop detected!");
-			assert(0);
-		}
+	/* The ranges of a bulk request that expire together are rescheduled together,
+	 * so they keep sending their probes (and first announce) in the same timer pass. */
+	if (bulk->last_state == (int) range->state &&
+		Time_cmp(&range->next_act_time, &bulk->last_due) == 0) {
+		range->next_act_time = bulk->next_due;
+		return queue_timer(mc, range);
 	}
-#endif
 
-	return 0;
+	bulk->last_state = range->state;
+	bulk->last_due = range->next_act_time;
+	rv = schedule_timer(mc, range);
+	bulk->next_due = range->next_act_time;
+	return rv;
 }
 
 static int assign_interval(Maap_Client *mc, Range *range, uint64_t attempt_base, uint16_t len) {
@@ -660,6 +809,90 @@ static int assign_interval(Maap_Client *mc, Range *range, uint64_t attempt_base,
 	return 0;
 }
 
+static int inform_bulk_not_acquired(Maap_Client *mc, const void *sender, int range_size, Maap_Notify_Error result) {
+	Maap_Notify note;
+
+	note.kind = MAAP_NOTIFY_ACQUIRED_BULK;
+	note.id = -1;
+	note.start = 0;
+	note.count = range_size;
+	note.result = result;
+
+	add_notify(mc, sender, &note);
+	return 0;
+}
+
+static int inform_bulk_acquired(Maap_Client *mc, Maap_Bulk *bulk) {
+	Maap_Notify note;
+	int i;
+
+	note.kind = MAAP_NOTIFY_ACQUIRED_BULK;
+	note.id = bulk->first_id;
+	note.start = bulk->starts[0];
+	note.count = bulk->length;
+	note.result = MAAP_NOTIFY_ERROR_NONE;
+	for (i = 0; i < bulk->num_ranges; ++i) {
+		if (bulk->starts[i] == 0) {
+			note.result = MAAP_NOTIFY_ERROR_RESERVE_NOT_AVAILABLE;
+			break;
+		}
+	}
+
+	/* The notification takes ownership of the address list. */
+	queue_notify(mc, bulk->sender, &note, bulk->starts, bulk->num_ranges);
+	bulk->starts = NULL;
+	return 0;
+}
+
+static Maap_Bulk *find_bulk(Maap_Client *mc, int id) {
+	Maap_Bulk *bulk;
+
+	for (bulk = mc->bulks; bulk; bulk = bulk->next) {
+		if (id >= bulk->first_id && id < bulk->first_id + bulk->num_ranges) {
+			return bulk;
+		}
+	}
+	return NULL;
+}
+
+static void bulk_range_done(Maap_Client *mc, Range *range, int acquired) {
+	Maap_Bulk *bulk = range->bulk, **pp;
+
+	assert(bulk);
+	bulk->starts[range->id - bulk->first_id] = (acquired ? get_start_address(mc, range) : 0);
+	range->bulk = NULL;
+	if (--(bulk->pending) > 0) {
+		return;
+	}
+
+	/* Every range has been resolved, so let the requester know the results. */
+	inform_bulk_acquired(mc, bulk);
+	for (pp = &(mc->bulks); *pp != bulk; pp = &((*pp)->next)) {
+		assert(*pp);
+	}
+	*pp = bulk->next;
+	free(bulk);
+}
+
+static Range *find_restored_range(Maap_Client *mc, uint64_t start, uint32_t length) {
+	Interval *iv;
+	Range *range;
+
+	if (start < mc->address_base || start + length - 1 > mc->address_base + mc->range_len - 1) {
+		return NULL;
+	}
+
+	for (iv = search_interval(mc->ranges, (uint32_t) (start - mc->address_base), length);
+		 iv != NULL && interval_check_overlap(iv, (uint32_t) (start - mc->address_base), length);
+		 iv = next_interval(iv)) {
+		range = iv->data;
+		if (range->restored && get_start_address(mc, range) == start && (uint32_t) get_count(mc, range) == length) {
+			return range;
+		}
+	}
+	return NULL;
+}
+
 int maap_reserve_range(Maap_Client *mc, const void *sender, uint64_t attempt_base, uint32_t length) {
 	int id;
 	Range *range;
@@ -676,6 +909,17 @@ int maap_reserve_range(Maap_Client *mc, const void *sender, uint64_t attempt_bas
 		return -1;
 	}
 
+	/* If we are still defending this exact block from before a restart, hand it over without probing again. */
+	range = find_restored_range(mc, attempt_base, length);
+	if (range) {
+		MAAP_LOGF_INFO("Reusing restored address range, id %d", range->id);
+		range->restored = 0;
+		range->sender = sender;
+		inform_acquiring(mc, range);
+		inform_acquired(mc, range, MAAP_NOTIFY_ERROR_NONE);
+		return range->id;
+	}
+
 	range = malloc(sizeof(Range));
 	if (range == NULL) {
 		inform_not_acquired(mc, sender, -1, length, MAAP_NOTIFY_ERROR_OUT_OF_MEMORY);
@@ -690,7 +934,9 @@ int maap_reserve_range(Maap_Client *mc, const void *sender, uint64_t attempt_bas
 	Time_setFromMonotonicTimer(&range->next_act_time);
 	range->interval = NULL;
 	range->sender = sender;
-	range->next_timer = NULL;
+	range->timer_index = -1;
+	range->bulk = NULL;
+	range->restored = 0;
 
 	if (assign_interval(mc, range, attempt_base, length) < 0)
 	{
@@ -713,9 +959,155 @@ int maap_reserve_range(Maap_Client *mc, const void *sender, uint64_t attempt_bas
 	return id;
 }
 
+int maap_reserve_ranges(Maap_Client *mc, const void *sender, uint64_t attempt_base, uint32_t length, int num_ranges) {
+	Maap_Bulk *bulk;
+	Range *range;
+	Time now;
+	int i;
+
+	if (!mc->initialized) {
+		MAAP_LOG_DEBUG("Reserve not allowed, as MAAP not initialized");
+		inform_bulk_not_acquired(mc, sender, length, MAAP_NOTIFY_ERROR_REQUIRES_INITIALIZATION);
+		return -1;
+	}
+
+	if (length > 0xFFFF || length > mc->range_len || num_ranges < 1 || num_ranges > MAAP_MAX_BULK_RANGES) {
+		/* Range size cannot be more than 16 bits in size, due to the MAAP packet format */
+		inform_bulk_not_acquired(mc, sender, length, MAAP_NOTIFY_ERROR_RESERVE_NOT_AVAILABLE);
+		return -1;
+	}
+
+	bulk = calloc(1, sizeof(Maap_Bulk));
+	if (bulk) {
+		bulk->starts = calloc(num_ranges, sizeof(uint64_t));
+	}
+	if (bulk == NULL || bulk->starts == NULL) {
+		free(bulk);
+		inform_bulk_not_acquired(mc, sender, length, MAAP_NOTIFY_ERROR_OUT_OF_MEMORY);
+		return -1;
+	}
+
+	bulk->first_id = mc->maxid + 1;
+	mc->maxid += num_ranges;
+	bulk->num_ranges = num_ranges;
+	bulk->pending = 0;
+	bulk->length = length;
+	bulk->sender = sender;
+	bulk->last_state = MAAP_STATE_INVALID;
+	bulk->next = mc->bulks;
+	mc->bulks = bulk;
+
+	/* Give every range the same starting time, so they are all probed in the same timer pass. */
+	Time_setFromMonotonicTimer(&now);
+
+	for (i = 0; i < num_ranges; ++i) {
+		range = malloc(sizeof(Range));
+		if (range == NULL) {
+			MAAP_LOGF_ERROR("Out of memory for address range, id %d", bulk->first_id + i);
+			continue;
+		}
+
+		range->id = bulk->first_id + i;
+		range->state = MAAP_STATE_PROBING;
+		range->counter = MAAP_PROBE_RETRANSMITS;
+		range->overlapping = 0;
+		range->next_act_time = now;
+		range->interval = NULL;
+		range->sender = sender;
+		range->timer_index = -1;
+		range->bulk = bulk;
+		range->restored = 0;
+
+		if (assign_interval(mc, range, attempt_base, length) < 0)
+		{
+			/* Cannot find any available intervals of the requested size.
+			 * The address for this range will be reported as 0. */
+			free(range);
+			continue;
+		}
+
+		/* Try to keep the ranges contiguous. */
+		attempt_base = get_end_address(mc, range) + 1;
+
+#ifdef DEBUG_NEGOTIATE_MSG
+		MAAP_LOGF_DEBUG("Requested address range, id %d", range->id);
+		MAAP_LOGF_DEBUG("Selected address range 0x%012llx-0x%012llx", get_start_address(mc, range), get_end_address(mc, range));
+#endif
+
+		bulk->pending++;
+		schedule_bulk_timer(mc, range);
+		send_probe(mc, range);
+	}
+
+	if (bulk->pending == 0) {
+		/* None of the ranges are available, so report the failure now. */
+		mc->bulks = bulk->next;
+		inform_bulk_acquired(mc, bulk);
+		free(bulk);
+		return -1;
+	}
+
+	start_timer(mc);
+
+	return bulk->first_id;
+}
+
+int maap_restore_range(Maap_Client *mc, const void *sender, uint64_t start, uint32_t length) {
+	Interval *iv;
+	Range *range;
+
+	if (!mc->initialized) {
+		MAAP_LOG_DEBUG("Restore not allowed, as MAAP not initialized");
+		return -1;
+	}
+
+	if (length == 0 || length > 0xFFFF ||
+		start < mc->address_base || start + length - 1 > mc->address_base + mc->range_len - 1) {
+		MAAP_LOGF_WARNING("Cannot restore address range 0x%012llx (Size %u)", (unsigned long long) start, (unsigned) length);
+		return -1;
+	}
+
+	range = malloc(sizeof(Range));
+	if (range == NULL) {
+		return -1;
+	}
+
+	iv = alloc_interval((uint32_t) (start - mc->address_base), length);
+	if (insert_interval(&mc->ranges, iv) == INTERVAL_OVERLAP) {
+		MAAP_LOGF_WARNING("Cannot restore address range 0x%012llx (Size %u), as it overlaps another range",
+			(unsigned long long) start, (unsigned) length);
+		free_interval(iv);
+		free(range);
+		return -1;
+	}
+
+	range->id = ++(mc->maxid);
+	range->state = MAAP_STATE_DEFENDING;
+	range->counter = MAAP_RESTORE_ANNOUNCES;
+	range->overlapping = 0;
+	Time_setFromMonotonicTimer(&range->next_act_time);
+	range->interval = iv;
+	range->sender = sender;
+	range->timer_index = -1;
+	range->bulk = NULL;
+	range->restored = 1;
+	iv->data = range;
+
+	MAAP_LOGF_INFO("Restored address range 0x%012llx-0x%012llx, id %d",
+		get_start_address(mc, range), get_end_address(mc, range), range->id);
+
+	schedule_timer(mc, range);
+	start_timer(mc);
+	send_announce(mc, range);
+
+	return range->id;
+}
+
 int maap_release_range(Maap_Client *mc, const void *sender, int id) {
 	Interval *iv;
 	Range *range;
+	Maap_Bulk *bulk;
+	int i;
 
 	if (!mc->initialized) {
 		MAAP_LOG_DEBUG("Release not allowed, as MAAP not initialized");
@@ -723,8 +1115,8 @@ int maap_release_range(Maap_Client *mc, const void *sender, int id) {
 		return -1;
 	}
 
-	range = mc->timer_queue;
-	while (range) {
+	for (i = 0; i < mc->timer_count; ++i) {
+		range = mc->timer_queue[i];
 		if (range->id == id && range->state != MAAP_STATE_RELEASED) {
 			inform_released(mc, sender, id, range, MAAP_NOTIFY_ERROR_NONE);
 			if (sender != range->sender)
@@ -733,6 +1125,13 @@ int maap_release_range(Maap_Client *mc, const void *sender, int id) {
 				inform_released(mc, range->sender, id, range, MAAP_NOTIFY_ERROR_NONE);
 			}
 
+			/* Don't report the range as acquired if it was part of a bulk request that is still in progress. */
+			if (range->bulk) {
+				bulk_range_done(mc, range, 0);
+			} else if ((bulk = find_bulk(mc, id)) != NULL) {
+				bulk->starts[id - bulk->first_id] = 0;
+			}
+
 			iv = range->interval;
 			remove_range_interval(&mc->ranges, iv);
 			/* memory for range will be freed the next time its timer elapses */
@@ -740,7 +1139,6 @@ int maap_release_range(Maap_Client *mc, const void *sender, int id) {
 
 			return 0;
 		}
-		range = range->next_timer;
 	}
 
 	MAAP_LOGF_DEBUG("Range id %d does not exist to release", id);
@@ -751,6 +1149,7 @@ int maap_release_range(Maap_Client *mc, const void *sender, int id) {
 void maap_range_status(Maap_Client *mc, const void *sender, int id)
 {
 	Range *range;
+	int i;
 
 	if (!mc->initialized) {
 		MAAP_LOG_DEBUG("Status not allowed, as MAAP not initialized");
@@ -758,13 +1157,12 @@ void maap_range_status(Maap_Client *mc, const void *sender, int id)
 		return;
 	}
 
-	range = mc->timer_queue;
-	while (range) {
+	for (i = 0; i < mc->timer_count; ++i) {
+		range = mc->timer_queue[i];
 		if (range->id == id && range->state == MAAP_STATE_DEFENDING) {
 			inform_status(mc, sender, id, range, MAAP_NOTIFY_ERROR_NONE);
 			return;
 		}
-		range = range->next_timer;
 	}
 
 	MAAP_LOGF_DEBUG("Range id %d does not exist", id);
@@ -773,6 +1171,7 @@ void maap_range_status(Maap_Client *mc, const void *sender, int id)
 
 int maap_yield_range(Maap_Client *mc, const void *sender, int id) {
 	Range *range;
+	int i;
 	MAAP_Packet announce_packet;
 	uint8_t announce_buffer[MAAP_NET_BUFFER_SIZE];
 
@@ -782,8 +1181,8 @@ int maap_yield_range(Maap_Client *mc, const void *sender, int id) {
 		return -1;
 	}
 
-	range = mc->timer_queue;
-	while (range) {
+	for (i = 0; i < mc->timer_count; ++i) {
+		range = mc->timer_queue[i];
 		if (range->id == id && range->state == MAAP_STATE_DEFENDING) {
 			// Create a conflicting packet for this range.
 			// Use a source address which will always be less than our address, so we should always yield.
@@ -796,7 +1195,6 @@ int maap_yield_range(Maap_Client *mc, const void *sender, int id) {
 
 			return 0;
 		}
-		range = range->next_timer;
 	}
 
 	MAAP_LOGF_DEBUG("Range id %d does not exist", id);
@@ -912,7 +1310,11 @@ int maap_handle_packet(Maap_Client *mc, const uint8_t *stream, int len) {
 				if (assign_interval(mc, range, 0, range_size) < 0) {
 					/* No interval is available, so stop probing and report an error. */
 					MAAP_LOG_WARNING("Unable to find an available address block to probe");
-					inform_not_acquired(mc, range->sender, range->id, range_size, MAAP_NOTIFY_ERROR_RESERVE_NOT_AVAILABLE);
+					if (range->bulk) {
+						bulk_range_done(mc, range, 0);
+					} else {
+						inform_not_acquired(mc, range->sender, range->id, range_size, MAAP_NOTIFY_ERROR_RESERVE_NOT_AVAILABLE);
+					}
 					remove_range_interval(&mc->ranges, iv);
 					/* memory will be freed the next time its timer elapses */
 					range->state = MAAP_STATE_RELEASED;
@@ -921,7 +1323,9 @@ int maap_handle_packet(Maap_Client *mc, const uint8_t *stream, int len) {
 					MAAP_LOGF_DEBUG("Selected new address range 0x%012llx-0x%012llx",
 						get_start_address(mc, range), get_end_address(mc, range));
 #endif
-					inform_acquiring(mc, range);
+					if (!range->bulk) {
+						inform_acquiring(mc, range);
+					}
 
 					remove_range_interval(&mc->ranges, iv);
 					range->counter = MAAP_PROBE_RETRANSMITS;
@@ -948,6 +1352,7 @@ int maap_handle_packet(Maap_Client *mc, const uint8_t *stream, int len) {
 				MAAP_LOG_INFO("IGNORE");
 			} else {
 				Range *new_range;
+				Maap_Bulk *bulk = find_bulk(mc, range->id);
 				int range_size = iv->high - iv->low + 1;
 
 				MAAP_LOG_INFO("YIELD");
@@ -958,9 +1363,20 @@ int maap_handle_packet(Maap_Client *mc, const uint8_t *stream, int len) {
 				 * Note:  Because our previous range is still in our range list,
 				 * the new range selected will not overlap it.
 				 */
-				new_range = malloc(sizeof(Range));
+				new_range = (range->restored ? NULL : malloc(sizeof(Range)));
+				if (range->restored) {
+					/* Nobody has claimed this range since the restart, so don't look for a replacement. */
+					MAAP_LOGF_INFO("Dropping restored address range, id %d", range->id);
+					inform_released(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_NONE);
+				} else if (bulk) {
+					/* The requester has not been told about this range yet,
+					 * so quietly replace it as part of the bulk request. */
+					bulk->starts[range->id - bulk->first_id] = 0;
+				}
 				if (new_range == NULL) {
-					inform_yielded(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_OUT_OF_MEMORY);
+					if (!bulk && !range->restored) {
+						inform_yielded(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_OUT_OF_MEMORY);
+					}
 				} else {
 					new_range->id = range->id;
 					new_range->state = MAAP_STATE_PROBING;
@@ -969,11 +1385,15 @@ int maap_handle_packet(Maap_Client *mc, const uint8_t *stream, int len) {
 					Time_setFromMonotonicTimer(&new_range->next_act_time);
 					new_range->interval = NULL;
 					new_range->sender = range->sender;
-					new_range->next_timer = NULL;
+					new_range->timer_index = -1;
+					new_range->bulk = NULL;
+					new_range->restored = 0;
 					if (assign_interval(mc, new_range, 0, range_size) < 0)
 					{
 						/* Cannot find any available intervals of the requested size. */
-						inform_yielded(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_RESERVE_NOT_AVAILABLE);
+						if (!bulk) {
+							inform_yielded(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_RESERVE_NOT_AVAILABLE);
+						}
 						free(new_range);
 					} else {
 #ifdef DEBUG_NEGOTIATE_MSG
@@ -985,8 +1405,13 @@ int maap_handle_packet(Maap_Client *mc, const uint8_t *stream, int len) {
 						schedule_timer(mc, new_range);
 						send_probe(mc, new_range);
 
-						inform_yielded(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_NONE);
-						inform_acquiring(mc, new_range);
+						if (bulk) {
+							new_range->bulk = bulk;
+							bulk->pending++;
+						} else {
+							inform_yielded(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_NONE);
+							inform_acquiring(mc, new_range);
+						}
 					}
 				}
 
@@ -1006,13 +1431,18 @@ int maap_handle_packet(Maap_Client *mc, const uint8_t *stream, int len) {
 
 int handle_probe_timer(Maap_Client *mc, Range *range) {
 	if (range->counter == 0) {
-		inform_acquired(mc, range, MAAP_NOTIFY_ERROR_NONE);
+		if (!range->bulk) {
+			inform_acquired(mc, range, MAAP_NOTIFY_ERROR_NONE);
+		}
 		range->state = MAAP_STATE_DEFENDING;
-		schedule_timer(mc, range);
+		schedule_bulk_timer(mc, range);
 		send_announce(mc, range);
+		if (range->bulk) {
+			bulk_range_done(mc, range, 1);
+		}
 	} else {
 		range->counter--;
-		schedule_timer(mc, range);
+		schedule_bulk_timer(mc, range);
 		send_probe(mc, range);
 	}
 
@@ -1020,6 +1450,15 @@ int handle_probe_timer(Maap_Client *mc, Range *range) {
 }
 
 int handle_defend_timer(Maap_Client *mc, Range *range) {
+	if (range->restored && --(range->counter) <= 0) {
+		/* Nobody claimed the range after the restart, so stop defending it. */
+		MAAP_LOGF_INFO("Releasing unclaimed restored address range, id %d", range->id);
+		inform_released(mc, range->sender, range->id, range, MAAP_NOTIFY_ERROR_NONE);
+		remove_range_interval(&mc->ranges, range->interval);
+		free(range);
+		return 0;
+	}
+
 	schedule_timer(mc, range);
 	send_announce(mc, range);
 
@@ -1036,12 +1475,12 @@ int maap_handle_timer(Maap_Client *mc) {
 	MAAP_LOGF_DEBUG("maap_handle_timer called at:  %s", Time_dump(&currenttime));
 #endif
 
-	while ((range = mc->timer_queue) && Time_passed(&currenttime, &range->next_act_time)) {
+	/* Handle every timer that is due, then re-arm the platform timer once. */
+	while (mc->timer_count && Time_passed(&currenttime, &(range = mc->timer_queue[0])->next_act_time)) {
 #ifdef DEBUG_TIMER_MSG
 		MAAP_LOGF_DEBUG("Due timer:  %s", Time_dump(&range->next_act_time));
 #endif
-		mc->timer_queue = range->next_timer;
-		range->next_timer = NULL;
+		timer_queue_remove(mc, range);
 
 		if (range->state == MAAP_STATE_PROBING) {
 #ifdef DEBUG_TIMER_MSG
@@ -1071,7 +1510,7 @@ int64_t maap_get_delay_to_next_timer(Maap_Client *mc)
 {
 	long long int timeRemaining;
 
-	if (!(mc->timer) || !(mc->timer_queue))
+	if (!(mc->timer) || !(mc->timer_count))
 	{
 		/* There are no timers waiting, so wait for an hour.
 		 * (No particular reason; it just sounded reasonable.) */
@@ -50,6 +50,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAAP_ANNOUNCE_INTERVAL_BASE             30000  /**< Announce interval minimum time in milliseconds - This value is defined in IEEE 1722-2016 Table B.8 */
 #define MAAP_ANNOUNCE_INTERVAL_VARIATION        2000   /**< Announce interval additional time in milliseconds - This value is defined in IEEE 1722-2016 Table B.8 */
 
+#define MAAP_RESTORE_ANNOUNCES                  4 /**< Number of announcements sent for a restored range before it is released, if no client claims it */
+
 #define MAAP_DEST_MAC {0x91, 0xE0, 0xF0, 0x00, 0xFF, 0x00} /**< MAAP multicast Address - Defined in IEEE 1722-2016 Table B.10 */
 
 #define MAAP_DYNAMIC_POOL_BASE 0x91E0F0000000LL /**< MAAP dynamic allocation pool base address - Defined in IEEE 1722-2016 Table B.9 */
@@ -75,10 +77,30 @@ typedef struct maap_notify_list Maap_Notify_List;
 struct maap_notify_list {
 	Maap_Notify notify;     /**< Notification information to send */
 	const void *sender;     /**< Sender information pointer for the entity that requested the original command */
+	uint64_t *addresses;    /**< Address block starts for #MAAP_NOTIFY_ACQUIRED_BULK, or NULL */
+	int num_addresses;      /**< Number of entries in addresses */
 	Maap_Notify_List *next; /**< Next notification in the queue */
 };
 
 
+/** Wrapper for struct maap_bulk */
+typedef struct maap_bulk Maap_Bulk;
+
+/** Structure for each #MAAP_CMD_RESERVE_BULK request still being probed */
+struct maap_bulk {
+	int first_id;        /**< Identifier of the first range in the request.  The other ranges use consecutive identifiers. */
+	int num_ranges;      /**< Number of ranges in the request */
+	int pending;         /**< Number of ranges not yet acquired or abandoned */
+	uint32_t length;     /**< Number of addresses in each range */
+	const void *sender;  /**< Sender information pointer for the entity that requested the ranges */
+	uint64_t *starts;    /**< Start address of each acquired range, or 0 if not (yet) acquired */
+	int last_state;      /**< State the ranges last rescheduled from last_due were in */
+	Time last_due;       /**< Expiration time shared by the ranges handled in the same timer pass */
+	Time next_due;       /**< Expiration time given to the first of those ranges, and reused for the rest */
+	Maap_Bulk *next;     /**< Next bulk request in the list */
+};
+
+
 /** Wrapper for struct range */
 typedef struct range Range;
 
@@ -91,7 +113,10 @@ struct range {
 	Time next_act_time; /**< Next time to perform an action for this range */
 	Interval *interval; /**< Interval information for the range */
 	const void *sender; /**< Sender information pointer for the entity that requested the range */
-	Range *next_timer;  /**< Next range in the list */
+	int timer_index;    /**< Position of this range in the timer heap, or -1 if not queued */
+	unsigned int timer_seq; /**< Scheduling order, so ranges due at the same time expire first-in first-out */
+	Maap_Bulk *bulk;    /**< Bulk request this range is still being acquired for, or NULL */
+	int restored;       /**< 1 if the range was restored from a previous run and not yet claimed by a reservation */
 };
 
 
@@ -102,12 +127,16 @@ typedef struct {
 	uint64_t address_base;      /**< Starting address of the recognized range of addresses (typically #MAAP_DYNAMIC_POOL_BASE) */
 	uint32_t range_len;         /**< Number of recognized addresses (typically #MAAP_DYNAMIC_POOL_SIZE) */
 	Interval *ranges;           /**< Pointer to the root of the #Interval tree, which contains all the Range structures */
-	Range *timer_queue;         /**< Pointer to a linked list of ranges that need timer support,
-								 * with the first timer to expire being first in the list */
+	Range **timer_queue;        /**< Binary min-heap of ranges that need timer support,
+								 * with the first timer to expire at index 0 (NULL until the first range is scheduled) */
+	int timer_count;            /**< Number of ranges in the timer heap */
+	int timer_size;             /**< Number of ranges the timer heap can hold before growing */
+	unsigned int timer_seq;     /**< Sequence number given to the most recently scheduled range */
 	Timer *timer;               /**< Pointer to the platform-specific timing support (initialized by calling #Time_newTimer) */
 	Net *net;                   /**< Pointer to the platform-specific networking support (initialized by calling #Net_newNet) */
 	int maxid;                  /**< Identifier value of the latest reservation */
 	Maap_Notify_List *notifies; /**< Pointer to a linked list of queued notification */
+	Maap_Bulk *bulks;           /**< Pointer to a linked list of bulk requests that are still probing */
 	int initialized;            /**< 1 if the structure has been initialized, 0 otherwise */
 } Maap_Client;
 
@@ -150,6 +179,47 @@ void maap_deinit_client(Maap_Client *mc);
  */
 int maap_reserve_range(Maap_Client *mc, const void *sender, uint64_t attempt_base, uint32_t length);
 
+/**
+ * Reserve several blocks of addresses at once, in support of a MAAP_CMD_RESERVE_BULK command.
+ *
+ * @note This call starts the reservation process for every block.
+ * The blocks are probed together, so the whole request takes a single probe period.
+ * No MAAP_NOTIFY_ACQUIRING or MAAP_NOTIFY_ACQUIRED notifications are sent for the individual blocks.
+ * Instead, a single MAAP_NOTIFY_ACQUIRED_BULK notification with the start address of every block
+ * will be sent when all the blocks have either been acquired or could not be.
+ * Once that notification is sent, each block is an independent reservation
+ * that can be released using its own identifier.
+ *
+ * @param mc Pointer to the Maap_Client structure to use
+ * @param sender Sender information pointer used to track the entity requesting the command
+ * @param attempt_base The base address to be attempted first, or 0 if no preference.
+ *        The following blocks are attempted contiguously after the first one, if available.
+ * @param length Number of addresses in each block to reserve (1 to 65535)
+ * @param num_ranges Number of blocks to reserve (1 to #MAAP_MAX_BULK_RANGES)
+ *
+ * @return The identifier value of the first block if the request was started successfully, -1 otherwise.
+ * The remaining blocks use the identifiers following it.
+ */
+int maap_reserve_ranges(Maap_Client *mc, const void *sender, uint64_t attempt_base, uint32_t length, int num_ranges);
+
+/**
+ * Optimistically take back a block of addresses that was reserved before a restart.
+ *
+ * @note The block skips probing and is announced immediately, so it is still subject
+ * to the normal defend and yield handling if another device has claimed it in the meantime.
+ * No notifications are sent for a restored block until a #maap_reserve_range call
+ * with the same start address and length claims it, which then completes immediately.
+ * If no reservation claims the block after #MAAP_RESTORE_ANNOUNCES announcements, it is released.
+ *
+ * @param mc Pointer to the Maap_Client structure to use
+ * @param sender Sender information pointer to use for the block until it is claimed
+ * @param start The first address of the block
+ * @param length Number of addresses in the block (1 to 65535)
+ *
+ * @return The identifier value if the block was restored, -1 otherwise.
+ */
+int maap_restore_range(Maap_Client *mc, const void *sender, uint64_t start, uint32_t length);
+
 /**
  * Release a reserved block of addresses, in support of a MAAP_CMD_RELEASE command.
  *
@@ -241,6 +311,20 @@ void add_notify(Maap_Client *mc, const void *sender, const Maap_Notify *mn);
  */
 int get_notify(Maap_Client *mc, const void **sender, Maap_Notify *mn);
 
+/**
+ * Get the next notification from the notifications queue, including any address list.
+ *
+ * @param mc Pointer to the Maap_Client structure to use
+ * @param sender Pointer to empty sender information pointer to receive the entity requesting the command
+ * @param mn Empty Maap_Notify structure to fill with the notification information
+ * @param addresses Pointer to receive the #MAAP_NOTIFY_ACQUIRED_BULK address block starts, or NULL if there are none.
+ *        The caller must free the returned array.
+ * @param num_addresses Pointer to receive the number of entries in addresses
+ *
+ * @return 1 if a notification was returned, 0 if there are no more queued notifications.
+ */
+int get_notify_addresses(Maap_Client *mc, const void **sender, Maap_Notify *mn, uint64_t **addresses, int *num_addresses);
+
 /**
  * Output the text equivalent of the notification information to the callback function.
  *
@@ -250,4 +334,16 @@ int get_notify(Maap_Client *mc, const void **sender, Maap_Notify *mn);
  */
 void print_notify(Maap_Notify *mn, print_notify_callback_t notify_callback, void *callback_data);
 
+/**
+ * Output the text equivalent of each address block of a #MAAP_NOTIFY_ACQUIRED_BULK notification to the callback function.
+ *
+ * @param mn Pointer to the notification information structure.
+ * @param addresses Address block starts received with the notification.
+ * @param num_addresses Number of entries in addresses.
+ * @param notify_callback Function of type #print_notify_callback_t that will handle printable results.
+ * @param callback_data Data to return with the callback.
+ */
+void print_notify_addresses(const Maap_Notify *mn, const uint64_t *addresses, int num_addresses,
+	print_notify_callback_t notify_callback, void *callback_data);
+
 #endif
@@ -47,8 +47,11 @@ typedef enum {
 	MAAP_CMD_STATUS,  /**< Return the block of reserved addresses associated with the supplied ID */
 	MAAP_CMD_YIELD,   /**< Yield a previously-reserved block of addresses.  This is only useful for testing. */
 	MAAP_CMD_EXIT,    /**< Have the daemon exit */
+	MAAP_CMD_RESERVE_BULK, /**< Preserve several blocks of addresses within the initialized range using a single probe cycle */
  } Maap_Cmd_Tag;
 
+#define MAAP_MAX_BULK_RANGES 256 /**< Maximum number of address blocks in a #MAAP_CMD_RESERVE_BULK command */
+
 /** MAAP Command Request Format
  *
  * This is the format of the command request the daemon expects to receive from the client.
@@ -56,12 +59,29 @@ typedef enum {
  */
 typedef struct {
 	Maap_Cmd_Tag kind; /**< Type of command to perform */
-	int32_t  id;       /**< ID to use for #MAAP_CMD_RELEASE, #MAAP_CMD_STATUS, or #MAAP_CMD_YIELD */
-	uint64_t start;    /**< Address range start for #MAAP_CMD_INIT */
-	uint32_t count;    /**< Address range size for #MAAP_CMD_INIT, or address block size for #MAAP_CMD_RESERVE */
+	int32_t  id;       /**< ID to use for #MAAP_CMD_RELEASE, #MAAP_CMD_STATUS, or #MAAP_CMD_YIELD,
+                        * or number of address blocks for #MAAP_CMD_RESERVE_BULK */
+	uint64_t start;    /**< Address range start for #MAAP_CMD_INIT, or preferred address block start (0 if none)
+                        * for #MAAP_CMD_RESERVE or #MAAP_CMD_RESERVE_BULK */
+	uint32_t count;    /**< Address range size for #MAAP_CMD_INIT, or address block size for #MAAP_CMD_RESERVE or #MAAP_CMD_RESERVE_BULK */
 } Maap_Cmd;
 
 
+/** Length of an interface name, including the terminating NUL */
+#define MAAP_IFNAME_LEN 16
+
+/** MAAP Interface Name
+ *
+ * A daemon serving several interfaces sends commands to the first interface given on its command line,
+ * unless the binary #Maap_Cmd is followed immediately, in the same write, by this structure naming another one.
+ * Once a client has named an interface this way, every binary notification sent to it is followed by
+ * this structure naming the interface it came from (ahead of the #Maap_Notify_Bulk address list, if any).
+ */
+typedef struct {
+	char name[MAAP_IFNAME_LEN]; /**< NUL-terminated interface name, such as "eth0" */
+} Maap_Ifname;
+
+
 /** MAAP Notifications */
 typedef enum {
 	MAAP_NOTIFY_INVALID = 0,
@@ -71,6 +91,8 @@ typedef enum {
 	MAAP_NOTIFY_RELEASED,    /**< Notification sent in response to a #MAAP_CMD_RELEASE command */
 	MAAP_NOTIFY_STATUS,      /**< Notification sent in response to a #MAAP_CMD_STATUS command */
 	MAAP_NOTIFY_YIELDED,     /**< Notification that an address block was yielded to another device on the network */
+	MAAP_NOTIFY_ACQUIRED_BULK, /**< Notification sent in response to a #MAAP_CMD_RESERVE_BULK command indicating that every block
+                                *   has either been reserved or could not be.  Followed by a #Maap_Notify_Bulk address list. */
 } Maap_Notify_Tag;
 
 /** MAAP Notification Errors */
@@ -101,6 +123,17 @@ typedef struct {
 	Maap_Notify_Error result; /**< #MAAP_NOTIFY_ERROR_NONE if the command succeeded, or another value if an error occurred */
 } Maap_Notify;
 
+/** MAAP Bulk Notification Address List Format
+ *
+ * A binary #MAAP_NOTIFY_ACQUIRED_BULK notification is immediately followed by this header,
+ * and then by num_ranges uint64_t address block starts.  Block i has the ID (Maap_Notify::id + i),
+ * and a start of 0 if that block could not be reserved.
+ */
+typedef struct {
+	uint32_t num_ranges; /**< Number of address block starts that follow */
+	uint32_t reserved;   /**< Unused, and set to 0 */
+} Maap_Notify_Bulk;
+
 
 /** Callback function used by #print_notify and #print_cmd_usage */
 typedef void (*print_notify_callback_t)(void *callback_data, int logLevel, const char *notifyText);
@@ -35,6 +35,10 @@ typedef unsigned __int32 uint32_t;
 #include <inttypes.h>
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 #include "maap_log_queue.h"
 
 #define MAAP_LOG_COMPONENT "Queue"
@@ -47,8 +51,29 @@ typedef unsigned __int32 uint32_t;
 #define FALSE 0
 #endif
 
+#ifdef _WIN32
+typedef LONG volatile maap_atomic_t;
+#define ATOMIC_LOAD(p)           ((uint32_t)InterlockedCompareExchange((p), 0, 0))
+#define ATOMIC_STORE(p, v)       InterlockedExchange((p), (LONG)(v))
+#define ATOMIC_CAS(p, exp, v)    (InterlockedCompareExchange((p), (LONG)(v), (LONG)(exp)) == (LONG)(exp))
+#define ATOMIC_INC(p)            InterlockedIncrement(p)
+#define ATOMIC_TAKE(p)           ((uint32_t)InterlockedExchange((p), 0))
+#else
+typedef uint32_t maap_atomic_t;
+#define ATOMIC_LOAD(p)           __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v)       __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_CAS(p, exp, v)    __atomic_compare_exchange_n((p), &(exp), (v), FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#define ATOMIC_INC(p)            __atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
+#define ATOMIC_TAKE(p)           __atomic_exchange_n((p), 0, __ATOMIC_RELAXED)
+#endif
+
 struct maap_log_queue_elem {
-	int setFlg;
+	// Position the slot is ready for: pos while free, pos + 1 once pushed.
+	maap_atomic_t seq;
+	// Position claimed by the producer holding this slot
+	uint32_t pos;
+	// Released without a push; the tail skips it.
+	int skipFlg;
 	void *data;
 };
 
@@ -56,31 +81,41 @@ struct maap_log_queue {
 	// Size of each element
 	uint32_t elemSize;
 
-	// Number of queue element slots
+	// Number of queue element slots (power of two)
 	uint32_t queueSize;
 
-	// Next element to be filled
-	uint32_t head;
+	// Next position to be claimed by a producer
+	maap_atomic_t head;
 
-	// Next element to be pulled
+	// Next position to be pulled (consumer only)
 	uint32_t tail;
 
+	// Elements dropped because the queue was full
+	maap_atomic_t dropped;
+
 	maap_log_queue_elem_t elemArray;
 };
 
 maap_log_queue_t maapLogQueueNewQueue(uint32_t elemSize, uint32_t queueSize)
 {
 	maap_log_queue_t retQueue;
+	uint32_t slots = 1;
 
-	if (elemSize < 1 || queueSize < 1)
+	if (elemSize < 1 || queueSize < 1 || queueSize > 0x80000000u)
 		return NULL;
 
+	// Positions are free-running 32-bit counters, so the slot count must divide 2^32.
+	while (slots < queueSize)
+		slots <<= 1;
+
 	retQueue = calloc(1, sizeof(struct maap_log_queue));
 	if (retQueue) {
-		retQueue->elemArray = calloc(queueSize, sizeof(struct maap_log_queue_elem));
+		retQueue->queueSize = slots;
+		retQueue->elemArray = calloc(slots, sizeof(struct maap_log_queue_elem));
 		if (retQueue->elemArray) {
 			uint32_t i1;
-			for (i1 = 0; i1 < queueSize; i1++) {
+			for (i1 = 0; i1 < slots; i1++) {
+				retQueue->elemArray[i1].seq = i1;
 				retQueue->elemArray[i1].data = calloc(1, elemSize);
 				if (!retQueue->elemArray[i1].data) {
 					maapLogQueueDeleteQueue(retQueue);
@@ -94,9 +129,9 @@ maap_log_queue_t maapLogQueueNewQueue(uint32_t elemSize, uint32_t queueSize)
 		}
 
 		retQueue->elemSize = elemSize;
-		retQueue->queueSize = queueSize;
 		retQueue->head = 0;
 		retQueue->tail = 0;
+		retQueue->dropped = 0;
 	}
 
 	return retQueue;
@@ -106,9 +141,11 @@ void maapLogQueueDeleteQueue(maap_log_queue_t queue)
 {
 	if (queue) {
 		uint32_t i1;
-		for (i1 = 0; i1 < queue->queueSize; i1++) {
-			free(queue->elemArray[i1].data);
-			queue->elemArray[i1].data = NULL;
+		if (queue->elemArray) {
+			for (i1 = 0; i1 < queue->queueSize; i1++) {
+				free(queue->elemArray[i1].data);
+				queue->elemArray[i1].data = NULL;
+			}
 		}
 		free(queue->elemArray);
 		queue->elemArray = NULL;
@@ -126,20 +163,11 @@ uint32_t maapLogQueueGetQueueSize(maap_log_queue_t queue)
 
 uint32_t maapLogQueueGetElemCount(maap_log_queue_t queue)
 {
-	uint32_t cnt = 0;
 	if (queue) {
-		if (queue->head > queue->tail) {
-			cnt += queue->head - queue->tail - 1;
-		}
-		else if (queue->head < queue->tail) {
-			cnt += queue->head + ((queue->queueSize - 1) - queue->tail);
-		}
-
-		if (queue->elemArray[queue->tail].setFlg) {
-			cnt++;
-		}
+		// Includes elements claimed but not yet pushed.
+		return (uint32_t)(ATOMIC_LOAD(&queue->head) - queue->tail);
 	}
-	return cnt;
+	return 0;
 }
 
 uint32_t maapLogQueueGetElemSize(maap_log_queue_t queue)
@@ -161,32 +189,58 @@ void *maapLogQueueData(maap_log_queue_elem_t elem)
 maap_log_queue_elem_t maapLogQueueHeadLock(maap_log_queue_t queue)
 {
 	if (queue) {
-		if (!queue->elemArray[queue->head].setFlg) {
-			return &queue->elemArray[queue->head];
+		uint32_t pos = ATOMIC_LOAD(&queue->head);
+		for (;;) {
+			maap_log_queue_elem_t elem = &queue->elemArray[pos & (queue->queueSize - 1)];
+			int32_t diff = (int32_t)(ATOMIC_LOAD(&elem->seq) - pos);
+			if (diff == 0) {
+				if (ATOMIC_CAS(&queue->head, pos, pos + 1)) {
+					elem->pos = pos;
+					elem->skipFlg = FALSE;
+					return elem;
+				}
+				pos = ATOMIC_LOAD(&queue->head);
+			}
+			else if (diff < 0) {
+				// Slot still holds an element from the previous lap; the queue is full.
+				ATOMIC_INC(&queue->dropped);
+				return NULL;
+			}
+			else {
+				pos = ATOMIC_LOAD(&queue->head);
+			}
 		}
 	}
 	return NULL;
 }
 
-void maapLogQueueHeadUnlock(maap_log_queue_t queue)
+void maapLogQueueHeadUnlock(maap_log_queue_t queue, maap_log_queue_elem_t elem)
 {
+	if (queue && elem) {
+		elem->skipFlg = TRUE;
+		ATOMIC_STORE(&elem->seq, elem->pos + 1);
+	}
 }
 
-void maapLogQueueHeadPush(maap_log_queue_t queue)
+void maapLogQueueHeadPush(maap_log_queue_t queue, maap_log_queue_elem_t elem)
 {
-	if (queue) {
-		queue->elemArray[queue->head++].setFlg = TRUE;
-		if (queue->head >= queue->queueSize) {
-			queue->head = 0;
-		}
+	if (queue && elem) {
+		ATOMIC_STORE(&elem->seq, elem->pos + 1);
 	}
 }
 
 maap_log_queue_elem_t maapLogQueueTailLock(maap_log_queue_t queue)
 {
 	if (queue) {
-		if (queue->elemArray[queue->tail].setFlg) {
-			return &queue->elemArray[queue->tail];
+		for (;;) {
+			maap_log_queue_elem_t elem = &queue->elemArray[queue->tail & (queue->queueSize - 1)];
+			if (ATOMIC_LOAD(&elem->seq) != queue->tail + 1) {
+				return NULL;
+			}
+			if (!elem->skipFlg) {
+				return elem;
+			}
+			maapLogQueueTailPull(queue);
 		}
 	}
 	return NULL;
@@ -199,9 +253,16 @@ void maapLogQueueTailUnlock(maap_log_queue_t queue)
 void maapLogQueueTailPull(maap_log_queue_t queue)
 {
 	if (queue) {
-		queue->elemArray[queue->tail++].setFlg = FALSE;
-		if (queue->tail >= queue->queueSize) {
-			queue->tail = 0;
-		}
+		maap_log_queue_elem_t elem = &queue->elemArray[queue->tail & (queue->queueSize - 1)];
+		ATOMIC_STORE(&elem->seq, queue->tail + queue->queueSize);
+		queue->tail++;
 	}
 }
+
+uint32_t maapLogQueueTakeDropCount(maap_log_queue_t queue)
+{
+	if (queue) {
+		return ATOMIC_TAKE(&queue->dropped);
+	}
+	return 0;
+}
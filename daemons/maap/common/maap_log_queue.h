@@ -24,13 +24,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *************************************************************************************/
 
 /*
-* MODULE SUMMARY : Interface for a basic dynamic array abstraction.
+* MODULE SUMMARY : Interface for a bounded multi-producer, single-consumer queue.
 *
-* - Fixed size queue.
+* - Fixed size queue. The number of slots is rounded up to a power of two.
 * - Only head and tail access possible.
-* - Head and Tail locking.
-* - If there is a single task accessing head and a single task accessing tail no synchronization is needed.
-* - If synchronization is needed the Pull and Push functions should be protected before calling.
+* - Any number of tasks may claim and push head elements concurrently without a lock.
+* - Only a single task may access the tail.
+* - When the queue is full the element is dropped and counted rather than blocking the producer.
 */
 
 #ifndef MAAP_LOG_QUEUE_H
@@ -57,14 +57,14 @@ uint32_t maapLogQueueGetElemSize(maap_log_queue_t queue);
 // Get data of the element. Returns NULL on failure.
 void *maapLogQueueData(maap_log_queue_elem_t elem);
 
-// Lock the head element.
+// Claim a head element. Returns NULL (and counts a drop) if the queue is full.
 maap_log_queue_elem_t maapLogQueueHeadLock(maap_log_queue_t queue);
 
-// Unlock the head element.
-void maapLogQueueHeadUnlock(maap_log_queue_t queue);
+// Release a claimed head element without pushing it. The tail will skip it.
+void maapLogQueueHeadUnlock(maap_log_queue_t queue, maap_log_queue_elem_t elem);
 
-// Push the head element making it available for tail access.
-void maapLogQueueHeadPush(maap_log_queue_t queue);
+// Push a claimed head element making it available for tail access.
+void maapLogQueueHeadPush(maap_log_queue_t queue, maap_log_queue_elem_t elem);
 
 // Lock the tail element.
 maap_log_queue_elem_t maapLogQueueTailLock(maap_log_queue_t queue);
@@ -75,4 +75,7 @@ void maapLogQueueTailUnlock(maap_log_queue_t queue);
 // Pull (remove) the tail element
 void maapLogQueueTailPull(maap_log_queue_t queue);
 
+// Get the number of elements dropped because the queue was full, and reset the count.
+uint32_t maapLogQueueTakeDropCount(maap_log_queue_t queue);
+
 #endif // MAAP_LOG_QUEUE_H
@@ -54,7 +54,7 @@ int parse_text_cmd(char *buf, Maap_Cmd *cmd) {
 		p = strtok(NULL, " \r\n");
 	}
 
-	if (argc >= 1 && argc <= 3)
+	if (argc >= 1 && argc <= 4)
 	{
 		/* Give all parameters default values. */
 		cmd->kind = MAAP_CMD_INVALID;
@@ -74,6 +74,19 @@ int parse_text_cmd(char *buf, Maap_Cmd *cmd) {
 				cmd->count = strtoul(argv[2], NULL, 0);
 				set_cmd = 1;
 			}
+		} else if (strncmp(argv[0], "reserve_bulk", 12) == 0) {
+			if (argc == 3) {
+				cmd->kind = MAAP_CMD_RESERVE_BULK;
+				cmd->id = (int)strtoul(argv[1], NULL, 0);
+				cmd->count = strtoul(argv[2], NULL, 0);
+				set_cmd = 1;
+			} else if (argc == 4) {
+				cmd->kind = MAAP_CMD_RESERVE_BULK;
+				cmd->id = (int)strtoul(argv[1], NULL, 0);
+				cmd->start = strtoull(argv[2], NULL, 16);
+				cmd->count = strtoul(argv[3], NULL, 0);
+				set_cmd = 1;
+			}
 		} else if (strncmp(argv[0], "reserve", 7) == 0) {
 			if (argc == 2) {
 				cmd->kind = MAAP_CMD_RESERVE;
@@ -106,6 +119,51 @@ int parse_text_cmd(char *buf, Maap_Cmd *cmd) {
 	return set_cmd;
  }
 
+int parse_iface(char *buf, int len, char *ifname) {
+	Maap_Cmd *bufcmd = (Maap_Cmd *)buf;
+	char *p, *end;
+	size_t n;
+
+	ifname[0] = '\0';
+
+	if (len >= (int) sizeof(Maap_Cmd)) {
+		switch (bufcmd->kind) {
+		case MAAP_CMD_INIT:
+		case MAAP_CMD_RESERVE:
+		case MAAP_CMD_RELEASE:
+		case MAAP_CMD_STATUS:
+		case MAAP_CMD_YIELD:
+		case MAAP_CMD_EXIT:
+		case MAAP_CMD_RESERVE_BULK:
+			/* Binary command, optionally followed by the interface name. */
+			if (len < (int) (sizeof(Maap_Cmd) + sizeof(Maap_Ifname))) {
+				return 0;
+			}
+			memcpy(ifname, buf + sizeof(Maap_Cmd), MAAP_IFNAME_LEN);
+			ifname[MAAP_IFNAME_LEN - 1] = '\0';
+			return (ifname[0] != '\0');
+		default:
+			break;
+		}
+	}
+
+	/* Text command, optionally starting with "@<interface>". */
+	for (p = buf; *p == ' ' || *p == '\t'; ++p) {}
+	if (*p != '@') {
+		return 0;
+	}
+	for (end = ++p; *end && *end != ' ' && *end != '\t' && *end != '\r' && *end != '\n'; ++end) {}
+	n = end - p;
+	if (n >= MAAP_IFNAME_LEN) { n = MAAP_IFNAME_LEN - 1; }
+	memcpy(ifname, p, n);
+	ifname[n] = '\0';
+
+	/* Remove the interface name, so the rest parses as a regular command. */
+	while (*end == ' ' || *end == '\t') { ++end; }
+	memmove(buf, end, strlen(end) + 1);
+	return (ifname[0] != '\0');
+}
+
 int parse_write(Maap_Client *mc, const void *sender, char *buf, int *input_is_text) {
 	Maap_Cmd *bufcmd, cmd;
 	int rv = 0;
@@ -120,6 +178,7 @@ int parse_write(Maap_Client *mc, const void *sender, char *buf, int *input_is_te
 	case MAAP_CMD_STATUS:
 	case MAAP_CMD_YIELD:
 	case MAAP_CMD_EXIT:
+	case MAAP_CMD_RESERVE_BULK:
 		if (input_is_text) { *input_is_text = 0; }
 		memcpy(&cmd, bufcmd, sizeof (Maap_Cmd));
 		rv = 1;
@@ -155,6 +214,17 @@ int parse_write(Maap_Client *mc, const void *sender, char *buf, int *input_is_te
 #endif
 			rv = maap_reserve_range(mc, sender, cmd.start, cmd.count);
 			break;
+		case MAAP_CMD_RESERVE_BULK:
+#ifdef DEBUG_CMD_MSG
+			if (cmd.start != 0) {
+				MAAP_LOGF_DEBUG("Got cmd MAAP_CMD_RESERVE_BULK, blocks: %d, start: 0x%016llx, length: %u",
+					(int) cmd.id, (unsigned long long)cmd.start, (unsigned) cmd.count);
+			} else {
+				MAAP_LOGF_DEBUG("Got cmd MAAP_CMD_RESERVE_BULK, blocks: %d, length: %u", (int) cmd.id, (unsigned) cmd.count);
+			}
+#endif
+			rv = maap_reserve_ranges(mc, sender, cmd.start, cmd.count, cmd.id);
+			break;
 		case MAAP_CMD_RELEASE:
 #ifdef DEBUG_CMD_MSG
 			MAAP_LOGF_DEBUG("Got cmd MAAP_CMD_RELEASE, id: %d", (int) cmd.id);
@@ -207,6 +277,12 @@ void parse_usage(print_notify_callback_t print_callback, void *callback_data)
 		"        <addr_size> in the initialized range.  If <addr_base> is specified,");
 	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
 		"        that address base will be attempted first.");
+	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
+		"    reserve_bulk <num_blocks> [<addr_base>] <addr_size> - Reserve <num_blocks>");
+	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
+		"        ranges of addresses of size <addr_size> using a single probe cycle.");
+	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
+		"        The ranges are kept contiguous from <addr_base> when possible.");
 	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
 		"    release <id> - Release the range of addresses with identifier ID");
 	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
@@ -217,6 +293,10 @@ void parse_usage(print_notify_callback_t print_callback, void *callback_data)
 		"        This is only useful for testing.");
 	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
 		"    exit - Shutdown the MAAP daemon");
+	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
+		"    Prefix a command with @<interface> to send it to that interface");
+	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
+		"        of a daemon serving several interfaces, e.g. \"@eth1 reserve 8\".");
 	print_callback(callback_data, MAAP_LOG_LEVEL_INFO,
 		" "); // Blank line
 }
@@ -47,6 +47,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 int parse_text_cmd(char *buf, Maap_Cmd *cmd);
 
+/**
+ * Find the interface the incoming binary or text data is addressed to.
+ *
+ * A text command names the interface with a leading "@<interface>" word, which is removed from buf.
+ * A binary command names it with a #Maap_Ifname following the #Maap_Cmd.
+ *
+ * @param buf Binary or text data to parse
+ * @param len Number of bytes of data in buf
+ * @param ifname Buffer of #MAAP_IFNAME_LEN bytes set to the interface name, or to an empty string if none was given
+ *
+ * @return 1 if the data named an interface, 0 otherwise.
+ */
+int parse_iface(char *buf, int len, char *ifname);
+
 /**
  * Parse the incoming binary or text data, and perform the specified command, if any.
  *
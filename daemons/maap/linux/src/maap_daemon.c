@@ -37,6 +37,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <limits.h>
 #include <unistd.h>
 #include <signal.h>
 #include <netdb.h>
@@ -62,16 +63,31 @@
 #include "maap_log.h"
 
 #define MAX_CLIENT_CONNECTIONS 32
+#define MAX_INTERFACES         8
 #define DEFAULT_PORT           "15364"
 
 #define VERSION_STR	"0.1"
 
+/** State kept for each interface served by the daemon */
+typedef struct {
+	char name[MAAP_IFNAME_LEN]; /**< Interface name */
+	int socketfd;               /**< Raw socket bound to the interface */
+	Maap_Client mc;             /**< MAAP state of the interface */
+	char *cachefile;            /**< Allocation cache file of the interface, or NULL */
+} Maap_Interface;
+
 static int init_maap_networking(const char *iface, uint8_t src_mac[ETH_ALEN], uint8_t dest_mac[ETH_ALEN]);
 static int get_listener_socket(const char *listenport);
 static int act_as_client(const char *listenport);
-static int act_as_server(const char *listenport, char *iface, int daemonize);
+static int act_as_server(const char *listenport, char **ifaces, int num_ifaces, int daemonize, const char *cachefile);
+static Maap_Interface *find_interface(Maap_Interface *ifc, int num_ifaces, const char *ifname);
 static int do_daemonize(void);
+static void load_allocation_cache(Maap_Client *mc, const char *cachefile);
+static void save_allocation_cache(Maap_Client *mc, const char *cachefile);
+static int send_notify(int socketfd, const Maap_Notify *mn, const char *ifname, const uint64_t *addresses, int num_addresses);
 
+static void print_notify_iface(const Maap_Interface *ifc, int num_ifaces, Maap_Notify *mn, const uint64_t *addresses, int num_addresses,
+	print_notify_callback_t print_callback, void *callback_data);
 static void log_print_notify_result(void *callback_data, int logLevel, const char *notifyText);
 static void display_print_notify_result(void *callback_data, int logLevel, const char *notifyText);
 static void send_print_notify_result(void *callback_data, int logLevel, const char *notifyText);
@@ -87,16 +103,22 @@ static void usage(void)
 	fprintf(stderr,
 		"\n" "%s"
 		"\n"
-		"usage: maap_daemon [ -c | -i interface-name [-d log_file] ] [-p port_num]"
+		"usage: maap_daemon [ -c | -i interface-name [-i interface-name ...] [-d log_file] [-s cache_file] ] [-p port_num]"
 		"\n"
 		"options:\n"
 		"\t-c  Run as a client (sends commands to the daemon)\n"
-		"\t-i  Run as a server monitoring the specified interface\n"
+		"\t-i  Run as a server monitoring the specified interface.  Repeat to\n"
+		"\t    serve up to %d interfaces; commands go to the first one unless\n"
+		"\t    they start with @interface-name.\n"
 		"\t-d  Daemonize the server and log to log_file\n"
+		"\t-s  Save the reserved address ranges to cache_file, and announce\n"
+		"\t    them again when the server restarts.  Use an absolute path\n"
+		"\t    when daemonizing.  With several interfaces, each one uses\n"
+		"\t    cache_file.interface-name.\n"
 		"\t-p  Specify the control port to connect to (client) or\n"
 		"\t    listen to (server).  The default port is " DEFAULT_PORT ".\n"
 		"\n",
-		version_str);
+		version_str, MAX_INTERFACES);
 	exit(1);
 }
 
@@ -115,17 +137,19 @@ int main(int argc, char *argv[])
 {
 	int c;
 	int as_client = 0, daemonize = 0;
-	char *iface = NULL;
+	char *ifaces[MAX_INTERFACES];
+	int num_ifaces = 0;
 	char *listenport = NULL;
 	char *logfile = NULL;
-	int ret;
+	char *cachefile = NULL;
+	int i, ret;
 
 
 	/*
 	 *  Parse the arguments
 	 */
 
-	while ((c = getopt(argc, argv, "hcd:i:p:")) >= 0)
+	while ((c = getopt(argc, argv, "hcd:i:p:s:")) >= 0)
 	{
 		switch (c)
 		{
@@ -145,13 +169,25 @@ int main(int argc, char *argv[])
 			break;
 
 		case 'i':
-			if (iface)
+			if (num_ifaces >= MAX_INTERFACES)
+			{
+				fprintf(stderr, "Only %d interfaces per server are supported\n", MAX_INTERFACES);
+				usage();
+			}
+			if (strlen(optarg) >= MAAP_IFNAME_LEN)
 			{
-				fprintf(stderr, "Only one interface per server is supported\n");
-				free(iface);
+				fprintf(stderr, "Interface name %s is too long\n", optarg);
 				usage();
 			}
-			iface = strdup(optarg);
+			for (i = 0; i < num_ifaces; ++i)
+			{
+				if (strcmp(ifaces[i], optarg) == 0)
+				{
+					fprintf(stderr, "Interface %s is given more than once\n", optarg);
+					usage();
+				}
+			}
+			ifaces[num_ifaces++] = strdup(optarg);
 			break;
 
 		case 'p':
@@ -164,6 +200,16 @@ int main(int argc, char *argv[])
 			listenport = strdup(optarg);
 			break;
 
+		case 's':
+			if (cachefile)
+			{
+				fprintf(stderr, "Only one cache file per server is supported\n");
+				free(cachefile);
+				usage();
+			}
+			cachefile = strdup(optarg);
+			break;
+
 		case 'h':
 		default:
 			usage();
@@ -181,16 +227,21 @@ int main(int argc, char *argv[])
 		usage();
 	}
 
-	if (!as_client && iface == NULL)
+	if (!as_client && num_ifaces == 0)
 	{
 		fprintf(stderr, "A network interface is required as a daemon\n");
 		usage();
 	}
-	if (as_client && iface != NULL)
+	if (as_client && num_ifaces != 0)
 	{
 		fprintf(stderr, "A network interface is not supported as a client\n");
 		usage();
 	}
+	if (as_client && cachefile != NULL)
+	{
+		fprintf(stderr, "A cache file is not supported as a client\n");
+		usage();
+	}
 
 	if (daemonize) {
 		ret = do_daemonize();
@@ -223,21 +274,27 @@ int main(int argc, char *argv[])
 	}
 	else
 	{
-		ret = act_as_server(listenport, iface, daemonize);
+		ret = act_as_server(listenport, ifaces, num_ifaces, daemonize, cachefile);
 	}
 
 	maapLogExit();
 
+	for (i = 0; i < num_ifaces; ++i)
+	{
+		free(ifaces[i]);
+	}
+
 	free(listenport);
+	free(cachefile);
 	return ret;
 }
 
 /* Local function to server side of network command & control. */
-static int act_as_server(const char *listenport, char *iface, int daemonize)
+static int act_as_server(const char *listenport, char **ifaces, int num_ifaces, int daemonize, const char *cachefile)
 {
-	Maap_Client mc;
+	Maap_Interface ifc[MAX_INTERFACES];
+	Maap_Interface *target;
 
-	int socketfd;
 	uint8_t dest_mac[ETH_ALEN] = MAAP_DEST_MAC;
 	uint8_t src_mac[ETH_ALEN];
 
@@ -245,43 +302,72 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 
 	int clientfd[MAX_CLIENT_CONNECTIONS];
 	int client_wants_text[MAX_CLIENT_CONNECTIONS];
-	int i, nextclientindex;
+	int client_wants_iface[MAX_CLIENT_CONNECTIONS];
+	int i, n, nextclientindex;
 
 	fd_set master, read_fds;
 	int fdmax;
 
 	void *packet_data;
-	int64_t waittime;
+	int64_t waittime, ifcwait;
 	struct timeval tv;
 	char recvbuffer[1600];
 	int recvbytes;
+	char ifname[MAAP_IFNAME_LEN];
+	int named;
 	Maap_Cmd recvcmd;
 	Maap_Notify recvnotify;
+	uint64_t *notifyaddresses;
+	int numnotifyaddresses;
 	uintptr_t notifysocket;
+	int cache_changed;
 	int exit_received = 0;
+	int net_error = 0;
 
 	int ret;
 
 	/*
-	 * Initialize the networking support.
+	 * Initialize the networking support and the Maap_Client data structure of each interface.
 	 */
 
-	socketfd = init_maap_networking(iface, src_mac, dest_mac);
-	if (socketfd == -1) {
-		maapLogExit();
-		return -1;
-	}
-
-	free(iface);
-	iface = NULL;
-
 	FD_ZERO(&read_fds);
 	FD_ZERO(&master);
 	if (!daemonize) {
 		FD_SET(STDIN_FILENO, &master);
 	}
-	FD_SET(socketfd, &master);
-	fdmax = socketfd;
+	fdmax = 0;
+
+	memset(ifc, 0, sizeof(ifc));
+	for (n = 0; n < num_ifaces; ++n)
+	{
+		strncpy(ifc[n].name, ifaces[n], MAAP_IFNAME_LEN - 1);
+		ifc[n].socketfd = init_maap_networking(ifaces[n], src_mac, dest_mac);
+		if (ifc[n].socketfd == -1) {
+			MAAP_LOGF_ERROR("Could not initialize interface %s", ifaces[n]);
+			while (--n >= 0) {
+				close(ifc[n].socketfd);
+				free(ifc[n].cachefile);
+			}
+			maapLogExit();
+			return -1;
+		}
+		FD_SET(ifc[n].socketfd, &master);
+		if (ifc[n].socketfd > fdmax) {
+			fdmax = ifc[n].socketfd;
+		}
+
+		ifc[n].mc.dest_mac = convert_mac_address(dest_mac);
+		ifc[n].mc.src_mac = convert_mac_address(src_mac);
+
+		/* A single interface keeps the cache file name as given, so existing caches are still found. */
+		if (cachefile) {
+			if (num_ifaces == 1) {
+				ifc[n].cachefile = strdup(cachefile);
+			} else if ((ifc[n].cachefile = malloc(strlen(cachefile) + MAAP_IFNAME_LEN + 1)) != NULL) {
+				sprintf(ifc[n].cachefile, "%s.%s", cachefile, ifc[n].name);
+			}
+		}
+	}
 
 
 	/*
@@ -290,7 +376,10 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 
 	listener = get_listener_socket(listenport);
 	if (listener == -1) {
-		close(socketfd);
+		for (n = 0; n < num_ifaces; ++n) {
+			close(ifc[n].socketfd);
+			free(ifc[n].cachefile);
+		}
 		maapLogExit();
 		return -1;
 	}
@@ -306,89 +395,121 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 	for (i = 0; i < MAX_CLIENT_CONNECTIONS; ++i) {
 		clientfd[i] = -1;
 		client_wants_text[i] = 0;
+		client_wants_iface[i] = 0;
 	}
 	nextclientindex = 0;
 
 
 	/*
-	 * Initialize the Maap_Client data structure.
+	 * Seed the random number generator.
+	 * This seeding is defined in IEEE 1722-2016 B.3.6.1.
 	 */
 
-	memset(&mc, 0, sizeof(mc));
-	mc.dest_mac = convert_mac_address(dest_mac);
-	mc.src_mac = convert_mac_address(src_mac);
+	srand((unsigned int)ifc[0].mc.src_mac + (unsigned int)time(NULL));
 
 
 	/*
-	 * Seed the random number generator.
-	 * This seeding is defined in IEEE 1722-2016 B.3.6.1.
+	 * Announce any address ranges we held before the last restart.
 	 */
 
-	srand((unsigned int)mc.src_mac + (unsigned int)time(NULL));
+	for (n = 0; n < num_ifaces; ++n) {
+		if (ifc[n].cachefile) {
+			load_allocation_cache(&ifc[n].mc, ifc[n].cachefile);
+		}
+	}
 
 
 	/*
 	 * Main event loop
 	 */
 
-	MAAP_LOG_STATUS("Server started");
+	MAAP_LOGF_STATUS("Server started on %d interface%s", num_ifaces, (num_ifaces == 1 ? "" : "s"));
 	if (!daemonize) {
 		puts("Enter \"help\" for a list of valid commands.");
 	}
 
 	while (!exit_received)
 	{
-		/* Send any queued packets. */
-		while (mc.net != NULL && (packet_data = Net_getNextQueuedPacket(mc.net)) != NULL)
-		{
-			if (send(socketfd, packet_data, MAAP_NET_BUFFER_SIZE, 0) < 0)
-			{
-				/* Something went wrong.  Abort! */
-				MAAP_LOGF_ERROR("Error %d writing to network socket (%s)", errno, strerror(errno));
-				Net_freeQueuedPacket(mc.net, packet_data);
-				break;
-			}
-			Net_freeQueuedPacket(mc.net, packet_data);
-		}
+		waittime = -1;
 
-		/* Process any notifications. */
-		while (get_notify(&mc, (void *)&notifysocket, &recvnotify) > 0)
+		for (n = 0; n < num_ifaces; ++n)
 		{
-			if ((int) notifysocket == -1) {
-				/* Just display the information for the user. */
-				print_notify(&recvnotify, display_print_notify_result, NULL);
-			} else {
-				/* Log the result. */
-				print_notify(&recvnotify, log_print_notify_result, NULL);
+			Maap_Client *mc = &ifc[n].mc;
 
-				/* Send the notification information to the client. */
-				for (i = 0; i < MAX_CLIENT_CONNECTIONS; ++i)
+			/* Send any queued packets. */
+			while (mc->net != NULL && (packet_data = Net_getNextQueuedPacket(mc->net)) != NULL)
+			{
+				if (send(ifc[n].socketfd, packet_data, MAAP_NET_BUFFER_SIZE, 0) < 0)
 				{
-					if (clientfd[i] == (int) notifysocket)
+					/* Something went wrong.  Abort! */
+					MAAP_LOGF_ERROR("Error %d writing to network socket of %s (%s)", errno, ifc[n].name, strerror(errno));
+					Net_freeQueuedPacket(mc->net, packet_data);
+					break;
+				}
+				Net_freeQueuedPacket(mc->net, packet_data);
+			}
+
+			/* Process any notifications. */
+			cache_changed = 0;
+			while (get_notify_addresses(mc, (void *)&notifysocket, &recvnotify, &notifyaddresses, &numnotifyaddresses) > 0)
+			{
+				if ((int) notifysocket == -1) {
+					/* Just display the information for the user. */
+					print_notify_iface(&ifc[n], num_ifaces, &recvnotify, notifyaddresses, numnotifyaddresses, display_print_notify_result, NULL);
+				} else {
+					/* Log the result. */
+					print_notify_iface(&ifc[n], num_ifaces, &recvnotify, notifyaddresses, numnotifyaddresses, log_print_notify_result, NULL);
+
+					/* Send the notification information to the client. */
+					for (i = 0; i < MAX_CLIENT_CONNECTIONS; ++i)
 					{
-						if (client_wants_text[i]) {
-							// Send the friendly text notification to the socket.
-							print_notify(&recvnotify, send_print_notify_result, (void *) &(clientfd[i]));
-						} else {
-							// Send the raw notification to the socket.
-							if (send((int) notifysocket, &recvnotify, sizeof(recvnotify), 0) < 0)
-							{
-								/* Something went wrong. Assume the socket will be closed below. */
-								MAAP_LOGF_ERROR("Error %d writing to client socket %d (%s)", errno, (int) notifysocket, strerror(errno));
+						if (clientfd[i] == (int) notifysocket)
+						{
+							if (client_wants_text[i]) {
+								// Send the friendly text notification to the socket.
+								print_notify_iface(&ifc[n], num_ifaces, &recvnotify, notifyaddresses, numnotifyaddresses, send_print_notify_result, (void *) &(clientfd[i]));
+							} else {
+								// Send the raw notification to the socket.
+								if (send_notify((int) notifysocket, &recvnotify, (client_wants_iface[i] ? ifc[n].name : NULL), notifyaddresses, numnotifyaddresses) < 0)
+								{
+									/* Something went wrong. Assume the socket will be closed below. */
+									MAAP_LOGF_ERROR("Error %d writing to client socket %d (%s)", errno, (int) notifysocket, strerror(errno));
+								}
 							}
+							break;
 						}
-						break;
+					}
+					if (i >= MAX_CLIENT_CONNECTIONS)
+					{
+						MAAP_LOGF_WARNING("Notification for client socket %d, but that socket no longer exists", (int) notifysocket);
 					}
 				}
-				if (i >= MAX_CLIENT_CONNECTIONS)
-				{
-					MAAP_LOGF_WARNING("Notification for client socket %d, but that socket no longer exists", (int) notifysocket);
+				free(notifyaddresses);
+
+				switch (recvnotify.kind) {
+				case MAAP_NOTIFY_INITIALIZED:
+				case MAAP_NOTIFY_ACQUIRED:
+				case MAAP_NOTIFY_ACQUIRED_BULK:
+				case MAAP_NOTIFY_RELEASED:
+				case MAAP_NOTIFY_YIELDED:
+					cache_changed = 1;
+					break;
+				default:
+					break;
 				}
 			}
+			if (cache_changed && ifc[n].cachefile) {
+				save_allocation_cache(mc, ifc[n].cachefile);
+			}
+
+			/* The soonest timer of all the interfaces determines how long to wait. */
+			ifcwait = maap_get_delay_to_next_timer(mc);
+			if (waittime < 0 || ifcwait < waittime) {
+				waittime = ifcwait;
+			}
 		}
 
 		/* Determine how long to wait. */
-		waittime = maap_get_delay_to_next_timer(&mc);
 		if (waittime > 0)
 		{
 			tv.tv_sec = waittime / 1000000000;
@@ -411,28 +532,38 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 		}
 		if (ret == 0)
 		{
-			/* The timer timed out.  Handle the timer. */
-			maap_handle_timer(&mc);
+			/* The timer timed out.  Handle the timers that are due. */
+			for (n = 0; n < num_ifaces; ++n) {
+				maap_handle_timer(&ifc[n].mc);
+			}
 			continue;
 		}
 
 		/* Handle any packets received. */
-		if (FD_ISSET(socketfd, &read_fds))
+		for (n = 0; n < num_ifaces; ++n)
 		{
-			struct sockaddr_ll ll_addr = {0};
-			socklen_t addr_len = 0;
-
-			while ((recvbytes = recvfrom(socketfd, recvbuffer, sizeof(recvbuffer), MSG_DONTWAIT, (struct sockaddr*)&ll_addr, &addr_len)) > 0)
-			{
-				maap_handle_packet(&mc, (uint8_t *)recvbuffer, recvbytes);
-			}
-			if (recvbytes < 0 && errno != EWOULDBLOCK)
+			if (FD_ISSET(ifc[n].socketfd, &read_fds))
 			{
-				/* Something went wrong.  Abort! */
-				MAAP_LOGF_ERROR("Error %d reading from network socket (%s)", errno, strerror(errno));
-				break;
+				struct sockaddr_ll ll_addr = {0};
+				socklen_t addr_len = 0;
+
+				while ((recvbytes = recvfrom(ifc[n].socketfd, recvbuffer, sizeof(recvbuffer), MSG_DONTWAIT, (struct sockaddr*)&ll_addr, &addr_len)) > 0)
+				{
+					maap_handle_packet(&ifc[n].mc, (uint8_t *)recvbuffer, recvbytes);
+				}
+				if (recvbytes < 0 && errno != EWOULDBLOCK)
+				{
+					/* Something went wrong.  Abort! */
+					MAAP_LOGF_ERROR("Error %d reading from network socket of %s (%s)", errno, ifc[n].name, strerror(errno));
+					net_error = 1;
+					break;
+				}
 			}
 		}
+		if (net_error)
+		{
+			break;
+		}
 
 		/* Accept any new connections. */
 		if (FD_ISSET(listener, &read_fds)) {
@@ -479,6 +610,7 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 				if (newfd != -1)
 				{
 					clientfd[nextclientindex] = newfd;
+					client_wants_iface[nextclientindex] = 0;
 					nextclientindex = (nextclientindex + 1) % MAX_CLIENT_CONNECTIONS; /* Next slot used for the next try. */
 					FD_SET(newfd, &master); /* add to master set */
 					if (newfd > fdmax) {    /* keep track of the max */
@@ -500,21 +632,31 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 			{
 				recvbuffer[recvbytes] = '\0';
 
-				/* Process the command data (may be binary or text). */
-				memset(&recvcmd, 0, sizeof(recvcmd));
-				int result = parse_write(&mc, (const void *)(uintptr_t) -1, recvbuffer, NULL);
-				if (result > 0)
+				/* Find the interface the command is for. */
+				parse_iface(recvbuffer, recvbytes, ifname);
+				target = find_interface(ifc, num_ifaces, ifname);
+				if (target == NULL)
 				{
-					/* Received a command to exit. */
-					exit_received = 1;
+					printf("Unknown interface %s\n", ifname);
 				}
-				else if (result < 0)
+				else
 				{
-					/* Invalid command.  Tell the user what valid commands are. */
-					if (strncmp(recvbuffer, "help", 4) != 0) {
-						puts("Invalid command type");
+					/* Process the command data (may be binary or text). */
+					memset(&recvcmd, 0, sizeof(recvcmd));
+					int result = parse_write(&target->mc, (const void *)(uintptr_t) -1, recvbuffer, NULL);
+					if (result > 0)
+					{
+						/* Received a command to exit. */
+						exit_received = 1;
+					}
+					else if (result < 0)
+					{
+						/* Invalid command.  Tell the user what valid commands are. */
+						if (strncmp(recvbuffer, "help", 4) != 0) {
+							puts("Invalid command type");
+						}
+						parse_usage(display_print_notify_result, NULL);
 					}
-					parse_usage(display_print_notify_result, NULL);
 				}
 			}
 		}
@@ -524,7 +666,7 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 		{
 			if (clientfd[i] != -1 && FD_ISSET(clientfd[i], &read_fds))
 			{
-				recvbytes = recv(clientfd[i], recvbuffer, sizeof(recvbuffer), 0);
+				recvbytes = recv(clientfd[i], recvbuffer, sizeof(recvbuffer) - 1, 0);
 				if (recvbytes < 0)
 				{
 					MAAP_LOGF_WARNING("Error %d reading from socket %d (%s).  Connection closed.", errno, clientfd[i], strerror(errno));
@@ -545,9 +687,25 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 				{
 					recvbuffer[recvbytes] = '\0';
 
+					/* Find the interface the command is for. */
+					named = parse_iface(recvbuffer, recvbytes, ifname);
+					target = find_interface(ifc, num_ifaces, ifname);
+					if (target == NULL)
+					{
+						char errtext[MAAP_IFNAME_LEN + 32];
+						snprintf(errtext, sizeof(errtext), "Unknown interface %s", ifname);
+						send_print_notify_result((void *) &(clientfd[i]), MAAP_LOG_LEVEL_ERROR, errtext);
+						continue;
+					}
+
 					/* Process the command data (may be binary or text). */
 					memset(&recvcmd, 0, sizeof(recvcmd));
-					int result = parse_write(&mc, (const void *)(uintptr_t) clientfd[i], recvbuffer, &(client_wants_text[i]));
+					int result = parse_write(&target->mc, (const void *)(uintptr_t) clientfd[i], recvbuffer, &(client_wants_text[i]));
+					if (named && !client_wants_text[i])
+					{
+						/* The client understands the interface name following binary notifications. */
+						client_wants_iface[i] = 1;
+					}
 					if (result > 0)
 					{
 						/* Received a command to exit. */
@@ -567,7 +725,6 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 
 	}
 
-	close(socketfd);
 	close(listener);
 
 	/* Close any connected sockets. */
@@ -578,7 +735,11 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 		}
 	}
 
-	maap_deinit_client(&mc);
+	for (n = 0; n < num_ifaces; ++n) {
+		close(ifc[n].socketfd);
+		maap_deinit_client(&ifc[n].mc);
+		free(ifc[n].cachefile);
+	}
 
 	MAAP_LOG_STATUS("Server stopped");
 
@@ -587,6 +748,36 @@ static int act_as_server(const char *listenport, char *iface, int daemonize)
 	return (exit_received ? 0 : -1);
 }
 
+/* Returns the interface named ifname, or the first interface if ifname is empty. */
+static Maap_Interface *find_interface(Maap_Interface *ifc, int num_ifaces, const char *ifname)
+{
+	int n;
+
+	if (ifname[0] == '\0') {
+		return &ifc[0];
+	}
+	for (n = 0; n < num_ifaces; ++n) {
+		if (strcmp(ifc[n].name, ifname) == 0) {
+			return &ifc[n];
+		}
+	}
+	return NULL;
+}
+
+/* Prints a notification, preceded by the name of its interface when the server has several. */
+static void print_notify_iface(const Maap_Interface *ifc, int num_ifaces, Maap_Notify *mn, const uint64_t *addresses, int num_addresses,
+	print_notify_callback_t print_callback, void *callback_data)
+{
+	char szOutput[MAAP_IFNAME_LEN + 16];
+
+	if (num_ifaces > 1) {
+		snprintf(szOutput, sizeof(szOutput), "Interface %.*s:", MAAP_IFNAME_LEN - 1, ifc->name);
+		print_callback(callback_data, MAAP_LOG_LEVEL_INFO, szOutput);
+	}
+	print_notify(mn, print_callback, callback_data);
+	print_notify_addresses(mn, addresses, num_addresses, print_callback, callback_data);
+}
+
 /* Initializes the MAAP raw socket support, and returns a socket handle for that socket. */
 static int init_maap_networking(const char *iface, uint8_t src_mac[ETH_ALEN], uint8_t dest_mac[ETH_ALEN])
 {
@@ -724,6 +915,13 @@ static int act_as_client(const char *listenport)
 	char recvbuffer[200];
 	int recvbytes;
 	Maap_Cmd recvcmd;
+	Maap_Notify_Bulk recvbulk;
+	uint64_t recvaddresses[MAAP_MAX_BULK_RANGES];
+	char ifname[MAAP_IFNAME_LEN];
+	Maap_Ifname recvname;
+	char sendbuffer[sizeof(Maap_Cmd) + sizeof(Maap_Ifname)];
+	size_t sendlen;
+	int uses_iface = 0;
 	int exit_received = 0;
 
 	/* Create a localhost socket. */
@@ -803,7 +1001,35 @@ static int act_as_client(const char *listenport)
 				/* Process the response data (will be binary). */
 				if (recvbytes == sizeof(Maap_Notify))
 				{
+					if (uses_iface)
+					{
+						/* The daemon names the interface after each notification once we have named one. */
+						if (recv(socketfd, &recvname, sizeof(recvname), MSG_WAITALL) != sizeof(recvname))
+						{
+							MAAP_LOG_WARNING("Received incomplete interface name");
+						}
+						else
+						{
+							recvname.name[MAAP_IFNAME_LEN - 1] = '\0';
+							printf("Interface %s:\n", recvname.name);
+						}
+					}
 					print_notify((Maap_Notify *) recvbuffer, display_print_notify_result, NULL);
+					if (((Maap_Notify *) recvbuffer)->kind == MAAP_NOTIFY_ACQUIRED_BULK)
+					{
+						/* The address list is sent immediately after the notification. */
+						if (recv(socketfd, &recvbulk, sizeof(recvbulk), MSG_WAITALL) != sizeof(recvbulk) ||
+							recvbulk.num_ranges > MAAP_MAX_BULK_RANGES ||
+							recv(socketfd, recvaddresses, recvbulk.num_ranges * sizeof(uint64_t), MSG_WAITALL) !=
+								(int) (recvbulk.num_ranges * sizeof(uint64_t)))
+						{
+							MAAP_LOG_WARNING("Received incomplete address list");
+						}
+						else
+						{
+							print_notify_addresses((Maap_Notify *) recvbuffer, recvaddresses, recvbulk.num_ranges, display_print_notify_result, NULL);
+						}
+					}
 				}
 				else
 				{
@@ -838,6 +1064,7 @@ static int act_as_client(const char *listenport)
 				int rv = 0;
 
 				recvbuffer[recvbytes] = '\0';
+				ifname[0] = '\0';
 
 				/* Determine the command requested (may be binary or text). */
 				switch (bufcmd->kind) {
@@ -847,11 +1074,13 @@ static int act_as_client(const char *listenport)
 				case MAAP_CMD_STATUS:
 				case MAAP_CMD_YIELD:
 				case MAAP_CMD_EXIT:
+				case MAAP_CMD_RESERVE_BULK:
 					memcpy(&recvcmd, bufcmd, sizeof(Maap_Cmd));
 					rv = 1;
 					break;
 				default:
 					memset(&recvcmd, 0, sizeof(Maap_Cmd));
+					parse_iface(recvbuffer, recvbytes, ifname);
 					rv = parse_text_cmd(recvbuffer, &recvcmd);
 					if (!rv) {
 						if (strncmp(recvbuffer, "help", 4) != 0) {
@@ -865,7 +1094,18 @@ static int act_as_client(const char *listenport)
 				/* If the command is valid, Send it to the MAAP daemon. */
 				if (rv)
 				{
-					if (send(socketfd, (char *) &recvcmd, sizeof(Maap_Cmd), 0) < 0)
+					memcpy(sendbuffer, &recvcmd, sizeof(Maap_Cmd));
+					sendlen = sizeof(Maap_Cmd);
+					if (ifname[0] != '\0')
+					{
+						/* Follow the command with the interface it is for. */
+						memset(&recvname, 0, sizeof(recvname));
+						memcpy(recvname.name, ifname, strlen(ifname));
+						memcpy(sendbuffer + sendlen, &recvname, sizeof(recvname));
+						sendlen += sizeof(recvname);
+						uses_iface = 1;
+					}
+					if (send(socketfd, sendbuffer, sendlen, 0) < 0)
 					{
 						/* Something went wrong.  Abort! */
 						MAAP_LOGF_ERROR("Error %d writing to network socket (%s)", errno, strerror(errno));
@@ -920,6 +1160,126 @@ static int do_daemonize(void)
 	return 0;
 }
 
+/* Initializes MAAP and restores the address ranges saved by save_allocation_cache(). */
+static void load_allocation_cache(Maap_Client *mc, const char *cachefile)
+{
+	FILE *fp;
+	char line[100];
+	unsigned long long start;
+	unsigned long count;
+	int restored = 0;
+
+	fp = fopen(cachefile, "r");
+	if (fp == NULL)
+	{
+		if (errno != ENOENT)
+		{
+			MAAP_LOGF_WARNING("Error %d opening cache file %s (%s)", errno, cachefile, strerror(errno));
+		}
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "init %llx %lu", &start, &count) == 2)
+		{
+			if (maap_init_client(mc, (const void *)(uintptr_t) -1, start, (uint32_t) count) < 0)
+			{
+				break;
+			}
+		}
+		else if (sscanf(line, "range %llx %lu", &start, &count) == 2)
+		{
+			if (maap_restore_range(mc, (const void *)(uintptr_t) -1, start, (uint32_t) count) > 0)
+			{
+				restored++;
+			}
+		}
+	}
+	fclose(fp);
+
+	MAAP_LOGF_STATUS("Restored %d address ranges from %s", restored, cachefile);
+}
+
+/* Saves the initialized range and the address ranges being defended, so they can be announced again after a restart. */
+static void save_allocation_cache(Maap_Client *mc, const char *cachefile)
+{
+	FILE *fp;
+	char tmpfile[PATH_MAX];
+	Interval *iv;
+	Range *range;
+
+	if (snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", cachefile) >= (int) sizeof(tmpfile))
+	{
+		MAAP_LOGF_ERROR("Cache file name %s is too long", cachefile);
+		return;
+	}
+
+	fp = fopen(tmpfile, "w");
+	if (fp == NULL)
+	{
+		MAAP_LOGF_ERROR("Error %d creating cache file %s (%s)", errno, tmpfile, strerror(errno));
+		return;
+	}
+
+	if (mc->initialized)
+	{
+		fprintf(fp, "init 0x%012llx %lu\n", (unsigned long long) mc->address_base, (unsigned long) mc->range_len);
+		for (iv = minimum_interval(mc->ranges); iv != NULL; iv = next_interval(iv))
+		{
+			range = iv->data;
+			if (range->state == MAAP_STATE_DEFENDING)
+			{
+				fprintf(fp, "range 0x%012llx %lu\n",
+					(unsigned long long) (mc->address_base + iv->low),
+					(unsigned long) (iv->high - iv->low + 1));
+			}
+		}
+	}
+
+	/* Replace the old cache in one step, so a power failure never leaves a partial file. */
+	if (fclose(fp) != 0 || rename(tmpfile, cachefile) != 0)
+	{
+		MAAP_LOGF_ERROR("Error %d writing cache file %s (%s)", errno, cachefile, strerror(errno));
+		unlink(tmpfile);
+	}
+}
+
+/* Sends a binary notification, followed by the interface name (if ifname is not NULL)
+ * and its address list for #MAAP_NOTIFY_ACQUIRED_BULK, in a single write. */
+static int send_notify(int socketfd, const Maap_Notify *mn, const char *ifname, const uint64_t *addresses, int num_addresses)
+{
+	char sendbuffer[sizeof(Maap_Notify) + sizeof(Maap_Ifname) + sizeof(Maap_Notify_Bulk) + MAAP_MAX_BULK_RANGES * sizeof(uint64_t)];
+	Maap_Notify_Bulk bulk;
+	Maap_Ifname name;
+	size_t len = 0;
+
+	memcpy(sendbuffer, mn, sizeof(Maap_Notify));
+	len += sizeof(Maap_Notify);
+	if (ifname)
+	{
+		memset(&name, 0, sizeof(name));
+		memcpy(name.name, ifname, strnlen(ifname, MAAP_IFNAME_LEN - 1));
+		memcpy(sendbuffer + len, &name, sizeof(name));
+		len += sizeof(name);
+	}
+	if (mn->kind == MAAP_NOTIFY_ACQUIRED_BULK)
+	{
+		if (num_addresses > MAAP_MAX_BULK_RANGES) { num_addresses = MAAP_MAX_BULK_RANGES; }
+		bulk.num_ranges = num_addresses;
+		bulk.reserved = 0;
+		memcpy(sendbuffer + len, &bulk, sizeof(bulk));
+		len += sizeof(bulk);
+		if (num_addresses > 0)
+		{
+			memcpy(sendbuffer + len, addresses, num_addresses * sizeof(uint64_t));
+			len += num_addresses * sizeof(uint64_t);
+		}
+	}
+
+	return (send(socketfd, sendbuffer, len, 0) < 0 ? -1 : 0);
+}
+
 static void log_print_notify_result(void *callback_data, int logLevel, const char *notifyText)
 {
 	switch (logLevel) {
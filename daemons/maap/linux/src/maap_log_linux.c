@@ -35,7 +35,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAAP_LOG_COMPONENT "Log"
 #include "maap_log.h"
 
+// The producer only captures the message text and the raw header fields.
+// The header is formatted by whoever outputs the item (normally the logging thread).
 typedef struct {
+	const char *tag;
+	const char *company;
+	const char *component;
+	const char *path;
+	int line;
+	unsigned long thread;
+	struct timespec nowTS;
 	uint8_t msg[LOG_QUEUE_MSG_SIZE];
   	int bRT;						// TRUE = Details are in RT queue
 } log_queue_item_t;
@@ -59,12 +68,6 @@ typedef struct {
 static maap_log_queue_t logQueue;
 static maap_log_queue_t logRTQueue;
 
-static char msg[LOG_MSG_LEN] = "";
-static char time_msg[LOG_TIME_LEN] = "";
-static char timestamp_msg[LOG_TIMESTAMP_LEN] = "";
-static char file_msg[LOG_FILE_LEN] = "";
-static char proc_msg[LOG_PROC_LEN] = "";
-static char thread_msg[LOG_THREAD_LEN] = "";
 static char full_msg[LOG_FULL_MSG_LEN] = "";
 
 static char rt_msg[LOG_RT_MSG_LEN] = "";
@@ -77,6 +80,7 @@ THREAD_DEFINITON(loggingThread);
 #define THREAD_STACK_SIZE 									65536
 #define loggingThread_THREAD_STK_SIZE    					THREAD_STACK_SIZE
 
+// Only serializes multi-call RT records; maapLogFn() does not take it.
 static MUTEX_HANDLE_ALT(gLogMutex);
 #define LOG_LOCK() MUTEX_LOCK_ALT(gLogMutex)
 #define LOG_UNLOCK() MUTEX_UNLOCK_ALT(gLogMutex)
@@ -138,10 +142,58 @@ void maapLogRTRender(log_queue_item_t *pLogItem)
 				}
 				maapLogQueueTailPull(logRTQueue);
 			}
+			else {
+				// The rest of the record was dropped.
+				bMore = FALSE;
+			}
 		}
 	}
 }
 
+static void maapLogRender(const log_queue_item_t *pLogItem, char *pBuf, size_t bufSize)
+{
+	char time_msg[LOG_TIME_LEN] = "";
+	char timestamp_msg[LOG_TIMESTAMP_LEN] = "";
+	char file_msg[LOG_FILE_LEN] = "";
+	char proc_msg[LOG_PROC_LEN] = "";
+	char thread_msg[LOG_THREAD_LEN] = "";
+
+	if (pLogItem->bRT) {
+		snprintf(pBuf, bufSize, "%s", (const char *)pLogItem->msg);
+		return;
+	}
+
+	if (MAAP_LOG_FILE_INFO && pLogItem->path) {
+		const char *file = strrchr(pLogItem->path, '/');
+		if (!file)
+			file = strrchr(pLogItem->path, '\\');
+		if (file)
+			file += 1;
+		else
+			file = pLogItem->path;
+		snprintf(file_msg, sizeof(file_msg), " %s:%d", file, pLogItem->line);
+	}
+	if (MAAP_LOG_PROC_INFO) {
+		snprintf(proc_msg, sizeof(proc_msg), " P:%5.5d", GET_PID());
+	}
+	if (MAAP_LOG_THREAD_INFO) {
+		snprintf(thread_msg, sizeof(thread_msg), " T:%lu", pLogItem->thread);
+	}
+	if (MAAP_LOG_TIME_INFO) {
+		struct tm tmNow;
+		localtime_r(&pLogItem->nowTS.tv_sec, &tmNow);
+
+		snprintf(time_msg, sizeof(time_msg), "%2.2d:%2.2d:%2.2d", tmNow.tm_hour, tmNow.tm_min, tmNow.tm_sec);
+	}
+	if (MAAP_LOG_TIMESTAMP_INFO) {
+		snprintf(timestamp_msg, sizeof(timestamp_msg), "%lu:%09lu", pLogItem->nowTS.tv_sec, pLogItem->nowTS.tv_nsec);
+	}
+
+	snprintf(pBuf, bufSize, "[%s%s%s%s %s %s%s] %s: %s%s", time_msg, timestamp_msg, proc_msg, thread_msg,
+		pLogItem->company, pLogItem->component, file_msg, pLogItem->tag, (const char *)pLogItem->msg,
+		(MAAP_LOG_EXTRA_NEWLINE ? "\n" : ""));
+}
+
 uint32_t maapLogGetMsg(uint8_t *pBuf, uint32_t bufSize)
 {
 	uint32_t dataLen = 0;
@@ -152,12 +204,13 @@ uint32_t maapLogGetMsg(uint8_t *pBuf, uint32_t bufSize)
 
 			if (pLogItem->bRT)
 				maapLogRTRender(pLogItem);
+			maapLogRender(pLogItem, full_msg, sizeof(full_msg));
 
-			dataLen = strlen((const char *)pLogItem->msg);
+			dataLen = strlen(full_msg);
 			if (dataLen <= bufSize)
-				memcpy(pBuf, (uint8_t *)pLogItem->msg, dataLen);
+				memcpy(pBuf, (uint8_t *)full_msg, dataLen);
 			else
-			  	memcpy(pBuf, (uint8_t *)pLogItem->msg, bufSize);
+			  	memcpy(pBuf, (uint8_t *)full_msg, bufSize);
 			maapLogQueueTailPull(logQueue);
 			return dataLen;
 		}
@@ -180,12 +233,19 @@ void *loggingThreadFn(void *pv)
 
 				if (pLogItem->bRT)
 					maapLogRTRender(pLogItem);
+				maapLogRender(pLogItem, full_msg, sizeof(full_msg));
 
-				fputs((const char *)pLogItem->msg, MAAP_LOG_OUTPUT_FD);
+				fputs(full_msg, MAAP_LOG_OUTPUT_FD);
 				maapLogQueueTailPull(logQueue);
 				more = TRUE;
 			}
 		}
+
+		uint32_t dropped = maapLogQueueTakeDropCount(logQueue) + maapLogQueueTakeDropCount(logRTQueue);
+		if (dropped) {
+			fprintf(MAAP_LOG_OUTPUT_FD, "[%s %s] WARNING: %" PRIu32 " log messages dropped\n",
+				MAAP_LOG_COMPANY, MAAP_LOG_COMPONENT, dropped);
+		}
 	}
 
 	return NULL;
@@ -235,66 +295,42 @@ void maapLogFn(
 {
 	if (level <= MAAP_LOG_LEVEL) {
 		va_list args;
-		va_start(args, fmt);
-
-		LOG_LOCK();
-
-		vsprintf(msg, fmt, args);
-
-		if (MAAP_LOG_FILE_INFO && path) {
-			char* file = strrchr(path, '/');
-			if (!file)
-				file = strrchr(path, '\\');
-			if (file)
-				file += 1;
-			else
-				file = (char*)path;
-			sprintf(file_msg, " %s:%d", file, line);
-		}
-		if (MAAP_LOG_PROC_INFO) {
-			sprintf(proc_msg, " P:%5.5d", GET_PID());
-		}
-		if (MAAP_LOG_THREAD_INFO) {
-			sprintf(thread_msg, " T:%lu", THREAD_SELF());
+		log_queue_item_t localItem;
+		log_queue_item_t *pLogItem = &localItem;
+		maap_log_queue_elem_t elem = NULL;
+		int bQueued = (MAAP_LOG_FROM_THREAD || MAAP_LOG_PULL_MODE);
+
+		if (bQueued) {
+			// Format straight into a claimed slot; a full queue drops the message.
+			if (!logQueue)
+				return;
+			elem = maapLogQueueHeadLock(logQueue);
+			if (!elem)
+				return;
+			pLogItem = (log_queue_item_t *)maapLogQueueData(elem);
 		}
-		if (MAAP_LOG_TIME_INFO) {
-			time_t tNow = time(NULL);
-			struct tm tmNow;
-			localtime_r(&tNow, &tmNow);
 
-			sprintf(time_msg, "%2.2d:%2.2d:%2.2d", tmNow.tm_hour, tmNow.tm_min, tmNow.tm_sec);
-		}
-		if (MAAP_LOG_TIMESTAMP_INFO) {
-			struct timespec nowTS;
-			clock_gettime(CLOCK_REALTIME, &nowTS);
-
-			sprintf(timestamp_msg, "%lu:%09lu", nowTS.tv_sec, nowTS.tv_nsec);
-		}
+		pLogItem->bRT = FALSE;
+		pLogItem->tag = tag;
+		pLogItem->company = company;
+		pLogItem->component = component;
+		pLogItem->path = path;
+		pLogItem->line = line;
+		pLogItem->thread = (unsigned long)THREAD_SELF();
+		clock_gettime(CLOCK_REALTIME, &pLogItem->nowTS);
 
-		// using sprintf and puts allows using static buffers rather than heap.
-		if (MAAP_LOG_EXTRA_NEWLINE)
-			/* int32_t full_msg_len = */ sprintf(full_msg, "[%s%s%s%s %s %s%s] %s: %s\n", time_msg, timestamp_msg, proc_msg, thread_msg, company, component, file_msg, tag, msg);
-		else
-			/* int32_t full_msg_len = */ sprintf(full_msg, "[%s%s%s%s %s %s%s] %s: %s", time_msg, timestamp_msg, proc_msg, thread_msg, company, component, file_msg, tag, msg);
+		va_start(args, fmt);
+		vsnprintf((char *)pLogItem->msg, LOG_QUEUE_MSG_SIZE, fmt, args);
+		va_end(args);
 
-		if (!MAAP_LOG_FROM_THREAD && !MAAP_LOG_PULL_MODE) {
-			fputs(full_msg, MAAP_LOG_OUTPUT_FD);
+		if (bQueued) {
+			maapLogQueueHeadPush(logQueue, elem);
 		}
 		else {
-			if (logQueue) {
-				maap_log_queue_elem_t elem = maapLogQueueHeadLock(logQueue);
-				if (elem) {
-					log_queue_item_t *pLogItem = (log_queue_item_t *)maapLogQueueData(elem);
-					pLogItem->bRT = FALSE;
-					strncpy((char *)pLogItem->msg, full_msg, LOG_QUEUE_MSG_LEN);
-					maapLogQueueHeadPush(logQueue);
-				}
-			}
+			char out_msg[LOG_FULL_MSG_LEN];
+			maapLogRender(pLogItem, out_msg, sizeof(out_msg));
+			fputs(out_msg, MAAP_LOG_OUTPUT_FD);
 		}
-
-		va_end(args);
-
-		LOG_UNLOCK();
 	}
 }
 
@@ -312,7 +348,7 @@ void maapLogRT(int level, int bBegin, int bItem, int bEnd, char *pFormat, log_rt
 					pLogRTItem->pFormat = NULL;
 					pLogRTItem->dataType = LOG_RT_DATATYPE_NOW_TS;
 					clock_gettime(CLOCK_REALTIME, &pLogRTItem->data.nowTS);
-					maapLogQueueHeadPush(logRTQueue);
+					maapLogQueueHeadPush(logRTQueue, elem);
 				}
 			}
 
@@ -354,7 +390,7 @@ void maapLogRT(int level, int bBegin, int bItem, int bEnd, char *pFormat, log_rt
 						default:
 							break;
 					}
-					maapLogQueueHeadPush(logRTQueue);
+					maapLogQueueHeadPush(logRTQueue, elem);
 				}
 			}
 
@@ -365,24 +401,22 @@ void maapLogRT(int level, int bBegin, int bItem, int bEnd, char *pFormat, log_rt
 					pLogRTItem->bEnd = TRUE;
 					pLogRTItem->pFormat = NULL;
 					pLogRTItem->dataType = LOG_RT_DATATYPE_NONE;
-					maapLogQueueHeadPush(logRTQueue);
+					maapLogQueueHeadPush(logRTQueue, elem);
 				}
 			}
 
 			if (bEnd) {
-				if (logQueue) {
+				if (MAAP_LOG_FROM_THREAD || MAAP_LOG_PULL_MODE) {
 					maap_log_queue_elem_t elem = maapLogQueueHeadLock(logQueue);
 					if (elem) {
 						log_queue_item_t *pLogItem = (log_queue_item_t *)maapLogQueueData(elem);
 						pLogItem->bRT = TRUE;
-						if (MAAP_LOG_FROM_THREAD) {
-							maapLogQueueHeadPush(logQueue);
-						} else {
-							maapLogRTRender(pLogItem);
-							fputs((const char *)pLogItem->msg, MAAP_LOG_OUTPUT_FD);
-							maapLogQueueHeadUnlock(logQueue);
-						}
+						maapLogQueueHeadPush(logQueue, elem);
 					}
+				} else {
+					log_queue_item_t logItem;
+					maapLogRTRender(&logItem);
+					fputs((const char *)logItem.msg, MAAP_LOG_OUTPUT_FD);
 				}
 
 				LOG_UNLOCK();
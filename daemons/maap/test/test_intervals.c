@@ -52,6 +52,35 @@ void print_node(Interval *node) {
 	total++;
 }
 
+/* Returns the black height of the subtree, or -1 if it is not a valid
+   red-black tree with consistent parent links */
+int check_balance(Interval *node) {
+	int left, right;
+
+	if (!node) return 0;
+	if ((node->left_child && node->left_child->parent != node) ||
+		(node->right_child && node->right_child->parent != node)) {
+		return -1;
+	}
+	if (node->color && ((node->left_child && node->left_child->color) ||
+		(node->right_child && node->right_child->color))) {
+		return -1; /* Red node with a red child */
+	}
+	left = check_balance(node->left_child);
+	right = check_balance(node->right_child);
+	if (left < 0 || left != right) return -1;
+	return left + (node->color ? 0 : 1);
+}
+
+int tree_depth(Interval *node) {
+	int left, right;
+
+	if (!node) return 0;
+	left = tree_depth(node->left_child);
+	right = tree_depth(node->right_child);
+	return 1 + (left > right ? left : right);
+}
+
 int main(void) {
 	Interval *set = NULL, *inter, *over, *prev;
 	int i, rv, count;
@@ -82,6 +111,30 @@ int main(void) {
 	}
 
 	count = INTERVALS_TO_ADD;
+	printf("\nInserting %d ascending intervals into a set\n", count);
+
+	for (i = 0; i < count; i++) {
+		inter = alloc_interval(i * 16, 8);
+		if (insert_interval(&set, inter) != INTERVAL_SUCCESS) {
+			fprintf(stderr, "Error:  Insert of [%d,%d] failed unexpectedly\n", inter->low, inter->high);
+			return 1; /* Error */
+		}
+	}
+	/* A red-black tree is never deeper than 2 * log2(n + 1) */
+	if (check_balance(set) < 0 || tree_depth(set) > 20) {
+		fprintf(stderr, "Error:  Tree of ascending intervals is unbalanced (depth %d)\n", tree_depth(set));
+		return 1; /* Error */
+	}
+	while (set) {
+		inter = remove_interval(&set, set);
+		free_interval(inter);
+		if (check_balance(set) < 0) {
+			fprintf(stderr, "Error:  Tree is unbalanced after a removal\n");
+			return 1; /* Error */
+		}
+	}
+	printf("Balanced tree testing passed\n");
+
 	printf("\nInserting %d random intervals into a set\n", count);
 
 	for (i = 0; i < count;) {
@@ -120,6 +173,10 @@ int main(void) {
 			if (over) over = remove_interval(&set, over);
 		}
 	}
+	if (check_balance(set) < 0) {
+		fprintf(stderr, "Error:  Tree is unbalanced after replacements\n");
+		return 1; /* Error */
+	}
 
 	/* Test that searches always return the first match */
 	for (i = 0; i < INTERVALS_TO_SEARCH; i++) {
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "CppUTest/TestHarness.h"
@@ -1315,6 +1316,222 @@ TEST(maap_group, Multiple_Conflicts_Defend)
 	maap_deinit_client(&mc);
 }
 
+TEST(maap_group, Reserve_Bulk)
+{
+	const uint64_t range_base_addr = MAAP_DYNAMIC_POOL_BASE;
+	const uint32_t range_size = MAAP_DYNAMIC_POOL_SIZE;
+	const int num_blocks = 64;
+	Maap_Client mc;
+	Maap_Notify mn;
+	const int sender1_in = 1, sender2_in = 2;
+	const void *sender_out;
+	int i, first_id, countdown, timer_passes;
+	int probe_packets_detected, announce_packets_detected;
+	uint64_t *addresses;
+	int num_addresses;
+	void *packet_data = NULL;
+	MAAP_Packet packet_contents;
+
+	/* Initialize the Maap_Client structure */
+	memset(&mc, 0, sizeof(Maap_Client));
+	mc.dest_mac = TEST_DEST_ADDR;
+	mc.src_mac = TEST_SRC_ADDR;
+
+	/* Initialize the range */
+	LONGS_EQUAL(0, maap_init_client(&mc, &sender1_in, range_base_addr, range_size));
+	LONGS_EQUAL(1, get_notify(&mc, &sender_out, &mn));
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+
+	/* Too many blocks should be rejected. */
+	LONGS_EQUAL(-1, maap_reserve_ranges(&mc, &sender2_in, 0, 1, MAAP_MAX_BULK_RANGES + 1));
+	LONGS_EQUAL(1, get_notify_addresses(&mc, &sender_out, &mn, &addresses, &num_addresses));
+	LONGS_EQUAL(MAAP_NOTIFY_ACQUIRED_BULK, mn.kind);
+	LONGS_EQUAL(-1, mn.id);
+	LONGS_EQUAL(MAAP_NOTIFY_ERROR_RESERVE_NOT_AVAILABLE, mn.result);
+	CHECK(addresses == NULL);
+	LONGS_EQUAL(0, num_addresses);
+
+	/* Reserve many small blocks, starting with a preferred address. */
+	first_id = maap_reserve_ranges(&mc, &sender2_in, range_base_addr + 0x100, 2, num_blocks);
+	CHECK(first_id > 0);
+
+	/* There should not be any notifications until all the blocks are done. */
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+
+	/* All the blocks should be probed and announced together. */
+	probe_packets_detected = 0;
+	announce_packets_detected = 0;
+	timer_passes = 0;
+	for (countdown = 1000; countdown > 0 && announce_packets_detected < num_blocks; --countdown)
+	{
+		while ((packet_data = Net_getNextQueuedPacket(mc.net)) != NULL)
+		{
+			LONGS_EQUAL(0, unpack_maap(&packet_contents, (const uint8_t *) packet_data));
+			Net_freeQueuedPacket(mc.net, packet_data);
+			if (packet_contents.message_type == MAAP_PROBE)
+			{
+				(probe_packets_detected)++;
+			}
+			else if (packet_contents.message_type == MAAP_ANNOUNCE)
+			{
+				(announce_packets_detected)++;
+			}
+			else
+			{
+				/* Unexpected MAAP_DEFEND packet. */
+				CHECK(0);
+			}
+		}
+		if (announce_packets_detected < num_blocks)
+		{
+			LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+			Time_increaseNanos(maap_get_delay_to_next_timer(&mc));
+			LONGS_EQUAL(0, maap_handle_timer(&mc));
+			timer_passes++;
+		}
+	}
+	CHECK(countdown > 0);
+	LONGS_EQUAL(4 * num_blocks, probe_packets_detected);
+	LONGS_EQUAL(num_blocks, announce_packets_detected);
+	LONGS_EQUAL(MAAP_PROBE_RETRANSMITS + 1, timer_passes);
+
+	/* We should have a single notification with all the addresses. */
+	LONGS_EQUAL(1, get_notify_addresses(&mc, &sender_out, &mn, &addresses, &num_addresses));
+	CHECK(sender_out == &sender2_in);
+	LONGS_EQUAL(MAAP_NOTIFY_ACQUIRED_BULK, mn.kind);
+	LONGS_EQUAL(first_id, mn.id);
+	LONGS_EQUAL(2, mn.count);
+	LONGS_EQUAL(MAAP_NOTIFY_ERROR_NONE, mn.result);
+	LONGS_EQUAL(num_blocks, num_addresses);
+	CHECK(addresses != NULL);
+	for (i = 0; i < num_blocks; ++i) {
+		/* The preferred address was free, so the blocks should be contiguous. */
+		CHECK(addresses[i] == range_base_addr + 0x100 + 2 * i);
+	}
+	free(addresses);
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+
+	/* Each block can be released on its own. */
+	LONGS_EQUAL(0, maap_release_range(&mc, &sender2_in, first_id + num_blocks - 1));
+	LONGS_EQUAL(1, get_notify(&mc, &sender_out, &mn));
+	LONGS_EQUAL(MAAP_NOTIFY_RELEASED, mn.kind);
+	CHECK(mn.start == range_base_addr + 0x100 + 2 * (num_blocks - 1));
+	LONGS_EQUAL(MAAP_NOTIFY_ERROR_NONE, mn.result);
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+
+	/* We are done with the Maap_Client structure */
+	maap_deinit_client(&mc);
+}
+
+TEST(maap_group, Restore_Range)
+{
+	const uint64_t range_base_addr = MAAP_DYNAMIC_POOL_BASE;
+	const uint32_t range_size = MAAP_DYNAMIC_POOL_SIZE;
+	Maap_Client mc;
+	Maap_Notify mn;
+	const int sender1_in = 1, sender2_in = 2;
+	const void *sender_out;
+	int id_claimed, id_unclaimed, id_yielded, countdown;
+	int announce_packets_detected;
+	void *packet_data = NULL;
+	MAAP_Packet packet_contents;
+	MAAP_Packet announce_packet;
+	uint8_t announce_buffer[MAAP_NET_BUFFER_SIZE];
+
+	/* Initialize the Maap_Client structure */
+	memset(&mc, 0, sizeof(Maap_Client));
+	mc.dest_mac = TEST_DEST_ADDR;
+	mc.src_mac = TEST_SRC_ADDR;
+
+	/* Ranges cannot be restored before initialization. */
+	LONGS_EQUAL(-1, maap_restore_range(&mc, &sender1_in, range_base_addr + 0x10, 8));
+
+	/* Initialize the range */
+	LONGS_EQUAL(0, maap_init_client(&mc, &sender1_in, range_base_addr, range_size));
+	LONGS_EQUAL(1, get_notify(&mc, &sender_out, &mn));
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+
+	/* Restore three ranges.  Each should be announced right away, without probing or notifications. */
+	id_claimed = maap_restore_range(&mc, &sender1_in, range_base_addr + 0x10, 8);
+	CHECK(id_claimed > 0);
+	id_unclaimed = maap_restore_range(&mc, &sender1_in, range_base_addr + 0x20, 8);
+	CHECK(id_unclaimed > 0);
+	id_yielded = maap_restore_range(&mc, &sender1_in, range_base_addr + 0x30, 8);
+	CHECK(id_yielded > 0);
+	LONGS_EQUAL(-1, maap_restore_range(&mc, &sender1_in, range_base_addr + 0x14, 8));
+	for (countdown = 0; (packet_data = Net_getNextQueuedPacket(mc.net)) != NULL; ++countdown)
+	{
+		LONGS_EQUAL(0, unpack_maap(&packet_contents, (const uint8_t *) packet_data));
+		Net_freeQueuedPacket(mc.net, packet_data);
+		CHECK(packet_contents.message_type == MAAP_ANNOUNCE);
+	}
+	LONGS_EQUAL(3, countdown);
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+
+	/* A reservation for the same range should complete immediately. */
+	LONGS_EQUAL(id_claimed, maap_reserve_range(&mc, &sender2_in, range_base_addr + 0x10, 8));
+	LONGS_EQUAL(1, get_notify(&mc, &sender_out, &mn));
+	CHECK(sender_out == &sender2_in);
+	LONGS_EQUAL(MAAP_NOTIFY_ACQUIRING, mn.kind);
+	LONGS_EQUAL(1, get_notify(&mc, &sender_out, &mn));
+	CHECK(sender_out == &sender2_in);
+	LONGS_EQUAL(MAAP_NOTIFY_ACQUIRED, mn.kind);
+	LONGS_EQUAL(id_claimed, mn.id);
+	CHECK(mn.start == range_base_addr + 0x10);
+	LONGS_EQUAL(8, mn.count);
+	LONGS_EQUAL(MAAP_NOTIFY_ERROR_NONE, mn.result);
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+	CHECK(NULL == Net_getNextQueuedPacket(mc.net));
+
+	/* An announcement from a lower address should take an unclaimed range without a replacement. */
+	init_packet(&announce_packet, TEST_DEST_ADDR, TEST_REMOTE_ADDR_LOWER);
+	announce_packet.message_type = MAAP_ANNOUNCE;
+	announce_packet.requested_start_address = range_base_addr + 0x30;
+	announce_packet.requested_count = 8;
+	LONGS_EQUAL(0, pack_maap(&announce_packet, announce_buffer));
+	LONGS_EQUAL(0, maap_handle_packet(&mc, announce_buffer, MAAP_NET_BUFFER_SIZE));
+	LONGS_EQUAL(1, get_notify(&mc, &sender_out, &mn));
+	CHECK(sender_out == &sender1_in);
+	LONGS_EQUAL(MAAP_NOTIFY_RELEASED, mn.kind);
+	LONGS_EQUAL(id_yielded, mn.id);
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+	CHECK(NULL == Net_getNextQueuedPacket(mc.net));
+
+	/* The other unclaimed range should be released after a few announcements. */
+	announce_packets_detected = 0;
+	for (countdown = 1000; countdown > 0 && !get_notify(&mc, &sender_out, &mn); --countdown)
+	{
+		Time_increaseNanos(maap_get_delay_to_next_timer(&mc));
+		LONGS_EQUAL(0, maap_handle_timer(&mc));
+		while ((packet_data = Net_getNextQueuedPacket(mc.net)) != NULL)
+		{
+			LONGS_EQUAL(0, unpack_maap(&packet_contents, (const uint8_t *) packet_data));
+			Net_freeQueuedPacket(mc.net, packet_data);
+			CHECK(packet_contents.message_type == MAAP_ANNOUNCE);
+			if (packet_contents.requested_start_address == range_base_addr + 0x20)
+			{
+				(announce_packets_detected)++;
+			}
+		}
+	}
+	CHECK(countdown > 0);
+	CHECK(sender_out == &sender1_in);
+	LONGS_EQUAL(MAAP_NOTIFY_RELEASED, mn.kind);
+	LONGS_EQUAL(id_unclaimed, mn.id);
+	LONGS_EQUAL(MAAP_RESTORE_ANNOUNCES - 1, announce_packets_detected);
+	LONGS_EQUAL(0, get_notify(&mc, &sender_out, &mn));
+
+	/* The claimed range should still be active. */
+	maap_range_status(&mc, &sender2_in, id_claimed);
+	LONGS_EQUAL(1, get_notify(&mc, &sender_out, &mn));
+	LONGS_EQUAL(MAAP_NOTIFY_STATUS, mn.kind);
+	LONGS_EQUAL(MAAP_NOTIFY_ERROR_NONE, mn.result);
+	CHECK(mn.start == range_base_addr + 0x10);
+
+	/* We are done with the Maap_Client structure */
+	maap_deinit_client(&mc);
+}
+
 
 static void verify_sent_packets(Maap_Client *p_mc, Maap_Notify *p_mn,
 	const void **p_sender_out,
@@ -299,7 +299,7 @@ void maapLogFn(
 					log_queue_item_t *pLogItem = (log_queue_item_t *)maapLogQueueData(elem);
 					pLogItem->bRT = FALSE;
 					strncpy((char *)pLogItem->msg, full_msg, LOG_QUEUE_MSG_LEN);
-					maapLogQueueHeadPush(logQueue);
+					maapLogQueueHeadPush(logQueue, elem);
 				}
 			}
 		}
@@ -325,7 +325,7 @@ void maapLogRT(int level, int bBegin, int bItem, int bEnd, char *pFormat, log_rt
 					pLogRTItem->pFormat = NULL;
 					pLogRTItem->dataType = LOG_RT_DATATYPE_NOW_TS;
 					GetLocalTime(&pLogRTItem->data.nowST);
-					maapLogQueueHeadPush(logRTQueue);
+					maapLogQueueHeadPush(logRTQueue, elem);
 				}
 			}
 
@@ -367,7 +367,7 @@ void maapLogRT(int level, int bBegin, int bItem, int bEnd, char *pFormat, log_rt
 						default:
 							break;
 					}
-					maapLogQueueHeadPush(logRTQueue);
+					maapLogQueueHeadPush(logRTQueue, elem);
 				}
 			}
 
@@ -378,7 +378,7 @@ void maapLogRT(int level, int bBegin, int bItem, int bEnd, char *pFormat, log_rt
 					pLogRTItem->bEnd = TRUE;
 					pLogRTItem->pFormat = NULL;
 					pLogRTItem->dataType = LOG_RT_DATATYPE_NONE;
-					maapLogQueueHeadPush(logRTQueue);
+					maapLogQueueHeadPush(logRTQueue, elem);
 				}
 			}
 
@@ -389,11 +389,11 @@ void maapLogRT(int level, int bBegin, int bItem, int bEnd, char *pFormat, log_rt
 						log_queue_item_t *pLogItem = (log_queue_item_t *)maapLogQueueData(elem);
 						pLogItem->bRT = TRUE;
 						if (MAAP_LOG_FROM_THREAD) {
-							maapLogQueueHeadPush(logQueue);
+							maapLogQueueHeadPush(logQueue, elem);
 						} else {
 							maapLogRTRender(pLogItem);
 							fputs((const char *)pLogItem->msg, MAAP_LOG_OUTPUT_FD);
-							maapLogQueueHeadUnlock(logQueue);
+							maapLogQueueHeadUnlock(logQueue, elem);
 						}
 					}
 				}
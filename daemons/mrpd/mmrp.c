@@ -55,12 +55,67 @@ SOCKET mmrp_socket;
 
 struct mmrp_database *MMRP_db;
 
+static unsigned int mmrp_hash(const struct mmrp_attribute *attrib)
+{
+	uint32_t h;
+	int i;
+
+	/* FNV-1a over the key */
+	h = 2166136261u ^ attrib->type;
+	h *= 16777619u;
+	if (MMRP_SVCREQ_TYPE == attrib->type) {
+		h ^= attrib->attribute.svcreq;
+		h *= 16777619u;
+	} else {
+		for (i = 0; i < 6; i++) {
+			h ^= attrib->attribute.macaddr[i];
+			h *= 16777619u;
+		}
+	}
+	return h & (MMRP_ATTRIB_HASH_SIZE - 1);
+}
+
+static void mmrp_hash_insert(struct mmrp_attribute *attrib)
+{
+	unsigned int bucket = mmrp_hash(attrib);
+
+	attrib->hnext = MMRP_db->attrib_hash[bucket];
+	MMRP_db->attrib_hash[bucket] = attrib;
+}
+
+static void mmrp_hash_remove(struct mmrp_attribute *attrib)
+{
+	struct mmrp_attribute **pp;
+
+	pp = &MMRP_db->attrib_hash[mmrp_hash(attrib)];
+	while (NULL != *pp) {
+		if (*pp == attrib) {
+			*pp = attrib->hnext;
+			break;
+		}
+		pp = &(*pp)->hnext;
+	}
+	attrib->hnext = NULL;
+}
+
+/* remove an attribute from the database, the caller frees it */
+static void mmrp_unlink(struct mmrp_attribute *attrib)
+{
+	if (NULL != attrib->prev)
+		attrib->prev->next = attrib->next;
+	else
+		MMRP_db->attrib_list = attrib->next;
+	if (NULL != attrib->next)
+		attrib->next->prev = attrib->prev;
+	mmrp_hash_remove(attrib);
+}
+
 struct mmrp_attribute *mmrp_lookup(struct mmrp_attribute *rattrib)
 {
 	struct mmrp_attribute *attrib;
 	int mac_eq;
 
-	attrib = MMRP_db->attrib_list;
+	attrib = MMRP_db->attrib_hash[mmrp_hash(rattrib)];
 	while (NULL != attrib) {
 		if (rattrib->type == attrib->type) {
 			if (MMRP_SVCREQ_TYPE == attrib->type) {
@@ -77,7 +132,7 @@ struct mmrp_attribute *mmrp_lookup(struct mmrp_attribute *rattrib)
 					return attrib;
 			}
 		}
-		attrib = attrib->next;
+		attrib = attrib->hnext;
 	}
 	return NULL;
 }
@@ -90,6 +145,8 @@ int mmrp_add(struct mmrp_attribute *rattrib)
 
 	/* XXX do a lookup first to guarantee uniqueness? */
 
+	mmrp_hash_insert(rattrib);
+
 	attrib_tail = attrib = MMRP_db->attrib_list;
 
 	while (NULL != attrib) {
@@ -1470,6 +1527,8 @@ int mmrp_send_notifications(struct mmrp_attribute *attrib, int notify)
 		client = client->next;
 	}
 
+	mrpd_map_changed(MRPD_APP_MMRP, notify, attrib);
+
  free_msgbuf:
 	if (variant)
 		free(variant);
@@ -1611,6 +1670,50 @@ int mmrp_cmd_service(uint8_t service, int mrp_event)
 	return 0;
 }
 
+/*
+ * Runs only the applicant for the MAC address or service requirement in
+ * key, leaving the registrar to the peer on this port. Bridge mode uses
+ * this to declare an attribute registered on another port.
+ */
+int mmrp_declare(struct mmrp_attribute *key, int mrp_event)
+{
+	struct mmrp_attribute *attrib;
+
+	if (NULL == MMRP_db)
+		return -1;
+
+	attrib = mmrp_lookup(key);
+	if (NULL == attrib) {
+		/* nothing declared, nothing to withdraw */
+		if (MRP_EVENT_LV == mrp_event)
+			return 0;
+		attrib = mmrp_alloc();
+		if (NULL == attrib)
+			return -1;
+		attrib->type = key->type;
+		attrib->attribute = key->attribute;
+		mmrp_add(attrib);
+	}
+
+	mrp_jointimer_start(&(MMRP_db->mrp_db));
+	mrp_applicant_fsm(&(MMRP_db->mrp_db), &(attrib->applicant), mrp_event,
+			  mrp_registrar_in(&(attrib->registrar)));
+	return 0;
+}
+
+/* returns 1 if the peer on this port has the attribute in key registered */
+int mmrp_registered(struct mmrp_attribute *key)
+{
+	struct mmrp_attribute *attrib;
+
+	if (NULL == MMRP_db)
+		return 0;
+
+	attrib = mmrp_lookup(key);
+	return (NULL != attrib) &&
+	    (MRP_MT_STATE != attrib->registrar.mrp_state);
+}
+
 int mmrp_recv_cmd(char *buf, int buflen, struct sockaddr_in *client)
 {
 	int rc;
@@ -1783,12 +1886,7 @@ int mmrp_reclaim(void)
 		    ((mattrib->applicant.mrp_state == MRP_VO_STATE) ||
 		     (mattrib->applicant.mrp_state == MRP_AO_STATE) ||
 		     (mattrib->applicant.mrp_state == MRP_QO_STATE))) {
-			if (NULL != mattrib->prev)
-				mattrib->prev->next = mattrib->next;
-			else
-				MMRP_db->attrib_list = mattrib->next;
-			if (NULL != mattrib->next)
-				mattrib->next->prev = mattrib->prev;
+			mmrp_unlink(mattrib);
 			free_mattrib = mattrib;
 			mattrib = mattrib->next;
 			mmrp_send_notifications(free_mattrib, MRP_NOTIFY_LV);
@@ -53,6 +53,7 @@
 struct mmrp_attribute {
 	struct mmrp_attribute *prev;
 	struct mmrp_attribute *next;
+	struct mmrp_attribute *hnext;	/* attrib_hash bucket chain */
 	uint32_t type;
 	union {
 		unsigned char macaddr[6];
@@ -62,9 +63,17 @@ struct mmrp_attribute {
 	mrp_registrar_attribute_t registrar;
 };
 
+/*
+ * attrib_list stays sorted by type and value for PDU vectorization;
+ * attrib_hash indexes the same attributes by (type, MAC address or
+ * service requirement) so that lookups don't have to walk the list.
+ */
+#define MMRP_ATTRIB_HASH_SIZE	1024	/* power of 2 */
+
 struct mmrp_database {
 	struct mrp_database mrp_db;
 	struct mmrp_attribute *attrib_list;
+	struct mmrp_attribute *attrib_hash[MMRP_ATTRIB_HASH_SIZE];
 	int send_empty_LeaveAll_flag;
 };
 
@@ -78,3 +87,5 @@ void mmrp_bye(struct sockaddr_in *client);
 int mmrp_recv_msg(void);
 void mmrp_increment_macaddr(uint8_t * macaddr);
 int mmrp_send_notifications(struct mmrp_attribute *attrib, int notify);
+int mmrp_declare(struct mmrp_attribute *key, int mrp_event);
+int mmrp_registered(struct mmrp_attribute *key);
@@ -56,12 +56,15 @@
 #include <net/ethernet.h>
 #include <sys/un.h>
 #include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <pthread.h>
 
 #include "mrpd.h"
 #include "mrp.h"
 #include "mvrp.h"
 #include "msrp.h"
 #include "mmrp.h"
+#include "mrpd_tlv.h"
 
 static void mrpd_log_timer_event(char *src, int event);
 
@@ -72,6 +75,7 @@ int mvrp_enable;
 int msrp_enable;
 int msrp_pruning;
 int logging_enable;
+int threads_enable;
 int mrpd_port;
 
 char *interface;
@@ -113,62 +117,398 @@ extern struct mmrp_database *MMRP_db;
 extern struct mvrp_database *MVRP_db;
 extern struct msrp_database *MSRP_db;
 
-int mrpd_timer_create(void)
+/*
+ * Event sources are registered with epoll once. The source, the
+ * application and the port it belongs to are packed into
+ * epoll_event.data.u32.
+ */
+#define MRPD_EV_CTL		0
+#define MRPD_EV_PERIODIC	1
+#define MRPD_EV_GC		2
+#define MRPD_EV_RECV		3
+#define MRPD_EV_LVATIMER	4
+#define MRPD_EV_LVTIMER		5
+#define MRPD_EV_JOINTIMER	6
+#define MRPD_EV_WHEEL		7	/* app holds the wheel index */
+#define MRPD_EV(port, app, src)	(((port) << 16) | ((app) << 8) | (src))
+#define MRPD_EV_PORT(ev)	((ev) >> 16)
+#define MRPD_EV_APP(ev)		(((ev) >> 8) & 0xff)
+#define MRPD_EV_SRC(ev)		((ev) & 0xff)
+
+#define MRPD_MAX_EVENTS		16
+
+struct mrpd_app {
+	const char *name;
+	int *enable;
+	SOCKET *sock;
+	struct mrp_database *(*db)(void);
+	int (*recv_msg)(void);
+	void (*event)(int event);
+	void (*flush)(void);	/* sends what was held back for clients */
+	/*
+	 * held while the application's state machines run; only contended
+	 * when the application has its own thread (-t)
+	 */
+	pthread_mutex_t lock;
+	pthread_t thread;
+	int epoll_fd;
+};
+
+static struct mrp_database *mmrp_app_db(void)
 {
-	int t = timerfd_create(CLOCK_MONOTONIC, 0);
-	if (-1 != t)
-		fcntl(t, F_SETFL, O_NONBLOCK);
-	return t;
+	return MMRP_db ? &MMRP_db->mrp_db : NULL;
 }
 
-void mrpd_timer_close(int t)
+static struct mrp_database *mvrp_app_db(void)
 {
-	if (-1 != t)
-		close(t);
+	return MVRP_db ? &MVRP_db->mrp_db : NULL;
 }
 
-int mrpd_timer_start_interval(int timerfd,
-			      unsigned long value_ms, unsigned long interval_ms)
+static struct mrp_database *msrp_app_db(void)
 {
-	int rc;
-	struct itimerspec itimerspec_new;
-	struct itimerspec itimerspec_old;
-	unsigned long ns_per_ms = 1000000;
+	return MSRP_db ? &MSRP_db->mrp_db : NULL;
+}
+
+static void mmrp_app_event(int event)
+{
+	mmrp_event(event, NULL);
+}
+
+static void mvrp_app_event(int event)
+{
+	mvrp_event(event, NULL);
+}
+
+static void msrp_app_event(int event)
+{
+	msrp_event(event, NULL);
+}
+
+static struct mrpd_app mrpd_apps[MRPD_APP_COUNT] = {
+	{ "MMRP", &mmrp_enable, &mmrp_socket, mmrp_app_db, mmrp_recv_msg,
+	  mmrp_app_event, NULL, PTHREAD_MUTEX_INITIALIZER, 0, -1 },
+	{ "MVRP", &mvrp_enable, &mvrp_socket, mvrp_app_db, mvrp_recv_msg,
+	  mvrp_app_event, NULL, PTHREAD_MUTEX_INITIALIZER, 0, -1 },
+	{ "MSRP", &msrp_enable, &msrp_socket, msrp_app_db, msrp_recv_msg,
+	  msrp_app_event, msrp_flush_notifications,
+	  PTHREAD_MUTEX_INITIALIZER, 0, -1 },
+};
+
+/*
+ * Bridge mode (-i given more than once): every port has its own sockets
+ * and attribute databases, so its own applicants and registrars. The
+ * applications work on the global sockets and databases, a port is
+ * selected by pointing those at its state.
+ */
+#define MRPD_MAX_PORTS		8
+
+struct mrpd_port {
+	char *ifname;
+	unsigned char station_addr[6];
+	SOCKET mmrp_socket;
+	SOCKET mvrp_socket;
+	SOCKET msrp_socket;
+	struct mmrp_database *mmrp_db;
+	struct mvrp_database *mvrp_db;
+	struct msrp_database *msrp_db;
+};
+
+static struct mrpd_port mrpd_ports[MRPD_MAX_PORTS];
+static int mrpd_port_count;
+static int mrpd_port_current;
+
+static void mrpd_port_save(int port)
+{
+	struct mrpd_port *p = &mrpd_ports[port];
+
+	memcpy(p->station_addr, STATION_ADDR, sizeof(p->station_addr));
+	p->mmrp_socket = mmrp_socket;
+	p->mvrp_socket = mvrp_socket;
+	p->msrp_socket = msrp_socket;
+	p->mmrp_db = MMRP_db;
+	p->mvrp_db = MVRP_db;
+	p->msrp_db = MSRP_db;
+}
+
+static void mrpd_port_select(int port)
+{
+	struct mrpd_port *p = &mrpd_ports[port];
+
+	/* a single port never switches, which keeps -t threads off the globals */
+	if ((mrpd_port_count < 2) || (port == mrpd_port_current))
+		return;
+
+	interface = p->ifname;
+	memcpy(STATION_ADDR, p->station_addr, sizeof(p->station_addr));
+	mmrp_socket = p->mmrp_socket;
+	mvrp_socket = p->mvrp_socket;
+	msrp_socket = p->msrp_socket;
+	MMRP_db = p->mmrp_db;
+	MVRP_db = p->mvrp_db;
+	MSRP_db = p->msrp_db;
+	mrpd_port_current = port;
+}
+
+static int mrpd_map_registered(int app, int port, void *attrib)
+{
+	mrpd_port_select(port);
+	switch (app) {
+	case MRPD_APP_MMRP:
+		return mmrp_registered((struct mmrp_attribute *)attrib);
+	case MRPD_APP_MVRP:
+		return mvrp_registered(((struct mvrp_attribute *)attrib)->attribute);
+	}
+	return 0;
+}
+
+static void mrpd_map_declare(int app, int port, void *attrib, int mrp_event)
+{
+	mrpd_port_select(port);
+	switch (app) {
+	case MRPD_APP_MMRP:
+		mmrp_declare((struct mmrp_attribute *)attrib, mrp_event);
+		break;
+	case MRPD_APP_MVRP:
+		mvrp_declare(((struct mvrp_attribute *)attrib)->attribute,
+			     mrp_event);
+		break;
+	}
+}
 
-	memset(&itimerspec_new, 0, sizeof(itimerspec_new));
-	memset(&itimerspec_old, 0, sizeof(itimerspec_old));
+/*
+ * Called by MMRP and MVRP whenever a registration is announced to the
+ * clients. A port declares an attribute as long as any other port has
+ * it registered, so the decision is remade for every port and extra
+ * calls (reclaim, repeated joins) are harmless. The declarations only
+ * drive applicants, they never come back here. MSRP is not propagated,
+ * talker and listener merging across ports is left to the clients.
+ */
+void mrpd_map_changed(int app, int notify, void *attrib)
+{
+	int origin = mrpd_port_current;
+	int port;
+	int other;
+	int wanted;
+
+	if (mrpd_port_count < 2)
+		return;
 
-	if (interval_ms) {
-		itimerspec_new.it_interval.tv_sec = interval_ms / 1000;
-		itimerspec_new.it_interval.tv_nsec =
-		    (interval_ms % 1000) * ns_per_ms;
+	for (port = 0; port < mrpd_port_count; port++) {
+		if (port == origin)
+			continue;
+		wanted = 0;
+		for (other = 0; other < mrpd_port_count && !wanted; other++) {
+			if (other != port)
+				wanted = mrpd_map_registered(app, other, attrib);
+		}
+		if (wanted)
+			mrpd_map_declare(app, port, attrib,
+					 (MRP_NOTIFY_NEW == notify) ?
+					 MRP_EVENT_NEW : MRP_EVENT_JOIN);
+		else
+			mrpd_map_declare(app, port, attrib, MRP_EVENT_LV);
 	}
+	mrpd_port_select(origin);
+}
 
-	itimerspec_new.it_value.tv_sec = value_ms / 1000;
-	itimerspec_new.it_value.tv_nsec = (value_ms % 1000) * ns_per_ms;
+static void mrpd_app_lock(int app)
+{
+	pthread_mutex_lock(&mrpd_apps[app].lock);
+}
 
-	rc = timerfd_settime(timerfd, 0, &itimerspec_new, &itimerspec_old);
+static void mrpd_app_unlock(int app)
+{
+	/* whatever ran under the lock is done, let held notifications go */
+	if (mrpd_apps[app].flush)
+		mrpd_apps[app].flush();
+	pthread_mutex_unlock(&mrpd_apps[app].lock);
+}
+
+/*
+ * All MRP timers (join, leave and leaveAll of every application and
+ * port, plus the periodic and gc timers) are slots multiplexed onto one
+ * timerfd per event loop, the wheel. When the wheel fires, every timer
+ * due within MRPD_TIMER_SLACK_MS fires with it, so timers that expire
+ * close together cost one wakeup and their PDUs go out in one pass.
+ * There are a few dozen slots at most, a scan of the table is cheaper
+ * than keeping buckets.
+ */
+#define MRPD_TIMER_COUNT	(MRPD_MAX_PORTS * MRPD_APP_COUNT * 3 + 2)
+#define MRPD_TIMER_SLACK_MS	20
+#define MRPD_WHEEL_MAIN		MRPD_APP_COUNT	/* control, periodic, gc */
+#define MRPD_WHEEL_COUNT	(MRPD_APP_COUNT + 1)
+
+struct mrpd_wheel {
+	int fd;			/* timerfd, -1 until the loop is set up */
+	uint64_t armed_ms;	/* expiry the timerfd is set to, 0 if idle */
+	pthread_mutex_t lock;
+};
+
+struct mrpd_timer {
+	int used;
+	struct mrpd_wheel *wheel;	/* NULL until registered */
+	uint32_t ev;		/* dispatched when the timer fires */
+	uint64_t expiry_ms;	/* CLOCK_MONOTONIC, 0 when stopped */
+	unsigned long interval_ms;
+};
+
+static struct mrpd_timer mrpd_timers[MRPD_TIMER_COUNT];
+
+/*
+ * -t gives each application a wheel of its own; without it the
+ * applications share the main one.
+ */
+static struct mrpd_wheel mrpd_wheels[MRPD_WHEEL_COUNT] = {
+	{ -1, 0, PTHREAD_MUTEX_INITIALIZER },
+	{ -1, 0, PTHREAD_MUTEX_INITIALIZER },
+	{ -1, 0, PTHREAD_MUTEX_INITIALIZER },
+	{ -1, 0, PTHREAD_MUTEX_INITIALIZER },
+};
+
+static uint64_t mrpd_now_ms(void)
+{
+	struct timespec ts;
 
-	return (rc);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-int mrpd_timer_start(int timerfd, unsigned long value_ms)
+/* called with the wheel locked */
+static void mrpd_wheel_arm(struct mrpd_wheel *wheel, uint64_t expiry_ms)
 {
-	return mrpd_timer_start_interval(timerfd, value_ms, 0);
+	struct itimerspec its;
+
+	if (-1 == wheel->fd)
+		return;
+	if (wheel->armed_ms && (wheel->armed_ms <= expiry_ms))
+		return;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = expiry_ms / 1000;
+	its.it_value.tv_nsec = (expiry_ms % 1000) * 1000000;
+	if (timerfd_settime(wheel->fd, TFD_TIMER_ABSTIME, &its, NULL) == 0)
+		wheel->armed_ms = expiry_ms;
 }
 
-int mrpd_timer_stop(int timerfd)
+static int mrpd_wheel_init(struct mrpd_wheel *wheel)
 {
-	int rc;
-	struct itimerspec itimerspec_new;
-	struct itimerspec itimerspec_old;
+	wheel->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	wheel->armed_ms = 0;
+	return wheel->fd;
+}
+
+/* ties a timer to the wheel of the loop that handles ev */
+static void mrpd_timer_attach(int t, struct mrpd_wheel *wheel, uint32_t ev)
+{
+	struct mrpd_timer *timer = &mrpd_timers[t];
+
+	pthread_mutex_lock(&wheel->lock);
+	timer->wheel = wheel;
+	timer->ev = ev;
+	/* timers started during init are armed now */
+	if (timer->expiry_ms)
+		mrpd_wheel_arm(wheel, timer->expiry_ms);
+	pthread_mutex_unlock(&wheel->lock);
+}
+
+/*
+ * Collects the events of the timers due on a wheel, within the slack,
+ * and rearms it for the next one. Returns the number of events.
+ */
+static int mrpd_wheel_expire(struct mrpd_wheel *wheel, uint32_t *evs)
+{
+	struct mrpd_timer *timer;
+	uint64_t expiries;
+	uint64_t now;
+	uint64_t next = 0;
+	int count = 0;
+	int t;
+
+	/* only clears the readable state, the table says what is due */
+	if (read(wheel->fd, &expiries, sizeof(expiries)) < 0)
+		expiries = 0;
+
+	pthread_mutex_lock(&wheel->lock);
+	now = mrpd_now_ms();
+	for (t = 0; t < MRPD_TIMER_COUNT; t++) {
+		timer = &mrpd_timers[t];
+		if ((timer->wheel != wheel) || !timer->expiry_ms)
+			continue;
+		if (timer->expiry_ms <= now + MRPD_TIMER_SLACK_MS) {
+			evs[count++] = timer->ev;
+			if (timer->interval_ms)
+				timer->expiry_ms = now + timer->interval_ms;
+			else
+				timer->expiry_ms = 0;
+		}
+		if (timer->expiry_ms && (!next || (timer->expiry_ms < next)))
+			next = timer->expiry_ms;
+	}
+	wheel->armed_ms = 0;
+	if (next)
+		mrpd_wheel_arm(wheel, next);
+	pthread_mutex_unlock(&wheel->lock);
+
+	return count;
+}
 
-	memset(&itimerspec_new, 0, sizeof(itimerspec_new));
-	memset(&itimerspec_old, 0, sizeof(itimerspec_old));
+int mrpd_timer_create(void)
+{
+	int t;
 
-	rc = timerfd_settime(timerfd, 0, &itimerspec_new, &itimerspec_old);
+	for (t = 0; t < MRPD_TIMER_COUNT; t++) {
+		if (!mrpd_timers[t].used) {
+			memset(&mrpd_timers[t], 0, sizeof(mrpd_timers[t]));
+			mrpd_timers[t].used = 1;
+			return t;
+		}
+	}
+	return -1;
+}
 
-	return (rc);
+void mrpd_timer_close(int t)
+{
+	if (-1 != t)
+		mrpd_timers[t].used = 0;
+}
+
+int mrpd_timer_start_interval(int t,
+			      unsigned long value_ms, unsigned long interval_ms)
+{
+	struct mrpd_timer *timer = &mrpd_timers[t];
+	struct mrpd_wheel *wheel = timer->wheel;
+
+	if (wheel)
+		pthread_mutex_lock(&wheel->lock);
+	timer->expiry_ms = mrpd_now_ms() + value_ms;
+	timer->interval_ms = interval_ms;
+	if (wheel) {
+		mrpd_wheel_arm(wheel, timer->expiry_ms);
+		pthread_mutex_unlock(&wheel->lock);
+	}
+
+	return 0;
+}
+
+int mrpd_timer_start(int t, unsigned long value_ms)
+{
+	return mrpd_timer_start_interval(t, value_ms, 0);
+}
+
+int mrpd_timer_stop(int t)
+{
+	struct mrpd_timer *timer = &mrpd_timers[t];
+	struct mrpd_wheel *wheel = timer->wheel;
+
+	/* the wheel may still wake up for it, and find nothing due */
+	if (wheel)
+		pthread_mutex_lock(&wheel->lock);
+	timer->expiry_ms = 0;
+	timer->interval_ms = 0;
+	if (wheel)
+		pthread_mutex_unlock(&wheel->lock);
+
+	return 0;
 }
 
 int gctimer_start()
@@ -251,11 +591,80 @@ mrpd_send_ctl_msg(struct sockaddr_in *client_addr, char *notify_data,
 		gc_ctl_msg_count = (gc_ctl_msg_count + 1) % 1000;
 	}
 #endif
+	/* binary clients get this batched into their next frame */
+	if (mrpd_tlv_send(client_addr, notify_data, notify_len))
+		return notify_len;
+
 	rc = sendto(control_socket, notify_data, notify_len,
 		    0, (struct sockaddr *)client_addr, sizeof(struct sockaddr));
 	return rc;
 }
 
+static int
+mrpd_send_ctl_frame(struct sockaddr_in *client_addr, char *frame, int len)
+{
+	if (-1 == control_socket)
+		return 0;
+
+	return sendto(control_socket, frame, len,
+		      0, (struct sockaddr *)client_addr, sizeof(struct sockaddr));
+}
+
+int mrpd_send_ctl_data(struct sockaddr_in *client_addr, void *data, int len)
+{
+	return mrpd_send_ctl_frame(client_addr, (char *)data, len);
+}
+
+/*
+ * In bridge mode a command is run on every port, as the local host is
+ * attached to all of them. The first error ends the loop so the client
+ * is answered once.
+ */
+static int mrpd_ctl_cmd(int app, char *buf, int buflen,
+			struct sockaddr_in *client)
+{
+	int port;
+	int rc = 0;
+
+	for (port = 0; (port < mrpd_port_count) && (0 == rc); port++) {
+		mrpd_app_lock(app);
+		mrpd_port_select(port);
+		switch (app) {
+		case MRPD_APP_MMRP:
+			rc = mmrp_recv_cmd(buf, buflen, client);
+			break;
+		case MRPD_APP_MVRP:
+			rc = mvrp_recv_cmd(buf, buflen, client);
+			break;
+		case MRPD_APP_MSRP:
+			rc = msrp_recv_cmd(buf, buflen, client);
+			break;
+		}
+		mrpd_app_unlock(app);
+	}
+	return rc;
+}
+
+static void mrpd_ctl_bye(struct sockaddr_in *client)
+{
+	int port;
+
+	for (port = 0; port < mrpd_port_count; port++) {
+		mrpd_app_lock(MRPD_APP_MMRP);
+		mrpd_port_select(port);
+		mmrp_bye(client);
+		mrpd_app_unlock(MRPD_APP_MMRP);
+		mrpd_app_lock(MRPD_APP_MVRP);
+		mrpd_port_select(port);
+		mvrp_bye(client);
+		mrpd_app_unlock(MRPD_APP_MVRP);
+		mrpd_app_lock(MRPD_APP_MSRP);
+		mrpd_port_select(port);
+		msrp_bye(client);
+		mrpd_app_unlock(MRPD_APP_MSRP);
+	}
+}
+
 int process_ctl_msg(char *buf, int buflen, struct sockaddr_in *client)
 {
 
@@ -271,6 +680,9 @@ int process_ctl_msg(char *buf, int buflen, struct sockaddr_in *client)
 	 *
 	 * BYE   Client detaches from daemon
 	 *
+	 * A datagram starting with MRPD_TLV_MAGIC is a binary frame
+	 * carrying a batch of the commands below, see mrpd_tlv.h.
+	 *
 	 * M+? - JOIN_MT a MAC address or service declaration
 	 * M++   JOIN_IN a MAC Address (XXX: MMRP doesn't use 'New' though?)
 	 * M-- - LV a MAC address or service declaration
@@ -320,6 +732,9 @@ int process_ctl_msg(char *buf, int buflen, struct sockaddr_in *client)
 		mrpd_log_printf("CMD:%s from CLNT %d\n", buf, client->sin_port);
 #endif
 
+	if (mrpd_tlv_is_frame(buf, buflen))
+		return mrpd_tlv_recv(buf, buflen, client, process_ctl_msg);
+
 	if (buflen < 3) {
 		printf("buflen = %d!\b", buflen);
 
@@ -328,19 +743,18 @@ int process_ctl_msg(char *buf, int buflen, struct sockaddr_in *client)
 
 	switch (buf[0]) {
 	case 'M':
-		return mmrp_recv_cmd(buf, buflen, client);
+		return mrpd_ctl_cmd(MRPD_APP_MMRP, buf, buflen, client);
 		break;
 	case 'V':
-		return mvrp_recv_cmd(buf, buflen, client);
+		return mrpd_ctl_cmd(MRPD_APP_MVRP, buf, buflen, client);
 		break;
 	case 'S':
 	case 'I':
-		return msrp_recv_cmd(buf, buflen, client);
+		return mrpd_ctl_cmd(MRPD_APP_MSRP, buf, buflen, client);
 		break;
 	case 'B':
-		mmrp_bye(client);
-		mvrp_bye(client);
-		msrp_bye(client);
+		mrpd_ctl_bye(client);
+		mrpd_tlv_bye(client);
 		break;
 	default:
 		printf("unrecognized command %s\n", buf);
@@ -562,25 +976,43 @@ int init_timers(void)
 	return -1;
 }
 
-int mrp_register_timers(struct mrp_database *mrp_db, fd_set * fds)
+static int mrpd_epoll_add(int epoll_fd, int fd, uint32_t ev)
 {
-	int max_fd;
+	struct epoll_event event;
 
-	FD_SET(mrp_db->join_timer, fds);
-	FD_SET(mrp_db->lv_timer, fds);
-	FD_SET(mrp_db->lva_timer, fds);
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = ev;
 
-	max_fd = mrp_db->join_timer;
-	if (mrp_db->lv_timer > max_fd)
-		max_fd = mrp_db->lv_timer;
-	if (mrp_db->lva_timer > max_fd)
-		max_fd = mrp_db->lva_timer;
+	return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static int mrp_register_app(int epoll_fd, struct mrpd_wheel *wheel,
+			    int port, int app)
+{
+	struct mrp_database *mrp_db;
+
+	mrpd_port_select(port);
+	mrp_db = mrpd_apps[app].db();
+	if (NULL == mrp_db)
+		return -1;
 
-	return max_fd;
+	if (mrpd_epoll_add(epoll_fd, *mrpd_apps[app].sock,
+			   MRPD_EV(port, app, MRPD_EV_RECV)) < 0)
+		return -1;
+	mrpd_timer_attach(mrp_db->lva_timer, wheel,
+			  MRPD_EV(port, app, MRPD_EV_LVATIMER));
+	mrpd_timer_attach(mrp_db->lv_timer, wheel,
+			  MRPD_EV(port, app, MRPD_EV_LVTIMER));
+	mrpd_timer_attach(mrp_db->join_timer, wheel,
+			  MRPD_EV(port, app, MRPD_EV_JOINTIMER));
+
+	return 0;
 }
 
 int mrpd_reclaim()
 {
+	int port;
 
 	/*
 	 * if the local applications have neither registered interest
@@ -588,9 +1020,20 @@ int mrpd_reclaim()
 	 * and allowing it to go into the MT state, delete the attribute 
 	 */
 
-	mmrp_reclaim();
-	mvrp_reclaim();
-	msrp_reclaim();
+	for (port = 0; port < mrpd_port_count; port++) {
+		mrpd_app_lock(MRPD_APP_MMRP);
+		mrpd_port_select(port);
+		mmrp_reclaim();
+		mrpd_app_unlock(MRPD_APP_MMRP);
+		mrpd_app_lock(MRPD_APP_MVRP);
+		mrpd_port_select(port);
+		mvrp_reclaim();
+		mrpd_app_unlock(MRPD_APP_MVRP);
+		mrpd_app_lock(MRPD_APP_MSRP);
+		mrpd_port_select(port);
+		msrp_reclaim();
+		mrpd_app_unlock(MRPD_APP_MSRP);
+	}
 
 	gctimer_start();
 
@@ -598,199 +1041,233 @@ int mrpd_reclaim()
 
 }
 
-void process_events(void)
+static void mrpd_app_dispatch(int port, int app, int src)
 {
+	struct mrpd_app *a = &mrpd_apps[app];
+
+	mrpd_app_lock(app);
+	mrpd_port_select(port);
+	switch (src) {
+	case MRPD_EV_RECV:
+#if LOG_POLL_EVENTS
+		mrpd_log_printf("== EVENT %s recv_msg ==\n", a->name);
+#endif
+		a->recv_msg();
+		break;
+	case MRPD_EV_LVATIMER:
+		mrpd_log_timer_event((char *)a->name, MRP_EVENT_LVATIMER);
+		a->event(MRP_EVENT_LVATIMER);
+		break;
+	case MRPD_EV_LVTIMER:
+		mrpd_log_timer_event((char *)a->name, MRP_EVENT_LVTIMER);
+		a->event(MRP_EVENT_LVTIMER);
+		break;
+	case MRPD_EV_JOINTIMER:
+		mrpd_log_timer_event((char *)a->name, MRP_EVENT_TX);
+		a->event(MRP_EVENT_TX);
+		break;
+	}
+	mrpd_app_unlock(app);
+}
+
+static void mrpd_dispatch(uint32_t ev)
+{
+	uint32_t evs[MRPD_TIMER_COUNT];
+	int count;
+	int port;
+	int app;
+	int i;
+
+	switch (MRPD_EV_SRC(ev)) {
+	case MRPD_EV_CTL:
+#if LOG_POLL_EVENTS
+		mrpd_log_printf("== EVENT recv_ctl_msg ==\n");
+#endif
+		recv_ctl_msg();
+		break;
+	case MRPD_EV_PERIODIC:
+#if LOG_POLL_EVENTS && LOG_TIMERS
+		mrpd_log_printf("== EVENT periodic_timer ==\n");
+#endif
+		mrp_periodictimer_fsm(&mrp_periodic_state, MRP_EVENT_PERIODIC);
+		for (port = 0; port < mrpd_port_count; port++) {
+			for (app = 0; app < MRPD_APP_COUNT; app++) {
+				if (!*mrpd_apps[app].enable)
+					continue;
+				mrpd_app_lock(app);
+				mrpd_port_select(port);
+				mrpd_apps[app].event(MRP_EVENT_PERIODIC);
+				mrpd_app_unlock(app);
+			}
+		}
+		break;
+	case MRPD_EV_GC:
+		mrpd_reclaim();
+		break;
+	case MRPD_EV_WHEEL:
+		count = mrpd_wheel_expire(&mrpd_wheels[MRPD_EV_APP(ev)], evs);
+		for (i = 0; i < count; i++)
+			mrpd_dispatch(evs[i]);
+		break;
+	default:
+		mrpd_app_dispatch(MRPD_EV_PORT(ev), MRPD_EV_APP(ev),
+				  MRPD_EV_SRC(ev));
+		break;
+	}
+}
 
-	fd_set fds, sel_fds;
+/* returns only on error */
+static void mrpd_wait_events(int epoll_fd)
+{
+	struct epoll_event events[MRPD_MAX_EVENTS];
 	int rc;
-	int max_fd;
+	int i;
 
-	/* wait for events, demux the received packets, process packets */
+	do {
+		rc = epoll_wait(epoll_fd, events, MRPD_MAX_EVENTS, -1);
 
-	FD_ZERO(&fds);
-	FD_SET(control_socket, &fds);
+		if (-1 == rc) {
+			if (EINTR == errno)
+				continue;
+#if LOG_ERRORS
+			fprintf(stderr, "Error on epoll_wait %s\r\n", strerror(errno));
+#endif
+			return;	/* exit on error */
+		}
 
-	max_fd = control_socket;
+		for (i = 0; i < rc; i++)
+			mrpd_dispatch(events[i].data.u32);
+		mrpd_tlv_flush();
+#if LOG_POLL_EVENTS
+		mrpd_log_printf("== EVENT DONE ==\n");
+#endif
+	} while (1);
+}
 
-	if (mmrp_enable) {
-		FD_SET(mmrp_socket, &fds);
-		if (mmrp_socket > max_fd)
-			max_fd = mmrp_socket;
+static void *mrpd_app_thread(void *arg)
+{
+	struct mrpd_app *a = (struct mrpd_app *)arg;
 
-		if (NULL == MMRP_db)
-			return;
+	mrpd_wait_events(a->epoll_fd);
 
-		rc = mrp_register_timers(&(MMRP_db->mrp_db), &fds);
-		if (rc > max_fd)
-			max_fd = rc;
-	}
-	if (mvrp_enable) {
-		FD_SET(mvrp_socket, &fds);
-		if (mvrp_socket > max_fd)
-			max_fd = mvrp_socket;
+	/* an application that stops processing events takes the daemon down */
+	fprintf(stderr, "%s event thread exited\n", a->name);
+	exit(1);
+	return NULL;
+}
 
-		if (NULL == MVRP_db)
-			return;
-		rc = mrp_register_timers(&(MVRP_db->mrp_db), &fds);
-		if (rc > max_fd)
-			max_fd = rc;
+void process_events(void)
+{
+	struct mrpd_wheel *wheel;
+	int epoll_fd;
+	int app_fd;
+	int port;
+	int app;
+	int rc;
 
-	}
-	if (msrp_enable) {
-		FD_SET(msrp_socket, &fds);
-		if (msrp_socket > max_fd)
-			max_fd = msrp_socket;
+	/* wait for events, demux the received packets, process packets */
 
-		if (NULL == MSRP_db)
-			return;
-		rc = mrp_register_timers(&(MSRP_db->mrp_db), &fds);
-		if (rc > max_fd)
-			max_fd = rc;
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (-1 == epoll_fd)
+		return;
 
+	if (mrpd_epoll_add(epoll_fd, control_socket, MRPD_EV_CTL) < 0)
+		goto out;
+
+	if (mrpd_wheel_init(&mrpd_wheels[MRPD_WHEEL_MAIN]) < 0)
+		goto out;
+	if (mrpd_epoll_add(epoll_fd, mrpd_wheels[MRPD_WHEEL_MAIN].fd,
+			   MRPD_EV(0, MRPD_WHEEL_MAIN, MRPD_EV_WHEEL)) < 0)
+		goto out;
+
+	for (app = 0; app < MRPD_APP_COUNT; app++) {
+		if (!*mrpd_apps[app].enable)
+			continue;
+
+		app_fd = epoll_fd;
+		wheel = &mrpd_wheels[MRPD_WHEEL_MAIN];
+		if (threads_enable) {
+			mrpd_apps[app].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+			if (-1 == mrpd_apps[app].epoll_fd)
+				goto out;
+			app_fd = mrpd_apps[app].epoll_fd;
+			wheel = &mrpd_wheels[app];
+			if (mrpd_wheel_init(wheel) < 0)
+				goto out;
+			if (mrpd_epoll_add(app_fd, wheel->fd,
+					   MRPD_EV(0, app, MRPD_EV_WHEEL)) < 0)
+				goto out;
+		}
+		for (port = 0; port < mrpd_port_count; port++) {
+			if (mrp_register_app(app_fd, wheel, port, app) < 0)
+				goto out;
+		}
 	}
 
-	FD_SET(periodic_timer, &fds);
-	if (periodic_timer > max_fd)
-		max_fd = periodic_timer;
+	mrpd_timer_attach(periodic_timer, &mrpd_wheels[MRPD_WHEEL_MAIN],
+			  MRPD_EV_PERIODIC);
 
 	rc = mrp_periodictimer_fsm(&mrp_periodic_state, MRP_EVENT_BEGIN);
 	if (rc)
-		return;
+		goto out;
+
+	mrpd_timer_attach(gc_timer, &mrpd_wheels[MRPD_WHEEL_MAIN], MRPD_EV_GC);
+
+	if (threads_enable) {
+		for (app = 0; app < MRPD_APP_COUNT; app++) {
+			if (!*mrpd_apps[app].enable)
+				continue;
+			rc = pthread_create(&mrpd_apps[app].thread, NULL,
+					    mrpd_app_thread, &mrpd_apps[app]);
+			if (rc) {
+				printf("%s thread create failed\n",
+				       mrpd_apps[app].name);
+				goto out;
+			}
+		}
+	}
 
-	FD_SET(gc_timer, &fds);
-	if (gc_timer > max_fd)
-		max_fd = gc_timer;
+	/* the control socket, periodic and gc timers stay on this thread */
+	mrpd_wait_events(epoll_fd);
+ out:
+	close(epoll_fd);
+}
 
-	do {
+static int mrpd_port_init(int port)
+{
+	int rc;
 
-		sel_fds = fds;
-		rc = select(max_fd + 1, &sel_fds, NULL, NULL, NULL);
+	/* the applications open their sockets on the global interface */
+	interface = mrpd_ports[port].ifname;
+	mrpd_port_current = port;
 
-		if (-1 == rc) {
-#if LOG_ERRORS
-			fprintf(stderr, "Error on select %s\r\n", strerror(errno));
-#endif
-			return;	/* exit on error */
-		}
-		else {
-			if (FD_ISSET(control_socket, &sel_fds)) {
-#if LOG_POLL_EVENTS
-				mrpd_log_printf("== EVENT recv_ctl_msg ==\n");
-#endif
-				recv_ctl_msg();
-			}
-			if (mmrp_enable) {
-				if FD_ISSET
-					(mmrp_socket, &sel_fds) {
-#if LOG_POLL_EVENTS
-					mrpd_log_printf("== EVENT mmrp_recv_msg ==\n");
-#endif
-					mmrp_recv_msg();
-					}
-				if FD_ISSET
-					(MMRP_db->mrp_db.lva_timer, &sel_fds) {
-					mrpd_log_timer_event("MMRP",
-							     MRP_EVENT_LVATIMER);
-					mmrp_event(MRP_EVENT_LVATIMER, NULL);
-					}
-				if FD_ISSET
-					(MMRP_db->mrp_db.lv_timer, &sel_fds) {
-					mrpd_log_timer_event("MMRP",
-							     MRP_EVENT_LVTIMER);
-					mmrp_event(MRP_EVENT_LVTIMER, NULL);
-					}
-				if FD_ISSET
-					(MMRP_db->mrp_db.join_timer, &sel_fds) {
-					mrpd_log_timer_event("MMRP",
-							     MRP_EVENT_TX);
-					mmrp_event(MRP_EVENT_TX, NULL);
-					}
-			}
-			if (mvrp_enable) {
-				if FD_ISSET
-					(mvrp_socket, &sel_fds) {
-#if LOG_POLL_EVENTS
-					mrpd_log_printf("== EVENT mvrp_recv_msg ==\n");
-#endif
-					mvrp_recv_msg();
-					}
-				if FD_ISSET
-					(MVRP_db->mrp_db.lva_timer, &sel_fds) {
-					mrpd_log_timer_event("MVRP",
-							     MRP_EVENT_LVATIMER);
-					mvrp_event(MRP_EVENT_LVATIMER, NULL);
-					}
-				if FD_ISSET
-					(MVRP_db->mrp_db.lv_timer, &sel_fds) {
-					mrpd_log_timer_event("MVRP",
-							     MRP_EVENT_LVTIMER);
-					mvrp_event(MRP_EVENT_LVTIMER, NULL);
-					}
-				if FD_ISSET
-					(MVRP_db->mrp_db.join_timer, &sel_fds) {
-					mrpd_log_timer_event("MVRP",
-							     MRP_EVENT_TX);
-					mvrp_event(MRP_EVENT_TX, NULL);
-					}
-			}
-			if (msrp_enable) {
-				if FD_ISSET
-					(msrp_socket, &sel_fds) {
-#if LOG_POLL_EVENTS
-					mrpd_log_printf("== EVENT msrp_recv_msg ==\n");
-#endif
-					msrp_recv_msg();
-				}
-				if FD_ISSET
-					(MSRP_db->mrp_db.lva_timer, &sel_fds) {
-					mrpd_log_timer_event("MSRP",
-							     MRP_EVENT_LVATIMER);
-					msrp_event(MRP_EVENT_LVATIMER, NULL);
-					}
-				if FD_ISSET
-					(MSRP_db->mrp_db.lv_timer, &sel_fds) {
-					mrpd_log_timer_event("MSRP",
-							     MRP_EVENT_LVTIMER);
-					msrp_event(MRP_EVENT_LVTIMER, NULL);
-					}
-				if FD_ISSET
-					(MSRP_db->mrp_db.join_timer, &sel_fds) {
-					mrpd_log_timer_event("MSRP",
-							     MRP_EVENT_TX);
-					msrp_event(MRP_EVENT_TX, NULL);
-					}
-			}
-			if (FD_ISSET(periodic_timer, &sel_fds)) {
-#if LOG_POLL_EVENTS && LOG_TIMERS
-				mrpd_log_printf("== EVENT periodic_timer ==\n");
-#endif
-				
-				mrp_periodictimer_fsm(&mrp_periodic_state, MRP_EVENT_PERIODIC);
-				if (mmrp_enable) {
-					mmrp_event(MRP_EVENT_PERIODIC, NULL);
-				}
-				if (mvrp_enable) {
-					mvrp_event(MRP_EVENT_PERIODIC, NULL);
-				}
-				if (msrp_enable) {
-					msrp_event(MRP_EVENT_PERIODIC, NULL);
-				}
-			}
-			if (FD_ISSET(gc_timer, &sel_fds)) {
-				mrpd_reclaim();
-			}
-#if LOG_POLL_EVENTS
-		mrpd_log_printf("== EVENT DONE ==\n");
-#endif
-		}
-	} while (1);
+	rc = mmrp_init(mmrp_enable);
+	if (rc) {
+		printf("mmrp_enable failed\n");
+		return rc;
+	}
+
+	rc = mvrp_init(mvrp_enable);
+	if (rc) {
+		printf("mvrp_enable failed\n");
+		return rc;
+	}
+
+	rc = msrp_init(msrp_enable, MSRP_INTERESTING_STREAM_ID_COUNT, msrp_pruning);
+	if (rc) {
+		printf("msrp_enable failed\n");
+		return rc;
+	}
+
+	mrpd_port_save(port);
+	return 0;
 }
 
 void usage(void)
 {
 	fprintf(stderr,
 		"\n"
-		"usage: mrpd [-hdlmvsp] -i interface-name"
+		"usage: mrpd [-hdlmvspt] -i interface-name [-i interface-name ...]"
 		"\n"
 		"options:\n"
 		"    -h  show this message\n"
@@ -799,14 +1276,17 @@ void usage(void)
 		"    -m  enable MMRP Registrar and Participant\n"
 		"    -v  enable MVRP Registrar and Participant\n"
 		"    -s  enable MSRP Registrar and Participant\n"
-		"    -i  specify interface to monitor\n"
-		"\n" "%s" "\n", version_str);
+		"    -t  run MMRP, MVRP and MSRP on separate threads\n"
+		"    -i  specify interface to monitor, repeat to run a bridge\n"
+		"        of up to %d ports (not with -t)\n"
+		"\n" "%s" "\n", MRPD_MAX_PORTS, version_str);
 	exit(1);
 }
 
 int main(int argc, char *argv[])
 {
 	int c;
+	int port;
 	int rc = 0;
 
 	daemonize = 0;
@@ -815,9 +1295,11 @@ int main(int argc, char *argv[])
 	msrp_enable = 0;
 	msrp_pruning = 0;
 	logging_enable = 0;
+	threads_enable = 0;
 	mrpd_port = MRPD_PORT_DEFAULT;
 	interface = NULL;
 	interface_fd = -1;
+	mrpd_port_count = 0;
 	registration = MRP_REGISTRAR_CTL_NORMAL;	/* default */
 	participant = MRP_APPLICANT_CTL_NORMAL;	/* default */
 	control_socket = INVALID_SOCKET;
@@ -829,7 +1311,7 @@ int main(int argc, char *argv[])
 	gc_timer = -1;
 
 	for (;;) {
-		c = getopt(argc, argv, "hdlmvspi:");
+		c = getopt(argc, argv, "hdlmvspti:");
 
 		if (c < 0)
 			break;
@@ -847,6 +1329,9 @@ int main(int argc, char *argv[])
 		case 'p':
 			msrp_pruning = 1;
 			break;
+		case 't':
+			threads_enable = 1;
+			break;
 		case 'l':
 			logging_enable = 1;
 			break;
@@ -854,12 +1339,12 @@ int main(int argc, char *argv[])
 			daemonize = 1;
 			break;
 		case 'i':
-			if (interface) {
-				printf
-				    ("only one interface per daemon is supported\n");
+			if (mrpd_port_count >= MRPD_MAX_PORTS) {
+				printf("at most %d interfaces are supported\n",
+				       MRPD_MAX_PORTS);
 				usage();
 			}
-			interface = strdup(optarg);
+			mrpd_ports[mrpd_port_count++].ifname = strdup(optarg);
 			break;
 		case 'h':
 		default:
@@ -870,9 +1355,14 @@ int main(int argc, char *argv[])
 	if (optind < argc)
 		usage();
 
-	if (NULL == interface)
+	if (0 == mrpd_port_count)
 		usage();
 
+	if ((mrpd_port_count > 1) && threads_enable) {
+		printf("-t needs a single interface\n");
+		usage();
+	}
+
 	if (!mmrp_enable && !mvrp_enable && !msrp_enable)
 		usage();
 
@@ -890,24 +1380,14 @@ int main(int argc, char *argv[])
 	rc = init_local_ctl();
 	if (rc)
 		goto out;
+	mrpd_tlv_init(mrpd_send_ctl_frame);
 
-	rc = mmrp_init(mmrp_enable);
-	if (rc) {
-		printf("mmrp_enable failed\n");
-		goto out;
-	}
-
-	rc = mvrp_init(mvrp_enable);
-	if (rc) {
-		printf("mvrp_enable failed\n");
-		goto out;
-	}
-
-	rc = msrp_init(msrp_enable, MSRP_INTERESTING_STREAM_ID_COUNT, msrp_pruning);
-	if (rc) {
-		printf("msrp_enable failed\n");
-		goto out;
+	for (port = 0; port < mrpd_port_count; port++) {
+		rc = mrpd_port_init(port);
+		if (rc)
+			goto out;
 	}
+	/* leave the globals on the last port initialized */
 
 	rc = init_timers();
 	if (rc) {
@@ -128,9 +128,22 @@ int mrpd_timer_start(HTIMER timerfd, unsigned long value_ms);
 int mrpd_timer_stop(HTIMER timerfd);
 int mrpd_send_ctl_msg(struct sockaddr_in *client_addr, char *notify_data,
 		      int notify_len);
+/* one binary datagram, never batched into a client's TLV frames */
+int mrpd_send_ctl_data(struct sockaddr_in *client_addr, void *data, int len);
 int mrpd_init_protocol_socket(uint16_t etype, SOCKET * sock,
 			      unsigned char *multicast_addr);
 int mrpd_close_socket(SOCKET sock);
 int mrpd_recvmsgbuf(SOCKET sock, char **buf);
 
 void mrpd_log_printf(const char *fmt, ...);
+
+#define MRPD_APP_MMRP		0
+#define MRPD_APP_MVRP		1
+#define MRPD_APP_MSRP		2
+#define MRPD_APP_COUNT		3
+
+/*
+ * Bridge mode: an application's registration of attrib changed on the
+ * current port, redeclare it on the others (802.1Q MAP propagation).
+ */
+void mrpd_map_changed(int app, int notify, void *attrib);
@@ -0,0 +1,436 @@
+/****************************************************************************
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   3. Neither the name of the Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+/*
+ * binary, batched client protocol for mrpd
+ *
+ * A client becomes a binary client by sending a MRPD_TLV_MAGIC frame.
+ * From then on everything mrpd sends it through mrpd_send_ctl_msg() is
+ * queued into one pending frame per client instead of one datagram per
+ * message. Notifications that do not match the client's subscription
+ * are dropped here. Pending frames go out when full, at the end of each
+ * received frame and once per event loop pass (mrpd_tlv_flush).
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mrpd.h"
+#include "mrpd_tlv.h"
+
+#ifdef _WIN32
+/* mrpw runs every application on one thread */
+#define TLV_LOCK()
+#define TLV_UNLOCK()
+#else
+#include <pthread.h>
+static pthread_mutex_t tlv_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define TLV_LOCK()	pthread_mutex_lock(&tlv_mutex)
+#define TLV_UNLOCK()	pthread_mutex_unlock(&tlv_mutex)
+#endif
+
+struct mrpd_tlv_client {
+	struct mrpd_tlv_client *next;
+	struct sockaddr_in addr;
+	uint32_t apps;		/* MRPD_TLV_APP_xxx subscription */
+	uint32_t events;	/* MRPD_TLV_EVT_xxx subscription */
+	uint32_t seq;		/* seq of the last received frame */
+	int cmd_index;		/* command being processed, -1 between frames */
+	int len;		/* bytes in frame, 0 when nothing is pending */
+	unsigned char frame[MAX_MRPD_CMDSZ];
+};
+
+static struct mrpd_tlv_client *tlv_clients;
+static mrpd_tlv_send_fn tlv_send;
+
+static void tlv_put16(unsigned char *p, uint16_t v)
+{
+	p[0] = (unsigned char)(v >> 8);
+	p[1] = (unsigned char)v;
+}
+
+static void tlv_put32(unsigned char *p, uint32_t v)
+{
+	tlv_put16(p, (uint16_t)(v >> 16));
+	tlv_put16(p + 2, (uint16_t)v);
+}
+
+static uint16_t tlv_get16(const unsigned char *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t tlv_get32(const unsigned char *p)
+{
+	return ((uint32_t)tlv_get16(p) << 16) | tlv_get16(p + 2);
+}
+
+int mrpd_tlv_frame_init(unsigned char *frame, int size, uint32_t seq)
+{
+	if (size < MRPD_TLV_HDR_SZ)
+		return -1;
+
+	frame[0] = MRPD_TLV_MAGIC;
+	frame[1] = MRPD_TLV_VERSION;
+	tlv_put16(&frame[2], 0);
+	tlv_put32(&frame[4], seq);
+
+	return MRPD_TLV_HDR_SZ;
+}
+
+int mrpd_tlv_frame_add(unsigned char *frame, int size, int *len,
+		       uint16_t type, const void *value, int vlen)
+{
+	if ((vlen < 0) || (vlen > 0xFFFF))
+		return -1;
+	if (*len + MRPD_TLV_ITEM_HDR_SZ + vlen > size)
+		return -1;
+
+	tlv_put16(&frame[*len], type);
+	tlv_put16(&frame[*len + 2], (uint16_t)vlen);
+	if (vlen)
+		memcpy(&frame[*len + MRPD_TLV_ITEM_HDR_SZ], value, vlen);
+	*len += MRPD_TLV_ITEM_HDR_SZ + vlen;
+	tlv_put16(&frame[2], tlv_get16(&frame[2]) + 1);
+
+	return 0;
+}
+
+/*
+ * Walk the items of a frame. *offset starts at MRPD_TLV_HDR_SZ.
+ * Returns 1 for an item, 0 at the end of the frame, -1 if malformed.
+ */
+int mrpd_tlv_frame_next(const unsigned char *frame, int len, int *offset,
+			uint16_t *type, const unsigned char **value,
+			int *vlen)
+{
+	int pos = *offset;
+
+	if (pos == len)
+		return 0;
+	if (pos + MRPD_TLV_ITEM_HDR_SZ > len)
+		return -1;
+
+	*type = tlv_get16(&frame[pos]);
+	*vlen = tlv_get16(&frame[pos + 2]);
+	if (pos + MRPD_TLV_ITEM_HDR_SZ + *vlen > len)
+		return -1;
+	*value = &frame[pos + MRPD_TLV_ITEM_HDR_SZ];
+	*offset = pos + MRPD_TLV_ITEM_HDR_SZ + *vlen;
+
+	return 1;
+}
+
+int mrpd_tlv_is_frame(const char *buf, int buflen)
+{
+	return (buflen >= MRPD_TLV_HDR_SZ) &&
+	    ((unsigned char)buf[0] == MRPD_TLV_MAGIC) &&
+	    ((unsigned char)buf[1] == MRPD_TLV_VERSION);
+}
+
+/*
+ * Notifications are the only messages a subscription filters. They
+ * are "xNE", "xJO" or "xLE" followed by a space, x being the
+ * application letter.
+ */
+static int mrpd_tlv_classify(const char *data, int len, uint32_t *app,
+			     uint32_t *evt)
+{
+	if ((len < 4) || (data[3] != ' '))
+		return 0;
+
+	switch (data[0]) {
+	case 'M':
+		*app = MRPD_TLV_APP_MMRP;
+		break;
+	case 'V':
+		*app = MRPD_TLV_APP_MVRP;
+		break;
+	case 'S':
+		*app = MRPD_TLV_APP_MSRP;
+		break;
+	default:
+		return 0;
+	}
+
+	if (data[1] == 'N' && data[2] == 'E')
+		*evt = MRPD_TLV_EVT_NEW;
+	else if (data[1] == 'J' && data[2] == 'O')
+		*evt = MRPD_TLV_EVT_JOIN;
+	else if (data[1] == 'L' && data[2] == 'E')
+		*evt = MRPD_TLV_EVT_LEAVE;
+	else
+		return 0;
+
+	return 1;
+}
+
+static struct mrpd_tlv_client *mrpd_tlv_find(struct sockaddr_in *addr)
+{
+	struct mrpd_tlv_client *c;
+
+	for (c = tlv_clients; c; c = c->next) {
+		if ((c->addr.sin_port == addr->sin_port) &&
+		    (c->addr.sin_addr.s_addr == addr->sin_addr.s_addr))
+			return c;
+	}
+
+	return NULL;
+}
+
+/* called with tlv_mutex held */
+static void mrpd_tlv_flush_client(struct mrpd_tlv_client *c)
+{
+	if (c->len == 0)
+		return;
+
+	tlv_send(&c->addr, (char *)c->frame, c->len);
+	c->len = 0;
+}
+
+/* called with tlv_mutex held */
+static int mrpd_tlv_queue(struct mrpd_tlv_client *c, uint16_t type,
+			  const void *value, int vlen)
+{
+	int tries;
+
+	for (tries = 0; tries < 2; tries++) {
+		if (c->len == 0)
+			c->len = mrpd_tlv_frame_init(c->frame,
+						     sizeof(c->frame), c->seq);
+		if (mrpd_tlv_frame_add(c->frame, sizeof(c->frame), &c->len,
+				       type, value, vlen) == 0)
+			return 0;
+		mrpd_tlv_flush_client(c);
+	}
+
+	return -1;
+}
+
+void mrpd_tlv_init(mrpd_tlv_send_fn send)
+{
+	tlv_send = send;
+}
+
+int mrpd_tlv_recv(char *buf, int buflen, struct sockaddr_in *client,
+		  mrpd_tlv_cmd_fn process)
+{
+	const unsigned char *frame = (const unsigned char *)buf;
+	const unsigned char *value;
+	struct mrpd_tlv_client *c;
+	char cmd[MAX_MRPD_CMDSZ];
+	unsigned char done[8];
+	uint16_t type;
+	uint16_t index = 0;
+	uint16_t failed = 0;
+	int offset = MRPD_TLV_HDR_SZ;
+	int vlen;
+	int rc;
+
+	if (!tlv_send || !mrpd_tlv_is_frame(buf, buflen))
+		return -1;
+
+	TLV_LOCK();
+	c = mrpd_tlv_find(client);
+	if (NULL == c) {
+		c = (struct mrpd_tlv_client *)malloc(sizeof(*c));
+		if (NULL == c) {
+			TLV_UNLOCK();
+			return -1;
+		}
+		memset(c, 0, sizeof(*c));
+		c->addr = *client;
+		c->apps = MRPD_TLV_APP_ALL;
+		c->events = MRPD_TLV_EVT_ALL;
+		c->next = tlv_clients;
+		tlv_clients = c;
+	}
+	c->seq = tlv_get32(&frame[4]);
+	TLV_UNLOCK();
+
+	/*
+	 * The client is looked up again after each command, a BYE in the
+	 * middle of a frame removes it.
+	 */
+	while ((rc = mrpd_tlv_frame_next(frame, buflen, &offset, &type,
+					 &value, &vlen)) > 0) {
+		switch (type) {
+		case MRPD_TLV_CMD:
+			if ((vlen >= (int)sizeof(cmd)) ||
+			    mrpd_tlv_is_frame((const char *)value, vlen)) {
+				failed++;
+				break;
+			}
+			memcpy(cmd, value, vlen);
+			cmd[vlen] = '\0';
+
+			TLV_LOCK();
+			c = mrpd_tlv_find(client);
+			if (c)
+				c->cmd_index = index;
+			TLV_UNLOCK();
+
+			/* text clients send the NUL too, parse() relies on it */
+			if (process(cmd, vlen + 1, client) < 0)
+				failed++;
+			break;
+		case MRPD_TLV_SUBSCRIBE:
+			TLV_LOCK();
+			c = mrpd_tlv_find(client);
+			if (c && (vlen == 8)) {
+				c->apps = tlv_get32(value);
+				c->events = tlv_get32(value + 4);
+			} else {
+				failed++;
+			}
+			TLV_UNLOCK();
+			break;
+		default:
+			failed++;
+			break;
+		}
+		index++;
+	}
+	if (rc < 0)
+		failed++;
+
+	TLV_LOCK();
+	c = mrpd_tlv_find(client);
+	if (c) {
+		c->cmd_index = -1;
+		tlv_put32(&done[0], c->seq);
+		tlv_put16(&done[4], index);
+		tlv_put16(&done[6], failed);
+		mrpd_tlv_queue(c, MRPD_TLV_DONE, done, sizeof(done));
+		mrpd_tlv_flush_client(c);
+	}
+	TLV_UNLOCK();
+
+	return failed ? -1 : 0;
+}
+
+/*
+ * Returns 0 when client is not a binary client and data must go out as
+ * text, otherwise the message was queued or filtered and len is returned.
+ */
+int mrpd_tlv_send(struct sockaddr_in *client, char *data, int len)
+{
+	struct mrpd_tlv_client *c;
+	unsigned char resp[2 + MAX_MRPD_CMDSZ];
+	const char *end;
+	uint32_t app;
+	uint32_t evt;
+	int tlen;
+	int rc;
+
+	if (NULL == tlv_clients)
+		return 0;
+
+	/* most callers pass the whole, NUL padded, message buffer */
+	end = memchr(data, '\0', len);
+	tlen = end ? (int)(end - data) : len;
+
+	TLV_LOCK();
+	c = mrpd_tlv_find(client);
+	if (NULL == c) {
+		TLV_UNLOCK();
+		return 0;
+	}
+
+	if (mrpd_tlv_classify(data, tlen, &app, &evt)) {
+		if (!(c->apps & app) || !(c->events & evt)) {
+			TLV_UNLOCK();
+			return len;
+		}
+		rc = mrpd_tlv_queue(c, MRPD_TLV_NOTIFY, data, tlen);
+	} else {
+		if (tlen > MAX_MRPD_CMDSZ)
+			tlen = MAX_MRPD_CMDSZ;
+		tlv_put16(resp, (c->cmd_index < 0) ?
+			  MRPD_TLV_NO_INDEX : (uint16_t)c->cmd_index);
+		memcpy(&resp[2], data, tlen);
+		rc = mrpd_tlv_queue(c, MRPD_TLV_RESPONSE, resp, 2 + tlen);
+	}
+
+	/* too large for any frame, a text datagram still gets through */
+	if (rc < 0)
+		tlv_send(client, data, len);
+	TLV_UNLOCK();
+
+	return len;
+}
+
+void mrpd_tlv_flush(void)
+{
+	struct mrpd_tlv_client *c;
+
+	if (NULL == tlv_clients)
+		return;
+
+	TLV_LOCK();
+	for (c = tlv_clients; c; c = c->next) {
+		/* a frame being processed flushes its replies as one batch */
+		if (c->cmd_index < 0)
+			mrpd_tlv_flush_client(c);
+	}
+	TLV_UNLOCK();
+}
+
+void mrpd_tlv_bye(struct sockaddr_in *client)
+{
+	struct mrpd_tlv_client **pc;
+	struct mrpd_tlv_client *c;
+
+	TLV_LOCK();
+	for (pc = &tlv_clients; *pc; pc = &(*pc)->next) {
+		c = *pc;
+		if ((c->addr.sin_port == client->sin_port) &&
+		    (c->addr.sin_addr.s_addr == client->sin_addr.s_addr)) {
+			*pc = c->next;
+			free(c);
+			break;
+		}
+	}
+	TLV_UNLOCK();
+}
+
+void mrpd_tlv_reset(void)
+{
+	struct mrpd_tlv_client *c;
+
+	TLV_LOCK();
+	while (tlv_clients) {
+		c = tlv_clients;
+		tlv_clients = c->next;
+		free(c);
+	}
+	TLV_UNLOCK();
+}
@@ -0,0 +1,101 @@
+/****************************************************************************
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   3. Neither the name of the Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+/*
+ * binary, batched control protocol for mrpd clients
+ *
+ * A binary frame starts with MRPD_TLV_MAGIC, which is never the first
+ * byte of a text command, so both protocols share the control socket.
+ *
+ * frame:  magic(1) version(1) count(2) seq(4) followed by count items
+ * item:   type(2) length(2) value(length)
+ *
+ * All multi-byte fields are in network byte order. Commands and
+ * notifications carry the same text as the text protocol, so existing
+ * command and notification parsers are reused unchanged.
+ */
+
+#ifndef _MRPD_TLV_H_
+#define _MRPD_TLV_H_
+
+#define MRPD_TLV_MAGIC		0xA5
+#define MRPD_TLV_VERSION	1
+#define MRPD_TLV_HDR_SZ		8
+#define MRPD_TLV_ITEM_HDR_SZ	4
+
+/* client to mrpd */
+#define MRPD_TLV_CMD		0x0001	/* one text command */
+#define MRPD_TLV_SUBSCRIBE	0x0002	/* app mask(4), event mask(4) */
+
+/* mrpd to client */
+#define MRPD_TLV_RESPONSE	0x8001	/* command index(2), response text */
+#define MRPD_TLV_NOTIFY		0x8002	/* notification text */
+#define MRPD_TLV_DONE		0x8003	/* seq(4), processed(2), failed(2) */
+
+/* MRPD_TLV_SUBSCRIBE application mask */
+#define MRPD_TLV_APP_MMRP	0x00000001
+#define MRPD_TLV_APP_MVRP	0x00000002
+#define MRPD_TLV_APP_MSRP	0x00000004
+#define MRPD_TLV_APP_ALL	0x00000007
+
+/* MRPD_TLV_SUBSCRIBE event mask */
+#define MRPD_TLV_EVT_NEW	0x00000001
+#define MRPD_TLV_EVT_JOIN	0x00000002
+#define MRPD_TLV_EVT_LEAVE	0x00000004
+#define MRPD_TLV_EVT_ALL	0x00000007
+
+/* MRPD_TLV_RESPONSE index for replies sent outside of a frame */
+#define MRPD_TLV_NO_INDEX	0xFFFF
+
+typedef int (*mrpd_tlv_send_fn) (struct sockaddr_in *client,
+				 char *data, int len);
+typedef int (*mrpd_tlv_cmd_fn) (char *buf, int buflen,
+				struct sockaddr_in *client);
+
+/* frame codec */
+int mrpd_tlv_frame_init(unsigned char *frame, int size, uint32_t seq);
+int mrpd_tlv_frame_add(unsigned char *frame, int size, int *len,
+		       uint16_t type, const void *value, int vlen);
+int mrpd_tlv_frame_next(const unsigned char *frame, int len, int *offset,
+			uint16_t *type, const unsigned char **value,
+			int *vlen);
+int mrpd_tlv_is_frame(const char *buf, int buflen);
+
+/* daemon side client handling */
+void mrpd_tlv_init(mrpd_tlv_send_fn send);
+int mrpd_tlv_recv(char *buf, int buflen, struct sockaddr_in *client,
+		  mrpd_tlv_cmd_fn process);
+int mrpd_tlv_send(struct sockaddr_in *client, char *data, int len);
+void mrpd_tlv_flush(void);
+void mrpd_tlv_bye(struct sockaddr_in *client);
+void mrpd_tlv_reset(void);
+
+#endif
@@ -98,6 +98,10 @@ int mrpd_port;
 HANDLE pkt_events[6];
 HANDLE sem_kill_wpcap_thread;
 HANDLE sem_kill_localhost_thread;
+/* bursts are absorbed by depth, then handed to the protocols in batches */
+#define MRPW_QUE_DEPTH	1024
+#define MRPW_QUE_BATCH	32
+
 struct que_def *que_wpcap;
 struct que_def *que_localhost;
 
@@ -305,19 +309,28 @@ int netif_send_frame(struct netif *net_if, uint8_t * frame, uint16_t length)
 	return (0);
 }
 
+/*
+ * The frame is copied in, pcap reuses its buffer on the next capture
+ * while queued frames wait to be processed.
+ */
 struct netif_thread_data {
-	uint8_t *frame;
 	uint16_t length;
+	uint8_t frame[MAX_FRAME_SIZE];
 };
 
 DWORD WINAPI netif_thread(LPVOID lpParam)
 {
 	int status;
-	struct netif_thread_data d;
+	static struct netif_thread_data d;
+	uint8_t *frame;
 
 	while (WaitForSingleObject(sem_kill_wpcap_thread, 0)) {
-		status = netif_capture_frame(net_if, &d.frame, &d.length);
+		status = netif_capture_frame(net_if, &frame, &d.length);
 		if (status > 0) {
+			if (d.length > MAX_FRAME_SIZE)
+				d.length = MAX_FRAME_SIZE;
+			memcpy(d.frame, frame, d.length);
+			/* a full queue drops the frame, MRP repeats itself */
 			que_push(que_wpcap, &d);
 		} else {
 			if (!SetEvent(pkt_events[pkt_event_wpcap_timeout])) {
@@ -601,6 +614,15 @@ int mrpd_send_ctl_msg(struct sockaddr_in *client_addr,
 	return rc;
 }
 
+int mrpd_send_ctl_data(struct sockaddr_in *client_addr, void *data, int len)
+{
+	if (INVALID_SOCKET == control_socket)
+		return 0;
+
+	return sendto(control_socket, data, len,
+		      0, (struct sockaddr *)client_addr, sizeof(struct sockaddr));
+}
+
 int mrpd_close_socket(SOCKET sock)
 {
 	return closesocket(sock);
@@ -623,6 +645,11 @@ int mrpd_init_protocol_socket(uint16_t etype, SOCKET * sock,
 	return 0;
 }
 
+/* one interface per process, there is nothing to propagate to */
+void mrpd_map_changed(int app, int notify, void *attrib)
+{
+}
+
 int init_local_ctl(void)
 {
 	struct sockaddr_in addr;
@@ -683,7 +710,8 @@ DWORD WINAPI ctl_thread(LPVOID lpParam)
 		    recvfrom(control_socket, s.msgbuf, MAX_MRPD_CMDSZ, 0,
 			     &s.client_addr, &client_len);
 		if (s.bytes > 0) {
-			que_push(que_localhost, &s);
+			if (que_push(que_localhost, &s) < 0)
+				free(s.msgbuf);
 		} else {
 			free(s.msgbuf);
 			if (!SetEvent(pkt_events[pkt_event_localhost_timeout])) {
@@ -732,8 +760,8 @@ int mrpw_init_threads(void)
 	timer_check_tick = mrpd_timer_create();
 	mrpd_timer_start_interval(timer_check_tick, 100, 100);
 
-	que_wpcap = que_new(256, sizeof(struct netif_thread_data));
-	que_localhost = que_new(256, sizeof(struct ctl_thread_params));
+	que_wpcap = que_new(MRPW_QUE_DEPTH, sizeof(struct netif_thread_data));
+	que_localhost = que_new(MRPW_QUE_DEPTH, sizeof(struct ctl_thread_params));
 
 	sem_kill_wpcap_thread = CreateSemaphore(NULL, 0, 32767, NULL);
 	sem_kill_localhost_thread = CreateSemaphore(NULL, 0, 32767, NULL);
@@ -774,15 +802,61 @@ int mrpw_init_threads(void)
 	return 0;
 }
 
-int mrpw_run_once(void)
+static void mrpw_recv_frame(struct netif_thread_data *wpcap_pkt)
 {
-	struct netif_thread_data wpcap_pkt;
-	struct ctl_thread_params localhost_pkt;
-	uint16_t length = 0;
 	uint8_t *payload;
 	uint16_t protocol;
 	uint8_t *proto;
 
+	proto = &wpcap_pkt->frame[12];
+	protocol = (uint16_t) proto[0] << 8 | (uint16_t) proto[1];
+	payload = proto + 2;
+
+	last_pdu_buffer = wpcap_pkt->frame;
+	last_pdu_buffer_size = wpcap_pkt->length;
+
+	switch (protocol) {
+	case MVRP_ETYPE:
+		if (mvrp_enable)
+			mvrp_recv_msg();
+		break;
+
+	case MMRP_ETYPE:
+		if (mmrp_enable)
+			mmrp_recv_msg();
+		break;
+
+	case MSRP_ETYPE:
+		if (msrp_enable)
+			msrp_recv_msg();
+		break;
+	}
+}
+
+/* reports queue overflows once per new drop count */
+static void mrpw_que_check(struct que_def *q, const char *name,
+			   uint32_t *reported)
+{
+	struct que_stats stats;
+
+	que_get_stats(q, &stats);
+	if (stats.overflows != *reported) {
+		printf("%s queue dropped %u entries (high water %u of %d)\n",
+		       name, stats.overflows - *reported, stats.high_water,
+		       MRPW_QUE_DEPTH);
+		*reported = stats.overflows;
+	}
+}
+
+int mrpw_run_once(void)
+{
+	static struct netif_thread_data wpcap_pkts[MRPW_QUE_BATCH];
+	static struct ctl_thread_params localhost_pkts[MRPW_QUE_BATCH];
+	static uint32_t wpcap_overflows;
+	static uint32_t localhost_overflows;
+	int count;
+	int i;
+
 	DWORD dwEvent =
 	    WaitForMultipleObjects(sizeof(pkt_events) / sizeof(HANDLE),
 				   pkt_events,
@@ -841,30 +915,11 @@ int mrpw_run_once(void)
 		break;
 
 	case WAIT_OBJECT_0 + pkt_event_wpcap:
-		que_pop_nowait(que_wpcap, &wpcap_pkt);
-		proto = &wpcap_pkt.frame[12];
-		protocol = (uint16_t) proto[0] << 8 | (uint16_t) proto[1];
-		payload = proto + 2;
-
-		last_pdu_buffer = wpcap_pkt.frame;
-		last_pdu_buffer_size = wpcap_pkt.length;
-
-		switch (protocol) {
-		case MVRP_ETYPE:
-			if (mvrp_enable)
-				mvrp_recv_msg();
-			break;
-
-		case MMRP_ETYPE:
-			if (mmrp_enable)
-				mmrp_recv_msg();
-			break;
-
-		case MSRP_ETYPE:
-			if (msrp_enable)
-				msrp_recv_msg();
-			break;
-		}
+		/* the queue signals again if the batch left entries behind */
+		count = que_pop_batch(que_wpcap, wpcap_pkts, MRPW_QUE_BATCH);
+		for (i = 0; i < count; i++)
+			mrpw_recv_frame(&wpcap_pkts[i]);
+		mrpw_que_check(que_wpcap, "wpcap", &wpcap_overflows);
 		if (mrpd_timer_timeout(&timer_check_tick)) {
 			if (!SetEvent(pkt_events[loop_time_tick])) {
 				printf("SetEvent loop_time_tick failed (%d)\n",
@@ -879,10 +934,15 @@ int mrpw_run_once(void)
 		break;
 
 	case WAIT_OBJECT_0 + pkt_event_localhost:
-		que_pop_nowait(que_localhost, &localhost_pkt);
-		process_ctl_msg(localhost_pkt.msgbuf,
-				localhost_pkt.bytes, (struct sockaddr_in *)
-				&localhost_pkt.client_addr);
+		count = que_pop_batch(que_localhost, localhost_pkts,
+				      MRPW_QUE_BATCH);
+		for (i = 0; i < count; i++) {
+			process_ctl_msg(localhost_pkts[i].msgbuf,
+					localhost_pkts[i].bytes,
+					(struct sockaddr_in *)
+					&localhost_pkts[i].client_addr);
+		}
+		mrpw_que_check(que_localhost, "localhost", &localhost_overflows);
 		if (mrpd_timer_timeout(&timer_check_tick)) {
 			if (!SetEvent(pkt_events[loop_time_tick])) {
 				printf("SetEvent loop_time_tick failed (%d)\n",
@@ -899,6 +959,8 @@ int mrpw_run_once(void)
 	default:
 		printf("Unknown event %d\n", dwEvent);
 	}
+	if (msrp_enable)
+		msrp_flush_notifications();
 	return 0;
 }
 
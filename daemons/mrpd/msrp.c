@@ -142,17 +142,173 @@ int msrp_count_type(uint32_t attrib_type)
 }
 
 
+/*
+ * TalkerAdvertise and TalkerFailed share a key since msrp_merge() may
+ * switch an attribute between the two in place.
+ */
+static uint32_t msrp_hash_key_type(uint32_t type)
+{
+	if (MSRP_TALKER_FAILED_TYPE == type)
+		return MSRP_TALKER_ADV_TYPE;
+	return type;
+}
+
+static unsigned int msrp_hash(const struct msrp_attribute *attrib)
+{
+	uint32_t h;
+	int i;
+
+	/* FNV-1a over the key */
+	h = 2166136261u ^ msrp_hash_key_type(attrib->type);
+	h *= 16777619u;
+	if (MSRP_DOMAIN_TYPE == attrib->type) {
+		h ^= attrib->attribute.domain.SRclassID;
+		h *= 16777619u;
+	} else {
+		for (i = 0; i < 8; i++) {
+			h ^= attrib->attribute.talk_listen.StreamID[i];
+			h *= 16777619u;
+		}
+	}
+	return h & (MSRP_ATTRIB_HASH_SIZE - 1);
+}
+
+static void msrp_hash_insert(struct msrp_attribute *attrib)
+{
+	unsigned int bucket = msrp_hash(attrib);
+
+	attrib->hnext = MSRP_db->attrib_hash[bucket];
+	MSRP_db->attrib_hash[bucket] = attrib;
+}
+
+static void msrp_hash_remove(struct msrp_attribute *attrib)
+{
+	struct msrp_attribute **pp;
+
+	pp = &MSRP_db->attrib_hash[msrp_hash(attrib)];
+	while (NULL != *pp) {
+		if (*pp == attrib) {
+			*pp = attrib->hnext;
+			break;
+		}
+		pp = &(*pp)->hnext;
+	}
+	attrib->hnext = NULL;
+}
+
+static void msrp_run_invalidate(struct msrp_attribute *attrib)
+{
+	attrib->run_state = MSRP_RUN_UNKNOWN;
+	if (NULL != attrib->prev)
+		attrib->prev->run_state = MSRP_RUN_UNKNOWN;
+}
+
+static uint64_t msrp_snap_get_generation(const uint8_t *rec)
+{
+	uint64_t v = 0;
+	int i;
+
+	for (i = 8; i < 16; i++)
+		v = (v << 8) | rec[i];
+	return v;
+}
+
+static void msrp_snap_put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static void msrp_snap_put32(uint8_t *p, uint32_t v)
+{
+	msrp_snap_put16(p, v >> 16);
+	msrp_snap_put16(p + 2, v);
+}
+
+static void msrp_snap_put64(uint8_t *p, uint64_t v)
+{
+	msrp_snap_put32(p, v >> 32);
+	msrp_snap_put32(p + 4, v);
+}
+
+/* encodes attrib as a snapshot record, generation left at 0 */
+static void msrp_snap_encode(const struct msrp_attribute *attrib, int op,
+			     uint8_t *rec)
+{
+	const msrpdu_talker_fail_t *tl = &attrib->attribute.talk_listen;
+	const msrpdu_domain_t *dom = &attrib->attribute.domain;
+	uint8_t *value = rec + 24;
+
+	memset(rec, 0, MSRP_SNAP_REC_SZ);
+	rec[0] = op;
+	rec[1] = attrib->type;
+
+	if (MSRP_DOMAIN_TYPE == attrib->type) {
+		value[0] = dom->SRclassID;
+		if (MSRP_SNAP_OP_REMOVE == op)
+			return;
+		value[1] = dom->SRclassPriority;
+		value[2] = dom->neighborSRclassPriority;
+		msrp_snap_put16(value + 4, dom->SRclassVID);
+	} else {
+		memcpy(value, tl->StreamID, 8);
+		if (MSRP_SNAP_OP_REMOVE == op)
+			return;
+		memcpy(value + 8, tl->DataFrameParameters.Dest_Addr, 6);
+		msrp_snap_put16(value + 14, tl->DataFrameParameters.Vlan_ID);
+		msrp_snap_put16(value + 16, tl->TSpec.MaxFrameSize);
+		msrp_snap_put16(value + 18, tl->TSpec.MaxIntervalFrames);
+		value[20] = tl->PriorityAndRank;
+		msrp_snap_put32(value + 24, tl->AccumulatedLatency);
+		memcpy(value + 28, tl->FailureInformation.BridgeID, 8);
+		value[36] = tl->FailureInformation.FailureCode;
+	}
+
+	rec[2] = attrib->applicant.mrp_state;
+	rec[3] = attrib->registrar.mrp_state;
+	rec[4] = attrib->substate;
+	memcpy(rec + 16, attrib->registrar.macaddr, 6);
+}
+
+/* keeps the removal for incremental snapshots */
+static void msrp_snap_remove(struct msrp_attribute *attrib)
+{
+	uint8_t *rec = MSRP_db->snap_tombstones[MSRP_db->snap_tombstone_next];
+
+	/* a client older than the removal overwritten here must resync */
+	if (rec[0])
+		MSRP_db->snap_floor = msrp_snap_get_generation(rec);
+
+	msrp_snap_encode(attrib, MSRP_SNAP_OP_REMOVE, rec);
+	msrp_snap_put64(rec + 8, ++MSRP_db->snap_generation);
+	MSRP_db->snap_tombstone_next =
+	    (MSRP_db->snap_tombstone_next + 1) % MSRP_SNAP_TOMBSTONES;
+}
+
+/* remove an attribute from the database, the caller frees it */
+static void msrp_unlink(struct msrp_attribute *attrib)
+{
+	msrp_snap_remove(attrib);
+	msrp_run_invalidate(attrib);
+	if (NULL != attrib->prev)
+		attrib->prev->next = attrib->next;
+	else
+		MSRP_db->attrib_list = attrib->next;
+	if (NULL != attrib->next)
+		attrib->next->prev = attrib->prev;
+	msrp_hash_remove(attrib);
+}
+
 struct msrp_attribute *msrp_lookup(struct msrp_attribute *rattrib)
 {
 	struct msrp_attribute *attrib;
+	uint32_t key_type;
 	int mac_eq;
 
-	attrib = MSRP_db->attrib_list;
+	key_type = msrp_hash_key_type(rattrib->type);
+	attrib = MSRP_db->attrib_hash[msrp_hash(rattrib)];
 	while (NULL != attrib) {
-		if (	(rattrib->type == attrib->type) ||
-			((MSRP_TALKER_ADV_TYPE == rattrib->type) && (MSRP_TALKER_FAILED_TYPE == attrib->type)) ||
-			((MSRP_TALKER_FAILED_TYPE == rattrib->type) && (MSRP_TALKER_ADV_TYPE == attrib->type)))
-			{
+		if (key_type == msrp_hash_key_type(attrib->type)) {
 			if (MSRP_DOMAIN_TYPE == attrib->type) {
 				if (attrib->attribute.domain.SRclassID ==
 				   rattrib->attribute.domain.SRclassID)
@@ -168,7 +324,7 @@ struct msrp_attribute *msrp_lookup(struct msrp_attribute *rattrib)
 					return attrib;
 			}
 		}
-		attrib = attrib->next;
+		attrib = attrib->hnext;
 	}
 	return NULL;
 }
@@ -189,14 +345,12 @@ struct msrp_attribute *msrp_lookup_stream_declaration(uint32_t decl_type, uint8_
 	return found_attrib;
 }
 #endif
-int msrp_add(struct msrp_attribute *rattrib)
+static void msrp_list_insert(struct msrp_attribute *rattrib)
 {
 	struct msrp_attribute *attrib;
 	struct msrp_attribute *attrib_tail;
 	int mac_eq;
 
-	/* XXX do a lookup first to guarantee uniqueness? */
-
 	attrib_tail = attrib = MSRP_db->attrib_list;
 
 	while (NULL != attrib) {
@@ -227,7 +381,7 @@ int msrp_add(struct msrp_attribute *rattrib)
 					attrib->next = rattrib;
 					if (rattrib->next)
 						rattrib->next->prev = rattrib;
-					return 0;
+					return;
 
 				} else {
 					/* head insertion ... */
@@ -239,7 +393,7 @@ int msrp_add(struct msrp_attribute *rattrib)
 					else
 						MSRP_db->attrib_list = rattrib;
 
-					return 0;
+					return;
 				}
 			} else {
 				mac_eq =
@@ -264,7 +418,7 @@ int msrp_add(struct msrp_attribute *rattrib)
 					attrib->next = rattrib;
 					if (rattrib->next)
 						rattrib->next->prev = rattrib;
-					return 0;
+					return;
 
 				} else {
 					/* head insertion ... */
@@ -276,7 +430,7 @@ int msrp_add(struct msrp_attribute *rattrib)
 					else
 						MSRP_db->attrib_list = rattrib;
 
-					return 0;
+					return;
 				}
 			}
 		}
@@ -297,6 +451,15 @@ int msrp_add(struct msrp_attribute *rattrib)
 		rattrib->prev = attrib_tail;
 		attrib_tail->next = rattrib;
 	}
+}
+
+int msrp_add(struct msrp_attribute *rattrib)
+{
+	/* XXX do a lookup first to guarantee uniqueness? */
+
+	msrp_hash_insert(rattrib);
+	msrp_list_insert(rattrib);
+	msrp_run_invalidate(rattrib);
 
 	return 0;
 }
@@ -331,6 +494,7 @@ int msrp_merge(struct msrp_attribute *rattrib)
 		 */
 		if (rattrib->operation == attrib->operation) {
 
+			msrp_run_invalidate(attrib);
 			attrib->attribute.talk_listen.FailureInformation.FailureCode =
 				rattrib->attribute.talk_listen.FailureInformation.
 				FailureCode;
@@ -2210,24 +2374,52 @@ msrp_emit_domainvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
  * Below works for both talker and talkerFailed because talker has
  * FailureInformation explicitly set to zero.
  */
-static int vectorize_talker(struct msrp_attribute *first_attrib,
-			uint8_t streamid_firstval[8],
-			uint8_t mac_firstval[6],
+static int vectorize_talker(struct msrp_attribute *attrib,
 			struct msrp_attribute *candidate_attrib)
 {
 	struct msrpdu_talker_fail  first;
 
 	/*
-	 * Make a copy of the "first" attrib and update ID and MAC with new
-	 * values before comparing
+	 * Make a copy of attrib and update ID and MAC with the values that
+	 * follow before comparing
 	 */
-	first = first_attrib->attribute.talk_listen;
-	memcpy(first.StreamID, streamid_firstval, 8);
-	memcpy(first.DataFrameParameters.Dest_Addr, mac_firstval, 6);
+	first = attrib->attribute.talk_listen;
+	msrp_increment_streamid(first.StreamID);
+	mmrp_increment_macaddr(first.DataFrameParameters.Dest_Addr);
 	return (memcmp(&first, &candidate_attrib->attribute.talk_listen,
 			sizeof(first)) == 0);
 }
 
+/*
+ * The PDU emitters ask this for every neighbouring pair on each transmit
+ * opportunity, so the answer is kept with the attribute until
+ * msrp_run_invalidate() clears it.
+ */
+static int msrp_run_continues(struct msrp_attribute *attrib)
+{
+	struct msrp_attribute *next = attrib->next;
+	uint8_t streamid[8];
+	int continues;
+
+	if (MSRP_RUN_UNKNOWN == attrib->run_state) {
+		if ((NULL == next) || (next->type != attrib->type)) {
+			continues = 0;
+		} else if (MSRP_LISTENER_TYPE == attrib->type) {
+			memcpy(streamid,
+			       attrib->attribute.talk_listen.StreamID, 8);
+			msrp_increment_streamid(streamid);
+			continues = (memcmp(next->attribute.talk_listen.StreamID,
+					    streamid, 8) == 0);
+		} else {
+			continues = vectorize_talker(attrib, next);
+		}
+		attrib->run_state = continues ?
+		    MSRP_RUN_CONTINUES : MSRP_RUN_BREAK;
+	}
+
+	return MSRP_RUN_CONTINUES == attrib->run_state;
+}
+
 int
 msrp_emit_talkervectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 		      int *bytes_used, int lva, unsigned int type)
@@ -2405,13 +2597,7 @@ msrp_emit_talkervectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 			if (0 == vattrib->applicant.tx)
 				break;
 
-			msrp_increment_streamid(streamid_firstval);
-			mmrp_increment_macaddr(destmac_firstval);
-
-			if (!vectorize_talker(attrib,
-					streamid_firstval,
-					destmac_firstval,
-					vattrib))
+			if (!msrp_run_continues(vattrib->prev))
 				break;
 
 			vattrib->applicant.tx = 0;
@@ -2570,7 +2756,6 @@ msrp_emit_listenvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 	uint8_t streamid_firstval[8];
 	struct msrp_attribute *attrib, *vattrib;
 	unsigned int vector_size = 13;
-	int mac_eq;
 	unsigned int attrib_found_flag = 0;
 
 	/* need at least 13 bytes for a single vector */
@@ -2701,12 +2886,7 @@ msrp_emit_listenvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 			if (0 == vattrib->applicant.tx)
 				break;
 
-			msrp_increment_streamid(streamid_firstval);
-
-			mac_eq = memcmp(vattrib->attribute.talk_listen.StreamID,
-					streamid_firstval, 8);
-
-			if (0 != mac_eq)
+			if (!msrp_run_continues(vattrib->prev))
 				break;
 
 			vattrib->applicant.tx = 0;
@@ -3016,6 +3196,129 @@ int msrp_txpdu(void)
 	return -1;
 }
 
+static struct msrp_client_filter *msrp_client_filter_find(
+	struct sockaddr_in *client)
+{
+	struct msrp_client_filter *filter;
+
+	for (filter = MSRP_db->client_filters; filter; filter = filter->next) {
+		if ((filter->client.sin_port == client->sin_port) &&
+		    (filter->client.sin_addr.s_addr == client->sin_addr.s_addr))
+			return filter;
+	}
+	return NULL;
+}
+
+static struct msrp_client_filter *msrp_client_filter_get(
+	struct sockaddr_in *client)
+{
+	struct msrp_client_filter *filter;
+
+	filter = msrp_client_filter_find(client);
+	if (NULL != filter)
+		return filter;
+
+	filter = (struct msrp_client_filter *)malloc(sizeof(*filter));
+	if (NULL == filter)
+		return NULL;
+	memset(filter, 0, sizeof(*filter));
+	if (eui64set_init(&filter->stream_ids,
+			  MSRP_CLIENT_FILTER_STREAMS) < 0) {
+		free(filter);
+		return NULL;
+	}
+	filter->client = *client;
+	filter->next = MSRP_db->client_filters;
+	MSRP_db->client_filters = filter;
+	return filter;
+}
+
+static void msrp_client_filter_flush(struct msrp_client_filter *filter)
+{
+	if (0 == filter->pending_len)
+		return;
+
+	mrpd_send_ctl_msg(&filter->client, filter->pending,
+			  filter->pending_len + 1);
+	filter->pending_len = 0;
+	filter->pending[0] = '\0';
+}
+
+static void msrp_client_filter_delete(struct sockaddr_in *client)
+{
+	struct msrp_client_filter **pfilter;
+	struct msrp_client_filter *filter;
+
+	for (pfilter = &MSRP_db->client_filters; *pfilter;
+	     pfilter = &(*pfilter)->next) {
+		filter = *pfilter;
+		if ((filter->client.sin_port == client->sin_port) &&
+		    (filter->client.sin_addr.s_addr ==
+		     client->sin_addr.s_addr)) {
+			*pfilter = filter->next;
+			eui64set_free(&filter->stream_ids);
+			free(filter);
+			return;
+		}
+	}
+}
+
+static int msrp_client_wants(struct msrp_client_filter *filter,
+			     struct msrp_attribute *attrib)
+{
+	if (NULL == filter)
+		return 1;
+
+	if (filter->type_mask && !(filter->type_mask & (1 << attrib->type)))
+		return 0;
+
+	/* domain attributes are not tied to a stream */
+	if ((MSRP_DOMAIN_TYPE != attrib->type) &&
+	    eui64set_num_entries(&filter->stream_ids) &&
+	    !eui64set_find(&filter->stream_ids,
+			   eui64_read(attrib->attribute.talk_listen.StreamID)))
+		return 0;
+
+	return 1;
+}
+
+static void msrp_notify_client(struct sockaddr_in *client,
+			       struct msrp_attribute *attrib, char *msgbuf)
+{
+	struct msrp_client_filter *filter;
+	int len = strlen(msgbuf);
+
+	filter = msrp_client_filter_find(client);
+	if (!msrp_client_wants(filter, attrib))
+		return;
+
+	if ((NULL == filter) || !filter->coalesce) {
+		mrpd_send_ctl_msg(client, msgbuf, len + 1);
+		return;
+	}
+
+	/* one datagram of newline separated lines, as S?? answers */
+	if (filter->pending_len + len >= MAX_MRPD_CMDSZ)
+		msrp_client_filter_flush(filter);
+	memcpy(&filter->pending[filter->pending_len], msgbuf, len + 1);
+	filter->pending_len += len;
+}
+
+/*
+ * Called once the event or message that caused a batch of attribute
+ * changes has been processed, with MSRP still locked.
+ */
+void msrp_flush_notifications(void)
+{
+	struct msrp_client_filter *filter;
+
+	if (NULL == MSRP_db)
+		return;
+
+	for (filter = MSRP_db->client_filters; filter; filter = filter->next)
+		msrp_client_filter_flush(filter);
+}
+
 int msrp_send_notifications(struct msrp_attribute *attrib, int notify)
 {
 	char *msgbuf;
@@ -3177,7 +3480,7 @@ int msrp_send_notifications(struct msrp_attribute *attrib, int notify)
 
 	client = MSRP_db->mrp_db.clients;
 	while (NULL != client) {
-		mrpd_send_ctl_msg(&(client->client), msgbuf, MAX_MRPD_CMDSZ);
+		msrp_notify_client(&(client->client), attrib, msgbuf);
 		client = client->next;
 	}
 
@@ -3347,6 +3650,109 @@ static int msrp_cmd_parse_stream_id(const char *buf, int buflen,
 }
 
 
+/* sends one snapshot datagram, the header goes in front of count records */
+static void msrp_snap_send(struct sockaddr_in *client, uint8_t *msgbuf,
+			   int flags, int count, int index, uint64_t since)
+{
+	msgbuf[0] = MSRP_SNAP_MAGIC;
+	msgbuf[1] = MSRP_SNAP_VERSION;
+	msrp_snap_put16(msgbuf + 2, flags);
+	msrp_snap_put16(msgbuf + 4, count);
+	msrp_snap_put16(msgbuf + 6, index);
+	msrp_snap_put64(msgbuf + 8, MSRP_db->snap_generation);
+	msrp_snap_put64(msgbuf + 16, since);
+	mrpd_send_ctl_data(client, msgbuf,
+			   MSRP_SNAP_HDR_SZ + count * MSRP_SNAP_REC_SZ);
+}
+
+/*
+ * Answers S?G with the records changed after generation since. Changes
+ * are picked up here by comparing each attribute with the record it was
+ * last snapshotted as, so nothing has to be tracked on the protocol
+ * paths and polling costs a binary encode per attribute.
+ */
+int msrp_snapshot(struct sockaddr_in *client, uint64_t since)
+{
+	struct msrp_attribute *attrib;
+	uint8_t rec[MSRP_SNAP_REC_SZ];
+	uint8_t *msgbuf;
+	uint8_t *tomb;
+	int per_msg = (MAX_MRPD_CMDSZ - MSRP_SNAP_HDR_SZ) / MSRP_SNAP_REC_SZ;
+	int flags = 0;
+	int count = 0;
+	int index = 0;
+	int i;
+
+	msgbuf = (uint8_t *)malloc(MAX_MRPD_CMDSZ);
+	if (NULL == msgbuf)
+		return -1;
+
+	for (attrib = MSRP_db->attrib_list; attrib; attrib = attrib->next) {
+		msrp_snap_encode(attrib, MSRP_SNAP_OP_UPDATE, rec);
+		if (memcmp(rec, attrib->snap, sizeof(rec))) {
+			memcpy(attrib->snap, rec, sizeof(rec));
+			attrib->snap_generation = ++MSRP_db->snap_generation;
+		}
+	}
+
+	if ((0 == since) || (since > MSRP_db->snap_generation) ||
+	    (since < MSRP_db->snap_floor)) {
+		flags |= MSRP_SNAP_FULL;
+		since = 0;
+	} else {
+		/* removals first, oldest first, so a re-add comes after */
+		for (i = 0; i < MSRP_SNAP_TOMBSTONES; i++) {
+			tomb = MSRP_db->snap_tombstones[(MSRP_db->snap_tombstone_next + i) %
+							MSRP_SNAP_TOMBSTONES];
+			if (!tomb[0] || (msrp_snap_get_generation(tomb) <= since))
+				continue;
+			if (count == per_msg) {
+				msrp_snap_send(client, msgbuf, flags | MSRP_SNAP_MORE,
+					       count, index++, since);
+				count = 0;
+			}
+			memcpy(msgbuf + MSRP_SNAP_HDR_SZ + count++ * MSRP_SNAP_REC_SZ,
+			       tomb, MSRP_SNAP_REC_SZ);
+		}
+	}
+
+	for (attrib = MSRP_db->attrib_list; attrib; attrib = attrib->next) {
+		if (attrib->snap_generation <= since)
+			continue;
+		if (count == per_msg) {
+			msrp_snap_send(client, msgbuf, flags | MSRP_SNAP_MORE,
+				       count, index++, since);
+			count = 0;
+		}
+		memcpy(msgbuf + MSRP_SNAP_HDR_SZ + count * MSRP_SNAP_REC_SZ,
+		       attrib->snap, MSRP_SNAP_REC_SZ);
+		msrp_snap_put64(msgbuf + MSRP_SNAP_HDR_SZ +
+				count * MSRP_SNAP_REC_SZ + 8,
+				attrib->snap_generation);
+		count++;
+	}
+
+	/* always ends with a datagram without MORE, even if nothing changed */
+	msrp_snap_send(client, msgbuf, flags, count, index, since);
+	free(msgbuf);
+	return 0;
+}
+
+static int msrp_cmd_parse_snapshot(const char *buf, int buflen,
+				   uint64_t *since, int *err_index)
+{
+	struct parse_param specs[] = {
+		{"G" PARSE_ASSIGN, parse_u64, since},
+		{0, parse_null, 0}
+	};
+	*since = 0;
+	/* a bare S?G asks for the whole table */
+	if ((buflen <= MSRP_CLIENT_CMDSTR_HEADER_LEN) || (':' != buf[3]))
+		return 0;
+	return parse(buf + MSRP_CLIENT_CMDSTR_HEADER_LEN,
+		     buflen - MSRP_CLIENT_CMDSTR_HEADER_LEN, specs, err_index);
+}
+
 /* S+? - (re)JOIN a stream */
 /* S++ - NEW a stream      */
 static int msrp_cmd_parse_join_or_new_stream(const char *buf, int buflen,
@@ -3612,6 +4018,7 @@ int msrp_recv_cmd(const char *buf, int buflen, struct sockaddr_in *client)
 
 	/*
 	 * S?? - query MSRP Registrar database
+	 * S?G - binary snapshot of the changes since a generation
 	 * S+? - (re)JOIN a stream
 	 * S++   NEW a stream
 	 * S-- - LV a stream
@@ -3619,6 +4026,10 @@ int msrp_recv_cmd(const char *buf, int buflen, struct sockaddr_in *client)
 	 * S-L   Withdraw a listener status
 	 * S+D   Report a domain status
 	 * S-D   Withdraw a domain status
+	 * S+F   Only notify this client of a stream id (S=) or type (T=)
+	 * S-F   Remove this client's notification filter
+	 * S+C   Coalesce this client's notifications into one datagram
+	 * S-C   Send this client one datagram per notification
 	 * I+S   Add a stream id to the talker stream id list
 	 * I-S   Remove a stream id from the talker stream id list
 	 * I-A   Remove all stream ids from the interesting talker and listener stream id lists
@@ -3627,6 +4038,17 @@ int msrp_recv_cmd(const char *buf, int buflen, struct sockaddr_in *client)
 	if (strncmp(buf, "S??", 3) == 0) {
 		msrp_dumptable(client);
 
+	} else if (strncmp(buf, "S?G", 3) == 0) {
+		/* buf[] should look similar to 'S?G:G=1234' */
+		uint64_t since;
+
+		rc = msrp_cmd_parse_snapshot(buf, buflen, &since, &err_index);
+		if (rc)
+			goto out_ERP;
+		rc = msrp_snapshot(client, since);
+		if (rc)
+			goto out_ERI;
+
 	} else if (strncmp(buf, "S-L", 3) == 0) {
 		/* buf[] should look similar to 'S-L:L=xxyyzz...' */
 		rc = msrp_cmd_parse_withdraw_listener_status(buf, buflen,
@@ -3653,12 +4075,7 @@ int msrp_recv_cmd(const char *buf, int buflen, struct sockaddr_in *client)
 				if (((free_sattrib->type == MSRP_TALKER_ADV_TYPE) ||
 					(free_sattrib->type == MSRP_TALKER_FAILED_TYPE)) &&
 					(memcmp(free_sattrib->attribute.talk_listen.StreamID, talker_param.StreamID, sizeof(talker_param.StreamID)) == 0)) {
-					if (NULL != free_sattrib->prev)
-						free_sattrib->prev->next = free_sattrib->next;
-					else
-						MSRP_db->attrib_list = free_sattrib->next;
-					if (NULL != free_sattrib->next)
-						free_sattrib->next->prev = free_sattrib->prev;
+					msrp_unlink(free_sattrib);
 					/* delete attribute */
 					free(free_sattrib);
 				}
@@ -3749,6 +4166,66 @@ int msrp_recv_cmd(const char *buf, int buflen, struct sockaddr_in *client)
 		rc = msrp_cmd_join_or_new_stream(&talker_param, attrib_type, mrp_event);
 		if (rc)
 			goto out_ERI;	/* oops - internal error */
+	} else if (strncmp(buf, "S+F", 3) == 0) {
+		/* buf[] should look similar to 'S+F:S=xxyyzz...' or 'S+F:T=1' */
+		struct msrp_client_filter *filter;
+		uint8_t stream_id[8];
+		uint8_t type;
+		struct parse_param type_specs[] = {
+			{"T" PARSE_ASSIGN, parse_u8, &type},
+			{0, parse_null, 0}
+		};
+
+		if ((buflen > MSRP_CLIENT_CMDSTR_HEADER_LEN) &&
+		    ('T' == buf[MSRP_CLIENT_CMDSTR_HEADER_LEN])) {
+			rc = parse(buf + MSRP_CLIENT_CMDSTR_HEADER_LEN,
+				   buflen - MSRP_CLIENT_CMDSTR_HEADER_LEN,
+				   type_specs, &err_index);
+			if (rc || (type < MSRP_TALKER_ADV_TYPE) ||
+			    (type > MSRP_DOMAIN_TYPE))
+				goto out_ERP;
+			filter = msrp_client_filter_get(client);
+			if (NULL == filter)
+				goto out_ERI;
+			filter->type_mask |= (1 << type);
+		} else {
+			rc = msrp_cmd_parse_stream_id(buf, buflen, stream_id,
+						      &err_index);
+			if (rc)
+				goto out_ERP;
+			filter = msrp_client_filter_get(client);
+			if (NULL == filter)
+				goto out_ERI;
+			if (!eui64set_find(&filter->stream_ids,
+					   eui64_read(stream_id)) &&
+			    (eui64set_insert_and_sort(&filter->stream_ids,
+						      eui64_read(stream_id),
+						      0) == 0))
+				goto out_ERI;
+		}
+	} else if (strncmp(buf, "S-F", 3) == 0) {
+		struct msrp_client_filter *filter;
+
+		filter = msrp_client_filter_find(client);
+		if (NULL != filter) {
+			filter->type_mask = 0;
+			eui64set_clear(&filter->stream_ids);
+		}
+	} else if (strncmp(buf, "S+C", 3) == 0) {
+		struct msrp_client_filter *filter;
+
+		filter = msrp_client_filter_get(client);
+		if (NULL == filter)
+			goto out_ERI;
+		filter->coalesce = 1;
+	} else if (strncmp(buf, "S-C", 3) == 0) {
+		struct msrp_client_filter *filter;
+
+		filter = msrp_client_filter_find(client);
+		if (NULL != filter) {
+			msrp_client_filter_flush(filter);
+			filter->coalesce = 0;
+		}
 	} else if (strncmp(buf, "I+S", 3 ) == 0 ) {
 		/* Add a stream id to the interesting stream id list */
 		uint8_t stream_id[8];
@@ -3790,12 +4267,7 @@ int msrp_recv_cmd(const char *buf, int buflen, struct sockaddr_in *client)
 				if (((free_sattrib->type == MSRP_TALKER_ADV_TYPE) ||
 					 (free_sattrib->type == MSRP_TALKER_FAILED_TYPE)) &&
 					 (memcmp(free_sattrib->attribute.talk_listen.StreamID, stream_id, sizeof(stream_id)) == 0)) {
-						if (NULL != free_sattrib->prev)
-							free_sattrib->prev->next = free_sattrib->next;
-						else
-							MSRP_db->attrib_list = free_sattrib->next;
-						if (NULL != free_sattrib->next)
-							free_sattrib->next->prev = free_sattrib->prev;
+						msrp_unlink(free_sattrib);
 						/* delete attribute */
 						free(free_sattrib);
 				}
@@ -3907,6 +4379,8 @@ void msrp_reset(void)
 		free(free_sattrib);
    	}
 	eui64set_free(&MSRP_db->interesting_stream_ids);
+	while (NULL != MSRP_db->client_filters)
+		msrp_client_filter_delete(&MSRP_db->client_filters->client);
 	mrp_client_remove_all(&MSRP_db->mrp_db.clients);
 	free(MSRP_db);
 }
@@ -3921,8 +4395,10 @@ int msrp_interesting_id_count(void)
 
 void msrp_bye(struct sockaddr_in *client)
 {
-	if (NULL != MSRP_db)
+	if (NULL != MSRP_db) {
 		mrp_client_delete(&(MSRP_db->mrp_db.clients), client);
+		msrp_client_filter_delete(client);
+	}
 }
 
 static struct msrp_attribute *msrp_conditional_reclaim(struct msrp_attribute *sattrib)
@@ -3933,12 +4409,7 @@ static struct msrp_attribute *msrp_conditional_reclaim(struct msrp_attribute *sa
 	    ((sattrib->applicant.mrp_state == MRP_VO_STATE) ||
 	     (sattrib->applicant.mrp_state == MRP_AO_STATE) ||
 	     (sattrib->applicant.mrp_state == MRP_QO_STATE))) {
-		if (NULL != sattrib->prev)
-			sattrib->prev->next = sattrib->next;
-		else
-			MSRP_db->attrib_list = sattrib->next;
-		if (NULL != sattrib->next)
-			sattrib->next->prev = sattrib->prev;
+		msrp_unlink(sattrib);
 		free_sattrib = sattrib;
 		sattrib = sattrib->next;
 #if LOG_MSRP_GARBAGE_COLLECTION
@@ -148,9 +148,47 @@ typedef struct msrpdu_domain {
 #define MSRP_OPERATION_REGISTER 0   /* from network */
 #define MSRP_OPERATION_DECLARE  1   /* from local client application */
 
+/*
+ * Binary table snapshot, the answer to 'S?G:G=<generation>'.
+ *
+ * Every change to the table (an attribute added, changed or removed)
+ * takes the next generation number. A client passes the generation of
+ * the last snapshot it applied and gets only the records changed since,
+ * in one or more datagrams of
+ *
+ * header: magic(1) version(1) flags(2) count(2) index(2)
+ *         generation(8) since(8)
+ * record: op(1) type(1) applicant state(1) registrar state(1)
+ *         substate(1) pad(3) generation(8) registrar mac(6) pad(2)
+ *         value(40)
+ *
+ * value for talkers and listeners:
+ *         StreamID(8) Dest_Addr(6) Vlan_ID(2) MaxFrameSize(2)
+ *         MaxIntervalFrames(2) PriorityAndRank(1) pad(3)
+ *         AccumulatedLatency(4) BridgeID(8) FailureCode(1) pad(3)
+ * value for domains:
+ *         SRclassID(1) SRclassPriority(1) neighborSRclassPriority(1)
+ *         pad(1) SRclassVID(2) pad(34)
+ *
+ * Multi-byte fields are in network byte order. A remove record only
+ * carries the type and the StreamID or SRclassID, and may name an
+ * attribute the client never saw. Generation 0, or one the daemon no
+ * longer has removals for, gets the whole table with MSRP_SNAP_FULL set.
+ */
+#define MSRP_SNAP_MAGIC		0xA6
+#define MSRP_SNAP_VERSION	1
+#define MSRP_SNAP_HDR_SZ	24
+#define MSRP_SNAP_REC_SZ	64
+#define MSRP_SNAP_FULL		0x0001	/* replace the local copy */
+#define MSRP_SNAP_MORE		0x0002	/* more datagrams follow */
+#define MSRP_SNAP_OP_UPDATE	1
+#define MSRP_SNAP_OP_REMOVE	2
+#define MSRP_SNAP_TOMBSTONES	64	/* removals kept for incremental reads */
+
 struct msrp_attribute {
 	struct msrp_attribute *prev;
 	struct msrp_attribute *next;
+	struct msrp_attribute *hnext;	/* attrib_hash bucket chain */
 	uint32_t type;
 	union {
 		msrpdu_talker_fail_t talk_listen;
@@ -160,14 +198,55 @@ struct msrp_attribute {
 	uint32_t operation;	/* DECLARE or REGISTER */
 	mrp_applicant_attribute_t applicant;
 	mrp_registrar_attribute_t registrar;
+	int run_state;		/* MSRP_RUN_xxx, cached vectorization with next */
+	uint64_t snap_generation;	/* of the last change seen in snap */
+	uint8_t snap[MSRP_SNAP_REC_SZ];	/* record as last snapshotted */
+};
+
+/*
+ * Whether attrib->next carries the value that follows attrib, so both
+ * can go into one vector. Cleared when either attribute changes or the
+ * list is relinked around them, and worked out again on the next PDU.
+ */
+#define MSRP_RUN_UNKNOWN	0
+#define MSRP_RUN_BREAK		1
+#define MSRP_RUN_CONTINUES	2
+
+/*
+ * attrib_list stays sorted by type and StreamID for PDU vectorization;
+ * attrib_hash indexes the same attributes by (type, StreamID) so that
+ * lookups don't have to walk the list.
+ */
+#define MSRP_ATTRIB_HASH_SIZE	1024	/* power of 2 */
+
+/*
+ * Notification settings of one client, created by its first S+F or S+C.
+ * Clients without one get every notification in its own datagram.
+ */
+#define MSRP_CLIENT_FILTER_STREAMS	64
+
+struct msrp_client_filter {
+	struct msrp_client_filter *next;
+	struct sockaddr_in client;
+	uint32_t type_mask;		/* 1 << MSRP_xxx_TYPE, 0 for all types */
+	struct eui64set stream_ids;	/* empty for all streams */
+	int coalesce;			/* hold lines for msrp_flush_notifications() */
+	int pending_len;
+	char pending[MAX_MRPD_CMDSZ];
 };
 
 struct msrp_database {
 	struct mrp_database mrp_db;
 	struct msrp_attribute *attrib_list;
+	struct msrp_attribute *attrib_hash[MSRP_ATTRIB_HASH_SIZE];
 	int send_empty_LeaveAll_flag;
 	struct eui64set interesting_stream_ids;
 	int enable_pruning_of_uninteresting_ids;
+	struct msrp_client_filter *client_filters;
+	uint64_t snap_generation;
+	uint64_t snap_floor;	/* older removals were overwritten */
+	int snap_tombstone_next;
+	uint8_t snap_tombstones[MSRP_SNAP_TOMBSTONES][MSRP_SNAP_REC_SZ];
 };
 
 int msrp_init(int msrp_enable, int max_interesting_stream_ids, int enable_pruning);
@@ -177,7 +256,9 @@ int msrp_recv_cmd(const char *buf, int buflen, struct sockaddr_in *client);
 int msrp_send_notifications(struct msrp_attribute *attrib, int notify);
 int msrp_reclaim(void);
 void msrp_bye(struct sockaddr_in *client);
+void msrp_flush_notifications(void);
 int msrp_recv_msg(void);
+int msrp_snapshot(struct sockaddr_in *client, uint64_t since);
 
 /**
  * Count attributes by type in the MSRP database.
@@ -45,7 +45,7 @@
 #include "parse.h"
 
 int mvrp_send_notifications(struct mvrp_attribute *attrib, int notify);
-static struct mvrp_attribute *mvrp_conditional_reclaim(struct mvrp_attribute *sattrib);
+static int mvrp_conditional_reclaim(struct mvrp_attribute *vattrib);
 int mvrp_txpdu(void);
 
 unsigned char MVRP_CUSTOMER_BRIDGE_ADDR[] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x21 };	/* 81-00 */
@@ -71,71 +71,68 @@ void mvrp_print_debug_info(int evt, const struct mvrp_attribute *attrib)
 }
 #endif
 
-struct mvrp_attribute *mvrp_lookup(struct mvrp_attribute *rattrib)
+static int mvrp_vid_in_use(uint16_t vid)
 {
-	struct mvrp_attribute *attrib;
+	return (MVRP_db->vid_map[vid / MVRP_VID_WORD_BITS] >>
+		(vid % MVRP_VID_WORD_BITS)) & 1;
+}
 
-	attrib = MVRP_db->attrib_list;
-	while (NULL != attrib) {
-		if (attrib->attribute == rattrib->attribute)
-			return attrib;
-		attrib = attrib->next;
+static int mvrp_lowest_bit(uint32_t word)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(word);
+#else
+	int bit = 0;
+
+	while (0 == (word & 1)) {
+		word >>= 1;
+		bit++;
 	}
-	return NULL;
+	return bit;
+#endif
 }
 
-int mvrp_add(struct mvrp_attribute *rattrib)
+/* returns the first VID >= vid that is in use, or -1 if there is none */
+int mvrp_next_vid(int vid)
 {
-	struct mvrp_attribute *attrib;
-	struct mvrp_attribute *attrib_tail;
-
-	/* XXX do a lookup first to guarantee uniqueness? */
+	int word_idx;
+	uint32_t word;
 
-	attrib_tail = attrib = MVRP_db->attrib_list;
-
-	while (NULL != attrib) {
-		if (attrib->attribute < rattrib->attribute) {
-			/* possible tail insertion ... */
-			if (NULL != attrib->next) {
-				attrib = attrib->next;
-				continue;
-			}
-			rattrib->next = attrib->next;
-			rattrib->prev = attrib;
-			attrib->next = rattrib;
-			return 0;
+	if ((vid < 0) || (vid >= MVRP_VID_COUNT))
+		return -1;
 
-		} else {
-			/* head insertion ... */
-			rattrib->next = attrib;
-			rattrib->prev = attrib->prev;
-			attrib->prev = rattrib;
-			if (NULL != rattrib->prev)
-				rattrib->prev->next = rattrib;
-			else
-				MVRP_db->attrib_list = rattrib;
+	word_idx = vid / MVRP_VID_WORD_BITS;
+	word = MVRP_db->vid_map[word_idx] &
+	    (0xFFFFFFFFu << (vid % MVRP_VID_WORD_BITS));
 
-			return 0;
-		}
-		attrib_tail = attrib;
-		attrib = attrib->next;
+	while (0 == word) {
+		if (++word_idx >= MVRP_VID_WORDS)
+			return -1;
+		word = MVRP_db->vid_map[word_idx];
 	}
+	return word_idx * MVRP_VID_WORD_BITS + mvrp_lowest_bit(word);
+}
 
-	/* if we are here we didn't need to stitch in a a sorted entry
-	 * so append it onto the tail (if it exists)
-	 */
+struct mvrp_attribute *mvrp_lookup(struct mvrp_attribute *rattrib)
+{
+	if ((rattrib->attribute >= MVRP_VID_COUNT) ||
+	    !mvrp_vid_in_use(rattrib->attribute))
+		return NULL;
+	return &MVRP_db->vids[rattrib->attribute];
+}
 
-	if (NULL == attrib_tail) {
-		rattrib->next = NULL;
-		rattrib->prev = NULL;
-		MVRP_db->attrib_list = rattrib;
-	} else {
-		rattrib->next = NULL;
-		rattrib->prev = attrib_tail;
-		attrib_tail->next = rattrib;
-	}
+/* copies rattrib into its VID slot; the caller still owns rattrib */
+struct mvrp_attribute *mvrp_add(struct mvrp_attribute *rattrib)
+{
+	uint16_t vid = rattrib->attribute;
 
-	return 0;
+	if (vid >= MVRP_VID_COUNT)
+		return NULL;
+
+	MVRP_db->vids[vid] = *rattrib;
+	MVRP_db->vid_map[vid / MVRP_VID_WORD_BITS] |=
+	    (uint32_t)1 << (vid % MVRP_VID_WORD_BITS);
+	return &MVRP_db->vids[vid];
 }
 
 int mvrp_merge(struct mvrp_attribute *rattrib)
@@ -157,6 +154,7 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 	struct mvrp_attribute *attrib;
 	int count = 0;
 	int rc;
+	int vid;
 
 #if LOG_MVRP
 	mrpd_log_printf("MVRP event %s\n", mrp_event_string(event));
@@ -167,9 +165,8 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 		mrp_lvatimer_stop(&(MVRP_db->mrp_db));
 		mrp_jointimer_stop(&(MVRP_db->mrp_db));
 		/* update state */
-		attrib = MVRP_db->attrib_list;
-
-		while (NULL != attrib) {
+		for (vid = mvrp_next_vid(0); vid >= 0; vid = mvrp_next_vid(vid + 1)) {
+			attrib = &MVRP_db->vids[vid];
 			mrp_applicant_fsm(&(MVRP_db->mrp_db),
 					  &(attrib->applicant), MRP_EVENT_TXLA,
 					  mrp_registrar_in(&(attrib->registrar)));
@@ -178,7 +175,6 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 #if LOG_MVRP
 			mvrp_print_debug_info(event, attrib);
 #endif
-			attrib = attrib->next;
 		}
 
 		mrp_lvatimer_fsm(&(MVRP_db->mrp_db), MRP_EVENT_LVATIMER);
@@ -191,9 +187,8 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 	case MRP_EVENT_RLA:
 		mrp_jointimer_start(&(MVRP_db->mrp_db));
 		/* update state */
-		attrib = MVRP_db->attrib_list;
-
-		while (NULL != attrib) {
+		for (vid = mvrp_next_vid(0); vid >= 0; vid = mvrp_next_vid(vid + 1)) {
+			attrib = &MVRP_db->vids[vid];
 			mrp_applicant_fsm(&(MVRP_db->mrp_db),
 					  &(attrib->applicant), MRP_EVENT_RLA,
 					  mrp_registrar_in(&(attrib->registrar)));
@@ -202,7 +197,6 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 #if LOG_MVRP
 			mvrp_print_debug_info(event, attrib);
 #endif
-			attrib = attrib->next;
 		}
 
 		mrp_lvatimer_fsm(&(MVRP_db->mrp_db), MRP_EVENT_RLA);
@@ -210,9 +204,8 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 		break;
 	case MRP_EVENT_TX:
 		mrp_jointimer_stop(&(MVRP_db->mrp_db));
-		attrib = MVRP_db->attrib_list;
-
-		while (NULL != attrib) {
+		for (vid = mvrp_next_vid(0); vid >= 0; vid = mvrp_next_vid(vid + 1)) {
+			attrib = &MVRP_db->vids[vid];
 			mrp_applicant_fsm(&(MVRP_db->mrp_db),
 					  &(attrib->applicant), MRP_EVENT_TX,
 					  mrp_registrar_in(&(attrib->registrar)));
@@ -220,7 +213,6 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 			mvrp_print_debug_info(event, attrib);
 #endif
 			count += mrp_applicant_state_transition_implies_tx(&(attrib->applicant));
-			attrib = attrib->next;
 		}
 
 		mvrp_txpdu();
@@ -235,9 +227,8 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 		break;
 	case MRP_EVENT_LVTIMER:
 		mrp_lvtimer_stop(&(MVRP_db->mrp_db));
-		attrib = MVRP_db->attrib_list;
-
-		while (NULL != attrib) {
+		for (vid = mvrp_next_vid(0); vid >= 0; vid = mvrp_next_vid(vid + 1)) {
+			attrib = &MVRP_db->vids[vid];
 			mrp_registrar_fsm(&(attrib->registrar),
 					  &(MVRP_db->mrp_db),
 					  MRP_EVENT_LVTIMER);
@@ -245,17 +236,18 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 #if LOG_MVRP
 			mvrp_print_debug_info(event, attrib);
 #endif
-			attrib = mvrp_conditional_reclaim(attrib);
+			mvrp_conditional_reclaim(attrib);
 		}
 		break;
 	case MRP_EVENT_PERIODIC:
-		attrib = MVRP_db->attrib_list;
+		vid = mvrp_next_vid(0);
 
-		if (NULL != attrib) {
+		if (vid >= 0) {
 			mrp_jointimer_start(&(MVRP_db->mrp_db));
 		}
 
-		while (NULL != attrib) {
+		for (; vid >= 0; vid = mvrp_next_vid(vid + 1)) {
+			attrib = &MVRP_db->vids[vid];
 			mrp_applicant_fsm(&(MVRP_db->mrp_db),
 					  &(attrib->applicant),
 					  MRP_EVENT_PERIODIC,
@@ -263,7 +255,6 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 #if LOG_MVRP
 			mvrp_print_debug_info(event, attrib);
 #endif
-			attrib = attrib->next;
 		}
 		break;
 	case MRP_EVENT_NEW:
@@ -288,8 +279,10 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 				free(rattrib);
 				return 0;
 			}
-			mvrp_add(rattrib);
-			attrib = rattrib;
+			attrib = mvrp_add(rattrib);
+			free(rattrib);
+			if (NULL == attrib)
+				return -1;	/* VID out of range */
 		} else {
 			mvrp_merge(rattrib);
 			free(rattrib);
@@ -329,10 +322,10 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 			}
 			break;
 		}
-		attrib = mvrp_conditional_reclaim(attrib);
 #if LOG_MVRP
 		mvrp_print_debug_info(event, attrib);
 #endif
+		mvrp_conditional_reclaim(attrib);
 		break;
 	default:
 		break;
@@ -344,15 +337,13 @@ int mvrp_event(int event, struct mvrp_attribute *rattrib)
 	 */
 
 	/* generate local notifications */
-	attrib = MVRP_db->attrib_list;
-
-	while (NULL != attrib) {
+	for (vid = mvrp_next_vid(0); vid >= 0; vid = mvrp_next_vid(vid + 1)) {
+		attrib = &MVRP_db->vids[vid];
 		if (MRP_NOTIFY_NONE != attrib->registrar.notify) {
 			mvrp_send_notifications(attrib,
 						attrib->registrar.notify);
 			attrib->registrar.notify = MRP_NOTIFY_NONE;
 		}
-		attrib = attrib->next;
 	}
 
 	return 0;
@@ -652,7 +643,7 @@ mvrp_emit_vidvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 	int vectidx;
 	unsigned int vectevt[3];
 	int vectevt_idx;
-	uint16_t vid_firstval;
+	int vid, vnext;
 	struct mvrp_attribute *attrib, *vattrib;
 	mrpdu_message_t *mrpdu_msg;
 	unsigned int attrib_found_flag = 0;
@@ -669,25 +660,25 @@ mvrp_emit_vidvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 	mrpdu_msg->AttributeType = MVRP_VID_TYPE;
 	mrpdu_msg->AttributeLength = 2;
 
-	attrib = MVRP_db->attrib_list;
+	vid = mvrp_next_vid(0);
 
 	mrpdu_vectorptr = (mrpdu_vectorattrib_t *) mrpdu_msg->Data;
 
-	while ((mrpdu_msg_ptr < (mrpdu_msg_eof - vector_size - MRPDU_ENDMARK_SZ)) && (NULL != attrib)) {
+	while ((mrpdu_msg_ptr < (mrpdu_msg_eof - vector_size - MRPDU_ENDMARK_SZ)) && (vid >= 0)) {
+		attrib = &MVRP_db->vids[vid];
 
 		if (0 == attrib->applicant.tx) {
-			attrib = attrib->next;
+			vid = mvrp_next_vid(vid + 1);
 			continue;
 		}
 		attrib->applicant.tx = 0;
 		if (MRP_ENCODE_OPTIONAL == attrib->applicant.encode) {
-			attrib = attrib->next;
+			vid = mvrp_next_vid(vid + 1);
 			continue;
 		}
 
 		attrib_found_flag = 1;
 		/* pointing to at least one attribute which needs to be transmitted */
-		vid_firstval = attrib->attribute;
 		mrpdu_vectorptr->FirstValue_VectorEvents[0] =
 		    (uint8_t) (attrib->attribute >> 8);
 		mrpdu_vectorptr->FirstValue_VectorEvents[1] =
@@ -744,15 +735,12 @@ mvrp_emit_vidvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 		 */
 
 		vectidx = 2;
-		vattrib = attrib->next;
 
-		while (NULL != vattrib) {
-			if (0 == vattrib->applicant.tx)
-				break;
+		for (vnext = vid + 1; (vnext < MVRP_VID_COUNT) &&
+		     mvrp_vid_in_use(vnext); vnext++) {
+			vattrib = &MVRP_db->vids[vnext];
 
-			vid_firstval++;
-
-			if (vattrib->attribute != vid_firstval)
+			if (0 == vattrib->applicant.tx)
 				break;
 
 			vattrib->applicant.tx = 0;
@@ -814,8 +802,6 @@ mvrp_emit_vidvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 			if (&(mrpdu_vectorptr->FirstValue_VectorEvents[vectidx])
 			    > (mrpdu_msg_eof - MRPDU_ENDMARK_SZ))
 				goto oops;
-
-			vattrib = vattrib->next;
 		}
 
 		/* handle any trailers */
@@ -846,7 +832,7 @@ mvrp_emit_vidvectors(unsigned char *msgbuf, unsigned char *msgbuf_eof,
 		mrpdu_msg_ptr =
 		    &(mrpdu_vectorptr->FirstValue_VectorEvents[vectidx]);
 
-		attrib = attrib->next;
+		vid = mvrp_next_vid(vid + 1);
 
 		mrpdu_vectorptr = (mrpdu_vectorattrib_t *) mrpdu_msg_ptr;
 	}
@@ -1066,6 +1052,8 @@ int mvrp_send_notifications(struct mvrp_attribute *attrib, int notify)
 		client = client->next;
 	}
 
+	mrpd_map_changed(MRPD_APP_MVRP, notify, attrib);
+
  free_msgbuf:
 	if (regsrc)
 		free(regsrc);
@@ -1084,6 +1072,7 @@ int mvrp_dumptable(struct sockaddr_in *client)
 	char *regsrc;
 	struct mvrp_attribute *attrib;
 	char mrp_state[8];
+	int vid;
 
 	msgbuf = (char *)malloc(MAX_MRPD_CMDSZ);
 	if (NULL == msgbuf)
@@ -1102,12 +1091,13 @@ int mvrp_dumptable(struct sockaddr_in *client)
 
 	msgbuf_wrptr = msgbuf;
 
-	attrib = MVRP_db->attrib_list;
-	if (attrib == NULL) {
+	vid = mvrp_next_vid(0);
+	if (vid < 0) {
 		sprintf(msgbuf, "MVRP:Empty\n");
 	}
 
-	while (NULL != attrib) {
+	for (; vid >= 0; vid = mvrp_next_vid(vid + 1)) {
+		attrib = &MVRP_db->vids[vid];
 		sprintf(variant, "V:I=%04x", attrib->attribute);
 
 		mrp_decode_state(&attrib->registrar, &attrib->applicant,
@@ -1124,7 +1114,6 @@ int mvrp_dumptable(struct sockaddr_in *client)
 		sprintf(stage, "%s %s\n", variant, regsrc);
 		sprintf(msgbuf_wrptr, "%s", stage);
 		msgbuf_wrptr += strnlen(stage, 128);
-		attrib = attrib->next;
 	}
 
 	mrpd_send_ctl_msg(client, msgbuf, MAX_MRPD_CMDSZ);
@@ -1160,6 +1149,9 @@ int mvrp_cmd_vid(uint16_t attribute, int mrp_event)
 {
 	struct mvrp_attribute *attrib;
 
+	if (attribute >= MVRP_VID_COUNT)
+		return -1;
+
 	attrib = mvrp_alloc();
 	if (NULL == attrib)
 		return -1;
@@ -1168,6 +1160,55 @@ int mvrp_cmd_vid(uint16_t attribute, int mrp_event)
 	return 0;
 }
 
+/*
+ * Runs only the applicant for a VID, so the registrar keeps reflecting
+ * what the peer on this port declared. Bridge mode uses this to declare
+ * a VID registered on another port (MAD_Join.request / MAD_Leave.request).
+ */
+int mvrp_declare(uint16_t vid, int mrp_event)
+{
+	struct mvrp_attribute *attrib;
+	struct mvrp_attribute *rattrib;
+	struct mvrp_attribute key;
+
+	if ((NULL == MVRP_db) || (vid >= MVRP_VID_COUNT))
+		return -1;
+
+	key.attribute = vid;
+	attrib = mvrp_lookup(&key);
+	if (NULL == attrib) {
+		/* nothing declared, nothing to withdraw */
+		if (MRP_EVENT_LV == mrp_event)
+			return 0;
+		rattrib = mvrp_alloc();
+		if (NULL == rattrib)
+			return -1;
+		rattrib->attribute = vid;
+		attrib = mvrp_add(rattrib);
+		free(rattrib);
+	}
+
+	mrp_jointimer_start(&(MVRP_db->mrp_db));
+	mrp_applicant_fsm(&(MVRP_db->mrp_db), &(attrib->applicant), mrp_event,
+			  mrp_registrar_in(&(attrib->registrar)));
+	return 0;
+}
+
+/* returns 1 if the peer on this port has the VID registered */
+int mvrp_registered(uint16_t vid)
+{
+	struct mvrp_attribute key;
+	struct mvrp_attribute *attrib;
+
+	if ((NULL == MVRP_db) || (vid >= MVRP_VID_COUNT))
+		return 0;
+
+	key.attribute = vid;
+	attrib = mvrp_lookup(&key);
+	return (NULL != attrib) &&
+	    (MRP_MT_STATE != attrib->registrar.mrp_state);
+}
+
 int mvrp_recv_cmd(char *buf, int buflen, struct sockaddr_in *client)
 {
 	int rc;
@@ -1296,64 +1337,44 @@ int mvrp_init(int mvrp_enable)
 	return -1;
 }
 
-static struct mvrp_attribute *mvrp_conditional_reclaim(struct mvrp_attribute *vattrib)
+/* returns 1 if the attribute was released */
+static int mvrp_conditional_reclaim(struct mvrp_attribute *vattrib)
 {
-	struct mvrp_attribute *free_vattrib;
+	uint16_t vid = vattrib->attribute;
 
 	if ((vattrib->registrar.mrp_state == MRP_MT_STATE) &&
 	    ((vattrib->applicant.mrp_state == MRP_VO_STATE) ||
 	     (vattrib->applicant.mrp_state == MRP_AO_STATE) ||
 	     (vattrib->applicant.mrp_state == MRP_QO_STATE))) {
-		if (NULL != vattrib->prev)
-			vattrib->prev->next = vattrib->next;
-		else
-			MVRP_db->attrib_list = vattrib->next;
-		if (NULL != vattrib->next)
-			vattrib->next->prev = vattrib->prev;
-		free_vattrib = vattrib;
-		vattrib = vattrib->next;
 #if LOG_MVRP_GARBAGE_COLLECTION
-		mrpd_log_printf("MVRP -------------> free attrib of type (%d), current 0x%p, next 0x%p\n",
-				free_vattrib->attribute,
-				free_vattrib, vattrib);
+		mrpd_log_printf("MVRP -------------> free attrib of type (%d)\n",
+				vid);
 #endif
-		mvrp_send_notifications(free_vattrib, MRP_NOTIFY_LV);
-		free(free_vattrib);
-		return vattrib;
-	} else {
-		return vattrib->next;
+		mvrp_send_notifications(vattrib, MRP_NOTIFY_LV);
+		MVRP_db->vid_map[vid / MVRP_VID_WORD_BITS] &=
+		    ~((uint32_t)1 << (vid % MVRP_VID_WORD_BITS));
+		return 1;
 	}
-
+	return 0;
 }
 
 int mvrp_reclaim(void)
 {
-	struct mvrp_attribute *vattrib;
+	int vid;
+
 	if (NULL == MVRP_db)
 		return 0;
 
-	vattrib = MVRP_db->attrib_list;
-	while (NULL != vattrib) {
-		vattrib = mvrp_conditional_reclaim(vattrib);
-
-	}
+	for (vid = mvrp_next_vid(0); vid >= 0; vid = mvrp_next_vid(vid + 1))
+		mvrp_conditional_reclaim(&MVRP_db->vids[vid]);
 	return 0;
 }
 
 void mvrp_reset(void)
 {
-	struct mvrp_attribute *free_sattrib;
-	struct mvrp_attribute *sattrib;
-
 	if (NULL == MVRP_db)
 		return;
 
-	sattrib = MVRP_db->attrib_list;
-	while (NULL != sattrib) {
-		free_sattrib = sattrib;
-		sattrib = sattrib->next;
-		free(free_sattrib);
-	}
 	mrp_client_remove_all(&MVRP_db->mrp_db.clients);
 	free(MVRP_db);
 }
@@ -32,16 +32,24 @@
 ******************************************************************************/
 
 struct mvrp_attribute {
-	struct mvrp_attribute *prev;
-	struct mvrp_attribute *next;
 	uint16_t attribute;	/* 12-bit VID */
 	mrp_applicant_attribute_t applicant;
 	mrp_registrar_attribute_t registrar;
 };
 
+#define MVRP_VID_COUNT		4096	/* 12-bit VID space */
+#define MVRP_VID_WORD_BITS	32
+#define MVRP_VID_WORDS		(MVRP_VID_COUNT / MVRP_VID_WORD_BITS)
+
+/*
+ * VLAN registry indexed by VID. A set bit in vid_map marks the matching
+ * vids[] entry as in use, so lookups are direct and walks skip 32 unused
+ * VIDs per bitmap word.
+ */
 struct mvrp_database {
         struct mrp_database mrp_db;
-        struct mvrp_attribute *attrib_list;
+        uint32_t vid_map[MVRP_VID_WORDS];
+        struct mvrp_attribute vids[MVRP_VID_COUNT];
         int send_empty_LeaveAll_flag;
 };
 
@@ -61,6 +69,9 @@ void mvrp_reset(void);
 int mvrp_event(int event, struct mvrp_attribute *rattrib);
 int mvrp_recv_cmd(char *buf, int buflen, struct sockaddr_in *client);
 struct mvrp_attribute *mvrp_lookup(struct mvrp_attribute *rattrib);
+int mvrp_next_vid(int vid);
 int mvrp_reclaim(void);
 void mvrp_bye(struct sockaddr_in *client);
 int mvrp_recv_msg(void);
+int mvrp_declare(uint16_t vid, int mrp_event);
+int mvrp_registered(uint16_t vid);
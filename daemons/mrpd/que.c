@@ -40,55 +40,112 @@
 struct que_def *que_new(int entry_count, int entry_size)
 {
 	struct que_def *q;
+	int count = 1;
+
+	/* indexes run freely and are masked, which needs a power of 2 */
+	while (count < entry_count)
+		count <<= 1;
 
 	q = (struct que_def *)calloc(1, sizeof(struct que_def));
 	if (!q)
 		return q;
-	q->buffer = (uint8_t *) calloc(entry_count, entry_size);
+	q->buffer = (uint8_t *) calloc(count, entry_size);
 	if (!q->buffer) {
 		free(q);
 		return NULL;
 	}
-	q->entry_count = entry_count;
+	q->entry_count = count;
 	q->entry_size = entry_size;
-	q->space_avail =
-	    CreateSemaphore(NULL, q->entry_count, q->entry_count, NULL);
-	q->data_avail = CreateSemaphore(NULL, 0, q->entry_count, NULL);
-	InitializeCriticalSection(&q->mutex);
+	q->data_avail = CreateEvent(NULL, FALSE, FALSE, NULL);
 
 	return q;
 }
 
 void que_delete(struct que_def *q)
 {
+	if (q->data_avail)
+		CloseHandle(q->data_avail);
 	if (q->buffer)
 		free(q->buffer);
 	free(q);
 }
 
-void que_push(struct que_def *q, void *d)
+int que_push(struct que_def *q, void *d)
 {
-	WaitForSingleObject(q->space_avail, INFINITE);
-	EnterCriticalSection(&q->mutex);
-	memcpy(&q->buffer[q->in_pos * q->entry_size], d, q->entry_size);
-	q->in_pos = (q->in_pos + 1) % q->entry_count;
-	LeaveCriticalSection(&q->mutex);
-	ReleaseSemaphore(q->data_avail, 1, NULL);
+	LONG in = q->in_pos;
+	LONG used = in - q->out_pos;
+
+	if (used >= q->entry_count) {
+		q->overflows++;
+		return -1;
+	}
+
+	memcpy(&q->buffer[(in & (q->entry_count - 1)) * q->entry_size], d,
+	       q->entry_size);
+	/* the entry must be visible before the index that hands it over */
+	MemoryBarrier();
+	q->in_pos = in + 1;
+	q->pushed++;
+	if ((uint32_t)used + 1 > q->high_water)
+		q->high_water = used + 1;
+
+	/*
+	 * Only the push into an empty queue wakes the consumer. The barrier
+	 * pairs with the one in que_pop_batch: either this sees the consumer
+	 * drained the queue, or the consumer sees this entry.
+	 */
+	MemoryBarrier();
+	if (in == q->out_pos)
+		SetEvent(q->data_avail);
+	return 0;
 }
 
-void que_pop_nowait(struct que_def *q, void *d)
+/* pops up to max entries into the array at d, returns how many */
+int que_pop_batch(struct que_def *q, void *d, int max)
 {
-	EnterCriticalSection(&q->mutex);
-	memcpy(d, &q->buffer[q->out_pos * q->entry_size], q->entry_size);
-	q->out_pos = (q->out_pos + 1) % q->entry_count;
-	LeaveCriticalSection(&q->mutex);
-	ReleaseSemaphore(q->space_avail, 1, NULL);
+	LONG out = q->out_pos;
+	LONG avail = q->in_pos - out;
+	int n;
+
+	if (avail > max)
+		avail = max;
+	/* the entries are read only after the index that published them */
+	MemoryBarrier();
+
+	for (n = 0; n < avail; n++) {
+		memcpy((uint8_t *)d + n * q->entry_size,
+		       &q->buffer[((out + n) & (q->entry_count - 1)) *
+				  q->entry_size], q->entry_size);
+	}
+	MemoryBarrier();
+	q->out_pos = out + n;
+	q->popped += n;
+
+	/* what a batch leaves behind won't get an event from que_push */
+	MemoryBarrier();
+	if (q->in_pos != q->out_pos)
+		SetEvent(q->data_avail);
+	return n;
+}
+
+int que_pop_nowait(struct que_def *q, void *d)
+{
+	return que_pop_batch(q, d, 1);
 }
 
 void que_pop_wait(struct que_def *q, void *d)
 {
-	WaitForSingleObject(q->data_avail, INFINITE);
-	que_pop_nowait(q, d);
+	while (!que_pop_batch(q, d, 1))
+		WaitForSingleObject(q->data_avail, INFINITE);
+}
+
+/* a snapshot, each counter is read without stopping its writer */
+void que_get_stats(struct que_def *q, struct que_stats *stats)
+{
+	stats->pushed = q->pushed;
+	stats->popped = q->popped;
+	stats->overflows = q->overflows;
+	stats->high_water = q->high_water;
 }
 
 HANDLE que_data_available_object(struct que_def *q)
@@ -33,6 +33,11 @@
 
 /*
  * Windwos specific - queue messages in a thread safe way between threads.
+ *
+ * Single producer, single consumer: one thread pushes, one pops. Entries
+ * are copied into a ring and handed over by publishing the ring indexes,
+ * so neither side takes a lock. A full queue drops the entry and counts
+ * it instead of blocking the producer.
  */
 
 #ifndef _QUE_H_
@@ -45,23 +50,41 @@
 extern "C" {
 #endif
 
+#define QUE_CACHE_LINE	64
+
+	struct que_stats {
+		uint32_t pushed;
+		uint32_t popped;
+		uint32_t overflows;	// entries dropped on a full queue
+		uint32_t high_water;	// most entries queued at once
+	};
+
 	struct que_def {
-		HANDLE space_avail;	// at least one slot empty
-		HANDLE data_avail;	// at least one slot full
-		CRITICAL_SECTION mutex;	// protect buffer, in_pos, out_pos
+		// written by the producer only
+		volatile LONG in_pos;
+		uint32_t pushed;
+		uint32_t overflows;
+		uint32_t high_water;
+		uint8_t pad_in[QUE_CACHE_LINE - 4 * sizeof(uint32_t)];
+
+		// written by the consumer only
+		volatile LONG out_pos;
+		uint32_t popped;
+		uint8_t pad_out[QUE_CACHE_LINE - 2 * sizeof(uint32_t)];
 
+		HANDLE data_avail;	// set when the queue stops being empty
 		uint8_t *buffer;
-		int in_pos;
-		int out_pos;
-		int entry_count;
+		int entry_count;	// power of 2
 		int entry_size;
 	};
 
 	struct que_def *que_new(int count, int entry_size);
 	void que_delete(struct que_def *q);
-	void que_push(struct que_def *q, void *d);
-	void que_pop_nowait(struct que_def *q, void *d);
+	int que_push(struct que_def *q, void *d);
+	int que_pop_batch(struct que_def *q, void *d, int max);
+	int que_pop_nowait(struct que_def *q, void *d);
 	void que_pop_wait(struct que_def *q, void *d);
+	void que_get_stats(struct que_def *q, struct que_stats *stats);
 	HANDLE que_data_available_object(struct que_def *q);
 
 #ifdef __cplusplus
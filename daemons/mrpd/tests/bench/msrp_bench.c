@@ -0,0 +1,520 @@
+/****************************************************************************
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   3. Neither the name of the Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+/*
+ * MSRP load generator and scaling benchmark
+ *
+ * Runs the MSRP application against the unit test doubles, so no
+ * network or timers are involved. Several simulated peers each
+ * advertise a share of the talkers and listen to the streams of the
+ * next peer. Their MSRPDUs are fed through msrp_recv_msg() and local
+ * declarations through msrp_recv_cmd(), while control clients count the
+ * resulting notifications.
+ *
+ *   msrp_bench [-n attributes] [-p peers] [-r run] [-c clients] [-i loops]
+ *              [-t attributes]
+ *
+ * -n  talker attributes in total, the same number of listeners is added
+ * -p  simulated peers sharing them
+ * -r  consecutive StreamIDs advertised in one vector (up to 2000)
+ * -c  local clients registered for notifications
+ * -i  repetitions of the transmit measurements
+ * -t  talker attributes declared for the transmit measurements; they
+ *     must fit in one MSRPDU, as msrp_txpdu() does not split a PDU
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mrp_doubles.h"
+#include "mrp.h"
+#include "msrp.h"
+#include "eui64set.h"
+
+#define BENCH_FRAME_SIZE	1514
+#define BENCH_STREAM_BASE	0x0022970000000000ull
+#define BENCH_DA_BASE		0x91e0f0000000ull
+
+extern int msrp_txpdu(void);
+extern struct msrp_database *MSRP_db;
+
+struct bench_frame {
+	unsigned char data[BENCH_FRAME_SIZE];
+	int len;
+	int values;
+};
+
+struct bench_frames {
+	struct bench_frame *frame;
+	int count;
+	int size;
+	int values;
+};
+
+static struct bench_frames frames;
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static struct bench_frame *bench_frame_new(int peer)
+{
+	static const unsigned char msrp_addr[] = {
+		0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E
+	};
+	struct bench_frame *f;
+	eth_hdr_t *eth;
+
+	if (frames.count == frames.size) {
+		frames.size = frames.size ? 2 * frames.size : 256;
+		frames.frame = realloc(frames.frame,
+				       frames.size * sizeof(*frames.frame));
+		if (NULL == frames.frame) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	f = &frames.frame[frames.count++];
+	memset(f, 0, sizeof(*f));
+
+	eth = (eth_hdr_t *)f->data;
+	memcpy(eth->destaddr, msrp_addr, 6);
+	eth->srcaddr[0] = 0x00;
+	eth->srcaddr[1] = 0x1b;
+	eth->srcaddr[2] = 0x21;
+	eth->srcaddr[5] = (uint8_t)(peer + 1);
+	eth->typelen = htons(MSRP_ETYPE);
+	f->data[sizeof(eth_hdr_t)] = MSRP_PROT_VER;
+	f->len = sizeof(eth_hdr_t) + 1;
+
+	return f;
+}
+
+static void bench_put(unsigned char *p, uint64_t v, int bytes)
+{
+	while (bytes--) {
+		p[bytes] = (unsigned char)v;
+		v >>= 8;
+	}
+}
+
+/*
+ * Append one message of type holding vectors of run values each, for
+ * count attributes starting at StreamID id. Returns the number of
+ * attributes that fit into the frame.
+ */
+static int bench_add_message(struct bench_frame *f, int type,
+			     uint64_t id, uint64_t da, int count, int run)
+{
+	int attrib_len = (MSRP_LISTENER_TYPE == type) ? 8 : 25;
+	unsigned char *msg = &f->data[f->len];
+	unsigned char *p = msg + 4;
+	unsigned char *eof = f->data + BENCH_FRAME_SIZE - 4;
+	int done = 0;
+	int n;
+	int i;
+	int vsize;
+
+	while (done < count) {
+		n = (count - done < run) ? count - done : run;
+		vsize = 2 + attrib_len + (n + 2) / 3;
+		if (MSRP_LISTENER_TYPE == type)
+			vsize += (n + 3) / 4;
+		if (p + vsize > eof)
+			break;
+
+		bench_put(p, n, 2);
+		p += 2;
+		bench_put(p, id + done, 8);
+		if (MSRP_TALKER_ADV_TYPE == type) {
+			bench_put(p + 8, da + done, 6);
+			bench_put(p + 14, MSRP_SR_PVID_DEFAULT, 2);
+			bench_put(p + 16, 224, 2);	/* MaxFrameSize */
+			bench_put(p + 18, 1, 2);	/* MaxIntervalFrames */
+			p[20] = 0x70;			/* class A, rank 1 */
+			bench_put(p + 21, 125000, 4);
+		}
+		p += attrib_len;
+
+		for (i = 0; i < n; i += 3)
+			*p++ = MRPDU_3PACK_ENCODE(MRPDU_JOININ,
+			    (i + 1 < n) ? MRPDU_JOININ : 0,
+			    (i + 2 < n) ? MRPDU_JOININ : 0);
+		if (MSRP_LISTENER_TYPE == type) {
+			for (i = 0; i < n; i += 4)
+				*p++ = MRPDU_4PACK_ENCODE(MSRP_LISTENER_READY,
+				    (i + 1 < n) ? MSRP_LISTENER_READY : 0,
+				    (i + 2 < n) ? MSRP_LISTENER_READY : 0,
+				    (i + 3 < n) ? MSRP_LISTENER_READY : 0);
+		}
+		done += n;
+	}
+
+	if (0 == done)
+		return 0;
+
+	/* vector endmark */
+	*p++ = 0;
+	*p++ = 0;
+	msg[0] = (uint8_t)type;
+	msg[1] = (uint8_t)attrib_len;
+	bench_put(&msg[2], p - (msg + 4), 2);
+	f->len = p - f->data;
+	f->values += done;
+	return done;
+}
+
+static void bench_add_domain(struct bench_frame *f)
+{
+	unsigned char *msg = &f->data[f->len];
+
+	msg[0] = MSRP_DOMAIN_TYPE;
+	msg[1] = 4;
+	bench_put(&msg[2], 2 + 4 + 1 + 2, 2);
+	bench_put(&msg[4], 1, 2);
+	msg[6] = 6;				/* SRclassID A */
+	msg[7] = 3;				/* priority */
+	bench_put(&msg[8], MSRP_SR_PVID_DEFAULT, 2);
+	msg[10] = MRPDU_3PACK_ENCODE(MRPDU_JOININ, 0, 0);
+	msg[11] = 0;
+	msg[12] = 0;
+	f->len += 13;
+	f->values++;
+}
+
+static void bench_frame_end(struct bench_frame *f)
+{
+	/* PDU endmark */
+	f->data[f->len++] = 0;
+	f->data[f->len++] = 0;
+	frames.values += f->values;
+}
+
+/*
+ * Peer p advertises talkers [p * share, (p + 1) * share) and listens to
+ * the talkers of the next peer.
+ */
+static void bench_generate(int attribs, int peers, int run)
+{
+	struct bench_frame *f;
+	int share = attribs / peers;
+	uint64_t id;
+	uint64_t lid;
+	int left;
+	int n;
+	int p;
+
+	for (p = 0; p < peers; p++) {
+		id = BENCH_STREAM_BASE + (uint64_t)p * share;
+		lid = BENCH_STREAM_BASE + (uint64_t)((p + 1) % peers) * share;
+
+		f = bench_frame_new(p);
+		bench_add_domain(f);
+		for (left = share; left; left -= n, id += n) {
+			n = bench_add_message(f, MSRP_TALKER_ADV_TYPE, id,
+					      BENCH_DA_BASE + (id & 0xffff),
+					      left, run);
+			if (n < left) {
+				bench_frame_end(f);
+				f = bench_frame_new(p);
+			}
+		}
+		for (left = share; left; left -= n, lid += n) {
+			n = bench_add_message(f, MSRP_LISTENER_TYPE, lid, 0,
+					      left, run);
+			if (n < left) {
+				bench_frame_end(f);
+				f = bench_frame_new(p);
+			}
+		}
+		bench_frame_end(f);
+	}
+}
+
+static void bench_start(int clients, int coalesce)
+{
+	struct sockaddr_in client;
+	char cmd[] = "S-F";
+	char cmd_coalesce[] = "S+C";
+	int i;
+
+	mrpd_reset();
+	msrp_init(1, MSRP_INTERESTING_STREAM_ID_COUNT, 0);
+
+	memset(&client, 0, sizeof(client));
+	for (i = 0; i < clients; i++) {
+		client.sin_port = htons(7600 + i);
+		if (coalesce)
+			msrp_recv_cmd(cmd_coalesce, sizeof(cmd_coalesce),
+				      &client);
+		else
+			msrp_recv_cmd(cmd, sizeof(cmd), &client);
+	}
+}
+
+static void bench_stop(void)
+{
+	msrp_reset();
+	MSRP_db = NULL;
+	mrpd_reset();
+}
+
+/* feeds every generated frame once, returns the elapsed ns */
+static uint64_t bench_rx_pass(int flush)
+{
+	uint64_t start;
+	int i;
+
+	start = bench_now_ns();
+	for (i = 0; i < frames.count; i++) {
+		memcpy(test_state.rx_PDU, frames.frame[i].data,
+		       frames.frame[i].len);
+		test_state.rx_PDU_len = frames.frame[i].len;
+		msrp_recv_msg();
+		if (flush)
+			msrp_flush_notifications();
+	}
+	return bench_now_ns() - start;
+}
+
+static void bench_report(const char *what, uint64_t ns, int count,
+			 const char *unit)
+{
+	printf("%-28s %10.1f ns/%s  (%d in %.3f ms)\n", what,
+	       count ? (double)ns / count : 0.0, unit, count, ns / 1e6);
+}
+
+static void bench_rx(int clients)
+{
+	uint64_t ns;
+	int msgs;
+
+	bench_start(clients, 0);
+
+	ns = bench_rx_pass(0);
+	msgs = test_state.sent_ctl_msg_count;
+	bench_report("rx register", ns, frames.values, "attribute");
+	printf("%-28s %10d talkers, %d listeners, %d domains\n",
+	       "  registered", msrp_count_type(MSRP_TALKER_ADV_TYPE),
+	       msrp_count_type(MSRP_LISTENER_TYPE),
+	       msrp_count_type(MSRP_DOMAIN_TYPE));
+	printf("%-28s %10.2f per attribute (%d datagrams)\n",
+	       "  notifications", frames.values ?
+	       (double)msgs / frames.values : 0.0, msgs);
+
+	test_state.sent_ctl_msg_count = 0;
+	ns = bench_rx_pass(0);
+	bench_report("rx refresh", ns, frames.values, "attribute");
+	printf("%-28s %10d datagrams\n", "  notifications",
+	       test_state.sent_ctl_msg_count);
+
+	bench_stop();
+
+	if (clients) {
+		bench_start(clients, 1);
+		ns = bench_rx_pass(1);
+		bench_report("rx register, coalesced", ns, frames.values,
+			     "attribute");
+		printf("%-28s %10d datagrams\n", "  notifications",
+		       test_state.sent_ctl_msg_count);
+		bench_stop();
+	}
+}
+
+/* declares attribs talkers, then a listener for each, and times both */
+static void bench_declare(int attribs, int run, uint64_t *talker_ns,
+			  uint64_t *listener_ns)
+{
+	struct sockaddr_in client;
+	char cmd[160];
+	uint64_t start;
+	uint64_t id;
+	int i;
+
+	memset(&client, 0, sizeof(client));
+	client.sin_port = htons(7599);
+
+	start = bench_now_ns();
+	for (i = 0; i < attribs; i++) {
+		/* leave a gap after each run so vectors stay run long */
+		id = BENCH_STREAM_BASE + i + i / run;
+		snprintf(cmd, sizeof(cmd),
+			 "S++:S=%016llx,A=%012llx,V=0002,Z=224,I=1,P=112,L=125000",
+			 (unsigned long long)id,
+			 (unsigned long long)(BENCH_DA_BASE + (id & 0xffff)));
+		msrp_recv_cmd(cmd, strlen(cmd) + 1, &client);
+	}
+	*talker_ns = bench_now_ns() - start;
+
+	start = bench_now_ns();
+	for (i = 0; i < attribs; i++) {
+		id = BENCH_STREAM_BASE + i + i / run;
+		snprintf(cmd, sizeof(cmd), "S+L:L=%016llx,D=2",
+			 (unsigned long long)id);
+		msrp_recv_cmd(cmd, strlen(cmd) + 1, &client);
+	}
+	*listener_ns = bench_now_ns() - start;
+}
+
+static void bench_cmd(int attribs, int run)
+{
+	uint64_t talker_ns;
+	uint64_t listener_ns;
+
+	bench_start(0, 0);
+	bench_declare(attribs, run, &talker_ns, &listener_ns);
+	bench_report("cmd S++ declare", talker_ns, attribs, "command");
+	bench_report("cmd S+L declare", listener_ns, attribs, "command");
+	bench_stop();
+}
+
+/* returns -1 if a transmit failed, leaving the timings unreported */
+static int bench_tx(int attribs, int run, int loops)
+{
+	struct msrp_attribute *attrib;
+	uint64_t talker_ns;
+	uint64_t listener_ns;
+	uint64_t lva_ns = 0;
+	uint64_t tx_ns = 0;
+	uint64_t start;
+	int pdus = 0;
+	int calls = 0;
+	int errors = 0;
+	int sent;
+	int i;
+
+	bench_start(0, 0);
+	bench_declare(attribs, run, &talker_ns, &listener_ns);
+
+	for (i = 0; i < loops; i++) {
+		sent = test_state.sent_count;
+		start = bench_now_ns();
+		if (msrp_event(MRP_EVENT_LVATIMER, NULL))
+			errors++;
+		lva_ns += bench_now_ns() - start;
+		pdus += test_state.sent_count - sent;
+
+		/* every further transmit opportunity after the LeaveAll */
+		for (attrib = MSRP_db->attrib_list; attrib;
+		     attrib = attrib->next)
+			attrib->applicant.tx = 1;
+		sent = test_state.sent_count;
+		start = bench_now_ns();
+		if (msrp_txpdu())
+			errors++;
+		tx_ns += bench_now_ns() - start;
+		pdus += test_state.sent_count - sent;
+		calls++;
+	}
+
+	bench_stop();
+
+	if (errors) {
+		/* the emitters fail rather than split a PDU once the frame is full */
+		fprintf(stderr, "%d of %d transmits failed with %d talkers, "
+			"try a smaller -t\n", errors, loops * 2, attribs);
+		return -1;
+	}
+
+	printf("%d talkers + %d listeners declared for transmit\n",
+	       attribs, attribs);
+	bench_report("LeaveAll event + txpdu", lva_ns, loops, "event");
+	bench_report("msrp_txpdu", tx_ns, calls, "PDU");
+	printf("%-28s %10d PDUs, last %d bytes\n", "  sent", pdus,
+	       (int)test_state.tx_PDU_len);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int attribs = 10000;
+	int peers = 4;
+	int run = 8;
+	int clients = 12;
+	int loops = 5;
+	int tx_attribs = 128;
+	int ret;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:p:r:c:i:t:h")) != -1) {
+		switch (c) {
+		case 'n':
+			attribs = atoi(optarg);
+			break;
+		case 'p':
+			peers = atoi(optarg);
+			break;
+		case 'r':
+			run = atoi(optarg);
+			break;
+		case 'c':
+			clients = atoi(optarg);
+			break;
+		case 'i':
+			loops = atoi(optarg);
+			break;
+		case 't':
+			tx_attribs = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n attributes] [-p peers]"
+				" [-r run] [-c clients] [-i loops]"
+				" [-t attributes]\n", argv[0]);
+			return 1;
+		}
+	}
+	if ((attribs < 1) || (peers < 1) || (run < 1) || (run > 2000) ||
+	    (clients < 0) || (loops < 1) || (tx_attribs < 1)) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+	if (peers > attribs)
+		peers = attribs;
+
+	bench_generate(attribs, peers, run);
+	printf("%d talkers + %d listeners from %d peers, run %d, %d clients: "
+	       "%d MSRPDUs\n", (attribs / peers) * peers,
+	       (attribs / peers) * peers, peers, run, clients, frames.count);
+
+	bench_rx(clients);
+	bench_cmd(attribs, run);
+	ret = bench_tx(tx_attribs, run, loops);
+
+	free(frames.frame);
+	return ret ? 1 : 0;
+}
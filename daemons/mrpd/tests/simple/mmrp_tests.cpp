@@ -146,3 +146,51 @@ TEST(MmrpTestGroup, TxLVA_clear_tx_flag)
 	CHECK(mrpd_send_packet_count() > 0);
 	CHECK_EQUAL(0, tx_flag_count);
 }
+
+/*
+ * Declare many MAC addresses in descending order; each must be found
+ * through the hash index and the attribute list must stay sorted for
+ * vectorized PDU emission.
+ */
+TEST(MmrpTestGroup, HashLookupKeepsListOrder)
+{
+	struct mmrp_attribute a_ref;
+	struct mmrp_attribute *attrib;
+	char cmd_string[32];
+	int count = 0;
+	int i;
+
+	CHECK(MMRP_db != NULL);
+
+	for (i = 299; i >= 0; i--) {
+		snprintf(cmd_string, sizeof(cmd_string),
+			 "M++:M=91e0f000%04x", i);
+		mmrp_recv_cmd(cmd_string, strlen(cmd_string) + 1, &client);
+	}
+
+	a_ref.type = MMRP_MACVEC_TYPE;
+	a_ref.attribute.macaddr[0] = 0x91;
+	a_ref.attribute.macaddr[1] = 0xe0;
+	a_ref.attribute.macaddr[2] = 0xf0;
+	a_ref.attribute.macaddr[3] = 0x00;
+	for (i = 0; i < 300; i++) {
+		a_ref.attribute.macaddr[4] = (uint8_t)(i >> 8);
+		a_ref.attribute.macaddr[5] = (uint8_t)i;
+		attrib = mmrp_lookup(&a_ref);
+		CHECK(attrib != NULL);
+		CHECK(0 == memcmp(attrib->attribute.macaddr,
+				  a_ref.attribute.macaddr, 6));
+	}
+
+	a_ref.attribute.macaddr[5] = 0xff;
+	a_ref.attribute.macaddr[4] = 0xff;
+	CHECK(mmrp_lookup(&a_ref) == NULL);
+
+	for (attrib = MMRP_db->attrib_list; NULL != attrib; attrib = attrib->next) {
+		if (NULL != attrib->next)
+			CHECK(memcmp(attrib->attribute.macaddr,
+				     attrib->next->attribute.macaddr, 6) < 0);
+		count++;
+	}
+	CHECK_EQUAL(300, count);
+}
@@ -175,6 +175,18 @@ TRACE
         return notify_len;
 }
 
+int mrpd_send_ctl_data(struct sockaddr_in *client_addr, void *data, int len)
+{
+TRACE
+	assert(len <= MAX_MRPD_CMDSZ);
+
+	(void)client_addr; /* unused */
+	memcpy(test_state.ctl_msg_data, data, len);
+	test_state.sent_ctl_msg_count++;
+
+        return len;
+}
+
 size_t mrpd_send(SOCKET sockfd, const void *buf, size_t len, int flags)
 {
 TRACE
@@ -207,6 +219,14 @@ TRACE
         return 0;
 }
 
+void mrpd_map_changed(int app, int notify, void *attrib)
+{
+TRACE
+	(void)app;	/* unused, the tests run a single port */
+	(void)notify;
+	(void)attrib;
+}
+
 #include "msrp.h"
 extern int msrp_event_orig(int event, struct msrp_attribute *rattrib);
 void dump_msrp_attrib(struct msrp_attribute *attr)
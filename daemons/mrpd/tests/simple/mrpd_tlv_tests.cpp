@@ -0,0 +1,246 @@
+/******************************************************************************
+
+  Copyright (c) 2014, AudioScience, Inc.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   3. Neither the name of the AudioScience, Inc nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+
+#include "mrp_doubles.h"
+#include "mrpd_tlv.h"
+
+}
+
+static struct sockaddr_in tlv_client;
+static unsigned char sent_frame[MAX_MRPD_CMDSZ];
+static int sent_len;
+static int sent_count;
+
+static int tlv_test_send(struct sockaddr_in *client, char *data, int len)
+{
+	(void)client;
+	memcpy(sent_frame, data, len);
+	sent_len = len;
+	sent_count++;
+	return len;
+}
+
+/* answers the second command of a batch with an error and a notification */
+static int tlv_test_process(char *buf, int buflen,
+			    struct sockaddr_in *client)
+{
+	char err[] = "ERP bad parameter";
+	char note[] = "VJO 0123 R=001122334455 R=IN";
+
+	/* commands arrive NUL terminated, as from text clients */
+	if ((buflen < 1) || (buf[buflen - 1] != '\0'))
+		return -1;
+	if (strcmp(buf, "V++:I=0123") == 0) {
+		mrpd_tlv_send(client, note, sizeof(note));
+		return 0;
+	}
+	if (strcmp(buf, "V++:I=bad") == 0) {
+		mrpd_tlv_send(client, err, sizeof(err));
+		return -1;
+	}
+	return 0;
+}
+
+static int tlv_test_recv(const char **cmds, int count, uint32_t seq)
+{
+	unsigned char frame[MAX_MRPD_CMDSZ];
+	int len;
+	int i;
+
+	len = mrpd_tlv_frame_init(frame, sizeof(frame), seq);
+	for (i = 0; i < count; i++)
+		mrpd_tlv_frame_add(frame, sizeof(frame), &len, MRPD_TLV_CMD,
+				   cmds[i], strlen(cmds[i]));
+	return mrpd_tlv_recv((char *)frame, len, &tlv_client,
+			     tlv_test_process);
+}
+
+static void tlv_test_subscribe(uint32_t apps, uint32_t events)
+{
+	unsigned char frame[MAX_MRPD_CMDSZ];
+	unsigned char masks[8] = {
+		(unsigned char)(apps >> 24), (unsigned char)(apps >> 16),
+		(unsigned char)(apps >> 8), (unsigned char)apps,
+		(unsigned char)(events >> 24), (unsigned char)(events >> 16),
+		(unsigned char)(events >> 8), (unsigned char)events
+	};
+	int len;
+
+	len = mrpd_tlv_frame_init(frame, sizeof(frame), 1);
+	mrpd_tlv_frame_add(frame, sizeof(frame), &len, MRPD_TLV_SUBSCRIBE,
+			   masks, sizeof(masks));
+	mrpd_tlv_recv((char *)frame, len, &tlv_client, tlv_test_process);
+}
+
+TEST_GROUP(MrpdTlvTestGroup)
+{
+	void setup()
+	{
+		memset(&tlv_client, 0, sizeof(tlv_client));
+		tlv_client.sin_port = htons(5000);
+		sent_len = 0;
+		sent_count = 0;
+		mrpd_tlv_init(tlv_test_send);
+	}
+
+	void teardown()
+	{
+		mrpd_tlv_reset();
+	}
+};
+
+TEST(MrpdTlvTestGroup, FrameRoundTrip)
+{
+	unsigned char frame[64];
+	const unsigned char *value;
+	uint16_t type;
+	int offset = MRPD_TLV_HDR_SZ;
+	int vlen;
+	int len;
+
+	len = mrpd_tlv_frame_init(frame, sizeof(frame), 0x01020304);
+	CHECK_EQUAL(0, mrpd_tlv_frame_add(frame, sizeof(frame), &len,
+					  MRPD_TLV_CMD, "S??", 3));
+	CHECK(mrpd_tlv_is_frame((char *)frame, len));
+	CHECK_EQUAL(1, frame[3]);
+	CHECK_EQUAL(0x04, frame[7]);
+
+	CHECK_EQUAL(1, mrpd_tlv_frame_next(frame, len, &offset, &type,
+					   &value, &vlen));
+	CHECK_EQUAL(MRPD_TLV_CMD, type);
+	CHECK_EQUAL(3, vlen);
+	CHECK(memcmp(value, "S??", 3) == 0);
+	CHECK_EQUAL(0, mrpd_tlv_frame_next(frame, len, &offset, &type,
+					   &value, &vlen));
+
+	/* a truncated item is rejected */
+	offset = MRPD_TLV_HDR_SZ;
+	CHECK_EQUAL(-1, mrpd_tlv_frame_next(frame, len - 1, &offset, &type,
+					    &value, &vlen));
+
+	/* the text protocol is never mistaken for a frame */
+	CHECK(!mrpd_tlv_is_frame("S++:S=0011223344556677", 22));
+}
+
+TEST(MrpdTlvTestGroup, BatchAnsweredInOneFrame)
+{
+	const char *cmds[] = { "V++:I=0123", "V++:I=bad", "V--:I=0456" };
+	const unsigned char *value;
+	uint16_t type;
+	int offset = MRPD_TLV_HDR_SZ;
+	int vlen;
+
+	CHECK_EQUAL(-1, tlv_test_recv(cmds, 3, 42));
+	CHECK_EQUAL(1, sent_count);
+
+	CHECK_EQUAL(1, mrpd_tlv_frame_next(sent_frame, sent_len, &offset,
+					   &type, &value, &vlen));
+	CHECK_EQUAL(MRPD_TLV_NOTIFY, type);
+	CHECK(memcmp(value, "VJO 0123", 8) == 0);
+
+	CHECK_EQUAL(1, mrpd_tlv_frame_next(sent_frame, sent_len, &offset,
+					   &type, &value, &vlen));
+	CHECK_EQUAL(MRPD_TLV_RESPONSE, type);
+	CHECK_EQUAL(1, (value[0] << 8) | value[1]);
+	CHECK_EQUAL((int)strlen("ERP bad parameter") + 2, vlen);
+
+	CHECK_EQUAL(1, mrpd_tlv_frame_next(sent_frame, sent_len, &offset,
+					   &type, &value, &vlen));
+	CHECK_EQUAL(MRPD_TLV_DONE, type);
+	CHECK_EQUAL(8, vlen);
+	CHECK_EQUAL(42, value[3]);
+	CHECK_EQUAL(3, value[5]);
+	CHECK_EQUAL(1, value[7]);
+
+	CHECK_EQUAL(0, mrpd_tlv_frame_next(sent_frame, sent_len, &offset,
+					   &type, &value, &vlen));
+}
+
+TEST(MrpdTlvTestGroup, SubscriptionFiltersNotifications)
+{
+	char vjo[] = "VJO 0123 R=001122334455 R=IN";
+	char vle[] = "VLE 0123 R=001122334455 R=LV";
+	char mjo[] = "MJO M=010203040506 R=001122334455 R=IN";
+	const unsigned char *value;
+	uint16_t type;
+	int offset = MRPD_TLV_HDR_SZ;
+	int vlen;
+
+	tlv_test_subscribe(MRPD_TLV_APP_MVRP, MRPD_TLV_EVT_JOIN);
+	sent_count = 0;
+
+	CHECK_EQUAL((int)sizeof(vjo), mrpd_tlv_send(&tlv_client, vjo,
+						    sizeof(vjo)));
+	CHECK_EQUAL((int)sizeof(vle), mrpd_tlv_send(&tlv_client, vle,
+						    sizeof(vle)));
+	CHECK_EQUAL((int)sizeof(mjo), mrpd_tlv_send(&tlv_client, mjo,
+						    sizeof(mjo)));
+
+	/* nothing goes out until the event loop flushes */
+	CHECK_EQUAL(0, sent_count);
+	mrpd_tlv_flush();
+	CHECK_EQUAL(1, sent_count);
+
+	CHECK_EQUAL(1, mrpd_tlv_frame_next(sent_frame, sent_len, &offset,
+					   &type, &value, &vlen));
+	CHECK_EQUAL(MRPD_TLV_NOTIFY, type);
+	CHECK_EQUAL((int)strlen(vjo), vlen);
+	CHECK_EQUAL(0, mrpd_tlv_frame_next(sent_frame, sent_len, &offset,
+					   &type, &value, &vlen));
+}
+
+TEST(MrpdTlvTestGroup, TextClientsUntouched)
+{
+	const char *cmds[] = { "V--:I=0456" };
+	struct sockaddr_in text_client;
+	char vjo[] = "VJO 0123 R=001122334455 R=IN";
+
+	tlv_test_recv(cmds, 1, 1);
+
+	memset(&text_client, 0, sizeof(text_client));
+	text_client.sin_port = htons(5001);
+	CHECK_EQUAL(0, mrpd_tlv_send(&text_client, vjo, sizeof(vjo)));
+
+	/* BYE turns a binary client back into a text client */
+	mrpd_tlv_bye(&tlv_client);
+	CHECK_EQUAL(0, mrpd_tlv_send(&tlv_client, vjo, sizeof(vjo)));
+}
@@ -657,3 +657,199 @@ TEST(MsrpTestGroup, TalkerAdvertise_To_Failed_Transition_With_Rx_rIn)
 
 }
 
+
+/*
+ * Declare more talkers than there are hash buckets and a listener that
+ * shares a StreamID with one of them, then check that lookups find each
+ * declaration by type and that the sorted attribute list is unchanged.
+ */
+TEST(MsrpTestGroup, Lookup_Hashed_Attributes)
+{
+	struct msrp_attribute *attrib;
+	char cmd_string[128];
+	uint8_t streamID[8];
+	uint64_t id = 0xbadc0ffeeull;
+	uint64_t da = 0xdeadbeefull;
+	int count = MSRP_ATTRIB_HASH_SIZE + 64;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		snprintf(cmd_string, sizeof(cmd_string),
+			"S++:S=%" PRIx64 ",A=%" PRIx64 ",V=" VLAN_ID ",Z=" TSPEC_MAX_FRAME_SIZE
+			",I=" TSPEC_MAX_FRAME_INTERVAL ",P=" PRIORITY_AND_RANK ",L=" ACCUMULATED_LATENCY,
+			id + i, da);
+		msrp_recv_cmd(cmd_string, strlen(cmd_string) + 1, &client);
+		CHECK(msrp_tests_cmd_ok(test_state.ctl_msg_data));
+	}
+
+	snprintf(cmd_string, sizeof(cmd_string), "S+L:L=%016" PRIx64 ",D=2", id);
+	msrp_recv_cmd(cmd_string, strlen(cmd_string) + 1, &client);
+	CHECK(msrp_tests_cmd_ok(test_state.ctl_msg_data));
+
+	LONGS_EQUAL(count, msrp_count_type(MSRP_TALKER_ADV_TYPE));
+	LONGS_EQUAL(1, msrp_count_type(MSRP_LISTENER_TYPE));
+
+	for (i = 0; i < count; i++)
+	{
+		eui64_write(streamID, id + i);
+		attrib = msrp_lookup_stream_declaration(MSRP_TALKER_ADV_TYPE, streamID);
+		CHECK(NULL != attrib);
+		CHECK(MSRP_TALKER_ADV_TYPE == attrib->type);
+		CHECK(0 == memcmp(attrib->attribute.talk_listen.StreamID, streamID, 8));
+		/* TalkerFailed lookups match TalkerAdvertise declarations */
+		POINTERS_EQUAL(attrib, msrp_lookup_stream_declaration(MSRP_TALKER_FAILED_TYPE, streamID));
+	}
+
+	eui64_write(streamID, id);
+	attrib = msrp_lookup_stream_declaration(MSRP_LISTENER_TYPE, streamID);
+	CHECK(NULL != attrib);
+	CHECK(MSRP_LISTENER_TYPE == attrib->type);
+
+	eui64_write(streamID, id + 1);
+	POINTERS_EQUAL(NULL, msrp_lookup_stream_declaration(MSRP_LISTENER_TYPE, streamID));
+	eui64_write(streamID, id + count);
+	POINTERS_EQUAL(NULL, msrp_lookup_stream_declaration(MSRP_TALKER_ADV_TYPE, streamID));
+
+	/* talkers are still sorted by StreamID within the list */
+	attrib = MSRP_db->attrib_list;
+	while ((NULL != attrib) && (NULL != attrib->next))
+	{
+		if ((MSRP_TALKER_ADV_TYPE == attrib->type) &&
+		    (MSRP_TALKER_ADV_TYPE == attrib->next->type))
+			CHECK(memcmp(attrib->attribute.talk_listen.StreamID,
+				attrib->next->attribute.talk_listen.StreamID, 8) < 0);
+		attrib = attrib->next;
+	}
+}
+
+static int msrp_tests_first_talker_numvalues(void)
+{
+	mrpdu_vectorattrib_t *vector;
+	unsigned char *pdu;
+
+	/* ethernet header and protocol version */
+	pdu = test_state.tx_PDU + sizeof(eth_hdr_t) + 1;
+	if (MSRP_TALKER_ADV_TYPE != pdu[0])
+		return -1;
+	/* attribute type, length and attribute list length */
+	vector = (mrpdu_vectorattrib_t *)(pdu + 4);
+	return MRPDU_VECT_NUMVALUES(ntohs(vector->VectorHeader));
+}
+
+/*
+ * Talkers with consecutive StreamIDs and DAs share one vector. Filling
+ * the gap between two runs must join them on the next PDU.
+ */
+TEST(MsrpTestGroup, TxLVA_TalkerAdv_runs_follow_inserts)
+{
+	char cmd_string[128];
+	uint64_t id = 0xbadc0ffeeull;
+	uint64_t da = 0xdeadbeefull;
+	int offsets[] = { 0, 1, 3, 2 };
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		snprintf(cmd_string, sizeof(cmd_string),
+			"S++:S=%" PRIx64 ",A=%" PRIx64 ",V=" VLAN_ID ",Z=" TSPEC_MAX_FRAME_SIZE
+			",I=" TSPEC_MAX_FRAME_INTERVAL ",P=" PRIORITY_AND_RANK ",L=" ACCUMULATED_LATENCY,
+			id + offsets[i], da + offsets[i]);
+		msrp_recv_cmd(cmd_string, strlen(cmd_string) + 1, &client);
+		CHECK(msrp_tests_cmd_ok(test_state.ctl_msg_data));
+
+		if (2 == i) {
+			msrp_event(MRP_EVENT_LVATIMER, NULL);
+			LONGS_EQUAL(2, msrp_tests_first_talker_numvalues());
+		}
+	}
+
+	msrp_event(MRP_EVENT_LVATIMER, NULL);
+	LONGS_EQUAL(4, msrp_tests_first_talker_numvalues());
+}
+
+static struct msrp_attribute *msrp_tests_declare_talker(uint64_t id)
+{
+	char cmd_string[128];
+	uint8_t streamID[8];
+
+	snprintf(cmd_string, sizeof(cmd_string),
+		"S++:S=%" PRIx64 ",A=" STREAM_DA ",V=" VLAN_ID ",Z=" TSPEC_MAX_FRAME_SIZE
+		",I=" TSPEC_MAX_FRAME_INTERVAL ",P=" PRIORITY_AND_RANK ",L=" ACCUMULATED_LATENCY,
+		id);
+	msrp_recv_cmd(cmd_string, strlen(cmd_string) + 1, &client);
+	eui64_write(streamID, id);
+	return msrp_lookup_stream_declaration(MSRP_TALKER_ADV_TYPE, streamID);
+}
+
+/*
+ * A client that filtered on a StreamID only hears about that stream,
+ * until it removes the filter again.
+ */
+TEST(MsrpTestGroup, Notification_Stream_Filter)
+{
+	struct msrp_attribute *wanted;
+	struct msrp_attribute *other;
+	char filter_cmd[] = "S+F:S=" STREAM_ID;
+	char type_cmd[] = "S+F:T=3";
+	char clear_cmd[] = "S-F";
+
+	wanted = msrp_tests_declare_talker(0xDEADBEEFBADFCA11ull);
+	other = msrp_tests_declare_talker(0xDEADBEEFBADFCA13ull);
+	CHECK(NULL != wanted);
+	CHECK(NULL != other);
+
+	msrp_recv_cmd(filter_cmd, sizeof(filter_cmd), &client);
+	test_state.sent_ctl_msg_count = 0;
+
+	msrp_send_notifications(wanted, MRP_NOTIFY_NEW);
+	LONGS_EQUAL(1, test_state.sent_ctl_msg_count);
+	CHECK(strncmp(test_state.ctl_msg_data, "SNE T:S=deadbeefbadfca11", 24) == 0);
+	msrp_send_notifications(other, MRP_NOTIFY_NEW);
+	LONGS_EQUAL(1, test_state.sent_ctl_msg_count);
+
+	/* listener type only, the matching talker is filtered too */
+	msrp_recv_cmd(type_cmd, sizeof(type_cmd), &client);
+	msrp_send_notifications(wanted, MRP_NOTIFY_JOIN);
+	LONGS_EQUAL(1, test_state.sent_ctl_msg_count);
+
+	msrp_recv_cmd(clear_cmd, sizeof(clear_cmd), &client);
+	test_state.sent_ctl_msg_count = 0;
+	msrp_send_notifications(other, MRP_NOTIFY_NEW);
+	LONGS_EQUAL(1, test_state.sent_ctl_msg_count);
+}
+
+/*
+ * With coalescing on, notifications wait for the flush and go out as one
+ * datagram of newline separated lines.
+ */
+TEST(MsrpTestGroup, Notification_Coalesce)
+{
+	struct msrp_attribute *attrib[3];
+	char coalesce_cmd[] = "S+C";
+	const char *line;
+	int lines = 0;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		attrib[i] = msrp_tests_declare_talker(0xbadc0ffeeull + 2 * i);
+		CHECK(NULL != attrib[i]);
+	}
+
+	msrp_recv_cmd(coalesce_cmd, sizeof(coalesce_cmd), &client);
+	test_state.sent_ctl_msg_count = 0;
+
+	for (i = 0; i < 3; i++)
+		msrp_send_notifications(attrib[i], MRP_NOTIFY_JOIN);
+	LONGS_EQUAL(0, test_state.sent_ctl_msg_count);
+
+	msrp_flush_notifications();
+	LONGS_EQUAL(1, test_state.sent_ctl_msg_count);
+	for (line = test_state.ctl_msg_data; (line = strstr(line, "SJO ")); line++)
+		lines++;
+	LONGS_EQUAL(3, lines);
+
+	/* nothing pending, nothing sent */
+	msrp_flush_notifications();
+	LONGS_EQUAL(1, test_state.sent_ctl_msg_count);
+}
@@ -84,12 +84,12 @@ TEST(MvrpTestGroup, RegisterVLAN)
     struct mvrp_attribute *a_mvrp = NULL;
     int err_index = 0;
     int parse_status = 0;
-	char cmd_string[] = "V++:I=1234";
+	char cmd_string[] = "V++:I=0123";
 
     CHECK(MVRP_db != NULL);
 
     /* here we fill in a_ref struct with target values */
-	a_ref.attribute = 0x1234;
+	a_ref.attribute = 0x123;
 
     /* use string interface to get MSRP to create TalkerAdv attrib in it's database */
     mvrp_recv_cmd(cmd_string, sizeof(cmd_string), &client);
@@ -106,12 +106,12 @@ TEST(MvrpTestGroup, TxLVA_clear_tx_flag)
 	int tx_flag_count = 0;
 	int err_index = 0;
 	int parse_status = 0;
-	char cmd_string[] = "V++:I=1234";
+	char cmd_string[] = "V++:I=0123";
 
 	CHECK(MVRP_db != NULL);
 
 	/* here we fill in a_ref struct with target values */
-	a_ref.attribute = 0x1234;
+	a_ref.attribute = 0x123;
 
 	/* use string interface to get MSRP to create TalkerAdv attrib in it's database */
 	mvrp_recv_cmd(cmd_string, sizeof(cmd_string), &client);
@@ -126,13 +126,72 @@ TEST(MvrpTestGroup, TxLVA_clear_tx_flag)
 	*/
 	mvrp_event(MRP_EVENT_LVATIMER, NULL);
 
-	/* verify that all tx flags are zero by scanning the attribute list */
-	attrib = MVRP_db->attrib_list;
-	while (NULL != attrib)
+	/* verify that all tx flags are zero by scanning the VID registry */
+	for (int vid = mvrp_next_vid(0); vid >= 0; vid = mvrp_next_vid(vid + 1))
 	{
-		tx_flag_count += attrib->applicant.tx;
-		attrib = attrib->next;
+		tx_flag_count += MVRP_db->vids[vid].applicant.tx;
 	}
 	CHECK(mrpd_send_packet_count() > 0);
 	CHECK_EQUAL(0, tx_flag_count);
 }
+
+TEST(MvrpTestGroup, RejectOutOfRangeVID)
+{
+	struct mvrp_attribute a_ref;
+	char cmd_string[] = "V++:I=1234";
+
+	CHECK(MVRP_db != NULL);
+
+	mvrp_recv_cmd(cmd_string, sizeof(cmd_string), &client);
+
+	a_ref.attribute = 0x1234;
+	CHECK(mvrp_lookup(&a_ref) == NULL);
+	CHECK_EQUAL(-1, mvrp_next_vid(0));
+}
+
+TEST(MvrpTestGroup, NextVIDSkipsUnusedWords)
+{
+	char cmd_low[] = "V++:I=0005";
+	char cmd_high[] = "V++:I=0ffe";
+
+	CHECK(MVRP_db != NULL);
+
+	mvrp_recv_cmd(cmd_low, sizeof(cmd_low), &client);
+	mvrp_recv_cmd(cmd_high, sizeof(cmd_high), &client);
+
+	CHECK_EQUAL(0x005, mvrp_next_vid(0));
+	CHECK_EQUAL(0xffe, mvrp_next_vid(0x006));
+	CHECK_EQUAL(-1, mvrp_next_vid(0xfff));
+}
+
+/*
+ * Consecutive VIDs are emitted as a single vector: three declared VIDs
+ * starting at 0x010 should produce one LeaveAll vector with NumberOfValues
+ * set to 3.
+ */
+TEST(MvrpTestGroup, TxLVA_vectorizes_contiguous_VIDs)
+{
+	char cmd_a[] = "V++:I=0010";
+	char cmd_b[] = "V++:I=0011";
+	char cmd_c[] = "V++:I=0012";
+	mrpdu_vectorattrib_t *vector;
+	unsigned char *pdu;
+
+	CHECK(MVRP_db != NULL);
+
+	mvrp_recv_cmd(cmd_a, sizeof(cmd_a), &client);
+	mvrp_recv_cmd(cmd_b, sizeof(cmd_b), &client);
+	mvrp_recv_cmd(cmd_c, sizeof(cmd_c), &client);
+
+	mvrp_event(MRP_EVENT_LVATIMER, NULL);
+	CHECK(mrpd_send_packet_count() > 0);
+
+	/* ethernet header, protocol version, attribute type and length */
+	pdu = test_state.tx_PDU + sizeof(eth_hdr_t) + 1;
+	CHECK_EQUAL(MVRP_VID_TYPE, pdu[0]);
+	CHECK_EQUAL(2, pdu[1]);
+	vector = (mrpdu_vectorattrib_t *)(pdu + 2);
+	CHECK_EQUAL(3, MRPDU_VECT_NUMVALUES(ntohs(vector->VectorHeader)));
+	CHECK_EQUAL(0x00, vector->FirstValue_VectorEvents[0]);
+	CHECK_EQUAL(0x10, vector->FirstValue_VectorEvents[1]);
+}
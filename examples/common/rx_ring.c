@@ -0,0 +1,252 @@
+/****************************************************************************
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   3. Neither the name of the Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#include "rx_ring.h"
+
+#define RX_RING_BLOCK_SIZE (1 << 16)
+#define RX_RING_BLOCK_COUNT (16)
+#define RX_RING_FRAME_SIZE (2048)
+#define RX_RING_MAX_BATCH (RX_RING_BLOCK_SIZE / 64)
+#define VLAN_TAG_LEN (4)
+
+struct rx_ring {
+	int sock;
+	unsigned char dest_mac[6];
+	uint8_t *mem;
+	size_t mem_size;
+	unsigned int block;
+	int losing;
+	volatile int halt;
+	const unsigned char *frames[RX_RING_MAX_BATCH];
+	unsigned int lens[RX_RING_MAX_BATCH];
+};
+
+struct rx_ring *rx_ring_open(const char *ifname, const unsigned char *dest_mac,
+			     unsigned int retire_usec)
+{
+	struct rx_ring *ring;
+	struct tpacket_req3 req;
+	struct sockaddr_ll addr;
+	struct packet_mreq mreq;
+	int version = TPACKET_V3;
+	int reserve = VLAN_TAG_LEN;
+	int ifindex;
+
+	ifindex = if_nametoindex(ifname);
+	if (0 == ifindex) {
+		fprintf(stderr, "Unknown interface %s\n", ifname);
+		return NULL;
+	}
+
+	ring = calloc(1, sizeof(*ring));
+	if (NULL == ring)
+		return NULL;
+	memcpy(ring->dest_mac, dest_mac, sizeof(ring->dest_mac));
+	ring->mem = MAP_FAILED;
+
+	ring->sock = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (ring->sock < 0) {
+		fprintf(stderr, "rx_ring socket: %s\n", strerror(errno));
+		goto fail;
+	}
+
+	/* room to put a stripped VLAN tag back in front of the payload */
+	if (setsockopt(ring->sock, SOL_PACKET, PACKET_VERSION, &version,
+		       sizeof(version)) < 0 ||
+	    setsockopt(ring->sock, SOL_PACKET, PACKET_RESERVE, &reserve,
+		       sizeof(reserve)) < 0) {
+		fprintf(stderr, "rx_ring TPACKET_V3: %s\n", strerror(errno));
+		goto fail;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = RX_RING_BLOCK_SIZE;
+	req.tp_block_nr = RX_RING_BLOCK_COUNT;
+	req.tp_frame_size = RX_RING_FRAME_SIZE;
+	req.tp_frame_nr = RX_RING_BLOCK_SIZE / RX_RING_FRAME_SIZE *
+		RX_RING_BLOCK_COUNT;
+	/* the kernel counts the retire timeout in msec */
+	req.tp_retire_blk_tov = (retire_usec + 999) / 1000;
+	if (0 == req.tp_retire_blk_tov)
+		req.tp_retire_blk_tov = 1;
+	if (setsockopt(ring->sock, SOL_PACKET, PACKET_RX_RING, &req,
+		       sizeof(req)) < 0) {
+		fprintf(stderr, "rx_ring PACKET_RX_RING: %s\n", strerror(errno));
+		goto fail;
+	}
+
+	ring->mem_size = (size_t)req.tp_block_size * req.tp_block_nr;
+	ring->mem = mmap(NULL, ring->mem_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, ring->sock, 0);
+	if (MAP_FAILED == ring->mem) {
+		fprintf(stderr, "rx_ring mmap: %s\n", strerror(errno));
+		goto fail;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	addr.sll_ifindex = ifindex;
+	if (bind(ring->sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "rx_ring bind: %s\n", strerror(errno));
+		goto fail;
+	}
+
+	memset(&mreq, 0, sizeof(mreq));
+	mreq.mr_ifindex = ifindex;
+	mreq.mr_type = PACKET_MR_MULTICAST;
+	mreq.mr_alen = 6;
+	memcpy(mreq.mr_address, dest_mac, 6);
+	if (setsockopt(ring->sock, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+		       sizeof(mreq)) < 0) {
+		fprintf(stderr, "rx_ring multicast: %s\n", strerror(errno));
+		goto fail;
+	}
+
+	return ring;
+
+fail:
+	rx_ring_close(ring);
+	return NULL;
+}
+
+void rx_ring_close(struct rx_ring *ring)
+{
+	if (NULL == ring)
+		return;
+	if (MAP_FAILED != ring->mem)
+		munmap(ring->mem, ring->mem_size);
+	if (ring->sock >= 0)
+		close(ring->sock);
+	free(ring);
+}
+
+/*
+ * Wait up to timeout_ms for the next block and pass its frames to the
+ * handler in one call. Returns the number of frames handed over, 0 on
+ * timeout or -1 on error.
+ */
+int rx_ring_dispatch(struct rx_ring *ring, int timeout_ms,
+		     rx_ring_handler handler, void *arg)
+{
+	struct tpacket_block_desc *desc = (struct tpacket_block_desc *)
+		(ring->mem + (size_t)ring->block * RX_RING_BLOCK_SIZE);
+	struct tpacket3_hdr *hdr;
+	unsigned int i, count = 0;
+
+	if (0 == (__atomic_load_n(&desc->hdr.bh1.block_status,
+				  __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+		struct pollfd pfd = { .fd = ring->sock, .events = POLLIN };
+
+		if (poll(&pfd, 1, timeout_ms) < 0)
+			return (EINTR == errno) ? 0 : -1;
+		if (0 == (__atomic_load_n(&desc->hdr.bh1.block_status,
+					  __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+			return 0;
+	}
+
+	if (desc->hdr.bh1.block_status & TP_STATUS_LOSING) {
+		if (!ring->losing)
+			fprintf(stderr, "rx_ring full, frames dropped\n");
+		ring->losing = 1;
+	} else {
+		ring->losing = 0;
+	}
+
+	hdr = (struct tpacket3_hdr *)((uint8_t *)desc +
+				      desc->hdr.bh1.offset_to_first_pkt);
+	for (i = 0; i < desc->hdr.bh1.num_pkts; i++) {
+		unsigned char *frame = (unsigned char *)hdr + hdr->tp_mac;
+		unsigned int len = hdr->tp_snaplen;
+
+		if (len >= 14 && 0 == memcmp(frame, ring->dest_mac, 6) &&
+		    count < RX_RING_MAX_BATCH) {
+			if (hdr->tp_status & TP_STATUS_VLAN_VALID) {
+				/* put the stripped tag back, as pcap does */
+				uint16_t tag[2];
+
+				tag[0] = htons(hdr->hv1.tp_vlan_tpid ?
+					       hdr->hv1.tp_vlan_tpid : ETH_P_8021Q);
+				tag[1] = htons(hdr->hv1.tp_vlan_tci);
+				memmove(frame - VLAN_TAG_LEN, frame, 12);
+				frame -= VLAN_TAG_LEN;
+				memcpy(frame + 12, tag, sizeof(tag));
+				len += VLAN_TAG_LEN;
+			}
+			ring->frames[count] = frame;
+			ring->lens[count] = len;
+			count++;
+		}
+		hdr = (struct tpacket3_hdr *)((uint8_t *)hdr + hdr->tp_next_offset);
+	}
+
+	if (count)
+		handler(arg, ring->frames, ring->lens, count);
+
+	/* hand the block back to the kernel */
+	__atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL,
+			 __ATOMIC_RELEASE);
+	ring->block = (ring->block + 1) % RX_RING_BLOCK_COUNT;
+
+	return count;
+}
+
+/* Dispatch blocks until rx_ring_breakloop() or an error */
+int rx_ring_loop(struct rx_ring *ring, rx_ring_handler handler, void *arg)
+{
+	int rc = 0;
+
+	ring->halt = 0;
+	while (!ring->halt && rc >= 0)
+		rc = rx_ring_dispatch(ring, 100, handler, arg);
+
+	return (rc < 0) ? -1 : 0;
+}
+
+/* safe to call from a signal handler */
+void rx_ring_breakloop(struct rx_ring *ring)
+{
+	ring->halt = 1;
+}
@@ -0,0 +1,61 @@
+/****************************************************************************
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   3. Neither the name of the Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifndef _RX_RING_H_
+#define _RX_RING_H_
+
+/*
+ * TPACKET_V3 receive ring for the listener examples
+ *
+ * The kernel fills whole blocks of frames and hands a block over once it
+ * is full or its retire timeout expires, so one wakeup delivers a batch of
+ * frames without a copy. This is the block mode receive path of the AVTP
+ * pipeline's ring rawsock, reduced to what the examples need.
+ */
+
+#include <stdint.h>
+
+struct rx_ring;
+
+/* called once per block with the frames addressed to the ring's MAC */
+typedef void (*rx_ring_handler)(void *arg, const unsigned char **frames,
+				const unsigned int *lens, unsigned int count);
+
+struct rx_ring *rx_ring_open(const char *ifname, const unsigned char *dest_mac,
+			     unsigned int retire_usec);
+void rx_ring_close(struct rx_ring *ring);
+int rx_ring_dispatch(struct rx_ring *ring, int timeout_ms,
+		     rx_ring_handler handler, void *arg);
+int rx_ring_loop(struct rx_ring *ring, rx_ring_handler handler, void *arg);
+void rx_ring_breakloop(struct rx_ring *ring);
+
+#endif /* _RX_RING_H_ */
@@ -30,6 +30,9 @@
 extern int read_data_from_queue( void* ptr);
 extern int send_data_status(int);
 extern void flag_exit_app(int);
+extern GstBuffer *read_buffer_from_queue(gboolean *last);
+extern guint64 read_buffer_max_bytes(void);
+extern int g_zero_copy;
 
  /* Structure to contain all our information, so we can pass it to callbacks */
 typedef struct 
@@ -43,6 +46,29 @@ typedef struct
 
 static gst_app_t gst_app;
 
+ /* Function to push received frames without copying them */
+static gboolean read_buffer(gst_app_t *app)
+{
+	GstBuffer *buffer;
+	gboolean last;
+	GstFlowReturn ret;
+
+	buffer = read_buffer_from_queue(&last);
+	ret = gst_app_src_push_buffer(app->src, buffer);
+	if(ret !=  GST_FLOW_OK) {
+		g_debug("push buffer returned %d\n", ret);
+		return FALSE;
+	}
+
+	if(last) {
+		ret = gst_app_src_end_of_stream(app->src);
+		g_debug("eos returned %d at %d\n", ret, __LINE__);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
  /* Function to read data*/
 static gboolean read_data(gst_app_t *app)
 {
@@ -87,7 +113,9 @@ static void start_feed (GstElement * pipeline, guint size, gst_app_t *app)
 		GST_DEBUG("\nGSTREAMER CALLBACK : 1\n");
 		send_data_status(1);
 		GST_DEBUG ("start feeding");
-		app->sourceid = g_idle_add ((GSourceFunc) read_data, app);
+		app->sourceid = g_idle_add (g_zero_copy ?
+					    (GSourceFunc) read_buffer :
+					    (GSourceFunc) read_data, app);
 	}
 }
  
@@ -170,6 +198,10 @@ static void found_source (GObject * object, GObject * orig, GParamSpec * pspec,
 	/* configure the appsrc, we will push a buffer to appsrc when it needs more data */
 	g_signal_connect (app->src, "need-data", G_CALLBACK (start_feed), app);
 	g_signal_connect (app->src, "enough-data", G_CALLBACK (stop_feed), app);
+
+	/* queued buffers pin receive frames, so pause the talker early */
+	if (g_zero_copy)
+		gst_app_src_set_max_bytes(app->src, read_buffer_max_bytes());
 }
 
 int gstreamer_main(void)
@@ -65,10 +65,17 @@
 
 #define NUM_OF_BUFFERS		50
 
+/* zero-copy mode keeps whole frames in flight inside GStreamer */
+#define ZERO_COPY_NUM_OF_BUFFERS	1024
+#define ZERO_COPY_MAX_PACKETS		64
+
 #define FRAME_SIZE 1500
 
 #define PAYLOAD_SIZE	1024
 
+#define PAYLOAD_OFFSET	(sizeof(eth_header) + sizeof(seventeen22_header) \
+			 + sizeof(six1883_header))
+
 /* external function */
 extern int gstreamer_main(void);
 
@@ -79,6 +86,7 @@ device_t igb_dev;
 int start_of_input_data = 0;
 int g_start_feed_socket = 0;
 int g_exit_app = 0;
+int g_zero_copy = 0;
 char *talker_ip;
 int port;
 int err;
@@ -105,7 +113,8 @@ enum
 	PROP_0, 
 	PROP_INTERFACE,
 	PROP_TALKERIP,
-	PROP_PORT
+	PROP_PORT,
+	PROP_ZERO_COPY
 };
 GST_DEBUG_CATEGORY_STATIC (avbsrc_debug);
 #define GST_CAT_DEFAULT (avbsrc_debug)
@@ -163,6 +172,12 @@ gst_avbsrc_class_init (GstAVBSrcClass * klass)
 					0, G_MAXUINT16, port,
 					G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+	g_object_class_install_property(G_OBJECT_CLASS (klass), PROP_ZERO_COPY,
+					 g_param_spec_boolean ("zero-copy", "Zero copy",
+					"Hand received frames to appsrc without copying them",
+					FALSE,
+					G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
 	gst_element_class_add_pad_template (gstelement_class,
 					    gst_static_pad_template_get (&src_template));
 
@@ -214,6 +229,10 @@ gst_avbsrc_set_property (GObject * object, guint prop_id, const GValue * value,
 			port = g_value_get_int (value);
 			break;
 
+		case PROP_ZERO_COPY:
+			g_zero_copy = g_value_get_boolean (value);
+			break;
+
 		default:
 			break;
 	}
@@ -240,6 +259,10 @@ gst_avbsrc_get_property (GObject * object, guint prop_id, GValue * value,
 			g_value_set_int (value, port);
 			break;
 
+		case PROP_ZERO_COPY:
+			g_value_set_boolean (value, g_zero_copy);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 			break;
@@ -249,9 +272,134 @@ gst_avbsrc_get_property (GObject * object, guint prop_id, GValue * value,
 struct tailq_entry {
 	TAILQ_ENTRY(tailq_entry) entries;
 	uint32_t payload_length;
+	uint32_t payload_offset;
 	uint8_t *payload_data;
 };
 
+/*
+ * Allocator for zero-copy mode. Its memories point into the frames the
+ * receive loop filled and nothing is ever allocated through it; freeing
+ * a memory puts the frame back on the free queue.
+ */
+typedef struct {
+	GstAllocator parent;
+} GstAVBRingAllocator;
+
+typedef struct {
+	GstAllocatorClass parent_class;
+} GstAVBRingAllocatorClass;
+
+typedef struct {
+	GstMemory mem;
+	struct tailq_entry *entry;
+} GstAVBRingMemory;
+
+#define GST_AVB_RING_MEMORY_TYPE	"AVBRingMemory"
+
+GType gst_avb_ring_allocator_get_type(void);
+G_DEFINE_TYPE (GstAVBRingAllocator, gst_avb_ring_allocator, GST_TYPE_ALLOCATOR);
+
+static GstAllocator *ring_allocator;
+
+static GstMemory *
+gst_avb_ring_allocator_alloc (GstAllocator * allocator, gsize size,
+			      GstAllocationParams * params)
+{
+	/* memories only come from wrapping received frames */
+	return NULL;
+}
+
+static void
+gst_avb_ring_allocator_free (GstAllocator * allocator, GstMemory * gmem)
+{
+	GstAVBRingMemory *mem = (GstAVBRingMemory *) gmem;
+	struct tailq_entry *q = mem->entry;
+
+	/* shares hold their parent, so only the parent owns the frame */
+	if (gmem->parent == NULL) {
+		pthread_mutex_lock(&(free_queue_lock));
+		q->payload_length = 0;
+		TAILQ_INSERT_TAIL(&free_queue, q, entries);
+		pthread_mutex_unlock(&(free_queue_lock));
+	}
+	g_slice_free (GstAVBRingMemory, mem);
+}
+
+static gpointer
+gst_avb_ring_mem_map (GstMemory * gmem, gsize maxsize, GstMapFlags flags)
+{
+	return ((GstAVBRingMemory *) gmem)->entry->payload_data;
+}
+
+static void
+gst_avb_ring_mem_unmap (GstMemory * gmem)
+{
+}
+
+static GstMemory *
+gst_avb_ring_mem_share (GstMemory * gmem, gssize offset, gssize size)
+{
+	GstAVBRingMemory *mem = (GstAVBRingMemory *) gmem;
+	GstAVBRingMemory *sub;
+	GstMemory *parent;
+
+	if ((parent = gmem->parent) == NULL)
+		parent = gmem;
+
+	if (size == -1)
+		size = gmem->size - offset;
+
+	sub = g_slice_new0 (GstAVBRingMemory);
+	gst_memory_init (GST_MEMORY_CAST (sub),
+			 GST_MINI_OBJECT_FLAGS (parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY,
+			 gmem->allocator, parent, gmem->maxsize, gmem->align,
+			 gmem->offset + offset, size);
+	sub->entry = mem->entry;
+
+	return GST_MEMORY_CAST (sub);
+}
+
+static void
+gst_avb_ring_allocator_class_init (GstAVBRingAllocatorClass * klass)
+{
+	GstAllocatorClass *allocator_class = (GstAllocatorClass *) klass;
+
+	allocator_class->alloc = gst_avb_ring_allocator_alloc;
+	allocator_class->free = gst_avb_ring_allocator_free;
+}
+
+static void
+gst_avb_ring_allocator_init (GstAVBRingAllocator * allocator)
+{
+	GstAllocator *alloc = GST_ALLOCATOR_CAST (allocator);
+
+	alloc->mem_type = GST_AVB_RING_MEMORY_TYPE;
+	alloc->mem_map = gst_avb_ring_mem_map;
+	alloc->mem_unmap = gst_avb_ring_mem_unmap;
+	alloc->mem_share = gst_avb_ring_mem_share;
+
+	GST_OBJECT_FLAG_SET (allocator, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+}
+
+/**
+ * ring_memory_wrap() - Wraps a received frame in a GstMemory
+ * @q: queue entry holding the whole received frame
+ *
+ * The memory covers just the payload. Ownership of @q passes to the
+ * memory until GStreamer frees it.
+ */
+static GstMemory *ring_memory_wrap(struct tailq_entry *q)
+{
+	GstAVBRingMemory *mem;
+
+	mem = g_slice_new0 (GstAVBRingMemory);
+	gst_memory_init (GST_MEMORY_CAST (mem), 0, ring_allocator, NULL,
+			 FRAME_SIZE, 0, q->payload_offset, q->payload_length);
+	mem->entry = q;
+
+	return GST_MEMORY_CAST (mem);
+}
+
 /**
  * start_feed_socket_init() - initializes the socket.
  *
@@ -329,19 +477,27 @@ void flag_exit_app(int flag)
 /**
  * initiliaze_queue() - Intializes the buffer queue
  * @max_size: the payload size of frame.
+ * @count: the number of buffers.
  *
  * Returns -EINVAL on error and zero on success.
  */
-static int initiliaze_queue(int32_t max_size)
+static int initiliaze_queue(int32_t max_size, int32_t count)
 {
 	int32_t i;
-	struct tailq_entry *q[NUM_OF_BUFFERS];
+	struct tailq_entry *q;
 
-	for (i = 0; i < NUM_OF_BUFFERS; i++) {
-		q[i] = (struct tailq_entry *) malloc(sizeof(struct tailq_entry));
-		q[i]->payload_length = 0;
-		q[i]->payload_data = malloc(max_size);
-		TAILQ_INSERT_TAIL(&free_queue, q[i], entries);
+	for (i = 0; i < count; i++) {
+		q = (struct tailq_entry *) malloc(sizeof(struct tailq_entry));
+		if (!q)
+			return -EINVAL;
+		q->payload_length = 0;
+		q->payload_offset = 0;
+		q->payload_data = malloc(max_size);
+		if (!q->payload_data) {
+			free(q);
+			return -EINVAL;
+		}
+		TAILQ_INSERT_TAIL(&free_queue, q, entries);
 	}
 
 	return 0;
@@ -405,6 +561,59 @@ int read_data_from_queue( void* ptr)
 	return i;
 }
 
+/**
+ * read_buffer_from_queue() - Gstreamer Callback to feed in data
+ * without copying it
+ * @last: set when the buffer holds the talker's final packet
+ *
+ * Used instead of read_data_from_queue() in zero-copy mode. Every packet
+ * queued since the last call, up to ZERO_COPY_MAX_PACKETS, goes out as one
+ * buffer with one memory per packet, so a frame the talker split across
+ * packets reaches appsrc whole. Each memory points into the received frame
+ * and gives it back to the receive loop once GStreamer releases it.
+ */
+GstBuffer *read_buffer_from_queue(gboolean *last)
+{
+	struct tailq_entry *q;
+	GstBuffer *buffer;
+	int n;
+
+	*last = FALSE;
+	while (!buffer_queue.tqh_first) {
+		usleep(1);
+	}
+
+	buffer = gst_buffer_new();
+	pthread_mutex_lock(&(buffer_queue_lock));
+	for (n = 0; n < ZERO_COPY_MAX_PACKETS; n++) {
+		q = buffer_queue.tqh_first;
+		if (q == NULL)
+			break;
+		TAILQ_REMOVE(&buffer_queue, q, entries);
+		gst_buffer_append_memory(buffer, ring_memory_wrap(q));
+
+		/* the talker ends the stream with a short packet */
+		if (q->payload_length != PAYLOAD_SIZE) {
+			*last = TRUE;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&(buffer_queue_lock));
+
+	return buffer;
+}
+
+/**
+ * read_buffer_max_bytes() - Bytes appsrc may hold in zero-copy mode
+ *
+ * Appsrc must report enough-data while half the frames are still free,
+ * or the receive loop runs out of frames before the talker pauses.
+ */
+guint64 read_buffer_max_bytes(void)
+{
+	return (guint64)PAYLOAD_SIZE * ZERO_COPY_NUM_OF_BUFFERS / 2;
+}
+
 /**
  * gstreamer_main_loop()- Initializes the gstreamer pipeline
  */
@@ -446,6 +655,12 @@ gst_avbsrc_create (GstPushSrc * psrc, GstBuffer ** buf)
 		signal(SIGINT, sigint_handler);
 
 		buff_size = PAYLOAD_SIZE;
+		if (g_zero_copy) {
+			/* frames are received straight into the queue entries */
+			buff_size = FRAME_SIZE;
+			ring_allocator = g_object_new(gst_avb_ring_allocator_get_type(), NULL);
+			gst_object_ref_sink(ring_allocator);
+		}
 
 		start_feed_socket_init();
 
@@ -502,7 +717,8 @@ gst_avbsrc_create (GstPushSrc * psrc, GstBuffer ** buf)
 		pthread_mutex_init(&(buffer_queue_lock), NULL);
 		pthread_mutex_init(&(free_queue_lock), NULL);
 
-		if (initiliaze_queue(buff_size) < 0)
+		if (initiliaze_queue(buff_size, g_zero_copy ?
+				     ZERO_COPY_NUM_OF_BUFFERS : NUM_OF_BUFFERS) < 0)
 			return -EINVAL;
 
 		err = pthread_create(&tid, NULL, gstreamer_main_loop, NULL);
@@ -524,6 +740,39 @@ gst_avbsrc_create (GstPushSrc * psrc, GstBuffer ** buf)
 		if (g_exit_app)
 			break;
 
+		if (g_zero_copy) {
+			while (!free_queue.tqh_first) {
+				usleep(1);
+			}
+
+			pthread_mutex_lock(&(free_queue_lock));
+			qptr = free_queue.tqh_first;
+			TAILQ_REMOVE(&free_queue, qptr, entries);
+			pthread_mutex_unlock(&(free_queue_lock));
+
+			err = recvfrom(socket_d, qptr->payload_data, FRAME_SIZE, 0, (struct sockaddr *) &ifsock_addr, (socklen_t *)&size);
+			if (err > (int)PAYLOAD_OFFSET) {
+				h1722 = (seventeen22_header *)(qptr->payload_data + sizeof(eth_header));
+				qptr->payload_offset = PAYLOAD_OFFSET;
+				qptr->payload_length = ntohs(h1722->length) - sizeof(six1883_header);
+			}
+			if (err <= (int)PAYLOAD_OFFSET ||
+			    qptr->payload_length > err - PAYLOAD_OFFSET) {
+				if (err <= 0)
+					printf("Failed to receive frame  !!!\n");
+				pthread_mutex_lock(&(free_queue_lock));
+				TAILQ_INSERT_TAIL(&free_queue, qptr, entries);
+				pthread_mutex_unlock(&(free_queue_lock));
+				continue;
+			}
+
+			pthread_mutex_lock(&(buffer_queue_lock));
+			TAILQ_INSERT_TAIL(&buffer_queue, qptr, entries);
+			pthread_mutex_unlock(&(buffer_queue_lock));
+			start_of_input_data = 1;
+			continue;
+		}
+
 		err = recvfrom(socket_d, frame, FRAME_SIZE, 0, (struct sockaddr *) &ifsock_addr, (socklen_t *)&size);
 		if (err > 0) {
 			while (!free_queue.tqh_first) {
@@ -20,6 +20,8 @@
 
 //Example:
 /* gst-launch-1.0 filesrc location=test.mp4 blocksize=1024 ! avbsink interface=eth0 */
+/* paced=true sends each buffer at the LaunchTime given by its PTS:
+ * gst-launch-1.0 filesrc location=test.mp4 blocksize=1024 ! avbsink interface=eth0 paced=true */
 
 
 
@@ -64,6 +66,13 @@
 #define STREAMID 0xABCDEF
 #define DEFAULT_INTERFACE "eth0"
 #define PACKET_IPG		125000	/* (1) packet every 125 usec */
+#define XMIT_DELAY		5000000	/* paced: first launch 5 ms after the first buffer */
+#define RENDER_DELAY		(XMIT_DELAY + 2000000)	/* paced: presentation 2 ms after launch */
+#define PACE_LEAD		20000000	/* paced: queue at most 20 ms ahead of the wire */
+#define XTS_SAMPLES		16	/* SYSTIM reads averaged per cross timestamp */
+#define XTS_REFRESH		1000	/* frames between cross timestamp refreshes */
+#define E1000_TQAVCTRL		0x03570
+#define E1000_TQAVCTRL_LAUNCH_VALID	0x00000200
 
 /* Global Variables */
 volatile int halt_tx = 0;
@@ -110,7 +119,8 @@ static GstStaticPadTemplate sink_template =
 enum
 {
 	PROP_0 = 0,
-	PROP_INTERFACE
+	PROP_INTERFACE,
+	PROP_PACED
 };
 
 
@@ -143,6 +153,10 @@ gst_avbsink_class_init (GstAvbSinkClass * klass)
 	g_object_class_install_property (gobject_class, PROP_INTERFACE,
 	g_param_spec_string ("interface", "Interface","Ethernet AVB Interface",
 			     interface1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (gobject_class, PROP_PACED,
+	g_param_spec_boolean ("paced", "Paced",
+			      "Send each buffer at the LaunchTime given by its PTS",
+			      FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 	gst_element_class_add_pad_template (gstelement_class,
 	gst_static_pad_template_get (&sink_template));
 	gst_element_class_set_static_metadata (gstelement_class, "AVB packet sender",
@@ -156,6 +170,8 @@ gst_avbsink_class_init (GstAvbSinkClass * klass)
 static void gst_avbsink_init (GstAvbSink * sink)
 {
 	sink->interface = interface1;
+	sink->paced = FALSE;
+	sink->have_base = FALSE;
 }
 
 static void
@@ -171,6 +187,12 @@ gst_avbsink_set_property (GObject * object, guint prop_id,
 			else
 				interface1 = g_value_dup_string (value);
 			break;
+		case PROP_PACED:
+			GST_AVBSINK (object)->paced = g_value_get_boolean (value);
+			/* the hardware paces the wire, not the pipeline clock */
+			gst_base_sink_set_sync (GST_BASE_SINK (object),
+						!GST_AVBSINK (object)->paced);
+			break;
 		default:
 			break;
 	}
@@ -185,6 +207,9 @@ gst_avbsink_get_property (GObject * object, guint prop_id, GValue * value,
 		case PROP_INTERFACE:
 			g_value_set_string (value, interface1);
 			break; 
+		case PROP_PACED:
+			g_value_set_boolean (value, GST_AVBSINK (object)->paced);
+			break;
 		default:
 			break;
 	}
@@ -327,6 +352,139 @@ int get_mac_addr(int8_t *interface)
 	  return 0;
 }
 
+/* Make the MAC honour igb_packet.attime as a LaunchTime */
+static void set_launch_valid(int enable)
+{
+	uint32_t tqavctrl;
+
+	if (igb_lock(&igb_dev))
+		return;
+	igb_readreg(&igb_dev, E1000_TQAVCTRL, &tqavctrl);
+	if (enable)
+		tqavctrl |= E1000_TQAVCTRL_LAUNCH_VALID;
+	else
+		tqavctrl &= ~E1000_TQAVCTRL_LAUNCH_VALID;
+	igb_writereg(&igb_dev, E1000_TQAVCTRL, tqavctrl);
+	igb_unlock(&igb_dev);
+}
+
+static void reclaim_packets(void)
+{
+	igb_clean(&igb_dev, &cleaned_packets);
+	while (cleaned_packets) {
+		tmp_packet = cleaned_packets;
+		cleaned_packets = cleaned_packets->next;
+		tmp_packet->next = free_packets;
+		free_packets = tmp_packet;
+	}
+}
+
+/*
+ * Paced mode: the buffer's PTS, relative to the first buffer, gives its
+ * LaunchTime in SYSTIM and its 1722 presentation time in gPTP time. The
+ * frame is queued for the i210 to send at that time, and the streaming
+ * thread only blocks while it is more than PACE_LEAD ahead of the wire or
+ * the ring has no free buffer. Sent buffers are reclaimed on completion.
+ */
+static GstFlowReturn
+gst_avbsink_render_paced (GstAvbSink * sink, GstBuffer * buff, GstMapInfo * info)
+{
+	GstClockTime pts = GST_BUFFER_PTS (buff);
+	uint64_t now, launch;
+	int err;
+
+	if (++sink->frames_since_xts >= XTS_REFRESH) {
+		igb_get_crosststamp(&igb_dev, XTS_SAMPLES, &sink->xts);
+		sink->frames_since_xts = 0;
+	}
+	if (igb_crosststamp_now(&sink->xts, &now) != 0)
+		return GST_FLOW_ERROR;
+
+	if (!sink->have_base) {
+		int shm_fd = -1;
+		char *shm_map = NULL;
+		gPtpTimeData td;
+
+		sink->ptp_offset = 0;
+		if (gptpinit(&shm_fd, &shm_map) == 0) {
+			if (gptpgetdata(shm_map, &td) == 0)
+				sink->ptp_offset = -td.ml_phoffset;
+			gptpdeinit(&shm_fd, &shm_map);
+		}
+		sink->pts_base = pts;
+		sink->launch_base = now + XMIT_DELAY;
+		sink->last_launch = sink->launch_base - PACKET_IPG;
+		sink->have_base = TRUE;
+		set_launch_valid(1);
+	}
+
+	if (GST_CLOCK_TIME_IS_VALID (pts) && GST_CLOCK_TIME_IS_VALID (sink->pts_base))
+		launch = sink->launch_base + (pts - sink->pts_base);
+	else
+		launch = sink->last_launch + PACKET_IPG;
+
+	if (launch < now + PACKET_IPG) {
+		/* late buffer: move the whole timeline so it goes out next */
+		GST_WARNING_OBJECT (sink, "buffer %" GST_TIME_FORMAT " late by %"
+				    G_GUINT64_FORMAT " ns", GST_TIME_ARGS (pts),
+				    now + PACKET_IPG - launch);
+		sink->launch_base += now + PACKET_IPG - launch;
+		launch = now + PACKET_IPG;
+	}
+	sink->last_launch = launch;
+
+	if (launch > now + PACE_LEAD)
+		usleep((launch - now - PACE_LEAD) / 1000);
+
+	while (NULL == free_packets) {
+		reclaim_packets();
+		if (NULL == free_packets)
+			usleep(PACKET_IPG / 1000);
+		if (halt_tx)
+			return GST_FLOW_EOS;
+	}
+	tmp_packet = free_packets;
+	free_packets = tmp_packet->next;
+
+	stream_packet = ((char *)tmp_packet->vaddr);
+	h1722 = (seventeen22_header *)((uint8_t*)stream_packet + sizeof(eth_header));
+	avb_set_1722_seq_number(h1722, seqnum++);
+	avb_set_1722_timestamp_valid(h1722, 1);
+	avb_set_1722_timestamp(h1722, htonl((uint32_t)(launch + sink->ptp_offset +
+					     RENDER_DELAY - XMIT_DELAY)));
+
+	data_ptr = (uint8_t *)((uint8_t*)stream_packet + sizeof(eth_header) +
+		sizeof(seventeen22_header) + sizeof(six1883_header));
+	memcpy((void *)data_ptr, info->data, MIN (info->size, payload_len));
+	total_read_bytes += payload_len;
+	total_samples += payload_len;
+	h61883 = (six1883_header *)((uint8_t*)stream_packet + sizeof(eth_header) + sizeof(seventeen22_header));
+	avb_set_61883_data_block_continuity(h61883, total_samples);
+
+	tmp_packet->attime = launch;
+	err = igb_xmit(&igb_dev, 0, tmp_packet);
+	if (err) {
+		tmp_packet->next = free_packets;
+		free_packets = tmp_packet;
+		if (ENOSPC == err) {
+			/* descriptor ring full: reclaim and try once more */
+			reclaim_packets();
+			tmp_packet = free_packets;
+			free_packets = tmp_packet->next;
+			err = igb_xmit(&igb_dev, 0, tmp_packet);
+			if (err) {
+				tmp_packet->next = free_packets;
+				free_packets = tmp_packet;
+			}
+		}
+		if (err)
+			GST_WARNING_OBJECT (sink, "dropped frame %lld", frame_sequence);
+	}
+	frame_sequence++;
+
+	return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_avbsink_render (GstBaseSink * bsink, GstBuffer * buff)
 {
@@ -448,6 +606,14 @@ gst_avbsink_render (GstBaseSink * bsink, GstBuffer * buff)
 		igb_cleanup();
 	}
 
+	if (GST_AVBSINK (bsink)->paced && listeners && !halt_tx) {
+		GstFlowReturn ret;
+
+		ret = gst_avbsink_render_paced (GST_AVBSINK (bsink), buff, &info);
+		gst_buffer_unmap (buff, &info);
+		return ret;
+	}
+
 	if (listeners && !halt_tx && avb_init) {
 start:
 		if (g_start_feeding == 2)
@@ -513,6 +679,8 @@ cleanup:
 
 exit_app:
 	  halt_tx = 1;
+	  if (GST_AVBSINK (bsink)->have_base)
+		  set_launch_valid(0);
 	  igb_set_class_bandwidth(&igb_dev, 0, 0, 0, 0);
 	  igb_dma_free_page(&igb_dev, &a_page);
 	  igb_detach(&igb_dev);
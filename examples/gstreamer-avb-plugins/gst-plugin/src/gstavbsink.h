@@ -25,6 +25,7 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
 #include <gio/gio.h>
+#include "igb.h"
 
 G_BEGIN_DECLS
 
@@ -44,6 +45,16 @@ struct _GstAvbSink {
     /* properties */
   gchar *interface;
   guint sourceid;
+  gboolean paced;
+
+    /* paced mode: buffer PTS to SYSTIM/gPTP mapping */
+  gboolean have_base;
+  GstClockTime pts_base;
+  guint64 launch_base;
+  guint64 last_launch;
+  gint64 ptp_offset;
+  guint frames_since_xts;
+  struct igb_crosststamp xts;
 };
 
 struct _GstAvbSinkClass {
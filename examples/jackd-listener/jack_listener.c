@@ -24,7 +24,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _GNU_SOURCE
 
 #include <errno.h>
+#include <math.h>
 #include <signal.h>
+#include <time.h>
 
 #include <pcap/pcap.h>
 #include <jack/jack.h>
@@ -32,6 +34,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <sndfile.h>
 
 #include "listener_mrp_client.h"
+#include "avb_gptp.h"
 
 #define LIBSND 1
 
@@ -53,9 +56,32 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define SAMPLE_SIZE (4)
 #define DEFAULT_RINGBUFFER_SIZE (32768)
 #define MAX_SAMPLE_VALUE ((1U << ((sizeof(int32_t) * 8) -1)) -1)
+#define AVTP_TIMESTAMP_OFFSET (ETHERNET_HEADER_SIZE + 12)
+#define AVTP_TV_BIT (0x01)
+#define FRAME_SIZE (SAMPLE_SIZE * CHANNELS)
+#define ANCHOR_RINGBUFFER_SIZE (1024) /* presentation times in flight */
+#define PLAYOUT_DLL_BW (0.5) /* Hz, bandwidth of the rate matching loop */
+#define PLAYOUT_MAX_DEV (0.005) /* limit of the resampling ratio around 1 */
 
 struct mrp_listener_ctx *ctx_sig;//Context pointer for signal handler
 
+/* presentation time of the sample frame with index 'frame' in the ringbuffer */
+struct playout_anchor {
+	uint64_t frame;
+	uint32_t timestamp;
+};
+
+/* state of the presentation time playout engine, owned by process_jack() */
+struct playout_state {
+	struct playout_anchor ref;
+	int have_ref;
+	uint64_t read_frame;	/* index of the next frame to read */
+	double pos;		/* fractional read position past read_frame */
+	double ratio;		/* input frames consumed per output frame */
+	double integ;		/* DLL integrator */
+	int locked;
+};
+
 struct ethernet_header{
 	u_char dst[6];
 	u_char src[6];
@@ -76,6 +102,13 @@ static jack_default_audio_sample_t** out;
 jack_ringbuffer_t* ringbuffer;
 jack_client_t* client;
 volatile int ready = 0;
+int playout = 0;
+int32_t playout_offset_ns = 0;
+jack_ringbuffer_t* anchors;
+uint64_t frames_written;
+struct playout_state pstate = { .ratio = 1.0 };
+int gptp_shm_fd = -1;
+char* gptp_mmap = NULL;
 
 static void help()
 {
@@ -85,6 +118,8 @@ static void help()
 		"Options:\n"
 		"    -h  show this message\n"
 		"    -i  specify interface for AVB connection\n"
+		"    -p  play out at the AVTP presentation time\n"
+		"    -l  with -p, extra playout latency in microseconds\n"
 		"\n" "%s" "\n", version_str);
 	exit(EXIT_FAILURE);
 }
@@ -125,8 +160,13 @@ void shutdown_and_exit(int sig)
 		fprintf(stdout, "jack\n");
 		jack_client_close(client);
 		jack_ringbuffer_free(ringbuffer);
+		if (NULL != anchors)
+			jack_ringbuffer_free(anchors);
 	}
 
+	if (NULL != gptp_mmap)
+		gptpdeinit(&gptp_shm_fd, &gptp_mmap);
+
 	if (sig != 0)
 		exit(EXIT_SUCCESS); /* actual signal */
 	else
@@ -158,6 +198,17 @@ void pcap_callback(u_char* args, const struct pcap_pkthdr* packet_header, const
 
 	mybuf = (uint32_t*) (packet + HEADER_SIZE);
 
+	if (playout && (packet[ETHERNET_HEADER_SIZE + 1] & AVTP_TV_BIT)) {
+		struct playout_anchor anchor;
+
+		anchor.frame = frames_written;
+		memcpy(&anchor.timestamp, packet + AVTP_TIMESTAMP_OFFSET,
+		       sizeof(anchor.timestamp));
+		anchor.timestamp = ntohl(anchor.timestamp);
+		if (jack_ringbuffer_write_space(anchors) >= sizeof(anchor))
+			jack_ringbuffer_write(anchors, (void*)&anchor, sizeof(anchor));
+	}
+
 	for(int i = 0; i < SAMPLES_PER_FRAME * CHANNELS; i+=CHANNELS) {
 
 		memcpy(&frame[0], &mybuf[i], sizeof(frame));
@@ -173,6 +224,7 @@ void pcap_callback(u_char* args, const struct pcap_pkthdr* packet_header, const
 
 		if ((cnt = jack_ringbuffer_write_space(ringbuffer)) >= SAMPLE_SIZE * CHANNELS) {
 			jack_ringbuffer_write(ringbuffer, (void*)&jackframe[0], SAMPLE_SIZE * CHANNELS);
+			frames_written++;
 
 		} else {
 			fprintf(stdout, "Only %i bytes available after %i samples.\n", cnt, total);
@@ -190,10 +242,163 @@ void pcap_callback(u_char* args, const struct pcap_pkthdr* packet_header, const
 	}
 }
 
+/* one sample of a frame 'index' frames past the ringbuffer read pointer */
+static inline float rb_sample(const jack_ringbuffer_data_t* vec, size_t index, int channel)
+{
+	size_t offset = index * FRAME_SIZE + channel * SAMPLE_SIZE;
+
+	/* frames never straddle the wrap: the ring size is a power of two */
+	if (offset < vec[0].len)
+		return *(const float*)(vec[0].buf + offset);
+	return *(const float*)(vec[1].buf + offset - vec[0].len);
+}
+
+/*
+ * gPTP time, in ns, at which the first frame of the buffer handed to JACK in
+ * this cycle leaves the playback port. JACK's period clock is moved to
+ * CLOCK_REALTIME and through the system model gptp publishes in its shm.
+ */
+static int playout_time(jack_nframes_t nframes, uint64_t* ptp)
+{
+	jack_nframes_t current_frames;
+	jack_time_t current_usecs, next_usecs;
+	float period_usecs;
+	jack_latency_range_t range;
+	gPtpSysModel model;
+	struct timespec now;
+	int64_t sys_offset;
+	uint64_t sys;
+	(void) nframes; /* unused */
+
+	if (jack_get_cycle_times(client, &current_frames, &current_usecs,
+				 &next_usecs, &period_usecs))
+		return -1;
+	if (gptpgetsysmodel(gptp_mmap, &model))
+		return -1;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	sys_offset = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec -
+		(int64_t)jack_get_time() * 1000;
+
+	jack_port_get_latency_range(outputports[0], JackPlaybackLatency, &range);
+	sys = next_usecs * 1000 + sys_offset +
+		(uint64_t)range.max * 1000000000ULL / jack_get_sample_rate(client);
+
+	return gptpsys2ptp(&model, sys, ptp) ? 0 : -1;
+}
+
+/* presentation time of the frame 'frame' from the nearest anchor */
+static uint32_t presentation_time(struct playout_state* ps, uint64_t frame)
+{
+	int64_t delta = (int64_t)(frame - ps->ref.frame);
+
+	return ps->ref.timestamp +
+		(uint32_t)(delta * 1000000000LL / SAMPLES_PER_SECOND);
+}
+
+/*
+ * Play the ringbuffer out so that each frame leaves the port at its AVTP
+ * presentation time. The phase error each cycle drives a second order DLL
+ * whose output is the resampling ratio, which tracks the talker's media
+ * clock against JACK's period clock. Errors of a period or more are fixed
+ * by dropping frames or inserting silence, and relock the loop.
+ */
+static void process_playout(jack_nframes_t nframes)
+{
+	struct playout_state* ps = &pstate;
+	const double rate = jack_get_sample_rate(client);
+	const double omega = 2 * M_PI * PLAYOUT_DLL_BW * nframes / rate;
+	jack_ringbuffer_data_t vec[2];
+	struct playout_anchor anchor;
+	size_t avail;
+	uint64_t ptp;
+	double err;
+	jack_nframes_t i = 0;
+
+	/* move the reference to the newest anchor not past the read position */
+	while (jack_ringbuffer_peek(anchors, (char*)&anchor, sizeof(anchor)) == sizeof(anchor)
+	       && (!ps->have_ref || anchor.frame <= ps->read_frame)) {
+		jack_ringbuffer_read_advance(anchors, sizeof(anchor));
+		ps->ref = anchor;
+		ps->have_ref = 1;
+	}
+
+	if (!ps->have_ref || playout_time(nframes, &ptp))
+		goto silence;
+
+	/* frames the read position is ahead (> 0) of its presentation time */
+	err = (int32_t)(presentation_time(ps, ps->read_frame) + playout_offset_ns
+			- (uint32_t)ptp) * rate / 1000000000.0 + ps->pos;
+
+	if (fabs(err) >= nframes) {
+		ps->locked = 0;
+		ps->integ = 0;
+		ps->ratio = 1.0;
+		ps->pos = 0;
+		/* early: hold the ringbuffer back */
+		if (err > 0)
+			goto silence;
+		/* late: drop what should already have been played */
+		avail = jack_ringbuffer_read_space(ringbuffer) / FRAME_SIZE;
+		if (avail > (size_t)-err)
+			avail = (size_t)-err;
+		jack_ringbuffer_read_advance(ringbuffer, avail * FRAME_SIZE);
+		ps->read_frame += avail;
+		goto silence;
+	}
+	if (!ps->locked) {
+		printf("playout locked\n");
+		ps->locked = 1;
+	}
+
+	/* DLL: consume slower while early, faster while late */
+	ps->integ += omega * omega * err;
+	ps->ratio = 1.0 - (sqrt(2) * omega * err + ps->integ) / nframes;
+	if (ps->ratio > 1.0 + PLAYOUT_MAX_DEV)
+		ps->ratio = 1.0 + PLAYOUT_MAX_DEV;
+	else if (ps->ratio < 1.0 - PLAYOUT_MAX_DEV)
+		ps->ratio = 1.0 - PLAYOUT_MAX_DEV;
+
+	jack_ringbuffer_get_read_vector(ringbuffer, vec);
+	avail = (vec[0].len + vec[1].len) / FRAME_SIZE;
+
+	for (; i < nframes; i++) {
+		size_t index = (size_t)ps->pos;
+		float frac = ps->pos - index;
+
+		if (index + 1 >= avail) {
+			printf ("underrun\n");
+			ps->locked = 0;
+			break;
+		}
+		for (int j = 0; j < CHANNELS; j++)
+			out[j][i] = rb_sample(vec, index, j) * (1 - frac) +
+				rb_sample(vec, index + 1, j) * frac;
+		ps->pos += ps->ratio;
+	}
+
+	avail = (size_t)ps->pos;
+	jack_ringbuffer_read_advance(ringbuffer, avail * FRAME_SIZE);
+	ps->read_frame += avail;
+	ps->pos -= avail;
+
+silence:
+	for (int j = 0; j < CHANNELS; j++)
+		memset(out[j] + i, 0, (nframes - i) * sizeof(jack_default_audio_sample_t));
+}
+
 static int process_jack(jack_nframes_t nframes, void* arg)
 {
 	(void) arg; /* unused */
 
+	if (playout) {
+		for(int i = 0; i < CHANNELS; i++) {
+			out[i] = jack_port_get_buffer(outputports[i], nframes);
+		}
+		process_playout(nframes);
+		return 0;
+	}
+
 	if (!ready) {
 		return 0;
 	}
@@ -259,6 +464,10 @@ jack_client_t* init_jack(struct mrp_listener_ctx *ctx)
 	out = (jack_default_audio_sample_t**) malloc (CHANNELS * sizeof (jack_default_audio_sample_t*));
 	ringbuffer = jack_ringbuffer_create (SAMPLE_SIZE * DEFAULT_RINGBUFFER_SIZE * CHANNELS);
 	jack_ringbuffer_mlock(ringbuffer);
+	if (playout) {
+		anchors = jack_ringbuffer_create (sizeof(struct playout_anchor) * ANCHOR_RINGBUFFER_SIZE);
+		jack_ringbuffer_mlock(anchors);
+	}
 
 	memset(out, 0, sizeof (jack_default_audio_sample_t*)*CHANNELS);
 	memset(ringbuffer->buf, 0, ringbuffer->size);
@@ -317,7 +526,7 @@ int main(int argc, char *argv[])
 	signal(SIGINT, shutdown_and_exit);
 
 	int c;
-	while((c = getopt(argc, argv, "hi:")) > 0)
+	while((c = getopt(argc, argv, "hi:pl:")) > 0)
 	{
 		switch (c)
 		{
@@ -327,6 +536,12 @@ int main(int argc, char *argv[])
 		case 'i':
 			dev = strdup(optarg);
 			break;
+		case 'p':
+			playout = 1;
+			break;
+		case 'l':
+			playout_offset_ns = strtol(optarg, NULL, 10) * 1000;
+			break;
 		default:
           		fprintf(stderr, "Unrecognized option!\n");
 		}
@@ -375,6 +590,11 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (playout && -1 == gptpinit(&gptp_shm_fd, &gptp_mmap)) {
+		fprintf(stderr, "GPTP init failed.\n");
+		return EXIT_FAILURE;
+	}
+
 	init_jack(ctx);
 
 	fprintf(stdout,"Waiting for talker...\n");
@@ -11,6 +11,7 @@
 #include "talker_mrp_client.h"
 
 extern volatile int glob_unleash_jack;
+extern int glob_paced;
 
 static jack_port_t** inputports;
 static jack_default_audio_sample_t** in;
@@ -25,10 +26,40 @@ void stop_jack(jack_client_t* client)
 	jack_ringbuffer_free(ringbuffer);
 }
 
+/*
+ * Interleave a whole period straight into the ringbuffer's free space and
+ * publish it with a single write advance. Returns -1 when it doesn't fit.
+ */
+static int interleave_period(jack_nframes_t nframes)
+{
+	jack_ringbuffer_data_t vec[2];
+	const size_t frame_bytes = CHANNELS * SAMPLE_SIZE;
+	jack_nframes_t done = 0;
+
+	jack_ringbuffer_get_write_vector(ringbuffer, vec);
+	if (vec[0].len + vec[1].len < nframes * frame_bytes)
+		return -1;
+
+	/* frames never straddle the wrap: the ring size is a power of two */
+	for (int v = 0; v < 2 && done < nframes; v++) {
+		jack_default_audio_sample_t *dst =
+			(jack_default_audio_sample_t *) vec[v].buf;
+		jack_nframes_t n = vec[v].len / frame_bytes;
+
+		if (n > nframes - done)
+			n = nframes - done;
+		for (jack_nframes_t i = 0; i < n; i++)
+			for (int j = 0; j < CHANNELS; j++)
+				*dst++ = in[j][done + i];
+		done += n;
+	}
+
+	jack_ringbuffer_write_advance(ringbuffer, nframes * frame_bytes);
+	return 0;
+}
+
 static int process(jack_nframes_t nframes, void* arg)
 {
-	int cnt;
-	static int total;
 	struct mrp_talker_ctx *ctx = (struct mrp_talker_ctx *) arg;
 
 	/* Do nothing until we're ready to begin. */
@@ -41,23 +72,16 @@ static int process(jack_nframes_t nframes, void* arg)
 		in[i] = jack_port_get_buffer(inputports[i], nframes);
 	}
 
-	for (size_t i = 0; i < nframes; i++) {
-		for(int j = 0; j < CHANNELS; j++) {
-			total++;
-			if ((cnt = jack_ringbuffer_write_space(ringbuffer)) >= SAMPLE_SIZE) {
-				jack_ringbuffer_write(ringbuffer,
-						(void*) (in[j]+i), SAMPLE_SIZE);
-				if (total % 5000 == 0) {
-					printf ("Available writespace: %i\n", cnt);
-				}
-			} else {
-				printf ("Only %i bytes available after %i samples\n",
-						cnt, total);
-				ctx->halt_tx = 1;
-			}
-		}
+	if (interleave_period(nframes)) {
+		printf ("Only %zu bytes available for a period of %u frames\n",
+				jack_ringbuffer_write_space(ringbuffer), nframes);
+		ctx->halt_tx = 1;
 	}
 
+	/* a paced packetizer polls the ringbuffer on its own schedule */
+	if (glob_paced)
+		return 0;
+
 	if (0 == pthread_mutex_trylock(&threadLock))
 	{
 		pthread_cond_signal(&dataReady);
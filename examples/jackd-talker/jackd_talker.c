@@ -43,6 +43,7 @@
 #include <sys/mman.h>
 #include <sys/socket.h>
 #include <linux/if.h>
+#include <time.h>
 
 #include <pci/pci.h>
 #include <jack/jack.h>
@@ -60,6 +61,12 @@
 #define RENDER_DELAY (XMIT_DELAY+2000000) /* us */
 #define PACKET_IPG (125000) /* (1) packet every 125 usec */
 #define PKT_SZ (100)
+#define PACE_LEAD (2000000) /* paced mode: queue frames 2 ms ahead of launch */
+#define PACE_MIN (500000) /* paced mode: resync when launch is closer than this */
+#define XTS_SAMPLES (16) /* SYSTIM reads averaged per cross timestamp */
+#define XTS_REFRESH (8000) /* frames between cross timestamp refreshes */
+#define E1000_TQAVCTRL (0x03570)
+#define E1000_TQAVCTRL_LAUNCH_VALID (0x00000200)
 volatile int *halt_tx_sig;//Global variable for signal handler
 
 typedef long double FrequencyRatio;
@@ -71,6 +78,8 @@ static const char *version_str = "simple_talker v" VERSION_STR "\n"
 
 device_t glob_igb_dev;
 volatile int glob_unleash_jack = 0;
+int glob_paced = 0;
+struct igb_crosststamp glob_xts;
 pthread_t glob_packetizer_id;
 u_int64_t glob_last_time;
 int glob_seqnum;
@@ -131,17 +140,98 @@ static void usage(void)
 		"options:\n"
 		"    -h  show this message\n"
 		"    -i  specify interface for AVB connection\n"
+		"    -p  pace transmission by LaunchTime instead of JACK wakeups\n"
 		"\n" "%s" "\n", version_str);
 	exit(EXIT_FAILURE);
 }
 
-static void* packetizer_thread(void *arg) {
+/* Make the MAC honour igb_packet.attime as a LaunchTime */
+static void set_launch_valid(int enable)
+{
+	u_int32_t tqavctrl;
+
+	if (igb_lock(&glob_igb_dev))
+		return;
+	igb_readreg(&glob_igb_dev, E1000_TQAVCTRL, &tqavctrl);
+	if (enable)
+		tqavctrl |= E1000_TQAVCTRL_LAUNCH_VALID;
+	else
+		tqavctrl &= ~E1000_TQAVCTRL_LAUNCH_VALID;
+	igb_writereg(&glob_igb_dev, E1000_TQAVCTRL, tqavctrl);
+	igb_unlock(&glob_igb_dev);
+}
+
+static void reclaim_packets(void)
+{
 	struct igb_packet *cleaned_packets;
-	struct mrp_talker_ctx *ctx = (struct mrp_talker_ctx *)arg;
+
+	igb_clean(&glob_igb_dev, &cleaned_packets);
+	while (cleaned_packets) {
+		glob_tmp_packet = cleaned_packets;
+		cleaned_packets = cleaned_packets->next;
+		glob_tmp_packet->next = glob_free_packets;
+		glob_free_packets = glob_tmp_packet;
+	}
+}
+
+/*
+ * Packetize one frame of interleaved samples and queue it for the next
+ * launch slot. Returns 0 when queued, ENOSPC when the frame has to be
+ * tried again after reclaiming buffers.
+ */
+static int send_frame(const jack_default_audio_sample_t *framebuf)
+{
+	static unsigned total_samples = 0;
 	six1883_sample *sample;
-	unsigned total_samples = 0;
 	int err;
 	int i;
+
+	glob_tmp_packet = glob_free_packets;
+	if (NULL == glob_tmp_packet)
+		return ENOSPC;
+	glob_header1722 =
+		(seventeen22_header *) (((char *)glob_tmp_packet->vaddr) + 18);
+	glob_header61883 = (six1883_header *) (glob_header1722 + 1);
+	glob_free_packets = glob_tmp_packet->next;
+
+	/* unfortuntely unless this thread is at rtprio
+	 * you get pre-empted between fetching the time
+	 * and programming the packet and get a late packet
+	 */
+	glob_tmp_packet->attime = glob_last_time + PACKET_IPG;
+
+	avb_61883_hdr_stamp(glob_header1722, NULL, glob_seqnum,
+			    (glob_seqnum + 1) % 4 != 0, glob_time_stamp, 32,
+			    total_samples);
+	sample =
+		(six1883_sample *) (((char *)glob_tmp_packet->vaddr) +
+				(18 + sizeof(seventeen22_header) +
+				 sizeof(six1883_header)));
+
+	for (i = 0; i < SAMPLES_PER_FRAME * CHANNELS; ++i) {
+		uint32_t tmp = htonl(MAX_SAMPLE_VALUE * framebuf[i]);
+		sample[i].label = 0x40;
+		memcpy(&(sample[i].value), &(tmp),
+				sizeof(sample[i].value));
+	}
+
+	err = igb_xmit(&glob_igb_dev, 0, glob_tmp_packet);
+	if (err) {
+		/* put back for now */
+		glob_tmp_packet->next = glob_free_packets;
+		glob_free_packets = glob_tmp_packet;
+		return ENOSPC;
+	}
+
+	glob_seqnum++;
+	glob_last_time += PACKET_IPG;
+	glob_time_stamp += PACKET_IPG;
+	total_samples += SAMPLES_PER_FRAME*CHANNELS;
+	return 0;
+}
+
+static void* packetizer_thread(void *arg) {
+	struct mrp_talker_ctx *ctx = (struct mrp_talker_ctx *)arg;
 	(void) arg; /* unused */
 
 	const size_t bytes_to_read = CHANNELS * SAMPLES_PER_FRAME *
@@ -158,73 +248,66 @@ static void* packetizer_thread(void *arg) {
 		pthread_cond_wait(&dataReady, &threadLock);
 
 		while ((jack_ringbuffer_read_space(ringbuffer) >= bytes_to_read)) {
-
-			glob_tmp_packet = glob_free_packets;
-			if (NULL == glob_tmp_packet)
-				goto cleanup;
-			glob_header1722 =
-				(seventeen22_header *) (((char *)glob_tmp_packet->vaddr) + 18);
-			glob_header61883 = (six1883_header *) (glob_header1722 + 1);
-			glob_free_packets = glob_tmp_packet->next;
-
-			/* unfortuntely unless this thread is at rtprio
-			 * you get pre-empted between fetching the time
-			 * and programming the packet and get a late packet
-			 */
-			glob_tmp_packet->attime = glob_last_time + PACKET_IPG;
-			glob_last_time += PACKET_IPG;
-
-			jack_ringbuffer_read (ringbuffer, (char*)&framebuf[0], bytes_to_read);
-
-			glob_header1722->seq_number = glob_seqnum++;
-			if (glob_seqnum % 4 == 0)
-				glob_header1722->timestamp_valid = 0;
-
-			else
-				glob_header1722->timestamp_valid = 1;
-
-			glob_time_stamp = htonl(glob_time_stamp);
-			glob_header1722->timestamp = glob_time_stamp;
-			glob_time_stamp = ntohl(glob_time_stamp);
-			glob_time_stamp += PACKET_IPG;
-			glob_header61883->data_block_continuity = total_samples;
-			total_samples += SAMPLES_PER_FRAME*CHANNELS;
-			sample =
-				(six1883_sample *) (((char *)glob_tmp_packet->vaddr) +
-						(18 + sizeof(seventeen22_header) +
-						 sizeof(six1883_header)));
-
-			for (i = 0; i < SAMPLES_PER_FRAME * CHANNELS; ++i) {
-				uint32_t tmp = htonl(MAX_SAMPLE_VALUE * framebuf[i]);
-				sample[i].label = 0x40;
-				memcpy(&(sample[i].value), &(tmp),
-						sizeof(sample[i].value));
+			jack_ringbuffer_peek (ringbuffer, (char*)&framebuf[0], bytes_to_read);
+			if (send_frame(framebuf)) {
+				reclaim_packets();
+				continue;
 			}
+			jack_ringbuffer_read_advance (ringbuffer, bytes_to_read);
+		}
+	}
+	free(framebuf);
+	return NULL;
+}
 
-			err = igb_xmit(&glob_igb_dev, 0, glob_tmp_packet);
+/*
+ * Paced packetizer: rather than waiting for JACK to signal each period, keep
+ * the transmit queue PACE_LEAD ahead of SYSTIM and let LaunchTime release
+ * the frames on their 125 usec slots. A late period then costs at most the
+ * frames it didn't deliver in time instead of a burst of a whole period.
+ */
+static void* paced_packetizer_thread(void *arg) {
+	struct mrp_talker_ctx *ctx = (struct mrp_talker_ctx *)arg;
+	const size_t bytes_to_read = CHANNELS * SAMPLES_PER_FRAME *
+		SAMPLE_SIZE;
+	jack_default_audio_sample_t* framebuf = malloc (bytes_to_read);
+	const struct timespec nap = { 0, PACKET_IPG };
+	extern jack_ringbuffer_t* ringbuffer;
+	unsigned frames = 0;
+	uint64_t now;
 
-			if (!err) {
-				continue;
-			}
+	while (ctx->listeners && !ctx->halt_tx) {
+		if (++frames % XTS_REFRESH == 0)
+			igb_get_crosststamp(&glob_igb_dev, XTS_SAMPLES, &glob_xts);
+		if (igb_crosststamp_now(&glob_xts, &now) != 0)
+			break;
 
-			if (ENOSPC == err) {
+		if (glob_last_time + PACKET_IPG < now + PACE_MIN) {
+			/*
+			 * Startup or an underrun: move launch and presentation
+			 * times forward together, in whole slots.
+			 */
+			uint64_t skip = now + PACE_LEAD - glob_last_time;
 
-				/* put back for now */
-				glob_tmp_packet->next = glob_free_packets;
-				glob_free_packets = glob_tmp_packet;
-			}
+			skip -= skip % PACKET_IPG;
+			glob_last_time += skip;
+			glob_time_stamp += skip;
+		}
 
-cleanup:		igb_clean(&glob_igb_dev, &cleaned_packets);
-			i = 0;
-			while (cleaned_packets) {
-			    i++;
-			    glob_tmp_packet = cleaned_packets;
-			    cleaned_packets = cleaned_packets->next;
-			    glob_tmp_packet->next = glob_free_packets;
-			    glob_free_packets = glob_tmp_packet;
-			}
+		if (glob_last_time + PACKET_IPG > now + PACE_LEAD ||
+		    jack_ringbuffer_read_space(ringbuffer) < bytes_to_read) {
+			clock_nanosleep(CLOCK_MONOTONIC, 0, &nap, NULL);
+			continue;
 		}
+
+		jack_ringbuffer_peek (ringbuffer, (char*)&framebuf[0], bytes_to_read);
+		if (send_frame(framebuf)) {
+			reclaim_packets();
+			continue;
+		}
+		jack_ringbuffer_read_advance (ringbuffer, bytes_to_read);
 	}
+	free(framebuf);
 	return NULL;
 }
 
@@ -248,6 +331,7 @@ int main(int argc, char *argv[])
 	int rc = 0;
 	char *interface = NULL;
 	gPtpTimeData td;
+	struct avb_61883_hdr hdr_fields;
 	uint64_t now_local, now_8021as;
 	uint64_t update_8021as;
 	unsigned delta_8021as, delta_local;
@@ -257,7 +341,7 @@ int main(int argc, char *argv[])
 	struct mrp_domain_attr *class_b = malloc(sizeof(struct mrp_domain_attr));
 
 	for (;;) {
-		c = getopt(argc, argv, "hi:");
+		c = getopt(argc, argv, "hi:p");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -272,6 +356,9 @@ int main(int argc, char *argv[])
 			}
 			interface = strdup(optarg);
 			break;
+		case 'p':
+			glob_paced = 1;
+			break;
 		}
 	}
 	if (optind < argc)
@@ -341,6 +428,20 @@ int main(int argc, char *argv[])
 	memset(glob_stream_id, 0, sizeof(glob_stream_id));
 	memcpy(glob_stream_id, glob_station_addr, sizeof(glob_station_addr));
 
+	memset(&hdr_fields, 0, sizeof(hdr_fields));
+	hdr_fields.sid_valid = 1;
+	hdr_fields.stream_id = avb_get_be64(glob_stream_id);
+	hdr_fields.length = 32;
+	hdr_fields.format_tag = 1;
+	hdr_fields.packet_channel = 0x1F;
+	hdr_fields.packet_tcode = 0xA;
+	hdr_fields.source_id = 0x3F;
+	hdr_fields.data_block_size = 1;
+	hdr_fields.eoh = 0x2;
+	hdr_fields.format_id = 0x10;
+	hdr_fields.format_dependent_field = 0x02;
+	hdr_fields.syt = 0xFFFF;
+
 	a_packet.dmatime = a_packet.attime = a_packet.flags = 0;
 	a_packet.map.paddr = a_page.dma_paddr;
 	a_packet.map.mmap_size = a_page.mmap_size;
@@ -379,35 +480,8 @@ int main(int argc, char *argv[])
 		/* 1722 header update + payload */
 		glob_header1722 =
 		    (seventeen22_header *) (((char *)glob_tmp_packet->vaddr) + 18);
-		glob_header1722->cd_indicator = 0;
-		glob_header1722->subtype = 0;
-		glob_header1722->sid_valid = 1;
-		glob_header1722->version = 0;
-		glob_header1722->reset = 0;
-		glob_header1722->reserved0 = 0;
-		glob_header1722->gateway_valid = 0;
-		glob_header1722->reserved1 = 0;
-		glob_header1722->timestamp_uncertain = 0;
-		memset(&(glob_header1722->stream_id), 0, sizeof(glob_header1722->stream_id));
-		memcpy(&(glob_header1722->stream_id), glob_station_addr,
-		       sizeof(glob_station_addr));
-		glob_header1722->length = htons(32);
+		avb_61883_hdr_compose(glob_header1722, &hdr_fields);
 		glob_header61883 = (six1883_header *) (glob_header1722 + 1);
-		glob_header61883->format_tag = 1;
-		glob_header61883->packet_channel = 0x1F;
-		glob_header61883->packet_tcode = 0xA;
-		glob_header61883->app_control = 0x0;
-		glob_header61883->reserved0 = 0;
-		glob_header61883->source_id = 0x3F;
-		glob_header61883->data_block_size = 1;
-		glob_header61883->fraction_number = 0;
-		glob_header61883->quadlet_padding_count = 0;
-		glob_header61883->source_packet_header = 0;
-		glob_header61883->reserved1 = 0;
-		glob_header61883->eoh = 0x2;
-		glob_header61883->format_id = 0x10;
-		glob_header61883->format_dependent_field = 0x02;
-		glob_header61883->syt = 0xFFFF;
 		glob_tmp_packet->len =
 		    18 + sizeof(seventeen22_header) + sizeof(six1883_header) +
 		    (SAMPLES_PER_FRAME * CHANNELS * sizeof(six1883_sample));
@@ -449,21 +523,36 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	if( igb_get_wallclock( &glob_igb_dev, &now_local, NULL ) != 0 ) {
+	if (igb_get_crosststamp(&glob_igb_dev, XTS_SAMPLES, &glob_xts) != 0) {
 	  fprintf( stderr, "Failed to get wallclock time\n" );
 	  return EXIT_FAILURE;
 	}
+	if (igb_crosststamp_now(&glob_xts, &now_local) != 0)
+		now_local = glob_xts.systim;
 	update_8021as = td.local_time - td.ml_phoffset;
 	delta_local = (unsigned)(now_local - td.local_time);
 	delta_8021as = (unsigned)(td.ml_freqoffset * delta_local);
 	now_8021as = update_8021as + delta_8021as;
 
-	glob_last_time = now_local + XMIT_DELAY;
-	glob_time_stamp = now_8021as + RENDER_DELAY;
+	if (glob_paced) {
+		/* the packetizer keeps just PACE_LEAD queued ahead of SYSTIM */
+		glob_last_time = now_local + PACE_LEAD;
+		glob_time_stamp = now_8021as + PACE_LEAD + RENDER_DELAY - XMIT_DELAY;
+	} else {
+		glob_last_time = now_local + XMIT_DELAY;
+		glob_time_stamp = now_8021as + RENDER_DELAY;
+	}
 
 	rc = nice(-20);
 
-	pthread_create (&glob_packetizer_id, NULL, packetizer_thread, (void *)ctx);
+	if (glob_paced) {
+		set_launch_valid(1);
+		pthread_create (&glob_packetizer_id, NULL, paced_packetizer_thread,
+				(void *)ctx);
+	} else {
+		pthread_create (&glob_packetizer_id, NULL, packetizer_thread,
+				(void *)ctx);
+	}
 	run_packetizer();
 
 	rc = nice(0);
@@ -479,6 +568,8 @@ int main(int argc, char *argv[])
 	if (rc)
 		printf("mrp_unadvertise_stream failed\n");
 
+	if (glob_paced)
+		set_launch_valid(0);
 	igb_set_class_bandwidth(&glob_igb_dev, 0, 0, 0, 0);	/* disable Qav */
 
 	rc = mrp_disconnect(ctx);
@@ -16,6 +16,8 @@
   *
   */
 
+#define _GNU_SOURCE
+
 #include <arpa/inet.h>
 #include <errno.h>
 #include <linux/if.h>
@@ -23,6 +25,7 @@
 #include <pthread.h>
 #include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 
 #include <pci/pci.h>
 
@@ -31,6 +34,9 @@
 
 #define USE_MRPD 1
 
+/* frames pulled in per recvmmsg() and written out per writev() */
+#define RX_BATCH 32
+
 /* globals */
 
 unsigned char glob_dest_addr[] = { 0x91, 0xE0, 0xF0, 0x00, 0x0E, 0x80 };
@@ -70,8 +76,13 @@ int main(int argc, char *argv[ ])
 	char *iface;
 	seventeen22_header *h1722;
 	long long int frame_sequence = 0;
-	unsigned char frame[MAX_FRAME_SIZE];
-	int size, length;
+	static unsigned char frames[RX_BATCH][MAX_FRAME_SIZE];
+	struct mmsghdr msgs[RX_BATCH];
+	struct iovec rx_iov[RX_BATCH];
+	struct iovec out_iov[RX_BATCH];
+	struct iovec *out;
+	int i, n, count, length;
+	ssize_t written;
 	struct sched_param sched;
 	struct mrp_listener_ctx *ctx = malloc(sizeof(struct mrp_listener_ctx));
 	struct mrp_domain_attr *class_a = malloc(sizeof(struct mrp_domain_attr));
@@ -181,9 +192,14 @@ int main(int argc, char *argv[ ])
 		return EINVAL;
 	}
 
-	size = sizeof(ifsock_addr);
 	frame_sequence = 0;
-	memset(frame, 0, sizeof(frame));
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < RX_BATCH; i++) {
+		rx_iov[i].iov_base = frames[i];
+		rx_iov[i].iov_len = MAX_FRAME_SIZE;
+		msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
 
 	memset(&sched, 0, sizeof sched);
 	sched.sched_priority = 1;
@@ -192,19 +208,51 @@ int main(int argc, char *argv[ ])
 		fprintf(stderr, "Failed to select RR scheduler: %s (%d)\n",
 			strerror(errno), errno);
 
+	/*
+	 * Block for the first frame, then take whatever else has queued up
+	 * and hand all payloads to stdout in a single writev().
+	 */
 	while (1) {
-		error = recvfrom(socket_descriptor, frame, MAX_FRAME_SIZE, 0, (struct sockaddr *) &ifsock_addr, (socklen_t *)&size);
-		if (error > 0) {
-			fprintf(stderr,"frame sequence = %lld\n", frame_sequence++);
-			h1722 = (seventeen22_header *)((uint8_t*)frame + sizeof(eth_header));
+		n = recvmmsg(socket_descriptor, msgs, RX_BATCH, MSG_WAITFORONE, NULL);
+		if (n <= 0) {
+			fprintf(stderr,"recvmmsg() error for frame sequence = %lld: %s\n",
+				frame_sequence, strerror(errno));
+			continue;
+		}
+
+		count = 0;
+		for (i = 0; i < n; i++) {
+			frame_sequence++;
+			h1722 = (seventeen22_header *)(frames[i] + sizeof(eth_header));
 			length = ntohs(h1722->length) - sizeof(six1883_header);
-			rc = write(1, (uint8_t *)((uint8_t*)frame + sizeof(eth_header) + sizeof(seventeen22_header) +
-				sizeof(six1883_header)), length);
-			if (rc == -1) {
-				fprintf(stderr, "Failed to write %d bytes: %s (%d)\n", length, strerror(errno), errno);
+			if (length <= 0 || msgs[i].msg_len < sizeof(eth_header) + sizeof(seventeen22_header) +
+					sizeof(six1883_header) + length)
+				continue;
+			out_iov[count].iov_base = frames[i] + sizeof(eth_header) +
+				sizeof(seventeen22_header) + sizeof(six1883_header);
+			out_iov[count].iov_len = length;
+			count++;
+		}
+
+		out = out_iov;
+		while (count > 0) {
+			written = writev(1, out, count);
+			if (written < 0) {
+				if (errno == EINTR)
+					continue;
+				fprintf(stderr, "Failed to write payloads: %s (%d)\n", strerror(errno), errno);
+				break;
+			}
+			/* step over what a short write consumed */
+			while (count > 0 && (size_t)written >= out->iov_len) {
+				written -= out->iov_len;
+				out++;
+				count--;
+			}
+			if (count > 0) {
+				out->iov_base = (uint8_t *)out->iov_base + written;
+				out->iov_len -= written;
 			}
-		} else {
-			fprintf(stderr,"recvfrom() error for frame sequence = %lld\n", frame_sequence++);
 		}
 	}
 
@@ -18,9 +18,13 @@
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <linux/if.h>
 #include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include <pci/pci.h>
 
@@ -32,6 +36,22 @@
 #define STREAMID (0xABCDEF)
 #define PACKET_IPG (125000) /* 1 packet every 125 usec */
 
+/*
+ * The transmit loop wakes once per PACE_PERIOD and sends as many frames as
+ * the reservation allows in that time (PACE_PERIOD / PACKET_IPG), never more
+ * than PACE_BURST periods worth after a late wakeup.
+ */
+#define PACE_PERIOD (1000000)
+#define PACE_BURST (4)
+
+struct input_src {
+	int fd;
+	uint8_t *map;	/* regular file mapped in, NULL for pipes */
+	size_t map_len;
+	size_t map_off;
+	int eof;
+};
+
 /* globals */
 
 uint32_t glob_payload_length;
@@ -41,22 +61,6 @@ unsigned char glob_stream_id[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
 unsigned char glob_dest_addr[] = { 0x91, 0xE0, 0xF0, 0x00, 0x0E, 0x80 };
 volatile int *halt_tx_sig;//Global variable for signal handler
 
-uint64_t reverse_64(uint64_t val)
-{
-	uint32_t low, high;
-
-	low = val & 0xffffffff;
-	high = (val >> 32) & 0xffffffff;
-	low = htonl(low);
-	high = htonl(high);
-
-	val = 0;
-	val = val | low;
-	val = (val << 32) | high;
-
-	return val;
-}
-
 void sigint_handler(int signum)
 {
 	fprintf(stderr, "got SIGINT\n");
@@ -87,6 +91,70 @@ int get_mac_addr(int8_t *iface)
 	return 0;
 }
 
+/*
+ * Regular files are mapped and copied straight into the DMA payloads.
+ * Anything else (typically a pipe from an encoder) is switched to
+ * non-blocking so a slow producer can never stall the paced transmit loop.
+ */
+int input_open(struct input_src *in, int fd)
+{
+	struct stat st;
+	void *map;
+	int flags;
+
+	memset(in, 0, sizeof(*in));
+	in->fd = fd;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			in->map = map;
+			in->map_len = st.st_size;
+			return 0;
+		}
+	}
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0)
+		return -1;
+	return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+void input_close(struct input_src *in)
+{
+	if (in->map)
+		munmap(in->map, in->map_len);
+	in->map = NULL;
+}
+
+/*
+ * Copy up to len bytes of input to dst. Returns the number of bytes copied,
+ * 0 when nothing is available right now and -1 on a read error.
+ */
+ssize_t input_fill(struct input_src *in, uint8_t *dst, size_t len)
+{
+	ssize_t n;
+
+	if (in->map) {
+		n = in->map_len - in->map_off;
+		if ((size_t)n > len)
+			n = len;
+		memcpy(dst, in->map + in->map_off, n);
+		in->map_off += n;
+		if (in->map_off == in->map_len)
+			in->eof = 1;
+		return n;
+	}
+
+	n = read(in->fd, dst, len);
+	if (n == 0)
+		in->eof = 1;
+	else if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		n = 0;
+	return n;
+}
+
 int main(int argc, char *argv[])
 {
 	device_t igb_dev;
@@ -96,7 +164,7 @@ int main(int argc, char *argv[])
 	struct igb_packet *cleaned_packets;
 	struct igb_packet *free_packets;
 	struct mrp_talker_ctx *ctx = malloc(sizeof(struct mrp_talker_ctx));
-	six1883_header *h61883;
+	struct avb_61883_hdr hdr_fields;
 	seventeen22_header *h1722;
 	unsigned i;
 	int err, seq_number, frame_size;
@@ -107,6 +175,13 @@ int main(int argc, char *argv[])
 	uint8_t *data_ptr;
 	void *stream_packet;
 	long long int frame_sequence = 0;
+	long long int tx_failed = 0;
+	struct igb_packet *cur_packet = NULL;
+	struct input_src input;
+	struct timespec next;
+	uint32_t fill = 0;
+	unsigned held = 0;
+	int credit = 0;
 	struct sched_param sched;
 	struct mrp_domain_attr *class_a = malloc(sizeof(struct mrp_domain_attr));
 	struct mrp_domain_attr *class_b = malloc(sizeof(struct mrp_domain_attr));
@@ -199,29 +274,21 @@ int main(int argc, char *argv[])
 
 	stream_packet = avb_create_packet(glob_payload_length);
 
-	h1722 = (seventeen22_header *)((uint8_t*)stream_packet + sizeof(eth_header));
-	h61883 = (six1883_header *)((uint8_t*)stream_packet + sizeof(eth_header) +
-					sizeof(seventeen22_header));
-
-	/*initalize h1722 header */
-	avb_initialize_h1722_to_defaults(h1722);
-	/* set the length */
-	avb_set_1722_length(h1722, htons(glob_payload_length + sizeof(six1883_header)));
-	avb_set_1722_stream_id(h1722,reverse_64(STREAMID));
-	avb_set_1722_sid_valid(h1722, 0x1);
-
-
-	/*initalize h61883 header */
-	avb_initialize_61883_to_defaults(h61883);
-	avb_set_61883_format_tag(h61883, 0x1);
-	avb_set_61883_packet_channel(h61883, 0x1f);
-	avb_set_61883_packet_tcode(h61883, 0xa);
-	avb_set_61883_source_id(h61883 , 0x3f);
-	avb_set_61883_data_block_size(h61883, 0x1);
-	avb_set_61883_eoh(h61883, 0x2);
-	avb_set_61883_format_id(h61883, 0x10);
-	avb_set_61883_format_dependent_field(h61883, 0x2);
-	avb_set_61883_syt(h61883, 0xffff);
+	/* initialize the h1722 and h61883 headers */
+	memset(&hdr_fields, 0, sizeof(hdr_fields));
+	hdr_fields.sid_valid = 1;
+	hdr_fields.stream_id = STREAMID;
+	hdr_fields.length = glob_payload_length + sizeof(six1883_header);
+	hdr_fields.format_tag = 1;
+	hdr_fields.packet_channel = 0x1f;
+	hdr_fields.packet_tcode = 0xa;
+	hdr_fields.source_id = 0x3f;
+	hdr_fields.data_block_size = 1;
+	hdr_fields.eoh = 0x2;
+	hdr_fields.format_id = 0x10;
+	hdr_fields.format_dependent_field = 0x2;
+	hdr_fields.syt = 0xffff;
+	avb_61883_hdr_compose((uint8_t*)stream_packet + sizeof(eth_header), &hdr_fields);
 
 	/* initilaze the source & destination mac address */
 	avb_eth_header_set_mac(stream_packet, glob_dest_addr, iface);
@@ -277,53 +344,31 @@ int main(int argc, char *argv[])
 	sched.sched_priority = 1;
 	sched_setscheduler(0, SCHED_RR, &sched);
 
+	err = input_open(&input, 0);
+	if (err) {
+		fprintf(stderr, "failed to set up STDIN (%s)\n", strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	/*
+	 * Frames go out at the rate the stream reserved, not at the rate input
+	 * arrives. Input is read straight into the payload of the frame being
+	 * built; a partially filled frame is held for one period to let more
+	 * input coalesce into it and is then sent short.
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &next);
 	while (ctx->listeners && !ctx->halt_tx)
 	{
-		tmp_packet = free_packets;
-		if (NULL == tmp_packet)
-			goto cleanup;
-
-		stream_packet = ((char *)tmp_packet->vaddr);
-		free_packets = tmp_packet->next;
-
-		/* unfortuntely unless this thread is at rtprio
-		 * you get pre-empted between fetching the time
-		 * and programming the packet and get a late packet
-		 */
-		h1722 = (seventeen22_header *)((uint8_t*)stream_packet + sizeof(eth_header));
-		avb_set_1722_seq_number(h1722, seq_number++);
-		if (seq_number % 4 == 0)
-			avb_set_1722_timestamp_valid(h1722, 0);
-		else
-			avb_set_1722_timestamp_valid(h1722, 1);
-
-		data_ptr = (uint8_t *)((uint8_t*)stream_packet + sizeof(eth_header) + sizeof(seventeen22_header)
-					+ sizeof(six1883_header));
-
-		read_bytes = read(0, (void *)data_ptr, glob_payload_length);
-		/* Error case while reading the input file */
-		if (read_bytes < 0) {
-			fprintf(stderr,"Failed to read from STDIN %s\n", argv[2]);
-			continue;
-		}
-		samples_count += read_bytes;
-		h61883 = (six1883_header *)((uint8_t*)stream_packet + sizeof(eth_header) + sizeof(seventeen22_header));
-		avb_set_61883_data_block_continuity(h61883 , samples_count);
-
-		err = igb_xmit(&igb_dev, 0, tmp_packet);
-		if (!err) {
-			fprintf(stderr,"frame sequence = %lld\n", frame_sequence++);
-			continue;
-		} else {
-			fprintf(stderr,"Failed frame sequence = %lld !!!!\n", frame_sequence++);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		next.tv_nsec += PACE_PERIOD;
+		if (next.tv_nsec >= 1000000000) {
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
 		}
+		credit += PACE_PERIOD / PACKET_IPG;
+		if (credit > PACE_BURST * PACE_PERIOD / PACKET_IPG)
+			credit = PACE_BURST * PACE_PERIOD / PACKET_IPG;
 
-		if (ENOSPC == err) {
-			/* put back for now */
-			tmp_packet->next = free_packets;
-			free_packets = tmp_packet;
-		}
-cleanup:
 		igb_clean(&igb_dev, &cleaned_packets);
 		while (cleaned_packets) {
 			tmp_packet = cleaned_packets;
@@ -331,9 +376,74 @@ cleanup:
 			tmp_packet->next = free_packets;
 			free_packets = tmp_packet;
 		}
+
+		while (credit > 0) {
+			if (NULL == cur_packet) {
+				cur_packet = free_packets;
+				if (NULL == cur_packet)
+					break;
+				free_packets = cur_packet->next;
+				fill = 0;
+				held = 0;
+			}
+
+			stream_packet = ((char *)cur_packet->vaddr);
+			data_ptr = (uint8_t *)((uint8_t*)stream_packet + sizeof(eth_header) + sizeof(seventeen22_header)
+						+ sizeof(six1883_header));
+
+			read_bytes = input_fill(&input, data_ptr + fill, glob_payload_length - fill);
+			/* Error case while reading the input file */
+			if (read_bytes < 0) {
+				fprintf(stderr, "Failed to read from STDIN: %s\n", strerror(errno));
+				ctx->halt_tx = 1;
+				break;
+			}
+			fill += read_bytes;
+
+			if (fill < glob_payload_length && !input.eof && (fill == 0 || held++ == 0))
+				break;
+			if (fill == 0)
+				break;
+
+			/* unfortuntely unless this thread is at rtprio
+			 * you get pre-empted between fetching the time
+			 * and programming the packet and get a late packet
+			 */
+			h1722 = (seventeen22_header *)((uint8_t*)stream_packet + sizeof(eth_header));
+			avb_61883_hdr_stamp(h1722, NULL, seq_number,
+					    (seq_number + 1) % 4 != 0, 0,
+					    fill + sizeof(six1883_header),
+					    samples_count + fill);
+			cur_packet->len = frame_size - glob_payload_length + fill;
+
+			err = igb_xmit(&igb_dev, 0, cur_packet);
+			if (ENOSPC == err) {
+				/* keep the frame and its data for the next period */
+				break;
+			}
+			if (err) {
+				fprintf(stderr, "Failed frame sequence = %lld !!!!\n", frame_sequence);
+				cur_packet->next = free_packets;
+				free_packets = cur_packet;
+				tx_failed++;
+			}
+			seq_number++;
+			frame_sequence++;
+			samples_count += fill;
+			cur_packet = NULL;
+			credit--;
+		}
+
+		if (input.eof && NULL == cur_packet) {
+			fprintf(stderr, "end of input\n");
+			break;
+		}
 	}
 
-	if (ctx->halt_tx == 0)
+	fprintf(stderr, "sent %lld frames (%lld failed)\n", frame_sequence, tx_failed);
+	input_close(&input);
+
+	if (ctx->halt_tx == 0 && !input.eof)
 		fprintf(stderr, "listener left ...\n");
 
 	ctx->halt_tx = 1;
@@ -48,6 +48,7 @@ static struct timeval rcv_timeout = {
 
 
 #include "mrpd.h"
+#include "mrpd_tlv.h"
 #include "mrpdclient.h"
 
 int mrpdclient_init(void)
@@ -105,10 +106,52 @@ int mrpdclient_close(SOCKET *mrpd_sock)
 	return 0;
 }
 
+/*
+ * Hand each response and notification of a binary frame to fn as if it
+ * had arrived as its own text datagram.
+ */
+static int mrpdclient_recv_frame(unsigned char *frame, int len,
+				 ptr_process_mrpd_msg fn)
+{
+	char *msgbuf;
+	int offset = MRPD_TLV_HDR_SZ;
+	int type;
+	int vlen;
+	int rc = 0;
+
+	while (offset + MRPD_TLV_ITEM_HDR_SZ <= len) {
+		type = (frame[offset] << 8) | frame[offset + 1];
+		vlen = (frame[offset + 2] << 8) | frame[offset + 3];
+		offset += MRPD_TLV_ITEM_HDR_SZ;
+		if (offset + vlen > len)
+			break;
+
+		if (type == MRPD_TLV_RESPONSE && vlen >= 2) {
+			/* skip the index of the command being answered */
+			offset += 2;
+			vlen -= 2;
+		} else if (type != MRPD_TLV_NOTIFY) {
+			offset += vlen;
+			continue;
+		}
+
+		msgbuf = (char *)malloc(vlen + 1);
+		if (NULL == msgbuf)
+			return -1;
+		memcpy(msgbuf, &frame[offset], vlen);
+		msgbuf[vlen] = '\0';
+		offset += vlen;
+		rc = fn(msgbuf, vlen);
+	}
+
+	return rc;
+}
+
 int mrpdclient_recv(SOCKET mrpd_sock, ptr_process_mrpd_msg fn)
 {
 	char *msgbuf;
 	int bytes = 0;
+	int rc;
 
 	if (SOCKET_ERROR == mrpd_sock)
 		return -1;
@@ -123,6 +166,13 @@ int mrpdclient_recv(SOCKET mrpd_sock, ptr_process_mrpd_msg fn)
 		goto out;
 	}
 
+	if (bytes >= MRPD_TLV_HDR_SZ &&
+	    (unsigned char)msgbuf[0] == MRPD_TLV_MAGIC) {
+		rc = mrpdclient_recv_frame((unsigned char *)msgbuf, bytes, fn);
+		free(msgbuf);
+		return rc;
+	}
+
 	return fn(msgbuf, bytes);
  out:
 	free(msgbuf);
@@ -146,3 +196,82 @@ int mrpdclient_sendto(SOCKET mrpd_sock, char *notify_data, int notify_len)
 	return sendto(mrpd_sock, notify_data, notify_len, 0,
 		(struct sockaddr *)&addr, addr_len);
 }
+
+static void mrpdclient_put16(unsigned char *p, unsigned int v)
+{
+	p[0] = (unsigned char)(v >> 8);
+	p[1] = (unsigned char)v;
+}
+
+static void mrpdclient_put32(unsigned char *p, unsigned int v)
+{
+	mrpdclient_put16(p, v >> 16);
+	mrpdclient_put16(p + 2, v & 0xFFFF);
+}
+
+static int mrpdclient_frame_add(unsigned char *frame, int *len, int type,
+				const void *value, int vlen)
+{
+	if (*len + MRPD_TLV_ITEM_HDR_SZ + vlen > MAX_MRPD_CMDSZ)
+		return -1;
+
+	mrpdclient_put16(&frame[*len], type);
+	mrpdclient_put16(&frame[*len + 2], vlen);
+	memcpy(&frame[*len + MRPD_TLV_ITEM_HDR_SZ], value, vlen);
+	*len += MRPD_TLV_ITEM_HDR_SZ + vlen;
+	mrpdclient_put16(&frame[2], ((frame[2] << 8) | frame[3]) + 1);
+
+	return 0;
+}
+
+static void mrpdclient_frame_init(unsigned char *frame, int *len,
+				  unsigned int seq)
+{
+	frame[0] = MRPD_TLV_MAGIC;
+	frame[1] = MRPD_TLV_VERSION;
+	mrpdclient_put16(&frame[2], 0);
+	mrpdclient_put32(&frame[4], seq);
+	*len = MRPD_TLV_HDR_SZ;
+}
+
+/*
+ * Send several text commands in one binary frame. mrpd answers with one
+ * frame holding every response, terminated by a MRPD_TLV_DONE item.
+ */
+int mrpdclient_sendbatch(SOCKET mrpd_sock, char **cmds, int count,
+			 unsigned int seq)
+{
+	unsigned char frame[MAX_MRPD_CMDSZ];
+	int len;
+	int i;
+
+	mrpdclient_frame_init(frame, &len, seq);
+	for (i = 0; i < count; i++) {
+		if (mrpdclient_frame_add(frame, &len, MRPD_TLV_CMD, cmds[i],
+					 strlen(cmds[i])) < 0)
+			return -1;
+	}
+
+	return mrpdclient_sendto(mrpd_sock, (char *)frame, len);
+}
+
+/*
+ * Switch to the binary protocol and only receive notifications for the
+ * MRPD_TLV_APP_xxx applications and MRPD_TLV_EVT_xxx events given.
+ */
+int mrpdclient_subscribe(SOCKET mrpd_sock, unsigned int apps,
+			 unsigned int events, unsigned int seq)
+{
+	unsigned char frame[MRPD_TLV_HDR_SZ + MRPD_TLV_ITEM_HDR_SZ + 8];
+	unsigned char masks[8];
+	int len;
+
+	mrpdclient_put32(&masks[0], apps);
+	mrpdclient_put32(&masks[4], events);
+	mrpdclient_frame_init(frame, &len, seq);
+	if (mrpdclient_frame_add(frame, &len, MRPD_TLV_SUBSCRIBE, masks,
+				 sizeof(masks)) < 0)
+		return -1;
+
+	return mrpdclient_sendto(mrpd_sock, (char *)frame, len);
+}
@@ -43,5 +43,9 @@ int mrpdclient_init(void);
 int mrpdclient_recv(SOCKET mrpd_sock, ptr_process_mrpd_msg fn);
 int mrpdclient_sendto(SOCKET mrpd_sock, char *notify_data, int notify_len);
 int mrpdclient_close(SOCKET *mrpd_sock);
+int mrpdclient_sendbatch(SOCKET mrpd_sock, char **cmds, int count,
+			 unsigned int seq);
+int mrpdclient_subscribe(SOCKET mrpd_sock, unsigned int apps,
+			 unsigned int events, unsigned int seq);
 
 #endif
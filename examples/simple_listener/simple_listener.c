@@ -28,6 +28,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <sndfile.h>
 
 #include "listener_mrp_client.h"
+#include "rx_ring.h"
 
 #define DEBUG 0
 #define PCAP 1
@@ -50,6 +51,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define SAMPLES_PER_FRAME (6)
 #define SAMPLES_PER_FRAME_AAF (64)
 #define CHANNELS (2)
+#define RX_RING_RETIRE_USEC (1000)
+#define MAX_BATCH_FRAMES (4096) /* sample frames written to the file at once */
 
 struct mrp_listener_ctx *ctx_sig;//Context pointer for signal handler
 
@@ -69,6 +72,7 @@ static const char *static_dest_mac = "91:E0:F0:00:FE:01";
 static u_char static_stream_id[] = { 0x91, 0xE0, 0xF0, 0x00, 0xFE, 0x00, 0x00, 0x01 };
 
 pcap_t* glob_pcap_handle;
+struct rx_ring* glob_rx_ring;
 
 u_char glob_ether_type[] = { 0x22, 0xf0 };
 SNDFILE* glob_snd_file = NULL;
@@ -88,11 +92,13 @@ static void help()
 		"    -n  no SRP\n"
 		"    -a  use AAF\n"
 		"    -f  set the name of the output wav-file\n"
+		"    -r  receive through a TPACKET_V3 ring instead of pcap\n"
 		"\n" "%s" "\n", version_str);
 	exit(EXIT_FAILURE);
 }
 
-void pcap_callback(u_char* args, const struct pcap_pkthdr* packet_header, const u_char* packet)
+/* Decode the 61883 samples of a matching packet into out, returns sample frames */
+static int decode_61883(const u_char* packet, int32_t* out)
 {
 	unsigned char* test_stream_id;
 	struct ethernet_header* eth_header;
@@ -100,8 +106,6 @@ void pcap_callback(u_char* args, const struct pcap_pkthdr* packet_header, const
 	uint32_t frame[2] = { 0 , 0 };
 
 	int i;
-	(void) args; /* unused */
-	(void) packet_header; /* unused */
 
 #if DEBUG
 	fprintf(stdout,"Got packet.\n");
@@ -143,13 +147,28 @@ void pcap_callback(u_char* args, const struct pcap_pkthdr* packet_header, const
 				frame[0] <<= 8;               /* left-align remaining PCM-24 sample */
 				frame[1] <<= 8;
 
-				sf_writef_int(glob_snd_file, (const int *)frame, 1);
+				memcpy(&out[i], frame, sizeof(frame));
 			}
+			return SAMPLES_PER_FRAME;
 		}
 	}
+	return 0;
 }
 
-void pcap_aaf_callback(u_char* args, const struct pcap_pkthdr* packet_header, const u_char* packet)
+void pcap_callback(u_char* args, const struct pcap_pkthdr* packet_header, const u_char* packet)
+{
+	int32_t samples[SAMPLES_PER_FRAME * CHANNELS];
+	int n;
+	(void) args; /* unused */
+	(void) packet_header; /* unused */
+
+	n = decode_61883(packet, samples);
+	if (n)
+		sf_writef_int(glob_snd_file, (const int *)samples, n);
+}
+
+/* Decode the AAF samples of a matching packet into out, returns sample frames */
+static int decode_aaf(const u_char* packet, int16_t* out)
 {
 	unsigned char* test_stream_id;
 	struct ethernet_header* eth_header;
@@ -157,8 +176,6 @@ void pcap_aaf_callback(u_char* args, const struct pcap_pkthdr* packet_header, co
 	uint16_t frame[2] = { 0 , 0 };
 
 	int i;
-	(void) args; /* unused */
-	(void) packet_header; /* unused */
 
 #if DEBUG
 	fprintf(stdout,"Got packet.\n");
@@ -195,10 +212,63 @@ void pcap_aaf_callback(u_char* args, const struct pcap_pkthdr* packet_header, co
 				frame[0] = ntohs(frame[0]);   /* convert to host-byte order */
 				frame[1] = ntohs(frame[1]);
 
-				sf_writef_short(glob_snd_file, (const short *)frame, 1);
+				memcpy(&out[i], frame, sizeof(frame));
 			}
+			return SAMPLES_PER_FRAME_AAF;
 		}
 	}
+	return 0;
+}
+
+void pcap_aaf_callback(u_char* args, const struct pcap_pkthdr* packet_header, const u_char* packet)
+{
+	int16_t samples[SAMPLES_PER_FRAME_AAF * CHANNELS];
+	int n;
+	(void) args; /* unused */
+	(void) packet_header; /* unused */
+
+	n = decode_aaf(packet, samples);
+	if (n)
+		sf_writef_short(glob_snd_file, (const short *)samples, n);
+}
+
+/* rx_ring handlers: decode a whole block, then write it with one call */
+static void ring_callback(void* arg, const unsigned char** frames, const unsigned int* lens, unsigned int count)
+{
+	static int32_t samples[MAX_BATCH_FRAMES * CHANNELS];
+	int n = 0;
+	(void) arg; /* unused */
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (lens[i] < HEADER_SIZE + SAMPLES_PER_FRAME * CHANNELS * 4)
+			continue;
+		if (n + SAMPLES_PER_FRAME > MAX_BATCH_FRAMES) {
+			sf_writef_int(glob_snd_file, (const int *)samples, n);
+			n = 0;
+		}
+		n += decode_61883(frames[i], &samples[n * CHANNELS]);
+	}
+	if (n)
+		sf_writef_int(glob_snd_file, (const int *)samples, n);
+}
+
+static void ring_aaf_callback(void* arg, const unsigned char** frames, const unsigned int* lens, unsigned int count)
+{
+	static int16_t samples[MAX_BATCH_FRAMES * CHANNELS];
+	int n = 0;
+	(void) arg; /* unused */
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (lens[i] < HEADER_SIZE_AAF + SAMPLES_PER_FRAME_AAF * CHANNELS * 2)
+			continue;
+		if (n + SAMPLES_PER_FRAME_AAF > MAX_BATCH_FRAMES) {
+			sf_writef_short(glob_snd_file, (const short *)samples, n);
+			n = 0;
+		}
+		n += decode_aaf(frames[i], &samples[n * CHANNELS]);
+	}
+	if (n)
+		sf_writef_short(glob_snd_file, (const short *)samples, n);
 }
 
 void sigint_handler(int signum)
@@ -221,6 +291,13 @@ void sigint_handler(int signum)
 			printf("mrp_disconnect failed\n");
 	}
 
+	if (NULL != glob_rx_ring)
+	{
+		/* main() closes the ring and the file once the loop returns */
+		rx_ring_breakloop(glob_rx_ring);
+		return;
+	}
+
 #if PCAP
 	if (NULL != glob_pcap_handle)
 	{
@@ -292,6 +369,9 @@ int main(int argc, char *argv[])
 	char filter_exp[100];				/* The filter expression */
 	char dest_mac[30];
 	pcap_handler callback = pcap_callback;
+	rx_ring_handler ring_handler = ring_callback;
+	int use_ring = 0;
+	unsigned char dest_addr[6];
 	struct mrp_listener_ctx *ctx = malloc(sizeof(struct mrp_listener_ctx));
 	struct mrp_domain_attr *class_a = malloc(sizeof(struct mrp_domain_attr));
 	struct mrp_domain_attr *class_b = malloc(sizeof(struct mrp_domain_attr));
@@ -299,7 +379,7 @@ int main(int argc, char *argv[])
 	signal(SIGINT, sigint_handler);
 
 	int c, rc;
-	while((c = getopt(argc, argv, "anhi:f:")) > 0)
+	while((c = getopt(argc, argv, "anrhi:f:")) > 0)
 	{
 		switch (c)
 		{
@@ -321,7 +401,11 @@ int main(int argc, char *argv[])
 			glob_use_aaf = 1;
 			sf_pcm_format = SF_FORMAT_PCM_16;
 			callback = pcap_aaf_callback;
+			ring_handler = ring_aaf_callback;
 		break;
+		case 'r':
+			use_ring = 1;
+			break;
 		default:
     	fprintf(stderr, "Unrecognized option!\n");
 		}
@@ -388,6 +472,34 @@ int main(int argc, char *argv[])
 	fprintf(stdout,"Created file called %s\n", file_name);
 #endif /* LIBSND */
 
+	if (use_ring)
+	{
+		if (6 != sscanf(dest_mac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+				&dest_addr[0], &dest_addr[1], &dest_addr[2],
+				&dest_addr[3], &dest_addr[4], &dest_addr[5]))
+		{
+			fprintf(stderr, "Bad destination MAC %s\n", dest_mac);
+			return EXIT_FAILURE;
+		}
+		glob_rx_ring = rx_ring_open(dev, dest_addr, RX_RING_RETIRE_USEC);
+		if (NULL == glob_rx_ring)
+		{
+			fprintf(stderr, "Could not open the receive ring on %s\n", dev);
+			return EXIT_FAILURE;
+		}
+		fprintf(stdout,"Receiving %s through a TPACKET_V3 ring\n", dest_mac);
+		rx_ring_loop(glob_rx_ring, ring_handler, ctx);
+		rx_ring_close(glob_rx_ring);
+#if LIBSND
+		sf_write_sync(glob_snd_file);
+		sf_close(glob_snd_file);
+#endif /* LIBSND */
+		free(ctx);
+		free(class_a);
+		free(class_b);
+		return EXIT_SUCCESS;
+	}
+
 #if PCAP
 	/** session, get session handler */
 	/* take promiscuous vs. non-promiscuous sniffing? (0 or 1) */
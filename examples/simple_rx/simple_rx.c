@@ -74,6 +74,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "igb.h"
 #include "listener_mrp_client.h"
+#include "rx_ring.h"
 
 #define DEBUG 0
 #define PCAP 0
@@ -99,6 +100,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define SAMPLES_PER_SECOND (48000)
 #define SAMPLES_PER_FRAME (6)
 #define CHANNELS (2)
+#define RX_RING_RETIRE_USEC (1000)
+#define MAX_BATCH_FRAMES (4096) /* sample frames written to the file at once */
 
 #if DIRECT_RX
 #define IGB_BIND_NAMESZ (24)
@@ -135,6 +138,7 @@ static const char *version_str = "simple_listener v" VERSION_STR "\n"
 pcap_t* glob_pcap_handle;
 u_char glob_ether_type[] = { 0x22, 0xf0 };
 SNDFILE* glob_snd_file;
+struct rx_ring* glob_rx_ring;
 
 #if DIRECT_RX
 /* Global variable for signal handler */
@@ -161,6 +165,7 @@ static void help()
 		"    -h  show this message\n"
 		"    -i  specify interface for AVB connection\n"
 		"    -f  set the name of the output wav-file\n"
+		"    -r  receive through a TPACKET_V3 ring instead of the igb queue\n"
 		"\n" "%s" "\n", version_str);
 	exit(EXIT_FAILURE);
 }
@@ -236,6 +241,9 @@ void sigint_handler(int signum)
 #if DIRECT_RX
 	halt_rx_sig = 0;
 #endif /* DIRECT_RX */
+
+	if (NULL != glob_rx_ring)
+		rx_ring_breakloop(glob_rx_ring);
 }
 
 #if DIRECT_RX
@@ -493,19 +501,92 @@ void igb_stop_rx(device_t *igb_dev)
 	igb_detach(igb_dev);
 }
 
-void igb_process_rx(device_t *igb_dev, struct mrp_listener_ctx *ctx)
+/*
+ * Decode the 61883 samples of a 1722 packet of our stream into out.
+ * Returns the number of sample frames, 0 for any other packet.
+ */
+static int decode_packet(uint8_t *packet, struct mrp_listener_ctx *ctx, int32_t *out)
 {
 	uint32_t i;
-	uint32_t count;
-	uint8_t  *packet;
 	uint32_t *buf;
 	uint32_t frame[2] = { 0 , 0 };
 	uint8_t  *test_stream_id;
-
-	struct igb_packet *igb_pkt = NULL;
 	struct ethhdr* eth_hdr;
 	uint16_t *ethtype = NULL;
 
+	eth_hdr = (struct ethhdr*)(packet);
+	switch (htons(eth_hdr->h_proto)) {
+		case ETH_P_8021Q:
+			ethtype = (uint16_t*)(packet + ETH_HLEN + 2);
+			if (*ethtype != htons(ETH_P_IEEE1722))
+				return 0; 	/* drop the packet */
+			break;
+		case ETH_P_IEEE1722:
+			break;
+		default:
+			return 0;	/* drop the packet */
+			break;
+	}
+
+	test_stream_id = (uint8_t*)(packet + ETHERNET_HEADER_SIZE + 
+									SEVENTEEN22_HEADER_PART1_SIZE);
+	buf = (uint32_t*)(packet + HEADER_SIZE);
+
+	if (ETH_P_IEEE1722 == htons(eth_hdr->h_proto)) {
+		/* I210 would strip the VLAN tag field when CTRL.VME = 1b */
+		/* pull 4 bytes the VLAN tag size */
+		test_stream_id = ((uint8_t*)test_stream_id - 4);
+		buf = ((uint32_t*)buf - 1);
+	}
+
+	if (0 != memcmp(test_stream_id, ctx->stream_id, STREAM_ID_SIZE))
+		return 0;
+
+	for(i = 0; i < SAMPLES_PER_FRAME * CHANNELS; i += 2)
+	{
+		memcpy(&frame[0], &buf[i], sizeof(frame));
+
+		frame[0] = ntohl(frame[0]);   /* convert to host-byte order */
+		frame[1] = ntohl(frame[1]);
+		frame[0] &= 0x00ffffff;       /* ignore leading label */
+		frame[1] &= 0x00ffffff;
+		frame[0] <<= 8;               /* left-align remaining PCM-24 sample */
+		frame[1] <<= 8;
+
+		memcpy(&out[i], frame, sizeof(frame));
+	}
+	return SAMPLES_PER_FRAME;
+}
+
+/* rx_ring handler: decode a whole block, then write it with one call */
+static void ring_callback(void *arg, const unsigned char **frames, const unsigned int *lens, unsigned int count)
+{
+	static int32_t samples[MAX_BATCH_FRAMES * CHANNELS];
+	struct mrp_listener_ctx *ctx = (struct mrp_listener_ctx*) arg;
+	unsigned int i;
+	int n = 0;
+
+	for (i = 0; i < count; i++) {
+		if (lens[i] < HEADER_SIZE + SAMPLES_PER_FRAME * CHANNELS * 4)
+			continue;
+		if (n + SAMPLES_PER_FRAME > MAX_BATCH_FRAMES) {
+			sf_writef_int(glob_snd_file, (const int *)samples, n);
+			n = 0;
+		}
+		n += decode_packet((uint8_t *)frames[i], ctx, &samples[n * CHANNELS]);
+	}
+	if (n)
+		sf_writef_int(glob_snd_file, (const int *)samples, n);
+}
+
+void igb_process_rx(device_t *igb_dev, struct mrp_listener_ctx *ctx)
+{
+	uint32_t count;
+	int32_t samples[SAMPLES_PER_FRAME * CHANNELS];
+	int n;
+
+	struct igb_packet *igb_pkt = NULL;
+
 	halt_rx_sig = 1;
 
 	while (halt_rx_sig) {
@@ -522,48 +603,9 @@ void igb_process_rx(device_t *igb_dev, struct mrp_listener_ctx *ctx)
 			continue;
 		}
 
-		packet = igb_pkt->vaddr;
-		eth_hdr = (struct ethhdr*)(packet);
-		switch (htons(eth_hdr->h_proto)) {
-			case ETH_P_8021Q:
-				ethtype = (uint16_t*)(packet + ETH_HLEN + 2);
-				if (*ethtype != htons(ETH_P_IEEE1722))
-					continue; 	/* drop the packet */
-				break;
-			case ETH_P_IEEE1722:
-				break;
-			default:
-				continue;	/* drop the packet */
-				break;
-		}
-
-		test_stream_id = (uint8_t*)(packet + ETHERNET_HEADER_SIZE + 
-										SEVENTEEN22_HEADER_PART1_SIZE);
-		buf = (uint32_t*)(packet + HEADER_SIZE);
-
-		if (ETH_P_IEEE1722 == htons(eth_hdr->h_proto)) {
-			/* I210 would strip the VLAN tag field when CTRL.VME = 1b */
-			/* pull 4 bytes the VLAN tag size */
-			test_stream_id = ((uint8_t*)test_stream_id - 4);
-			buf = ((uint32_t*)buf - 1);
-		}
-
-		if (0 == memcmp(test_stream_id, ctx->stream_id, STREAM_ID_SIZE))
-		{
-			for(i = 0; i < SAMPLES_PER_FRAME * CHANNELS; i += 2)
-			{
-				memcpy(&frame[0], &buf[i], sizeof(frame));
-
-				frame[0] = ntohl(frame[0]);   /* convert to host-byte order */
-				frame[1] = ntohl(frame[1]);
-				frame[0] &= 0x00ffffff;       /* ignore leading label */
-				frame[1] &= 0x00ffffff;
-				frame[0] <<= 8;               /* left-align remaining PCM-24 sample */
-				frame[1] <<= 8;
-
-				sf_writef_int(glob_snd_file, (const int *)frame, 1);
-			}
-		}
+		n = decode_packet(igb_pkt->vaddr, ctx, samples);
+		if (n)
+			sf_writef_int(glob_snd_file, (const int *)samples, n);
 	}
 }
 
@@ -625,6 +667,7 @@ int main(int argc, char *argv[])
 #endif /* DIRECT_RX */
 
 	int c,rc;
+	int use_ring = 0;
 
 	if ((NULL == ctx) || (NULL == class_a) || (NULL == class_b)) {
 		fprintf(stderr, "failed allocating memory\n");
@@ -635,7 +678,7 @@ int main(int argc, char *argv[])
 	ctx_sig = ctx;
 	signal(SIGINT, sigint_handler);
 
-	while((c = getopt(argc, argv, "hi:f:")) > 0)
+	while((c = getopt(argc, argv, "hi:f:r")) > 0)
 	{
 		switch (c)
 		{
@@ -648,6 +691,9 @@ int main(int argc, char *argv[])
 		case 'f':
 			file_name = strdup(optarg);
 			break;
+		case 'r':
+			use_ring = 1;
+			break;
 		default:
           		fprintf(stderr, "Unrecognized option!\n");
 		}
@@ -739,6 +785,18 @@ int main(int argc, char *argv[])
 	fprintf(stdout,"Created file called %s\n", file_name);
 #endif /* LIBSND */
 
+	if (use_ring) {
+		glob_rx_ring = rx_ring_open(dev, ctx->dst_mac, RX_RING_RETIRE_USEC);
+		if (NULL == glob_rx_ring) {
+			fprintf(stderr, "Could not open the receive ring on %s\n", dev);
+			rc = EXIT_FAILURE;
+			goto out;
+		}
+		rx_ring_loop(glob_rx_ring, ring_callback, ctx);
+		rc = EXIT_SUCCESS;
+		goto out;
+	}
+
 #if PCAP
 	/** session, get session handler */
 	/* take promiscuous vs. non-promiscuous sniffing? (0 or 1) */
@@ -795,8 +853,13 @@ int main(int argc, char *argv[])
 #endif
 	rc = EXIT_SUCCESS;
 out:
+	if (NULL != glob_rx_ring) {
+		rx_ring_close(glob_rx_ring);
+		glob_rx_ring = NULL;
+	}
 #if DIRECT_RX
-	igb_stop_rx(&igb_dev);
+	if (!use_ring)
+		igb_stop_rx(&igb_dev);
 	cleanup();
 #endif /* DIRECT_RX */
 
@@ -34,7 +34,6 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <fcntl.h>
-#include <math.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -48,10 +47,10 @@
 
 #include "talker_mrp_client.h"
 #include "avb.h"
+#include "avb_tonegen.h"
 
 #define VERSION_STR "1.0"
 
-#define SRC_CHANNELS (2)
 #define GAIN (0.5)
 #define L16_PAYLOAD_TYPE (96) /* for layer 4 transport - should be negotiated via RTSP */
 #define ID_B_HDR_EXT_ID (0) /* for layer 4 transport - should be negotiated via RTSP */
@@ -67,6 +66,13 @@
 #define L4_PACKET_IPG (1250000)	/* (1) packet every 1.25 millisec */
 #define L4_PORT ((uint16_t)5004)
 #define PKT_SZ (100)
+#define XTS_SAMPLES (16) /* SYSTIM reads averaged into the start time */
+#define MAX_STREAMS (16) /* streams one process can drive in batched mode */
+#define XMIT_BATCH (16) /* frames handed to igb_xmit_batch() at once */
+#define TONE_RATE (48000)
+#define TONE_HZ (480) /* one period per 100 frames */
+#define E1000_TQAVCTRL (0x03570)
+#define E1000_TQAVCTRL_LAUNCH_VALID (0x00000200)
 
 typedef long double FrequencyRatio;
 volatile int *halt_tx_sig;//Global variable for signal handler
@@ -109,6 +115,15 @@ typedef struct __attribute__ ((packed)) {
 	uint16_t length;
 } IP_PseudoHeader;
 
+/* one 1722/61883 stream of the batched mode */
+struct talker_stream {
+	unsigned char stream_id[8];
+	unsigned char dest_addr[6];
+	uint8_t seqnum;
+	uint8_t dbc;
+	unsigned sample_index;
+};
+
 /* globals */
 
 static const char *version_str = "simple_talker v" VERSION_STR "\n"
@@ -202,37 +217,160 @@ static inline uint64_t ST_rdtsc(void)
 	return ret;
 }
 
-void gensine32(int32_t * buf, unsigned count)
+/* sine shared by every stream, encoded for the selected transport */
+static struct avb_tonegen tone;
+
+/* Make the MAC honour igb_packet.attime as a LaunchTime */
+static void set_launch_valid(device_t *igb_dev, int enable)
 {
-	long double interval = (2 * ((long double)M_PI)) / count;
-	unsigned i;
-	for (i = 0; i < count; ++i) {
-		buf[i] =
-		    (int32_t) (MAX_SAMPLE_VALUE * sinl(i * interval) * GAIN);
-	}
+	u_int32_t tqavctrl;
+
+	if (igb_lock(igb_dev))
+		return;
+	igb_readreg(igb_dev, E1000_TQAVCTRL, &tqavctrl);
+	if (enable)
+		tqavctrl |= E1000_TQAVCTRL_LAUNCH_VALID;
+	else
+		tqavctrl &= ~E1000_TQAVCTRL_LAUNCH_VALID;
+	igb_writereg(igb_dev, E1000_TQAVCTRL, tqavctrl);
+	igb_unlock(igb_dev);
 }
 
-int get_samples(unsigned count, int32_t * buffer)
+/* MAC header and Q-tag of a class A frame */
+static void init_eth_header(uint8_t *frame, const unsigned char *dest_addr,
+			    struct mrp_talker_ctx *ctx, uint16_t ethertype)
 {
-	static int init = 0;
-	static int32_t samples_onechannel[100];
-	static unsigned index = 0;
+	memcpy(frame, dest_addr, 6);
+	memcpy(frame + 6, glob_station_addr, sizeof(glob_station_addr));
+
+	/* Q-tag */
+	frame[12] = 0x81;
+	frame[13] = 0x00;
+	frame[14] =
+	    ((ctx->domain_class_a_priority << 13 | ctx->domain_class_a_vid)) >> 8;
+	frame[15] =
+	    ((ctx->domain_class_a_priority << 13 | ctx->domain_class_a_vid)) & 0xFF;
+	frame[16] = ethertype >> 8;
+	frame[17] = ethertype & 0xFF;
+}
 
-	if (init == 0) {
-		gensine32(samples_onechannel, 100);
-		init = 1;
-	}
+/* 1722 and 61883 headers; returns the length of the whole frame */
+static unsigned init_1722_header(seventeen22_header *l2_header0,
+				 const unsigned char *stream_id)
+{
+	struct avb_61883_hdr f;
+
+	memset(&f, 0, sizeof(f));
+	f.sid_valid = 1;
+	f.stream_id = avb_get_be64(stream_id);
+	f.length = 32;
+	f.format_tag = 1;
+	f.packet_channel = 0x1F;
+	f.packet_tcode = 0xA;
+	f.source_id = 0x3F;
+	f.data_block_size = 1;
+	f.eoh = 0x2;
+	f.format_id = 0x10;
+	f.format_dependent_field = 0x02;
+	f.syt = 0xFFFF;
+	avb_61883_hdr_compose(l2_header0, &f);
+
+	return 18 + sizeof(seventeen22_header) + sizeof(six1883_header) +
+		(L2_SAMPLES_PER_FRAME * CHANNELS * sizeof(six1883_sample));
+}
+
+/* Fill the per-frame fields of the next frame of a stream */
+static void fill_stream_frame(struct igb_packet *packet,
+			      struct talker_stream *stream, uint64_t time_stamp)
+{
+	seventeen22_header *l2_header0 =
+		(seventeen22_header *) (((char *)packet->vaddr) + 18);
+	six1883_header *l2_header1 = (six1883_header *) (l2_header0 + 1);
+
+	memcpy(packet->vaddr, stream->dest_addr, sizeof(stream->dest_addr));
+	memcpy(&(l2_header0->stream_id), stream->stream_id,
+	       sizeof(stream->stream_id));
+
+	avb_61883_hdr_stamp(l2_header0, NULL, stream->seqnum,
+			    (stream->seqnum + 1) % 4 != 0, (uint32_t)time_stamp,
+			    32, stream->dbc);
+	stream->seqnum++;
+	stream->dbc += L2_SAMPLES_PER_FRAME * CHANNELS;
+
+	stream->sample_index =
+		avb_tonegen_fill(&tone, stream->sample_index, l2_header1 + 1,
+				 L2_SAMPLES_PER_FRAME, tone.frame_bytes);
+}
+
+/*
+ * Batched mode: every class A interval carries one frame of each stream.
+ * Whole intervals are queued with one igb_xmit_batch() call, and sent
+ * buffers are only reclaimed once the free list can't fill a batch.
+ */
+static void run_batched(device_t *igb_dev, struct mrp_talker_ctx *ctx,
+			struct talker_stream *streams, unsigned nstreams,
+			struct igb_packet *free_packets, unsigned nfree,
+			uint64_t launch_time, uint64_t time_stamp, int launch)
+{
+	struct igb_packet *batch[XMIT_BATCH];
+	unsigned cycles = XMIT_BATCH / nstreams;
+	unsigned nbatch = 0, first = 0;
+	unsigned c, s;
+	uint64_t sent = 0, cleans = 0;
+	u_int32_t count;
+	struct timespec start, end;
+	double secs;
+	int err;
 
-	while (count > 0) {
-		int i;
-		for (i = 0; i < SRC_CHANNELS; ++i) {
-			*(buffer++) = samples_onechannel[index];
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (ctx->listeners && !ctx->halt_tx) {
+		if (nbatch == 0) {
+			if (nfree < cycles * nstreams) {
+				igb_clean_queue(igb_dev, 0, &free_packets, &count);
+				nfree += count;
+				++cleans;
+				continue;
+			}
+			for (c = 0; c < cycles; ++c) {
+				launch_time += L2_PACKET_IPG;
+				for (s = 0; s < nstreams; ++s) {
+					struct igb_packet *packet = free_packets;
+
+					free_packets = packet->next;
+					--nfree;
+					fill_stream_frame(packet, &streams[s],
+							  time_stamp);
+					packet->attime = launch ? launch_time : 0;
+					batch[nbatch++] = packet;
+				}
+				time_stamp += L2_PACKET_IPG;
+			}
+		}
+
+		count = nbatch - first;
+		err = igb_xmit_batch(igb_dev, 0, batch + first, &count);
+		first += count;
+		sent += count;
+		if (first == nbatch) {
+			nbatch = first = 0;
+		} else if (ENOSPC == err) {
+			/* ring full - reclaim descriptors and retry the rest */
+			igb_clean_queue(igb_dev, 0, &free_packets, &count);
+			nfree += count;
+			++cleans;
+		} else if (err) {
+			printf("igb_xmit_batch failed (%s)\n", strerror(abs(err)));
+			break;
 		}
-		index = (index + 1) % 100;
-		--count;
 	}
 
-	return 0;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	secs = (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1000000000.0;
+	printf("sent %" PRIu64 " frames on %u streams in %.1f s "
+	       "(%.0f frames/s, %" PRIu64 " cleans)\n",
+	       sent, nstreams, secs, secs > 0 ? sent / secs : 0.0, cleans);
 }
 
 void sigint_handler(int signum)
@@ -283,6 +421,8 @@ static void usage(void)
 		"    -h  show this message\n"
 		"    -i  specify interface for AVB connection\n"
 		"    -t  transport equal to 2 for 1722 or 3 for RTP\n"
+		"    -n  send N 1722 streams with batched transmits\n"
+		"    -l  transmit at each frame's LaunchTime\n"
 		"\n" "%s" "\n", version_str);
 	exit(EXIT_FAILURE);
 }
@@ -310,11 +450,10 @@ int main(int argc, char *argv[])
 	uint64_t time_stamp;
 	unsigned total_samples = 0;
 	gPtpTimeData td;
-	int32_t sample_buffer[L4_SAMPLES_PER_FRAME * SRC_CHANNELS];
+	unsigned tone_index = 0;
 
 	seventeen22_header *l2_header0;
 	six1883_header *l2_header1;
-	six1883_sample *sample;
 
 	IP_RTP_Header *l4_headers;
 	IP_PseudoHeader pseudo_hdr;
@@ -325,14 +464,22 @@ int main(int argc, char *argv[])
 
 	uint64_t now_local, now_8021as;
 	uint64_t update_8021as;
+	struct igb_crosststamp xts;
 	unsigned delta_8021as, delta_local;
 	uint8_t dest_addr[6];
 	size_t packet_size;
 	struct mrp_domain_attr *class_a = malloc(sizeof(struct mrp_domain_attr));
 	struct mrp_domain_attr *class_b = malloc(sizeof(struct mrp_domain_attr));
+	unsigned nstreams = 0;
+	int launch = 0;
+	struct talker_stream streams[MAX_STREAMS];
+	struct igb_dma_alloc tx_region;
+	int have_region = 0;
+	struct igb_packet *slab = NULL;
+	unsigned nslab = 0;
 
 	for (;;) {
-		c = getopt(argc, argv, "hi:t:");
+		c = getopt(argc, argv, "hi:t:n:l");
 		if (c < 0)
 			break;
 		switch (c) {
@@ -348,6 +495,13 @@ int main(int argc, char *argv[])
 			break;
 		case 't':
 			transport = strtoul( optarg, NULL, 10 );
+			break;
+		case 'n':
+			nstreams = strtoul( optarg, NULL, 10 );
+			break;
+		case 'l':
+			launch = 1;
+			break;
 		}
 	}
 	if (optind < argc)
@@ -359,6 +513,11 @@ int main(int argc, char *argv[])
 		fprintf( stderr, "Must specify valid transport\n" );
 		usage();
 	}
+	if (nstreams > MAX_STREAMS || (nstreams && transport != 2)) {
+		fprintf(stderr, "-n takes 1 to %d streams of transport 2\n",
+			MAX_STREAMS);
+		usage();
+	}
 
 	rc = mrp_talker_client_init(ctx);
 	if (rc) {
@@ -449,7 +608,9 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	if( transport == 2 ) {
+	if (nstreams) {
+		igb_set_class_bandwidth(&igb_dev, nstreams, 0, PKT_SZ - 22, 0);
+	} else if( transport == 2 ) {
 		igb_set_class_bandwidth
 			(&igb_dev, 125000/L2_PACKET_IPG, 0, PKT_SZ - 22, 0);
 	} else {
@@ -460,6 +621,8 @@ int main(int argc, char *argv[])
 
 	memset(glob_stream_id, 0, sizeof(glob_stream_id));
 	memcpy(glob_stream_id, glob_station_addr, sizeof(glob_station_addr));
+	if (launch)
+		set_launch_valid(&igb_dev, 1);
 
 	if( transport == 2 ) {
 		packet_size = PKT_SZ;
@@ -491,61 +654,14 @@ int main(int argc, char *argv[])
 		tmp_packet->vaddr += tmp_packet->offset;
 		tmp_packet->next = free_packets;
 		memset(tmp_packet->vaddr, 0, packet_size);	/* MAC header at least */
-		memcpy(tmp_packet->vaddr, dest_addr, sizeof(dest_addr));
-		memcpy(tmp_packet->vaddr + 6, glob_station_addr,
-		       sizeof(glob_station_addr));
-
-		/* Q-tag */
-		((char *)tmp_packet->vaddr)[12] = 0x81;
-		((char *)tmp_packet->vaddr)[13] = 0x00;
-		((char *)tmp_packet->vaddr)[14] =
-		    ((ctx->domain_class_a_priority << 13 | ctx->domain_class_a_vid)) >> 8;
-		((char *)tmp_packet->vaddr)[15] =
-		    ((ctx->domain_class_a_priority << 13 | ctx->domain_class_a_vid)) & 0xFF;
-		if( transport == 2 ) {
-			((char *)tmp_packet->vaddr)[16] = 0x22;	/* 1722 eth type */
-			((char *)tmp_packet->vaddr)[17] = 0xF0;
-		} else {
-			((char *)tmp_packet->vaddr)[16] = 0x08;	/* IP eth type */
-			((char *)tmp_packet->vaddr)[17] = 0x00;
-		}
+		init_eth_header(tmp_packet->vaddr, dest_addr, ctx,
+				transport == 2 ? 0x22F0 : 0x0800);
 
 		if( transport == 2 ) {
 			/* 1722 header update + payload */
 			l2_header0 =
 				(seventeen22_header *) (((char *)tmp_packet->vaddr) + 18);
-			l2_header0->cd_indicator = 0;
-			l2_header0->subtype = 0;
-			l2_header0->sid_valid = 1;
-			l2_header0->version = 0;
-			l2_header0->reset = 0;
-			l2_header0->reserved0 = 0;
-			l2_header0->gateway_valid = 0;
-			l2_header0->reserved1 = 0;
-			l2_header0->timestamp_uncertain = 0;
-			memset(&(l2_header0->stream_id), 0, sizeof(l2_header0->stream_id));
-			memcpy(&(l2_header0->stream_id), glob_station_addr,
-				   sizeof(glob_station_addr));
-			l2_header0->length = htons(32);
-			l2_header1 = (six1883_header *) (l2_header0 + 1);
-			l2_header1->format_tag = 1;
-			l2_header1->packet_channel = 0x1F;
-			l2_header1->packet_tcode = 0xA;
-			l2_header1->app_control = 0x0;
-			l2_header1->reserved0 = 0;
-			l2_header1->source_id = 0x3F;
-			l2_header1->data_block_size = 1;
-			l2_header1->fraction_number = 0;
-			l2_header1->quadlet_padding_count = 0;
-			l2_header1->source_packet_header = 0;
-			l2_header1->reserved1 = 0;
-			l2_header1->eoh = 0x2;
-			l2_header1->format_id = 0x10;
-			l2_header1->format_dependent_field = 0x02;
-			l2_header1->syt = 0xFFFF;
-			tmp_packet->len =
-				18 + sizeof(seventeen22_header) + sizeof(six1883_header) +
-				(L2_SAMPLES_PER_FRAME * CHANNELS * sizeof(six1883_sample));
+			tmp_packet->len = init_1722_header(l2_header0, glob_stream_id);
 		} else {
 			pseudo_hdr.source = l4_local_address;
 			memcpy
@@ -598,6 +714,52 @@ int main(int argc, char *argv[])
 		free_packets = tmp_packet;
 	}
 
+	if (nstreams) {
+		/*
+		 * Batched mode carves its frames out of one contiguous region,
+		 * or out of the page above when the driver can't map one.
+		 */
+		if (igb_dma_malloc_huge(&igb_dev, &tx_region) == 0) {
+			have_region = 1;
+			slab = igb_dma_slab_carve(&tx_region, packet_size, &nslab);
+		} else {
+			slab = igb_dma_slab_carve(&a_page, packet_size, &nslab);
+		}
+		if (NULL == slab || nslab < XMIT_BATCH) {
+			printf("failed to carve transmit buffers\n");
+			return EXIT_FAILURE;
+		}
+		for (i = 0; i < nslab; i++) {
+			memset(slab[i].vaddr, 0, packet_size);
+			init_eth_header(slab[i].vaddr, dest_addr, ctx, 0x22F0);
+			slab[i].len = init_1722_header
+				((seventeen22_header *) (((char *)slab[i].vaddr) + 18),
+				 glob_stream_id);
+		}
+
+		memset(streams, 0, sizeof(streams));
+		for (i = 0; i < nstreams; i++) {
+			memcpy(streams[i].stream_id, glob_station_addr,
+			       sizeof(glob_station_addr));
+			streams[i].stream_id[6] = i >> 8;
+			streams[i].stream_id[7] = i & 0xFF;
+			memcpy(streams[i].dest_addr, glob_l2_dest_addr,
+			       sizeof(streams[i].dest_addr));
+			streams[i].dest_addr[5] = 0x80 + i;
+		}
+		/* stream 0 is the one the listener is awaited on */
+		memcpy(glob_stream_id, streams[0].stream_id, sizeof(glob_stream_id));
+		memcpy(dest_addr, streams[0].dest_addr, sizeof(dest_addr));
+	}
+
+	rc = avb_tonegen_init(&tone, transport == 2 ? AVB_TONEGEN_AM824 :
+			      AVB_TONEGEN_S16_BE, TONE_RATE, TONE_HZ, CHANNELS,
+			      GAIN, 0);
+	if (rc) {
+		printf("failed to generate the tone\n");
+		return EXIT_FAILURE;
+	}
+
 	/*
 	 * subtract 16 bytes for the MAC header/Q-tag - pktsz is limited to the
 	 * data payload of the ethernet frame.
@@ -605,7 +767,14 @@ int main(int argc, char *argv[])
 	 * IPG is scaled to the Class (A) observation interval of packets per 125 usec.
 	 */
 	fprintf(stderr, "advertising stream ...\n");
-	if( transport == 2 ) {
+	if (nstreams) {
+		for (i = 0, rc = 0; i < nstreams && !rc; i++)
+			rc = mrp_advertise_stream(streams[i].stream_id,
+						  streams[i].dest_addr,
+						  PKT_SZ - 16,
+						  L2_PACKET_IPG / 125000,
+						  3900, ctx);
+	} else if( transport == 2 ) {
 		rc = mrp_advertise_stream(glob_stream_id, dest_addr,
 					PKT_SZ - 16,
 					L2_PACKET_IPG / 125000,
@@ -646,10 +815,12 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	if(igb_get_wallclock( &igb_dev, &now_local, NULL ) > 0) {
+	if (igb_get_crosststamp(&igb_dev, XTS_SAMPLES, &xts) != 0) {
 		fprintf( stderr, "Failed to get wallclock time\n" );
 		return EXIT_FAILURE;
 	}
+	if (igb_crosststamp_now(&xts, &now_local) != 0)
+		now_local = xts.systim;
 	update_8021as = td.local_time - td.ml_phoffset;
 	delta_local = (unsigned)(now_local - td.local_time);
 	delta_8021as = (unsigned)(td.ml_freqoffset * delta_local);
@@ -660,7 +831,11 @@ int main(int argc, char *argv[])
 
 	rc = nice(-20);
 
-	while (ctx->listeners && !ctx->halt_tx) {
+	if (nstreams)
+		run_batched(&igb_dev, ctx, streams, nstreams, slab, nslab,
+			    last_time, time_stamp, launch);
+
+	while (nstreams == 0 && ctx->listeners && !ctx->halt_tx) {
 		tmp_packet = free_packets;
 		if (NULL == tmp_packet)
 			goto cleanup;
@@ -669,7 +844,6 @@ int main(int argc, char *argv[])
 
 		if( transport == 2 ) {
 			uint32_t timestamp_l;
-			get_samples( L2_SAMPLES_PER_FRAME, sample_buffer );
 			l2_header0 =
 				(seventeen22_header *) (((char *)tmp_packet->vaddr) + 18);
 			l2_header1 = (six1883_header *) (l2_header0 + 1);
@@ -681,33 +855,17 @@ int main(int argc, char *argv[])
 			tmp_packet->attime = last_time + L2_PACKET_IPG;
 			last_time += L2_PACKET_IPG;
 
-			l2_header0->seq_number = seqnum++;
-			if (seqnum % 4 == 0)
-				l2_header0->timestamp_valid = 0;
-
-			else
-				l2_header0->timestamp_valid = 1;
-
 			timestamp_l = time_stamp;
-			l2_header0->timestamp = htonl(timestamp_l);
+			avb_61883_hdr_stamp(l2_header0, NULL, seqnum,
+					    (seqnum + 1) % 4 != 0, timestamp_l, 32,
+					    total_samples);
+			seqnum++;
 			time_stamp += L2_PACKET_IPG;
-			l2_header1->data_block_continuity = total_samples;
 			total_samples += L2_SAMPLES_PER_FRAME*CHANNELS;
-			sample =
-				(six1883_sample *) (((char *)tmp_packet->vaddr) +
-									(18 + sizeof(seventeen22_header) +
-									 sizeof(six1883_header)));
-
-			for (i = 0; i < L2_SAMPLES_PER_FRAME * CHANNELS; ++i) {
-				uint32_t tmp = htonl(sample_buffer[i]);
-				sample[i].label = 0x40;
-				memcpy(&(sample[i].value), &(tmp),
-					   sizeof(sample[i].value));
-			}
+			tone_index = avb_tonegen_fill(&tone, tone_index, l2_header1 + 1,
+						      L2_SAMPLES_PER_FRAME, tone.frame_bytes);
 		} else {
-			uint16_t *l16_sample;
 			uint8_t *tmp;
-			get_samples( L4_SAMPLES_PER_FRAME, sample_buffer );
 
 			l4_headers =
 				(IP_RTP_Header *) (((char *)tmp_packet->vaddr) + 18);
@@ -735,12 +893,8 @@ int main(int argc, char *argv[])
 
 			time_stamp += L4_PACKET_IPG;
 
-			l16_sample = (uint16_t *) (l4_headers+1);
-
-			for (i = 0; i < L4_SAMPLES_PER_FRAME * CHANNELS; ++i) {
-				uint16_t tmp = sample_buffer[i]/65536;
-				l16_sample[i] = htons(tmp);
-			}
+			tone_index = avb_tonegen_fill(&tone, tone_index, l4_headers + 1,
+						      L4_SAMPLES_PER_FRAME, tone.frame_bytes);
 			l4_headers->cksum = 0;
 			{
 				struct iovec iv[2];
@@ -781,7 +935,12 @@ int main(int argc, char *argv[])
 	if (ctx->halt_tx == 0)
 		printf("listener left ...\n");
 	ctx->halt_tx = 1;
-	if( transport == 2 ) {
+	if (nstreams) {
+		for (i = 0; i < nstreams; i++)
+			rc = mrp_unadvertise_stream
+				(streams[i].stream_id, streams[i].dest_addr,
+				 PKT_SZ - 16, L2_PACKET_IPG / 125000, 3900, ctx);
+	} else if( transport == 2 ) {
 		rc = mrp_unadvertise_stream
 			(glob_stream_id, dest_addr, PKT_SZ - 16, L2_PACKET_IPG / 125000,
 			 3900, ctx);
@@ -794,6 +953,8 @@ int main(int argc, char *argv[])
 	if (rc)
 		printf("mrp_unadvertise_stream failed\n");
 
+	if (launch)
+		set_launch_valid(&igb_dev, 0);
 	igb_set_class_bandwidth(&igb_dev, 0, 0, 0, 0);	/* disable Qav */
 
 	rc = mrp_disconnect(ctx);
@@ -802,7 +963,11 @@ int main(int argc, char *argv[])
 	free(ctx);
 	free(class_a);
 	free(class_b);
+	free(slab);
+	if (have_region)
+		igb_dma_free_page(&igb_dev, &tx_region);
 	igb_dma_free_page(&igb_dev, &a_page);
+	avb_tonegen_free(&tone);
 	rc = gptpdeinit(&igb_shm_fd, &igb_mmap);
 	err = igb_detach(&igb_dev);
 
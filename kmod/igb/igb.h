@@ -50,6 +50,7 @@ struct igb_user_page {
 	struct igb_user_page *next;
 	struct page *page;
 	dma_addr_t page_dma;
+	unsigned int order;	/* mapping is PAGE_SIZE << order bytes */
 };
 #if defined(CONFIG_DCA) || defined(CONFIG_DCA_MODULE)
 #define IGB_DCA
@@ -410,6 +411,7 @@ struct igb_q_vector {
 	u32 eims_value;			/* EIMS mask value */
 
 	u16 itr_val;
+	u16 itr_fixed;			/* ITR pinned by IGB_SET_ITR, 0 = adaptive */
 	u8 set_itr;
 	void __iomem *itr_register;
 
@@ -604,6 +606,12 @@ struct igb_adapter {
 	struct igb_q_vector *q_vector[MAX_Q_VECTORS];
 	u32 eims_enable_mask;
 	u32 eims_other;
+	u32 eims_user;		/* vectors serving only user (AVB) queues */
+	bool avb_polled;	/* user queue interrupts masked */
+	u32 user_queues;	/* queues 0..user_queues-1 belong to user space */
+	u32 flex_in_use;	/* flex filters handed out by IGB_ALLOC_FLEX */
+	u32 queue_class[4];	/* IGB_QUEUE_CLASS_* of each TX queue */
+	u16 avb_tx_size[3];	/* TX ring size of a user queue, 0 = tx_ring_count */
 
 	/* to not mess up cache alignment, always add to the bottom */
 	u32 *config_space;
@@ -879,6 +887,39 @@ void igb_procfs_topdir_exit(void);
 #define IGB_LINKSPEED  _IOW('E', 206, int)
 #define IGB_MAP_RX_RING    _IOW('E', 207, int)
 #define IGB_UNMAP_RX_RING  _IOW('E', 208, int)
+#define IGB_MAPBUF_HUGE    _IOW('E', 209, int)
+#define IGB_SET_POLLED     _IOW('E', 210, int)
+#define IGB_SET_ITR        _IOW('E', 211, int)
+#define IGB_GET_QUEUES     _IOW('E', 212, int)
+#define IGB_SET_QUEUE_CLASS _IOW('E', 213, int)
+#define IGB_ALLOC_FLEX     _IOW('E', 214, int)
+#define IGB_FREE_FLEX      _IOW('E', 215, int)
+
+/*
+ * by default queues 0 and 1 belong to user space (AVB) and are not
+ * serviced by NAPI; avb_user_queues hands out queue 2 as well. Queue 3
+ * takes all unfiltered traffic (MRQC) and stays with the kernel.
+ */
+#define IGB_USER_QUEUES    2
+#define IGB_MAX_USER_QUEUES 3
+
+/* igb_avb_tx_size - TX ring size set for a user queue, 0 if none */
+static inline u16 igb_avb_tx_size(const struct igb_adapter *adapter, int i)
+{
+	return (i < adapter->user_queues) ? adapter->avb_tx_size[i] : 0;
+}
+
+/* flexible host filters of the i210, shared by all user space processes */
+#define IGB_MAX_FLEX_FILTERS 8
+#define IGB_FLEX_ANY       0xFFFFFFFF
+
+/* traffic class of a user TX queue; only queues 0 (A) and 1 (B) shape */
+#define IGB_QUEUE_CLASS_STRICT 0	/* strict priority, no credit shaper */
+#define IGB_QUEUE_CLASS_A      1	/* SR class A, credit based shaper */
+#define IGB_QUEUE_CLASS_B      2	/* SR class B, credit based shaper */
+
+/* size of the physically contiguous buffer returned by IGB_MAPBUF_HUGE */
+#define IGB_HUGEBUF_SIZE   (2 * 1024 * 1024)
 
 #define IGB_BIND_NAMESZ	24
 
@@ -905,6 +946,35 @@ struct igb_link_cmd {
 	u32		duplex;
 };
 
+struct igb_poll_cmd {
+	u32		enable;	/* mask the user queue interrupts */
+};
+
+/* pin the interrupt rate of a kernel queue, usecs 0 restores adaptive ITR */
+struct igb_itr_cmd {
+	u32		queue;
+	u32		usecs;
+};
+
+/* queue layout and what of it is claimed, from IGB_GET_QUEUES */
+struct igb_queue_cmd {
+	u32		user_queues;	/* queues 0..user_queues-1 are user's */
+	u32		tx_in_use;	/* mapped TX rings, bit per queue */
+	u32		rx_in_use;	/* mapped RX rings, bit per queue */
+	u32		flex_in_use;	/* allocated flex filters, bit per id */
+	u32		queue_class[4];	/* IGB_QUEUE_CLASS_* per TX queue */
+};
+
+struct igb_class_cmd {
+	u32		queue;
+	u32		queue_class;	/* IGB_QUEUE_CLASS_* */
+};
+
+/* filter_id IGB_FLEX_ANY takes the lowest free filter and returns it */
+struct igb_flex_cmd {
+	u32		filter_id;
+};
+
 struct igb_private_data {
 	struct igb_adapter *adapter;
 	/* user-dma specific variable for buffer */
@@ -912,6 +982,7 @@ struct igb_private_data {
 	/* user-dma specific variable for TX and RX */
 	u32	uring_tx_init;
 	u32	uring_rx_init;
+	u32	flex_in_use;
 };
 
 #endif /* _IGB_H_ */
@@ -886,7 +886,8 @@ static int igb_set_ringparam(struct net_device *netdev,
 
 	if (!netif_running(adapter->netdev)) {
 		for (i = 0; i < adapter->num_tx_queues; i++)
-			adapter->tx_ring[i]->count = new_tx_count;
+			adapter->tx_ring[i]->count =
+				igb_avb_tx_size(adapter, i) ?: new_tx_count;
 		for (i = 0; i < adapter->num_rx_queues; i++)
 			adapter->rx_ring[i]->count = new_rx_count;
 		adapter->tx_ring_count = new_tx_count;
@@ -918,7 +919,8 @@ static int igb_set_ringparam(struct net_device *netdev,
 			memcpy(&temp_ring[i], adapter->tx_ring[i],
 			       sizeof(struct igb_ring));
 
-			temp_ring[i].count = new_tx_count;
+			temp_ring[i].count =
+				igb_avb_tx_size(adapter, i) ?: new_tx_count;
 			err = igb_setup_tx_resources(&temp_ring[i]);
 			if (err) {
 				while (i) {
@@ -2036,6 +2038,7 @@ static int igb_set_coalesce(struct net_device *netdev,
 			q_vector->itr_val = adapter->tx_itr_setting;
 		if (q_vector->itr_val && q_vector->itr_val <= 3)
 			q_vector->itr_val = IGB_START_ITR;
+		q_vector->itr_fixed = 0;
 		q_vector->set_itr = 1;
 	}
 
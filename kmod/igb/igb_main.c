@@ -365,6 +365,19 @@ MODULE_PARM_DESC(debug, "Debug level (0=none, ..., 16=all)");
 static int tx_size = 256; /*default value*/
 module_param(tx_size, int, 0);
 MODULE_PARM_DESC(tx_size, "Tx Ring size passed in insmod parameter");
+
+static int avb_polled;
+module_param(avb_polled, int, 0);
+MODULE_PARM_DESC(avb_polled, "Mask the interrupts of the user (AVB) queues, which user space polls (0,1), default 0=off, needs MSI-X");
+
+static int avb_user_queues = IGB_USER_QUEUES;
+module_param(avb_user_queues, int, 0);
+MODULE_PARM_DESC(avb_user_queues, "Number of queues, from queue 0 up, left to user space (AVB) (1-3), default 2");
+
+static int avb_tx_size[IGB_MAX_USER_QUEUES];
+static unsigned int num_avb_tx_size;
+module_param_array(avb_tx_size, int, &num_avb_tx_size, 0);
+MODULE_PARM_DESC(avb_tx_size, "Tx ring size of each user (AVB) queue, e.g. 4096,1024 (80-4096, rounded up to 256), default 0=tx_size");
 /**
  * igb_init_module - Driver Registration Routine
  *
@@ -534,6 +547,22 @@ static void igb_write_ivar(struct e1000_hw *hw, int msix_vector,
 	E1000_WRITE_REG_ARRAY(hw, E1000_IVAR0, index, ivar);
 }
 
+/* true if every ring of the vector is a user (AVB) queue */
+static bool igb_user_q_vector(struct igb_q_vector *q_vector)
+{
+	u32 user_queues = q_vector->adapter->user_queues;
+
+	if (!q_vector->rx.ring && !q_vector->tx.ring)
+		return false;
+	if (q_vector->rx.ring &&
+	    q_vector->rx.ring->queue_index >= user_queues)
+		return false;
+	if (q_vector->tx.ring &&
+	    q_vector->tx.ring->queue_index >= user_queues)
+		return false;
+	return true;
+}
+
 #define IGB_N0_QUEUE -1
 static void igb_assign_vector(struct igb_q_vector *q_vector, int msix_vector)
 {
@@ -608,8 +637,15 @@ static void igb_assign_vector(struct igb_q_vector *q_vector, int msix_vector)
 		break;
 	}
 
-	/* add q_vector eims value to global eims_enable_mask */
-	adapter->eims_enable_mask |= q_vector->eims_value;
+	/*
+	 * add q_vector eims value to global eims_enable_mask, unless it only
+	 * serves user queues that are polled with interrupts masked
+	 */
+	if (igb_user_q_vector(q_vector))
+		adapter->eims_user |= q_vector->eims_value;
+	if (!(adapter->avb_polled && adapter->msix_entries &&
+	      igb_user_q_vector(q_vector)))
+		adapter->eims_enable_mask |= q_vector->eims_value;
 
 	/* configure q_vector to set itr on first interrupt */
 	q_vector->set_itr = 1;
@@ -628,6 +664,7 @@ static void igb_configure_msix(struct igb_adapter *adapter)
 	struct e1000_hw *hw = &adapter->hw;
 
 	adapter->eims_enable_mask = 0;
+	adapter->eims_user = 0;
 
 	/* set vector for other causes, i.e. link changes */
 	switch (hw->mac.type) {
@@ -1209,7 +1246,8 @@ static int igb_alloc_q_vector(struct igb_adapter *adapter,
 			set_bit(IGB_RING_FLAG_TX_CTX_IDX, &ring->flags);
 
 		/* apply Tx specific ring traits */
-		ring->count = adapter->tx_ring_count;
+		ring->count = igb_avb_tx_size(adapter, txr_idx) ?:
+			      adapter->tx_ring_count;
 		ring->queue_index = txr_idx;
 
 		/* assign ring to adapter */
@@ -3228,6 +3266,7 @@ static int igb_sw_init(struct igb_adapter *adapter)
 	struct e1000_hw *hw = &adapter->hw;
 	struct net_device *netdev = adapter->netdev;
 	struct pci_dev *pdev = adapter->pdev;
+	int i;
 
 	/* PCI config space info */
 
@@ -3243,6 +3282,27 @@ static int igb_sw_init(struct igb_adapter *adapter)
 	/* set default ring sizes */
 	adapter->tx_ring_count = tx_size;
 	printk(KERN_INFO "igb_avb adapter->tx_ring_size %d", tx_size);
+	adapter->avb_polled = !!avb_polled;
+	adapter->user_queues = clamp_t(int, avb_user_queues, 1,
+				       IGB_MAX_USER_QUEUES);
+	/*
+	 * Deep rings let a talker queue many milliseconds of launch time
+	 * frames ahead. Whole pages of descriptors, so that libigb, which
+	 * sizes a ring from its mapping, agrees with TDLEN.
+	 */
+	for (i = 0; i < IGB_MAX_USER_QUEUES; i++) {
+		if (avb_tx_size[i] <= 0)
+			continue;
+		adapter->avb_tx_size[i] = ALIGN(clamp_t(int, avb_tx_size[i],
+							IGB_MIN_TXD,
+							IGB_MAX_TXD), 256);
+		printk(KERN_INFO "igb_avb queue %d tx ring size %d", i,
+		       adapter->avb_tx_size[i]);
+	}
+	adapter->queue_class[0] = IGB_QUEUE_CLASS_A;
+	adapter->queue_class[1] = IGB_QUEUE_CLASS_B;
+	adapter->queue_class[2] = IGB_QUEUE_CLASS_STRICT;
+	adapter->queue_class[3] = IGB_QUEUE_CLASS_STRICT;
 	adapter->rx_ring_count = IGB_DEFAULT_RXD;
 
 	/* set default work limits */
@@ -7137,8 +7197,9 @@ void igb_ring_irq_enable(struct igb_q_vector *q_vector)
 	struct igb_adapter *adapter = q_vector->adapter;
 	struct e1000_hw *hw = &adapter->hw;
 
-	if ((q_vector->rx.ring && (adapter->rx_itr_setting & 3)) ||
-	    (!q_vector->rx.ring && (adapter->tx_itr_setting & 3))) {
+	if (!q_vector->itr_fixed &&
+	    ((q_vector->rx.ring && (adapter->rx_itr_setting & 3)) ||
+	     (!q_vector->rx.ring && (adapter->tx_itr_setting & 3)))) {
 		if ((adapter->num_q_vectors == 1) && !adapter->vf_data)
 			igb_set_itr(q_vector);
 		else
@@ -7146,10 +7207,14 @@ void igb_ring_irq_enable(struct igb_q_vector *q_vector)
 	}
 
 	if (!test_bit(__IGB_DOWN, &adapter->state)) {
-		if (adapter->msix_entries)
-			E1000_WRITE_REG(hw, E1000_EIMS, q_vector->eims_value);
-		else
+		if (adapter->msix_entries) {
+			/* polled user queues stay masked */
+			if (q_vector->eims_value & adapter->eims_enable_mask)
+				E1000_WRITE_REG(hw, E1000_EIMS,
+						q_vector->eims_value);
+		} else {
 			igb_irq_enable(adapter);
+		}
 	}
 }
 
@@ -7210,7 +7275,7 @@ static bool igb_clean_tx_irq(struct igb_q_vector *q_vector)
 		return true;
 
 	/* don't service user (AVB) queues */
-	if (tx_ring->queue_index < 2)
+	if (tx_ring->queue_index < adapter->user_queues)
 		return true;
 
 	tx_buffer = &tx_ring->tx_buffer_info[i];
@@ -8212,7 +8277,7 @@ static bool igb_clean_rx_irq(struct igb_q_vector *q_vector, int budget)
 	u16 cleaned_count = igb_desc_unused(rx_ring);
 
 	/* don't service user (AVB) queues */
-	if (rx_ring->queue_index < 2)
+	if (rx_ring->queue_index < q_vector->adapter->user_queues)
 		return true;
 
 	do {
@@ -8529,7 +8594,7 @@ static bool igb_clean_rx_irq(struct igb_q_vector *q_vector, int budget)
 	u16 cleaned_count = igb_desc_unused(rx_ring);
 
 	/* don't service user (AVB) queues */
-	if (rx_ring->queue_index < 2)
+	if (rx_ring->queue_index < q_vector->adapter->user_queues)
 		return true;
 
 	do {
@@ -10087,6 +10152,7 @@ s32 igb_write_i2c_byte(struct e1000_hw *hw, u8 byte_offset,
 #endif /*  HAVE_I2C_SUPPORT */
 static int igb_init_avb(struct e1000_hw *hw)
 {
+	struct igb_adapter *adapter = hw->back;
 	u32	tqavctrl;
 	u32	tqavcc0, tqavcc1;
 	u32	tqavhc0, tqavhc1;
@@ -10109,8 +10175,12 @@ static int igb_init_avb(struct e1000_hw *hw)
 	 * after the device has started.
 	 */
 
-	tqavcc0 = E1000_TQAVCC_QUEUEMODE; /* no idle slope */
-	tqavcc1 = E1000_TQAVCC_QUEUEMODE; /* no idle slope */
+	tqavcc0 = 0; /* no idle slope */
+	tqavcc1 = 0; /* no idle slope */
+	if (adapter->queue_class[0] != IGB_QUEUE_CLASS_STRICT)
+		tqavcc0 |= E1000_TQAVCC_QUEUEMODE;
+	if (adapter->queue_class[1] != IGB_QUEUE_CLASS_STRICT)
+		tqavcc1 |= E1000_TQAVCC_QUEUEMODE;
 	tqavhc0 = 0xFFFFFFFF; /* unlimited credits */
 	tqavhc1 = 0xFFFFFFFF; /* unlimited credits */
 
@@ -10284,6 +10354,281 @@ static long igb_getspeed(struct file *file, void __user *arg)
 	return 0;
 }
 
+/* mask (or unmask) the interrupts of the vectors serving only user queues */
+static void igb_set_avb_polled(struct igb_adapter *adapter, bool polled)
+{
+	struct e1000_hw *hw = &adapter->hw;
+	u32 regval;
+
+	adapter->avb_polled = polled;
+
+	if (!adapter->msix_entries || !adapter->eims_user)
+		return;
+
+	if (polled) {
+		adapter->eims_enable_mask &= ~adapter->eims_user;
+		regval = E1000_READ_REG(hw, E1000_EIAM);
+		E1000_WRITE_REG(hw, E1000_EIAM, regval & ~adapter->eims_user);
+		E1000_WRITE_REG(hw, E1000_EIMC, adapter->eims_user);
+		regval = E1000_READ_REG(hw, E1000_EIAC);
+		E1000_WRITE_REG(hw, E1000_EIAC, regval & ~adapter->eims_user);
+	} else {
+		adapter->eims_enable_mask |= adapter->eims_user;
+		if (!test_bit(__IGB_DOWN, &adapter->state)) {
+			regval = E1000_READ_REG(hw, E1000_EIAC);
+			E1000_WRITE_REG(hw, E1000_EIAC,
+					regval | adapter->eims_user);
+			regval = E1000_READ_REG(hw, E1000_EIAM);
+			E1000_WRITE_REG(hw, E1000_EIAM,
+					regval | adapter->eims_user);
+			E1000_WRITE_REG(hw, E1000_EIMS, adapter->eims_user);
+		}
+	}
+	E1000_WRITE_FLUSH(hw);
+}
+
+static long igb_setpolled(struct file *file, void __user *arg)
+{
+	struct igb_private_data *igb_priv = file->private_data;
+	struct igb_adapter *adapter;
+	struct igb_poll_cmd req;
+
+	if (igb_priv == NULL) {
+		printk("cannot find private data!\n");
+		return -ENOENT;
+	}
+
+	adapter = igb_priv->adapter;
+	if (adapter == NULL) {
+		printk("map to unbound device!\n");
+		return -ENOENT;
+	}
+
+	if (copy_from_user(&req, arg, sizeof(req))) {
+		printk("copy_from_user failed\n");
+		return -EFAULT;
+	}
+
+	/* with a shared vector the user queues can't be masked on their own */
+	if (req.enable && !adapter->msix_entries)
+		return -EOPNOTSUPP;
+
+	rtnl_lock();
+	igb_set_avb_polled(adapter, !!req.enable);
+	rtnl_unlock();
+
+	return 0;
+}
+
+static long igb_setitr(struct file *file, void __user *arg)
+{
+	struct igb_private_data *igb_priv = file->private_data;
+	struct igb_adapter *adapter;
+	struct igb_q_vector *q_vectors[2];
+	struct igb_itr_cmd req;
+	int i;
+
+	if (igb_priv == NULL) {
+		printk("cannot find private data!\n");
+		return -ENOENT;
+	}
+
+	adapter = igb_priv->adapter;
+	if (adapter == NULL) {
+		printk("map to unbound device!\n");
+		return -ENOENT;
+	}
+
+	if (copy_from_user(&req, arg, sizeof(req))) {
+		printk("copy_from_user failed\n");
+		return -EFAULT;
+	}
+
+	/* only the kernel queues raise interrupts worth throttling */
+	if (req.queue < adapter->user_queues || req.usecs > IGB_MAX_ITR_USECS)
+		return -EINVAL;
+
+	rtnl_lock();
+	if (req.queue >= adapter->num_rx_queues ||
+	    req.queue >= adapter->num_tx_queues) {
+		rtnl_unlock();
+		return -EINVAL;
+	}
+
+	/* without queue pairs RX and TX of the queue have their own vectors */
+	q_vectors[0] = adapter->rx_ring[req.queue]->q_vector;
+	q_vectors[1] = adapter->tx_ring[req.queue]->q_vector;
+	for (i = 0; i < 2; i++) {
+		struct igb_q_vector *q_vector = q_vectors[i];
+
+		if (!q_vector || (i && q_vector == q_vectors[0]))
+			continue;
+		q_vector->itr_fixed = req.usecs << 2;
+		if (q_vector->itr_fixed)
+			q_vector->itr_val = q_vector->itr_fixed;
+		else if (q_vector->rx.ring)
+			q_vector->itr_val = adapter->rx_itr_setting;
+		else
+			q_vector->itr_val = adapter->tx_itr_setting;
+		if (q_vector->itr_val && q_vector->itr_val <= 3)
+			q_vector->itr_val = IGB_START_ITR;
+		q_vector->set_itr = 1;
+	}
+	rtnl_unlock();
+
+	return 0;
+}
+
+static long igb_getqueues(struct file *file, void __user *arg)
+{
+	struct igb_private_data *igb_priv = file->private_data;
+	struct igb_adapter *adapter;
+	struct igb_queue_cmd req;
+	int i;
+
+	if (igb_priv == NULL) {
+		printk("cannot find private data!\n");
+		return -ENOENT;
+	}
+
+	adapter = igb_priv->adapter;
+	if (adapter == NULL) {
+		printk("map to unbound device!\n");
+		return -ENOENT;
+	}
+
+	memset(&req, 0, sizeof(req));
+	mutex_lock(&adapter->lock);
+	req.user_queues = adapter->user_queues;
+	req.tx_in_use = adapter->uring_tx_init;
+	req.rx_in_use = adapter->uring_rx_init;
+	req.flex_in_use = adapter->flex_in_use;
+	for (i = 0; i < 4; i++)
+		req.queue_class[i] = adapter->queue_class[i];
+	mutex_unlock(&adapter->lock);
+
+	if (copy_to_user(arg, &req, sizeof(req))) {
+		printk("copyout to user failed\n");
+		return -EFAULT;
+	}
+	return 0;
+}
+
+/*
+ * Only queues 0 and 1 have credit based shapers, and queue 0 always wins
+ * the arbitration, so class A can only be queue 0 and class B queue 1.
+ * Either may instead run strict priority, e.g. for CRF or control traffic.
+ */
+static long igb_setqueueclass(struct file *file, void __user *arg)
+{
+	struct igb_private_data *igb_priv = file->private_data;
+	struct igb_adapter *adapter;
+	struct e1000_hw *hw;
+	struct igb_class_cmd req;
+	u32 tqavcc;
+
+	if (igb_priv == NULL) {
+		printk("cannot find private data!\n");
+		return -ENOENT;
+	}
+
+	adapter = igb_priv->adapter;
+	if (adapter == NULL) {
+		printk("map to unbound device!\n");
+		return -ENOENT;
+	}
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	if (req.queue >= adapter->user_queues ||
+	    req.queue_class > IGB_QUEUE_CLASS_B)
+		return -EINVAL;
+	if ((req.queue_class == IGB_QUEUE_CLASS_A && req.queue != 0) ||
+	    (req.queue_class == IGB_QUEUE_CLASS_B && req.queue != 1))
+		return -EOPNOTSUPP;
+
+	mutex_lock(&adapter->lock);
+	if (req.queue <= 1) {
+		hw = &adapter->hw;
+		tqavcc = E1000_READ_REG(hw, E1000_I210_TQAVCC(req.queue));
+		if (req.queue_class == IGB_QUEUE_CLASS_STRICT)
+			tqavcc &= ~E1000_TQAVCC_QUEUEMODE;
+		else
+			tqavcc |= E1000_TQAVCC_QUEUEMODE;
+		E1000_WRITE_REG(hw, E1000_I210_TQAVCC(req.queue), tqavcc);
+	}
+	adapter->queue_class[req.queue] = req.queue_class;
+	mutex_unlock(&adapter->lock);
+
+	return 0;
+}
+
+/*
+ * Flex filters are programmed by user space through the mapped registers,
+ * the driver only arbitrates which process owns which filter.
+ */
+static long igb_flexfilter(struct file *file, void __user *arg, int cmd)
+{
+	struct igb_private_data *igb_priv = file->private_data;
+	struct igb_adapter *adapter;
+	struct igb_flex_cmd req;
+	u32 id;
+
+	if (igb_priv == NULL) {
+		printk("cannot find private data!\n");
+		return -ENOENT;
+	}
+
+	adapter = igb_priv->adapter;
+	if (adapter == NULL) {
+		printk("map to unbound device!\n");
+		return -ENOENT;
+	}
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	mutex_lock(&adapter->lock);
+	if (cmd == IGB_FREE_FLEX) {
+		if (req.filter_id >= IGB_MAX_FLEX_FILTERS ||
+		    !(igb_priv->flex_in_use & (1 << req.filter_id))) {
+			mutex_unlock(&adapter->lock);
+			return -EINVAL;
+		}
+		adapter->flex_in_use &= ~(1 << req.filter_id);
+		igb_priv->flex_in_use &= ~(1 << req.filter_id);
+		mutex_unlock(&adapter->lock);
+		return 0;
+	}
+
+	if (req.filter_id == IGB_FLEX_ANY) {
+		for (id = 0; id < IGB_MAX_FLEX_FILTERS; id++)
+			if (!(adapter->flex_in_use & (1 << id)))
+				break;
+	} else {
+		id = req.filter_id;
+	}
+	if (id >= IGB_MAX_FLEX_FILTERS) {
+		mutex_unlock(&adapter->lock);
+		return req.filter_id == IGB_FLEX_ANY ? -ENOSPC : -EINVAL;
+	}
+	if (adapter->flex_in_use & (1 << id)) {
+		mutex_unlock(&adapter->lock);
+		return -EBUSY;
+	}
+	adapter->flex_in_use |= (1 << id);
+	igb_priv->flex_in_use |= (1 << id);
+	mutex_unlock(&adapter->lock);
+
+	req.filter_id = id;
+	if (copy_to_user(arg, &req, sizeof(req))) {
+		printk("copyout to user failed\n");
+		return -EFAULT;
+	}
+	return 0;
+}
+
 static long igb_mapbuf_user(struct file *file, void __user *arg, int ring)
 {
 	struct igb_private_data *igb_priv = file->private_data;
@@ -10293,6 +10638,8 @@ static long igb_mapbuf_user(struct file *file, void __user *arg, int ring)
 	struct page *page;
 	dma_addr_t page_dma;
 	struct igb_user_page *userpage;
+	unsigned int order = 0;
+	gfp_t gfp = GFP_ATOMIC | __GFP_COLD;
 
 	if (igb_priv == NULL) {
 		printk("cannot find private data!\n");
@@ -10323,33 +10670,44 @@ static long igb_mapbuf_user(struct file *file, void __user *arg, int ring)
 		igb_priv->userpages = userpage;
 	}
 
+	/*
+	 * IGB_MAPBUF_HUGE hands out one physically contiguous block so that
+	 * user space can carve many (or jumbo) packet buffers from a single
+	 * mapping. Higher-order allocations may sleep to compact memory.
+	 */
+	if (ring == IGB_MAPBUF_HUGE) {
+		order = get_order(IGB_HUGEBUF_SIZE);
+		gfp = GFP_KERNEL | __GFP_COMP | __GFP_NOWARN;
+	}
+
 #if defined(CONFIG_IGB_SUPPORT_32BIT_IOCTL)
 #if defined(CONFIG_ZONE_DMA32)
-	page = alloc_page(GFP_ATOMIC | __GFP_COLD | GFP_DMA32);
+	gfp |= GFP_DMA32;
 #else /* defined(CONFIG_ZONE_DMA32) */
-	page = alloc_page(GFP_ATOMIC | __GFP_COLD | GFP_DMA);
+	gfp |= GFP_DMA;
 #endif /* defined(CONFIG_ZONE_DMA32) */
-#else /* defined(CONFIG_IGB_SUPPORT_32BIT_IOCTL) */
-	page = alloc_page(GFP_ATOMIC | __GFP_COLD);
 #endif /* defined(CONFIG_IGB_SUPPORT_32BIT_IOCTL) */
+	page = alloc_pages(gfp, order);
 	if (unlikely(!page)) {
 		err = -ENOMEM;
 		goto page_failed;
 	}
 
+	userpage->page = page;
+	userpage->order = order;
+
 	page_dma = dma_map_page(pci_dev_to_dev(adapter->pdev), page,
-			0, PAGE_SIZE, DMA_FROM_DEVICE);
+			0, PAGE_SIZE << order, DMA_FROM_DEVICE);
 
 	if (dma_mapping_error(pci_dev_to_dev(adapter->pdev), page_dma)) {
 		err = -ENOMEM;
 		goto map_failed;
 	}
 
-	igb_priv->userpages->page = page;
-	igb_priv->userpages->page_dma = page_dma;
+	userpage->page_dma = page_dma;
 
 	req.physaddr = page_dma;
-	req.mmap_size = PAGE_SIZE;
+	req.mmap_size = PAGE_SIZE << order;
 	mutex_unlock(&adapter->lock);
 
 	if (copy_to_user(arg, &req, sizeof(req))) {
@@ -10363,10 +10721,10 @@ static long igb_mapbuf_user(struct file *file, void __user *arg, int ring)
 
 copy_failed:
 	dma_unmap_page(pci_dev_to_dev(adapter->pdev),
-			userpage->page_dma, PAGE_SIZE,
+			userpage->page_dma, PAGE_SIZE << userpage->order,
 			DMA_FROM_DEVICE);
 map_failed:
-	put_page(userpage->page);
+	__free_pages(userpage->page, userpage->order);
 page_failed:
 	if (userpage->prev)
 		userpage->prev->next = userpage->next;
@@ -10402,7 +10760,7 @@ static long igb_mapbuf(struct file *file, void __user *arg, int ring)
 	}
 
 	if ((ring == IGB_MAPRING) || (ring == IGB_MAP_TX_RING)) {
-		if (req.queue >= 3) {
+		if (req.queue >= adapter->user_queues) {
 			printk("mapring:invalid queue specified(%d)\n",
 			       req.queue);
 			return -EINVAL;
@@ -10427,7 +10785,7 @@ static long igb_mapbuf(struct file *file, void __user *arg, int ring)
 		req.mmap_size = adapter->tx_ring[req.queue]->size;
 		mutex_unlock(&adapter->lock);
 	} else if (ring == IGB_MAP_RX_RING) {
-		if (req.queue >= 3) {
+		if (req.queue >= adapter->user_queues) {
 			printk("mapring:invalid queue specified(%d)\n",
 			       req.queue);
 			return -EINVAL;
@@ -10545,10 +10903,10 @@ static long igb_unmapbuf(struct file *file, void __user *arg, int ring)
 
 		dma_unmap_page(pci_dev_to_dev(adapter->pdev),
 				userpage->page_dma,
-				PAGE_SIZE,
+				PAGE_SIZE << userpage->order,
 				DMA_FROM_DEVICE);
 
-		put_page(userpage->page);
+		__free_pages(userpage->page, userpage->order);
 
 		/* take the page out of our list and free it */
 		if (userpage->prev)
@@ -10584,6 +10942,7 @@ static long igb_ioctl_file(struct file *file, unsigned int cmd,
 		err = igb_mapbuf(file, argp, cmd);
 		break;
 	case IGB_MAPBUF:
+	case IGB_MAPBUF_HUGE:
 		err = igb_mapbuf_user(file, argp, cmd);
 		break;
 	case IGB_UNMAP_TX_RING:
@@ -10594,6 +10953,22 @@ static long igb_ioctl_file(struct file *file, unsigned int cmd,
 	case IGB_LINKSPEED:
 		err = igb_getspeed(file, argp);
 		break;
+	case IGB_SET_POLLED:
+		err = igb_setpolled(file, argp);
+		break;
+	case IGB_SET_ITR:
+		err = igb_setitr(file, argp);
+		break;
+	case IGB_GET_QUEUES:
+		err = igb_getqueues(file, argp);
+		break;
+	case IGB_SET_QUEUE_CLASS:
+		err = igb_setqueueclass(file, argp);
+		break;
+	case IGB_ALLOC_FLEX:
+	case IGB_FREE_FLEX:
+		err = igb_flexfilter(file, argp, cmd);
+		break;
 	default:
 		err = -EINVAL;
 		break;
@@ -10642,15 +11017,26 @@ static int igb_close_file(struct inode *inode, struct file *file)
 	adapter->uring_tx_init &= ~igb_priv->uring_tx_init;
 	adapter->uring_rx_init &= ~igb_priv->uring_rx_init;
 
+	/* stop steering frames into rings that are going away */
+	if (igb_priv->flex_in_use) {
+		struct e1000_hw *hw = &adapter->hw;
+		u32 wufc = E1000_READ_REG(hw, E1000_WUFC);
+
+		wufc &= ~(igb_priv->flex_in_use * E1000_WUFC_FLX0);
+		E1000_WRITE_REG(hw, E1000_WUFC, wufc);
+		adapter->flex_in_use &= ~igb_priv->flex_in_use;
+		igb_priv->flex_in_use = 0;
+	}
+
 	userpage = igb_priv->userpages;
 
 	while (userpage != NULL) {
 		dma_unmap_page(pci_dev_to_dev(adapter->pdev),
 						userpage->page_dma,
-						PAGE_SIZE,
+						PAGE_SIZE << userpage->order,
 						DMA_FROM_DEVICE);
 
-		put_page(userpage->page);
+		__free_pages(userpage->page, userpage->order);
 
 		/* take the page out of our list and free it */
 		if (userpage->prev)
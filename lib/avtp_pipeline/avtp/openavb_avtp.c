@@ -46,6 +46,10 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_avtp.h"
 #include "openavb_rawsock.h"
 #include "openavb_mediaq.h"
+#include "openavb_probe.h"
+#if AVB_FEATURE_STATIC_PAIRS
+#include "openavb_avtp_pairs.h"
+#endif
 
 #define	AVB_LOG_COMPONENT	"AVTP"
 #include "openavb_log.h"
@@ -53,6 +57,19 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // Maximum time that AVTP RX/TX calls should block before returning
 #define AVTP_MAX_BLOCK_USEC (1 * MICROSECONDS_PER_SECOND)
 
+// Transit calibration: frames between timed frames while calibrating and
+// afterwards, how long a hardware TX timestamp may take to come back, and
+// misses in a row before the launch or submit time is used instead
+#define AVTP_CAL_INTERVAL_FRAMES		16
+#define AVTP_CAL_MONITOR_FRAMES			256
+#define AVTP_CAL_HW_TIMEOUT_NS			(100 * NANOSECONDS_PER_MSEC)
+#define AVTP_CAL_HW_MAX_MISSES			8
+
+// Redundant listener: longest wait on one interface before looking at the
+// other, and frames in a row behind the sequence taken as a talker restart
+#define AVTP_REDUNDANT_SLICE_USEC		250
+#define AVTP_REDUNDANT_RESYNC_FRAMES	(2 * OPENAVB_RAWSOCK_RX_BURST_MAX)
+
 /*
  * This is broken out into a function, so that we can close and reopen
  * the socket if we detect a problem receiving frames.
@@ -80,6 +97,18 @@ static openavbRC openAvtpSock(avtp_stream_t *pStream)
 		if (!pStream->tx) {
 			// Set the multicast address that we want to receive
 			openavbRawsockRxMulticast(pStream->rawsock, TRUE, pStream->dest_addr.ether_addr_octet);
+			// and the stream, for rawsocks shared between listeners
+			openavbRawsockRxStreamID(pStream->rawsock, pStream->streamIDnet);
+			// Receive whole blocks of frames if asked to
+			if (pStream->rxBlockUsec
+				&& !openavbRawsockRxSetBlockTimeout(pStream->rawsock, pStream->rxBlockUsec)) {
+				AVB_LOG_INFO("Block receive not available; receiving frame by frame");
+			}
+			// and have the kernel busy poll the NIC while we spin
+			if (pStream->rxBusyPollUsec
+				&& !openavbRawsockRxSetBusyPoll(pStream->rawsock, pStream->rxBusyPollUsec)) {
+				AVB_LOG_INFO("Kernel busy poll not available; spinning in user space only");
+			}
 		}
 		AVB_RC_RET(OPENAVB_AVTP_SUCCESS);
 	}
@@ -94,7 +123,7 @@ static openavbRC openAvtpSock(avtp_stream_t *pStream)
 #define HIDX_AVTP_TIMESPAMP32		12
 static void processTimestampEval(avtp_stream_t *pStream, U8 *pHdr)
 {
-	AVB_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
 
 	if (pStream->tsEval) {
 		bool tsValid =  (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE;
@@ -109,9 +138,157 @@ static void processTimestampEval(avtp_stream_t *pStream, U8 *pHdr)
 		}
 	}
 
-	AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+	AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+}
+
+static openavbRC x_avtpBuildTxHdr(avtp_stream_t *pStream);
+static void x_avtpSelectPath(avtp_stream_t *pStream);
+
+// Subtypes with the common stream header, whose avtp_timestamp is at
+// HIDX_AVTP_TIMESPAMP32: IEC 61883/IIDC, AAF and CVF
+static inline bool x_avtpCommonTimestamp(U8 subtype)
+{
+	return subtype == 0x00 || subtype == 0x02 || subtype == 0x03;
+}
+
+// Move the AVTP timestamp of a TX frame by the calibrated offset
+static inline void x_avtpPresentAdjust(avtp_stream_t *pStream, U8 *pHdr)
+{
+	if (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) {
+		U32 ts = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]));
+		*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]) = htonl(ts + (S32)pStream->presentAdjNS);
+	}
+}
+
+// Set the offset to the longest capture to wire time plus the margin
+static void x_avtpCalApply(avtp_stream_t *pStream)
+{
+	U64 maxTransitNS = pStream->max_transit_usec * NANOSECONDS_PER_USEC;
+	U64 offsetNS = pStream->calPathMaxNS + pStream->calMarginNS;
+	if (offsetNS > maxTransitNS) {
+		AVB_LOGF_WARNING("Transit calibration: %" PRIu64 "us needed, max_transit is %" PRIu64 "us",
+			offsetNS / NANOSECONDS_PER_USEC, pStream->max_transit_usec);
+		offsetNS = maxTransitNS;
+	}
+	pStream->presentAdjNS = (S64)offsetNS - (S64)maxTransitNS;
+}
+
+// Take the time a timed frame went out on the wire
+static void x_avtpCalSample(avtp_stream_t *pStream, U64 wireNS)
+{
+	// Capture to wire; the AVTP timestamp is gPTP time modulo 2^32 ns
+	S64 pathNS = (S32)((U32)wireNS - pStream->calAvtpTs) + (S64)(pStream->max_transit_usec * NANOSECONDS_PER_USEC);
+	if (pathNS < 0)
+		return;
+
+	bool bLonger = (U64)pathNS > pStream->calPathMaxNS;
+	if (bLonger)
+		pStream->calPathMaxNS = pathNS;
+
+	if (!pStream->bCalDone) {
+		if (++pStream->calSampleCount >= pStream->calSamples) {
+			pStream->bCalDone = TRUE;
+			x_avtpCalApply(pStream);
+			AVB_LOGF_INFO("Transit calibrated (%s timestamps): path %" PRIu64 "us, offset %uus of max_transit %" PRIu64 "us",
+				pStream->bCalHw ? "hardware" : "software",
+				pStream->calPathMaxNS / NANOSECONDS_PER_USEC,
+				openavbAvtpTxPresentOffset(pStream), pStream->max_transit_usec);
+		}
+	}
+	else if (bLonger && pStream->presentAdjNS < 0) {
+		x_avtpCalApply(pStream);
+		AVB_LOGF_INFO("Transit path grew to %" PRIu64 "us; offset raised to %u usec",
+			pStream->calPathMaxNS / NANOSECONDS_PER_USEC, openavbAvtpTxPresentOffset(pStream));
+	}
+}
+
+// Time the first of the frames about to be submitted, when one is due
+static void x_avtpCalBegin(avtp_stream_t *pStream, U8 *pBuf, U64 launchNS)
+{
+	if (pStream->bCalPending
+		|| ++pStream->calFrameCount < (pStream->bCalDone ? AVTP_CAL_MONITOR_FRAMES : AVTP_CAL_INTERVAL_FRAMES))
+		return;
+
+	U8 *pAvtp = pBuf + pStream->ethHdrLen;
+	if (!(pAvtp[HIDX_AVTP_HIDE7_TV1] & 0x01))
+		return;
+
+	pStream->calFrameCount = 0;
+	pStream->calAvtpTs = ntohl(*(U32 *)(&pAvtp[HIDX_AVTP_TIMESPAMP32])) - (S32)pStream->presentAdjNS;
+	pStream->bCalHw = pStream->calHwMisses < AVTP_CAL_HW_MAX_MISSES
+		&& openavbRawsockTxTimestampNext(pStream->rawsock);
+	pStream->calSubmitNS = launchNS;
+	pStream->bCalPending = TRUE;
+}
+
+// The timed frame was submitted. Without a hardware timestamp it goes
+// out at its launch time, or now.
+static void x_avtpCalSubmitted(avtp_stream_t *pStream)
+{
+	if (!pStream->bCalPending)
+		return;
+
+	U64 nowNS;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	if (pStream->calSubmitNS < nowNS)
+		pStream->calSubmitNS = nowNS;
+	if (!pStream->bCalHw) {
+		pStream->bCalPending = FALSE;
+		x_avtpCalSample(pStream, pStream->calSubmitNS);
+	}
+}
+
+// Pick up the hardware timestamp of the timed frame once it is back
+static void x_avtpCalPoll(avtp_stream_t *pStream)
+{
+	if (!pStream->bCalPending || !pStream->bCalHw)
+		return;
+
+	U64 localNS, wireNS;
+	if (openavbRawsockTxTimestampGet(pStream->rawsock, &localNS)) {
+		pStream->bCalPending = FALSE;
+		pStream->calHwMisses = 0;
+		if (osalAVBTimeLocalToPTP(localNS, &wireNS)) {
+			x_avtpCalSample(pStream, wireNS);
+		}
+		return;
+	}
+
+	U64 nowNS;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	if (nowNS > pStream->calSubmitNS + AVTP_CAL_HW_TIMEOUT_NS) {
+		pStream->bCalPending = FALSE;
+		if (++pStream->calHwMisses == AVTP_CAL_HW_MAX_MISSES) {
+			AVB_LOG_WARNING("No hardware TX timestamps; calibrating with software times");
+		}
+	}
+}
+
+size_t openavbAvtpStreamSize(void)
+{
+	return sizeof(avtp_stream_t);
+}
+
+// Zeroed stream state, in the caller's storage when there is some
+static avtp_stream_t *x_avtpStreamAlloc(void *pStorage)
+{
+	avtp_stream_t *pStream;
+	if (pStorage) {
+		pStream = memset(pStorage, 0, sizeof(avtp_stream_t));
+		pStream->embedded = TRUE;
+	}
+	else {
+		pStream = calloc(1, sizeof(avtp_stream_t));
+	}
+	return pStream;
 }
 
+static void x_avtpStreamFree(avtp_stream_t *pStream)
+{
+	if (!pStream->embedded) {
+		free(pStream);
+	}
+}
 
 /* Initialize AVTP for talking
  */
@@ -127,6 +304,7 @@ openavbRC openavbAvtpTxInit(
 	U16 vlanID,
 	U8  vlanPCP,
 	U16 nbuffers,
+	void *pStorage,
 	void **pStream_out)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
@@ -135,7 +313,7 @@ openavbRC openavbAvtpTxInit(
 	*pStream_out = NULL;
 
 	// Malloc the structure to hold state information
-	avtp_stream_t *pStream = calloc(1, sizeof(avtp_stream_t));
+	avtp_stream_t *pStream = x_avtpStreamAlloc(pStorage);
 	if (!pStream) {
 		AVB_RC_LOG_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_OUT_OF_MEMORY), AVB_TRACE_AVTP);
 	}
@@ -147,6 +325,7 @@ openavbRC openavbAvtpTxInit(
 
 	pStream->pMapCB->map_tx_init_cb(pStream->pMediaQ);
 	pStream->pIntfCB->intf_tx_init_cb(pStream->pMediaQ);
+	x_avtpSelectPath(pStream);
 
 	// Set the frame length
 	pStream->frameLen = pStream->pMapCB->map_max_data_size_cb(pStream->pMediaQ) + ETH_HDR_LEN_VLAN;
@@ -158,10 +337,13 @@ openavbRC openavbAvtpTxInit(
 	pStream->ifname = strdup(ifname);
 	pStream->nbuffers = nbuffers;
 
+	// IGB launch time is always on when built in
+	pStream->bLaunchTime = IGB_LAUNCHTIME_ENABLED ? TRUE : FALSE;
+
 	// Open a raw socket
 	openavbRC rc = openAvtpSock(pStream);
 	if (IS_OPENAVB_FAILURE(rc)) {
-		free(pStream);
+		x_avtpStreamFree(pStream);
 		AVB_RC_LOG_TRACE_RET(rc, AVB_TRACE_AVTP);
 	}
 
@@ -174,12 +356,16 @@ openavbRC openavbAvtpTxInit(
 	}
 	else {
 		openavbRawsockClose(pStream->rawsock);
-		free(pStream);
+		x_avtpStreamFree(pStream);
 		AVB_LOG_ERROR("Failed to get source MAC address");
 		AVB_RC_TRACE_RET(OPENAVB_AVTP_FAILURE, AVB_TRACE_AVTP);
 	}
 
 	hdrInfo.dhost = destAddr;
+	memcpy(pStream->dest_addr.ether_addr_octet, destAddr, ETH_ALEN);
+	pStream->vlanID = vlanID;
+	pStream->vlanPCP = vlanPCP;
+	pStream->fwmark = fwmark;
 	if (vlanPCP != 0 || vlanID != 0) {
 		hdrInfo.vlan = TRUE;
 		hdrInfo.vlan_pcp = vlanPCP;
@@ -198,6 +384,14 @@ openavbRC openavbAvtpTxInit(
         U16 *pStreamUID = (U16 *)((U8 *)(pStream->streamIDnet) + ETH_ALEN);
        *pStreamUID = htons(streamID->uniqueID);
 
+	// Build the header template copied into every frame we send
+	rc = x_avtpBuildTxHdr(pStream);
+	if (IS_OPENAVB_FAILURE(rc)) {
+		openavbRawsockClose(pStream->rawsock);
+		x_avtpStreamFree(pStream);
+		AVB_RC_LOG_TRACE_RET(rc, AVB_TRACE_AVTP);
+	}
+
 	// Set the fwmark - used to steer packets into the right traffic control queue
 	openavbRawsockTxSetMark(pStream->rawsock, fwmark);
 
@@ -285,112 +479,409 @@ static openavbRC fillAvtpHdr(avtp_stream_t *pStream, U8 *pFill)
 	AVB_RC_TRACE_RET(OPENAVB_AVTP_SUCCESS, AVB_TRACE_AVTP_DETAIL);
 }
 
-/* Send a frame
+/* Build the TX header template: the Ethernet header from the rawsock,
+ * then the common AVTP header.
  */
-openavbRC openavbAvtpTx(void *pv, bool bSend, bool txBlockingInIntf)
+static openavbRC x_avtpBuildTxHdr(avtp_stream_t *pStream)
 {
-	AVB_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
-
-	avtp_stream_t *pStream = (avtp_stream_t *)pv;
-	if (!pStream) {
-		AVB_RC_LOG_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT), AVB_TRACE_AVTP_DETAIL);
+	memset(pStream->txHdrTemplate, 0, AVTP_TX_HDR_TEMPLATE_LEN);
+	openavbRawsockTxFillHdr(pStream->rawsock, pStream->txHdrTemplate, &pStream->ethHdrLen);
+	if (pStream->ethHdrLen + AVTP_V0_COMMON_HDR_LEN > AVTP_TX_HDR_TEMPLATE_LEN) {
+		AVB_LOGF_ERROR("Ethernet header too long for TX template: %u", pStream->ethHdrLen);
+		return AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT);
 	}
+	return fillAvtpHdr(pStream, pStream->txHdrTemplate + pStream->ethHdrLen);
+}
 
-	U8 * pAvtpFrame,*pFill;
-	U32 avtpFrameLen, frameLen;
-	tx_cb_ret_t txCBResult = TX_CB_RET_PACKET_NOT_READY;
+// Thread CPU time now, if the phases are being timed
+static inline U64 x_avtpPhaseNow(avtp_stream_t *pStream)
+{
+	U64 nowNS = 0;
+	if (pStream->bPhaseTime)
+		CLOCK_GETTIME64(OPENAVB_CLOCK_THREAD_CPUTIME, &nowNS);
+	return nowNS;
+}
 
-	// Get a TX buf if we don't already have one.
-	//   (We keep the TX buf in our stream data, so that if we don't
-	//    get data from the mapping module, we can use the buf next time.)
-	if (!pStream->pBuf) {
+// Charge the thread CPU time since sinceNS to a phase and return the time now
+static inline U64 x_avtpPhaseMark(avtp_stream_t *pStream, avtp_phase_t phase, U64 sinceNS)
+{
+	U64 nowNS = 0;
+	if (pStream->bPhaseTime) {
+		CLOCK_GETTIME64(OPENAVB_CLOCK_THREAD_CPUTIME, &nowNS);
+		pStream->phaseNS[phase] += nowNS - sinceNS;
+		if (pStream->pCallHist[phase]) {
+			U64 callNS = nowNS - sinceNS;
+			openavbHistRecord(pStream->pCallHist[phase], callNS > UINT32_MAX ? UINT32_MAX : (U32)callNS);
+		}
+	}
+	return nowNS;
+}
 
-		pStream->pBuf = (U8 *)openavbRawsockGetTxFrame(pStream->rawsock, TRUE, &frameLen);
-		if (pStream->pBuf) {
-			assert(frameLen >= pStream->frameLen);
-			// Fill in the Ethernet header
-			openavbRawsockTxFillHdr(pStream->rawsock, pStream->pBuf, &pStream->ethHdrLen);
+// gPTP time now for a latency trace stage
+static inline U64 x_avtpLatNow(void)
+{
+	U64 nowNS = 0;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	return nowNS;
+}
+
+// Start a latency trace sample for the AVTP PDU at pAvtp
+static openavb_lat_sample_t *x_avtpLatBegin(avtp_stream_t *pStream, U8 *pAvtp)
+{
+	openavb_lat_sample_t *pSample = openavbLatTraceBegin(pStream->pLatRing);
+	if (pSample) {
+		memcpy(pSample->streamID, pStream->streamIDnet, sizeof(pSample->streamID));
+		pSample->seq = pAvtp[AVTP_V0_SEQ_NUM_OFFSET];
+		pSample->bTalker = pStream->tx;
+		if (pAvtp[HIDX_AVTP_HIDE7_TV1] & 0x01) {
+			pSample->avtpTimestamp = ntohl(*(U32 *)(&pAvtp[HIDX_AVTP_TIMESPAMP32]));
 		}
 	}
+	return pSample;
+}
 
-	if (pStream->pBuf) {
-		// AVTP frame starts right after the Ethernet header
-		pAvtpFrame = pFill = pStream->pBuf + pStream->ethHdrLen;
-		avtpFrameLen = pStream->frameLen - pStream->ethHdrLen;
+// Stamp the traced frames just handed to the rawsock and publish them
+static inline void x_avtpLatTxDone(avtp_stream_t *pStream)
+{
+	if (pStream->pLatRing && pStream->pLatRing->pending) {
+		openavbLatTraceStamp(pStream->pLatRing, OPENAVB_LAT_TX_SUBMIT, x_avtpLatNow());
+		openavbLatTracePublish(pStream->pLatRing);
+	}
+}
+
+/* Launch time of the next frame from the media queue item at itemNS. The
+ * frames after the first of an item are stepped launchSpacingNS apart so
+ * they leave spread over the interval rather than in a burst. *pFrames is
+ * the count to keep in launchItemFrames once the frame is really sent.
+ */
+static inline U64 x_avtpLaunchSpread(avtp_stream_t *pStream, U64 itemNS, U32 *pFrames)
+{
+	if (!pStream->launchSpacingNS || !itemNS)
+		return itemNS;
+
+	if (itemNS != pStream->launchItemNS) {
+		pStream->launchItemNS = itemNS;
+		pStream->launchItemFrames = 0;
+		*pFrames = 0;
+		return itemNS;
+	}
+
+	*pFrames = pStream->launchItemFrames + 1;
+	return itemNS + *pFrames * pStream->launchSpacingNS;
+}
+
+/* Fill a TX frame with the next AVTP PDU from the mapping module.
+ * Returns the mapping module result; on success *pFrameLen holds the
+ * length of the complete Ethernet frame.
+ *
+ * mapTx and intfTx are the stream's mapping and interface TX callbacks,
+ * passed in so the static pair paths below can call them directly.
+ */
+static inline __attribute__((always_inline)) tx_cb_ret_t x_avtpTxFillWith(avtp_stream_t *pStream, U8 *pBuf, U32 *pFrameLen, U64 *pTimeNsec, bool txBlockingInIntf,
+	openavb_map_tx_cb_t mapTx, openavb_intf_tx_cb_t intfTx)
+{
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
 
-		// Fill the AVTP Header. This must be done before calling the interface and mapping modules.
-		openavbRC rc = fillAvtpHdr(pStream, pFill);
-		if (IS_OPENAVB_FAILURE(rc)) {
-			AVB_RC_LOG_TRACE_RET(rc, AVB_TRACE_AVTP_DETAIL);
+	U8 * pAvtpFrame,*pFill;
+	U32 avtpFrameLen;
+	tx_cb_ret_t txCBResult = TX_CB_RET_PACKET_NOT_READY;
+
+	// AVTP frame starts right after the Ethernet header
+	pAvtpFrame = pFill = pBuf + pStream->ethHdrLen;
+	avtpFrameLen = pStream->frameLen - pStream->ethHdrLen;
+
+	// Fill the Ethernet and AVTP Headers from the template. This must be done
+	// before calling the interface and mapping modules.
+	memcpy(pBuf, pStream->txHdrTemplate, AVTP_TX_HDR_TEMPLATE_LEN);
+	pFill[AVTP_V0_SEQ_NUM_OFFSET] = pStream->avtp_sequence_num;
+
+	U64 timeNsec = 0;
+	U32 launchFrames = 0;
+	U64 phaseNS = x_avtpPhaseNow(pStream);
+	bool bLat = openavbLatTraceWanted(pStream->pLatRing, pStream->avtp_sequence_num);
+	U64 latIntfNS = 0, latMapNS = 0;
+
+	if (!txBlockingInIntf) {
+		// Let the interface module write the payload straight into the frame
+		// when the mapping module supports it.
+		U32 payloadOffset, payloadSize;
+		bool bLend = pStream->pMapCB->map_tx_payload_cb
+			&& pStream->pMapCB->map_tx_payload_cb(pStream->pMediaQ, &payloadOffset, &payloadSize)
+			&& payloadOffset + payloadSize <= avtpFrameLen;
+		if (bLend) {
+			openavbMediaQHeadLend(pStream->pMediaQ, pAvtpFrame + payloadOffset, payloadSize);
 		}
 
-		U64 timeNsec = 0;
+		// Call interface module to read data
+		if (pStream->asrc) {
+			intfTx(openavbAvtpAsrcMediaQ(pStream->asrc));
+			openavbAvtpAsrcRun(pStream->asrc);
+		}
+		else {
+			intfTx(pStream->pMediaQ);
+		}
+		phaseNS = x_avtpPhaseMark(pStream, AVTP_PHASE_INTF, phaseNS);
+		if (bLat)
+			latIntfNS = x_avtpLatNow();
 
-		if (!txBlockingInIntf) {
-			// Call interface module to read data
-			pStream->pIntfCB->intf_tx_cb(pStream->pMediaQ);
+		if (bLend) {
+			openavbMediaQHeadLend(pStream->pMediaQ, NULL, 0);
+		}
 
-#if IGB_LAUNCHTIME_ENABLED
+		if (pStream->bLaunchTime) {
 			// lets get unmodified timestamp from mediaq item about to be sent by mapping
 			media_q_item_t* item = openavbMediaQTailLock(pStream->pMediaQ, true);
 			if (item) {
 				timeNsec = item->pAvtpTime->timeNsec;
 				openavbMediaQTailUnlock(pStream->pMediaQ);
+				timeNsec = x_avtpLaunchSpread(pStream, timeNsec, &launchFrames);
 			}
-#endif
+		}
 
-			// Call mapping module to move data into AVTP frame
-			txCBResult = pStream->pMapCB->map_tx_cb(pStream->pMediaQ, pAvtpFrame, &avtpFrameLen);
-		
-			pStream->bytes += avtpFrameLen;
+		// Call mapping module to move data into AVTP frame
+		txCBResult = mapTx(pStream->pMediaQ, pAvtpFrame, &avtpFrameLen);
+		if (txCBResult == TX_CB_RET_PACKET_NOT_READY && pStream->bTxNull) {
+			// Underrun; keep the listeners fed with the null content frame
+			avtpFrameLen = pStream->frameLen - pStream->ethHdrLen;
+			txCBResult = pStream->pMapCB->map_tx_null_cb(pStream->pMediaQ, pAvtpFrame, &avtpFrameLen);
+			if (txCBResult != TX_CB_RET_PACKET_NOT_READY)
+				pStream->nullFrames++;
 		}
-		else {
+		x_avtpPhaseMark(pStream, AVTP_PHASE_MAP, phaseNS);
+		if (bLat)
+			latMapNS = x_avtpLatNow();
+	
+		pStream->bytes += avtpFrameLen;
+	}
+	else {
 
-#if IGB_LAUNCHTIME_ENABLED
+		if (pStream->bLaunchTime) {
 			// lets get unmodified timestamp from mediaq item about to be sent by mapping
 			media_q_item_t* item = openavbMediaQTailLock(pStream->pMediaQ, true);
 			if (item) {
 				timeNsec = item->pAvtpTime->timeNsec;
 				openavbMediaQTailUnlock(pStream->pMediaQ);
+				timeNsec = x_avtpLaunchSpread(pStream, timeNsec, &launchFrames);
 			}
-#endif
+		}
 
-			// Blocking in interface mode. Pull from media queue for tx first
-			if ((txCBResult = pStream->pMapCB->map_tx_cb(pStream->pMediaQ, pAvtpFrame, &avtpFrameLen)) == TX_CB_RET_PACKET_NOT_READY) {
-				// Call interface module to read data
-				pStream->pIntfCB->intf_tx_cb(pStream->pMediaQ);
-			}
-			else {
-				pStream->bytes += avtpFrameLen;
-			}
+		// Blocking in interface mode. Pull from media queue for tx first
+		txCBResult = mapTx(pStream->pMediaQ, pAvtpFrame, &avtpFrameLen);
+		phaseNS = x_avtpPhaseMark(pStream, AVTP_PHASE_MAP, phaseNS);
+		if (bLat)
+			latMapNS = x_avtpLatNow();
+		if (txCBResult == TX_CB_RET_PACKET_NOT_READY) {
+			// Call interface module to read data
+			intfTx(pStream->pMediaQ);
+			x_avtpPhaseMark(pStream, AVTP_PHASE_INTF, phaseNS);
+		}
+		else {
+			pStream->bytes += avtpFrameLen;
 		}
+	}
 
-		// If we got data from the mapping module, notifiy the raw sockets.
-		if (txCBResult != TX_CB_RET_PACKET_NOT_READY) {
+	if (txCBResult != TX_CB_RET_PACKET_NOT_READY) {
 
-			if (pStream->tsEval) {
-				processTimestampEval(pStream, pAvtpFrame);
+		if (pStream->tsEval) {
+			processTimestampEval(pStream, pAvtpFrame);
+		}
+		if (pStream->presentAdjNS) {
+			x_avtpPresentAdjust(pStream, pAvtpFrame);
+		}
+
+		AVB_PROBE3(avtp_tx, pStream, pStream->avtp_sequence_num, avtpFrameLen);
+
+		if (bLat) {
+			// Published with the submit time once the frame reaches the rawsock
+			openavb_lat_sample_t *pSample = x_avtpLatBegin(pStream, pAvtpFrame);
+			if (pSample) {
+				pSample->stageNS[OPENAVB_LAT_TX_INTF] = latIntfNS;
+				pSample->stageNS[OPENAVB_LAT_TX_MAP] = latMapNS;
+				pSample->stageNS[OPENAVB_LAT_TX_LAUNCH] = timeNsec;
 			}
+		}
+
+		// Increment the sequence number now that we are sure this is a good packet.
+		pStream->avtp_sequence_num++;
+
+		if (timeNsec) {
+			pStream->launchItemFrames = launchFrames;
+		}
+
+		*pFrameLen = avtpFrameLen + pStream->ethHdrLen;
+		*pTimeNsec = timeNsec;
+	}
+
+	AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+	return txCBResult;
+}
+
+// Fill a TX frame through the stream's callback pointers
+static tx_cb_ret_t x_avtpTxFill(void *pv, U8 *pBuf, U32 *pFrameLen, U64 *pTimeNsec, bool txBlockingInIntf)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	return x_avtpTxFillWith(pStream, pBuf, pFrameLen, pTimeNsec, txBlockingInIntf,
+		pStream->pMapCB->map_tx_cb, pStream->pIntfCB->intf_tx_cb);
+}
+
+/* Queue a copy of a filled frame on the redundant interface, under that
+ * interface's header. Never waits for a buffer; a frame there is no buffer
+ * for is only counted, the primary interface still carries it.
+ */
+static void x_avtpTxRedundant(avtp_stream_t *pStream, U8 *pBuf, U32 frameLen, U64 timeNsec)
+{
+	U32 bufLen;
+	U8 *pBuf2 = (U8 *)openavbRawsockGetTxFrame(pStream->rawsock2, FALSE, &bufLen);
+	if (!pBuf2) {
+		pStream->nRedundant++;
+		return;
+	}
+	memcpy(pBuf2, pStream->txHdrTemplate2, pStream->ethHdrLen);
+	memcpy(pBuf2 + pStream->ethHdrLen, pBuf + pStream->ethHdrLen, frameLen - pStream->ethHdrLen);
+	openavbRawsockTxFrameReady(pStream->rawsock2, pBuf2, frameLen, timeNsec);
+}
+
+/* Send a frame
+ */
+openavbRC openavbAvtpTx(void *pv, bool bSend, bool txBlockingInIntf)
+{
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (!pStream) {
+		AVB_RC_LOG_HOT_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT), AVB_TRACE_AVTP_DETAIL);
+	}
+
+	U32 frameLen;
+	U64 phaseNS = x_avtpPhaseNow(pStream);
+
+	// Get a TX buf if we don't already have one.
+	//   (We keep the TX buf in our stream data, so that if we don't
+	//    get data from the mapping module, we can use the buf next time.)
+	if (!pStream->pBuf) {
 
-			// Increment the sequence number now that we are sure this is a good packet.
-			pStream->avtp_sequence_num++;
+		pStream->pBuf = (U8 *)openavbRawsockGetTxFrame(pStream->rawsock, TRUE, &frameLen);
+		if (pStream->pBuf) {
+			assert(frameLen >= pStream->frameLen);
+		}
+		x_avtpPhaseMark(pStream, AVTP_PHASE_RAWSOCK, phaseNS);
+	}
+
+	if (pStream->pBuf) {
+		U64 timeNsec = 0;
+
+		// If we got data from the mapping module, notifiy the raw sockets.
+		if (pStream->txFill(pStream, pStream->pBuf, &frameLen, &timeNsec, txBlockingInIntf) != TX_CB_RET_PACKET_NOT_READY) {
+			phaseNS = x_avtpPhaseNow(pStream);
+			if (pStream->calSamples) {
+				x_avtpCalPoll(pStream);
+				x_avtpCalBegin(pStream, pStream->pBuf, timeNsec);
+			}
+			if (pStream->rawsock2) {
+				x_avtpTxRedundant(pStream, pStream->pBuf, frameLen, timeNsec);
+				if (bSend)
+					openavbRawsockSend(pStream->rawsock2);
+			}
 			// Mark the frame "ready to send".
-			openavbRawsockTxFrameReady(pStream->rawsock, pStream->pBuf, avtpFrameLen + pStream->ethHdrLen, timeNsec);
+			openavbRawsockTxFrameReady(pStream->rawsock, pStream->pBuf, frameLen, timeNsec);
 			// Send if requested
 			if (bSend)
 				openavbRawsockSend(pStream->rawsock);
+			if (pStream->calSamples)
+				x_avtpCalSubmitted(pStream);
+			x_avtpPhaseMark(pStream, AVTP_PHASE_RAWSOCK, phaseNS);
+			x_avtpLatTxDone(pStream);
 			// Drop our reference to it
 			pStream->pBuf = NULL;
 		}
 		else {
-			AVB_RC_TRACE_RET(OPENAVB_AVTP_FAILURE, AVB_TRACE_AVTP_DETAIL);
+			AVB_RC_HOT_TRACE_RET(OPENAVB_AVTP_FAILURE, AVB_TRACE_AVTP_DETAIL);
 		}
 	}
 	else {
-		AVB_RC_TRACE_RET(OPENAVB_AVTP_FAILURE, AVB_TRACE_AVTP_DETAIL);
+		AVB_RC_HOT_TRACE_RET(OPENAVB_AVTP_FAILURE, AVB_TRACE_AVTP_DETAIL);
 	}
 
-	AVB_RC_TRACE_RET(OPENAVB_AVTP_SUCCESS, AVB_TRACE_AVTP_DETAIL);
+	AVB_RC_HOT_TRACE_RET(OPENAVB_AVTP_SUCCESS, AVB_TRACE_AVTP_DETAIL);
+}
+
+/* Send up to nFrames frames, submitting them to the rawsock in bursts
+ */
+int openavbAvtpTxBurst(void *pv, U32 nFrames, bool txBlockingInIntf)
+{
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (!pStream) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+		return 0;
+	}
+
+	U32 lens[OPENAVB_RAWSOCK_TX_BURST_MAX];
+	U64 times[OPENAVB_RAWSOCK_TX_BURST_MAX];
+	U32 nSent = 0;
+
+	while (nSent < nFrames) {
+		U32 nWanted = nFrames - nSent;
+		if (nWanted > OPENAVB_RAWSOCK_TX_BURST_MAX)
+			nWanted = OPENAVB_RAWSOCK_TX_BURST_MAX;
+
+		// Top up the TX bufs we hold. Bufs left over from a previous burst
+		// are kept (in ring order) so they are used first.
+		if (pStream->nBurstBufs < nWanted) {
+			U32 frameLen;
+			U64 phaseNS = x_avtpPhaseNow(pStream);
+			int nGot = openavbRawsockGetTxFrames(pStream->rawsock, TRUE,
+				&pStream->pBurstBufs[pStream->nBurstBufs], nWanted - pStream->nBurstBufs, &frameLen);
+			if (nGot > 0) {
+				assert(frameLen >= pStream->frameLen);
+				pStream->nBurstBufs += nGot;
+			}
+			x_avtpPhaseMark(pStream, AVTP_PHASE_RAWSOCK, phaseNS);
+		}
+		if (pStream->nBurstBufs < nWanted)
+			nWanted = pStream->nBurstBufs;
+
+		U32 nFilled;
+		for (nFilled = 0; nFilled < nWanted; nFilled++) {
+			if (pStream->txFill(pStream, pStream->pBurstBufs[nFilled], &lens[nFilled], &times[nFilled], txBlockingInIntf) == TX_CB_RET_PACKET_NOT_READY)
+				break;
+		}
+
+		if (nFilled > 0) {
+			// Mark the frames "ready to send" and ring the doorbell once
+			U64 phaseNS = x_avtpPhaseNow(pStream);
+			if (pStream->calSamples) {
+				x_avtpCalPoll(pStream);
+				x_avtpCalBegin(pStream, pStream->pBurstBufs[0], times[0]);
+			}
+			if (pStream->rawsock2) {
+				U32 i;
+				for (i = 0; i < nFilled; i++)
+					x_avtpTxRedundant(pStream, pStream->pBurstBufs[i], lens[i], times[i]);
+				openavbRawsockSend(pStream->rawsock2);
+			}
+			int nDone = openavbRawsockTxFramesSend(pStream->rawsock, pStream->pBurstBufs, lens, times, nFilled);
+			if (pStream->calSamples)
+				x_avtpCalSubmitted(pStream);
+			x_avtpPhaseMark(pStream, AVTP_PHASE_RAWSOCK, phaseNS);
+			x_avtpLatTxDone(pStream);
+			if (nDone < 0)
+				nDone = 0;
+
+			// Drop our references to the submitted bufs
+			pStream->nBurstBufs -= nFilled;
+			memmove(pStream->pBurstBufs, &pStream->pBurstBufs[nFilled], pStream->nBurstBufs * sizeof(U8 *));
+			nSent += nDone;
+		}
+
+		if (nFilled == 0 || nFilled < nWanted)
+			break;
+	}
+
+	AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+	return nSent;
 }
 
 openavbRC openavbAvtpRxInit(
@@ -402,6 +893,8 @@ openavbRC openavbAvtpRxInit(
 	U8 *daddr,
 	U16 nbuffers,
 	bool rxSignalMode,
+	U32 rxBlockUsec,
+	void *pStorage,
 	void **pStream_out)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
@@ -419,7 +912,7 @@ openavbRC openavbAvtpRxInit(
 		AVB_RC_LOG_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT), AVB_TRACE_AVTP);
 	}
 
-	avtp_stream_t *pStream = calloc(1, sizeof(avtp_stream_t));
+	avtp_stream_t *pStream = x_avtpStreamAlloc(pStorage);
 	if (!pStream) {
 		AVB_RC_LOG_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_OUT_OF_MEMORY), AVB_TRACE_AVTP);
 	}
@@ -432,6 +925,7 @@ openavbRC openavbAvtpRxInit(
 
 	pStream->pMapCB->map_rx_init_cb(pStream->pMediaQ);
 	pStream->pIntfCB->intf_rx_init_cb(pStream->pMediaQ);
+	x_avtpSelectPath(pStream);
 
 	// Set the frame length
 	pStream->frameLen = pStream->pMapCB->map_max_data_size_cb(pStream->pMediaQ) + ETH_HDR_LEN_VLAN;
@@ -448,12 +942,14 @@ openavbRC openavbAvtpRxInit(
 	pStream->ifname = strdup(ifname);
 	pStream->nbuffers = nbuffers;
 	pStream->bRxSignalMode = rxSignalMode;
+	pStream->rxBlockUsec = rxBlockUsec;
 
 	openavbRC rc = openAvtpSock(pStream);
 	if (IS_OPENAVB_FAILURE(rc)) {
-		free(pStream);
+		x_avtpStreamFree(pStream);
 		AVB_RC_LOG_TRACE_RET(rc, AVB_TRACE_AVTP);
 	}
+	pStream->rxRawsock = pStream->rawsock;
 
 	// Save the AVTP subtype
 	pStream->subtype = pStream->pMapCB->map_subtype_cb();
@@ -462,10 +958,10 @@ openavbRC openavbAvtpRxInit(
 	AVB_RC_TRACE_RET(OPENAVB_AVTP_SUCCESS, AVB_TRACE_AVTP);
 }
 
-static void x_avtpRxFrame(avtp_stream_t *pStream, U8 *pFrame, U32 frameLen)
+static inline __attribute__((always_inline)) void x_avtpRxFrame(avtp_stream_t *pStream, U8 *pFrame, U32 frameLen, openavb_map_rx_cb_t mapRx)
 {
-	AVB_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
-	AVB_LOGF_DEBUG("pFrame=%p, len=%u", pFrame, frameLen);
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+	AVB_HOT_LOGF_DEBUG("pFrame=%p, len=%u", pFrame, frameLen);
 	U8 subtype, flags, flags2, rxSeq, nLost, avtpVersion;
 	U8 *pRead = pFrame;
 
@@ -483,6 +979,19 @@ static void x_avtpRxFrame(avtp_stream_t *pStream, U8 *pFrame, U32 frameLen)
 
 			rxSeq = *pRead++;
 
+			if (pStream->rawsock2 && pStream->nLost != -1
+				&& (S8)(rxSeq - pStream->avtp_sequence_num) < 0) {
+				// Behind the sequence: the other interface brought it
+				// already. Many in a row mean the talker started over.
+				if (++pStream->rxBehindRun <= AVTP_REDUNDANT_RESYNC_FRAMES) {
+					pStream->nRedundant++;
+					AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+					return;
+				}
+				pStream->avtp_sequence_num = rxSeq;
+			}
+			pStream->rxBehindRun = 0;
+
 			if (pStream->nLost == -1) {
 				// first frame received, don't check for mismatch
 				pStream->nLost = 0;
@@ -490,17 +999,19 @@ static void x_avtpRxFrame(avtp_stream_t *pStream, U8 *pFrame, U32 frameLen)
 			else if (pStream->avtp_sequence_num != rxSeq) {
 				nLost = (rxSeq - pStream->avtp_sequence_num)
 					+ (rxSeq < pStream->avtp_sequence_num ? 256 : 0);
-				AVB_LOGF_DEBUG("AVTP sequence mismatch: expected: %u,\tgot: %u,\tlost %d",
+				AVB_HOT_LOGF_DEBUG("AVTP sequence mismatch: expected: %u,\tgot: %u,\tlost %d",
 					pStream->avtp_sequence_num, rxSeq, nLost);
+				AVB_PROBE4(avtp_rx_lost, pStream, pStream->avtp_sequence_num, rxSeq, nLost);
 				pStream->nLost += nLost;
 			}
+			AVB_PROBE3(avtp_rx, pStream, rxSeq, frameLen);
 			pStream->avtp_sequence_num = rxSeq + 1;
 
 			pStream->bytes += frameLen;
 
 			flags2 = *pRead++;
 
-			AVB_LOGF_DEBUG("subtype=%u, sv=%u, ver=%u, mr=%u, tv=%u tu=%u",
+			AVB_HOT_LOGF_DEBUG("subtype=%u, sv=%u, ver=%u, mr=%u, tv=%u tu=%u",
 				subtype, flags & 0x80, avtpVersion,
 				flags & 0x08, flags & 0x01, flags2 & 0x01);
 
@@ -510,7 +1021,7 @@ static void x_avtpRxFrame(avtp_stream_t *pStream, U8 *pFrame, U32 frameLen)
 				processTimestampEval(pStream, pFrame);
 			}
 
-			pStream->pMapCB->map_rx_cb(pStream->pMediaQ, pFrame, frameLen);
+			mapRx(pStream->pMediaQ, pFrame, frameLen);
 			
 			// NOTE : This is a redundant call. It is handled in avtpTryRx()
 			// pStream->pIntfCB->intf_rx_cb(pStream->pMediaQ);
@@ -529,73 +1040,315 @@ static void x_avtpRxFrame(avtp_stream_t *pStream, U8 *pFrame, U32 frameLen)
 		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVBAVTP_RC_IGNORING_CONTROL_PACKET));
 	}
 
-	AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+	AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
 }
 
 /*
- * Try to receive some data.
- *
- * Keeps state information in pStream.
- * Look at pStream->info for the received data.
+ * Fetch a batch of frames into the cache. A redundant stream takes turns
+ * between its two interfaces so neither backs up behind the other, and
+ * waits on the next one in turn in slices so frames from the other aren't
+ * held up when an interface goes quiet.
  */
-static void avtpTryRx(avtp_stream_t *pStream)
+static int x_avtpFetchRxFrames(avtp_stream_t *pStream, U32 timeout)
 {
-	AVB_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
-
-	U8         *pBuf = NULL;   // pointer to buffer containing rcvd frame, if any
-	U8         *pAvtpPdu;      // pointer to AVTP PDU within Ethernet frame
-	U32         offsetToFrame; // offset into pBuf where Ethernet frame begins (bytes)
-	U32         frameLen;      // length of the Ethernet frame (bytes)
-	int         hdrLen;        // length of the Ethernet frame header (bytes)
-	U32         avtpPduLen;    // length of the AVTP PDU (bytes)
-	hdr_info_t  hdrInfo;       // Ethernet header contents
-	U32         timeout;
+	if (!pStream->rawsock2) {
+		return openavbRawsockGetRxFrames(pStream->rawsock, timeout,
+			pStream->pRxFrames, pStream->rxOffsets, pStream->rxLens, OPENAVB_RAWSOCK_RX_BURST_MAX);
+	}
 
-	while (!pBuf) {
-		if (!openavbMediaQUsecTillTail(pStream->pMediaQ, &timeout)) {
-			// No mediaQ item available therefore wait for a new packet
-			timeout = AVTP_MAX_BLOCK_USEC;
-			pBuf = (U8 *)openavbRawsockGetRxFrame(pStream->rawsock, timeout, &offsetToFrame, &frameLen);
-			if (!pBuf) {
-				AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
-				return;
-			}
+	void *pNext = pStream->rxRawsock == pStream->rawsock ? pStream->rawsock2 : pStream->rawsock;
+	void *pAfter = pStream->rxRawsock;
+	int n;
+	while (1) {
+		n = openavbRawsockGetRxFrames(pNext, OPENAVB_RAWSOCK_NONBLOCK,
+			pStream->pRxFrames, pStream->rxOffsets, pStream->rxLens, OPENAVB_RAWSOCK_RX_BURST_MAX);
+		if (n > 0) {
+			pStream->rxRawsock = pNext;
+			return n;
 		}
-		else if (timeout == 0) {
-			// Process the pending media queue item and after check for available incoming packets
-			pStream->pIntfCB->intf_rx_cb(pStream->pMediaQ);
-
-			// Previously would check for new packets but disabled to favor presentation times.
-			// pBuf = (U8 *)openavbRawsockGetRxFrame(pStream->rawsock, OPENAVB_RAWSOCK_NONBLOCK, &offsetToFrame, &frameLen);
+		n = openavbRawsockGetRxFrames(pAfter, OPENAVB_RAWSOCK_NONBLOCK,
+			pStream->pRxFrames, pStream->rxOffsets, pStream->rxLens, OPENAVB_RAWSOCK_RX_BURST_MAX);
+		if (n > 0) {
+			pStream->rxRawsock = pAfter;
+			return n;
 		}
-		else {
-			if (timeout > AVTP_MAX_BLOCK_USEC)
-				timeout = AVTP_MAX_BLOCK_USEC;
-			if (timeout < RAWSOCK_MIN_TIMEOUT_USEC)
-				timeout = RAWSOCK_MIN_TIMEOUT_USEC;
-			
-			pBuf = (U8 *)openavbRawsockGetRxFrame(pStream->rawsock, timeout, &offsetToFrame, &frameLen);
-			if (!pBuf)
-				pStream->pIntfCB->intf_rx_cb(pStream->pMediaQ);
+		if (timeout == OPENAVB_RAWSOCK_NONBLOCK)
+			return 0;
+
+		U32 slice = timeout < AVTP_REDUNDANT_SLICE_USEC ? timeout : AVTP_REDUNDANT_SLICE_USEC;
+		timeout -= slice;
+		n = openavbRawsockGetRxFrames(pNext, slice,
+			pStream->pRxFrames, pStream->rxOffsets, pStream->rxLens, OPENAVB_RAWSOCK_RX_BURST_MAX);
+		if (n > 0) {
+			pStream->rxRawsock = pNext;
+			return n;
 		}
 	}
-
-	hdrLen = openavbRawsockRxParseHdr(pStream->rawsock, pBuf, &hdrInfo);
-	if (hdrLen < 0) {
-		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVBAVTP_RC_PARSING_FRAME_HEADER));
-	}
-	else {
-		pAvtpPdu = pBuf + offsetToFrame + hdrLen;
-		avtpPduLen = frameLen - hdrLen;
-		x_avtpRxFrame(pStream, pAvtpPdu, avtpPduLen);
-	}
-	openavbRawsockRelRxFrame(pStream->rawsock, pBuf);
-
-	AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
 }
 
-int openavbAvtpTxBufferLevel(void *pv)
-{
+/*
+ * Hand out the next received frame, fetching a new batch
+ * from the rawsock when the cached frames are used up.
+ */
+static U8 *x_avtpGetRxFrame(avtp_stream_t *pStream, U32 timeout, U32 *offset, U32 *len)
+{
+	if (pStream->iRxFrame >= pStream->nRxFrames) {
+		int n = 0;
+		U32 spinUsec = 0;
+		U64 phaseNS = x_avtpPhaseNow(pStream);
+
+		if (pStream->rxBusyPollUsec && timeout) {
+			// Spin on non-blocking receives for up to the busy poll budget
+			U64 nowNS, endNS;
+			spinUsec = timeout < pStream->rxBusyPollUsec ? timeout : pStream->rxBusyPollUsec;
+			CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
+			endNS = nowNS + (U64)spinUsec * NANOSECONDS_PER_USEC;
+			do {
+				n = x_avtpFetchRxFrames(pStream, OPENAVB_RAWSOCK_NONBLOCK);
+				if (n != 0)
+					break;
+				CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
+			} while (nowNS < endNS);
+			timeout -= spinUsec;
+		}
+
+		// Unless the spin used up all the time there was
+		if (n == 0 && (timeout || !spinUsec)) {
+			n = x_avtpFetchRxFrames(pStream, timeout);
+		}
+		x_avtpPhaseMark(pStream, AVTP_PHASE_RAWSOCK, phaseNS);
+		if (pStream->pLatRing && n > 0)
+			pStream->rxFetchNS = x_avtpLatNow();
+		pStream->iRxFrame = 0;
+		pStream->nRxFrames = n > 0 ? n : 0;
+		if (pStream->nRxFrames == 0)
+			return NULL;
+	}
+
+	U32 i = pStream->iRxFrame++;
+	*offset = pStream->rxOffsets[i];
+	*len = pStream->rxLens[i];
+	return pStream->pRxFrames[i];
+}
+
+// Give back cached frames that were never processed
+static void x_avtpRelRxFrames(avtp_stream_t *pStream)
+{
+	while (pStream->iRxFrame < pStream->nRxFrames) {
+		openavbRawsockRelRxFrame(pStream->rxRawsock, pStream->pRxFrames[pStream->iRxFrame++]);
+	}
+	pStream->iRxFrame = pStream->nRxFrames = 0;
+}
+
+// Parse one received frame, hand it to the mapping and release it
+static inline __attribute__((always_inline)) void x_avtpRxBuf(avtp_stream_t *pStream, U8 *pBuf, U32 offsetToFrame, U32 frameLen, openavb_map_rx_cb_t mapRx)
+{
+	int         hdrLen;        // length of the Ethernet frame header (bytes)
+	hdr_info_t  hdrInfo;       // Ethernet header contents
+	U64         phaseNS = x_avtpPhaseNow(pStream);
+
+	hdrLen = openavbRawsockRxParseHdr(pStream->rxRawsock, pBuf, &hdrInfo);
+	if (hdrLen < 0) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVBAVTP_RC_PARSING_FRAME_HEADER));
+	}
+	else {
+		U8 *pAvtp = pBuf + offsetToFrame + hdrLen;
+		openavb_lat_sample_t *pSample = NULL;
+		phaseNS = x_avtpPhaseMark(pStream, AVTP_PHASE_RAWSOCK, phaseNS);
+		if (frameLen - hdrLen >= HIDX_AVTP_TIMESPAMP32 + 4
+			&& openavbLatTraceWanted(pStream->pLatRing, pAvtp[AVTP_V0_SEQ_NUM_OFFSET])) {
+			pSample = x_avtpLatBegin(pStream, pAvtp);
+		}
+		x_avtpRxFrame(pStream, pAvtp, frameLen - hdrLen, mapRx);
+		phaseNS = x_avtpPhaseMark(pStream, AVTP_PHASE_MAP, phaseNS);
+		if (pSample) {
+			U64 nowNS = x_avtpLatNow();
+			pSample->stageNS[OPENAVB_LAT_RX_RAWSOCK] = pStream->rxFetchNS;
+			pSample->stageNS[OPENAVB_LAT_RX_MAP] = nowNS;
+			if (pAvtp[HIDX_AVTP_HIDE7_TV1] & 0x01) {
+				// The AVTP timestamp is gPTP time modulo 2^32 ns, within a
+				// couple of seconds of now
+				pSample->stageNS[OPENAVB_LAT_RX_PRESENT] = nowNS + (S32)(pSample->avtpTimestamp - (U32)nowNS);
+			}
+			openavbLatTracePublish(pStream->pLatRing);
+		}
+	}
+	openavbRawsockRelRxFrame(pStream->rxRawsock, pBuf);
+	x_avtpPhaseMark(pStream, AVTP_PHASE_RAWSOCK, phaseNS);
+}
+
+// Have the interface module present what is due
+static inline __attribute__((always_inline)) void x_avtpIntfRx(avtp_stream_t *pStream, openavb_intf_rx_cb_t intfRx)
+{
+	U64 phaseNS = x_avtpPhaseNow(pStream);
+	intfRx(pStream->pMediaQ);
+	x_avtpPhaseMark(pStream, AVTP_PHASE_INTF, phaseNS);
+}
+
+/*
+ * Try to receive some data.
+ *
+ * Keeps state information in pStream.
+ * Look at pStream->info for the received data.
+ *
+ * Once a frame has arrived, the rest of the batch fetched with it
+ * is processed in the same call, so the listener loop runs once per
+ * batch rather than once per frame.
+ *
+ * mapRx and intfRx are the stream's mapping and interface RX callbacks,
+ * passed in so the static pair paths below can call them directly.
+ */
+static inline __attribute__((always_inline)) void avtpTryRxWith(avtp_stream_t *pStream,
+	openavb_map_rx_cb_t mapRx, openavb_intf_rx_cb_t intfRx)
+{
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+
+	U8         *pBuf = NULL;   // pointer to buffer containing rcvd frame, if any
+	U32         offsetToFrame; // offset into pBuf where Ethernet frame begins (bytes)
+	U32         frameLen;      // length of the Ethernet frame (bytes)
+	U32         timeout;
+
+	while (!pBuf) {
+		if (!openavbMediaQUsecTillTail(pStream->pMediaQ, &timeout)) {
+			// No mediaQ item available therefore wait for a new packet
+			timeout = AVTP_MAX_BLOCK_USEC;
+			pBuf = x_avtpGetRxFrame(pStream, timeout, &offsetToFrame, &frameLen);
+			if (!pBuf) {
+				AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+				return;
+			}
+		}
+		else if (timeout == 0) {
+			// Process the pending media queue item and after check for available incoming packets
+			x_avtpIntfRx(pStream, intfRx);
+
+			// Previously would check for new packets but disabled to favor presentation times.
+			// pBuf = (U8 *)openavbRawsockGetRxFrame(pStream->rawsock, OPENAVB_RAWSOCK_NONBLOCK, &offsetToFrame, &frameLen);
+		}
+		else {
+			if (timeout > AVTP_MAX_BLOCK_USEC)
+				timeout = AVTP_MAX_BLOCK_USEC;
+			if (timeout < RAWSOCK_MIN_TIMEOUT_USEC)
+				timeout = RAWSOCK_MIN_TIMEOUT_USEC;
+			
+			pBuf = x_avtpGetRxFrame(pStream, timeout, &offsetToFrame, &frameLen);
+			if (!pBuf) {
+				x_avtpIntfRx(pStream, intfRx);
+#if AVB_FEATURE_SIM
+				// Rawsocks don't wait in the simulation; nothing comes
+				// due until the virtual clock is moved
+				AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+				return;
+#endif
+			}
+		}
+	}
+
+	x_avtpRxBuf(pStream, pBuf, offsetToFrame, frameLen, mapRx);
+
+	// Drain the rest of the batch, still presenting any item that comes due
+	while (pStream->iRxFrame < pStream->nRxFrames) {
+		if (openavbMediaQUsecTillTail(pStream->pMediaQ, &timeout) && timeout == 0)
+			x_avtpIntfRx(pStream, intfRx);
+
+		pBuf = x_avtpGetRxFrame(pStream, OPENAVB_RAWSOCK_NONBLOCK, &offsetToFrame, &frameLen);
+		x_avtpRxBuf(pStream, pBuf, offsetToFrame, frameLen, mapRx);
+	}
+
+	AVB_HOT_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+}
+
+// Receive through the stream's callback pointers
+static void avtpTryRx(void *pv)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	avtpTryRxWith(pStream, pStream->pMapCB->map_rx_cb, pStream->pIntfCB->intf_rx_cb);
+}
+
+#if AVB_FEATURE_STATIC_PAIRS
+// The mapping and interface callbacks of the pairs are referenced weakly,
+// so modules that aren't linked into the binary resolve to NULL and their
+// pairs are never selected.
+#define X_AVTP_PAIR_DECLARE(name, mapTx, intfTx, mapRx, intfRx)						\
+	extern tx_cb_ret_t mapTx(media_q_t *pMediaQ, U8 *pData, U32 *dataLen) __attribute__((weak));	\
+	extern bool intfTx(media_q_t *pMediaQ) __attribute__((weak));					\
+	extern bool mapRx(media_q_t *pMediaQ, U8 *pData, U32 dataLen) __attribute__((weak));	\
+	extern bool intfRx(media_q_t *pMediaQ) __attribute__((weak));
+AVTP_STATIC_PAIRS(X_AVTP_PAIR_DECLARE)
+
+// TX and RX paths with the pair's callbacks called directly
+#define X_AVTP_PAIR_DEFINE(name, mapTx, intfTx, mapRx, intfRx)						\
+	static tx_cb_ret_t x_avtpTxFill_##name(void *pv, U8 *pBuf, U32 *pFrameLen, U64 *pTimeNsec, bool txBlockingInIntf)	\
+	{																				\
+		return x_avtpTxFillWith((avtp_stream_t *)pv, pBuf, pFrameLen, pTimeNsec, txBlockingInIntf, mapTx, intfTx);	\
+	}																				\
+	static void avtpTryRx_##name(void *pv)											\
+	{																				\
+		avtpTryRxWith((avtp_stream_t *)pv, mapRx, intfRx);							\
+	}
+AVTP_STATIC_PAIRS(X_AVTP_PAIR_DEFINE)
+#endif
+
+// Drop what is in the media queue; with ignoreTimestamp FALSE only the
+// items that have come due
+static void x_avtpPurgeMediaQ(avtp_stream_t *pStream, bool ignoreTimestamp)
+{
+	while (openavbMediaQTailLock(pStream->pMediaQ, ignoreTimestamp)) {
+		openavbMediaQTailPull(pStream->pMediaQ);
+	}
+}
+
+// Warm standby TX path. Nothing is sent and the interface module isn't
+// called, but media pushed in meanwhile is dropped so a resumed stream
+// starts with current data. The TX buffers stay with the stream.
+static tx_cb_ret_t x_avtpTxFillPaused(void *pv, U8 *pBuf, U32 *pFrameLen, U64 *pTimeNsec, bool txBlockingInIntf)
+{
+	x_avtpPurgeMediaQ((avtp_stream_t *)pv, TRUE);
+	return TX_CB_RET_PACKET_NOT_READY;
+}
+
+// Warm standby RX path. Frames keep being taken off the socket or ring so
+// nothing stale is waiting on resume; they are released unmapped, and
+// media that comes due meanwhile is dropped instead of presented.
+static void avtpTryRxPaused(void *pv)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	U32 offsetToFrame, frameLen;
+
+	U8 *pBuf = x_avtpGetRxFrame(pStream, AVTP_MAX_BLOCK_USEC, &offsetToFrame, &frameLen);
+	while (pBuf) {
+		openavbRawsockRelRxFrame(pStream->rxRawsock, pBuf);
+		pBuf = x_avtpGetRxFrame(pStream, OPENAVB_RAWSOCK_NONBLOCK, &offsetToFrame, &frameLen);
+	}
+	x_avtpPurgeMediaQ(pStream, FALSE);
+}
+
+// Pick the TX or RX path for the stream's mapping and interface callbacks
+static void x_avtpSelectPath(avtp_stream_t *pStream)
+{
+	pStream->txFill = x_avtpTxFill;
+	pStream->tryRx = avtpTryRx;
+
+#if AVB_FEATURE_STATIC_PAIRS
+#define X_AVTP_PAIR_SELECT(name, mapTx, intfTx, mapRx, intfRx)						\
+	if (pStream->tx && mapTx && intfTx												\
+		&& pStream->pMapCB->map_tx_cb == mapTx && pStream->pIntfCB->intf_tx_cb == intfTx) {	\
+		pStream->txFill = x_avtpTxFill_##name;										\
+		AVB_LOG_INFO("Using the " #name " TX path");								\
+		return;																		\
+	}																				\
+	if (!pStream->tx && mapRx && intfRx												\
+		&& pStream->pMapCB->map_rx_cb == mapRx && pStream->pIntfCB->intf_rx_cb == intfRx) {	\
+		pStream->tryRx = avtpTryRx_##name;											\
+		AVB_LOG_INFO("Using the " #name " RX path");								\
+		return;																		\
+	}
+	AVTP_STATIC_PAIRS(X_AVTP_PAIR_SELECT)
+#endif
+}
+
+int openavbAvtpTxBufferLevel(void *pv)
+{
 	avtp_stream_t *pStream = (avtp_stream_t *)pv;
 	if (!pStream) {
 		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
@@ -626,6 +1379,32 @@ int openavbAvtpLost(void *pv)
 	return count;
 }
 
+U64 openavbAvtpTxNullFrames(void *pv)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (!pStream) {
+		// Quietly return. Since this can be called before a stream is available.
+		return 0;
+	}
+
+	U64 count = pStream->nullFrames;
+	pStream->nullFrames = 0;
+	return count;
+}
+
+U64 openavbAvtpRedundantCount(void *pv)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (!pStream) {
+		// Quietly return. Since this can be called before a stream is available.
+		return 0;
+	}
+
+	U64 count = pStream->nRedundant;
+	pStream->nRedundant = 0;
+	return count;
+}
+
 U64 openavbAvtpBytes(void *pv)
 {
 	avtp_stream_t *pStream = (avtp_stream_t *)pv;
@@ -639,28 +1418,112 @@ U64 openavbAvtpBytes(void *pv)
 	return bytes;
 }
 
+void openavbAvtpPhaseTimeOn(void *pv, bool bOn)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (pStream) {
+		pStream->bPhaseTime = bOn;
+	}
+}
+
+void openavbAvtpPhaseTimeTake(void *pv, U64 *pIntfNS, U64 *pMapNS, U64 *pRawsockNS)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (!pStream) {
+		// Quietly return. Since this can be called before a stream is available.
+		*pIntfNS = *pMapNS = *pRawsockNS = 0;
+		return;
+	}
+
+	*pIntfNS = pStream->phaseNS[AVTP_PHASE_INTF];
+	*pMapNS = pStream->phaseNS[AVTP_PHASE_MAP];
+	*pRawsockNS = pStream->phaseNS[AVTP_PHASE_RAWSOCK];
+	memset(pStream->phaseNS, 0, sizeof(pStream->phaseNS));
+}
+
+void openavbAvtpSetCallHistograms(void *pv, openavb_hist_t *pIntfHist, openavb_hist_t *pMapHist)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (pStream) {
+		pStream->pCallHist[AVTP_PHASE_INTF] = pIntfHist;
+		pStream->pCallHist[AVTP_PHASE_MAP] = pMapHist;
+	}
+}
+
+void openavbAvtpSetLatencyTrace(void *pv, openavb_lat_ring_t *pRing)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (pStream) {
+		pStream->pLatRing = pRing;
+	}
+}
+
 openavbRC openavbAvtpRx(void *pv)
 {
-	AVB_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
 
 	avtp_stream_t *pStream = (avtp_stream_t *)pv;
 	if (!pStream) {
-		AVB_RC_LOG_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT), AVB_TRACE_AVTP_DETAIL);
+		AVB_RC_LOG_HOT_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT), AVB_TRACE_AVTP_DETAIL);
 	}
 
 	// Check our socket, and potentially receive some data.
-	avtpTryRx(pStream);
+	pStream->tryRx(pStream);
 
 	// See if there's a complete (re-assembled) data sample.
 	if (pStream->info.rx.bComplete) {
 		pStream->info.rx.bComplete = FALSE;
-		AVB_RC_TRACE_RET(OPENAVB_AVTP_SUCCESS, AVB_TRACE_AVTP_DETAIL);
+		AVB_RC_HOT_TRACE_RET(OPENAVB_AVTP_SUCCESS, AVB_TRACE_AVTP_DETAIL);
 	}
 
-	AVB_RC_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVBAVTP_RC_NO_FRAMES_PROCESSED), AVB_TRACE_AVTP_DETAIL);
+	AVB_RC_HOT_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVBAVTP_RC_NO_FRAMES_PROCESSED), AVB_TRACE_AVTP_DETAIL);
 }
 
-void openavbAvtpConfigTimsstampEval(void *handle, U32 tsInterval, U32 reportInterval, bool smoothing, U32 tsMaxJitter, U32 tsMaxDrift)
+openavbRC openavbAvtpRxPoll(void *pv, U32 *pWaitUsec)
+{
+	AVB_HOT_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)pv;
+	if (!pStream || !pWaitUsec) {
+		AVB_RC_LOG_HOT_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT), AVB_TRACE_AVTP_DETAIL);
+	}
+
+	U8 *pBuf;
+	U32 offsetToFrame, frameLen, timeout;
+
+	if (pStream->bPause) {
+		// As avtpTryRxPaused(), without waiting
+		while ((pBuf = x_avtpGetRxFrame(pStream, OPENAVB_RAWSOCK_NONBLOCK, &offsetToFrame, &frameLen)) != NULL) {
+			openavbRawsockRelRxFrame(pStream->rxRawsock, pBuf);
+		}
+		x_avtpPurgeMediaQ(pStream, FALSE);
+	}
+	else {
+		openavb_map_rx_cb_t mapRx = pStream->pMapCB->map_rx_cb;
+		openavb_intf_rx_cb_t intfRx = pStream->pIntfCB->intf_rx_cb;
+
+		while ((pBuf = x_avtpGetRxFrame(pStream, OPENAVB_RAWSOCK_NONBLOCK, &offsetToFrame, &frameLen)) != NULL) {
+			x_avtpRxBuf(pStream, pBuf, offsetToFrame, frameLen, mapRx);
+			if (openavbMediaQUsecTillTail(pStream->pMediaQ, &timeout) && timeout == 0)
+				x_avtpIntfRx(pStream, intfRx);
+		}
+		if (openavbMediaQUsecTillTail(pStream->pMediaQ, &timeout) && timeout == 0)
+			x_avtpIntfRx(pStream, intfRx);
+	}
+
+	*pWaitUsec = AVTP_MAX_BLOCK_USEC;
+	if (openavbMediaQUsecTillTail(pStream->pMediaQ, &timeout) && timeout < AVTP_MAX_BLOCK_USEC)
+		*pWaitUsec = timeout;
+
+	if (pStream->info.rx.bComplete) {
+		pStream->info.rx.bComplete = FALSE;
+		AVB_RC_HOT_TRACE_RET(OPENAVB_AVTP_SUCCESS, AVB_TRACE_AVTP_DETAIL);
+	}
+
+	AVB_RC_HOT_TRACE_RET(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVBAVTP_RC_NO_FRAMES_PROCESSED), AVB_TRACE_AVTP_DETAIL);
+}
+
+void openavbAvtpConfigTimsstampEval(void *handle, U32 tsPerSecond, openavb_hist_t *pJitterHist, openavb_hist_t *pDriftHist, bool smoothing, U32 tsMaxJitter, U32 tsMaxDrift)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
 
@@ -671,9 +1534,11 @@ void openavbAvtpConfigTimsstampEval(void *handle, U32 tsInterval, U32 reportInte
 		return;
 	}
 
-	pStream->tsEval = openavbTimestampEvalNew();
-	openavbTimestampEvalInitialize(pStream->tsEval, tsInterval);
-	openavbTimestampEvalSetReport(pStream->tsEval, reportInterval);
+	if (!pStream->tsEval) {
+		pStream->tsEval = openavbTimestampEvalNew();
+	}
+	openavbTimestampEvalInitializeRate(pStream->tsEval, tsPerSecond);
+	openavbTimestampEvalSetHistograms(pStream->tsEval, pJitterHist, pDriftHist);
 	if (smoothing) {
 		openavbTimestampEvalSetSmoothing(pStream->tsEval, tsMaxJitter, tsMaxDrift);
 	}
@@ -681,6 +1546,258 @@ void openavbAvtpConfigTimsstampEval(void *handle, U32 tsInterval, U32 reportInte
 	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
 }
 
+bool openavbAvtpTxSetLaunchTime(void *handle, bool enable)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || !pStream->tx) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	bool ret = openavbRawsockTxSetLaunchTime(pStream->rawsock, enable);
+	if (ret && pStream->rawsock2 && !openavbRawsockTxSetLaunchTime(pStream->rawsock2, enable)) {
+		AVB_LOG_WARNING("Redundant interface can't launch at the launch time");
+	}
+	if (ret) {
+		pStream->bLaunchTime = enable;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return ret;
+}
+
+void openavbAvtpTxSetLaunchSpacing(void *handle, U32 framesPerSecond)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || !pStream->tx) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return;
+	}
+
+	pStream->launchSpacingNS = framesPerSecond ? NANOSECONDS_PER_SECOND / framesPerSecond : 0;
+	pStream->launchItemNS = 0;
+	pStream->launchItemFrames = 0;
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+}
+
+bool openavbAvtpRxSetBusyPoll(void *handle, U32 usecBusyPoll)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || pStream->tx) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	pStream->rxBusyPollUsec = usecBusyPoll;
+	if (pStream->rawsock
+		&& !openavbRawsockRxSetBusyPoll(pStream->rawsock, usecBusyPoll)
+		&& usecBusyPoll) {
+		AVB_LOG_INFO("Kernel busy poll not available; spinning in user space only");
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return TRUE;
+}
+
+bool openavbAvtpRxSetReplay(void *handle, const char *fileName, U32 speedPct, U32 loops)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || pStream->tx || !pStream->rawsock) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	bool ret = openavbRawsockRxReplay(pStream->rawsock, fileName, speedPct, loops);
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return ret;
+}
+
+bool openavbAvtpTxSetRecord(void *handle, const char *fileName)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || !pStream->tx || !pStream->rawsock) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	bool ret = openavbRawsockTxRecord(pStream->rawsock, fileName);
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return ret;
+}
+
+bool openavbAvtpTxSetAsrc(void *handle, avtp_asrc_mode_t mode, U32 bufferUsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || !pStream->tx) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	openavbAvtpAsrcDelete(pStream->asrc);
+	pStream->asrc = NULL;
+	if (mode != AVTP_ASRC_OFF) {
+		pStream->asrc = openavbAvtpAsrcNew(pStream->pMediaQ, mode, bufferUsec);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return mode == AVTP_ASRC_OFF || pStream->asrc != NULL;
+}
+
+bool openavbAvtpTxSetCalibration(void *handle, U32 nSamples, U32 marginUsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || !pStream->tx) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+	if (nSamples && !x_avtpCommonTimestamp(pStream->subtype)) {
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	pStream->calSamples = nSamples;
+	pStream->calMarginNS = marginUsec * NANOSECONDS_PER_USEC;
+	pStream->calSampleCount = 0;
+	pStream->calFrameCount = 0;
+	pStream->calHwMisses = 0;
+	pStream->calPathMaxNS = 0;
+	pStream->bCalDone = FALSE;
+	pStream->bCalPending = FALSE;
+	pStream->presentAdjNS = 0;
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return TRUE;
+}
+
+U32 openavbAvtpTxPresentOffset(void *handle)
+{
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream) {
+		return 0;
+	}
+
+	return (pStream->max_transit_usec * NANOSECONDS_PER_USEC + pStream->presentAdjNS) / NANOSECONDS_PER_USEC;
+}
+
+bool openavbAvtpTxSetNullFill(void *handle, bool enable)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || !pStream->tx) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	pStream->bTxNull = enable && pStream->pMapCB->map_tx_null_cb != NULL;
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return !enable || pStream->bTxNull;
+}
+
+bool openavbAvtpSetRedundant(void *handle, const char *ifname, U8 *destAddr)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	avtp_stream_t *pStream = (avtp_stream_t *)handle;
+	if (!pStream || !pStream->rawsock || pStream->rawsock2 || !ifname) {
+		AVB_RC_LOG(AVB_RC(OPENAVB_AVTP_FAILURE | OPENAVB_RC_INVALID_ARGUMENT));
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+	if (!destAddr) {
+		destAddr = pStream->dest_addr.ether_addr_octet;
+	}
+
+	void *rawsock2;
+	if (pStream->tx) {
+		rawsock2 = openavbRawsockOpen(ifname, FALSE, TRUE, ETHERTYPE_AVTP, pStream->frameLen, pStream->nbuffers);
+	}
+	else {
+#ifndef UBUNTU
+		rawsock2 = openavbRawsockOpen(ifname, TRUE, FALSE, ETHERTYPE_8021Q, pStream->frameLen, pStream->nbuffers);
+#else
+		rawsock2 = openavbRawsockOpen(ifname, TRUE, FALSE, ETHERTYPE_AVTP, pStream->frameLen, pStream->nbuffers);
+#endif
+	}
+	if (!rawsock2) {
+		AVB_LOGF_ERROR("Failed to open redundant interface %s", ifname);
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return FALSE;
+	}
+
+	if (pStream->tx) {
+		// Same frames, but from this interface's address to destAddr
+		hdr_info_t hdrInfo;
+		U8 srcAddr[ETH_ALEN];
+		U32 hdrLen = 0;
+		if (!openavbRawsockGetAddr(rawsock2, srcAddr)) {
+			AVB_LOG_ERROR("Failed to get source MAC address of redundant interface");
+			openavbRawsockClose(rawsock2);
+			AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+			return FALSE;
+		}
+		hdrInfo.shost = srcAddr;
+		hdrInfo.dhost = destAddr;
+		hdrInfo.vlan = pStream->vlanPCP != 0 || pStream->vlanID != 0;
+		hdrInfo.vlan_pcp = pStream->vlanPCP;
+		hdrInfo.vlan_vid = pStream->vlanID;
+		openavbRawsockTxSetHdr(rawsock2, &hdrInfo);
+
+		memset(pStream->txHdrTemplate2, 0, AVTP_TX_HDR_TEMPLATE_LEN);
+		openavbRawsockTxFillHdr(rawsock2, pStream->txHdrTemplate2, &hdrLen);
+		if (hdrLen != pStream->ethHdrLen) {
+			AVB_LOGF_ERROR("Redundant interface header length %u differs from %u", hdrLen, pStream->ethHdrLen);
+			openavbRawsockClose(rawsock2);
+			AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+			return FALSE;
+		}
+
+		openavbRawsockTxSetMark(rawsock2, pStream->fwmark);
+		if (pStream->bLaunchTime && !openavbRawsockTxSetLaunchTime(rawsock2, TRUE)) {
+			AVB_LOG_WARNING("Redundant interface can't launch at the launch time");
+		}
+	}
+	else {
+		openavbSetRxSignalMode(rawsock2, pStream->bRxSignalMode);
+		openavbRawsockRxMulticast(rawsock2, TRUE, destAddr);
+		openavbRawsockRxStreamID(rawsock2, pStream->streamIDnet);
+	}
+
+	pStream->rawsock2 = rawsock2;
+	pStream->nRedundant = 0;
+	pStream->rxBehindRun = 0;
+
+	AVB_LOGF_INFO("Redundant over %s and %s", pStream->ifname, ifname);
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return TRUE;
+}
+
 void openavbAvtpPause(void *handle, bool bPause)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
@@ -692,6 +1809,15 @@ void openavbAvtpPause(void *handle, bool bPause)
 		return;
 	}
 
+	// Only the path changes; the rawsock, its buffers and the media queue
+	// stay as they are, so resuming takes effect on the next interval.
+	if (bPause && !pStream->bPause) {
+		pStream->txFill = x_avtpTxFillPaused;
+		pStream->tryRx = avtpTryRxPaused;
+	}
+	else if (!bPause && pStream->bPause) {
+		x_avtpSelectPath(pStream);
+	}
 	pStream->bPause = bPause;
 
 	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
@@ -707,17 +1833,28 @@ void openavbAvtpShutdown(void *pv)
 		pStream->pIntfCB->intf_end_cb(pStream->pMediaQ);
 		pStream->pMapCB->map_end_cb(pStream->pMediaQ);
 
-		// close the rawsock
+		openavbAvtpAsrcDelete(pStream->asrc);
+		pStream->asrc = NULL;
+
+		openavbTimestampEvalDelete(pStream->tsEval);
+		pStream->tsEval = NULL;
+
+		// close the rawsocks
 		if (pStream->rawsock) {
+			x_avtpRelRxFrames(pStream);
 			openavbRawsockClose(pStream->rawsock);
 			pStream->rawsock = NULL;
 		}
+		if (pStream->rawsock2) {
+			openavbRawsockClose(pStream->rawsock2);
+			pStream->rawsock2 = NULL;
+		}
 
 		if (pStream->ifname)
 			free(pStream->ifname);
 
 		// free the malloc'd stream info
-		free(pStream);
+		x_avtpStreamFree(pStream);
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
 	return;
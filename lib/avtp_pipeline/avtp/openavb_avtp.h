@@ -42,6 +42,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_map_pub.h"
 #include "openavb_rawsock.h"
 #include "openavb_timestamp.h"
+#include "openavb_avtp_asrc.h"
+#include "openavb_lat_trace_pub.h"
 
 #define ETHERTYPE_AVTP 0x22F0
 #define ETHERTYPE_8021Q 0x8100
@@ -57,6 +59,16 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // AVTP Headers
 #define AVTP_COMMON_STREAM_DATA_HDR_LEN	24
 
+// The fields of the common AVTP header that don't depend on the subtype
+// (subtype, flags, sequence_num, tu, stream_id) and where sequence_num sits
+#define AVTP_V0_COMMON_HDR_LEN		12
+#define AVTP_V0_SEQ_NUM_OFFSET		2
+
+// Ethernet and common AVTP header template copied into each TX frame.
+// Rounded up from ETH_HDR_LEN_VLAN + AVTP_V0_COMMON_HDR_LEN to a whole
+// number of 8 byte stores; the tail is zero and later written by the mapping.
+#define AVTP_TX_HDR_TEMPLATE_LEN	32
+
 //#define OPENAVB_AVTP_REPORT_RX_STATS 1
 #define OPENAVB_AVTP_REPORT_INTERVAL 100
 
@@ -81,6 +93,14 @@ typedef struct {
 } avtp_state_t;
 
 
+// Phases of a stream's work that CPU time is split across
+typedef enum {
+	AVTP_PHASE_INTF,
+	AVTP_PHASE_MAP,
+	AVTP_PHASE_RAWSOCK,
+	AVTP_PHASE_COUNT
+} avtp_phase_t;
+
 /* Info associated with an AVTP stream (RX or TX).
  *
  * The void* handle that is returned to the client
@@ -106,6 +126,10 @@ typedef struct
 	U8 streamIDnet[8];
 	// The destination address for stream
 	struct ether_addr dest_addr;
+	// VLAN and fwmark of TX frames, kept for the redundant interface
+	U16 vlanID;
+	U8 vlanPCP;
+	U32 fwmark;
 	// The AVTP subtype; it determines the encapsulation
 	U8 subtype;
 	// Max Transit - value added to current time to get play time
@@ -128,25 +152,111 @@ typedef struct
 	media_q_t *pMediaQ;
 	bool bRxSignalMode;
 
+	// Ethernet and common AVTP header of every TX frame, built once in
+	// openavbAvtpTxInit; only the sequence number is patched per frame
+	U8 txHdrTemplate[AVTP_TX_HDR_TEMPLATE_LEN] __attribute__((aligned(8)));
+	// TX fill and RX paths; a specialized pair path with AVB_FEATURE_STATIC_PAIRS
+	tx_cb_ret_t (*txFill)(void *pStream, U8 *pBuf, U32 *pFrameLen, U64 *pTimeNsec, bool txBlockingInIntf);
+	void (*tryRx)(void *pStream);
 	// TX frame buffer
 	U8* pBuf;
+	// TX frame buffers held for burst transmission
+	U8* pBurstBufs[OPENAVB_RAWSOCK_TX_BURST_MAX];
+	U32 nBurstBufs;
+	// RX frames fetched in one batch and not yet processed
+	U8* pRxFrames[OPENAVB_RAWSOCK_RX_BURST_MAX];
+	U32 rxOffsets[OPENAVB_RAWSOCK_RX_BURST_MAX];
+	U32 rxLens[OPENAVB_RAWSOCK_RX_BURST_MAX];
+	U32 nRxFrames;
+	U32 iRxFrame;
+	// RX block retire timeout, 0 for frame by frame receive
+	U32 rxBlockUsec;
+	// How long to spin for a frame before blocking, 0 to block right away
+	U32 rxBusyPollUsec;
 	// Ethernet header length
 	U32 ethHdrLen;
+	// Rawsock of the second interface of a redundant stream, NULL when
+	// there is none. Talkers send every frame on both interfaces; listeners
+	// take each sequence number from whichever brings it first.
+	void *rawsock2;
+	// Header template of the frames sent on rawsock2
+	U8 txHdrTemplate2[AVTP_TX_HDR_TEMPLATE_LEN] __attribute__((aligned(8)));
+	// Rawsock the cached RX frames came from
+	void *rxRawsock;
+	// Frames not sent on rawsock2 for lack of a buffer (talker), or
+	// dropped as already received (listener)
+	U64 nRedundant;
+	// Listener: frames in a row that were behind the sequence
+	U32 rxBehindRun;
+	// Pass launch times (media queue timestamps) to the rawsock
+	bool bLaunchTime;
+	// Launch time step between frames of one media queue item, 0 to launch
+	// them all at the item's time
+	U64 launchSpacingNS;
+	// Media queue time of the last frame sent and frames sent after it
+	// from the same item
+	U64 launchItemNS;
+	U32 launchItemFrames;
+	// Sample rate converter between the interface and mapping modules
+	openavb_avtp_asrc_t asrc;
+	// Send the mapping module's null content frame when it has no data
+	bool bTxNull;
+
+	// Transit calibration, off while calSamples is 0. One frame in a while
+	// is timed from capture to the wire; the AVTP timestamp of every frame
+	// is moved by presentAdjNS (never positive) once calibrated.
+	U32 calSamples;
+	U32 calMarginNS;
+	U32 calSampleCount;
+	U32 calFrameCount;
+	bool bCalDone;
+	// A timed frame is in flight, with a hardware TX timestamp asked for
+	bool bCalPending;
+	bool bCalHw;
+	// Hardware timestamps that never came back, in a row
+	U32 calHwMisses;
+	// AVTP timestamp of the timed frame before the move, and when it was
+	// submitted (gPTP time)
+	U32 calAvtpTs;
+	U64 calSubmitNS;
+	// Longest capture to wire time seen
+	U64 calPathMaxNS;
+	S64 presentAdjNS;
 	
 	// Timestamp evaluation related
 	openavb_timestamp_eval_t tsEval;
 
+	// Built in caller storage; not freed on shutdown
+	bool embedded;
+
 	// Stat related	
 	// RX frames lost
 	int nLost;
 	// Bytes sent or recieved
 	U64 bytes;
+	// Null content frames sent on underrun
+	U64 nullFrames;
+	// Time the phases on the thread CPU clock
+	bool bPhaseTime;
+	// Thread CPU time spent in each phase while timed
+	U64 phaseNS[AVTP_PHASE_COUNT];
+	// Histograms of the time taken by each timed call, per phase; NULL when not kept
+	openavb_hist_t *pCallHist[AVTP_PHASE_COUNT];
+	// Latency trace of sampled frames, NULL when off; owned by the caller
+	openavb_lat_ring_t *pLatRing;
+	// When the current RX batch was fetched, while tracing
+	U64 rxFetchNS;
 	
 } avtp_stream_t;
 
 
 typedef void (*avtp_listener_callback_fn)(void *pv, avtp_info_t *data);
 
+// Size of the storage a caller can pass as pStorage to openavbAvtpTxInit() or
+// openavbAvtpRxInit() to have the stream built there instead of on the heap.
+// The storage stays the caller's; openavbAvtpShutdown() doesn't free it.
+size_t openavbAvtpStreamSize(void);
+
 // tx/rx
 openavbRC openavbAvtpTxInit(media_q_t *pMediaQ,
 					openavb_map_cb_t *pMapCB,
@@ -159,10 +269,15 @@ openavbRC openavbAvtpTxInit(media_q_t *pMediaQ,
 					U16 vlanID,
 					U8  vlanPCP,
 					U16 nbuffers,
+					void *pStorage,
 					void **pStream_out);
 
 openavbRC openavbAvtpTx(void *pv, bool bSend, bool txBlockingInIntf);
 
+// Send up to nFrames frames using the rawsock burst API.
+// Returns the number of frames sent.
+int openavbAvtpTxBurst(void *pv, U32 nFrames, bool txBlockingInIntf);
+
 openavbRC openavbAvtpRxInit(media_q_t *pMediaQ, 
 					openavb_map_cb_t *pMapCB,
 					openavb_intf_cb_t *pIntfCB,
@@ -171,12 +286,80 @@ openavbRC openavbAvtpRxInit(media_q_t *pMediaQ,
 					U8* destAddr,
 					U16 nbuffers,
 					bool rxSignalMode,
+					U32 rxBlockUsec,
+					void *pStorage,
 					void **pStream_out);
 
 openavbRC openavbAvtpRx(void *handle);
 
-void openavbAvtpConfigTimsstampEval(void *handle, U32 tsInterval, U32 reportInterval, bool smoothing, U32 tsMaxJitter, U32 tsMaxDrift);
+// Receive without blocking, for a thread servicing several streams. Takes
+// every frame waiting on the rawsock and presents what has come due, then
+// sets *pWaitUsec to the time until the next media queue item is due (or a
+// maximum block time when none is queued). Busy polling isn't done here.
+openavbRC openavbAvtpRxPoll(void *handle, U32 *pWaitUsec);
+
+// Evaluate the AVTP timestamp of every frame against tsPerSecond timestamps
+// a second, recording jitter and drift into the histograms (either may be NULL).
+void openavbAvtpConfigTimsstampEval(void *handle, U32 tsPerSecond, openavb_hist_t *pJitterHist, openavb_hist_t *pDriftHist, bool smoothing, U32 tsMaxJitter, U32 tsMaxDrift);
+
+// Have the rawsock launch frames at their media queue timestamps.
+// Returns FALSE if the rawsock can't.
+bool openavbAvtpTxSetLaunchTime(void *handle, bool enable);
+
+// Spread the launch times of the frames taken from one media queue item
+// evenly at framesPerSecond instead of launching them together. 0 turns
+// spreading off.
+void openavbAvtpTxSetLaunchSpacing(void *handle, U32 framesPerSecond);
+
+// Put a sample rate converter between the interface and mapping modules.
+// Returns FALSE if the stream can't be converted.
+bool openavbAvtpTxSetAsrc(void *handle, avtp_asrc_mode_t mode, U32 bufferUsec);
+
+// Send a frame of null content (silence, NULL packets) in place of each
+// frame the mapping module has no data for. Returns FALSE if the mapping
+// module has no null content.
+bool openavbAvtpTxSetNullFill(void *handle, bool enable);
 
+// Null content frames sent since the last call
+U64 openavbAvtpTxNullFrames(void *pv);
+
+// Calibrate the presentation offset. One frame in a while is timed from
+// capture (its AVTP timestamp less max_transit) to the wire, with hardware
+// TX timestamps where the rawsock has them and the launch or submit time
+// where not. Once nSamples frames were timed the AVTP timestamp of every
+// frame is moved so the offset is the longest time seen plus marginUsec,
+// and a longer time seen later raises it again. The offset never goes
+// above max_transit. nSamples 0 turns it off. Returns FALSE if the stream's
+// subtype has no common AVTP timestamp.
+bool openavbAvtpTxSetCalibration(void *handle, U32 nSamples, U32 marginUsec);
+
+// Presentation offset in use in usec; max_transit until calibrated
+U32 openavbAvtpTxPresentOffset(void *handle);
+
+// Spin for up to usecBusyPoll waiting for each frame before blocking,
+// with kernel busy polling on the socket where the rawsock supports it.
+// 0 turns it off.
+bool openavbAvtpRxSetBusyPoll(void *handle, U32 usecBusyPoll);
+
+// Receive the frames of a capture file instead of the network
+// (see openavbRawsockRxReplay). Returns FALSE if the rawsock can't.
+bool openavbAvtpRxSetReplay(void *handle, const char *fileName, U32 speedPct, U32 loops);
+
+// Record sent frames to a pcapng file. Returns FALSE if the rawsock can't.
+bool openavbAvtpTxSetRecord(void *handle, const char *fileName);
+
+// Make the stream redundant over a second interface. A talker sends a copy
+// of every frame it fills there, with destAddr (or the stream's destination
+// when NULL) and its own source address; a listener receives on both and
+// drops the frames whose sequence number it already has.
+bool openavbAvtpSetRedundant(void *handle, const char *ifname, U8 *destAddr);
+
+// Redundancy counter since the last call: frames the talker couldn't send
+// on the second interface, or duplicates the listener dropped
+U64 openavbAvtpRedundantCount(void *handle);
+
+// Warm standby: a paused stream keeps its rawsock, buffers and media queue
+// but sends nothing, or drops what it receives, until resumed.
 void openavbAvtpPause(void *handle, bool bPause);
 
 void openavbAvtpShutdown(void *handle);
@@ -189,4 +372,18 @@ int openavbAvtpLost(void *handle);
 
 U64 openavbAvtpBytes(void *handle);
 
+// Time the intf, map and rawsock phases on the thread CPU clock
+void openavbAvtpPhaseTimeOn(void *handle, bool bOn);
+
+// Take the thread CPU time spent in each phase since the last take
+void openavbAvtpPhaseTimeTake(void *handle, U64 *pIntfNS, U64 *pMapNS, U64 *pRawsockNS);
+
+// Also record the thread CPU time of every timed interface and mapping
+// module call into these histograms; NULL leaves a phase out.
+void openavbAvtpSetCallHistograms(void *handle, openavb_hist_t *pIntfHist, openavb_hist_t *pMapHist);
+
+// Record sampled frames into a latency trace ring; NULL turns it off.
+// The ring must outlive the stream or be detached first.
+void openavbAvtpSetLatencyTrace(void *handle, openavb_lat_ring_t *pRing);
+
 #endif //AVB_AVTP_H
@@ -0,0 +1,547 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Asynchronous sample rate converter stage.
+*
+* The interface module fills a staging media queue at the rate of its own
+* clock. Each talker cycle the staged frames are written into the converter,
+* and whenever the stream media queue runs dry one item of exactly
+* framesPerItem frames at the nominal rate is resampled into it.
+*
+* The conversion ratio is the device clock rate measured against the item
+* timestamps (feed forward) plus a PI servo that holds the converter input
+* level at the configured buffer. In AVTP_ASRC_MCR mode the target rate
+* follows the media clock recovered by the MCR HAL instead of nominal.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "openavb_platform.h"
+#include "openavb_types.h"
+#include "openavb_trace.h"
+#include "openavb_mediaq.h"
+#include "openavb_map_uncmp_audio_pub.h"
+#include "openavb_map_aaf_audio_pub.h"
+#include "openavb_mcr_hal_pub.h"
+#include "openavb_mcr_sw.h"
+#include "openavb_asrc.h"
+#include "openavb_avtp_asrc.h"
+
+#define	AVB_LOG_COMPONENT	"ASRC"
+#include "openavb_log.h"
+
+// Items in the staging media queue
+#define AVTP_ASRC_STAGE_ITEMS		8
+
+// Default input buffered ahead of the converter
+#define AVTP_ASRC_DEFAULT_BUFFER_USEC	5000
+
+// Device clock timestamps are pushed at least this many msec apart, and a
+// rate measurement window spans this many pushes
+#define AVTP_ASRC_PUSH_MSEC			10
+#define AVTP_ASRC_PUSH_WINDOW		1000
+
+// Servo updates per second, proportional time constant and integral time
+#define AVTP_ASRC_SERVO_HZ			10
+#define AVTP_ASRC_SERVO_TP_SEC		4.0
+#define AVTP_ASRC_SERVO_TI_SEC		20.0
+// Largest servo correction
+#define AVTP_ASRC_MAX_CORR_PPB		1000000.0
+
+// Output timestamps further than this from the capture time are re-anchored
+#define AVTP_ASRC_MAX_TS_ERR_NSEC	2000000.0
+
+struct openavb_avtp_asrc {
+	avtp_asrc_mode_t mode;
+
+	// Stream media queue and the staging queue the interface fills
+	media_q_t *pMediaQ;
+	media_q_t *pInQ;
+
+	openavb_asrc_t asrc;
+
+	// Sample format
+	U32 channels;
+	U32 sampleBytes;
+	U32 bitDepth;
+	bool bFloat;
+	bool bBigEndian;
+	U32 audioRate;
+	U32 framesPerItem;
+	U32 itemFrameSizeBytes;
+
+	// One item of interleaved float samples
+	float *pConv;
+
+	// Input frames written to the converter since the last reset
+	U64 inFrames;
+	// Capture time of the first frame of the last timestamped input item
+	bool bInTs;
+	U64 lastInTs;
+	U64 lastInIdx;
+
+	// Device clock against the item timestamps
+	mcr_sw_t devClock;
+	bool bDevPushed;
+	U32 devPendingFrames;
+	U32 devPushFrames;
+
+	// Servo, in input frames above the target level
+	bool bPrimed;
+	double targetFrames;
+	U32 servoItems;
+	U32 servoCount;
+	double servoFillSum;
+	double servoInteg;
+	// Feed forward rate and which estimates it contains
+	double ffPpb;
+	bool bFfDev;
+	bool bFfMcr;
+	double ratioPpb;
+	double outPpb;
+
+	// Output timeline, kept as base plus offset so the fraction isn't lost
+	bool bOutTs;
+	U64 outBaseNs;
+	double outOffsetNs;
+};
+
+static bool x_formatOK(openavb_avtp_asrc_t asrc, media_q_pub_map_uncmp_audio_info_t *pPubMapInfo)
+{
+	asrc->channels = pPubMapInfo->audioChannels;
+	asrc->sampleBytes = pPubMapInfo->itemSampleSizeBytes;
+	asrc->bitDepth = pPubMapInfo->audioBitDepth;
+	asrc->bFloat = (pPubMapInfo->audioType == AVB_AUDIO_TYPE_FLOAT);
+	asrc->bBigEndian = (pPubMapInfo->audioEndian == AVB_AUDIO_ENDIAN_BIG);
+	asrc->audioRate = pPubMapInfo->audioRate;
+	asrc->framesPerItem = pPubMapInfo->framesPerItem;
+	asrc->itemFrameSizeBytes = pPubMapInfo->itemFrameSizeBytes;
+
+	if (!asrc->channels || !asrc->audioRate || !asrc->framesPerItem
+		|| asrc->itemFrameSizeBytes != asrc->channels * asrc->sampleBytes) {
+		AVB_LOG_ERROR("ASRC needs the audio format set by the mapping module");
+		return FALSE;
+	}
+	if (asrc->bFloat) {
+		if (asrc->sampleBytes != 4) {
+			AVB_LOGF_ERROR("ASRC doesn't support %u byte float samples", asrc->sampleBytes);
+			return FALSE;
+		}
+	}
+	else if (pPubMapInfo->audioType == AVB_AUDIO_TYPE_INT || pPubMapInfo->audioType == AVB_AUDIO_TYPE_UNSPEC) {
+		if (asrc->sampleBytes < 2 || asrc->sampleBytes > 4
+			|| asrc->bitDepth < 16 || asrc->bitDepth > asrc->sampleBytes * 8) {
+			AVB_LOGF_ERROR("ASRC doesn't support %u bit samples in %u bytes", asrc->bitDepth, asrc->sampleBytes);
+			return FALSE;
+		}
+	}
+	else {
+		AVB_LOG_ERROR("ASRC only supports signed integer and float samples");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void x_toFloat(openavb_avtp_asrc_t asrc, const U8 *pSrc, float *pDst, U32 samples)
+{
+	U32 bytes = asrc->sampleBytes;
+	U32 shift = 32 - asrc->bitDepth;
+	float scale = 1.0f / 2147483648.0f;
+	U32 i, b;
+
+	for (i = 0; i < samples; i++) {
+		U32 v = 0;
+		if (asrc->bBigEndian) {
+			for (b = 0; b < bytes; b++) {
+				v = (v << 8) | pSrc[b];
+			}
+		}
+		else {
+			for (b = bytes; b > 0; b--) {
+				v = (v << 8) | pSrc[b - 1];
+			}
+		}
+		pSrc += bytes;
+
+		if (asrc->bFloat) {
+			memcpy(&pDst[i], &v, sizeof(float));
+		}
+		else {
+			// Left align the sample
+			pDst[i] = (float)(S32)(v << shift) * scale;
+		}
+	}
+}
+
+static void x_fromFloat(openavb_avtp_asrc_t asrc, const float *pSrc, U8 *pDst, U32 samples)
+{
+	U32 bytes = asrc->sampleBytes;
+	U32 shift = 32 - asrc->bitDepth;
+	U32 i, b;
+
+	for (i = 0; i < samples; i++) {
+		U32 v;
+		if (asrc->bFloat) {
+			memcpy(&v, &pSrc[i], sizeof(float));
+		}
+		else {
+			float f = pSrc[i] * 2147483648.0f;
+			S32 s;
+			if (f >= 2147483647.0f) {
+				s = 0x7FFFFFFF;
+			}
+			else if (f <= -2147483648.0f) {
+				s = (S32)0x80000000;
+			}
+			else {
+				s = (S32)lrintf(f);
+			}
+			v = (U32)(s >> shift);
+		}
+
+		if (asrc->bBigEndian) {
+			for (b = bytes; b > 0; b--) {
+				pDst[b - 1] = (U8)v;
+				v >>= 8;
+			}
+		}
+		else {
+			for (b = 0; b < bytes; b++) {
+				pDst[b] = (U8)v;
+				v >>= 8;
+			}
+		}
+		pDst += bytes;
+	}
+}
+
+static void x_reset(openavb_avtp_asrc_t asrc)
+{
+	openavbAsrcReset(asrc->asrc);
+	asrc->inFrames = 0;
+	asrc->bInTs = FALSE;
+	asrc->bPrimed = FALSE;
+	asrc->bOutTs = FALSE;
+	asrc->servoCount = 0;
+	asrc->servoFillSum = 0.0;
+}
+
+// Track the device clock rate from the staged item timestamps
+static void x_devClockPush(openavb_avtp_asrc_t asrc, media_q_item_t *pItem, U32 frames)
+{
+	if (!openavbAvtpTimeTimestampIsValid(pItem->pAvtpTime)) {
+		asrc->bDevPushed = FALSE;
+		asrc->bInTs = FALSE;
+		return;
+	}
+
+	U64 ts = openavbAvtpTimeGetAvtpTimeNS(pItem->pAvtpTime);
+	if (!asrc->bDevPushed || asrc->devPendingFrames >= asrc->devPushFrames) {
+		openavbMcrSwPush(&asrc->devClock, (U32)ts, asrc->devPendingFrames, asrc->audioRate);
+		asrc->devPendingFrames = 0;
+		asrc->bDevPushed = TRUE;
+	}
+	asrc->devPendingFrames += frames;
+
+	asrc->bInTs = TRUE;
+	asrc->lastInTs = ts;
+	asrc->lastInIdx = asrc->inFrames;
+}
+
+static void x_drainInput(openavb_avtp_asrc_t asrc)
+{
+	media_q_item_t *pItem;
+
+	while ((pItem = openavbMediaQTailLock(asrc->pInQ, TRUE)) != NULL) {
+		U32 frames = pItem->dataLen / asrc->itemFrameSizeBytes;
+		if (frames > asrc->framesPerItem) {
+			frames = asrc->framesPerItem;
+		}
+
+		if (frames) {
+			x_devClockPush(asrc, pItem, frames);
+			x_toFloat(asrc, pItem->pPubData, asrc->pConv, frames * asrc->channels);
+			if (openavbAsrcWrite(asrc->asrc, asrc->pConv, frames) != frames) {
+				IF_LOG_INTERVAL(100) AVB_LOG_WARNING("ASRC overflow, restarting");
+				x_reset(asrc);
+			}
+			else {
+				asrc->inFrames += frames;
+			}
+		}
+		openavbMediaQTailPull(asrc->pInQ);
+	}
+}
+
+// Average the converter level over a servo period and update the ratio
+static void x_servo(openavb_avtp_asrc_t asrc)
+{
+	asrc->servoFillSum += openavbAsrcFill(asrc->asrc);
+	if (++asrc->servoCount < asrc->servoItems) {
+		return;
+	}
+
+	double periodSec = (double)asrc->servoCount * asrc->framesPerItem / asrc->audioRate;
+	double err = asrc->servoFillSum / asrc->servoCount - asrc->targetFrames;
+	asrc->servoCount = 0;
+	asrc->servoFillSum = 0.0;
+
+	// Too much buffered input means the converter must consume faster
+	double kp = 1e9 / (asrc->audioRate * AVTP_ASRC_SERVO_TP_SEC);
+	double integMax = AVTP_ASRC_MAX_CORR_PPB * AVTP_ASRC_SERVO_TI_SEC / kp;
+	asrc->servoInteg += err * periodSec;
+	if (asrc->servoInteg > integMax) {
+		asrc->servoInteg = integMax;
+	}
+	else if (asrc->servoInteg < -integMax) {
+		asrc->servoInteg = -integMax;
+	}
+
+	S32 devPpb = 0;
+	bool bDev = openavbMcrSwGetRatePpb(&asrc->devClock, &devPpb);
+	if (!bDev) {
+		devPpb = 0;
+	}
+
+	S32 mcrPpb = 0;
+	bool bMcr = (asrc->mode == AVTP_ASRC_MCR) && HAL_GET_MCR_RATE_V2(&mcrPpb);
+	if (!bMcr) {
+		mcrPpb = 0;
+	}
+	asrc->outPpb = mcrPpb;
+
+	// When an estimate comes or goes the integral has already absorbed the
+	// difference; hand it over so the ratio doesn't jump.
+	double ffPpb = (double)devPpb - mcrPpb;
+	if (bDev != asrc->bFfDev || bMcr != asrc->bFfMcr) {
+		asrc->servoInteg -= (ffPpb - asrc->ffPpb) * AVTP_ASRC_SERVO_TI_SEC / kp;
+		asrc->bFfDev = bDev;
+		asrc->bFfMcr = bMcr;
+	}
+	asrc->ffPpb = ffPpb;
+
+	double corrPpb = kp * (err + asrc->servoInteg / AVTP_ASRC_SERVO_TI_SEC);
+	if (corrPpb > AVTP_ASRC_MAX_CORR_PPB) {
+		corrPpb = AVTP_ASRC_MAX_CORR_PPB;
+	}
+	else if (corrPpb < -AVTP_ASRC_MAX_CORR_PPB) {
+		corrPpb = -AVTP_ASRC_MAX_CORR_PPB;
+	}
+
+	// Input frames per output frame is device rate over output rate
+	asrc->ratioPpb = ffPpb + corrPpb;
+	openavbAsrcSetRatio(asrc->asrc, 1.0 + asrc->ratioPpb * 1e-9);
+
+	IF_LOG_INTERVAL(100) AVB_LOGF_DEBUG("ASRC level:%.1f target:%.0f dev:%d ppb mcr:%d ppb ratio:%.0f ppb",
+		err + asrc->targetFrames, asrc->targetFrames, devPpb, mcrPpb, asrc->ratioPpb);
+}
+
+// Timestamp an output item with the capture time of its first frame, advanced
+// at the output rate so that it stays smooth.
+static void x_timestamp(openavb_avtp_asrc_t asrc, media_q_item_t *pItem, double pos)
+{
+	if (!asrc->bInTs) {
+		openavbAvtpTimeSetTimestampValid(pItem->pAvtpTime, FALSE);
+		asrc->bOutTs = FALSE;
+		return;
+	}
+
+	double estNs = (double)asrc->lastInTs + (pos - (double)asrc->lastInIdx) * NANOSECONDS_PER_SECOND / asrc->audioRate;
+	if (asrc->bOutTs) {
+		double errNs = (double)asrc->outBaseNs + asrc->outOffsetNs - estNs;
+		if (fabs(errNs) > AVTP_ASRC_MAX_TS_ERR_NSEC) {
+			IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("ASRC output time %.0f ns off the capture time, re-anchoring", errNs);
+			asrc->bOutTs = FALSE;
+		}
+	}
+	if (!asrc->bOutTs) {
+		asrc->outBaseNs = (U64)estNs;
+		asrc->outOffsetNs = 0.0;
+		asrc->bOutTs = TRUE;
+	}
+
+	openavbAvtpTimeSetToTimestampNS(pItem->pAvtpTime, asrc->outBaseNs + (U64)asrc->outOffsetNs);
+
+	asrc->outOffsetNs += (double)asrc->framesPerItem * NANOSECONDS_PER_SECOND / (asrc->audioRate * (1.0 + asrc->outPpb * 1e-9));
+	U64 whole = (U64)asrc->outOffsetNs;
+	asrc->outBaseNs += whole;
+	asrc->outOffsetNs -= whole;
+}
+
+openavb_avtp_asrc_t openavbAvtpAsrcNew(media_q_t *pMediaQ, avtp_asrc_mode_t mode, U32 bufferUsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	if (!pMediaQ || !pMediaQ->pPubMapInfo || !pMediaQ->pMediaQDataFormat
+		|| (strcmp(pMediaQ->pMediaQDataFormat, MapUncmpAudioMediaQDataFormat) != 0
+		&& strcmp(pMediaQ->pMediaQDataFormat, MapAVTPAudioMediaQDataFormat) != 0)) {
+		AVB_LOG_ERROR("ASRC needs an uncompressed or AAF audio mapping");
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return NULL;
+	}
+
+	openavb_avtp_asrc_t asrc = calloc(1, sizeof(struct openavb_avtp_asrc));
+	if (!asrc) {
+		AVB_LOG_ERROR("Unable to allocate ASRC");
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return NULL;
+	}
+	asrc->mode = mode;
+	asrc->pMediaQ = pMediaQ;
+
+	media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
+	if (!x_formatOK(asrc, pPubMapInfo)) {
+		openavbAvtpAsrcDelete(asrc);
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return NULL;
+	}
+
+	if (!bufferUsec) {
+		bufferUsec = AVTP_ASRC_DEFAULT_BUFFER_USEC;
+	}
+	asrc->targetFrames = (double)bufferUsec * asrc->audioRate / MICROSECONDS_PER_SECOND;
+	if (asrc->targetFrames < asrc->framesPerItem) {
+		asrc->targetFrames = asrc->framesPerItem;
+	}
+
+	// Room for the level swinging around the target plus a full staging queue
+	U32 capacity = (U32)asrc->targetFrames * 4 + AVTP_ASRC_STAGE_ITEMS * asrc->framesPerItem;
+	asrc->asrc = openavbAsrcNew(asrc->channels, capacity);
+	asrc->pConv = malloc((size_t)asrc->framesPerItem * asrc->channels * sizeof(float));
+
+	// The staging queue shares the mapping and interface data of the stream
+	// media queue so the interface module can't tell them apart.
+	asrc->pInQ = openavbMediaQCreate();
+	if (!asrc->asrc || !asrc->pConv || !asrc->pInQ) {
+		AVB_LOG_ERROR("Unable to allocate ASRC");
+		openavbAvtpAsrcDelete(asrc);
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return NULL;
+	}
+	asrc->pInQ->pMediaQDataFormat = pMediaQ->pMediaQDataFormat;
+	asrc->pInQ->pPubMapInfo = pMediaQ->pPubMapInfo;
+	asrc->pInQ->pPvtMapInfo = pMediaQ->pPvtMapInfo;
+	asrc->pInQ->pPvtIntfInfo = pMediaQ->pPvtIntfInfo;
+	openavbMediaQThreadSafeOn(asrc->pInQ);
+	if (!openavbMediaQSetSize(asrc->pInQ, AVTP_ASRC_STAGE_ITEMS, pPubMapInfo->itemSize)) {
+		AVB_LOG_ERROR("Unable to size the ASRC staging media queue");
+		openavbAvtpAsrcDelete(asrc);
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+		return NULL;
+	}
+
+	openavbMcrSwInit(&asrc->devClock, AVTP_ASRC_PUSH_WINDOW);
+	asrc->devPushFrames = asrc->audioRate / 1000 * AVTP_ASRC_PUSH_MSEC;
+	asrc->servoItems = asrc->audioRate / (asrc->framesPerItem * AVTP_ASRC_SERVO_HZ);
+	if (asrc->servoItems == 0) {
+		asrc->servoItems = 1;
+	}
+	x_reset(asrc);
+
+	AVB_LOGF_INFO("ASRC %s, %u channels at %u Hz, buffer %u usec",
+		mode == AVTP_ASRC_MCR ? "to MCR" : "to gPTP", asrc->channels, asrc->audioRate, bufferUsec);
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+	return asrc;
+}
+
+void openavbAvtpAsrcDelete(openavb_avtp_asrc_t asrc)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP);
+
+	if (asrc) {
+		if (asrc->pInQ) {
+			// Shared with the stream media queue, which frees them
+			asrc->pInQ->pMediaQDataFormat = NULL;
+			asrc->pInQ->pPubMapInfo = NULL;
+			asrc->pInQ->pPvtMapInfo = NULL;
+			asrc->pInQ->pPvtIntfInfo = NULL;
+			openavbMediaQDelete(asrc->pInQ);
+		}
+		openavbAsrcDelete(asrc->asrc);
+		free(asrc->pConv);
+		free(asrc);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP);
+}
+
+media_q_t *openavbAvtpAsrcMediaQ(openavb_avtp_asrc_t asrc)
+{
+	return asrc->pInQ;
+}
+
+void openavbAvtpAsrcRun(openavb_avtp_asrc_t asrc)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVTP_DETAIL);
+
+	x_drainInput(asrc);
+
+	if (!asrc->bPrimed) {
+		if (openavbAsrcFill(asrc->asrc) < asrc->targetFrames) {
+			AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+			return;
+		}
+		asrc->bPrimed = TRUE;
+	}
+
+	// Only produce at the pace the mapping module consumes, so the input level
+	// reflects the clock difference.
+	if (openavbMediaQCountItems(asrc->pMediaQ, TRUE) > 0) {
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+		return;
+	}
+
+	x_servo(asrc);
+
+	if (openavbAsrcAvailable(asrc->asrc) < asrc->framesPerItem) {
+		IF_LOG_INTERVAL(100) AVB_LOG_WARNING("ASRC underrun, refilling");
+		asrc->bPrimed = FALSE;
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+		return;
+	}
+
+	media_q_item_t *pItem = openavbMediaQHeadLock(asrc->pMediaQ);
+	if (!pItem) {
+		AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+		return;
+	}
+
+	double pos = openavbAsrcPosition(asrc->asrc);
+	openavbAsrcRead(asrc->asrc, asrc->pConv, asrc->framesPerItem);
+	x_fromFloat(asrc, asrc->pConv, pItem->pPubData, asrc->framesPerItem * asrc->channels);
+	pItem->dataLen = asrc->framesPerItem * asrc->itemFrameSizeBytes;
+	x_timestamp(asrc, pItem, pos);
+	openavbMediaQHeadPush(asrc->pMediaQ);
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVTP_DETAIL);
+}
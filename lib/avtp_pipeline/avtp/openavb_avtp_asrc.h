@@ -0,0 +1,69 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* HEADER SUMMARY : Asynchronous sample rate converter stage between the
+* talker interface and mapping modules.
+*/
+
+#ifndef AVB_AVTP_ASRC_H
+#define AVB_AVTP_ASRC_H 1
+
+#include "openavb_types.h"
+#include "openavb_mediaq_pub.h"
+
+// Values of the asrc stream setting
+typedef enum {
+	// No conversion, the interface fills the stream media queue
+	AVTP_ASRC_OFF = 0,
+	// Resample to the nominal rate on the gPTP timeline
+	AVTP_ASRC_GPTP = 1,
+	// Resample to the media clock recovered by the MCR HAL
+	AVTP_ASRC_MCR = 2,
+} avtp_asrc_mode_t;
+
+typedef struct openavb_avtp_asrc * openavb_avtp_asrc_t;
+
+// Create a stage feeding pMediaQ, which must carry uncompressed or AAF audio.
+// bufferUsec is the input kept buffered ahead of the converter; 0 picks a
+// default. Returns NULL if the stream can't be converted.
+openavb_avtp_asrc_t openavbAvtpAsrcNew(media_q_t *pMediaQ, avtp_asrc_mode_t mode, U32 bufferUsec);
+
+// Delete a stage. The stream media queue is left alone.
+void openavbAvtpAsrcDelete(openavb_avtp_asrc_t asrc);
+
+// The media queue the interface module fills instead of the stream media queue.
+media_q_t *openavbAvtpAsrcMediaQ(openavb_avtp_asrc_t asrc);
+
+// Move the interface data through the converter, pushing an item to the
+// stream media queue when the mapping module needs one.
+void openavbAvtpAsrcRun(openavb_avtp_asrc_t asrc);
+
+#endif // AVB_AVTP_ASRC_H
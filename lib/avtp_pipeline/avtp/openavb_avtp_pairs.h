@@ -0,0 +1,53 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* HEADER SUMMARY : Mapping and interface module pairs that get their own
+* AVTP TX and RX paths in builds with AVB_FEATURE_STATIC_PAIRS.
+*
+* A stream whose callbacks match a pair runs a copy of the AVTP fill and
+* receive code with those callbacks called directly rather than through
+* openavb_map_cb_t / openavb_intf_cb_t, so the compiler (and LTO) can
+* inline them. Streams with any other combination, or with modules loaded
+* through dlopen, use the generic path. Edit the list to suit the target.
+*/
+
+#ifndef OPENAVB_AVTP_PAIRS_H
+#define OPENAVB_AVTP_PAIRS_H 1
+
+// X(name, map TX callback, interface TX callback, map RX callback, interface RX callback)
+#define AVTP_STATIC_PAIRS(X)																\
+	X(aaf_alsa,       openavbMapAVTPAudioTxCB,  openavbIntfAlsaTxCB,     openavbMapAVTPAudioRxCB,  openavbIntfAlsaRxCB)		\
+	X(aaf_tonegen,    openavbMapAVTPAudioTxCB,  openavbIntfToneGenTxCB,  openavbMapAVTPAudioRxCB,  openavbIntfToneGenRxCB)	\
+	X(uncmp_alsa,     openavbMapUncmpAudioTxCB, openavbIntfAlsaTxCB,     openavbMapUncmpAudioRxCB, openavbIntfAlsaRxCB)		\
+	X(uncmp_tonegen,  openavbMapUncmpAudioTxCB, openavbIntfToneGenTxCB,  openavbMapUncmpAudioRxCB, openavbIntfToneGenRxCB)	\
+	X(null_null,      openavbMapNullTxCB,       openavbIntfNullTxCB,     openavbMapNullRxCB,       openavbIntfNullRxCB)
+
+#endif // OPENAVB_AVTP_PAIRS_H
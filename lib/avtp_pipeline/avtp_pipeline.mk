@@ -1,6 +1,7 @@
 AVB_FEATURE_ENDPOINT ?= 1
 IGB_LAUNCHTIME_ENABLED ?= 0
 AVB_FEATURE_GSTREAMER ?= 1
+AVB_FEATURE_PRODUCTION ?= 0
 PLATFORM_TOOLCHAIN ?= x86_i210_linux
 
 .PHONY: all clean
@@ -23,4 +24,5 @@ build/Makefile:
 	      -DAVB_FEATURE_ENDPOINT=$(AVB_FEATURE_ENDPOINT) \
 	      -DIGB_LAUNCHTIME_ENABLED=$(IGB_LAUNCHTIME_ENABLED) \
 	      -DAVB_FEATURE_GSTREAMER=$(AVB_FEATURE_GSTREAMER) \
+	      -DAVB_FEATURE_PRODUCTION=$(AVB_FEATURE_PRODUCTION) \
               ..
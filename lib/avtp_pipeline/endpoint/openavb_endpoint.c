@@ -59,6 +59,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_avtp.h"
 #include "openavb_qmgr.h"
 #include "openavb_maap.h"
+#include "openavb_endpoint_avdecc.h"
 
 #define	AVB_LOG_COMPONENT	"Endpoint"
 #include "openavb_pub.h"
@@ -70,6 +71,14 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 // list of streams that we're managing
 clientStream_t* 				x_streamList;
+// last link of x_streamList, where new streams are appended
+static clientStream_t**			x_streamListTail = &x_streamList;
+
+// Streams are also indexed by StreamID and MAAP handle so lookups from
+// client messages and MAAP callbacks do not walk the whole list.
+#define STREAM_HASH_SIZE	256		// must be a power of 2
+static clientStream_t*			x_streamByID[STREAM_HASH_SIZE];
+static clientStream_t*			x_streamByMaap[STREAM_HASH_SIZE];
 // true until we are signalled to stop
 bool endpointRunning = TRUE;
 // data from our configuation file
@@ -117,6 +126,35 @@ void openavbEndPtLogAllStaticStreams(void)
 	}
 }
 
+static unsigned x_streamIDHash(const AVBStreamID_t *streamID)
+{
+	// FNV-1a over the MAC and unique ID
+	U32 hash = 2166136261u;
+	int i;
+	for (i = 0; i < ETH_ALEN; i++) {
+		hash = (hash ^ streamID->addr[i]) * 16777619u;
+	}
+	hash = (hash ^ (streamID->uniqueID & 0xff)) * 16777619u;
+	hash = (hash ^ (streamID->uniqueID >> 8)) * 16777619u;
+	return hash & (STREAM_HASH_SIZE - 1);
+}
+
+static unsigned x_maapHash(const void *hndMaap)
+{
+	uintptr_t v = (uintptr_t)hndMaap;
+	v ^= v >> 4;
+	v ^= v >> 12;
+	return v & (STREAM_HASH_SIZE - 1);
+}
+
+static void x_streamTableInit(void)
+{
+	x_streamList = NULL;
+	x_streamListTail = &x_streamList;
+	memset(x_streamByID, 0, sizeof(x_streamByID));
+	memset(x_streamByMaap, 0, sizeof(x_streamByMaap));
+}
+
 /* Called for each talker or listener stream declared by clients
  */
 clientStream_t* addStream(int h, AVBStreamID_t *streamID)
@@ -135,33 +173,70 @@ clientStream_t* addStream(int h, AVBStreamID_t *streamID)
 		newClientStream->streamID.uniqueID = streamID->uniqueID;
 		newClientStream->clientHandle = h;
 		newClientStream->fwmark = INVALID_FWMARK;
-	
-		if(x_streamList == NULL) {
-			x_streamList = newClientStream;
-		}else {
-			// insert at end
-			for(lpp = &x_streamList; *lpp != NULL; lpp = &(*lpp)->next) {
-				if ((*lpp)->next == NULL) {
-					(*lpp)->next = newClientStream;
-					break;
-				}
-			}
-		}
+
+		// insert at end
+		newClientStream->pprev = x_streamListTail;
+		*x_streamListTail = newClientStream;
+		x_streamListTail = &newClientStream->next;
+
+		// append to the bucket so that the oldest entry for a StreamID is found first
+		for (lpp = &x_streamByID[x_streamIDHash(streamID)]; *lpp != NULL; lpp = &(*lpp)->nextByID);
+		*lpp = newClientStream;
 	} while (0);
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
 	return newClientStream;
 }
 
+/* Set (or clear, with NULL) the MAAP handle of a stream, keeping the index current
+ */
+void setStreamMaap(clientStream_t* ps, void *hndMaap)
+{
+	clientStream_t **lpp;
+
+	if (ps->hndMaap) {
+		for (lpp = &x_streamByMaap[x_maapHash(ps->hndMaap)]; *lpp != NULL; lpp = &(*lpp)->nextByMaap) {
+			if (*lpp == ps) {
+				*lpp = ps->nextByMaap;
+				break;
+			}
+		}
+		ps->nextByMaap = NULL;
+	}
+
+	ps->hndMaap = hndMaap;
+
+	if (hndMaap) {
+		lpp = &x_streamByMaap[x_maapHash(hndMaap)];
+		ps->nextByMaap = *lpp;
+		*lpp = ps;
+	}
+}
+
 void delStream(clientStream_t* ps)
 {
 	clientStream_t **lpp;
-	for(lpp = &x_streamList; *lpp != NULL; lpp = &(*lpp)->next) {
-		if((*lpp) == ps) {
-			*lpp = (*lpp)->next;
-			free(ps);
+
+	if (!ps || !ps->pprev) {
+		return;
+	}
+
+	setStreamMaap(ps, NULL);
+
+	for (lpp = &x_streamByID[x_streamIDHash(&ps->streamID)]; *lpp != NULL; lpp = &(*lpp)->nextByID) {
+		if (*lpp == ps) {
+			*lpp = ps->nextByID;
 			break;
 		}
 	}
+
+	*ps->pprev = ps->next;
+	if (ps->next) {
+		ps->next->pprev = ps->pprev;
+	}
+	else {
+		x_streamListTail = ps->pprev;
+	}
+	free(ps);
 }
 
 /* Find a stream in the list of streams we're handling
@@ -194,12 +269,10 @@ clientStream_t* findStream(AVBStreamID_t *streamID)
 		AVB_LOGF_DEBUG("Replaced default streamID MAC with interface MAC "ETH_FORMAT, ETH_OCTETS(streamID->addr));
 	}
 
-	clientStream_t **lpp;
-	for(lpp = &x_streamList; *lpp != NULL; lpp = &(*lpp)->next) {
-		if (memcmp(streamID->addr, (*lpp)->streamID.addr, ETH_ALEN) == 0
-			&& streamID->uniqueID == (*lpp)->streamID.uniqueID)
+	for (ps = x_streamByID[x_streamIDHash(streamID)]; ps != NULL; ps = ps->nextByID) {
+		if (memcmp(streamID->addr, ps->streamID.addr, ETH_ALEN) == 0
+			&& streamID->uniqueID == ps->streamID.uniqueID)
 		{
-			ps = *lpp;
 			break;
 		}
 	}
@@ -213,12 +286,10 @@ static clientStream_t* findStreamMaap(void* hndMaap)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
 	clientStream_t* ps = NULL;
-	
-	clientStream_t **lpp;
-	for(lpp = &x_streamList; *lpp != NULL; lpp = &(*lpp)->next) {
-		if ((*lpp)->hndMaap == hndMaap)
+
+	for (ps = x_streamByMaap[x_maapHash(hndMaap)]; ps != NULL; ps = ps->nextByMaap) {
+		if (ps->hndMaap == hndMaap)
 		{
-			ps = *lpp;
 			break;
 		}
 	}
@@ -251,7 +322,7 @@ bool x_talkerDeregister(clientStream_t *ps)
 	// Release MAAP address allocation
 	if (ps->hndMaap) {
 		openavbMaapRelease(ps->hndMaap);
-		ps->hndMaap = NULL;
+		setStreamMaap(ps, NULL);
 	}
 		
 	// remove record
@@ -464,13 +535,27 @@ int avbEndpointLoop(void)
 			AVB_LOG_WARNING(" ");
 		}
 
-		x_streamList = NULL;
+		x_streamTableInit();
 
 		if (!openavbQmgrInitialize(x_cfg.fqtss_mode, x_cfg.ifindex, x_cfg.ifname, x_cfg.mtu, x_cfg.link_kbit, x_cfg.nsr_kbit)) {
 			AVB_LOG_ERROR("Failed to initialize QMgr");
 			break;
 		}
 
+		int nClass;
+		for (nClass = SR_CLASS_A; nClass < MAX_AVB_SR_CLASSES; nClass++) {
+			if (x_cfg.cbs_parent[nClass]
+				&& !openavbQmgrSetupCbs((SRClassIdx_t)nClass, x_cfg.cbs_parent[nClass], x_cfg.cbs_offload)) {
+				AVB_LOGF_WARNING("Failed to set up the CBS qdisc for class %c", AVB_CLASS_LABEL(nClass));
+			}
+		}
+
+		// after CBS, so the ETF qdisc can be put under a CBS qdisc
+		if (x_cfg.etf_parent
+			&& !openavbQmgrSetupLaunchTime(x_cfg.etf_parent, x_cfg.etf_delta_usec, x_cfg.etf_offload)) {
+			AVB_LOG_WARNING("Failed to set up the ETF qdisc; SO_TXTIME launch time will not work");
+		}
+
 		if (!openavbMaapInitialize(x_cfg.ifname, maapRestartCallback)) {
 			AVB_LOG_ERROR("Failed to initialize MAAP");
 			openavbQmgrFinalize();
@@ -498,6 +583,10 @@ int avbEndpointLoop(void)
 			break;
 		}
 
+		if (!openavbAvdeccInitialize(&x_cfg)) {
+			AVB_LOG_WARNING("Failed to start the AVDECC entity; streams will not wait for a controller");
+		}
+
 		if (openavbEndpointServerOpen()) {
 
 			while (endpointRunning) {
@@ -506,6 +595,8 @@ int avbEndpointLoop(void)
 
 			openavbEndpointServerClose();
 		}
+
+		openavbAvdeccFinalize();
 				
 		if(!x_cfg.noSrp) {
 			// Shutdown SRP
@@ -67,6 +67,12 @@ typedef enum {
 	OPENAVB_ENDPOINT_TALKER_CALLBACK,
 	OPENAVB_ENDPOINT_LISTENER_CALLBACK,
 	OPENAVB_ENDPOINT_VERSION_CALLBACK,
+
+	// client messages added later; kept at the end so the values above do not change
+	OPENAVB_ENDPOINT_CLIENT_STATS,
+
+	// server messages added later
+	OPENAVB_ENDPOINT_ACMP_CALLBACK,
 } openavbEndpointMsgType_t;
 
 //////////////////////////////
@@ -90,6 +96,10 @@ typedef struct {
 typedef struct {
 } openavbEndpointParams_VersionRequest_t;
 
+typedef struct {
+	openavb_hist_summary_t hist[TL_HIST_COUNT];
+} openavbEndpointParams_ClientStats_t;
+
 //////////////////////////////
 // Server messages parameters
 //////////////////////////////
@@ -117,10 +127,18 @@ typedef struct {
 	U32 		AVBVersion;
 } openavbEndpointParams_VersionCallback_t;
 
+typedef struct {
+	bool		connect;
+	U8 			destAddr[ETH_ALEN];
+} openavbEndpointParams_AcmpCallback_t;
+
 #define OPENAVB_ENDPOINT_MSG_LEN sizeof(openavbEndpointMessage_t)
 
 typedef struct clientStream_t {
 	struct clientStream_t *next; // next link list pointer
+	struct clientStream_t **pprev;		// link that points at this entry in the list
+	struct clientStream_t *nextByID;	// next entry in the same StreamID hash bucket
+	struct clientStream_t *nextByMaap;	// next entry in the same MAAP handle hash bucket
 
 	int				clientHandle;		// ID that links this info to client (talker or listener)
 
@@ -145,6 +163,9 @@ typedef struct clientStream_t {
 
 	// Information provided by QMgr
 	int				fwmark;				// mark to identify packets of this stream
+
+	// Latest latency histogram summaries reported by the client
+	openavb_hist_summary_t hist[TL_HIST_COUNT];
 } clientStream_t;
 
 int startPTP(void);
@@ -155,6 +176,7 @@ void openavbEndpointServerClose(void);
 clientStream_t* findStream(AVBStreamID_t *streamID);
 void delStream(clientStream_t* ps);
 clientStream_t* addStream(int h, AVBStreamID_t *streamID);
+void setStreamMaap(clientStream_t* ps, void *hndMaap);
 void openavbEndPtLogAllStaticStreams(void);
 bool x_talkerDeregister(clientStream_t *ps);
 bool x_listenerDetach(clientStream_t *ps);
@@ -225,6 +247,12 @@ bool openavbEptSrvrAttachStream(int                      h,
                             AVBStreamID_t           *streamID,
                             openavbSrpLsnrDeclSubtype_t  ld);
 
+// Talkers and listeners with latency_hist set periodically report a summary
+// of their latency histograms. Endpoint communication is from client to server.
+bool openavbEptSrvrClientStats(int                      h,
+                           AVBStreamID_t           *streamID,
+                           openavb_hist_summary_t   hist[TL_HIST_COUNT]);
+
 
 // SRP notifies the talker when its stream has been established to taken down.
 // Endpoint communication is from server to client.
@@ -269,6 +297,20 @@ void openavbEptClntNotifyLstnrOfSrpCb(int                 h,
                                   openavbSrpFailInfo_t   *failInfo);
 
 
+// With the endpoint's AVDECC entity enabled, a controller connecting or
+// disconnecting a stream resumes or pauses it; a listener connected to
+// another talker moves to that talker's stream first.
+// Endpoint communication is from server to client.
+void openavbEptSrvrNotifyOfAcmpCb(int                 h,
+                              AVBStreamID_t      *streamID,
+                              U8                  destAddr[],
+                              bool                connect);
+void openavbEptClntNotifyOfAcmpCb(int                 h,
+                              AVBStreamID_t      *streamID,
+                              U8                  destAddr[],
+                              bool                connect);
+
+
 // A talker can withdraw its stream registration at any time;
 // a listener can withdraw its stream attachement at any time;
 // in ether case, endpoint communication is from client to server
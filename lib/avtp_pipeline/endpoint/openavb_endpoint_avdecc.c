@@ -0,0 +1,898 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : AVDECC entity of the endpoint (IEEE 1722.1-2013)
+*
+* ADP: the entity is advertised every quarter of its valid time, whenever
+* its talkers or listeners change, and on ENTITY_DISCOVER.
+*
+* ACMP: each client gets a talker or listener unique ID, the lowest free
+* one for its role, in the order the clients register. A CONNECT_TX for a
+* talker resumes its stream when the first listener connects, and the last
+* DISCONNECT_TX pauses it again. A CONNECT_RX for a listener is passed on
+* to the talker as CONNECT_TX; when the talker answers, the listener is
+* resumed, or moved to the talker's stream if it was waiting on another
+* one, and the controller gets its CONNECT_RX_RESPONSE. DISCONNECT_RX is
+* answered right away, without waiting for the talker.
+*
+* AECP: there is no entity model, so AEM commands other than
+* ENTITY_AVAILABLE are answered with NOT_IMPLEMENTED.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "openavb_platform.h"
+#include "openavb_trace.h"
+#include "openavb_endpoint.h"
+#include "openavb_endpoint_avdecc.h"
+
+#define	AVB_LOG_COMPONENT	"AVDECC"
+#include "openavb_pub.h"
+#include "openavb_log.h"
+
+#include "openavb_endpoint_avdecc_osal.c"
+
+// the following is from openavb_endpoint.c
+extern clientStream_t*         x_streamList;
+
+#define AVDECC_ETHERTYPE			0x22F0
+#define AVDECC_ETH_HDR_LEN			14
+#define AVDECC_FRAME_MIN			60		// shortest Ethernet frame, without FCS
+#define AVDECC_FRAME_MAX			1514
+#define AVDECC_RX_BATCH				32		// frames handled per service call
+
+#define AVDECC_MAX_CLIENTS			(MAX_AVB_STREAMS)
+#define AVDECC_MAX_LISTENERS		16		// listeners per talker stream
+
+// Control PDU header: cd and subtype, sv, version and message type,
+// status and control data length, stream or entity ID
+#define AVDECC_CD					0x80
+#define AVDECC_SUBTYPE_ADP			0x7A
+#define AVDECC_SUBTYPE_AECP			0x7B
+#define AVDECC_SUBTYPE_ACMP			0x7C
+#define AVDECC_HDR_LEN				12
+
+// ADP
+#define ADP_ENTITY_AVAILABLE		0
+#define ADP_ENTITY_DEPARTING		1
+#define ADP_ENTITY_DISCOVER			2
+
+#define ADP_ENTITY_ID				4
+#define ADP_ENTITY_MODEL_ID			12
+#define ADP_ENTITY_CAPABILITIES		20
+#define ADP_TALKER_STREAM_SOURCES	24
+#define ADP_TALKER_CAPABILITIES		26
+#define ADP_LISTENER_STREAM_SINKS	28
+#define ADP_LISTENER_CAPABILITIES	30
+#define ADP_AVAILABLE_INDEX			36
+#define ADP_PDU_LEN					68
+
+#define ADP_ENTITY_CAP_CLASS_A		0x00000100
+#define ADP_ENTITY_CAP_CLASS_B		0x00000200
+#define ADP_ENTITY_CAP_GPTP			0x00000400
+#define ADP_STREAM_CAP_IMPLEMENTED	0x0001
+#define ADP_STREAM_CAP_AUDIO		0x4000
+
+// AECP
+#define AECP_AEM_COMMAND			0
+#define AECP_TARGET_ENTITY_ID		4
+#define AECP_COMMAND_TYPE			22
+#define AECP_AEM_HDR_LEN			24
+#define AECP_STATUS_SUCCESS			0
+#define AECP_STATUS_NOT_IMPLEMENTED	1
+#define AEM_CMD_ENTITY_AVAILABLE	0x0002
+
+// ACMP
+#define ACMP_CONNECT_TX_COMMAND		0
+#define ACMP_CONNECT_TX_RESPONSE	1
+#define ACMP_DISCONNECT_TX_COMMAND	2
+#define ACMP_DISCONNECT_TX_RESPONSE	3
+#define ACMP_GET_TX_STATE_COMMAND	4
+#define ACMP_CONNECT_RX_COMMAND		6
+#define ACMP_DISCONNECT_RX_COMMAND	8
+#define ACMP_GET_RX_STATE_COMMAND	10
+#define ACMP_GET_TX_CONNECTION_COMMAND	12
+
+#define ACMP_STREAM_ID				4
+#define ACMP_TALKER_ENTITY_ID		20
+#define ACMP_LISTENER_ENTITY_ID		28
+#define ACMP_TALKER_UNIQUE_ID		36
+#define ACMP_LISTENER_UNIQUE_ID		38
+#define ACMP_STREAM_DEST_MAC		40
+#define ACMP_CONNECTION_COUNT		46
+#define ACMP_SEQUENCE_ID			48
+#define ACMP_FLAGS					50
+#define ACMP_STREAM_VLAN_ID			52
+#define ACMP_PDU_LEN				56
+
+#define ACMP_FLAG_CLASS_B			0x0001
+
+#define ACMP_STATUS_SUCCESS					0
+#define ACMP_STATUS_LISTENER_UNKNOWN_ID		1
+#define ACMP_STATUS_TALKER_UNKNOWN_ID		2
+#define ACMP_STATUS_LISTENER_TALKER_TIMEOUT	7
+#define ACMP_STATUS_LISTENER_EXCLUSIVE		8
+#define ACMP_STATUS_STATE_UNAVAILABLE		9
+#define ACMP_STATUS_NOT_CONNECTED			10
+#define ACMP_STATUS_NOT_SUPPORTED			31
+
+// A CONNECT_TX the talker does not answer is sent once more
+#define ACMP_CONNECT_TX_TIMEOUT_MSEC	2000
+#define ACMP_CONNECT_TX_RETRIES			1
+
+typedef struct {
+	U64 entityID;
+	U16 uniqueID;
+} avdecc_peer_t;
+
+typedef struct {
+	int				h;					// client handle, AVB_ENDPOINT_HANDLE_INVALID if unused
+	clientRole_t	role;
+	U16				uniqueID;			// ACMP talker or listener unique ID
+
+	// Talker: listeners connected to the stream
+	avdecc_peer_t	listeners[AVDECC_MAX_LISTENERS];
+	U16				nListeners;
+
+	// Listener: CONNECT_TX_RESPONSE of the talker connected to
+	bool			bConnected;
+	U8				connection[ACMP_PDU_LEN];
+
+	// Listener: CONNECT_RX being passed on to a talker
+	bool			bPending;
+	U8				pendingCmd[ACMP_PDU_LEN];
+	U16				pendingSeqID;
+	U8				pendingRetries;
+	U64				pendingDueNS;
+} avdecc_client_t;
+
+static const U8 x_avdeccMcast[ETH_ALEN] = { 0x91, 0xE0, 0xF0, 0x01, 0x00, 0x00 };
+
+static bool				x_bEnabled;
+static int				x_sock = -1;
+static U8				x_ifmac[ETH_ALEN];
+static U64				x_entityID;
+static U64				x_entityModelID;
+static U32				x_validTime;			// seconds
+static U32				x_availableIndex;
+static U64				x_adpDueNS;				// next ENTITY_AVAILABLE, 0 for right away
+static U16				x_acmpSeqID;			// for the commands sent to talkers
+static avdecc_client_t	x_clients[AVDECC_MAX_CLIENTS];
+static U8				x_rxFrame[AVDECC_FRAME_MAX];
+
+static void x_acmpRx(const U8 *pPdu);
+
+static U64 x_nowNS(void)
+{
+	U64 nowNS = 0;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_MONOTONIC, &nowNS);
+	return nowNS;
+}
+
+static U16 x_get16(const U8 *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static U64 x_get64(const U8 *p)
+{
+	U64 v = 0;
+	int i;
+	for (i = 0; i < 8; i++) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static void x_put16(U8 *p, U16 v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static void x_put32(U8 *p, U32 v)
+{
+	x_put16(p, v >> 16);
+	x_put16(p + 2, v);
+}
+
+static void x_put64(U8 *p, U64 v)
+{
+	x_put32(p, v >> 32);
+	x_put32(p + 4, v);
+}
+
+static void x_getStreamID(const U8 *p, AVBStreamID_t *streamID)
+{
+	memcpy(streamID->addr, p, ETH_ALEN);
+	streamID->uniqueID = x_get16(p + ETH_ALEN);
+}
+
+static void x_putStreamID(U8 *p, const AVBStreamID_t *streamID)
+{
+	memcpy(p, streamID->addr, ETH_ALEN);
+	x_put16(p + ETH_ALEN, streamID->uniqueID);
+}
+
+static void x_setHdr(U8 *pPdu, U8 subtype, U8 msgType, U8 status, U16 dataLen, U64 id)
+{
+	pPdu[0] = AVDECC_CD | subtype;
+	pPdu[1] = msgType & 0x0F;
+	x_put16(pPdu + 2, (status << 11) | (dataLen & 0x07FF));
+	x_put64(pPdu + 4, id);
+}
+
+// Turns a received PDU into a response, or into another message
+static void x_setMsgType(U8 *pPdu, U8 msgType, U8 status)
+{
+	pPdu[1] = (pPdu[1] & 0xF0) | (msgType & 0x0F);
+	x_put16(pPdu + 2, (status << 11) | (x_get16(pPdu + 2) & 0x07FF));
+}
+
+static void x_avdeccSend(const U8 destAddr[ETH_ALEN], const U8 *pPdu, U32 pduLen)
+{
+	U8 frame[AVDECC_FRAME_MAX];
+	U32 len = AVDECC_ETH_HDR_LEN + pduLen;
+
+	if (len > sizeof(frame)) {
+		return;
+	}
+	memcpy(frame, destAddr, ETH_ALEN);
+	memcpy(frame + ETH_ALEN, x_ifmac, ETH_ALEN);
+	x_put16(frame + 2 * ETH_ALEN, AVDECC_ETHERTYPE);
+	memcpy(frame + AVDECC_ETH_HDR_LEN, pPdu, pduLen);
+	if (len < AVDECC_FRAME_MIN) {
+		memset(frame + len, 0, AVDECC_FRAME_MIN - len);
+		len = AVDECC_FRAME_MIN;
+	}
+	x_avdeccSockSend(x_sock, frame, len);
+}
+
+static avdecc_client_t *x_findClient(clientRole_t role, U16 uniqueID)
+{
+	int i;
+	for (i = 0; i < AVDECC_MAX_CLIENTS; i++) {
+		if (x_clients[i].h != AVB_ENDPOINT_HANDLE_INVALID
+			&& x_clients[i].role == role && x_clients[i].uniqueID == uniqueID) {
+			return &x_clients[i];
+		}
+	}
+	return NULL;
+}
+
+static avdecc_client_t *x_findClientByHandle(int h)
+{
+	int i;
+	for (i = 0; i < AVDECC_MAX_CLIENTS; i++) {
+		if (x_clients[i].h == h) {
+			return &x_clients[i];
+		}
+	}
+	return NULL;
+}
+
+// Current stream of a client, if it has one
+static clientStream_t *x_clientStream(int h)
+{
+	clientStream_t *ps;
+	for (ps = x_streamList; ps != NULL; ps = ps->next) {
+		if (ps->clientHandle == h) {
+			return ps;
+		}
+	}
+	return NULL;
+}
+
+
+/*************************************************************
+ * ADP
+ */
+
+static void x_adpSend(U8 msgType)
+{
+	U8 pdu[ADP_PDU_LEN];
+	U16 nSources = 0, nSinks = 0;
+	int i;
+
+	// Unique IDs are handed out from 0, so the highest one in use sets the count
+	for (i = 0; i < AVDECC_MAX_CLIENTS; i++) {
+		avdecc_client_t *pc = &x_clients[i];
+		if (pc->h == AVB_ENDPOINT_HANDLE_INVALID) {
+			continue;
+		}
+		if (pc->role == clientTalker && pc->uniqueID >= nSources) {
+			nSources = pc->uniqueID + 1;
+		}
+		else if (pc->role == clientListener && pc->uniqueID >= nSinks) {
+			nSinks = pc->uniqueID + 1;
+		}
+	}
+
+	memset(pdu, 0, sizeof(pdu));
+	x_setHdr(pdu, AVDECC_SUBTYPE_ADP, msgType, x_validTime / 2, ADP_PDU_LEN - AVDECC_HDR_LEN, x_entityID);
+	x_put64(pdu + ADP_ENTITY_MODEL_ID, x_entityModelID);
+	x_put32(pdu + ADP_ENTITY_CAPABILITIES, ADP_ENTITY_CAP_CLASS_A | ADP_ENTITY_CAP_CLASS_B | ADP_ENTITY_CAP_GPTP);
+	x_put16(pdu + ADP_TALKER_STREAM_SOURCES, nSources);
+	x_put16(pdu + ADP_TALKER_CAPABILITIES, nSources ? ADP_STREAM_CAP_IMPLEMENTED | ADP_STREAM_CAP_AUDIO : 0);
+	x_put16(pdu + ADP_LISTENER_STREAM_SINKS, nSinks);
+	x_put16(pdu + ADP_LISTENER_CAPABILITIES, nSinks ? ADP_STREAM_CAP_IMPLEMENTED | ADP_STREAM_CAP_AUDIO : 0);
+	if (msgType == ADP_ENTITY_AVAILABLE) {
+		x_put32(pdu + ADP_AVAILABLE_INDEX, x_availableIndex++);
+	}
+	x_avdeccSend(x_avdeccMcast, pdu, ADP_PDU_LEN);
+}
+
+static void x_adpRx(const U8 *pPdu)
+{
+	U64 entityID = x_get64(pPdu + ADP_ENTITY_ID);
+
+	if ((pPdu[1] & 0x0F) == ADP_ENTITY_DISCOVER
+		&& (entityID == 0 || entityID == x_entityID)) {
+		x_adpDueNS = 0;
+	}
+}
+
+
+/*************************************************************
+ * AECP
+ */
+
+static void x_aecpRx(const U8 *pPdu, U32 pduLen, const U8 *srcAddr)
+{
+	U8 rsp[AVDECC_FRAME_MAX - AVDECC_ETH_HDR_LEN];
+	U8 msgType = pPdu[1] & 0x0F;
+	U8 status = AECP_STATUS_NOT_IMPLEMENTED;
+
+	// Only commands (even message types) addressed to us are answered
+	if (x_get64(pPdu + AECP_TARGET_ENTITY_ID) != x_entityID || (msgType & 1)) {
+		return;
+	}
+
+	if (msgType == AECP_AEM_COMMAND && pduLen >= AECP_AEM_HDR_LEN
+		&& (x_get16(pPdu + AECP_COMMAND_TYPE) & 0x7FFF) == AEM_CMD_ENTITY_AVAILABLE) {
+		status = AECP_STATUS_SUCCESS;
+	}
+	AVB_LOGF_DEBUG("AECP message type %u from "ETH_FORMAT", status %u", msgType, ETH_OCTETS(srcAddr), status);
+
+	// The response carries the command's payload back
+	memcpy(rsp, pPdu, pduLen);
+	x_setMsgType(rsp, msgType + 1, status);
+	x_avdeccSend(srcAddr, rsp, pduLen);
+}
+
+
+/*************************************************************
+ * ACMP
+ */
+
+static void x_acmpSend(const U8 *pPdu)
+{
+	U8 msgType = pPdu[1] & 0x0F;
+
+	x_avdeccSend(x_avdeccMcast, pPdu, ACMP_PDU_LEN);
+
+	// Our own frames do not come back from the socket; commands for our
+	// talkers and their responses to our listeners are handled right here
+	if (((msgType == ACMP_CONNECT_TX_COMMAND || msgType == ACMP_DISCONNECT_TX_COMMAND)
+			&& x_get64(pPdu + ACMP_TALKER_ENTITY_ID) == x_entityID)
+		|| ((msgType == ACMP_CONNECT_TX_RESPONSE || msgType == ACMP_DISCONNECT_TX_RESPONSE)
+			&& x_get64(pPdu + ACMP_LISTENER_ENTITY_ID) == x_entityID)) {
+		x_acmpRx(pPdu);
+	}
+}
+
+// Stream ID, destination address and VLAN of a connection
+static void x_acmpCopyStream(U8 *pDst, const U8 *pSrc)
+{
+	memcpy(pDst + ACMP_STREAM_ID, pSrc + ACMP_STREAM_ID, 8);
+	memcpy(pDst + ACMP_STREAM_DEST_MAC, pSrc + ACMP_STREAM_DEST_MAC, ETH_ALEN);
+	memcpy(pDst + ACMP_STREAM_VLAN_ID, pSrc + ACMP_STREAM_VLAN_ID, 2);
+}
+
+// Returns 1 if the listener was added, 0 if it was connected already, -1 if there is no room
+static int x_talkerAddListener(avdecc_client_t *pc, U64 entityID, U16 uniqueID)
+{
+	int i;
+	for (i = 0; i < pc->nListeners; i++) {
+		if (pc->listeners[i].entityID == entityID && pc->listeners[i].uniqueID == uniqueID) {
+			return 0;
+		}
+	}
+	if (pc->nListeners >= AVDECC_MAX_LISTENERS) {
+		return -1;
+	}
+	pc->listeners[pc->nListeners].entityID = entityID;
+	pc->listeners[pc->nListeners].uniqueID = uniqueID;
+	pc->nListeners++;
+	return 1;
+}
+
+static bool x_talkerRemoveListener(avdecc_client_t *pc, U64 entityID, U16 uniqueID)
+{
+	int i;
+	for (i = 0; i < pc->nListeners; i++) {
+		if (pc->listeners[i].entityID == entityID && pc->listeners[i].uniqueID == uniqueID) {
+			pc->listeners[i] = pc->listeners[--pc->nListeners];
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void x_acmpTalkerCmd(const U8 *pPdu, U8 msgType)
+{
+	U8 rsp[ACMP_PDU_LEN];
+	U8 status = ACMP_STATUS_SUCCESS;
+	U64 listenerID = x_get64(pPdu + ACMP_LISTENER_ENTITY_ID);
+	U16 listenerUID = x_get16(pPdu + ACMP_LISTENER_UNIQUE_ID);
+	avdecc_client_t *pc = x_findClient(clientTalker, x_get16(pPdu + ACMP_TALKER_UNIQUE_ID));
+	clientStream_t *ps = pc ? x_clientStream(pc->h) : NULL;
+
+	if (!pc) {
+		status = ACMP_STATUS_TALKER_UNKNOWN_ID;
+	}
+	else if (msgType == ACMP_CONNECT_TX_COMMAND) {
+		int added = ps ? x_talkerAddListener(pc, listenerID, listenerUID) : -1;
+		if (added < 0) {
+			status = ACMP_STATUS_STATE_UNAVAILABLE;
+		}
+		else if (added && pc->nListeners == 1) {
+			// First listener; the stream has been waiting in warm standby
+			openavbEptSrvrNotifyOfAcmpCb(pc->h, &ps->streamID, ps->destAddr, TRUE);
+		}
+	}
+	else if (msgType == ACMP_DISCONNECT_TX_COMMAND) {
+		if (!x_talkerRemoveListener(pc, listenerID, listenerUID)) {
+			status = ACMP_STATUS_NOT_CONNECTED;
+		}
+		else if (pc->nListeners == 0 && ps) {
+			openavbEptSrvrNotifyOfAcmpCb(pc->h, &ps->streamID, ps->destAddr, FALSE);
+		}
+	}
+	else if (msgType != ACMP_GET_TX_STATE_COMMAND) {
+		status = ACMP_STATUS_NOT_SUPPORTED;
+	}
+
+	AVB_LOGF_DEBUG("ACMP talker %u command %u from listener %016" PRIx64 "/%u, status %u",
+		x_get16(pPdu + ACMP_TALKER_UNIQUE_ID), msgType, listenerID, listenerUID, status);
+
+	memcpy(rsp, pPdu, ACMP_PDU_LEN);
+	if (ps) {
+		U16 flags = x_get16(pPdu + ACMP_FLAGS) & ~ACMP_FLAG_CLASS_B;
+		if (ps->srClass == SR_CLASS_B) {
+			flags |= ACMP_FLAG_CLASS_B;
+		}
+		x_putStreamID(rsp + ACMP_STREAM_ID, &ps->streamID);
+		memcpy(rsp + ACMP_STREAM_DEST_MAC, ps->destAddr, ETH_ALEN);
+		x_put16(rsp + ACMP_STREAM_VLAN_ID, ps->vlanID);
+		x_put16(rsp + ACMP_FLAGS, flags);
+	}
+	x_put16(rsp + ACMP_CONNECTION_COUNT, pc ? pc->nListeners : 0);
+	x_setMsgType(rsp, msgType + 1, status);
+	x_acmpSend(rsp);
+}
+
+// Passes the pending CONNECT_RX on to the talker
+static void x_acmpConnectTalker(avdecc_client_t *pc, U64 nowNS)
+{
+	U8 cmd[ACMP_PDU_LEN];
+
+	memcpy(cmd, pc->pendingCmd, ACMP_PDU_LEN);
+	x_setMsgType(cmd, ACMP_CONNECT_TX_COMMAND, ACMP_STATUS_SUCCESS);
+	x_put16(cmd + ACMP_SEQUENCE_ID, pc->pendingSeqID);
+	// Set before sending; a talker of our own answers at once
+	pc->pendingDueNS = nowNS + (U64)ACMP_CONNECT_TX_TIMEOUT_MSEC * NANOSECONDS_PER_MSEC;
+	x_acmpSend(cmd);
+}
+
+static void x_acmpDisconnectTalker(avdecc_client_t *pc, bool bNotify)
+{
+	U8 cmd[ACMP_PDU_LEN];
+
+	memcpy(cmd, pc->connection, ACMP_PDU_LEN);
+	x_setMsgType(cmd, ACMP_DISCONNECT_TX_COMMAND, ACMP_STATUS_SUCCESS);
+	x_put16(cmd + ACMP_SEQUENCE_ID, x_acmpSeqID++);
+	pc->bConnected = FALSE;
+
+	if (bNotify) {
+		AVBStreamID_t streamID;
+		x_getStreamID(pc->connection + ACMP_STREAM_ID, &streamID);
+		openavbEptSrvrNotifyOfAcmpCb(pc->h, &streamID, pc->connection + ACMP_STREAM_DEST_MAC, FALSE);
+	}
+	x_acmpSend(cmd);
+}
+
+static void x_acmpListenerCmd(const U8 *pPdu, U8 msgType)
+{
+	U8 rsp[ACMP_PDU_LEN];
+	U8 status = ACMP_STATUS_SUCCESS;
+	avdecc_client_t *pc = x_findClient(clientListener, x_get16(pPdu + ACMP_LISTENER_UNIQUE_ID));
+
+	AVB_LOGF_DEBUG("ACMP listener %u command %u for talker %016" PRIx64 "/%u",
+		x_get16(pPdu + ACMP_LISTENER_UNIQUE_ID), msgType,
+		x_get64(pPdu + ACMP_TALKER_ENTITY_ID), x_get16(pPdu + ACMP_TALKER_UNIQUE_ID));
+
+	memcpy(rsp, pPdu, ACMP_PDU_LEN);
+	if (!pc) {
+		status = ACMP_STATUS_LISTENER_UNKNOWN_ID;
+	}
+	else if (msgType == ACMP_CONNECT_RX_COMMAND) {
+		if (pc->bConnected
+			&& (x_get64(pc->connection + ACMP_TALKER_ENTITY_ID) != x_get64(pPdu + ACMP_TALKER_ENTITY_ID)
+				|| x_get16(pc->connection + ACMP_TALKER_UNIQUE_ID) != x_get16(pPdu + ACMP_TALKER_UNIQUE_ID))) {
+			status = ACMP_STATUS_LISTENER_EXCLUSIVE;
+		}
+		else {
+			// Answered when the talker responds (or a repeated command replaces it)
+			memcpy(pc->pendingCmd, pPdu, ACMP_PDU_LEN);
+			pc->bPending = TRUE;
+			pc->pendingRetries = 0;
+			pc->pendingSeqID = x_acmpSeqID++;
+			x_acmpConnectTalker(pc, x_nowNS());
+			return;
+		}
+	}
+	else if (msgType == ACMP_DISCONNECT_RX_COMMAND) {
+		if (!pc->bConnected) {
+			status = ACMP_STATUS_NOT_CONNECTED;
+		}
+		else {
+			x_acmpCopyStream(rsp, pc->connection);
+			x_acmpDisconnectTalker(pc, TRUE);
+		}
+	}
+	else if (msgType == ACMP_GET_RX_STATE_COMMAND) {
+		if (pc->bConnected) {
+			x_acmpCopyStream(rsp, pc->connection);
+			memcpy(rsp + ACMP_TALKER_ENTITY_ID, pc->connection + ACMP_TALKER_ENTITY_ID, 8);
+			x_put16(rsp + ACMP_TALKER_UNIQUE_ID, x_get16(pc->connection + ACMP_TALKER_UNIQUE_ID));
+		}
+		x_put16(rsp + ACMP_CONNECTION_COUNT, pc->bConnected ? 1 : 0);
+	}
+	else {
+		status = ACMP_STATUS_NOT_SUPPORTED;
+	}
+
+	x_setMsgType(rsp, msgType + 1, status);
+	x_acmpSend(rsp);
+}
+
+// A talker answered a CONNECT_TX we sent for one of our listeners
+static void x_acmpListenerTxResponse(const U8 *pPdu, U8 msgType)
+{
+	U8 rsp[ACMP_PDU_LEN];
+	U8 status = x_get16(pPdu + 2) >> 11;
+	avdecc_client_t *pc = x_findClient(clientListener, x_get16(pPdu + ACMP_LISTENER_UNIQUE_ID));
+
+	// Disconnects were answered without waiting for the talker
+	if (msgType != ACMP_CONNECT_TX_RESPONSE || !pc || !pc->bPending
+		|| x_get16(pPdu + ACMP_SEQUENCE_ID) != pc->pendingSeqID) {
+		return;
+	}
+	pc->bPending = FALSE;
+
+	memcpy(rsp, pc->pendingCmd, ACMP_PDU_LEN);
+	x_acmpCopyStream(rsp, pPdu);
+	memcpy(rsp + ACMP_CONNECTION_COUNT, pPdu + ACMP_CONNECTION_COUNT, 2);
+	memcpy(rsp + ACMP_FLAGS, pPdu + ACMP_FLAGS, 2);
+	x_setMsgType(rsp, ACMP_CONNECT_RX_COMMAND + 1, status);
+
+	if (status == ACMP_STATUS_SUCCESS) {
+		AVBStreamID_t streamID;
+		x_getStreamID(pPdu + ACMP_STREAM_ID, &streamID);
+		AVB_LOGF_INFO("Listener %u connected to "STREAMID_FORMAT, pc->uniqueID, STREAMID_ARGS(&streamID));
+
+		pc->bConnected = TRUE;
+		memcpy(pc->connection, pPdu, ACMP_PDU_LEN);
+		openavbEptSrvrNotifyOfAcmpCb(pc->h, &streamID, pc->connection + ACMP_STREAM_DEST_MAC, TRUE);
+	}
+	else {
+		AVB_LOGF_WARNING("Listener %u not connected, talker status %u", pc->uniqueID, status);
+	}
+	x_acmpSend(rsp);
+}
+
+static void x_acmpListenerTimeout(avdecc_client_t *pc, U64 nowNS)
+{
+	U8 rsp[ACMP_PDU_LEN];
+
+	if (pc->pendingRetries < ACMP_CONNECT_TX_RETRIES) {
+		pc->pendingRetries++;
+		x_acmpConnectTalker(pc, nowNS);
+		return;
+	}
+
+	AVB_LOGF_WARNING("Listener %u not connected, talker %016" PRIx64 " did not answer",
+		pc->uniqueID, x_get64(pc->pendingCmd + ACMP_TALKER_ENTITY_ID));
+	pc->bPending = FALSE;
+	memcpy(rsp, pc->pendingCmd, ACMP_PDU_LEN);
+	x_setMsgType(rsp, ACMP_CONNECT_RX_COMMAND + 1, ACMP_STATUS_LISTENER_TALKER_TIMEOUT);
+	x_acmpSend(rsp);
+}
+
+static void x_acmpRx(const U8 *pPdu)
+{
+	U8 msgType = pPdu[1] & 0x0F;
+
+	switch (msgType) {
+		case ACMP_CONNECT_TX_COMMAND:
+		case ACMP_DISCONNECT_TX_COMMAND:
+		case ACMP_GET_TX_STATE_COMMAND:
+		case ACMP_GET_TX_CONNECTION_COMMAND:
+			if (x_get64(pPdu + ACMP_TALKER_ENTITY_ID) == x_entityID) {
+				x_acmpTalkerCmd(pPdu, msgType);
+			}
+			break;
+		case ACMP_CONNECT_RX_COMMAND:
+		case ACMP_DISCONNECT_RX_COMMAND:
+		case ACMP_GET_RX_STATE_COMMAND:
+			if (x_get64(pPdu + ACMP_LISTENER_ENTITY_ID) == x_entityID) {
+				x_acmpListenerCmd(pPdu, msgType);
+			}
+			break;
+		case ACMP_CONNECT_TX_RESPONSE:
+		case ACMP_DISCONNECT_TX_RESPONSE:
+			if (x_get64(pPdu + ACMP_LISTENER_ENTITY_ID) == x_entityID) {
+				x_acmpListenerTxResponse(pPdu, msgType);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+
+/*************************************************************
+ * Frames
+ */
+
+static void x_avdeccRx(const U8 *pFrame, U32 len)
+{
+	const U8 *pPdu = pFrame + AVDECC_ETH_HDR_LEN;
+	U32 pduLen;
+
+	if (len < AVDECC_ETH_HDR_LEN + AVDECC_HDR_LEN) {
+		return;
+	}
+	// Ignore the Ethernet padding
+	pduLen = AVDECC_HDR_LEN + (x_get16(pPdu + 2) & 0x07FF);
+	if (pduLen > len - AVDECC_ETH_HDR_LEN) {
+		return;
+	}
+
+	switch (pPdu[0]) {
+		case AVDECC_CD | AVDECC_SUBTYPE_ADP:
+			if (pduLen >= ADP_PDU_LEN) {
+				x_adpRx(pPdu);
+			}
+			break;
+		case AVDECC_CD | AVDECC_SUBTYPE_AECP:
+			if (pduLen >= AECP_AEM_HDR_LEN - 2) {
+				x_aecpRx(pPdu, pduLen, pFrame + ETH_ALEN);
+			}
+			break;
+		case AVDECC_CD | AVDECC_SUBTYPE_ACMP:
+			if (pduLen >= ACMP_PDU_LEN) {
+				x_acmpRx(pPdu);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+
+/*************************************************************
+ * Endpoint interface
+ */
+
+bool openavbAvdeccInitialize(openavb_endpoint_cfg_t *pCfg)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVDECC);
+	int i;
+
+	x_bEnabled = FALSE;
+	if (!pCfg->avdecc_enabled) {
+		AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+		return TRUE;
+	}
+
+	memcpy(x_ifmac, pCfg->ifmac, ETH_ALEN);
+	x_entityID = pCfg->avdecc_entity_id;
+	if (!x_entityID) {
+		// EUI-64 from the interface MAC
+		U8 eui64[8] = { x_ifmac[0], x_ifmac[1], x_ifmac[2], 0xFF, 0xFE, x_ifmac[3], x_ifmac[4], x_ifmac[5] };
+		x_entityID = x_get64(eui64);
+	}
+	x_entityModelID = pCfg->avdecc_entity_model_id;
+	x_validTime = pCfg->avdecc_valid_time;
+	x_availableIndex = 0;
+	x_adpDueNS = 0;
+	for (i = 0; i < AVDECC_MAX_CLIENTS; i++) {
+		memset(&x_clients[i], 0, sizeof(x_clients[i]));
+		x_clients[i].h = AVB_ENDPOINT_HANDLE_INVALID;
+	}
+
+	x_sock = x_avdeccSockOpen(pCfg->ifindex, AVDECC_ETHERTYPE, x_avdeccMcast);
+	if (x_sock < 0) {
+		AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+		return FALSE;
+	}
+	x_bEnabled = TRUE;
+
+	AVB_LOGF_INFO("Entity %016" PRIx64 " on %s, valid time %u s", x_entityID, pCfg->ifname, x_validTime);
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+	return TRUE;
+}
+
+void openavbAvdeccFinalize(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVDECC);
+
+	if (x_bEnabled) {
+		x_adpSend(ADP_ENTITY_DEPARTING);
+		x_avdeccSockClose(x_sock);
+		x_sock = -1;
+		x_bEnabled = FALSE;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+}
+
+int openavbAvdeccGetSocket(void)
+{
+	return x_bEnabled ? x_sock : -1;
+}
+
+int openavbAvdeccTimeoutMsec(int maxMsec)
+{
+	U64 dueNS, nowNS, msec;
+	int i;
+
+	if (!x_bEnabled) {
+		return maxMsec;
+	}
+
+	dueNS = x_adpDueNS;
+	for (i = 0; i < AVDECC_MAX_CLIENTS; i++) {
+		if (x_clients[i].h != AVB_ENDPOINT_HANDLE_INVALID && x_clients[i].bPending
+			&& x_clients[i].pendingDueNS < dueNS) {
+			dueNS = x_clients[i].pendingDueNS;
+		}
+	}
+
+	nowNS = x_nowNS();
+	if (dueNS <= nowNS) {
+		return 0;
+	}
+	msec = (dueNS - nowNS + NANOSECONDS_PER_MSEC - 1) / NANOSECONDS_PER_MSEC;
+	return msec < (U64)maxMsec ? (int)msec : maxMsec;
+}
+
+void openavbAvdeccService(bool bRxReady)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVDECC);
+	U64 nowNS;
+	int i;
+
+	if (!x_bEnabled) {
+		AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+		return;
+	}
+
+	// Level triggered; whatever is left over wakes the next call
+	for (i = 0; bRxReady && i < AVDECC_RX_BATCH; i++) {
+		int len = x_avdeccSockRecv(x_sock, x_rxFrame, sizeof(x_rxFrame));
+		if (len <= 0) {
+			break;
+		}
+		x_avdeccRx(x_rxFrame, len);
+	}
+
+	nowNS = x_nowNS();
+	if (nowNS >= x_adpDueNS) {
+		x_adpSend(ADP_ENTITY_AVAILABLE);
+		x_adpDueNS = nowNS + (U64)x_validTime * NANOSECONDS_PER_SECOND / 4;
+	}
+
+	for (i = 0; i < AVDECC_MAX_CLIENTS; i++) {
+		if (x_clients[i].h != AVB_ENDPOINT_HANDLE_INVALID && x_clients[i].bPending
+			&& nowNS >= x_clients[i].pendingDueNS) {
+			x_acmpListenerTimeout(&x_clients[i], nowNS);
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+}
+
+void openavbAvdeccStreamAdded(clientStream_t *ps)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVDECC);
+	avdecc_client_t *pc = NULL;
+	U16 uniqueID = 0;
+	int i;
+
+	// A client that already has a unique ID is being moved to another stream
+	if (!x_bEnabled || !ps || x_findClientByHandle(ps->clientHandle)) {
+		AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+		return;
+	}
+
+	for (i = 0; i < AVDECC_MAX_CLIENTS; i++) {
+		if (x_clients[i].h == AVB_ENDPOINT_HANDLE_INVALID) {
+			pc = &x_clients[i];
+			break;
+		}
+	}
+	if (!pc) {
+		AVB_LOGF_WARNING("No room for stream "STREAMID_FORMAT"; it can't be connected by a controller",
+			STREAMID_ARGS(&ps->streamID));
+		AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+		return;
+	}
+	while (x_findClient(ps->role, uniqueID)) {
+		uniqueID++;
+	}
+
+	memset(pc, 0, sizeof(*pc));
+	pc->h = ps->clientHandle;
+	pc->role = ps->role;
+	pc->uniqueID = uniqueID;
+	AVB_LOGF_INFO("%s %u is stream "STREAMID_FORMAT, ps->role == clientTalker ? "Talker" : "Listener",
+		uniqueID, STREAMID_ARGS(&ps->streamID));
+
+	// Warm standby until a controller connects the stream
+	openavbEptSrvrNotifyOfAcmpCb(ps->clientHandle, &ps->streamID, ps->destAddr, FALSE);
+
+	// Announce the new stream count
+	x_adpDueNS = 0;
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+}
+
+void openavbAvdeccClientGone(int h)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_AVDECC);
+
+	avdecc_client_t *pc = x_bEnabled ? x_findClientByHandle(h) : NULL;
+	if (pc) {
+		// A pending connect is left for the controller to time out
+		if (pc->role == clientListener && pc->bConnected) {
+			x_acmpDisconnectTalker(pc, FALSE);
+		}
+		pc->h = AVB_ENDPOINT_HANDLE_INVALID;
+		x_adpDueNS = 0;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_AVDECC);
+}
@@ -0,0 +1,70 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* HEADER SUMMARY : AVDECC entity of the endpoint
+*
+* With [avdecc] enabled the endpoint is an IEEE 1722.1 entity for the
+* whole device: it advertises itself with ADP and answers ACMP for the
+* streams of its clients. Streams are registered or attached as usual and
+* then wait paused (warm standby) until a controller connects them, so a
+* connect only has to resume a stream that already has its reservation.
+*/
+
+#ifndef OPENAVB_ENDPOINT_AVDECC_H
+#define OPENAVB_ENDPOINT_AVDECC_H
+
+#include "openavb_endpoint.h"
+
+// Opens the AVDECC socket. Returns TRUE without doing anything if the
+// entity is not enabled in the configuration.
+bool openavbAvdeccInitialize(openavb_endpoint_cfg_t *pCfg);
+
+// Announces that the entity departs and closes the socket
+void openavbAvdeccFinalize(void);
+
+// Socket to wait on for AVDECC frames, or -1 if the entity is disabled
+int openavbAvdeccGetSocket(void);
+
+// Milliseconds until openavbAvdeccService() has timed work to do,
+// at most maxMsec
+int openavbAvdeccTimeoutMsec(int maxMsec);
+
+// Handles the received frames (if bRxReady) and the work that is due
+void openavbAvdeccService(bool bRxReady);
+
+// A client registered (talker) or attached (listener) a stream. The first
+// stream of a client gets an ACMP unique ID, and is paused.
+void openavbAvdeccStreamAdded(clientStream_t *ps);
+
+// A client closed its connection to the endpoint
+void openavbAvdeccClientGone(int h);
+
+#endif // OPENAVB_ENDPOINT_AVDECC_H
@@ -99,6 +99,12 @@ static bool openavbEptClntReceiveFromServer(int h, openavbEndpointMessage_t *msg
 		case OPENAVB_ENDPOINT_VERSION_CALLBACK:
 			openavbEptClntCheckVerMatchesSrvr(h, msg->params.versionCallback.AVBVersion);
 			break;
+		case OPENAVB_ENDPOINT_ACMP_CALLBACK:
+			openavbEptClntNotifyOfAcmpCb(h,
+			                            &msg->streamID,
+			                             msg->params.acmpCallback.destAddr,
+			                             msg->params.acmpCallback.connect);
+			break;
 		default:
 			AVB_LOG_ERROR("Client receive: unexpected message");
 			AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
@@ -184,6 +190,27 @@ bool openavbEptClntStopStream(int h, AVBStreamID_t *streamID)
 	return ret;
 }
  
+bool openavbEptClntSendStats(int h, AVBStreamID_t *streamID, openavb_hist_summary_t hist[TL_HIST_COUNT])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
+	openavbEndpointMessage_t msgBuf;
+
+	if (!streamID || !hist) {
+		AVB_LOG_ERROR("Client stats: invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
+		return FALSE;
+	}
+
+	memset(&msgBuf, 0, OPENAVB_ENDPOINT_MSG_LEN);
+	msgBuf.type = OPENAVB_ENDPOINT_CLIENT_STATS;
+	memcpy(&(msgBuf.streamID), streamID, sizeof(AVBStreamID_t));
+	memcpy(msgBuf.params.clientStats.hist, hist, sizeof(msgBuf.params.clientStats.hist));
+	bool ret = openavbEptClntSendToServer(h, &msgBuf);
+
+	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
+	return ret;
+}
+
 bool openavbEptClntRequestVersionFromServer(int h)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
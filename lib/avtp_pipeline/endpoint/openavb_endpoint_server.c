@@ -56,6 +56,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_log.h"
 #include "openavb_qmgr.h"  // for INVALID_FWMARK
 #include "openavb_maap.h"
+#include "openavb_endpoint_avdecc.h"
 
 // forward declarations
 static bool openavbEptSrvrReceiveFromClient(int h, openavbEndpointMessage_t *msg);
@@ -101,6 +102,10 @@ static bool openavbEptSrvrReceiveFromClient(int h, openavbEndpointMessage_t *msg
 			AVB_LOG_DEBUG("Version request from client");
 			ret = openavbEptSrvrHndlVerRqstFromClient(h);
 			break;
+		case OPENAVB_ENDPOINT_CLIENT_STATS:
+			AVB_LOGF_VERBOSE("Stats from client uid=%d", msg->streamID.uniqueID);
+			ret = openavbEptSrvrClientStats(h, &msg->streamID, msg->params.clientStats.hist);
+			break;
 		default:
 			AVB_LOG_ERROR("Unexpected message received at server");
 			break;
@@ -182,6 +187,30 @@ void openavbEptSrvrNotifyLstnrOfSrpCb(int h,
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
 }
 
+void openavbEptSrvrNotifyOfAcmpCb(int h,
+                              AVBStreamID_t *streamID,
+                              U8 destAddr[],
+                              bool connect)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
+	openavbEndpointMessage_t  msgBuf;
+
+	if (!streamID || !destAddr) {
+		AVB_LOG_ERROR("ACMP callback; invalid argument passed");
+		AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
+		return;
+	}
+
+	memset(&msgBuf, 0, OPENAVB_ENDPOINT_MSG_LEN);
+	msgBuf.type = OPENAVB_ENDPOINT_ACMP_CALLBACK;
+	memcpy(&(msgBuf.streamID), streamID, sizeof(AVBStreamID_t));
+	memcpy(msgBuf.params.acmpCallback.destAddr, destAddr, ETH_ALEN);
+	msgBuf.params.acmpCallback.connect = connect;
+	openavbEptSrvrSendToClient(h, &msgBuf);
+
+	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
+}
+
 void openavbEptSrvrSendServerVersionToClient(int h, U32 AVBVersion)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
@@ -230,10 +259,13 @@ bool openavbEptSrvrRegisterStream(int h,
 	ps->latency = latency;
 	ps->fwmark = INVALID_FWMARK;
 
+	// Before SRP, so that the stream already starts out paused
+	openavbAvdeccStreamAdded(ps);
+
 	if (memcmp(ps->destAddr, destAddr, ETH_ALEN) == 0) {
 		// no client-supplied address, use MAAP
 		struct ether_addr addr;
-		ps->hndMaap = openavbMaapAllocate(1, &addr);
+		setStreamMaap(ps, openavbMaapAllocate(1, &addr));
 		if (ps->hndMaap) {
 			memcpy(ps->destAddr, addr.ether_addr_octet, ETH_ALEN);
 			strmAttachCb((void*)ps, openavbSrp_LDSt_Stream_Info);		// Inform talker about MAAP
@@ -248,7 +280,7 @@ bool openavbEptSrvrRegisterStream(int h,
 	else {
 		// client-supplied destination MAC address
 		memcpy(ps->destAddr, destAddr, ETH_ALEN);
-		ps->hndMaap = NULL;
+		setStreamMaap(ps, NULL);
 	}
 
 	// Do SRP talker register
@@ -310,6 +342,7 @@ bool openavbEptSrvrAttachStream(int h,
 			return FALSE;
 		}
 		ps->role = clientListener;
+		openavbAvdeccStreamAdded(ps);
 	}
 
 	if(x_cfg.noSrp) {
@@ -360,6 +393,33 @@ bool openavbEptSrvrStopStream(int h, AVBStreamID_t *streamID)
 	return rc;
 }
 
+/* Client (talker or listener) reporting its latency histograms
+ */
+bool openavbEptSrvrClientStats(int h, AVBStreamID_t *streamID, openavb_hist_summary_t hist[TL_HIST_COUNT])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
+
+	clientStream_t *ps = findStream(streamID);
+	if (!ps || ps->clientHandle != h) {
+		AVB_LOGF_ERROR("Error storing client stats: missing record for stream %d", streamID->uniqueID);
+		AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
+		return FALSE;
+	}
+
+	memcpy(ps->hist, hist, sizeof(ps->hist));
+
+	int i1;
+	for (i1 = 0; i1 < TL_HIST_COUNT; i1++) {
+		if (hist[i1].count) {
+			AVB_LOGF_DEBUG("Stream %d hist %d: count=%" PRIu64 ", p50=%u, p99=%u, p99.9=%u, max=%u ns",
+				streamID->uniqueID, i1, hist[i1].count, hist[i1].p50, hist[i1].p99, hist[i1].p999, hist[i1].max);
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
+	return TRUE;
+}
+
 /* Client version request
  */
 bool openavbEptSrvrHndlVerRqstFromClient(int h)
@@ -378,6 +438,8 @@ void openavbEptSrvrCloseClientConnection(int h)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
 
+	openavbAvdeccClientGone(h);
+
 	clientStream_t **lpp;
 	for(lpp = &x_streamList; *lpp != NULL; lpp = &(*lpp)->next) {
 		if ((*lpp)->clientHandle == h)
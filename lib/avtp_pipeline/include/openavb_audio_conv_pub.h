@@ -0,0 +1,124 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Audio sample format conversion kernels
+*/
+
+#ifndef OPENAVB_AUDIO_CONV_PUB_H
+#define OPENAVB_AUDIO_CONV_PUB_H 1
+
+#include "openavb_types_pub.h"
+#include "openavb_audio_pub.h"
+
+/** \file
+ * Sample format conversions between the host order used by interface modules
+ * and the network order carried in AVTP payloads.
+ *
+ * Each kernel converts \a count samples. Source and destination do not need to
+ * be aligned. The byte swap kernels may be used in place (pDst == pSrc); the
+ * AM824 kernels change the sample size and must not overlap. An SSE2, AVX2 or
+ * NEON version is selected the first time a kernel is used, with a scalar
+ * fallback for everything else.
+ *
+ * 24 bit packed samples are 3 bytes, least significant byte first, as used by
+ * the ALSA S24_3LE format.
+ */
+
+/** Byte swap 16 bit samples (int16 host <-> network order).
+ */
+void openavbAudioConvSwap16(void *pDst, const void *pSrc, U32 count);
+
+/** Byte swap 24 bit packed samples (3 bytes each).
+ */
+void openavbAudioConvSwap24(void *pDst, const void *pSrc, U32 count);
+
+/** Byte swap 32 bit samples (int32, float or 24 in 32 bit host <-> network order).
+ */
+void openavbAudioConvSwap32(void *pDst, const void *pSrc, U32 count);
+
+/** Convert host order int16 samples to IEC 61883-6 AM824 quadlets.
+ *
+ * \param pDst Network order quadlets
+ * \param pSrc Host order int16 samples
+ * \param count Number of samples
+ * \param label AM824 label already shifted into bits 31..24
+ */
+void openavbAudioConvInt16ToAM824(void *pDst, const void *pSrc, U32 count, U32 label);
+
+/** Convert 24 bit packed samples to IEC 61883-6 AM824 quadlets.
+ *
+ * \param pDst Network order quadlets
+ * \param pSrc 24 bit packed samples
+ * \param count Number of samples
+ * \param label AM824 label already shifted into bits 31..24
+ */
+void openavbAudioConvInt24ToAM824(void *pDst, const void *pSrc, U32 count, U32 label);
+
+/** Convert IEC 61883-6 AM824 quadlets to host order int16 samples.
+ */
+void openavbAudioConvAM824ToInt16(void *pDst, const void *pSrc, U32 count);
+
+/** Convert IEC 61883-6 AM824 quadlets to 24 bit packed samples.
+ */
+void openavbAudioConvAM824ToInt24(void *pDst, const void *pSrc, U32 count);
+
+/** Mix float samples into an accumulator: pAcc[i] += pSrc[i] * gain.
+ *
+ * Used to sum several streams before converting the result to the output
+ * format, which clips it.
+ *
+ * \param pAcc Host order float accumulator
+ * \param pSrc Host order float samples
+ * \param gain Linear gain applied to pSrc
+ * \param count Number of samples
+ */
+void openavbAudioMixF32(float *pAcc, const float *pSrc, float gain, U32 count);
+
+/** A conversion kernel returned by openavbAudioConvSelect().
+ */
+typedef void (*openavb_audio_conv_fn_t)(void *pDst, const void *pSrc, U32 count);
+
+/** Select the kernel converting samples from one format to another.
+ *
+ * Formats are 16, 24 (packed) and 32 bit int and 32 bit float, in either
+ * byte order; AVB_AUDIO_ENDIAN_UNSPEC stands for the host order. Each pair of
+ * formats has its own kernel, so picking it once at init leaves no per-sample
+ * format test in the copy. Identical formats get a plain copy and formats
+ * that only differ in byte order get the byte swap kernel. Int samples are
+ * scaled by their full range to and from float, which is clipped to
+ * [-1.0, 1.0). Narrower ints keep the most significant bits.
+ *
+ * \return The kernel, or NULL if a format isn't supported
+ */
+openavb_audio_conv_fn_t openavbAudioConvSelect(avb_audio_type_t srcType, avb_audio_bit_depth_t srcBitDepth, avb_audio_endian_t srcEndian,
+	avb_audio_type_t dstType, avb_audio_bit_depth_t dstBitDepth, avb_audio_endian_t dstEndian);
+
+#endif // OPENAVB_AUDIO_CONV_PUB_H
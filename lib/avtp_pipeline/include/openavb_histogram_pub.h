@@ -0,0 +1,154 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Log-linear latency histograms
+*/
+
+#ifndef OPENAVB_HISTOGRAM_PUB_H
+#define OPENAVB_HISTOGRAM_PUB_H 1
+
+#include "openavb_types_pub.h"
+
+/** \file
+ * Fixed size log-linear histograms for latency values in nanoseconds.
+ *
+ * Values below 2^OPENAVB_HIST_SUB_BITS get a bucket each. Above that each
+ * power of two is split into 2^OPENAVB_HIST_SUB_BITS linear buckets, so the
+ * reported value is within about 6% of the recorded one across the full
+ * U32 range (up to ~4.29 seconds). Larger values land in the last bucket.
+ *
+ * A histogram has a single writer. openavbHistRecord() uses only relaxed
+ * atomic loads and stores, so it never blocks and never takes a lock. Readers
+ * on other threads use openavbHistSnapshot() and may see a record that is
+ * only partly applied; the snapshot is consistent with its own bucket counts.
+ */
+
+/// Number of bits of linear resolution inside each power of two
+#define OPENAVB_HIST_SUB_BITS		4
+/// Number of linear buckets inside each power of two
+#define OPENAVB_HIST_SUB_COUNT		(1 << OPENAVB_HIST_SUB_BITS)
+/// Total number of buckets
+#define OPENAVB_HIST_BUCKETS		((32 - OPENAVB_HIST_SUB_BITS + 1) * OPENAVB_HIST_SUB_COUNT)
+
+/// Latency histogram
+typedef struct {
+	/// Number of values recorded in each bucket
+	U32 bucket[OPENAVB_HIST_BUCKETS];
+	/// Number of values recorded
+	U64 count;
+	/// Sum of all recorded values
+	U64 sum;
+	/// Largest recorded value
+	U32 max;
+} openavb_hist_t;
+
+/// Short form of a histogram that is cheap to pass around
+typedef struct {
+	/// Number of values recorded
+	U64 count;
+	/// Mean value
+	U32 mean;
+	/// 50th percentile
+	U32 p50;
+	/// 99th percentile
+	U32 p99;
+	/// 99.9th percentile
+	U32 p999;
+	/// Largest recorded value
+	U32 max;
+} openavb_hist_summary_t;
+
+/** Bucket index for a value.
+ */
+static inline U32 openavbHistBucket(U32 value)
+{
+	if (value < OPENAVB_HIST_SUB_COUNT) {
+		return value;
+	}
+	U32 msb = 31 - __builtin_clz(value);
+	U32 shift = msb - OPENAVB_HIST_SUB_BITS;
+	return ((shift + 1) << OPENAVB_HIST_SUB_BITS) + ((value >> shift) & (OPENAVB_HIST_SUB_COUNT - 1));
+}
+
+/** Record a value. Must only be called from the thread that owns the histogram.
+ */
+static inline void openavbHistRecord(openavb_hist_t *pHist, U32 value)
+{
+	U32 *pBucket = &pHist->bucket[openavbHistBucket(value)];
+	OPENAVB_ATOMIC_STORE_RELAXED(pBucket, OPENAVB_ATOMIC_LOAD_RELAXED(pBucket) + 1);
+	OPENAVB_ATOMIC_STORE_RELAXED(&pHist->count, OPENAVB_ATOMIC_LOAD_RELAXED(&pHist->count) + 1);
+	OPENAVB_ATOMIC_STORE_RELAXED(&pHist->sum, OPENAVB_ATOMIC_LOAD_RELAXED(&pHist->sum) + value);
+	if (value > OPENAVB_ATOMIC_LOAD_RELAXED(&pHist->max)) {
+		OPENAVB_ATOMIC_STORE_RELAXED(&pHist->max, value);
+	}
+}
+
+/** Record a signed nanosecond delta, clamping it to the U32 range.
+ */
+static inline void openavbHistRecordDelta(openavb_hist_t *pHist, S64 delta)
+{
+	if (delta < 0) {
+		delta = 0;
+	}
+	else if (delta > 0xFFFFFFFFLL) {
+		delta = 0xFFFFFFFFLL;
+	}
+	openavbHistRecord(pHist, (U32)delta);
+}
+
+/** Clear a histogram.
+ *
+ * Only safe when the writer is not recording at the same time.
+ */
+void openavbHistReset(openavb_hist_t *pHist);
+
+/** Copy a histogram that may be recorded into concurrently.
+ *
+ * \param pHist The histogram to read.
+ * \param pSnap Receives the copy. The count is recomputed from the copied
+ * buckets.
+ */
+void openavbHistSnapshot(const openavb_hist_t *pHist, openavb_hist_t *pSnap);
+
+/** Value at a percentile of a histogram snapshot.
+ *
+ * \param pHist The snapshot to read.
+ * \param percentile Percentile from 0.0 to 100.0.
+ * \return Upper bound of the bucket holding the percentile, never more than the
+ * largest recorded value. 0 if nothing was recorded.
+ */
+U32 openavbHistPercentile(const openavb_hist_t *pHist, double percentile);
+
+/** Summarize a histogram snapshot.
+ */
+void openavbHistSummarize(const openavb_hist_t *pHist, openavb_hist_summary_t *pSummary);
+
+#endif // OPENAVB_HISTOGRAM_PUB_H
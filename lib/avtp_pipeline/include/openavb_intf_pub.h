@@ -192,6 +192,27 @@ typedef unsigned int (*openavb_intf_get_src_bitrate_t)(media_q_t *pMediaQ);
  */
 typedef void (*openavb_intf_enable_fixed_timestamp)(media_q_t *pMediaQ, bool enable, U32 transmitInterval, U32 batchFactor);
 
+/** Report how far ahead of the wire the talker is.
+ *
+ * Called by the talker at every wake-up, before it pulls frames from the
+ * media queue, with the amount of media already queued for transmit: the
+ * frames waiting in the TX ring, or with launch_lookahead_usec the frames
+ * queued for a future launch time. An interface module can use it to read
+ * its source in bigger chunks while the talker is close to running dry and
+ * in smaller ones while plenty is queued, rather than one media queue item
+ * per transmit callback.
+ *
+ * Not called when the rawsock in use can't report its TX buffer level, nor
+ * with tx_blocking_in_intf.
+ *
+ * \param pMediaQ A pointer to the media queue for this stream
+ * \param aheadUsec Media queued for transmit, in microseconds
+ *
+ * \note This callback is optional, does not need to be implemented in the
+ * interface module.
+ */
+typedef void (*openavb_intf_tx_ahead_cb_t)(media_q_t *pMediaQ, U32 aheadUsec);
+
 /** Interface callbacks structure.
  */
 typedef struct {
@@ -221,6 +242,8 @@ typedef struct {
 	openavb_intf_get_src_bitrate_t  intf_get_src_bitrate_cb;
 	/// Enable fixed timestamp callback
 	openavb_intf_enable_fixed_timestamp intf_enable_fixed_timestamp;
+	/// TX ahead feedback callback
+	openavb_intf_tx_ahead_cb_t		intf_tx_ahead_cb;
 } openavb_intf_cb_t;
 
 /** Main initialization entry point into the interface module.
@@ -0,0 +1,70 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : JPEG marker scanner
+*/
+
+#ifndef OPENAVB_JPEG_SCAN_PUB_H
+#define OPENAVB_JPEG_SCAN_PUB_H 1
+
+#include "openavb_types_pub.h"
+
+/** \file
+ * Search for the JPEG markers that can be found in or around entropy coded
+ * data: SOI (0xFFD8), EOI (0xFFD9) and the restart markers RST0 to RST7
+ * (0xFFD0 to 0xFFD7). Every other 0xFF in entropy coded data is stuffed
+ * (0xFF00) and is skipped.
+ *
+ * The search looks at 16 or 32 bytes per step with an SSE2, AVX2 or NEON
+ * version selected the first time it is used, with a scalar fallback for
+ * everything else.
+ */
+
+#define JPEG_MARKER_RST0	0xD0	///< First restart marker code
+#define JPEG_MARKER_RST7	0xD7	///< Last restart marker code
+#define JPEG_MARKER_SOI		0xD8	///< Start of image marker code
+#define JPEG_MARKER_EOI		0xD9	///< End of image marker code
+
+/** Is this marker code a restart marker.
+ */
+#define JPEG_MARKER_IS_RST(code)	((code) >= JPEG_MARKER_RST0 && (code) <= JPEG_MARKER_RST7)
+
+/** Find the next SOI, EOI or restart marker.
+ *
+ * \param pData Data to search
+ * \param len Number of bytes in pData
+ * \param pos Offset to start the search at
+ * \return Offset of the 0xFF byte of the next marker at or after \a pos, or
+ *         \a len if there is none. The marker code is pData[offset + 1].
+ */
+U32 openavbJpegScanNext(const U8 *pData, U32 len, U32 pos);
+
+#endif // OPENAVB_JPEG_SCAN_PUB_H
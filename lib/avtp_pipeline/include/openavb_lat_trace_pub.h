@@ -0,0 +1,175 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Sampled end-to-end latency trace
+*/
+
+#ifndef OPENAVB_LAT_TRACE_PUB_H
+#define OPENAVB_LAT_TRACE_PUB_H 1
+
+#include <string.h>
+#include "openavb_types_pub.h"
+
+/** \file
+ * Latency trace of sampled AVTP frames.
+ *
+ * Only frames whose AVTP sequence number is a multiple of the sample period
+ * are traced. The period is a power of two no larger than 256, so a talker
+ * and its listeners pick the same frames without any coordination and the
+ * samples can be joined afterwards on stream ID, sequence number and AVTP
+ * timestamp.
+ *
+ * Stage times are gPTP nanoseconds taken with the wall clock; 0 means the
+ * stage was not recorded for the frame.
+ *
+ * Samples go into a ring with a single writer (the stream's thread) and a
+ * single reader. A full ring drops new samples rather than blocking.
+ */
+
+/// Largest sample period; the 8 bit AVTP sequence number wraps at this
+#define OPENAVB_LAT_TRACE_MAX_PERIOD	256
+/// Number of samples a ring holds
+#define OPENAVB_LAT_TRACE_RING_LEN		256
+
+/// Points along the path a traced frame takes
+typedef enum {
+	/// Talker: interface module has put the data in the media queue
+	OPENAVB_LAT_TX_INTF,
+	/// Talker: mapping module has built the AVTP PDU
+	OPENAVB_LAT_TX_MAP,
+	/// Talker: frame handed to the rawsock and sent
+	OPENAVB_LAT_TX_SUBMIT,
+	/// Talker: launch time the frame was queued for (launch_time only)
+	OPENAVB_LAT_TX_LAUNCH,
+	/// Listener: frame fetched from the rawsock
+	OPENAVB_LAT_RX_RAWSOCK,
+	/// Listener: mapping module has put the data in the media queue
+	OPENAVB_LAT_RX_MAP,
+	/// Listener: presentation time carried in the AVTP PDU
+	OPENAVB_LAT_RX_PRESENT,
+	OPENAVB_LAT_STAGE_COUNT
+} openavb_lat_stage_t;
+
+/// One traced frame
+typedef struct {
+	/// Stream ID in network order
+	U8 streamID[8];
+	/// AVTP timestamp field of the PDU (0 if not valid)
+	U32 avtpTimestamp;
+	/// AVTP sequence number
+	U8 seq;
+	/// TRUE when recorded by a talker
+	U8 bTalker;
+	U8 reserved[2];
+	/// Time of each stage, indexed by openavb_lat_stage_t
+	U64 stageNS[OPENAVB_LAT_STAGE_COUNT];
+} openavb_lat_sample_t;
+
+/// Ring of traced frames
+typedef struct {
+	/// Samples written so far; sample n is in ring[n % OPENAVB_LAT_TRACE_RING_LEN]
+	U32 head;
+	/// Samples read so far
+	U32 tail;
+	/// Samples written but not yet published by openavbLatTracePublish()
+	U32 pending;
+	/// Samples dropped because the ring was full
+	U32 dropped;
+	/// Sample period minus one
+	U32 mask;
+	openavb_lat_sample_t ring[OPENAVB_LAT_TRACE_RING_LEN];
+} openavb_lat_ring_t;
+
+/** Is the frame with this sequence number traced?
+ */
+static inline bool openavbLatTraceWanted(const openavb_lat_ring_t *pRing, U8 seq)
+{
+	return pRing && (seq & pRing->mask) == 0;
+}
+
+/** Start a sample. Returns NULL, counting a drop, when the ring is full.
+ * Writer only. The sample is not seen by the reader until published.
+ */
+static inline openavb_lat_sample_t *openavbLatTraceBegin(openavb_lat_ring_t *pRing)
+{
+	U32 n = pRing->head + pRing->pending;
+	if (n - OPENAVB_ATOMIC_LOAD_ACQUIRE(&pRing->tail) >= OPENAVB_LAT_TRACE_RING_LEN) {
+		pRing->dropped++;
+		return NULL;
+	}
+	pRing->pending++;
+	openavb_lat_sample_t *pSample = &pRing->ring[n % OPENAVB_LAT_TRACE_RING_LEN];
+	memset(pSample, 0, sizeof(*pSample));
+	return pSample;
+}
+
+/** Set a stage time on all samples begun but not yet published. Writer only.
+ */
+static inline void openavbLatTraceStamp(openavb_lat_ring_t *pRing, openavb_lat_stage_t stage, U64 nowNS)
+{
+	U32 i;
+	for (i = 0; i < pRing->pending; i++) {
+		pRing->ring[(pRing->head + i) % OPENAVB_LAT_TRACE_RING_LEN].stageNS[stage] = nowNS;
+	}
+}
+
+/** Hand the samples begun so far to the reader. Writer only.
+ */
+static inline void openavbLatTracePublish(openavb_lat_ring_t *pRing)
+{
+	if (pRing->pending) {
+		OPENAVB_ATOMIC_STORE_RELEASE(&pRing->head, pRing->head + pRing->pending);
+		pRing->pending = 0;
+	}
+}
+
+/** Allocate a ring.
+ *
+ * \param period Trace one frame in this many; a power of two up to
+ * OPENAVB_LAT_TRACE_MAX_PERIOD.
+ * \return The ring, or NULL if the period is not valid or memory is short.
+ */
+openavb_lat_ring_t *openavbLatTraceNew(U32 period);
+
+/** Free a ring.
+ */
+void openavbLatTraceDelete(openavb_lat_ring_t *pRing);
+
+/** Take published samples out of a ring. Reader only.
+ *
+ * \param pRing The ring.
+ * \param pSamples Receives the samples, oldest first.
+ * \param max Room in pSamples.
+ * \return Number of samples copied.
+ */
+U32 openavbLatTraceRead(openavb_lat_ring_t *pRing, openavb_lat_sample_t *pSamples, U32 max);
+
+#endif // OPENAVB_LAT_TRACE_PUB_H
@@ -155,6 +155,18 @@ typedef enum {
 	LOG_RT_DATATYPE_FLOAT
 } log_rt_datatype_t;
 
+// Per thread log rings. With OPENAVB_LOG_FROM_THREAD (or OPENAVB_LOG_PULL_MODE) avbLogFn() and
+// avbLogRT() store a binary record, the format pointer plus the raw arguments, in a lock-free
+// ring owned by the calling thread. The records are formatted by the logging thread (or in
+// avbLogGetMsg()). Messages whose format can not be captured are formatted on the calling
+// thread as before. Format strings, tags and file names must be string literals; %s
+// arguments are copied into the record.
+static const bool OPENAVB_LOG_RING = TRUE;
+#define LOG_RING_THREAD_CNT		32		// Threads that can have a ring at the same time
+#define LOG_RING_REC_CNT		64		// Records per ring. Must be a power of 2
+#define LOG_RING_ARG_CNT		16		// Arguments (or RT items) per record
+#define LOG_RING_STR_LEN		192		// Room per record for copies of %s arguments
+
 
 #define LOG_VARX(x, y) x ## y
 #define LOG_VAR(x, y) LOG_VARX(x, y)
@@ -239,6 +251,16 @@ void avbLogRT(int level, bool bBegin, bool bItem, bool bEnd, char *pFormat, log_
 #define AVB_LOGRT_VERBOSE(BEGIN, ITEM, END, FMT, TYPE, VAL)
 #endif	// AVB_LOG_ON
 
+// Debug logging for per-frame code. Same as AVB_LOGF_DEBUG/AVB_LOG_DEBUG except that
+// AVB_FEATURE_PRODUCTION builds drop it, arguments included, whatever AVB_LOG_LEVEL is.
+#if AVB_FEATURE_PRODUCTION
+#define AVB_HOT_LOGF_DEBUG(FMT, ...)
+#define AVB_HOT_LOG_DEBUG(MSG)
+#else
+#define AVB_HOT_LOGF_DEBUG(FMT, ...)  AVB_LOGF_DEBUG(FMT, __VA_ARGS__)
+#define AVB_HOT_LOG_DEBUG(MSG)        AVB_LOG_DEBUG(MSG)
+#endif
+
 // Get a queued log message. Intended to be used with the OPENAVB_LOG_PULL_MODE option. 
 // Message will not be null terminated.
 U32 avbLogGetMsg(U8 *pBuf, U32 bufSize);
@@ -192,6 +192,44 @@ typedef void (*openavb_map_set_src_bitrate_cb_t)(media_q_t *pMediaQ, unsigned in
  */
 typedef unsigned int (*openavb_map_get_max_interval_frames_cb_t)(media_q_t *pMediaQ, SRClassIdx_t sr_class);
 
+/** Get the payload region of the transmit frame.
+ *
+ * Called by the talker before the interface module transmit callback. If the
+ * mapping module places exactly one media queue item in each AVTP frame it may
+ * return where in the frame that data goes. The media queue item is then lent
+ * that region (see openavbMediaQHeadLend()) so the interface module fills the
+ * payload in place and openavb_map_tx_cb_t() does not need to copy it.
+ * \param pMediaQ A pointer to the media queue for this stream
+ * \param[out] pOffset Offset of the payload from the start of the AVTP frame
+ * \param[out] pSize Size of the payload region in bytes
+ * \return TRUE if the payload can be filled in place
+ *
+ * \note This callback is optional, does not need to be implemented in the
+ * mapping module. A mapping module that implements it must skip its copy when
+ * the tail item data is already at the payload position.
+ */
+typedef bool (*openavb_map_tx_payload_cb_t)(media_q_t *pMediaQ, U32 *pOffset, U32 *pSize);
+
+/** Fill a transmit frame with null content.
+ *
+ * Called by the talker when openavb_map_tx_cb_t() returned
+ * TX_CB_RET_PACKET_NOT_READY and the stream is set to keep sending on
+ * underrun (tx_null_on_underrun). The frame carries content a listener plays
+ * as nothing, such as silence for audio or NULL packets for a transport
+ * stream. The mapping module builds that frame once and on each call copies
+ * it in and patches only the timestamp and its own counters, so the cost is
+ * the same whatever the source is doing. The AVTP sequence number is set by
+ * the caller.
+ * \param pMediaQ A pointer to the media queue for this stream
+ * \param pData pointer to data
+ * \param dataLen length of data
+ * \return One of enum \ref tx_cb_ret_t values.
+ *
+ * \note This callback is optional, does not need to be implemented in the
+ * mapping module.
+ */
+typedef tx_cb_ret_t (*openavb_map_tx_null_cb_t)(media_q_t *pMediaQ, U8 *pData, U32 *datalen);
+
 /** Mapping callbacks structure.
  */
 typedef struct {
@@ -225,6 +263,10 @@ typedef struct {
 	openavb_map_set_src_bitrate_cb_t    map_set_src_bitrate_cb;
 	/// Max interval frames callback.
 	openavb_map_get_max_interval_frames_cb_t map_get_max_interval_frames_cb;
+	/// Transmit payload region callback.
+	openavb_map_tx_payload_cb_t			map_tx_payload_cb;
+	/// Transmit null content callback.
+	openavb_map_tx_null_cb_t			map_tx_null_cb;
 } openavb_map_cb_t;
 
 /** Main initialization entry point into the mapping module.
@@ -0,0 +1,60 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* HEADER SUMMARY : Static tracepoints for the frame hot path.
+*
+* With AVB_FEATURE_USDT the probes are USDT (systemtap SDT) markers in the
+* "openavb" provider. A disabled marker is a single nop, so the probes stay
+* in production builds and can be attached with perf, bpftrace or systemtap,
+* e.g. "bpftrace -e 'usdt:./openavb_harness:openavb:avtp_rx_lost { ... }'".
+* Without AVB_FEATURE_USDT they compile to nothing.
+*
+* Arguments should be plain integers or pointers that are already at hand;
+* they are evaluated even when no tracer is attached.
+*/
+
+#ifndef OPENAVB_PROBE_H
+#define OPENAVB_PROBE_H 1
+
+#if AVB_FEATURE_USDT
+#include <sys/sdt.h>
+#define AVB_PROBE1(NAME, A)				DTRACE_PROBE1(openavb, NAME, A)
+#define AVB_PROBE2(NAME, A, B)			DTRACE_PROBE2(openavb, NAME, A, B)
+#define AVB_PROBE3(NAME, A, B, C)		DTRACE_PROBE3(openavb, NAME, A, B, C)
+#define AVB_PROBE4(NAME, A, B, C, D)	DTRACE_PROBE4(openavb, NAME, A, B, C, D)
+#else
+#define AVB_PROBE1(NAME, A)
+#define AVB_PROBE2(NAME, A, B)
+#define AVB_PROBE3(NAME, A, B, C)
+#define AVB_PROBE4(NAME, A, B, C, D)
+#endif
+
+#endif // OPENAVB_PROBE_H
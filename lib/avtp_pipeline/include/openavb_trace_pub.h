@@ -140,6 +140,16 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define AVB_TRACE_LOOP_EXIT(FEATURE)
 #endif
 
+// Tracing for per-frame code. Same as AVB_TRACE_ENTRY/EXIT except that AVB_FEATURE_PRODUCTION
+// builds drop it regardless of AVB_TRACE_ON. Use the AVB_PROBE* tracepoints there instead.
+#if AVB_FEATURE_PRODUCTION
+#define AVB_HOT_TRACE_ENTRY(FEATURE)
+#define AVB_HOT_TRACE_EXIT(FEATURE)
+#else
+#define AVB_HOT_TRACE_ENTRY(FEATURE)	AVB_TRACE_ENTRY(FEATURE)
+#define AVB_HOT_TRACE_EXIT(FEATURE)		AVB_TRACE_EXIT(FEATURE)
+#endif
+
 #ifdef AVB_TRACE_ON
 
 static inline void avbTraceMinimalFn(int featureOn, const char *tag, const char *function, const char *file, int line)
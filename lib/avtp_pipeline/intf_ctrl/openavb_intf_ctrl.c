@@ -344,6 +344,45 @@ extern bool DLL_EXPORT openavbIntfCtrlSendControl(void *pIntfHandle, U8 *pData,
 	return FALSE;
 }
 
+// Host side callback. The commands are queued back to back so the control
+// mapping can pack them into as few frames as map_nv_max_messages allows.
+extern U32 DLL_EXPORT openavbIntfCtrlSendControlVec(void *pIntfHandle, const openavb_intf_ctrl_msg_t *pMsgs, U32 count, U32 usecDelay)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
+
+	media_q_t *pMediaQ = pIntfHandle;
+	U32 sent = 0;
+
+	if (pMediaQ && pMsgs) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return 0;
+		}
+
+		while (sent < count) {
+			media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+			if (!pMediaQItem)
+				break;	// Media queue full
+
+			if (pMediaQItem->itemSize < pMsgs[sent].dataLength) {
+				AVB_LOG_ERROR("Control data too large for media queue.");
+				openavbMediaQHeadUnlock(pMediaQ);
+				break;
+			}
+
+			memcpy(pMediaQItem->pPubData, pMsgs[sent].pData, pMsgs[sent].dataLength);
+			pMediaQItem->dataLen = pMsgs[sent].dataLength;
+			openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+			openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, usecDelay);
+			openavbMediaQHeadPush(pMediaQ);
+			sent++;
+		}
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+	return sent;
+}
+
 // Main initialization entry point into the interface module
 extern bool DLL_EXPORT openavbIntfCtrlInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB)
 {
@@ -371,6 +410,7 @@ extern bool DLL_EXPORT openavbIntfCtrlInitialize(media_q_t *pMediaQ, openavb_int
 		openavbIntfHostCBList.register_receive_control_cb = openavbIntfCtrlRegisterReceiveControlCB;
 		openavbIntfHostCBList.unregister_receive_control_cb = openavbIntfCtrlUnregisterReceiveControlCB;
 		openavbIntfHostCBList.send_control_cb = openavbIntfCtrlSendControl;
+		openavbIntfHostCBList.send_control_vec_cb = openavbIntfCtrlSendControlVec;
 		pIntfCB->intf_host_cb_list = (void *)&openavbIntfHostCBList;
 
 		pPvtData->muxMode = FALSE;
@@ -53,6 +53,19 @@ typedef bool (*openavb_intf_ctrl_unregister_receive_control_fn_t)(void *pIntfHan
 /// Submit a control command for transmission.
 typedef bool (*openavb_intf_ctrl_send_control_fn_t)(void *pIntfHandle, U8 *pData, U32 dataLength, U32 usecDelay);
 
+/// One control command in a vector passed to send_control_vec_cb.
+typedef struct {
+	/// Command data
+	U8 *pData;
+	/// Command length in bytes
+	U32 dataLength;
+} openavb_intf_ctrl_msg_t;
+
+/// Submit several control commands for transmission with the same delay.
+/// Returns the number of leading commands queued; fewer than count means
+/// the media queue filled up or a command was too large.
+typedef U32 (*openavb_intf_ctrl_send_control_vec_fn_t)(void *pIntfHandle, const openavb_intf_ctrl_msg_t *pMsgs, U32 count, U32 usecDelay);
+
 /// Callbacks to control functions
 typedef struct {
 	/// Registering callback function
@@ -61,6 +74,8 @@ typedef struct {
 	openavb_intf_ctrl_unregister_receive_control_fn_t 	unregister_receive_control_cb;
 	/// Submitting control command
 	openavb_intf_ctrl_send_control_fn_t					send_control_cb;
+	/// Submitting a vector of control commands
+	openavb_intf_ctrl_send_control_vec_fn_t				send_control_vec_cb;
 } openavb_intf_host_cb_list_t;
 
 #endif  // OPENAVB_INTF_CTRL_PUB_H
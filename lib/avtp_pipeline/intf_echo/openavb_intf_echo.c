@@ -35,10 +35,19 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 *  a listener it will echo the data to stdout. This is strickly for
 *  testing purposes and is generally intented to work with the Pipe
 *  mapping module.
+*
+* In loopback mode (intf_nv_loopback) a listener and a talker of the same
+* process pair up by name, and every item the listener receives is shared,
+* without copying, into the talker's media queue to be sent straight back.
+* A reference count per item drops when the talker's mapping module pulls
+* it, and the listener gives the item back to its own media queue once it
+* is zero, always from the listener thread.
 */
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_mediaq_pub.h"
@@ -47,6 +56,44 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define	AVB_LOG_COMPONENT	"Echo Interface"
 #include "openavb_log_pub.h" 
 
+#define ECHO_LOOPBACK_NAMESIZE		32
+
+// How long a stopping listener waits for the talker to send out the items it holds
+#define ECHO_LOOPBACK_DRAIN_MSEC	100
+
+typedef struct {
+	media_q_item_t *pItem;
+	// 1 while the talker's media queue holds the item
+	S32 refCount;
+} echo_loopback_item_t;
+
+// A listener and talker paired by intf_nv_loopback
+typedef struct echo_loopback {
+	char name[ECHO_LOOPBACK_NAMESIZE];
+	U32 nUsers;
+
+	// The listener media queue items are taken from
+	media_q_t *pListenerMediaQ;
+
+	// The talker media queue the listener feeds. NULL while the talker isn't streaming.
+	media_q_t *pTalkerMediaQ;
+
+	// Listener items shared with the talker, oldest first. Only the listener
+	// thread changes the list; the talker thread only drops the counts.
+	echo_loopback_item_t *pTaken;
+	int nTakenSlots;
+	int takenFirst;
+	int nTaken;
+
+	// Items not looped back because the talker wasn't streaming or was full
+	U64 dropped;
+
+	struct echo_loopback *pNext;
+} echo_loopback_t;
+
+static echo_loopback_t *gEchoLoopbacks = NULL;
+static pthread_mutex_t gEchoLoopbackLock = PTHREAD_MUTEX_INITIALIZER;
+
 typedef struct {
 	/////////////
 	// Config data
@@ -72,9 +119,17 @@ typedef struct {
 	// Ignore timestamp at listener.
 	bool ignoreTimestamp;
 
+	// intf_nv_loopback: name pairing a listener with the talker it feeds
+	char *pLoopbackName;
+
+	// Keep the received timestamp on looped back items instead of the time they are sent
+	bool loopbackKeepTimestamp;
+
 	/////////////
 	// Variable data
 	/////////////
+	echo_loopback_t *pLoopback;
+
 	// When increment is enable this is the counter
 	U32 Counter;
 
@@ -147,14 +202,155 @@ void openavbIntfEchoCfgCB(media_q_t *pMediaQ, const char *name, const char *valu
 				pPvtData->ignoreTimestamp = (tmp == 1);
 			}
 		}
+		else if (strcmp(name, "intf_nv_loopback") == 0) {
+			if (pPvtData->pLoopbackName)
+				free(pPvtData->pLoopbackName);
+			pPvtData->pLoopbackName = strdup(value);
+		}
+		else if (strcmp(name, "intf_nv_loopback_keep_timestamp") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp == 1) {
+				pPvtData->loopbackKeepTimestamp = (tmp == 1);
+			}
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
+// Find or create the loopback pair of this name and join it
+static echo_loopback_t *x_echoLoopbackJoin(const char *name)
+{
+	echo_loopback_t *pLoopback;
+
+	pthread_mutex_lock(&gEchoLoopbackLock);
+	for (pLoopback = gEchoLoopbacks; pLoopback; pLoopback = pLoopback->pNext) {
+		if (strcmp(pLoopback->name, name) == 0) {
+			break;
+		}
+	}
+	if (!pLoopback && (pLoopback = calloc(1, sizeof(echo_loopback_t))) != NULL) {
+		strncpy(pLoopback->name, name, ECHO_LOOPBACK_NAMESIZE - 1);
+		pLoopback->pNext = gEchoLoopbacks;
+		gEchoLoopbacks = pLoopback;
+	}
+	if (pLoopback) {
+		pLoopback->nUsers++;
+	}
+	pthread_mutex_unlock(&gEchoLoopbackLock);
+	return pLoopback;
+}
+
+static void x_echoLoopbackLeave(echo_loopback_t *pLoopback)
+{
+	echo_loopback_t **ppLoopback;
+
+	pthread_mutex_lock(&gEchoLoopbackLock);
+	if (--pLoopback->nUsers == 0) {
+		for (ppLoopback = &gEchoLoopbacks; *ppLoopback; ppLoopback = &(*ppLoopback)->pNext) {
+			if (*ppLoopback == pLoopback) {
+				*ppLoopback = pLoopback->pNext;
+				break;
+			}
+		}
+		free(pLoopback->pTaken);
+		free(pLoopback);
+	}
+	pthread_mutex_unlock(&gEchoLoopbackLock);
+}
+
+// Called from the talker thread once its mapping module is done with an item
+static void x_echoLoopbackRelease(void *pReleaseArg)
+{
+	echo_loopback_item_t *pTaken = (echo_loopback_item_t *)pReleaseArg;
+	OPENAVB_ATOMIC_FETCH_ADD(&pTaken->refCount, -1);
+}
+
+// Give the oldest taken items back to the listener's media queue while the
+// talker no longer holds them.
+static void x_echoLoopbackGiveBack(media_q_t *pMediaQ, echo_loopback_t *pLoopback)
+{
+	while (pLoopback->nTaken > 0) {
+		echo_loopback_item_t *pTaken = &pLoopback->pTaken[pLoopback->takenFirst];
+
+		if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&pTaken->refCount) > 0) {
+			break;
+		}
+		openavbMediaQTailItemGive(pMediaQ, pTaken->pItem);
+		pTaken->pItem = NULL;
+		pLoopback->takenFirst = (pLoopback->takenFirst + 1) % pLoopback->nTakenSlots;
+		pLoopback->nTaken--;
+	}
+}
+
+// Share the listener's due items into the talker's media queue
+static void x_echoLoopbackRx(media_q_t *pMediaQ, pvt_data_t *pPvtData)
+{
+	echo_loopback_t *pLoopback = pPvtData->pLoopback;
+	media_q_item_t *pItem;
+
+	x_echoLoopbackGiveBack(pMediaQ, pLoopback);
+
+	pthread_mutex_lock(&gEchoLoopbackLock);
+	while (pLoopback->nTaken < pLoopback->nTakenSlots
+		&& (pItem = openavbMediaQTailLock(pMediaQ, pPvtData->ignoreTimestamp)) != NULL) {
+		media_q_t *pTalkerMediaQ = pLoopback->pTalkerMediaQ;
+		media_q_item_t *pHead;
+
+		if (pItem->dataLen == 0) {
+			// An item given back while newer ones were queued comes round empty
+			openavbMediaQTailPull(pMediaQ);
+			continue;
+		}
+		if (!pTalkerMediaQ || (pHead = openavbMediaQHeadLockAttach(pTalkerMediaQ)) == NULL) {
+			pLoopback->dropped++;
+			openavbMediaQTailPull(pMediaQ);
+			continue;
+		}
+		if (!openavbMediaQTailItemTake(pMediaQ, pItem)) {
+			openavbMediaQHeadUnlock(pTalkerMediaQ);
+			openavbMediaQTailUnlock(pMediaQ);
+			break;
+		}
+
+		echo_loopback_item_t *pTaken = &pLoopback->pTaken[(pLoopback->takenFirst + pLoopback->nTaken) % pLoopback->nTakenSlots];
+		pLoopback->nTaken++;
+		pTaken->pItem = pItem;
+		pTaken->refCount = 1;
+		if (openavbMediaQHeadShare(pTalkerMediaQ, pItem, x_echoLoopbackRelease, pTaken)) {
+			if (!pPvtData->loopbackKeepTimestamp) {
+				openavbAvtpTimeSetToWallTime(pHead->pAvtpTime);
+			}
+			openavbMediaQHeadPush(pTalkerMediaQ);
+		}
+		else {
+			pTaken->refCount = 0;
+			openavbMediaQHeadUnlock(pTalkerMediaQ);
+			pLoopback->dropped++;
+		}
+	}
+	pthread_mutex_unlock(&gEchoLoopbackLock);
+
+	x_echoLoopbackGiveBack(pMediaQ, pLoopback);
+}
+
 void openavbIntfEchoGenInitCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return;
+		}
+
+		if (pPvtData->pLoopbackName) {
+			pPvtData->pLoopback = x_echoLoopbackJoin(pPvtData->pLoopbackName);
+			if (!pPvtData->pLoopback) {
+				AVB_LOG_ERROR("Unable to allocate memory for echo loopback.");
+			}
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -175,6 +371,20 @@ void openavbIntfEchoTxInitCB(media_q_t *pMediaQ)
 
 		if (pPvtData->fixedTimestampEnabled)
 			openavbAvtpTimeSetToWallTime(&pPvtData->walltime);
+
+		if (pPvtData->pLoopback) {
+			// The listener thread pushes to this media queue
+			openavbMediaQThreadSafeOn(pMediaQ);
+
+			pthread_mutex_lock(&gEchoLoopbackLock);
+			if (pPvtData->pLoopback->pTalkerMediaQ) {
+				AVB_LOGF_ERROR("Echo loopback %s already has a talker", pPvtData->pLoopback->name);
+			}
+			else {
+				pPvtData->pLoopback->pTalkerMediaQ = pMediaQ;
+			}
+			pthread_mutex_unlock(&gEchoLoopbackLock);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -192,6 +402,12 @@ bool openavbIntfEchoTxCB(media_q_t *pMediaQ)
 			return FALSE;
 		}
 
+		if (pPvtData->pLoopback) {
+			// The paired listener fills the media queue
+			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+			return FALSE;
+		}
+
 		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
 		if (pMediaQItem) {
 			if (pMediaQItem->itemSize >= pPvtData->increment ? pPvtData->echoStringLen + 16 : pPvtData->echoStringLen) {
@@ -249,6 +465,26 @@ void openavbIntfEchoRxInitCB(media_q_t *pMediaQ)
 		}
 
 		pPvtData->Counter = 0;
+
+		echo_loopback_t *pLoopback = pPvtData->pLoopback;
+		if (pLoopback) {
+			int itemCount, itemSize;
+			pthread_mutex_lock(&gEchoLoopbackLock);
+			if (pLoopback->pListenerMediaQ && pLoopback->pListenerMediaQ != pMediaQ) {
+				AVB_LOGF_ERROR("Echo loopback %s already has a listener", pLoopback->name);
+			}
+			else if (!pLoopback->pTaken) {
+				if (!openavbMediaQGetSize(pMediaQ, &itemCount, &itemSize)
+					|| !(pLoopback->pTaken = calloc(itemCount, sizeof(echo_loopback_item_t)))) {
+					AVB_LOG_ERROR("Unable to allocate echo loopback item list");
+				}
+				else {
+					pLoopback->nTakenSlots = itemCount;
+					pLoopback->pListenerMediaQ = pMediaQ;
+				}
+			}
+			pthread_mutex_unlock(&gEchoLoopbackLock);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -266,6 +502,14 @@ bool openavbIntfEchoRxCB(media_q_t *pMediaQ)
 			return FALSE;
 		}
 
+		if (pPvtData->pLoopback) {
+			if (pPvtData->pLoopback->pListenerMediaQ == pMediaQ) {
+				x_echoLoopbackRx(pMediaQ, pPvtData);
+			}
+			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+			return FALSE;
+		}
+
 		media_q_item_t *pMediaQItem = NULL;
 		while (moreItems) {
 			pMediaQItem = openavbMediaQTailLock(pMediaQ, pPvtData->ignoreTimestamp);
@@ -301,6 +545,37 @@ bool openavbIntfEchoRxCB(media_q_t *pMediaQ)
 void openavbIntfEchoEndCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		echo_loopback_t *pLoopback = pPvtData ? pPvtData->pLoopback : NULL;
+
+		if (pLoopback && pLoopback->pTalkerMediaQ == pMediaQ) {
+			// Items already shared stay in the media queue until pulled
+			pthread_mutex_lock(&gEchoLoopbackLock);
+			pLoopback->pTalkerMediaQ = NULL;
+			pthread_mutex_unlock(&gEchoLoopbackLock);
+		}
+		else if (pLoopback && pLoopback->pListenerMediaQ == pMediaQ) {
+			// Give the talker a moment to send out what it holds before the
+			// listener's media queue, which the items point into, goes away.
+			int i1;
+			for (i1 = 0; i1 < ECHO_LOOPBACK_DRAIN_MSEC && pLoopback->nTaken > 0; i1++) {
+				x_echoLoopbackGiveBack(pMediaQ, pLoopback);
+				if (pLoopback->nTaken > 0) {
+					usleep(1000);
+				}
+			}
+			if (pLoopback->nTaken > 0) {
+				AVB_LOGF_WARNING("Echo loopback %s: talker still holds %d items; stop the talker first",
+					pLoopback->name, pLoopback->nTaken);
+			}
+			if (pLoopback->dropped) {
+				AVB_LOGF_INFO("Echo loopback %s: %llu items not looped back", pLoopback->name,
+					(unsigned long long)pLoopback->dropped);
+				pLoopback->dropped = 0;
+			}
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -319,6 +594,22 @@ void openavbIntfEchoGenEndCB(media_q_t *pMediaQ)
 			free(pPvtData->pEchoString);
 			pPvtData->pEchoString = NULL;
 		}
+
+		if (pPvtData->pLoopback) {
+			echo_loopback_t *pLoopback = pPvtData->pLoopback;
+			pthread_mutex_lock(&gEchoLoopbackLock);
+			if (pLoopback->pListenerMediaQ == pMediaQ) {
+				pLoopback->pListenerMediaQ = NULL;
+				pLoopback->takenFirst = pLoopback->nTaken = 0;
+			}
+			pthread_mutex_unlock(&gEchoLoopbackLock);
+			x_echoLoopbackLeave(pLoopback);
+			pPvtData->pLoopback = NULL;
+		}
+		if (pPvtData->pLoopbackName) {
+			free(pPvtData->pLoopbackName);
+			pPvtData->pLoopbackName = NULL;
+		}
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
@@ -375,6 +666,9 @@ extern bool DLL_EXPORT openavbIntfEchoInitialize(media_q_t *pMediaQ, openavb_int
 		pPvtData->noNewline = FALSE;
 		pPvtData->ignoreTimestamp = FALSE;
 		pPvtData->fixedTimestampEnabled = FALSE;
+		pPvtData->pLoopbackName = NULL;
+		pPvtData->loopbackKeepTimestamp = FALSE;
+		pPvtData->pLoopback = NULL;
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
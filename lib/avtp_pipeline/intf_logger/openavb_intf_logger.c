@@ -30,11 +30,24 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 /*
 * Usage Notes: It is expected that there will be at most only 1 logger
-* interface module running.
+* interface module running as a talker.
+*
+* As a listener the module records the stream to intf_nv_file_name. The RX
+* callback only copies items into one of two write buffers; a writer thread
+* writes full buffers out, so a slow disk never stalls the listener. When
+* both buffers are taken the item is dropped and counted instead. Each item
+* is written as a record with a small header, and start, stop and drop
+* markers travel in-band in the same record stream.
 */
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_mediaq_pub.h"
@@ -43,6 +56,37 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define	AVB_LOG_COMPONENT	"Logger Interface"
 #include "openavb_log_pub.h" 
 
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+// Record header, in host byte order, ahead of every record in the file
+#define LOGGER_REC_MAGIC			0x52425641		// "AVBR"
+#define LOGGER_REC_DATA				0				// Media queue item data
+#define LOGGER_REC_START			1				// Capture started, data is the marker text
+#define LOGGER_REC_STOP				2				// Capture stopped
+#define LOGGER_REC_PAD				3				// Filler up to the next direct I/O block
+
+typedef struct {
+	U32 magic;
+	U16 type;
+	U16 reserved;
+	// Bytes of data following the header
+	U32 len;
+	// Items dropped since the previous record
+	U32 dropped;
+	// AVTP time of a data record, wall time of a marker
+	U64 timeNsec;
+} logger_rec_hdr_t;
+
+// Alignment of the write buffers and, with direct I/O, of every write
+#define LOGGER_IO_ALIGN				4096
+
+typedef struct {
+	U8 *pBuf;
+	U32 len;
+} logger_buf_t;
+
 typedef struct {
 	/////////////
 	// Config data
@@ -50,25 +94,361 @@ typedef struct {
 	// Ignore timestamp at listener.
 	bool ignoreTimestamp;
 
+	// intf_nv_file_name: File the listener records to
+	char *pFileName;
+
+	// intf_nv_buffer_size: Size of each of the two write buffers
+	U32 bufferSize;
+
+	// intf_nv_direct_io: Open the file with O_DIRECT
+	bool directIO;
+
+	// intf_nv_marker: Text carried in the start marker
+	char *pMarker;
+
 	/////////////
 	// Variable data
 	/////////////
+	int fd;
+
+	// Buffer being filled by the listener, and the other one
+	logger_buf_t buf[2];
+	int fillIdx;
+	// The other buffer is queued for or being written by the writer thread
+	bool writeBusy;
+	bool writerStop;
+	bool writerRunning;
+	pthread_t writerThread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	// Items dropped since the last record and in total
+	U32 dropPending;
+	U64 dropped;
+	U64 recorded;
+	// Set once a write fails; nothing more is recorded
+	bool writeFailed;
 } pvt_data_t;
 
+static U64 x_wallTimeNsec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (U64)ts.tv_sec * NANOSECONDS_PER_SECOND + ts.tv_nsec;
+}
+
+static bool x_writeAll(int fd, const U8 *pData, U32 len)
+{
+	while (len > 0) {
+		ssize_t written = write(fd, pData, len);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return FALSE;
+		}
+		pData += written;
+		len -= written;
+	}
+	return TRUE;
+}
+
+static void *x_writerThreadFn(void *pv)
+{
+	pvt_data_t *pPvtData = pv;
+
+	pthread_mutex_lock(&pPvtData->lock);
+	while (TRUE) {
+		while (!pPvtData->writeBusy && !pPvtData->writerStop) {
+			pthread_cond_wait(&pPvtData->cond, &pPvtData->lock);
+		}
+		if (!pPvtData->writeBusy) {
+			break;
+		}
+
+		logger_buf_t *pWrite = &pPvtData->buf[pPvtData->fillIdx ^ 1];
+		pthread_mutex_unlock(&pPvtData->lock);
+
+		bool bOK = x_writeAll(pPvtData->fd, pWrite->pBuf, pWrite->len);
+
+		pthread_mutex_lock(&pPvtData->lock);
+		if (!bOK) {
+			pPvtData->writeFailed = TRUE;
+		}
+		pWrite->len = 0;
+		pPvtData->writeBusy = FALSE;
+		pthread_cond_broadcast(&pPvtData->cond);
+	}
+	pthread_mutex_unlock(&pPvtData->lock);
+
+	return NULL;
+}
+
+// Hand the fill buffer to the writer thread and fill the other one. Returns
+// FALSE, leaving everything as it was, while the other one is still busy.
+static bool x_swapBuffers(pvt_data_t *pPvtData, bool bWait)
+{
+	bool bSwapped = FALSE;
+
+	pthread_mutex_lock(&pPvtData->lock);
+	while (bWait && pPvtData->writeBusy) {
+		pthread_cond_wait(&pPvtData->cond, &pPvtData->lock);
+	}
+	if (!pPvtData->writeBusy) {
+		pPvtData->fillIdx ^= 1;
+		pPvtData->writeBusy = TRUE;
+		pthread_cond_broadcast(&pPvtData->cond);
+		bSwapped = TRUE;
+	}
+	pthread_mutex_unlock(&pPvtData->lock);
+
+	return bSwapped;
+}
+
+// Copy a record into the write buffers. A record that doesn't fit before the
+// writer thread frees the other buffer is dropped rather than waited for.
+static bool x_record(pvt_data_t *pPvtData, U16 type, U64 timeNsec, const void *pData, U32 len, bool bWait)
+{
+	logger_rec_hdr_t hdr;
+	U32 total = sizeof(hdr) + len;
+
+	if (pPvtData->writeFailed || total > pPvtData->bufferSize) {
+		return FALSE;
+	}
+
+	logger_buf_t *pFill = &pPvtData->buf[pPvtData->fillIdx];
+	if (pFill->len + total > pPvtData->bufferSize) {
+		// Top up this buffer so every write is a whole buffer, then carry
+		// on in the other one. Records may span the two.
+		U32 room = pPvtData->bufferSize - pFill->len;
+		bool bFree;
+
+		pthread_mutex_lock(&pPvtData->lock);
+		bFree = !pPvtData->writeBusy;
+		pthread_mutex_unlock(&pPvtData->lock);
+
+		if (!bFree && !bWait) {
+			return FALSE;
+		}
+
+		hdr.magic = LOGGER_REC_MAGIC;
+		hdr.type = type;
+		hdr.reserved = 0;
+		hdr.len = len;
+		hdr.dropped = pPvtData->dropPending;
+		hdr.timeNsec = timeNsec;
+
+		const U8 *pParts[2] = { (const U8 *)&hdr, pData };
+		U32 partLen[2] = { sizeof(hdr), len };
+		int i;
+		for (i = 0; i < 2; i++) {
+			const U8 *pPart = pParts[i];
+			U32 partLeft = partLen[i];
+			while (partLeft > 0) {
+				U32 chunk = partLeft < room ? partLeft : room;
+				memcpy(pFill->pBuf + pFill->len, pPart, chunk);
+				pFill->len += chunk;
+				pPart += chunk;
+				partLeft -= chunk;
+				room -= chunk;
+				if (room == 0) {
+					x_swapBuffers(pPvtData, TRUE);
+					pFill = &pPvtData->buf[pPvtData->fillIdx];
+					room = pPvtData->bufferSize - pFill->len;
+				}
+			}
+		}
+	}
+	else {
+		hdr.magic = LOGGER_REC_MAGIC;
+		hdr.type = type;
+		hdr.reserved = 0;
+		hdr.len = len;
+		hdr.dropped = pPvtData->dropPending;
+		hdr.timeNsec = timeNsec;
+		memcpy(pFill->pBuf + pFill->len, &hdr, sizeof(hdr));
+		if (len) {
+			memcpy(pFill->pBuf + pFill->len + sizeof(hdr), pData, len);
+		}
+		pFill->len += total;
+	}
+
+	pPvtData->dropPending = 0;
+	return TRUE;
+}
+
+static void x_recorderStop(pvt_data_t *pPvtData)
+{
+	if (pPvtData->fd < 0) {
+		return;
+	}
+
+	x_record(pPvtData, LOGGER_REC_STOP, x_wallTimeNsec(), NULL, 0, TRUE);
+
+	if (pPvtData->directIO && (pPvtData->buf[pPvtData->fillIdx].len & (LOGGER_IO_ALIGN - 1))) {
+		// Direct I/O only writes whole blocks, so pad out the last one. The
+		// buffers are whole blocks too, so this holds even if the pad record
+		// runs into the other buffer.
+		static const U8 zeros[LOGGER_IO_ALIGN];
+		U32 len = pPvtData->buf[pPvtData->fillIdx].len + sizeof(logger_rec_hdr_t);
+		U32 padLen = ((len + LOGGER_IO_ALIGN - 1) & ~(LOGGER_IO_ALIGN - 1)) - len;
+		x_record(pPvtData, LOGGER_REC_PAD, 0, zeros, padLen, TRUE);
+	}
+
+	if (pPvtData->buf[pPvtData->fillIdx].len) {
+		x_swapBuffers(pPvtData, TRUE);
+	}
+
+	if (pPvtData->writerRunning) {
+		pthread_mutex_lock(&pPvtData->lock);
+		pPvtData->writerStop = TRUE;
+		pthread_cond_broadcast(&pPvtData->cond);
+		pthread_mutex_unlock(&pPvtData->lock);
+		pthread_join(pPvtData->writerThread, NULL);
+		pPvtData->writerRunning = FALSE;
+	}
+
+	close(pPvtData->fd);
+	pPvtData->fd = -1;
+
+	if (pPvtData->writeFailed) {
+		AVB_LOGF_ERROR("Writing %s failed; the recording is incomplete", pPvtData->pFileName);
+	}
+	AVB_LOGF_INFO("Recorded %" PRIu64 " items, dropped %" PRIu64, pPvtData->recorded, pPvtData->dropped);
+
+	int i;
+	for (i = 0; i < 2; i++) {
+		free(pPvtData->buf[i].pBuf);
+		pPvtData->buf[i].pBuf = NULL;
+		pPvtData->buf[i].len = 0;
+	}
+	pthread_cond_destroy(&pPvtData->cond);
+	pthread_mutex_destroy(&pPvtData->lock);
+}
+
+static bool x_recorderStart(pvt_data_t *pPvtData, media_q_t *pMediaQ)
+{
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	int i;
+
+	// Whole blocks keep every write aligned for direct I/O
+	pPvtData->bufferSize = (pPvtData->bufferSize + LOGGER_IO_ALIGN - 1) & ~(LOGGER_IO_ALIGN - 1);
+	for (i = 0; i < 2; i++) {
+		if (posix_memalign((void **)&pPvtData->buf[i].pBuf, LOGGER_IO_ALIGN, pPvtData->bufferSize) != 0) {
+			pPvtData->buf[i].pBuf = NULL;
+		}
+		pPvtData->buf[i].len = 0;
+	}
+	if (!pPvtData->buf[0].pBuf || !pPvtData->buf[1].pBuf) {
+		AVB_LOG_ERROR("Unable to allocate recording buffers");
+		free(pPvtData->buf[0].pBuf);
+		free(pPvtData->buf[1].pBuf);
+		pPvtData->buf[0].pBuf = pPvtData->buf[1].pBuf = NULL;
+		return FALSE;
+	}
+
+	pPvtData->fd = -1;
+	if (pPvtData->directIO && O_DIRECT) {
+		pPvtData->fd = open(pPvtData->pFileName, flags | O_DIRECT, 0644);
+		if (pPvtData->fd < 0) {
+			AVB_LOGF_WARNING("Unable to open %s for direct I/O; using buffered writes", pPvtData->pFileName);
+		}
+	}
+	if (pPvtData->fd < 0) {
+		pPvtData->directIO = FALSE;
+		pPvtData->fd = open(pPvtData->pFileName, flags, 0644);
+	}
+	if (pPvtData->fd < 0) {
+		AVB_LOGF_ERROR("Unable to open %s: %s", pPvtData->pFileName, strerror(errno));
+		free(pPvtData->buf[0].pBuf);
+		free(pPvtData->buf[1].pBuf);
+		pPvtData->buf[0].pBuf = pPvtData->buf[1].pBuf = NULL;
+		return FALSE;
+	}
+
+	pPvtData->fillIdx = 0;
+	pPvtData->writeBusy = FALSE;
+	pPvtData->writerStop = FALSE;
+	pPvtData->writeFailed = FALSE;
+	pPvtData->dropPending = 0;
+	pPvtData->dropped = 0;
+	pPvtData->recorded = 0;
+	pthread_mutex_init(&pPvtData->lock, NULL);
+	pthread_cond_init(&pPvtData->cond, NULL);
+
+	pPvtData->writerRunning = pthread_create(&pPvtData->writerThread, NULL, x_writerThreadFn, pPvtData) == 0;
+	if (!pPvtData->writerRunning) {
+		AVB_LOG_ERROR("Unable to start the recording writer thread");
+		pthread_cond_destroy(&pPvtData->cond);
+		pthread_mutex_destroy(&pPvtData->lock);
+		close(pPvtData->fd);
+		pPvtData->fd = -1;
+		free(pPvtData->buf[0].pBuf);
+		free(pPvtData->buf[1].pBuf);
+		pPvtData->buf[0].pBuf = pPvtData->buf[1].pBuf = NULL;
+		return FALSE;
+	}
+
+	// The start marker names the capture and its media queue data format
+	char marker[256];
+	int len = snprintf(marker, sizeof(marker), "%s %s",
+		pMediaQ->pMediaQDataFormat ? pMediaQ->pMediaQDataFormat : "",
+		pPvtData->pMarker ? pPvtData->pMarker : "");
+	if (len >= (int)sizeof(marker)) {
+		len = sizeof(marker) - 1;
+	}
+	x_record(pPvtData, LOGGER_REC_START, x_wallTimeNsec(), marker, len, TRUE);
+
+	return TRUE;
+}
 
 // Each configuration name value pair for this mapping will result in this callback being called.
 void openavbIntfLoggerCfgCB(media_q_t *pMediaQ, const char *name, const char *value) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
 	if (pMediaQ) {
-		//char *pEnd;
-		//long tmp;
+		char *pEnd;
+		long tmp;
 
 		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
 		if (!pPvtData) {
 			AVB_LOG_ERROR("Private interface module data not allocated.");
 			return;
 		}
+
+		if (strcmp(name, "intf_nv_ignore_timestamp") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp == 1) {
+				pPvtData->ignoreTimestamp = (tmp == 1);
+			}
+		}
+		else if (strcmp(name, "intf_nv_file_name") == 0) {
+			if (pPvtData->pFileName) {
+				free(pPvtData->pFileName);
+			}
+			pPvtData->pFileName = strdup(value);
+		}
+		else if (strcmp(name, "intf_nv_buffer_size") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp >= LOGGER_IO_ALIGN && tmp <= 0x40000000) {
+				pPvtData->bufferSize = tmp;
+			}
+			else {
+				AVB_LOGF_ERROR("Invalid value: name=%s, value=%s", name, value);
+			}
+		}
+		else if (strcmp(name, "intf_nv_direct_io") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp == 1) {
+				pPvtData->directIO = (tmp == 1);
+			}
+		}
+		else if (strcmp(name, "intf_nv_marker") == 0) {
+			if (pPvtData->pMarker) {
+				free(pPvtData->pMarker);
+			}
+			pPvtData->pMarker = strdup(value);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -137,6 +517,19 @@ bool openavbIntfLoggerTxCB(media_q_t *pMediaQ)
 void openavbIntfLoggerRxInitCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return;
+		}
+
+		if (pPvtData->pFileName) {
+			x_recorderStart(pPvtData, pMediaQ);
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -144,14 +537,52 @@ void openavbIntfLoggerRxInitCB(media_q_t *pMediaQ)
 bool openavbIntfLoggerRxCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
+
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return FALSE;
+		}
+
+		if (pPvtData->fd < 0) {
+			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+			return FALSE;
+		}
+
+		media_q_item_t *pMediaQItem;
+		while ((pMediaQItem = openavbMediaQTailLock(pMediaQ, pPvtData->ignoreTimestamp)) != NULL) {
+			if (pMediaQItem->dataLen) {
+				// Never wait for the disk here; a full buffer costs the item
+				if (x_record(pPvtData, LOGGER_REC_DATA, openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime),
+						pMediaQItem->pPubData, pMediaQItem->dataLen, FALSE)) {
+					pPvtData->recorded++;
+				}
+				else {
+					pPvtData->dropPending++;
+					pPvtData->dropped++;
+				}
+			}
+			openavbMediaQTailPull(pMediaQ);
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
-	return FALSE;
+	return TRUE;
 }
 
 // This callback will be called when the stream is closing. 
 void openavbIntfLoggerEndCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (pPvtData) {
+			x_recorderStop(pPvtData);
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -165,6 +596,15 @@ void openavbIntfLoggerGenEndCB(media_q_t *pMediaQ)
 			AVB_LOG_ERROR("Private interface module data not allocated.");
 			return;
 		}
+
+		if (pPvtData->pFileName) {
+			free(pPvtData->pFileName);
+			pPvtData->pFileName = NULL;
+		}
+		if (pPvtData->pMarker) {
+			free(pPvtData->pMarker);
+			pPvtData->pMarker = NULL;
+		}
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
@@ -194,6 +634,8 @@ extern bool DLL_EXPORT openavbIntfLoggerInitialize(media_q_t *pMediaQ, openavb_i
 		pIntfCB->intf_gen_end_cb = openavbIntfLoggerGenEndCB;
 
 		pPvtData->ignoreTimestamp = FALSE;
+		pPvtData->bufferSize = 1024 * 1024;
+		pPvtData->fd = -1;
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -38,6 +38,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include <stdlib.h>
 #include <string.h>
+#include "openavb_platform_pub.h"
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_mediaq_pub.h"
@@ -53,11 +54,49 @@ typedef struct {
 	// Ignore timestamp at listener.
 	bool ignoreTimestamp;
 
+	// Synthetic load per item: thread CPU time to burn, bytes of a working
+	// set to touch and payload bytes to write (talker) or read (listener).
+	U32 costNsec;
+	U32 touchBytes;
+	U32 payloadSize;
+
+	// Items per second the talker pushes. 0 = one per TX call.
+	U32 itemRate;
+
 	/////////////
 	// Variable data
 	/////////////
+	U8 *pTouch;
+	U32 touchOffset;
+
+	// When the next item is due (itemRate)
+	U64 nextItemNS;
+
+	// Keeps the payload reads from being optimized away
+	U32 sum;
 } pvt_data_t;
 
+// Touch every cache line of the next touchBytes of the working set and burn
+// costNsec of thread CPU time, as a real interface module would per item.
+static void x_nullItemLoad(pvt_data_t *pPvtData)
+{
+	if (pPvtData->pTouch) {
+		volatile U8 *pTouch = pPvtData->pTouch;
+		U32 i1;
+		for (i1 = 0; i1 < pPvtData->touchBytes; i1 += 64) {
+			pTouch[i1]++;
+		}
+	}
+
+	if (pPvtData->costNsec) {
+		U64 startNS, nowNS;
+		CLOCK_GETTIME64(OPENAVB_CLOCK_THREAD_CPUTIME, &startNS);
+		do {
+			CLOCK_GETTIME64(OPENAVB_CLOCK_THREAD_CPUTIME, &nowNS);
+		} while (nowNS - startNS < pPvtData->costNsec);
+	}
+}
+
 
 // Each configuration name value pair for this mapping will result in this callback being called.
 void openavbIntfNullCfgCB(media_q_t *pMediaQ, const char *name, const char *value) 
@@ -80,6 +119,18 @@ void openavbIntfNullCfgCB(media_q_t *pMediaQ, const char *name, const char *valu
 				pPvtData->ignoreTimestamp = (tmp == 1);
 			}
 		}
+		else if (strcmp(name, "intf_nv_cost_nsec") == 0) {
+			pPvtData->costNsec = strtoul(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "intf_nv_touch_bytes") == 0) {
+			pPvtData->touchBytes = strtoul(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "intf_nv_payload_size") == 0) {
+			pPvtData->payloadSize = strtoul(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "intf_nv_item_rate") == 0) {
+			pPvtData->itemRate = strtoul(value, &pEnd, 10);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -88,6 +139,25 @@ void openavbIntfNullCfgCB(media_q_t *pMediaQ, const char *name, const char *valu
 void openavbIntfNullGenInitCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return;
+		}
+
+		if (pPvtData->touchBytes) {
+			// Touched once here so page faults are not counted as item cost
+			pPvtData->pTouch = calloc(1, pPvtData->touchBytes);
+			if (!pPvtData->pTouch) {
+				AVB_LOGF_ERROR("Unable to allocate %u bytes to touch", pPvtData->touchBytes);
+			}
+		}
+		if (pPvtData->costNsec || pPvtData->touchBytes || pPvtData->itemRate) {
+			AVB_LOGF_INFO("Synthetic load: %u ns and %u bytes touched per item, %u byte payload, %u items/sec",
+				pPvtData->costNsec, pPvtData->touchBytes, pPvtData->payloadSize, pPvtData->itemRate);
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -96,6 +166,12 @@ void openavbIntfNullGenInitCB(media_q_t *pMediaQ)
 void openavbIntfNullTxInitCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (pPvtData) {
+			pPvtData->nextItemNS = 0;
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -105,24 +181,50 @@ bool openavbIntfNullTxCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
 	if (pMediaQ) {
-		//pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return FALSE;
+		}
+
+		bool bPushed = FALSE;
+		U64 nowNS = 0;
+		if (pPvtData->itemRate) {
+			CLOCK_GETTIME64(OPENAVB_CLOCK_MONOTONIC, &nowNS);
+			if (!pPvtData->nextItemNS || (S64)(nowNS - pPvtData->nextItemNS) > (S64)NANOSECONDS_PER_SECOND) {
+				// First call, or over a second behind: start over from now
+				pPvtData->nextItemNS = nowNS;
+			}
+		}
+
+		// Without an item rate one item per call, else every item that is due
+		while (!pPvtData->itemRate || (S64)(nowNS - pPvtData->nextItemNS) >= 0) {
+			media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+			if (!pMediaQItem) {
+				break;	// Media queue full
+			}
 
-		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
-		if (pMediaQItem) {
 			openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
-			
-			// Set 1 byte
-			*(U8 *)(pMediaQItem->pPubData) = 0xff;
-			pMediaQItem->dataLen = 1;
-			
+
+			U32 dataLen = pPvtData->payloadSize ? pPvtData->payloadSize : 1;
+			if (dataLen > pMediaQItem->itemSize) {
+				dataLen = pMediaQItem->itemSize;
+			}
+			memset(pMediaQItem->pPubData, 0xff, dataLen);
+			pMediaQItem->dataLen = dataLen;
+			x_nullItemLoad(pPvtData);
+
 			openavbMediaQHeadPush(pMediaQ);
-			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
-			return TRUE;
-		}
-		else {
-			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
-			return FALSE;	// Media queue full
+			bPushed = TRUE;
+
+			if (!pPvtData->itemRate) {
+				break;
+			}
+			pPvtData->nextItemNS += NANOSECONDS_PER_SECOND / pPvtData->itemRate;
 		}
+
+		AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+		return bPushed;
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
 	return FALSE;
@@ -151,6 +253,13 @@ bool openavbIntfNullRxCB(media_q_t *pMediaQ)
 		while (moreItems) {
 			media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, pPvtData->ignoreTimestamp);
 			if (pMediaQItem) {
+				U32 dataLen = pMediaQItem->dataLen < pPvtData->payloadSize ? pMediaQItem->dataLen : pPvtData->payloadSize;
+				const U8 *pData = pMediaQItem->pPubData;
+				U32 i1;
+				for (i1 = 0; i1 < dataLen; i1++) {
+					pPvtData->sum += pData[i1];
+				}
+				x_nullItemLoad(pPvtData);
 				openavbMediaQTailPull(pMediaQ);
 			}
 			else {
@@ -173,6 +282,13 @@ void openavbIntfNullEndCB(media_q_t *pMediaQ)
 void openavbIntfNullGenEndCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (pPvtData) {
+			free(pPvtData->pTouch);
+			pPvtData->pTouch = NULL;
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
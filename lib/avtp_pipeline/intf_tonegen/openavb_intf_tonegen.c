@@ -29,10 +29,12 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 *************************************************************************************************************/
 
 /*
-* MODULE SUMMARY : Tone generator interface module. Talker only.
+* MODULE SUMMARY : Tone generator interface module. Talker, or listener
+* verifying the integrity pattern.
 * 
 * - This interface module generates and audio tone for use with -6 and AAF mappings
-* - Requires an OSAL sin implementation of reasonable performance. 
+* - Samples are copied out of a table holding one encoded period of the tone
+*   (see lib/common/avb_tonegen.h), so generation costs no per-sample math.
 */
 
 #include <stdlib.h>
@@ -47,11 +49,11 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_map_aaf_audio_pub.h"
 #include "openavb_intf_pub.h"
 #include "openavb_mcs.h"
+#include "avb_tonegen.h"
 
 #define	AVB_LOG_COMPONENT	"Tone Gen Interface"
 #include "openavb_log_pub.h"
 
-#define PI 3.14159265358979f
 
 typedef struct {
 	/////////////
@@ -92,6 +94,12 @@ typedef struct {
 	bool fv2Enabled;
 	U32 fv2;
 
+	// intf_nv_phase_step_deg: Phase lead of each channel over the previous one
+	float phaseStepDeg;
+
+	// intf_nv_pattern: Send (or verify) the per channel counter pattern instead of a tone
+	bool patternEnabled;
+
 	/////////////
 	// Variable data
 	/////////////
@@ -105,8 +113,16 @@ typedef struct {
 	// Keeps track of how long before toggling the tone on / off
 	U32 freqCountdown;
 
-	// Ratio precalc
-	float ratio;
+	// Encoded tables for the current frequency and for silence
+	struct avb_tonegen tone;
+	struct avb_tonegen silence;
+
+	// Next (or expected) frame counter of the pattern
+	U32 patternSeq;
+
+	// Pattern frames received and how many of them were bad
+	U64 patternFrames;
+	U64 patternErrors;
 
 	// Index to into the melody string
 	U32 melodyIdx;
@@ -194,6 +210,52 @@ static void xGetMelodyToneAndDuration(char note, char count, U32 *freq, U32 *sam
 	}
 }
 
+// Maps the configured sample format to the generator's encoding.
+static bool xGetFormat(pvt_data_t *pPvtData, avb_tonegen_format *pFormat)
+{
+	if (pPvtData->audioType == AVB_AUDIO_TYPE_INT) {
+		if (pPvtData->audioBitDepth == 32)
+			*pFormat = AVB_TONEGEN_S32_BE;
+		else if (pPvtData->audioBitDepth == 24)
+			*pFormat = AVB_TONEGEN_S24_BE;
+		else if (pPvtData->audioBitDepth == 16)
+			*pFormat = AVB_TONEGEN_S16_BE;
+		else
+			return FALSE;
+		return TRUE;
+	}
+	if (pPvtData->audioType == AVB_AUDIO_TYPE_FLOAT && !pPvtData->patternEnabled) {
+		*pFormat = AVB_TONEGEN_FLOAT_BE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+// Returns the table for the current frequency, rebuilding it if the frequency changed.
+static struct avb_tonegen *xGetTone(pvt_data_t *pPvtData, media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo)
+{
+	struct avb_tonegen *pTone = pPvtData->freq ? &pPvtData->tone : &pPvtData->silence;
+	avb_tonegen_format format;
+	double gain = pPvtData->volume;
+
+	if (pTone->table && pTone->hz == pPvtData->freq)
+		return pTone;
+	avb_tonegen_free(pTone);
+
+	if (!xGetFormat(pPvtData, &format))
+		return NULL;
+	// Integer samples peak at 32000 on a 16 bit scale
+	if (format != AVB_TONEGEN_FLOAT_BE)
+		gain *= 32000.0 / 32768.0;
+
+	if (avb_tonegen_init(pTone, format, pPubMapUncmpAudioInfo->audioRate, pPvtData->freq,
+			pPubMapUncmpAudioInfo->audioChannels - pPvtData->fvChannels, gain,
+			pPvtData->phaseStepDeg * M_PI / 180.0) != 0) {
+		return NULL;
+	}
+	return pTone;
+}
+
 static bool xSupportedMappingFormat(media_q_t *pMediaQ)
 {
 	if (pMediaQ) {
@@ -347,6 +409,14 @@ void openavbIntfToneGenCfgCB(media_q_t *pMediaQ, const char *name, const char *v
 			pPvtData->fvChannels++;
 		}
 
+		else if (strcmp(name, "intf_nv_phase_step_deg") == 0) {
+			pPvtData->phaseStepDeg = strtof(value, &pEnd);
+		}
+
+		else if (strcmp(name, "intf_nv_pattern") == 0) {
+			pPvtData->patternEnabled = (strtol(value, &pEnd, 10) != 0);
+		}
+
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -422,10 +492,17 @@ bool openavbIntfToneGenTxCB(media_q_t *pMediaQ)
 			// Tone on
 			static U32 runningFrameCnt = 0;
 			U32 frameCnt;
-			U32 channelCnt;
+			U32 runCnt;
+			U32 fvBytes = 0;
+			U32 fv1 = htonl(pPvtData->fv1);
+			U32 fv2 = htonl(pPvtData->fv2);
 			U8 *pData = pMediaQItem->pPubData;
 
-			for (frameCnt = 0; frameCnt < pPubMapUncmpAudioInfo->framesPerItem; frameCnt++) {
+			// Fixed values are only written for 32 bit integer samples
+			if (pPvtData->audioType == AVB_AUDIO_TYPE_INT && pPvtData->audioBitDepth == 32)
+				fvBytes = pPvtData->fvChannels * 4;
+
+			for (frameCnt = 0; frameCnt < pPubMapUncmpAudioInfo->framesPerItem; frameCnt += runCnt) {
 
 				// Check for tone on / off toggle
 				if (!pPvtData->freqCountdown) {
@@ -457,60 +534,46 @@ bool openavbIntfToneGenTxCB(media_q_t *pMediaQ)
 							pPvtData->freq = pPvtData->toneHz;
 						}
 					}
-					pPvtData->ratio = (float)pPvtData->freq / (float)pPubMapUncmpAudioInfo->audioRate;
 				}
-				pPvtData->freqCountdown--;
-
-				float value = SIN(2 * PI * (runningFrameCnt++ % pPubMapUncmpAudioInfo->audioRate) * pPvtData->ratio) * pPvtData->volume;
-
-				for (channelCnt = 0; channelCnt < pPubMapUncmpAudioInfo->audioChannels - pPvtData->fvChannels; channelCnt++) {
-					if (pPvtData->audioType == AVB_AUDIO_TYPE_INT) {
-						if (pPvtData->audioBitDepth == 32) {
-							S32 sample32 = (S32)(value * (32000 << 16));
-							S32 tmp32 = htonl(sample32);
-							memcpy(pData, (U8 *)&tmp32, 4);
-							pData += 4;
-						} else if (pPvtData->audioBitDepth == 24) {
-							S32 sample24 = (S32)(value * (32000 << 16));
-							S32 tmp24 = htonl(sample24);
-							memcpy(pData, (U8 *)&tmp24, 3);
-							pData += 3;
-						} else if (pPvtData->audioBitDepth == 16) {
-							S16 sample16 = (S32)(value * 32000);
-							S16 tmp16 = htons(sample16);
-							memcpy(pData, (U8 *)&tmp16, 2);
-							pData += 2;
-						}
-					} else if (pPvtData->audioType == AVB_AUDIO_TYPE_FLOAT) {
-						U32 tmp32f;
-						// value *= .75; // attenuate value
-						memcpy((U8 *)&tmp32f, (U8 *)&value, 4);  // done so no warning with -Wstrict-aliasing
-						tmp32f = htonl(tmp32f);
-						memcpy(pData, (U8 *)&tmp32f, 4);
-						pData += 4;
-					} else {
-						// CORE_TODO
-						AVB_LOG_ERROR("Audio sample size format not implemented yet for tone generator interface module");
-					}
+
+				// Frames left in this item at the current frequency
+				runCnt = pPubMapUncmpAudioInfo->framesPerItem - frameCnt;
+				if (pPvtData->freqCountdown && runCnt > pPvtData->freqCountdown)
+					runCnt = pPvtData->freqCountdown;
+				pPvtData->freqCountdown -= runCnt;
+
+				struct avb_tonegen *pTone = xGetTone(pPvtData, pPubMapUncmpAudioInfo);
+				if (!pTone) {
+					AVB_LOG_ERROR("Audio sample size format not implemented yet for tone generator interface module");
+					break;
 				}
 
-				if (pPvtData->fvChannels > 0) {
-					if (pPvtData->audioType == AVB_AUDIO_TYPE_INT) {
-						if (pPvtData->audioBitDepth == 32) {
-							if (pPvtData->fv1Enabled) {
-								S32 tmp32 = htonl(pPvtData->fv1);
-								memcpy(pData, (U8 *)&tmp32, 4);
-								pData += 4;
-							}
+				if (pPvtData->patternEnabled) {
+					pPvtData->patternSeq = avb_tonegen_pattern(pTone->format, pTone->channels,
+						pPvtData->patternSeq, pData, runCnt, pTone->frame_bytes + fvBytes);
+				}
+				else {
+					avb_tonegen_fill(pTone, runningFrameCnt % pPubMapUncmpAudioInfo->audioRate,
+						pData, runCnt, pTone->frame_bytes + fvBytes);
+				}
 
-							if (pPvtData->fv2Enabled) {
-								S32 tmp32 = htonl(pPvtData->fv2);
-								memcpy(pData, (U8 *)&tmp32, 4);
-								pData += 4;
-							}
+				if (fvBytes > 0) {
+					U8 *pFv = pData + pTone->frame_bytes;
+					U32 i;
+					for (i = 0; i < runCnt; i++, pFv += pTone->frame_bytes + fvBytes) {
+						U8 *p = pFv;
+						if (pPvtData->fv1Enabled) {
+							memcpy(p, (U8 *)&fv1, 4);
+							p += 4;
+						}
+						if (pPvtData->fv2Enabled) {
+							memcpy(p, (U8 *)&fv2, 4);
 						}
 					}
 				}
+
+				pData += runCnt * (pTone->frame_bytes + fvBytes);
+				runningFrameCnt += runCnt;
 			}
 			
 			pMediaQItem->dataLen = pPubMapUncmpAudioInfo->itemSize;
@@ -542,13 +605,64 @@ bool openavbIntfToneGenTxCB(media_q_t *pMediaQ)
 void openavbIntfToneGenRxInitCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ && pMediaQ->pPvtIntfInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData->patternEnabled) {
+			AVB_LOG_WARNING("Listener only verifies the integrity pattern, set intf_nv_pattern = 1");
+		}
+		pPvtData->patternSeq = AVB_TONEGEN_PATTERN_SYNC;
+		pPvtData->patternFrames = 0;
+		pPvtData->patternErrors = 0;
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
-// This callback is called when acting as a listener.
+// This callback is called when acting as a listener. In pattern mode every received
+// frame is checked against the counter pattern the talker sends.
 bool openavbIntfToneGenRxCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
+
+	if (pMediaQ) {
+		media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo = pMediaQ->pPubMapInfo;
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		// Only read when xGetFormat() set it
+		avb_tonegen_format format = AVB_TONEGEN_S16_BE;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return FALSE;
+		}
+
+		bool verify = pPvtData->patternEnabled && xGetFormat(pPvtData, &format);
+		U32 channels = pPubMapUncmpAudioInfo->audioChannels - pPvtData->fvChannels;
+		U32 frameBytes = pPubMapUncmpAudioInfo->audioChannels * (pPvtData->audioBitDepth / 8);
+		bool moreItems = TRUE;
+
+		while (moreItems) {
+			// Presentation time does not matter when only checking content
+			media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+			if (pMediaQItem) {
+				if (verify && frameBytes && pMediaQItem->dataLen) {
+					U32 frames = pMediaQItem->dataLen / frameBytes;
+					U32 errors = avb_tonegen_pattern_check(format, channels, &pPvtData->patternSeq,
+						pMediaQItem->pPubData, frames, frameBytes);
+
+					if (errors && !pPvtData->patternErrors) {
+						AVB_LOGF_WARNING("Pattern mismatch after %" PRIu64 " good frames", pPvtData->patternFrames);
+					}
+					pPvtData->patternFrames += frames;
+					pPvtData->patternErrors += errors;
+				}
+				openavbMediaQTailPull(pMediaQ);
+			}
+			else {
+				moreItems = FALSE;
+			}
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
 	return FALSE;
 }
@@ -558,6 +672,17 @@ bool openavbIntfToneGenRxCB(media_q_t *pMediaQ)
 void openavbIntfToneGenEndCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ && pMediaQ->pPvtIntfInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (pPvtData->patternEnabled && pPvtData->patternFrames) {
+			AVB_LOGF_INFO("Pattern: %" PRIu64 " frames checked, %" PRIu64 " bad",
+				pPvtData->patternFrames, pPvtData->patternErrors);
+		}
+		avb_tonegen_free(&pPvtData->tone);
+		avb_tonegen_free(&pPvtData->silence);
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -575,7 +700,7 @@ void openavbIntfToneGenEnableFixedTimestamp(media_q_t *pMediaQ, bool enabled, U3
 
 		pPvtData->fixedTimestampEnabled = enabled;
 		if (pPvtData->fixedTimestampEnabled) {
-				openavbMcsInit(&pPvtData->mcs, NANOSECONDS_PER_SECOND/transmitInterval);
+				openavbMcsInitFraction(&pPvtData->mcs, NANOSECONDS_PER_SECOND, transmitInterval);
 				AVB_LOG_INFO("Fixed timestamping enabled");
 		}
 
@@ -0,0 +1,483 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+ 
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ 
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+Attributions: The inih library portion of the source code is licensed from 
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt. 
+Complete license and copyright information can be found at 
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Verify interface module.
+* 
+* This interface module is only a listener. It checks the integrity pattern
+* sent by the tone generator interface module (intf_nv_pattern = 1) and
+* collects a histogram of how far ahead of its presentation time each item
+* arrives. Nothing is logged per item; totals are reported periodically and
+* when the stream ends, so it can run on many streams at full rate.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "openavb_platform_pub.h"
+#include "openavb_osal_pub.h"
+#include "openavb_types_pub.h"
+#include "openavb_trace_pub.h"
+#include "openavb_mediaq_pub.h"
+#include "openavb_map_uncmp_audio_pub.h"
+#include "openavb_map_aaf_audio_pub.h"
+#include "openavb_intf_pub.h"
+#include "avb_tonegen.h"
+
+#define	AVB_LOG_COMPONENT	"Verify Interface"
+#include "openavb_log_pub.h" 
+
+#define HIST_BINS 64
+
+typedef struct {
+	/////////////
+	// Config data
+	/////////////
+	// intf_nv_audio_rate
+	avb_audio_rate_t audioRate;
+
+	// intf_nv_audio_bit_depth
+	avb_audio_bit_depth_t audioBitDepth;
+
+	// intf_nv_audio_channels
+	avb_audio_channels_t audioChannels;
+
+	// intf_nv_pattern_channels: Leading channels carrying the pattern, 0 for all
+	U32 patternChannels;
+
+	// intf_nv_hist_min_usec: Lower edge of the first histogram bin
+	S32 histMinUSec;
+
+	// intf_nv_hist_bin_usec: Width of each histogram bin
+	U32 histBinUSec;
+
+	// intf_nv_report_sec: Seconds between reports, 0 to report only at the end
+	U32 reportSec;
+
+	// intf_nv_ignore_timestamp: Take items as they arrive rather than at presentation time
+	bool ignoreTimestamp;
+
+	/////////////
+	// Variable data
+	/////////////
+	avb_tonegen_format format;
+
+	bool formatValid;
+
+	// Next expected pattern frame counter
+	U32 seq;
+
+	// Pattern totals, and the totals at the last report
+	struct avb_tonegen_pattern_stats stats;
+	struct avb_tonegen_pattern_stats reported;
+
+	U64 items;
+
+	U64 noTimestamp;
+
+	// Presentation time minus arrival time, per item
+	U64 hist[HIST_BINS];
+	U64 histUnder;
+	U64 histOver;
+	S64 marginMinNS;
+	S64 marginMaxNS;
+
+	U64 nextReportNS;
+
+} pvt_data_t;
+
+static bool xSupportedMappingFormat(media_q_t *pMediaQ)
+{
+	if (pMediaQ) {
+		if (pMediaQ->pMediaQDataFormat) {
+			if (strcmp(pMediaQ->pMediaQDataFormat, MapUncmpAudioMediaQDataFormat) == 0 || strcmp(pMediaQ->pMediaQDataFormat, MapAVTPAudioMediaQDataFormat) == 0) {
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
+// Margin in usec below which the given fraction of items fell.
+static S64 xPercentileUSec(pvt_data_t *pPvtData, U64 count, double fraction)
+{
+	U64 target = (U64)(count * fraction);
+	U64 seen = pPvtData->histUnder;
+	int i;
+
+	if (seen > target)
+		return pPvtData->histMinUSec;
+	for (i = 0; i < HIST_BINS; i++) {
+		seen += pPvtData->hist[i];
+		if (seen > target)
+			return pPvtData->histMinUSec + (S64)(i + 1) * pPvtData->histBinUSec;
+	}
+	return pPvtData->marginMaxNS / 1000;
+}
+
+static void xReport(pvt_data_t *pPvtData, bool final)
+{
+	struct avb_tonegen_pattern_stats *pNow = &pPvtData->stats;
+	struct avb_tonegen_pattern_stats *pLast = &pPvtData->reported;
+	U64 count = pPvtData->histUnder + pPvtData->histOver;
+	int i;
+
+	for (i = 0; i < HIST_BINS; i++)
+		count += pPvtData->hist[i];
+
+	AVB_LOGF_INFO("Items:%" PRIu64 " Frames:%" PRIu64 " Gaps:%" PRIu64 " (lost %" PRIu64 " frames) Dups:%" PRIu64 " Corrupt:%" PRIu64 " NoTimestamp:%" PRIu64,
+		pPvtData->items, pNow->frames, pNow->gaps, pNow->lost, pNow->dups, pNow->corrupt, pPvtData->noTimestamp);
+
+	if (pNow->gaps != pLast->gaps || pNow->dups != pLast->dups || pNow->corrupt != pLast->corrupt) {
+		AVB_LOGF_ERROR("Media corruption since last report: %" PRIu64 " gaps, %" PRIu64 " dups, %" PRIu64 " corrupt frames",
+			pNow->gaps - pLast->gaps, pNow->dups - pLast->dups, pNow->corrupt - pLast->corrupt);
+	}
+	*pLast = *pNow;
+
+	if (count) {
+		AVB_LOGF_INFO("Margin usec: min %" PRId64 " p0.1 %" PRId64 " p1 %" PRId64 " p50 %" PRId64 " max %" PRId64 " (%" PRIu64 " below %d)",
+			pPvtData->marginMinNS / 1000,
+			xPercentileUSec(pPvtData, count, 0.001),
+			xPercentileUSec(pPvtData, count, 0.01),
+			xPercentileUSec(pPvtData, count, 0.5),
+			pPvtData->marginMaxNS / 1000,
+			pPvtData->histUnder, pPvtData->histMinUSec);
+	}
+
+	if (final && count) {
+		for (i = 0; i < HIST_BINS; i++) {
+			if (pPvtData->hist[i]) {
+				S64 lowUSec = pPvtData->histMinUSec + (S64)i * pPvtData->histBinUSec;
+				AVB_LOGF_INFO("Margin %" PRId64 "..%" PRId64 " usec: %" PRIu64,
+					lowUSec, lowUSec + pPvtData->histBinUSec, pPvtData->hist[i]);
+			}
+		}
+		if (pPvtData->histOver) {
+			AVB_LOGF_INFO("Margin above histogram: %" PRIu64, pPvtData->histOver);
+		}
+	}
+}
+
+// Each configuration name value pair for this mapping will result in this callback being called.
+void openavbIntfVerifyCfgCB(media_q_t *pMediaQ, const char *name, const char *value) 
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ) {
+		char *pEnd;
+		long tmp;
+
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return;
+		}
+
+		media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo;
+		pPubMapUncmpAudioInfo = (media_q_pub_map_uncmp_audio_info_t *)pMediaQ->pPubMapInfo;
+		if (!pPubMapUncmpAudioInfo) {
+			AVB_LOG_ERROR("Public map data for audio info not allocated.");
+			return;
+		}
+
+		if (strcmp(name, "intf_nv_audio_rate") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (tmp >= AVB_AUDIO_RATE_8KHZ && tmp <= AVB_AUDIO_RATE_192KHZ) {
+				pPvtData->audioRate = (avb_audio_rate_t)tmp;
+			}
+			else {
+				AVB_LOG_ERROR("Invalid audio rate configured for intf_nv_audio_rate.");
+				pPvtData->audioRate = AVB_AUDIO_RATE_48KHZ;
+			}
+
+			// Give the audio parameters to the mapping module.
+			if (xSupportedMappingFormat(pMediaQ)) {
+				pPubMapUncmpAudioInfo->audioRate = pPvtData->audioRate;
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_audio_bit_depth") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (tmp == 16 || tmp == 24 || tmp == 32) {
+				pPvtData->audioBitDepth = (avb_audio_bit_depth_t)tmp;
+			}
+			else {
+				AVB_LOG_ERROR("Invalid audio bit depth configured for intf_nv_audio_bit_depth (16, 24 or 32).");
+				pPvtData->audioBitDepth = AVB_AUDIO_BIT_DEPTH_24BIT;
+			}
+
+			// Give the audio parameters to the mapping module.
+			if (xSupportedMappingFormat(pMediaQ)) {
+				pPubMapUncmpAudioInfo->audioBitDepth = pPvtData->audioBitDepth;
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_audio_channels") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (tmp >= AVB_AUDIO_CHANNELS_1) {
+				pPvtData->audioChannels = (avb_audio_channels_t)tmp;
+			}
+			else {
+				AVB_LOG_ERROR("Invalid audio channels configured for intf_nv_audio_channels.");
+				pPvtData->audioChannels = (avb_audio_channels_t)AVB_AUDIO_CHANNELS_2;
+			}
+
+			// Give the audio parameters to the mapping module.
+			if (xSupportedMappingFormat(pMediaQ)) {
+				pPubMapUncmpAudioInfo->audioChannels = pPvtData->audioChannels;
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_pattern_channels") == 0) {
+			pPvtData->patternChannels = strtol(value, &pEnd, 10);
+		}
+
+		else if (strcmp(name, "intf_nv_hist_min_usec") == 0) {
+			pPvtData->histMinUSec = strtol(value, &pEnd, 10);
+		}
+
+		else if (strcmp(name, "intf_nv_hist_bin_usec") == 0) {
+			pPvtData->histBinUSec = strtol(value, &pEnd, 10);
+			if (pPvtData->histBinUSec == 0) {
+				pPvtData->histBinUSec = 100;
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_report_sec") == 0) {
+			pPvtData->reportSec = strtol(value, &pEnd, 10);
+		}
+
+		else if (strcmp(name, "intf_nv_ignore_timestamp") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0') {
+				pPvtData->ignoreTimestamp = (tmp == 1);
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+}
+
+void openavbIntfVerifyGenInitCB(media_q_t *pMediaQ) 
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+}
+
+// No talker functionality in this interface
+void openavbIntfVerifyTxInitCB(media_q_t *pMediaQ) 
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+}
+
+// No talker functionality in this interface
+bool openavbIntfVerifyTxCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
+	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+	return FALSE;
+}
+
+// A call to this callback indicates that this interface module will be
+// a listener. Any listener initialization can be done in this function.
+void openavbIntfVerifyRxInitCB(media_q_t *pMediaQ) 
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return;
+		}
+
+		pPvtData->formatValid = TRUE;
+		if (pPvtData->audioBitDepth == 32)
+			pPvtData->format = AVB_TONEGEN_S32_BE;
+		else if (pPvtData->audioBitDepth == 24)
+			pPvtData->format = AVB_TONEGEN_S24_BE;
+		else if (pPvtData->audioBitDepth == 16)
+			pPvtData->format = AVB_TONEGEN_S16_BE;
+		else
+			pPvtData->formatValid = FALSE;
+
+		if (pPvtData->patternChannels == 0 || pPvtData->patternChannels > pPvtData->audioChannels)
+			pPvtData->patternChannels = pPvtData->audioChannels;
+
+		pPvtData->seq = AVB_TONEGEN_PATTERN_SYNC;
+		memset(&pPvtData->stats, 0, sizeof(pPvtData->stats));
+		memset(&pPvtData->reported, 0, sizeof(pPvtData->reported));
+		memset(pPvtData->hist, 0, sizeof(pPvtData->hist));
+		pPvtData->histUnder = 0;
+		pPvtData->histOver = 0;
+		pPvtData->marginMinNS = 0;
+		pPvtData->marginMaxNS = 0;
+		pPvtData->items = 0;
+		pPvtData->noTimestamp = 0;
+		pPvtData->nextReportNS = 0;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+}
+
+// This callback is called when acting as a listener.
+bool openavbIntfVerifyRxCB(media_q_t *pMediaQ) 
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
+
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private interface module data not allocated.");
+			return FALSE;
+		}
+
+		U32 frameBytes = pPvtData->audioChannels * (pPvtData->audioBitDepth / 8);
+		bool moreItems = TRUE;
+
+		while (moreItems) {
+			media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, pPvtData->ignoreTimestamp);
+			if (!pMediaQItem) {
+				moreItems = FALSE;
+				continue;
+			}
+
+			if (pMediaQItem->dataLen) {
+				U64 presentNS = openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime);
+				bool presentValid = openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime);
+				U64 nowNS;
+
+				openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+				nowNS = openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime);
+
+				if (presentValid) {
+					S64 marginNS = (S64)(presentNS - nowNS);
+					S64 binNS = (S64)pPvtData->histBinUSec * 1000;
+					S64 offNS = marginNS - (S64)pPvtData->histMinUSec * 1000;
+
+					if (pPvtData->items == pPvtData->noTimestamp || marginNS < pPvtData->marginMinNS)
+						pPvtData->marginMinNS = marginNS;
+					if (pPvtData->items == pPvtData->noTimestamp || marginNS > pPvtData->marginMaxNS)
+						pPvtData->marginMaxNS = marginNS;
+
+					if (offNS < 0)
+						pPvtData->histUnder++;
+					else if (offNS / binNS >= HIST_BINS)
+						pPvtData->histOver++;
+					else
+						pPvtData->hist[offNS / binNS]++;
+				}
+				else {
+					pPvtData->noTimestamp++;
+				}
+				pPvtData->items++;
+
+				if (pPvtData->formatValid && frameBytes) {
+					avb_tonegen_pattern_verify(pPvtData->format, pPvtData->patternChannels, &pPvtData->seq,
+						pMediaQItem->pPubData, pMediaQItem->dataLen / frameBytes, frameBytes, &pPvtData->stats);
+				}
+
+				if (pPvtData->reportSec) {
+					if (!pPvtData->nextReportNS) {
+						pPvtData->nextReportNS = nowNS + (U64)pPvtData->reportSec * NANOSECONDS_PER_SECOND;
+					}
+					else if (nowNS >= pPvtData->nextReportNS) {
+						xReport(pPvtData, FALSE);
+						pPvtData->nextReportNS += (U64)pPvtData->reportSec * NANOSECONDS_PER_SECOND;
+					}
+				}
+			}
+			openavbMediaQTailPull(pMediaQ);
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+	return TRUE;
+}
+
+// This callback will be called when the interface needs to be closed. All shutdown should 
+// occur in this function.
+void openavbIntfVerifyEndCB(media_q_t *pMediaQ) 
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ && pMediaQ->pPvtIntfInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		if (pPvtData->items) {
+			xReport(pPvtData, TRUE);
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+}
+
+void openavbIntfVerifyGenEndCB(media_q_t *pMediaQ) 
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+}
+
+// Main initialization entry point into the interface module
+extern DLL_EXPORT bool openavbIntfVerifyInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ) {
+		pMediaQ->pPvtIntfInfo = calloc(1, sizeof(pvt_data_t));		// Memory freed by the media queue when the media queue is destroyed.
+
+		if (!pMediaQ->pPvtIntfInfo) {
+			AVB_LOG_ERROR("Unable to allocate memory for AVTP interface module.");
+			return FALSE;
+		}
+
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+
+		pIntfCB->intf_cfg_cb = openavbIntfVerifyCfgCB;
+		pIntfCB->intf_gen_init_cb = openavbIntfVerifyGenInitCB;
+		pIntfCB->intf_tx_init_cb = openavbIntfVerifyTxInitCB;
+		pIntfCB->intf_tx_cb = openavbIntfVerifyTxCB;
+		pIntfCB->intf_rx_init_cb = openavbIntfVerifyRxInitCB;
+		pIntfCB->intf_rx_cb = openavbIntfVerifyRxCB;
+		pIntfCB->intf_end_cb = openavbIntfVerifyEndCB;
+		pIntfCB->intf_gen_end_cb = openavbIntfVerifyGenEndCB;
+
+		pPvtData->audioRate = AVB_AUDIO_RATE_48KHZ;
+		pPvtData->audioBitDepth = AVB_AUDIO_BIT_DEPTH_24BIT;
+		pPvtData->audioChannels = AVB_AUDIO_CHANNELS_2;
+		pPvtData->patternChannels = 0;
+		pPvtData->histMinUSec = -1000;
+		pPvtData->histBinUSec = 100;
+		pPvtData->reportSec = 10;
+		pPvtData->ignoreTimestamp = TRUE;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+	return TRUE;
+}
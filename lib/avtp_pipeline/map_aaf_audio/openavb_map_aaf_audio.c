@@ -36,6 +36,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include <stdlib.h>
 #include <string.h>
+#include "openavb_platform_pub.h"
 #include "openavb_mcr_hal_pub.h"
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
@@ -43,6 +44,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_mediaq_pub.h"
 #include "openavb_map_pub.h"
 #include "openavb_map_aaf_audio_pub.h"
+#include "openavb_mcs.h"
+#include "openavb_audio_conv_pub.h"
 
 #define	AVB_LOG_COMPONENT	"AAF Mapping"
 #include "openavb_log_pub.h"
@@ -57,6 +60,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // - 1 Byte - TV bit (timestamp valid)
 #define HIDX_AVTP_HIDE7_TV1			1
 
+// - 1 Byte - Sequence number
+#define HIDX_AVTP_SEQ_NUM8			2
+
 // - 1 Byte - TU bit (timestamp uncertain)
 #define HIDX_AVTP_HIDE7_TU1			3
 
@@ -111,6 +117,13 @@ typedef struct {
 	// into the AVTP payload above the minimal needed.
 	U32 packingFactor;
 
+	// Let the interface module fill the AVTP payload in place
+	bool directFill;
+
+	// AAF sample format when it differs from the interface's. 0 = same.
+	avb_audio_type_t aafType;
+	avb_audio_bit_depth_t aafBitDepth;
+
 	// MCR mode
 	avb_audio_mcr_t audioMcr;
 
@@ -119,6 +132,11 @@ typedef struct {
 
 	// MCR clock recovery interval	
 	U32 mcrRecoveryInterval;
+
+	// MCR clock output device, pin and rate
+	char *pMcrClockDevice;
+	U32 mcrClockPin;
+	U32 mcrClockHz;
 	
 	/////////////
 	// Variable data
@@ -130,8 +148,21 @@ typedef struct {
 	U8							aaf_bit_depth;
 	U32 payloadSize;
 
+	// Media queue item bytes and samples for one packet
+	U32 itemPacketSize;
+	U32 packetSamples;
+
+	// Conversion between item samples and AAF samples. NULL when the
+	// interface module provides samples in the AAF format.
+	openavb_audio_conv_fn_t txConv;
+	openavb_audio_conv_fn_t rxConv;
+
 	U8 aaf_event_field;
 
+	// Format info and packet info words of the TX header, in network order
+	U32 txFormatInfo;
+	U32 txPacketInfo;
+
 	bool dataValid;
 
 	U32 intervalCounter;
@@ -140,6 +171,20 @@ typedef struct {
 
 	bool mediaQItemSyncTS;
 
+	// Frames received since the last timestamp pushed to MCR
+	U32 mcrFrames;
+
+	// Timestamps for the packets after the first of a packed item
+	mcs_t packetMcs;
+	U32 packetMcsLeft;
+	// Packet steps not yet taken by packetMcs (sparse mode)
+	U32 packetMcsSkipped;
+	bool packetMcsUncertain;
+
+	// AAF header and silent payload sent when the interface has no data,
+	// built at TX init. Only the timestamp is filled in per packet.
+	U8 *pNullFrame;
+
 } pvt_data_t;
 
 static void x_calculateSizes(media_q_t *pMediaQ)
@@ -189,13 +234,50 @@ static void x_calculateSizes(media_q_t *pMediaQ)
 		}
 		AVB_LOGF_INFO("aaf_rate=%d (%dKhz)", pPvtData->aaf_rate, pPubMapInfo->audioRate);
 
+		// The AAF format follows the interface's unless map_nv_aaf_format
+		// sets one, in which case samples are converted on the way.
+		avb_audio_type_t aafType = pPubMapInfo->audioType;
+		avb_audio_bit_depth_t aafBitDepth = pPubMapInfo->audioBitDepth;
+		pPvtData->txConv = NULL;
+		pPvtData->rxConv = NULL;
+		if (pPvtData->aafBitDepth) {
+			// AAF samples are in network order
+			pPvtData->txConv = openavbAudioConvSelect(pPubMapInfo->audioType, pPubMapInfo->audioBitDepth, pPubMapInfo->audioEndian,
+				pPvtData->aafType, pPvtData->aafBitDepth, AVB_AUDIO_ENDIAN_BIG);
+			pPvtData->rxConv = openavbAudioConvSelect(pPvtData->aafType, pPvtData->aafBitDepth, AVB_AUDIO_ENDIAN_BIG,
+				pPubMapInfo->audioType, pPubMapInfo->audioBitDepth, pPubMapInfo->audioEndian);
+			if (pPvtData->txConv && pPvtData->rxConv) {
+				aafType = pPvtData->aafType;
+				aafBitDepth = pPvtData->aafBitDepth;
+			}
+			else {
+				AVB_LOGF_ERROR("Can't convert %s%d interface samples to map_nv_aaf_format; using the interface format",
+					pPubMapInfo->audioType == AVB_AUDIO_TYPE_FLOAT ? "float" : "int", pPubMapInfo->audioBitDepth);
+				pPvtData->txConv = NULL;
+				pPvtData->rxConv = NULL;
+			}
+		}
+
+		switch (pPubMapInfo->audioBitDepth) {
+			case AVB_AUDIO_BIT_DEPTH_32BIT:
+				pPubMapInfo->itemSampleSizeBytes = 4;
+				break;
+			case AVB_AUDIO_BIT_DEPTH_24BIT:
+				pPubMapInfo->itemSampleSizeBytes = 3;
+				break;
+			case AVB_AUDIO_BIT_DEPTH_16BIT:
+				pPubMapInfo->itemSampleSizeBytes = 2;
+				break;
+			default:
+				break;
+		}
+
 		char *typeStr = "int";
-		if (pPubMapInfo->audioType == AVB_AUDIO_TYPE_FLOAT) {
+		if (aafType == AVB_AUDIO_TYPE_FLOAT) {
 			typeStr = "float";
-			switch (pPubMapInfo->audioBitDepth) {
+			switch (aafBitDepth) {
 				case AVB_AUDIO_BIT_DEPTH_32BIT:
 					pPvtData->aaf_format = AAF_FORMAT_FLOAT_32;
-					pPubMapInfo->itemSampleSizeBytes = 4;
 					pPubMapInfo->packetSampleSizeBytes = 4;
 					pPvtData->aaf_bit_depth = 32;
 					break;
@@ -206,22 +288,19 @@ static void x_calculateSizes(media_q_t *pMediaQ)
 			}
 		}
 		else {
-			switch (pPubMapInfo->audioBitDepth) {
+			switch (aafBitDepth) {
 				case AVB_AUDIO_BIT_DEPTH_32BIT:
 					pPvtData->aaf_format = AAF_FORMAT_INT_32;
-					pPubMapInfo->itemSampleSizeBytes = 4;
 					pPubMapInfo->packetSampleSizeBytes = 4;
 					pPvtData->aaf_bit_depth = 32;
 					break;
 				case AVB_AUDIO_BIT_DEPTH_24BIT:
 					pPvtData->aaf_format = AAF_FORMAT_INT_24;
-					pPubMapInfo->itemSampleSizeBytes = 3;
 					pPubMapInfo->packetSampleSizeBytes = 3;
 					pPvtData->aaf_bit_depth = 24;
 					break;
 				case AVB_AUDIO_BIT_DEPTH_16BIT:
 					pPvtData->aaf_format = AAF_FORMAT_INT_16;
-					pPubMapInfo->itemSampleSizeBytes = 2;
 					pPubMapInfo->packetSampleSizeBytes = 2;
 					pPvtData->aaf_bit_depth = 16;
 					break;
@@ -248,7 +327,7 @@ static void x_calculateSizes(media_q_t *pMediaQ)
 			}
 		}
 		AVB_LOGF_INFO("aaf_format=%d (%s%d)",
-			pPvtData->aaf_format, typeStr, pPubMapInfo->audioBitDepth);
+			pPvtData->aaf_format, typeStr, aafBitDepth);
 
 		// Audio frames per packet
 		pPubMapInfo->framesPerPacket = (pPubMapInfo->audioRate / pPvtData->txInterval);
@@ -274,6 +353,8 @@ static void x_calculateSizes(media_q_t *pMediaQ)
 		pPubMapInfo->framesPerItem = pPubMapInfo->framesPerPacket * pPvtData->packingFactor;
 		pPubMapInfo->itemFrameSizeBytes = pPubMapInfo->itemSampleSizeBytes * pPubMapInfo->audioChannels;
 		pPubMapInfo->itemSize = pPubMapInfo->itemFrameSizeBytes * pPubMapInfo->framesPerItem;
+		pPvtData->itemPacketSize = pPubMapInfo->itemFrameSizeBytes * pPubMapInfo->framesPerPacket;
+		pPvtData->packetSamples = pPubMapInfo->framesPerPacket * pPubMapInfo->audioChannels;
 		AVB_LOGF_INFO("item: sampleSz=%d * channels=%d => frameSz=%d * %d * packing=%d => itemSz=%d",
 			pPubMapInfo->itemSampleSizeBytes,
 			pPubMapInfo->audioChannels,
@@ -323,6 +404,31 @@ void openavbMapAVTPAudioCfgCB(media_q_t *pMediaQ, const char *name, const char *
 				pPvtData->sparseMode = TS_SPARSE_MODE_DISABLED;
 			}
 		}
+		else if (strcmp(name, "map_nv_aaf_format") == 0) {
+			if (strcasecmp(value, "int16") == 0) {
+				pPvtData->aafType = AVB_AUDIO_TYPE_INT;
+				pPvtData->aafBitDepth = AVB_AUDIO_BIT_DEPTH_16BIT;
+			}
+			else if (strcasecmp(value, "int24") == 0) {
+				pPvtData->aafType = AVB_AUDIO_TYPE_INT;
+				pPvtData->aafBitDepth = AVB_AUDIO_BIT_DEPTH_24BIT;
+			}
+			else if (strcasecmp(value, "int32") == 0) {
+				pPvtData->aafType = AVB_AUDIO_TYPE_INT;
+				pPvtData->aafBitDepth = AVB_AUDIO_BIT_DEPTH_32BIT;
+			}
+			else if (strcasecmp(value, "float32") == 0) {
+				pPvtData->aafType = AVB_AUDIO_TYPE_FLOAT;
+				pPvtData->aafBitDepth = AVB_AUDIO_BIT_DEPTH_32BIT;
+			}
+			else {
+				AVB_LOGF_ERROR("Invalid map_nv_aaf_format: %s", value);
+			}
+		}
+		else if (strcmp(name, "map_nv_direct_fill") == 0) {
+			char *pEnd;
+			pPvtData->directFill = (strtol(value, &pEnd, 10) == 1);
+		}
 		else if (strcmp(name, "map_nv_audio_mcr") == 0) {
 			char *pEnd;
 			pPvtData->audioMcr = (avb_audio_mcr_t)strtol(value, &pEnd, 10);
@@ -335,6 +441,19 @@ void openavbMapAVTPAudioCfgCB(media_q_t *pMediaQ, const char *name, const char *
 			char *pEnd;
 			pPvtData->mcrRecoveryInterval = strtol(value, &pEnd, 10);
 		}
+		else if (strcmp(name, "map_nv_mcr_clock_device") == 0) {
+			if (pPvtData->pMcrClockDevice)
+				free(pPvtData->pMcrClockDevice);
+			pPvtData->pMcrClockDevice = strdup(value);
+		}
+		else if (strcmp(name, "map_nv_mcr_clock_pin") == 0) {
+			char *pEnd;
+			pPvtData->mcrClockPin = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_mcr_clock_hz") == 0) {
+			char *pEnd;
+			pPvtData->mcrClockHz = strtol(value, &pEnd, 10);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -421,6 +540,41 @@ void openavbMapAVTPAudioGenInitCB(media_q_t *pMediaQ)
 void openavbMapAVTPAudioTxInitCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		media_q_pub_map_aaf_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return;
+		}
+		if (pPubMapInfo->audioRate) {
+			openavbMcsInitFraction(&pPvtData->packetMcs, (U64)pPubMapInfo->framesPerPacket * NANOSECONDS_PER_SECOND, pPubMapInfo->audioRate);
+		}
+		pPvtData->packetMcsLeft = 0;
+		pPvtData->packetMcsSkipped = 0;
+
+		// These header words don't change while streaming
+		// - format info (format, sample rate, channels per frame, bit depth)
+		pPvtData->txFormatInfo = htonl(pPvtData->aaf_format << 24
+			| pPvtData->aaf_rate << 20
+			| pPubMapInfo->audioChannels << 8
+			| pPvtData->aaf_bit_depth);
+		// - packet info (data length, evt field)
+		pPvtData->txPacketInfo = htonl(pPvtData->payloadSize << 16
+			| pPvtData->aaf_event_field << 8);
+
+		// Zero samples are silence in every AAF PCM format
+		free(pPvtData->pNullFrame);
+		pPvtData->pNullFrame = calloc(1, AAF_HEADER_SIZE + pPvtData->payloadSize);
+		if (pPvtData->pNullFrame) {
+			U32 *pHdr = (U32 *)pPvtData->pNullFrame;
+			pHdr[1] = pPvtData->txFormatInfo;
+			pHdr[2] = pPvtData->txPacketInfo;
+			if (pPvtData->sparseMode == TS_SPARSE_MODE_ENABLED) {
+				pPvtData->pNullFrame[HIDX_AVTP_HIDE7_SP - AVTP_V0_HEADER_SIZE] |= SP_M0_BIT;
+			}
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
@@ -428,6 +582,27 @@ void openavbMapAVTPAudioTxInitCB(media_q_t *pMediaQ)
 //  from multiple media queue items. This allows interface to set into the media queue blocks of audio frames to properly correspond to
 //  a SYT_INTERVAL. Additionally the public data member sytInterval needs to be set in the same way the uncompressed audio mapping does.
 // This talker callback will be called for each AVB observation interval.
+// A media queue item can only be filled in place if it is exactly one packet
+bool openavbMapAVTPAudioTxPayloadCB(media_q_t *pMediaQ, U32 *pOffset, U32 *pSize)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+
+	if (pMediaQ && pOffset && pSize) {
+		media_q_pub_map_aaf_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData && pPvtData->directFill && pPvtData->packingFactor == 1
+			&& !pPvtData->txConv && pPubMapInfo->itemSize == pPvtData->payloadSize) {
+			*pOffset = TOTAL_HEADER_SIZE;
+			*pSize = pPvtData->payloadSize;
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return TRUE;
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return FALSE;
+}
+
 tx_cb_ret_t openavbMapAVTPAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 {
 	media_q_item_t *pMediaQItem = NULL;
@@ -444,52 +619,80 @@ tx_cb_ret_t openavbMapAVTPAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 	if (pMediaQItem) {
 		if (pMediaQItem->dataLen > 0) {
 
-			U32 tmp32;
 			U8 *pHdrV0 = pData;
 			U32 *pHdr = (U32 *)(pData + AVTP_V0_HEADER_SIZE);
 			U8  *pPayload = pData + TOTAL_HEADER_SIZE;
-			media_q_pub_map_aaf_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
 			pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
 			if (!pPvtData) {
 				AVB_LOG_ERROR("Private mapping module data not allocated.");
 				return TX_CB_RET_PACKET_NOT_READY;
 			}
+			// Sparse mode only carries a timestamp in packets whose sequence
+			// number is a multiple of 8; the others skip the time math.
+			bool stamp = pPvtData->sparseMode != TS_SPARSE_MODE_ENABLED
+				|| (pHdrV0[HIDX_AVTP_SEQ_NUM8] & 0x07) == 0;
+			bool stamped = FALSE;
+
 			// timestamp set in the interface module, here just validate
 			if (openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime)) {
+				// Packets of this item before the next one to be stamped
+				U32 toStamp = stamp ? 0 : 8 - (pHdrV0[HIDX_AVTP_SEQ_NUM8] & 0x07);
+
+				pPvtData->packetMcsLeft = 0;
+				if (toStamp < pPvtData->packingFactor) {
+					// Add the max transit time.
+					openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, pPvtData->maxTransitUsec);
+
+					if (stamp) {
+						// Set (clear) timestamp uncertain flag
+						if (openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime))
+							pHdrV0[HIDX_AVTP_HIDE7_TU1] |= 0x01;
+						else pHdrV0[HIDX_AVTP_HIDE7_TU1] &= ~0x01;
+
+						// - 4 bytes	avtp_timestamp
+						*pHdr = htonl(openavbAvtpTimeGetAvtpTimestamp(pMediaQItem->pAvtpTime));
+						stamped = TRUE;
+					}
 
-				// Add the max transit time.
-				openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, pPvtData->maxTransitUsec);
-
-				// Set timestamp valid flag
-				pHdrV0[HIDX_AVTP_HIDE7_TV1] |= 0x01;
-
-				// Set (clear) timestamp uncertain flag
-				if (openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime))
-					pHdrV0[HIDX_AVTP_HIDE7_TU1] |= 0x01;
-				else pHdrV0[HIDX_AVTP_HIDE7_TU1] &= ~0x01;
-
-				// - 4 bytes	avtp_timestamp
-				*pHdr++ = htonl(openavbAvtpTimeGetAvtpTimestamp(pMediaQItem->pAvtpTime));
+					// The other packets of a packed item follow at the packet
+					// interval; the synthesizer steps them without a divide.
+					if (pPvtData->packingFactor > 1 && pPvtData->packetMcs.stepQ32) {
+						openavbMcsSetEdge(&pPvtData->packetMcs, openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime));
+						pPvtData->packetMcsLeft = pPvtData->packingFactor - 1;
+						pPvtData->packetMcsSkipped = 0;
+						pPvtData->packetMcsUncertain = openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime);
+					}
+				}
 
 				openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, FALSE);
 			}
-			else {
-				// Clear timestamp valid flag
-				pHdrV0[HIDX_AVTP_HIDE7_TV1] &= ~0x01;
-				pHdr++; // Move past the timestamp field
+			else if (pPvtData->packetMcsLeft && pMediaQItem->readIdx) {
+				pPvtData->packetMcsLeft--;
+				pPvtData->packetMcsSkipped++;
+
+				if (stamp) {
+					if (pPvtData->packetMcsUncertain)
+						pHdrV0[HIDX_AVTP_HIDE7_TU1] |= 0x01;
+					else pHdrV0[HIDX_AVTP_HIDE7_TU1] &= ~0x01;
+
+					// Catch up over the unstamped packets in one step
+					*pHdr = htonl((U32)openavbMcsAdvanceN(&pPvtData->packetMcs, pPvtData->packetMcsSkipped, NULL));
+					pPvtData->packetMcsSkipped = 0;
+					stamped = TRUE;
+				}
 			}
 
+			// Set (clear) timestamp valid flag
+			if (stamped)
+				pHdrV0[HIDX_AVTP_HIDE7_TV1] |= 0x01;
+			else pHdrV0[HIDX_AVTP_HIDE7_TV1] &= ~0x01;
+			pHdr++; // Move past the timestamp field
+
 			// - 4 bytes	format info (format, sample rate, channels per frame, bit depth)
-			tmp32 = pPvtData->aaf_format << 24;
-			tmp32 |= pPvtData->aaf_rate  << 20;
-			tmp32 |= pPubMapInfo->audioChannels << 8;
-			tmp32 |= pPvtData->aaf_bit_depth;
-			*pHdr++ = htonl(tmp32);
+			*pHdr++ = pPvtData->txFormatInfo;
 
 			// - 4 bytes	packet info (data length, evt field)
-			tmp32 = pPvtData->payloadSize << 16;
-			tmp32 |= pPvtData->aaf_event_field << 8;
-			*pHdr++ = htonl(tmp32);
+			*pHdr++ = pPvtData->txPacketInfo;
 
 			// Set (clear) sparse mode flag
 			if (pPvtData->sparseMode == TS_SPARSE_MODE_ENABLED) {
@@ -504,7 +707,7 @@ tx_cb_ret_t openavbMapAVTPAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 				return TX_CB_RET_PACKET_NOT_READY;
 			}
 
-			if ((pMediaQItem->dataLen - pMediaQItem->readIdx) < pPvtData->payloadSize) {
+			if ((pMediaQItem->dataLen - pMediaQItem->readIdx) < pPvtData->itemPacketSize) {
 				// This should not happen so we will just toss it away.
 				AVB_LOG_ERROR("Not enough data in media queue item for packet");
 				openavbMediaQTailPull(pMediaQ);
@@ -512,9 +715,16 @@ tx_cb_ret_t openavbMapAVTPAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 				return TX_CB_RET_PACKET_NOT_READY;
 			}
 
-			memcpy(pPayload, (uint8_t *)pMediaQItem->pPubData + pMediaQItem->readIdx, pPvtData->payloadSize);
+			if (pPvtData->txConv) {
+				pPvtData->txConv(pPayload, (uint8_t *)pMediaQItem->pPubData + pMediaQItem->readIdx,
+					pPvtData->packetSamples);
+			}
+			// Nothing to copy if the interface filled the payload in place
+			else if ((U8 *)pMediaQItem->pPubData + pMediaQItem->readIdx != pPayload) {
+				memcpy(pPayload, (uint8_t *)pMediaQItem->pPubData + pMediaQItem->readIdx, pPvtData->payloadSize);
+			}
 
-			pMediaQItem->readIdx += pPvtData->payloadSize;
+			pMediaQItem->readIdx += pPvtData->itemPacketSize;
 			if (pMediaQItem->readIdx >= pMediaQItem->dataLen) {
 				// Finished reading the entire item
 				openavbMediaQTailPull(pMediaQ);
@@ -542,6 +752,39 @@ tx_cb_ret_t openavbMapAVTPAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 	return TX_CB_RET_PACKET_NOT_READY;
 }
 
+// Send silence in place of a packet the interface module has no data for
+tx_cb_ret_t openavbMapAVTPAudioTxNullCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+
+	pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+	if (!pPvtData || !pPvtData->pNullFrame
+		|| *dataLen < TOTAL_HEADER_SIZE + pPvtData->payloadSize) {
+		AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+		return TX_CB_RET_PACKET_NOT_READY;
+	}
+
+	memcpy(pData + AVTP_V0_HEADER_SIZE, pPvtData->pNullFrame, AAF_HEADER_SIZE + pPvtData->payloadSize);
+
+	// Present the silence max transit from now. Sparse mode stamps only one
+	// packet in eight.
+	pData[HIDX_AVTP_HIDE7_TU1] &= ~0x01;
+	if (pPvtData->sparseMode != TS_SPARSE_MODE_ENABLED || (pData[HIDX_AVTP_SEQ_NUM8] & 0x07) == 0) {
+		U64 nowNS;
+		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+		pData[HIDX_AVTP_HIDE7_TV1] |= 0x01;
+		*(U32 *)(pData + AVTP_V0_HEADER_SIZE) = htonl((U32)(nowNS + (U64)pPvtData->maxTransitUsec * NANOSECONDS_PER_USEC));
+	}
+	else {
+		pData[HIDX_AVTP_HIDE7_TV1] &= ~0x01;
+	}
+
+	*dataLen = TOTAL_HEADER_SIZE + pPvtData->payloadSize;
+
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return TX_CB_RET_PACKET_READY;
+}
+
 // A call to this callback indicates that this mapping module will be
 // a listener. Any listener initialization can be done in this function.
 void openavbMapAVTPAudioRxInitCB(media_q_t *pMediaQ)
@@ -553,8 +796,13 @@ void openavbMapAVTPAudioRxInitCB(media_q_t *pMediaQ)
 			AVB_LOG_ERROR("Private mapping module data not allocated.");
 			return;
 		}
-		if (pPvtData->audioMcr != AVB_MCR_NONE) {
+		// With a Clock Reference Stream the CRF listener owns the MCR HAL
+		if (pPvtData->audioMcr == AVB_MCR_AVTP_TIMESTAMP) {
 			HAL_INIT_MCR_V2(pPvtData->txInterval, pPvtData->packingFactor, pPvtData->mcrTimestampInterval, pPvtData->mcrRecoveryInterval);
+			if (pPvtData->pMcrClockDevice) {
+				HAL_SET_MCR_CLOCK_OUTPUT_V2(pPvtData->pMcrClockDevice, pPvtData->mcrClockPin, pPvtData->mcrClockHz);
+			}
+			pPvtData->mcrFrames = 0;
 		}
 		bool badPckFctrValue = FALSE;
 		if (pPvtData->sparseMode == TS_SPARSE_MODE_ENABLED) {
@@ -661,6 +909,15 @@ bool openavbMapAVTPAudioRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 				pPvtData->dataValid = TRUE;
 			}
 
+			if (pPvtData->audioMcr == AVB_MCR_AVTP_TIMESTAMP) {
+				// The timestamp belongs to the first frame of this packet
+				if ((pHdrV0[HIDX_AVTP_HIDE7_TV1] & 0x01) && !(pHdrV0[HIDX_AVTP_HIDE7_TU1] & 0x01)) {
+					HAL_PUSH_MCR_TIMESTAMP_V2(timestamp, pPvtData->mcrFrames, pPubMapInfo->audioRate);
+					pPvtData->mcrFrames = 0;
+				}
+				pPvtData->mcrFrames += pPubMapInfo->framesPerPacket;
+			}
+
 			// Get item pointer in media queue
 			media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
 			if (pMediaQItem) {
@@ -693,8 +950,14 @@ bool openavbMapAVTPAudioRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 						pPubMapInfo->intf_rx_translate_cb(pMediaQ, pPayload, pPvtData->payloadSize);
 					}
 
-					memcpy((uint8_t *)pMediaQItem->pPubData + pMediaQItem->dataLen, pPayload, pPvtData->payloadSize);
-					pMediaQItem->dataLen += pPvtData->payloadSize;
+					if (pPvtData->rxConv) {
+						pPvtData->rxConv((uint8_t *)pMediaQItem->pPubData + pMediaQItem->dataLen, pPayload,
+							pPvtData->packetSamples);
+					}
+					else {
+						memcpy((uint8_t *)pMediaQItem->pPubData + pMediaQItem->dataLen, pPayload, pPvtData->payloadSize);
+					}
+					pMediaQItem->dataLen += pPvtData->itemPacketSize;
 				}
 
 				if (pMediaQItem->dataLen < pMediaQItem->itemSize) {
@@ -739,11 +1002,14 @@ void openavbMapAVTPAudioEndCB(media_q_t *pMediaQ)
 			return;
 		}
 
-		if (pPvtData->audioMcr != AVB_MCR_NONE) {
+		if (pPvtData->audioMcr == AVB_MCR_AVTP_TIMESTAMP) {
 			HAL_CLOSE_MCR_V2();
 		}
 
 		pPvtData->mediaQItemSyncTS = FALSE;
+
+		free(pPvtData->pNullFrame);
+		pPvtData->pNullFrame = NULL;
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -752,6 +1018,15 @@ void openavbMapAVTPAudioEndCB(media_q_t *pMediaQ)
 void openavbMapAVTPAudioGenEndCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ && pMediaQ->pPvtMapInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData->pMcrClockDevice) {
+			free(pPvtData->pMcrClockDevice);
+			pPvtData->pMcrClockDevice = NULL;
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -771,6 +1046,7 @@ extern DLL_EXPORT bool openavbMapAVTPAudioInitialize(media_q_t *pMediaQ, openavb
 		}
 
 		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		openavbMediaQSetPubMapInfoSize(pMediaQ, sizeof(media_q_pub_map_aaf_audio_info_t));
 
 		pMapCB->map_cfg_cb = openavbMapAVTPAudioCfgCB;
 		pMapCB->map_subtype_cb = openavbMapAVTPAudioSubtypeCB;
@@ -784,13 +1060,17 @@ extern DLL_EXPORT bool openavbMapAVTPAudioInitialize(media_q_t *pMediaQ, openavb
 		pMapCB->map_rx_cb = openavbMapAVTPAudioRxCB;
 		pMapCB->map_end_cb = openavbMapAVTPAudioEndCB;
 		pMapCB->map_gen_end_cb = openavbMapAVTPAudioGenEndCB;
+		pMapCB->map_tx_payload_cb = openavbMapAVTPAudioTxPayloadCB;
+		pMapCB->map_tx_null_cb = openavbMapAVTPAudioTxNullCB;
 
 		pPvtData->itemCount = 20;
 		pPvtData->txInterval = 4000;  // default to something that wont cause divide by zero
 		pPvtData->packingFactor = 1;
+		pPvtData->directFill = FALSE;
 		pPvtData->maxTransitUsec = inMaxTransitUsec;
 		pPvtData->sparseMode = TS_SPARSE_MODE_DISABLED;
 		pPvtData->mcrTimestampInterval = 144;
+		pPvtData->mcrClockHz = 1000;
 		pPvtData->mcrRecoveryInterval = 512;
 		pPvtData->aaf_event_field = AAF_STATIC_CHANNELS_LAYOUT;
 		pPvtData->intervalCounter = 0;
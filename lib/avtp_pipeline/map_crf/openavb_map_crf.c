@@ -0,0 +1,701 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+ 
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ 
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+Attributions: The inih library portion of the source code is licensed from 
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt. 
+Complete license and copyright information can be found at 
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Clock Reference Format (CRF) mapping module.
+* 
+* A CRF stream (IEEE 1722-2016 clause 10) carries nothing but media clock
+* timestamps. The talker synthesizes them from gPTP time, several per PDU,
+* and listeners feed them to the media clock recovery (MCR) HAL. One CRF
+* stream at a few dozen packets per second can then discipline any number
+* of audio listeners set to map_nv_audio_mcr = 2 (Clock Reference Stream).
+*
+* The interface module only paces the talker, any interface that pushes
+* media queue items with the wall time (for example null) will do.
+* 
+*----------------------------------------------------------------*
+* 
+* HEADERS
+* 
+*  -+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-
+* |C|             |S|     |M| |F|T|               |               |
+* |D|subtype      |V|vers |R|R|S|U|sequence number|type           |
+* --+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+--
+* |                                                               |
+* |                                                               |
+* -                                                               -
+* |                                                               |
+* |stream id                                                      |
+* --+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+--
+* |pull |                                                         |
+* |     |base frequency                                           |
+* --+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+--
+* |                               |                               |
+* |crf data length                |timestamp interval             |
+* --+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+--
+* |                                                               |
+* |crf data: 64 bit timestamps ...                                |
+*  -+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-|-+-+-+-+-+-+-+-
+* 
+* CD 				: Standard AVTP
+* Subtype 			: CRF 0x04
+* SV				: Standard AVTP
+* Ver				: Standard AVTP
+* MR				: Toggled when the talker restarts its media clock
+* R					: Reserved
+* FS				: Frame sync, not used
+* TU				: Timestamp uncertain
+* Sequence number	: Standard AVTP
+* Type				: CRF type, 1 = audio sample
+* Stream ID			: Standard AVTP
+* Pull				: Multiplier applied to the base frequency
+* Base frequency	: Nominal media clock frequency in Hz
+* CRF data length	: Bytes of timestamps that follow
+* Timestamp interval: Media clock events between two timestamps
+* 
+*/
+
+#include "openavb_platform_pub.h"
+#include <stdlib.h>
+#include <string.h>
+#include "openavb_types_pub.h"
+#include "openavb_trace_pub.h"
+#include "openavb_avtp_time_pub.h"
+#include "openavb_mediaq_pub.h"
+#include "openavb_map_pub.h"
+#include "openavb_mcr_hal_pub.h"
+#include "openavb_mcs.h"
+#include "openavb_map_crf_pub.h"
+
+#define	AVB_LOG_COMPONENT	"CRF Mapping"
+#include "openavb_log_pub.h"
+
+#define AVTP_SUBTYPE_CRF			0x04
+
+#define CRF_HEADER_SIZE				20
+
+// Largest number of timestamps in one PDU that fits a standard Ethernet frame
+#define CRF_MAX_TIMESTAMPS			180
+
+// - 1 Byte - SV, MR, FS and TU bits
+#define HIDX_CRF_FLAGS8				1
+#define CRF_FLAG_SV					0x80
+#define CRF_FLAG_MR					0x08
+#define CRF_FLAG_TU					0x01
+
+// - 1 Byte - sequence number
+#define HIDX_CRF_SEQ8				2
+
+// - 1 Byte - CRF type
+#define HIDX_CRF_TYPE8				3
+
+// - 4 bytes	pull (3 bits) and base_frequency (29 bits)
+#define HIDX_CRF_PULL_BASE32		12
+#define CRF_BASE_FREQUENCY_MASK		0x1FFFFFFF
+
+// - 2 bytes	crf_data_length
+#define HIDX_CRF_DATALEN16			16
+
+// - 2 bytes	timestamp_interval
+#define HIDX_CRF_TS_INTERVAL16		18
+
+#define CRF_TYPE_AUDIO_SAMPLE		1
+
+// Pull multipliers as num / den, indexed by the pull field
+static const U32 x_pullNum[] = { 1, 1000, 1001, 24, 25, 1 };
+static const U32 x_pullDen[] = { 1, 1001, 1000, 25, 24, 8 };
+#define CRF_PULL_MAX				5
+
+typedef struct {
+	/////////////
+	// Config data
+	/////////////
+	// map_nv_item_count
+	U32 itemCount;
+
+	// map_nv_type
+	U8 crfType;
+
+	// map_nv_base_frequency
+	U32 baseFrequency;
+
+	// map_nv_pull
+	U8 pull;
+
+	// map_nv_timestamp_interval
+	U32 timestampInterval;
+
+	// map_nv_timestamps_per_pdu
+	U32 timestampsPerPdu;
+
+	// map_nv_mcr
+	bool mcr;
+
+	// map_nv_mcr_recovery_interval
+	U32 mcrRecoveryInterval;
+
+	// map_nv_mcr_clock_device, map_nv_mcr_clock_pin and map_nv_mcr_clock_hz
+	char *pMcrClockDevice;
+	U32 mcrClockPin;
+	U32 mcrClockHz;
+
+	// map_nv_mcr_input_device, map_nv_mcr_input_pin and map_nv_mcr_input_hz
+	char *pMcrInputDevice;
+	U32 mcrInputPin;
+	U32 mcrInputHz;
+
+	/////////////
+	// Variable data
+	/////////////
+	// Maximum transit time
+	U32 maxTransitUsec;     // In microseconds
+
+	// Nanoseconds between two timestamps and covered by one PDU
+	double nsPerTimestamp;
+	U64 nsPerPdu;
+
+	// Talker: generates the timestamps
+	mcs_t mcs;
+	bool mcsRunning;
+	bool mediaRestart;
+	// External media clock the MCS follows
+	bool mcrInputRunning;
+
+	// Listener: MCR HAL owned by this stream, last timestamp pushed to it and
+	// the last media restart bit seen
+	bool mcrRunning;
+	bool haveLastTimestamp;
+	U32 lastTimestamp;
+	bool lastMediaRestart;
+} pvt_data_t;
+
+// Each configuration name value pair for this mapping will result in this callback being called.
+void openavbMapCrfCfgCB(media_q_t *pMediaQ, const char *name, const char *value)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return;
+		}
+
+		if (strcmp(name, "map_nv_item_count") == 0) {
+			char *pEnd;
+			pPvtData->itemCount = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_type") == 0) {
+			char *pEnd;
+			pPvtData->crfType = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_base_frequency") == 0) {
+			char *pEnd;
+			pPvtData->baseFrequency = strtol(value, &pEnd, 10) & CRF_BASE_FREQUENCY_MASK;
+		}
+		else if (strcmp(name, "map_nv_pull") == 0) {
+			char *pEnd;
+			long tmp = strtol(value, &pEnd, 10);
+			if (tmp < 0 || tmp > CRF_PULL_MAX) {
+				AVB_LOGF_ERROR("Unsupported CRF pull %ld", tmp);
+			}
+			else {
+				pPvtData->pull = tmp;
+			}
+		}
+		else if (strcmp(name, "map_nv_timestamp_interval") == 0) {
+			char *pEnd;
+			pPvtData->timestampInterval = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_timestamps_per_pdu") == 0) {
+			char *pEnd;
+			pPvtData->timestampsPerPdu = strtol(value, &pEnd, 10);
+			if (pPvtData->timestampsPerPdu > CRF_MAX_TIMESTAMPS) {
+				AVB_LOGF_WARNING("map_nv_timestamps_per_pdu limited to %d", CRF_MAX_TIMESTAMPS);
+				pPvtData->timestampsPerPdu = CRF_MAX_TIMESTAMPS;
+			}
+		}
+		else if (strcmp(name, "map_nv_mcr") == 0) {
+			char *pEnd;
+			pPvtData->mcr = (strtol(value, &pEnd, 10) == 1);
+		}
+		else if (strcmp(name, "map_nv_mcr_recovery_interval") == 0) {
+			char *pEnd;
+			pPvtData->mcrRecoveryInterval = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_mcr_clock_device") == 0) {
+			if (pPvtData->pMcrClockDevice)
+				free(pPvtData->pMcrClockDevice);
+			pPvtData->pMcrClockDevice = strdup(value);
+		}
+		else if (strcmp(name, "map_nv_mcr_clock_pin") == 0) {
+			char *pEnd;
+			pPvtData->mcrClockPin = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_mcr_clock_hz") == 0) {
+			char *pEnd;
+			pPvtData->mcrClockHz = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_mcr_input_device") == 0) {
+			if (pPvtData->pMcrInputDevice)
+				free(pPvtData->pMcrInputDevice);
+			pPvtData->pMcrInputDevice = strdup(value);
+		}
+		else if (strcmp(name, "map_nv_mcr_input_pin") == 0) {
+			char *pEnd;
+			pPvtData->mcrInputPin = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_mcr_input_hz") == 0) {
+			char *pEnd;
+			pPvtData->mcrInputHz = strtol(value, &pEnd, 10);
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+}
+
+U8 openavbMapCrfSubtypeCB()
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+	return AVTP_SUBTYPE_CRF;
+}
+
+// Returns the AVTP version used by this mapping
+U8 openavbMapCrfAvtpVersionCB()
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return 0x00;        // Version 0
+}
+
+U16 openavbMapCrfMaxDataSizeCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return 0;
+		}
+
+		AVB_TRACE_EXIT(AVB_TRACE_MAP);
+		return CRF_HEADER_SIZE + pPvtData->timestampsPerPdu * sizeof(U64);
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+	return 0;
+}
+
+// Returns the intended transmit interval (in frames per second). One PDU per
+// timestampsPerPdu timestamps, rounded up: the talker holds back PDUs that
+// would run ahead of the media clock.
+U32 openavbMapCrfTransmitIntervalCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return 0;
+		}
+
+		U64 num = (U64)pPvtData->baseFrequency * x_pullNum[pPvtData->pull];
+		U64 den = (U64)pPvtData->timestampInterval * pPvtData->timestampsPerPdu * x_pullDen[pPvtData->pull];
+		AVB_TRACE_EXIT(AVB_TRACE_MAP);
+		return den ? (U32)((num + den - 1) / den) : 0;
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+	return 0;
+}
+
+void openavbMapCrfGenInitCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return;
+		}
+
+		if (!pPvtData->baseFrequency || !pPvtData->timestampInterval || !pPvtData->timestampsPerPdu) {
+			AVB_LOG_ERROR("map_nv_base_frequency, map_nv_timestamp_interval and map_nv_timestamps_per_pdu must not be 0");
+			pPvtData->baseFrequency = 48000;
+			pPvtData->timestampInterval = 160;
+			pPvtData->timestampsPerPdu = 6;
+		}
+
+		pPvtData->nsPerTimestamp = (double)pPvtData->timestampInterval * NANOSECONDS_PER_SECOND * x_pullDen[pPvtData->pull]
+			/ ((double)pPvtData->baseFrequency * x_pullNum[pPvtData->pull]);
+		pPvtData->nsPerPdu = (U64)(pPvtData->nsPerTimestamp * pPvtData->timestampsPerPdu);
+
+		openavbMediaQSetSize(pMediaQ, pPvtData->itemCount, pPvtData->timestampsPerPdu * sizeof(U64));
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+}
+
+// A call to this callback indicates that this mapping module will be
+// a talker. Any talker initialization can be done in this function.
+void openavbMapCrfTxInitCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return;
+		}
+
+		openavbMcsInitFraction(&pPvtData->mcs,
+			(U64)pPvtData->timestampInterval * NANOSECONDS_PER_SECOND * x_pullDen[pPvtData->pull],
+			pPvtData->baseFrequency * x_pullNum[pPvtData->pull]);
+		pPvtData->mcsRunning = FALSE;
+
+		if (pPvtData->pMcrInputDevice) {
+			pPvtData->mcrInputRunning = HAL_SET_MCR_CLOCK_INPUT_V2(pPvtData->pMcrInputDevice, pPvtData->mcrInputPin, pPvtData->mcrInputHz);
+		}
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+}
+
+// This talker callback will be called for each AVB observation interval.
+tx_cb_ret_t openavbMapCrfTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+	if (pMediaQ && pData && dataLen) {
+		U8 *pHdr = pData;
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return TX_CB_RET_PACKET_NOT_READY;
+		}
+
+		// The item only paces the stream, its wall time tells where the media clock should be
+		media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+		if (!pMediaQItem) {
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return TX_CB_RET_PACKET_NOT_READY;  // Media queue empty
+		}
+		if (pMediaQItem->dataLen == 0) {
+			openavbMediaQTailPull(pMediaQ);
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return TX_CB_RET_PACKET_NOT_READY;  // No payload
+		}
+		U64 nowNS = openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime) + (U64)pPvtData->maxTransitUsec * NANOSECONDS_PER_USEC;
+		bool uncertain = openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime);
+		openavbMediaQTailPull(pMediaQ);
+
+		if (!pPvtData->mcsRunning) {
+			openavbMcsSetEdge(&pPvtData->mcs, nowNS);
+			pPvtData->mcsRunning = TRUE;
+			pPvtData->mediaRestart = !pPvtData->mediaRestart;
+		}
+		else {
+			U64 nextNS = pPvtData->mcs.edgeTime + pPvtData->mcs.nsPerAdvance;
+			if (nextNS > nowNS + 2 * pPvtData->nsPerPdu) {
+				// Ahead of the media clock, skip this transmit slot
+				AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+				return TX_CB_RET_PACKET_NOT_READY;
+			}
+			if (nextNS + pPvtData->nsPerPdu < nowNS) {
+				// Fell behind, drop whole timestamps to keep the clock phase continuous.
+				// Listeners see the gap in the timestamps themselves.
+				U32 skip = (U32)((nowNS - nextNS) / pPvtData->nsPerTimestamp);
+				openavbMcsAdvanceN(&pPvtData->mcs, skip, NULL);
+				IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("CRF talker behind, skipped %u timestamps", skip);
+			}
+		}
+
+		if (pPvtData->mcrInputRunning) {
+			// A fast studio clock needs shorter steps
+			S32 ratePpb;
+			if (HAL_GET_MCR_INPUT_RATE_V2(&ratePpb)) {
+				openavbMcsSetRateTrim(&pPvtData->mcs, -ratePpb);
+			}
+		}
+
+		pHdr[HIDX_CRF_FLAGS8] = CRF_FLAG_SV
+			| (pPvtData->mediaRestart ? CRF_FLAG_MR : 0)
+			| (uncertain ? CRF_FLAG_TU : 0);
+		pHdr[HIDX_CRF_TYPE8] = pPvtData->crfType;
+		*(U32 *)(&pHdr[HIDX_CRF_PULL_BASE32]) = htonl(((U32)pPvtData->pull << 29) | pPvtData->baseFrequency);
+		// for alignment
+		U16 tmp16 = htons(pPvtData->timestampsPerPdu * sizeof(U64));
+		memcpy(&pHdr[HIDX_CRF_DATALEN16], &tmp16, sizeof(U16));
+		tmp16 = htons(pPvtData->timestampInterval);
+		memcpy(&pHdr[HIDX_CRF_TS_INTERVAL16], &tmp16, sizeof(U16));
+
+		U64 timestamps[CRF_MAX_TIMESTAMPS];
+		openavbMcsAdvanceN(&pPvtData->mcs, pPvtData->timestampsPerPdu, timestamps);
+		U8 *pPayload = pData + CRF_HEADER_SIZE;
+		U32 i1;
+		for (i1 = 0; i1 < pPvtData->timestampsPerPdu; i1++) {
+			U64 ts = htonll(timestamps[i1]);
+			memcpy(pPayload, &ts, sizeof(U64));
+			pPayload += sizeof(U64);
+		}
+		*dataLen = CRF_HEADER_SIZE + pPvtData->timestampsPerPdu * sizeof(U64);
+
+		AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
+		AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+		return TX_CB_RET_PACKET_READY;
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return TX_CB_RET_PACKET_NOT_READY;
+}
+
+// A call to this callback indicates that this mapping module will be
+// a listener. Any listener initialization can be done in this function.
+void openavbMapCrfRxInitCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return;
+		}
+
+		if (pPvtData->mcr) {
+			HAL_INIT_MCR_V2(0, 0, pPvtData->timestampInterval, pPvtData->mcrRecoveryInterval);
+			if (pPvtData->pMcrClockDevice) {
+				HAL_SET_MCR_CLOCK_OUTPUT_V2(pPvtData->pMcrClockDevice, pPvtData->mcrClockPin, pPvtData->mcrClockHz);
+			}
+			pPvtData->mcrRunning = TRUE;
+		}
+		pPvtData->haveLastTimestamp = FALSE;
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+}
+
+// This callback occurs when running as a listener and data is available.
+bool openavbMapCrfRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+	if (pMediaQ && pData) {
+		const U8 *pHdr = pData;
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return FALSE;
+		}
+
+		if (dataLen < CRF_HEADER_SIZE || pHdr[HIDX_CRF_TYPE8] != pPvtData->crfType) {
+			IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("Ignoring CRF PDU of unexpected type or size");
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return FALSE;
+		}
+
+		U32 pullBase = ntohl(*(U32 *)(&pHdr[HIDX_CRF_PULL_BASE32]));
+		U16 crfDataLen, tsInterval;
+		memcpy(&crfDataLen, &pHdr[HIDX_CRF_DATALEN16], sizeof(U16));
+		memcpy(&tsInterval, &pHdr[HIDX_CRF_TS_INTERVAL16], sizeof(U16));
+		crfDataLen = ntohs(crfDataLen);
+		tsInterval = ntohs(tsInterval);
+
+		if ((pullBase & CRF_BASE_FREQUENCY_MASK) != pPvtData->baseFrequency
+			|| (pullBase >> 29) != pPvtData->pull
+			|| tsInterval != pPvtData->timestampInterval) {
+			IF_LOG_INTERVAL(1000) AVB_LOGF_WARNING("CRF stream is %u Hz pull %u interval %u, configured for %u Hz pull %u interval %u",
+				pullBase & CRF_BASE_FREQUENCY_MASK, pullBase >> 29, tsInterval,
+				pPvtData->baseFrequency, pPvtData->pull, pPvtData->timestampInterval);
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return FALSE;
+		}
+
+		U32 nTimestamps = crfDataLen / sizeof(U64);
+		if (CRF_HEADER_SIZE + crfDataLen > dataLen) {
+			nTimestamps = (dataLen - CRF_HEADER_SIZE) / sizeof(U64);
+		}
+
+		bool mediaRestart = (pHdr[HIDX_CRF_FLAGS8] & CRF_FLAG_MR) ? TRUE : FALSE;
+		if (mediaRestart != pPvtData->lastMediaRestart) {
+			// The talker restarted its media clock, the previous timestamp is not related
+			pPvtData->lastMediaRestart = mediaRestart;
+			pPvtData->haveLastTimestamp = FALSE;
+		}
+
+		const U8 *pPayload = pData + CRF_HEADER_SIZE;
+		U64 firstNS = 0;
+
+		if (pPvtData->mcrRunning && !(pHdr[HIDX_CRF_FLAGS8] & CRF_FLAG_TU)) {
+			U32 pullNum = x_pullNum[pPvtData->pull];
+			U32 pullDen = x_pullDen[pPvtData->pull];
+			U32 i1;
+			for (i1 = 0; i1 < nTimestamps; i1++) {
+				U64 ts;
+				memcpy(&ts, pPayload + i1 * sizeof(U64), sizeof(U64));
+				ts = ntohll(ts);
+
+				// Whole timestamp intervals since the last one pushed, so
+				// lost PDUs and talker skips do not disturb the recovery
+				U32 intervals = 1;
+				if (pPvtData->haveLastTimestamp) {
+					intervals = (U32)((U32)(ts - pPvtData->lastTimestamp) / pPvtData->nsPerTimestamp + 0.5);
+					if (!intervals) {
+						continue;
+					}
+				}
+
+				// The pull is applied through the frame count so the nominal rate stays exact
+				HAL_PUSH_MCR_TIMESTAMP_V2((U32)ts, intervals * pPvtData->timestampInterval * pullDen,
+					pPvtData->baseFrequency * pullNum);
+				pPvtData->lastTimestamp = (U32)ts;
+				pPvtData->haveLastTimestamp = TRUE;
+			}
+		}
+
+		if (nTimestamps) {
+			memcpy(&firstNS, pPayload, sizeof(U64));
+			firstNS = ntohll(firstNS);
+		}
+
+		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+		if (pMediaQItem) {
+			openavbAvtpTimeSetToTimestampNS(pMediaQItem->pAvtpTime, firstNS);
+			openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, nTimestamps ? TRUE : FALSE);
+			openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, (pHdr[HIDX_CRF_FLAGS8] & CRF_FLAG_TU) ? TRUE : FALSE);
+
+			U64 *pTs = pMediaQItem->pPubData;
+			U32 i1;
+			if (nTimestamps * sizeof(U64) > pMediaQItem->itemSize) {
+				nTimestamps = pMediaQItem->itemSize / sizeof(U64);
+			}
+			for (i1 = 0; i1 < nTimestamps; i1++) {
+				memcpy(&pTs[i1], pPayload + i1 * sizeof(U64), sizeof(U64));
+				pTs[i1] = ntohll(pTs[i1]);
+			}
+			pMediaQItem->dataLen = nTimestamps * sizeof(U64);
+
+			openavbMediaQHeadPush(pMediaQ);
+			AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return TRUE;
+		}
+		else {
+			// The clock recovery above does not depend on the media queue
+			IF_LOG_INTERVAL(1000) AVB_LOG_INFO("Media queue full");
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return FALSE;   // Media queue full
+		}
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return FALSE;
+}
+
+// This callback will be called when the mapping module needs to be closed.
+// All cleanup should occur in this function.
+void openavbMapCrfEndCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return;
+		}
+
+		if (pPvtData->mcrRunning) {
+			HAL_CLOSE_MCR_V2();
+			pPvtData->mcrRunning = FALSE;
+		}
+		if (pPvtData->mcrInputRunning) {
+			HAL_SET_MCR_CLOCK_INPUT_V2(NULL, 0, 0);
+			pPvtData->mcrInputRunning = FALSE;
+		}
+		pPvtData->mcsRunning = FALSE;
+		pPvtData->haveLastTimestamp = FALSE;
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+}
+
+void openavbMapCrfGenEndCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData && pPvtData->pMcrClockDevice) {
+			free(pPvtData->pMcrClockDevice);
+			pPvtData->pMcrClockDevice = NULL;
+		}
+		if (pPvtData && pPvtData->pMcrInputDevice) {
+			free(pPvtData->pMcrInputDevice);
+			pPvtData->pMcrInputDevice = NULL;
+		}
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+}
+
+// Initialization entry point into the mapping module. Will need to be included in the .ini file.
+extern DLL_EXPORT bool openavbMapCrfInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+
+	if (pMediaQ) {
+		pMediaQ->pMediaQDataFormat = strdup(MapCrfMediaQDataFormat);
+		pMediaQ->pPvtMapInfo = calloc(1, sizeof(pvt_data_t));       // Memory freed by the media queue when the media queue is destroyed.
+
+		if (!pMediaQ->pMediaQDataFormat || !pMediaQ->pPvtMapInfo) {
+			AVB_LOG_ERROR("Unable to allocate memory for mapping module.");
+			return FALSE;
+		}
+
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+
+		pMapCB->map_cfg_cb = openavbMapCrfCfgCB;
+		pMapCB->map_subtype_cb = openavbMapCrfSubtypeCB;
+		pMapCB->map_avtp_version_cb = openavbMapCrfAvtpVersionCB;
+		pMapCB->map_max_data_size_cb = openavbMapCrfMaxDataSizeCB;
+		pMapCB->map_transmit_interval_cb = openavbMapCrfTransmitIntervalCB;
+		pMapCB->map_gen_init_cb = openavbMapCrfGenInitCB;
+		pMapCB->map_tx_init_cb = openavbMapCrfTxInitCB;
+		pMapCB->map_tx_cb = openavbMapCrfTxCB;
+		pMapCB->map_rx_init_cb = openavbMapCrfRxInitCB;
+		pMapCB->map_rx_cb = openavbMapCrfRxCB;
+		pMapCB->map_end_cb = openavbMapCrfEndCB;
+		pMapCB->map_gen_end_cb = openavbMapCrfGenEndCB;
+
+		pPvtData->itemCount = 20;
+		pPvtData->crfType = CRF_TYPE_AUDIO_SAMPLE;
+		pPvtData->baseFrequency = 48000;
+		pPvtData->pull = 0;
+		pPvtData->timestampInterval = 160;
+		pPvtData->timestampsPerPdu = 6;
+		pPvtData->mcr = TRUE;
+		pPvtData->mcrRecoveryInterval = 256;
+		pPvtData->mcrClockHz = 1000;
+		pPvtData->mcrInputHz = 1000;
+		pPvtData->maxTransitUsec = inMaxTransitUsec;
+
+		openavbMediaQSetMaxLatency(pMediaQ, inMaxTransitUsec);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MAP);
+	return TRUE;
+}
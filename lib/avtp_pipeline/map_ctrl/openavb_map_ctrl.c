@@ -81,12 +81,17 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 * Data Length		: Length of the data payload
 * Protocol type 	: Set to "F" for CTL_PROPRIETARY
 * Reserved 			: Standard AVTP
-* Number of messages: This mapping module will always transport just 1 message.
+* Number of messages: Number of control messages packed into the frame.
+*					  Up to map_nv_max_messages, 1 by default.
 * 
 ******* OPENAVB Vendor headers
 * 
+* Each control message in the frame starts with its own OPENAVB header
+* and the messages follow each other with no padding, so a frame
+* carrying one message is laid out exactly as before aggregation.
+* 
 * OPENAVB Ctrl format	: OPENAVB specific control format. 0x01 for this mapping.
-* OPENAVB data length	: Data length of the OPENAVB control payload.
+* OPENAVB data length	: Data length of this control message.
 * OPENAVB reserved		: reserved
 * 
 */
@@ -157,6 +162,14 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // - 1 bytes	OPENAVB reserved
 #define HIDX_OPENAVB_RESERVEDA8			27
 
+// Offsets of the same fields within each message's OPENAVB header
+#define MIDX_OPENAVB_CTRL_FORMAT8		0
+#define MIDX_OPENAVB_CTRL_DATALEN16		1
+#define MIDX_OPENAVB_RESERVEDA8			3
+
+// Number of messages is an 8 bit field
+#define MAX_MESSAGES_PER_FRAME			255
+
 
 typedef struct {
 	/////////////
@@ -168,6 +181,9 @@ typedef struct {
 	// Transmit interval in frames per second. 0 = default for talker class.
 	U32 txInterval;
 
+	// map_nv_max_messages: control messages packed into one frame
+	U32 maxMessages;
+
 
 	/////////////
 	// Variable data
@@ -212,6 +228,13 @@ void openavbMapCtrlCfgCB(media_q_t *pMediaQ, const char *name, const char *value
 			pPvtData->maxDataSize = (pPvtData->maxPayloadSize + TOTAL_HEADER_SIZE);
 			pPvtData->itemSize =	pPvtData->maxDataSize;
 		}
+		else if (strcmp(name, "map_nv_max_messages") == 0) {
+			pPvtData->maxMessages = strtol(value, &pEnd, 10);
+			if (pPvtData->maxMessages < 1)
+				pPvtData->maxMessages = 1;
+			else if (pPvtData->maxMessages > MAX_MESSAGES_PER_FRAME)
+				pPvtData->maxMessages = MAX_MESSAGES_PER_FRAME;
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -290,13 +313,22 @@ void openavbMapCtrlTxInitCB(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Append one control message, with its OPENAVB header, at pMsg
+static inline U32 x_putMessage(U8 *pMsg, const media_q_item_t *pMediaQItem)
+{
+	pMsg[MIDX_OPENAVB_CTRL_FORMAT8] = MAP_CTRL_OPENAVB_FORMAT;
+	*(U16 *)(&pMsg[MIDX_OPENAVB_CTRL_DATALEN16]) = htons(pMediaQItem->dataLen);
+	pMsg[MIDX_OPENAVB_RESERVEDA8] = 0x00;
+	memcpy(pMsg + OPENAVB_FORMAT_HEADER_SIZE, pMediaQItem->pPubData, pMediaQItem->dataLen);
+	return OPENAVB_FORMAT_HEADER_SIZE + pMediaQItem->dataLen;
+}
+
 // This talker callback will be called for each AVB observation interval.
 tx_cb_ret_t openavbMapCtrlTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
 	if (pMediaQ && pData && dataLen) {
 		U8 *pHdr = pData;
-		U8 *pPayload = pData + TOTAL_HEADER_SIZE;
 		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
 		if (!pPvtData) {
 			AVB_LOG_ERROR("Private mapping module data not allocated.");
@@ -315,6 +347,7 @@ tx_cb_ret_t openavbMapCtrlTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 				}
 
 				// PTP walltime already set in the interface module. Just add the max transit time.
+				// The first message's timestamp is used for the whole frame.
 				openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, pPvtData->maxTransitUsec);
 
 				// Set timestamp valid flag
@@ -332,18 +365,37 @@ tx_cb_ret_t openavbMapCtrlTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 
 				*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]) = htonl(openavbAvtpTimeGetAvtpTimestamp(pMediaQItem->pAvtpTime));
 				*(U32 *)(&pHdr[HIDX_AVTP_FORMAT_INFO32]) = 0x00000000;
-				*(U16 *)(&pHdr[HIDX_AVTP_DATA_LENGTH16]) = htons(pMediaQItem->dataLen + OPENAVB_FORMAT_HEADER_SIZE);
 				pHdr[HIDX_PROTO4_RESERVED4] = 0xF0;      	// 1722a 10.2.2 protocol_type field. F for CTL_PROPRIETARY
-				pHdr[HIDX_NUMMESS8] = 0x01;      			// Always 1 control message
 
-				pHdr[HIDX_OPENAVB_CTRL_FORMAT8] = MAP_CTRL_OPENAVB_FORMAT;
-				*(U16 *)(&pHdr[HIDX_OPENAVB_CTRL_DATALEN16]) = htons(pMediaQItem->dataLen);
-				pHdr[HIDX_OPENAVB_RESERVEDA8] = 0x00;
+				U32 frameLen = AVTP_HEADER_SIZE;
+				U32 numMessages = 0;
+				frameLen += x_putMessage(pData + frameLen, pMediaQItem);
+				numMessages++;
+				openavbMediaQTailPull(pMediaQ);
 
-				memcpy(pPayload, pMediaQItem->pPubData, pMediaQItem->dataLen);
-				*dataLen = pMediaQItem->dataLen + TOTAL_HEADER_SIZE;
+				// Pack whatever else is already queued while it still fits
+				while (numMessages < pPvtData->maxMessages) {
+					pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+					if (!pMediaQItem)
+						break;
+					if (pMediaQItem->dataLen == 0 || pMediaQItem->dataLen > pPvtData->maxPayloadSize) {
+						// Leave it for the single message path to drop and report
+						openavbMediaQTailUnlock(pMediaQ);
+						break;
+					}
+					if (frameLen + OPENAVB_FORMAT_HEADER_SIZE + pMediaQItem->dataLen > pPvtData->maxDataSize) {
+						openavbMediaQTailUnlock(pMediaQ);
+						break;
+					}
+					frameLen += x_putMessage(pData + frameLen, pMediaQItem);
+					numMessages++;
+					openavbMediaQTailPull(pMediaQ);
+				}
+
+				*(U16 *)(&pHdr[HIDX_AVTP_DATA_LENGTH16]) = htons(frameLen - AVTP_HEADER_SIZE);
+				pHdr[HIDX_NUMMESS8] = numMessages;
+				*dataLen = frameLen;
 
-				openavbMediaQTailPull(pMediaQ);
 				AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
 				AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
 				return TX_CB_RET_PACKET_READY;
@@ -372,31 +424,63 @@ void openavbMapCtrlRxInitCB(media_q_t *pMediaQ)
 }
 
 // This callback occurs when running as a listener and data is available.
+// Each control message in the frame is placed in its own media queue item.
 bool openavbMapCtrlRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
 	if (pMediaQ && pData) {
 		const U8 *pHdr = pData;
-		U8 *pPayload = pData + TOTAL_HEADER_SIZE;
 		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
 		if (!pPvtData) {
 			AVB_LOG_ERROR("Private mapping module data not allocated.");
 			return FALSE;
 		}
 
-		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
-		if (pMediaQItem) {
-			U32 timestamp = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]));
+		if (dataLen < TOTAL_HEADER_SIZE) {
+			AVB_LOG_ERROR("Control frame too short.");
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return FALSE;
+		}
+
+		U32 timestamp = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]));
+		bool tsValid = (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE;
+		bool tsUncertain = (pHdr[HIDX_AVTP_HIDE7_TU1] & 0x01) ? TRUE : FALSE;
+
+		// A count of 0 is not valid; treat it as the single message it must carry
+		U32 numMessages = pHdr[HIDX_NUMMESS8] ? pHdr[HIDX_NUMMESS8] : 1;
+		U32 offset = AVTP_HEADER_SIZE;
+		U32 msg;
+
+		for (msg = 0; msg < numMessages; msg++) {
+			const U8 *pMsg = pData + offset;
+			U16 payloadLen;
+
+			if (offset + OPENAVB_FORMAT_HEADER_SIZE > dataLen) {
+				AVB_LOGF_ERROR("Control frame truncated after %u of %u messages.", msg, numMessages);
+				break;
+			}
+			payloadLen = ntohs(*(U16 *)(&pMsg[MIDX_OPENAVB_CTRL_DATALEN16]));
+			if (offset + OPENAVB_FORMAT_HEADER_SIZE + payloadLen > dataLen) {
+				AVB_LOGF_ERROR("Control frame truncated after %u of %u messages.", msg, numMessages);
+				break;
+			}
+
+			media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+			if (!pMediaQItem) {
+				IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("Media queue full. %u of %u messages dropped.", numMessages - msg, numMessages);
+				AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+				return FALSE;   // Media queue full
+			}
+
 			openavbAvtpTimeSetToTimestamp(pMediaQItem->pAvtpTime, timestamp);
 
 			// Set timestamp valid and timestamp uncertain flags
-			openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE);
-			openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TU1] & 0x01) ? TRUE : FALSE);
+			openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, tsValid);
+			openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, tsUncertain);
 
-			if (pHdr[HIDX_OPENAVB_CTRL_FORMAT8] == MAP_CTRL_OPENAVB_FORMAT) {
-				U16 payloadLen = ntohs(*(U16 *)(&pHdr[HIDX_OPENAVB_CTRL_DATALEN16]));
+			if (pMsg[MIDX_OPENAVB_CTRL_FORMAT8] == MAP_CTRL_OPENAVB_FORMAT) {
 				if (pMediaQItem->itemSize >= payloadLen) {
-					memcpy(pMediaQItem->pPubData, pPayload, payloadLen);
+					memcpy(pMediaQItem->pPubData, pMsg + OPENAVB_FORMAT_HEADER_SIZE, payloadLen);
 					pMediaQItem->dataLen = payloadLen;
 				}
 				else {
@@ -410,15 +494,12 @@ bool openavbMapCtrlRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 			}
 
 			openavbMediaQHeadPush(pMediaQ);
-			AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
-			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
-			return TRUE;
-		}
-		else {
-			IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Media queue full.");
-			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
-			return FALSE;   // Media queue full
+			offset += OPENAVB_FORMAT_HEADER_SIZE + payloadLen;
 		}
+
+		AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
+		AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+		return TRUE;
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
 	return FALSE;
@@ -469,6 +550,7 @@ extern DLL_EXPORT bool openavbMapCtrlInitialize(media_q_t *pMediaQ, openavb_map_
 
 		pPvtData->itemCount = 20;
 		pPvtData->txInterval = 0;
+		pPvtData->maxMessages = 1;
 		pPvtData->maxTransitUsec = inMaxTransitUsec;
 
 		pPvtData->maxPayloadSize = 1024;
@@ -64,6 +64,21 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #define MAX_PAYLOAD_SIZE 1412
 
+// RFC 6184 FU-A: FU indicator and FU header precede each fragment
+#define FU_A_TYPE					28
+#define FU_A_HEADER_SIZE			2
+#define FU_S_BIT					0x80
+#define FU_E_BIT					0x40
+
+// RFC 6184 STAP-A: aggregated NAL units, each preceded by a 16 bit size
+#define STAP_A_TYPE					24
+
+// - 1 byte		AVTP sequence number, read when reassembling
+#define HIDX_AVTP_SEQ_NUM8			2
+
+// Item size used for reassembled access units when map_nv_item_size isn't set
+#define DEFAULT_FRAME_ITEM_SIZE		(256 * 1024)
+
 //////
 // AVTP Version 0 Header
 //////
@@ -121,6 +136,15 @@ typedef struct {
 	// Max payload size
 	U32 maxPayloadSize;
 
+	// map_nv_item_size: item storage for NAL unit items. 0 = max payload size.
+	U32 cfgItemSize;
+
+	// map_nv_reassemble: listener rebuilds whole access units in one item
+	bool reassemble;
+
+	// map_nv_drop_on_gap: drop an access unit that lost a packet
+	bool dropOnGap;
+
 	/////////////
 	// Variable data
 	/////////////
@@ -133,6 +157,19 @@ typedef struct {
 	// Maximum media queue item size
 	U32 itemSize;
 
+	// Position in the NAL unit item at the tail. Valid while nalItemOpen.
+	bool nalItemOpen;
+	U32 nalStart;		// First byte of the current NAL unit (its header)
+	U32 nalEnd;			// One past its last byte
+	bool fuActive;		// Current NAL unit is being sent as FU-A fragments
+
+	// Listener reassembly state
+	bool asmDrop;		// Discarding up to the end of a damaged access unit
+	bool asmSeqValid;
+	U8 asmSeq;			// Sequence number of the last packet seen
+	U32 asmFrames;
+	U32 asmDropped;
+
 } pvt_data_t;
 
 
@@ -168,6 +205,15 @@ void openavbMapH264CfgCB(media_q_t *pMediaQ, const char *name, const char *value
 			pPvtData->maxDataSize = (pPvtData->maxPayloadSize + TOTAL_HEADER_SIZE);
 			pPvtData->itemSize =	pPvtData->maxPayloadSize;
 		}
+		else if (strcmp(name, "map_nv_item_size") == 0) {
+			pPvtData->cfgItemSize = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_reassemble") == 0) {
+			pPvtData->reassemble = (strtol(value, &pEnd, 10) == 1);
+		}
+		else if (strcmp(name, "map_nv_drop_on_gap") == 0) {
+			pPvtData->dropOnGap = (strtol(value, &pEnd, 10) == 1);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -233,6 +279,11 @@ void openavbMapH264GenInitCB(media_q_t *pMediaQ)
 			return;
 		}
 
+		if (pPvtData->cfgItemSize > pPvtData->itemSize)
+			pPvtData->itemSize = pPvtData->cfgItemSize;
+		else if (pPvtData->reassemble && !pPvtData->cfgItemSize)
+			pPvtData->itemSize = DEFAULT_FRAME_ITEM_SIZE;
+
 		openavbMediaQSetSize(pMediaQ, pPvtData->itemCount, pPvtData->itemSize);
 		openavbMediaQAllocItemMapData(pMediaQ, sizeof(media_q_item_map_h264_pub_data_t), 0);
 	}
@@ -247,6 +298,91 @@ void openavbMapH264TxInitCB(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Find the next NAL unit in an item at or after offset. An item that does not
+// start with a start code is taken to be a single NAL unit.
+static bool x_nextNal(const U8 *pItem, U32 dataLen, U32 offset, U32 *pStart, U32 *pEnd)
+{
+	U32 i = offset;
+
+	if (offset == 0 && !(dataLen >= 3 && pItem[0] == 0 && pItem[1] == 0 && (pItem[2] == 1 || (dataLen >= 4 && pItem[2] == 0 && pItem[3] == 1)))) {
+		*pStart = 0;
+		*pEnd = dataLen;
+		return dataLen > 0;
+	}
+
+	// Skip the zero bytes and 0x01 of the start code
+	while (i < dataLen && pItem[i] == 0)
+		i++;
+	if (i >= dataLen || pItem[i] != 1)
+		return FALSE;
+	i++;
+	if (i >= dataLen)
+		return FALSE;
+	*pStart = i;
+
+	// The NAL unit runs up to the next 00 00 01, less any zero bytes before it
+	for (; i + 2 < dataLen; i++) {
+		if (pItem[i + 2] > 1)
+			i += 2;
+		else if (pItem[i] == 0 && pItem[i + 1] == 0 && pItem[i + 2] == 1)
+			break;
+	}
+	if (i + 2 >= dataLen)
+		i = dataLen;
+	while (i > *pStart && pItem[i - 1] == 0)
+		i--;
+	*pEnd = i;
+	return *pEnd > *pStart;
+}
+
+// Build the next packet of a NAL unit item into pPayload. Returns the payload
+// length and sets *pLast once the item has been completely sent.
+static U32 x_nalItemPacket(pvt_data_t *pPvtData, media_q_item_t *pMediaQItem, U8 *pPayload, bool *pLast)
+{
+	const U8 *pItem = pMediaQItem->pPubData;
+	U32 len;
+
+	if (!pPvtData->fuActive) {
+		len = pPvtData->nalEnd - pPvtData->nalStart;
+		if (len <= pPvtData->maxPayloadSize) {
+			// Single NAL unit packet
+			memcpy(pPayload, pItem + pPvtData->nalStart, len);
+			pMediaQItem->readIdx = pPvtData->nalEnd;
+		}
+		else {
+			// First FU-A fragment. The NAL header is carried in the FU indicator and header.
+			pPvtData->fuActive = TRUE;
+			pMediaQItem->readIdx = pPvtData->nalStart + 1;
+		}
+	}
+
+	if (pPvtData->fuActive) {
+		U8 nalHdr = pItem[pPvtData->nalStart];
+		bool first = (pMediaQItem->readIdx == pPvtData->nalStart + 1);
+
+		len = pPvtData->nalEnd - pMediaQItem->readIdx;
+		if (len > pPvtData->maxPayloadSize - FU_A_HEADER_SIZE)
+			len = pPvtData->maxPayloadSize - FU_A_HEADER_SIZE;
+
+		pPayload[0] = (nalHdr & 0xE0) | FU_A_TYPE;
+		pPayload[1] = (nalHdr & 0x1F) | (first ? FU_S_BIT : 0);
+		memcpy(pPayload + FU_A_HEADER_SIZE, pItem + pMediaQItem->readIdx, len);
+		pMediaQItem->readIdx += len;
+		if (pMediaQItem->readIdx >= pPvtData->nalEnd) {
+			pPayload[1] |= FU_E_BIT;
+			pPvtData->fuActive = FALSE;
+		}
+		len += FU_A_HEADER_SIZE;
+	}
+
+	*pLast = FALSE;
+	if (!pPvtData->fuActive) {
+		if (!x_nextNal(pItem, pMediaQItem->dataLen, pPvtData->nalEnd, &pPvtData->nalStart, &pPvtData->nalEnd))
+			*pLast = TRUE;
+	}
+	return len;
+}
+
 // This talker callback will be called for each AVB observation interval.
 tx_cb_ret_t openavbMapH264TxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 {
@@ -270,9 +406,57 @@ tx_cb_ret_t openavbMapH264TxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 
 		media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
 		if (pMediaQItem) {
+			media_q_item_map_h264_pub_data_t *pPubMapData = pMediaQItem->pPubMapData;
+
+			if (pPubMapData->nalUnits && pMediaQItem->dataLen > 0) {
+				bool last;
+
+				if (!pPvtData->nalItemOpen) {
+					if (!x_nextNal(pMediaQItem->pPubData, pMediaQItem->dataLen, 0, &pPvtData->nalStart, &pPvtData->nalEnd)) {
+						IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("No NAL unit found in media queue item.");
+						openavbMediaQTailPull(pMediaQ);
+						AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+						return TX_CB_RET_PACKET_NOT_READY;
+					}
+					pPvtData->nalItemOpen = TRUE;
+					pPvtData->fuActive = FALSE;
+
+					// Every packet of the item shares its timestamp
+					openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, pPvtData->maxTransitUsec);
+				}
+
+				if (openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime))
+					pHdr[HIDX_AVTP_HIDE7_TV1] |= 0x01;
+				else
+					pHdr[HIDX_AVTP_HIDE7_TV1] &= ~0x01;
+				if (openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime))
+					pHdr[HIDX_AVTP_HIDE7_TU1] |= 0x01;
+				else
+					pHdr[HIDX_AVTP_HIDE7_TU1] &= ~0x01;
+				*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]) = htonl(openavbAvtpTimeGetAvtpTimestamp(pMediaQItem->pAvtpTime));
+
+				U32 payloadLen = x_nalItemPacket(pPvtData, pMediaQItem, pPayload, &last);
+
+				pHdr[HIDX_M31_M21_M11_M01_EVT2_RESV2] = (last && pPubMapData->lastPacket) ? 0x10 : 0x00;
+				*(U16 *)(&pHdr[HIDX_STREAM_DATA_LEN16]) = htons(payloadLen);
+				*dataLen = payloadLen + TOTAL_HEADER_SIZE;
+
+				if (last) {
+					pPvtData->nalItemOpen = FALSE;
+					openavbMediaQTailPull(pMediaQ);
+				}
+				else {
+					openavbMediaQTailUnlock(pMediaQ);
+				}
+
+				AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
+				AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+				return TX_CB_RET_PACKET_READY;
+			}
+
 			if (pMediaQItem->dataLen > 0) {
-				if (pMediaQItem->dataLen > pPvtData->itemSize) {
-					AVB_LOGF_ERROR("Media queue data item size too large. Reported size: %d  Max Size: %d", pMediaQItem->dataLen, pPvtData->itemSize);
+				if (pMediaQItem->dataLen > pPvtData->maxPayloadSize) {
+					AVB_LOGF_ERROR("Media queue data item size too large. Reported size: %d  Max Size: %d", pMediaQItem->dataLen, pPvtData->maxPayloadSize);
 					AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
 					openavbMediaQTailPull(pMediaQ);
 					return TX_CB_RET_PACKET_NOT_READY;
@@ -296,7 +480,7 @@ tx_cb_ret_t openavbMapH264TxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 				// Set the timestamp.
 				*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]) = htonl(openavbAvtpTimeGetAvtpTimestamp(pMediaQItem->pAvtpTime));
 
-				if (((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->lastPacket) {
+				if (pPubMapData->lastPacket) {
 					pHdr[HIDX_M31_M21_M11_M01_EVT2_RESV2] = 0x10;;
 				}
 				else {
@@ -337,6 +521,131 @@ void openavbMapH264RxInitCB(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Append one NAL unit, with a start code, to a reassembled item
+static inline bool x_asmAppend(media_q_item_t *pMediaQItem, const U8 *pNal, U32 len, bool startCode)
+{
+	U8 *pDst = (U8 *)pMediaQItem->pPubData + pMediaQItem->dataLen;
+
+	if (pMediaQItem->dataLen + (startCode ? 4 : 0) + len > pMediaQItem->itemSize)
+		return FALSE;
+	if (startCode) {
+		pDst[0] = 0x00; pDst[1] = 0x00; pDst[2] = 0x00; pDst[3] = 0x01;
+		pDst += 4;
+		pMediaQItem->dataLen += 4;
+	}
+	memcpy(pDst, pNal, len);
+	pMediaQItem->dataLen += len;
+	return TRUE;
+}
+
+// Depacketize one RTP payload onto the end of the access unit being built
+static bool x_asmPayload(media_q_item_t *pMediaQItem, const U8 *pPayload, U32 payloadLen)
+{
+	if (payloadLen < 1)
+		return FALSE;
+
+	U8 type = pPayload[0] & 0x1F;
+
+	if (type >= 1 && type <= 23) {
+		return x_asmAppend(pMediaQItem, pPayload, payloadLen, TRUE);
+	}
+	else if (type == STAP_A_TYPE) {
+		U32 offset = 1;
+		while (offset + 2 <= payloadLen) {
+			U32 nalLen = (pPayload[offset] << 8) | pPayload[offset + 1];
+			offset += 2;
+			if (nalLen == 0 || offset + nalLen > payloadLen)
+				return FALSE;
+			if (!x_asmAppend(pMediaQItem, pPayload + offset, nalLen, TRUE))
+				return FALSE;
+			offset += nalLen;
+		}
+		return TRUE;
+	}
+	else if (type == FU_A_TYPE) {
+		if (payloadLen < FU_A_HEADER_SIZE)
+			return FALSE;
+		if (pPayload[1] & FU_S_BIT) {
+			U8 nalHdr = (pPayload[0] & 0xE0) | (pPayload[1] & 0x1F);
+			if (!x_asmAppend(pMediaQItem, &nalHdr, 1, TRUE))
+				return FALSE;
+		}
+		else if (pMediaQItem->dataLen == 0) {
+			return FALSE;	// Continuation without its start
+		}
+		return x_asmAppend(pMediaQItem, pPayload + FU_A_HEADER_SIZE, payloadLen - FU_A_HEADER_SIZE, FALSE);
+	}
+	return FALSE;
+}
+
+// Listener reassembly. Packets are depacketized into the head item, which
+// stays locked between packets, and the item is pushed as one Annex B access
+// unit when the M0 bit arrives.
+static bool x_asmRx(media_q_t *pMediaQ, pvt_data_t *pPvtData, U8 *pHdr, U8 *pPayload, U16 payloadLen)
+{
+	bool last = (pHdr[HIDX_M31_M21_M11_M01_EVT2_RESV2] & 0x10) ? TRUE : FALSE;
+	U8 seq = pHdr[HIDX_AVTP_SEQ_NUM8];
+
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem) {
+		IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Media queue full");
+		pPvtData->asmSeq = seq;
+		if (!pPvtData->asmDrop) {
+			pPvtData->asmDrop = TRUE;
+			pPvtData->asmDropped++;
+		}
+		if (last)
+			pPvtData->asmDrop = FALSE;
+		return FALSE;
+	}
+
+	// A gap may have taken the start of this access unit, so drop it even when nothing is buffered yet
+	if (pPvtData->dropOnGap && pPvtData->asmSeqValid && seq != (U8)(pPvtData->asmSeq + 1)) {
+		if (!pPvtData->asmDrop) {
+			IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Sequence gap (%u after %u). Dropping access unit.", seq, pPvtData->asmSeq);
+			pPvtData->asmDropped++;
+		}
+		pPvtData->asmDrop = TRUE;
+	}
+	pPvtData->asmSeq = seq;
+	pPvtData->asmSeqValid = TRUE;
+
+	if (!pPvtData->asmDrop) {
+		if (pMediaQItem->dataLen == 0) {
+			// The first packet of the access unit supplies its timestamp
+			U32 timestamp = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESPAMP32]));
+			openavbAvtpTimeSetToTimestamp(pMediaQItem->pAvtpTime, timestamp);
+			openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE);
+			openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TU1] & 0x01) ? TRUE : FALSE);
+		}
+
+		if (!x_asmPayload(pMediaQItem, pPayload, payloadLen)) {
+			IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Unusable packet or access unit larger than item (%u). Dropping access unit.", pMediaQItem->itemSize);
+			pPvtData->asmDrop = TRUE;
+			pPvtData->asmDropped++;
+		}
+	}
+
+	if (pPvtData->asmDrop) {
+		pMediaQItem->dataLen = 0;
+		if (last)
+			pPvtData->asmDrop = FALSE;
+		openavbMediaQHeadUnlock(pMediaQ);
+		return TRUE;
+	}
+
+	if (last) {
+		((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->lastPacket = TRUE;
+		((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->nalUnits = TRUE;
+		openavbMediaQHeadPush(pMediaQ);
+		pPvtData->asmFrames++;
+	}
+	else {
+		openavbMediaQHeadUnlock(pMediaQ);
+	}
+	return TRUE;
+}
+
 // This callback occurs when running as a listener and data is available.
 bool openavbMapH264RxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 {
@@ -344,7 +653,11 @@ bool openavbMapH264RxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 	if (pMediaQ && pData) {
 		U8 *pHdr = pData;
 		U8 *pPayload = pData + TOTAL_HEADER_SIZE;
-
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return FALSE;
+		}
 
 		//pHdr[HIDX_AVTP_TIMESPAMP32]
 		//pHdr[HIDX_FORMAT8]
@@ -362,6 +675,13 @@ bool openavbMapH264RxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 			return FALSE;
 		}
 
+		if (pPvtData->reassemble) {
+			bool ret = x_asmRx(pMediaQ, pPvtData, pHdr, pPayload, payloadLen);
+			AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return ret;
+		}
+
 		// Get item pointer in media queue
 		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
 		if (pMediaQItem) {
@@ -377,6 +697,7 @@ bool openavbMapH264RxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 				((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->lastPacket = TRUE;
 			else
 				((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->lastPacket = FALSE;
+			((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->nalUnits = FALSE;
 
 			if (pMediaQItem->itemSize >= payloadLen) {
 				memcpy(pMediaQItem->pPubData, pPayload, payloadLen);
@@ -407,6 +728,12 @@ bool openavbMapH264RxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 void openavbMapH264EndCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData && pPvtData->reassemble) {
+			AVB_LOGF_INFO("Reassembled %u access units, dropped %u", pPvtData->asmFrames, pPvtData->asmDropped);
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
@@ -447,6 +774,7 @@ extern DLL_EXPORT bool openavbMapH264Initialize(media_q_t *pMediaQ, openavb_map_
 
 		pPvtData->itemCount = 20;
 		pPvtData->txInterval = 0;
+		pPvtData->dropOnGap = TRUE;
 		pPvtData->maxTransitUsec = inMaxTransitUsec;
 
 		pPvtData->maxPayloadSize = MAX_PAYLOAD_SIZE;
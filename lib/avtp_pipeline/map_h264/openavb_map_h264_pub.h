@@ -50,9 +50,23 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // that is why a single static (static/extern pattern) definition can not be used.
 #define MapH264MediaQDataFormat "H.264"
 
+/*
+* A talker item normally holds one RTP payload (RFC 6184) that fits in a frame. An interface may instead set
+* nalUnits and place a whole NAL unit, or an access unit of NAL units in Annex B byte stream form with start codes,
+* in one item. The mapping then sends each NAL unit that fits as a single NAL unit packet and splits larger ones into
+* FU-A fragments, reading them straight out of the item. lastPacket then marks the item as the end of an access unit
+* and M0 is set on its final packet only.
+*
+* Listeners receive one RTP payload per item with nalUnits FALSE, unless map_nv_reassemble is set. The mapping then
+* depacketizes single NAL unit, STAP-A and FU-A packets into one item per access unit in Annex B byte stream form,
+* pushed with nalUnits and lastPacket TRUE once M0 arrives.
+*/
 typedef struct {
 	// Last fragment of frame flag.
 	bool lastPacket;		// For details see 1722a 9.4.3.1.1 M0 field
+
+	// Item holds whole NAL units to be fragmented by the mapping
+	bool nalUnits;
 } media_q_item_map_h264_pub_data_t;
 
 #endif  // OPENAVB_MAP_H264_PUB_H
@@ -40,6 +40,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_mediaq_pub.h"
 #include "openavb_map_pub.h"
 #include "openavb_map_mjpeg_pub.h"
+#include "openavb_jpeg_scan_pub.h"
 
 #define	AVB_LOG_COMPONENT	"MJPEG Mapping"
 #include "openavb_log_pub.h"
@@ -58,6 +59,19 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #define ITEM_SIZE					MAX_JPEG_PAYLOAD_SIZE
 
+// Item size used for reassembled frames when map_nv_item_size isn't set
+#define DEFAULT_FRAME_ITEM_SIZE		(256 * 1024)
+
+// RFC 2435 header sizes
+#define JPEG_MAIN_HEADER_SIZE		8
+#define JPEG_RESTART_HEADER_SIZE	4
+#define JPEG_QTABLE_HEADER_SIZE		4
+
+// RFC 2435 restart header F and L bits, and the largest restart count
+#define JPEG_RESTART_F				0x8000
+#define JPEG_RESTART_L				0x4000
+#define JPEG_RESTART_COUNT_MAX		0x3FFF
+
 //////
 // AVTP Version 0 Header
 //////
@@ -68,6 +82,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // - 1 Byte - TV bit (timestamp valid)
 #define HIDX_AVTP_HIDE7_TV1			1
 
+// - 1 Byte - sequence number, read when reassembling
+#define HIDX_AVTP_SEQ_NUM8			2
+
 // - 1 Byte - TU bit (timestamp uncertain)
 #define HIDX_AVTP_HIDE7_TU1			3
 
@@ -102,6 +119,13 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // - 1 byte		Reserved					= binary 0x00
 #define HIDX_RESV8					23
 
+// One fragment of a frame item
+typedef struct {
+	U32 offset;				// Fragment offset, from the start of the JPEG data
+	U32 len;				// Bytes of JPEG data
+	U16 restart;			// F and L bits and restart count, with restart markers
+} mjpeg_frag_t;
+
 typedef struct {
 	/////////////
 	// Config data
@@ -112,6 +136,18 @@ typedef struct {
 	// Transmit interval in frames per second. 0 = default for talker class.
 	U32 txInterval;
 
+	// map_nv_item_size: item storage for reassembled frames
+	U32 itemSize;
+
+	// map_nv_reassemble: listener rebuilds whole frames in one item
+	bool reassemble;
+
+	// map_nv_drop_on_gap: drop a frame that lost a fragment
+	bool dropOnGap;
+
+	// map_nv_fragment: talker items hold whole frames that the mapping fragments
+	bool fragment;
+
 	/////////////
 	// Variable data
 	/////////////
@@ -119,6 +155,24 @@ typedef struct {
 
 	U32 timestamp;
 	bool tsvalid;
+
+	// Listener reassembly state
+	bool asmDrop;			// Discarding up to the end of a damaged frame
+	bool asmSeqValid;
+	U8 asmSeq;				// Sequence number of the last packet seen
+	U32 asmHdrLen;			// RFC 2435 headers at the start of the frame item
+	U32 asmFrames;
+	U32 asmDropped;
+
+	// Talker fragmentation state, planned when the first fragment of a frame is sent
+	mjpeg_frag_t *pFrags;
+	U32 fragMax;			// Room in pFrags
+	U32 fragCount;			// Fragments of the frame in the tail item
+	U32 fragIdx;			// Next fragment to send
+	U32 fragHdrLen;			// RFC 2435 headers at the start of the frame item
+	U32 fragRestHdrLen;		// Headers of every fragment but the first
+	U32 fragFrames;
+	U32 fragDropped;
 } pvt_data_t;
 
 
@@ -144,6 +198,22 @@ void openavbMapMjpegCfgCB(media_q_t *pMediaQ, const char *name, const char *valu
 			char *pEnd;
 			pPvtData->txInterval = strtol(value, &pEnd, 10);
 		}
+		else if (strcmp(name, "map_nv_item_size") == 0) {
+			char *pEnd;
+			pPvtData->itemSize = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_reassemble") == 0) {
+			char *pEnd;
+			pPvtData->reassemble = (strtol(value, &pEnd, 10) == 1);
+		}
+		else if (strcmp(name, "map_nv_drop_on_gap") == 0) {
+			char *pEnd;
+			pPvtData->dropOnGap = (strtol(value, &pEnd, 10) == 1);
+		}
+		else if (strcmp(name, "map_nv_fragment") == 0) {
+			char *pEnd;
+			pPvtData->fragment = (strtol(value, &pEnd, 10) == 1);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -202,7 +272,12 @@ void openavbMapMjpegGenInitCB(media_q_t *pMediaQ)
 		pPvtData->timestamp = 0;
 		pPvtData->tsvalid = FALSE;
 
-		openavbMediaQSetSize(pMediaQ, pPvtData->itemCount, ITEM_SIZE);
+		if ((pPvtData->reassemble || pPvtData->fragment) && !pPvtData->itemSize)
+			pPvtData->itemSize = DEFAULT_FRAME_ITEM_SIZE;
+		if (pPvtData->itemSize < ITEM_SIZE)
+			pPvtData->itemSize = ITEM_SIZE;
+
+		openavbMediaQSetSize(pMediaQ, pPvtData->itemCount, pPvtData->itemSize);
 		openavbMediaQAllocItemMapData(pMediaQ, sizeof(media_q_item_map_mjpeg_pub_data_t), 0);
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -213,9 +288,213 @@ void openavbMapMjpegGenInitCB(media_q_t *pMediaQ)
 void openavbMapMjpegTxInitCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData && pPvtData->fragment && !pPvtData->pFrags) {
+			// A fragment and the one after it hold more than a full fragment of
+			// data, so this is plenty even for the smaller first fragment
+			pPvtData->fragMax = 4 * (pPvtData->itemSize / MAX_JPEG_PAYLOAD_SIZE) + 4;
+			pPvtData->pFrags = calloc(pPvtData->fragMax, sizeof(mjpeg_frag_t));
+			if (!pPvtData->pFrags) {
+				AVB_LOG_ERROR("Unable to allocate the fragment table.");
+				pPvtData->fragMax = 0;
+			}
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Forward declaration, the helper is shared with the listener
+static U32 x_jpegHeaderLen(const U8 *pPayload, U32 payloadLen);
+
+// Set the timestamp and its flags. Every fragment of a frame carries the
+// timestamp of its first one.
+static void x_txSetTime(pvt_data_t *pPvtData, media_q_item_t *pMediaQItem, U8 *pHdr, bool lastFragment)
+{
+	// Set timestamp valid flag
+	if (openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime)) {
+		pHdr[HIDX_AVTP_HIDE7_TV1] |= 0x01;      // Set
+	}
+	else {
+		pHdr[HIDX_AVTP_HIDE7_TV1] &= ~0x01;     // Clear
+	}
+
+	// Set timestamp uncertain flag
+	if (openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime)) {
+		pHdr[HIDX_AVTP_HIDE7_TU1] |= 0x01;      // Set
+	}
+	else {
+		pHdr[HIDX_AVTP_HIDE7_TU1] &= ~0x01;     // Clear
+	}
+
+	// Set the timestamp.
+	// 1722a-D6: The avtp_timestamp represents the presentation time associated with the given frame. The same avtp_timestamp
+	// shall appear in each fragment of a given frame. The M0 marker bit shall be set in the last packet of a frame.
+	if (!pPvtData->tsvalid)
+	{
+		pPvtData->timestamp = openavbAvtpTimeGetAvtpTimestamp(pMediaQItem->pAvtpTime);
+		pPvtData->tsvalid = TRUE;
+	}
+	*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32]) = htonl(pPvtData->timestamp);
+
+	if (lastFragment) {
+		pHdr[HIDX_M11_M01_EVT2_RESV2] = 0x00 | (1 << 4);
+		pPvtData->tsvalid = FALSE;
+	}
+	else {
+		pHdr[HIDX_M11_M01_EVT2_RESV2] = 0x00;
+	}
+}
+
+static bool x_fragAdd(pvt_data_t *pPvtData, U32 offset, U32 len, U16 restart)
+{
+	if (pPvtData->fragCount >= pPvtData->fragMax)
+		return FALSE;
+	pPvtData->pFrags[pPvtData->fragCount].offset = offset;
+	pPvtData->pFrags[pPvtData->fragCount].len = len;
+	pPvtData->pFrags[pPvtData->fragCount].restart = restart;
+	pPvtData->fragCount++;
+	return TRUE;
+}
+
+// Plan the fragments of a frame item, which holds a single RFC 2435 payload
+// at fragment offset 0. Without restart markers the JPEG data is cut where
+// the packets are full. With them (RFC 2435 3.1.7) each fragment carries as
+// many whole restart intervals as fit, so a receiver can decode around a lost
+// packet; an interval too large for one packet is spread over several, F set
+// on the first and L on the last. The interval ends come from a single scan of
+// the frame.
+static bool x_fragPlan(pvt_data_t *pPvtData, const U8 *pItem, U32 itemLen)
+{
+	U32 hdrLen = x_jpegHeaderLen(pItem, itemLen);
+	if (!hdrLen || hdrLen >= MAX_JPEG_PAYLOAD_SIZE || hdrLen == itemLen)
+		return FALSE;
+	if (((pItem[1] << 16) | (pItem[2] << 8) | pItem[3]) != 0)
+		return FALSE;
+
+	bool restart = (pItem[4] >= 64 && pItem[4] <= 127);
+	const U8 *pJpeg = pItem + hdrLen;
+	U32 len = itemLen - hdrLen;
+	U32 firstMax = MAX_JPEG_PAYLOAD_SIZE - hdrLen;
+	U32 restMax;
+
+	pPvtData->fragHdrLen = hdrLen;
+	pPvtData->fragRestHdrLen = JPEG_MAIN_HEADER_SIZE + (restart ? JPEG_RESTART_HEADER_SIZE : 0);
+	pPvtData->fragCount = 0;
+	restMax = MAX_JPEG_PAYLOAD_SIZE - pPvtData->fragRestHdrLen;
+
+	if (!restart) {
+		U32 start = 0;
+		while (start < len) {
+			U32 n = len - start;
+			U32 max = start ? restMax : firstMax;
+			if (n > max)
+				n = max;
+			if (!x_fragAdd(pPvtData, start, n, 0))
+				return FALSE;
+			start += n;
+		}
+		return TRUE;
+	}
+
+	U32 start = 0;			// Start of the fragment being planned
+	U32 cut = 0;			// End of the last whole interval that fits in it
+	U32 intervals = 0;		// Restart intervals ending at or before cut
+	U32 first = 0;			// Restart interval the fragment starts with
+	while (start < len) {
+		// End of the restart interval following cut
+		U32 m = openavbJpegScanNext(pJpeg, len, cut);
+		while (m < len && !JPEG_MARKER_IS_RST(pJpeg[m + 1]))
+			m = openavbJpegScanNext(pJpeg, len, m + 1);
+		U32 end = (m < len) ? m + 2 : len;
+		U32 max = start ? restMax : firstMax;
+
+		if (end - start <= max) {
+			// The interval fits, keep adding
+			cut = end;
+			intervals++;
+			if (end < len)
+				continue;
+		}
+		else if (cut == start) {
+			// The interval alone doesn't fit, spread it over several fragments
+			U16 flags = JPEG_RESTART_F;
+			while (end - start > max) {
+				if (!x_fragAdd(pPvtData, start, max, flags | (first % JPEG_RESTART_COUNT_MAX)))
+					return FALSE;
+				start += max;
+				flags = 0;
+				max = restMax;
+			}
+			if (!x_fragAdd(pPvtData, start, end - start, flags | JPEG_RESTART_L | (first % JPEG_RESTART_COUNT_MAX)))
+				return FALSE;
+			start = cut = end;
+			first = ++intervals;
+			continue;
+		}
+
+		// Send the whole intervals up to cut
+		if (!x_fragAdd(pPvtData, start, cut - start, JPEG_RESTART_F | JPEG_RESTART_L | (first % JPEG_RESTART_COUNT_MAX)))
+			return FALSE;
+		start = cut;
+		first = intervals;
+	}
+	return TRUE;
+}
+
+// Talker side of map_nv_fragment. The tail item stays locked until its last
+// fragment has been sent.
+static tx_cb_ret_t x_fragTx(media_q_t *pMediaQ, pvt_data_t *pPvtData, media_q_item_t *pMediaQItem, U8 *pHdr, U8 *pPayload, U32 *dataLen)
+{
+	const U8 *pItem = pMediaQItem->pPubData;
+
+	if (pPvtData->fragIdx == 0) {
+		if (!pPvtData->pFrags || !x_fragPlan(pPvtData, pItem, pMediaQItem->dataLen)) {
+			IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Item isn't an RFC 2435 frame or has too many fragments (%u bytes). Dropping frame.", pMediaQItem->dataLen);
+			pPvtData->fragDropped++;
+			openavbMediaQTailPull(pMediaQ);
+			*dataLen = 0;
+			return TX_CB_RET_PACKET_NOT_READY;
+		}
+
+		// PTP walltime already set in the interface module. Just add the max transit time.
+		openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, pPvtData->maxTransitUsec);
+	}
+
+	mjpeg_frag_t *pFrag = &pPvtData->pFrags[pPvtData->fragIdx];
+	bool last = (pPvtData->fragIdx + 1 == pPvtData->fragCount);
+	x_txSetTime(pPvtData, pMediaQItem, pHdr, last);
+
+	// The frame headers with this fragment's offset and restart flags; only
+	// the first fragment carries the quantization tables.
+	U32 hdrLen = pFrag->offset ? pPvtData->fragRestHdrLen : pPvtData->fragHdrLen;
+	memcpy(pPayload, pItem, hdrLen);
+	pPayload[1] = (pFrag->offset >> 16) & 0xFF;
+	pPayload[2] = (pFrag->offset >> 8) & 0xFF;
+	pPayload[3] = pFrag->offset & 0xFF;
+	if (pPvtData->fragRestHdrLen > JPEG_MAIN_HEADER_SIZE) {
+		pPayload[JPEG_MAIN_HEADER_SIZE + 2] = pFrag->restart >> 8;
+		pPayload[JPEG_MAIN_HEADER_SIZE + 3] = pFrag->restart & 0xFF;
+	}
+	memcpy(pPayload + hdrLen, pItem + pPvtData->fragHdrLen + pFrag->offset, pFrag->len);
+
+	*(U16 *)(&pHdr[HIDX_STREAM_DATA_LEN16]) = hdrLen + pFrag->len;
+
+	// Set out bound data length (entire packet length)
+	*dataLen = hdrLen + pFrag->len + TOTAL_HEADER_SIZE;
+
+	if (last) {
+		pPvtData->fragIdx = 0;
+		pPvtData->fragFrames++;
+		openavbMediaQTailPull(pMediaQ);
+	}
+	else {
+		pPvtData->fragIdx++;
+		openavbMediaQTailUnlock(pMediaQ);
+	}
+	return TX_CB_RET_PACKET_READY;
+}
+
 // This talker callback will be called for each AVB observation interval.
 tx_cb_ret_t openavbMapMjpegTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 {
@@ -241,6 +520,13 @@ tx_cb_ret_t openavbMapMjpegTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 		media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
 		if (pMediaQItem) {
 			if (pMediaQItem->dataLen > 0) {
+				if (pPvtData->fragment) {
+					tx_cb_ret_t ret = x_fragTx(pMediaQ, pPvtData, pMediaQItem, pHdr, pPayload, dataLen);
+					AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
+					AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+					return ret;
+				}
+
 				if (pMediaQItem->dataLen > ITEM_SIZE) {
 					AVB_LOGF_ERROR("Media queue data item size too large. Reported size: %d  Max Size: %d", pMediaQItem->dataLen, ITEM_SIZE);
 					AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
@@ -251,39 +537,8 @@ tx_cb_ret_t openavbMapMjpegTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 				// PTP walltime already set in the interface module. Just add the max transit time.
 				openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, pPvtData->maxTransitUsec);
 
-				// Set timestamp valid flag
-				if (openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime)) {
-					pHdr[HIDX_AVTP_HIDE7_TV1] |= 0x01;      // Set
-				}
-				else {
-					pHdr[HIDX_AVTP_HIDE7_TV1] &= ~0x01;     // Clear
-				}
-
-				// Set timestamp uncertain flag
-				if (openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime)) {
-					pHdr[HIDX_AVTP_HIDE7_TU1] |= 0x01;      // Set
-				}
-				else {
-					pHdr[HIDX_AVTP_HIDE7_TU1] &= ~0x01;     // Clear
-				}
-
-				// Set the timestamp.
-				// 1722a-D6: The avtp_timestamp represents the presentation time associated with the given frame. The same avtp_timestamp
-				// shall appear in each fragment of a given frame. The M0 marker bit shall be set in the last packet of a frame.
-				if (!pPvtData->tsvalid)
-				{
-					pPvtData->timestamp = openavbAvtpTimeGetAvtpTimestamp(pMediaQItem->pAvtpTime);
-					pPvtData->tsvalid = TRUE;
-				}
-				*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32]) = htonl(pPvtData->timestamp);
-
-				if (((media_q_item_map_mjpeg_pub_data_t *)pMediaQItem->pPubMapData)->lastFragment) {
-					pHdr[HIDX_M11_M01_EVT2_RESV2] = 0x00 | (1 << 4);
-					pPvtData->tsvalid = FALSE;
-				}
-				else {
-					pHdr[HIDX_M11_M01_EVT2_RESV2] = 0x00;
-				}
+				x_txSetTime(pPvtData, pMediaQItem, pHdr,
+					((media_q_item_map_mjpeg_pub_data_t *)pMediaQItem->pPubMapData)->lastFragment);
 
 				// Copy the JPEG fragment into the outgoing avtp packet.
 				memcpy(pPayload, pMediaQItem->pPubData, pMediaQItem->dataLen);
@@ -319,6 +574,118 @@ void openavbMapMjpegRxInitCB(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Length of the RFC 2435 headers in front of the JPEG data of a payload
+static U32 x_jpegHeaderLen(const U8 *pPayload, U32 payloadLen)
+{
+	U32 len = JPEG_MAIN_HEADER_SIZE;
+	U32 offset;
+	U8 type, q;
+
+	if (payloadLen < len)
+		return 0;
+	offset = (pPayload[1] << 16) | (pPayload[2] << 8) | pPayload[3];
+	type = pPayload[4];
+	q = pPayload[5];
+
+	if (type >= 64 && type <= 127)
+		len += JPEG_RESTART_HEADER_SIZE;
+	if (q >= 128 && offset == 0) {
+		if (payloadLen < len + JPEG_QTABLE_HEADER_SIZE)
+			return 0;
+		len += JPEG_QTABLE_HEADER_SIZE + ((pPayload[len + 2] << 8) | pPayload[len + 3]);
+	}
+	return (len <= payloadLen) ? len : 0;
+}
+
+// Listener reassembly. The frame is built in the head item, which stays
+// locked between packets: the first fragment is kept whole and later ones
+// add only their JPEG data, so the pushed item is a single RFC 2435 payload
+// at fragment offset 0 holding the entire frame.
+static bool x_asmRx(media_q_t *pMediaQ, pvt_data_t *pPvtData, U8 *pHdr, U8 *pPayload, U32 payloadLen)
+{
+	bool last = (pHdr[HIDX_M11_M01_EVT2_RESV2] & 0x10) ? TRUE : FALSE;
+	U8 seq = pHdr[HIDX_AVTP_SEQ_NUM8];
+
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem) {
+		IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Media queue full.");
+		pPvtData->asmSeq = seq;
+		if (!pPvtData->asmDrop) {
+			pPvtData->asmDrop = TRUE;
+			pPvtData->asmDropped++;
+		}
+		if (last)
+			pPvtData->asmDrop = FALSE;
+		return FALSE;
+	}
+
+	// A gap may have taken the start of this frame, so drop it even when nothing is buffered yet
+	if (pPvtData->dropOnGap && pPvtData->asmSeqValid && seq != (U8)(pPvtData->asmSeq + 1)) {
+		if (!pPvtData->asmDrop) {
+			IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Sequence gap (%u after %u). Dropping frame.", seq, pPvtData->asmSeq);
+			pPvtData->asmDropped++;
+		}
+		pPvtData->asmDrop = TRUE;
+	}
+	pPvtData->asmSeq = seq;
+	pPvtData->asmSeqValid = TRUE;
+
+	if (!pPvtData->asmDrop) {
+		U32 hdrLen = x_jpegHeaderLen(pPayload, payloadLen);
+		U32 offset = hdrLen ? ((pPayload[1] << 16) | (pPayload[2] << 8) | pPayload[3]) : 0;
+		bool ok = (hdrLen != 0);
+
+		if (ok && pMediaQItem->dataLen == 0) {
+			// Need the first fragment to start a frame
+			ok = (offset == 0 && payloadLen <= pMediaQItem->itemSize);
+			if (ok) {
+				U32 timestamp = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32]));
+				openavbAvtpTimeSetToTimestamp(pMediaQItem->pAvtpTime, timestamp);
+				openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE);
+				openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TU1] & 0x01) ? TRUE : FALSE);
+
+				memcpy(pMediaQItem->pPubData, pPayload, payloadLen);
+				pMediaQItem->dataLen = payloadLen;
+				pPvtData->asmHdrLen = hdrLen;
+			}
+		}
+		else if (ok) {
+			U32 dataLen = payloadLen - hdrLen;
+			// The fragment offset must continue where the frame left off
+			ok = ((!pPvtData->dropOnGap || offset == pMediaQItem->dataLen - pPvtData->asmHdrLen)
+				&& pMediaQItem->dataLen + dataLen <= pMediaQItem->itemSize);
+			if (ok) {
+				memcpy((U8 *)pMediaQItem->pPubData + pMediaQItem->dataLen, pPayload + hdrLen, dataLen);
+				pMediaQItem->dataLen += dataLen;
+			}
+		}
+
+		if (!ok) {
+			IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Unexpected fragment or frame larger than item (%u). Dropping frame.", pMediaQItem->itemSize);
+			pPvtData->asmDrop = TRUE;
+			pPvtData->asmDropped++;
+		}
+	}
+
+	if (pPvtData->asmDrop) {
+		pMediaQItem->dataLen = 0;
+		if (last)
+			pPvtData->asmDrop = FALSE;
+		openavbMediaQHeadUnlock(pMediaQ);
+		return TRUE;
+	}
+
+	if (last) {
+		((media_q_item_map_mjpeg_pub_data_t *)pMediaQItem->pPubMapData)->lastFragment = TRUE;
+		openavbMediaQHeadPush(pMediaQ);
+		pPvtData->asmFrames++;
+	}
+	else {
+		openavbMediaQHeadUnlock(pMediaQ);
+	}
+	return TRUE;
+}
+
 // This callback occurs when running as a listener and data is available.
 bool openavbMapMjpegRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 {
@@ -329,6 +696,20 @@ bool openavbMapMjpegRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 
 //		U16 payloadLen = ntohs(*(U16 *)(&pHdr[HIDX_STREAM_DATA_LEN16]));
 		U16 payloadLen = *(U16 *)(&pHdr[HIDX_STREAM_DATA_LEN16]);
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return FALSE;
+		}
+
+		if (pPvtData->reassemble) {
+			bool ret = FALSE;
+			if (dataLen > TOTAL_HEADER_SIZE)
+				ret = x_asmRx(pMediaQ, pPvtData, pHdr, pPayload, dataLen - TOTAL_HEADER_SIZE);
+			AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return ret;
+		}
 
 		// Get item pointer in media queue
 		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
@@ -377,6 +758,18 @@ bool openavbMapMjpegRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 void openavbMapMjpegEndCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData && pPvtData->reassemble) {
+			AVB_LOGF_INFO("Reassembled %u frames, dropped %u", pPvtData->asmFrames, pPvtData->asmDropped);
+		}
+		if (pPvtData && pPvtData->pFrags) {
+			AVB_LOGF_INFO("Fragmented %u frames, dropped %u", pPvtData->fragFrames, pPvtData->fragDropped);
+			free(pPvtData->pFrags);
+			pPvtData->pFrags = NULL;
+			pPvtData->fragIdx = 0;
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
@@ -417,6 +810,7 @@ extern DLL_EXPORT bool openavbMapMjpegInitialize(media_q_t *pMediaQ, openavb_map
 
 		pPvtData->itemCount = 20;
 		pPvtData->txInterval = 0;
+		pPvtData->dropOnGap = TRUE;
 		pPvtData->maxTransitUsec = inMaxTransitUsec;
 
 		openavbMediaQSetMaxLatency(pMediaQ, inMaxTransitUsec);
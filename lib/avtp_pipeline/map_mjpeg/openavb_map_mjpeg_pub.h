@@ -60,6 +60,10 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
  *
  *  The payload will be as defined in RFC 2435 and will include the JPEG header
  *  as well as the JPEG data.
+ *
+ * With map_nv_reassemble set a listener item instead holds a whole frame: the
+ * first fragment with its headers followed by the JPEG data of the rest, i.e.
+ * one RFC 2435 payload at fragment offset 0 with lastFragment TRUE.
  */
 
 /** \note A define is used for the MediaQDataFormat identifier because it is
@@ -34,6 +34,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include <stdlib.h>
 #include <string.h>
+#include "openavb_platform_pub.h"
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_avtp_time_pub.h"
@@ -50,6 +51,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define MPEG2_TS_PKT_SIZE			188
 // MPEG2TS sync byte
 #define MPEG2_TS_SYNC_BYTE			0x47
+// PID of the NULL packets that pad a transport stream
+#define MPEG2_TS_NULL_PID			0x1FFF
 
 // GStreamer likes to pass 4096-byte buffers, so we want a buffer
 // bigger than that.  And, we're more efficient if the interface layer
@@ -168,6 +171,13 @@ typedef struct {
 	// Transmit rate in frames per second. 0 = default for talker class.
 	unsigned txRate;
 
+	// Listener-only config
+
+	// map_nv_rx_item_fill
+	// Gather the payloads of several AVTP packets into one media queue item
+	// until it holds this many bytes. 0 = one item per AVTP packet.
+	unsigned rxItemFill;
+
 	/////////////
 	// Variable data
 	/////////////
@@ -185,6 +195,16 @@ typedef struct {
 
 	unsigned int srcBitrate;
 
+	// Frame of one NULL source packet sent when the interface has no data,
+	// built at TX init. The timestamps and DBC are filled in per frame.
+	U8 nullFrame[TOTAL_HEADER_SIZE + MPEGTS_SRC_PKT_SIZE];
+
+	// Gathering items: AVTP timestamp of the first payload in the head item,
+	// and how far later payloads may be before the item is handed over
+	U32 rxItemTimestamp;
+	bool rxItemTimestampValid;
+	U32 rxItemHoldNsec;
+
 } pvt_data_t;
 
 
@@ -240,6 +260,13 @@ void openavbMapMpeg2tsCfgCB(media_q_t *pMediaQ, const char *name, const char *va
 				valueOK = TRUE;
 			}
 		}
+		else if (strcmp(name, "map_nv_rx_item_fill") == 0) {
+			tmp = strtoul(value, &pEnd, 10);
+			if (pEnd != value && *pEnd == '\0') {
+				pPvtData->rxItemFill = tmp;
+				valueOK = TRUE;
+			}
+		}
 		else {
 			AVB_LOGF_WARNING("Unknown configuration item: %s", name);
 			nameOK = FALSE;
@@ -322,23 +349,99 @@ void openavbMapMpeg2tsGenInitCB(media_q_t *pMediaQ)
 void openavbMapMpeg2tsTxInitCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+
+	if (pMediaQ && pMediaQ->pPvtMapInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		U8 *pHdr = pPvtData->nullFrame;
+		U8 *pTsPkt = pHdr + TOTAL_HEADER_SIZE + MPEGTS_SRC_PKT_HDR_SIZE;
+
+		memset(pHdr, 0, TOTAL_HEADER_SIZE);
+		*(U16 *)(pHdr + HIDX_DATALEN16) = htons(MPEGTS_SRC_PKT_SIZE + CIP_HEADER_SIZE);
+		pHdr[HIDX_TAG2_CHANNEL6] = (1 << 6) | 0x1f;
+		pHdr[HIDX_TCODE4_SY4] = (0x0a << 4) | 0;
+		pHdr[HIDX_CIP2_SID6] = (0x00 << 6) | 0x3f;
+		pHdr[HIDX_DBS8] = 0x06;
+		pHdr[HIDX_FN2_QPC3_SPH1_RSV2] = (0x03 << 6) | (0x00 << 3) | (0x01 << 2) | 0x00;
+		pHdr[HIDX_CIP2_FMT6] = (0x02 << 6) | 0xa0;
+		pHdr[HIDX_TSF1_RESA7] = (0x01 << 7) | 0x00;
+
+		// NULL packet: payload only, no scrambling, stuffing bytes
+		memset(pTsPkt, 0xff, MPEG2_TS_PKT_SIZE);
+		pTsPkt[0] = MPEG2_TS_SYNC_BYTE;
+		pTsPkt[1] = MPEG2_TS_NULL_PID >> 8;
+		pTsPkt[2] = MPEG2_TS_NULL_PID & 0xff;
+		pTsPkt[3] = 0x10;
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
-static int syncScan(media_q_item_t *pMediaQItem, int startIdx)
+// Send a NULL packet in place of a frame the interface module has no data for
+tx_cb_ret_t openavbMapMpeg2tsTxNullCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 {
-	char *data = pMediaQItem->pPubData;
-	int offset;
-	for (offset = startIdx; offset < pMediaQItem->dataLen; offset++) {
-		if (data[offset] == MPEG2_TS_SYNC_BYTE)
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+
+	pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+	if (!pPvtData || *dataLen < sizeof(pPvtData->nullFrame)) {
+		AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+		return TX_CB_RET_PACKET_NOT_READY;
+	}
+
+	memcpy(pData + AVTP_V0_HEADER_SIZE, pPvtData->nullFrame + AVTP_V0_HEADER_SIZE, sizeof(pPvtData->nullFrame) - AVTP_V0_HEADER_SIZE);
+
+	// Present it max transit from now, stamped like any other source packet
+	U64 nowNS;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	U32 timestamp = htonl((U32)(nowNS + (U64)pPvtData->maxTransitUsec * NANOSECONDS_PER_USEC));
+	pData[HIDX_AVTP_HIDE7_TV1] |= 0x01;
+	pData[HIDX_AVTP_HIDE7_TU1] &= ~0x01;
+	*(U32 *)(&pData[HIDX_AVTP_TIMESTAMP32]) = timestamp;
+	*(U32 *)(&pData[TOTAL_HEADER_SIZE]) = timestamp;
+
+	pData[HIDX_DBC8] = pPvtData->DBC;
+	pPvtData->DBC = (pPvtData->DBC + BLOCKS_PER_SRC_PKT) & 0x000000ff;
+
+	*dataLen = sizeof(pPvtData->nullFrame);
+
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return TX_CB_RET_PACKET_READY;
+}
+
+// Find the start of the next TS packet at or after startIdx.
+// memchr() does the byte search with the C library's vectorized scan. A sync
+// byte followed by another one a packet later is preferred over a lone 0x47 in
+// the payload. Returns the index of the packet (including any 4 byte source
+// packet header) or -1 if no sync byte was found.
+static int syncScan(pvt_data_t *pPvtData, media_q_item_t *pMediaQItem, int startIdx)
+{
+	U8 *data = pMediaQItem->pPubData;
+	int hdrSize = pPvtData->tsPacketSize - MPEG2_TS_PKT_SIZE;
+	int offset = startIdx + hdrSize;
+	int candidate = -1;
+
+	while (offset < (int)pMediaQItem->dataLen) {
+		U8 *pSync = memchr(data + offset, MPEG2_TS_SYNC_BYTE, pMediaQItem->dataLen - offset);
+		if (!pSync)
+			break;
+		offset = pSync - data;
+		if (candidate < 0)
+			candidate = offset;
+		if (offset + pPvtData->tsPacketSize >= pMediaQItem->dataLen
+			|| data[offset + pPvtData->tsPacketSize] == MPEG2_TS_SYNC_BYTE) {
+			candidate = offset;
 			break;
+		}
+		offset++;
 	}
 
-	AVB_LOGF_WARNING("Dropped %d bytes", offset - startIdx);
-	if (offset >= pMediaQItem->dataLen)
-		offset = -1;
+	if (candidate < 0) {
+		AVB_LOGF_WARNING("Dropped %d bytes", pMediaQItem->dataLen - startIdx);
+		return -1;
+	}
 
-	return offset;
+	if (candidate - hdrSize > startIdx)
+		AVB_LOGF_WARNING("Dropped %d bytes", candidate - hdrSize - startIdx);
+	return candidate - hdrSize;
 }
 
 // This talker callback will be called for each AVB observation interval.
@@ -381,9 +484,11 @@ tx_cb_ret_t openavbMapMpeg2tsTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 
 			if (pPvtData->unsynched) {
 				// Scan forward, looking for next sync byte.
-				offset = syncScan(pMediaQItem, 0);
-				if (offset >= 0)
+				offset = syncScan(pPvtData, pMediaQItem, 0);
+				if (offset >= 0) {
 					pMediaQItem->readIdx = offset;
+					pPvtData->unsynched = FALSE;
+				}
 				else {
 					pPvtData->unsynched = TRUE;
 					pMediaQItem->dataLen = 0;
@@ -426,45 +531,76 @@ tx_cb_ret_t openavbMapMpeg2tsTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 
 				/* Copy the TS packets into the outgoing AVTP frame
 				 */
-				offset = 0, bytesNeeded = pPvtData->tsPacketSize;
-
-				// If getting 188-byte packets from interface, need to add source packet header
-				if (pPvtData->tsPacketSize == MPEG2_TS_PKT_SIZE) {
-					// Set the timestamp on this source packet
-					*((U32 *)pPayload) = htonl(timestamp);
-					offset = MPEGTS_SRC_PKT_HDR_SIZE;
+				U8 *pItemData = (U8 *)pMediaQItem->pPubData + pMediaQItem->readIdx;
+				int nPkts, nSynced;
+
+				if (pPvtData->nSavedBytes == 0) {
+					// Whole packets straight from the MQ item. Source packets
+					// already carry their header and go out in a single copy.
+					nPkts = nItemBytes / pPvtData->tsPacketSize;
+					if (nPkts > pPvtData->numSourcePackets - sourcePacketsAdded)
+						nPkts = pPvtData->numSourcePackets - sourcePacketsAdded;
+
+					if (pPvtData->tsPacketSize == MPEGTS_SRC_PKT_SIZE) {
+						memcpy(pPayload, pItemData, nPkts * MPEGTS_SRC_PKT_SIZE);
+					}
+					else {
+						int i1;
+						for (i1 = 0; i1 < nPkts; i1++) {
+							*((U32 *)(pPayload + i1 * MPEGTS_SRC_PKT_SIZE)) = htonl(timestamp);
+							memcpy(pPayload + i1 * MPEGTS_SRC_PKT_SIZE + MPEGTS_SRC_PKT_HDR_SIZE,
+								pItemData + i1 * MPEG2_TS_PKT_SIZE, MPEG2_TS_PKT_SIZE);
+						}
+					}
 				}
+				else {
+					// Stitch the leftover data from the last MQ item to the start of this one
+					offset = 0, bytesNeeded = pPvtData->tsPacketSize;
+					nPkts = 1;
+
+					// If getting 188-byte packets from interface, need to add source packet header
+					if (pPvtData->tsPacketSize == MPEG2_TS_PKT_SIZE) {
+						// Set the timestamp on this source packet
+						*((U32 *)pPayload) = htonl(timestamp);
+						offset = MPEGTS_SRC_PKT_HDR_SIZE;
+					}
 
-				// Use any leftover data from last MQ item
-				if (pPvtData->nSavedBytes) {
 					memcpy(pPayload + offset, pPvtData->savedBytes, pPvtData->nSavedBytes);
 					offset += pPvtData->nSavedBytes;
 					bytesNeeded -= pPvtData->nSavedBytes;
-					pPvtData->nSavedBytes = 0;
+					memcpy(pPayload + offset, pItemData, bytesNeeded);
 				}
 
-				// Now, copy data from current MQ item
-				memcpy(pPayload + offset, pMediaQItem->pPubData + pMediaQItem->readIdx, bytesNeeded);
-
 				// Check that the data we've copied is synchronized
-				/// i.e. that the transport stream packet starts
+				/// i.e. that each transport stream packet starts
 				//  where we think it should
-				if (pPayload[4] == MPEG2_TS_SYNC_BYTE) {
+				for (nSynced = 0; nSynced < nPkts; nSynced++) {
+					if (pPayload[nSynced * MPEGTS_SRC_PKT_SIZE + MPEGTS_SRC_PKT_HDR_SIZE] != MPEG2_TS_SYNC_BYTE)
+						break;
+				}
+
+				if (nSynced > 0) {
 					// OK, now we can update the read index
-					pMediaQItem->readIdx += bytesNeeded;
+					if (pPvtData->nSavedBytes) {
+						pMediaQItem->readIdx += pPvtData->tsPacketSize - pPvtData->nSavedBytes;
+					}
+					else {
+						pMediaQItem->readIdx += nSynced * pPvtData->tsPacketSize;
+					}
 					// and move the payload ptr for the next source packet
-					pPayload += MPEGTS_SRC_PKT_SIZE;
+					pPayload += nSynced * MPEGTS_SRC_PKT_SIZE;
 
 					// Keep track of how many source packets have been added to the outgoing packet
-					sourcePacketsAdded++;
+					sourcePacketsAdded += nSynced;
 				}
-				else {
+				pPvtData->nSavedBytes = 0;
+
+				if (nSynced < nPkts) {
 					AVB_LOG_WARNING("Alignment problem");
 
 					// Scan forward, looking for next sync byte.
-					// Start scan after 4-byte header if getting 192 byte packets.
 					// Ignore saved data if there was any, start from what's in current item.
-					offset = syncScan(pMediaQItem, pMediaQItem->readIdx + (pPvtData->tsPacketSize - MPEG2_TS_PKT_SIZE) + 1);
+					offset = syncScan(pPvtData, pMediaQItem, pMediaQItem->readIdx + 1);
 					if (offset >= 0)
 						pMediaQItem->readIdx = offset;
 					else {
@@ -536,6 +672,30 @@ tx_cb_ret_t openavbMapMpeg2tsTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 void openavbMapMpeg2tsRxInitCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+
+	if (pMediaQ && pMediaQ->pPvtMapInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+
+		if (pPvtData->rxItemFill) {
+			// Whole TS packets only, and no more than an item holds
+			if (pPvtData->rxItemFill > pPvtData->itemSize) {
+				AVB_LOGF_WARNING("map_nv_rx_item_fill %u larger than map_nv_item_size, using %u",
+					pPvtData->rxItemFill, pPvtData->itemSize);
+				pPvtData->rxItemFill = pPvtData->itemSize;
+			}
+			pPvtData->rxItemFill -= pPvtData->rxItemFill % pPvtData->tsPacketSize;
+			if (pPvtData->rxItemFill < pPvtData->tsPacketSize) {
+				pPvtData->rxItemFill = pPvtData->tsPacketSize;
+			}
+
+			// A partly filled item waits for more payloads; don't let its
+			// data fall more than the max transit time behind
+			pPvtData->rxItemHoldNsec = pPvtData->maxTransitUsec < 4000000 ?
+				pPvtData->maxTransitUsec * 1000 : 4000000000U;
+			AVB_LOGF_INFO("Gathering %u bytes per media queue item", pPvtData->rxItemFill);
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
@@ -584,37 +744,59 @@ bool openavbMapMpeg2tsRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 		//pHdr[HIDX_RESC8];
 
 		if (sourcePacketCount > 0) {
+			U32 copyLen = sourcePacketCount * pPvtData->tsPacketSize;
+			U32 timestamp = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32]));
+			bool timestampValid = (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE;
+
 			// Get item in media queue
 			media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+			if (pMediaQItem && pMediaQItem->dataLen > 0
+				&& (pMediaQItem->itemSize - pMediaQItem->dataLen < copyLen
+					|| (timestampValid && pPvtData->rxItemTimestampValid
+						&& timestamp - pPvtData->rxItemTimestamp > pPvtData->rxItemHoldNsec))) {
+				// Hand over what was gathered so far and start a new item
+				openavbMediaQHeadPush(pMediaQ);
+				pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+			}
 			if (pMediaQItem) {
 				if (pMediaQItem->dataLen == 0) {
 					// Get the timestamp and place it in the media queue item.
-					U32 timestamp = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32]));
 					openavbAvtpTimeSetToTimestamp(pMediaQItem->pAvtpTime, timestamp);
 
 					// Set timestamp valid and timestamp uncertain flags
-					openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE);
+					openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, timestampValid);
 					openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TU1] & 0x01) ? TRUE : FALSE);
+					pPvtData->rxItemTimestamp = timestamp;
+					pPvtData->rxItemTimestampValid = timestampValid;
 				}
 
-				int i;
-				for (i = 0; i < sourcePacketCount; i++) {
-					if (pMediaQItem->itemSize - pMediaQItem->dataLen >= pPvtData->tsPacketSize) {
+				if (pMediaQItem->itemSize - pMediaQItem->dataLen < copyLen) {
+					AVB_LOG_ERROR("Data too large for media queue");
+					pMediaQItem->dataLen = 0;
+				}
+				else if (pPvtData->tsPacketSize == MPEGTS_SRC_PKT_SIZE) {
+					// Source packets are passed on whole, so the payload is one copy
+					memcpy(pMediaQItem->pPubData + pMediaQItem->dataLen, pPayload, copyLen);
+					pMediaQItem->dataLen += copyLen;
+				}
+				else {
+					int i;
+					for (i = 0; i < sourcePacketCount; i++) {
 						memcpy(pMediaQItem->pPubData + pMediaQItem->dataLen,
 							pPayload + MPEGTS_SRC_PKT_SIZE - pPvtData->tsPacketSize,
 							pPvtData->tsPacketSize);
 						pMediaQItem->dataLen += pPvtData->tsPacketSize;
 						pPayload += MPEGTS_SRC_PKT_SIZE;
 					}
-					else {
-						AVB_LOG_ERROR("Data too large for media queue");
-						pMediaQItem->dataLen = 0;
-						break;
-					}
 				}
 
-				// TODO: try to pack more data into MQ item?
-				openavbMediaQHeadPush(pMediaQ);
+				if (pMediaQItem->dataLen >= pPvtData->rxItemFill) {
+					openavbMediaQHeadPush(pMediaQ);
+				}
+				else {
+					// Keep filling the item with the next payloads
+					openavbMediaQHeadUnlock(pMediaQ);
+				}
 			}
 			else {
 				// Media queue full, data dropped
@@ -711,6 +893,7 @@ extern DLL_EXPORT bool openavbMapMpeg2tsInitialize(media_q_t *pMediaQ, openavb_m
 		pMapCB->map_gen_init_cb = openavbMapMpeg2tsGenInitCB;
 		pMapCB->map_tx_init_cb = openavbMapMpeg2tsTxInitCB;
 		pMapCB->map_tx_cb = openavbMapMpeg2tsTxCB;
+		pMapCB->map_tx_null_cb = openavbMapMpeg2tsTxNullCB;
 		pMapCB->map_rx_init_cb = openavbMapMpeg2tsRxInitCB;
 		pMapCB->map_rx_cb = openavbMapMpeg2tsRxCB;
 		pMapCB->map_end_cb = openavbMapMpeg2tsEndCB;
@@ -80,6 +80,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include <stdlib.h>
 #include <string.h>
+#include "openavb_platform_pub.h"
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_avtp_time_pub.h"
@@ -100,6 +101,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #define ITEM_SIZE					MAX_DATA_SIZE
 
+// Largest map_nv_payload_size that still fits a standard Ethernet frame
+#define MAX_CFG_PAYLOAD_SIZE		(1500 - TOTAL_HEADER_SIZE)
+
 
 //////
 // AVTP Version 0 Header
@@ -142,13 +146,42 @@ typedef struct {
 	// Transmit interval in frames per second. 0 = default for talker class.
 	U32 txInterval;
 
+	// Synthetic load per frame: payload bytes carried after the header,
+	// thread CPU time to burn and bytes of a working set to touch.
+	U32 payloadSize;
+	U32 costNsec;
+	U32 touchBytes;
+
 	/////////////
 	// Variable data
 	/////////////
 	U32 maxTransitUsec;     // In microseconds
 
+	U8 *pTouch;
+
 } pvt_data_t;
 
+// Touch every cache line of the working set and burn costNsec of thread
+// CPU time, as a real mapping module would per frame.
+static void x_nullFrameLoad(pvt_data_t *pPvtData)
+{
+	if (pPvtData->pTouch) {
+		volatile U8 *pTouch = pPvtData->pTouch;
+		U32 i1;
+		for (i1 = 0; i1 < pPvtData->touchBytes; i1 += 64) {
+			pTouch[i1]++;
+		}
+	}
+
+	if (pPvtData->costNsec) {
+		U64 startNS, nowNS;
+		CLOCK_GETTIME64(OPENAVB_CLOCK_THREAD_CPUTIME, &startNS);
+		do {
+			CLOCK_GETTIME64(OPENAVB_CLOCK_THREAD_CPUTIME, &nowNS);
+		} while (nowNS - startNS < pPvtData->costNsec);
+	}
+}
+
 // Each configuration name value pair for this mapping will result in this callback being called.
 void openavbMapNullCfgCB(media_q_t *pMediaQ, const char *name, const char *value)
 {
@@ -170,6 +203,22 @@ void openavbMapNullCfgCB(media_q_t *pMediaQ, const char *name, const char *value
 			char *pEnd;
 			pPvtData->txInterval = strtol(value, &pEnd, 10);
 		}
+		else if (strcmp(name, "map_nv_payload_size") == 0) {
+			char *pEnd;
+			pPvtData->payloadSize = strtoul(value, &pEnd, 10);
+			if (pPvtData->payloadSize > MAX_CFG_PAYLOAD_SIZE) {
+				AVB_LOGF_WARNING("map_nv_payload_size %u too large; using %u", pPvtData->payloadSize, MAX_CFG_PAYLOAD_SIZE);
+				pPvtData->payloadSize = MAX_CFG_PAYLOAD_SIZE;
+			}
+		}
+		else if (strcmp(name, "map_nv_cost_nsec") == 0) {
+			char *pEnd;
+			pPvtData->costNsec = strtoul(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_touch_bytes") == 0) {
+			char *pEnd;
+			pPvtData->touchBytes = strtoul(value, &pEnd, 10);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -195,6 +244,13 @@ U8 openavbMapNullAvtpVersionCB()
 U16 openavbMapNullMaxDataSizeCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData && pPvtData->payloadSize > MAX_PAYLOAD_SIZE) {
+			AVB_TRACE_EXIT(AVB_TRACE_MAP);
+			return TOTAL_HEADER_SIZE + pPvtData->payloadSize;
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 	return MAX_DATA_SIZE;
 }
@@ -227,7 +283,15 @@ void openavbMapNullGenInitCB(media_q_t *pMediaQ)
 			return;
 		}
 
-		openavbMediaQSetSize(pMediaQ, pPvtData->itemCount, ITEM_SIZE);
+		openavbMediaQSetSize(pMediaQ, pPvtData->itemCount,
+			pPvtData->payloadSize > ITEM_SIZE ? pPvtData->payloadSize : ITEM_SIZE);
+
+		if (pPvtData->touchBytes) {
+			pPvtData->pTouch = calloc(1, pPvtData->touchBytes);
+			if (!pPvtData->pTouch) {
+				AVB_LOGF_ERROR("Unable to allocate %u bytes to touch", pPvtData->touchBytes);
+			}
+		}
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
@@ -276,7 +340,16 @@ tx_cb_ret_t openavbMapNullTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 			pHdr[HIDX_OPENAVB_RESERVEDC8] = 0x00;
 			*(U32 *)(&pHdr[HIDX_OPENAVB_FORMAT_SPEC32]) = 0x00000000;
 
-			*dataLen = TOTAL_HEADER_SIZE;   // No data
+			// Carry the item's data, padded out to the payload size
+			U32 payloadSize = pPvtData->payloadSize;
+			if (payloadSize) {
+				U32 copyLen = pMediaQItem->dataLen < payloadSize ? pMediaQItem->dataLen : payloadSize;
+				memcpy(pHdr + TOTAL_HEADER_SIZE, pMediaQItem->pPubData, copyLen);
+				memset(pHdr + TOTAL_HEADER_SIZE + copyLen, 0, payloadSize - copyLen);
+			}
+			x_nullFrameLoad(pPvtData);
+
+			*dataLen = TOTAL_HEADER_SIZE + payloadSize;   // No data unless map_nv_payload_size is set
 			openavbMediaQTailPull(pMediaQ);
 			AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
 			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
@@ -305,6 +378,11 @@ bool openavbMapNullRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
 	if (pMediaQ && pData) {
 		U8 *pHdr = pData;
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return FALSE;
+		}
 
 		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
 		if (pMediaQItem) {
@@ -316,7 +394,17 @@ bool openavbMapNullRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 			openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TV1] & 0x01) ? TRUE : FALSE);
 			openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, (pHdr[HIDX_AVTP_HIDE7_TU1] & 0x01) ? TRUE : FALSE);
 
-			pMediaQItem->dataLen = 0;       // Regardless of what is sent nullify the data to the interface.
+			// Nullify the data to the interface unless a payload size is set
+			U32 payloadLen = 0;
+			if (pPvtData->payloadSize && dataLen > TOTAL_HEADER_SIZE) {
+				payloadLen = dataLen - TOTAL_HEADER_SIZE;
+				if (payloadLen > pMediaQItem->itemSize) {
+					payloadLen = pMediaQItem->itemSize;
+				}
+				memcpy(pMediaQItem->pPubData, pHdr + TOTAL_HEADER_SIZE, payloadLen);
+			}
+			pMediaQItem->dataLen = payloadLen;
+			x_nullFrameLoad(pPvtData);
 			openavbMediaQHeadPush(pMediaQ);
 			AVB_TRACE_LINE(AVB_TRACE_MAP_LINE);
 			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
@@ -342,6 +430,13 @@ void openavbMapNullEndCB(media_q_t *pMediaQ)
 void openavbMapNullGenEndCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData) {
+			free(pPvtData->pTouch);
+			pPvtData->pTouch = NULL;
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
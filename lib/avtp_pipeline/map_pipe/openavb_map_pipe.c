@@ -140,6 +140,9 @@ typedef struct {
 	// map_nv_pull_header
 	bool pull_header;
 
+	// map_nv_direct_fill
+	bool directFill;
+
 
 	/////////////
 	// Variable data
@@ -200,6 +203,10 @@ void openavbMapPipeCfgCB(media_q_t *pMediaQ, const char *name, const char *value
 				pPvtData->pull_header = (tmp == 1);
 			}
 		}
+		else if (strcmp(name, "map_nv_direct_fill") == 0) {
+			char *pEnd;
+			pPvtData->directFill = (strtol(value, &pEnd, 10) == 1);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -278,6 +285,27 @@ void openavbMapPipeTxInitCB(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Lets the interface module fill the payload of the transmit frame in place
+bool openavbMapPipeTxPayloadCB(media_q_t *pMediaQ, U32 *pOffset, U32 *pSize)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+
+	if (pMediaQ && pOffset && pSize) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		// With pull_header the item carries its own header, which the
+		// mapping module would then overwrite in place
+		if (pPvtData && pPvtData->directFill && !pPvtData->pull_header) {
+			*pOffset = TOTAL_HEADER_SIZE;
+			*pSize = pPvtData->itemSize;
+			AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+			return TRUE;
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return FALSE;
+}
+
 // This talker callback will be called for each AVB observation interval.
 tx_cb_ret_t openavbMapPipeTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 {
@@ -331,7 +359,10 @@ tx_cb_ret_t openavbMapPipeTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 					*dataLen = pMediaQItem->dataLen;
 				}
 				else {
-					memcpy(pPayload, pMediaQItem->pPubData, pMediaQItem->dataLen);
+					// Nothing to copy if the interface filled the payload in place
+					if (pMediaQItem->pPubData != pPayload) {
+						memcpy(pPayload, pMediaQItem->pPubData, pMediaQItem->dataLen);
+					}
 					*dataLen = pMediaQItem->dataLen + TOTAL_HEADER_SIZE;
 				}
 
@@ -468,11 +499,13 @@ extern DLL_EXPORT bool openavbMapPipeInitialize(media_q_t *pMediaQ, openavb_map_
 		pMapCB->map_rx_cb = openavbMapPipeRxCB;
 		pMapCB->map_end_cb = openavbMapPipeEndCB;
 		pMapCB->map_gen_end_cb = openavbMapPipeGenEndCB;
+		pMapCB->map_tx_payload_cb = openavbMapPipeTxPayloadCB;
 
 		pPvtData->itemCount = 20;
 		pPvtData->txInterval = 0;
 		pPvtData->push_header = FALSE;
 		pPvtData->pull_header = FALSE;
+		pPvtData->directFill = FALSE;
 		pPvtData->maxTransitUsec = inMaxTransitUsec;
 
 		pPvtData->maxPayloadSize = 1024;
@@ -34,6 +34,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include <stdlib.h>
 #include <string.h>
+#include "openavb_platform_pub.h"
+#include "openavb_mcr_hal_pub.h"
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_avtp_time_pub.h"
@@ -44,6 +46,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include "openavb_map_pub.h"
 #include "openavb_map_uncmp_audio_pub.h"
+#include "openavb_mcs.h"
+#include "openavb_audio_conv_pub.h"
 
 // DEBUG Uncomment to turn on logging for just this module.
 #define AVB_LOG_ON	1
@@ -137,6 +141,12 @@ typedef struct {
 	//	the minimal needed.
 	U32 packingFactor;
 
+	// Number of the item's channels carried by this stream. 0 = all of them.
+	U32 streamChannels;
+
+	// First item channel carried by this stream
+	U32 channelOffset;
+
 	/////////////
 	// Variable data
 	/////////////
@@ -148,11 +158,40 @@ typedef struct {
 
 	U32 maxPayloadSize;
 
+	// Channels in each data block of the stream
+	U32 packetChannels;
+
 	// Data block continuity counter
 	U8 DBC;
 
 	avb_audio_mcr_t audioMcr;
 
+	// MCR clock output device, pin and rate
+	char *pMcrClockDevice;
+	U32 mcrClockPin;
+	U32 mcrClockHz;
+
+	// Data block index of the last timestamp pushed to MCR
+	bool mcrHaveBlock;
+	U8 mcrLastBlock;
+
+	// map_nv_sparse_mode, one SYT_INTERVAL in eight is timestamped
+	U32 sparseMode;
+
+	// Last timestamp received and its data block, for the listener to step
+	// the times of the SYT_INTERVALs a sparse talker left unstamped
+	bool rxHaveTs;
+	bool rxTsUncertain;
+	U32 rxLastTs;
+	U8 rxLastBlock;
+	mcs_t rxMcs;
+
+	// Packet of AM824 silence sent when the interface has no data, built at
+	// TX init. Sent from the avtp_timestamp on; the timestamp and DBC are
+	// filled in per packet.
+	U8 *pNullFrame;
+	U32 nullFrameLen;
+
 } pvt_data_t;
 
 static void x_calculateSizes(media_q_t *pMediaQ)
@@ -259,7 +298,18 @@ static void x_calculateSizes(media_q_t *pMediaQ)
 			pPubMapInfo->itemSampleSizeBytes = 1;
 		}
 
-		pPubMapInfo->packetFrameSizeBytes = pPubMapInfo->packetSampleSizeBytes * pPubMapInfo->audioChannels;
+		pPvtData->packetChannels = pPvtData->streamChannels ? pPvtData->streamChannels : pPubMapInfo->audioChannels;
+		if (pPvtData->channelOffset + pPvtData->packetChannels > pPubMapInfo->audioChannels) {
+			AVB_LOGF_ERROR("Channels %u to %u don't fit in the %u channels of the interface; using all of them",
+				pPvtData->channelOffset, pPvtData->channelOffset + pPvtData->packetChannels - 1, pPubMapInfo->audioChannels);
+			pPvtData->channelOffset = 0;
+			pPvtData->packetChannels = pPubMapInfo->audioChannels;
+		}
+		if (pPvtData->packetChannels != pPubMapInfo->audioChannels) {
+			AVB_LOGF_INFO("Stream Channels:%d-%d", pPvtData->channelOffset, pPvtData->channelOffset + pPvtData->packetChannels - 1);
+		}
+
+		pPubMapInfo->packetFrameSizeBytes = pPubMapInfo->packetSampleSizeBytes * pPvtData->packetChannels;
 		pPubMapInfo->packetAudioDataSizeBytes = pPubMapInfo->framesPerPacket * pPubMapInfo->packetFrameSizeBytes;
 		pPvtData->maxPayloadSize = pPubMapInfo->packetAudioDataSizeBytes + TOTAL_HEADER_SIZE;
 
@@ -291,6 +341,61 @@ static void x_calculateSizes(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Convert frames of the media queue item to AM824 data blocks. When the
+// stream carries only some of the item's channels each frame is cut down to
+// them on the way.
+static void x_itemToAM824(media_q_pub_map_uncmp_audio_info_t *pPubMapInfo, pvt_data_t *pPvtData, U8 *pDst, const U8 *pSrc, U32 frames)
+{
+	if (pPvtData->packetChannels == pPubMapInfo->audioChannels) {
+		if (pPubMapInfo->itemSampleSizeBytes == 2) {
+			openavbAudioConvInt16ToAM824(pDst, pSrc, frames * pPubMapInfo->audioChannels, pPvtData->AM824_label);
+		}
+		else {
+			openavbAudioConvInt24ToAM824(pDst, pSrc, frames * pPubMapInfo->audioChannels, pPvtData->AM824_label);
+		}
+		return;
+	}
+
+	pSrc += pPvtData->channelOffset * pPubMapInfo->itemSampleSizeBytes;
+	while (frames-- > 0) {
+		if (pPubMapInfo->itemSampleSizeBytes == 2) {
+			openavbAudioConvInt16ToAM824(pDst, pSrc, pPvtData->packetChannels, pPvtData->AM824_label);
+		}
+		else {
+			openavbAudioConvInt24ToAM824(pDst, pSrc, pPvtData->packetChannels, pPvtData->AM824_label);
+		}
+		pDst += pPubMapInfo->packetFrameSizeBytes;
+		pSrc += pPubMapInfo->itemFrameSizeBytes;
+	}
+}
+
+// Convert AM824 data blocks to frames of the media queue item, into the
+// stream's channels of each frame when it carries only some of them.
+static void x_am824ToItem(media_q_pub_map_uncmp_audio_info_t *pPubMapInfo, pvt_data_t *pPvtData, U8 *pDst, const U8 *pSrc, U32 frames)
+{
+	if (pPvtData->packetChannels == pPubMapInfo->audioChannels) {
+		if (pPubMapInfo->itemSampleSizeBytes == 2) {
+			openavbAudioConvAM824ToInt16(pDst, pSrc, frames * pPubMapInfo->audioChannels);
+		}
+		else {
+			openavbAudioConvAM824ToInt24(pDst, pSrc, frames * pPubMapInfo->audioChannels);
+		}
+		return;
+	}
+
+	pDst += pPvtData->channelOffset * pPubMapInfo->itemSampleSizeBytes;
+	while (frames-- > 0) {
+		if (pPubMapInfo->itemSampleSizeBytes == 2) {
+			openavbAudioConvAM824ToInt16(pDst, pSrc, pPvtData->packetChannels);
+		}
+		else {
+			openavbAudioConvAM824ToInt24(pDst, pSrc, pPvtData->packetChannels);
+		}
+		pDst += pPubMapInfo->itemFrameSizeBytes;
+		pSrc += pPubMapInfo->packetFrameSizeBytes;
+	}
+}
+
 
 // Each configuration name value pair for this mapping will result in this callback being called.
 void openavbMapUncmpAudioCfgCB(media_q_t *pMediaQ, const char *name, const char *value)
@@ -317,10 +422,41 @@ void openavbMapUncmpAudioCfgCB(media_q_t *pMediaQ, const char *name, const char
 			char *pEnd;
 			pPvtData->packingFactor = strtol(value, &pEnd, 10);
 		}
+		else if (strcmp(name, "map_nv_stream_channels") == 0) {
+			char *pEnd;
+			pPvtData->streamChannels = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_channel_offset") == 0) {
+			char *pEnd;
+			pPvtData->channelOffset = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_sparse_mode") == 0) {
+			char *pEnd;
+			U32 tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp == 1) {
+				pPvtData->sparseMode = TS_SPARSE_MODE_ENABLED;
+			}
+			else if (*pEnd == '\0' && tmp == 0) {
+				pPvtData->sparseMode = TS_SPARSE_MODE_DISABLED;
+			}
+		}
 		else if (strcmp(name, "map_nv_audio_mcr") == 0) {
 			char *pEnd;
 			pPvtData->audioMcr = (avb_audio_mcr_t)strtol(value, &pEnd, 10);
 		}
+		else if (strcmp(name, "map_nv_mcr_clock_device") == 0) {
+			if (pPvtData->pMcrClockDevice)
+				free(pPvtData->pMcrClockDevice);
+			pPvtData->pMcrClockDevice = strdup(value);
+		}
+		else if (strcmp(name, "map_nv_mcr_clock_pin") == 0) {
+			char *pEnd;
+			pPvtData->mcrClockPin = strtol(value, &pEnd, 10);
+		}
+		else if (strcmp(name, "map_nv_mcr_clock_hz") == 0) {
+			char *pEnd;
+			pPvtData->mcrClockHz = strtol(value, &pEnd, 10);
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
@@ -390,6 +526,11 @@ void openavbMapUncmpAudioGenInitCB(media_q_t *pMediaQ)
 
 		x_calculateSizes(pMediaQ);
 		openavbMediaQSetSize(pMediaQ, pPvtData->itemCount, pPubMapInfo->itemSize);
+
+		pPubMapInfo->sparseMode = pPvtData->sparseMode;
+		if (pPubMapInfo->sparseMode == TS_SPARSE_MODE_ENABLED) {
+			AVB_LOG_INFO("Sparse timestamping mode: enabled");
+		}
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 	}
@@ -428,9 +569,65 @@ void openavbMapUncmpAudioTxInitCB(media_q_t *pMediaQ)
 		return;
 	}
 
+	// Encode a packet of zero samples once, so silence costs a copy
+	U32 payloadLen = pPubMapInfo->framesPerPacket * pPubMapInfo->packetFrameSizeBytes;
+	U8 *pZero = calloc(pPubMapInfo->framesPerPacket, pPubMapInfo->itemFrameSizeBytes);
+	free(pPvtData->pNullFrame);
+	pPvtData->nullFrameLen = TOTAL_HEADER_SIZE + payloadLen;
+	pPvtData->pNullFrame = calloc(1, pPvtData->nullFrameLen);
+	if (pZero && pPvtData->pNullFrame) {
+		U8 *pHdr = pPvtData->pNullFrame;
+		*(U16 *)(&pHdr[HIDX_DATALEN16]) = htons(payloadLen + CIP_HEADER_SIZE);
+		pHdr[HIDX_TAG2_CHANNEL6] = (1 << 6) | 0x1f;
+		pHdr[HIDX_TCODE4_SY4] = (0x0a << 4) | 0;
+		pHdr[HIDX_CIP2_SID6] = (0x00 << 6) | 0x3f;
+		pHdr[HIDX_DBS8] = pPvtData->packetChannels;
+		pHdr[HIDX_CIP2_FMT6] = (0x02 << 6) | 0x10;
+		pHdr[HIDX_FDF5_SFC3] = 0x00 << 3 | pPvtData->cip_sfc;
+		*(U16 *)(&pHdr[HIDX_SYT16]) = 0xffff;
+		x_itemToAM824(pPubMapInfo, pPvtData, pHdr + TOTAL_HEADER_SIZE, pZero, pPubMapInfo->framesPerPacket);
+	}
+	else {
+		free(pPvtData->pNullFrame);
+		pPvtData->pNullFrame = NULL;
+	}
+	free(pZero);
+
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
+// Send silence in place of a packet the interface module has no data for
+tx_cb_ret_t openavbMapUncmpAudioTxNullCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MAP_DETAIL);
+
+	media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
+	pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+	if (!pPvtData || !pPvtData->pNullFrame
+		|| *dataLen < pPvtData->nullFrameLen) {
+		AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+		return TX_CB_RET_PACKET_NOT_READY;
+	}
+
+	memcpy(pData + AVTP_V0_HEADER_SIZE, pPvtData->pNullFrame + AVTP_V0_HEADER_SIZE, pPvtData->nullFrameLen - AVTP_V0_HEADER_SIZE);
+
+	// Present the silence max transit from now
+	U64 nowNS;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	pData[HIDX_AVTP_HIDE7_TV1] |= 0x01;
+	pData[HIDX_AVTP_HIDE7_TU1] &= ~0x01;
+	*(U32 *)(&pData[HIDX_AVTP_TIMESTAMP32]) = htonl((U32)(nowNS + (U64)pPvtData->maxTransitUsec * NANOSECONDS_PER_USEC));
+
+	// The data blocks count like real ones so listeners see no gap
+	pData[HIDX_DBC8] = pPvtData->DBC;
+	pPvtData->DBC += pPubMapInfo->framesPerPacket;
+
+	*dataLen = pPvtData->nullFrameLen;
+
+	AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
+	return TX_CB_RET_PACKET_READY;
+}
+
 // This talker callback will be called for each AVB observation interval.
 tx_cb_ret_t openavbMapUncmpAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen)
 {
@@ -463,7 +660,7 @@ tx_cb_ret_t openavbMapUncmpAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen
 
 		// Set the majority of the CIP header now.
 		pHdr[HIDX_CIP2_SID6] = (0x00 << 6) | 0x3f;
-		pHdr[HIDX_DBS8] = pPubMapInfo->audioChannels;
+		pHdr[HIDX_DBS8] = pPvtData->packetChannels;
 
 		pHdr[HIDX_FN2_QPC3_SPH1_RSV2] = (0x00 << 6) | (0x00 << 3) | (0x00 << 2) | 0x00;
 		// pHdr[HIDX_DBC8] = 0; 						// Set later
@@ -478,7 +675,11 @@ tx_cb_ret_t openavbMapUncmpAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen
 			pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
 
 			if (pMediaQItem && pMediaQItem->dataLen > 0) {
-				if (pMediaQItem->readIdx == 0) {
+				// In sparse mode only the SYT_INTERVAL starting at a multiple
+				// of 8 * SYT_INTERVAL data blocks is stamped.
+				if (pMediaQItem->readIdx == 0
+					&& (pPvtData->sparseMode != TS_SPARSE_MODE_ENABLED
+						|| (U8)(pPvtData->DBC + framesProcessed) % (8 * pPubMapInfo->sytInterval) == 0)) {
 					// Timestamp from the media queue is always assoicated with the first data point.
 
 					// Update time stamp
@@ -504,31 +705,15 @@ tx_cb_ret_t openavbMapUncmpAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen
 				}
 
 				U8 *pItemData = (U8 *)pMediaQItem->pPubData + pMediaQItem->readIdx;
-				while (framesProcessed < pPubMapInfo->framesPerPacket && pMediaQItem->readIdx < pMediaQItem->dataLen) {
-					int i1;
-					for (i1 = 0; i1 < pPubMapInfo->audioChannels; i1++) {
-						if (pPubMapInfo->itemSampleSizeBytes == 2) {
-							S32 sample = *(S16 *)pItemData;
-							sample &= 0x0000ffff;
-							sample = sample << 8;
-							sample |= pPvtData->AM824_label;
-							sample = htonl(sample);
-							*(U32 *)(pAVTPDataUnit) = sample;
-							pAVTPDataUnit += 4;
-							pItemData += 2;
-						}
-						else {
-							S32 sample = *(S32 *)pItemData;
-							sample &= 0x00ffffff;
-							sample |= pPvtData->AM824_label;
-							sample = htonl(sample);
-							*(U32 *)(pAVTPDataUnit) = sample;
-							pAVTPDataUnit += 4;
-							pItemData += 3;
-						}
+				if (pMediaQItem->readIdx < pMediaQItem->dataLen) {
+					U32 frames = (pMediaQItem->dataLen - pMediaQItem->readIdx + pPubMapInfo->itemFrameSizeBytes - 1) / pPubMapInfo->itemFrameSizeBytes;
+					if (frames > pPubMapInfo->framesPerPacket - framesProcessed) {
+						frames = pPubMapInfo->framesPerPacket - framesProcessed;
 					}
-					framesProcessed++;
-					pMediaQItem->readIdx += pPubMapInfo->itemFrameSizeBytes;
+					x_itemToAM824(pPubMapInfo, pPvtData, pAVTPDataUnit, pItemData, frames);
+					pAVTPDataUnit += frames * pPubMapInfo->packetFrameSizeBytes;
+					framesProcessed += frames;
+					pMediaQItem->readIdx += frames * pPubMapInfo->itemFrameSizeBytes;
 				}
 
 				if (pMediaQItem->readIdx >= pMediaQItem->dataLen) {
@@ -574,6 +759,29 @@ tx_cb_ret_t openavbMapUncmpAudioTxCB(media_q_t *pMediaQ, U8 *pData, U32 *dataLen
 void openavbMapUncmpAudioRxInitCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+	if (pMediaQ) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (!pPvtData) {
+			AVB_LOG_ERROR("Private mapping module data not allocated.");
+			return;
+		}
+		// With a Clock Reference Stream the CRF listener owns the MCR HAL
+		if (pPvtData->audioMcr == AVB_MCR_AVTP_TIMESTAMP) {
+			HAL_INIT_MCR_V2(pPvtData->txInterval, pPvtData->packingFactor, 0, 0);
+			if (pPvtData->pMcrClockDevice) {
+				HAL_SET_MCR_CLOCK_OUTPUT_V2(pPvtData->pMcrClockDevice, pPvtData->mcrClockPin, pPvtData->mcrClockHz);
+			}
+			pPvtData->mcrHaveBlock = FALSE;
+		}
+
+		pPvtData->rxHaveTs = FALSE;
+		if (pPvtData->sparseMode == TS_SPARSE_MODE_ENABLED) {
+			media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
+			if (pPubMapInfo->audioRate) {
+				openavbMcsInitFraction(&pPvtData->rxMcs, NANOSECONDS_PER_SECOND, pPubMapInfo->audioRate);
+			}
+		}
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
@@ -611,6 +819,23 @@ bool openavbMapUncmpAudioRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 		U8 *pAVTPDataUnit = pPayload;
 		U8 *pAVTPDataUnitEnd = pData + AVTP_V0_HEADER_SIZE + MAP_HEADER_SIZE + payloadLen;
 
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if ((pPvtData->audioMcr == AVB_MCR_AVTP_TIMESTAMP) && tsValid && !tsUncertain) {
+			// The timestamp belongs to the data block at the SYT_INTERVAL boundary (iec61883-6 Section 7.2)
+			U8 block = dbc + (pPubMapInfo->sytInterval - (dbc % pPubMapInfo->sytInterval)) % pPubMapInfo->sytInterval;
+			HAL_PUSH_MCR_TIMESTAMP_V2(ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32])),
+				pPvtData->mcrHaveBlock ? (U8)(block - pPvtData->mcrLastBlock) : 0, pPubMapInfo->audioRate);
+			pPvtData->mcrLastBlock = block;
+			pPvtData->mcrHaveBlock = TRUE;
+		}
+
+		if (pPvtData->sparseMode == TS_SPARSE_MODE_ENABLED && tsValid) {
+			pPvtData->rxLastTs = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32]));
+			pPvtData->rxLastBlock = dbc + (pPubMapInfo->sytInterval - (dbc % pPubMapInfo->sytInterval)) % pPubMapInfo->sytInterval;
+			pPvtData->rxTsUncertain = tsUncertain;
+			pPvtData->rxHaveTs = TRUE;
+		}
+
 		while (((pAVTPDataUnit + pPubMapInfo->packetFrameSizeBytes) <= pAVTPDataUnitEnd)) {
 			// Get item pointer in media queue
 			media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
@@ -622,11 +847,6 @@ bool openavbMapUncmpAudioRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 
 				// Get the timestamp
 				U32 timestamp = ntohl(*(U32 *)(&pHdr[HIDX_AVTP_TIMESTAMP32]));
-				pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
-				if ((pPvtData->audioMcr != AVB_MCR_NONE) && tsValid && !tsUncertain) {
-					// MCR mode set and timestamp is valid, and timestamp uncertain is not set
-					openavbAvtpTimePushMCR(pMediaQItem->pAvtpTime, timestamp);
-				}
 
 				if (pMediaQItem->dataLen == 0) {
 					// This is the first set of frames for the media queue item, must align based on SYT_INTERVAL for proper synchronization of listeners
@@ -638,6 +858,15 @@ bool openavbMapUncmpAudioRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 						return TRUE;
 					}
 
+					if (!tsValid && pPvtData->rxHaveTs && pPvtData->rxMcs.stepQ32) {
+						// Sparse talker: step from the last timestamp to this
+						// data block at the audio rate
+						openavbMcsSetEdge(&pPvtData->rxMcs, pPvtData->rxLastTs);
+						timestamp = (U32)openavbMcsAdvanceN(&pPvtData->rxMcs, (U8)(dbc - pPvtData->rxLastBlock), NULL);
+						tsValid = TRUE;
+						tsUncertain = pPvtData->rxTsUncertain;
+					}
+
 					// Set time stamp info on first data write to the media queue
 					// place it in the media queue item.
 					openavbAvtpTimeSetToTimestamp(pMediaQItem->pAvtpTime, timestamp);
@@ -645,30 +874,23 @@ bool openavbMapUncmpAudioRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 					// Set timestamp valid and timestamp uncertain flags
 					openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, tsValid);
 					openavbAvtpTimeSetTimestampUncertain(pMediaQItem->pAvtpTime, tsUncertain);
-				}
 
-				while (((pAVTPDataUnit + pPubMapInfo->packetFrameSizeBytes) <= pAVTPDataUnitEnd) && ((pItemData + pPubMapInfo->itemFrameSizeBytes) <= pItemDataEnd)) {
-					int i1;
-					for (i1 = 0; i1 < pPubMapInfo->audioChannels; i1++) {
-						if (pPubMapInfo->itemSampleSizeBytes == 2) {
-							S32 sample = ntohl(*(S32 *)pAVTPDataUnit);
-							sample = sample * 1;
-							*(S16 *)(pItemData) = (sample & 0x00ffffff) >> 8;
-							pAVTPDataUnit += 4;
-							pItemData += 2;
-							itemSizeWritten += 2;
-						}
-						else {
-							S32 sample = ntohl(*(S32 *)pAVTPDataUnit);
-							sample = sample * 1;
-							*(S32 *)(pItemData) = sample & 0x00ffffff;
-							pAVTPDataUnit += 4;
-							pItemData += 3;
-							itemSizeWritten += 3;
-						}
+					if (pPvtData->packetChannels != pPubMapInfo->audioChannels) {
+						// Channels this stream doesn't carry stay silent
+						memset(pMediaQItem->pPubData, 0, pMediaQItem->itemSize);
 					}
 				}
 
+				U32 frames = (pAVTPDataUnitEnd - pAVTPDataUnit) / pPubMapInfo->packetFrameSizeBytes;
+				U32 itemFrames = (pItemDataEnd - pItemData) / pPubMapInfo->itemFrameSizeBytes;
+				if (frames > itemFrames) {
+					frames = itemFrames;
+				}
+				if (frames > 0) {
+					x_am824ToItem(pPubMapInfo, pPvtData, pItemData, pAVTPDataUnit, frames);
+					itemSizeWritten = frames * pPubMapInfo->itemFrameSizeBytes;
+				}
+
 				pMediaQItem->dataLen += itemSizeWritten;
 
 				if (pMediaQItem->dataLen < pMediaQItem->itemSize) {
@@ -701,12 +923,32 @@ bool openavbMapUncmpAudioRxCB(media_q_t *pMediaQ, U8 *pData, U32 dataLen)
 void openavbMapUncmpAudioEndCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MAP);
+
+	if (pMediaQ && pMediaQ->pPvtMapInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData->audioMcr == AVB_MCR_AVTP_TIMESTAMP) {
+			HAL_CLOSE_MCR_V2();
+		}
+
+		free(pPvtData->pNullFrame);
+		pPvtData->pNullFrame = NULL;
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_MAP);
 }
 
 void openavbMapUncmpAudioGenEndCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMediaQ && pMediaQ->pPvtMapInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
+		if (pPvtData->pMcrClockDevice) {
+			free(pPvtData->pMcrClockDevice);
+			pPvtData->pMcrClockDevice = NULL;
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
@@ -727,6 +969,7 @@ extern DLL_EXPORT bool openavbMapUncmpAudioInitialize(media_q_t *pMediaQ, openav
 
 		pvt_data_t *pPvtData = pMediaQ->pPvtMapInfo;
 		media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
+		openavbMediaQSetPubMapInfoSize(pMediaQ, sizeof(media_q_pub_map_uncmp_audio_info_t));
 
 		pMapCB->map_cfg_cb = openavbMapUncmpAudioCfgCB;
 		pMapCB->map_subtype_cb = openavbMapUncmpAudioSubtypeCB;
@@ -737,6 +980,7 @@ extern DLL_EXPORT bool openavbMapUncmpAudioInitialize(media_q_t *pMediaQ, openav
 		pMapCB->map_avdecc_init_cb = openavbMapUncmpAudioAVDECCInitCB;
 		pMapCB->map_tx_init_cb = openavbMapUncmpAudioTxInitCB;
 		pMapCB->map_tx_cb = openavbMapUncmpAudioTxCB;
+		pMapCB->map_tx_null_cb = openavbMapUncmpAudioTxNullCB;
 		pMapCB->map_rx_init_cb = openavbMapUncmpAudioRxInitCB;
 		pMapCB->map_rx_cb = openavbMapUncmpAudioRxCB;
 		pMapCB->map_end_cb = openavbMapUncmpAudioEndCB;
@@ -748,6 +992,8 @@ extern DLL_EXPORT bool openavbMapUncmpAudioInitialize(media_q_t *pMediaQ, openav
 		pPvtData->maxTransitUsec = inMaxTransitUsec;
 		pPvtData->DBC = 0;
 		pPvtData->audioMcr = AVB_MCR_NONE;
+		pPvtData->mcrClockHz = 1000;
+		pPvtData->sparseMode = TS_SPARSE_MODE_DISABLED;
 
 		pPubMapInfo->sparseMode = TS_SPARSE_MODE_UNSPEC;
 
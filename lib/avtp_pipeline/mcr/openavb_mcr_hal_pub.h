@@ -41,6 +41,11 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define HAL_INIT_MCR_V2(packetRate, pushInterval, timestampInterval, recoveryInterval) halInitMCR(packetRate, pushInterval, timestampInterval, recoveryInterval)
 #define HAL_CLOSE_MCR_V2() halCloseMCR()
 #define HAL_PUSH_MCR_V2() halPushMCR()
+#define HAL_PUSH_MCR_TIMESTAMP_V2(timestamp, frames, audioRate) halPushMCRTimestamp(timestamp, frames, audioRate)
+#define HAL_GET_MCR_RATE_V2(pRatePpb) halGetMCRRatePpb(pRatePpb)
+#define HAL_SET_MCR_CLOCK_OUTPUT_V2(pDevice, pin, clockHz) halSetMCRClockOutput(pDevice, pin, clockHz)
+#define HAL_SET_MCR_CLOCK_INPUT_V2(pDevice, pin, clockHz) halSetMCRClockInput(pDevice, pin, clockHz)
+#define HAL_GET_MCR_INPUT_RATE_V2(pRatePpb) halGetMCRInputRatePpb(pRatePpb)
 
 // Initialize HAL MCR
 bool halInitMCR(U32 packetRate, U32 pushInterval, U32 timeStampInterval, U32 recoveryInterval);
@@ -51,6 +56,27 @@ bool halCloseMCR(void);
 // Push MCR Event
 bool halPushMCR(void);
 
+// Push a received AVTP timestamp for clock recovery. frames is the number of media clock frames
+// between this timestamp and the previously pushed one at the nominal audioRate.
+bool halPushMCRTimestamp(U32 timestamp, U32 frames, U32 audioRate);
+
+// Recovered talker media clock offset from nominal in parts per billion. Positive values mean the
+// talker clock runs fast. Returns FALSE until the recovery has locked.
+bool halGetMCRRatePpb(S32 *pRatePpb);
+
+// Output the recovered media clock divided down to clockHz on a hardware pin. pDevice names the
+// clock device (a PTP hardware clock on Linux). Returns FALSE if the platform has no such output.
+bool halSetMCRClockOutput(const char *pDevice, U32 pin, U32 clockHz);
+
+// Timestamp the rising edges of an external media clock (word clock, divided down to clockHz) on a
+// hardware pin. pDevice is a PTP hardware clock (/dev/ptpN) or the name of an interface attached
+// through the igb library. pDevice NULL stops the capture. Independent of the recovery above.
+bool halSetMCRClockInput(const char *pDevice, U32 pin, U32 clockHz);
+
+// External media clock offset from nominal against gPTP time in parts per billion, positive when it
+// runs fast. Collects the pending edges, so call it regularly. Returns FALSE until locked.
+bool halGetMCRInputRatePpb(S32 *pRatePpb);
+
 // MCR timer adjustment. Negative value speed up the media clock. Positive values slow the media clock.
 // Will take effect during the next clock recovery interval. This is completely indepentant from pure MCR and
 // allows for adjustments based on media buffer levels. The value past in works as credit with each 
@@ -0,0 +1,171 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Software media clock recovery
+*
+* The talker stamps its media clock frames with gPTP presentation times, so
+* the gPTP duration of a known number of frames gives the talker media clock
+* rate relative to nominal. Durations are summed over a recovery window and
+* the per window measurement is filtered into a frequency estimate that the
+* platform HAL uses to steer a local clock (ALSA rate control, i210 SDP).
+*/
+
+#include <string.h>
+#include "openavb_platform_pub.h"
+#include "openavb_types_pub.h"
+#include "openavb_mcr_sw.h"
+
+#define	AVB_LOG_COMPONENT	"MCR"
+#include "openavb_log_pub.h"
+
+#define MCR_SW_DEFAULT_RECOVERY_INTERVAL	512
+
+// A timestamp step this far from nominal is a gap or a stream restart
+#define MCR_SW_STEP_TOLERANCE_DIV			8
+
+// Far outside any crystal tolerance, treat as loss of lock
+#define MCR_SW_MAX_PPB						500000
+
+// Loop filter weight, 1 / 2^N of each new measurement
+#define MCR_SW_FILTER_SHIFT					2
+
+void openavbMcrSwInit(mcr_sw_t *pMcr, U32 recoveryInterval)
+{
+	memset(pMcr, 0, sizeof(*pMcr));
+	pMcr->recoveryInterval = recoveryInterval ? recoveryInterval : MCR_SW_DEFAULT_RECOVERY_INTERVAL;
+}
+
+void openavbMcrSwReset(mcr_sw_t *pMcr)
+{
+	openavbMcrSwInit(pMcr, pMcr->recoveryInterval);
+}
+
+static void x_windowReset(mcr_sw_t *pMcr)
+{
+	pMcr->windowPushes = 0;
+	pMcr->windowFrames = 0;
+	pMcr->windowNSec = 0;
+}
+
+bool openavbMcrSwPush(mcr_sw_t *pMcr, U32 timestamp, U32 frames, U32 audioRate)
+{
+	if (!pMcr->recoveryInterval) {
+		openavbMcrSwInit(pMcr, 0);
+	}
+
+	if (!audioRate) {
+		return FALSE;
+	}
+
+	if (!pMcr->bHaveLast || audioRate != pMcr->audioRate) {
+		pMcr->bHaveLast = TRUE;
+		pMcr->lastTimestamp = timestamp;
+		pMcr->audioRate = audioRate;
+		x_windowReset(pMcr);
+		return FALSE;
+	}
+
+	if (!frames) {
+		// Same frame pushed again
+		return FALSE;
+	}
+
+	// The 32 bit AVTP timestamp wraps every ~4.3s
+	U32 deltaNSec = timestamp - pMcr->lastTimestamp;
+	U64 nominalNSec = (U64)frames * NANOSECONDS_PER_SECOND / audioRate;
+	pMcr->lastTimestamp = timestamp;
+
+	S64 stepErr = (S64)deltaNSec - (S64)nominalNSec;
+	if (stepErr < 0) {
+		stepErr = -stepErr;
+	}
+	if ((U64)stepErr > nominalNSec / MCR_SW_STEP_TOLERANCE_DIV) {
+		IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("MCR timestamp step %u ns, expected %" PRIu64 " ns, restarting window", deltaNSec, nominalNSec);
+		x_windowReset(pMcr);
+		return FALSE;
+	}
+
+	pMcr->windowFrames += frames;
+	pMcr->windowNSec += deltaNSec;
+	if (++pMcr->windowPushes < pMcr->recoveryInterval) {
+		return FALSE;
+	}
+
+	// Frames took less gPTP time than nominal when the talker runs fast
+	U64 windowNominalNSec = pMcr->windowFrames * NANOSECONDS_PER_SECOND / audioRate;
+	S64 measPpb = ((S64)windowNominalNSec - (S64)pMcr->windowNSec) * 1000000000LL / (S64)pMcr->windowNSec;
+	U64 windowNSec = pMcr->windowNSec;
+	x_windowReset(pMcr);
+
+	if (measPpb > MCR_SW_MAX_PPB || measPpb < -MCR_SW_MAX_PPB) {
+		AVB_LOGF_WARNING("MCR measured %" PRId64 " ppb, out of range", measPpb);
+		openavbMcrSwReset(pMcr);
+		return FALSE;
+	}
+
+	if (pMcr->windows++ == 0) {
+		pMcr->ratePpb = measPpb;
+	}
+	else {
+		pMcr->ratePpb += (measPpb - pMcr->ratePpb) / (1 << MCR_SW_FILTER_SHIFT);
+	}
+
+	// Spend the buffer level credit over the next window
+	S64 adjNSec = pMcr->adjCreditNSec;
+	if (pMcr->adjGranularityNSec) {
+		adjNSec = (adjNSec / (S64)pMcr->adjGranularityNSec) * (S64)pMcr->adjGranularityNSec;
+	}
+	pMcr->adjCreditNSec -= adjNSec;
+	// A positive adjustment slows the media clock
+	pMcr->outPpb = pMcr->ratePpb - adjNSec * 1000000000LL / (S64)windowNSec;
+
+	IF_LOG_INTERVAL(10) AVB_LOGF_DEBUG("MCR meas:%" PRId64 " ppb rate:%" PRId64 " ppb out:%" PRId64 " ppb", measPpb, pMcr->ratePpb, pMcr->outPpb);
+	return TRUE;
+}
+
+bool openavbMcrSwGetRatePpb(mcr_sw_t *pMcr, S32 *pRatePpb)
+{
+	if (pMcr->windows < 2) {
+		return FALSE;
+	}
+	*pRatePpb = (S32)pMcr->outPpb;
+	return TRUE;
+}
+
+void openavbMcrSwAdjustNSec(mcr_sw_t *pMcr, S32 adjNSec)
+{
+	pMcr->adjCreditNSec += adjNSec;
+}
+
+void openavbMcrSwAdjustGranularityNSec(mcr_sw_t *pMcr, U32 adjGranularityNSec)
+{
+	pMcr->adjGranularityNSec = adjGranularityNSec;
+}
@@ -0,0 +1,79 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE : Software media clock recovery from received AVTP timestamps
+*/
+
+#ifndef OPENAVB_MCR_SW_H
+#define OPENAVB_MCR_SW_H
+
+#include "openavb_types_base_pub.h"
+
+typedef struct {
+	// Timestamps per rate measurement window
+	U32 recoveryInterval;
+	U32 adjGranularityNSec;
+
+	bool bHaveLast;
+	U32 lastTimestamp;
+
+	// Current measurement window
+	U32 windowPushes;
+	U64 windowFrames;
+	U64 windowNSec;
+	U32 audioRate;
+
+	// Filtered talker media clock offset from nominal
+	S64 ratePpb;
+	// ratePpb plus any pending buffer level adjustment
+	S64 outPpb;
+	U32 windows;
+
+	// Buffer level adjustment credit from halAdjustMCRNSec()
+	S32 adjCreditNSec;
+} mcr_sw_t;
+
+void openavbMcrSwInit(mcr_sw_t *pMcr, U32 recoveryInterval);
+void openavbMcrSwReset(mcr_sw_t *pMcr);
+
+// Feed a valid AVTP timestamp that lies frames media clock frames after the
+// previously pushed one. Returns TRUE when a measurement window completed and
+// the rate estimate changed.
+bool openavbMcrSwPush(mcr_sw_t *pMcr, U32 timestamp, U32 frames, U32 audioRate);
+
+// Talker media clock offset from nominal in ppb, positive when it runs fast.
+// Returns FALSE until two windows have been measured.
+bool openavbMcrSwGetRatePpb(mcr_sw_t *pMcr, S32 *pRatePpb);
+
+void openavbMcrSwAdjustNSec(mcr_sw_t *pMcr, S32 adjNSec);
+void openavbMcrSwAdjustGranularityNSec(mcr_sw_t *pMcr, U32 adjGranularityNSec);
+
+#endif // OPENAVB_MCR_SW_H
@@ -32,11 +32,49 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "openavb_log_pub.h"
 #include "openavb_mcs.h"
 
+#define MCS_Q32_MASK 0xFFFFFFFFULL
+
 void openavbMcsInit(mcs_t *mediaClockSynth, U64 nsPerAdvance)
 {
   mediaClockSynth->firstTimeSet = FALSE;
   mediaClockSynth->nsPerAdvance = nsPerAdvance;
   mediaClockSynth->edgeTime = 0;
+  mediaClockSynth->nominalStepQ32 = nsPerAdvance << 32;
+  mediaClockSynth->stepQ32 = mediaClockSynth->nominalStepQ32;
+  mediaClockSynth->edgeFrac = 0;
+}
+
+void openavbMcsInitFraction(mcs_t *mediaClockSynth, U64 nsNum, U32 nsDen)
+{
+  U64 whole = nsNum / nsDen;
+  U64 rem = nsNum % nsDen;
+
+  openavbMcsInit(mediaClockSynth, whole);
+  // rem < nsDen so neither the shift nor the rounded quotient can overflow
+  mediaClockSynth->nominalStepQ32 |= ((rem << 32) + nsDen / 2) / nsDen;
+  mediaClockSynth->stepQ32 = mediaClockSynth->nominalStepQ32;
+}
+
+void openavbMcsSetRateTrim(mcs_t *mediaClockSynth, S32 ratePpb)
+{
+  // Not on the per packet path, a single floating point scale is fine here
+  mediaClockSynth->stepQ32 = mediaClockSynth->nominalStepQ32
+    + (S64)((double)mediaClockSynth->nominalStepQ32 * ratePpb / 1000000000.0);
+  mediaClockSynth->nsPerAdvance = mediaClockSynth->stepQ32 >> 32;
+}
+
+void openavbMcsSetEdge(mcs_t *mediaClockSynth, U64 edgeTime)
+{
+  mediaClockSynth->edgeTime = edgeTime;
+  mediaClockSynth->edgeFrac = 0;
+  mediaClockSynth->firstTimeSet = TRUE;
+}
+
+static inline void x_mcsStep(mcs_t *mediaClockSynth)
+{
+  U64 frac = (U64)mediaClockSynth->edgeFrac + (mediaClockSynth->stepQ32 & MCS_Q32_MASK);
+  mediaClockSynth->edgeTime += (mediaClockSynth->stepQ32 >> 32) + (frac >> 32);
+  mediaClockSynth->edgeFrac = (U32)frac;
 }
 
 void openavbMcsAdvance(mcs_t *mediaClockSynth)
@@ -48,7 +86,7 @@ void openavbMcsAdvance(mcs_t *mediaClockSynth)
     }
   }
   else	{
-    mediaClockSynth->edgeTime += mediaClockSynth->nsPerAdvance;
+    x_mcsStep(mediaClockSynth);
 #if !IGB_LAUNCHTIME_ENABLED
     IF_LOG_INTERVAL(8000) {
       U64 nowNS;
@@ -59,3 +97,31 @@ void openavbMcsAdvance(mcs_t *mediaClockSynth)
 #endif
   }
 }
+
+U64 openavbMcsAdvanceN(mcs_t *mediaClockSynth, U32 n, U64 *pEdgeTimes)
+{
+  if (mediaClockSynth->firstTimeSet == FALSE) {
+    openavbMcsAdvance(mediaClockSynth);
+    if (pEdgeTimes && n) {
+      *pEdgeTimes++ = mediaClockSynth->edgeTime;
+    }
+    if (n) {
+      n--;
+    }
+  }
+
+  if (pEdgeTimes) {
+    while (n--) {
+      x_mcsStep(mediaClockSynth);
+      *pEdgeTimes++ = mediaClockSynth->edgeTime;
+    }
+  }
+  else if (n) {
+    // n * frac fits in 64 bits for any U32 n
+    U64 frac = (U64)mediaClockSynth->edgeFrac + (mediaClockSynth->stepQ32 & MCS_Q32_MASK) * n;
+    mediaClockSynth->edgeTime += (mediaClockSynth->stepQ32 >> 32) * n + (frac >> 32);
+    mediaClockSynth->edgeFrac = (U32)frac;
+  }
+
+  return mediaClockSynth->edgeTime;
+}
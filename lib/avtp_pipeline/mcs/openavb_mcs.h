@@ -34,9 +34,30 @@ typedef struct {
   bool firstTimeSet;
   U64 nsPerAdvance;
   U64 edgeTime;
+
+  // Q32.32 nanoseconds per advance, nominal and with the rate trim applied
+  U64 nominalStepQ32;
+  U64 stepQ32;
+  // Fractional nanoseconds carried between advances (Q32)
+  U32 edgeFrac;
 } mcs_t;
 
 void openavbMcsInit(mcs_t *mediaClockSynth, U64 nsPerAdvance);
+
+// Exact fractional advance of nsNum / nsDen nanoseconds, for example
+// NANOSECONDS_PER_SECOND / packetRate or frames * NANOSECONDS_PER_SECOND / audioRate.
+void openavbMcsInitFraction(mcs_t *mediaClockSynth, U64 nsNum, U32 nsDen);
+
+// Scale the advance by (1 + ratePpb / 10^9), e.g. from gPTP syntonization or media clock recovery.
+void openavbMcsSetRateTrim(mcs_t *mediaClockSynth, S32 ratePpb);
+
+// Restart the edges from edgeTime
+void openavbMcsSetEdge(mcs_t *mediaClockSynth, U64 edgeTime);
+
 void openavbMcsAdvance(mcs_t *mediaClockSynth);
 
+// Advance n times at once. The edge time after each advance is stored in
+// pEdgeTimes when it is not NULL. Returns the final edge time.
+U64 openavbMcsAdvanceN(mcs_t *mediaClockSynth, U32 n, U64 *pEdgeTimes);
+
 #endif
@@ -35,12 +35,16 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_platform.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
 #include "openavb_types_pub.h"
 #include "openavb_trace.h"
 #include "openavb_mediaq.h"
 #include "openavb_avtp_time_pub.h"
 
 #include "openavb_printbuf.h"
+#include "openavb_prefault.h"
 
 #define	AVB_LOG_COMPONENT	"Media Queue"
 #include "openavb_log.h"
@@ -53,6 +57,10 @@ static MUTEX_HANDLE(gMediaQMutex);
 // may be too aggressive and can result in never catching up. Therefore it is disabled for now
 //#define ENABLE_FIRST_FUTURE 1
 
+// Maximum number of stale items dropped by a single purge call. Keeps the time spent
+// under the media queue lock bounded when a listener falls far behind.
+#define MEDIAQ_PURGE_BUDGET		8
+
 //#define DUMP_HEAD_PUSH 		1
 //#define DUMP_TAIL_PULL 		1
 
@@ -63,6 +71,15 @@ FILE *pFileHeadPush = 0;
 FILE *pFileTailPull = 0;
 #endif
 
+// External data attached to an item in place of its own buffer
+typedef struct {
+	openavb_media_q_release_cb_t releaseCb;
+	void *pReleaseArg;
+	void *pOwnData;
+	U32 ownItemSize;
+	void *pOwnMapData;
+} media_q_attach_t;
+
 typedef struct {
 	// Maximum number of items the queue can hold.
 	int itemCount;
@@ -70,6 +87,12 @@ typedef struct {
 	// The size in bytes of each item
 	int itemSize;
 
+	// The size in bytes of each item's public map data
+	int itemPubMapSize;
+
+	// The size in bytes of the mapping module's pPubMapInfo
+	int pubMapInfoSize;
+
 	// Pointer to the array of items.
 	media_q_item_t *pItems;
 
@@ -97,8 +120,770 @@ typedef struct {
 	// Maximum stale tail
 	U32 maxStaleTailUsec;
 
+	// Determines if the lock-free single producer / single consumer mode is used
+	// for Head and Tail access. When set the head and tail members are not used.
+	bool lockFreeOn;
+
+	// Lock-free mode indexes run from 0 to (2 * itemCount) - 1 so that a full
+	// queue can be told apart from an empty one. The padding keeps the index
+	// written by the producer and the index written by the consumer on separate
+	// cache lines.
+	U8 lockFreePad0[OPENAVB_CACHE_LINE_SIZE];
+
+	// Lock-free mode: next item to be filled. Only written by the producer.
+	U32 lockFreeHead;
+
+	U8 lockFreePad1[OPENAVB_CACHE_LINE_SIZE - sizeof(U32)];
+
+	// Lock-free mode: next item to be pulled. Only written by the consumer.
+	U32 lockFreeTail;
+
+	U8 lockFreePad2[OPENAVB_CACHE_LINE_SIZE - sizeof(U32)];
+
+	// Buffer offered by openavbMediaQHeadLend() for the next empty head item
+	void *pLendBuf;
+
+	// Index of the item currently using a lent buffer or -1 if there isn't one.
+	int lentIdx;
+
+	// The lent item's own data buffer, put back when the loan ends
+	void *pLentOwnData;
+
+	// Per item external data attached with openavbMediaQHeadAttach()
+	media_q_attach_t *pAttach;
+
+	// Determines if items are carved out of a single mapped arena
+	bool arenaOn;
+
+	// Arena mapping, its size and how much of it has been handed out
+	U8 *pArena;
+	size_t arenaSize;
+	size_t arenaUsed;
+
+	// True once the arena has been locked into memory
+	bool arenaLocked;
+
+	// Byte ring mode: item data is carved out of one ring in push order so
+	// memory follows the bytes actually queued rather than itemCount * itemSize.
+	// itemSize is then the most a single item can hold.
+	bool ringOn;
+	U32 ringSize;
+	U8 *pRing;
+
+	// Ring positions run freely and are reduced modulo ringSize. ringWrite is
+	// only written by the producer, ringRead only by the consumer.
+	U64 ringWrite;
+	U64 ringRead;
+
+	// Per item start of its reservation and the ring position just past it
+	U64 *pRingStart;
+	U64 *pRingEnd;
+
+	// Running totals kept on push and pull so the queue can be measured without
+	// walking it. Byte totals are of dataLen at push time; pItemEnd holds the
+	// pushed byte total right after each item was pushed.
+	U64 *pItemEnd;
+	U64 pushedBytes;
+	U64 pulledBytes;
+	U32 pushedItems;
+	U32 pulledItems;
+
+	// Ready boundary: the items at the tail whose timestamp has passed. The
+	// boundary only moves forward as time passes and items are pulled.
+	// pPresentNS holds each queued item's presentation time as pushed, 0 for
+	// one without a usable timestamp, so readiness is checked by scanning a
+	// packed array instead of the items. itemLatencyNS is the max latency the
+	// item times were created with.
+	U64 *pPresentNS;
+	U64 itemLatencyNS;
+	U32 readyItems;
+	U64 readyEnd;
+	int readySlot;
+
+	// Lock-free mode ready boundary as a count of items pulled or ready, so
+	// pulls move it along with the tail
+	U32 lockFreeReady;
+
+	// Total number of stale items dropped by the tail purge
+	U64 purgedItems;
+
+	// Most items queued at once, 0 for all of them, and the number of times
+	// an empty head was refused because of it. Set from another thread than
+	// the producer's.
+	U32 depthLimit;
+	U64 depthLimitedItems;
+
+	// Presentation time order mode: pushed items are moved ahead of queued items
+	// with a later timestamp. Late and optionally duplicate items are dropped.
+	bool orderedOn;
+	U32 maxLateUsec;
+	bool dropDuplicates;
+
+	// Presentation time of the last item pulled with a valid timestamp
+	bool havePulledNS;
+	U64 pulledNS;
+
+	U64 reorderedItems;
+	U64 lateItems;
+	U64 duplicateItems;
+
+	// Optional latency histograms owned by the caller. Residency is recorded by
+	// the thread pulling the tail, push margin by the thread pushing the head.
+	// pPushNS holds the wall time each item was pushed.
+	openavb_hist_t *pResidencyHist;
+	openavb_hist_t *pPushMarginHist;
+	U64 *pPushNS;
+
+	// Optional occupancy instrumentation owned by the caller. bOverflow is set
+	// by the producer while the head is being refused, so an overflow is only
+	// logged once.
+	media_q_instr_t *pInstr;
+	bool bOverflow;
+
+	// Queue built in caller storage by openavbMediaQCreateIn(); not freed on delete
+	bool embedded;
+
 } media_q_info_t;
 
+// Huge page size used for MAP_HUGETLB arenas
+#define MEDIAQ_ARENA_HUGE_PAGE_SIZE		(2 * 1024 * 1024)
+
+// Room left in the arena for per-item map and interface data
+#define MEDIAQ_ARENA_ITEM_EXTRA			256
+
+#define MEDIAQ_ALIGN(x, a)	(((x) + (a) - 1) & ~((size_t)(a) - 1))
+
+static inline int x_openavbMediaQLockFreeSlot(media_q_info_t *pMediaQInfo, U32 idx)
+{
+	return idx < pMediaQInfo->itemCount ? idx : idx - pMediaQInfo->itemCount;
+}
+
+static inline U32 x_openavbMediaQLockFreeNext(media_q_info_t *pMediaQInfo, U32 idx)
+{
+	return ++idx < (pMediaQInfo->itemCount * 2) ? idx : 0;
+}
+
+static inline U32 x_openavbMediaQLockFreeFill(media_q_info_t *pMediaQInfo, U32 head, U32 tail)
+{
+	return head >= tail ? head - tail : head + (pMediaQInfo->itemCount * 2) - tail;
+}
+
+static inline U32 x_openavbMediaQLockFreePrev(media_q_info_t *pMediaQInfo, U32 idx)
+{
+	return idx > 0 ? idx - 1 : (pMediaQInfo->itemCount * 2) - 1;
+}
+
+// Returns the index of the current tail item or -1 if there isn't one.
+static int x_openavbMediaQTailIdx(media_q_info_t *pMediaQInfo)
+{
+	if (pMediaQInfo->lockFreeOn) {
+		U32 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->lockFreeHead);
+		if (head == pMediaQInfo->lockFreeTail) {
+			return -1;
+		}
+		return x_openavbMediaQLockFreeSlot(pMediaQInfo, pMediaQInfo->lockFreeTail);
+	}
+	return pMediaQInfo->tail;
+}
+
+// Returns the index of the item the producer is filling or -1 if the queue is full.
+static int x_openavbMediaQHeadIdx(media_q_info_t *pMediaQInfo)
+{
+	if (pMediaQInfo->lockFreeOn) {
+		U32 tail = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->lockFreeTail);
+		if (x_openavbMediaQLockFreeFill(pMediaQInfo, pMediaQInfo->lockFreeHead, tail) >= pMediaQInfo->itemCount) {
+			return -1;
+		}
+		return x_openavbMediaQLockFreeSlot(pMediaQInfo, pMediaQInfo->lockFreeHead);
+	}
+	return pMediaQInfo->head;
+}
+
+// Give the lent item its own data buffer back, optionally keeping the data it holds.
+static void x_openavbMediaQUnlend(media_q_info_t *pMediaQInfo, bool bKeepData)
+{
+	media_q_item_t *pItem = &pMediaQInfo->pItems[pMediaQInfo->lentIdx];
+
+	if (bKeepData && pItem->dataLen > 0) {
+		memcpy(pMediaQInfo->pLentOwnData, pItem->pPubData, pItem->dataLen);
+	}
+	pItem->pPubData = pMediaQInfo->pLentOwnData;
+	pMediaQInfo->pLentOwnData = NULL;
+	pMediaQInfo->lentIdx = -1;
+}
+
+// Give an item with attached data its own buffer back and release the data.
+static void x_openavbMediaQDetach(media_q_info_t *pMediaQInfo, int idx)
+{
+	if (pMediaQInfo->pAttach && pMediaQInfo->pAttach[idx].releaseCb) {
+		media_q_attach_t *pAttach = &pMediaQInfo->pAttach[idx];
+		media_q_item_t *pItem = &pMediaQInfo->pItems[idx];
+
+		pItem->pPubData = pAttach->pOwnData;
+		pItem->itemSize = pAttach->ownItemSize;
+		pItem->pPubMapData = pAttach->pOwnMapData;
+		pAttach->releaseCb(pAttach->pReleaseArg);
+		pAttach->releaseCb = NULL;
+		pAttach->pReleaseArg = NULL;
+		pAttach->pOwnData = NULL;
+		pAttach->pOwnMapData = NULL;
+	}
+}
+
+// Switch the head item over to the lent buffer if the queue is empty and the
+// item has no data yet, so nothing already queued can be left pointing at it.
+static void x_openavbMediaQLendHead(media_q_info_t *pMediaQInfo, int headIdx, bool bEmpty)
+{
+	media_q_item_t *pItem = &pMediaQInfo->pItems[headIdx];
+
+	if (pMediaQInfo->pLendBuf && pMediaQInfo->lentIdx == -1 && bEmpty && pItem->dataLen == 0) {
+		pMediaQInfo->pLentOwnData = pItem->pPubData;
+		pItem->pPubData = pMediaQInfo->pLendBuf;
+		pMediaQInfo->lentIdx = headIdx;
+	}
+}
+
+// Byte ring mode: give the head item room for a whole item from the ring if it
+// doesn't already have it. The room is always contiguous; when too little is
+// left before the end of the ring the reservation starts over at the beginning.
+// Without bData the item is only going to have data attached, so it is left
+// without room. Returns FALSE if the ring is too full.
+static bool x_openavbMediaQRingReserve(media_q_info_t *pMediaQInfo, int headIdx, bool bData)
+{
+	media_q_item_t *pItem = &pMediaQInfo->pItems[headIdx];
+	U64 pos = pMediaQInfo->ringWrite;
+	U32 offset = pos % pMediaQInfo->ringSize;
+
+	if (pItem->pPubData || !bData) {
+		return TRUE;
+	}
+
+	if (offset + pMediaQInfo->itemSize > pMediaQInfo->ringSize) {
+		pos += pMediaQInfo->ringSize - offset;
+		offset = 0;
+	}
+	if (pos + pMediaQInfo->itemSize - OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->ringRead) > pMediaQInfo->ringSize) {
+		return FALSE;
+	}
+
+	pMediaQInfo->pRingStart[headIdx] = pos;
+	pItem->pPubData = pMediaQInfo->pRing + offset;
+	return TRUE;
+}
+
+// Byte ring mode: hand the unused part of the head item's reservation back to
+// the producer. Attached items hold no ring data at all.
+static void x_openavbMediaQRingCommit(media_q_info_t *pMediaQInfo, int headIdx)
+{
+	U32 used = pMediaQInfo->pItems[headIdx].dataLen;
+
+	if (pMediaQInfo->pAttach[headIdx].releaseCb || !pMediaQInfo->pItems[headIdx].pPubData) {
+		// Nothing was written, so even a reservation that wrapped is not used
+		pMediaQInfo->pRingEnd[headIdx] = pMediaQInfo->ringWrite;
+		return;
+	}
+	pMediaQInfo->pRingEnd[headIdx] = pMediaQInfo->pRingStart[headIdx] + MEDIAQ_ALIGN(used, OPENAVB_CACHE_LINE_SIZE);
+	pMediaQInfo->ringWrite = pMediaQInfo->pRingEnd[headIdx];
+}
+
+// Byte ring mode: the pulled item's bytes go back to the ring.
+static void x_openavbMediaQRingRelease(media_q_info_t *pMediaQInfo, int tailIdx)
+{
+	pMediaQInfo->pItems[tailIdx].pPubData = NULL;
+
+	// Release ordering keeps the producer from reusing the bytes before they are read
+	OPENAVB_ATOMIC_STORE_RELEASE(&pMediaQInfo->ringRead, pMediaQInfo->pRingEnd[tailIdx]);
+}
+
+// Map the arena for itemCount items of itemSize bytes. Huge pages are tried
+// first; without reserved huge pages an ordinary mapping is used and the kernel
+// is asked to back it with transparent huge pages. Pages are not touched here
+// so they are faulted in by the stream thread in openavbMediaQArenaLock().
+static bool x_openavbMediaQArenaCreate(media_q_info_t *pMediaQInfo, int itemCount, int itemSize)
+{
+	size_t size = MEDIAQ_ALIGN(itemCount * sizeof(media_q_item_t), OPENAVB_CACHE_LINE_SIZE)
+		+ 3 * MEDIAQ_ALIGN(itemCount * sizeof(U64), OPENAVB_CACHE_LINE_SIZE)	// item end, push and presentation times
+		+ itemCount * (MEDIAQ_ALIGN(itemSize, OPENAVB_CACHE_LINE_SIZE) + MEDIAQ_ARENA_ITEM_EXTRA)
+		+ pMediaQInfo->ringSize;
+	void *pArena;
+
+	size = MEDIAQ_ALIGN(size, MEDIAQ_ARENA_HUGE_PAGE_SIZE);
+	pArena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (pArena == MAP_FAILED) {
+		pArena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pArena == MAP_FAILED) {
+			AVB_LOGF_WARNING("MediaQ arena of %zu bytes not available, using the heap", size);
+			return FALSE;
+		}
+		madvise(pArena, size, MADV_HUGEPAGE);
+		AVB_LOGF_INFO("MediaQ arena: %zu bytes (no reserved huge pages)", size);
+	}
+	else {
+		AVB_LOGF_INFO("MediaQ arena: %zu bytes in huge pages", size);
+	}
+
+	pMediaQInfo->pArena = pArena;
+	pMediaQInfo->arenaSize = size;
+	pMediaQInfo->arenaUsed = 0;
+	return TRUE;
+}
+
+// Zeroed storage from the arena, or from the heap once the arena is used up
+// (or not in use).
+static void *x_openavbMediaQAlloc(media_q_info_t *pMediaQInfo, size_t size)
+{
+	if (pMediaQInfo->pArena) {
+		size_t offset = MEDIAQ_ALIGN(pMediaQInfo->arenaUsed, OPENAVB_CACHE_LINE_SIZE);
+		if (offset + size <= pMediaQInfo->arenaSize) {
+			pMediaQInfo->arenaUsed = offset + size;
+			return pMediaQInfo->pArena + offset;
+		}
+		IF_LOG_INTERVAL(100) AVB_LOG_WARNING("MediaQ arena full, using the heap");
+	}
+	return calloc(1, size);
+}
+
+static void x_openavbMediaQFree(media_q_info_t *pMediaQInfo, void *p)
+{
+	if (pMediaQInfo->pArena
+		&& (U8 *)p >= pMediaQInfo->pArena
+		&& (U8 *)p < pMediaQInfo->pArena + pMediaQInfo->arenaSize) {
+		return;
+	}
+	free(p);
+}
+
+// pPresentNS value of a taken item, which is never ready
+#define MEDIAQ_NS_TAKEN					(~(U64)0)
+
+// Snapshot the presentation time of the item at slot idx
+static inline void x_openavbMediaQSetPresentNS(media_q_info_t *pMediaQInfo, int idx)
+{
+	avtp_time_t *pAvtpTime = pMediaQInfo->pItems[idx].pAvtpTime;
+	if (openavbAvtpTimeTimestampIsValid(pAvtpTime) && !openavbAvtpTimeTimestampIsUncertain(pAvtpTime)) {
+		pMediaQInfo->pPresentNS[idx] = openavbAvtpTimeGetAvtpTimeNS(pAvtpTime);
+	}
+	else {
+		pMediaQInfo->pPresentNS[idx] = 0;
+	}
+}
+
+// Same test as openavbAvtpTimeIsPastTime() on a snapshot: ready once nowNS
+// reaches the presentation time, or when that time is further ahead than the
+// max latency. A time of 0 is always ready.
+static inline bool x_openavbMediaQPresentIsPast(media_q_info_t *pMediaQInfo, U64 presentNS, U64 nowNS)
+{
+	return presentNS - nowNS - 1 >= pMediaQInfo->itemLatencyNS;
+}
+
+// Same as openavbAvtpTimeUsecDelta() on a snapshot: 0 when there is no time
+static inline S32 x_openavbMediaQPresentUsecDelta(U64 presentNS, U64 nowNS)
+{
+	return presentNS ? (S32)((S64)(presentNS - nowNS) / NANOSECONDS_PER_USEC) : 0;
+}
+
+static U32 x_openavbMediaQQueuedItems(media_q_info_t *pMediaQInfo, U64 *pEnd);
+
+// Log an event in the instrumentation. The producer and the consumer may both
+// log, so the slot is claimed atomically.
+static void x_openavbMediaQInstrEvent(media_q_info_t *pMediaQInfo, U32 type, U32 items)
+{
+	media_q_instr_t *pInstr = pMediaQInfo->pInstr;
+	U64 n = OPENAVB_ATOMIC_FETCH_ADD(&pInstr->eventHead, 1);
+	media_q_event_t *pEvent = &pInstr->event[n % MEDIAQ_INSTR_EVENTS];
+	U64 nowNS;
+
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	OPENAVB_ATOMIC_STORE_RELAXED(&pEvent->seq, 0);
+	OPENAVB_ATOMIC_FENCE();
+	OPENAVB_ATOMIC_STORE_RELAXED(&pEvent->timeNS, nowNS);
+	OPENAVB_ATOMIC_STORE_RELAXED(&pEvent->type, type);
+	OPENAVB_ATOMIC_STORE_RELAXED(&pEvent->items, items);
+	OPENAVB_ATOMIC_STORE_RELEASE(&pEvent->seq, n + 1);
+}
+
+// Sample the depth after a push (producer)
+static inline void x_openavbMediaQInstrPush(media_q_info_t *pMediaQInfo, U32 depth)
+{
+	media_q_instr_t *pInstr = pMediaQInfo->pInstr;
+	U32 gen = OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->markGen);
+
+	openavbHistRecord(&pInstr->pushDepth, depth);
+	if (gen != OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->highGen)
+		|| depth > OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->highWater)) {
+		OPENAVB_ATOMIC_STORE_RELAXED(&pInstr->highWater, depth);
+		OPENAVB_ATOMIC_STORE_RELEASE(&pInstr->highGen, gen);
+	}
+}
+
+// Sample the depth before a pull (consumer)
+static inline void x_openavbMediaQInstrPull(media_q_info_t *pMediaQInfo, U32 depth)
+{
+	media_q_instr_t *pInstr = pMediaQInfo->pInstr;
+	U32 gen = OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->markGen);
+	U32 left = depth > 0 ? depth - 1 : 0;
+
+	openavbHistRecord(&pInstr->pullDepth, depth);
+	if (gen != OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->lowGen)
+		|| left < OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->lowWater)) {
+		OPENAVB_ATOMIC_STORE_RELAXED(&pInstr->lowWater, left);
+		OPENAVB_ATOMIC_STORE_RELEASE(&pInstr->lowGen, gen);
+	}
+}
+
+// Record the head being refused (bRefused) or handed out
+static inline void x_openavbMediaQInstrHead(media_q_info_t *pMediaQInfo, bool bRefused, bool bLimited)
+{
+	if (!bRefused) {
+		pMediaQInfo->bOverflow = FALSE;
+	}
+	else if (!pMediaQInfo->bOverflow) {
+		pMediaQInfo->bOverflow = TRUE;
+		x_openavbMediaQInstrEvent(pMediaQInfo, bLimited ? MEDIAQ_EVENT_LIMITED : MEDIAQ_EVENT_OVERFLOW,
+			x_openavbMediaQQueuedItems(pMediaQInfo, NULL));
+	}
+}
+
+// Record an item being pushed at slot idx
+static inline void x_openavbMediaQCountPush(media_q_info_t *pMediaQInfo, int idx)
+{
+	pMediaQInfo->pushedBytes += pMediaQInfo->pItems[idx].dataLen;
+	pMediaQInfo->pItemEnd[idx] = pMediaQInfo->pushedBytes;
+	pMediaQInfo->pushedItems++;
+	x_openavbMediaQSetPresentNS(pMediaQInfo, idx);
+
+	if (pMediaQInfo->pInstr) {
+		// The lock-free head only moves past the item after this
+		x_openavbMediaQInstrPush(pMediaQInfo,
+			x_openavbMediaQQueuedItems(pMediaQInfo, NULL) + (pMediaQInfo->lockFreeOn ? 1 : 0));
+	}
+
+	if (pMediaQInfo->pResidencyHist || pMediaQInfo->pPushMarginHist) {
+		U64 nowNS;
+		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+		pMediaQInfo->pPushNS[idx] = nowNS;
+
+		avtp_time_t *pAvtpTime = pMediaQInfo->pItems[idx].pAvtpTime;
+		if (pMediaQInfo->pPushMarginHist
+			&& openavbAvtpTimeTimestampIsValid(pAvtpTime)
+			&& !openavbAvtpTimeTimestampIsUncertain(pAvtpTime)) {
+			openavbHistRecordDelta(pMediaQInfo->pPushMarginHist,
+				(S64)(openavbAvtpTimeGetAvtpTimeNS(pAvtpTime) - nowNS));
+		}
+	}
+}
+
+// Record the item at slot idx leaving the queue
+static inline void x_openavbMediaQCountPull(media_q_info_t *pMediaQInfo, int idx)
+{
+	if (pMediaQInfo->pInstr) {
+		x_openavbMediaQInstrPull(pMediaQInfo, x_openavbMediaQQueuedItems(pMediaQInfo, NULL));
+	}
+
+	pMediaQInfo->pulledBytes = pMediaQInfo->pItemEnd[idx];
+	pMediaQInfo->pulledItems++;
+
+	if (pMediaQInfo->pResidencyHist) {
+		U64 nowNS;
+		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+		openavbHistRecordDelta(pMediaQInfo->pResidencyHist, (S64)(nowNS - pMediaQInfo->pPushNS[idx]));
+	}
+}
+
+// An item given back after the head skipped over it sits between the tail and
+// the head and is queued again as an empty item. Otherwise it is simply free.
+static void x_openavbMediaQCountGive(media_q_info_t *pMediaQInfo, int idx)
+{
+	int n = pMediaQInfo->itemCount;
+
+	x_openavbMediaQSetPresentNS(pMediaQInfo, idx);
+
+	if (pMediaQInfo->head == -1) {
+		// The queue was full; this is now its only free slot
+		pMediaQInfo->head = idx;
+		return;
+	}
+
+	if (pMediaQInfo->tail == -1) {
+		return;
+	}
+
+	int dist = (idx - pMediaQInfo->tail + n) % n;
+	if (dist >= (pMediaQInfo->head - pMediaQInfo->tail + n) % n) {
+		// Ahead of the head; it will be filled in turn
+		return;
+	}
+
+	// Takes the byte position of the queued item before it
+	int prev = idx;
+	do {
+		prev = prev > 0 ? prev - 1 : n - 1;
+	} while (pMediaQInfo->pItems[prev].taken && prev != pMediaQInfo->tail);
+	pMediaQInfo->pItemEnd[idx] = pMediaQInfo->pItemEnd[prev];
+	pMediaQInfo->pushedItems++;
+
+	if ((S32)(pMediaQInfo->readyItems - pMediaQInfo->pulledItems) > 0) {
+		int readyDist = (pMediaQInfo->readySlot - pMediaQInfo->tail + n) % n;
+		if (readyDist == 0 || dist < readyDist) {
+			// Inside the ready part of the queue
+			pMediaQInfo->readyItems++;
+		}
+	}
+}
+
+// Move the ready boundary over the items whose time has passed and return the
+// number of ready items. *pReadyEnd is set to the pushed byte total at the end
+// of the last ready item. Items are queued in time order and time only moves
+// forward, so items behind the boundary are never checked again.
+static U32 x_openavbMediaQReadyItems(media_q_info_t *pMediaQInfo, U64 *pReadyEnd)
+{
+	U64 nSecTime;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nSecTime);
+
+	if (pMediaQInfo->lockFreeOn) {
+		U32 tail = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->lockFreeTail);
+		U32 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->lockFreeHead);
+		U32 fill = x_openavbMediaQLockFreeFill(pMediaQInfo, head, tail);
+		S32 known = (S32)(OPENAVB_ATOMIC_LOAD_RELAXED(&pMediaQInfo->lockFreeReady) - pMediaQInfo->pulledItems);
+		U32 readyItems = known > 0 ? (U32)known : 0;
+		if (readyItems > fill) {
+			readyItems = fill;
+		}
+		U32 ready = tail + readyItems;
+		if (ready >= pMediaQInfo->itemCount * 2) {
+			ready -= pMediaQInfo->itemCount * 2;
+		}
+		while (ready != head) {
+			U64 presentNS = pMediaQInfo->pPresentNS[x_openavbMediaQLockFreeSlot(pMediaQInfo, ready)];
+			if (!x_openavbMediaQPresentIsPast(pMediaQInfo, presentNS, nSecTime))
+				break;
+			ready = x_openavbMediaQLockFreeNext(pMediaQInfo, ready);
+			readyItems++;
+		}
+		OPENAVB_ATOMIC_STORE_RELAXED(&pMediaQInfo->lockFreeReady, pMediaQInfo->pulledItems + readyItems);
+		if (pReadyEnd) {
+			*pReadyEnd = readyItems == 0 ? pMediaQInfo->pulledBytes
+				: pMediaQInfo->pItemEnd[x_openavbMediaQLockFreeSlot(pMediaQInfo, x_openavbMediaQLockFreePrev(pMediaQInfo, ready))];
+		}
+		return readyItems;
+	}
+
+	if ((S32)(pMediaQInfo->readyItems - pMediaQInfo->pulledItems) <= 0) {
+		// Nothing known to be ready; start again from the tail
+		pMediaQInfo->readyItems = pMediaQInfo->pulledItems;
+		pMediaQInfo->readyEnd = pMediaQInfo->pulledBytes;
+		pMediaQInfo->readySlot = pMediaQInfo->tail;
+	}
+	while (pMediaQInfo->readyItems != pMediaQInfo->pushedItems && pMediaQInfo->readySlot > -1) {
+		U64 presentNS = pMediaQInfo->pPresentNS[pMediaQInfo->readySlot];
+		if (presentNS != MEDIAQ_NS_TAKEN) {
+			if (!x_openavbMediaQPresentIsPast(pMediaQInfo, presentNS, nSecTime))
+				break;
+			pMediaQInfo->readyItems++;
+			pMediaQInfo->readyEnd = pMediaQInfo->pItemEnd[pMediaQInfo->readySlot];
+		}
+		if (++pMediaQInfo->readySlot >= pMediaQInfo->itemCount)
+			pMediaQInfo->readySlot = 0;
+	}
+	if (pReadyEnd) {
+		*pReadyEnd = pMediaQInfo->readyEnd;
+	}
+	return pMediaQInfo->readyItems - pMediaQInfo->pulledItems;
+}
+
+// Number of items in the queue and, if pEnd is set, the pushed byte total at
+// the end of the last one.
+static U32 x_openavbMediaQQueuedItems(media_q_info_t *pMediaQInfo, U64 *pEnd)
+{
+	if (pMediaQInfo->lockFreeOn) {
+		U32 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->lockFreeHead);
+		U32 tail = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->lockFreeTail);
+		U32 fill = x_openavbMediaQLockFreeFill(pMediaQInfo, head, tail);
+		if (pEnd) {
+			*pEnd = fill == 0 ? pMediaQInfo->pulledBytes
+				: pMediaQInfo->pItemEnd[x_openavbMediaQLockFreeSlot(pMediaQInfo, x_openavbMediaQLockFreePrev(pMediaQInfo, head))];
+		}
+		return fill;
+	}
+
+	if (pEnd) {
+		*pEnd = pMediaQInfo->pushedBytes;
+	}
+	return pMediaQInfo->pushedItems - pMediaQInfo->pulledItems;
+}
+
+// Returns TRUE if the depth limit keeps the head item from being started.
+// A head item already holding data is always given back so it can be finished.
+static inline bool x_openavbMediaQDepthLimited(media_q_info_t *pMediaQInfo, int headIdx)
+{
+	U32 limit = OPENAVB_ATOMIC_LOAD_RELAXED(&pMediaQInfo->depthLimit);
+	if (limit == 0
+		|| pMediaQInfo->pItems[headIdx].dataLen > 0
+		|| x_openavbMediaQQueuedItems(pMediaQInfo, NULL) < limit) {
+		return FALSE;
+	}
+	OPENAVB_ATOMIC_STORE_RELAXED(&pMediaQInfo->depthLimitedItems, pMediaQInfo->depthLimitedItems + 1);
+	return TRUE;
+}
+
+// Ordered mode: the item with a usable presentation time, NULL for one that
+// is queued without being ordered.
+static inline avtp_time_t *x_openavbMediaQOrderTime(media_q_item_t *pItem)
+{
+	if (pItem->dataLen == 0 || !openavbAvtpTimeTimestampIsValid(pItem->pAvtpTime)) {
+		return NULL;
+	}
+	return pItem->pAvtpTime;
+}
+
+// Ordered mode: find where the item at the head belongs. Returns the number of
+// queued items it goes ahead of, or -1 if it is to be dropped.
+static int x_openavbMediaQOrderFind(media_q_info_t *pMediaQInfo)
+{
+	avtp_time_t *pTime = x_openavbMediaQOrderTime(&pMediaQInfo->pItems[pMediaQInfo->head]);
+	if (!pTime) {
+		return 0;
+	}
+	U64 timeNS = openavbAvtpTimeGetAvtpTimeNS(pTime);
+
+	if (pMediaQInfo->havePulledNS) {
+		S64 delta = (S64)(timeNS - pMediaQInfo->pulledNS);
+		if (delta < 0 || (delta == 0 && pMediaQInfo->dropDuplicates)) {
+			// Its turn has already passed
+			if (delta < 0) {
+				pMediaQInfo->lateItems++;
+			}
+			else {
+				pMediaQInfo->duplicateItems++;
+			}
+			return -1;
+		}
+	}
+	if (pMediaQInfo->maxLateUsec) {
+		U64 nowNS;
+		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+		if ((S64)(nowNS - timeNS) > (S64)pMediaQInfo->maxLateUsec * NANOSECONDS_PER_USEC) {
+			pMediaQInfo->lateItems++;
+			return -1;
+		}
+	}
+
+	if (pMediaQInfo->tail == -1) {
+		return 0;
+	}
+
+	// Walk back from the newest queued item; a stream that is in order stops at the first compare
+	int n = pMediaQInfo->itemCount;
+	int ahead = 0;
+	int idx = pMediaQInfo->head;
+	while (idx != pMediaQInfo->tail) {
+		idx = idx > 0 ? idx - 1 : n - 1;
+		media_q_item_t *pItem = &pMediaQInfo->pItems[idx];
+		if (pItem->taken) {
+			continue;
+		}
+		avtp_time_t *pQueuedTime = x_openavbMediaQOrderTime(pItem);
+		if (!pQueuedTime) {
+			// Not ordered, nothing moves ahead of it
+			break;
+		}
+		S64 delta = (S64)(timeNS - openavbAvtpTimeGetAvtpTimeNS(pQueuedTime));
+		if (delta == 0 && pMediaQInfo->dropDuplicates) {
+			pMediaQInfo->duplicateItems++;
+			return -1;
+		}
+		if (delta >= 0) {
+			break;
+		}
+		if (idx == pMediaQInfo->tail && (pMediaQInfo->tailLocked || pItem->readIdx)) {
+			// The tail is being read and can't be overtaken any more
+			pMediaQInfo->lateItems++;
+			return -1;
+		}
+		ahead++;
+	}
+	return ahead;
+}
+
+// Ordered mode: move the item just pushed at the head ahead of the last
+// 'ahead' queued items. Taken items stay where they are; the others shift up
+// one slot along with everything kept per slot.
+static void x_openavbMediaQOrderMove(media_q_info_t *pMediaQInfo, int ahead)
+{
+	int n = pMediaQInfo->itemCount;
+	int to = pMediaQInfo->head;
+	int from = to;
+	media_q_item_t moved = pMediaQInfo->pItems[to];
+	media_q_attach_t movedAttach;
+	U64 movedPushNS = 0;
+	U64 movedPresentNS = pMediaQInfo->pPresentNS[to];
+	bool movedLent = (pMediaQInfo->lentIdx == to);
+
+	if (pMediaQInfo->pAttach) {
+		movedAttach = pMediaQInfo->pAttach[to];
+	}
+	if (pMediaQInfo->pPushNS) {
+		movedPushNS = pMediaQInfo->pPushNS[to];
+	}
+
+	while (ahead > 0) {
+		do {
+			from = from > 0 ? from - 1 : n - 1;
+		} while (pMediaQInfo->pItems[from].taken);
+
+		pMediaQInfo->pItems[to] = pMediaQInfo->pItems[from];
+		pMediaQInfo->pPresentNS[to] = pMediaQInfo->pPresentNS[from];
+		if (pMediaQInfo->pAttach) {
+			pMediaQInfo->pAttach[to] = pMediaQInfo->pAttach[from];
+		}
+		if (pMediaQInfo->pPushNS) {
+			pMediaQInfo->pPushNS[to] = pMediaQInfo->pPushNS[from];
+		}
+		if (pMediaQInfo->lentIdx == from) {
+			pMediaQInfo->lentIdx = to;
+		}
+		to = from;
+		ahead--;
+	}
+
+	pMediaQInfo->pItems[to] = moved;
+	pMediaQInfo->pPresentNS[to] = movedPresentNS;
+	if (pMediaQInfo->pAttach) {
+		pMediaQInfo->pAttach[to] = movedAttach;
+	}
+	if (pMediaQInfo->pPushNS) {
+		pMediaQInfo->pPushNS[to] = movedPushNS;
+	}
+	if (movedLent) {
+		pMediaQInfo->lentIdx = to;
+	}
+
+	// Byte positions follow the new order
+	U64 end = pMediaQInfo->pulledBytes;
+	if (to != pMediaQInfo->tail) {
+		int prev = to;
+		do {
+			prev = prev > 0 ? prev - 1 : n - 1;
+		} while (pMediaQInfo->pItems[prev].taken && prev != pMediaQInfo->tail);
+		end = pMediaQInfo->pItemEnd[prev];
+	}
+	int idx = to;
+	while (TRUE) {
+		if (!pMediaQInfo->pItems[idx].taken) {
+			end += pMediaQInfo->pItems[idx].dataLen;
+			pMediaQInfo->pItemEnd[idx] = end;
+		}
+		if (idx == pMediaQInfo->head) {
+			break;
+		}
+		idx = idx + 1 < n ? idx + 1 : 0;
+	}
+
+	// The ready boundary may have passed the new position; start it over from the tail
+	pMediaQInfo->readyItems = pMediaQInfo->pulledItems;
+	pMediaQInfo->reorderedItems++;
+}
+
 static void x_openavbMediaQIncrementHead(media_q_info_t *pMediaQInfo)	
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
@@ -106,12 +891,17 @@ static void x_openavbMediaQIncrementHead(media_q_info_t *pMediaQInfo)
 	// Module internal function therefore not validating pMediaQInfo
 	
 	int startingHead = pMediaQInfo->head;
-	while (++pMediaQInfo->head != startingHead)
+	while (TRUE)
 	{
-		if (pMediaQInfo->head >= pMediaQInfo->itemCount) {
+		if (++pMediaQInfo->head >= pMediaQInfo->itemCount) {
 			pMediaQInfo->head = 0;
 		}
 
+		// Back where it started: every other item is taken
+		if (pMediaQInfo->head == startingHead) {
+			break;
+		}
+
 		// If head catches up with tail deactivate the head.
 		if (pMediaQInfo->head == pMediaQInfo->tail) {
 			break; // Set head to pMediaQInfo->head = -1;
@@ -137,12 +927,17 @@ static void x_openavbMediaQIncrementTail(media_q_info_t *pMediaQInfo)
 	// Module internal function therefore not validating pMediaQInfo
 	
 	int startingTail = pMediaQInfo->tail;
-	while (++pMediaQInfo->tail != startingTail)
+	while (TRUE)
 	{
-		if (pMediaQInfo->tail >= pMediaQInfo->itemCount) {
+		if (++pMediaQInfo->tail >= pMediaQInfo->itemCount) {
 			pMediaQInfo->tail = 0;
 		}
 
+		// Back where it started: every other item is taken
+		if (pMediaQInfo->tail == startingTail) {
+			break;
+		}
+
 		// If tail catches up with head deactivate the tail.
 		if (pMediaQInfo->tail == pMediaQInfo->head) {
 			break; // Set head to pMediaQInfo->tail = -1;
@@ -161,8 +956,89 @@ static void x_openavbMediaQIncrementTail(media_q_info_t *pMediaQInfo)
 	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
 }
 
-	
-// CORE_TODO: May need to add mutex protection when merging with OSAL/HAL branch.
+
+// Pulls the tail item without touching the global media queue lock. Shared by the
+// public tail pull and the stale tail purge, which do their own locking.
+static bool x_openavbMediaQTailPull(media_q_info_t *pMediaQInfo)
+{
+	if (pMediaQInfo->lockFreeOn) {
+		int tailIdx = pMediaQInfo->itemCount > 0 ? x_openavbMediaQTailIdx(pMediaQInfo) : -1;
+		if (tailIdx > -1) {
+			media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
+			x_openavbMediaQCountPull(pMediaQInfo, tailIdx);
+			pTail->readIdx = 0;		// Reset read index
+			pTail->dataLen = 0;		// Clears out the data
+			if (tailIdx == pMediaQInfo->lentIdx) {
+				x_openavbMediaQUnlend(pMediaQInfo, FALSE);
+			}
+			x_openavbMediaQDetach(pMediaQInfo, tailIdx);
+			if (pMediaQInfo->ringOn) {
+				x_openavbMediaQRingRelease(pMediaQInfo, tailIdx);
+			}
+			pMediaQInfo->tailLocked = FALSE;
+
+			// Release ordering hands the item back to the producer only after it is cleared
+			OPENAVB_ATOMIC_STORE_RELEASE(&pMediaQInfo->lockFreeTail,
+				x_openavbMediaQLockFreeNext(pMediaQInfo, pMediaQInfo->lockFreeTail));
+
+			return TRUE;
+		}
+		return FALSE;
+	}
+	if (pMediaQInfo->itemCount > 0) {
+		if (pMediaQInfo->tail > -1) {
+			media_q_item_t *pTail = &pMediaQInfo->pItems[pMediaQInfo->tail];
+
+#if DUMP_TAIL_PULL
+			media_q_item_t *pMediaQItem = &pMediaQInfo->pItems[pMediaQInfo->tail];
+			if (!pFileTailPull) {
+				char filename[128];
+				sprintf(filename, "tailpull_%5.5d.dat", GET_PID());
+				pFileTailPull = fopen(filename, "wb");
+			}
+			if (pFileTailPull) {
+				size_t result = fwrite(pMediaQItem->pPubData, 1, pMediaQItem->dataLen, pFileTailPull);
+				if (result != pMediaQItem->dataLen)
+					printf("ERROR writing tail pull log");
+			}
+#endif
+
+			// If head not set, set it now
+			if (pMediaQInfo->head == -1) {
+				pMediaQInfo->head = pMediaQInfo->tail;
+			}
+
+			if (pMediaQInfo->orderedOn) {
+				avtp_time_t *pTime = x_openavbMediaQOrderTime(pTail);
+				if (pTime) {
+					pMediaQInfo->pulledNS = openavbAvtpTimeGetAvtpTimeNS(pTime);
+					pMediaQInfo->havePulledNS = TRUE;
+				}
+			}
+
+			x_openavbMediaQCountPull(pMediaQInfo, pMediaQInfo->tail);
+			pTail->readIdx = 0;		// Reset read index
+			pTail->dataLen = 0;		// Clears out the data
+			if (pMediaQInfo->tail == pMediaQInfo->lentIdx) {
+				x_openavbMediaQUnlend(pMediaQInfo, FALSE);
+			}
+			x_openavbMediaQDetach(pMediaQInfo, pMediaQInfo->tail);
+			if (pMediaQInfo->ringOn) {
+				x_openavbMediaQRingRelease(pMediaQInfo, pMediaQInfo->tail);
+			}
+
+			x_openavbMediaQIncrementTail(pMediaQInfo);
+
+			pMediaQInfo->tailLocked = FALSE;
+
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+// Purges stale items from the tail of the queue. At most MEDIAQ_PURGE_BUDGET items are
+// dropped per call; a purge in progress (firstFuture == FALSE) carries over to the next call.
 void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
@@ -184,13 +1060,23 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
 
 			if (pMediaQInfo->maxStaleTailUsec > 0) {
+				bool bLock = pMediaQInfo->threadSafeOn && !pMediaQInfo->lockFreeOn;
 				bool bFirst = TRUE;
 				bool bMore = TRUE;
-				while (bMore) {
+				U32 budget = MEDIAQ_PURGE_BUDGET;
+				U32 purged = 0;
+				U64 nowNS;
+				CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+
+				if (bLock) {
+					MEDIAQ_LOCK();
+				}
+				while (bMore && budget > 0) {
 					bMore = FALSE;
 					if (pMediaQInfo->itemCount > 0) {
-						if (pMediaQInfo->tail > -1) {
-							media_q_item_t *pTail = &pMediaQInfo->pItems[pMediaQInfo->tail];
+						int tailIdx = x_openavbMediaQTailIdx(pMediaQInfo);
+						if (tailIdx > -1) {
+							media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
 	
 							if (pTail) {
 								pMediaQInfo->tailLocked = TRUE;
@@ -198,7 +1084,7 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 
 #ifdef ENABLE_FIRST_FUTURE
 								if (bFirst) {
-									S32 delta = openavbAvtpTimeUsecDelta(pTail->pAvtpTime);
+									S32 delta = x_openavbMediaQPresentUsecDelta(pMediaQInfo->pPresentNS[tailIdx], nowNS);
 									S32 maxStale = (S32)(0 - pMediaQInfo->maxStaleTailUsec);
 
 									if (delta < maxStale) {
@@ -210,15 +1096,19 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 								}
 								else {
 									// Once we have triggered a stale tail purge everything past presentation time.
-									if (openavbAvtpTimeIsPast(pTail->pAvtpTime)) {
+									if (x_openavbMediaQPresentIsPast(pMediaQInfo, pMediaQInfo->pPresentNS[tailIdx], nowNS)) {
 										bPurge = TRUE;
 									}
 								}
 
 								if (bPurge) {
-									openavbMediaQTailPull(pMediaQ);
+									if (x_openavbMediaQTailPull(pMediaQInfo)) {
+										pMediaQInfo->purgedItems++;
+										purged++;
+									}
 									pTail = NULL;
 									bMore = TRUE;
+									budget--;
 								}
 								else {
 									pMediaQInfo->tailLocked = FALSE;
@@ -226,7 +1116,7 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 								}
 #else // ENABLE_FIRST_FUTURE
 								if (bFirst) {
-									S32 delta = openavbAvtpTimeUsecDelta(pTail->pAvtpTime);
+									S32 delta = x_openavbMediaQPresentUsecDelta(pMediaQInfo->pPresentNS[tailIdx], nowNS);
 									S32 maxStale = (S32)(0 - pMediaQInfo->maxStaleTailUsec);
 									if(delta >= 0) {
 										pMediaQInfo->firstFuture = TRUE;
@@ -240,7 +1130,7 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 								}
 								else {
 									// Once we have triggered a stale tail purge everything past presentation time.
-									if (openavbAvtpTimeIsPast(pTail->pAvtpTime)) {
+									if (x_openavbMediaQPresentIsPast(pMediaQInfo, pMediaQInfo->pPresentNS[tailIdx], nowNS)) {
 #if 0 // debug
 										if (!(++cnt % 1)) {
 											openavbPrintbufPrintf(printBuf, "Purge More\n");
@@ -254,9 +1144,13 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 								}
 
 								if (bPurge || (pMediaQInfo->firstFuture == FALSE)) {
-									openavbMediaQTailPull(pMediaQ);
+									if (x_openavbMediaQTailPull(pMediaQInfo)) {
+										pMediaQInfo->purgedItems++;
+										purged++;
+									}
 									pTail = NULL;
 									bMore = TRUE;
+									budget--;
 								}
 								else {
 									pMediaQInfo->tailLocked = FALSE;
@@ -268,6 +1162,12 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 						}
 					}
 				}
+				if (purged && pMediaQInfo->pInstr) {
+					x_openavbMediaQInstrEvent(pMediaQInfo, MEDIAQ_EVENT_PURGE, purged);
+				}
+				if (bLock) {
+					MEDIAQ_UNLOCK();
+				}
 			}
 		}
 	}
@@ -276,18 +1176,43 @@ void x_openavbMediaQPurgeStaleTail(media_q_t *pMediaQ)
 }
 
 	
+size_t openavbMediaQStorageSize(void)
+{
+	return MEDIAQ_ALIGN(sizeof(media_q_t), OPENAVB_CACHE_LINE_SIZE) + sizeof(media_q_info_t);
+}
+
 media_q_t* openavbMediaQCreate()
+{
+	return openavbMediaQCreateIn(NULL);
+}
+
+media_q_t* openavbMediaQCreateIn(void *pStorage)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
 
-	media_q_t *pMediaQ = calloc(1, sizeof(media_q_t));
+	media_q_t *pMediaQ;
+
+	if (pStorage) {
+		// The private info starts on its own cache line after the public part
+		memset(pStorage, 0, openavbMediaQStorageSize());
+		pMediaQ = pStorage;
+		pMediaQ->pPvtMediaQInfo = (U8 *)pStorage + MEDIAQ_ALIGN(sizeof(media_q_t), OPENAVB_CACHE_LINE_SIZE);
+		((media_q_info_t *)pMediaQ->pPvtMediaQInfo)->embedded = TRUE;
+	}
+	else {
+		pMediaQ = calloc(1, sizeof(media_q_t));
+		if (pMediaQ) {
+			pMediaQ->pPvtMediaQInfo = calloc(1, sizeof(media_q_info_t));
+		}
+	}
 
 	if (pMediaQ) {
-		pMediaQ->pPvtMediaQInfo = calloc(1, sizeof(media_q_info_t));
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
 			pMediaQInfo->itemCount = 0;
 			pMediaQInfo->itemSize = 0;
+			pMediaQInfo->itemPubMapSize = 0;
+			pMediaQInfo->pubMapInfoSize = 0;
 			pMediaQInfo->head = 0;
 			pMediaQInfo->headLocked = FALSE;
 			pMediaQInfo->tail = -1;
@@ -296,6 +1221,52 @@ media_q_t* openavbMediaQCreate()
 			pMediaQInfo->maxLatencyUsec = 0;
 			pMediaQInfo->threadSafeOn = FALSE;
 			pMediaQInfo->maxStaleTailUsec = MICROSECONDS_PER_SECOND;
+			pMediaQInfo->lockFreeOn = FALSE;
+			pMediaQInfo->lockFreeHead = 0;
+			pMediaQInfo->lockFreeTail = 0;
+			pMediaQInfo->pLendBuf = NULL;
+			pMediaQInfo->lentIdx = -1;
+			pMediaQInfo->pLentOwnData = NULL;
+			pMediaQInfo->pAttach = NULL;
+			pMediaQInfo->arenaOn = FALSE;
+			pMediaQInfo->pArena = NULL;
+			pMediaQInfo->arenaSize = 0;
+			pMediaQInfo->arenaUsed = 0;
+			pMediaQInfo->arenaLocked = FALSE;
+			pMediaQInfo->ringOn = FALSE;
+			pMediaQInfo->ringSize = 0;
+			pMediaQInfo->pRing = NULL;
+			pMediaQInfo->ringWrite = 0;
+			pMediaQInfo->ringRead = 0;
+			pMediaQInfo->pRingStart = NULL;
+			pMediaQInfo->pRingEnd = NULL;
+			pMediaQInfo->pItemEnd = NULL;
+			pMediaQInfo->pPresentNS = NULL;
+			pMediaQInfo->itemLatencyNS = 0;
+			pMediaQInfo->pushedBytes = 0;
+			pMediaQInfo->pulledBytes = 0;
+			pMediaQInfo->pushedItems = 0;
+			pMediaQInfo->pulledItems = 0;
+			pMediaQInfo->readyItems = 0;
+			pMediaQInfo->readyEnd = 0;
+			pMediaQInfo->readySlot = -1;
+			pMediaQInfo->lockFreeReady = 0;
+			pMediaQInfo->purgedItems = 0;
+			pMediaQInfo->depthLimit = 0;
+			pMediaQInfo->depthLimitedItems = 0;
+			pMediaQInfo->orderedOn = FALSE;
+			pMediaQInfo->maxLateUsec = 0;
+			pMediaQInfo->dropDuplicates = FALSE;
+			pMediaQInfo->havePulledNS = FALSE;
+			pMediaQInfo->pulledNS = 0;
+			pMediaQInfo->reorderedItems = 0;
+			pMediaQInfo->lateItems = 0;
+			pMediaQInfo->duplicateItems = 0;
+			pMediaQInfo->pResidencyHist = NULL;
+			pMediaQInfo->pPushMarginHist = NULL;
+			pMediaQInfo->pPushNS = NULL;
+			pMediaQInfo->pInstr = NULL;
+			pMediaQInfo->bOverflow = FALSE;
 		}
 		else {
 			openavbMediaQDelete(pMediaQ);
@@ -321,7 +1292,153 @@ void openavbMediaQThreadSafeOn(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
 }
 
+void openavbMediaQLockFreeOn(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->head != 0 || pMediaQInfo->tail != -1) {
+				AVB_LOG_ERROR("Lock-free mode must be enabled before the MediaQ is used");
+			}
+			else {
+				pMediaQInfo->lockFreeOn = TRUE;
+				pMediaQInfo->lockFreeHead = 0;
+				pMediaQInfo->lockFreeTail = 0;
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
+
+
+
+void openavbMediaQArenaOn(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->pItems) {
+				AVB_LOG_ERROR("Arena mode must be enabled before the MediaQ size is set");
+			}
+			else {
+				pMediaQInfo->arenaOn = TRUE;
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
+
+void openavbMediaQArenaLock(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->pArena && !pMediaQInfo->arenaLocked) {
+				// mlock() faults every page in from this thread, so with the
+				// default first touch policy the arena lands on this thread's node.
+				if (mlock(pMediaQInfo->pArena, pMediaQInfo->arenaSize) == 0) {
+					pMediaQInfo->arenaLocked = TRUE;
+				}
+				else {
+					AVB_LOGF_WARNING("Unable to lock MediaQ arena: %s", strerror(errno));
+				}
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
+
+size_t openavbMediaQPrefault(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	size_t bytes = 0;
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			int n = pMediaQInfo->itemCount;
+			if (pMediaQInfo->pArena) {
+				// Items and bookkeeping are all carved out of the arena
+				bytes = openavbPrefault(pMediaQInfo->pArena, pMediaQInfo->arenaUsed, TRUE);
+			}
+			else if (pMediaQInfo->pItems) {
+				bytes += openavbPrefault(pMediaQInfo->pItems, n * sizeof(media_q_item_t), TRUE);
+				bytes += openavbPrefault(pMediaQInfo->pItemEnd, n * sizeof(U64), TRUE);
+				bytes += openavbPrefault(pMediaQInfo->pPushNS, n * sizeof(U64), TRUE);
+				bytes += openavbPrefault(pMediaQInfo->pPresentNS, n * sizeof(U64), TRUE);
+				bytes += openavbPrefault(pMediaQInfo->pAttach, n * sizeof(media_q_attach_t), TRUE);
+				if (pMediaQInfo->ringOn) {
+					bytes += openavbPrefault(pMediaQInfo->pRing, pMediaQInfo->ringSize, TRUE);
+					bytes += openavbPrefault(pMediaQInfo->pRingStart, n * sizeof(U64), TRUE);
+					bytes += openavbPrefault(pMediaQInfo->pRingEnd, n * sizeof(U64), TRUE);
+				}
+				else {
+					int i1;
+					for (i1 = 0; i1 < n; i1++) {
+						bytes += openavbPrefault(pMediaQInfo->pItems[i1].pPubData, pMediaQInfo->itemSize, TRUE);
+					}
+				}
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+	return bytes;
+}
+
+void openavbMediaQRingOn(media_q_t *pMediaQ, U32 ringSize)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->pItems) {
+				AVB_LOG_ERROR("Ring mode must be enabled before the MediaQ size is set");
+			}
+			else if (ringSize > 0) {
+				pMediaQInfo->ringOn = TRUE;
+				pMediaQInfo->ringSize = MEDIAQ_ALIGN(ringSize, OPENAVB_CACHE_LINE_SIZE);
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
+
+void openavbMediaQOrderedOn(media_q_t *pMediaQ, U32 maxLateUsec, bool dropDuplicates)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->lockFreeOn || pMediaQInfo->ringOn) {
+				AVB_LOG_ERROR("Presentation time order isn't supported in lock-free or ring mode");
+			}
+			else if (pMediaQInfo->head != 0 || pMediaQInfo->tail != -1) {
+				AVB_LOG_ERROR("Presentation time order must be enabled before the MediaQ is used");
+			}
+			else {
+				pMediaQInfo->orderedOn = TRUE;
+				pMediaQInfo->maxLateUsec = maxLateUsec;
+				pMediaQInfo->dropDuplicates = dropDuplicates;
+			}
+		}
+	}
 
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
 
 bool openavbMediaQSetSize(media_q_t *pMediaQ, int itemCount, int itemSize)
 {
@@ -339,17 +1456,44 @@ bool openavbMediaQSetSize(media_q_t *pMediaQ, int itemCount, int itemSize)
 			// Don't want to re-allocate new memory each time
 			if (!pMediaQInfo->pItems)
 			{
-				pMediaQInfo->pItems = calloc(itemCount, sizeof(media_q_item_t));
-				if (pMediaQInfo->pItems) {
+				if (pMediaQInfo->ringOn && pMediaQInfo->ringSize < MEDIAQ_ALIGN(itemSize, OPENAVB_CACHE_LINE_SIZE)) {
+					// At least one whole item must fit
+					AVB_LOGF_WARNING("MediaQ ring of %u bytes is smaller than an item, using %d", pMediaQInfo->ringSize, itemSize);
+					pMediaQInfo->ringSize = MEDIAQ_ALIGN(itemSize, OPENAVB_CACHE_LINE_SIZE);
+				}
+				if (pMediaQInfo->arenaOn) {
+					x_openavbMediaQArenaCreate(pMediaQInfo, itemCount, pMediaQInfo->ringOn ? 0 : itemSize);
+				}
+				if (pMediaQInfo->ringOn) {
+					pMediaQInfo->pRing = x_openavbMediaQAlloc(pMediaQInfo, pMediaQInfo->ringSize);
+					pMediaQInfo->pRingStart = x_openavbMediaQAlloc(pMediaQInfo, itemCount * sizeof(U64));
+					pMediaQInfo->pRingEnd = x_openavbMediaQAlloc(pMediaQInfo, itemCount * sizeof(U64));
+					if (!pMediaQInfo->pRing || !pMediaQInfo->pRingStart || !pMediaQInfo->pRingEnd) {
+						AVB_LOG_ERROR("Out of memory creating MediaQ ring");
+						AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+						return FALSE;
+					}
+				}
+				pMediaQInfo->pItems = x_openavbMediaQAlloc(pMediaQInfo, itemCount * sizeof(media_q_item_t));
+				pMediaQInfo->pItemEnd = x_openavbMediaQAlloc(pMediaQInfo, itemCount * sizeof(U64));
+				pMediaQInfo->pPushNS = x_openavbMediaQAlloc(pMediaQInfo, itemCount * sizeof(U64));
+				pMediaQInfo->pPresentNS = x_openavbMediaQAlloc(pMediaQInfo, itemCount * sizeof(U64));
+				pMediaQInfo->pAttach = x_openavbMediaQAlloc(pMediaQInfo, itemCount * sizeof(media_q_attach_t));
+				if (pMediaQInfo->pItems && pMediaQInfo->pItemEnd && pMediaQInfo->pPushNS && pMediaQInfo->pPresentNS && pMediaQInfo->pAttach) {
 					pMediaQInfo->itemCount = itemCount;
 					pMediaQInfo->itemSize = itemSize;
+					pMediaQInfo->itemLatencyNS = (U64)pMediaQInfo->maxLatencyUsec * NANOSECONDS_PER_USEC;
 
 					int i1;
 					for (i1 = 0; i1 < itemCount; i1++) {
 						pMediaQInfo->pItems[i1].pAvtpTime = openavbAvtpTimeCreate(pMediaQInfo->maxLatencyUsec);
-						pMediaQInfo->pItems[i1].pPubData = calloc(1, itemSize);
 						pMediaQInfo->pItems[i1].dataLen = 0;
 						pMediaQInfo->pItems[i1].itemSize = itemSize;
+						if (pMediaQInfo->ringOn) {
+							// Ring space is reserved when the item becomes the head
+							continue;
+						}
+						pMediaQInfo->pItems[i1].pPubData = x_openavbMediaQAlloc(pMediaQInfo, itemSize);
 						if (!pMediaQInfo->pItems[i1].pPubData) {
 							AVB_LOG_ERROR("Out of memory creating MediaQ item");
 							AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
@@ -380,6 +1524,26 @@ bool openavbMediaQSetSize(media_q_t *pMediaQ, int itemCount, int itemSize)
 	return TRUE;
 }
 
+bool openavbMediaQGetSize(media_q_t *pMediaQ, int *pItemCount, int *pItemSize)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ && pItemCount && pItemSize) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->pItems) {
+				*pItemCount = pMediaQInfo->itemCount;
+				*pItemSize = pMediaQInfo->itemSize;
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+				return TRUE;
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+	return FALSE;
+}
+
 bool openavbMediaQAllocItemMapData(media_q_t *pMediaQ, int itemPubMapSize, int itemPvtMapSize)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
@@ -392,7 +1556,7 @@ bool openavbMediaQAllocItemMapData(media_q_t *pMediaQ, int itemPubMapSize, int i
 				for (i1 = 0; i1 < pMediaQInfo->itemCount; i1++) {
 					if (itemPubMapSize) {
 						if (!pMediaQInfo->pItems[i1].pPubMapData) {
-							pMediaQInfo->pItems[i1].pPubMapData = calloc(1, itemPubMapSize);
+							pMediaQInfo->pItems[i1].pPubMapData = x_openavbMediaQAlloc(pMediaQInfo, itemPubMapSize);
 							if (!pMediaQInfo->pItems[i1].pPubMapData) {
 								AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
 								return FALSE;
@@ -406,7 +1570,7 @@ bool openavbMediaQAllocItemMapData(media_q_t *pMediaQ, int itemPubMapSize, int i
 					}
 					if (itemPvtMapSize) {
 						if (!pMediaQInfo->pItems[i1].pPvtMapData) {
-							pMediaQInfo->pItems[i1].pPvtMapData = calloc(1, itemPvtMapSize);
+							pMediaQInfo->pItems[i1].pPvtMapData = x_openavbMediaQAlloc(pMediaQInfo, itemPvtMapSize);
 							if (!pMediaQInfo->pItems[i1].pPvtMapData) {
 								AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
 								return FALSE;
@@ -419,6 +1583,9 @@ bool openavbMediaQAllocItemMapData(media_q_t *pMediaQ, int itemPubMapSize, int i
 						}
 					}
 				}
+				if (itemPubMapSize) {
+					pMediaQInfo->itemPubMapSize = itemPubMapSize;
+				}
 
 				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
 				return TRUE;
@@ -430,6 +1597,43 @@ bool openavbMediaQAllocItemMapData(media_q_t *pMediaQ, int itemPubMapSize, int i
 	return FALSE;
 }
 
+int openavbMediaQGetItemPubMapSize(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	int itemPubMapSize = 0;
+	if (pMediaQ && pMediaQ->pPvtMediaQInfo) {
+		itemPubMapSize = ((media_q_info_t *)(pMediaQ->pPvtMediaQInfo))->itemPubMapSize;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+	return itemPubMapSize;
+}
+
+void openavbMediaQSetPubMapInfoSize(media_q_t *pMediaQ, int pubMapInfoSize)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ && pMediaQ->pPvtMediaQInfo) {
+		((media_q_info_t *)(pMediaQ->pPvtMediaQInfo))->pubMapInfoSize = pubMapInfoSize;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
+
+int openavbMediaQGetPubMapInfoSize(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	int pubMapInfoSize = 0;
+	if (pMediaQ && pMediaQ->pPvtMediaQInfo) {
+		pubMapInfoSize = ((media_q_info_t *)(pMediaQ->pPvtMediaQInfo))->pubMapInfoSize;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+	return pubMapInfoSize;
+}
+
 
 bool openavbMediaQAllocItemIntfData(media_q_t *pMediaQ, int itemIntfSize)
 {
@@ -442,7 +1646,7 @@ bool openavbMediaQAllocItemIntfData(media_q_t *pMediaQ, int itemIntfSize)
 				int i1;
 				for (i1 = 0; i1 < pMediaQInfo->itemCount; i1++) {
 					if (!pMediaQInfo->pItems[i1].pPvtIntfData) {
-						pMediaQInfo->pItems[i1].pPvtIntfData = calloc(1, itemIntfSize);
+						pMediaQInfo->pItems[i1].pPvtIntfData = x_openavbMediaQAlloc(pMediaQInfo, itemIntfSize);
 						if (!pMediaQInfo->pItems[i1].pPvtIntfData) {
 							AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
 							return FALSE;
@@ -469,6 +1673,7 @@ bool openavbMediaQDelete(media_q_t *pMediaQ)
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
 
 	if (pMediaQ) {
+		bool embedded = pMediaQ->pPvtMediaQInfo && ((media_q_info_t *)pMediaQ->pPvtMediaQInfo)->embedded;
 
 #if DUMP_HEAD_PUSH
 		if (pFileHeadPush) {
@@ -489,35 +1694,75 @@ bool openavbMediaQDelete(media_q_t *pMediaQ)
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
 			if (pMediaQInfo->pItems) {
 				int i1;
+				if (pMediaQInfo->lentIdx > -1) {
+					x_openavbMediaQUnlend(pMediaQInfo, FALSE);
+				}
 				for (i1 = 0; i1 < pMediaQInfo->itemCount; i1++) {
-					
+					if (!pMediaQInfo->pItems[i1].taken) {
+						x_openavbMediaQDetach(pMediaQInfo, i1);
+					}
+
 					if (pMediaQInfo->pItems[i1].taken) {
 						AVB_LOG_ERROR("Deleting MediaQ with an item TAKEN. The item will be orphaned.");
 					}
 					else {
 						openavbAvtpTimeDelete(pMediaQInfo->pItems[i1].pAvtpTime);
-						if (pMediaQInfo->pItems[i1].pPubData) {
-							free(pMediaQInfo->pItems[i1].pPubData);
+						if (pMediaQInfo->pItems[i1].pPubData && !pMediaQInfo->ringOn) {
+							x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pItems[i1].pPubData);
 							pMediaQInfo->pItems[i1].pPubData = NULL;
 						}
 						if (pMediaQInfo->pItems[i1].pPubMapData) {
-							free(pMediaQInfo->pItems[i1].pPubMapData);
+							x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pItems[i1].pPubMapData);
 							pMediaQInfo->pItems[i1].pPubMapData = NULL;
 						}
 						if (pMediaQInfo->pItems[i1].pPvtMapData) {
-							free(pMediaQInfo->pItems[i1].pPvtMapData);
+							x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pItems[i1].pPvtMapData);
 							pMediaQInfo->pItems[i1].pPvtMapData = NULL;
 						}
 						if (pMediaQInfo->pItems[i1].pPvtIntfData) {
-							free(pMediaQInfo->pItems[i1].pPvtIntfData);
+							x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pItems[i1].pPvtIntfData);
 							pMediaQInfo->pItems[i1].pPvtIntfData = NULL;
 						}
 					}
 				}
-				free(pMediaQInfo->pItems);
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pItems);
 				pMediaQInfo->pItems = NULL;
 			}
-			free(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->pItemEnd) {
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pItemEnd);
+				pMediaQInfo->pItemEnd = NULL;
+			}
+			if (pMediaQInfo->pPushNS) {
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pPushNS);
+				pMediaQInfo->pPushNS = NULL;
+			}
+			if (pMediaQInfo->pPresentNS) {
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pPresentNS);
+				pMediaQInfo->pPresentNS = NULL;
+			}
+			if (pMediaQInfo->pAttach) {
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pAttach);
+				pMediaQInfo->pAttach = NULL;
+			}
+			if (pMediaQInfo->pRing) {
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pRing);
+				pMediaQInfo->pRing = NULL;
+			}
+			if (pMediaQInfo->pRingStart) {
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pRingStart);
+				pMediaQInfo->pRingStart = NULL;
+			}
+			if (pMediaQInfo->pRingEnd) {
+				x_openavbMediaQFree(pMediaQInfo, pMediaQInfo->pRingEnd);
+				pMediaQInfo->pRingEnd = NULL;
+			}
+			if (pMediaQInfo->pArena) {
+				munmap(pMediaQInfo->pArena, pMediaQInfo->arenaSize);
+				pMediaQInfo->pArena = NULL;
+			}
+			if (!embedded) {
+				free(pMediaQ->pPvtMediaQInfo);
+			}
 			pMediaQ->pPvtMediaQInfo = NULL;
 
 			if (pMediaQ->pPubMapInfo) {
@@ -525,75 +1770,225 @@ bool openavbMediaQDelete(media_q_t *pMediaQ)
 				pMediaQ->pPubMapInfo = NULL;
 			}
 
-			if (pMediaQ->pPvtMapInfo) {
-				free(pMediaQ->pPvtMapInfo);
-				pMediaQ->pPvtMapInfo = NULL;
-			}
+			if (pMediaQ->pPvtMapInfo) {
+				free(pMediaQ->pPvtMapInfo);
+				pMediaQ->pPvtMapInfo = NULL;
+			}
+
+			if (pMediaQ->pPvtIntfInfo) {
+				free(pMediaQ->pPvtIntfInfo);
+				pMediaQ->pPvtIntfInfo = NULL;
+			}
+		}
+
+		if (pMediaQ->pMediaQDataFormat) {
+			free(pMediaQ->pMediaQDataFormat);
+			pMediaQ->pMediaQDataFormat = NULL;
+		}
+
+		if (!embedded) {
+			free(pMediaQ);
+		}
+		pMediaQ = NULL;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+	return FALSE;
+}
+
+void openavbMediaQSetMaxLatency(media_q_t *pMediaQ, U32 maxLatencyUsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			pMediaQInfo->maxLatencyUsec = maxLatencyUsec;
+		}
+	}
+		
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
+
+void openavbMediaQSetMaxStaleTail(media_q_t *pMediaQ, U32 maxStaleTailUsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			pMediaQInfo->maxStaleTailUsec = maxStaleTailUsec;
+		}
+	}
+		
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
+
+void openavbMediaQSetDepthLimit(media_q_t *pMediaQ, U32 itemLimit)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
 
-			if (pMediaQ->pPvtIntfInfo) {
-				free(pMediaQ->pPvtIntfInfo);
-				pMediaQ->pPvtIntfInfo = NULL;
-			}
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			OPENAVB_ATOMIC_STORE_RELAXED(&pMediaQInfo->depthLimit, itemLimit);
 		}
+	}
 
-		if (pMediaQ->pMediaQDataFormat) {
-			free(pMediaQ->pMediaQDataFormat);
-			pMediaQ->pMediaQDataFormat = NULL;
-		}
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
+}
 
-		free(pMediaQ);
-		pMediaQ = NULL;
+U64 openavbMediaQDepthLimitedItems(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+			return OPENAVB_ATOMIC_LOAD_RELAXED(&pMediaQInfo->depthLimitedItems);
+		}
 	}
 
-	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
-	return FALSE;
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+	return 0;
 }
 
-void openavbMediaQSetMaxLatency(media_q_t *pMediaQ, U32 maxLatencyUsec)
+void openavbMediaQSetHistograms(media_q_t *pMediaQ, openavb_hist_t *pResidencyHist, openavb_hist_t *pPushMarginHist)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
 
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
-			pMediaQInfo->maxLatencyUsec = maxLatencyUsec;
+			pMediaQInfo->pResidencyHist = pResidencyHist;
+			pMediaQInfo->pPushMarginHist = pPushMarginHist;
 		}
 	}
-		
+
 	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
 }
 
-void openavbMediaQSetMaxStaleTail(media_q_t *pMediaQ, U32 maxStaleTailUsec)
+void openavbMediaQSetInstrument(media_q_t *pMediaQ, media_q_instr_t *pInstr)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ);
 
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
-			pMediaQInfo->maxStaleTailUsec = maxStaleTailUsec;
+			if (pInstr) {
+				// No mark period has started yet
+				pInstr->highGen = pInstr->lowGen = pInstr->markGen - 1;
+			}
+			pMediaQInfo->pInstr = pInstr;
+			pMediaQInfo->bOverflow = FALSE;
 		}
 	}
-		
+
 	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ);
 }
 
-media_q_item_t *openavbMediaQHeadLock(media_q_t *pMediaQ)
+void openavbMediaQInstrSnapshot(media_q_instr_t *pInstr, media_q_instr_t *pSnap, bool bRestartMarks)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
+
+	if (!pInstr || !pSnap) {
+		AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+		return;
+	}
+
+	openavbHistSnapshot(&pInstr->pushDepth, &pSnap->pushDepth);
+	openavbHistSnapshot(&pInstr->pullDepth, &pSnap->pullDepth);
+
+	U32 gen = OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->markGen);
+	pSnap->markGen = gen;
+	pSnap->highGen = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pInstr->highGen);
+	pSnap->highWater = pSnap->highGen == gen ? OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->highWater) : 0;
+	pSnap->lowGen = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pInstr->lowGen);
+	pSnap->lowWater = pSnap->lowGen == gen ? OPENAVB_ATOMIC_LOAD_RELAXED(&pInstr->lowWater) : 0;
+	if (bRestartMarks) {
+		OPENAVB_ATOMIC_STORE_RELAXED(&pInstr->markGen, gen + 1);
+	}
+
+	// Events older than the ring are gone; a slot being rewritten reads as zero
+	U64 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pInstr->eventHead);
+	U64 n = head > MEDIAQ_INSTR_EVENTS ? head - MEDIAQ_INSTR_EVENTS : 0;
+	pSnap->eventHead = head;
+	memset(pSnap->event, 0, sizeof(pSnap->event));
+	for (; n < head; n++) {
+		media_q_event_t *pEvent = &pInstr->event[n % MEDIAQ_INSTR_EVENTS];
+		media_q_event_t *pCopy = &pSnap->event[n % MEDIAQ_INSTR_EVENTS];
+		U64 seq = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pEvent->seq);
+		if (seq != n + 1)
+			continue;
+		pCopy->timeNS = OPENAVB_ATOMIC_LOAD_RELAXED(&pEvent->timeNS);
+		pCopy->type = OPENAVB_ATOMIC_LOAD_RELAXED(&pEvent->type);
+		pCopy->items = OPENAVB_ATOMIC_LOAD_RELAXED(&pEvent->items);
+		OPENAVB_ATOMIC_FENCE();
+		if (OPENAVB_ATOMIC_LOAD_RELAXED(&pEvent->seq) == seq) {
+			pCopy->seq = seq;
+		}
+		else {
+			memset(pCopy, 0, sizeof(*pCopy));
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+}
+
+// Shared by openavbMediaQHeadLock() and openavbMediaQHeadLockAttach(); bData
+// is FALSE when the caller only attaches data, so no ring room is needed.
+static media_q_item_t *x_openavbMediaQHeadLock(media_q_t *pMediaQ, bool bData)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
 
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->lockFreeOn) {
+				if (pMediaQInfo->itemCount > 0) {
+					U32 tail = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pMediaQInfo->lockFreeTail);
+					U32 fill = x_openavbMediaQLockFreeFill(pMediaQInfo, pMediaQInfo->lockFreeHead, tail);
+					int headIdx = x_openavbMediaQLockFreeSlot(pMediaQInfo, pMediaQInfo->lockFreeHead);
+					bool bLimited = FALSE;
+					if (fill < pMediaQInfo->itemCount
+						&& !(bLimited = x_openavbMediaQDepthLimited(pMediaQInfo, headIdx))
+						&& (!pMediaQInfo->ringOn || x_openavbMediaQRingReserve(pMediaQInfo, headIdx, bData))) {
+						x_openavbMediaQLendHead(pMediaQInfo, headIdx, fill == 0);
+						pMediaQInfo->headLocked = TRUE;
+						if (pMediaQInfo->pInstr) {
+							x_openavbMediaQInstrHead(pMediaQInfo, FALSE, FALSE);
+						}
+						AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+						return &pMediaQInfo->pItems[headIdx];
+					}
+					if (pMediaQInfo->pInstr) {
+						x_openavbMediaQInstrHead(pMediaQInfo, TRUE, bLimited);
+					}
+				}
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+				return NULL;
+			}
 			if (pMediaQInfo->threadSafeOn) {
 				MEDIAQ_LOCK();
 			}
 			if (pMediaQInfo->itemCount > 0) {
-				if (pMediaQInfo->head > -1) {
+				bool bLimited = FALSE;
+				if (pMediaQInfo->head > -1
+					&& !(bLimited = x_openavbMediaQDepthLimited(pMediaQInfo, pMediaQInfo->head))
+					&& (!pMediaQInfo->ringOn || x_openavbMediaQRingReserve(pMediaQInfo, pMediaQInfo->head, bData))) {
+					x_openavbMediaQLendHead(pMediaQInfo, pMediaQInfo->head, pMediaQInfo->tail == -1);
 					pMediaQInfo->headLocked = TRUE;
+					if (pMediaQInfo->pInstr) {
+						x_openavbMediaQInstrHead(pMediaQInfo, FALSE, FALSE);
+					}
 					AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
 					// Mutex (LOCK()) if acquired stays locked
 					return &pMediaQInfo->pItems[pMediaQInfo->head];
 				}
+				if (pMediaQInfo->pInstr) {
+					x_openavbMediaQInstrHead(pMediaQInfo, TRUE, bLimited);
+				}
 			}
 			if (pMediaQInfo->threadSafeOn) {
 				MEDIAQ_UNLOCK();
@@ -605,6 +2000,16 @@ media_q_item_t *openavbMediaQHeadLock(media_q_t *pMediaQ)
 	return NULL;
 }
 
+media_q_item_t *openavbMediaQHeadLock(media_q_t *pMediaQ)
+{
+	return x_openavbMediaQHeadLock(pMediaQ, TRUE);
+}
+
+media_q_item_t *openavbMediaQHeadLockAttach(media_q_t *pMediaQ)
+{
+	return x_openavbMediaQHeadLock(pMediaQ, FALSE);
+}
+
 void openavbMediaQHeadUnlock(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
@@ -612,7 +2017,16 @@ void openavbMediaQHeadUnlock(media_q_t *pMediaQ)
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
-			if (pMediaQInfo->itemCount > 0) {
+			// Nothing was written to a lent buffer so the loan can end right away
+			int headIdx = x_openavbMediaQHeadIdx(pMediaQInfo);
+			if (headIdx > -1 && headIdx == pMediaQInfo->lentIdx
+				&& pMediaQInfo->pItems[headIdx].dataLen == 0) {
+				x_openavbMediaQUnlend(pMediaQInfo, FALSE);
+			}
+			if (pMediaQInfo->lockFreeOn) {
+				pMediaQInfo->headLocked = FALSE;
+			}
+			else if (pMediaQInfo->itemCount > 0) {
 				if (pMediaQInfo->head > -1) {
 					pMediaQInfo->headLocked = FALSE;
 					if (pMediaQInfo->threadSafeOn) {
@@ -632,6 +2046,26 @@ bool openavbMediaQHeadPush(media_q_t *pMediaQ)
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->lockFreeOn) {
+				if (pMediaQInfo->headLocked) {
+					int headIdx = x_openavbMediaQLockFreeSlot(pMediaQInfo, pMediaQInfo->lockFreeHead);
+					pMediaQInfo->pItems[headIdx].readIdx = 0;
+					if (pMediaQInfo->ringOn) {
+						x_openavbMediaQRingCommit(pMediaQInfo, headIdx);
+					}
+					x_openavbMediaQCountPush(pMediaQInfo, headIdx);
+					pMediaQInfo->headLocked = FALSE;
+
+					// Release ordering publishes the item contents to the consumer
+					OPENAVB_ATOMIC_STORE_RELEASE(&pMediaQInfo->lockFreeHead,
+						x_openavbMediaQLockFreeNext(pMediaQInfo, pMediaQInfo->lockFreeHead));
+
+					AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+					return TRUE;
+				}
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+				return FALSE;
+			}
 			if (pMediaQInfo->itemCount > 0) {
 				if (pMediaQInfo->head > -1) {
 					media_q_item_t *pHead = &pMediaQInfo->pItems[pMediaQInfo->head];
@@ -650,12 +2084,39 @@ bool openavbMediaQHeadPush(media_q_t *pMediaQ)
 					}
 #endif
 
+					int ahead = 0;
+					if (pMediaQInfo->orderedOn) {
+						ahead = x_openavbMediaQOrderFind(pMediaQInfo);
+						if (ahead < 0) {
+							// Dropped; the head item is reused as it was before it was filled
+							pHead->readIdx = 0;
+							pHead->dataLen = 0;
+							if (pMediaQInfo->head == pMediaQInfo->lentIdx) {
+								x_openavbMediaQUnlend(pMediaQInfo, FALSE);
+							}
+							x_openavbMediaQDetach(pMediaQInfo, pMediaQInfo->head);
+							pMediaQInfo->headLocked = FALSE;
+							if (pMediaQInfo->threadSafeOn) {
+								MEDIAQ_UNLOCK();
+							}
+							AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+							return FALSE;
+						}
+					}
+
 					// If tail not set, set it now
 					if (pMediaQInfo->tail == -1) {
 						pMediaQInfo->tail = pMediaQInfo->head;
 					}
 					
 					pHead->readIdx = 0;		// Reset read index
+					if (pMediaQInfo->ringOn) {
+						x_openavbMediaQRingCommit(pMediaQInfo, pMediaQInfo->head);
+					}
+					x_openavbMediaQCountPush(pMediaQInfo, pMediaQInfo->head);
+					if (ahead > 0) {
+						x_openavbMediaQOrderMove(pMediaQInfo, ahead);
+					}
 
 					x_openavbMediaQIncrementHead(pMediaQInfo);
 
@@ -679,6 +2140,8 @@ media_q_item_t* openavbMediaQTailLock(media_q_t *pMediaQ, bool ignoreTimestamp)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
 
+	// Runs ahead of both the lock-free and the locked path. In lock-free mode the
+	// purge only touches consumer side state, so it needs no lock either.
 	if (!ignoreTimestamp) {
 		x_openavbMediaQPurgeStaleTail(pMediaQ);
 	}
@@ -686,6 +2149,19 @@ media_q_item_t* openavbMediaQTailLock(media_q_t *pMediaQ, bool ignoreTimestamp)
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->lockFreeOn) {
+				int tailIdx = pMediaQInfo->itemCount > 0 ? x_openavbMediaQTailIdx(pMediaQInfo) : -1;
+				if (tailIdx > -1) {
+					media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
+					if (ignoreTimestamp || openavbAvtpTimeIsPast(pTail->pAvtpTime)) {
+						pMediaQInfo->tailLocked = TRUE;
+						AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+						return pTail;
+					}
+				}
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+				return NULL;
+			}
 			if (pMediaQInfo->threadSafeOn) {
 				MEDIAQ_LOCK();
 			}
@@ -726,7 +2202,10 @@ void openavbMediaQTailUnlock(media_q_t *pMediaQ)
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
-			if (pMediaQInfo->itemCount > 0) {
+			if (pMediaQInfo->lockFreeOn) {
+				pMediaQInfo->tailLocked = FALSE;
+			}
+			else if (pMediaQInfo->itemCount > 0) {
 				if (pMediaQInfo->tail > -1) {
 					pMediaQInfo->tailLocked = FALSE;
 					if (pMediaQInfo->threadSafeOn) {
@@ -746,42 +2225,82 @@ bool openavbMediaQTailPull(media_q_t *pMediaQ)
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
-			if (pMediaQInfo->itemCount > 0) {
-				if (pMediaQInfo->tail > -1) {
-					media_q_item_t *pTail = &pMediaQInfo->pItems[pMediaQInfo->tail];
+			if (x_openavbMediaQTailPull(pMediaQInfo)) {
+				if (pMediaQInfo->threadSafeOn && !pMediaQInfo->lockFreeOn) {
+					MEDIAQ_UNLOCK();
+				}
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+				return TRUE;
+			}
+		}
+	}
 
-#if DUMP_TAIL_PULL
-					media_q_item_t *pMediaQItem = &pMediaQInfo->pItems[pMediaQInfo->tail];
-					if (!pFileTailPull) {
-						char filename[128];
-						sprintf(filename, "tailpull_%5.5d.dat", GET_PID());
-						pFileTailPull = fopen(filename, "wb");
-					}
-					if (pFileTailPull) {
-						size_t result = fwrite(pMediaQItem->pPubData, 1, pMediaQItem->dataLen, pFileTailPull);
-						if (result != pMediaQItem->dataLen)
-							printf("ERROR writing tail pull log");
-					}
-#endif
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+	return FALSE;
+}
 
-					// If head not set, set it now
-					if (pMediaQInfo->head == -1) {
-						pMediaQInfo->head = pMediaQInfo->tail;
-					}
+void openavbMediaQHeadLend(media_q_t *pMediaQ, void *pBuf, U32 size)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->threadSafeOn && !pMediaQInfo->lockFreeOn) {
+				MEDIAQ_LOCK();
+			}
 
-					pTail->readIdx = 0;		// Reset read index
-					pTail->dataLen = 0;		// Clears out the data
+			if (pBuf && (size != pMediaQInfo->itemSize || pMediaQInfo->ringOn)) {
+				// Only whole items can be filled in place, and ring items have no
+				// buffer of their own to fall back on
+				pBuf = NULL;
+			}
 
-					x_openavbMediaQIncrementTail(pMediaQInfo);
+			if (pBuf && pMediaQInfo->lentIdx > -1
+				&& pMediaQInfo->pItems[pMediaQInfo->lentIdx].pPubData != pBuf
+				&& pMediaQInfo->lentIdx == x_openavbMediaQHeadIdx(pMediaQInfo)) {
+				// The partly filled head item is on an old buffer; move it home
+				x_openavbMediaQUnlend(pMediaQInfo, TRUE);
+			}
+			pMediaQInfo->pLendBuf = pBuf;
 
-					pMediaQInfo->tailLocked = FALSE;
-					if (pMediaQInfo->threadSafeOn) {
-						MEDIAQ_UNLOCK();
-					}
-					
-					AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
-					return TRUE;
-				}
+			if (pMediaQInfo->threadSafeOn && !pMediaQInfo->lockFreeOn) {
+				MEDIAQ_UNLOCK();
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+}
+
+bool openavbMediaQHeadAttach(media_q_t *pMediaQ, void *pData, U32 dataLen, openavb_media_q_release_cb_t releaseCb, void *pReleaseArg)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
+
+	if (pMediaQ && pData && releaseCb) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			int headIdx = x_openavbMediaQHeadIdx(pMediaQInfo);
+
+			// The head item must be locked by the caller, empty and on its own buffer
+			if (pMediaQInfo->headLocked && headIdx > -1 && pMediaQInfo->pAttach
+				&& headIdx != pMediaQInfo->lentIdx
+				&& !pMediaQInfo->pAttach[headIdx].releaseCb
+				&& pMediaQInfo->pItems[headIdx].dataLen == 0) {
+				media_q_attach_t *pAttach = &pMediaQInfo->pAttach[headIdx];
+				media_q_item_t *pItem = &pMediaQInfo->pItems[headIdx];
+
+				pAttach->releaseCb = releaseCb;
+				pAttach->pReleaseArg = pReleaseArg;
+				pAttach->pOwnData = pItem->pPubData;
+				pAttach->ownItemSize = pItem->itemSize;
+				pAttach->pOwnMapData = pItem->pPubMapData;
+				pItem->pPubData = pData;
+				pItem->itemSize = dataLen;
+				pItem->dataLen = dataLen;
+
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+				return TRUE;
 			}
 		}
 	}
@@ -790,6 +2309,28 @@ bool openavbMediaQTailPull(media_q_t *pMediaQ)
 	return FALSE;
 }
 
+bool openavbMediaQHeadShare(media_q_t *pMediaQ, media_q_item_t *pSrcItem, openavb_media_q_release_cb_t releaseCb, void *pReleaseArg)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
+
+	if (pMediaQ && pSrcItem && pSrcItem->pPubData) {
+		if (openavbMediaQHeadAttach(pMediaQ, pSrcItem->pPubData, pSrcItem->dataLen, releaseCb, pReleaseArg)) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			media_q_item_t *pItem = &pMediaQInfo->pItems[x_openavbMediaQHeadIdx(pMediaQInfo)];
+
+			// The map data is only borrowed; detaching puts the item's own back
+			pItem->pPubMapData = pSrcItem->pPubMapData;
+			*pItem->pAvtpTime = *pSrcItem->pAvtpTime;
+
+			AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+			return TRUE;
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+	return FALSE;
+}
+
 bool openavbMediaQTailItemTake(media_q_t *pMediaQ, media_q_item_t* pItem)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
@@ -797,12 +2338,27 @@ bool openavbMediaQTailItemTake(media_q_t *pMediaQ, media_q_item_t* pItem)
 	if (pMediaQ && pItem) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pMediaQInfo->lockFreeOn) {
+				// Taken items would leave holes the producer can't see without a lock.
+				AVB_LOG_ERROR("Taking MediaQ items is not supported in lock-free mode");
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+				return FALSE;
+			}
+			if (pMediaQInfo->ringOn) {
+				// The ring is handed back strictly in order
+				AVB_LOG_ERROR("Taking MediaQ items is not supported in ring mode");
+				AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+				return FALSE;
+			}
 			if (pMediaQInfo->itemCount > 0) {
 				if (pMediaQInfo->tail > -1) {
+					x_openavbMediaQCountPull(pMediaQInfo, pMediaQInfo->tail);
 
+					// Marked first so the tail can't settle back on it
+					pItem->taken = TRUE;
+					pMediaQInfo->pPresentNS[pMediaQInfo->tail] = MEDIAQ_NS_TAKEN;
 					x_openavbMediaQIncrementTail(pMediaQInfo);
 
-					pItem->taken = TRUE;
 					pMediaQInfo->tailLocked = FALSE;
 					if (pMediaQInfo->threadSafeOn) {
 						MEDIAQ_UNLOCK();
@@ -834,18 +2390,12 @@ bool openavbMediaQTailItemGive(media_q_t *pMediaQ, media_q_item_t* pItem)
 				if (pMediaQInfo->threadSafeOn) {
 					MEDIAQ_LOCK();
 				}
+				if (pMediaQInfo->lentIdx > -1 && pItem == &pMediaQInfo->pItems[pMediaQInfo->lentIdx]) {
+					x_openavbMediaQUnlend(pMediaQInfo, FALSE);
+				}
 				if (pMediaQInfo->itemCount > 0) {
-					if (pMediaQInfo->head == -1) {
-						// Transition from full mediaq to an available item slot. Find this item that was just give back
-						int i1;
-						for (i1 = 0; i1 < pMediaQInfo->itemCount; i1++)
-						{
-							if (!pMediaQInfo->pItems[i1].taken) {
-								pMediaQInfo->head = i1;
-								break;
-							}
-						}
-					}
+					x_openavbMediaQDetach(pMediaQInfo, pItem - pMediaQInfo->pItems);
+					x_openavbMediaQCountGive(pMediaQInfo, pItem - pMediaQInfo->pItems);
 				}
 				if (pMediaQInfo->threadSafeOn) {
 					MEDIAQ_UNLOCK();
@@ -869,8 +2419,9 @@ bool openavbMediaQUsecTillTail(media_q_t *pMediaQ, U32 *pUsecTill)
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
 			if (pMediaQInfo->itemCount > 0) {
-				if (pMediaQInfo->tail > -1) {
-					media_q_item_t *pTail = &pMediaQInfo->pItems[pMediaQInfo->tail];
+				int tailIdx = x_openavbMediaQTailIdx(pMediaQInfo);
+				if (tailIdx > -1) {
+					media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
 
 					U32 usecTill;
 					
@@ -895,63 +2446,24 @@ bool openavbMediaQIsAvailableBytes(media_q_t *pMediaQ, U32 bytes, bool ignoreTim
 		x_openavbMediaQPurgeStaleTail(pMediaQ);
 	}
 
-	int byteCnt = 0;
-
 	if (pMediaQ) {
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
 			if (pMediaQInfo->itemCount > 0) {
-				if (pMediaQInfo->tail > -1) {
-					// Check if tail item is ready.
-					int tailIdx = pMediaQInfo->tail;
-					int endIdx = pMediaQInfo->head > -1 ? pMediaQInfo->head : pMediaQInfo->tail;
-					if (ignoreTimestamp) {
-						while (1) {
-							media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
-							
-							if (!pTail->taken) {
-								byteCnt += pTail->dataLen - pTail->readIdx;
-	
-								if (byteCnt >= bytes) {
-									// Met the available byte count
-									AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
-									return TRUE;
-								}
-							}
-
-							tailIdx++;
-							if (tailIdx >= pMediaQInfo->itemCount)
-								tailIdx = 0;
-							if (tailIdx == endIdx)
-								break;
-						}
-					}
-					else {
-						U64 nSecTime;
-						CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nSecTime);
-						while (1) {
-							media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
-							assert(pTail);
-
-							if (!pTail->taken) {
-								if (!openavbAvtpTimeIsPastTime(pTail->pAvtpTime, nSecTime))
-									break;
-
-								byteCnt += pTail->dataLen - pTail->readIdx;
-	
-								if (byteCnt >= bytes) {
-									// Met the available byte count
-									AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
-									return TRUE;
-								}
-							}
-
-							tailIdx++;
-							if (tailIdx >= pMediaQInfo->itemCount)
-								tailIdx = 0;
-							if (tailIdx == endIdx)
-								break;
-						}
+				U64 end;
+				U32 itemCnt = ignoreTimestamp ?
+					x_openavbMediaQQueuedItems(pMediaQInfo, &end) :
+					x_openavbMediaQReadyItems(pMediaQInfo, &end);
+				int tailIdx = x_openavbMediaQTailIdx(pMediaQInfo);
+				if (itemCnt > 0 && tailIdx > -1) {
+					// The tail item may be partly read (or emptied) since it was pushed
+					media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
+					S64 byteCnt = (S64)(end - pMediaQInfo->pItemEnd[tailIdx])
+						+ (S64)pTail->dataLen - (S64)pTail->readIdx;
+					if (byteCnt >= bytes) {
+						// Met the available byte count
+						AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+						return TRUE;
 					}
 				}
 			}
@@ -976,49 +2488,9 @@ U32 openavbMediaQCountItems(media_q_t *pMediaQ, bool ignoreTimestamp)
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
 			if (pMediaQInfo->itemCount > 0) {
-				if (pMediaQInfo->tail > -1) {
-					// Check if tail item is ready.
-					int tailIdx = pMediaQInfo->tail;
-					if (ignoreTimestamp) {
-						while (1) {
-							media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
-
-							if (!pTail->taken) {
-								itemCnt++;
-							}
-
-							tailIdx++;
-							if (tailIdx >= pMediaQInfo->itemCount)
-								tailIdx = 0;
-							if (tailIdx == pMediaQInfo->head)
-								break;
-							if (itemCnt >= pMediaQInfo->itemCount)								
-								break;
-						}
-					}
-					else {
-						U64 nSecTime;
-						CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nSecTime);
-						while (1) {
-							media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
-
-							if (!pTail->taken) {
-								if (!openavbAvtpTimeIsPastTime(pTail->pAvtpTime, nSecTime))
-									break;
-
-								itemCnt++;
-							}
-
-							tailIdx++;
-							if (tailIdx >= pMediaQInfo->itemCount)
-								tailIdx = 0;
-							if (tailIdx == pMediaQInfo->head)
-								break;
-							if (itemCnt >= pMediaQInfo->itemCount)								
-								break;
-						}
-					}
-				}
+				itemCnt = ignoreTimestamp ?
+					x_openavbMediaQQueuedItems(pMediaQInfo, NULL) :
+					x_openavbMediaQReadyItems(pMediaQInfo, NULL);
 			}
 		}
 	}
@@ -1039,9 +2511,9 @@ bool openavbMediaQAnyReadyItems(media_q_t *pMediaQ, bool ignoreTimestamp)
 		if (pMediaQ->pPvtMediaQInfo) {
 			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
 			if (pMediaQInfo->itemCount > 0) {
-				if (pMediaQInfo->tail > -1) {
+				int tailIdx = x_openavbMediaQTailIdx(pMediaQInfo);
+				if (tailIdx > -1) {
 					// Check if tail item is ready.
-					int tailIdx = pMediaQInfo->tail;
 					if (ignoreTimestamp) {
 						media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
 
@@ -1053,11 +2525,10 @@ bool openavbMediaQAnyReadyItems(media_q_t *pMediaQ, bool ignoreTimestamp)
 					else {
 						U64 nSecTime;
 						CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nSecTime);
-						media_q_item_t *pTail = &pMediaQInfo->pItems[tailIdx];
-						assert(pTail);
-					
-						if (!pTail->taken) {
-							if (openavbAvtpTimeIsPastTime(pTail->pAvtpTime, nSecTime)) {
+						U64 presentNS = pMediaQInfo->pPresentNS[tailIdx];
+
+						if (presentNS != MEDIAQ_NS_TAKEN) {
+							if (x_openavbMediaQPresentIsPast(pMediaQInfo, presentNS, nSecTime)) {
 								AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
 								return TRUE;
 							}
@@ -1072,3 +2543,40 @@ bool openavbMediaQAnyReadyItems(media_q_t *pMediaQ, bool ignoreTimestamp)
 	return FALSE;
 }
 
+U64 openavbMediaQPurgedItems(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+			return pMediaQInfo->purgedItems;
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+	return 0;
+}
+
+void openavbMediaQOrderedStats(media_q_t *pMediaQ, U64 *pReordered, U64 *pLate, U64 *pDuplicates)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_MEDIAQ_DETAIL);
+
+	if (pMediaQ) {
+		if (pMediaQ->pPvtMediaQInfo) {
+			media_q_info_t *pMediaQInfo = (media_q_info_t *)(pMediaQ->pPvtMediaQInfo);
+			if (pReordered) {
+				*pReordered = pMediaQInfo->reorderedItems;
+			}
+			if (pLate) {
+				*pLate = pMediaQInfo->lateItems;
+			}
+			if (pDuplicates) {
+				*pDuplicates = pMediaQInfo->duplicateItems;
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_MEDIAQ_DETAIL);
+}
@@ -42,12 +42,21 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 //  However the declarations are included here for easy internal use. 
 media_q_t* openavbMediaQCreate();
 void openavbMediaQThreadSafeOn(media_q_t *pMediaQ);
+void openavbMediaQLockFreeOn(media_q_t *pMediaQ);
+void openavbMediaQArenaOn(media_q_t *pMediaQ);
+void openavbMediaQArenaLock(media_q_t *pMediaQ);
+void openavbMediaQOrderedOn(media_q_t *pMediaQ, U32 maxLateUsec, bool dropDuplicates);
 bool openavbMediaQSetSize(media_q_t *pMediaQ, int itemCount, int itemSize);
 bool openavbMediaQAllocItemMapData(media_q_t *pMediaQ, int itemPubMapSize, int itemPvtMapSize);
 bool openavbMediaQAllocItemIntfData(media_q_t *pMediaQ, int itemIntfSize);
 bool openavbMediaQDelete(media_q_t *pMediaQ);
 void openavbMediaQSetMaxLatency(media_q_t *pMediaQ, U32 maxLatencyUsec);
 void openavbMediaQSetMaxStaleTail(media_q_t *pMediaQ, U32 maxStaleTailUsec);
+void openavbMediaQSetDepthLimit(media_q_t *pMediaQ, U32 itemLimit);
+U64 openavbMediaQDepthLimitedItems(media_q_t *pMediaQ);
+void openavbMediaQSetHistograms(media_q_t *pMediaQ, openavb_hist_t *pResidencyHist, openavb_hist_t *pPushMarginHist);
+void openavbMediaQSetInstrument(media_q_t *pMediaQ, media_q_instr_t *pInstr);
+void openavbMediaQInstrSnapshot(media_q_instr_t *pInstr, media_q_instr_t *pSnap, bool bRestartMarks);
 media_q_item_t *openavbMediaQHeadLock(media_q_t *pMediaQ);
 void openavbMediaQHeadUnlock(media_q_t *pMediaQ);
 bool openavbMediaQHeadPush(media_q_t *pMediaQ);
@@ -56,5 +65,7 @@ void openavbMediaQTailUnlock(media_q_t *pMediaQ);
 bool openavbMediaQTailPull(media_q_t *pMediaQ);
 bool openavbMediaQUsecTillTail(media_q_t *pMediaQ, U32 *pUsecTill);
 bool openavbMediaQIsAvailableBytes(media_q_t *pMediaQ, U32 bytes, bool ignoreTimestamp);
+U64 openavbMediaQPurgedItems(media_q_t *pMediaQ);
+void openavbMediaQOrderedStats(media_q_t *pMediaQ, U64 *pReordered, U64 *pLate, U64 *pDuplicates);
 
 #endif  // OPENAVB_MEDIA_Q_H
@@ -38,6 +38,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include "openavb_types_pub.h"
 #include "openavb_avtp_time_pub.h"
+#include "openavb_histogram_pub.h"
 
 /** \file
  * Media Queue.
@@ -122,6 +123,23 @@ typedef struct {
  */
 media_q_t* openavbMediaQCreate();
 
+/** Size of the storage openavbMediaQCreateIn() needs.
+ */
+size_t openavbMediaQStorageSize(void);
+
+/** Create a media queue in caller storage.
+ *
+ * Like openavbMediaQCreate() but the queue structures are built in pStorage,
+ * which must be openavbMediaQStorageSize() bytes and cache line aligned, so
+ * a caller can keep the queue next to the state that uses it. The storage
+ * stays the caller's: openavbMediaQDelete() releases what the queue allocated
+ * but not pStorage. A NULL pStorage allocates as openavbMediaQCreate() does.
+ *
+ * \param pStorage Storage for the queue or NULL
+ * \return A pointer to a media queue structure. NULL if the creation fails
+ */
+media_q_t* openavbMediaQCreateIn(void *pStorage);
+
 /** Enable thread safe access for this media queue.
  *
  * In the default case a media queue is only accessed from a single thread and
@@ -134,6 +152,93 @@ media_q_t* openavbMediaQCreate();
  */
 void openavbMediaQThreadSafeOn(media_q_t *pMediaQ);
 
+/** Enable lock-free single producer / single consumer access for this media queue.
+ *
+ * When exactly one thread uses the head functions and exactly one other thread
+ * uses the tail functions, calling this function replaces the mutex used by
+ * openavbMediaQThreadSafeOn() with atomic head and tail indexes kept on separate
+ * cache lines. Neither side ever blocks the other. This must be called before
+ * the media queue is used and once enabled it can not be disabled.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ *
+ * \note openavbMediaQTailItemTake() is not supported in this mode.
+ */
+void openavbMediaQLockFreeOn(media_q_t *pMediaQ);
+
+/** Allocate the media queue items from a single arena.
+ *
+ * Item headers, item data and the per-item map and interface data are laid
+ * out back to back in one huge page backed mapping instead of separate heap
+ * allocations. This must be called before openavbMediaQSetSize().
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ */
+void openavbMediaQArenaOn(media_q_t *pMediaQ);
+
+/** Lock the media queue arena into memory.
+ *
+ * Faults in and mlock()s the arena from the calling thread so the memory is
+ * local to the thread that will use it. Does nothing if the arena isn't in use
+ * or is already locked.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ */
+void openavbMediaQArenaLock(media_q_t *pMediaQ);
+
+/** Fault in the media queue memory.
+ *
+ * Touches the items, their data and the per item bookkeeping so the first
+ * intervals of a stream don't take page faults. Safe while another thread
+ * uses the queue. Call after openavbMediaQSetSize().
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \return The number of bytes touched
+ */
+size_t openavbMediaQPrefault(media_q_t *pMediaQ);
+
+/** Carve the item data out of one byte ring.
+ *
+ * Instead of every item owning a buffer of itemSize bytes, each item takes
+ * only the bytes it was pushed with from a shared ring of ringSize bytes, so
+ * queues of widely varying items (such as video frames) need memory for the
+ * data actually queued rather than itemCount * itemSize. The item at the head
+ * is always given itemSize contiguous bytes; openavbMediaQHeadLock() returns
+ * NULL while the ring doesn't have that much free. Items that only have data
+ * attached take no ring bytes; lock them with openavbMediaQHeadLockAttach(). This must be called before
+ * openavbMediaQSetSize(), whose itemSize then sets the largest single item.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \param ringSize Size of the ring in bytes, 0 leaves ring mode off
+ *
+ * \note openavbMediaQTailItemTake() and openavbMediaQHeadLend() are not
+ * supported in this mode.
+ */
+void openavbMediaQRingOn(media_q_t *pMediaQ, U32 ringSize);
+
+/** Keep the queue in presentation time order.
+ *
+ * By default items are queued in the order they are pushed. In this mode an
+ * item pushed with a valid timestamp earlier than items already queued is moved
+ * ahead of them, so reordered packets, for example from redundant paths or
+ * bridges with several queues, still leave the tail in presentation order and
+ * the due check in openavbMediaQTailLock() stays a single look at the tail.
+ * openavbMediaQHeadPush() returns FALSE and drops the item when it is late:
+ * its presentation time is before that of an item already pulled, it could
+ * only be placed ahead of a locked or partly read tail, or it is more than
+ * maxLateUsec in the past. With dropDuplicates an item with the same
+ * presentation time as one already queued or just pulled is dropped as well.
+ * This must be called before the media queue is used.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \param maxLateUsec Drop items this far past their presentation time, 0 for no limit
+ * \param dropDuplicates Drop items repeating a presentation time
+ *
+ * \note Not supported together with openavbMediaQLockFreeOn() or
+ * openavbMediaQRingOn().
+ */
+void openavbMediaQOrderedOn(media_q_t *pMediaQ, U32 maxLateUsec, bool dropDuplicates);
+
 /** Set size of  media queue.
  *
  * Pre-allocate all the items for the media queue. Once allocated the item
@@ -151,6 +256,15 @@ void openavbMediaQThreadSafeOn(media_q_t *pMediaQ);
  */
 bool openavbMediaQSetSize(media_q_t *pMediaQ, int itemCount, int itemSize);
 
+/** Get size of media queue.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \param pItemCount Set to the number of items given to openavbMediaQSetSize()
+ * \param pItemSize Set to the item size given to openavbMediaQSetSize()
+ * \return TRUE on success or FALSE if the size hasn't been set yet
+ */
+bool openavbMediaQGetSize(media_q_t *pMediaQ, int *pItemCount, int *pItemSize);
+
 /** Alloc item map data.
  *
  * Items in the media queue may also have per-item data that is managed by the
@@ -172,6 +286,33 @@ bool openavbMediaQSetSize(media_q_t *pMediaQ, int itemCount, int itemSize);
  */
 bool openavbMediaQAllocItemMapData(media_q_t *pMediaQ, int itemPubMapSize, int itemPvtMapSize);
 
+/** Get size of item public map data.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \return The itemPubMapSize given to openavbMediaQAllocItemMapData(), or 0
+ *         if the items have no public map data
+ */
+int openavbMediaQGetItemPubMapSize(media_q_t *pMediaQ);
+
+/** Record the size of the mapping module's public data.
+ *
+ * Mapping modules whose pPubMapInfo is partly filled in by the interface
+ * module call this from their initialize function, so that a talker fed by a
+ * shared source can take the audio or video format from the first stream.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \param pubMapInfoSize Size in bytes of the structure pPubMapInfo points to
+ */
+void openavbMediaQSetPubMapInfoSize(media_q_t *pMediaQ, int pubMapInfoSize);
+
+/** Get size of the mapping module's public data.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \return The size given to openavbMediaQSetPubMapInfoSize(), or 0 if the
+ *         mapping module didn't record it
+ */
+int openavbMediaQGetPubMapInfoSize(media_q_t *pMediaQ);
+
 /** Alloc item interface data.
  *
  * Items in the media queue may also have per-item data that is managed by the
@@ -220,6 +361,102 @@ void openavbMediaQSetMaxLatency(media_q_t *pMediaQ, U32 maxLatencyUsec);
  */
 void openavbMediaQSetMaxStaleTail(media_q_t *pMediaQ, U32 maxStaleTailUsec);
 
+/** Limits how many items may be queued at once.
+ *
+ * Below the allocated item count the queue then reports itself full once
+ * itemLimit items are queued. A head item that already holds data is still
+ * handed out so it can be finished. May be changed from any thread while the
+ * queue is in use.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \param itemLimit Most items queued at once, 0 for no limit
+ */
+void openavbMediaQSetDepthLimit(media_q_t *pMediaQ, U32 itemLimit);
+
+/** Sets the latency histograms recorded by the media queue.
+ *
+ * Either histogram may be NULL. The histograms stay owned by the caller and
+ * must outlive the media queue.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \param pResidencyHist Receives the time in nanoseconds from head push to
+ * tail pull of each item. Recorded by the thread pulling the tail.
+ * \param pPushMarginHist Receives the presentation time minus push time in
+ * nanoseconds of each item with a valid timestamp, 0 when already late.
+ * Recorded by the thread pushing the head.
+ */
+void openavbMediaQSetHistograms(media_q_t *pMediaQ, openavb_hist_t *pResidencyHist, openavb_hist_t *pPushMarginHist);
+
+/// Number of events kept by the media queue instrumentation
+#define MEDIAQ_INSTR_EVENTS		32
+
+/// Kinds of media queue events
+typedef enum {
+	/// The head could not be locked because the queue was full
+	MEDIAQ_EVENT_OVERFLOW = 1,
+	/// The head could not be locked because of the depth limit
+	MEDIAQ_EVENT_LIMITED,
+	/// Stale items were purged from the tail
+	MEDIAQ_EVENT_PURGE,
+} media_q_event_type_t;
+
+/// A timestamped media queue event
+typedef struct {
+	/// Event number plus one, written last; 0 while the slot is being written
+	U64 seq;
+	/// Wall time of the event in nanoseconds
+	U64 timeNS;
+	/// media_q_event_type_t
+	U32 type;
+	/// Items queued for an overflow, items dropped for a purge
+	U32 items;
+} media_q_event_t;
+
+/// Occupancy instrumentation of a media queue, see openavbMediaQSetInstrument()
+typedef struct {
+	/// Items queued right after each head push. Recorded by the producer.
+	openavb_hist_t pushDepth;
+	/// Items queued right before each tail pull. Recorded by the consumer.
+	openavb_hist_t pullDepth;
+	/// Most items queued after a push in mark period highGen
+	U32 highWater;
+	U32 highGen;
+	/// Fewest items left after a pull in mark period lowGen
+	U32 lowWater;
+	U32 lowGen;
+	/// Current mark period; a mark from an older period is stale
+	U32 markGen;
+	/// Number of events recorded. Event n is kept in slot n % MEDIAQ_INSTR_EVENTS.
+	/// An overflow is recorded once when the head is first refused, not on every
+	/// retry.
+	U64 eventHead;
+	media_q_event_t event[MEDIAQ_INSTR_EVENTS];
+} media_q_instr_t;
+
+/** Sets the occupancy instrumentation recorded by the media queue.
+ *
+ * The queue depth is sampled into the histograms on every head push and tail
+ * pull, high and low water marks are kept per mark period, and overflows and
+ * stale tail purges are logged with a timestamp. Nothing is recorded while
+ * pInstr is NULL. The structure stays owned by the caller, must be zeroed
+ * before it is first set and must outlive the media queue.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure
+ * \param pInstr The instrumentation to record into, or NULL
+ */
+void openavbMediaQSetInstrument(media_q_t *pMediaQ, media_q_instr_t *pInstr);
+
+/** Copy media queue instrumentation that may be recorded into concurrently.
+ *
+ * Marks that belong to an older period than markGen are returned as 0 and
+ * events that were being overwritten as a zero slot.
+ *
+ * \param pInstr The instrumentation set with openavbMediaQSetInstrument()
+ * \param pSnap Receives the copy
+ * \param bRestartMarks Start a new mark period once the marks are copied
+ */
+void openavbMediaQInstrSnapshot(media_q_instr_t *pInstr, media_q_instr_t *pSnap, bool bRestartMarks);
+
 /** Get pointer to the head item and lock it.
  *
  * Get the storage location for the next item that can be added to the circle
@@ -234,6 +471,20 @@ void openavbMediaQSetMaxStaleTail(media_q_t *pMediaQ, U32 maxStaleTailUsec);
  */
 media_q_item_t *openavbMediaQHeadLock(media_q_t *pMediaQ);
 
+/** Lock the head item to attach data to it.
+ *
+ * Like openavbMediaQHeadLock() for an interface module that fills the item
+ * with openavbMediaQHeadAttach() or openavbMediaQHeadShare() only. In byte
+ * ring mode no ring room is reserved for the item, so this succeeds while the
+ * ring is full and the item has no storage of its own (pPubData may be NULL).
+ * Otherwise it is the same as openavbMediaQHeadLock().
+ *
+ * \param pMediaQ A pointer to the media_q_t structure.
+ * \return A pointer to a media queue item. Returns NULL if no head item is
+ *         free.
+ */
+media_q_item_t *openavbMediaQHeadLockAttach(media_q_t *pMediaQ);
+
 /** Unlock the head item.
  *
  * Unlock a locked media queue item from the head of the queue. The item will
@@ -259,6 +510,65 @@ void openavbMediaQHeadUnlock(media_q_t *pMediaQ);
  */
 bool openavbMediaQHeadPush(media_q_t *pMediaQ);
 
+/** Lend a buffer to the next head item.
+ *
+ * While a buffer is offered, openavbMediaQHeadLock() on an empty queue returns
+ * an empty head item whose pPubData points at pBuf, so the interface module
+ * writes straight into it. The item keeps the buffer until it is pulled from
+ * the tail. Talkers use this to let the interface fill the AVTP payload of the
+ * transmit frame in place. Offer NULL to stop lending.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure.
+ * \param pBuf The buffer to lend or NULL.
+ * \param size Size of pBuf. Must equal the item size, otherwise nothing is lent.
+ *
+ * \note The buffer must stay valid until the item using it has been pulled.
+ */
+void openavbMediaQHeadLend(media_q_t *pMediaQ, void *pBuf, U32 size);
+
+/** Release callback for data attached with openavbMediaQHeadAttach().
+ *
+ * \param pReleaseArg The argument given to openavbMediaQHeadAttach().
+ */
+typedef void (*openavb_media_q_release_cb_t)(void *pReleaseArg);
+
+/** Attach external data to the locked head item.
+ *
+ * Instead of copying into the item storage, an interface module can let the
+ * locked head item point at data it holds, such as a mapped GStreamer buffer.
+ * pPubData, dataLen and itemSize of the item are set to the attached data, so
+ * the mapping module reads it like any other item. When the item is pulled
+ * from the tail (or given back after openavbMediaQTailItemTake()), the item
+ * gets its own storage back and the release callback is called, possibly from
+ * the thread that pulled it. If the call fails nothing is attached and the
+ * caller still owns the data.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure.
+ * \param pData The data, which must stay valid until it is released.
+ * \param dataLen Length of pData.
+ * \param releaseCb Called once the item is done with pData.
+ * \param pReleaseArg Argument for releaseCb.
+ * \return TRUE if attached. FALSE if the head isn't locked, already holds
+ *         data or is filling a buffer lent by openavbMediaQHeadLend().
+ */
+bool openavbMediaQHeadAttach(media_q_t *pMediaQ, void *pData, U32 dataLen, openavb_media_q_release_cb_t releaseCb, void *pReleaseArg);
+
+/** Share an item of another media queue with the locked head item.
+ *
+ * Like openavbMediaQHeadAttach() with the data of pSrcItem, except that the
+ * head item also takes the timestamp of pSrcItem and borrows its public map
+ * data, so an interface module reads it exactly as it would read pSrcItem.
+ * pSrcItem is normally one taken with openavbMediaQTailItemTake() and must not
+ * be given back before the release callback is called.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure.
+ * \param pSrcItem The item to share.
+ * \param releaseCb Called once the head item is done with pSrcItem.
+ * \param pReleaseArg Argument for releaseCb.
+ * \return TRUE if shared, FALSE as for openavbMediaQHeadAttach().
+ */
+bool openavbMediaQHeadShare(media_q_t *pMediaQ, media_q_item_t *pSrcItem, openavb_media_q_release_cb_t releaseCb, void *pReleaseArg);
+
 /** Get pointer to the tail item and lock it.
  *
  * Lock the next available tail item in the media queue. Available is based on
@@ -362,4 +672,33 @@ U32 openavbMediaQCountItems(media_q_t *pMediaQ, bool ignoreTimestamp);
  */
 bool openavbMediaQAnyReadyItems(media_q_t *pMediaQ, bool ignoreTimestamp);
 
+/** Get the number of stale MediaQ items purged.
+ *
+ * Returns the total number of items dropped from the tail of the queue
+ * because they were older than the max stale tail setting.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure.
+ * \return Number of purged items.
+ */
+U64 openavbMediaQPurgedItems(media_q_t *pMediaQ);
+
+/** Returns the number of times a head lock was refused because the depth
+ * limit set with openavbMediaQSetDepthLimit() was reached.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure.
+ * \return Number of refused head locks.
+ */
+U64 openavbMediaQDepthLimitedItems(media_q_t *pMediaQ);
+
+/** Get the presentation time order counters.
+ *
+ * Only counted when openavbMediaQOrderedOn() is in use. Any pointer may be NULL.
+ *
+ * \param pMediaQ A pointer to the media_q_t structure.
+ * \param pReordered Set to the number of items pushed ahead of items already queued.
+ * \param pLate Set to the number of items dropped as too late.
+ * \param pDuplicates Set to the number of items dropped as duplicates.
+ */
+void openavbMediaQOrderedStats(media_q_t *pMediaQ, U64 *pReordered, U64 *pLate, U64 *pDuplicates);
+
 #endif  // OPENAVB_MEDIA_Q_PUB_H
@@ -33,6 +33,7 @@
 ******************************************************************************/
 
 #include "mrp_client.h"
+#include "mrpd_tlv.h"
 
 #define AVB_LOG_COMPONENT "MRP"
 #include "openavb_log.h"
@@ -60,27 +61,159 @@ pthread_t monitor_thread;
 pthread_attr_t monitor_attr;
 unsigned char monitor_stream_id[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
 
+/* commands held back by mrp_batch_begin(), sent as one mrpd_tlv.h frame */
+static unsigned char batch_frame[MAX_MRPD_CMDSZ];
+static int batch_len = 0;
+static int batch_depth = 0;
+static unsigned int batch_seq = 0;
+static unsigned int batch_start_seq = 0;
+
+/*
+ * Batches waiting for mrpd to report them done. A batch may have been split
+ * over several frames, first_seq to last_seq, whose counts are summed up
+ * until the MRPD_TLV_DONE of the last one arrives.
+ */
+#define MRP_PENDING_MAX 16
+
+struct mrp_pending {
+	int used;
+	unsigned int first_seq;
+	unsigned int last_seq;
+	int processed;
+	int failed;
+	mrp_done_cb cb;
+	void *arg;
+};
+
+static struct mrp_pending pending[MRP_PENDING_MAX];
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * private
  */
 
-int send_mrp_msg(char *notify_data, int notify_len)
+static int send_mrp_frame(char *data, int len)
 {
 	struct sockaddr_in addr;
-	socklen_t addr_len;
 
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(MRPD_PORT_DEFAULT);
+	inet_aton("127.0.0.1", &addr.sin_addr);
+
+	return sendto(control_socket, data, len, 0,
+		      (struct sockaddr *)&addr, sizeof(addr));
+}
+
+static void batch_put16(unsigned char *p, unsigned int v)
+{
+	p[0] = (unsigned char)(v >> 8);
+	p[1] = (unsigned char)v;
+}
+
+static unsigned int batch_get16(const unsigned char *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static unsigned int batch_get32(const unsigned char *p)
+{
+	return (batch_get16(p) << 16) | batch_get16(p + 2);
+}
+
+static int batch_send(void)
+{
+	int rc;
+
+	if (batch_len <= MRPD_TLV_HDR_SZ)
+		return 0;
+
+	rc = send_mrp_frame((char *)batch_frame, batch_len);
+	batch_len = 0;
+
+	return rc < 0 ? -1 : 0;
+}
+
+/*
+ * Queue one text command in the pending frame, sending the frame first
+ * when the command does not fit any more.
+ */
+static int batch_add(const char *cmd, int len)
+{
+	if (MRPD_TLV_HDR_SZ + MRPD_TLV_ITEM_HDR_SZ + len > MAX_MRPD_CMDSZ)
+		return -1;
+
+	if (batch_len + MRPD_TLV_ITEM_HDR_SZ + len > MAX_MRPD_CMDSZ) {
+		if (batch_send() < 0)
+			return -1;
+	}
+
+	if (batch_len == 0) {
+		batch_frame[0] = MRPD_TLV_MAGIC;
+		batch_frame[1] = MRPD_TLV_VERSION;
+		batch_put16(&batch_frame[2], 0);
+		batch_put16(&batch_frame[4], batch_seq >> 16);
+		batch_put16(&batch_frame[6], batch_seq & 0xFFFF);
+		batch_seq++;
+		batch_len = MRPD_TLV_HDR_SZ;
+	}
+
+	batch_put16(&batch_frame[batch_len], MRPD_TLV_CMD);
+	batch_put16(&batch_frame[batch_len + 2], len);
+	memcpy(&batch_frame[batch_len + MRPD_TLV_ITEM_HDR_SZ], cmd, len);
+	batch_len += MRPD_TLV_ITEM_HDR_SZ + len;
+	batch_put16(&batch_frame[2],
+		    ((batch_frame[2] << 8) | batch_frame[3]) + 1);
+
+	return 0;
+}
+
+int send_mrp_msg(char *notify_data, int notify_len)
+{
 	if (control_socket == -1)
 		return -1;
 	if (notify_data == NULL)
 		return -1;
 
-	memset(&addr, 0, sizeof(addr));
-	addr.sin_family = AF_INET;
-	addr.sin_port = htons(MRPD_PORT_DEFAULT);
-	inet_aton("127.0.0.1", &addr.sin_addr);
-	addr_len = sizeof(addr);
-	return sendto(control_socket, notify_data, notify_len, 0,
-			 (struct sockaddr *)&addr, addr_len);
+	if (batch_depth) {
+		/* callers pass the whole, NUL padded, message buffer */
+		if (batch_add(notify_data, strnlen(notify_data, notify_len)) < 0)
+			return -1;
+		return notify_len;
+	}
+
+	return send_mrp_frame(notify_data, notify_len);
+}
+
+/* Account one frame of a pending batch and complete the batch on its last */
+static void pending_done(unsigned int seq, int processed, int failed)
+{
+	mrp_done_cb cb = NULL;
+	void *arg = NULL;
+	int i;
+
+	pthread_mutex_lock(&pending_lock);
+	for (i = 0; i < MRP_PENDING_MAX; i++) {
+		struct mrp_pending *p = &pending[i];
+
+		if (!p->used ||
+		    (seq - p->first_seq) > (p->last_seq - p->first_seq))
+			continue;
+		p->processed += processed;
+		p->failed += failed;
+		if (seq == p->last_seq) {
+			cb = p->cb;
+			arg = p->arg;
+			processed = p->processed;
+			failed = p->failed;
+			p->used = 0;
+		}
+		break;
+	}
+	pthread_mutex_unlock(&pending_lock);
+
+	if (cb)
+		cb(processed, failed, arg);
 }
 
 int process_mrp_msg(char *buf, int buflen)
@@ -354,6 +487,71 @@ int process_mrp_msg(char *buf, int buflen)
 	return 0;
 }
 
+/*
+ * mrpd may coalesce several notifications into one datagram or frame item,
+ * one per line. Hand them to process_mrp_msg() one line at a time.
+ */
+static void process_mrp_lines(char *buf, int len)
+{
+	char *line = buf;
+	char *end = buf + len;
+	char *nl;
+
+	while (line < end && *line != '\0') {
+		nl = memchr(line, '\n', end - line);
+		if (nl)
+			*nl = '\0';
+		if (*line != '\0')
+			process_mrp_msg(line, strnlen(line, end - line));
+		if (!nl)
+			break;
+		line = nl + 1;
+	}
+}
+
+/*
+ * Hand each response and notification of a binary frame to
+ * process_mrp_lines() as if it had arrived as its own text datagram.
+ */
+static void process_mrp_frame(unsigned char *frame, int len)
+{
+	char msgbuf[MAX_MRPD_CMDSZ];
+	int offset = MRPD_TLV_HDR_SZ;
+	int type;
+	int vlen;
+
+	while (offset + MRPD_TLV_ITEM_HDR_SZ <= len) {
+		type = (frame[offset] << 8) | frame[offset + 1];
+		vlen = (frame[offset + 2] << 8) | frame[offset + 3];
+		offset += MRPD_TLV_ITEM_HDR_SZ;
+		if (offset + vlen > len)
+			break;
+
+		if (type == MRPD_TLV_DONE && vlen == 8) {
+			pending_done(batch_get32(&frame[offset]),
+				     batch_get16(&frame[offset + 4]),
+				     batch_get16(&frame[offset + 6]));
+			offset += vlen;
+			continue;
+		} else if (type == MRPD_TLV_RESPONSE && vlen >= 2) {
+			/* skip the index of the command being answered */
+			offset += 2;
+			vlen -= 2;
+		} else if (type != MRPD_TLV_NOTIFY) {
+			offset += vlen;
+			continue;
+		}
+
+		if (vlen >= (int)sizeof(msgbuf))
+			vlen = sizeof(msgbuf) - 1;
+		memcpy(msgbuf, &frame[offset], vlen);
+		msgbuf[vlen] = '\0';
+		offset += vlen;
+		AVB_LOGF_VERBOSE("Msg: %s", msgbuf);
+		process_mrp_lines(msgbuf, vlen);
+	}
+}
+
 void *mrp_monitor_thread(void *arg)
 {
 	char *msgbuf;
@@ -395,8 +593,13 @@ void *mrp_monitor_thread(void *arg)
 		bytes = recvmsg(control_socket, &msg, 0);
 		if (bytes < 0)
 			continue;
+		if (bytes >= MRPD_TLV_HDR_SZ &&
+		    (unsigned char)msgbuf[0] == MRPD_TLV_MAGIC) {
+			process_mrp_frame((unsigned char *)msgbuf, bytes);
+			continue;
+		}
 		AVB_LOGF_VERBOSE("Msg: %s", msgbuf);
-		process_mrp_msg(msgbuf, bytes);
+		process_mrp_lines(msgbuf, bytes);
 	}
 	free(msgbuf);
 	pthread_exit(NULL);
@@ -446,6 +649,144 @@ int mrp_disconnect(void)
 		return 0;
 }
 
+/*
+ * Hold back the commands sent until the matching mrp_batch_flush() and
+ * send them to mrpd together, as one binary frame. Calls nest.
+ */
+void mrp_batch_begin(void)
+{
+	if (batch_depth++ == 0)
+		batch_start_seq = batch_seq;
+}
+
+int mrp_batch_flush(void)
+{
+	if (batch_depth == 0)
+		return -1;
+	if (--batch_depth)
+		return 0;
+
+	return batch_send();
+}
+
+/*
+ * As mrp_batch_flush(), calling cb once mrpd is done with every command of
+ * the batch. Only the outermost flush sends, so only it takes a callback.
+ * A batch with nothing in it completes at once.
+ */
+int mrp_batch_flush_async(mrp_done_cb cb, void *arg)
+{
+	int i;
+
+	if (batch_depth == 0)
+		return -1;
+	if (batch_depth > 1) {
+		mrp_batch_flush();
+		return cb ? -1 : 0;
+	}
+
+	if (batch_len == 0 && batch_seq == batch_start_seq) {
+		batch_depth = 0;
+		if (cb)
+			cb(0, 0, arg);
+		return 0;
+	}
+
+	if (cb) {
+		/* registered before sending, mrpd can answer straight away */
+		pthread_mutex_lock(&pending_lock);
+		for (i = 0; i < MRP_PENDING_MAX; i++) {
+			if (!pending[i].used)
+				break;
+		}
+		if (i < MRP_PENDING_MAX) {
+			pending[i].used = 1;
+			pending[i].first_seq = batch_start_seq;
+			pending[i].last_seq = batch_seq - 1;
+			pending[i].processed = 0;
+			pending[i].failed = 0;
+			pending[i].cb = cb;
+			pending[i].arg = arg;
+		}
+		pthread_mutex_unlock(&pending_lock);
+		if (i == MRP_PENDING_MAX) {
+			/* too many in flight; send anyway, without completion */
+			batch_depth = 0;
+			batch_send();
+			return -1;
+		}
+	}
+
+	batch_depth = 0;
+	if (batch_send() < 0) {
+		if (cb) {
+			pthread_mutex_lock(&pending_lock);
+			pending[i].used = 0;
+			pthread_mutex_unlock(&pending_lock);
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Queue all of decls in one batch and send it, see mrp_batch_flush_async().
+ */
+int mrp_submit(const struct mrp_decl *decls, int count, mrp_done_cb cb, void *arg)
+{
+	const struct mrp_decl *d;
+	int class_id, priority;
+	u_int16_t vlan;
+	int rc = 0;
+	int i;
+
+	mrp_batch_begin();
+	for (i = 0; i < count && rc == 0; i++) {
+		d = &decls[i];
+		switch (d->type) {
+		case MRP_DECL_DOMAIN:
+			class_id = d->class_id;
+			priority = d->priority;
+			vlan = d->vlan;
+			rc = mrp_register_domain(&class_id, &priority, &vlan);
+			break;
+		case MRP_DECL_VLAN:
+			rc = mrp_join_vlan();
+			break;
+		case MRP_DECL_TALKER:
+			rc = mrp_advertise_stream((uint8_t *)d->streamid,
+						  (uint8_t *)d->destaddr,
+						  d->vlan, d->pktsz, d->interval,
+						  d->priority, d->latency);
+			break;
+		case MRP_DECL_TALKER_LEAVE:
+			rc = mrp_unadvertise_stream((uint8_t *)d->streamid,
+						    (uint8_t *)d->destaddr,
+						    d->vlan, d->pktsz, d->interval,
+						    d->priority, d->latency);
+			break;
+		case MRP_DECL_LISTENER:
+			rc = mrp_send_ready((uint8_t *)d->streamid);
+			break;
+		case MRP_DECL_LISTENER_LEAVE:
+			rc = mrp_send_leave((uint8_t *)d->streamid);
+			break;
+		default:
+			rc = -1;
+			break;
+		}
+	}
+
+	if (rc) {
+		/* send what was queued, the caller hears of it failing here */
+		mrp_batch_flush();
+		return -1;
+	}
+
+	return mrp_batch_flush_async(cb, arg);
+}
+
 int mrp_monitor(void)
 {
 	int rc;
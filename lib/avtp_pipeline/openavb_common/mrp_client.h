@@ -77,6 +77,8 @@ extern void mrp_register_cb(unsigned char streamid[8], int declType, unsigned ch
 int mrp_connect(void);
 int mrp_disconnect(void);
 int mrp_monitor(void);
+void mrp_batch_begin(void);
+int mrp_batch_flush(void);
 int mrp_register_domain(int *class_id, int *priority, u_int16_t *vid);
 int mrp_join_vlan(void);
 int mrp_advertise_stream(uint8_t * streamid, uint8_t * destaddr, u_int16_t vlan, int pktsz, int interval, int priority, int latency);
@@ -89,4 +91,39 @@ int mrp_get_domain(int *class_a_id, int *a_priority, u_int16_t * a_vid,
 int mrp_send_ready(uint8_t *stream_id);
 int mrp_send_leave(uint8_t *stream_id);
 
+/*
+ * asynchronous, pipelined use
+ *
+ * Declarations are queued and sent to mrpd in as few frames as fit, without
+ * waiting for any reply. Once mrpd has gone through all of them the
+ * completion callback runs on the monitor thread with the number of
+ * commands processed and how many of those failed.
+ */
+
+typedef void (*mrp_done_cb)(int processed, int failed, void *arg);
+
+enum mrp_decl_type {
+	MRP_DECL_DOMAIN,		/* class_id, priority, vlan */
+	MRP_DECL_VLAN,			/* joins VLAN 2 */
+	MRP_DECL_TALKER,		/* streamid, destaddr, vlan, pktsz, interval, priority, latency */
+	MRP_DECL_TALKER_LEAVE,		/* as MRP_DECL_TALKER */
+	MRP_DECL_LISTENER,		/* streamid, declares ready */
+	MRP_DECL_LISTENER_LEAVE		/* streamid */
+};
+
+struct mrp_decl {
+	enum mrp_decl_type type;
+	uint8_t streamid[8];
+	uint8_t destaddr[6];
+	u_int16_t vlan;
+	int class_id;
+	int pktsz;
+	int interval;
+	int priority;
+	int latency;
+};
+
+int mrp_batch_flush_async(mrp_done_cb cb, void *arg);
+int mrp_submit(const struct mrp_decl *decls, int count, mrp_done_cb cb, void *arg);
+
 #endif /* _TALKER_MRP_CLIENT_H_ */
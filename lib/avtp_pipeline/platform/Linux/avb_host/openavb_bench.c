@@ -0,0 +1,673 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Loopback talker to listener pipeline benchmark.
+*
+* Each stream is a talker and a listener wired together through the
+* in-process "loop" rawsock, so the mapping modules, media queues and AVTP
+* run exactly as they do on the network while no frame ever leaves the
+* process. Streams are spread over worker threads; every thread drives the
+* talker and the listener of its streams in turn and times each stage.
+*
+* gPTP must be running, as for the host and harness, since timestamps are
+* taken from the wall (PTP) clock.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include "openavb_tl_pub.h"
+#include "openavb_osal_pub.h"
+#include "openavb_trace_pub.h"
+#include "openavb_avtp.h"
+#include "openavb_avtp_time_pub.h"
+#include "openavb_histogram_pub.h"
+#include "openavb_map_uncmp_audio_pub.h"
+#include <inttypes.h>
+
+#define	AVB_LOG_COMPONENT	"TL Bench"
+#include "openavb_log_pub.h"
+
+// Mapping modules under test
+extern bool openavbMapNullInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+extern bool openavbMapAVTPAudioInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+extern bool openavbMapUncmpAudioInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+
+// Interface module providing the non data path callbacks
+extern bool openavbIntfNullInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
+
+// Default in-process wire
+#define BENCH_DEFAULT_IFNAME		"loop:bench"
+
+// Media queue items and rawsock RX queue depth per stream
+#define BENCH_ITEM_COUNT			"64"
+#define BENCH_RX_FRAMES				64
+#define BENCH_TX_FRAMES				8
+
+// Calls to the listener allowed for one frame to come out of the pipeline
+#define BENCH_RX_TRIES				4
+
+// How many frames between looks at the clock and the running flag
+#define BENCH_CHECK_INTERVAL		256
+
+// Audio format used for the audio mappings
+#define BENCH_AUDIO_RATE			AVB_AUDIO_RATE_48KHZ
+#define BENCH_AUDIO_BIT_DEPTH		AVB_AUDIO_BIT_DEPTH_24BIT
+
+typedef enum {
+	BENCH_STAGE_INTF_TX = 0,	// talker interface module filling an item
+	BENCH_STAGE_AVTP_TX,		// talker mapping and AVTP, up to the rawsock
+	BENCH_STAGE_AVTP_RX,		// rawsock, AVTP and listener mapping
+	BENCH_STAGE_INTF_RX,		// listener interface module taking an item
+	BENCH_STAGE_COUNT
+} bench_stage_t;
+
+static const char *benchStageNames[BENCH_STAGE_COUNT] = {
+	"intf tx", "avtp tx", "avtp rx", "intf rx"
+};
+
+typedef struct {
+	const char *name;
+	bool (*pMapInitFn)(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+	bool bAudio;
+} bench_map_t;
+
+static const bench_map_t benchMaps[] = {
+	{ "null", openavbMapNullInitialize, FALSE },
+	{ "aaf", openavbMapAVTPAudioInitialize, TRUE },
+	{ "uncmp", openavbMapUncmpAudioInitialize, TRUE },
+};
+
+// One side (talker or listener) of a stream
+typedef struct {
+	media_q_t *pMediaQ;
+	openavb_map_cb_t mapCB;
+	openavb_intf_cb_t intfCB;
+	void *pAvtp;
+} bench_side_t;
+
+typedef struct {
+	bench_side_t talker;
+	bench_side_t listener;
+	AVBStreamID_t streamID;
+	U8 destAddr[ETH_ALEN];
+	// Bytes the talker interface puts in each item
+	U32 fillLen;
+	// Frames that went through the whole pipeline
+	U64 frames;
+} bench_stream_t;
+
+typedef struct {
+	pthread_t thread;
+	int idx;
+	bench_stream_t **ppStreams;
+	int streamCount;
+	int seconds;
+
+	U64 frames;
+	U64 lost;
+	U64 elapsedNS;
+	// Items taken by the listener interface module
+	U64 rxItems;
+	// Time spent in the listener interface module during the current frame
+	U64 intfRxNS;
+
+	openavb_hist_t stage[BENCH_STAGE_COUNT];
+	openavb_hist_t latency;
+} bench_thread_t;
+
+typedef struct {
+	const bench_map_t *pMap;
+	char *ifname;
+	int streamCount;
+	int threadCount;
+	int seconds;
+	U32 txRate;
+	U32 channels;
+	bool bPin;
+} bench_opts_t;
+
+static volatile bool bRunning = TRUE;
+
+// The stream being driven, and its thread, for the interface callbacks
+static __thread bench_stream_t *tCurStream = NULL;
+static __thread bench_thread_t *tCurThread = NULL;
+
+static inline U64 x_benchNowNS(void)
+{
+	U64 nowNS = 0;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_MONOTONIC, &nowNS);
+	return nowNS;
+}
+
+/***********************************************
+ * Interface callbacks for the data path.
+ * Same as the null interface module, except that the talker fills whole
+ * items (so the audio mappings accept them) and the listener ignores
+ * presentation times and records the latency of each item instead.
+ */
+static bool openavbBenchIntfTxCB(media_q_t *pMediaQ)
+{
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem)
+		return FALSE;	// Media queue full
+
+	openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+	pMediaQItem->dataLen = tCurStream->fillLen;
+	openavbMediaQHeadPush(pMediaQ);
+	return TRUE;
+}
+
+static bool openavbBenchIntfRxCB(media_q_t *pMediaQ)
+{
+	U64 startNS = x_benchNowNS();
+	media_q_item_t *pMediaQItem;
+
+	while ((pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE)) != NULL) {
+		if (openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime)) {
+			U64 wallNS = 0;
+			CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &wallNS);
+			openavbHistRecordDelta(&tCurThread->latency,
+				(S64)(wallNS - openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime)));
+		}
+		openavbMediaQTailPull(pMediaQ);
+		tCurThread->rxItems++;
+	}
+
+	tCurThread->intfRxNS += x_benchNowNS() - startNS;
+	return FALSE;
+}
+
+/***********************************************
+ * Stream setup and teardown
+ */
+static bool openavbBenchSideInit(bench_side_t *pSide, bench_stream_t *pStream, bench_opts_t *pOpts, bool bTalker)
+{
+	char value[32];
+
+	pSide->pMediaQ = openavbMediaQCreate();
+	if (!pSide->pMediaQ) {
+		AVB_LOG_ERROR("Unable to create media queue");
+		return FALSE;
+	}
+
+	// No transit time, so items are due as soon as they are received
+	if (!pOpts->pMap->pMapInitFn(pSide->pMediaQ, &pSide->mapCB, 0)) {
+		AVB_LOG_ERROR("Mapping initialize function error.");
+		return FALSE;
+	}
+	if (!openavbIntfNullInitialize(pSide->pMediaQ, &pSide->intfCB)) {
+		AVB_LOG_ERROR("Interface initialize function error.");
+		return FALSE;
+	}
+	pSide->intfCB.intf_tx_cb = openavbBenchIntfTxCB;
+	pSide->intfCB.intf_rx_cb = openavbBenchIntfRxCB;
+
+	snprintf(value, sizeof(value), "%u", pOpts->txRate);
+	pSide->mapCB.map_cfg_cb(pSide->pMediaQ, "map_nv_item_count", BENCH_ITEM_COUNT);
+	pSide->mapCB.map_cfg_cb(pSide->pMediaQ, "map_nv_tx_rate", value);
+
+	if (pOpts->pMap->bAudio) {
+		// Normally set by the interface module from its configuration
+		media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pSide->pMediaQ->pPubMapInfo;
+		pPubMapInfo->audioRate = BENCH_AUDIO_RATE;
+		pPubMapInfo->audioType = AVB_AUDIO_TYPE_INT;
+		pPubMapInfo->audioBitDepth = BENCH_AUDIO_BIT_DEPTH;
+		pPubMapInfo->audioEndian = AVB_AUDIO_ENDIAN_BIG;
+		pPubMapInfo->audioChannels = pOpts->channels;
+	}
+
+	pSide->mapCB.map_gen_init_cb(pSide->pMediaQ);
+	pSide->intfCB.intf_gen_init_cb(pSide->pMediaQ);
+
+	if (bTalker) {
+		if (pOpts->pMap->bAudio) {
+			media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pSide->pMediaQ->pPubMapInfo;
+			pStream->fillLen = pPubMapInfo->itemSize;
+		}
+		else {
+			pStream->fillLen = 1;
+		}
+
+		openavbRC rc = openavbAvtpTxInit(pSide->pMediaQ, &pSide->mapCB, &pSide->intfCB,
+			pOpts->ifname, &pStream->streamID, pStream->destAddr,
+			0, 0, 0, 0, BENCH_TX_FRAMES, NULL, &pSide->pAvtp);
+		if (IS_OPENAVB_FAILURE(rc)) {
+			AVB_LOG_ERROR("Failed to create AVTP talker stream");
+			return FALSE;
+		}
+	}
+	else {
+		openavbRC rc = openavbAvtpRxInit(pSide->pMediaQ, &pSide->mapCB, &pSide->intfCB,
+			pOpts->ifname, &pStream->streamID, pStream->destAddr,
+			BENCH_RX_FRAMES, FALSE, 0, NULL, &pSide->pAvtp);
+		if (IS_OPENAVB_FAILURE(rc)) {
+			AVB_LOG_ERROR("Failed to create AVTP listener stream");
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void openavbBenchSideClose(bench_side_t *pSide)
+{
+	if (pSide->pAvtp) {
+		openavbAvtpShutdown(pSide->pAvtp);
+		pSide->pAvtp = NULL;
+	}
+	if (pSide->pMediaQ) {
+		if (pSide->intfCB.intf_gen_end_cb)
+			pSide->intfCB.intf_gen_end_cb(pSide->pMediaQ);
+		if (pSide->mapCB.map_gen_end_cb)
+			pSide->mapCB.map_gen_end_cb(pSide->pMediaQ);
+		openavbMediaQDelete(pSide->pMediaQ);
+		pSide->pMediaQ = NULL;
+	}
+}
+
+static bench_stream_t *openavbBenchStreamCreate(int idx, bench_opts_t *pOpts)
+{
+	bench_stream_t *pStream = calloc(1, sizeof(bench_stream_t));
+	if (!pStream) {
+		AVB_LOG_ERROR("Unable to allocate stream");
+		return NULL;
+	}
+
+	// Stream IDs and destinations made unique by the stream index
+	if_info_t ifInfo;
+	if (openavbCheckInterface(pOpts->ifname, &ifInfo))
+		memcpy(pStream->streamID.addr, ifInfo.mac.ether_addr_octet, ETH_ALEN);
+	pStream->streamID.uniqueID = idx;
+	U8 destAddr[ETH_ALEN] = {0x91, 0xe0, 0xf0, 0x00, (idx >> 8) & 0xff, idx & 0xff};
+	memcpy(pStream->destAddr, destAddr, ETH_ALEN);
+
+	// The listener first, so that it is on the wire before the talker sends
+	if (!openavbBenchSideInit(&pStream->listener, pStream, pOpts, FALSE)
+		|| !openavbBenchSideInit(&pStream->talker, pStream, pOpts, TRUE)) {
+		AVB_LOGF_ERROR("Unable to create stream %d", idx);
+		openavbBenchSideClose(&pStream->talker);
+		openavbBenchSideClose(&pStream->listener);
+		free(pStream);
+		return NULL;
+	}
+
+	return pStream;
+}
+
+static void openavbBenchStreamDelete(bench_stream_t *pStream)
+{
+	if (pStream) {
+		openavbBenchSideClose(&pStream->talker);
+		openavbBenchSideClose(&pStream->listener);
+		free(pStream);
+	}
+}
+
+/***********************************************
+ * Worker thread. Pushes one frame at a time through each of its streams.
+ */
+static bool openavbBenchFrame(bench_thread_t *pThread, bench_stream_t *pStream)
+{
+	U64 t0, t1, t2, t3;
+
+	tCurStream = pStream;
+
+	t0 = x_benchNowNS();
+	bool bPushed = pStream->talker.intfCB.intf_tx_cb(pStream->talker.pMediaQ);
+	t1 = x_benchNowNS();
+	if (!bPushed)
+		return FALSE;
+
+	openavbRC rc = openavbAvtpTx(pStream->talker.pAvtp, TRUE, FALSE);
+	t2 = x_benchNowNS();
+	if (IS_OPENAVB_FAILURE(rc))
+		return FALSE;
+
+	// The first call receives the frame into the media queue,
+	// the next one hands the (already due) item to the interface.
+	U64 rxItems = pThread->rxItems;
+	int tries;
+	pThread->intfRxNS = 0;
+	for (tries = 0; tries < BENCH_RX_TRIES && pThread->rxItems == rxItems; tries++) {
+		openavbAvtpRx(pStream->listener.pAvtp);
+	}
+	t3 = x_benchNowNS();
+	if (pThread->rxItems == rxItems)
+		return FALSE;
+
+	openavbHistRecordDelta(&pThread->stage[BENCH_STAGE_INTF_TX], (S64)(t1 - t0));
+	openavbHistRecordDelta(&pThread->stage[BENCH_STAGE_AVTP_TX], (S64)(t2 - t1));
+	openavbHistRecordDelta(&pThread->stage[BENCH_STAGE_AVTP_RX], (S64)(t3 - t2 - pThread->intfRxNS));
+	openavbHistRecordDelta(&pThread->stage[BENCH_STAGE_INTF_RX], (S64)pThread->intfRxNS);
+
+	pStream->frames++;
+	return TRUE;
+}
+
+static void *openavbBenchThread(void *pv)
+{
+	bench_thread_t *pThread = (bench_thread_t *)pv;
+	tCurThread = pThread;
+
+	openavbHistReset(&pThread->latency);
+	int i1;
+	for (i1 = 0; i1 < BENCH_STAGE_COUNT; i1++)
+		openavbHistReset(&pThread->stage[i1]);
+
+	U64 startNS = x_benchNowNS();
+	U64 endNS = startNS + (U64)pThread->seconds * NANOSECONDS_PER_SECOND;
+	U64 nowNS = startNS;
+	U32 count = 0;
+
+	while (bRunning && nowNS < endNS) {
+		for (i1 = 0; i1 < pThread->streamCount; i1++) {
+			if (openavbBenchFrame(pThread, pThread->ppStreams[i1]))
+				pThread->frames++;
+			else
+				pThread->lost++;
+		}
+		if (++count % BENCH_CHECK_INTERVAL == 0)
+			nowNS = x_benchNowNS();
+	}
+
+	pThread->elapsedNS = x_benchNowNS() - startNS;
+	return NULL;
+}
+
+/***********************************************
+ * Reporting
+ */
+static void openavbBenchHistMerge(openavb_hist_t *pDst, const openavb_hist_t *pSrc)
+{
+	int i1;
+	for (i1 = 0; i1 < OPENAVB_HIST_BUCKETS; i1++)
+		pDst->bucket[i1] += pSrc->bucket[i1];
+	pDst->count += pSrc->count;
+	pDst->sum += pSrc->sum;
+	if (pSrc->max > pDst->max)
+		pDst->max = pSrc->max;
+}
+
+static void openavbBenchPrintHist(const char *name, const openavb_hist_t *pHist)
+{
+	openavb_hist_summary_t summary;
+	openavbHistSummarize(pHist, &summary);
+	printf("  %-10s %10u %10u %10u %10u %10u\n",
+		name, summary.mean, summary.p50, summary.p99, summary.p999, summary.max);
+}
+
+static void openavbBenchReport(bench_opts_t *pOpts, bench_thread_t *pThreads, int threadCount)
+{
+	openavb_hist_t *pHist = calloc(BENCH_STAGE_COUNT + 1, sizeof(openavb_hist_t));
+	if (!pHist) {
+		AVB_LOG_ERROR("Unable to allocate report histograms");
+		return;
+	}
+
+	U64 frames = 0, lost = 0, elapsedNS = 0;
+	int i1, i2;
+	for (i1 = 0; i1 < threadCount; i1++) {
+		frames += pThreads[i1].frames;
+		lost += pThreads[i1].lost;
+		if (pThreads[i1].elapsedNS > elapsedNS)
+			elapsedNS = pThreads[i1].elapsedNS;
+		for (i2 = 0; i2 < BENCH_STAGE_COUNT; i2++)
+			openavbBenchHistMerge(&pHist[i2], &pThreads[i1].stage[i2]);
+		openavbBenchHistMerge(&pHist[BENCH_STAGE_COUNT], &pThreads[i1].latency);
+	}
+
+	double seconds = (double)elapsedNS / NANOSECONDS_PER_SECOND;
+	double fps = seconds > 0 ? frames / seconds : 0;
+
+	printf("\n");
+	printf("Mapping %s, %d stream(s) on %d thread(s), %.2f s\n", pOpts->pMap->name, pOpts->streamCount, threadCount, seconds);
+	printf("  frames      %" PRIu64 " (%" PRIu64 " lost)\n", frames, lost);
+	printf("  frames/sec  %.0f total, %.0f per core, %.0f per stream\n",
+		fps, fps / threadCount, fps / pOpts->streamCount);
+	for (i1 = 0; i1 < threadCount; i1++) {
+		double tSeconds = (double)pThreads[i1].elapsedNS / NANOSECONDS_PER_SECOND;
+		printf("  thread %-3d  %.0f frames/sec\n", i1, tSeconds > 0 ? pThreads[i1].frames / tSeconds : 0);
+	}
+
+	printf("\n  %-10s %10s %10s %10s %10s %10s\n", "ns/frame", "mean", "p50", "p99", "p99.9", "max");
+	for (i1 = 0; i1 < BENCH_STAGE_COUNT; i1++)
+		openavbBenchPrintHist(benchStageNames[i1], &pHist[i1]);
+	openavbBenchPrintHist("latency", &pHist[BENCH_STAGE_COUNT]);
+	printf("\n");
+
+	free(pHist);
+}
+
+/***********************************************
+ * Signal handler - used to respond to signals.
+ * Allows graceful cleanup.
+ */
+static void openavbBenchSigHandler(int signal)
+{
+	if (signal == SIGINT) {
+		bRunning = FALSE;
+	}
+}
+
+void openavbBenchUsage(char *programName)
+{
+	printf(
+		"\n"
+		"Usage: %s [options]\n"
+		"  -m val     Mapping to run: null, aaf or uncmp. Defaults to null.\n"
+		"  -s val     Stream count. Defaults to 1.\n"
+		"  -t val     Worker threads; streams are spread evenly over them. Defaults to 1.\n"
+		"  -d val     Run for 'val' seconds. Defaults to 5.\n"
+		"  -r val     Talker transmit rate (frames per second per stream, as map_nv_tx_rate). Defaults to 8000.\n"
+		"  -c val     Audio channels for the audio mappings (48KHz, 24 bit). Defaults to 2.\n"
+		"  -I val     Loop interface the streams are wired through. Defaults to " BENCH_DEFAULT_IFNAME ".\n"
+		"  -a         Pin worker thread N to CPU N.\n"
+		"  -h         Prints this message.\n"
+		"\n"
+		"Frames are pushed through each stream as fast as possible; the transmit rate only\n"
+		"sets how much data goes in each frame.\n"
+		"\n"
+		"Examples:\n"
+		"  %s -m aaf -s 32 -t 4 -a\n"
+		"    Run 32 AAF streams on 4 pinned threads for 5 seconds.\n\n"
+		,
+		programName, programName);
+}
+
+/**********************************************
+ * main
+ */
+int main(int argc, char *argv[])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HOST);
+
+	char *programName;
+	bench_opts_t opts;
+	bench_stream_t **ppStreams = NULL;
+	bench_thread_t *pThreads = NULL;
+	int nCreated = 0, nStarted = 0;
+	int i1, i2;
+	int ret = 0;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.pMap = &benchMaps[0];
+	opts.ifname = BENCH_DEFAULT_IFNAME;
+	opts.streamCount = 1;
+	opts.threadCount = 1;
+	opts.seconds = 5;
+	opts.txRate = 8000;
+	opts.channels = 2;
+
+	// Setup signal handler. Catch SIGINT and shutdown cleanly
+	struct sigaction sa;
+	sa.sa_handler = openavbBenchSigHandler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0; // not SA_RESTART
+	sigaction(SIGINT, &sa, NULL);
+
+	// Process command line
+	programName = strrchr(argv[0], '/');
+	programName = programName ? programName + 1 : argv[0];
+
+	bool optDone = FALSE;
+	while (!optDone) {
+		int opt = getopt(argc, argv, "m:s:t:d:r:c:I:ah");
+		if (opt != EOF) {
+			switch (opt) {
+				case 'm':
+					opts.pMap = NULL;
+					for (i1 = 0; i1 < (int)(sizeof(benchMaps) / sizeof(benchMaps[0])); i1++) {
+						if (strcmp(optarg, benchMaps[i1].name) == 0)
+							opts.pMap = &benchMaps[i1];
+					}
+					if (!opts.pMap) {
+						printf("Unknown mapping: %s\n", optarg);
+						openavbBenchUsage(programName);
+						exit(-1);
+					}
+					break;
+				case 's':
+					opts.streamCount = atoi(optarg);
+					break;
+				case 't':
+					opts.threadCount = atoi(optarg);
+					break;
+				case 'd':
+					opts.seconds = atoi(optarg);
+					break;
+				case 'r':
+					opts.txRate = strtoul(optarg, NULL, 0);
+					break;
+				case 'c':
+					opts.channels = strtoul(optarg, NULL, 0);
+					break;
+				case 'I':
+					opts.ifname = optarg;
+					break;
+				case 'a':
+					opts.bPin = TRUE;
+					break;
+				case 'h':
+				case '?':
+				default:
+					openavbBenchUsage(programName);
+					exit(-1);
+			}
+		}
+		else {
+			optDone = TRUE;
+		}
+	}
+
+	if (opts.streamCount < 1 || opts.threadCount < 1 || opts.seconds < 1 || opts.txRate == 0 || opts.channels == 0) {
+		openavbBenchUsage(programName);
+		exit(-1);
+	}
+	if (strncmp(opts.ifname, "loop:", 5) != 0) {
+		printf("Interface must be a loop interface (loop:name)\n");
+		exit(-1);
+	}
+	if (opts.threadCount > opts.streamCount)
+		opts.threadCount = opts.streamCount;
+
+	// No endpoint or QoS manager is involved
+	avbLogInit();
+	osalAVBTimeInit();
+
+	ppStreams = calloc(opts.streamCount, sizeof(bench_stream_t *));
+	pThreads = calloc(opts.threadCount, sizeof(bench_thread_t));
+	if (!ppStreams || !pThreads) {
+		AVB_LOG_ERROR("Unable to allocate streams");
+		ret = -1;
+		goto cleanup;
+	}
+
+	for (nCreated = 0; nCreated < opts.streamCount; nCreated++) {
+		ppStreams[nCreated] = openavbBenchStreamCreate(nCreated, &opts);
+		if (!ppStreams[nCreated]) {
+			ret = -1;
+			goto cleanup;
+		}
+	}
+
+	// Give each thread a contiguous run of streams
+	for (i1 = 0, i2 = 0; i1 < opts.threadCount; i1++) {
+		pThreads[i1].idx = i1;
+		pThreads[i1].seconds = opts.seconds;
+		pThreads[i1].ppStreams = &ppStreams[i2];
+		pThreads[i1].streamCount = opts.streamCount / opts.threadCount
+			+ (i1 < opts.streamCount % opts.threadCount ? 1 : 0);
+		i2 += pThreads[i1].streamCount;
+	}
+
+	printf("Running %d %s stream(s) on %d thread(s) for %d s\n",
+		opts.streamCount, opts.pMap->name, opts.threadCount, opts.seconds);
+
+	for (nStarted = 0; nStarted < opts.threadCount; nStarted++) {
+		if (pthread_create(&pThreads[nStarted].thread, NULL, openavbBenchThread, &pThreads[nStarted]) != 0) {
+			AVB_LOG_ERROR("Unable to start worker thread");
+			bRunning = FALSE;
+			ret = -1;
+			break;
+		}
+		if (opts.bPin) {
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			CPU_SET(nStarted % CPU_SETSIZE, &cpuset);
+			pthread_setaffinity_np(pThreads[nStarted].thread, sizeof(cpu_set_t), &cpuset);
+		}
+	}
+
+	for (i1 = 0; i1 < nStarted; i1++) {
+		pthread_join(pThreads[i1].thread, NULL);
+	}
+
+	if (ret == 0)
+		openavbBenchReport(&opts, pThreads, opts.threadCount);
+
+cleanup:
+	for (i1 = 0; i1 < nCreated; i1++) {
+		openavbBenchStreamDelete(ppStreams[i1]);
+	}
+	free(ppStreams);
+	free(pThreads);
+
+	osalAVBTimeClose();
+	avbLogExit();
+
+	AVB_TRACE_EXIT(AVB_TRACE_HOST);
+	exit(ret);
+}
@@ -43,6 +43,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_osal_pub.h"
 #include "openavb_plugin.h"
 #include "openavb_trace_pub.h"
+#include "openavb_metrics.h"
 #ifdef AVB_FEATURE_GSTREAMER
 #include <gst/gst.h>
 #endif
@@ -57,6 +58,7 @@ bool bRunning = TRUE;
 extern bool openavbMapPipeInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapAVTPAudioInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapCtrlInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+extern bool openavbMapCrfInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapH264Initialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapMjpegInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapMpeg2tsInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
@@ -69,6 +71,7 @@ extern bool openavbIntfCtrlInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIn
 extern bool openavbIntfLoggerInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 extern bool openavbIntfNullInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 extern bool openavbIntfToneGenInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
+extern bool openavbIntfVerifyInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 extern bool openavbIntfViewerInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 
 // Linux interface modules
@@ -82,6 +85,110 @@ extern bool openavbIntfH264RtpGstInitialize(media_q_t *pMediaQ, openavb_intf_cb_
 #endif
 
 
+/***********************************************
+ * Parallel stream configuration.
+ * Worker threads take the next unconfigured stream until all are done.
+ */
+typedef struct {
+	char **tlIniList;
+	tl_handle_t *tlHandleList;
+	int tlCount;
+	int nextIdx;
+	bool bError;
+	pthread_mutex_t mutex;
+} harness_cfg_work_t;
+
+static bool openavbTlHarnessConfigure(tl_handle_t handle, char *iniFile)
+{
+	bool bOk = TRUE;
+	openavb_tl_cfg_t cfg;
+	openavb_tl_cfg_name_value_t NVCfg;
+
+	printf("Configuring: %s\n", iniFile);
+	openavbTLInitCfg(&cfg);
+	memset(&NVCfg, 0, sizeof(NVCfg));
+
+	if (!openavbTLReadIniFileOsal(handle, iniFile, &cfg, &NVCfg)) {
+		printf("Error reading ini file: %s\n", iniFile);
+		return FALSE;
+	}
+	if (!openavbTLConfigure(handle, &cfg, &NVCfg)) {
+		printf("Error configuring: %s\n", iniFile);
+		bOk = FALSE;
+	}
+
+	int i2;
+	for (i2 = 0; i2 < NVCfg.nLibCfgItems; i2++) {
+		free(NVCfg.libCfgNames[i2]);
+		free(NVCfg.libCfgValues[i2]);
+	}
+	return bOk;
+}
+
+static void *openavbTlHarnessConfigureThread(void *pv)
+{
+	harness_cfg_work_t *pWork = (harness_cfg_work_t *)pv;
+
+	while (1) {
+		pthread_mutex_lock(&pWork->mutex);
+		int idx = pWork->bError ? pWork->tlCount : pWork->nextIdx++;
+		pthread_mutex_unlock(&pWork->mutex);
+
+		if (idx >= pWork->tlCount)
+			break;
+
+		if (!openavbTlHarnessConfigure(pWork->tlHandleList[idx], pWork->tlIniList[idx])) {
+			pthread_mutex_lock(&pWork->mutex);
+			pWork->bError = TRUE;
+			pthread_mutex_unlock(&pWork->mutex);
+		}
+	}
+	return NULL;
+}
+
+// Configure all streams on up to nThreads threads. Returns FALSE if any stream failed.
+static bool openavbTlHarnessConfigureParallel(char **tlIniList, tl_handle_t *tlHandleList, int tlCount, int nThreads)
+{
+	harness_cfg_work_t work;
+	pthread_t *threads;
+	int i1, nStarted = 0;
+
+	if (nThreads > tlCount)
+		nThreads = tlCount;
+	if (nThreads <= 0) {
+		AVB_LOG_ERROR("No streams or threads to configure them on");
+		return FALSE;
+	}
+
+	memset(&work, 0, sizeof(work));
+	work.tlIniList = tlIniList;
+	work.tlHandleList = tlHandleList;
+	work.tlCount = tlCount;
+	pthread_mutex_init(&work.mutex, NULL);
+
+	threads = calloc((size_t)nThreads, sizeof(pthread_t));
+
+	for (i1 = 0; threads && i1 < nThreads; i1++) {
+		if (pthread_create(&threads[i1], NULL, openavbTlHarnessConfigureThread, &work) != 0) {
+			AVB_LOG_WARNING("Unable to start configuration thread");
+			break;
+		}
+		nStarted++;
+	}
+
+	// Configure on this thread too; also covers the case where no thread could be started
+	openavbTlHarnessConfigureThread(&work);
+
+	for (i1 = 0; i1 < nStarted; i1++) {
+		pthread_join(threads[i1], NULL);
+	}
+	free(threads);
+	pthread_mutex_destroy(&work.mutex);
+
+	return !work.bError;
+}
+
+
 /***********************************************
  * Signal handler - used to respond to signals.
  * Allows graceful cleanup.
@@ -110,11 +217,16 @@ void openavbTlHarnessUsage(char *programName)
 		"\n"
 		"Usage: %s [options] file...\n"
 		"  -a val     Override stream address in each configuration file.\n"
+		"  -c mask    Run the logging, endpoint and other service threads on the CPUs in 'mask'. Streams use their thread_affinity.\n"
 		"  -h         Prints this message.\n"
 		"  -i         Enables interactive mode.\n"
 		"  -s val     Stream count. Starts 'val' number of streams for each configuration file. stream_uid will be overriden.\n"
 		"  -d val     Last byte of destination address from static pool. Full address will be 91:e0:f0:00:fe:val.\n"
 		"  -I val     Use given (val) interface globally, can be overriden by giving the ifname= option to the config line.\n"
+		"  -L         Prelink: resolve the mapping and interface modules of all streams at start, and never use the dynamic loader after.\n"
+		"  -p val     Configure streams on 'val' parallel threads. Speeds up startup of many streams.\n"
+		"  -M name    Publish the stats, latency histograms and latency trace of all streams in shared memory segment 'name'.\n"
+		"  -P port    Serve the stats and latency histograms of all streams as Prometheus text on TCP 'port'.\n"
 		"\n"
 		"Examples:\n"
 		"  %s talker.ini\n"
@@ -142,6 +254,7 @@ void openavbTlHarnessMenu()
 		" t            Stop all streams\n"
 		" l            List streams\n"
 		" 0-99         Toggle the state of the numbered stream\n"
+		" p0-p99       Toggle warm standby (pause) of the numbered stream\n"
 		" m            Display this menu\n"
 		" z            Stats\n"
 		" x            Exit\n"
@@ -165,6 +278,11 @@ int main(int argc, char *argv[])
 	bool optDestAddrSet = FALSE;
 	U8 destAddr[ETH_ALEN] = {0x91, 0xe0, 0xf0, 0x00, 0xfe, 0x00};
 	char *optIfnameGlobal = NULL;
+	int optCfgThreads = 1;
+	unsigned long optAffinity = 0;
+	char *optMetricsShm = NULL;
+	U16 optMetricsPort = 0;
+	bool optPrelink = FALSE;
 
 	// Talker listener vars
 	int iniIdx = 0;
@@ -187,6 +305,7 @@ int main(int argc, char *argv[])
 	registerStaticMapModule(openavbMapPipeInitialize);
 	registerStaticMapModule(openavbMapAVTPAudioInitialize);
 	registerStaticMapModule(openavbMapCtrlInitialize);
+	registerStaticMapModule(openavbMapCrfInitialize);
 	registerStaticMapModule(openavbMapH264Initialize);
 	registerStaticMapModule(openavbMapMjpegInitialize);
 	registerStaticMapModule(openavbMapMpeg2tsInitialize);
@@ -198,6 +317,7 @@ int main(int argc, char *argv[])
 	registerStaticIntfModule(openavbIntfLoggerInitialize);
 	registerStaticIntfModule(openavbIntfNullInitialize);
 	registerStaticIntfModule(openavbIntfToneGenInitialize);
+	registerStaticIntfModule(openavbIntfVerifyInitialize);
 	registerStaticIntfModule(openavbIntfViewerInitialize);
 	registerStaticIntfModule(openavbIntfAlsaInitialize);
 	registerStaticIntfModule(openavbIntfMpeg2tsFileInitialize);
@@ -218,12 +338,15 @@ int main(int argc, char *argv[])
 
 	bool optDone = FALSE;
 	while (!optDone) {
-		int opt = getopt(argc, argv, "a:his:d:I:");
+		int opt = getopt(argc, argv, "a:c:his:d:I:Lp:M:P:");
 		if (opt != EOF) {
 			switch (opt) {
 				case 'a':
 					optStreamAddr = strdup(optarg);
 					break;
+				case 'c':
+					optAffinity = strtoul(optarg, NULL, 0);
+					break;
 				case 'i':
 					optInteractive = TRUE;
 					break;
@@ -238,6 +361,18 @@ int main(int argc, char *argv[])
 				case 'I':
 					optIfnameGlobal = strdup(optarg);
 					break;
+				case 'p':
+					optCfgThreads = atoi(optarg);
+					break;
+				case 'L':
+					optPrelink = TRUE;
+					break;
+				case 'M':
+					optMetricsShm = optarg;
+					break;
+				case 'P':
+					optMetricsPort = atoi(optarg);
+					break;
 				case '?':
 				default:
 					openavbTlHarnessUsage(programName);
@@ -249,6 +384,9 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (optAffinity) {
+		osalAVBSetAffinity(optAffinity);
+	}
 	osalAVBInitialize(optIfnameGlobal);
 
 	// Setup the talker listener counts and lists
@@ -326,30 +464,28 @@ int main(int argc, char *argv[])
 	}
 
 	// Parse ini and configure all streams
-	for (i1 = 0; i1 < tlCount; i1++) {
-		printf("Configuring: %s\n", tlIniList[i1]);
-		openavb_tl_cfg_t cfg;
-		openavb_tl_cfg_name_value_t NVCfg;
-
-		openavbTLInitCfg(&cfg);
-		memset(&NVCfg, 0, sizeof(NVCfg));
-
-		if (!openavbTLReadIniFileOsal(tlHandleList[i1], tlIniList[i1], &cfg, &NVCfg)) {
-			printf("Error reading ini file: %s\n", tlIniList[i1]);
+	if (optCfgThreads > 1) {
+		if (!openavbTlHarnessConfigureParallel(tlIniList, tlHandleList, tlCount, optCfgThreads - 1)) {
 			osalAVBFinalize();
 			exit(-1);
 		}
-		if (!openavbTLConfigure(tlHandleList[i1], &cfg, &NVCfg)) {
-			printf("Error configuring: %s\n", tlIniList[i1]);
-			osalAVBFinalize();
-			exit(-1);
+	}
+	else {
+		for (i1 = 0; i1 < tlCount; i1++) {
+			if (!openavbTlHarnessConfigure(tlHandleList[i1], tlIniList[i1])) {
+				osalAVBFinalize();
+				exit(-1);
+			}
 		}
+	}
 
-		int i2;
-		for (i2 = 0; i2 < NVCfg.nLibCfgItems; i2++) {
-			free(NVCfg.libCfgNames[i2]);
-			free(NVCfg.libCfgValues[i2]);
-		}
+	// Every stream has its modules in the registry now
+	if (optPrelink) {
+		openavbPluginSeal();
+	}
+
+	if (optMetricsShm || optMetricsPort) {
+		openavbMetricsStart(tlHandleList, tlIniList, tlCount, optMetricsShm, optMetricsPort);
 	}
 
 	if (!optInteractive) {
@@ -414,7 +550,7 @@ int main(int argc, char *argv[])
 						int i1;
 						for (i1 = 0; i1 < tlCount; i1++) {
 							if (tlHandleList[i1] && openavbTLIsRunning(tlHandleList[i1])) {
-								printf("%02d: [Started] %s\n", i1, tlIniList[i1]);
+								printf("%02d: [%s] %s\n", i1, openavbTLIsStreamPaused(tlHandleList[i1]) ? "Paused" : "Started", tlIniList[i1]);
 							}
 							else {
 								printf("%02d: [Stopped] %s\n", i1, tlIniList[i1]);
@@ -422,6 +558,20 @@ int main(int argc, char *argv[])
 						}
 					}
 					break;
+				case 'p':
+					// Toggle warm standby; everything stays allocated
+					{
+						int idx = atoi(buf + 1);
+						if (isdigit(buf[1]) && idx < tlCount && tlHandleList[idx]) {
+							bool bPause = !openavbTLIsStreamPaused(tlHandleList[idx]);
+							printf("%s: %s\n", bPause ? "Pausing" : "Resuming", tlIniList[idx]);
+							openavbTLPauseStream(tlHandleList[idx], bPause);
+						}
+						else {
+							openavbTlHarnessMenu();
+						}
+					}
+					break;
 				case 'm':
 					// Display menu
 					openavbTlHarnessMenu();
@@ -441,11 +591,12 @@ int main(int argc, char *argv[])
 										openavbTLStat(tlHandleList[i1], TL_STAT_TX_BYTES));
 								}
 								else if (openavbTLGetRole(tlHandleList[i1]) == AVB_ROLE_LISTENER) {
-									printf("     Listener totals: calls=%" PRIu64 ", frames=%" PRIu64 ", lost=%" PRIu64 ", bytes=%" PRIu64 "\n",
+									printf("     Listener totals: calls=%" PRIu64 ", frames=%" PRIu64 ", lost=%" PRIu64 ", bytes=%" PRIu64 ", purged=%" PRIu64 "\n",
 										openavbTLStat(tlHandleList[i1], TL_STAT_RX_CALLS),
 										openavbTLStat(tlHandleList[i1], TL_STAT_RX_FRAMES),
 										openavbTLStat(tlHandleList[i1], TL_STAT_RX_LOST),
-										openavbTLStat(tlHandleList[i1], TL_STAT_RX_BYTES));
+										openavbTLStat(tlHandleList[i1], TL_STAT_RX_BYTES),
+										openavbTLStat(tlHandleList[i1], TL_STAT_MQ_PURGED));
 								}
 							}
 							else {
@@ -498,6 +649,8 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	openavbMetricsStop();
+
 	// Close the streams
 	for (i1 = 0; i1 < tlCount; i1++) {
 		if (tlHandleList[i1]) {
@@ -37,8 +37,10 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <string.h>
 #include <signal.h>
 #include "openavb_tl_pub.h"
+#include "openavb_osal_pub.h"
 #include "openavb_plugin.h"
 #include "openavb_trace_pub.h"
+#include "openavb_metrics.h"
 #ifdef AVB_FEATURE_GSTREAMER
 #include <gst/gst.h>
 #endif
@@ -52,6 +54,7 @@ bool bRunning = TRUE;
 extern bool openavbMapPipeInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapAVTPAudioInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapCtrlInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+extern bool openavbMapCrfInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapH264Initialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapMjpegInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
 extern bool openavbMapMpeg2tsInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
@@ -64,6 +67,7 @@ extern bool openavbIntfCtrlInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIn
 extern bool openavbIntfLoggerInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 extern bool openavbIntfNullInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 extern bool openavbIntfToneGenInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
+extern bool openavbIntfVerifyInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 extern bool openavbIntfViewerInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
 
 // Linux interface modules
@@ -103,7 +107,11 @@ void openavbTlHostUsage(char *programName)
 	printf(
 		"\n"
 		"Usage: %s [options] file...\n"
+		"  -c mask    Run the logging, endpoint and other service threads on the CPUs in 'mask'. Streams use their thread_affinity.\n"
 		"  -I val     Use given (val) interface globally, can be overriden by giving the ifname= option to the config line.\n"
+		"  -L         Prelink: resolve the mapping and interface modules of all streams at start, and never use the dynamic loader after.\n"
+		"  -M name    Publish the stats, latency histograms and latency trace of all streams in shared memory segment 'name'.\n"
+		"  -P port    Serve the stats and latency histograms of all streams as Prometheus text on TCP 'port'.\n"
 		"\n"
 		"Examples:\n"
 		"  %s talker.ini\n"
@@ -128,6 +136,10 @@ int main(int argc, char *argv[])
 	int iniIdx = 0;
 	char *programName;
 	char *optIfnameGlobal = NULL;
+	unsigned long optAffinity = 0;
+	char *optMetricsShm = NULL;
+	U16 optMetricsPort = 0;
+	bool optPrelink = FALSE;
 
 	programName = strrchr(argv[0], '/');
 	programName = programName ? programName + 1 : argv[0];
@@ -143,12 +155,24 @@ int main(int argc, char *argv[])
 	// Process command line
 	bool optDone = FALSE;
 	while (!optDone) {
-		int opt = getopt(argc, argv, "hI:");
+		int opt = getopt(argc, argv, "c:hI:LM:P:");
 		if (opt != EOF) {
 			switch (opt) {
+				case 'c':
+					optAffinity = strtoul(optarg, NULL, 0);
+					break;
 				case 'I':
 					optIfnameGlobal = strdup(optarg);
 					break;
+				case 'L':
+					optPrelink = TRUE;
+					break;
+				case 'M':
+					optMetricsShm = optarg;
+					break;
+				case 'P':
+					optMetricsPort = atoi(optarg);
+					break;
 				case 'h':
 				default:
 					openavbTlHostUsage(programName);
@@ -160,6 +184,9 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (optAffinity) {
+		osalAVBSetAffinity(optAffinity);
+	}
 	osalAVBInitialize(optIfnameGlobal);
 
 	iniIdx = optind;
@@ -196,6 +223,7 @@ int main(int argc, char *argv[])
 	registerStaticMapModule(openavbMapPipeInitialize);
 	registerStaticMapModule(openavbMapAVTPAudioInitialize);
 	registerStaticMapModule(openavbMapCtrlInitialize);
+	registerStaticMapModule(openavbMapCrfInitialize);
 	registerStaticMapModule(openavbMapH264Initialize);
 	registerStaticMapModule(openavbMapMjpegInitialize);
 	registerStaticMapModule(openavbMapMpeg2tsInitialize);
@@ -207,6 +235,7 @@ int main(int argc, char *argv[])
 	registerStaticIntfModule(openavbIntfLoggerInitialize);
 	registerStaticIntfModule(openavbIntfNullInitialize);
 	registerStaticIntfModule(openavbIntfToneGenInitialize);
+	registerStaticIntfModule(openavbIntfVerifyInitialize);
 	registerStaticIntfModule(openavbIntfViewerInitialize);
 	registerStaticIntfModule(openavbIntfAlsaInitialize);
 	registerStaticIntfModule(openavbIntfMpeg2tsFileInitialize);
@@ -262,6 +291,15 @@ int main(int argc, char *argv[])
 	gst_init(0, NULL);
 #endif
 
+	// Every stream has its modules in the registry now
+	if (optPrelink) {
+		openavbPluginSeal();
+	}
+
+	if (optMetricsShm || optMetricsPort) {
+		openavbMetricsStart(tlHandleList, argv + iniIdx, tlCount, optMetricsShm, optMetricsPort);
+	}
+
 	for (i1 = 0; i1 < tlCount; i1++) {
 		openavbTLRun(tlHandleList[i1]);
 	}
@@ -274,6 +312,8 @@ int main(int argc, char *argv[])
 		openavbTLStop(tlHandleList[i1]);
 	}
 
+	openavbMetricsStop();
+
 	for (i1 = 0; i1 < tlCount; i1++) {
 		openavbTLClose(tlHandleList[i1]);
 	}
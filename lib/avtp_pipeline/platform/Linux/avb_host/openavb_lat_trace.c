@@ -0,0 +1,438 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Latency trace reader and joiner.
+*
+* Follows the latency trace ring a host publishes with -M and writes the
+* samples as CSV, one line per traced frame and role. Traces taken on the
+* talker and listener hosts (their clocks are gPTP time, so they compare
+* directly) are then joined on stream ID, AVTP timestamp and sequence number
+* to give the time between each stage of every traced frame.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <inttypes.h>
+#include "openavb_metrics.h"
+
+static volatile bool bRunning = TRUE;
+
+// Column names of the trace CSV, after stream_id, role, seq and avtp_timestamp.
+// Indexed by openavb_lat_stage_t
+static const char *x_stageNames[OPENAVB_LAT_STAGE_COUNT] = {
+	"tx_intf",
+	"tx_map",
+	"tx_submit",
+	"tx_launch",
+	"rx_rawsock",
+	"rx_map",
+	"rx_present",
+};
+
+// One row of a trace CSV
+typedef struct {
+	U8 streamID[8];
+	bool bTalker;
+	U32 seq;
+	U32 avtpTimestamp;
+	U64 stageNS[OPENAVB_LAT_STAGE_COUNT];
+} lat_row_t;
+
+// Time between two stages of a joined frame
+typedef struct {
+	const char *name;
+	bool bFromTalker;
+	openavb_lat_stage_t from;
+	// Used when the from stage was not recorded (e.g. no launch time)
+	S32 fromAlt;
+	openavb_lat_stage_t to;
+} lat_delta_t;
+
+static const lat_delta_t x_deltas[] = {
+	{ "tx_intf_to_map", TRUE, OPENAVB_LAT_TX_INTF, -1, OPENAVB_LAT_TX_MAP },
+	{ "tx_map_to_submit", TRUE, OPENAVB_LAT_TX_MAP, -1, OPENAVB_LAT_TX_SUBMIT },
+	{ "tx_submit_to_launch", TRUE, OPENAVB_LAT_TX_SUBMIT, -1, OPENAVB_LAT_TX_LAUNCH },
+	{ "wire_to_rx_rawsock", TRUE, OPENAVB_LAT_TX_LAUNCH, OPENAVB_LAT_TX_SUBMIT, OPENAVB_LAT_RX_RAWSOCK },
+	{ "rx_rawsock_to_map", FALSE, OPENAVB_LAT_RX_RAWSOCK, -1, OPENAVB_LAT_RX_MAP },
+	{ "rx_map_to_present", FALSE, OPENAVB_LAT_RX_MAP, -1, OPENAVB_LAT_RX_PRESENT },
+	{ "tx_intf_to_present", TRUE, OPENAVB_LAT_TX_INTF, -1, OPENAVB_LAT_RX_PRESENT },
+};
+#define LAT_DELTA_COUNT (sizeof(x_deltas) / sizeof(x_deltas[0]))
+
+void openavbLatTraceSigHandler(int signal)
+{
+	if (signal == SIGINT) {
+		bRunning = FALSE;
+	}
+}
+
+void openavbLatTraceUsage(char *programName)
+{
+	printf(
+		"\n"
+		"Usage: %s -M name [-d val]\n"
+		"       %s -j file...\n"
+		"  -M name    Follow the latency trace in shared memory segment 'name' (the host's -M)\n"
+		"             and write the samples to stdout as CSV until interrupted.\n"
+		"  -d val     Stop following after 'val' seconds.\n"
+		"  -j         Join the talker and listener samples in the CSV files, writing the time\n"
+		"             between stages of each traced frame to stdout and a summary to stderr.\n"
+		"  -h         Prints this message.\n"
+		"\n"
+		"Set latency_trace to the same value on the talker and its listeners.\n"
+		"\n"
+		"Examples:\n"
+		"  %s -M openavb_metrics -d 60 > talker.csv\n"
+		"    Record one minute of trace samples from a host started with -M openavb_metrics.\n\n"
+		"  %s -j talker.csv listener.csv\n"
+		"    Join the samples recorded on a talker and a listener host.\n\n"
+		,
+		programName, programName, programName, programName);
+}
+
+static void x_printStreamID(FILE *pOut, const U8 *pID)
+{
+	fprintf(pOut, "%02x%02x%02x%02x%02x%02x:%02x%02x",
+		pID[0], pID[1], pID[2], pID[3], pID[4], pID[5], pID[6], pID[7]);
+}
+
+static void x_printSample(const openavb_lat_sample_t *pSample)
+{
+	int i1;
+
+	x_printStreamID(stdout, pSample->streamID);
+	printf(",%s,%u,%u", pSample->bTalker ? "talker" : "listener", pSample->seq, pSample->avtpTimestamp);
+	for (i1 = 0; i1 < OPENAVB_LAT_STAGE_COUNT; i1++) {
+		printf(",%" PRIu64, pSample->stageNS[i1]);
+	}
+	printf("\n");
+}
+
+static void x_printHeader(void)
+{
+	int i1;
+
+	printf("stream_id,role,seq,avtp_timestamp");
+	for (i1 = 0; i1 < OPENAVB_LAT_STAGE_COUNT; i1++) {
+		printf(",%s", x_stageNames[i1]);
+	}
+	printf("\n");
+}
+
+static int x_follow(const char *shmName, int seconds)
+{
+	char name[NAME_MAX];
+	struct stat st;
+
+	snprintf(name, sizeof(name), "%s%s", shmName[0] == '/' ? "" : "/", shmName);
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "Unable to open shared memory %s\n", name);
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	openavb_metrics_shm_t *pShm = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pShm == MAP_FAILED) {
+		fprintf(stderr, "Unable to map shared memory %s\n", name);
+		return -1;
+	}
+	if ((size_t)st.st_size < sizeof(*pShm)
+		|| OPENAVB_ATOMIC_LOAD_ACQUIRE(&pShm->magic) != OPENAVB_METRICS_MAGIC
+		|| pShm->version != OPENAVB_METRICS_VERSION
+		|| pShm->traceLen == 0
+		|| pShm->traceOffset + (size_t)pShm->traceLen * sizeof(openavb_lat_sample_t) > (size_t)st.st_size) {
+		fprintf(stderr, "%s is not a metrics segment with a latency trace\n", name);
+		munmap(pShm, st.st_size);
+		return -1;
+	}
+
+	const openavb_lat_sample_t *pTrace = openavbMetricsTrace(pShm);
+	U64 next = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pShm->traceHead);
+	U64 lost = 0;
+	time_t endTime = seconds ? time(NULL) + seconds : 0;
+
+	x_printHeader();
+	while (bRunning && (!endTime || time(NULL) < endTime)) {
+		U64 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pShm->traceHead);
+		if (head - next > pShm->traceLen) {
+			lost += head - next - pShm->traceLen;
+			next = head - pShm->traceLen;
+		}
+		for (; next < head; next++) {
+			openavb_lat_sample_t sample = pTrace[next % pShm->traceLen];
+			// Discard the copy if the slot was written again meanwhile
+			if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&pShm->traceHead) - next > pShm->traceLen) {
+				lost++;
+				continue;
+			}
+			x_printSample(&sample);
+		}
+		fflush(stdout);
+		usleep(10000);
+	}
+
+	if (lost) {
+		fprintf(stderr, "%" PRIu64 " samples overwritten before they were read\n", lost);
+	}
+	munmap(pShm, st.st_size);
+	return 0;
+}
+
+// Read the rows of a trace CSV, appending to *ppRows
+static bool x_readCsv(const char *fileName, lat_row_t **ppRows, size_t *pCount, size_t *pAlloc)
+{
+	char line[512];
+	FILE *pIn = fopen(fileName, "r");
+	if (!pIn) {
+		fprintf(stderr, "Unable to open %s\n", fileName);
+		return FALSE;
+	}
+
+	while (fgets(line, sizeof(line), pIn)) {
+		lat_row_t row;
+		char role[16];
+		unsigned id[8];
+		int i1;
+
+		memset(&row, 0, sizeof(row));
+		if (sscanf(line, "%2x%2x%2x%2x%2x%2x:%2x%2x,%15[^,],%u,%u,%" SCNu64 ",%" SCNu64 ",%" SCNu64 ",%" SCNu64 ",%" SCNu64 ",%" SCNu64 ",%" SCNu64,
+				&id[0], &id[1], &id[2], &id[3], &id[4], &id[5], &id[6], &id[7], role, &row.seq, &row.avtpTimestamp,
+				&row.stageNS[0], &row.stageNS[1], &row.stageNS[2], &row.stageNS[3],
+				&row.stageNS[4], &row.stageNS[5], &row.stageNS[6]) != 11 + OPENAVB_LAT_STAGE_COUNT) {
+			// Header or malformed line
+			continue;
+		}
+		for (i1 = 0; i1 < 8; i1++) {
+			row.streamID[i1] = id[i1];
+		}
+		row.bTalker = strcmp(role, "talker") == 0;
+
+		if (*pCount == *pAlloc) {
+			size_t alloc = *pAlloc ? *pAlloc * 2 : 4096;
+			lat_row_t *pRows = realloc(*ppRows, alloc * sizeof(lat_row_t));
+			if (!pRows) {
+				fprintf(stderr, "Out of memory\n");
+				fclose(pIn);
+				return FALSE;
+			}
+			*ppRows = pRows;
+			*pAlloc = alloc;
+		}
+		(*ppRows)[(*pCount)++] = row;
+	}
+
+	fclose(pIn);
+	return TRUE;
+}
+
+// Order by stream, AVTP timestamp and sequence number, the join key
+static int x_keyCmp(const lat_row_t *pA, const lat_row_t *pB)
+{
+	int ret = memcmp(pA->streamID, pB->streamID, sizeof(pA->streamID));
+	if (ret)
+		return ret;
+	if (pA->avtpTimestamp != pB->avtpTimestamp)
+		return pA->avtpTimestamp < pB->avtpTimestamp ? -1 : 1;
+	if (pA->seq != pB->seq)
+		return pA->seq < pB->seq ? -1 : 1;
+	return 0;
+}
+
+static int x_rowCmp(const void *pvA, const void *pvB)
+{
+	return x_keyCmp(pvA, pvB);
+}
+
+static int x_join(int nFiles, char **fileNames)
+{
+	lat_row_t *pRows = NULL;
+	size_t nRows = 0, nAlloc = 0, nTalker = 0, nJoined = 0;
+	S64 min[LAT_DELTA_COUNT], max[LAT_DELTA_COUNT];
+	double sum[LAT_DELTA_COUNT];
+	U64 cnt[LAT_DELTA_COUNT];
+	size_t i1, i2;
+	int i3;
+
+	for (i3 = 0; i3 < nFiles; i3++) {
+		if (!x_readCsv(fileNames[i3], &pRows, &nRows, &nAlloc)) {
+			free(pRows);
+			return -1;
+		}
+	}
+
+	// Talker rows first, each half in key order
+	for (i1 = 0; i1 < nRows; i1++) {
+		if (pRows[i1].bTalker) {
+			lat_row_t tmp = pRows[nTalker];
+			pRows[nTalker++] = pRows[i1];
+			pRows[i1] = tmp;
+		}
+	}
+	lat_row_t *pTalker = pRows, *pListener = pRows + nTalker;
+	size_t nListener = nRows - nTalker;
+	qsort(pTalker, nTalker, sizeof(lat_row_t), x_rowCmp);
+	qsort(pListener, nListener, sizeof(lat_row_t), x_rowCmp);
+
+	memset(cnt, 0, sizeof(cnt));
+	memset(sum, 0, sizeof(sum));
+	printf("stream_id,seq,avtp_timestamp");
+	for (i2 = 0; i2 < LAT_DELTA_COUNT; i2++) {
+		printf(",%s", x_deltas[i2].name);
+	}
+	printf("\n");
+
+	// Merge; for a key that repeats (the AVTP timestamp wraps every 4.3
+	// seconds) take the talker sample sent closest to the listener's receive
+	size_t iTalker = 0;
+	for (i1 = 0; i1 < nListener; i1++) {
+		lat_row_t *pRx = &pListener[i1];
+		while (iTalker < nTalker && x_keyCmp(&pTalker[iTalker], pRx) < 0)
+			iTalker++;
+
+		lat_row_t *pTx = NULL;
+		U64 bestDiff = UINT64_MAX;
+		for (i2 = iTalker; i2 < nTalker && x_keyCmp(&pTalker[i2], pRx) == 0; i2++) {
+			S64 diff = (S64)(pRx->stageNS[OPENAVB_LAT_RX_RAWSOCK] - pTalker[i2].stageNS[OPENAVB_LAT_TX_SUBMIT]);
+			U64 absDiff = diff < 0 ? -diff : diff;
+			if (absDiff < bestDiff) {
+				bestDiff = absDiff;
+				pTx = &pTalker[i2];
+			}
+		}
+		if (!pTx)
+			continue;
+		nJoined++;
+
+		x_printStreamID(stdout, pRx->streamID);
+		printf(",%u,%u", pRx->seq, pRx->avtpTimestamp);
+		for (i2 = 0; i2 < LAT_DELTA_COUNT; i2++) {
+			const lat_delta_t *pDelta = &x_deltas[i2];
+			const lat_row_t *pFrom = pDelta->bFromTalker ? pTx : pRx;
+			const lat_row_t *pTo = pDelta->to < OPENAVB_LAT_RX_RAWSOCK ? pTx : pRx;
+			U64 fromNS = pFrom->stageNS[pDelta->from];
+			U64 toNS = pTo->stageNS[pDelta->to];
+			if (!fromNS && pDelta->fromAlt >= 0)
+				fromNS = pFrom->stageNS[pDelta->fromAlt];
+			if (!fromNS || !toNS) {
+				printf(",");
+				continue;
+			}
+			S64 delta = (S64)(toNS - fromNS);
+			printf(",%" PRId64, delta);
+			if (!cnt[i2] || delta < min[i2])
+				min[i2] = delta;
+			if (!cnt[i2] || delta > max[i2])
+				max[i2] = delta;
+			sum[i2] += delta;
+			cnt[i2]++;
+		}
+		printf("\n");
+	}
+
+	fprintf(stderr, "%zu talker and %zu listener samples, %zu joined\n", nTalker, nListener, nJoined);
+	fprintf(stderr, "%-20s %10s %12s %12s %12s\n", "stage (ns)", "count", "min", "mean", "max");
+	for (i2 = 0; i2 < LAT_DELTA_COUNT; i2++) {
+		if (cnt[i2]) {
+			fprintf(stderr, "%-20s %10" PRIu64 " %12" PRId64 " %12.0f %12" PRId64 "\n",
+				x_deltas[i2].name, cnt[i2], min[i2], sum[i2] / cnt[i2], max[i2]);
+		}
+	}
+
+	free(pRows);
+	return 0;
+}
+
+/**********************************************
+ * main
+ */
+int main(int argc, char *argv[])
+{
+	char *programName;
+	char *shmName = NULL;
+	bool bJoin = FALSE;
+	int seconds = 0;
+
+	// Setup signal handler. Catch SIGINT and stop following cleanly
+	struct sigaction sa;
+	sa.sa_handler = openavbLatTraceSigHandler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0; // not SA_RESTART
+	sigaction(SIGINT, &sa, NULL);
+
+	programName = strrchr(argv[0], '/');
+	programName = programName ? programName + 1 : argv[0];
+
+	bool optDone = FALSE;
+	while (!optDone) {
+		int opt = getopt(argc, argv, "M:d:jh");
+		if (opt != EOF) {
+			switch (opt) {
+				case 'M':
+					shmName = optarg;
+					break;
+				case 'd':
+					seconds = atoi(optarg);
+					break;
+				case 'j':
+					bJoin = TRUE;
+					break;
+				case 'h':
+				case '?':
+				default:
+					openavbLatTraceUsage(programName);
+					exit(-1);
+			}
+		}
+		else {
+			optDone = TRUE;
+		}
+	}
+
+	if (bJoin && !shmName && optind < argc) {
+		return x_join(argc - optind, &argv[optind]) == 0 ? 0 : -1;
+	}
+	if (shmName && !bJoin && optind == argc) {
+		return x_follow(shmName, seconds) == 0 ? 0 : -1;
+	}
+
+	openavbLatTraceUsage(programName);
+	exit(-1);
+}
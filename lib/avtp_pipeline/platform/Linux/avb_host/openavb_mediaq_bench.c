@@ -0,0 +1,568 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Media queue microbenchmark and contention stress test.
+*
+* Moves items through 1..N media queues as fast as possible and reports
+* throughput together with the cost of HeadLock, HeadPush, TailLock and
+* TailPull and the time items spend queued. Runs are swept over queue
+* counts, item sizes and depths for each synchronization mode:
+*
+*   single        one thread fills and drains each queue, no locking
+*   single-mutex  as single, with openavbMediaQThreadSafeOn()
+*   mutex         a producer and a consumer thread per queue, with
+*                 openavbMediaQThreadSafeOn() (one mutex for all queues)
+*   lockfree      a producer and a consumer thread per queue, with
+*                 openavbMediaQLockFreeOn()
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "openavb_platform_pub.h"
+#include "openavb_osal_pub.h"
+#include "openavb_trace_pub.h"
+#include "openavb_mediaq_pub.h"
+#include "openavb_histogram_pub.h"
+#include <inttypes.h>
+
+#define	AVB_LOG_COMPONENT	"MediaQ Bench"
+#include "openavb_log_pub.h"
+
+// Longest list accepted for -m, -z and -n
+#define MQB_MAX_LIST				16
+
+// Time one operation in this many; timing every call would hide the queue cost
+#define MQB_SAMPLE_INTERVAL			16
+
+// Smallest item; a timestamp is carried in the first bytes
+#define MQB_MIN_ITEM_SIZE			((int)sizeof(U64))
+
+typedef enum {
+	MQB_MODE_SINGLE = 0,
+	MQB_MODE_SINGLE_MUTEX,
+	MQB_MODE_MUTEX,
+	MQB_MODE_LOCKFREE,
+	MQB_MODE_COUNT
+} mqb_mode_t;
+
+static const char *mqbModeNames[MQB_MODE_COUNT] = {
+	"single", "single-mutex", "mutex", "lockfree"
+};
+
+typedef enum {
+	MQB_OP_HEAD_LOCK = 0,
+	MQB_OP_HEAD_PUSH,
+	MQB_OP_TAIL_LOCK,
+	MQB_OP_TAIL_PULL,
+	MQB_OP_QUEUED,		// push to pull of the same item
+	MQB_OP_COUNT
+} mqb_op_t;
+
+static const char *mqbOpNames[MQB_OP_COUNT] = {
+	"hlock", "hpush", "tlock", "tpull", "queued"
+};
+
+// Statistics kept by one thread
+typedef struct {
+	U64 pushed;
+	U64 pulled;
+	U64 fullSpins;
+	U64 emptySpins;
+	U64 sink;
+	openavb_hist_t hist[MQB_OP_COUNT];
+} mqb_stats_t;
+
+typedef struct mqb_queue {
+	media_q_t *pMediaQ;
+	mqb_mode_t mode;
+	int cpu;
+
+	pthread_t producer;
+	pthread_t consumer;
+	bool bProducerDone;
+
+	mqb_stats_t producerStats;
+	mqb_stats_t consumerStats;
+} mqb_queue_t;
+
+static volatile bool bRunning = TRUE;
+
+static inline U64 x_mqbNowNS(void)
+{
+	U64 nowNS = 0;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_MONOTONIC, &nowNS);
+	return nowNS;
+}
+
+// Pin the calling thread to a CPU; a negative cpu leaves it alone
+static void x_mqbPin(int cpu)
+{
+	if (cpu >= 0) {
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpu % CPU_SETSIZE, &cpuset);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+	}
+}
+
+// Fill the item at the head of the queue. Returns FALSE if the queue is full.
+static bool x_mqbPush(media_q_t *pMediaQ, mqb_stats_t *pStats)
+{
+	bool bSample = (pStats->pushed % MQB_SAMPLE_INTERVAL) == 0;
+	U64 t0 = bSample ? x_mqbNowNS() : 0;
+
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem) {
+		pStats->fullSpins++;
+		return FALSE;
+	}
+
+	U64 t1 = bSample ? x_mqbNowNS() : 0;
+
+	memset(pMediaQItem->pPubData, (U8)pStats->pushed, pMediaQItem->itemSize);
+	pMediaQItem->dataLen = pMediaQItem->itemSize;
+
+	U64 t2 = 0;
+	if (bSample) {
+		t2 = x_mqbNowNS();
+		*(U64 *)pMediaQItem->pPubData = t2;
+	}
+	else {
+		*(U64 *)pMediaQItem->pPubData = 0;
+	}
+
+	openavbMediaQHeadPush(pMediaQ);
+
+	if (bSample) {
+		U64 t3 = x_mqbNowNS();
+		openavbHistRecordDelta(&pStats->hist[MQB_OP_HEAD_LOCK], (S64)(t1 - t0));
+		openavbHistRecordDelta(&pStats->hist[MQB_OP_HEAD_PUSH], (S64)(t3 - t2));
+	}
+	pStats->pushed++;
+	return TRUE;
+}
+
+// Read and release the item at the tail of the queue. Returns FALSE if the queue is empty.
+static bool x_mqbPull(media_q_t *pMediaQ, mqb_stats_t *pStats)
+{
+	bool bSample = (pStats->pulled % MQB_SAMPLE_INTERVAL) == 0;
+	U64 t0 = bSample ? x_mqbNowNS() : 0;
+
+	media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+	if (!pMediaQItem) {
+		pStats->emptySpins++;
+		return FALSE;
+	}
+
+	U64 t1 = bSample ? x_mqbNowNS() : 0;
+
+	U64 pushNS = *(U64 *)pMediaQItem->pPubData;
+	if (pushNS) {
+		openavbHistRecordDelta(&pStats->hist[MQB_OP_QUEUED], (S64)(x_mqbNowNS() - pushNS));
+	}
+
+	// Touch all the data, as an interface module would
+	U64 sum = 0;
+	const U64 *pWord = (const U64 *)pMediaQItem->pPubData;
+	U32 nWords = pMediaQItem->dataLen / sizeof(U64);
+	U32 i1;
+	for (i1 = 0; i1 < nWords; i1++)
+		sum += pWord[i1];
+	pStats->sink += sum;
+
+	U64 t2 = bSample ? x_mqbNowNS() : 0;
+
+	openavbMediaQTailPull(pMediaQ);
+
+	if (bSample) {
+		U64 t3 = x_mqbNowNS();
+		openavbHistRecordDelta(&pStats->hist[MQB_OP_TAIL_LOCK], (S64)(t1 - t0));
+		openavbHistRecordDelta(&pStats->hist[MQB_OP_TAIL_PULL], (S64)(t3 - t2));
+	}
+	pStats->pulled++;
+	return TRUE;
+}
+
+// One thread fills the queue, then drains it
+static void *openavbMqbSingleThread(void *pv)
+{
+	mqb_queue_t *pQueue = (mqb_queue_t *)pv;
+	mqb_stats_t *pStats = &pQueue->producerStats;
+
+	x_mqbPin(pQueue->cpu);
+
+	while (bRunning) {
+		while (x_mqbPush(pQueue->pMediaQ, pStats));
+		while (x_mqbPull(pQueue->pMediaQ, pStats));
+	}
+
+	return NULL;
+}
+
+static void *openavbMqbProducerThread(void *pv)
+{
+	mqb_queue_t *pQueue = (mqb_queue_t *)pv;
+
+	x_mqbPin(pQueue->cpu);
+
+	while (bRunning) {
+		// Let the consumer run if it shares our CPU
+		if (!x_mqbPush(pQueue->pMediaQ, &pQueue->producerStats))
+			sched_yield();
+	}
+
+	// Publishes the final push count to the consumer
+	OPENAVB_ATOMIC_STORE_RELEASE(&pQueue->bProducerDone, TRUE);
+	return NULL;
+}
+
+static void *openavbMqbConsumerThread(void *pv)
+{
+	mqb_queue_t *pQueue = (mqb_queue_t *)pv;
+
+	x_mqbPin(pQueue->cpu >= 0 ? pQueue->cpu + 1 : -1);
+
+	// Keep going until everything the producer pushed is consumed
+	while (1) {
+		if (!x_mqbPull(pQueue->pMediaQ, &pQueue->consumerStats)) {
+			if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&pQueue->bProducerDone)
+				&& pQueue->consumerStats.pulled == pQueue->producerStats.pushed) {
+				break;
+			}
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void openavbMqbHistMerge(openavb_hist_t *pDst, const openavb_hist_t *pSrc)
+{
+	int i1;
+	for (i1 = 0; i1 < OPENAVB_HIST_BUCKETS; i1++)
+		pDst->bucket[i1] += pSrc->bucket[i1];
+	pDst->count += pSrc->count;
+	pDst->sum += pSrc->sum;
+	if (pSrc->max > pDst->max)
+		pDst->max = pSrc->max;
+}
+
+static void openavbMqbStatsMerge(mqb_stats_t *pDst, const mqb_stats_t *pSrc)
+{
+	int i1;
+	pDst->pushed += pSrc->pushed;
+	pDst->pulled += pSrc->pulled;
+	pDst->fullSpins += pSrc->fullSpins;
+	pDst->emptySpins += pSrc->emptySpins;
+	for (i1 = 0; i1 < MQB_OP_COUNT; i1++)
+		openavbMqbHistMerge(&pDst->hist[i1], &pSrc->hist[i1]);
+}
+
+static void openavbMqbPrintHeader(void)
+{
+	int i1;
+	printf("%-12s %6s %6s %6s %10s %8s", "mode", "queues", "size", "depth", "Mitems/s", "ns/item");
+	for (i1 = 0; i1 < MQB_OP_COUNT; i1++)
+		printf(" %15s", mqbOpNames[i1]);
+	printf(" %10s %10s\n", "full", "empty");
+
+	printf("%-12s %6s %6s %6s %10s %8s", "", "", "", "", "", "");
+	for (i1 = 0; i1 < MQB_OP_COUNT; i1++)
+		printf(" %15s", "p50/p99 ns");
+	printf(" %10s %10s\n", "spins", "spins");
+}
+
+// Run one combination and print its results. Returns FALSE if it couldn't be set up.
+static bool openavbMqbRun(mqb_mode_t mode, int queueCount, int itemSize, int depth, U32 runMsec, bool bPin)
+{
+	mqb_queue_t *pQueues = calloc(queueCount, sizeof(mqb_queue_t));
+	mqb_stats_t *pTotal = calloc(1, sizeof(mqb_stats_t));
+	bool bThreaded = (mode == MQB_MODE_MUTEX || mode == MQB_MODE_LOCKFREE);
+	bool bOk = TRUE;
+	int nStarted = 0;
+	int i1;
+
+	if (!pQueues || !pTotal) {
+		AVB_LOG_ERROR("Unable to allocate queues");
+		free(pQueues);
+		free(pTotal);
+		return FALSE;
+	}
+
+	for (i1 = 0; i1 < queueCount; i1++) {
+		mqb_queue_t *pQueue = &pQueues[i1];
+		pQueue->mode = mode;
+		pQueue->cpu = bPin ? (bThreaded ? i1 * 2 : i1) : -1;
+
+		pQueue->pMediaQ = openavbMediaQCreate();
+		if (!pQueue->pMediaQ) {
+			AVB_LOG_ERROR("Unable to create media queue");
+			bOk = FALSE;
+			break;
+		}
+		if (mode == MQB_MODE_SINGLE_MUTEX || mode == MQB_MODE_MUTEX) {
+			openavbMediaQThreadSafeOn(pQueue->pMediaQ);
+		}
+		else if (mode == MQB_MODE_LOCKFREE) {
+			openavbMediaQLockFreeOn(pQueue->pMediaQ);
+		}
+		if (!openavbMediaQSetSize(pQueue->pMediaQ, depth, itemSize)) {
+			AVB_LOG_ERROR("Unable to size media queue");
+			bOk = FALSE;
+			break;
+		}
+	}
+
+	U64 startNS = x_mqbNowNS();
+	bRunning = TRUE;
+
+	for (i1 = 0; bOk && i1 < queueCount; i1++) {
+		mqb_queue_t *pQueue = &pQueues[i1];
+		if (bThreaded) {
+			if (pthread_create(&pQueue->consumer, NULL, openavbMqbConsumerThread, pQueue) != 0) {
+				AVB_LOG_ERROR("Unable to start consumer thread");
+				bOk = FALSE;
+				break;
+			}
+			if (pthread_create(&pQueue->producer, NULL, openavbMqbProducerThread, pQueue) != 0) {
+				AVB_LOG_ERROR("Unable to start producer thread");
+				OPENAVB_ATOMIC_STORE_RELEASE(&pQueue->bProducerDone, TRUE);
+				pthread_join(pQueue->consumer, NULL);
+				bOk = FALSE;
+				break;
+			}
+		}
+		else {
+			if (pthread_create(&pQueue->producer, NULL, openavbMqbSingleThread, pQueue) != 0) {
+				AVB_LOG_ERROR("Unable to start queue thread");
+				bOk = FALSE;
+				break;
+			}
+		}
+		nStarted++;
+	}
+
+	if (bOk) {
+		usleep(runMsec * 1000);
+	}
+	bRunning = FALSE;
+
+	for (i1 = 0; i1 < nStarted; i1++) {
+		pthread_join(pQueues[i1].producer, NULL);
+		if (bThreaded)
+			pthread_join(pQueues[i1].consumer, NULL);
+	}
+	U64 elapsedNS = x_mqbNowNS() - startNS;
+
+	if (bOk) {
+		for (i1 = 0; i1 < queueCount; i1++) {
+			openavbMqbStatsMerge(pTotal, &pQueues[i1].producerStats);
+			openavbMqbStatsMerge(pTotal, &pQueues[i1].consumerStats);
+		}
+
+		double seconds = (double)elapsedNS / NANOSECONDS_PER_SECOND;
+		double itemsPerSec = seconds > 0 ? pTotal->pulled / seconds : 0;
+		printf("%-12s %6d %6d %6d %10.2f %8.1f",
+			mqbModeNames[mode], queueCount, itemSize, depth,
+			itemsPerSec / 1000000.0,
+			itemsPerSec > 0 ? (queueCount * (double)NANOSECONDS_PER_SECOND) / itemsPerSec : 0);
+		for (i1 = 0; i1 < MQB_OP_COUNT; i1++) {
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%u/%u",
+				openavbHistPercentile(&pTotal->hist[i1], 50.0),
+				openavbHistPercentile(&pTotal->hist[i1], 99.0));
+			printf(" %15s", buf);
+		}
+		printf(" %10" PRIu64 " %10" PRIu64 "\n", pTotal->fullSpins, pTotal->emptySpins);
+	}
+
+	for (i1 = 0; i1 < queueCount; i1++) {
+		if (pQueues[i1].pMediaQ)
+			openavbMediaQDelete(pQueues[i1].pMediaQ);
+	}
+	free(pQueues);
+	free(pTotal);
+
+	return bOk;
+}
+
+// Parse a comma separated list of numbers. Returns the count, 0 on error.
+static int x_mqbParseList(const char *str, int *pList, int max)
+{
+	int count = 0;
+	const char *p = str;
+	while (*p && count < max) {
+		char *pEnd;
+		long val = strtol(p, &pEnd, 0);
+		if (pEnd == p || val < 1)
+			return 0;
+		pList[count++] = (int)val;
+		p = (*pEnd == ',') ? pEnd + 1 : pEnd;
+		if (*pEnd && *pEnd != ',')
+			return 0;
+	}
+	return count;
+}
+
+void openavbMqbUsage(char *programName)
+{
+	printf(
+		"\n"
+		"Usage: %s [options]\n"
+		"  -m list    Modes to run: single, single-mutex, mutex, lockfree. Defaults to all.\n"
+		"  -q val     Run with 1, 2, 4, ... up to 'val' concurrent queues. Defaults to 4.\n"
+		"  -z list    Item sizes in bytes (at least %d). Defaults to 64,1024.\n"
+		"  -n list    Queue depths (items). Defaults to 8,64.\n"
+		"  -d val     Milliseconds to run each combination. Defaults to 1000.\n"
+		"  -a         Pin threads: queue N uses CPU N (single modes) or CPUs 2N and 2N+1.\n"
+		"  -h         Prints this message.\n"
+		"\n"
+		"Lists are comma separated. Operation times are sampled on one item in %d.\n"
+		"\n"
+		"Examples:\n"
+		"  %s -m mutex,lockfree -q 8 -z 192 -n 16\n"
+		"    Compare the mutex and lock-free queues with 1 to 8 producer/consumer pairs.\n\n"
+		,
+		programName, MQB_MIN_ITEM_SIZE, MQB_SAMPLE_INTERVAL, programName);
+}
+
+/**********************************************
+ * main
+ */
+int main(int argc, char *argv[])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HOST);
+
+	char *programName;
+	bool bModes[MQB_MODE_COUNT] = { TRUE, TRUE, TRUE, TRUE };
+	int maxQueues = 4;
+	int sizes[MQB_MAX_LIST] = { 64, 1024 };
+	int sizeCount = 2;
+	int depths[MQB_MAX_LIST] = { 8, 64 };
+	int depthCount = 2;
+	U32 runMsec = 1000;
+	bool bPin = FALSE;
+	int ret = 0;
+	int i1, i2, i3, i4;
+
+	// Process command line
+	programName = strrchr(argv[0], '/');
+	programName = programName ? programName + 1 : argv[0];
+
+	bool optDone = FALSE;
+	while (!optDone) {
+		int opt = getopt(argc, argv, "m:q:z:n:d:ah");
+		if (opt != EOF) {
+			switch (opt) {
+				case 'm':
+				{
+					memset(bModes, 0, sizeof(bModes));
+					char *pModes = strdup(optarg);
+					char *pSave = NULL;
+					char *pMode;
+					for (pMode = strtok_r(pModes, ",", &pSave); pMode; pMode = strtok_r(NULL, ",", &pSave)) {
+						for (i1 = 0; i1 < MQB_MODE_COUNT; i1++) {
+							if (strcmp(pMode, mqbModeNames[i1]) == 0)
+								break;
+						}
+						if (i1 == MQB_MODE_COUNT) {
+							printf("Unknown mode: %s\n", pMode);
+							openavbMqbUsage(programName);
+							exit(-1);
+						}
+						bModes[i1] = TRUE;
+					}
+					free(pModes);
+					break;
+				}
+				case 'q':
+					maxQueues = atoi(optarg);
+					break;
+				case 'z':
+					sizeCount = x_mqbParseList(optarg, sizes, MQB_MAX_LIST);
+					break;
+				case 'n':
+					depthCount = x_mqbParseList(optarg, depths, MQB_MAX_LIST);
+					break;
+				case 'd':
+					runMsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'a':
+					bPin = TRUE;
+					break;
+				case 'h':
+				case '?':
+				default:
+					openavbMqbUsage(programName);
+					exit(-1);
+			}
+		}
+		else {
+			optDone = TRUE;
+		}
+	}
+
+	if (maxQueues < 1 || sizeCount == 0 || depthCount == 0 || runMsec == 0) {
+		openavbMqbUsage(programName);
+		exit(-1);
+	}
+	for (i1 = 0; i1 < sizeCount; i1++) {
+		if (sizes[i1] < MQB_MIN_ITEM_SIZE) {
+			printf("Item size %d too small\n", sizes[i1]);
+			exit(-1);
+		}
+	}
+
+	avbLogInit();
+
+	openavbMqbPrintHeader();
+	for (i1 = 0; i1 < MQB_MODE_COUNT; i1++) {
+		if (!bModes[i1])
+			continue;
+		for (i2 = 1; i2 <= maxQueues; i2 = (i2 * 2 > maxQueues && i2 < maxQueues) ? maxQueues : i2 * 2) {
+			for (i3 = 0; i3 < sizeCount; i3++) {
+				for (i4 = 0; i4 < depthCount; i4++) {
+					if (!openavbMqbRun((mqb_mode_t)i1, i2, sizes[i3], depths[i4], runMsec, bPin))
+						ret = -1;
+				}
+			}
+		}
+	}
+
+	avbLogExit();
+
+	AVB_TRACE_EXIT(AVB_TRACE_HOST);
+	exit(ret);
+}
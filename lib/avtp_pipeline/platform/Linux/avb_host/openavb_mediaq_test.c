@@ -0,0 +1,300 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Media queue checks.
+*
+* Runs the media queue through item sequences that have broken its
+* bookkeeping before and checks the counts and items it hands back.
+* Exits non-zero if any check fails.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "openavb_platform_pub.h"
+#include "openavb_osal_pub.h"
+#include "openavb_trace_pub.h"
+#include "openavb_mediaq_pub.h"
+#include "openavb_avtp_time_pub.h"
+
+#define	AVB_LOG_COMPONENT	"MediaQ Test"
+#include "openavb_log_pub.h"
+
+#define MQT_ITEM_SIZE		64
+
+#define MQT_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __func__, __LINE__, #cond); \
+			bOk = FALSE; \
+			goto done; \
+		} \
+	} while (0)
+
+// Fill the item at the head of the queue with id. Returns FALSE if the queue is full.
+static bool x_mqtPush(media_q_t *pMediaQ, U8 id)
+{
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem) {
+		return FALSE;
+	}
+	memset(pMediaQItem->pPubData, id, pMediaQItem->itemSize);
+	pMediaQItem->dataLen = pMediaQItem->itemSize;
+	openavbMediaQHeadPush(pMediaQ);
+	return TRUE;
+}
+
+// As x_mqtPush() with the item due offsetUsec from now.
+static bool x_mqtPushAt(media_q_t *pMediaQ, U8 id, long offsetUsec)
+{
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem) {
+		return FALSE;
+	}
+	memset(pMediaQItem->pPubData, id, pMediaQItem->itemSize);
+	pMediaQItem->dataLen = pMediaQItem->itemSize;
+	openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+	openavbAvtpTimeAddUSec(pMediaQItem->pAvtpTime, offsetUsec);
+	openavbAvtpTimeSetTimestampValid(pMediaQItem->pAvtpTime, TRUE);
+	openavbMediaQHeadPush(pMediaQ);
+	return TRUE;
+}
+
+// Pull the tail item without checking its time. Returns FALSE if the queue is empty.
+static bool x_mqtPull(media_q_t *pMediaQ)
+{
+	if (!openavbMediaQTailLock(pMediaQ, TRUE)) {
+		return FALSE;
+	}
+	return openavbMediaQTailPull(pMediaQ);
+}
+
+// A full queue with its tail item taken and given back has one queued item
+// and one free slot.
+static bool openavbMqtFullTakeGive(void)
+{
+	bool bOk = TRUE;
+	media_q_item_t *pMediaQItem;
+
+	media_q_t *pMediaQ = openavbMediaQCreate();
+	MQT_CHECK(pMediaQ);
+	MQT_CHECK(openavbMediaQSetSize(pMediaQ, 2, MQT_ITEM_SIZE));
+
+	MQT_CHECK(x_mqtPush(pMediaQ, 0));
+	MQT_CHECK(x_mqtPush(pMediaQ, 1));
+	MQT_CHECK(openavbMediaQHeadLock(pMediaQ) == NULL);
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 2);
+
+	pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+	MQT_CHECK(pMediaQItem);
+	MQT_CHECK(((U8 *)pMediaQItem->pPubData)[0] == 0);
+	MQT_CHECK(openavbMediaQTailItemTake(pMediaQ, pMediaQItem));
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 1);
+
+	MQT_CHECK(openavbMediaQTailItemGive(pMediaQ, pMediaQItem));
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 1);
+
+	// The given slot is free again and nothing was queued in it
+	MQT_CHECK(x_mqtPush(pMediaQ, 2));
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 2);
+
+	pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+	MQT_CHECK(pMediaQItem);
+	MQT_CHECK(pMediaQItem->dataLen == MQT_ITEM_SIZE);
+	MQT_CHECK(((U8 *)pMediaQItem->pPubData)[0] == 1);
+	MQT_CHECK(openavbMediaQTailPull(pMediaQ));
+
+	pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+	MQT_CHECK(pMediaQItem);
+	MQT_CHECK(pMediaQItem->dataLen == MQT_ITEM_SIZE);
+	MQT_CHECK(((U8 *)pMediaQItem->pPubData)[0] == 2);
+	MQT_CHECK(openavbMediaQTailPull(pMediaQ));
+
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 0);
+	MQT_CHECK(openavbMediaQTailLock(pMediaQ, TRUE) == NULL);
+
+done:
+	if (pMediaQ) {
+		openavbMediaQDelete(pMediaQ);
+	}
+	return bOk;
+}
+
+// The lock-free ready boundary follows pulls made without a ready count, so
+// an item not yet due is never counted as ready.
+static bool openavbMqtLockFreeReady(void)
+{
+	bool bOk = TRUE;
+
+	media_q_t *pMediaQ = openavbMediaQCreate();
+	MQT_CHECK(pMediaQ);
+	openavbMediaQLockFreeOn(pMediaQ);
+	openavbMediaQSetMaxLatency(pMediaQ, 2 * MICROSECONDS_PER_SECOND);
+	MQT_CHECK(openavbMediaQSetSize(pMediaQ, 1, MQT_ITEM_SIZE));
+
+	MQT_CHECK(x_mqtPushAt(pMediaQ, 0, 0));
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, FALSE) == 1);
+	MQT_CHECK(x_mqtPull(pMediaQ));
+
+	MQT_CHECK(x_mqtPushAt(pMediaQ, 1, 0));
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, FALSE) == 1);
+	MQT_CHECK(x_mqtPull(pMediaQ));
+
+	MQT_CHECK(x_mqtPushAt(pMediaQ, 2, 0));
+	MQT_CHECK(x_mqtPull(pMediaQ));
+
+	MQT_CHECK(x_mqtPushAt(pMediaQ, 3, MICROSECONDS_PER_SECOND));
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 1);
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, FALSE) == 0);
+
+done:
+	if (pMediaQ) {
+		openavbMediaQDelete(pMediaQ);
+	}
+	return bOk;
+}
+
+// The lock-free tail lock purges stale items just as the locked one does.
+static bool openavbMqtLockFreeStale(void)
+{
+	bool bOk = TRUE;
+	media_q_item_t *pMediaQItem;
+
+	media_q_t *pMediaQ = openavbMediaQCreate();
+	MQT_CHECK(pMediaQ);
+	openavbMediaQLockFreeOn(pMediaQ);
+	openavbMediaQSetMaxLatency(pMediaQ, 2 * MICROSECONDS_PER_SECOND);
+	openavbMediaQSetMaxStaleTail(pMediaQ, 1000);
+	MQT_CHECK(openavbMediaQSetSize(pMediaQ, 4, MQT_ITEM_SIZE));
+
+	MQT_CHECK(x_mqtPushAt(pMediaQ, 0, -MICROSECONDS_PER_SECOND));
+	MQT_CHECK(x_mqtPushAt(pMediaQ, 1, -MICROSECONDS_PER_SECOND));
+	MQT_CHECK(x_mqtPushAt(pMediaQ, 2, MICROSECONDS_PER_SECOND));
+	MQT_CHECK(openavbMediaQPurgedItems(pMediaQ) == 0);
+
+	// Only the item not yet due is left
+	MQT_CHECK(openavbMediaQTailLock(pMediaQ, FALSE) == NULL);
+	MQT_CHECK(openavbMediaQPurgedItems(pMediaQ) == 2);
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 1);
+
+	pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+	MQT_CHECK(pMediaQItem);
+	MQT_CHECK(((U8 *)pMediaQItem->pPubData)[0] == 2);
+	MQT_CHECK(openavbMediaQTailPull(pMediaQ));
+
+done:
+	if (pMediaQ) {
+		openavbMediaQDelete(pMediaQ);
+	}
+	return bOk;
+}
+
+static void x_mqtRelease(void *pReleaseArg)
+{
+	(*(int *)pReleaseArg)++;
+}
+
+// Attached items take no byte ring room, so they can still be queued while
+// the ring is full.
+static bool openavbMqtRingAttach(void)
+{
+	bool bOk = TRUE;
+	media_q_item_t *pMediaQItem;
+	U8 data[MQT_ITEM_SIZE];
+	int released = 0;
+
+	media_q_t *pMediaQ = openavbMediaQCreate();
+	MQT_CHECK(pMediaQ);
+	openavbMediaQRingOn(pMediaQ, 2 * MQT_ITEM_SIZE);
+	MQT_CHECK(openavbMediaQSetSize(pMediaQ, 4, MQT_ITEM_SIZE));
+
+	MQT_CHECK(x_mqtPush(pMediaQ, 0));
+	MQT_CHECK(x_mqtPush(pMediaQ, 1));
+	MQT_CHECK(openavbMediaQHeadLock(pMediaQ) == NULL);
+
+	memset(data, 2, sizeof(data));
+	pMediaQItem = openavbMediaQHeadLockAttach(pMediaQ);
+	MQT_CHECK(pMediaQItem);
+	MQT_CHECK(openavbMediaQHeadAttach(pMediaQ, data, sizeof(data), x_mqtRelease, &released));
+	MQT_CHECK(openavbMediaQHeadPush(pMediaQ));
+	MQT_CHECK(openavbMediaQCountItems(pMediaQ, TRUE) == 3);
+
+	// Pulling the written items frees the ring for written items again
+	MQT_CHECK(x_mqtPull(pMediaQ));
+	MQT_CHECK(x_mqtPull(pMediaQ));
+	MQT_CHECK(x_mqtPush(pMediaQ, 3));
+
+	pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+	MQT_CHECK(pMediaQItem);
+	MQT_CHECK(pMediaQItem->pPubData == data);
+	MQT_CHECK(openavbMediaQTailPull(pMediaQ));
+	MQT_CHECK(released == 1);
+
+	pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+	MQT_CHECK(pMediaQItem);
+	MQT_CHECK(((U8 *)pMediaQItem->pPubData)[0] == 3);
+	MQT_CHECK(openavbMediaQTailPull(pMediaQ));
+
+done:
+	if (pMediaQ) {
+		openavbMediaQDelete(pMediaQ);
+	}
+	return bOk;
+}
+
+int main(int argc, char *argv[])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HOST);
+
+	int ret = 0;
+
+	avbLogInit();
+
+	if (!openavbMqtFullTakeGive()) {
+		ret = -1;
+	}
+	if (!openavbMqtLockFreeReady()) {
+		ret = -1;
+	}
+	if (!openavbMqtLockFreeStale()) {
+		ret = -1;
+	}
+	if (!openavbMqtRingAttach()) {
+		ret = -1;
+	}
+
+	printf("%s\n", ret == 0 ? "PASSED" : "FAILED");
+
+	avbLogExit();
+
+	AVB_TRACE_EXIT(AVB_TRACE_HOST);
+	exit(ret);
+}
@@ -0,0 +1,539 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Stream metrics exporter for the talker listener hosts.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <inttypes.h>
+#include "openavb_metrics.h"
+#include "openavb_osal_pub.h"
+#include "openavb_trace_pub.h"
+
+#define	AVB_LOG_COMPONENT	"TL Metrics"
+#include "openavb_log_pub.h"
+
+// How often the streams are read
+#define METRICS_PERIOD_MSEC		1000
+// How often the latency trace rings are drained; they hold
+// OPENAVB_LAT_TRACE_RING_LEN samples each
+#define METRICS_TRACE_PERIOD_MSEC	20
+
+#define METRICS_TX		(1 << AVB_ROLE_TALKER)
+#define METRICS_RX		(1 << AVB_ROLE_LISTENER)
+
+typedef struct {
+	const char *name;
+	const char *help;
+	U32 roles;
+} metrics_info_t;
+
+// Indexed by tl_stat_t
+static const metrics_info_t x_statInfo[] = {
+	{ "openavb_tx_calls_total", "Talker wake-ups", METRICS_TX },
+	{ "openavb_tx_frames_total", "Frames sent", METRICS_TX },
+	{ "openavb_tx_late_total", "Missed talker wake-ups", METRICS_TX },
+	{ "openavb_tx_bytes_total", "Bytes sent", METRICS_TX },
+	{ "openavb_rx_calls_total", "Listener receive calls", METRICS_RX },
+	{ "openavb_rx_frames_total", "Frames received", METRICS_RX },
+	{ "openavb_rx_lost_total", "Frames lost", METRICS_RX },
+	{ "openavb_rx_bytes_total", "Bytes received", METRICS_RX },
+	{ "openavb_mq_purged_total", "Stale media queue items purged", METRICS_TX | METRICS_RX },
+	{ "openavb_mq_reordered_total", "Media queue items put in presentation order", METRICS_RX },
+	{ "openavb_mq_late_total", "Media queue items too late to be put in order", METRICS_RX },
+	{ "openavb_mq_duplicate_total", "Media queue items dropped as duplicates", METRICS_RX },
+	{ "openavb_cpu_nanoseconds_total", "Stream thread CPU time", METRICS_TX | METRICS_RX },
+	{ "openavb_cpu_involuntary_switches_total", "Stream thread involuntary context switches", METRICS_TX | METRICS_RX },
+	{ "openavb_cpu_intf_nanoseconds_total", "CPU time in the interface module", METRICS_TX | METRICS_RX },
+	{ "openavb_cpu_map_nanoseconds_total", "CPU time in the mapping module", METRICS_TX | METRICS_RX },
+	{ "openavb_cpu_rawsock_nanoseconds_total", "CPU time in the rawsock", METRICS_TX | METRICS_RX },
+	{ "openavb_tx_null_frames_total", "Null content frames sent on underrun", METRICS_TX },
+	{ "openavb_redundant_frames_total", "Frames missing on or dropped from the redundant interface", METRICS_TX | METRICS_RX },
+};
+typedef char x_statInfoCheck[(sizeof(x_statInfo) / sizeof(x_statInfo[0]) == OPENAVB_METRICS_STAT_COUNT) ? 1 : -1];
+
+// Indexed by tl_hist_t
+static const metrics_info_t x_histInfo[TL_HIST_COUNT] = {
+	{ "openavb_tx_wake_late_nanoseconds", "Talker wake-up lateness", METRICS_TX },
+	{ "openavb_tx_path_nanoseconds", "Talker TX path time per frame", METRICS_TX },
+	{ "openavb_mq_residency_nanoseconds", "Time items spend in the media queue", METRICS_TX | METRICS_RX },
+	{ "openavb_rx_margin_nanoseconds", "Listener presentation margin", METRICS_RX },
+	{ "openavb_ts_jitter_nanoseconds", "AVTP timestamp interval jitter", METRICS_TX | METRICS_RX },
+	{ "openavb_ts_drift_nanoseconds", "AVTP timestamp drift from the nominal rate", METRICS_TX | METRICS_RX },
+	{ "openavb_intf_call_nanoseconds", "CPU time of one interface module call", METRICS_TX | METRICS_RX },
+	{ "openavb_map_call_nanoseconds", "CPU time of one mapping module call", METRICS_TX | METRICS_RX },
+};
+
+static struct {
+	tl_handle_t *tlHandleList;
+	char **tlNameList;
+	int tlCount;
+	// Latest reading of every stream
+	openavb_metrics_stream_t *pSnap;
+	openavb_metrics_shm_t *pShm;
+	size_t shmSize;
+	char shmName[NAME_MAX];
+	int listenFd;
+	// Written to on stop to wake the thread
+	int wakeFd[2];
+	pthread_t thread;
+	bool bThread;
+	bool bStarted;
+	// Drain the latency trace rings (streams without latency_trace have none)
+	bool bTrace;
+	// Scratch copy of a stream's media queue instrumentation
+	media_q_instr_t mqInstr;
+} x_metrics = { .listenFd = -1, .wakeFd = { -1, -1 } };
+
+static void x_metricsCollect(void)
+{
+	int i1, i2;
+
+	for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+		tl_handle_t handle = x_metrics.tlHandleList[i1];
+		openavb_metrics_stream_t *pStream = &x_metrics.pSnap[i1];
+
+		pStream->role = openavbTLGetRole(handle);
+		pStream->streaming = openavbTLIsStreaming(handle);
+
+		// The counters are only there while the stream thread is; keep the
+		// last reading otherwise
+		if (pStream->streaming) {
+			for (i2 = 0; i2 < OPENAVB_METRICS_STAT_COUNT; i2++) {
+				pStream->stat[i2] = openavbTLStat(handle, (tl_stat_t)i2);
+			}
+		}
+
+		for (i2 = 0; i2 < TL_HIST_COUNT; i2++) {
+			openavb_hist_t snap;
+			if (openavbTLHistogram(handle, (tl_hist_t)i2, &snap)) {
+				openavbHistSummarize(&snap, &pStream->hist[i2]);
+				pStream->histSum[i2] = snap.sum;
+			}
+		}
+
+		// Each reading starts a new water mark period
+		if (openavbTLMediaQInstr(handle, &x_metrics.mqInstr, TRUE)) {
+			media_q_instr_t *pInstr = &x_metrics.mqInstr;
+			pStream->mqHighWater = pInstr->highWater;
+			pStream->mqLowWater = pInstr->lowWater;
+			openavbHistSummarize(&pInstr->pushDepth, &pStream->mqPushDepth);
+			openavbHistSummarize(&pInstr->pullDepth, &pStream->mqPullDepth);
+			pStream->mqPushDepthSum = pInstr->pushDepth.sum;
+			pStream->mqPullDepthSum = pInstr->pullDepth.sum;
+			pStream->mqEventCount = pInstr->eventHead;
+			memcpy(pStream->mqEvent, pInstr->event, sizeof(pStream->mqEvent));
+		}
+	}
+}
+
+// Move the streams' latency trace samples into the segment
+static void x_metricsTrace(void)
+{
+	openavb_metrics_shm_t *pShm = x_metrics.pShm;
+	openavb_lat_sample_t samples[64];
+	int i1;
+
+	if (!pShm)
+		return;
+
+	openavb_lat_sample_t *pTrace = openavbMetricsTrace(pShm);
+	for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+		U32 n, i2;
+		while ((n = openavbTLLatencyTrace(x_metrics.tlHandleList[i1], samples, sizeof(samples) / sizeof(samples[0]))) > 0) {
+			for (i2 = 0; i2 < n; i2++) {
+				pTrace[pShm->traceHead % pShm->traceLen] = samples[i2];
+				OPENAVB_ATOMIC_STORE_RELEASE(&pShm->traceHead, pShm->traceHead + 1);
+			}
+		}
+	}
+}
+
+static void x_metricsPublish(void)
+{
+	openavb_metrics_shm_t *pShm = x_metrics.pShm;
+	struct timespec now;
+
+	if (!pShm)
+		return;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	OPENAVB_ATOMIC_STORE_RELAXED(&pShm->seq, pShm->seq + 1);
+	OPENAVB_ATOMIC_FENCE();
+	memcpy(pShm->stream, x_metrics.pSnap, x_metrics.tlCount * sizeof(openavb_metrics_stream_t));
+	pShm->updateNS = (U64)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+	OPENAVB_ATOMIC_STORE_RELEASE(&pShm->seq, pShm->seq + 1);
+}
+
+// Stream name as a label value, escaped as the text format needs
+static void x_metricsLabel(FILE *pOut, const char *name)
+{
+	fputs("{stream=\"", pOut);
+	for (; *name; name++) {
+		if (*name == '"' || *name == '\\')
+			fputc('\\', pOut);
+		if (*name == '\n')
+			fputs("\\n", pOut);
+		else
+			fputc(*name, pOut);
+	}
+	fputc('"', pOut);
+}
+
+// Quantiles, sum and count of one stream's summary
+static void x_metricsSummary(FILE *pOut, const char *name, const char *stream, const openavb_hist_summary_t *pHist, U64 sum)
+{
+	const struct { const char *q; U32 val; } quantiles[] = {
+		{ "0.5", pHist->p50 }, { "0.99", pHist->p99 }, { "0.999", pHist->p999 }, { "1", pHist->max },
+	};
+	int i1;
+	for (i1 = 0; i1 < sizeof(quantiles) / sizeof(quantiles[0]); i1++) {
+		fputs(name, pOut);
+		x_metricsLabel(pOut, stream);
+		fprintf(pOut, ",quantile=\"%s\"} %u\n", quantiles[i1].q, quantiles[i1].val);
+	}
+	fprintf(pOut, "%s_sum", name);
+	x_metricsLabel(pOut, stream);
+	fprintf(pOut, "} %" PRIu64 "\n", sum);
+	fprintf(pOut, "%s_count", name);
+	x_metricsLabel(pOut, stream);
+	fprintf(pOut, "} %" PRIu64 "\n", pHist->count);
+}
+
+static void x_metricsRender(FILE *pOut)
+{
+	int i1, i2;
+
+	for (i2 = 0; i2 < OPENAVB_METRICS_STAT_COUNT; i2++) {
+		fprintf(pOut, "# HELP %s %s\n# TYPE %s counter\n", x_statInfo[i2].name, x_statInfo[i2].help, x_statInfo[i2].name);
+		for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+			openavb_metrics_stream_t *pStream = &x_metrics.pSnap[i1];
+			if (x_statInfo[i2].roles & (1 << pStream->role)) {
+				fputs(x_statInfo[i2].name, pOut);
+				x_metricsLabel(pOut, x_metrics.tlNameList[i1]);
+				fprintf(pOut, "} %" PRIu64 "\n", pStream->stat[i2]);
+			}
+		}
+	}
+
+	fputs("# HELP openavb_streaming Whether the stream is streaming\n# TYPE openavb_streaming gauge\n", pOut);
+	for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+		fputs("openavb_streaming", pOut);
+		x_metricsLabel(pOut, x_metrics.tlNameList[i1]);
+		fprintf(pOut, "} %u\n", x_metrics.pSnap[i1].streaming ? 1 : 0);
+	}
+
+	for (i2 = 0; i2 < TL_HIST_COUNT; i2++) {
+		const char *name = x_histInfo[i2].name;
+		fprintf(pOut, "# HELP %s %s\n# TYPE %s summary\n", name, x_histInfo[i2].help, name);
+		for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+			openavb_metrics_stream_t *pStream = &x_metrics.pSnap[i1];
+			openavb_hist_summary_t *pHist = &pStream->hist[i2];
+			if (!(x_histInfo[i2].roles & (1 << pStream->role)) || !pHist->count)
+				continue;
+			x_metricsSummary(pOut, name, x_metrics.tlNameList[i1], pHist, pStream->histSum[i2]);
+		}
+	}
+
+	fputs("# HELP openavb_mq_push_depth_items Media queue items queued after each push\n"
+		"# TYPE openavb_mq_push_depth_items summary\n", pOut);
+	for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+		openavb_metrics_stream_t *pStream = &x_metrics.pSnap[i1];
+		if (pStream->mqPushDepth.count) {
+			x_metricsSummary(pOut, "openavb_mq_push_depth_items", x_metrics.tlNameList[i1], &pStream->mqPushDepth, pStream->mqPushDepthSum);
+		}
+	}
+	fputs("# HELP openavb_mq_pull_depth_items Media queue items queued before each pull\n"
+		"# TYPE openavb_mq_pull_depth_items summary\n", pOut);
+	for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+		openavb_metrics_stream_t *pStream = &x_metrics.pSnap[i1];
+		if (pStream->mqPullDepth.count) {
+			x_metricsSummary(pOut, "openavb_mq_pull_depth_items", x_metrics.tlNameList[i1], &pStream->mqPullDepth, pStream->mqPullDepthSum);
+		}
+	}
+
+	const struct { const char *name; const char *help; const char *type; } mqInfo[] = {
+		{ "openavb_mq_high_water_items", "Most media queue items queued in the last period", "gauge" },
+		{ "openavb_mq_low_water_items", "Fewest media queue items left in the last period", "gauge" },
+		{ "openavb_mq_events_total", "Media queue overflows and purges", "counter" },
+	};
+	for (i2 = 0; i2 < sizeof(mqInfo) / sizeof(mqInfo[0]); i2++) {
+		fprintf(pOut, "# HELP %s %s\n# TYPE %s %s\n", mqInfo[i2].name, mqInfo[i2].help, mqInfo[i2].name, mqInfo[i2].type);
+		for (i1 = 0; i1 < x_metrics.tlCount; i1++) {
+			openavb_metrics_stream_t *pStream = &x_metrics.pSnap[i1];
+			U64 val = i2 == 0 ? pStream->mqHighWater : i2 == 1 ? pStream->mqLowWater : pStream->mqEventCount;
+			fputs(mqInfo[i2].name, pOut);
+			x_metricsLabel(pOut, x_metrics.tlNameList[i1]);
+			fprintf(pOut, "} %" PRIu64 "\n", val);
+		}
+	}
+}
+
+// Answer one scrape with the latest reading. Whatever was asked for gets the
+// metrics; the request is read only so the client sees a clean close.
+static void x_metricsServe(int fd)
+{
+	char req[1024];
+	char *pBody = NULL;
+	size_t bodyLen = 0;
+	struct timeval tv = { 1, 0 };
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	if (recv(fd, req, sizeof(req), 0) <= 0)
+		return;
+
+	FILE *pOut = open_memstream(&pBody, &bodyLen);
+	if (!pOut)
+		return;
+	x_metricsRender(pOut);
+	fclose(pOut);
+
+	char hdr[128];
+	int hdrLen = snprintf(hdr, sizeof(hdr),
+		"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", bodyLen);
+	if (send(fd, hdr, hdrLen, MSG_NOSIGNAL) == hdrLen) {
+		size_t sent = 0;
+		while (sent < bodyLen) {
+			ssize_t n = send(fd, pBody + sent, bodyLen - sent, MSG_NOSIGNAL);
+			if (n <= 0)
+				break;
+			sent += n;
+		}
+	}
+	free(pBody);
+}
+
+static void *x_metricsThread(void *pv)
+{
+	struct sched_param param = { 0 };
+	struct pollfd fds[2];
+	int nFds = 1;
+	U64 nextNS = 0, nextTraceNS = 0;
+
+	// Stay out of the way of the stream threads
+	pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+
+	fds[0].fd = x_metrics.wakeFd[0];
+	fds[0].events = POLLIN;
+	if (x_metrics.listenFd >= 0) {
+		fds[1].fd = x_metrics.listenFd;
+		fds[1].events = POLLIN;
+		nFds = 2;
+	}
+
+	while (1) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		U64 nowNS = (U64)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+
+		if (nowNS >= nextNS) {
+			x_metricsCollect();
+			x_metricsPublish();
+			nextNS = nowNS + (U64)METRICS_PERIOD_MSEC * NANOSECONDS_PER_MSEC;
+		}
+		U64 wakeNS = nextNS;
+		if (x_metrics.bTrace) {
+			if (nowNS >= nextTraceNS) {
+				x_metricsTrace();
+				nextTraceNS = nowNS + (U64)METRICS_TRACE_PERIOD_MSEC * NANOSECONDS_PER_MSEC;
+			}
+			if (nextTraceNS < wakeNS)
+				wakeNS = nextTraceNS;
+		}
+
+		if (poll(fds, nFds, (wakeNS - nowNS) / NANOSECONDS_PER_MSEC + 1) < 0 && errno != EINTR)
+			break;
+		if (fds[0].revents)
+			break;
+		if (nFds > 1 && (fds[1].revents & POLLIN)) {
+			int fd = accept(x_metrics.listenFd, NULL, NULL);
+			if (fd >= 0) {
+				x_metricsServe(fd);
+				close(fd);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static bool x_metricsOpenShm(const char *shmName)
+{
+	snprintf(x_metrics.shmName, sizeof(x_metrics.shmName), "%s%s", shmName[0] == '/' ? "" : "/", shmName);
+	U32 traceOffset = sizeof(openavb_metrics_shm_t) + x_metrics.tlCount * sizeof(openavb_metrics_stream_t);
+	traceOffset = (traceOffset + 7) & ~7;
+	x_metrics.shmSize = traceOffset + OPENAVB_METRICS_TRACE_LEN * sizeof(openavb_lat_sample_t);
+
+	int fd = shm_open(x_metrics.shmName, O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		AVB_LOGF_ERROR("Unable to open shared memory %s: %s", x_metrics.shmName, strerror(errno));
+		return FALSE;
+	}
+	if (ftruncate(fd, x_metrics.shmSize) != 0) {
+		AVB_LOGF_ERROR("Unable to size shared memory %s: %s", x_metrics.shmName, strerror(errno));
+		close(fd);
+		shm_unlink(x_metrics.shmName);
+		return FALSE;
+	}
+	void *p = mmap(NULL, x_metrics.shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		AVB_LOGF_ERROR("Unable to map shared memory %s: %s", x_metrics.shmName, strerror(errno));
+		shm_unlink(x_metrics.shmName);
+		return FALSE;
+	}
+
+	x_metrics.pShm = p;
+	memset(x_metrics.pShm, 0, x_metrics.shmSize);
+	x_metrics.pShm->version = OPENAVB_METRICS_VERSION;
+	x_metrics.pShm->nStreams = x_metrics.tlCount;
+	x_metrics.pShm->traceLen = OPENAVB_METRICS_TRACE_LEN;
+	x_metrics.pShm->traceOffset = traceOffset;
+	OPENAVB_ATOMIC_STORE_RELEASE(&x_metrics.pShm->magic, OPENAVB_METRICS_MAGIC);
+	return TRUE;
+}
+
+static bool x_metricsOpenHttp(U16 httpPort)
+{
+	struct sockaddr_in addr;
+	int on = 1;
+
+	x_metrics.listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (x_metrics.listenFd < 0) {
+		AVB_LOGF_ERROR("Unable to open metrics socket: %s", strerror(errno));
+		return FALSE;
+	}
+	setsockopt(x_metrics.listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(httpPort);
+	if (bind(x_metrics.listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+		|| listen(x_metrics.listenFd, 4) != 0) {
+		AVB_LOGF_ERROR("Unable to listen for metrics on port %u: %s", httpPort, strerror(errno));
+		close(x_metrics.listenFd);
+		x_metrics.listenFd = -1;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+bool openavbMetricsStart(tl_handle_t *tlHandleList, char **tlNameList, int tlCount, const char *shmName, U16 httpPort)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HOST);
+
+	if (x_metrics.bStarted || (!shmName && !httpPort)) {
+		AVB_TRACE_EXIT(AVB_TRACE_HOST);
+		return FALSE;
+	}
+
+	x_metrics.tlHandleList = tlHandleList;
+	x_metrics.tlNameList = tlNameList;
+	x_metrics.tlCount = tlCount;
+	x_metrics.pSnap = calloc(tlCount ? tlCount : 1, sizeof(openavb_metrics_stream_t));
+	if (!x_metrics.pSnap) {
+		AVB_LOG_ERROR("Unable to allocate metrics");
+		AVB_TRACE_EXIT(AVB_TRACE_HOST);
+		return FALSE;
+	}
+
+	// Trace samples only go to the shared memory segment
+	x_metrics.bTrace = shmName != NULL;
+
+	if ((shmName && !x_metricsOpenShm(shmName))
+		|| (httpPort && !x_metricsOpenHttp(httpPort))
+		|| pipe2(x_metrics.wakeFd, O_CLOEXEC) != 0
+		|| pthread_create(&x_metrics.thread, NULL, x_metricsThread, NULL) != 0) {
+		AVB_LOG_ERROR("Unable to start the metrics exporter");
+		openavbMetricsStop();
+		AVB_TRACE_EXIT(AVB_TRACE_HOST);
+		return FALSE;
+	}
+	x_metrics.bThread = TRUE;
+	x_metrics.bStarted = TRUE;
+
+	if (x_metrics.pShm) {
+		AVB_LOGF_INFO("Publishing metrics of %d streams in shared memory %s", tlCount, x_metrics.shmName);
+	}
+	if (httpPort) {
+		AVB_LOGF_INFO("Serving metrics of %d streams on port %u", tlCount, httpPort);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_HOST);
+	return TRUE;
+}
+
+void openavbMetricsStop(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HOST);
+
+	if (x_metrics.bThread) {
+		if (write(x_metrics.wakeFd[1], "x", 1) == 1) {
+			pthread_join(x_metrics.thread, NULL);
+		}
+		x_metrics.bThread = FALSE;
+	}
+	if (x_metrics.wakeFd[0] >= 0) {
+		close(x_metrics.wakeFd[0]);
+		close(x_metrics.wakeFd[1]);
+		x_metrics.wakeFd[0] = x_metrics.wakeFd[1] = -1;
+	}
+	if (x_metrics.listenFd >= 0) {
+		close(x_metrics.listenFd);
+		x_metrics.listenFd = -1;
+	}
+	if (x_metrics.pShm) {
+		munmap(x_metrics.pShm, x_metrics.shmSize);
+		shm_unlink(x_metrics.shmName);
+		x_metrics.pShm = NULL;
+	}
+	free(x_metrics.pSnap);
+	x_metrics.pSnap = NULL;
+	x_metrics.bStarted = FALSE;
+
+	AVB_TRACE_EXIT(AVB_TRACE_HOST);
+}
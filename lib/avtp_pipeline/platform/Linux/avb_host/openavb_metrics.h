@@ -0,0 +1,120 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Stream metrics exporter for the talker listener hosts.
+*
+* A low priority thread reads the TL stats and latency histograms of every
+* stream once a period and publishes them in a POSIX shared memory segment
+* and, optionally, as Prometheus text on a TCP port. The stream threads do
+* nothing extra: the stats are read under the same short stats lock the API
+* always used and the histograms are copied lock-free.
+*
+* Streams with latency_trace set have their trace samples drained more often
+* into a ring in the same segment, for openavb_lat_trace to follow.
+*/
+
+#ifndef OPENAVB_METRICS_H
+#define OPENAVB_METRICS_H 1
+
+#include "openavb_tl_pub.h"
+#include "openavb_histogram_pub.h"
+
+#define OPENAVB_METRICS_MAGIC		0x4D425641	// "AVBM"
+#define OPENAVB_METRICS_VERSION		6
+// Number of tl_stat_t values
+#define OPENAVB_METRICS_STAT_COUNT	(TL_STAT_REDUNDANT + 1)
+#define OPENAVB_METRICS_NAME_LEN	128
+// Latency trace samples kept in the segment
+#define OPENAVB_METRICS_TRACE_LEN	4096
+
+// One stream in the shared memory segment
+typedef struct {
+	// Stream name, the configuration line the stream was started from
+	char name[OPENAVB_METRICS_NAME_LEN];
+	// avb_role_t
+	U32 role;
+	// Non-zero while the stream is streaming
+	U32 streaming;
+	// Indexed by tl_stat_t
+	U64 stat[OPENAVB_METRICS_STAT_COUNT];
+	// Indexed by tl_hist_t; all zero unless latency_hist or ts_eval is set
+	openavb_hist_summary_t hist[TL_HIST_COUNT];
+	U64 histSum[TL_HIST_COUNT];
+	// Media queue occupancy; all zero unless latency_hist is set. The water
+	// marks are those of the last period, 0 when nothing was pushed or pulled.
+	U32 mqHighWater;
+	U32 mqLowWater;
+	// Items queued after each push and before each pull
+	openavb_hist_summary_t mqPushDepth;
+	openavb_hist_summary_t mqPullDepth;
+	U64 mqPushDepthSum;
+	U64 mqPullDepthSum;
+	// Overflow and purge events; mqEventCount counts all of them, the last
+	// MEDIAQ_INSTR_EVENTS are in mqEvent, event n in slot n % MEDIAQ_INSTR_EVENTS
+	U64 mqEventCount;
+	media_q_event_t mqEvent[MEDIAQ_INSTR_EVENTS];
+} openavb_metrics_stream_t;
+
+// Layout of the shared memory segment. seq is odd while the exporter is
+// updating it; a reader copies what it needs and retries if seq was odd or
+// changed in between.
+//
+// The latency trace ring follows the streams, at traceOffset bytes from the
+// start of the segment. traceHead counts the samples written; sample n is in
+// slot n % traceLen. A reader copies a slot and then rereads traceHead: if
+// the writer has since come round to the slot, the copy is discarded.
+typedef struct {
+	U32 magic;
+	U32 version;
+	U32 seq;
+	U32 nStreams;
+	// CLOCK_REALTIME of the last update
+	U64 updateNS;
+	U32 traceLen;
+	U32 traceOffset;
+	U64 traceHead;
+	openavb_metrics_stream_t stream[];
+} openavb_metrics_shm_t;
+
+static inline openavb_lat_sample_t *openavbMetricsTrace(openavb_metrics_shm_t *pShm)
+{
+	return (openavb_lat_sample_t *)((U8 *)pShm + pShm->traceOffset);
+}
+
+// Start exporting the streams in tlHandleList, named by tlNameList.
+// shmName is the shared memory segment name (e.g. "openavb_metrics"), or NULL
+// for none. httpPort is the TCP port for Prometheus text, or 0 for none.
+bool openavbMetricsStart(tl_handle_t *tlHandleList, char **tlNameList, int tlCount, const char *shmName, U16 httpPort);
+
+// Stop the exporter and remove the shared memory segment.
+void openavbMetricsStop(void);
+
+#endif // OPENAVB_METRICS_H
@@ -0,0 +1,830 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Virtual time talker and listener simulation.
+*
+* Only built with AVB_FEATURE_SIM, where every clock reads a virtual clock
+* (see openavb_time_sim.c). Each stream is a talker and a listener set up
+* the way openavb_host sets them up, wired together through a loop rawsock
+* that can delay, jitter and drop frames. One thread steps all of them in
+* virtual time order, jumping the clock straight to the next talker
+* interval or listener wake-up, so hundreds of streams run faster than real
+* time. Wake-ups can be made late, and now and then stalled, to see how
+* the talker deficit reset, the media queue stale purge and presentation
+* times cope with a loaded host.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "openavb_tl_pub.h"
+#include "openavb_osal_pub.h"
+#include "openavb_trace_pub.h"
+#include "openavb_tl.h"
+#include "openavb_talker.h"
+#include "openavb_listener.h"
+#include "openavb_avtp.h"
+#include "openavb_avtp_time_pub.h"
+#include "openavb_histogram_pub.h"
+#include "openavb_map_uncmp_audio_pub.h"
+#include "loop_rawsock.h"
+#include <inttypes.h>
+
+#define	AVB_LOG_COMPONENT	"TL Sim"
+#include "openavb_log_pub.h"
+
+// Mapping modules under test
+extern bool openavbMapNullInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+extern bool openavbMapAVTPAudioInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+extern bool openavbMapUncmpAudioInitialize(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+
+// Interface module providing the non data path callbacks
+extern bool openavbIntfNullInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB);
+
+// In-process wire all the streams share
+#define SIM_DEFAULT_IFNAME			"loop:sim"
+
+// Media queue items and rawsock RX queue depth per stream
+#define SIM_ITEM_COUNT				"64"
+#define SIM_RX_FRAMES				64
+
+// Most listener calls in one wake-up, while they keep receiving
+#define SIM_RX_MAX_PER_WAKE			64
+
+// Audio format used for the audio mappings
+#define SIM_AUDIO_RATE				AVB_AUDIO_RATE_48KHZ
+#define SIM_AUDIO_BIT_DEPTH			AVB_AUDIO_BIT_DEPTH_24BIT
+
+// SR class defaults, as used without an endpoint
+#define SIM_CLASS_A_PRIORITY		3
+#define SIM_CLASS_B_PRIORITY		2
+#define SIM_DEFAULT_VID				2
+
+typedef struct {
+	const char *name;
+	bool (*pMapInitFn)(media_q_t *pMediaQ, openavb_map_cb_t *pMapCB, U32 inMaxTransitUsec);
+	bool bAudio;
+} sim_map_t;
+
+static const sim_map_t simMaps[] = {
+	{ "null", openavbMapNullInitialize, FALSE },
+	{ "aaf", openavbMapAVTPAudioInitialize, TRUE },
+	{ "uncmp", openavbMapUncmpAudioInitialize, TRUE },
+};
+
+typedef struct {
+	tl_state_t *pTalker;
+	tl_state_t *pListener;
+	AVBStreamID_t streamID;
+	U8 destAddr[ETH_ALEN];
+	// Bytes the talker interface puts in each item
+	U32 fillLen;
+	// Listener wake-up schedule before jitter and stalls
+	U64 nextRxNS;
+
+	U64 intervals;
+	U64 deficitResets;
+	U64 presented;
+	openavb_hist_t late;
+} sim_stream_t;
+
+// A talker interval or listener wake-up; id is the stream index * 2, plus 1 for the listener
+typedef struct {
+	U64 dueNS;
+	U32 id;
+} sim_event_t;
+
+typedef struct {
+	const sim_map_t *pMap;
+	char *ifname;
+	int streamCount;
+	int seconds;
+	U32 txRate;
+	U32 channels;
+	U8 srClass;
+	U32 maxTransitUsec;
+	U32 maxDeficitUsec;
+	U32 maxStaleUsec;
+	U32 rxPeriodUsec;
+	U32 wakeJitterUsec;
+	U32 stallPpm;
+	U32 stallUsec;
+	U32 netDelayUsec;
+	U32 netJitterUsec;
+	U32 netLossPpm;
+	U32 seed;
+	bool bVerbose;
+} sim_opts_t;
+
+static volatile bool bRunning = TRUE;
+
+static sim_opts_t *gSimOpts = NULL;
+
+// The stream being stepped, for the interface callbacks
+static sim_stream_t *gCurStream = NULL;
+
+// Wake-up impairment random state
+static U32 gSimRnd = 1;
+
+static U32 x_simRand(void)
+{
+	// xorshift32
+	gSimRnd ^= gSimRnd << 13;
+	gSimRnd ^= gSimRnd >> 17;
+	gSimRnd ^= gSimRnd << 5;
+	return gSimRnd;
+}
+
+static inline U64 x_simNowNS(void)
+{
+	U64 nowNS = 0;
+	CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
+	return nowNS;
+}
+
+// How late a thread meant to wake at dueNS gets to run
+static U64 x_simWakeNS(U64 dueNS)
+{
+	if (gSimOpts->wakeJitterUsec)
+		dueNS += ((U64)x_simRand() * ((U64)gSimOpts->wakeJitterUsec * NANOSECONDS_PER_USEC + 1)) >> 32;
+	if (gSimOpts->stallPpm && (((U64)x_simRand() * 1000000) >> 32) < gSimOpts->stallPpm)
+		dueNS += (U64)gSimOpts->stallUsec * NANOSECONDS_PER_USEC;
+	return dueNS;
+}
+
+/***********************************************
+ * Event queue: a binary min heap on due time, ties in id order so that
+ * a run repeats exactly for the same seed.
+ */
+static inline bool x_simBefore(const sim_event_t *a, const sim_event_t *b)
+{
+	return a->dueNS < b->dueNS || (a->dueNS == b->dueNS && a->id < b->id);
+}
+
+static void openavbSimPush(sim_event_t *pHeap, int *pCount, U64 dueNS, U32 id)
+{
+	int i = (*pCount)++;
+	sim_event_t ev = { dueNS, id };
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (!x_simBefore(&ev, &pHeap[parent]))
+			break;
+		pHeap[i] = pHeap[parent];
+		i = parent;
+	}
+	pHeap[i] = ev;
+}
+
+static sim_event_t openavbSimPop(sim_event_t *pHeap, int *pCount)
+{
+	sim_event_t top = pHeap[0];
+	sim_event_t last = pHeap[--(*pCount)];
+	int i = 0;
+	while (1) {
+		int child = 2 * i + 1;
+		if (child >= *pCount)
+			break;
+		if (child + 1 < *pCount && x_simBefore(&pHeap[child + 1], &pHeap[child]))
+			child++;
+		if (!x_simBefore(&pHeap[child], &last))
+			break;
+		pHeap[i] = pHeap[child];
+		i = child;
+	}
+	if (*pCount > 0)
+		pHeap[i] = last;
+	return top;
+}
+
+/***********************************************
+ * Interface callbacks for the data path.
+ * Same as the null interface module, except that the talker fills whole
+ * items (so the audio mappings accept them) and the listener records how
+ * late after its presentation time each item is taken.
+ */
+static bool openavbSimIntfTxCB(media_q_t *pMediaQ)
+{
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem)
+		return FALSE;	// Media queue full
+
+	openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+	pMediaQItem->dataLen = gCurStream->fillLen;
+	openavbMediaQHeadPush(pMediaQ);
+	return TRUE;
+}
+
+static bool openavbSimIntfRxCB(media_q_t *pMediaQ)
+{
+	media_q_item_t *pMediaQItem;
+
+	while ((pMediaQItem = openavbMediaQTailLock(pMediaQ, FALSE)) != NULL) {
+		if (openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime)) {
+			U64 wallNS = 0;
+			CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &wallNS);
+			openavbHistRecordDelta(&gCurStream->late,
+				(S64)(wallNS - openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime)));
+		}
+		openavbMediaQTailPull(pMediaQ);
+		gCurStream->presented++;
+	}
+
+	return FALSE;
+}
+
+static bool openavbSimIntfInitialize(media_q_t *pMediaQ, openavb_intf_cb_t *pIntfCB)
+{
+	if (!openavbIntfNullInitialize(pMediaQ, pIntfCB))
+		return FALSE;
+
+	pIntfCB->intf_tx_cb = openavbSimIntfTxCB;
+	pIntfCB->intf_rx_cb = openavbSimIntfRxCB;
+
+	if (gSimOpts->pMap->bAudio) {
+		// Normally set by the interface module from its configuration
+		media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pMediaQ->pPubMapInfo;
+		pPubMapInfo->audioRate = SIM_AUDIO_RATE;
+		pPubMapInfo->audioType = AVB_AUDIO_TYPE_INT;
+		pPubMapInfo->audioBitDepth = SIM_AUDIO_BIT_DEPTH;
+		pPubMapInfo->audioEndian = AVB_AUDIO_ENDIAN_BIG;
+		pPubMapInfo->audioChannels = gSimOpts->channels;
+	}
+	return TRUE;
+}
+
+/***********************************************
+ * Stream setup and teardown. Talkers and listeners are configured through
+ * the TL API, then started here the way the TL thread does without an
+ * endpoint, but without a thread (or the QoS manager) of their own.
+ */
+static tl_state_t *openavbSimSideOpen(sim_stream_t *pStream, sim_opts_t *pOpts, avb_role_t role)
+{
+	openavb_tl_cfg_t cfg;
+	openavb_tl_cfg_name_value_t NVCfg;
+	char txRate[16];
+
+	openavbTLInitCfg(&cfg);
+	cfg.role = role;
+	cfg.pMapInitFn = pOpts->pMap->pMapInitFn;
+	cfg.pIntfInitFn = openavbSimIntfInitialize;
+	strncpy(cfg.ifname, pOpts->ifname, IFNAMSIZE - 1);
+	cfg.dest_addr.mac = &cfg.dest_addr.buffer;
+	memcpy(cfg.dest_addr.buffer.ether_addr_octet, pStream->destAddr, ETH_ALEN);
+	cfg.stream_addr.mac = &cfg.stream_addr.buffer;
+	memcpy(cfg.stream_addr.buffer.ether_addr_octet, pStream->streamID.addr, ETH_ALEN);
+	cfg.stream_uid = pStream->streamID.uniqueID;
+	cfg.sr_class = pOpts->srClass;
+	cfg.max_transit_usec = pOpts->maxTransitUsec;
+	cfg.max_transmit_deficit_usec = pOpts->maxDeficitUsec;
+	cfg.max_stale = pOpts->maxStaleUsec;
+	cfg.raw_rx_buffers = SIM_RX_FRAMES;
+
+	snprintf(txRate, sizeof(txRate), "%u", pOpts->txRate);
+	memset(&NVCfg, 0, sizeof(NVCfg));
+	NVCfg.libCfgNames[0] = "map_nv_item_count";
+	NVCfg.libCfgValues[0] = SIM_ITEM_COUNT;
+	NVCfg.libCfgNames[1] = "map_nv_tx_rate";
+	NVCfg.libCfgValues[1] = txRate;
+	NVCfg.nLibCfgItems = 2;
+
+	tl_handle_t handle = openavbTLOpen();
+	if (!handle) {
+		return NULL;
+	}
+	if (!openavbTLConfigure(handle, &cfg, &NVCfg)) {
+		AVB_LOG_ERROR("Unable to configure stream");
+		openavbTLClose(handle);
+		return NULL;
+	}
+	return (tl_state_t *)handle;
+}
+
+static bool openavbSimSideStart(tl_state_t *pTLState, sim_stream_t *pStream)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+
+	{
+		MUTEX_ATTR_HANDLE(mta);
+		MUTEX_ATTR_INIT(mta);
+		MUTEX_ATTR_SET_TYPE(mta, MUTEX_ATTR_TYPE_DEFAULT);
+		MUTEX_ATTR_SET_NAME(mta, "TLStatsMutex");
+		MUTEX_CREATE_ERR();
+		MUTEX_CREATE(pTLState->statsMutex, mta);
+		MUTEX_LOG_ERR("Could not create/initialize 'TLStatsMutex' mutex");
+	}
+
+	if (pCfg->role == AVB_ROLE_TALKER) {
+		talker_data_t *pTalkerData = calloc(1, sizeof(talker_data_t));
+		if (!pTalkerData)
+			return FALSE;
+		pTLState->pPvtTalkerData = pTalkerData;
+
+		strncpy(pTalkerData->ifname, pCfg->ifname, IFNAMSIZ - 1);
+		pTalkerData->streamID = pStream->streamID;
+		memcpy(pTalkerData->destAddr, pStream->destAddr, ETH_ALEN);
+		pTalkerData->classRate = pCfg->sr_class == SR_CLASS_A ? 8000 : 4000;
+		pTalkerData->vlanID = SIM_DEFAULT_VID;
+		pTalkerData->vlanPCP = pCfg->sr_class == SR_CLASS_A ? SIM_CLASS_A_PRIORITY : SIM_CLASS_B_PRIORITY;
+		pTalkerData->tSpec.maxIntervalFrames = pCfg->max_interval_frames;
+		pTalkerData->tSpec.maxFrameSize = pCfg->map_cb.map_max_data_size_cb(pTLState->pMediaQ);
+
+		if (gSimOpts->pMap->bAudio) {
+			media_q_pub_map_uncmp_audio_info_t *pPubMapInfo = pTLState->pMediaQ->pPubMapInfo;
+			pStream->fillLen = pPubMapInfo->itemSize;
+		}
+		else {
+			pStream->fillLen = 1;
+		}
+
+		return talkerStartStream(pTLState) && pTLState->bStreaming;
+	}
+
+	listener_data_t *pListenerData = calloc(1, sizeof(listener_data_t));
+	if (!pListenerData)
+		return FALSE;
+	pTLState->pPvtListenerData = pListenerData;
+
+	strncpy(pListenerData->ifname, pCfg->ifname, IFNAMSIZ - 1);
+	pListenerData->streamID = pStream->streamID;
+	memcpy(pListenerData->destAddr, pStream->destAddr, ETH_ALEN);
+	pListenerData->tSpec.maxIntervalFrames = pCfg->max_interval_frames;
+	pListenerData->tSpec.maxFrameSize = pCfg->max_frame_size;
+
+	return listenerStartStream(pTLState) && pTLState->bStreaming;
+}
+
+static void openavbSimSideClose(tl_state_t *pTLState)
+{
+	if (!pTLState)
+		return;
+
+	if (pTLState->cfg.role == AVB_ROLE_TALKER) {
+		if (pTLState->pPvtTalkerData) {
+			if (pTLState->bStreaming)
+				talkerStopStream(pTLState);
+			free(pTLState->pPvtTalkerData);
+			pTLState->pPvtTalkerData = NULL;
+			MUTEX_CREATE_ERR();
+			MUTEX_DESTROY(pTLState->statsMutex);
+			MUTEX_LOG_ERR("Error destroying mutex");
+		}
+	}
+	else if (pTLState->pPvtListenerData) {
+		if (pTLState->bStreaming)
+			listenerStopStream(pTLState);
+		free(pTLState->pPvtListenerData);
+		pTLState->pPvtListenerData = NULL;
+		MUTEX_CREATE_ERR();
+		MUTEX_DESTROY(pTLState->statsMutex);
+		MUTEX_LOG_ERR("Error destroying mutex");
+	}
+
+	openavbTLClose(pTLState);
+}
+
+static bool openavbSimStreamCreate(sim_stream_t *pStream, int idx, sim_opts_t *pOpts)
+{
+	// Stream IDs and destinations made unique by the stream index
+	if_info_t ifInfo;
+	if (openavbCheckInterface(pOpts->ifname, &ifInfo))
+		memcpy(pStream->streamID.addr, ifInfo.mac.ether_addr_octet, ETH_ALEN);
+	pStream->streamID.uniqueID = idx;
+	U8 destAddr[ETH_ALEN] = {0x91, 0xe0, 0xf0, 0x00, (idx >> 8) & 0xff, idx & 0xff};
+	memcpy(pStream->destAddr, destAddr, ETH_ALEN);
+	openavbHistReset(&pStream->late);
+
+	// The listener first, so that it is on the wire before the talker sends
+	gCurStream = pStream;
+	pStream->pListener = openavbSimSideOpen(pStream, pOpts, AVB_ROLE_LISTENER);
+	pStream->pTalker = openavbSimSideOpen(pStream, pOpts, AVB_ROLE_TALKER);
+	if (!pStream->pListener || !pStream->pTalker
+		|| !openavbSimSideStart(pStream->pListener, pStream)
+		|| !openavbSimSideStart(pStream->pTalker, pStream)) {
+		AVB_LOGF_ERROR("Unable to create stream %d", idx);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void openavbSimStreamDelete(sim_stream_t *pStream)
+{
+	gCurStream = pStream;
+	openavbSimSideClose(pStream->pTalker);
+	pStream->pTalker = NULL;
+	openavbSimSideClose(pStream->pListener);
+	pStream->pListener = NULL;
+}
+
+/***********************************************
+ * Stepping
+ */
+static U64 openavbSimTalkerStep(sim_stream_t *pStream)
+{
+	talker_data_t *pTalkerData = pStream->pTalker->pPvtTalkerData;
+	U64 expectNS = pTalkerData->nextCycleNS + pTalkerData->intervalNS;
+
+	talkerDoInterval(pStream->pTalker);
+	pStream->intervals++;
+
+	// Anything else means the deficit got too big and the cycle timer was reset
+	if (pTalkerData->nextCycleNS != expectNS)
+		pStream->deficitResets++;
+
+	return x_simWakeNS(pTalkerData->nextCycleNS);
+}
+
+static U64 openavbSimListenerStep(sim_stream_t *pStream, U64 nowNS)
+{
+	listener_data_t *pListenerData = pStream->pListener->pPvtListenerData;
+	unsigned long frames;
+	int calls = 0;
+
+	do {
+		frames = pListenerData->nReportFrames;
+		listenerDoStream(pStream->pListener);
+	} while (pListenerData->nReportFrames != frames && ++calls < SIM_RX_MAX_PER_WAKE);
+
+	// Wake-ups missed while the listener was late are skipped
+	U64 periodNS = (U64)gSimOpts->rxPeriodUsec * NANOSECONDS_PER_USEC;
+	do {
+		pStream->nextRxNS += periodNS;
+	} while (pStream->nextRxNS <= nowNS);
+
+	return x_simWakeNS(pStream->nextRxNS);
+}
+
+static U64 openavbSimRun(sim_stream_t *pStreams, sim_opts_t *pOpts)
+{
+	int count = 0, i1;
+	U64 steps = 0;
+	sim_event_t *pHeap = calloc(pOpts->streamCount * 2, sizeof(sim_event_t));
+	if (!pHeap) {
+		AVB_LOG_ERROR("Unable to allocate event queue");
+		return 0;
+	}
+
+	U64 startNS = x_simNowNS();
+	U64 endNS = startNS + (U64)pOpts->seconds * NANOSECONDS_PER_SECOND;
+
+	for (i1 = 0; i1 < pOpts->streamCount; i1++) {
+		talker_data_t *pTalkerData = pStreams[i1].pTalker->pPvtTalkerData;
+		pStreams[i1].nextRxNS = startNS;
+		openavbSimPush(pHeap, &count, x_simWakeNS(pTalkerData->nextCycleNS), i1 * 2);
+		openavbSimPush(pHeap, &count, x_simWakeNS(startNS), i1 * 2 + 1);
+	}
+
+	while (bRunning && count > 0) {
+		sim_event_t ev = openavbSimPop(pHeap, &count);
+		if (ev.dueNS >= endNS)
+			break;
+
+		// A thread woken late finds the clock already past its due time
+		osalSimSetTime(ev.dueNS);
+		U64 nowNS = x_simNowNS();
+
+		sim_stream_t *pStream = &pStreams[ev.id / 2];
+		gCurStream = pStream;
+		U64 nextNS = (ev.id & 1) ? openavbSimListenerStep(pStream, nowNS) : openavbSimTalkerStep(pStream);
+		openavbSimPush(pHeap, &count, nextNS > nowNS ? nextNS : nowNS, ev.id);
+		steps++;
+	}
+
+	osalSimSetTime(endNS);
+	free(pHeap);
+	return steps;
+}
+
+/***********************************************
+ * Reporting
+ */
+static void openavbSimHistMerge(openavb_hist_t *pDst, const openavb_hist_t *pSrc)
+{
+	int i1;
+	for (i1 = 0; i1 < OPENAVB_HIST_BUCKETS; i1++)
+		pDst->bucket[i1] += pSrc->bucket[i1];
+	pDst->count += pSrc->count;
+	pDst->sum += pSrc->sum;
+	if (pSrc->max > pDst->max)
+		pDst->max = pSrc->max;
+}
+
+static void openavbSimReport(sim_stream_t *pStreams, sim_opts_t *pOpts, U64 steps, U64 realNS)
+{
+	openavb_hist_t *pLate = calloc(1, sizeof(openavb_hist_t));
+	if (!pLate) {
+		AVB_LOG_ERROR("Unable to allocate report histogram");
+		return;
+	}
+
+	U64 intervals = 0, resets = 0, txFrames = 0, rxFrames = 0, lost = 0, purged = 0, presented = 0;
+	int i1;
+
+	if (pOpts->bVerbose)
+		printf("\n  %-6s %10s %8s %10s %10s %8s %8s %10s %10s\n",
+			"stream", "intervals", "resets", "tx frames", "rx frames", "lost", "purged", "presented", "late p99");
+
+	for (i1 = 0; i1 < pOpts->streamCount; i1++) {
+		sim_stream_t *pStream = &pStreams[i1];
+		talker_data_t *pTalkerData = pStream->pTalker->pPvtTalkerData;
+		listener_data_t *pListenerData = pStream->pListener->pPvtListenerData;
+		U64 sLost = openavbAvtpLost(pListenerData->avtpHandle);
+		U64 sPurged = openavbMediaQPurgedItems(pStream->pListener->pMediaQ);
+
+		intervals += pStream->intervals;
+		resets += pStream->deficitResets;
+		txFrames += pTalkerData->cntFrames;
+		rxFrames += pListenerData->nReportFrames;
+		lost += sLost;
+		purged += sPurged;
+		presented += pStream->presented;
+		openavbSimHistMerge(pLate, &pStream->late);
+
+		if (pOpts->bVerbose) {
+			openavb_hist_summary_t summary;
+			openavbHistSummarize(&pStream->late, &summary);
+			printf("  %-6d %10" PRIu64 " %8" PRIu64 " %10lu %10lu %8" PRIu64 " %8" PRIu64 " %10" PRIu64 " %10u\n",
+				i1, pStream->intervals, pStream->deficitResets, pTalkerData->cntFrames,
+				pListenerData->nReportFrames, sLost, sPurged, pStream->presented, summary.p99);
+		}
+	}
+
+	double realSeconds = (double)realNS / NANOSECONDS_PER_SECOND;
+	openavb_hist_summary_t summary;
+	openavbHistSummarize(pLate, &summary);
+
+	printf("\n");
+	printf("Mapping %s, %d stream(s), %d s of virtual time in %.2f s (%.1fx real time), %" PRIu64 " steps\n",
+		pOpts->pMap->name, pOpts->streamCount, pOpts->seconds, realSeconds,
+		realSeconds > 0 ? pOpts->seconds / realSeconds : 0, steps);
+	printf("  talker     %" PRIu64 " intervals, %" PRIu64 " frames, %" PRIu64 " deficit resets\n", intervals, txFrames, resets);
+	printf("  listener   %" PRIu64 " frames, %" PRIu64 " lost, %" PRIu64 " stale purged, %" PRIu64 " presented\n", rxFrames, lost, purged, presented);
+	printf("\n  %-10s %10s %10s %10s %10s %10s\n", "late ns", "mean", "p50", "p99", "p99.9", "max");
+	printf("  %-10s %10u %10u %10u %10u %10u\n", "present", summary.mean, summary.p50, summary.p99, summary.p999, summary.max);
+	printf("\n");
+
+	free(pLate);
+}
+
+/***********************************************
+ * Signal handler - used to respond to signals.
+ * Allows graceful cleanup.
+ */
+static void openavbSimSigHandler(int signal)
+{
+	if (signal == SIGINT) {
+		bRunning = FALSE;
+	}
+}
+
+void openavbSimUsage(char *programName)
+{
+	printf(
+		"\n"
+		"Usage: %s [options]\n"
+		"  -m val     Mapping to run: null, aaf or uncmp. Defaults to null.\n"
+		"  -s val     Stream count. Defaults to 1.\n"
+		"  -d val     Run for 'val' seconds of virtual time. Defaults to 10.\n"
+		"  -r val     Talker transmit rate (frames per second per stream, as map_nv_tx_rate). Defaults to 8000.\n"
+		"  -c val     Audio channels for the audio mappings (48KHz, 24 bit). Defaults to 2.\n"
+		"  -B         SR class B instead of class A.\n"
+		"  -T val     max_transit_usec. Defaults to 2000.\n"
+		"  -x val     max_transmit_deficit_usec. Defaults to 50000.\n"
+		"  -S val     max_stale in usec. Defaults to 1000000.\n"
+		"  -p val     Listener wake-up period in usec. Defaults to 125.\n"
+		"  -j val     Wake-ups are late by up to 'val' usec. Defaults to 0.\n"
+		"  -k val     'val' in a million wake-ups stall. Defaults to 0.\n"
+		"  -K val     Stall length in usec. Defaults to 10000.\n"
+		"  -D val     Wire delay in usec. Defaults to 0.\n"
+		"  -J val     Wire jitter in usec, on top of the delay. Defaults to 0.\n"
+		"  -L val     Wire loss in frames per million. Defaults to 0.\n"
+		"  -R val     Random seed for wake-up and wire impairments. Defaults to 1.\n"
+		"  -I val     Loop interface the streams are wired through. Defaults to " SIM_DEFAULT_IFNAME ".\n"
+		"  -v         Print per stream results.\n"
+		"  -h         Prints this message.\n"
+		"\n"
+		"Examples:\n"
+		"  %s -m aaf -s 200 -d 60 -j 50 -k 100 -K 20000\n"
+		"    Run 200 AAF streams for a virtual minute with wake-ups up to 50 usec late\n"
+		"    and one in 10000 stalled for 20 ms.\n\n"
+		,
+		programName, programName);
+}
+
+/**********************************************
+ * main
+ */
+int main(int argc, char *argv[])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HOST);
+
+	char *programName;
+	sim_opts_t opts;
+	sim_stream_t *pStreams = NULL;
+	int nCreated = 0;
+	int i1;
+	int ret = 0;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.pMap = &simMaps[0];
+	opts.ifname = SIM_DEFAULT_IFNAME;
+	opts.streamCount = 1;
+	opts.seconds = 10;
+	opts.txRate = 8000;
+	opts.channels = 2;
+	opts.srClass = SR_CLASS_A;
+	opts.maxTransitUsec = 2000;
+	opts.maxDeficitUsec = 50000;
+	opts.maxStaleUsec = MICROSECONDS_PER_SECOND;
+	opts.rxPeriodUsec = 125;
+	opts.stallUsec = 10000;
+	opts.seed = 1;
+	gSimOpts = &opts;
+
+	// Setup signal handler. Catch SIGINT and shutdown cleanly
+	struct sigaction sa;
+	sa.sa_handler = openavbSimSigHandler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0; // not SA_RESTART
+	sigaction(SIGINT, &sa, NULL);
+
+	// Process command line
+	programName = strrchr(argv[0], '/');
+	programName = programName ? programName + 1 : argv[0];
+
+	bool optDone = FALSE;
+	while (!optDone) {
+		int opt = getopt(argc, argv, "m:s:d:r:c:BT:x:S:p:j:k:K:D:J:L:R:I:vh");
+		if (opt != EOF) {
+			switch (opt) {
+				case 'm':
+					opts.pMap = NULL;
+					for (i1 = 0; i1 < (int)(sizeof(simMaps) / sizeof(simMaps[0])); i1++) {
+						if (strcmp(optarg, simMaps[i1].name) == 0)
+							opts.pMap = &simMaps[i1];
+					}
+					if (!opts.pMap) {
+						printf("Unknown mapping: %s\n", optarg);
+						openavbSimUsage(programName);
+						exit(-1);
+					}
+					break;
+				case 's':
+					opts.streamCount = atoi(optarg);
+					break;
+				case 'd':
+					opts.seconds = atoi(optarg);
+					break;
+				case 'r':
+					opts.txRate = strtoul(optarg, NULL, 0);
+					break;
+				case 'c':
+					opts.channels = strtoul(optarg, NULL, 0);
+					break;
+				case 'B':
+					opts.srClass = SR_CLASS_B;
+					break;
+				case 'T':
+					opts.maxTransitUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'x':
+					opts.maxDeficitUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'S':
+					opts.maxStaleUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'p':
+					opts.rxPeriodUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'j':
+					opts.wakeJitterUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'k':
+					opts.stallPpm = strtoul(optarg, NULL, 0);
+					break;
+				case 'K':
+					opts.stallUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'D':
+					opts.netDelayUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'J':
+					opts.netJitterUsec = strtoul(optarg, NULL, 0);
+					break;
+				case 'L':
+					opts.netLossPpm = strtoul(optarg, NULL, 0);
+					break;
+				case 'R':
+					opts.seed = strtoul(optarg, NULL, 0);
+					break;
+				case 'I':
+					opts.ifname = optarg;
+					break;
+				case 'v':
+					opts.bVerbose = TRUE;
+					break;
+				case 'h':
+				case '?':
+				default:
+					openavbSimUsage(programName);
+					exit(-1);
+			}
+		}
+		else {
+			optDone = TRUE;
+		}
+	}
+
+	if (opts.streamCount < 1 || opts.seconds < 1 || opts.txRate == 0 || opts.channels == 0
+		|| opts.rxPeriodUsec == 0 || opts.stallPpm > 1000000 || opts.netLossPpm > 1000000) {
+		openavbSimUsage(programName);
+		exit(-1);
+	}
+	if (strncmp(opts.ifname, "loop:", 5) != 0) {
+		printf("Interface must be a loop interface (loop:name)\n");
+		exit(-1);
+	}
+	gSimRnd = opts.seed ? opts.seed : 1;
+
+	// No endpoint or QoS manager is involved
+	avbLogInit();
+	if (!openavbTLInitialize(opts.streamCount * 2)) {
+		AVB_LOG_ERROR("Unable to initialize talker listener library");
+		avbLogExit();
+		exit(-1);
+	}
+
+	if (!loopRawsockSetImpairment(opts.ifname + 5, opts.netDelayUsec, opts.netJitterUsec, opts.netLossPpm, opts.seed)) {
+		ret = -1;
+		goto cleanup;
+	}
+
+	pStreams = calloc(opts.streamCount, sizeof(sim_stream_t));
+	if (!pStreams) {
+		AVB_LOG_ERROR("Unable to allocate streams");
+		ret = -1;
+		goto cleanup;
+	}
+
+	for (nCreated = 0; nCreated < opts.streamCount; nCreated++) {
+		if (!openavbSimStreamCreate(&pStreams[nCreated], nCreated, &opts)) {
+			nCreated++;
+			ret = -1;
+			goto cleanup;
+		}
+	}
+
+	printf("Simulating %d %s stream(s) for %d s\n", opts.streamCount, opts.pMap->name, opts.seconds);
+
+	struct timespec realStart, realEnd;
+	clock_gettime(CLOCK_MONOTONIC, &realStart);
+	U64 steps = openavbSimRun(pStreams, &opts);
+	clock_gettime(CLOCK_MONOTONIC, &realEnd);
+
+	openavbSimReport(pStreams, &opts, steps,
+		(U64)(realEnd.tv_sec - realStart.tv_sec) * NANOSECONDS_PER_SECOND + realEnd.tv_nsec - realStart.tv_nsec);
+
+cleanup:
+	for (i1 = 0; i1 < nCreated; i1++) {
+		openavbSimStreamDelete(&pStreams[i1]);
+	}
+	free(pStreams);
+
+	openavbTLCleanup();
+	osalAVBTimeClose();
+	avbLogExit();
+
+	AVB_TRACE_EXIT(AVB_TRACE_HOST);
+	exit(ret);
+}
@@ -0,0 +1,154 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Linux socket handling of the endpoint's AVDECC entity.
+*
+* AVDECC PDUs share the AVTP ethertype with the streams, so a socket
+* filter keeps everything but ADP, AECP and ACMP out; otherwise the
+* endpoint would wake for every frame of a stream received on the host.
+* Included from openavb_endpoint_avdecc.c.
+*/
+
+#ifndef OPENAVB_ENDPOINT_AVDECC_OSAL_C
+#define OPENAVB_ENDPOINT_AVDECC_OSAL_C
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <arpa/inet.h>
+
+// Opens a packet socket for AVDECC frames on interface ifindex and joins
+// the AVDECC multicast group. Returns the socket, or -1.
+static int x_avdeccSockOpen(int ifindex, U16 ethertype, const U8 mcastAddr[ETH_ALEN])
+{
+	// Accepts control PDUs with subtype ADP, AECP or ACMP; the first
+	// byte of the AVTP header (cd bit and subtype) is 0xfa to 0xfc
+	struct sock_filter bpfCode[] = {
+		{ 0x30, 0, 0, 0x0000000e },		// ldb [14]
+		{ 0x35, 0, 2, 0x000000fa },		// jge #0xfa
+		{ 0x25, 1, 0, 0x000000fc },		// jgt #0xfc
+		{ 0x06, 0, 0, 0x0000ffff },		// ret #0xffff
+		{ 0x06, 0, 0, 0x00000000 }		// ret #0
+	};
+	struct sock_fprog filter;
+	struct sockaddr_ll addr;
+	struct packet_mreq mreq;
+
+	int sock = socket(PF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, htons(ethertype));
+	if (sock < 0) {
+		AVB_LOGF_ERROR("Failed to open AVDECC socket: %s", strerror(errno));
+		return -1;
+	}
+
+	// Filter before binding, so no stream frame gets queued meanwhile
+	memset(&filter, 0, sizeof(filter));
+	filter.len = sizeof(bpfCode) / sizeof(bpfCode[0]);
+	filter.filter = bpfCode;
+	if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter)) < 0) {
+		AVB_LOGF_ERROR("Failed to filter AVDECC socket: %s", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(ethertype);
+	addr.sll_ifindex = ifindex;
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		AVB_LOGF_ERROR("Failed to bind AVDECC socket: %s", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	memset(&mreq, 0, sizeof(mreq));
+	mreq.mr_ifindex = ifindex;
+	mreq.mr_type = PACKET_MR_MULTICAST;
+	mreq.mr_alen = ETH_ALEN;
+	memcpy(mreq.mr_address, mcastAddr, ETH_ALEN);
+	if (setsockopt(sock, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+		AVB_LOGF_ERROR("Failed to join AVDECC multicast group: %s", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+// The multicast membership goes with the socket
+static void x_avdeccSockClose(int sock)
+{
+	if (sock >= 0) {
+		close(sock);
+	}
+}
+
+// Receives one frame without waiting, skipping frames sent from this host.
+// Returns the frame length, 0 if there is none, or -1 on error.
+static int x_avdeccSockRecv(int sock, U8 *pBuf, size_t size)
+{
+	struct sockaddr_ll from;
+	socklen_t fromLen;
+	ssize_t nRead;
+
+	do {
+		fromLen = sizeof(from);
+		nRead = recvfrom(sock, pBuf, size, 0, (struct sockaddr *)&from, &fromLen);
+		if (nRead < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				return 0;
+			}
+			AVB_LOGF_ERROR("AVDECC socket read: %s", strerror(errno));
+			return -1;
+		}
+	} while (from.sll_pkttype == PACKET_OUTGOING);
+
+	return nRead;
+}
+
+// Sends a complete Ethernet frame
+static bool x_avdeccSockSend(int sock, const U8 *pFrame, size_t len)
+{
+	ssize_t nWrite = send(sock, pFrame, len, 0);
+	if (nWrite < (ssize_t)len) {
+		if (nWrite < 0) {
+			AVB_LOGF_ERROR("AVDECC socket write: %s", strerror(errno));
+		}
+		else {
+			AVB_LOG_ERROR("AVDECC socket write too short");
+		}
+		return FALSE;
+	}
+	return TRUE;
+}
+
+#endif // OPENAVB_ENDPOINT_AVDECC_OSAL_C
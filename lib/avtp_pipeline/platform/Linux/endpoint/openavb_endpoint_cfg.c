@@ -37,6 +37,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <string.h>
 #include <errno.h>
 #include <ctype.h>
+#include <linux/pkt_sched.h>
 #include "openavb_endpoint.h"
 #include "openavb_endpoint_cfg.h"
 #include "openavb_trace.h"
@@ -56,6 +57,28 @@ static void cfgValErr(const char *section, const char *name, const char *value)
 				   section, name, value);
 }
 
+// Parse a tc handle given as "major:minor" in hex, or "root"
+static bool cfgParseTcHandle(const char *value, U32 *pHandle)
+{
+	char *pEnd;
+
+	if (MATCH(value, "root")) {
+		*pHandle = TC_H_ROOT;
+		return TRUE;
+	}
+
+	errno = 0;
+	unsigned long major = strtoul(value, &pEnd, 16);
+	if (*pEnd != ':' || errno != 0 || major > 0xFFFF)
+		return FALSE;
+	unsigned long minor = strtoul(pEnd + 1, &pEnd, 16);
+	if (*pEnd != '\0' || errno != 0 || minor > 0xFFFF)
+		return FALSE;
+
+	*pHandle = TC_H_MAKE(major << 16, minor);
+	return TRUE;
+}
+
 static int cfgCallback(void *user, const char *section, const char *name, const char *value)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
@@ -126,6 +149,37 @@ static int cfgCallback(void *user, const char *section, const char *name, const
 			if (*pEnd == '\0' && errno == 0)
 				valOK = TRUE;
 		}
+		else if (MATCH(name, "etf_parent")) {
+			valOK = cfgParseTcHandle(value, &pCfg->etf_parent);
+		}
+		else if (MATCH(name, "cbs_parent_a")) {
+			valOK = cfgParseTcHandle(value, &pCfg->cbs_parent[SR_CLASS_A]);
+		}
+		else if (MATCH(name, "cbs_parent_b")) {
+			valOK = cfgParseTcHandle(value, &pCfg->cbs_parent[SR_CLASS_B]);
+		}
+		else if (MATCH(name, "cbs_offload")) {
+			errno = 0;
+			unsigned temp = strtoul(value, &pEnd, 10);
+			if (*pEnd == '\0' && errno == 0) {
+				valOK = TRUE;
+				pCfg->cbs_offload = (temp == 1);
+			}
+		}
+		else if (MATCH(name, "etf_delta_usec")) {
+			errno = 0;
+			pCfg->etf_delta_usec = strtoul(value, &pEnd, 10);
+			if (*pEnd == '\0' && errno == 0)
+				valOK = TRUE;
+		}
+		else if (MATCH(name, "etf_offload")) {
+			errno = 0;
+			unsigned temp = strtoul(value, &pEnd, 10);
+			if (*pEnd == '\0' && errno == 0) {
+				valOK = TRUE;
+				pCfg->etf_offload = (temp == 1);
+			}
+		}
 		else {
 			// unmatched item, fail
 			AVB_LOGF_ERROR("Unrecognized configuration item: section=%s, name=%s", section, name);
@@ -164,6 +218,43 @@ static int cfgCallback(void *user, const char *section, const char *name, const
 			return 0;
 		}
 	}
+	else if (MATCH(section, "avdecc"))
+	{
+		if (MATCH(name, "enabled")) {
+			errno = 0;
+			unsigned temp = strtoul(value, &pEnd, 10);
+			if (*pEnd == '\0' && errno == 0) {
+				valOK = TRUE;
+				pCfg->avdecc_enabled = (temp == 1);
+			}
+		}
+		else if (MATCH(name, "entity_id")) {
+			errno = 0;
+			pCfg->avdecc_entity_id = strtoull(value, &pEnd, 16);
+			if (*pEnd == '\0' && errno == 0)
+				valOK = TRUE;
+		}
+		else if (MATCH(name, "entity_model_id")) {
+			errno = 0;
+			pCfg->avdecc_entity_model_id = strtoull(value, &pEnd, 16);
+			if (*pEnd == '\0' && errno == 0)
+				valOK = TRUE;
+		}
+		else if (MATCH(name, "valid_time")) {
+			// sent in units of 2 seconds, in 5 bits
+			errno = 0;
+			pCfg->avdecc_valid_time = strtoul(value, &pEnd, 10);
+			if (*pEnd == '\0' && errno == 0
+				&& pCfg->avdecc_valid_time >= 2 && pCfg->avdecc_valid_time <= 62)
+				valOK = TRUE;
+		}
+		else {
+			// unmatched item, fail
+			AVB_LOGF_ERROR("Unrecognized configuration item: section=%s, name=%s", section, name);
+			AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
+			return 0;
+		}
+	}
 	else {
 		// unmatched item, fail
 		AVB_LOGF_ERROR("Unrecognized configuration item: section=%s, name=%s", section, name);
@@ -190,6 +281,8 @@ int openavbReadConfig(const char *ini_file, openavb_endpoint_cfg_t *pCfg)
 	// defaults - most are handled by setting everything to 0
 	memset(pCfg, 0, sizeof(openavb_endpoint_cfg_t));
 	pCfg->fqtss_mode = -1;
+	pCfg->etf_delta_usec = 300;
+	pCfg->avdecc_valid_time = 20;
 
 	int result = ini_parse(ini_file, cfgCallback, pCfg);
 	if (result < 0) {
@@ -53,8 +53,22 @@ typedef struct {
 	unsigned	nsr_kbit;
 	unsigned	mtu;
 	unsigned	fqtss_mode;
+	// ETF qdisc for SO_TXTIME launch time: tc parent handle (0 for none),
+	// release delta and hardware offload
+	U32			etf_parent;
+	unsigned	etf_delta_usec;
+	bool		etf_offload;
+	// CBS qdisc per SR class: tc parent handle (0 for none), hardware offload
+	U32			cbs_parent[MAX_AVB_SR_CLASSES];
+	bool		cbs_offload;
 	bool        noSrp;
 	bool        bypassAsCapableCheck;
+	// AVDECC entity: enable, entity ID (0 for one from the interface MAC),
+	// entity model ID and ADP valid time in seconds
+	bool		avdecc_enabled;
+	U64			avdecc_entity_id;
+	U64			avdecc_entity_model_id;
+	unsigned	avdecc_valid_time;
 } openavb_endpoint_cfg_t;
 
 int openavbReadConfig(const char *inifile, openavb_endpoint_cfg_t *pCfg);
@@ -107,10 +107,44 @@ void openavbEptClntCloseSrvrConnection(int h)
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
 }
 
+// Read and dispatch one message from the server. Closes the socket on failure.
+static bool x_clntReadMessage(int h)
+{
+	openavbEndpointMessage_t msgBuf;
+	memset(&msgBuf, 0, OPENAVB_ENDPOINT_MSG_LEN);
+	ssize_t nRead = read(h, &msgBuf, OPENAVB_ENDPOINT_MSG_LEN);
+
+	if (nRead < OPENAVB_ENDPOINT_MSG_LEN) {
+		// sock closed
+		if (nRead == 0) {
+			AVB_LOG_ERROR("Socket closed unexpectedly");
+		}
+		else if (nRead < 0) {
+			AVB_LOGF_ERROR("Socket read error: %s", strerror(errno));
+		}
+		else {
+			AVB_LOG_ERROR("Socket read to short");
+		}
+		socketClose(h);
+		return FALSE;
+	}
+
+	// got a message
+	if (!openavbEptClntReceiveFromServer(h, &msgBuf)) {
+		AVB_LOG_ERROR("Invalid message received");
+		socketClose(h);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Waits up to timeout msec for the server to push a message, then handles
+// every message already queued on the socket so that a burst of SRP changes
+// is not spread over several service intervals.
 bool openavbEptClntService(int h, int timeout)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
-	bool rc = FALSE;
+	bool rc = TRUE;
 
 	if (h == AVB_ENDPOINT_HANDLE_INVALID) {
 		AVB_LOG_ERROR("Client service: invalid socket");
@@ -126,50 +160,27 @@ bool openavbEptClntService(int h, int timeout)
 	AVB_LOG_VERBOSE("Waiting for event...");
 	int pRet = poll(fds, 1, timeout);
 
+	while (pRet > 0 && rc) {
+		AVB_LOGF_DEBUG("Poll returned %d events", pRet);
+		// only one fd, so it's readable.
+		rc = x_clntReadMessage(h);
+
+		// check for more without blocking
+		if (rc) {
+			pRet = poll(fds, 1, 0);
+		}
+	}
+
 	if (pRet == 0) {
 		AVB_LOG_VERBOSE("Poll timeout");
-		AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
-		return TRUE;
 	}
 	else if (pRet < 0) {
 		if (errno == EINTR) {
 			AVB_LOG_VERBOSE("Poll interrupted");
-			AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
-			return TRUE;
 		}
 		else {
 			AVB_LOGF_ERROR("Poll error: %s", strerror(errno));
-		}
-	}
-	else {
-		AVB_LOGF_DEBUG("Poll returned %d events", pRet);
-		// only one fd, so it's readable.
-		openavbEndpointMessage_t msgBuf;
-		memset(&msgBuf, 0, OPENAVB_ENDPOINT_MSG_LEN);
-		ssize_t nRead = read(h, &msgBuf, OPENAVB_ENDPOINT_MSG_LEN);
-					
-		if (nRead < OPENAVB_ENDPOINT_MSG_LEN) {
-			// sock closed
-			if (nRead == 0) {
-				AVB_LOG_ERROR("Socket closed unexpectedly");
-			}
-			else if (nRead < 0) {
-				AVB_LOGF_ERROR("Socket read error: %s", strerror(errno));
-			}
-			else {
-				AVB_LOG_ERROR("Socket read to short");
-			}
-			socketClose(h);
-		}
-		else {
-			// got a message
-			if (openavbEptClntReceiveFromServer(h, &msgBuf)) {
-				rc = TRUE;
-			}
-			else {
-				AVB_LOG_ERROR("Invalid message received");
-				socketClose(h);
-			}
+			rc = FALSE;
 		}
 	}
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
@@ -248,6 +248,17 @@ void mrp_register_cb(unsigned char streamid[8], int join, unsigned char destaddr
 	AVB_TRACE_EXIT(AVB_TRACE_SRP_PUBLIC);
 }
 
+// Completion of declarations sent without waiting for mrpd
+static void x_mrpDone(int processed, int failed, void *arg)
+{
+	if (failed) {
+		AVB_LOGF_ERROR("mrpd rejected %d of %d %s", failed, processed, (const char *)arg);
+	}
+	else {
+		AVB_LOGF_DEBUG("mrpd accepted %d %s", processed, (const char *)arg);
+	}
+}
+
 openavbRC openavbSrpInitialize(strmAttachCb_t attachCb, strmRegCb_t registerCb,
                                char* ifname, U32 TxRateKbps, bool bypassAsCapableCheck)
 {
@@ -285,15 +296,21 @@ openavbRC openavbSrpInitialize(strmAttachCb_t attachCb, strmRegCb_t registerCb,
 	AVB_LOGF_INFO("detected domain Class A PRIO=%d VID=%04x...", a_priority, (int)a_vid);
 	AVB_LOGF_INFO("detected domain Class B PRIO=%d VID=%04x...", b_priority, (int)b_vid);
 
-	err = mrp_register_domain(&domain_class_a_id, &domain_class_a_priority, &domain_class_a_vid);
-	if (err) {
-		AVB_LOG_DEBUG("mrp_register_domain failed");
-		goto error;
-	}
-
-	err = mrp_register_domain(&domain_class_b_id, &domain_class_b_priority, &domain_class_b_vid);
+	// Both domains go out in one frame, their outcome is only logged
+	struct mrp_decl domains[2];
+	memset(domains, 0, sizeof(domains));
+	domains[0].type = MRP_DECL_DOMAIN;
+	domains[0].class_id = domain_class_a_id;
+	domains[0].priority = domain_class_a_priority;
+	domains[0].vlan = domain_class_a_vid;
+	domains[1].type = MRP_DECL_DOMAIN;
+	domains[1].class_id = domain_class_b_id;
+	domains[1].priority = domain_class_b_priority;
+	domains[1].vlan = domain_class_b_vid;
+
+	err = mrp_submit(domains, 2, x_mrpDone, "domain declarations");
 	if (err) {
-		AVB_LOG_DEBUG("mrp_register_domain failed");
+		AVB_LOG_DEBUG("mrp_submit of the domains failed");
 		goto error;
 	}
 
@@ -491,6 +508,26 @@ openavbRC openavbSrpDetachStream(AVBStreamID_t* _streamId)
 	return OPENAVB_SRP_SUCCESS;
 }
 
+void openavbSrpBatchBegin(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_SRP_PUBLIC);
+	mrp_batch_begin();
+	AVB_TRACE_EXIT(AVB_TRACE_SRP_PUBLIC);
+}
+
+openavbRC openavbSrpBatchFlush(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_SRP_PUBLIC);
+	int err = mrp_batch_flush_async(x_mrpDone, "stream declarations");
+	if (err) {
+		AVB_LOG_ERROR("mrp_batch_flush_async failed");
+		AVB_TRACE_EXIT(AVB_TRACE_SRP_PUBLIC);
+		return OPENAVB_SRP_FAILURE;
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_SRP_PUBLIC);
+	return OPENAVB_SRP_SUCCESS;
+}
+
 openavbRC openavbSrpGetClassParams(SRClassIdx_t SRClassIdx, U8* priority, U16* vid, U32* inverseIntervalSec)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_SRP_PUBLIC);
@@ -47,11 +47,13 @@ typedef struct {
 		openavbEndpointParams_ListenerAttach_t		listenerAttach;
 		openavbEndpointParams_ClientStop_t			clientStop;
 		openavbEndpointParams_VersionRequest_t		versionRequest;
+		openavbEndpointParams_ClientStats_t			clientStats;
 
 		// Server messages
 		openavbEndpointParams_TalkerCallback_t		talkerCallback;
 		openavbEndpointParams_ListenerCallback_t	listenerCallback;
 		openavbEndpointParams_VersionCallback_t		versionCallback;
+		openavbEndpointParams_AcmpCallback_t		acmpCallback;
 	} params;
 } openavbEndpointMessage_t;
 
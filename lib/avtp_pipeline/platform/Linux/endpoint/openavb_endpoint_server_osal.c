@@ -31,26 +31,78 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #ifndef OPENAVB_ENDPOINT_SERVER_OSAL_C
 #define OPENAVB_ENDPOINT_SERVER_OSAL_C
 
-#define AVB_ENDPOINT_LISTEN_FDS	0 // first fds, was last MAX_AVB_STREAMS
+#include <sys/epoll.h>
+
+#define AVB_ENDPOINT_LISTEN_FDS	0 // first handle, clients get the ones after it
+#define AVB_ENDPOINT_AVDECC_EVENT	0xFFFFFFFF // epoll tag of the AVDECC socket, never a handle
 #define SOCK_INVALID (-1)
-#define POLL_FD_COUNT ((MAX_AVB_STREAMS) + 1)
+
+// Handle table size to start with; it doubles whenever it fills up
+#define EPT_SRVR_INITIAL_HANDLES	((MAX_AVB_STREAMS) + 1)
+
+// Messages read from one client before moving on to the others; a client
+// with more queued stays on the ready list for the next service call
+#define EPT_SRVR_BATCH_MSGS		8
+
+// epoll events handled per service call
+#define EPT_SRVR_MAX_EVENTS		32
+
+// Clients are edge triggered, so their data is drained here rather than
+// re-reported by every epoll_wait. A partial message is kept until the rest
+// of it arrives.
+typedef struct {
+	int fd;
+	bool ready;					// on the ready list, more data may be queued
+	size_t rxLen;				// bytes of rxMsg received so far
+	openavbEndpointMessage_t rxMsg;
+} eptSrvrClient_t;
 
 static int lsock  = SOCK_INVALID;
-static struct pollfd fds[POLL_FD_COUNT];
+static int epfd = SOCK_INVALID;
+static eptSrvrClient_t *clients;
+static int nClients;				// size of clients, handles are indexes
+static int *readyList;				// handles with data left after their batch
+static int nReady;
 static struct sockaddr_un serverAddr;
 
+static bool x_clientsGrow(void)
+{
+	int n = nClients ? nClients * 2 : EPT_SRVR_INITIAL_HANDLES;
+	eptSrvrClient_t *newClients = realloc(clients, n * sizeof(*clients));
+	if (!newClients) {
+		return FALSE;
+	}
+	clients = newClients;
+
+	int *newReady = realloc(readyList, n * sizeof(*readyList));
+	if (!newReady) {
+		return FALSE;
+	}
+	readyList = newReady;
+
+	for (int i = nClients; i < n; i++) {
+		clients[i].fd = SOCK_INVALID;
+		clients[i].ready = FALSE;
+		clients[i].rxLen = 0;
+	}
+	nClients = n;
+	return TRUE;
+}
+
 static void socketClose(int h)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
 
-	if (h < 0 || h >= POLL_FD_COUNT) {
+	if (h <= AVB_ENDPOINT_LISTEN_FDS || h >= nClients || clients[h].fd == SOCK_INVALID) {
 		AVB_LOG_ERROR("Closing socket; invalid handle");
 	}
 	else {
 		openavbEptSrvrCloseClientConnection(h);
-		close(fds[h].fd);
-		fds[h].fd = SOCK_INVALID;
-		fds[h].events = 0;
+		epoll_ctl(epfd, EPOLL_CTL_DEL, clients[h].fd, NULL);
+		close(clients[h].fd);
+		clients[h].fd = SOCK_INVALID;
+		// Left on the ready list, it is skipped there once the fd is gone
+		clients[h].rxLen = 0;
 	}
 	
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
@@ -60,7 +112,7 @@ static bool openavbEptSrvrSendToClient(int h, openavbEndpointMessage_t *msg)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
 
-	if (h < 0 || h >= POLL_FD_COUNT) {
+	if (h <= AVB_ENDPOINT_LISTEN_FDS || h >= nClients) {
 		AVB_LOG_ERROR("Sending message; invalid handle");
 		AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
 		return FALSE;
@@ -71,7 +123,7 @@ static bool openavbEptSrvrSendToClient(int h, openavbEndpointMessage_t *msg)
 		return FALSE;
 	}
 
-	int csock = fds[h].fd;
+	int csock = clients[h].fd;
 	if (csock == SOCK_INVALID) {
 		AVB_LOG_ERROR("Socket closed unexpectedly");
 		return FALSE;
@@ -101,11 +153,17 @@ static bool openavbEptSrvrSendToClient(int h, openavbEndpointMessage_t *msg)
 bool openavbEndpointServerOpen(void)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
-	int i;
+	struct epoll_event ev;
 
-	for (i=0; i < POLL_FD_COUNT; i++) {
-		fds[i].fd = SOCK_INVALID;
-		fds[i].events = 0;
+	if (!x_clientsGrow()) {
+		AVB_LOG_ERROR("Failed to allocate client table");
+		goto error;
+	}
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		AVB_LOGF_ERROR("Failed to create epoll instance: %s", strerror(errno));
+		goto error;
 	}
 
 	lsock = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -131,8 +189,26 @@ bool openavbEndpointServerOpen(void)
 	}
 	AVB_LOGF_DEBUG("Listening on socket: %s", serverAddr.sun_path);
 
-	fds[AVB_ENDPOINT_LISTEN_FDS].fd = lsock;
-	fds[AVB_ENDPOINT_LISTEN_FDS].events = POLLIN;
+	// The listen socket stays level triggered, one accept per wakeup
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u32 = AVB_ENDPOINT_LISTEN_FDS;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, lsock, &ev) != 0) {
+		AVB_LOGF_ERROR("Failed to watch listen socket: %s", strerror(errno));
+		goto error;
+	}
+	clients[AVB_ENDPOINT_LISTEN_FDS].fd = lsock;
+
+	int avdeccSock = openavbAvdeccGetSocket();
+	if (avdeccSock >= 0) {
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.u32 = AVB_ENDPOINT_AVDECC_EVENT;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, avdeccSock, &ev) != 0) {
+			AVB_LOGF_ERROR("Failed to watch AVDECC socket: %s", strerror(errno));
+			goto error;
+		}
+	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
 	return TRUE;
@@ -142,93 +218,202 @@ bool openavbEndpointServerOpen(void)
 		close(lsock);
 		lsock = -1;
 	}
+	if (epfd >= 0) {
+		close(epfd);
+		epfd = -1;
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
 	return FALSE;
 }
+
+static void x_acceptClient(void)
+{
+	struct sockaddr_un addrClient;
+	socklen_t lenAddr = sizeof(addrClient);
+	struct epoll_event ev;
+	int h;
+
+	int csock = accept(lsock, (struct sockaddr*)&addrClient, &lenAddr);
+	if (csock < 0) {
+		AVB_LOGF_ERROR("Failed to accept connection: %s", strerror(errno));
+		return;
+	}
+
+	for (h = AVB_ENDPOINT_LISTEN_FDS + 1; h < nClients; h++) {
+		if (clients[h].fd == SOCK_INVALID && !clients[h].ready) {
+			break;
+		}
+	}
+	if (h >= nClients && !x_clientsGrow()) {
+		AVB_LOG_ERROR("Too many client connections");
+		close(csock);
+		return;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+	ev.data.u32 = h;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, csock, &ev) != 0) {
+		AVB_LOGF_ERROR("Failed to watch client socket: %s", strerror(errno));
+		close(csock);
+		return;
+	}
+	clients[h].fd = csock;
+	clients[h].rxLen = 0;
+	AVB_LOGF_DEBUG("Client connected, h=%d", h);
+}
+
+// Reads and handles up to EPT_SRVR_BATCH_MSGS messages from a client.
+// Returns TRUE if it stopped at the batch limit with data possibly left.
+static bool x_serviceClient(int h)
+{
+	openavbEndpointMessage_t batch[EPT_SRVR_BATCH_MSGS];
+	eptSrvrClient_t *c = &clients[h];
+
+	// Top up a partial message first so the batch stays message aligned
+	while (c->rxLen > 0 && c->fd != SOCK_INVALID) {
+		ssize_t nRead = recv(c->fd, (U8 *)&c->rxMsg + c->rxLen, OPENAVB_ENDPOINT_MSG_LEN - c->rxLen, MSG_DONTWAIT);
+		if (nRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return FALSE;
+		}
+		if (nRead <= 0) {
+			if (nRead == 0) {
+				AVB_LOGF_ERROR("Short read, h=%d", h);
+			}
+			else {
+				AVB_LOGF_ERROR("Socket read, h=%d: %s", h, strerror(errno));
+			}
+			socketClose(h);
+			return FALSE;
+		}
+		c->rxLen += nRead;
+		if (c->rxLen < OPENAVB_ENDPOINT_MSG_LEN) {
+			continue;
+		}
+		c->rxLen = 0;
+		if (!openavbEptSrvrReceiveFromClient(h, &c->rxMsg)) {
+			AVB_LOG_ERROR("Failed to handle message");
+			socketClose(h);
+			return FALSE;
+		}
+	}
+	if (c->fd == SOCK_INVALID) {
+		return FALSE;
+	}
+
+	ssize_t nRead = recv(c->fd, batch, sizeof(batch), MSG_DONTWAIT);
+	AVB_LOGF_VERBOSE("Socket read h=%d,fd=%d: read=%zd, expect=%zu", h, c->fd, nRead, OPENAVB_ENDPOINT_MSG_LEN);
+	if (nRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		return FALSE;
+	}
+	if (nRead <= 0) {
+		// sock closed
+		if (nRead == 0) {
+			AVB_LOGF_DEBUG("Socket closed, h=%d", h);
+		}
+		else {
+			AVB_LOGF_ERROR("Socket read, h=%d: %s", h, strerror(errno));
+		}
+		socketClose(h);
+		return FALSE;
+	}
+
+	size_t nMsgs = nRead / OPENAVB_ENDPOINT_MSG_LEN;
+	for (size_t i = 0; i < nMsgs; i++) {
+		// got a message
+		if (!openavbEptSrvrReceiveFromClient(h, &batch[i])) {
+			AVB_LOG_ERROR("Failed to handle message");
+			socketClose(h);
+			return FALSE;
+		}
+		if (c->fd == SOCK_INVALID) {
+			// A handler dropped the client
+			return FALSE;
+		}
+	}
+
+	c->rxLen = nRead % OPENAVB_ENDPOINT_MSG_LEN;
+	if (c->rxLen) {
+		memcpy(&c->rxMsg, &batch[nMsgs], c->rxLen);
+	}
+
+	// A full buffer means the socket may not be drained yet
+	return (size_t)nRead == sizeof(batch);
+}
+
+static void x_markReady(int h)
+{
+	if (!clients[h].ready) {
+		clients[h].ready = TRUE;
+		readyList[nReady++] = h;
+	}
+}
  
 void openavbEptSrvrService(void)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
-	struct sockaddr_un addrClient;
-	socklen_t lenAddr;
-	int i, j;
-	int  csock;
-
-	int nfds = POLL_FD_COUNT;
-	int pRet;
+	struct epoll_event events[EPT_SRVR_MAX_EVENTS];
+	bool bAvdeccRx = FALSE;
+	int i;
 
+	// Clients left over from the last batch need servicing without waiting,
+	// and the AVDECC entity may have a timeout coming up
 	AVB_LOG_VERBOSE("Waiting for event...");
-	pRet = poll(fds, nfds, 1000);
+	int nEvents = epoll_wait(epfd, events, EPT_SRVR_MAX_EVENTS, nReady ? 0 : openavbAvdeccTimeoutMsec(1000));
 
-	if (pRet == 0) {
-		AVB_LOG_VERBOSE("poll timeout");
+	if (nEvents == 0) {
+		AVB_LOG_VERBOSE("epoll timeout");
 	}
-	else if (pRet < 0) {
+	else if (nEvents < 0) {
 		if (errno == EINTR) {
-			AVB_LOG_VERBOSE("Poll interrupted");
+			AVB_LOG_VERBOSE("epoll interrupted");
 		}
 		else {
-			AVB_LOGF_ERROR("Poll error: %s", strerror(errno));
+			AVB_LOGF_ERROR("epoll error: %s", strerror(errno));
 		}
+		nEvents = 0;
 	}
 	else {
-		AVB_LOGF_VERBOSE("Poll returned %d events", pRet);
-		for (i=0; i<nfds; i++) {
-			if (fds[i].revents != 0) {
-				AVB_LOGF_VERBOSE("%d sock=%d, event=0x%x, revent=0x%x", i, fds[i].fd, fds[i].events, fds[i].revents);
-
-				if (i == AVB_ENDPOINT_LISTEN_FDS) {
-					// listen sock - indicates new connection from client
-					lenAddr = sizeof(addrClient);
-					csock = accept(lsock, (struct sockaddr*)&addrClient, &lenAddr);
-					if (csock < 0) {
-						AVB_LOGF_ERROR("Failed to accept connection: %s", strerror(errno));
-					}
-					else {
-						for (j = 0; j < POLL_FD_COUNT; j++) {
-							if (fds[j].fd == SOCK_INVALID) {
-								fds[j].fd = csock;
-								fds[j].events = POLLIN;
-								break;
-							}
-						}
-						if (j >= POLL_FD_COUNT) {
-							AVB_LOG_ERROR("Too many client connections");
-							close(csock);
-						}
-					}
-				}
-				else {
-					csock = fds[i].fd;
-					openavbEndpointMessage_t  msgBuf;
-					memset(&msgBuf, 0, OPENAVB_ENDPOINT_MSG_LEN);
-					ssize_t nRead = read(csock, &msgBuf, OPENAVB_ENDPOINT_MSG_LEN);
-					AVB_LOGF_VERBOSE("Socket read h=%d,fd=%d: read=%zu, expect=%zu", i, csock, nRead, OPENAVB_ENDPOINT_MSG_LEN);
-					
-					if (nRead < OPENAVB_ENDPOINT_MSG_LEN) {
-						// sock closed
-						if (nRead == 0) {
-							AVB_LOGF_DEBUG("Socket closed, h=%d", i);
-						}
-						else if (nRead < 0) {
-							AVB_LOGF_ERROR("Socket read, h=%d: %s", i, strerror(errno));
-						}
-						else {
-							AVB_LOGF_ERROR("Short read, h=%d", i);
-						}
-						socketClose(i);
-					}
-					else {
-						// got a message
-						if (!openavbEptSrvrReceiveFromClient(i, &msgBuf)) {
-							AVB_LOG_ERROR("Failed to handle message");
-							socketClose(i);
-						}
-					}
-				}
-			}
+		AVB_LOGF_VERBOSE("epoll returned %d events", nEvents);
+	}
+
+	for (i = 0; i < nEvents; i++) {
+		if (events[i].data.u32 == AVB_ENDPOINT_AVDECC_EVENT) {
+			bAvdeccRx = TRUE;
+			continue;
+		}
+
+		int h = events[i].data.u32;
+		AVB_LOGF_VERBOSE("%d sock=%d, revent=0x%x", h, h < nClients ? clients[h].fd : SOCK_INVALID, events[i].events);
+
+		if (h == AVB_ENDPOINT_LISTEN_FDS) {
+			// listen sock - indicates new connection from client
+			x_acceptClient();
+		}
+		else if (h < nClients && clients[h].fd != SOCK_INVALID) {
+			x_markReady(h);
 		}
 	}
+
+	// One batch per ready client, in the order they became ready. Clients
+	// that still have data stay on the list for the next call. The SRP
+	// declarations they cause go out together once all have been serviced,
+	// so streams coming up at the same time are not declared one by one.
+	openavbSrpBatchBegin();
+	int nKeep = 0;
+	for (i = 0; i < nReady; i++) {
+		int h = readyList[i];
+		clients[h].ready = FALSE;
+		if (clients[h].fd != SOCK_INVALID && x_serviceClient(h)) {
+			clients[h].ready = TRUE;
+			readyList[nKeep++] = h;
+		}
+	}
+	nReady = nKeep;
+	openavbSrpBatchFlush();
+
+	openavbAvdeccService(bAvdeccRx);
+
 	AVB_TRACE_EXIT(AVB_TRACE_ENDPOINT);
 }
 
@@ -236,14 +421,23 @@ void openavbEndpointServerClose(void)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_ENDPOINT);
 	int i;
-	for (i = 0; i < POLL_FD_COUNT; i++) {
-		if (fds[i].fd != SOCK_INVALID) {
-			close(fds[i].fd);
+	for (i = AVB_ENDPOINT_LISTEN_FDS + 1; i < nClients; i++) {
+		if (clients[i].fd != SOCK_INVALID) {
+			close(clients[i].fd);
 		}
 	}
 	if (lsock != SOCK_INVALID) {
 		close(lsock);
 	}
+	if (epfd != SOCK_INVALID) {
+		close(epfd);
+		epfd = SOCK_INVALID;
+	}
+	free(clients);
+	clients = NULL;
+	free(readyList);
+	readyList = NULL;
+	nClients = nReady = 0;
 
 	if (unlink(serverAddr.sun_path) != 0) {
 		AVB_LOGF_ERROR("Failed to unlink %s: %s", serverAddr.sun_path, strerror(errno));
@@ -35,6 +35,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "openavb_platform_pub.h"
 #include "openavb_types_pub.h"
 #include "openavb_audio_pub.h"
 #include "openavb_trace_pub.h"
@@ -42,6 +45,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_map_uncmp_audio_pub.h"
 #include "openavb_map_aaf_audio_pub.h"
 #include "openavb_intf_pub.h"
+#include "openavb_audio_conv_pub.h"
+#include "openavb_mcr_hal_pub.h"
+#include "openavb_intf_alsa_mix.h"
 
 #define	AVB_LOG_COMPONENT	"ALSA Interface"
 #include "openavb_log_pub.h"
@@ -84,6 +90,40 @@ typedef struct {
 
 	U32 periodTimeUsec;
 
+	// intf_nv_sw_byteswap
+	bool swByteSwap;
+
+	// intf_nv_mmap
+	bool mmap;
+
+	// intf_nv_present_timer
+	bool presentTimer;
+
+	// intf_nv_mcr_ctl, ALSA control steered to the recovered media clock
+	char *pMcrCtl;
+
+	// intf_nv_mcr_ctl_nominal, control value for the nominal rate
+	long mcrCtlNominal;
+
+	// intf_nv_tx_lead_usec, talker lead the capture side keeps topped up
+	U32 txLeadUsec;
+
+	// intf_nv_mix_group, device shared with the listeners of the same group
+	char *pMixGroup;
+
+	// intf_nv_mix_channels, device channels of the group (0: the stream's)
+	U32 mixChannels;
+
+	// intf_nv_mix_route, device channel of each stream channel
+	U8 mixRoute[ALSA_MIX_MAX_CHANNELS];
+	U32 mixRouteCount;
+
+	// intf_nv_mix_gain, linear gain of the stream in the mix
+	float mixGain;
+
+	// intf_nv_mix_latency_usec, device buffer of the group
+	U32 mixLatencyUsec;
+
 	/////////////
 	// Variable data
 	/////////////
@@ -95,8 +135,198 @@ typedef struct {
 
 	// ALSA read/write interval
 	U32 intervalCounter;
+
+	// Media queued for transmit, as last reported by the talker
+	U32 txAheadUsec;
+
+	// Samples are swapped in software between the PCM and the media queue
+	bool swapSamples;
+
+	// Playback buffer size and start threshold in frames (mmap mode)
+	snd_pcm_uframes_t bufferFrames;
+	snd_pcm_uframes_t startFrames;
+
+	// Presentation timer thread (intf_nv_present_timer)
+	media_q_t *pMediaQ;
+	pthread_t presentThread;
+	bool presentRunning;
+	int presentTimerFd;
+
+	// Time from writing a frame to it reaching the DAC, tracked from
+	// snd_pcm_htimestamp() and used as the write lead.
+	S64 presentLeadNsec;
+
+	// Last measured difference between actual and requested playout time
+	S64 playoutOffsetNsec;
+
+	// Rate control for media clock recovery
+	snd_ctl_t *mcrCtlHandle;
+	snd_ctl_elem_value_t *mcrCtlValue;
+	long mcrCtlLast;
+
+	// Mix group membership (intf_nv_mix_group)
+	alsa_mix_member_t *pMix;
 } pvt_data_t;
 
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_AUDIO_ENDIAN AVB_AUDIO_ENDIAN_BIG
+#else
+#define HOST_AUDIO_ENDIAN AVB_AUDIO_ENDIAN_LITTLE
+#endif
+
+// Endianess to open the PCM with. With intf_nv_sw_byteswap a foreign
+// endianess is converted here instead of in the ALSA plug layer.
+static avb_audio_endian_t x_pcmEndian(pvt_data_t *pPvtData)
+{
+	pPvtData->swapSamples = pPvtData->swByteSwap
+		&& pPvtData->audioEndian != AVB_AUDIO_ENDIAN_UNSPEC
+		&& pPvtData->audioEndian != HOST_AUDIO_ENDIAN
+		&& pPvtData->audioBitDepth != AVB_AUDIO_BIT_DEPTH_8BIT;
+	return pPvtData->swapSamples ? HOST_AUDIO_ENDIAN : pPvtData->audioEndian;
+}
+
+static void x_swapSamples(media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo, void *pData, U32 frames)
+{
+	U32 samples = frames * pPubMapUncmpAudioInfo->audioChannels;
+
+	switch (pPubMapUncmpAudioInfo->itemSampleSizeBytes) {
+		case 2:
+			openavbAudioConvSwap16(pData, pData, samples);
+			break;
+		case 3:
+			openavbAudioConvSwap24(pData, pData, samples);
+			break;
+		case 4:
+			openavbAudioConvSwap32(pData, pData, samples);
+			break;
+		default:
+			break;
+	}
+}
+
+// Use direct DMA ring access when intf_nv_mmap is set. Devices that cannot
+// do mmap access fall back to the read/write interface.
+static int x_setAccess(pvt_data_t *pPvtData, snd_pcm_hw_params_t *hwParams)
+{
+	if (pPvtData->mmap) {
+		int rslt = snd_pcm_hw_params_set_access(pPvtData->pcmHandle, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+		if (rslt == 0) {
+			return 0;
+		}
+		AVB_LOGF_WARNING("mmap access not supported by %s (%s), using read/write access", pPvtData->pDeviceName, snd_strerror(rslt));
+		pPvtData->mmap = FALSE;
+	}
+	return snd_pcm_hw_params_set_access(pPvtData->pcmHandle, hwParams, PCM_ACCESS_TYPE);
+}
+
+static U8 *x_mmapAddr(const snd_pcm_channel_area_t *pAreas, snd_pcm_uframes_t offset)
+{
+	return (U8 *)pAreas[0].addr + (pAreas[0].first + offset * pAreas[0].step) / 8;
+}
+
+// Capture counterpart of snd_pcm_readi() in mmap mode. Copies up to frames
+// out of the DMA ring into pData without blocking. The ring may wrap so this
+// can take two mmap_begin/commit rounds.
+static snd_pcm_sframes_t x_mmapRead(pvt_data_t *pPvtData, U8 *pData, snd_pcm_uframes_t frames, U32 frameBytes)
+{
+	const snd_pcm_channel_area_t *pAreas;
+	snd_pcm_uframes_t offset, n, done = 0;
+	snd_pcm_sframes_t avail, rslt;
+
+	// Unlike snd_pcm_readi() mmap capture is not started implicitly
+	if (snd_pcm_state(pPvtData->pcmHandle) == SND_PCM_STATE_PREPARED) {
+		rslt = snd_pcm_start(pPvtData->pcmHandle);
+		if (rslt < 0) {
+			return rslt;
+		}
+	}
+
+	avail = snd_pcm_avail_update(pPvtData->pcmHandle);
+	if (avail < 0) {
+		return avail;
+	}
+	if (avail == 0) {
+		return -EAGAIN;
+	}
+
+	while (done < frames && avail > 0) {
+		n = frames - done;
+		if (n > (snd_pcm_uframes_t)avail) {
+			n = avail;
+		}
+		rslt = snd_pcm_mmap_begin(pPvtData->pcmHandle, &pAreas, &offset, &n);
+		if (rslt < 0) {
+			return done ? (snd_pcm_sframes_t)done : rslt;
+		}
+		memcpy(pData + done * frameBytes, x_mmapAddr(pAreas, offset), n * frameBytes);
+		rslt = snd_pcm_mmap_commit(pPvtData->pcmHandle, offset, n);
+		if (rslt < 0) {
+			return done ? (snd_pcm_sframes_t)done : rslt;
+		}
+		done += rslt;
+		avail -= rslt;
+	}
+
+	return done;
+}
+
+// Playback counterpart of snd_pcm_writei() in mmap mode. Blocks until all
+// frames are copied into the DMA ring and starts the PCM once the start
+// threshold is queued.
+static snd_pcm_sframes_t x_mmapWrite(pvt_data_t *pPvtData, U8 *pData, snd_pcm_uframes_t frames, U32 frameBytes)
+{
+	const snd_pcm_channel_area_t *pAreas;
+	snd_pcm_uframes_t offset, n, done = 0;
+	snd_pcm_sframes_t avail, rslt;
+
+	while (done < frames) {
+		avail = snd_pcm_avail_update(pPvtData->pcmHandle);
+		if (avail < 0) {
+			return avail;
+		}
+
+		if (snd_pcm_state(pPvtData->pcmHandle) == SND_PCM_STATE_PREPARED
+			&& (avail == 0 || pPvtData->bufferFrames - avail >= pPvtData->startFrames)) {
+			rslt = snd_pcm_start(pPvtData->pcmHandle);
+			if (rslt < 0) {
+				return rslt;
+			}
+		}
+
+		if (avail == 0) {
+			rslt = snd_pcm_wait(pPvtData->pcmHandle, 1000);
+			if (rslt < 0) {
+				return rslt;
+			}
+			continue;
+		}
+
+		n = frames - done;
+		if (n > (snd_pcm_uframes_t)avail) {
+			n = avail;
+		}
+		rslt = snd_pcm_mmap_begin(pPvtData->pcmHandle, &pAreas, &offset, &n);
+		if (rslt < 0) {
+			return rslt;
+		}
+		memcpy(x_mmapAddr(pAreas, offset), pData + done * frameBytes, n * frameBytes);
+		rslt = snd_pcm_mmap_commit(pPvtData->pcmHandle, offset, n);
+		if (rslt < 0) {
+			return rslt;
+		}
+		done += rslt;
+	}
+
+	if (snd_pcm_state(pPvtData->pcmHandle) == SND_PCM_STATE_PREPARED) {
+		avail = snd_pcm_avail_update(pPvtData->pcmHandle);
+		if (avail >= 0 && pPvtData->bufferFrames - avail >= pPvtData->startFrames) {
+			snd_pcm_start(pPvtData->pcmHandle);
+		}
+	}
+
+	return done;
+}
+
 
 static snd_pcm_format_t x_AVBAudioFormatToAlsaFormat(avb_audio_type_t type,
 											  avb_audio_bit_depth_t bitDepth,
@@ -380,6 +610,90 @@ void openavbIntfAlsaCfgCB(media_q_t *pMediaQ, const char *name, const char *valu
 			pPvtData->periodTimeUsec = strtol(value, &pEnd, 10);
 		}
 
+		else if (strcmp(name, "intf_nv_sw_byteswap") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp == 1) {
+				pPvtData->swByteSwap = (tmp == 1);
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_tx_lead_usec") == 0) {
+			pPvtData->txLeadUsec = strtoul(value, &pEnd, 10);
+		}
+
+		else if (strcmp(name, "intf_nv_mmap") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp == 1) {
+				pPvtData->mmap = (tmp == 1);
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_mcr_ctl") == 0) {
+			if (pPvtData->pMcrCtl)
+				free(pPvtData->pMcrCtl);
+			pPvtData->pMcrCtl = strdup(value);
+		}
+
+		else if (strcmp(name, "intf_nv_mcr_ctl_nominal") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp > 0) {
+				pPvtData->mcrCtlNominal = tmp;
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_present_timer") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp == 1) {
+				pPvtData->presentTimer = (tmp == 1);
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_mix_group") == 0) {
+			if (pPvtData->pMixGroup)
+				free(pPvtData->pMixGroup);
+			pPvtData->pMixGroup = strdup(value);
+		}
+
+		else if (strcmp(name, "intf_nv_mix_channels") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp > 0 && tmp <= ALSA_MIX_MAX_CHANNELS) {
+				pPvtData->mixChannels = tmp;
+			}
+			else {
+				AVB_LOG_ERROR("Invalid intf_nv_mix_channels.");
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_mix_route") == 0) {
+			// Comma separated device channels, e.g. 2,3
+			const char *p = value;
+			pPvtData->mixRouteCount = 0;
+			while (*p && pPvtData->mixRouteCount < ALSA_MIX_MAX_CHANNELS) {
+				tmp = strtol(p, &pEnd, 10);
+				if (pEnd == p || tmp < 0 || tmp >= ALSA_MIX_MAX_CHANNELS) {
+					AVB_LOGF_ERROR("Invalid intf_nv_mix_route: %s", value);
+					pPvtData->mixRouteCount = 0;
+					break;
+				}
+				pPvtData->mixRoute[pPvtData->mixRouteCount++] = tmp;
+				p = *pEnd == ',' ? pEnd + 1 : pEnd;
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_mix_gain") == 0) {
+			float gain = strtof(value, &pEnd);
+			if (*pEnd == '\0' && gain >= 0) {
+				pPvtData->mixGain = gain;
+			}
+		}
+
+		else if (strcmp(name, "intf_nv_mix_latency_usec") == 0) {
+			tmp = strtol(value, &pEnd, 10);
+			if (*pEnd == '\0' && tmp > 0) {
+				pPvtData->mixLatencyUsec = tmp;
+			}
+		}
+
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -452,7 +766,7 @@ void openavbIntfAlsaTxInitCB(media_q_t *pMediaQ)
 		}
 
 		// Set the access type
-		rslt = snd_pcm_hw_params_set_access(pPvtData->pcmHandle, hwParams, PCM_ACCESS_TYPE);
+		rslt = x_setAccess(pPvtData, hwParams);
 		if (rslt < 0) {
 			AVB_LOGF_ERROR("snd_pcm_hw_params_set_access() error: %s", snd_strerror(rslt));
 			snd_pcm_close(pPvtData->pcmHandle);
@@ -466,7 +780,7 @@ void openavbIntfAlsaTxInitCB(media_q_t *pMediaQ)
 		// Set the sample format
 		int fmt = x_AVBAudioFormatToAlsaFormat(pPvtData->audioType,
 											   pPvtData->audioBitDepth,
-											   pPvtData->audioEndian, 
+											   x_pcmEndian(pPvtData),
 											   pMediaQ->pMediaQDataFormat);
 		rslt = snd_pcm_hw_params_set_format(pPvtData->pcmHandle, hwParams, fmt);
 		if (rslt < 0) {
@@ -542,17 +856,88 @@ void openavbIntfAlsaTxInitCB(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
 
+// Talker feedback: how much media is already queued for transmit
+void openavbIntfAlsaTxAheadCB(media_q_t *pMediaQ, U32 aheadUsec)
+{
+	if (pMediaQ && pMediaQ->pPvtIntfInfo) {
+		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+		pPvtData->txAheadUsec = aheadUsec;
+	}
+}
+
+// Capture into the head item of the media queue and push it once complete.
+// backlogFrames is how many captured frames are still held by ALSA past
+// this item, which dates the item that much earlier than now.
+static bool x_captureItem(media_q_t *pMediaQ, pvt_data_t *pPvtData, U32 backlogFrames, bool *pPushed)
+{
+	media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo = pMediaQ->pPubMapInfo;
+	media_q_item_t *pMediaQItem;
+	S32 rslt;
+
+	*pPushed = FALSE;
+
+	pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (pMediaQItem) {
+		if (pMediaQItem->itemSize < pPubMapUncmpAudioInfo->itemSize) {
+			AVB_LOG_ERROR("Media queue item not large enough for samples");
+		}
+
+		if (pPvtData->mmap) {
+			// With a lent head item this copies the DMA ring straight into the AVTP frame
+			rslt = x_mmapRead(pPvtData, pMediaQItem->pPubData + pMediaQItem->dataLen, pPubMapUncmpAudioInfo->framesPerItem - (pMediaQItem->dataLen / pPubMapUncmpAudioInfo->itemFrameSizeBytes), pPubMapUncmpAudioInfo->itemFrameSizeBytes);
+		}
+		else {
+			rslt = snd_pcm_readi(pPvtData->pcmHandle, pMediaQItem->pPubData + pMediaQItem->dataLen, pPubMapUncmpAudioInfo->framesPerItem - (pMediaQItem->dataLen / pPubMapUncmpAudioInfo->itemFrameSizeBytes));
+		}
+
+		if (rslt == -EPIPE) {
+			AVB_LOGF_ERROR("%s error: %s", pPvtData->mmap ? "snd_pcm_mmap_begin()" : "snd_pcm_readi()", snd_strerror(rslt));
+			rslt = snd_pcm_recover(pPvtData->pcmHandle, rslt, 0);
+			if (rslt < 0) {
+				AVB_LOGF_ERROR("snd_pcm_recover: %s", snd_strerror(rslt));
+			}
+			openavbMediaQHeadUnlock(pMediaQ);
+			return FALSE;
+		}
+		if (rslt < 0) {
+			openavbMediaQHeadUnlock(pMediaQ);
+			return FALSE;
+		}
+
+		if (pPvtData->swapSamples) {
+			x_swapSamples(pPubMapUncmpAudioInfo, pMediaQItem->pPubData + pMediaQItem->dataLen, rslt);
+		}
+
+		pMediaQItem->dataLen += rslt * pPubMapUncmpAudioInfo->itemFrameSizeBytes;
+		if (pMediaQItem->dataLen != pPubMapUncmpAudioInfo->itemSize) {
+			openavbMediaQHeadUnlock(pMediaQ);
+			return TRUE;
+		}
+		else {
+			openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+			if (backlogFrames) {
+				openavbAvtpTimeSubNSec(pMediaQItem->pAvtpTime, (long)((U64)backlogFrames * NANOSECONDS_PER_SECOND / pPvtData->audioRate));
+			}
+			openavbMediaQHeadPush(pMediaQ);
+			*pPushed = TRUE;
+			return TRUE;
+		}
+	}
+	else {
+		return FALSE;	// Media queue full
+	}
+}
+
 // This callback will be called for each AVB transmit interval. 
 bool openavbIntfAlsaTxCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
 
-	S32 rslt;
-
 	if (pMediaQ) {
 		media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo = pMediaQ->pPubMapInfo;
 		pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
 		media_q_item_t *pMediaQItem = NULL;
+		bool bRet, bPushed;
 		if (!pPvtData) {
 			AVB_LOG_ERROR("Private interface module data not allocated.");
 			return FALSE;
@@ -570,56 +955,309 @@ bool openavbIntfAlsaTxCB(media_q_t *pMediaQ)
 		if (pPvtData->intervalCounter++ % pPubMapUncmpAudioInfo->packingFactor != 0)
 			return TRUE;
 
-		pMediaQItem = openavbMediaQHeadLock(pMediaQ);
-		if (pMediaQItem) {
-			if (pMediaQItem->itemSize < pPubMapUncmpAudioInfo->itemSize) {
-				AVB_LOG_ERROR("Media queue item not large enough for samples");
-			}
+		if (pPvtData->txLeadUsec && pPvtData->txAheadUsec < pPvtData->txLeadUsec) {
+			// The talker is short of its lead: read as many whole items as
+			// make it up and ALSA has captured, not just this interval's.
+			U32 itemUsec = (U64)pPubMapUncmpAudioInfo->framesPerItem * MICROSECONDS_PER_SECOND / pPvtData->audioRate;
+			U32 nItems = 1 + (pPvtData->txLeadUsec - pPvtData->txAheadUsec) / (itemUsec ? itemUsec : 1);
+			snd_pcm_sframes_t avail = snd_pcm_avail_update(pPvtData->pcmHandle);
+			U32 backlog = avail > 0 ? avail : 0;
+			bool bAny = FALSE;
+
+			// Count what is read now as queued until the talker reports again
+			pPvtData->txAheadUsec = pPvtData->txLeadUsec;
+
+			do {
+				backlog = backlog > pPubMapUncmpAudioInfo->framesPerItem ? backlog - pPubMapUncmpAudioInfo->framesPerItem : 0;
+				bRet = x_captureItem(pMediaQ, pPvtData, backlog, &bPushed);
+				bAny |= bPushed;
+			} while (bRet && bPushed && --nItems);
+			bRet = bRet || bAny;
+		}
+		else {
+			bRet = x_captureItem(pMediaQ, pPvtData, 0, &bPushed);
+		}
 
-			rslt = snd_pcm_readi(pPvtData->pcmHandle, pMediaQItem->pPubData + pMediaQItem->dataLen, pPubMapUncmpAudioInfo->framesPerItem - (pMediaQItem->dataLen / pPubMapUncmpAudioInfo->itemFrameSizeBytes));
+		AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+		return bRet;
+	}
 
-			if (rslt == -EPIPE) {
-				AVB_LOGF_ERROR("snd_pcm_readi() error: %s", snd_strerror(rslt));
-				rslt = snd_pcm_recover(pPvtData->pcmHandle, rslt, 0);
-				if (rslt < 0) {
-					AVB_LOGF_ERROR("snd_pcm_recover: %s", snd_strerror(rslt));
-				}
-				openavbMediaQHeadUnlock(pMediaQ);
-				AVB_TRACE_EXIT(AVB_TRACE_INTF);
-				return FALSE;
+	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+	return FALSE;
+}
+
+// Open the control named by intf_nv_mcr_ctl on the card of the PCM, e.g.
+// "iface=PCM,name='PCM Rate Shift 100000'" of snd-aloop.
+static void x_mcrCtlOpen(pvt_data_t *pPvtData)
+{
+	snd_pcm_info_t *pcmInfo;
+	snd_ctl_elem_id_t *elemId;
+	char cardName[16];
+	int card = -1;
+
+	if (snd_pcm_info_malloc(&pcmInfo) == 0) {
+		if (snd_pcm_info(pPvtData->pcmHandle, pcmInfo) == 0) {
+			card = snd_pcm_info_get_card(pcmInfo);
+		}
+		snd_pcm_info_free(pcmInfo);
+	}
+	if (card < 0) {
+		AVB_LOGF_ERROR("No sound card behind %s for intf_nv_mcr_ctl", pPvtData->pDeviceName);
+		return;
+	}
+	snprintf(cardName, sizeof(cardName), "hw:%d", card);
+
+	if (snd_ctl_open(&pPvtData->mcrCtlHandle, cardName, 0) < 0) {
+		AVB_LOGF_ERROR("snd_ctl_open(%s) failed", cardName);
+		pPvtData->mcrCtlHandle = NULL;
+		return;
+	}
+
+	if (snd_ctl_elem_id_malloc(&elemId) < 0) {
+		snd_ctl_close(pPvtData->mcrCtlHandle);
+		pPvtData->mcrCtlHandle = NULL;
+		return;
+	}
+	if (snd_ctl_ascii_elem_id_parse(elemId, pPvtData->pMcrCtl) < 0
+		|| snd_ctl_elem_value_malloc(&pPvtData->mcrCtlValue) < 0) {
+		AVB_LOGF_ERROR("Invalid intf_nv_mcr_ctl: %s", pPvtData->pMcrCtl);
+		snd_ctl_elem_id_free(elemId);
+		snd_ctl_close(pPvtData->mcrCtlHandle);
+		pPvtData->mcrCtlHandle = NULL;
+		return;
+	}
+	snd_ctl_elem_value_set_id(pPvtData->mcrCtlValue, elemId);
+	snd_ctl_elem_id_free(elemId);
+	pPvtData->mcrCtlLast = 0;
+}
+
+static void x_mcrCtlClose(pvt_data_t *pPvtData)
+{
+	if (pPvtData->mcrCtlValue) {
+		snd_ctl_elem_value_free(pPvtData->mcrCtlValue);
+		pPvtData->mcrCtlValue = NULL;
+	}
+	if (pPvtData->mcrCtlHandle) {
+		snd_ctl_close(pPvtData->mcrCtlHandle);
+		pPvtData->mcrCtlHandle = NULL;
+	}
+}
+
+// Follow the talker media clock by steering the device rate control
+static void x_mcrCtlUpdate(pvt_data_t *pPvtData)
+{
+	S32 ratePpb;
+
+	if (!pPvtData->mcrCtlHandle || !HAL_GET_MCR_RATE_V2(&ratePpb)) {
+		return;
+	}
+
+	long value = pPvtData->mcrCtlNominal + (long)(((S64)pPvtData->mcrCtlNominal * ratePpb + 500000000LL) / 1000000000LL);
+	if (value == pPvtData->mcrCtlLast) {
+		return;
+	}
+
+	snd_ctl_elem_value_set_integer(pPvtData->mcrCtlValue, 0, value);
+	int rslt = snd_ctl_elem_write(pPvtData->mcrCtlHandle, pPvtData->mcrCtlValue);
+	if (rslt < 0) {
+		IF_LOG_INTERVAL(100) AVB_LOGF_ERROR("snd_ctl_elem_write(%s) error: %s", pPvtData->pMcrCtl, snd_strerror(rslt));
+		return;
+	}
+	pPvtData->mcrCtlLast = value;
+}
+
+static S32 x_writeItem(pvt_data_t *pPvtData, media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo, media_q_item_t *pMediaQItem)
+{
+	S32 rslt;
+
+	if (pPvtData->swapSamples) {
+		x_swapSamples(pPubMapUncmpAudioInfo, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->framesPerItem);
+	}
+
+	if (pPvtData->mmap) {
+		rslt = x_mmapWrite(pPvtData, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->framesPerItem, pPubMapUncmpAudioInfo->itemFrameSizeBytes);
+		if (rslt < 0) {
+			AVB_LOGF_ERROR("snd_pcm_mmap_begin: %s", snd_strerror(rslt));
+			rslt = snd_pcm_recover(pPvtData->pcmHandle, rslt, 0);
+			if (rslt < 0) {
+				AVB_LOGF_ERROR("snd_pcm_recover: %s", snd_strerror(rslt));
 			}
+			rslt = x_mmapWrite(pPvtData, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->framesPerItem, pPubMapUncmpAudioInfo->itemFrameSizeBytes);
+		}
+	}
+	else {
+		rslt = snd_pcm_writei(pPvtData->pcmHandle, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->framesPerItem);
+		if (rslt < 0) {
+			AVB_LOGF_ERROR("snd_pcm_writei: %s", snd_strerror(rslt));
+			rslt = snd_pcm_recover(pPvtData->pcmHandle, rslt, 0);
 			if (rslt < 0) {
-				openavbMediaQHeadUnlock(pMediaQ);
-				AVB_TRACE_EXIT(AVB_TRACE_INTF);
-				return FALSE;
+				AVB_LOGF_ERROR("snd_pcm_recover: %s", snd_strerror(rslt));
 			}
+			rslt = snd_pcm_writei(pPvtData->pcmHandle, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->framesPerItem);
+		}
+	}
+	if (rslt != pPubMapUncmpAudioInfo->framesPerItem) {
+		AVB_LOGF_WARNING("Not all pcm data consumed written:%u  consumed:%u", pMediaQItem->dataLen, rslt * pPubMapUncmpAudioInfo->audioChannels);
+	}
 
-			pMediaQItem->dataLen += rslt * pPubMapUncmpAudioInfo->itemFrameSizeBytes;
-			if (pMediaQItem->dataLen != pPubMapUncmpAudioInfo->itemSize) {
-				openavbMediaQHeadUnlock(pMediaQ);
-				AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
-				return TRUE;
-			}
-			else {
-				openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
-				openavbMediaQHeadPush(pMediaQ);
+	x_mcrCtlUpdate(pPvtData);
 
-				AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
-				return TRUE;
+	return rslt;
+}
+
+static U64 x_framesToNsec(pvt_data_t *pPvtData, U64 frames)
+{
+	return frames * NANOSECONDS_PER_SECOND / pPvtData->audioRate;
+}
+
+// Convert a gPTP time to CLOCK_REALTIME, the clock the timer runs on
+static U64 x_ptpToRealtime(U64 ptpNsec)
+{
+	U64 ptpNow, rtNow;
+
+	if (!CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &ptpNow)
+		|| !CLOCK_GETTIME64(OPENAVB_CLOCK_REALTIME, &rtNow)) {
+		return 0;
+	}
+	return rtNow + (S64)(ptpNsec - ptpNow);
+}
+
+// Measure when the first frame just written will actually be played and
+// steer the write lead so later items hit their presentation time.
+static void x_presentFeedback(pvt_data_t *pPvtData, U64 targetNsec, snd_pcm_uframes_t framesWritten)
+{
+	snd_pcm_uframes_t avail;
+	snd_htimestamp_t tstamp;
+
+	if (snd_pcm_state(pPvtData->pcmHandle) != SND_PCM_STATE_RUNNING
+		|| snd_pcm_htimestamp(pPvtData->pcmHandle, &avail, &tstamp) < 0
+		|| avail > pPvtData->bufferFrames) {
+		return;
+	}
+
+	// Queued frames ahead of the item when it was written
+	snd_pcm_uframes_t queued = pPvtData->bufferFrames - avail;
+	queued = queued > framesWritten ? queued - framesWritten : 0;
+
+	U64 playNsec = (U64)tstamp.tv_sec * NANOSECONDS_PER_SECOND + tstamp.tv_nsec + x_framesToNsec(pPvtData, queued);
+	pPvtData->playoutOffsetNsec = (S64)(playNsec - targetNsec);
+	pPvtData->presentLeadNsec += pPvtData->playoutOffsetNsec / 8;
+	if (pPvtData->presentLeadNsec < 0) {
+		pPvtData->presentLeadNsec = 0;
+	}
+	else if (pPvtData->presentLeadNsec > (S64)x_framesToNsec(pPvtData, pPvtData->bufferFrames)) {
+		pPvtData->presentLeadNsec = x_framesToNsec(pPvtData, pPvtData->bufferFrames);
+	}
+
+	IF_LOG_INTERVAL(1000) AVB_LOGF_INFO("Playout offset:%" PRId64 "ns lead:%" PRId64 "ns", pPvtData->playoutOffsetNsec, pPvtData->presentLeadNsec);
+}
+
+static void x_presentWait(pvt_data_t *pPvtData, U64 realtimeNsec, bool bAbsolute)
+{
+	struct itimerspec timerSpec;
+	U64 expirations;
+
+	memset(&timerSpec, 0, sizeof(timerSpec));
+	timerSpec.it_value.tv_sec = realtimeNsec / NANOSECONDS_PER_SECOND;
+	timerSpec.it_value.tv_nsec = realtimeNsec % NANOSECONDS_PER_SECOND;
+	if (!timerSpec.it_value.tv_sec && !timerSpec.it_value.tv_nsec) {
+		timerSpec.it_value.tv_nsec = 1;
+	}
+	if (TIMERFD_SETTIME(pPvtData->presentTimerFd, bAbsolute ? TFD_TIMER_ABSTIME : 0, &timerSpec, NULL) < 0) {
+		AVB_LOGF_ERROR("timerfd_settime() error: %s", strerror(errno));
+		return;
+	}
+	if (read(pPvtData->presentTimerFd, &expirations, sizeof(expirations)) < 0 && errno != EINTR) {
+		AVB_LOGF_ERROR("timerfd read error: %s", strerror(errno));
+	}
+}
+
+// Presentation scheduler. Sleeps on an absolute timer until each item is
+// due, less the measured output latency, and writes it to the PCM then.
+static void *x_presentThreadFn(void *pv)
+{
+	pvt_data_t *pPvtData = pv;
+	media_q_t *pMediaQ = pPvtData->pMediaQ;
+	media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo = pMediaQ->pPubMapInfo;
+	U64 itemNsec = x_framesToNsec(pPvtData, pPubMapUncmpAudioInfo->framesPerItem);
+
+	while (pPvtData->presentRunning) {
+		media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, TRUE);
+		if (!pMediaQItem) {
+			// Nothing queued, check again after one item worth of audio
+			x_presentWait(pPvtData, itemNsec, FALSE);
+			continue;
+		}
+
+		if (!pMediaQItem->dataLen) {
+			openavbMediaQTailPull(pMediaQ);
+			continue;
+		}
+
+		U64 targetNsec = 0;
+		if (!pPvtData->ignoreTimestamp
+			&& openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime)
+			&& !openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime)) {
+			targetNsec = x_ptpToRealtime(openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime));
+		}
+
+		if (targetNsec) {
+			U64 nowNsec;
+			CLOCK_GETTIME64(OPENAVB_CLOCK_REALTIME, &nowNsec);
+			U64 writeNsec = targetNsec - pPvtData->presentLeadNsec;
+			if ((S64)(writeNsec - nowNsec) > 0) {
+				// Let the listener keep pushing while this thread sleeps
+				openavbMediaQTailUnlock(pMediaQ);
+				x_presentWait(pPvtData, writeNsec, TRUE);
+				continue;
 			}
 		}
-		else {
-			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
-			return FALSE;	// Media queue full
+
+		S32 rslt = x_writeItem(pPvtData, pPubMapUncmpAudioInfo, pMediaQItem);
+		if (targetNsec && rslt > 0) {
+			x_presentFeedback(pPvtData, targetNsec, rslt);
 		}
+		openavbMediaQTailPull(pMediaQ);
 	}
 
-	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
-	return FALSE;
+	return NULL;
 }
 
 // A call to this callback indicates that this interface module will be
 // a listener. Any listener initialization can be done in this function.
+// Hand the stream to its mix group instead of opening the device
+static void x_mixJoin(media_q_t *pMediaQ, pvt_data_t *pPvtData)
+{
+	alsa_mix_cfg_t cfg;
+
+	if (!pMediaQ->pMediaQDataFormat
+		|| (strcmp(pMediaQ->pMediaQDataFormat, MapUncmpAudioMediaQDataFormat) != 0
+		&& strcmp(pMediaQ->pMediaQDataFormat, MapAVTPAudioMediaQDataFormat) != 0)) {
+		AVB_LOG_ERROR("intf_nv_mix_group needs an uncompressed audio mapping");
+		return;
+	}
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.pGroupName = pPvtData->pMixGroup;
+	cfg.pDeviceName = pPvtData->pDeviceName;
+	cfg.deviceFormat = x_AVBAudioFormatToAlsaFormat(pPvtData->audioType, pPvtData->audioBitDepth,
+		pPvtData->audioEndian, pMediaQ->pMediaQDataFormat);
+	cfg.deviceChannels = pPvtData->mixChannels;
+	cfg.latencyUsec = pPvtData->mixLatencyUsec;
+	cfg.allowResampling = pPvtData->allowResampling;
+	cfg.audioRate = pPvtData->audioRate;
+	cfg.audioType = pPvtData->audioType;
+	cfg.audioBitDepth = pPvtData->audioBitDepth;
+	cfg.audioEndian = pPvtData->audioEndian;
+	cfg.audioChannels = pPvtData->audioChannels;
+	memcpy(cfg.route, pPvtData->mixRoute, sizeof(cfg.route));
+	cfg.routeCount = pPvtData->mixRouteCount;
+	cfg.gain = pPvtData->mixGain;
+	cfg.ignoreTimestamp = pPvtData->ignoreTimestamp;
+
+	pPvtData->pMix = openavbIntfAlsaMixJoin(&cfg, pMediaQ);
+}
+
 void openavbIntfAlsaRxInitCB(media_q_t *pMediaQ) 
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
@@ -637,6 +1275,12 @@ void openavbIntfAlsaRxInitCB(media_q_t *pMediaQ)
 			return;
 		}
 
+		if (pPvtData->pMixGroup) {
+			x_mixJoin(pMediaQ, pPvtData);
+			AVB_TRACE_EXIT(AVB_TRACE_INTF);
+			return;
+		}
+
 		// Open the pcm device.
 		rslt = snd_pcm_open(&pPvtData->pcmHandle, pPvtData->pDeviceName, SND_PCM_STREAM_PLAYBACK, 0);
 
@@ -681,7 +1325,7 @@ void openavbIntfAlsaRxInitCB(media_q_t *pMediaQ)
 		}
 
 		// Set the access type
-		rslt = snd_pcm_hw_params_set_access(pPvtData->pcmHandle, hwParams, PCM_ACCESS_TYPE);
+		rslt = x_setAccess(pPvtData, hwParams);
 		if (rslt < 0) {
 			AVB_LOGF_ERROR("snd_pcm_hw_params_set_access() error: %s", snd_strerror(rslt));
 			snd_pcm_close(pPvtData->pcmHandle);
@@ -695,7 +1339,7 @@ void openavbIntfAlsaRxInitCB(media_q_t *pMediaQ)
 		// Set the sample format
 		int fmt = x_AVBAudioFormatToAlsaFormat(pPvtData->audioType,
 											   pPvtData->audioBitDepth,
-											   pPvtData->audioEndian, 
+											   x_pcmEndian(pPvtData),
 											   pMediaQ->pMediaQDataFormat);
 		rslt = snd_pcm_hw_params_set_format(pPvtData->pcmHandle, hwParams, fmt);
 		if (rslt < 0) {
@@ -862,7 +1506,14 @@ void openavbIntfAlsaRxInitCB(media_q_t *pMediaQ)
 			return;
 		}
 
-		rslt = snd_pcm_sw_params_set_start_threshold(pPvtData->pcmHandle, swParams, period_size * pPvtData->startThresholdPeriods);
+		{
+			snd_pcm_uframes_t periodFrames;
+			if (snd_pcm_get_params(pPvtData->pcmHandle, &pPvtData->bufferFrames, &periodFrames) < 0) {
+				pPvtData->bufferFrames = buffer_size;
+			}
+		}
+		pPvtData->startFrames = period_size * pPvtData->startThresholdPeriods;
+		rslt = snd_pcm_sw_params_set_start_threshold(pPvtData->pcmHandle, swParams, pPvtData->startFrames);
 		if (rslt < 0) {
 			AVB_LOGF_ERROR("snd_pcm_sw_params_set_start_threshold error(): %s", snd_strerror(rslt));
 			snd_pcm_close(pPvtData->pcmHandle);
@@ -889,6 +1540,14 @@ void openavbIntfAlsaRxInitCB(media_q_t *pMediaQ)
 			return;
 		}
 
+		if (pPvtData->presentTimer) {
+			// Needed for snd_pcm_htimestamp() playout feedback
+			rslt = snd_pcm_sw_params_set_tstamp_mode(pPvtData->pcmHandle, swParams, SND_PCM_TSTAMP_ENABLE);
+			if (rslt < 0) {
+				AVB_LOGF_WARNING("snd_pcm_sw_params_set_tstamp_mode error(): %s", snd_strerror(rslt));
+			}
+		}
+
 		rslt = snd_pcm_sw_params(pPvtData->pcmHandle, swParams);
 		if (rslt < 0) {
 			AVB_LOGF_ERROR("snd_pcm_sw_params error(): %s", snd_strerror(rslt));
@@ -917,6 +1576,30 @@ void openavbIntfAlsaRxInitCB(media_q_t *pMediaQ)
 		snd_output_t* out;
 		snd_output_stdio_attach(&out, stderr, 0);
 		snd_pcm_dump(pPvtData->pcmHandle, out);
+
+		if (pPvtData->pMcrCtl) {
+			x_mcrCtlOpen(pPvtData);
+		}
+
+		if (pPvtData->presentTimer) {
+			pPvtData->presentTimerFd = TIMERFD_CREATE(CLOCK_REALTIME, 0);
+			if (pPvtData->presentTimerFd < 0) {
+				AVB_LOGF_ERROR("timerfd_create() error: %s", strerror(errno));
+			}
+			else {
+				// The listener pushes items while the presentation thread pulls them
+				openavbMediaQThreadSafeOn(pMediaQ);
+				pPvtData->pMediaQ = pMediaQ;
+				pPvtData->presentLeadNsec = x_framesToNsec(pPvtData, pPvtData->startFrames);
+				pPvtData->presentRunning = TRUE;
+				if (pthread_create(&pPvtData->presentThread, NULL, x_presentThreadFn, pPvtData) != 0) {
+					AVB_LOG_ERROR("Failed to start the presentation thread, using the listener loop");
+					pPvtData->presentRunning = FALSE;
+					TIMER_CLOSE(pPvtData->presentTimerFd);
+					pPvtData->presentTimerFd = -1;
+				}
+			}
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -935,26 +1618,19 @@ bool openavbIntfAlsaRxCB(media_q_t *pMediaQ)
 			return FALSE;
 		}
 
+		// Items are written by the presentation or the mixer thread
+		if (pPvtData->presentRunning || pPvtData->pMix) {
+			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+			return TRUE;
+		}
+
 		bool moreItems = TRUE;
 
 		while (moreItems) {
 			media_q_item_t *pMediaQItem = openavbMediaQTailLock(pMediaQ, pPvtData->ignoreTimestamp);
 			if (pMediaQItem) {
 				if (pMediaQItem->dataLen) {
-					S32 rslt;
-
-					rslt = snd_pcm_writei(pPvtData->pcmHandle, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->framesPerItem);
-					if (rslt < 0) {
-						AVB_LOGF_ERROR("snd_pcm_writei: %s", snd_strerror(rslt));
-						rslt = snd_pcm_recover(pPvtData->pcmHandle, rslt, 0);
-						if (rslt < 0) {
-							AVB_LOGF_ERROR("snd_pcm_recover: %s", snd_strerror(rslt));
-						}
-						rslt = snd_pcm_writei(pPvtData->pcmHandle, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->framesPerItem);
-					}
-					if (rslt != pPubMapUncmpAudioInfo->framesPerItem) {
-						AVB_LOGF_WARNING("Not all pcm data consumed written:%u  consumed:%u", pMediaQItem->dataLen, rslt * pPubMapUncmpAudioInfo->audioChannels);
-					}
+					x_writeItem(pPvtData, pPubMapUncmpAudioInfo, pMediaQItem);
 
 					// DEBUG
 					// rslt = snd_pcm_avail(pPvtData->pcmHandle);
@@ -988,6 +1664,25 @@ void openavbIntfAlsaEndCB(media_q_t *pMediaQ)
 			return;
 		}
 
+		if (pPvtData->presentRunning) {
+			pPvtData->presentRunning = FALSE;
+			// Wake the thread from its timer wait
+			struct itimerspec timerSpec;
+			memset(&timerSpec, 0, sizeof(timerSpec));
+			timerSpec.it_value.tv_nsec = 1;
+			TIMERFD_SETTIME(pPvtData->presentTimerFd, 0, &timerSpec, NULL);
+			pthread_join(pPvtData->presentThread, NULL);
+			TIMER_CLOSE(pPvtData->presentTimerFd);
+			pPvtData->presentTimerFd = -1;
+		}
+
+		if (pPvtData->pMix) {
+			openavbIntfAlsaMixLeave(pPvtData->pMix);
+			pPvtData->pMix = NULL;
+		}
+
+		x_mcrCtlClose(pPvtData);
+
 		if (pPvtData->pcmHandle) {
 			snd_pcm_close(pPvtData->pcmHandle);
 			pPvtData->pcmHandle = NULL;
@@ -1022,6 +1717,7 @@ extern DLL_EXPORT bool openavbIntfAlsaInitialize(media_q_t *pMediaQ, openavb_int
 		pIntfCB->intf_gen_init_cb = openavbIntfAlsaGenInitCB;
 		pIntfCB->intf_tx_init_cb = openavbIntfAlsaTxInitCB;
 		pIntfCB->intf_tx_cb = openavbIntfAlsaTxCB;
+		pIntfCB->intf_tx_ahead_cb = openavbIntfAlsaTxAheadCB;
 		pIntfCB->intf_rx_init_cb = openavbIntfAlsaRxInitCB;
 		pIntfCB->intf_rx_cb = openavbIntfAlsaRxCB;
 		pIntfCB->intf_end_cb = openavbIntfAlsaEndCB;
@@ -1033,6 +1729,10 @@ extern DLL_EXPORT bool openavbIntfAlsaInitialize(media_q_t *pMediaQ, openavb_int
 		pPvtData->intervalCounter = 0;
 		pPvtData->startThresholdPeriods = 2;	// Default to 2 periods of frames as the start threshold
 		pPvtData->periodTimeUsec = 100000;
+		pPvtData->presentTimerFd = -1;
+		pPvtData->mcrCtlNominal = 100000;	// snd-aloop "PCM Rate Shift 100000"
+		pPvtData->mixGain = 1.0f;
+		pPvtData->mixLatencyUsec = 20000;
 
 	}
 
@@ -0,0 +1,592 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+ 
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ 
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+Attributions: The inih library portion of the source code is licensed from 
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt. 
+Complete license and copyright information can be found at 
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : In-process mixer for ALSA listener streams
+*
+* Listener streams with the same intf_nv_mix_group share one playback PCM.
+* The stream that creates the group opens the device and starts a mixer
+* thread; each stream gets a ring of float frames in the device's channel
+* layout, indexed by device frame. Once per ALSA period the mixer thread
+* takes every stream's newly arrived media queue items, converts them to
+* float and stores them at the device frame their presentation time falls
+* on, routed to their device channels. It then sums the period of every
+* ring with the SIMD mix kernel, clears it, converts the sum to the device
+* format (which clips) and writes it. A stream without data adds silence.
+*
+* The device frame to gPTP time mapping follows snd_pcm_delay(), so it
+* tracks the device clock. A stream's items are placed back to back while
+* their presentation times stay within a millisecond of that; a larger
+* jump, such as from the device drifting against gPTP, moves the stream to
+* where its timestamps say.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "openavb_platform_pub.h"
+#include "openavb_types_pub.h"
+#include "openavb_trace_pub.h"
+#include "openavb_mediaq_pub.h"
+#include "openavb_map_uncmp_audio_pub.h"
+#include "openavb_audio_conv_pub.h"
+#include "openavb_intf_alsa_mix.h"
+
+#define	AVB_LOG_COMPONENT	"ALSA Interface"
+#include "openavb_log_pub.h"
+
+// Timestamps of a stream may wander this far before it is moved
+#define MIX_SLACK_USEC		1000
+
+// Smoothing of the device frame to gPTP time mapping
+#define MIX_TIMEBASE_SHIFT	4
+
+struct alsa_mix_group;
+
+struct alsa_mix_member {
+	struct alsa_mix_group *pGroup;
+	media_q_t *pMediaQ;
+	openavb_audio_conv_fn_t pConvIn;
+	U32 channels;
+	U8 route[ALSA_MIX_MAX_CHANNELS];
+	bool identity;
+	float gain;
+	bool ignoreTimestamp;
+
+	// ringFrames frames in the device's channel layout
+	float *pRing;
+
+	// One item converted to float, in the stream's channel layout
+	float *pConv;
+	U32 convFrames;
+
+	// Device frame following the stream's last item
+	U64 nextFrame;
+	bool havePos;
+
+	U64 mixedFrames;
+	U64 lateFrames;
+	U64 earlyFrames;
+	U32 moves;
+};
+
+typedef struct alsa_mix_group {
+	char name[ALSA_MIX_NAMESIZE];
+	snd_pcm_t *pcmHandle;
+	U32 rate;
+	U32 channels;
+	U32 periodFrames;
+	U32 ringFrames;
+	U32 slackFrames;
+
+	// Sum of one period and the same converted for the device
+	float *pAcc;
+	U8 *pOut;
+	openavb_audio_conv_fn_t pConvOut;
+
+	alsa_mix_member_t *pMembers[ALSA_MIX_MAX_STREAMS];
+	U32 nMembers;
+
+	// Next device frame to mix, and the gPTP time device frame 0 plays at
+	U64 mixFrame;
+	U64 basePtpNsec;
+	bool baseValid;
+
+	pthread_t thread;
+	bool running;
+	U32 xruns;
+
+	// Held by the mixer thread for a period and while streams join or leave
+	pthread_mutex_t lock;
+	struct alsa_mix_group *pNext;
+} alsa_mix_group_t;
+
+static alsa_mix_group_t *gMixGroups = NULL;
+static pthread_mutex_t gMixGroupsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static U32 x_sampleBytes(avb_audio_bit_depth_t bitDepth)
+{
+	return bitDepth == AVB_AUDIO_BIT_DEPTH_16BIT ? 2 : bitDepth == AVB_AUDIO_BIT_DEPTH_24BIT ? 3 : 4;
+}
+
+static U64 x_framesToNsec(alsa_mix_group_t *pGroup, U64 frames)
+{
+	return frames / pGroup->rate * NANOSECONDS_PER_SECOND
+		+ frames % pGroup->rate * NANOSECONDS_PER_SECOND / pGroup->rate;
+}
+
+static S64 x_nsecToFrames(alsa_mix_group_t *pGroup, S64 nsec)
+{
+	S64 sign = nsec < 0 ? -1 : 1;
+	U64 n = nsec < 0 ? -nsec : nsec;
+	return sign * (S64)(n / NANOSECONDS_PER_SECOND * pGroup->rate
+		+ (n % NANOSECONDS_PER_SECOND * pGroup->rate + NANOSECONDS_PER_SECOND / 2) / NANOSECONDS_PER_SECOND);
+}
+
+// Device frame an item starts at. Called by the mixer thread.
+static bool x_itemFrame(alsa_mix_member_t *pMember, media_q_item_t *pMediaQItem, U64 *pFrame)
+{
+	alsa_mix_group_t *pGroup = pMember->pGroup;
+
+	if (!pMember->ignoreTimestamp
+		&& openavbAvtpTimeTimestampIsValid(pMediaQItem->pAvtpTime)
+		&& !openavbAvtpTimeTimestampIsUncertain(pMediaQItem->pAvtpTime)) {
+		if (!pGroup->baseValid) {
+			return FALSE;
+		}
+		S64 frame = x_nsecToFrames(pGroup, (S64)(openavbAvtpTimeGetAvtpTimeNS(pMediaQItem->pAvtpTime) - pGroup->basePtpNsec));
+		if (frame < 0) {
+			return FALSE;
+		}
+		if (pMember->havePos) {
+			S64 offset = frame - (S64)pMember->nextFrame;
+			if (offset >= -(S64)pGroup->slackFrames && offset <= (S64)pGroup->slackFrames) {
+				// Keep the stream seamless
+				frame = pMember->nextFrame;
+			}
+			else {
+				IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Mix group %s: stream moved by %" PRId64 " frames", pGroup->name, offset);
+				pMember->moves++;
+			}
+		}
+		*pFrame = frame;
+		return TRUE;
+	}
+
+	// Without timestamps the items follow each other, a period ahead to start
+	if (!pMember->havePos || pMember->nextFrame < pGroup->mixFrame) {
+		*pFrame = pGroup->mixFrame + pGroup->periodFrames;
+	}
+	else {
+		*pFrame = pMember->nextFrame;
+	}
+	return TRUE;
+}
+
+// Store converted frames at a device frame, routed to the device channels
+static void x_ringStore(alsa_mix_member_t *pMember, U64 frame, U32 frames)
+{
+	alsa_mix_group_t *pGroup = pMember->pGroup;
+	U32 first = 0, f, c;
+
+	pMember->nextFrame = frame + frames;
+	pMember->havePos = TRUE;
+
+	// Too late for the mix, or beyond what the ring holds
+	if (frame < pGroup->mixFrame) {
+		first = pGroup->mixFrame - frame < frames ? pGroup->mixFrame - frame : frames;
+		pMember->lateFrames += first;
+	}
+	if (frame + frames > pGroup->mixFrame + pGroup->ringFrames) {
+		U64 over = frame + frames - (pGroup->mixFrame + pGroup->ringFrames);
+		over = over < frames - first ? over : frames - first;
+		pMember->earlyFrames += over;
+		frames -= over;
+	}
+
+	for (f = first; f < frames; ) {
+		U32 idx = (frame + f) % pGroup->ringFrames;
+		U32 n = pGroup->ringFrames - idx < frames - f ? pGroup->ringFrames - idx : frames - f;
+		const float *pSrc = pMember->pConv + f * pMember->channels;
+		float *pDst = pMember->pRing + idx * pGroup->channels;
+
+		if (pMember->identity) {
+			memcpy(pDst, pSrc, n * pGroup->channels * sizeof(float));
+		}
+		else {
+			U32 i;
+			for (i = 0; i < n; i++, pSrc += pMember->channels, pDst += pGroup->channels) {
+				for (c = 0; c < pMember->channels; c++) {
+					if (pMember->route[c] < pGroup->channels) {
+						pDst[pMember->route[c]] = pSrc[c];
+					}
+				}
+			}
+		}
+		pMember->mixedFrames += n;
+		f += n;
+	}
+}
+
+// Take the stream's items, whatever their presentation time, into its ring
+static void x_memberTake(alsa_mix_member_t *pMember)
+{
+	media_q_pub_map_uncmp_audio_info_t *pPubMapUncmpAudioInfo = pMember->pMediaQ->pPubMapInfo;
+	media_q_item_t *pMediaQItem;
+
+	while ((pMediaQItem = openavbMediaQTailLock(pMember->pMediaQ, TRUE)) != NULL) {
+		U32 frames = pPubMapUncmpAudioInfo->itemFrameSizeBytes ?
+			pMediaQItem->dataLen / pPubMapUncmpAudioInfo->itemFrameSizeBytes : 0;
+		U64 frame;
+
+		if (frames > pMember->convFrames) {
+			float *pConv = realloc(pMember->pConv, frames * pMember->channels * sizeof(float));
+			if (!pConv) {
+				AVB_LOG_ERROR("Unable to allocate the mix conversion buffer");
+				frames = 0;
+			}
+			else {
+				pMember->pConv = pConv;
+				pMember->convFrames = frames;
+			}
+		}
+
+		if (frames && x_itemFrame(pMember, pMediaQItem, &frame)) {
+			pMember->pConvIn(pMember->pConv, pMediaQItem->pPubData, frames * pMember->channels);
+			x_ringStore(pMember, frame, frames);
+		}
+		else if (frames) {
+			pMember->lateFrames += frames;
+		}
+		openavbMediaQTailPull(pMember->pMediaQ);
+	}
+}
+
+// Sum one period of every stream and clear it from the rings. Called with
+// the group locked.
+static void x_mixPeriod(alsa_mix_group_t *pGroup)
+{
+	U32 idx = pGroup->mixFrame % pGroup->ringFrames;
+	U32 n1 = pGroup->ringFrames - idx < pGroup->periodFrames ? pGroup->ringFrames - idx : pGroup->periodFrames;
+	U32 n2 = pGroup->periodFrames - n1;
+	U32 i;
+
+	memset(pGroup->pAcc, 0, pGroup->periodFrames * pGroup->channels * sizeof(float));
+	for (i = 0; i < pGroup->nMembers; i++) {
+		alsa_mix_member_t *pMember = pGroup->pMembers[i];
+		float *pSeg = pMember->pRing + idx * pGroup->channels;
+
+		openavbAudioMixF32(pGroup->pAcc, pSeg, pMember->gain, n1 * pGroup->channels);
+		memset(pSeg, 0, n1 * pGroup->channels * sizeof(float));
+		if (n2) {
+			openavbAudioMixF32(pGroup->pAcc + n1 * pGroup->channels, pMember->pRing, pMember->gain, n2 * pGroup->channels);
+			memset(pMember->pRing, 0, n2 * pGroup->channels * sizeof(float));
+		}
+	}
+	pGroup->mixFrame += pGroup->periodFrames;
+}
+
+static void x_writePeriod(alsa_mix_group_t *pGroup)
+{
+	snd_pcm_sframes_t rslt;
+
+	pGroup->pConvOut(pGroup->pOut, pGroup->pAcc, pGroup->periodFrames * pGroup->channels);
+	rslt = snd_pcm_writei(pGroup->pcmHandle, pGroup->pOut, pGroup->periodFrames);
+	if (rslt < 0) {
+		IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Mix group %s snd_pcm_writei: %s", pGroup->name, snd_strerror(rslt));
+		pGroup->xruns++;
+		rslt = snd_pcm_recover(pGroup->pcmHandle, rslt, 1);
+		if (rslt < 0) {
+			AVB_LOGF_ERROR("snd_pcm_recover: %s", snd_strerror(rslt));
+			return;
+		}
+		snd_pcm_writei(pGroup->pcmHandle, pGroup->pOut, pGroup->periodFrames);
+	}
+}
+
+// Frame mixFrame, the next to be written, plays once the frames queued in
+// the device have
+static void x_timebaseUpdate(alsa_mix_group_t *pGroup)
+{
+	snd_pcm_sframes_t delay;
+	U64 ptpNow;
+
+	if (snd_pcm_delay(pGroup->pcmHandle, &delay) < 0 || delay < 0
+		|| !CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &ptpNow)) {
+		return;
+	}
+
+	U64 base = ptpNow + x_framesToNsec(pGroup, delay) - x_framesToNsec(pGroup, pGroup->mixFrame);
+	if (!pGroup->baseValid) {
+		pGroup->basePtpNsec = base;
+		pGroup->baseValid = TRUE;
+	}
+	else {
+		pGroup->basePtpNsec += (S64)(base - pGroup->basePtpNsec) >> MIX_TIMEBASE_SHIFT;
+	}
+}
+
+// Mixer thread. snd_pcm_writei() blocking on a full device buffer paces it.
+static void *x_mixThreadFn(void *pv)
+{
+	alsa_mix_group_t *pGroup = pv;
+	U32 i;
+
+	while (pGroup->running) {
+		pthread_mutex_lock(&pGroup->lock);
+		for (i = 0; i < pGroup->nMembers; i++) {
+			x_memberTake(pGroup->pMembers[i]);
+		}
+		x_mixPeriod(pGroup);
+		pthread_mutex_unlock(&pGroup->lock);
+
+		x_writePeriod(pGroup);
+
+		pthread_mutex_lock(&pGroup->lock);
+		x_timebaseUpdate(pGroup);
+		pthread_mutex_unlock(&pGroup->lock);
+	}
+
+	return NULL;
+}
+
+static void x_groupFree(alsa_mix_group_t *pGroup)
+{
+	if (pGroup->pcmHandle) {
+		snd_pcm_close(pGroup->pcmHandle);
+	}
+	pthread_mutex_destroy(&pGroup->lock);
+	free(pGroup->pAcc);
+	free(pGroup->pOut);
+	free(pGroup);
+}
+
+// Open the device of a new group and start its mixer thread
+static alsa_mix_group_t *x_groupOpen(const alsa_mix_cfg_t *pCfg)
+{
+	snd_pcm_uframes_t bufferFrames, periodFrames;
+	alsa_mix_group_t *pGroup;
+	int rslt;
+
+	pGroup = calloc(1, sizeof(*pGroup));
+	if (!pGroup) {
+		AVB_LOG_ERROR("Unable to allocate the mix group");
+		return NULL;
+	}
+	strncpy(pGroup->name, pCfg->pGroupName, sizeof(pGroup->name) - 1);
+	pthread_mutex_init(&pGroup->lock, NULL);
+	pGroup->rate = pCfg->audioRate;
+	pGroup->channels = pCfg->deviceChannels ? pCfg->deviceChannels : pCfg->audioChannels;
+	if (pGroup->channels > ALSA_MIX_MAX_CHANNELS) {
+		AVB_LOGF_ERROR("Mix group %s: %u channels, at most %u supported", pGroup->name, pGroup->channels, ALSA_MIX_MAX_CHANNELS);
+		x_groupFree(pGroup);
+		return NULL;
+	}
+
+	pGroup->pConvOut = openavbAudioConvSelect(AVB_AUDIO_TYPE_FLOAT, AVB_AUDIO_BIT_DEPTH_32BIT, AVB_AUDIO_ENDIAN_UNSPEC,
+		pCfg->audioType, pCfg->audioBitDepth, pCfg->audioEndian);
+	if (!pGroup->pConvOut || pCfg->deviceFormat == SND_PCM_FORMAT_UNKNOWN) {
+		AVB_LOGF_ERROR("Mix group %s: sample format not supported by the mixer", pGroup->name);
+		x_groupFree(pGroup);
+		return NULL;
+	}
+
+	rslt = snd_pcm_open(&pGroup->pcmHandle, pCfg->pDeviceName, SND_PCM_STREAM_PLAYBACK, 0);
+	if (rslt < 0) {
+		AVB_LOGF_ERROR("snd_pcm_open error(): %s", snd_strerror(rslt));
+		pGroup->pcmHandle = NULL;
+		x_groupFree(pGroup);
+		return NULL;
+	}
+	rslt = snd_pcm_set_params(pGroup->pcmHandle, pCfg->deviceFormat, SND_PCM_ACCESS_RW_INTERLEAVED,
+		pGroup->channels, pGroup->rate, pCfg->allowResampling, pCfg->latencyUsec);
+	if (rslt < 0) {
+		AVB_LOGF_ERROR("snd_pcm_set_params() error: %s", snd_strerror(rslt));
+		x_groupFree(pGroup);
+		return NULL;
+	}
+	rslt = snd_pcm_get_params(pGroup->pcmHandle, &bufferFrames, &periodFrames);
+	if (rslt < 0 || periodFrames == 0) {
+		AVB_LOGF_ERROR("snd_pcm_get_params() error: %s", snd_strerror(rslt));
+		x_groupFree(pGroup);
+		return NULL;
+	}
+
+	pGroup->periodFrames = periodFrames;
+	pGroup->slackFrames = pGroup->rate * MIX_SLACK_USEC / 1000000;
+	// Room for items arriving up to half a second ahead of being played
+	pGroup->ringFrames = pGroup->rate / 2 > 4 * bufferFrames ? pGroup->rate / 2 : 4 * bufferFrames;
+	pGroup->pAcc = malloc(periodFrames * pGroup->channels * sizeof(float));
+	pGroup->pOut = malloc(periodFrames * pGroup->channels * x_sampleBytes(pCfg->audioBitDepth));
+	if (!pGroup->pAcc || !pGroup->pOut) {
+		AVB_LOG_ERROR("Unable to allocate the mix buffers");
+		x_groupFree(pGroup);
+		return NULL;
+	}
+
+	pGroup->running = TRUE;
+	if (pthread_create(&pGroup->thread, NULL, x_mixThreadFn, pGroup) != 0) {
+		AVB_LOG_ERROR("Failed to start the mixer thread");
+		x_groupFree(pGroup);
+		return NULL;
+	}
+
+	AVB_LOGF_INFO("Mix group %s on %s: %u channels at %u Hz, period %lu buffer %lu frames",
+		pGroup->name, pCfg->pDeviceName, pGroup->channels, pGroup->rate,
+		(unsigned long)periodFrames, (unsigned long)bufferFrames);
+	return pGroup;
+}
+
+alsa_mix_member_t *openavbIntfAlsaMixJoin(const alsa_mix_cfg_t *pCfg, media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	alsa_mix_member_t *pMember = NULL;
+	alsa_mix_group_t *pGroup;
+	U32 c;
+
+	if (!pCfg || !pCfg->pGroupName || !pMediaQ || !pMediaQ->pPubMapInfo) {
+		AVB_TRACE_EXIT(AVB_TRACE_INTF);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&gMixGroupsLock);
+
+	for (pGroup = gMixGroups; pGroup; pGroup = pGroup->pNext) {
+		if (strncmp(pGroup->name, pCfg->pGroupName, sizeof(pGroup->name)) == 0) {
+			break;
+		}
+	}
+	if (pGroup) {
+		if (pGroup->rate != pCfg->audioRate) {
+			AVB_LOGF_ERROR("Mix group %s runs at %u Hz, not %u Hz", pGroup->name, pGroup->rate, pCfg->audioRate);
+			goto out;
+		}
+		if (pGroup->nMembers >= ALSA_MIX_MAX_STREAMS) {
+			AVB_LOGF_ERROR("Mix group %s is full", pGroup->name);
+			goto out;
+		}
+	}
+
+	pMember = calloc(1, sizeof(*pMember));
+	if (!pMember) {
+		AVB_LOG_ERROR("Unable to allocate the mix group member");
+		goto out;
+	}
+	pMember->pMediaQ = pMediaQ;
+	pMember->channels = pCfg->audioChannels;
+	pMember->gain = pCfg->gain;
+	pMember->ignoreTimestamp = pCfg->ignoreTimestamp;
+	pMember->pConvIn = openavbAudioConvSelect(pCfg->audioType, pCfg->audioBitDepth, pCfg->audioEndian,
+		AVB_AUDIO_TYPE_FLOAT, AVB_AUDIO_BIT_DEPTH_32BIT, AVB_AUDIO_ENDIAN_UNSPEC);
+	if (!pMember->pConvIn || pMember->channels == 0 || pMember->channels > ALSA_MIX_MAX_CHANNELS) {
+		AVB_LOGF_ERROR("Mix group %s: stream format not supported by the mixer", pCfg->pGroupName);
+		goto fail;
+	}
+
+	if (!pGroup) {
+		pGroup = x_groupOpen(pCfg);
+		if (!pGroup) {
+			goto fail;
+		}
+		pGroup->pNext = gMixGroups;
+		gMixGroups = pGroup;
+	}
+	pMember->pGroup = pGroup;
+
+	pMember->identity = pMember->channels == pGroup->channels;
+	for (c = 0; c < pMember->channels; c++) {
+		pMember->route[c] = c < pCfg->routeCount ? pCfg->route[c] : c;
+		if (pMember->route[c] >= pGroup->channels) {
+			AVB_LOGF_WARNING("Mix group %s has no channel %u, stream channel %u dropped", pGroup->name, pMember->route[c], c);
+		}
+		if (pMember->route[c] != c) {
+			pMember->identity = FALSE;
+		}
+	}
+
+	pMember->pRing = calloc((size_t)pGroup->ringFrames * pGroup->channels, sizeof(float));
+	if (!pMember->pRing) {
+		AVB_LOG_ERROR("Unable to allocate the mix ring");
+		goto fail;
+	}
+
+	// The mixer thread pulls while the listener pushes
+	openavbMediaQThreadSafeOn(pMediaQ);
+
+	pthread_mutex_lock(&pGroup->lock);
+	pGroup->pMembers[pGroup->nMembers++] = pMember;
+	pthread_mutex_unlock(&pGroup->lock);
+
+	AVB_LOGF_INFO("Stream joined mix group %s (%u streams)", pGroup->name, pGroup->nMembers);
+	goto out;
+
+fail:
+	free(pMember);
+	pMember = NULL;
+	// A group opened for this stream alone has no members yet
+	if (pGroup && pGroup->nMembers == 0 && gMixGroups == pGroup) {
+		pGroup->running = FALSE;
+		pthread_join(pGroup->thread, NULL);
+		gMixGroups = pGroup->pNext;
+		x_groupFree(pGroup);
+	}
+
+out:
+	pthread_mutex_unlock(&gMixGroupsLock);
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+	return pMember;
+}
+
+void openavbIntfAlsaMixLeave(alsa_mix_member_t *pMember)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_INTF);
+
+	if (pMember) {
+		alsa_mix_group_t *pGroup = pMember->pGroup;
+		alsa_mix_group_t **ppGroup;
+		U32 i;
+
+		pthread_mutex_lock(&gMixGroupsLock);
+
+		pthread_mutex_lock(&pGroup->lock);
+		for (i = 0; i < pGroup->nMembers; i++) {
+			if (pGroup->pMembers[i] == pMember) {
+				pGroup->pMembers[i] = pGroup->pMembers[--pGroup->nMembers];
+				break;
+			}
+		}
+		pthread_mutex_unlock(&pGroup->lock);
+
+		AVB_LOGF_INFO("Stream left mix group %s: %" PRIu64 " frames mixed, %" PRIu64 " late, %" PRIu64 " early, %u moves",
+			pGroup->name, pMember->mixedFrames, pMember->lateFrames, pMember->earlyFrames, pMember->moves);
+
+		if (pGroup->nMembers == 0) {
+			pGroup->running = FALSE;
+			pthread_join(pGroup->thread, NULL);
+			for (ppGroup = &gMixGroups; *ppGroup; ppGroup = &(*ppGroup)->pNext) {
+				if (*ppGroup == pGroup) {
+					*ppGroup = pGroup->pNext;
+					break;
+				}
+			}
+			AVB_LOGF_INFO("Mix group %s closed, %u xruns", pGroup->name, pGroup->xruns);
+			x_groupFree(pGroup);
+		}
+
+		pthread_mutex_unlock(&gMixGroupsLock);
+
+		free(pMember->pRing);
+		free(pMember->pConv);
+		free(pMember);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_INTF);
+}
@@ -0,0 +1,85 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+ 
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ 
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ 
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+Attributions: The inih library portion of the source code is licensed from 
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt. 
+Complete license and copyright information can be found at 
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* HEADER SUMMARY : In-process mixer for ALSA listener streams
+*/
+
+#ifndef OPENAVB_INTF_ALSA_MIX_H
+#define OPENAVB_INTF_ALSA_MIX_H 1
+
+#include "openavb_types_pub.h"
+#include "openavb_audio_pub.h"
+#include "openavb_mediaq_pub.h"
+
+#include <alsa/asoundlib.h>
+
+#define ALSA_MIX_NAMESIZE		64
+#define ALSA_MIX_MAX_STREAMS	16
+#define ALSA_MIX_MAX_CHANNELS	AVB_AUDIO_CHANNELS_8
+
+typedef struct alsa_mix_member alsa_mix_member_t;
+
+// What a listener stream brings to its mix group. The device settings are
+// taken from the stream that opens the group.
+typedef struct {
+	const char *pGroupName;
+
+	// Device, used by the first stream of the group
+	const char *pDeviceName;
+	snd_pcm_format_t deviceFormat;
+	U32 deviceChannels;
+	U32 latencyUsec;
+	bool allowResampling;
+
+	// Sample format of the stream's media queue items, also the device's
+	avb_audio_rate_t audioRate;
+	avb_audio_type_t audioType;
+	avb_audio_bit_depth_t audioBitDepth;
+	avb_audio_endian_t audioEndian;
+	U32 audioChannels;
+
+	// Device channel of each stream channel, identity when routeCount is 0
+	U8 route[ALSA_MIX_MAX_CHANNELS];
+	U32 routeCount;
+	float gain;
+
+	bool ignoreTimestamp;
+} alsa_mix_cfg_t;
+
+// Join the mix group named in pCfg, opening the device if the group is new.
+// From then on the group's mixer thread takes the items from pMediaQ.
+// Returns NULL if the stream can't be mixed.
+alsa_mix_member_t *openavbIntfAlsaMixJoin(const alsa_mix_cfg_t *pCfg, media_q_t *pMediaQ);
+
+// Leave the group; the last stream to leave closes the device
+void openavbIntfAlsaMixLeave(alsa_mix_member_t *pMember);
+
+#endif // OPENAVB_INTF_ALSA_MIX_H
@@ -58,6 +58,9 @@ typedef struct pvt_data_t
 
 	bool ignoreTimestamp;
 
+	// Talker appsink delivers byte stream access units instead of RTP packets
+	bool nalUnits;
+
 	GstElement       *pipe;
 	GstAppSink       *appsink;
 	GstAppSrc       *appsrc;
@@ -125,6 +128,14 @@ void openavbIntfH264RtpGstCfgCB(media_q_t *pMediaQ, const char *name, const char
 			pPvtData->ignoreTimestamp = (tmp == 1);
 		}
 	}
+	else if (strcmp(name, "intf_nv_nal_units") == 0)
+	{
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && tmp == 1)
+		{
+			pPvtData->nalUnits = (tmp == 1);
+		}
+	}
 }
 
 void openavbIntfH264RtpGstGenInitCB(media_q_t *pMediaQ)
@@ -194,15 +205,19 @@ static void createTxPipeline(media_q_t *pMediaQ)
 	//No limits for internal sink buffers. This may cause large memory consumption.
 	g_object_set(pPvtData->appsink, "max-buffers", 0, "drop", 0, NULL);
 
-	GstElement *rtpPayloader = gst_bin_get_by_name(GST_BIN(pPvtData->pipe), RTP_PAYLOADER_NAME);
-	if (rtpPayloader)
+	// Access units are fragmented by the mapping; there is no payloader to size
+	if (!pPvtData->nalUnits)
 	{
-		g_object_set(rtpPayloader, "mtu", openavbMediaQGetItemSize(pMediaQ), NULL);
-		gst_object_unref(rtpPayloader);
-	}
-	else
-	{
-		AVB_LOG_ERROR("Cannot set mtu on rtppayloader. Make sure that its name is avbrtppay in the pipeline.");
+		GstElement *rtpPayloader = gst_bin_get_by_name(GST_BIN(pPvtData->pipe), RTP_PAYLOADER_NAME);
+		if (rtpPayloader)
+		{
+			g_object_set(rtpPayloader, "mtu", openavbMediaQGetItemSize(pMediaQ), NULL);
+			gst_object_unref(rtpPayloader);
+		}
+		else
+		{
+			AVB_LOG_ERROR("Cannot set mtu on rtppayloader. Make sure that its name is avbrtppay in the pipeline.");
+		}
 	}
 
 	if (GST_STATE_CHANGE_FAILURE == gst_element_set_state(pPvtData->pipe, GST_STATE_PLAYING)) {
@@ -261,6 +276,57 @@ void openavbIntfH264RtpGstTxInitCB(media_q_t *pMediaQ)
 
 // This callback will be called for each AVB transmit interval. Commonly this will be
 // 4000 or 8000 times  per second.
+// Release a buffer attached to a media queue item
+static void x_releaseRtpBuf(void *pv)
+{
+	gst_al_rtp_buffer_unref((GstAlBuf *)pv);
+}
+
+static void x_releaseBuf(void *pv)
+{
+	gst_al_buffer_unref((GstAlBuf *)pv);
+}
+
+// Queue one byte stream access unit per item. The mapping splits it into
+// single NAL unit and FU-A packets, so a whole I-frame takes one item.
+static bool x_txAccessUnit(media_q_t *pMediaQ, media_q_item_t *pMediaQItem)
+{
+	pvt_data_t *pPvtData = pMediaQ->pPvtIntfInfo;
+	GstAlBuf *txBuf = gst_al_pull_buffer(GST_APP_SINK(pPvtData->appsink));
+
+	if (!txBuf)
+	{
+		pMediaQItem->dataLen = 0;
+		openavbMediaQHeadUnlock(pMediaQ);
+		AVB_LOG_ERROR("Gstreamer buffer pull problem");
+		return FALSE;
+	}
+	g_atomic_int_add(&pPvtData->nWaiting, -1);
+
+	U32 auSize = GST_AL_BUF_SIZE(txBuf);
+	bool bAttached = openavbMediaQHeadAttach(pMediaQ, GST_AL_BUF_DATA(txBuf), auSize, x_releaseBuf, txBuf);
+	if (!bAttached)
+	{
+		if (auSize > pMediaQItem->itemSize)
+		{
+			AVB_LOGF_ERROR("Access unit (%d) exceeds pMediaQItem itemSize (%d). Raise map_nv_item_size.", auSize, pMediaQItem->itemSize);
+			pMediaQItem->dataLen = 0;
+			openavbMediaQHeadUnlock(pMediaQ);
+			gst_al_buffer_unref(txBuf);
+			return FALSE;
+		}
+		memcpy(pMediaQItem->pPubData, GST_AL_BUF_DATA(txBuf), auSize);
+		pMediaQItem->dataLen = auSize;
+		gst_al_buffer_unref(txBuf);
+	}
+
+	((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->nalUnits = TRUE;
+	((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->lastPacket = TRUE;
+	openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+	openavbMediaQHeadPush(pMediaQ);
+	return TRUE;
+}
+
 bool openavbIntfH264RtpGstTxCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
@@ -289,7 +355,15 @@ bool openavbIntfH264RtpGstTxCB(media_q_t *pMediaQ)
 	{
 		//Transmit data --BEGIN--
 		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
-		if (pMediaQItem)
+		if (pMediaQItem && pPvtData->nalUnits)
+		{
+			if (!x_txAccessUnit(pMediaQ, pMediaQItem))
+			{
+				AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+				return FALSE;
+			}
+		}
+		else if (pMediaQItem)
 		{
 			U32 paySize = 0;
 
@@ -320,8 +394,13 @@ bool openavbIntfH264RtpGstTxCB(media_q_t *pMediaQ)
 				return FALSE;
 			}
 
-			pMediaQItem->dataLen = paySize;
-			memcpy(pMediaQItem->pPubData, GST_AL_BUF_DATA(txBuf), paySize);
+			// Hand the mapped payload to the media queue; it is released when
+			// the mapping module pulls the item. Copy if the item can't take it.
+			bool bAttached = openavbMediaQHeadAttach(pMediaQ, GST_AL_BUF_DATA(txBuf), paySize, x_releaseRtpBuf, txBuf);
+			if (!bAttached) {
+				pMediaQItem->dataLen = paySize;
+				memcpy(pMediaQItem->pPubData, GST_AL_BUF_DATA(txBuf), paySize);
+			}
 			if (gst_al_rtp_buffer_get_marker(txBuf))
 			{
 				((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->lastPacket = TRUE;
@@ -330,10 +409,13 @@ bool openavbIntfH264RtpGstTxCB(media_q_t *pMediaQ)
 			{
 				((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->lastPacket = FALSE;
 			}
+			((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->nalUnits = FALSE;
 			openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
 			openavbMediaQHeadPush(pMediaQ);
 
-			gst_al_rtp_buffer_unref(txBuf);
+			if (!bAttached) {
+				gst_al_rtp_buffer_unref(txBuf);
+			}
 		}
 		else
 		{
@@ -504,6 +586,29 @@ bool openavbIntfH264RtpGstRxCB(media_q_t *pMediaQ)
 			openavbMediaQTailPull(pMediaQ);
 			continue;
 		}
+		if (((media_q_item_map_h264_pub_data_t *)pMediaQItem->pPubMapData)->nalUnits)
+		{
+			// Access unit reassembled by the mapping (map_nv_reassemble). It goes
+			// to appsrc as one byte stream buffer, so no RTP depayloader is needed.
+			GstAlBuf *auBuf = gst_al_alloc_buffer(pMediaQItem->dataLen);
+			if (!auBuf)
+			{
+				AVB_LOG_ERROR("gst_al_alloc_buffer failed!");
+				openavbMediaQTailUnlock(pMediaQ);
+				return FALSE;
+			}
+			memcpy(GST_AL_BUF_DATA(auBuf), pMediaQItem->pPubData, pMediaQItem->dataLen);
+			GST_AL_BUFFER_TIMESTAMP(auBuf) = GST_CLOCK_TIME_NONE;
+			GST_AL_BUFFER_DURATION(auBuf) = GST_CLOCK_TIME_NONE;
+
+			GstFlowReturn ret = gst_al_push_buffer(GST_APP_SRC(pPvtData->appsrc), auBuf);
+			if (ret != GST_FLOW_OK)
+			{
+				AVB_LOGF_ERROR("Pushing buffer to appsrc failed with code %d", ret);
+			}
+			openavbMediaQTailPull(pMediaQ);
+			continue;
+		}
 		if (pPvtData->asyncRx)
 		{
 			U32 bufwr = pPvtData->bufwr;
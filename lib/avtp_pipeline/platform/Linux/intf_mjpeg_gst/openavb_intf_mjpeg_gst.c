@@ -55,6 +55,10 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #define NBUFS 256
 
+// RFC 2435 header sizes
+#define JPEG_MAIN_HEADER_SIZE		8
+#define JPEG_RESTART_HEADER_SIZE	4
+
 typedef struct pvt_data_t
 {
 	char *pPipelineStr;
@@ -72,6 +76,9 @@ typedef struct pvt_data_t
 	bool asyncRx;
 	bool blockingRx;
 
+	bool frameItems;                /*<! talker gathers each frame into one item */
+	bool frameDrop;                 /*<! discarding up to the end of a frame */
+
 	bool get_avtp_timestamp;        /*<! this flag indicates whether
                                         an avtp timestamp should be taken */
 	U32 frame_timestamp;            /*<! this is a timestamp of a video frame */
@@ -122,6 +129,14 @@ void openavbIntfMjpegGstCfgCB(media_q_t *pMediaQ, const char *name, const char *
 			pPvtData->blockingRx = (tmp == 1);
 		}
 	}
+	else if (strcmp(name, "intf_nv_frame_items") == 0)
+	{
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && tmp == 1)
+		{
+			pPvtData->frameItems = (tmp == 1);
+		}
+	}
 	else if (strcmp(name, "intf_nv_ignore_timestamp") == 0)
 	{
 		tmp = strtol(value, &pEnd, 10);
@@ -189,6 +204,83 @@ void openavbIntfMjpegGstTxInitCB(media_q_t *pMediaQ)
 
 // This callback will be called for each AVB transmit interval. Commonly this will be
 // 4000 or 8000 times  per second.
+// Release a buffer attached to a media queue item
+static void x_releaseRtpBuf(void *pv)
+{
+	gst_al_rtp_buffer_unref((GstAlBuf *)pv);
+}
+
+// Gather the RTP payloads of a frame into one item, the way the listener
+// reassembles them: the first payload whole, then only the JPEG data of the
+// others. The mapping fragments the item again (map_nv_fragment).
+static bool x_txFrameItem(media_q_t *pMediaQ, pvt_data_t *pPvtData, GstAlBuf *txBuf)
+{
+	const U8 *pPay = GST_AL_BUF_DATA(txBuf);
+	U32 paySize = GST_AL_BUF_SIZE(txBuf);
+	bool marker = gst_al_rtp_buffer_get_marker(txBuf);
+
+	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+	if (!pMediaQItem)
+	{
+		// Only happens at the start of a frame, the item is kept until its end
+		IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Media queue full.");
+		pPvtData->frameDrop = !marker;
+		return FALSE;
+	}
+
+	if (!pPvtData->frameDrop)
+	{
+		if (pMediaQItem->dataLen == 0)
+		{
+			U32 offset = (paySize >= JPEG_MAIN_HEADER_SIZE) ? ((pPay[1] << 16) | (pPay[2] << 8) | pPay[3]) : 1;
+			if (offset == 0 && paySize <= pMediaQItem->itemSize)
+			{
+				openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+				memcpy(pMediaQItem->pPubData, pPay, paySize);
+				pMediaQItem->dataLen = paySize;
+			}
+			else
+			{
+				pPvtData->frameDrop = TRUE;
+			}
+		}
+		else
+		{
+			U32 hdrLen = JPEG_MAIN_HEADER_SIZE + ((pPay[4] >= 64 && pPay[4] <= 127) ? JPEG_RESTART_HEADER_SIZE : 0);
+			if (paySize >= hdrLen && pMediaQItem->dataLen + paySize - hdrLen <= pMediaQItem->itemSize)
+			{
+				memcpy((U8 *)pMediaQItem->pPubData + pMediaQItem->dataLen, pPay + hdrLen, paySize - hdrLen);
+				pMediaQItem->dataLen += paySize - hdrLen;
+			}
+			else
+			{
+				pPvtData->frameDrop = TRUE;
+			}
+		}
+		if (pPvtData->frameDrop)
+		{
+			IF_LOG_INTERVAL(100) AVB_LOGF_WARNING("Unexpected fragment or frame larger than item (%u). Dropping frame.", pMediaQItem->itemSize);
+		}
+	}
+
+	if (pPvtData->frameDrop)
+	{
+		pMediaQItem->dataLen = 0;
+		pPvtData->frameDrop = !marker;
+		openavbMediaQHeadUnlock(pMediaQ);
+	}
+	else if (marker)
+	{
+		((media_q_item_map_mjpeg_pub_data_t *)pMediaQItem->pPubMapData)->lastFragment = TRUE;
+		openavbMediaQHeadPush(pMediaQ);
+	}
+	else
+	{
+		openavbMediaQHeadUnlock(pMediaQ);
+	}
+	return TRUE;
+}
+
 bool openavbIntfMjpegGstTxCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
@@ -222,12 +314,25 @@ bool openavbIntfMjpegGstTxCB(media_q_t *pMediaQ)
 
 	paySize = GST_AL_BUF_SIZE(txBuf);
 
+	if (pPvtData->frameItems)
+	{
+		bool ret = x_txFrameItem(pMediaQ, pPvtData, txBuf);
+		gst_al_rtp_buffer_unref(txBuf);
+		AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+		return ret;
+	}
+
 	//Transmit data --BEGIN--
 	media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
 	if (pMediaQItem)
 	{
-		pMediaQItem->dataLen = paySize;
-		memcpy(pMediaQItem->pPubData, GST_AL_BUF_DATA(txBuf), paySize);
+		// Hand the mapped payload to the media queue; it is released when
+		// the mapping module pulls the item. Copy if the item can't take it.
+		bool bAttached = openavbMediaQHeadAttach(pMediaQ, GST_AL_BUF_DATA(txBuf), paySize, x_releaseRtpBuf, txBuf);
+		if (!bAttached) {
+			pMediaQItem->dataLen = paySize;
+			memcpy(pMediaQItem->pPubData, GST_AL_BUF_DATA(txBuf), paySize);
+		}
 		if (gst_al_rtp_buffer_get_marker(txBuf))
 		{
 			((media_q_item_map_mjpeg_pub_data_t *)pMediaQItem->pPubMapData)->lastFragment = TRUE;
@@ -247,7 +352,9 @@ bool openavbIntfMjpegGstTxCB(media_q_t *pMediaQ)
 		}
 		openavbMediaQHeadPush(pMediaQ);
 
-		gst_al_rtp_buffer_unref(txBuf);
+		if (!bAttached) {
+			gst_al_rtp_buffer_unref(txBuf);
+		}
 
 		AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
 		return TRUE;
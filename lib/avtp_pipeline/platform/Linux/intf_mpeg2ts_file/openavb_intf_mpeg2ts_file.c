@@ -32,11 +32,21 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 * MODULE SUMMARY : Mpeg2 TS File interface module.
 *                  Computation of TS packet duration copied 
 *                  from Live555 application (www.live555.com).
+*
+* With intf_nv_pcr_pacing the talker instead sends every TS packet at the
+* time its PCRs give it. The input is read ahead to the next PCR, the
+* packets between two PCRs are spread evenly over the time between them, and
+* each TX call pushes just the packets that have come due, timestamped with
+* the time of the first. VBR content therefore goes out at its own rate.
 */
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "openavb_platform_pub.h"
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_mediaq_pub.h"
@@ -52,6 +62,17 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define MAX_TABLE_PIDS 100
 #define F27_MHZ 27000000.0
 #define F90_KHZ 90000.0
+#define MMAP_READAHEAD (1024 * 1024)
+
+#define TS_PACKET_SIZE 188
+// PCR pacing: how far ahead of the packet being sent the input is read
+#define PCR_LOOKAHEAD_PACKETS 4096
+// PCR steps larger than this (or backwards) are treated as discontinuities
+#define PCR_MAX_STEP_NSEC NANOSECONDS_PER_SECOND
+// Falling further behind than this restarts the schedule rather than bursting to catch up
+#define PCR_MAX_LATE_NSEC (50 * NANOSECONDS_PER_MSEC)
+// PCR wraps at 2^33 * 300 ticks of 27 MHz
+#define PCR_WRAP (((U64)1 << 33) * 300)
 
 struct PIDStatus {
   double firstClock, lastClock, firstRealTime, lastRealTime;
@@ -77,11 +98,20 @@ typedef struct {
 	// Ignore timestamp at listener.
 	bool ignoreTimestamp;
 
+	// intf_nv_mmap: Map the talker input file into memory rather than reading it with stdio.
+	bool useMmap;
+
 	/////////////
 	// Variable data
 	/////////////
 	FILE *pFile;
 
+	// Talker file mapping (NULL when reading with stdio)
+	U8 *pMap;
+	size_t mapSize;
+	size_t mapOffset;
+	size_t mapAdviseOffset;
+
 	// Talker variables for tracking rewind
 	struct timespec startTime;
 	int nRepeatCount;
@@ -96,6 +126,26 @@ typedef struct {
 	double fTSPacketDurationEstimate;
 	struct PIDStatus *fPIDStatusTable;
 
+	// intf_nv_pcr_pacing: send packets at the times their PCRs give them
+	bool pcrPacing;
+
+	// PCR pacing state. pLook holds the input from the next packet to send
+	// (lookHead) on to lookTail, reaching to the next PCR when possible.
+	U8 *pLook;
+	U32 lookHead;
+	U32 lookTail;
+	int pcrPid;
+	bool bHavePcr;
+	U64 lastPcr;
+	// Time of the last PCR packet, packets sent since it and the spacing to the next PCR
+	U64 pcrTimeNS;
+	U64 pcrPktsSent;
+	U64 pktNS;
+	// Offset of the next PCR packet in pLook, or -1 if not read yet
+	S32 nextPcrOff;
+	U64 nextPcr;
+	bool nextPcrDiscontinuity;
+
 } pvt_data_t;
 
 double openavbIntfMpeg2tsFileComputeDuration(pvt_data_t* pPvtData, unsigned char* pkts, unsigned int length);
@@ -129,6 +179,81 @@ int pidTableFindOrCreatePid(struct PIDStatus *table, const unsigned int pid)
 	return idx;
 }
 
+static void x_unmapFile(pvt_data_t *pPvtData)
+{
+	if (pPvtData->pMap) {
+		munmap(pPvtData->pMap, pPvtData->mapSize);
+		pPvtData->pMap = NULL;
+		pPvtData->mapSize = 0;
+	}
+}
+
+// Map the already opened input file. On any failure the stdio path is used instead.
+static void x_mapFile(pvt_data_t *pPvtData)
+{
+	struct stat buf;
+	int fd = fileno(pPvtData->pFile);
+
+	if (fstat(fd, &buf) != 0 || !S_ISREG(buf.st_mode) || buf.st_size == 0) {
+		AVB_LOGF_WARNING("Unable to map input file, using stdio: %s", pPvtData->pFileName);
+		return;
+	}
+
+	void *pMap = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (pMap == MAP_FAILED) {
+		AVB_LOGF_WARNING("Unable to map input file, using stdio: %s, %s", pPvtData->pFileName, strerror(errno));
+		return;
+	}
+	madvise(pMap, buf.st_size, MADV_SEQUENTIAL);
+
+	pPvtData->pMap = pMap;
+	pPvtData->mapSize = buf.st_size;
+	pPvtData->mapOffset = 0;
+	pPvtData->mapAdviseOffset = 0;
+	AVB_LOGF_INFO("Mapped input file: %s (%zu bytes)", pPvtData->pFileName, pPvtData->mapSize);
+}
+
+// Copy up to len bytes from the mapping, keeping the next window faulted in ahead of us.
+static size_t x_readMap(pvt_data_t *pPvtData, U8 *pDest, size_t len)
+{
+	if (pPvtData->mapOffset + MMAP_READAHEAD / 2 >= pPvtData->mapAdviseOffset
+		&& pPvtData->mapAdviseOffset < pPvtData->mapSize) {
+		size_t adviseLen = pPvtData->mapSize - pPvtData->mapAdviseOffset;
+		if (adviseLen > MMAP_READAHEAD) {
+			adviseLen = MMAP_READAHEAD;
+		}
+		madvise(pPvtData->pMap + pPvtData->mapAdviseOffset, adviseLen, MADV_WILLNEED);
+		pPvtData->mapAdviseOffset += MMAP_READAHEAD;
+	}
+
+	size_t remaining = pPvtData->mapSize - pPvtData->mapOffset;
+	if (len > remaining) {
+		len = remaining;
+	}
+	memcpy(pDest, pPvtData->pMap + pPvtData->mapOffset, len);
+	pPvtData->mapOffset += len;
+	return len;
+}
+
+static bool x_inputAtEnd(pvt_data_t *pPvtData)
+{
+	if (pPvtData->pMap) {
+		return pPvtData->mapOffset >= pPvtData->mapSize;
+	}
+	return feof(pPvtData->pFile);
+}
+
+static void x_rewind(pvt_data_t *pPvtData)
+{
+	if (pPvtData->pMap) {
+		pPvtData->mapOffset = 0;
+		pPvtData->mapAdviseOffset = 0;
+	}
+	else {
+		fseek(pPvtData->pFile, 0, 0);
+	}
+}
+
 // Each configuration name value pair for this mapping will result in this callback being called.
 void openavbIntfMpeg2tsFileCfgCB(media_q_t *pMediaQ, const char *name, const char *value) 
 {
@@ -173,6 +298,20 @@ void openavbIntfMpeg2tsFileCfgCB(media_q_t *pMediaQ, const char *name, const cha
 				valueOK = TRUE;
 			}
 		}
+		else if (strcmp(name, "intf_nv_mmap") == 0) {
+			tmp = strtoul(value, &pEnd, 10);
+			if (*pEnd == '\0' && pEnd != value && (tmp == 0 || tmp == 1)) {
+				pPvtData->useMmap = (tmp == 1);
+				valueOK = TRUE;
+			}
+		}
+		else if (strcmp(name, "intf_nv_pcr_pacing") == 0) {
+			tmp = strtoul(value, &pEnd, 10);
+			if (*pEnd == '\0' && pEnd != value && (tmp == 0 || tmp == 1)) {
+				pPvtData->pcrPacing = (tmp == 1);
+				valueOK = TRUE;
+			}
+		}
 		else if (strcmp(name, "intf_nv_enable_proper_bitrate_streaming") == 0) {
 			tmp = strtoul(value, &pEnd, 10);
 			if (*pEnd == '\0' && pEnd != value && (tmp == 0 || tmp == 1)) {
@@ -303,6 +442,183 @@ unsigned int openavbIntMpeg2tsGetSrcBitrate(media_q_t *pMediaQ)
 
 	return ((pvt_data_t *)pMediaQ->pPvtIntfInfo)->maxBitrate;
 }
+// Read up to len bytes of input
+static size_t x_readInput(pvt_data_t *pPvtData, U8 *pDest, size_t len)
+{
+	if (pPvtData->pMap) {
+		return x_readMap(pPvtData, pDest, len);
+	}
+	return fread(pDest, 1, len, pPvtData->pFile);
+}
+
+// PCR of a TS packet in 27 MHz ticks, if it carries one
+static bool x_pcrGet(const U8 *pkt, U64 *pPcr, bool *pDiscontinuity)
+{
+	if (!(pkt[3] & 0x20) || pkt[4] < 7 || !(pkt[5] & 0x10)) {
+		return FALSE;
+	}
+	U64 base = ((U64)pkt[6] << 25) | ((U64)pkt[7] << 17) | ((U64)pkt[8] << 9) | ((U64)pkt[9] << 1) | (pkt[10] >> 7);
+	U32 ext = ((pkt[10] & 0x01) << 8) | pkt[11];
+	*pPcr = base * 300 + ext;
+	*pDiscontinuity = (pkt[5] & 0x80) != 0;
+	return TRUE;
+}
+
+static void x_pcrReset(pvt_data_t *pPvtData)
+{
+	pPvtData->lookHead = pPvtData->lookTail = 0;
+	pPvtData->pcrPid = -1;
+	pPvtData->bHavePcr = FALSE;
+	pPvtData->pcrPktsSent = 0;
+	pPvtData->pktNS = 0;
+	pPvtData->nextPcrOff = -1;
+}
+
+// Find the next PCR on the PCR PID after the packet being sent, reading more
+// input as needed. Returns FALSE if the lookahead or the input ran out first.
+static bool x_pcrLookahead(pvt_data_t *pPvtData)
+{
+	U32 off = pPvtData->lookHead + (pPvtData->bHavePcr && pPvtData->pcrPktsSent == 0 ? TS_PACKET_SIZE : 0);
+
+	while (1) {
+		for (; off + TS_PACKET_SIZE <= pPvtData->lookTail; off += TS_PACKET_SIZE) {
+			U8 *pkt = pPvtData->pLook + off;
+			int pid = ((pkt[1] & 0x1F) << 8) | pkt[2];
+			U64 pcr;
+			bool discontinuity;
+
+			if ((pPvtData->pcrPid < 0 || pid == pPvtData->pcrPid) && x_pcrGet(pkt, &pcr, &discontinuity)) {
+				if (pPvtData->pcrPid < 0) {
+					AVB_LOGF_INFO("Pacing on the PCRs of PID 0x%x", pid);
+					pPvtData->pcrPid = pid;
+				}
+				pPvtData->nextPcrOff = off;
+				pPvtData->nextPcr = pcr;
+				pPvtData->nextPcrDiscontinuity = discontinuity;
+				return TRUE;
+			}
+		}
+
+		// Keep the unsent packets at the start of the buffer and read more
+		if (pPvtData->lookHead > 0) {
+			memmove(pPvtData->pLook, pPvtData->pLook + pPvtData->lookHead, pPvtData->lookTail - pPvtData->lookHead);
+			off -= pPvtData->lookHead;
+			pPvtData->lookTail -= pPvtData->lookHead;
+			pPvtData->lookHead = 0;
+		}
+		U32 room = PCR_LOOKAHEAD_PACKETS * TS_PACKET_SIZE - pPvtData->lookTail;
+		if (room < TS_PACKET_SIZE || x_inputAtEnd(pPvtData)) {
+			return FALSE;
+		}
+		size_t result = x_readInput(pPvtData, pPvtData->pLook + pPvtData->lookTail, room);
+		if (result == 0) {
+			return FALSE;
+		}
+		pPvtData->lookTail += result;
+
+		// Resynchronize if the input doesn't start on a packet boundary
+		while (pPvtData->lookHead < pPvtData->lookTail && pPvtData->pLook[pPvtData->lookHead] != MPEGTS_SYNC_BYTE) {
+			pPvtData->lookHead++;
+		}
+		if (off < pPvtData->lookHead) {
+			off = pPvtData->lookHead;
+		}
+	}
+}
+
+// Spread the packets up to the next PCR found by x_pcrLookahead() over the
+// time to it. Across a discontinuity the last spacing is kept.
+static void x_pcrSpacing(pvt_data_t *pPvtData)
+{
+	U64 nPkts = pPvtData->pcrPktsSent + (pPvtData->nextPcrOff - pPvtData->lookHead) / TS_PACKET_SIZE;
+
+	if (pPvtData->bHavePcr && !pPvtData->nextPcrDiscontinuity && nPkts > 0) {
+		U64 stepNS = ((pPvtData->nextPcr + PCR_WRAP - pPvtData->lastPcr) % PCR_WRAP) * 1000 / 27;
+		if (stepNS > 0 && stepNS <= PCR_MAX_STEP_NSEC) {
+			pPvtData->pktNS = stepNS / nPkts;
+			return;
+		}
+	}
+	if (pPvtData->bHavePcr) {
+		IF_LOG_INTERVAL(100) AVB_LOG_INFO("PCR discontinuity");
+	}
+}
+
+// Whole packets read ahead and not sent yet
+static U32 x_pcrPending(pvt_data_t *pPvtData)
+{
+	return (pPvtData->lookTail - pPvtData->lookHead) / TS_PACKET_SIZE;
+}
+
+// Push the packets that have come due. Returns TRUE if anything was pushed.
+static bool x_pcrPacedTx(media_q_t *pMediaQ, pvt_data_t *pPvtData)
+{
+	U64 nowNS = 0;
+	bool bPushed = FALSE;
+
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+
+	if (pPvtData->bHavePcr
+		&& nowNS > pPvtData->pcrTimeNS + pPvtData->pcrPktsSent * pPvtData->pktNS + PCR_MAX_LATE_NSEC) {
+		IF_LOG_INTERVAL(100) AVB_LOG_WARNING("PCR pacing fell behind; restarting the schedule");
+		pPvtData->pcrTimeNS = nowNS - pPvtData->pcrPktsSent * pPvtData->pktNS;
+	}
+
+	while (1) {
+		// The next PCR packet starts a new segment. The first one anchors
+		// the PCRs to the time now.
+		if (pPvtData->nextPcrOff >= 0 && pPvtData->lookHead == (U32)pPvtData->nextPcrOff) {
+			if (pPvtData->bHavePcr) {
+				pPvtData->pcrTimeNS += pPvtData->pcrPktsSent * pPvtData->pktNS;
+			}
+			else {
+				pPvtData->pcrTimeNS = nowNS;
+				pPvtData->bHavePcr = TRUE;
+			}
+			pPvtData->pcrPktsSent = 0;
+			pPvtData->lastPcr = pPvtData->nextPcr;
+			pPvtData->nextPcrOff = -1;
+		}
+		if (pPvtData->nextPcrOff < 0 && x_pcrLookahead(pPvtData)) {
+			x_pcrSpacing(pPvtData);
+		}
+
+		// Packets up to the next PCR (or all read so far when it isn't
+		// known) whose time has come. Before the first PCR they all have.
+		U32 nAvail = pPvtData->nextPcrOff >= 0
+			? (pPvtData->nextPcrOff - pPvtData->lookHead) / TS_PACKET_SIZE
+			: x_pcrPending(pPvtData);
+		U32 nDue = 0;
+		while (nDue < nAvail
+			&& (!pPvtData->bHavePcr || pPvtData->pcrTimeNS + (pPvtData->pcrPktsSent + nDue) * pPvtData->pktNS <= nowNS)) {
+			nDue++;
+		}
+		if (nDue == 0) {
+			break;
+		}
+
+		media_q_item_t *pMediaQItem = openavbMediaQHeadLock(pMediaQ);
+		if (!pMediaQItem) {
+			IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Media queue full");
+			break;
+		}
+		if (nDue > pMediaQItem->itemSize / TS_PACKET_SIZE) {
+			nDue = pMediaQItem->itemSize / TS_PACKET_SIZE;
+		}
+		memcpy(pMediaQItem->pPubData, pPvtData->pLook + pPvtData->lookHead, nDue * TS_PACKET_SIZE);
+		pMediaQItem->dataLen = nDue * TS_PACKET_SIZE;
+		openavbAvtpTimeSetToTimestampNS(pMediaQItem->pAvtpTime, pPvtData->bHavePcr
+			? pPvtData->pcrTimeNS + pPvtData->pcrPktsSent * pPvtData->pktNS : nowNS);
+		openavbMediaQHeadPush(pMediaQ);
+		bPushed = TRUE;
+
+		pPvtData->lookHead += nDue * TS_PACKET_SIZE;
+		pPvtData->pcrPktsSent += nDue;
+	}
+
+	return bPushed;
+}
+
 // A call to this callback indicates that this interface module will be
 // a talker. Any talker initialization can be done in this function.
 void openavbIntfMpeg2tsFileTxInitCB(media_q_t *pMediaQ) 
@@ -331,6 +647,21 @@ void openavbIntfMpeg2tsFileTxInitCB(media_q_t *pMediaQ)
 				AVB_TRACE_EXIT(AVB_TRACE_INTF);
 				return;
 			}
+
+			if (pPvtData->useMmap) {
+				x_mapFile(pPvtData);
+			}
+		}
+
+		if (pPvtData->pcrPacing) {
+			if (!pPvtData->pLook) {
+				pPvtData->pLook = malloc(PCR_LOOKAHEAD_PACKETS * TS_PACKET_SIZE);
+			}
+			if (!pPvtData->pLook) {
+				AVB_LOG_ERROR("Unable to allocate PCR lookahead; not pacing");
+				pPvtData->pcrPacing = FALSE;
+			}
+			x_pcrReset(pPvtData);
 		}
 	}
 
@@ -363,7 +694,7 @@ bool openavbIntfMpeg2tsFileTxCB(media_q_t *pMediaQ)
 		clock_gettime(CLOCK_MONOTONIC, &now);
 
 		double nowSeconds = 0;
-		if (pPvtData->enableBitrateTracking) {
+		if (pPvtData->enableBitrateTracking && !pPvtData->pcrPacing) {
 			nowSeconds = (double)now.tv_sec + (double)now.tv_nsec / NANOSECONDS_PER_SECOND;
 
 			if (nowSeconds < pPvtData->nextTransmitTime)
@@ -372,8 +703,8 @@ bool openavbIntfMpeg2tsFileTxCB(media_q_t *pMediaQ)
 			}
 		}
 
-		// handle end-of-file
-		if (feof(pPvtData->pFile)) {
+		// handle end-of-file, once the packets read ahead have been sent
+		if (x_inputAtEnd(pPvtData) && (!pPvtData->pcrPacing || x_pcrPending(pPvtData) == 0)) {
 			if (pPvtData->pFileName && pPvtData->repeat) {
 				if (pPvtData->nRepeatCount < 2)
 					; // No delay for first few rewinds - want to buffer some data for restarts
@@ -386,11 +717,16 @@ bool openavbIntfMpeg2tsFileTxCB(media_q_t *pMediaQ)
 				}
 
 				AVB_LOGF_INFO("EOF, rewinding input file: %s", pPvtData->pFileName);
-				fseek(pPvtData->pFile, 0, 0);
+				x_rewind(pPvtData);
 
 				pPvtData->nRepeatCount++;
 				pPvtData->nBuffersSent = 0;
 
+				if (pPvtData->pcrPacing) {
+					// The first PCR of the new pass is anchored to the time it is reached
+					x_pcrReset(pPvtData);
+				}
+
 				if (pPvtData->enableBitrateTracking) {
 					// clear PCR infos here, PID hashtable, packet duration estimate
 					pPvtData->fTSPacketDurationEstimate = 0;
@@ -408,6 +744,7 @@ bool openavbIntfMpeg2tsFileTxCB(media_q_t *pMediaQ)
 			}
 			else {
 				AVB_LOGF_INFO("EOF, closing input file: %s", pPvtData->pFileName);
+				x_unmapFile(pPvtData);
 				fclose(pPvtData->pFile);
 				pPvtData->pFile = NULL;
 				AVB_TRACE_EXIT(AVB_TRACE_MAP_DETAIL);
@@ -415,6 +752,15 @@ bool openavbIntfMpeg2tsFileTxCB(media_q_t *pMediaQ)
 			}
 		}
 
+		if (pPvtData->pcrPacing) {
+			retval = x_pcrPacedTx(pMediaQ, pPvtData);
+			if (retval && pPvtData->nBuffersSent++ == 0) {
+				pPvtData->startTime = now;
+			}
+			AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
+			return retval;
+		}
+
 		pMediaQItem = openavbMediaQHeadLock(pMediaQ);
 		if (!pMediaQItem) {
 			IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Media queue full");
@@ -422,7 +768,13 @@ bool openavbIntfMpeg2tsFileTxCB(media_q_t *pMediaQ)
 			return FALSE;	// Media queue full
 		}
  
-		size_t result = fread(pMediaQItem->pPubData, 1, pMediaQItem->itemSize, pPvtData->pFile);
+		size_t result;
+		if (pPvtData->pMap) {
+			result = x_readMap(pPvtData, pMediaQItem->pPubData, pMediaQItem->itemSize);
+		}
+		else {
+			result = fread(pMediaQItem->pPubData, 1, pMediaQItem->itemSize, pPvtData->pFile);
+		}
 		if (result == 0) {
 			int e = ferror(pPvtData->pFile);
 			if (e != 0) {
@@ -630,10 +982,17 @@ void openavbIntfMpeg2tsFileEndCB(media_q_t *pMediaQ)
 			return;
 		}
 
+		x_unmapFile(pPvtData);
+
 		if (pPvtData->pFile) {
 			fclose(pPvtData->pFile);
 			pPvtData->pFile = NULL;
 		}
+
+		if (pPvtData->pLook) {
+			free(pPvtData->pLook);
+			pPvtData->pLook = NULL;
+		}
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_INTF);
@@ -309,6 +309,12 @@ void openavbIntfMpeg2tsGstTxInitCB(media_q_t *pMediaQ)
 	AVB_TRACE_EXIT(AVB_TRACE_INTF_DETAIL);
 }
 
+// Release a buffer attached to a media queue item
+static void x_releaseBuf(void *pv)
+{
+	gst_al_buffer_unref((GstAlBuf *)pv);
+}
+
 bool openavbIntfMpeg2tsGstTxCB(media_q_t *pMediaQ)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_INTF_DETAIL);
@@ -360,6 +366,13 @@ bool openavbIntfMpeg2tsGstTxCB(media_q_t *pMediaQ)
 				pMediaQItem->dataLen = 0;
 				openavbMediaQHeadUnlock(pMediaQ);
 			}
+			else if (openavbMediaQHeadAttach(pMediaQ, GST_AL_BUF_DATA(txBuf), GST_AL_BUF_SIZE(txBuf), x_releaseBuf, txBuf))
+			{
+				// The mapped buffer is released when the mapping module pulls the item
+				openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
+				openavbMediaQHeadPush(pMediaQ);
+				txBuf = NULL;
+			}
 			else
 			{
 				memcpy(pMediaQItem->pPubData, GST_AL_BUF_DATA(txBuf), GST_AL_BUF_SIZE(txBuf));
@@ -367,7 +380,10 @@ bool openavbIntfMpeg2tsGstTxCB(media_q_t *pMediaQ)
 				openavbAvtpTimeSetToWallTime(pMediaQItem->pAvtpTime);
 				openavbMediaQHeadPush(pMediaQ);
 			}
-			gst_al_buffer_unref(txBuf);
+			if (txBuf)
+			{
+				gst_al_buffer_unref(txBuf);
+			}
 		}
 		else
 		{
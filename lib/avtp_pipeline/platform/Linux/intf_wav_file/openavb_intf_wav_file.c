@@ -39,7 +39,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
 #include "openavb_mediaq_pub.h"
@@ -72,6 +74,12 @@ typedef struct {
 
 } wav_file_header_t;
 
+// Offset of the sample data for our only supported wav file format.
+#define WAV_FILE_DATA_OFFSET	44
+
+// Size of the window prefetched ahead of the read position when mapped.
+#define WAV_FILE_MMAP_READAHEAD	(1024 * 1024)
+
 
 typedef struct {
 	/////////////
@@ -80,11 +88,20 @@ typedef struct {
 	// intf_nv_file_name: The fully qualified file name used both the talker and listener.
 	char *pFileName;
 
+	// intf_nv_mmap: Map the input file into memory rather than reading it with stdio.
+	bool useMmap;
+
 	/////////////
 	// Variable data
 	/////////////
 	FILE *pFile;
 
+	// Talker file mapping (NULL when reading with stdio)
+	U8 *pMap;
+	size_t mapSize;
+	size_t mapOffset;
+	size_t mapAdviseOffset;
+
 	// ALSA read/write interval
 	U32 intervalCounter;
 
@@ -120,6 +137,76 @@ static inline void ifwrite(void *ptr, size_t size, size_t num, FILE *stream)
     }
 }
 
+static void x_unmapFile(pvt_data_t *pPvtData)
+{
+	if (pPvtData->pMap) {
+		munmap(pPvtData->pMap, pPvtData->mapSize);
+		pPvtData->pMap = NULL;
+		pPvtData->mapSize = 0;
+	}
+}
+
+// Map the already opened input file. On any failure the stdio path is used instead.
+static void x_mapFile(pvt_data_t *pPvtData)
+{
+	struct stat buf;
+	int fd = fileno(pPvtData->pFile);
+
+	x_unmapFile(pPvtData);
+
+	if (fstat(fd, &buf) != 0 || !S_ISREG(buf.st_mode) || buf.st_size <= WAV_FILE_DATA_OFFSET) {
+		AVB_LOGF_WARNING("Unable to map input file, using stdio: %s", pPvtData->pFileName);
+		return;
+	}
+
+	void *pMap = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (pMap == MAP_FAILED) {
+		AVB_LOGF_WARNING("Unable to map input file, using stdio: %s, %s", pPvtData->pFileName, strerror(errno));
+		return;
+	}
+	madvise(pMap, buf.st_size, MADV_SEQUENTIAL);
+
+	pPvtData->pMap = pMap;
+	pPvtData->mapSize = buf.st_size;
+	pPvtData->mapOffset = WAV_FILE_DATA_OFFSET;
+	pPvtData->mapAdviseOffset = 0;
+	AVB_LOGF_INFO("Mapped input file: %s (%zu bytes)", pPvtData->pFileName, pPvtData->mapSize);
+}
+
+// Copy up to len bytes from the mapping, keeping the next window faulted in ahead of us.
+static U32 x_readMap(pvt_data_t *pPvtData, U8 *pDest, U32 len)
+{
+	if (pPvtData->mapOffset + WAV_FILE_MMAP_READAHEAD / 2 >= pPvtData->mapAdviseOffset
+		&& pPvtData->mapAdviseOffset < pPvtData->mapSize) {
+		size_t adviseLen = pPvtData->mapSize - pPvtData->mapAdviseOffset;
+		if (adviseLen > WAV_FILE_MMAP_READAHEAD) {
+			adviseLen = WAV_FILE_MMAP_READAHEAD;
+		}
+		madvise(pPvtData->pMap + pPvtData->mapAdviseOffset, adviseLen, MADV_WILLNEED);
+		pPvtData->mapAdviseOffset += WAV_FILE_MMAP_READAHEAD;
+	}
+
+	size_t remaining = pPvtData->mapSize - pPvtData->mapOffset;
+	if (len > remaining) {
+		len = remaining;
+	}
+	memcpy(pDest, pPvtData->pMap + pPvtData->mapOffset, len);
+	pPvtData->mapOffset += len;
+	return len;
+}
+
+// Repeat the wav file from the start of its sample data.
+static void x_rewind(pvt_data_t *pPvtData)
+{
+	if (pPvtData->pMap) {
+		pPvtData->mapOffset = WAV_FILE_DATA_OFFSET;
+		pPvtData->mapAdviseOffset = 0;
+	}
+	else {
+		fseek(pPvtData->pFile, WAV_FILE_DATA_OFFSET, 0);
+	}
+}
+
 static void x_parseWaveFile(media_q_t *pMediaQ)
 {
 	if (pMediaQ) {
@@ -371,6 +458,15 @@ void openavbIntfWavFileCfgCB(media_q_t *pMediaQ, const char *name, const char *v
                 AVB_LOG_INFO("Forced audio samples endian conversion: little <-> big");
             }
         }
+        else if (strcmp(name, "intf_nv_mmap") == 0) {
+            val = strtol(value, &pEnd, 10);
+            if (*pEnd == '\0' && pEnd != value && (val == 0 || val == 1)) {
+                pPvtData->useMmap = (val == 1);
+            }
+            else {
+                AVB_LOG_ERROR("Invalid value configured for intf_nv_mmap.");
+            }
+        }
     }
     AVB_TRACE_EXIT(AVB_TRACE_INTF);
 }
@@ -422,7 +518,11 @@ void openavbIntfWavFileTxInitCB(media_q_t *pMediaQ)
 
 		if (pPvtData->pFile) {
 			// Seek to start of data for our only supported wav file format.
-			fseek(pPvtData->pFile, 44, 0);
+			fseek(pPvtData->pFile, WAV_FILE_DATA_OFFSET, 0);
+
+			if (pPvtData->useMmap) {
+				x_mapFile(pPvtData);
+			}
 		}
 	}
 
@@ -464,14 +564,20 @@ bool openavbIntfWavFileTxCB(media_q_t *pMediaQ)
 
 			if (pPvtData->pFile) {
 
-				U32 bytesRead = fread(pMediaQItem->pPubData, 1, pPubMapUncmpAudioInfo->itemSize, pPvtData->pFile);
+				U32 bytesRead;
+				if (pPvtData->pMap) {
+					bytesRead = x_readMap(pPvtData, pMediaQItem->pPubData, pPubMapUncmpAudioInfo->itemSize);
+				}
+				else {
+					bytesRead = fread(pMediaQItem->pPubData, 1, pPubMapUncmpAudioInfo->itemSize, pPvtData->pFile);
+				}
 
 				if (bytesRead < pPubMapUncmpAudioInfo->itemSize) {
 					// Pad reminder of item with anything we didn't read because of end of file.
 					memset(pMediaQItem->pPubData + bytesRead, 0x00, pPubMapUncmpAudioInfo->itemSize - bytesRead);
 
-					// Repeat wav file. Seek to start of data for our only supported wav file format.
-					fseek(pPvtData->pFile, 44, 0);
+					// Repeat wav file.
+					x_rewind(pPvtData);
 				}
 				pMediaQItem->dataLen = pPubMapUncmpAudioInfo->itemSize;
 
@@ -637,6 +743,8 @@ void openavbIntfWavFileEndCB(media_q_t *pMediaQ)
 			return;
 		}
 
+		x_unmapFile(pPvtData);
+
 		if (pPvtData->pFile) {
 			fclose(pPvtData->pFile);
 			pPvtData->pFile = NULL;
@@ -65,6 +65,12 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define SLEEP(sec)  							   sleep(sec)
 #define SLEEP_MSEC(mSec)						   usleep(mSec * 1000)
 #define SLEEP_NSEC(nSec)						   usleep(nSec / 1000)
+#if AVB_FEATURE_SIM
+// The simulation runs on one thread, so sleeping is moving the virtual clock
+#define SLEEP_UNTIL_NSEC(nSec)  				   osalSimSetTime(nSec)
+#define SPIN_UNTIL_NSEC(nsec)					osalSimSetTime(nsec)
+#define SLEEP_SPIN_UNTIL_NSEC(nsec, guardNSec)	osalSimSetTime(nsec)
+#else
 #define SLEEP_UNTIL_NSEC(nSec)  				   xSleepUntilNSec(nSec)
 inline static void xSleepUntilNSec(U64 nSec)
 {
@@ -74,17 +80,30 @@ inline static void xSleepUntilNSec(U64 nSec)
 	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tmpTime, NULL);
 }
 
-#define SPIN_UNTIL_NSEC(nsec)					xSpinUntilNSec(nsec)
-inline static void xSpinUntilNSec(U64 nSec)
+// Wait until nSec on the wall (gPTP) clock. The target is moved onto the
+// timer clock once, then the thread sleeps until guardNSec before it and spins
+// out the rest on the timer clock. That is a vDSO read (the TSC on x86), so the
+// spin doesn't keep taking the gPTP shared memory for every other reader.
+#define SPIN_UNTIL_NSEC(nsec)					xWaitUntilNSec(nsec, UINT64_MAX)
+#define SLEEP_SPIN_UNTIL_NSEC(nsec, guardNSec)	xWaitUntilNSec(nsec, guardNSec)
+inline static void xWaitUntilNSec(U64 nSec, U64 guardNSec)
 {
+	U64 wallNS, timerNS, endNS;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &wallNS);
+	if (wallNS >= nSec)
+		return;
+	CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &timerNS);
+	endNS = timerNS + (nSec - wallNS);
+
+	if (nSec - wallNS > guardNSec)
+		xSleepUntilNSec(endNS - guardNSec);
+
 	do {
-		U64 spinNowNS;
-		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &spinNowNS);
-		if (spinNowNS > nSec)
-			break;
+		CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &timerNS);
 	}
-	while (1);
+	while (timerNS < endNS);
 }
+#endif
 
 #define RAND()  								   random()
 #define SRAND(seed) 							   srandom(seed)
@@ -130,10 +149,14 @@ thread##_type	thread##_ThreadData
 	}
 
 #define THREAD_SET_RT_PRIORITY(threadhandle, priority) 													\
+	THREAD_SET_RT_POLICY(threadhandle, SCHED_RR, priority)
+
+// policy is SCHED_RR or SCHED_FIFO
+#define THREAD_SET_RT_POLICY(threadhandle, policy, priority) 											\
 	{																									\
 		struct sched_param param;																		\
 		param.__sched_priority = priority;																\
-		pthread_setschedparam(threadhandle##_ThreadData.pthread, SCHED_RR, &param);						\
+		pthread_setschedparam(threadhandle##_ThreadData.pthread, policy, &param);						\
 	}
 
 #define THREAD_PIN(threadhandle, affinity) 																		\
@@ -147,6 +170,18 @@ thread##_type	thread##_ThreadData
 		pthread_setaffinity_np(threadhandle##_ThreadData.pthread, sizeof(cpu_set_t), &cpuset);			\
 	}
 
+// Pin the calling thread. Threads it creates afterwards inherit the mask.
+#define THREAD_PIN_SELF(affinity) 																		\
+	{																									\
+		cpu_set_t cpuset;																				\
+		int i1;																							\
+		CPU_ZERO(&cpuset);																				\
+		for (i1 = 0; i1 < 32; i1++) {																	\
+			if (affinity & (1 << i1)) CPU_SET(i1, &cpuset);												\
+		}																								\
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);							\
+	}
+
 #define THREAD_CHECK_ERROR(threadhandle, message, error)										\
 	do {																						\
 		error=FALSE;																			\
@@ -53,6 +53,11 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define THREAD_SELF()							   pthread_self()
 #define GET_PID()								   getpid() 	
 
+// Per thread value with a destructor that runs when the thread exits
+#define THREAD_KEY_HANDLE(key)					   pthread_key_t key
+#define THREAD_KEY_CREATE(key, destructor)		   pthread_key_create(&key, destructor)
+#define THREAD_KEY_SET(key, value)				   pthread_setspecific(key, value)
+
 
 // Funky struct to hold a configurable ethernet address (MAC).
 // The "mac" pointer is null if no config value was supplied,
@@ -52,3 +52,8 @@ extern DLL_EXPORT bool osalAVBFinalize(void)
 	return TRUE;
 }
 
+extern DLL_EXPORT bool osalAVBSetAffinity(unsigned affinity)
+{
+	THREAD_PIN_SELF(affinity);
+	return TRUE;
+}
@@ -40,5 +40,11 @@ bool osalAVBInitialize(const char *ifname);
 
 bool osalAVBFinalize(void);
 
+// Restrict the calling thread to the CPUs in the affinity bit mask. Called
+// before osalAVBInitialize() the logging, endpoint and other service threads
+// inherit it; talker and listener threads are pinned by their own
+// thread_affinity setting, so this keeps the housekeeping off their cores.
+bool osalAVBSetAffinity(unsigned affinity);
+
 #endif // _OPENAVB_OSAL_PUB_H
 
@@ -59,9 +59,15 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 //task TalkerThread
 #define talkerThread_THREAD_STK_SIZE						THREAD_STACK_SIZE
 
+//task talkerPoolThread
+#define talkerPoolThread_THREAD_STK_SIZE					THREAD_STACK_SIZE
+
 //task ListenerThread
 #define listenerThread_THREAD_STK_SIZE 						THREAD_STACK_SIZE
 
+//task listenerPoolThread
+#define listenerPoolThread_THREAD_STK_SIZE					THREAD_STACK_SIZE
+
 //task openavbAecpSMEntityModelEntityThread
 #define openavbAecpSMEntityModelEntityThread_THREAD_STK_SIZE   	THREAD_STACK_SIZE
 
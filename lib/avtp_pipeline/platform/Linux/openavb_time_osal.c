@@ -32,6 +32,11 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <linux/ptp_clock.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
 
 #include "avb_gptp.h"
 
@@ -54,6 +59,72 @@ static int gPtpShmFd = -1;
 static char *gPtpMmap = NULL;
 gPtpTimeData gPtpTD;
 
+// gPTP domains of other interfaces, each served by its own gptp started
+// with -SHM /ptp_<ifname>. Interfaces without one use the default domain.
+#define MAX_PTP_DOMAINS 4
+typedef struct {
+	char ifname[IFNAMSIZ];
+	int shmFd;
+	char *mmap;
+	gPtpTimeData td;
+} ptp_domain_t;
+
+static ptp_domain_t gPtpDomains[MAX_PTP_DOMAINS];
+static int gPtpDomainCount = 0;
+
+// Domain WALLTIME is read from in the calling thread, NULL for the default
+static __thread ptp_domain_t *tPtpDomain;
+#define PTP_MMAP()	(tPtpDomain ? tPtpDomain->mmap : gPtpMmap)
+#define PTP_TD()	(tPtpDomain ? &tPtpDomain->td : &gPtpTD)
+
+// gPTP domain number WALLTIME follows within that segment, one of those
+// gptp follows with -DOMAIN; -1 for the domain gptp disciplines its clock to
+static __thread S32 tPtpDomainNumber = -1;
+
+// Time data of the calling thread's domain. Falls back to gptp's own domain
+// until gptp has a sync result of the selected one.
+static int x_getPTPData(char *pMmap, gPtpTimeData *td, uint32_t *seq) {
+	if (tPtpDomainNumber >= 0
+		&& gptpgetdomaindata(pMmap, tPtpDomainNumber, td, seq) == 0) {
+		return 0;
+	}
+	return seq ? gptpgetdataseq(pMmap, td, seq) : gptpgetdata(pMmap, td);
+}
+
+// PTP hardware clocks of the interfaces stream threads selected, opened
+// once and shared by all threads on the interface
+#define MAX_PHCS 4
+typedef struct {
+	char ifname[IFNAMSIZ];
+	int fd;
+	clockid_t clockId;
+} phc_t;
+
+static phc_t gPhcs[MAX_PHCS];
+static int gPhcCount = 0;
+
+// PHC OPENAVB_CLOCK_PHC is read from in the calling thread, NULL for none
+static __thread phc_t *tPhc;
+
+// Same dynamic clock id encoding as clock_getres(2) for PTP devices
+#define PHC_FD_TO_CLOCKID(fd)	((~(clockid_t)(fd) << 3) | 3)
+
+// Per thread linear model of PTP time against CLOCK_REALTIME (the clock
+// gptp measures ls_phoffset against). It only changes when gptp publishes
+// new data, so between updates a WALLTIME read is one clock_gettime and a
+// multiply instead of a shared memory copy and long double math.
+typedef struct {
+	bool valid;
+	uint32_t seq;
+	U64 baseSysNsec;
+	U64 basePtpNsec;
+	double rateAdj;		// (ptp rate / system rate) - 1
+	U64 baseLocalNsec;	// local (PHC) time of the last update
+	double localRateAdj;	// (ptp rate / local rate) - 1
+} ptp_clock_cache_t;
+
+static __thread ptp_clock_cache_t tPtpCache;
+
 static bool x_timeInit(void) {
 	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
 
@@ -77,24 +148,170 @@ static bool x_timeInit(void) {
 	return TRUE;
 }
 
+// Brings tPtpCache up to date with the last gptp update
+static bool x_updatePTPCache(void) {
+	uint32_t seq, count;
+	char *pMmap = PTP_MMAP();
+
+	// The update counter only moves with new sync results, the seqlock
+	// sequence also with every interface data refresh. Read the counter
+	// before the data so a racing update refreshes the cache again.
+	bool bCount = gptpgetupdate(pMmap, &count, NULL) == 0;
+	if (!tPtpCache.valid
+		|| (bCount ? count != tPtpCache.seq
+			: gptpgetseq(pMmap, &seq) < 0 || seq != tPtpCache.seq)) {
+		gPtpTimeData td;
+		if (x_getPTPData(pMmap, &td, &seq) < 0) {
+			// older gptp without an update counter
+			tPtpCache.valid = FALSE;
+			return FALSE;
+		}
+		*PTP_TD() = td;
+
+		tPtpCache.seq = bCount ? count : seq;
+		tPtpCache.baseSysNsec = td.local_time + td.ls_phoffset;
+		tPtpCache.basePtpNsec = td.local_time - td.ml_phoffset;
+		tPtpCache.rateAdj = (double)(td.ml_freqoffset * td.ls_freqoffset - 1.0L);
+		tPtpCache.baseLocalNsec = td.local_time;
+		tPtpCache.localRateAdj = (double)(td.ml_freqoffset - 1.0L);
+		tPtpCache.valid = TRUE;
+	}
+	return TRUE;
+}
+
+static bool x_getPTPTimeCached(U64 *timeNsec) {
+	struct timespec sysTime;
+
+	if (!x_updatePTPCache()) {
+		return FALSE;
+	}
+
+	if (clock_gettime(CLOCK_REALTIME, &sysTime) != 0) {
+		return FALSE;
+	}
+
+	int64_t deltaSys = ((U64)sysTime.tv_sec * NANOSECONDS_PER_SECOND + sysTime.tv_nsec) - tPtpCache.baseSysNsec;
+	*timeNsec = tPtpCache.basePtpNsec + deltaSys + (int64_t)(deltaSys * tPtpCache.rateAdj);
+	return TRUE;
+}
+
+// gptp refreshes a filtered CLOCK_REALTIME to PTP model many times per sync
+// interval; when present it is both cheaper and closer than extrapolating
+// from the last sync.
+static bool x_getPTPTimeModel(U64 *timeNsec) {
+	gPtpSysModel model;
+	struct timespec sysTime;
+
+	// The model only covers the domain gptp disciplines its clock to
+	if (tPtpDomainNumber >= 0 || gptpgetsysmodel(PTP_MMAP(), &model) < 0) {
+		return FALSE;
+	}
+
+	if (clock_gettime(CLOCK_REALTIME, &sysTime) != 0) {
+		return FALSE;
+	}
+
+	int64_t deltaSys = ((U64)sysTime.tv_sec * NANOSECONDS_PER_SECOND + sysTime.tv_nsec) - model.sys_base;
+	*timeNsec = model.ptp_base + deltaSys + (int64_t)(deltaSys * (double)(model.rate - 1.0L));
+	return TRUE;
+}
+
+// gptp's local time is the PHC, so reading it directly leaves out the
+// system clock and its offset and rate estimates altogether.
+static bool x_getPTPTimePHC(U64 *timeNsec) {
+	struct timespec phcTime;
+
+	if (!tPhc || !x_updatePTPCache()) {
+		return FALSE;
+	}
+
+	if (clock_gettime(tPhc->clockId, &phcTime) != 0) {
+		return FALSE;
+	}
+
+	int64_t deltaLocal = ((U64)phcTime.tv_sec * NANOSECONDS_PER_SECOND + phcTime.tv_nsec) - tPtpCache.baseLocalNsec;
+	*timeNsec = tPtpCache.basePtpNsec + deltaLocal + (int64_t)(deltaLocal * tPtpCache.localRateAdj);
+	return TRUE;
+}
+
+// Opens the PHC of ifname, or finds it already open. Called with LOCK held.
+static phc_t *x_openPHC(const char *ifname) {
+	struct ethtool_ts_info info;
+	struct ifreq ifr;
+	char device[32];
+	phc_t *pPhc;
+	int sock, fd, err, i;
+
+	for (i = 0; i < gPhcCount; i++) {
+		if (strncmp(gPhcs[i].ifname, ifname, IFNAMSIZ) == 0) {
+			return gPhcs[i].fd >= 0 ? &gPhcs[i] : NULL;
+		}
+	}
+	if (gPhcCount >= MAX_PHCS) {
+		return NULL;
+	}
+
+	// Remembered even without a PHC so the lookup is not repeated
+	pPhc = &gPhcs[gPhcCount++];
+	strncpy(pPhc->ifname, ifname, IFNAMSIZ - 1);
+	pPhc->fd = -1;
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		return NULL;
+	}
+	memset(&info, 0, sizeof(info));
+	memset(&ifr, 0, sizeof(ifr));
+	info.cmd = ETHTOOL_GET_TS_INFO;
+	strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+	ifr.ifr_data = (char *)&info;
+	err = ioctl(sock, SIOCETHTOOL, &ifr);
+	close(sock);
+	if (err < 0 || info.phc_index < 0) {
+		AVB_LOGF_DEBUG("%s has no PTP hardware clock", ifname);
+		return NULL;
+	}
+
+	snprintf(device, sizeof(device), "/dev/ptp%d", info.phc_index);
+	fd = open(device, O_RDONLY);
+	if (fd < 0) {
+		AVB_LOGF_WARNING("Failed to open %s: %s", device, strerror(errno));
+		return NULL;
+	}
+
+	pPhc->fd = fd;
+	pPhc->clockId = PHC_FD_TO_CLOCKID(fd);
+	AVB_LOGF_INFO("%s uses PTP hardware clock %s", ifname, device);
+	return pPhc;
+}
+
 static bool x_getPTPTime(U64 *timeNsec) {
 	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
 
-	if (gptpgetdata(gPtpMmap, &gPtpTD) < 0) {
+	if (x_getPTPTimeModel(timeNsec) || x_getPTPTimeCached(timeNsec)) {
+		AVB_TRACE_EXIT(AVB_TRACE_TIME);
+		return TRUE;
+	}
+
+	// Many threads get here at once; the seqlock read gives each a consistent
+	// private copy, so compute from that rather than from the shared gPtpTD.
+	gPtpTimeData td;
+	if (x_getPTPData(PTP_MMAP(), &td, NULL) < 0) {
 		AVB_LOG_ERROR("GPTP data fetch failed");
 		AVB_TRACE_EXIT(AVB_TRACE_TIME);
 		return FALSE;
 	}
+	*PTP_TD() = td;
 
 	uint64_t now_local;
 	uint64_t update_8021as;
 	int64_t delta_8021as;
 	int64_t delta_local;
 
-	if (gptplocaltime(&gPtpTD, &now_local)) {
-		update_8021as = gPtpTD.local_time - gPtpTD.ml_phoffset;
-		delta_local = now_local - gPtpTD.local_time;
-		delta_8021as = gPtpTD.ml_freqoffset * delta_local;
+	if (gptplocaltime(&td, &now_local)) {
+		update_8021as = td.local_time - td.ml_phoffset;
+		delta_local = now_local - td.local_time;
+		delta_8021as = td.ml_freqoffset * delta_local;
 		*timeNsec = update_8021as + delta_8021as;
 
 		AVB_TRACE_EXIT(AVB_TRACE_TIME);
@@ -119,11 +336,141 @@ bool osalAVBTimeInit(void) {
 	return TRUE;
 }
 
+bool osalAVBTimeSelectIf(const char *ifname) {
+	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
+
+	ptp_domain_t *pDomain = NULL;
+	int i;
+
+	if (ifname) {
+		// strip a rawsock prefix such as "igb:"
+		const char *colon = strchr(ifname, ':');
+		if (colon)
+			ifname = colon + 1;
+	}
+	tPtpDomainNumber = -1;
+	if (!ifname || !ifname[0]) {
+		tPtpDomain = NULL;
+		tPhc = NULL;
+		tPtpCache.valid = FALSE;
+		AVB_TRACE_EXIT(AVB_TRACE_TIME);
+		return TRUE;
+	}
+
+	LOCK();
+	for (i = 0; i < gPtpDomainCount; i++) {
+		if (strncmp(gPtpDomains[i].ifname, ifname, IFNAMSIZ) == 0) {
+			pDomain = &gPtpDomains[i];
+			break;
+		}
+	}
+
+	if (!pDomain && gPtpDomainCount < MAX_PTP_DOMAINS) {
+		char shmName[IFNAMSIZ + 8];
+		int shmFd = -1;
+		char *pMmap = NULL;
+
+		snprintf(shmName, sizeof(shmName), "/ptp_%s", ifname);
+		// probe first, gptpinitname() complains when there is no such gptp
+		int probeFd = shm_open(shmName, O_RDONLY, 0);
+		if (probeFd >= 0) {
+			close(probeFd);
+			if (gptpinitname(shmName, &shmFd, &pMmap) == 0) {
+				pDomain = &gPtpDomains[gPtpDomainCount++];
+				strncpy(pDomain->ifname, ifname, IFNAMSIZ - 1);
+				pDomain->shmFd = shmFd;
+				pDomain->mmap = pMmap;
+				gptpgetdata(pMmap, &pDomain->td);
+				AVB_LOGF_INFO("%s uses gPTP shared memory %s", ifname, shmName);
+			}
+		}
+	}
+	tPhc = x_openPHC(ifname);
+	UNLOCK();
+
+	if (!pDomain) {
+		AVB_LOGF_DEBUG("%s uses the default gPTP domain", ifname);
+	}
+	if (pDomain != tPtpDomain) {
+		tPtpDomain = pDomain;
+		tPtpCache.valid = FALSE;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TIME);
+	return TRUE;
+}
+
+bool osalAVBTimeSelectDomain(S32 domain) {
+	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
+
+	if (domain < -1 || domain > 127) {
+		AVB_LOGF_ERROR("Invalid gPTP domain %d", domain);
+		AVB_TRACE_EXIT(AVB_TRACE_TIME);
+		return FALSE;
+	}
+	if (domain != tPtpDomainNumber) {
+		tPtpDomainNumber = domain;
+		tPtpCache.valid = FALSE;
+		if (domain >= 0) {
+			gPtpTimeData td;
+			if (gptpgetdomaindata(PTP_MMAP(), domain, &td, NULL) < 0) {
+				AVB_LOGF_WARNING("gptp publishes no gPTP domain %d yet, using its own domain meanwhile", domain);
+			}
+			else {
+				AVB_LOGF_INFO("Following gPTP domain %d", domain);
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TIME);
+	return TRUE;
+}
+
+// Last time data of the calling thread's domain, for the IGB rawsock
+const gPtpTimeData *osalAVBTimeData(void) {
+	return PTP_TD();
+}
+
+bool osalAVBTimeLocalToPTP(U64 localNsec, U64 *ptpNsec) {
+	if (!PTP_MMAP() || !x_updatePTPCache()) {
+		return FALSE;
+	}
+
+	int64_t deltaLocal = localNsec - tPtpCache.baseLocalNsec;
+	*ptpNsec = tPtpCache.basePtpNsec + deltaLocal + (int64_t)(deltaLocal * tPtpCache.localRateAdj);
+	return TRUE;
+}
+
+bool osalAVBTimeGetUpdate(U32 *updateCount, U32 *gmCount) {
+	char *pMmap = PTP_MMAP();
+	return pMmap && gptpgetupdate(pMmap, updateCount, gmCount) == 0;
+}
+
+bool osalAVBTimeWaitUpdate(U32 lastCount, U32 timeoutUsec, U32 *updateCount) {
+	char *pMmap = PTP_MMAP();
+	return pMmap && gptpwaitupdate(pMmap, lastCount, timeoutUsec, updateCount) == 0;
+}
+
 bool osalAVBTimeClose(void) {
 	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
 
 	gptpdeinit(&gPtpShmFd, &gPtpMmap);
 
+	LOCK();
+	while (gPtpDomainCount > 0) {
+		ptp_domain_t *pDomain = &gPtpDomains[--gPtpDomainCount];
+		gptpdeinit(&pDomain->shmFd, &pDomain->mmap);
+		memset(pDomain, 0, sizeof(*pDomain));
+	}
+	while (gPhcCount > 0) {
+		phc_t *pPhc = &gPhcs[--gPhcCount];
+		if (pPhc->fd >= 0) {
+			close(pPhc->fd);
+		}
+		memset(pPhc, 0, sizeof(*pPhc));
+	}
+	UNLOCK();
+
 	AVB_TRACE_EXIT(AVB_TRACE_TIME);
 	return TRUE;
 }
@@ -143,7 +490,11 @@ bool osalClockGettime(openavb_clockId_t openavbClockId, struct timespec *getTime
 		case OPENAVB_TIMER_CLOCK:
 			clockId = CLOCK_MONOTONIC;
 			break;
+		case OPENAVB_CLOCK_THREAD_CPUTIME:
+			clockId = CLOCK_THREAD_CPUTIME_ID;
+			break;
 		case OPENAVB_CLOCK_WALLTIME:
+		case OPENAVB_CLOCK_PHC:
 			break;
 		}
 		if (!clock_gettime(clockId, getTime)) return TRUE;
@@ -159,6 +510,17 @@ bool osalClockGettime(openavb_clockId_t openavbClockId, struct timespec *getTime
 		AVB_TRACE_EXIT(AVB_TRACE_TIME);
 		return TRUE;
 	}
+	else if (openavbClockId == OPENAVB_CLOCK_PHC) {
+		U64 timeNsec;
+		if (!x_getPTPTimePHC(&timeNsec) && !x_getPTPTime(&timeNsec)) {
+			AVB_TRACE_EXIT(AVB_TRACE_TIME);
+			return FALSE;
+		}
+		getTime->tv_sec = timeNsec / NANOSECONDS_PER_SECOND;
+		getTime->tv_nsec = timeNsec % NANOSECONDS_PER_SECOND;
+		AVB_TRACE_EXIT(AVB_TRACE_TIME);
+		return TRUE;
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_TIME);
 	return FALSE;
 }
@@ -176,7 +538,11 @@ bool osalClockGettime64(openavb_clockId_t openavbClockId, U64 *timeNsec) {
 		case OPENAVB_TIMER_CLOCK:
 			clockId = CLOCK_MONOTONIC;
 			break;
+		case OPENAVB_CLOCK_THREAD_CPUTIME:
+			clockId = CLOCK_THREAD_CPUTIME_ID;
+			break;
 		case OPENAVB_CLOCK_WALLTIME:
+		case OPENAVB_CLOCK_PHC:
 			break;
 		}
 		struct timespec getTime;
@@ -190,6 +556,10 @@ bool osalClockGettime64(openavb_clockId_t openavbClockId, U64 *timeNsec) {
 		AVB_TRACE_EXIT(AVB_TRACE_TIME);
 		return x_getPTPTime(timeNsec);
 	}
+	else if (openavbClockId == OPENAVB_CLOCK_PHC) {
+		AVB_TRACE_EXIT(AVB_TRACE_TIME);
+		return x_getPTPTimePHC(timeNsec) || x_getPTPTime(timeNsec);
+	}
 	AVB_TRACE_EXIT(AVB_TRACE_TIME);
 	return FALSE;
 }
@@ -47,7 +47,14 @@ typedef enum {
 	OPENAVB_CLOCK_REALTIME,
 	OPENAVB_CLOCK_MONOTONIC,
 	OPENAVB_TIMER_CLOCK,
-	OPENAVB_CLOCK_WALLTIME
+	OPENAVB_CLOCK_THREAD_CPUTIME,
+	OPENAVB_CLOCK_WALLTIME,
+	// gPTP time like WALLTIME, but extrapolated from a direct read of the
+	// PTP hardware clock (/dev/ptpN) of the interface the calling thread
+	// selected with osalAVBTimeSelectIf(), the clock gptp measures against,
+	// rather than from the system clock. Falls back to WALLTIME when the
+	// thread has no interface or the interface has no PHC.
+	OPENAVB_CLOCK_PHC
 } openavb_clockId_t;
 
 #define CLOCK_GETTIME(arg1, arg2) osalClockGettime(arg1, arg2)
@@ -65,5 +72,42 @@ bool osalClockGettime(openavb_clockId_t openavbClockId, struct timespec *getTime
 // Gets current time as U64 nSec. Returns 0 on success otherwise -1
 bool osalClockGettime64(openavb_clockId_t openavbClockId, U64 *timeNsec);
 
+// Makes WALLTIME in the calling thread follow the gPTP domain of ifname
+// (a rawsock prefix such as "igb:" is ignored): the gptp started with
+// -SHM /ptp_<ifname> when there is one, else the default /ptp. A stream
+// thread calls this with its interface; NULL selects the default again.
+// It also selects the PTP hardware clock of ifname for OPENAVB_CLOCK_PHC.
+bool osalAVBTimeSelectIf(const char *ifname);
+
+// Makes WALLTIME in the calling thread follow gPTP domain number domain
+// of the gptp osalAVBTimeSelectIf() selected, one it follows with -DOMAIN,
+// or with -1 the domain gptp disciplines its clock to. Until gptp has a
+// sync result of the domain its own domain is used. Call it after
+// osalAVBTimeSelectIf(), which selects -1 again.
+bool osalAVBTimeSelectDomain(S32 domain);
+
+// Converts a time of gptp's local clock, the PHC of its interface (as in
+// hardware timestamps), to gPTP time in the calling thread's domain.
+// Returns FALSE if gptp has published no sync result yet.
+bool osalAVBTimeLocalToPTP(U64 localNsec, U64 *ptpNsec);
+
+// Reads the gPTP update counters. updateCount goes up with every new sync
+// result and grandmaster change, gmCount (may be NULL) with every grandmaster
+// change. Returns FALSE if gptp does not publish them.
+bool osalAVBTimeGetUpdate(U32 *updateCount, U32 *gmCount);
+
+// Blocks until updateCount moves past lastCount or timeoutUsec passes
+// (0 waits forever). On timeout *updateCount is lastCount. Returns FALSE if
+// gptp does not publish update counters.
+bool osalAVBTimeWaitUpdate(U32 lastCount, U32 timeoutUsec, U32 *updateCount);
+
+#if AVB_FEATURE_SIM
+// In the simulation build every clock but OPENAVB_CLOCK_THREAD_CPUTIME reads
+// one virtual clock, which only moves when the simulation moves it.
+
+// Move the virtual clock forward to timeNsec. It never goes back.
+void osalSimSetTime(U64 timeNsec);
+#endif
+
 
 #endif // _OPENAVB_TIME_OSAL_PUB_H
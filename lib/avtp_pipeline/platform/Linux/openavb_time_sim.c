@@ -0,0 +1,136 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Virtual clock for the simulation build.
+*
+* Replaces openavb_time_osal.c when AVB_FEATURE_SIM is set. All clocks
+* except the thread CPU time clock read the same virtual time, which only
+* moves when the simulation (or a SLEEP_UNTIL_NSEC) moves it, so talkers
+* and listeners can be stepped faster than real time. gPTP isn't needed.
+*/
+
+#include <inttypes.h>
+
+#include "avb_gptp.h"
+
+#include "openavb_platform.h"
+#include "openavb_time_osal.h"
+#include "openavb_trace.h"
+
+#define	AVB_LOG_COMPONENT	"osalTime"
+#include "openavb_pub.h"
+#include "openavb_log.h"
+
+// Where the virtual clock starts; far enough from zero that times taken
+// before it (ie: now - max_transit) don't wrap
+#define SIM_TIME_START_NS	(1000ULL * NANOSECONDS_PER_SECOND)
+
+// Used by the IGB rawsock to convert launch times; never filled in here
+gPtpTimeData gPtpTD;
+
+// Only the simulation thread moves it; other threads may read it
+static U64 gSimTimeNS = SIM_TIME_START_NS;
+
+bool osalAVBTimeInit(void) {
+	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
+
+	AVB_LOGF_INFO("Simulation build; virtual clock at %" PRIu64, OPENAVB_ATOMIC_LOAD_ACQUIRE(&gSimTimeNS));
+
+	AVB_TRACE_EXIT(AVB_TRACE_TIME);
+	return TRUE;
+}
+
+bool osalAVBTimeClose(void) {
+	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
+	AVB_TRACE_EXIT(AVB_TRACE_TIME);
+	return TRUE;
+}
+
+// One virtual clock for every interface
+bool osalAVBTimeSelectIf(const char *ifname) {
+	return TRUE;
+}
+
+bool osalAVBTimeSelectDomain(S32 domain) {
+	return TRUE;
+}
+
+const gPtpTimeData *osalAVBTimeData(void) {
+	return &gPtpTD;
+}
+
+// No PHC behind the virtual clock either
+bool osalAVBTimeLocalToPTP(U64 localNsec, U64 *ptpNsec) {
+	return FALSE;
+}
+
+// No gptp behind the virtual clock, so nothing ever publishes an update
+bool osalAVBTimeGetUpdate(U32 *updateCount, U32 *gmCount) {
+	return FALSE;
+}
+
+bool osalAVBTimeWaitUpdate(U32 lastCount, U32 timeoutUsec, U32 *updateCount) {
+	return FALSE;
+}
+
+void osalSimSetTime(U64 timeNsec) {
+	if (timeNsec > OPENAVB_ATOMIC_LOAD_RELAXED(&gSimTimeNS)) {
+		OPENAVB_ATOMIC_STORE_RELEASE(&gSimTimeNS, timeNsec);
+	}
+}
+
+bool osalClockGettime64(openavb_clockId_t openavbClockId, U64 *timeNsec) {
+	if (openavbClockId == OPENAVB_CLOCK_THREAD_CPUTIME) {
+		struct timespec getTime;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &getTime) != 0)
+			return FALSE;
+		*timeNsec = ((U64)getTime.tv_sec * (U64)NANOSECONDS_PER_SECOND) + (U64)getTime.tv_nsec;
+		return TRUE;
+	}
+
+	*timeNsec = OPENAVB_ATOMIC_LOAD_ACQUIRE(&gSimTimeNS);
+	return TRUE;
+}
+
+bool osalClockGettime(openavb_clockId_t openavbClockId, struct timespec *getTime) {
+	AVB_TRACE_ENTRY(AVB_TRACE_TIME);
+
+	U64 timeNsec;
+	if (!osalClockGettime64(openavbClockId, &timeNsec)) {
+		AVB_TRACE_EXIT(AVB_TRACE_TIME);
+		return FALSE;
+	}
+	getTime->tv_sec = timeNsec / NANOSECONDS_PER_SECOND;
+	getTime->tv_nsec = timeNsec % NANOSECONDS_PER_SECOND;
+
+	AVB_TRACE_EXIT(AVB_TRACE_TIME);
+	return TRUE;
+}
@@ -0,0 +1,229 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+#include "cbs_rawsock.h"
+#include "avb_sched.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "openavb_trace.h"
+
+#define	AVB_LOG_COMPONENT	"Raw Socket"
+#include "openavb_log.h"
+
+static U64 x_nowNsec(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (U64)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+static void x_lock(cbs_rawsock_shm_t *pShm)
+{
+	if (pthread_mutex_lock(&pShm->lock) == EOWNERDEAD) {
+		// A talker died holding the lock; the credit it was updating
+		// is still usable
+		pthread_mutex_consistent(&pShm->lock);
+	}
+}
+
+static cbs_rawsock_t* x_map(const char *ifname, bool bCreate)
+{
+	cbs_rawsock_t *pShaper = calloc(1, sizeof(cbs_rawsock_t));
+	if (!pShaper)
+		return NULL;
+
+	snprintf(pShaper->shmName, sizeof(pShaper->shmName), CBS_RAWSOCK_SHM_NAME, ifname);
+
+	int fd = shm_open(pShaper->shmName, bCreate ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0660);
+	if (fd < 0) {
+		if (bCreate || errno != ENOENT)
+			AVB_LOGF_ERROR("Software shaper; shm_open %s failed: %s", pShaper->shmName, strerror(errno));
+		free(pShaper);
+		return NULL;
+	}
+	if (bCreate && ftruncate(fd, sizeof(cbs_rawsock_shm_t)) < 0) {
+		AVB_LOGF_ERROR("Software shaper; ftruncate failed: %s", strerror(errno));
+		close(fd);
+		shm_unlink(pShaper->shmName);
+		free(pShaper);
+		return NULL;
+	}
+
+	pShaper->pShm = mmap(NULL, sizeof(cbs_rawsock_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pShaper->pShm == MAP_FAILED) {
+		AVB_LOGF_ERROR("Software shaper; mmap failed: %s", strerror(errno));
+		if (bCreate)
+			shm_unlink(pShaper->shmName);
+		free(pShaper);
+		return NULL;
+	}
+	pShaper->bOwner = bCreate;
+	return pShaper;
+}
+
+cbs_rawsock_t* cbsRawsockCreate(const char *ifname, U32 linkKbit)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	cbs_rawsock_t *pShaper = x_map(ifname, TRUE);
+	if (!pShaper) {
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	cbs_rawsock_shm_t *pShm = pShaper->pShm;
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	pthread_mutex_init(&pShm->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	pShm->linkBytesPerSec = (linkKbit ? linkKbit : 1000000) * 1000 / 8;
+	__atomic_store_n(&pShm->magic, CBS_RAWSOCK_MAGIC, __ATOMIC_RELEASE);
+
+	AVB_LOGF_INFO("Software shaper for %s created (%s)", ifname, pShaper->shmName);
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return pShaper;
+}
+
+void cbsRawsockSetStream(cbs_rawsock_t *pShaper, U16 fwmark, U32 streamBytesPerSec)
+{
+	int nClass = TC_AVB_MARK_CLASS(fwmark);
+	int nStream = TC_AVB_MARK_STREAM(fwmark);
+
+	if (!pShaper || nClass < 0 || nClass >= MAX_AVB_SR_CLASSES || nStream >= MAX_AVB_STREAMS_PER_CLASS)
+		return;
+
+	cbs_rawsock_class_t *pClass = &pShaper->pShm->classes[nClass];
+	x_lock(pShaper->pShm);
+	pClass->idleSlope += streamBytesPerSec - pClass->streamBytesPerSec[nStream];
+	pClass->streamBytesPerSec[nStream] = streamBytesPerSec;
+	pthread_mutex_unlock(&pShaper->pShm->lock);
+
+	AVB_LOGF_DEBUG("Software shaper class %c: idle slope %u bytes/sec", AVB_CLASS_LABEL(nClass), pClass->idleSlope);
+}
+
+cbs_rawsock_t* cbsRawsockAttach(const char *ifname)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	cbs_rawsock_t *pShaper = x_map(ifname, FALSE);
+	if (pShaper && __atomic_load_n(&pShaper->pShm->magic, __ATOMIC_ACQUIRE) != CBS_RAWSOCK_MAGIC) {
+		AVB_LOGF_WARNING("Software shaper %s not ready; frames are not shaped", pShaper->shmName);
+		cbsRawsockClose(pShaper);
+		pShaper = NULL;
+	}
+	if (pShaper) {
+		AVB_LOGF_INFO("Shaping TX in software (%s)", pShaper->shmName);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return pShaper;
+}
+
+void cbsRawsockClose(cbs_rawsock_t *pShaper)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	if (pShaper) {
+		munmap(pShaper->pShm, sizeof(cbs_rawsock_shm_t));
+		// Talkers still attached keep their mapping; new ones won't shape
+		if (pShaper->bOwner)
+			shm_unlink(pShaper->shmName);
+		free(pShaper);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+}
+
+// Credit grows at the idle slope while a frame waits for it. It doesn't
+// build up beyond zero while no frame waits, as when the class queue of a
+// hardware shaper is empty, so a class can't save up for a burst. Sending takes the frame's
+// wire size out; the time it spends on the wire is covered by the idle
+// slope, which makes the send slope idleSlope - linkRate.
+void cbsRawsockTxWait(cbs_rawsock_t *pShaper, U16 fwmark, U32 len)
+{
+	int nClass = TC_AVB_MARK_CLASS(fwmark);
+	if (!pShaper || nClass < 0 || nClass >= MAX_AVB_SR_CLASSES)
+		return;
+
+	cbs_rawsock_shm_t *pShm = pShaper->pShm;
+	cbs_rawsock_class_t *pClass = &pShm->classes[nClass];
+	S64 cost = (S64)(len + OPENAVB_AVTP_L1_OVERHEAD) * NANOSECONDS_PER_SECOND;
+	bool bWaited = FALSE;
+
+	while (1) {
+		x_lock(pShm);
+
+		U64 nowNsec = x_nowNsec();
+		S64 idleSlope = pClass->idleSlope;
+		if (idleSlope == 0) {
+			pthread_mutex_unlock(&pShm->lock);
+			return;
+		}
+
+		// A frame that waited keeps what its sleep overshot, up to its
+		// own size, so oversleeping doesn't eat into the reservation
+		S64 hiCredit = bWaited ? cost : 0;
+		S64 room = hiCredit - pClass->credit;
+		U64 elapsed = nowNsec - pClass->lastNsec;
+		if (room <= 0 || elapsed >= (U64)room / idleSlope)
+			pClass->credit = hiCredit;
+		else
+			pClass->credit += idleSlope * (S64)elapsed;
+		pClass->lastNsec = nowNsec;
+
+		if (pClass->credit >= 0) {
+			pClass->credit -= cost;
+			if (bWaited)
+				pClass->nWaits++;
+			pthread_mutex_unlock(&pShm->lock);
+			return;
+		}
+
+		U64 waitNsec = (-pClass->credit + idleSlope - 1) / idleSlope;
+		pthread_mutex_unlock(&pShm->lock);
+
+		struct timespec wait;
+		wait.tv_sec = waitNsec / NANOSECONDS_PER_SECOND;
+		wait.tv_nsec = waitNsec % NANOSECONDS_PER_SECOND;
+		clock_nanosleep(CLOCK_MONOTONIC, 0, &wait, NULL);
+		bWaited = TRUE;
+	}
+}
@@ -0,0 +1,97 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Credit-based shaper in software, for NICs without Qav
+* hardware. The queue manager publishes the SR class reservations of an
+* interface in shared memory; talkers sending through the simple and ring
+* rawsocks on that interface, in any process, take their frames out of the
+* credit of their class, found from the fwmark, before handing them to the
+* kernel.
+*/
+
+#ifndef CBS_RAWSOCK_H
+#define CBS_RAWSOCK_H
+
+#include "openavb_types.h"
+#include <pthread.h>
+
+// Shared memory segment per interface
+#define CBS_RAWSOCK_SHM_NAME	"/openavb_cbs_%s"
+#define CBS_RAWSOCK_MAGIC		0x43425331	// "CBS1"
+
+// Credit of one SR class, shared by all the talkers of the class
+typedef struct {
+	// reserved bandwidth of each stream, indexed by the fwmark stream
+	U32 streamBytesPerSec[MAX_AVB_STREAMS_PER_CLASS];
+	// sum of the above
+	U32 idleSlope;
+	// credit in bytes, scaled by NANOSECONDS_PER_SECOND
+	S64 credit;
+	// CLOCK_MONOTONIC time credit was last brought up to date
+	U64 lastNsec;
+	// frames that had to wait for credit
+	U64 nWaits;
+} cbs_rawsock_class_t;
+
+typedef struct {
+	U32 magic;
+	U32 linkBytesPerSec;
+	// process shared, robust
+	pthread_mutex_t lock;
+	cbs_rawsock_class_t classes[MAX_AVB_SR_CLASSES];
+} cbs_rawsock_shm_t;
+
+typedef struct {
+	cbs_rawsock_shm_t *pShm;
+	char shmName[IFNAMSIZ + 16];
+	bool bOwner;
+} cbs_rawsock_t;
+
+// Queue manager side: create the shaper for ifname, shaping no class yet
+cbs_rawsock_t* cbsRawsockCreate(const char *ifname, U32 linkKbit);
+
+// Queue manager side: set the reservation of the stream with fwmark
+// (0 when the stream is removed)
+void cbsRawsockSetStream(cbs_rawsock_t *pShaper, U16 fwmark, U32 streamBytesPerSec);
+
+// Talker side: attach to the shaper for ifname; NULL if the queue
+// manager doesn't shape that interface in software
+cbs_rawsock_t* cbsRawsockAttach(const char *ifname);
+
+// Detach, and remove the shaper when called by its creator
+void cbsRawsockClose(cbs_rawsock_t *pShaper);
+
+// Wait until the class of fwmark has credit for a frame of len bytes,
+// and take the frame out of it. Frames of classes without a reservation
+// pass straight through.
+void cbsRawsockTxWait(cbs_rawsock_t *pShaper, U16 fwmark, U32 len);
+
+#endif // CBS_RAWSOCK_H
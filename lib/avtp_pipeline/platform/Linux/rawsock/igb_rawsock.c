@@ -36,15 +36,77 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "avb_sched.h"
 
 #include "openavb_trace.h"
+#include "openavb_time_osal_pub.h"
 
 #define	AVB_LOG_COMPONENT	"Raw Socket"
 #include "openavb_log.h"
 
 #if IGB_LAUNCHTIME_ENABLED
-// needed for gptplocaltime()
-extern gPtpTimeData gPtpTD;
+// needed for gptplocaltime(), from the gPTP domain the stream thread selected
+extern const gPtpTimeData *osalAVBTimeData(void);
 #endif
 
+// how long to sleep between polls of an empty RX ring
+#define IGB_RX_POLL_USEC 10
+
+// Move the RX queue onto user-space buffers. On failure the rawsock
+// keeps receiving through pcap.
+static bool x_igbRxOpen(igb_rawsock_t *rawsock)
+{
+	rawsock->rx_queue = igbAcquireRxQueue(rawsock->igb_dev);
+	if (rawsock->rx_queue < 0) {
+		AVB_LOG_INFO("No free igb RX queue; receiving through pcap");
+		return FALSE;
+	}
+
+	// Drivers without IGB_ALLOC_FLEX leave filter n to queue n
+	rawsock->rx_filter = IGB_FLEX_ANY;
+	rawsock->rx_filterAllocated = igb_alloc_flex_filter(rawsock->igb_dev, &rawsock->rx_filter) == 0;
+	if (!rawsock->rx_filterAllocated) {
+		rawsock->rx_filter = rawsock->rx_queue;
+	}
+
+	rawsock->rx_packets = igbAllocRxPackets(rawsock->igb_dev, rawsock->rx_pages, IGB_RX_PAGES, &rawsock->rx_nPackets);
+	if (!rawsock->rx_packets) {
+		if (rawsock->rx_filterAllocated) {
+			igb_free_flex_filter(rawsock->igb_dev, rawsock->rx_filter);
+			rawsock->rx_filterAllocated = FALSE;
+		}
+		igbReleaseRxQueue(rawsock->igb_dev, rawsock->rx_queue);
+		rawsock->rx_queue = -1;
+		return FALSE;
+	}
+
+	int i;
+	for (i = 0; i < rawsock->rx_nPackets; i++) {
+		struct igb_packet *packet = &rawsock->rx_packets[i];
+		int err = igb_refresh_buffers(rawsock->igb_dev, rawsock->rx_queue, &packet, 1);
+		if (err) {
+			AVB_LOGF_ERROR("igb_refresh_buffers failed: %s", strerror(err < 0 ? -err : err));
+		}
+	}
+
+	AVB_LOGF_INFO("igb RX queue %d: %d buffers, flex filter %u", rawsock->rx_queue, rawsock->rx_nPackets, rawsock->rx_filter);
+	return TRUE;
+}
+
+static void x_igbRxClose(igb_rawsock_t *rawsock)
+{
+	if (rawsock->rx_queue < 0)
+		return;
+
+	// stop steering frames into the ring before its memory goes away
+	igb_clear_flex_filter(rawsock->igb_dev, rawsock->rx_filter);
+	if (rawsock->rx_filterAllocated) {
+		igb_free_flex_filter(rawsock->igb_dev, rawsock->rx_filter);
+		rawsock->rx_filterAllocated = FALSE;
+	}
+	igbFreeRxPackets(rawsock->igb_dev, rawsock->rx_packets, rawsock->rx_pages, IGB_RX_PAGES);
+	igbReleaseRxQueue(rawsock->igb_dev, rawsock->rx_queue);
+	rawsock->rx_packets = NULL;
+	rawsock->rx_queue = -1;
+}
+
 void *igbRawsockOpen(igb_rawsock_t* rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
@@ -56,6 +118,10 @@ void *igbRawsockOpen(igb_rawsock_t* rawsock, const char *ifname, bool rx_mode, b
 		return NULL;
 	}
 
+	rawsock->rx_queue = -1;
+	rawsock->rx_filter = IGB_FLEX_ANY;
+	rawsock->rx_filterAllocated = FALSE;
+
 	if (tx_mode) {
 		// Deal with frame size.
 		if (frame_size == 0) {
@@ -72,23 +138,41 @@ void *igbRawsockOpen(igb_rawsock_t* rawsock, const char *ifname, bool rx_mode, b
 		}
 
 		// IGB setup
-		rawsock->igb_dev = igbAcquireDevice();
+		rawsock->igb_dev = igbAcquireDeviceIf(ifname);
 
 		// select class B queue by default
 		rawsock->queue = 1;
 	}
 
+	if (rx_mode) {
+		if (!rawsock->igb_dev)
+			rawsock->igb_dev = igbAcquireDeviceIf(ifname);
+
+		if (rawsock->igb_dev)
+			x_igbRxOpen(rawsock);
+	}
+
 	// fill virtual functions table
 	rawsock_cb_t *cb = &rawsock->base.cb;
 	cb->close = igbRawsockClose;
 	cb->getTxFrame = igbRawsockGetTxFrame;
 	cb->relTxFrame = igbRawsockRelTxFrame;
 	cb->txSetMark = igbRawsockTxSetMark;
+	cb->txSetLaunchTime = igbRawsockTxSetLaunchTime;
 	cb->txFrameReady = igbRawsockTxFrameReady;
 	cb->send = igbRawsockSend;
+	cb->getTxFrames = igbRawsockGetTxFrames;
+	cb->txFramesSend = igbRawsockTxFramesSend;
 	cb->txBufLevel = igbRawsockTxBufLevel;
 	cb->getTXOutOfBuffers = igbRawsockGetTXOutOfBuffers;
 	cb->getTXOutOfBuffersCyclic = igbRawsockGetTXOutOfBuffersCyclic;
+	if (rawsock->rx_queue >= 0) {
+		cb->getRxFrame = igbRawsockGetRxFrame;
+		cb->relRxFrame = igbRawsockRelRxFrame;
+		cb->rxGetTimestamp = igbRawsockRxGetTimestamp;
+		cb->rxParseHdr = baseRawsockRxParseHdr;
+		cb->rxMulticast = igbRawsockRxMulticast;
+	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
 	return rawsock;
@@ -98,6 +182,8 @@ void igbRawsockClose(void *pvRawsock)
 {
 	igb_rawsock_t *rawsock = (igb_rawsock_t*)pvRawsock;
 
+	x_igbRxClose(rawsock);
+
 	if (rawsock->igb_dev) {
 		igbReleaseDevice(rawsock->igb_dev);
 	}
@@ -132,6 +218,16 @@ bool igbRawsockTxSetMark(void *pvRawsock, int mark)
 	return TRUE;
 }
 
+// Launch time is a build option of the igb rawsock (IGB_LAUNCHTIME_ENABLED)
+bool igbRawsockTxSetLaunchTime(void *pvRawsock, bool enable)
+{
+	if (!VALID_TX_RAWSOCK((igb_rawsock_t*)pvRawsock)) {
+		AVB_LOG_ERROR("Setting launch time; invalid argument passed");
+		return FALSE;
+	}
+	return enable == (IGB_LAUNCHTIME_ENABLED ? TRUE : FALSE);
+}
+
 // Get a buffer from the ring to use for TX
 U8 *igbRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len)
 {
@@ -149,7 +245,7 @@ U8 *igbRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len)
 	int bBufferBusyReported = 0;
 
 	do {
-		rawsock->tx_packet = igbGetTxPacket(rawsock->igb_dev);
+		rawsock->tx_packet = igbGetTxPacket(rawsock->igb_dev, rawsock->queue);
 		if (!rawsock->tx_packet && blocking) {
 			if (0 == bBufferBusyReported) {
 				if (!rawsock->txOutOfBuffer) {
@@ -191,6 +287,18 @@ bool igbRawsockRelTxFrame(void *pvRawsock, U8 *pBuffer)
 	return TRUE;
 }
 
+#if IGB_LAUNCHTIME_ENABLED
+// A launch time already behind the NIC clock goes out at once, outside the
+// class's pacing; say so rather than let the stream drift silently.
+static void x_igbCheckLaunchTime(igb_rawsock_t *rawsock, U64 attime)
+{
+	U64 nowLocal;
+	if (igbGetLocalTime(rawsock->igb_dev, &nowLocal) && attime < nowLocal) {
+		IF_LOG_INTERVAL(1000) AVB_LOGF_WARNING("Launch time %" PRIu64 "ns in the past", nowLocal - attime);
+	}
+}
+#endif
+
 // Release a TX frame, and mark it as ready to send
 bool igbRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64 timeNsec)
 {
@@ -207,7 +315,8 @@ bool igbRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64
 	rawsock->tx_packet->len = len;
 
 #if IGB_LAUNCHTIME_ENABLED
-	gptpmaster2local(&gPtpTD, timeNsec, &rawsock->tx_packet->attime);
+	gptpmaster2local(osalAVBTimeData(), timeNsec, &rawsock->tx_packet->attime);
+	x_igbCheckLaunchTime(rawsock, rawsock->tx_packet->attime);
 #endif
 
 	err = igb_xmit(rawsock->igb_dev, rawsock->queue, rawsock->tx_packet);
@@ -230,6 +339,241 @@ int igbRawsockSend(void *pvRawsock)
 	return 1;
 }
 
+// Get a burst of buffers to use for TX
+int igbRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	igb_rawsock_t *rawsock = (igb_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || len == NULL) {
+		AVB_LOG_ERROR("Getting TX frames; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	// Only wait for the first buffer; hand back whatever else is free.
+	U32 i = 0, slot;
+	for (slot = 0; slot < OPENAVB_RAWSOCK_TX_BURST_MAX && i < count; slot++) {
+		if (rawsock->tx_burst[slot])
+			continue;
+		pFrames[i] = igbRawsockGetTxFrame(pvRawsock, blocking && i == 0, len);
+		if (!pFrames[i])
+			break;
+		rawsock->tx_burst[slot] = rawsock->tx_packet;
+		i++;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return i;
+}
+
+// Queue a burst of TX frames and bump the descriptor tail once
+int igbRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	igb_rawsock_t *rawsock = (igb_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || lens == NULL || count > OPENAVB_RAWSOCK_TX_BURST_MAX) {
+		AVB_LOG_ERROR("Send; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	struct igb_packet *packets[OPENAVB_RAWSOCK_TX_BURST_MAX];
+	U32 i, slot, nPackets = 0;
+
+	for (i = 0; i < count; i++) {
+		for (slot = 0; slot < OPENAVB_RAWSOCK_TX_BURST_MAX; slot++) {
+			if (rawsock->tx_burst[slot] && rawsock->tx_burst[slot]->vaddr == pFrames[i])
+				break;
+		}
+		if (slot == OPENAVB_RAWSOCK_TX_BURST_MAX) {
+			AVB_LOG_ERROR("Send; frame not obtained with igbRawsockGetTxFrames");
+			break;
+		}
+
+		struct igb_packet *packet = rawsock->tx_burst[slot];
+		rawsock->tx_burst[slot] = NULL;
+		packet->len = lens[i];
+
+#if IGB_LAUNCHTIME_ENABLED
+		gptpmaster2local(osalAVBTimeData(), timeNsec ? timeNsec[i] : 0, &packet->attime);
+#endif
+
+		packets[nPackets++] = packet;
+	}
+
+#if IGB_LAUNCHTIME_ENABLED
+	// the first frame of the burst has the earliest launch time
+	if (timeNsec && nPackets)
+		x_igbCheckLaunchTime(rawsock, packets[0]->attime);
+#endif
+
+	U32 nSent = nPackets;
+	int err = igb_xmit_batch(rawsock->igb_dev, rawsock->queue, packets, &nSent);
+	if (err) {
+		AVB_LOGF_ERROR("igb_xmit_batch failed: %s", strerror(err < 0 ? -err : err));
+	}
+
+	// Packets the ring had no room for go back to the free list
+	for (i = nSent; i < nPackets; i++) {
+		igbRelTxPacket(rawsock->igb_dev, rawsock->queue, packets[i]);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return nSent;
+}
+
+// Get a received frame straight out of the igb RX ring (zero copy)
+U8 *igbRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	igb_rawsock_t *rawsock = (igb_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || offset == NULL || len == NULL) {
+		AVB_LOG_ERROR("Getting RX frame; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return NULL;
+	}
+
+	if (rawsock->rx_packet) {
+		AVB_LOG_ERROR("Getting RX frame; previous frame not released");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return NULL;
+	}
+
+	U64 deadlineNsec = 0;
+	if (timeout != OPENAVB_RAWSOCK_BLOCK && timeout != OPENAVB_RAWSOCK_NONBLOCK) {
+		CLOCK_GETTIME64(OPENAVB_CLOCK_MONOTONIC, &deadlineNsec);
+		deadlineNsec += (U64)timeout * NANOSECONDS_PER_USEC;
+	}
+
+	while (!rawsock->rx_nPending) {
+		U32 count = IGB_RX_BATCH;
+		int err = igb_receive(rawsock->igb_dev, rawsock->rx_queue, &rawsock->rx_pending, &count);
+		if (!err && count) {
+			rawsock->rx_nPending = count;
+			break;
+		}
+		if (err && err != EAGAIN) {
+			IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("igb_receive failed: %s", strerror(err < 0 ? -err : err));
+		}
+
+		if (timeout == OPENAVB_RAWSOCK_NONBLOCK) {
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+		if (deadlineNsec) {
+			U64 nowNsec;
+			CLOCK_GETTIME64(OPENAVB_CLOCK_MONOTONIC, &nowNsec);
+			if (nowNsec >= deadlineNsec) {
+				AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+				return NULL;
+			}
+		}
+		usleep(IGB_RX_POLL_USEC);
+	}
+
+	// the chain from igb_receive is only valid for rx_nPending entries
+	rawsock->rx_packet = rawsock->rx_pending;
+	rawsock->rx_pending = --rawsock->rx_nPending ? rawsock->rx_packet->next : NULL;
+	rawsock->rx_packet->next = NULL;
+
+	*offset = 0;
+	*len = rawsock->rx_packet->len;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	// the frame starts past the timestamp header, if the NIC wrote one
+	return (U8*)rawsock->rx_packet->vaddr + rawsock->rx_packet->rxoffset;
+}
+
+// Hand the frame's buffer back to the RX ring
+bool igbRawsockRelRxFrame(void *pvRawsock, U8 *pFrame)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	igb_rawsock_t *rawsock = (igb_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || !rawsock->rx_packet
+		|| (U8*)rawsock->rx_packet->vaddr + rawsock->rx_packet->rxoffset != pFrame) {
+		AVB_LOG_ERROR("Releasing RX frame; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	int err;
+	do {
+		// igb_refresh_buffers only fails with EAGAIN while igb_receive holds the ring
+		err = igb_refresh_buffers(rawsock->igb_dev, rawsock->rx_queue, &rawsock->rx_packet, 1);
+	} while (err == EAGAIN);
+	if (err) {
+		AVB_LOGF_ERROR("igb_refresh_buffers failed: %s", strerror(err < 0 ? -err : err));
+	}
+	rawsock->rx_packet = NULL;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return !err;
+}
+
+// SYSTIM time the i210 stamped into the frame's buffer on arrival
+bool igbRawsockRxGetTimestamp(void *pvRawsock, U8 *pFrame, U64 *pTimeNsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	igb_rawsock_t *rawsock = (igb_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || !rawsock->rx_packet || pTimeNsec == NULL
+		|| (U8*)rawsock->rx_packet->vaddr + rawsock->rx_packet->rxoffset != pFrame) {
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	*pTimeNsec = rawsock->rx_packet->rxtime;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return rawsock->rx_packet->rxtime != 0;
+}
+
+// Steer AVTP frames for addr into the rawsock's RX queue with a flex filter
+bool igbRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	igb_rawsock_t *rawsock = (igb_rawsock_t*)pvRawsock;
+
+	// keep the pcap filter in step so the fallback path sees the same traffic
+	pcapRawsockRxMulticast(pvRawsock, add_membership, addr);
+
+	if (!add_membership) {
+		igb_clear_flex_filter(rawsock->igb_dev, rawsock->rx_filter);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return TRUE;
+	}
+
+	// match dst mac, the 802.1Q TPID and the ethertype behind the tag
+	U8 filter[128];
+	U8 mask[64];
+	memset(filter, 0, sizeof(filter));
+	memset(mask, 0, sizeof(mask));
+
+	eth_vlan_hdr_t *hdr = (eth_vlan_hdr_t*)filter;
+	memcpy(hdr->dhost, addr, ETH_ALEN);
+	hdr->vlan.tpip = htons(ETHERTYPE_8021Q);
+	hdr->ethertype = htons(rawsock->base.ethertype);
+
+	mask[0] = 0x3F;		// bytes 0-5: dst mac
+	mask[1] = 0x30;		// bytes 12-13: 802.1Q TPID
+	mask[2] = 0x03;		// bytes 16-17: ethertype
+
+	// filter length must be a multiple of 8
+	unsigned int filter_len = ((sizeof(eth_vlan_hdr_t) + 7) / 8) * 8;
+
+	int err = igb_setup_flex_filter(rawsock->igb_dev, rawsock->rx_queue, rawsock->rx_filter, filter_len, filter, mask);
+	if (err) {
+		AVB_LOGF_ERROR("igb_setup_flex_filter failed: %s", strerror(err < 0 ? -err : err));
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return !err;
+}
+
 int igbRawsockTxBufLevel(void *pvRawsock)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
@@ -33,13 +33,32 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "rawsock_impl.h"
 #include <pcap/pcap.h>
 #include "igb.h"
+#include "openavb_igb.h"
+
+// how many descriptors to reap per igb_receive() call
+#define IGB_RX_BATCH 16
 
 typedef struct {
 	base_rawsock_t base;
 	pcap_t *handle;
 	device_t *igb_dev;
 	struct igb_packet *tx_packet;
+	// packets handed out by igbRawsockGetTxFrames and not yet sent
+	struct igb_packet *tx_burst[OPENAVB_RAWSOCK_TX_BURST_MAX];
 	int queue;
+	// zero-copy RX queue fed by a flex filter; -1 when RX goes through pcap
+	int rx_queue;
+	// flex filter steering into rx_queue, shared with other processes
+	unsigned int rx_filter;
+	bool rx_filterAllocated;
+	struct igb_dma_alloc rx_pages[IGB_RX_PAGES];
+	struct igb_packet *rx_packets;
+	int rx_nPackets;
+	// frame handed out by igbRawsockGetRxFrame
+	struct igb_packet *rx_packet;
+	// frames reaped from the ring but not yet handed out
+	struct igb_packet *rx_pending;
+	U32 rx_nPending;
 	unsigned long txOutOfBuffer;
 	unsigned long txOutOfBufferCyclic;
 } igb_rawsock_t;
@@ -50,6 +69,9 @@ void igbRawsockClose(void *pvRawsock);
 
 bool igbRawsockTxSetMark(void *pvRawsock, int mark);
 
+// Launch time is a build option of the igb rawsock (IGB_LAUNCHTIME_ENABLED)
+bool igbRawsockTxSetLaunchTime(void *pvRawsock, bool enable);
+
 U8 *igbRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len);
 
 bool igbRawsockRelTxFrame(void *pvRawsock, U8 *pBuffer);
@@ -58,6 +80,18 @@ bool igbRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64
 
 int igbRawsockSend(void *pvRawsock);
 
+int igbRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len);
+
+int igbRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count);
+
+U8 *igbRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len);
+
+bool igbRawsockRelRxFrame(void *pvRawsock, U8 *pFrame);
+
+bool igbRawsockRxGetTimestamp(void *pvRawsock, U8 *pFrame, U64 *pTimeNsec);
+
+bool igbRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN]);
+
 int igbRawsockTxBufLevel(void *pvRawsock);
 
 unsigned long igbRawsockGetTXOutOfBuffers(void *pvRawsock);
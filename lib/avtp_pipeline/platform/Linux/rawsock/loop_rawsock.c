@@ -0,0 +1,774 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : In-process loopback rawsock.
+*
+* Rawsocks opened on the same "loop:<name>" interface share a wire that
+* lives in the process. Frames a talker marks ready are copied directly
+* into the queues of the listeners whose destination MAC and stream ID
+* match, which lets a whole talker to listener pipeline run without a
+* network device (ie: for benchmarking the mapping and interface modules).
+* A wire can be impaired with delay, jitter and loss; delayed frames stay
+* queued until they are due on the wall clock.
+*/
+
+#include "loop_rawsock.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <linux/if_packet.h>
+
+#include "openavb_trace.h"
+
+#define	AVB_LOG_COMPONENT	"Raw Socket"
+#include "openavb_log.h"
+
+// Offset of the stream_id within an AVTP stream PDU
+#define LOOP_RAWSOCK_STREAM_ID_OFFSET	4
+#define LOOP_RAWSOCK_STREAM_ID_LEN		8
+
+// Default queue depth if the client doesn't ask for one
+#define LOOP_RAWSOCK_DEFAULT_SLOTS		64
+
+// MTU reported for loop wires
+#define LOOP_RAWSOCK_MTU				1500
+
+typedef struct loop_wire {
+	char name[IFNAMSIZ];
+
+	// number of rawsocks attached
+	int users;
+
+	// protects the demultiplexing tables; talkers only read them
+	pthread_rwlock_t lock;
+	loop_rawsock_t *buckets[LOOP_RAWSOCK_HASH_SIZE];
+	// listeners without a full destination/stream ID key
+	loop_rawsock_t *wildcards;
+
+	// impairments (see loopRawsockSetImpairment)
+	bool bImpaired;
+	U64 delayNS;
+	U64 jitterNS;
+	U32 lossPpm;
+	U32 seed;
+
+	struct loop_wire *pNext;
+} loop_wire_t;
+
+static loop_wire_t *gWires = NULL;
+static pthread_mutex_t gWiresMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// FNV-1a over destination MAC and stream ID
+static U32 x_loopHash(const U8 *pDestAddr, const U8 *pStreamID)
+{
+	U32 hash = 2166136261u;
+	int i;
+	for (i = 0; i < ETH_ALEN; i++) {
+		hash = (hash ^ pDestAddr[i]) * 16777619u;
+	}
+	for (i = 0; i < LOOP_RAWSOCK_STREAM_ID_LEN; i++) {
+		hash = (hash ^ pStreamID[i]) * 16777619u;
+	}
+	return hash & (LOOP_RAWSOCK_HASH_SIZE - 1);
+}
+
+// Fill in made-up interface info for a loop wire. The (locally administered)
+// MAC address is derived from the wire name, so it is stable between runs.
+bool loopAvbCheckInterface(const char *ifname, if_info_t *info)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	if (!ifname || !info || strlen(ifname) >= IFNAMSIZ) {
+		AVB_LOG_ERROR("Checking loop interface; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	memset(info, 0, sizeof(if_info_t));
+	strncpy(info->name, ifname, IFNAMSIZ - 1);
+
+	U32 hash = 2166136261u;
+	const char *p;
+	for (p = ifname; *p; p++) {
+		hash = (hash ^ (U8)*p) * 16777619u;
+	}
+	info->mac.ether_addr_octet[0] = 0x02;
+	info->mac.ether_addr_octet[1] = 0x00;
+	info->mac.ether_addr_octet[2] = (hash >> 24) & 0xff;
+	info->mac.ether_addr_octet[3] = (hash >> 16) & 0xff;
+	info->mac.ether_addr_octet[4] = (hash >> 8) & 0xff;
+	info->mac.ether_addr_octet[5] = hash & 0xff;
+	info->index = 0;
+	info->mtu = LOOP_RAWSOCK_MTU;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
+// Find (or create) the wire with the given name and take a reference on it
+static loop_wire_t *x_loopWireAcquire(const char *ifname)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	pthread_mutex_lock(&gWiresMutex);
+
+	loop_wire_t *wire;
+	for (wire = gWires; wire; wire = wire->pNext) {
+		if (strcmp(wire->name, ifname) == 0)
+			break;
+	}
+
+	if (!wire) {
+		wire = calloc(1, sizeof(loop_wire_t));
+		if (!wire) {
+			AVB_LOG_ERROR("Creating loop wire; malloc failed");
+			pthread_mutex_unlock(&gWiresMutex);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
+		strncpy(wire->name, ifname, sizeof(wire->name) - 1);
+		pthread_rwlock_init(&wire->lock, NULL);
+		wire->pNext = gWires;
+		gWires = wire;
+		AVB_LOGF_INFO("Loop wire %s created", ifname);
+	}
+	wire->users++;
+
+	pthread_mutex_unlock(&gWiresMutex);
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return wire;
+}
+
+// Drop a reference on a wire, freeing it when the last user is gone
+static void x_loopWireRelease(loop_wire_t *wire)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	pthread_mutex_lock(&gWiresMutex);
+
+	if (--wire->users > 0) {
+		pthread_mutex_unlock(&gWiresMutex);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return;
+	}
+
+	loop_wire_t **ppWire;
+	for (ppWire = &gWires; *ppWire; ppWire = &(*ppWire)->pNext) {
+		if (*ppWire == wire) {
+			*ppWire = wire->pNext;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&gWiresMutex);
+
+	pthread_rwlock_destroy(&wire->lock);
+	free(wire);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+}
+
+// Remove a listener from the wire's tables. Caller holds the wire lock for writing.
+static void x_loopUnlink(loop_rawsock_t *rawsock)
+{
+	if (!rawsock->bLinked)
+		return;
+
+	loop_wire_t *wire = rawsock->wire;
+	loop_rawsock_t **ppClient = &wire->wildcards;
+	if (rawsock->bDestAddr && rawsock->bStreamID)
+		ppClient = &wire->buckets[x_loopHash(rawsock->destAddr, rawsock->streamID)];
+
+	for (; *ppClient; ppClient = &(*ppClient)->pNext) {
+		if (*ppClient == rawsock) {
+			*ppClient = rawsock->pNext;
+			break;
+		}
+	}
+	rawsock->pNext = NULL;
+	rawsock->bLinked = FALSE;
+}
+
+// Add a listener to the wire's tables. Caller holds the wire lock for writing.
+static void x_loopLink(loop_rawsock_t *rawsock)
+{
+	loop_wire_t *wire = rawsock->wire;
+	loop_rawsock_t **ppClient = &wire->wildcards;
+	if (rawsock->bDestAddr && rawsock->bStreamID)
+		ppClient = &wire->buckets[x_loopHash(rawsock->destAddr, rawsock->streamID)];
+
+	rawsock->pNext = *ppClient;
+	*ppClient = rawsock;
+	rawsock->bLinked = TRUE;
+}
+
+// xorshift32; the state is never 0
+static inline U32 x_loopRand(U32 *pState)
+{
+	U32 x = *pState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*pState = x;
+	return x;
+}
+
+// Seed a listener's impairments from the wire seed and its key, so the
+// same streams see the same impairments whatever order they are opened in
+static U32 x_loopSeed(loop_rawsock_t *rawsock)
+{
+	U32 hash = 2166136261u ^ rawsock->wire->seed;
+	int i;
+	for (i = 0; i < ETH_ALEN; i++) {
+		hash = (hash ^ rawsock->destAddr[i]) * 16777619u;
+	}
+	for (i = 0; i < LOOP_RAWSOCK_STREAM_ID_LEN; i++) {
+		hash = (hash ^ rawsock->streamID[i]) * 16777619u;
+	}
+	return hash ? hash : 1;
+}
+
+// Queue a copy of the frame for a listener. nowNS is only set on impaired wires.
+static void x_loopPush(loop_rawsock_t *rawsock, const U8 *pFrame, U32 len, U64 nowNS)
+{
+	if (len > rawsock->slotSize) {
+		IF_LOG_INTERVAL(1000) AVB_LOGF_WARNING("Loop frame too big for receive buffer (len %u)", len);
+		return;
+	}
+
+	pthread_mutex_lock(&rawsock->pushLock);
+
+	U64 dueNS = 0;
+	if (nowNS) {
+		loop_wire_t *wire = rawsock->wire;
+		if (!rawsock->rndState)
+			rawsock->rndState = x_loopSeed(rawsock);
+
+		if (wire->lossPpm && (((U64)x_loopRand(&rawsock->rndState) * 1000000) >> 32) < wire->lossPpm) {
+			rawsock->rxLost++;
+			pthread_mutex_unlock(&rawsock->pushLock);
+			return;
+		}
+
+		dueNS = nowNS + wire->delayNS;
+		if (wire->jitterNS)
+			dueNS += ((U64)x_loopRand(&rawsock->rndState) * (wire->jitterNS + 1)) >> 32;
+		if (dueNS < rawsock->lastDueNS)
+			dueNS = rawsock->lastDueNS;
+		rawsock->lastDueNS = dueNS;
+	}
+
+	U32 head = rawsock->head;
+	U32 next = head + 1;
+	if (next == rawsock->slotCount)
+		next = 0;
+
+	if (next == OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->tail)) {
+		rawsock->rxDropped++;
+		pthread_mutex_unlock(&rawsock->pushLock);
+		IF_LOG_INTERVAL(1000) AVB_LOGF_WARNING("Loop RX queue full; frame dropped (rawsock=%p)", rawsock);
+		return;
+	}
+
+	memcpy(rawsock->pSlotMem + (head * rawsock->slotSize), pFrame, len);
+	rawsock->pSlotLen[head] = len;
+	rawsock->pSlotDueNS[head] = dueNS;
+	OPENAVB_ATOMIC_STORE_RELEASE(&rawsock->head, next);
+
+	pthread_mutex_unlock(&rawsock->pushLock);
+
+	// Only wake the listener if it may have seen an empty queue. Pairs with
+	// the fence in loopRawsockRelRxFrame().
+	OPENAVB_ATOMIC_FENCE();
+	if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->tail) == head) {
+		U64 one = 1;
+		if (write(rawsock->eventFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+			IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("Loop RX signal failed: %s", strerror(errno));
+		}
+	}
+}
+
+bool loopRawsockSetImpairment(const char *ifname, U32 delayUsec, U32 jitterUsec, U32 lossPpm, U32 seed)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	if (!ifname || strlen(ifname) >= IFNAMSIZ || lossPpm > 1000000) {
+		AVB_LOG_ERROR("Setting loop impairment; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	// The reference is never dropped, so the settings outlive the rawsocks
+	loop_wire_t *wire = x_loopWireAcquire(ifname);
+	if (!wire) {
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	pthread_rwlock_wrlock(&wire->lock);
+	wire->delayNS = (U64)delayUsec * NANOSECONDS_PER_USEC;
+	wire->jitterNS = (U64)jitterUsec * NANOSECONDS_PER_USEC;
+	wire->lossPpm = lossPpm;
+	wire->seed = seed;
+	wire->bImpaired = delayUsec || jitterUsec || lossPpm;
+	pthread_rwlock_unlock(&wire->lock);
+
+	AVB_LOGF_INFO("Loop wire %s: delay %uus, jitter %uus, loss %u ppm", ifname, delayUsec, jitterUsec, lossPpm);
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
+// Open a rawsock on an in-process wire
+void* loopRawsockOpen(loop_rawsock_t *rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	AVB_LOGF_DEBUG("Open, rx=%d, tx=%d, ethertype=%x size=%d, num=%d", rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
+	baseRawsockOpen(&rawsock->base, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
+	rawsock->eventFd = -1;
+	pthread_mutex_init(&rawsock->pushLock, NULL);
+
+	if (!loopAvbCheckInterface(ifname, &(rawsock->base.ifInfo))) {
+		AVB_LOGF_ERROR("Creating rawsock; bad loop interface name: %s", ifname);
+		loopRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Deal with frame size.
+	if (rawsock->base.frameSize == 0) {
+		// use interface MTU as max frames size, if none specified
+		rawsock->base.frameSize = rawsock->base.ifInfo.mtu + ETH_HLEN + VLAN_HLEN;
+	}
+	if (rawsock->base.frameSize > sizeof(rawsock->txBuffer)) {
+		AVB_LOGF_ERROR("Creating rawsock; frame size %d too big", rawsock->base.frameSize);
+		loopRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	if (rx_mode) {
+		// Allocate our frame queue
+		rawsock->slotCount = (num_frames ? num_frames : LOOP_RAWSOCK_DEFAULT_SLOTS) + 1;
+		rawsock->slotSize = TPACKET_ALIGN(rawsock->base.frameSize);
+		rawsock->pSlotMem = malloc(rawsock->slotCount * rawsock->slotSize);
+		rawsock->pSlotLen = calloc(rawsock->slotCount, sizeof(U32));
+		rawsock->pSlotDueNS = calloc(rawsock->slotCount, sizeof(U64));
+		if (!rawsock->pSlotMem || !rawsock->pSlotLen || !rawsock->pSlotDueNS) {
+			AVB_LOG_ERROR("Creating rawsock; malloc failed");
+			loopRawsockClose(rawsock);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
+
+		rawsock->eventFd = eventfd(0, EFD_NONBLOCK);
+		if (rawsock->eventFd == -1) {
+			AVB_LOGF_ERROR("Creating rawsock; eventfd: %s", strerror(errno));
+			loopRawsockClose(rawsock);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
+	}
+
+	rawsock->wire = x_loopWireAcquire(ifname);
+	if (!rawsock->wire) {
+		loopRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	if (rx_mode) {
+		// Until a destination and stream ID are set, receive everything
+		pthread_rwlock_wrlock(&rawsock->wire->lock);
+		x_loopLink(rawsock);
+		pthread_rwlock_unlock(&rawsock->wire->lock);
+	}
+
+	// fill virtual functions table
+	rawsock_cb_t *cb = &rawsock->base.cb;
+	cb->close = loopRawsockClose;
+	cb->getSocket = loopRawsockGetSocket;
+	cb->getTxFrame = loopRawsockGetTxFrame;
+	cb->relTxFrame = loopRawsockRelTxFrame;
+	cb->txFrameReady = loopRawsockTxFrameReady;
+	cb->send = loopRawsockSend;
+	cb->txSetMark = loopRawsockTxSetMark;
+	cb->txBufLevel = loopRawsockTxBufLevel;
+	cb->getRxFrame = loopRawsockGetRxFrame;
+	cb->relRxFrame = loopRawsockRelRxFrame;
+	cb->rxMulticast = loopRawsockRxMulticast;
+	cb->rxStreamID = loopRawsockRxStreamID;
+	cb->rxBufLevel = loopRawsockRxBufLevel;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock;
+}
+
+// Close the rawsock
+void loopRawsockClose(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+
+	if (rawsock) {
+		if (rawsock->wire) {
+			pthread_rwlock_wrlock(&rawsock->wire->lock);
+			x_loopUnlink(rawsock);
+			pthread_rwlock_unlock(&rawsock->wire->lock);
+
+			x_loopWireRelease(rawsock->wire);
+			rawsock->wire = NULL;
+		}
+
+		if (rawsock->rxDropped) {
+			AVB_LOGF_INFO("Loop RX queue dropped %lu frames", rawsock->rxDropped);
+		}
+		if (rawsock->rxLost) {
+			AVB_LOGF_INFO("Loop wire impairment dropped %lu frames", rawsock->rxLost);
+		}
+
+		if (rawsock->eventFd != -1) {
+			close(rawsock->eventFd);
+			rawsock->eventFd = -1;
+		}
+
+		free(rawsock->pSlotMem);
+		rawsock->pSlotMem = NULL;
+		free(rawsock->pSlotLen);
+		rawsock->pSlotLen = NULL;
+		free(rawsock->pSlotDueNS);
+		rawsock->pSlotDueNS = NULL;
+
+		pthread_mutex_destroy(&rawsock->pushLock);
+	}
+
+	baseRawsockClose(rawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+}
+
+// Get the eventfd used for this rawsock; can be used for poll/select
+int loopRawsockGetSocket(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!rawsock) {
+		AVB_LOG_ERROR("Getting socket; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return -1;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock->eventFd;
+}
+
+// Get a buffer to use for TX. There is only one; frames are copied
+// out of it as soon as they are ready, so it is never held for long.
+U8* loopRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_TX_RAWSOCK(rawsock) || len == NULL) {
+		AVB_LOG_ERROR("Getting TX frame; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return NULL;
+	}
+
+	*len = rawsock->base.frameSize;
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return rawsock->txBuffer;
+}
+
+// Release a TX frame, without sending it
+bool loopRawsockRelTxFrame(void *pvRawsock, U8 *pBuffer)
+{
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_TX_RAWSOCK(rawsock) || pBuffer != rawsock->txBuffer) {
+		AVB_LOG_ERROR("Releasing TX frame; invalid argument");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Deliver a TX frame to the listeners on the wire
+bool loopRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64 timeNsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_TX_RAWSOCK(rawsock) || pBuffer == NULL || len < ETH_HLEN) {
+		AVB_LOG_ERROR("Marking TX frame ready; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	U32 hdrLen = ETH_HLEN;
+	if (ntohs(((eth_hdr_t *)pBuffer)->ethertype) == ETHERTYPE_8021Q)
+		hdrLen += VLAN_HLEN;
+
+	const U8 *pStreamID = NULL;
+	if (len >= hdrLen + LOOP_RAWSOCK_STREAM_ID_OFFSET + LOOP_RAWSOCK_STREAM_ID_LEN)
+		pStreamID = pBuffer + hdrLen + LOOP_RAWSOCK_STREAM_ID_OFFSET;
+
+	loop_wire_t *wire = rawsock->wire;
+	loop_rawsock_t *pClient;
+	U64 nowNS = 0;
+
+	pthread_rwlock_rdlock(&wire->lock);
+
+	if (wire->bImpaired)
+		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+
+	if (pStreamID) {
+		pClient = wire->buckets[x_loopHash(pBuffer, pStreamID)];
+		for (; pClient; pClient = pClient->pNext) {
+			if (memcmp(pClient->streamID, pStreamID, LOOP_RAWSOCK_STREAM_ID_LEN) == 0
+				&& memcmp(pClient->destAddr, pBuffer, ETH_ALEN) == 0) {
+				x_loopPush(pClient, pBuffer, len, nowNS);
+			}
+		}
+	}
+
+	for (pClient = wire->wildcards; pClient; pClient = pClient->pNext) {
+		if (!pClient->bDestAddr || memcmp(pClient->destAddr, pBuffer, ETH_ALEN) == 0) {
+			x_loopPush(pClient, pBuffer, len, nowNS);
+		}
+	}
+
+	pthread_rwlock_unlock(&wire->lock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Frames are delivered as soon as they are ready; nothing to do
+int loopRawsockSend(void *pvRawsock)
+{
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Send; invalid argument");
+		return -1;
+	}
+	return 1;
+}
+
+// Accept (and ignore) the firewall mark; there is no qdisc on a loop wire
+bool loopRawsockTxSetMark(void *pvRawsock, int mark)
+{
+	return VALID_TX_RAWSOCK(pvRawsock);
+}
+
+// Count used TX buffers
+int loopRawsockTxBufLevel(void *pvRawsock)
+{
+	return 0;
+}
+
+// Get a RX frame
+U8* loopRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock) || offset == NULL || len == NULL) {
+		AVB_LOG_ERROR("Getting RX frame; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return NULL;
+	}
+
+#if AVB_FEATURE_SIM
+	// The virtual clock doesn't move while we wait, so never wait
+	timeout = OPENAVB_RAWSOCK_NONBLOCK;
+#endif
+
+	while (1) {
+		U32 tail = rawsock->tail;
+		U64 dueWaitNS = 0;
+		if (tail != OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->head)) {
+			U64 dueNS = rawsock->pSlotDueNS[tail], nowNS = 0;
+			if (dueNS)
+				CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+			if (dueNS <= nowNS) {
+				// Frames are stored from the start of the slot
+				*offset = 0;
+				*len = rawsock->pSlotLen[tail];
+				AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+				return rawsock->pSlotMem + (tail * rawsock->slotSize);
+			}
+			// Still on the (impaired) wire
+			dueWaitNS = dueNS - nowNS;
+		}
+
+		if (timeout == OPENAVB_RAWSOCK_NONBLOCK) {
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+
+		struct pollfd pfd;
+		struct timespec ts, *pts = NULL;
+		bool bDueWait = FALSE;
+		if (timeout != OPENAVB_RAWSOCK_BLOCK) {
+			ts.tv_sec = timeout / MICROSECONDS_PER_SECOND;
+			ts.tv_nsec = (timeout % MICROSECONDS_PER_SECOND) * NANOSECONDS_PER_USEC;
+			pts = &ts;
+		}
+		if (dueWaitNS && (!pts || dueWaitNS < (U64)timeout * NANOSECONDS_PER_USEC)) {
+			// Wake up when the frame at the tail is due
+			ts.tv_sec = dueWaitNS / NANOSECONDS_PER_SECOND;
+			ts.tv_nsec = dueWaitNS % NANOSECONDS_PER_SECOND;
+			pts = &ts;
+			bDueWait = TRUE;
+		}
+
+		pfd.fd = rawsock->eventFd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		int ret = ppoll(&pfd, 1, pts, NULL);
+		if (ret < 0) {
+			if (errno != EINTR) {
+				AVB_LOGF_ERROR("Getting RX frame; poll failed: %s", strerror(errno));
+			}
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+		if ((pfd.revents & POLLIN) == 0) {
+			if (bDueWait)
+				continue;
+			// timeout
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+
+		// Reset the eventfd counter, then look at the queue again
+		U64 count;
+		if (read(rawsock->eventFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+			AVB_LOGF_ERROR("Getting RX frame; eventfd read failed: %s", strerror(errno));
+		}
+	}
+}
+
+// Release a RX frame held by the client
+bool loopRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Releasing RX frame; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	U32 tail = rawsock->tail;
+	if (tail == OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->head)
+		|| pBuffer != rawsock->pSlotMem + (tail * rawsock->slotSize)) {
+		AVB_LOG_ERROR("Releasing RX frame; frame not held");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	if (++tail == rawsock->slotCount)
+		tail = 0;
+	OPENAVB_ATOMIC_STORE_RELEASE(&rawsock->tail, tail);
+
+	// Pairs with the fence in x_loopPush(), so a frame queued while we
+	// release this one either shows up to us or signals the eventfd.
+	OPENAVB_ATOMIC_FENCE();
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Setup the rawsock to receive multicast packets
+bool loopRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock) || addr == NULL) {
+		AVB_LOG_ERROR("Setting multicast; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	pthread_rwlock_wrlock(&rawsock->wire->lock);
+	x_loopUnlink(rawsock);
+	if (add_membership) {
+		memcpy(rawsock->destAddr, addr, ETH_ALEN);
+		rawsock->bDestAddr = TRUE;
+	}
+	else if (rawsock->bDestAddr && memcmp(rawsock->destAddr, addr, ETH_ALEN) == 0) {
+		rawsock->bDestAddr = FALSE;
+	}
+	x_loopLink(rawsock);
+	pthread_rwlock_unlock(&rawsock->wire->lock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
+// Deliver only frames of the given stream to this rawsock
+bool loopRawsockRxStreamID(void *pvRawsock, const U8 streamID[8])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock) || streamID == NULL) {
+		AVB_LOG_ERROR("Setting stream ID; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	pthread_rwlock_wrlock(&rawsock->wire->lock);
+	x_loopUnlink(rawsock);
+	memcpy(rawsock->streamID, streamID, LOOP_RAWSOCK_STREAM_ID_LEN);
+	rawsock->bStreamID = TRUE;
+	x_loopLink(rawsock);
+	pthread_rwlock_unlock(&rawsock->wire->lock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
+// Count used RX buffers in our queue
+int loopRawsockRxBufLevel(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	loop_rawsock_t *rawsock = (loop_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("getting buffer level; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return 0;
+	}
+
+	U32 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->head);
+	U32 tail = OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->tail);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return (head + rawsock->slotCount - tail) % rawsock->slotCount;
+}
@@ -0,0 +1,149 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+#ifndef LOOP_RAWSOCK_H
+#define LOOP_RAWSOCK_H
+
+#include "rawsock_impl.h"
+#include <pthread.h>
+
+// Number of hash buckets used to demultiplex frames on a wire
+#define LOOP_RAWSOCK_HASH_SIZE		64
+
+struct loop_wire;
+
+// State information for a rawsock attached to an in-process wire.
+// Frames sent by any TX rawsock on a wire are copied straight into the
+// queues of the RX rawsocks on the same wire; no network device is used.
+//
+typedef struct loop_rawsock {
+	base_rawsock_t base;
+
+	// wire we are attached to
+	struct loop_wire *wire;
+
+	// buffer for sending frames
+	U8 txBuffer[1518];
+
+	// eventfd signalled when frames are queued; used for poll
+	int eventFd;
+
+	// demultiplexing key
+	U8 destAddr[ETH_ALEN];
+	bool bDestAddr;
+	U8 streamID[8];
+	bool bStreamID;
+
+	// linkage in the wire's hash bucket (or wildcard list)
+	bool bLinked;
+	struct loop_rawsock *pNext;
+
+	// serializes talkers delivering to this rawsock
+	pthread_mutex_t pushLock;
+
+	// frame queue, filled by the talkers and drained by the listener.
+	// One slot is always left empty.
+	U8 *pSlotMem;
+	U32 *pSlotLen;
+	U32 slotCount;
+	U32 slotSize;
+
+	// queue indexes on separate cache lines; the talkers own
+	// head and the listener owns tail
+	U8 pad0[OPENAVB_CACHE_LINE_SIZE];
+	U32 head;
+	U8 pad1[OPENAVB_CACHE_LINE_SIZE - sizeof(U32)];
+	U32 tail;
+	U8 pad2[OPENAVB_CACHE_LINE_SIZE - sizeof(U32)];
+
+	// frames dropped because our queue was full
+	unsigned long rxDropped;
+
+	// On impaired wires, when each queued frame is due and when the last
+	// one queued is due; frames are never due before the one ahead of them
+	U64 *pSlotDueNS;
+	U64 lastDueNS;
+	// impairment random state, seeded from the wire and our key
+	U32 rndState;
+	// frames dropped by the wire's loss impairment
+	unsigned long rxLost;
+} loop_rawsock_t;
+
+// Fill in made-up interface info for a loop wire
+bool loopAvbCheckInterface(const char *ifname, if_info_t *info);
+
+// Delay frames on the wire called ifname by delayUsec plus up to jitterUsec,
+// and drop lossPpm in a million of them, independently for each listener.
+// The random choices repeat for the same seed. The wire is kept from then on.
+bool loopRawsockSetImpairment(const char *ifname, U32 delayUsec, U32 jitterUsec, U32 lossPpm, U32 seed);
+
+// Open a rawsock on the in-process wire called ifname
+void* loopRawsockOpen(loop_rawsock_t *rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames);
+
+// Close the rawsock, and release the wire once its last user is gone
+void loopRawsockClose(void *pvRawsock);
+
+// Get the eventfd used for this rawsock; can be used for poll/select
+int loopRawsockGetSocket(void *pvRawsock);
+
+// Get a buffer to use for TX
+U8* loopRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len);
+
+// Release a TX frame, without sending it
+bool loopRawsockRelTxFrame(void *pvRawsock, U8 *pBuffer);
+
+// Deliver a TX frame to the listeners on the wire
+bool loopRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64 timeNsec);
+
+// Frames are delivered as soon as they are ready; nothing to do
+int loopRawsockSend(void *pvRawsock);
+
+// Accept (and ignore) the firewall mark
+bool loopRawsockTxSetMark(void *pvRawsock, int mark);
+
+// Count used TX buffers
+int loopRawsockTxBufLevel(void *pvRawsock);
+
+// Get a RX frame
+U8* loopRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len);
+
+// Release a RX frame held by the client
+bool loopRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer);
+
+// Setup the rawsock to receive multicast packets
+bool loopRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN]);
+
+// Deliver only frames of the given stream to this rawsock
+bool loopRawsockRxStreamID(void *pvRawsock, const U8 streamID[8]);
+
+// Count used RX buffers in our queue
+int loopRawsockRxBufLevel(void *pvRawsock);
+
+#endif
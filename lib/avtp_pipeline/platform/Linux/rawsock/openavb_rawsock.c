@@ -32,6 +32,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <malloc.h>
 #include "simple_rawsock.h"
 #include "ring_rawsock.h"
+#include "shared_rawsock.h"
+#include "loop_rawsock.h"
 
 #if AVB_FEATURE_IGB
 #include "igb_rawsock.h"
@@ -44,6 +46,10 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "pcap_rawsock.h"
 #endif
 
+#if AVB_FEATURE_XDP
+#include "xdp_rawsock.h"
+#endif
+
 #include "openavb_trace.h"
 
 #define	AVB_LOG_COMPONENT	"Raw Socket"
@@ -65,7 +71,29 @@ bool openavbCheckInterface(const char *ifname_uri, if_info_t *info)
 
 	AVB_LOGF_DEBUG("%s ifname_uri %s ifname %s proto %s", __func__, ifname_uri, ifname, proto);
 
-	bool ret = simpleAvbCheckInterface(ifname, info);
+	bool ret;
+	if (strcmp(proto, "loop") == 0) {
+		// In-process wire; there is no network device to look at
+		ret = loopAvbCheckInterface(ifname, info);
+	}
+#if AVB_FEATURE_PCAP
+	else if (strcmp(proto, "pcap") == 0) {
+		// May be capture files rather than a network device
+		ret = pcapAvbCheckInterface(ifname, info);
+	}
+#endif
+	else if (strcmp(proto, "shared") == 0) {
+		// Drop the lane count, if any
+		char devname[IF_NAMESIZE] = {0};
+		strncpy(devname, ifname, sizeof(devname) - 1);
+		char *at = strchr(devname, '@');
+		if (at)
+			*at = '\0';
+		ret = simpleAvbCheckInterface(devname, info);
+	}
+	else {
+		ret = simpleAvbCheckInterface(ifname, info);
+	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
 	return ret;
@@ -79,9 +107,11 @@ void *openavbRawsockOpen(const char *ifname_uri, bool rx_mode, bool tx_mode, U16
 	const char* ifname = ifname_uri;
 	char proto[IF_NAMESIZE] = DEFAULT_PROTO;
 	char *colon = strchr(ifname_uri, ':');
-	if (colon) {
+	if (colon && colon - ifname_uri < IF_NAMESIZE) {
 		ifname = colon + 1;
 		strncpy(proto, ifname_uri, colon - ifname_uri);
+		// DEFAULT_PROTO may be longer than the one given
+		proto[colon - ifname_uri] = '\0';
 	}
 
 	AVB_LOGF_DEBUG("%s ifname_uri %s ifname %s proto %s", __func__, ifname_uri, ifname, proto);
@@ -102,6 +132,34 @@ void *openavbRawsockOpen(const char *ifname_uri, bool rx_mode, bool tx_mode, U16
 		// call constructor
 		pvRawsock = ringRawsockOpen(rawsock, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
 
+	} else if (strcmp(proto, "shared") == 0) {
+
+		AVB_LOG_INFO("Using *shared* RX implementation");
+
+		// allocate memory for rawsock object
+		shared_rawsock_t *rawsock = calloc(1, sizeof(shared_rawsock_t));
+		if (!rawsock) {
+			AVB_LOG_ERROR("Creating rawsock; malloc failed");
+			return NULL;
+		}
+
+		// call constructor
+		pvRawsock = sharedRawsockOpen(rawsock, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
+	} else if (strcmp(proto, "loop") == 0) {
+
+		AVB_LOG_INFO("Using *loop* implementation");
+
+		// allocate memory for rawsock object
+		loop_rawsock_t *rawsock = calloc(1, sizeof(loop_rawsock_t));
+		if (!rawsock) {
+			AVB_LOG_ERROR("Creating rawsock; malloc failed");
+			return NULL;
+		}
+
+		// call constructor
+		pvRawsock = loopRawsockOpen(rawsock, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
 	} else if (strcmp(proto, "simple") == 0) {
 
 		AVB_LOG_INFO("Using *simple* implementation");
@@ -115,6 +173,21 @@ void *openavbRawsockOpen(const char *ifname_uri, bool rx_mode, bool tx_mode, U16
 
 		// call constructor
 		pvRawsock = simpleRawsockOpen(rawsock, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
+#if AVB_FEATURE_XDP
+	} else if (strcmp(proto, "xdp") == 0) {
+
+		AVB_LOG_INFO("Using *xdp* implementation");
+
+		// allocate memory for rawsock object
+		xdp_rawsock_t *rawsock = calloc(1, sizeof(xdp_rawsock_t));
+		if (!rawsock) {
+			AVB_LOG_ERROR("Creating rawsock; malloc failed");
+			return NULL;
+		}
+
+		// call constructor
+		pvRawsock = xdpRawsockOpen(rawsock, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
+#endif
 #if AVB_FEATURE_PCAP
 	} else if (strcmp(proto, "pcap") == 0) {
 
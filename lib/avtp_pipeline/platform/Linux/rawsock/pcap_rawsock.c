@@ -30,7 +30,19 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 /*
  * Rawsock implemenation which uses libpcap for receiving and transmitting packets.
+ *
+ * Opened on "pcap:file" instead of a network device, it works on capture
+ * files: received frames are replayed from a pcap or pcapng file mapped into
+ * memory, and sent frames can be recorded to a pcapng file (which also works
+ * alongside a live device).
 */
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "pcap_rawsock.h"
 #include "simple_rawsock.h"
 #include "openavb_trace.h"
@@ -38,6 +50,58 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define	AVB_LOG_COMPONENT	"Raw Socket"
 #include "openavb_log.h"
 
+#define PCAP_ETHERTYPE_AVTP		0x22F0
+#define PCAP_LINKTYPE_ETHERNET	1
+
+// Classic pcap file and record headers
+#define PCAP_MAGIC_USEC			0xA1B2C3D4
+#define PCAP_MAGIC_NSEC			0xA1B23C4D
+#define PCAP_FILE_HDR_LEN		24
+#define PCAP_REC_HDR_LEN		16
+
+// pcapng block types and layout
+#define PCAPNG_BLOCK_SHB		0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB		0x00000001
+#define PCAPNG_BLOCK_SPB		0x00000003
+#define PCAPNG_BLOCK_EPB		0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC	0x1A2B3C4D
+#define PCAPNG_OPT_ENDOFOPT		0
+#define PCAPNG_OPT_IF_TSRESOL	9
+
+// Buffer for the recording stream
+#define PCAP_RECORD_BUFFER_SIZE	(1024 * 1024)
+
+// How long a replay that has run out of frames sleeps per call
+#define PCAP_REPLAY_IDLE_USEC	10000
+
+bool pcapAvbCheckInterface(const char *ifname, if_info_t *info)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	if (!ifname || !info) {
+		AVB_LOG_ERROR("Checking pcap interface; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	if (strcmp(ifname, PCAP_RAWSOCK_FILE_IFNAME) != 0) {
+		bool ret = simpleAvbCheckInterface(ifname, info);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return ret;
+	}
+
+	// Capture files have no device; make up a locally administered address
+	memset(info, 0, sizeof(if_info_t));
+	strncpy(info->name, ifname, IFNAMSIZ - 1);
+	info->mac.ether_addr_octet[0] = 0x02;
+	info->mac.ether_addr_octet[5] = 0x01;
+	info->index = 0;
+	info->mtu = ETH_DATA_LEN;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
 // Open a rawsock for TX or RX
 void *pcapRawsockOpen(pcap_rawsock_t* rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames)
 {
@@ -47,14 +111,16 @@ void *pcapRawsockOpen(pcap_rawsock_t* rawsock, const char *ifname, bool rx_mode,
 
 	baseRawsockOpen(&rawsock->base, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
 
-	if (tx_mode) {
+	bool bFile = strcmp(ifname, PCAP_RAWSOCK_FILE_IFNAME) == 0;
+
+	if (tx_mode && !bFile) {
 		AVB_LOG_DEBUG("pcap rawsock transmit mode will bypass FQTSS");
 	}
 
 	rawsock->handle = 0;
 
 	// Get info about the network device
-	if (!simpleAvbCheckInterface(ifname, &(rawsock->base.ifInfo))) {
+	if (!pcapAvbCheckInterface(ifname, &(rawsock->base.ifInfo))) {
 		AVB_LOGF_ERROR("Creating rawsock; bad interface name: %s", ifname);
 		free(rawsock);
 		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
@@ -73,13 +139,27 @@ void *pcapRawsockOpen(pcap_rawsock_t* rawsock, const char *ifname, bool rx_mode,
 		return NULL;
 	}
 
-	char errbuf[PCAP_ERRBUF_SIZE];
-	rawsock->handle = pcap_open_live(ifname, rawsock->base.frameSize, 1, 1, errbuf);
-	if (!rawsock->handle) {
-		AVB_LOGF_ERROR("Cannot open device %s: %s", ifname, errbuf);
-		free(rawsock);
-		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
-		return NULL;
+	if (bFile) {
+		// Frames come from rxReplay and go to txRecord
+		if (rx_mode) {
+			rawsock->pSlotMem = calloc(PCAP_RAWSOCK_REPLAY_SLOTS, rawsock->base.frameSize);
+			if (!rawsock->pSlotMem) {
+				AVB_LOG_ERROR("Creating rawsock; malloc failed");
+				free(rawsock);
+				AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+				return NULL;
+			}
+		}
+	}
+	else {
+		char errbuf[PCAP_ERRBUF_SIZE];
+		rawsock->handle = pcap_open_live(ifname, rawsock->base.frameSize, 1, 1, errbuf);
+		if (!rawsock->handle) {
+			AVB_LOGF_ERROR("Cannot open device %s: %s", ifname, errbuf);
+			free(rawsock);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
 	}
 
 	// fill virtual functions table
@@ -87,8 +167,15 @@ void *pcapRawsockOpen(pcap_rawsock_t* rawsock, const char *ifname, bool rx_mode,
 	cb->close = pcapRawsockClose;
 	cb->getTxFrame = pcapRawsockGetTxFrame;
 	cb->txFrameReady = pcapRawsockTxFrameReady;
+	cb->txRecord = pcapRawsockTxRecord;
 	cb->getRxFrame = pcapRawsockGetRxFrame;
 	cb->rxMulticast = pcapRawsockRxMulticast;
+	if (bFile) {
+		cb->getRxFrames = pcapRawsockGetRxFrames;
+		cb->relRxFrame = pcapRawsockRelRxFrame;
+		cb->rxStreamID = pcapRawsockRxStreamID;
+		cb->rxReplay = pcapRawsockRxReplay;
+	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
 	return rawsock;
@@ -99,7 +186,16 @@ void pcapRawsockClose(void *pvRawsock)
 	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
 
 	if (rawsock) {
-		pcap_close(rawsock->handle);
+		if (rawsock->handle) {
+			pcap_close(rawsock->handle);
+		}
+		if (rawsock->pFile) {
+			munmap(rawsock->pFile, rawsock->fileSize);
+		}
+		if (rawsock->pRecord) {
+			fclose(rawsock->pRecord);
+		}
+		free(rawsock->pSlotMem);
 	}
 
 	baseRawsockClose(rawsock);
@@ -117,16 +213,52 @@ U8 *pcapRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len)
 	return false;
 }
 
+// Append one frame to the recording as a pcapng enhanced packet block
+static void x_pcapRecord(pcap_rawsock_t *rawsock, U8 *pBuffer, U32 len, U64 timeNsec)
+{
+	U32 padLen = (4 - (len & 3)) & 3;
+	U32 hdr[7], trailer;
+	static const U8 pad[4] = { 0 };
+
+	if (!timeNsec) {
+		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &timeNsec);
+	}
+
+	hdr[0] = PCAPNG_BLOCK_EPB;
+	hdr[1] = trailer = sizeof(hdr) + len + padLen + sizeof(trailer);
+	hdr[2] = 0;	// interface
+	hdr[3] = timeNsec >> 32;
+	hdr[4] = timeNsec & 0xFFFFFFFF;
+	hdr[5] = len;
+	hdr[6] = len;
+
+	if (fwrite(hdr, sizeof(hdr), 1, rawsock->pRecord) != 1
+		|| fwrite(pBuffer, len, 1, rawsock->pRecord) != 1
+		|| fwrite(pad, padLen, 1, rawsock->pRecord) != (padLen ? 1 : 0)
+		|| fwrite(&trailer, sizeof(trailer), 1, rawsock->pRecord) != 1) {
+		IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Writing the recording failed");
+	}
+}
+
 bool pcapRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64 timeNsec)
 {
 	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
 	int ret = -1;
 
-	if (timeNsec) {
-		IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is unsupported in pcap_rawsock");
-	}
-
 	if (rawsock) {
+		if (rawsock->pRecord) {
+			x_pcapRecord(rawsock, pBuffer, len, timeNsec);
+		}
+
+		if (!rawsock->handle) {
+			// Capture file only
+			return rawsock->pRecord != NULL;
+		}
+
+		if (timeNsec) {
+			IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is unsupported in pcap_rawsock");
+		}
+
 		ret = pcap_sendpacket(rawsock->handle, pBuffer, len);
 		if (ret == -1) {
 			AVB_LOGF_ERROR("pcap_sendpacket failed: %s", pcap_geterr(rawsock->handle));
@@ -136,6 +268,43 @@ bool pcapRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64
 	return ret == 0;
 }
 
+bool pcapRawsockTxRecord(void *pvRawsock, const char *fileName)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || !fileName || rawsock->pRecord) {
+		AVB_LOG_ERROR("Recording; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	rawsock->pRecord = fopen(fileName, "wb");
+	if (!rawsock->pRecord) {
+		AVB_LOGF_ERROR("Unable to create %s: %s", fileName, strerror(errno));
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+	setvbuf(rawsock->pRecord, NULL, _IOFBF, PCAP_RECORD_BUFFER_SIZE);
+
+	// Section header, then one Ethernet interface with nanosecond timestamps
+	U32 shb[7] = { PCAPNG_BLOCK_SHB, sizeof(shb), PCAPNG_BYTE_ORDER_MAGIC, 1, 0xFFFFFFFF, 0xFFFFFFFF, sizeof(shb) };
+	U32 idb[8] = { PCAPNG_BLOCK_IDB, sizeof(idb), PCAP_LINKTYPE_ETHERNET, rawsock->base.frameSize,
+		PCAPNG_OPT_IF_TSRESOL | (1 << 16), 9, PCAPNG_OPT_ENDOFOPT, sizeof(idb) };
+	if (fwrite(shb, sizeof(shb), 1, rawsock->pRecord) != 1
+		|| fwrite(idb, sizeof(idb), 1, rawsock->pRecord) != 1) {
+		AVB_LOGF_ERROR("Unable to write %s: %s", fileName, strerror(errno));
+		fclose(rawsock->pRecord);
+		rawsock->pRecord = NULL;
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	AVB_LOGF_INFO("Recording sent frames to %s", fileName);
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
 U8 *pcapRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len)
 {
 	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
@@ -144,6 +313,14 @@ U8 *pcapRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, un
 	const u_char *packet = 0;
 	int ret;
 
+	if (rawsock && !rawsock->handle) {
+		U8 *pFrame = NULL;
+		if (pcapRawsockGetRxFrames(pvRawsock, timeout, &pFrame, offset, len, 1) == 1) {
+			return pFrame;
+		}
+		return NULL;
+	}
+
 	if (rawsock) {
 		ret = pcap_next_ex(rawsock->handle, &header, &packet);
 		switch(ret) {
@@ -174,6 +351,13 @@ bool pcapRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[
 {
 	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
 
+	if (!rawsock->handle) {
+		// Replay filters in software
+		rawsock->bRxDestAddr = add_membership;
+		memcpy(rawsock->rxDestAddr, addr, ETH_ALEN);
+		return true;
+	}
+
 	struct bpf_program comp_filter_exp;
 	char filter_exp[30];
 
@@ -193,3 +377,354 @@ bool pcapRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[
 
 	return true;
 }
+
+bool pcapRawsockRxStreamID(void *pvRawsock, const U8 streamID[8])
+{
+	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
+
+	memcpy(rawsock->rxStreamID, streamID, sizeof(rawsock->rxStreamID));
+	rawsock->bRxStreamID = TRUE;
+	return true;
+}
+
+// Read a 16 or 32 bit field of the capture file
+static inline U16 x_pcapRd16(pcap_rawsock_t *rawsock, size_t pos)
+{
+	U16 val;
+	memcpy(&val, rawsock->pFile + pos, sizeof(val));
+	return rawsock->bSwapped ? __builtin_bswap16(val) : val;
+}
+
+static inline U32 x_pcapRd32(pcap_rawsock_t *rawsock, size_t pos)
+{
+	U32 val;
+	memcpy(&val, rawsock->pFile + pos, sizeof(val));
+	return rawsock->bSwapped ? __builtin_bswap32(val) : val;
+}
+
+// Capture timestamp units of an interface to nanoseconds
+static inline U64 x_pcapTsToNS(pcap_rawsock_t *rawsock, U32 ifIdx, U64 units)
+{
+	if (rawsock->tsShift[ifIdx]) {
+		return (U64)(((unsigned __int128)units * NANOSECONDS_PER_SECOND) >> rawsock->tsShift[ifIdx]);
+	}
+	return units * rawsock->tsMul[ifIdx] / rawsock->tsDiv[ifIdx];
+}
+
+// Take up a pcapng interface description block
+static void x_pcapngIdb(pcap_rawsock_t *rawsock, size_t pos, U32 blockLen)
+{
+	U32 ifIdx = rawsock->nIfs++;
+	if (ifIdx >= PCAP_RAWSOCK_MAX_IFS)
+		return;
+
+	// Microseconds unless the block says otherwise; other link types are skipped
+	rawsock->tsMul[ifIdx] = x_pcapRd16(rawsock, pos + 8) == PCAP_LINKTYPE_ETHERNET ? 1000 : 0;
+	rawsock->tsDiv[ifIdx] = 1;
+	rawsock->tsShift[ifIdx] = 0;
+
+	size_t opt = pos + 16, end = pos + blockLen - 4;
+	while (opt + 4 <= end) {
+		U16 code = x_pcapRd16(rawsock, opt);
+		U16 len = x_pcapRd16(rawsock, opt + 2);
+		if (code == PCAPNG_OPT_ENDOFOPT || opt + 4 + len > end)
+			break;
+		if (code == PCAPNG_OPT_IF_TSRESOL && len >= 1 && rawsock->tsMul[ifIdx]) {
+			U8 resol = rawsock->pFile[opt + 4];
+			if (resol & 0x80) {
+				rawsock->tsShift[ifIdx] = resol & 0x7F;
+			}
+			else {
+				U64 scale = 1;
+				U8 i;
+				for (i = 0; i < (resol > 9 ? resol - 9 : 9 - resol) && i < 19; i++)
+					scale *= 10;
+				rawsock->tsMul[ifIdx] = resol > 9 ? 1 : scale;
+				rawsock->tsDiv[ifIdx] = resol > 9 ? scale : 1;
+			}
+		}
+		opt += 4 + ((len + 3) & ~3);
+	}
+}
+
+// Read the next Ethernet frame of the capture file.
+// Returns FALSE at the end of the file (or of its readable part).
+static bool x_pcapNextRecord(pcap_rawsock_t *rawsock, U8 **ppData, U32 *pLen, U64 *pCapNS)
+{
+	while (1) {
+		size_t pos = rawsock->filePos;
+
+		if (!rawsock->bPcapng) {
+			if (pos + PCAP_REC_HDR_LEN > rawsock->fileSize)
+				return FALSE;
+			U32 capLen = x_pcapRd32(rawsock, pos + 8);
+			if (pos + PCAP_REC_HDR_LEN + capLen > rawsock->fileSize)
+				return FALSE;
+			*pCapNS = (U64)x_pcapRd32(rawsock, pos) * NANOSECONDS_PER_SECOND + (U64)x_pcapRd32(rawsock, pos + 4) * rawsock->tsMul[0];
+			*ppData = rawsock->pFile + pos + PCAP_REC_HDR_LEN;
+			*pLen = capLen;
+			rawsock->filePos = pos + PCAP_REC_HDR_LEN + capLen;
+			return TRUE;
+		}
+
+		if (pos + 12 > rawsock->fileSize)
+			return FALSE;
+		U32 blockType;
+		memcpy(&blockType, rawsock->pFile + pos, sizeof(blockType));
+		if (blockType == PCAPNG_BLOCK_SHB) {
+			// New section, which may be in the other byte order
+			U32 magic;
+			memcpy(&magic, rawsock->pFile + pos + 8, sizeof(magic));
+			rawsock->bSwapped = magic != PCAPNG_BYTE_ORDER_MAGIC;
+			rawsock->nIfs = 0;
+		}
+		else {
+			blockType = x_pcapRd32(rawsock, pos);
+		}
+		U32 blockLen = x_pcapRd32(rawsock, pos + 4);
+		if (blockLen < 12 || (blockLen & 3) || pos + blockLen > rawsock->fileSize)
+			return FALSE;
+		rawsock->filePos = pos + blockLen;
+
+		if (blockType == PCAPNG_BLOCK_IDB && blockLen >= 20) {
+			x_pcapngIdb(rawsock, pos, blockLen);
+		}
+		else if (blockType == PCAPNG_BLOCK_EPB && blockLen >= 32) {
+			U32 ifIdx = x_pcapRd32(rawsock, pos + 8);
+			U32 capLen = x_pcapRd32(rawsock, pos + 20);
+			if (ifIdx >= rawsock->nIfs || ifIdx >= PCAP_RAWSOCK_MAX_IFS || !rawsock->tsMul[ifIdx] || 28 + capLen > blockLen - 4)
+				continue;
+			U64 units = ((U64)x_pcapRd32(rawsock, pos + 12) << 32) | x_pcapRd32(rawsock, pos + 16);
+			rawsock->lastCapNS = x_pcapTsToNS(rawsock, ifIdx, units);
+			*pCapNS = rawsock->lastCapNS;
+			*ppData = rawsock->pFile + pos + 28;
+			*pLen = capLen;
+			return TRUE;
+		}
+		else if (blockType == PCAPNG_BLOCK_SPB && blockLen >= 16) {
+			// No timestamp; take the one before
+			if (rawsock->nIfs == 0 || !rawsock->tsMul[0])
+				continue;
+			U32 capLen = x_pcapRd32(rawsock, pos + 8);
+			if (capLen > blockLen - 16)
+				capLen = blockLen - 16;
+			*pCapNS = rawsock->lastCapNS;
+			*ppData = rawsock->pFile + pos + 12;
+			*pLen = capLen;
+			return TRUE;
+		}
+	}
+}
+
+// Is the frame an AVTP frame the client asked for?
+static bool x_pcapWanted(pcap_rawsock_t *rawsock, const U8 *pFrame, U32 len)
+{
+	U32 hdrLen = ETH_HLEN;
+
+	if (len < ETH_HLEN + 12)
+		return FALSE;
+	U16 ethertype = (pFrame[12] << 8) | pFrame[13];
+	if (ethertype == ETHERTYPE_8021Q) {
+		hdrLen += VLAN_HLEN;
+		ethertype = (pFrame[16] << 8) | pFrame[17];
+	}
+	if (ethertype != PCAP_ETHERTYPE_AVTP || len < hdrLen + 12)
+		return FALSE;
+	if (rawsock->bRxDestAddr && memcmp(pFrame, rawsock->rxDestAddr, ETH_ALEN) != 0)
+		return FALSE;
+	// Stream data with the stream ID valid
+	if (rawsock->bRxStreamID
+		&& ((pFrame[hdrLen] & 0x80) || !(pFrame[hdrLen + 1] & 0x80)
+			|| memcmp(pFrame + hdrLen + 4, rawsock->rxStreamID, sizeof(rawsock->rxStreamID)) != 0))
+		return FALSE;
+	return TRUE;
+}
+
+// Make the next wanted frame pending, starting the next pass at the end of
+// the file. Returns FALSE once the replay is over.
+static bool x_pcapReplayNext(pcap_rawsock_t *rawsock)
+{
+	bool bAny = rawsock->bPassStarted;
+
+	while (!rawsock->bReplayDone) {
+		U8 *pData;
+		U32 len;
+		U64 capNS;
+
+		if (x_pcapNextRecord(rawsock, &pData, &len, &capNS)) {
+			if (x_pcapWanted(rawsock, pData, len)) {
+				rawsock->pPending = pData;
+				rawsock->pendingLen = len;
+				rawsock->pendingCapNS = capNS;
+				return TRUE;
+			}
+			continue;
+		}
+
+		rawsock->passes++;
+		if (!bAny || (rawsock->loops && rawsock->passes >= rawsock->loops)) {
+			AVB_LOGF_INFO("Replay finished after %u passes%s", rawsock->passes, bAny ? "" : "; no frames for this stream");
+			rawsock->bReplayDone = TRUE;
+			break;
+		}
+		rawsock->filePos = rawsock->fileStart;
+		rawsock->bPassStarted = FALSE;
+		bAny = FALSE;
+	}
+	return FALSE;
+}
+
+static void x_pcapSleepNS(U64 ns)
+{
+	struct timespec ts = { ns / NANOSECONDS_PER_SECOND, ns % NANOSECONDS_PER_SECOND };
+	nanosleep(&ts, NULL);
+}
+
+int pcapRawsockGetRxFrames(void *pvRawsock, U32 usecTimeout, U8 **pFrames, U32 *offsets, U32 *lens, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || !rawsock->pFile || pFrames == NULL || offsets == NULL || lens == NULL) {
+		IF_LOG_INTERVAL(1000) AVB_LOG_ERROR("Getting RX frames; no capture file to replay");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	U64 nowNS, endNS;
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	endNS = usecTimeout == (U32)OPENAVB_RAWSOCK_BLOCK ? UINT64_MAX : nowNS + (U64)usecTimeout * NANOSECONDS_PER_USEC;
+
+	U32 n = 0;
+	while (n < count) {
+		if (!rawsock->pPending && !x_pcapReplayNext(rawsock))
+			break;
+
+		if (!rawsock->bPassStarted) {
+			rawsock->passCapNS = rawsock->pendingCapNS;
+			rawsock->passStartNS = nowNS;
+			rawsock->bPassStarted = TRUE;
+		}
+
+		if (rawsock->speedPct) {
+			// When the frame is due at the requested pace
+			U64 dueNS = rawsock->passStartNS
+				+ (rawsock->pendingCapNS - rawsock->passCapNS) * 100 / rawsock->speedPct;
+			if (dueNS > nowNS) {
+				if (n > 0)
+					break;
+				if (dueNS > endNS) {
+					if (usecTimeout)
+						x_pcapSleepNS(endNS - nowNS);
+					AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+					return 0;
+				}
+				x_pcapSleepNS(dueNS - nowNS);
+				CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+			}
+		}
+
+		// Hand out a copy with the AVTP timestamp moved by how much later
+		// than its capture the frame is delivered, so the presentation
+		// margin is as captured
+		U8 *pSlot = rawsock->pSlotMem + (rawsock->nextSlot++ % PCAP_RAWSOCK_REPLAY_SLOTS) * rawsock->base.frameSize;
+		U32 len = rawsock->pendingLen < (U32)rawsock->base.frameSize ? rawsock->pendingLen : (U32)rawsock->base.frameSize;
+		memcpy(pSlot, rawsock->pPending, len);
+		U32 hdrLen = pSlot[12] == 0x81 && pSlot[13] == 0x00 ? ETH_HLEN + VLAN_HLEN : ETH_HLEN;
+		if (len >= hdrLen + 16 && (pSlot[hdrLen + 1] & 0x01)) {
+			U32 ts;
+			memcpy(&ts, pSlot + hdrLen + 12, sizeof(ts));
+			ts = htonl(ntohl(ts) + (U32)(nowNS - rawsock->pendingCapNS));
+			memcpy(pSlot + hdrLen + 12, &ts, sizeof(ts));
+		}
+		rawsock->pPending = NULL;
+
+		pFrames[n] = pSlot;
+		offsets[n] = 0;
+		lens[n] = len;
+		n++;
+	}
+
+	if (n == 0 && rawsock->bReplayDone && usecTimeout) {
+		// Nothing more will come; don't have the caller spin
+		U64 idleNS = (U64)PCAP_REPLAY_IDLE_USEC * NANOSECONDS_PER_USEC;
+		x_pcapSleepNS(endNS - nowNS < idleNS ? endNS - nowNS : idleNS);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return n;
+}
+
+bool pcapRawsockRelRxFrame(void *pvRawsock, U8 *pFrame)
+{
+	// Replay slots are reused in turn
+	return true;
+}
+
+bool pcapRawsockRxReplay(void *pvRawsock, const char *fileName, U32 speedPct, U32 loops)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	pcap_rawsock_t *rawsock = (pcap_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || !fileName || rawsock->pFile) {
+		AVB_LOG_ERROR("Replay; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	struct stat st;
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < PCAP_FILE_HDR_LEN) {
+		AVB_LOGF_ERROR("Unable to read capture file %s", fileName);
+		if (fd >= 0)
+			close(fd);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		AVB_LOGF_ERROR("Unable to map capture file %s: %s", fileName, strerror(errno));
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+	madvise(p, st.st_size, MADV_SEQUENTIAL);
+	rawsock->pFile = p;
+	rawsock->fileSize = st.st_size;
+
+	U32 magic;
+	memcpy(&magic, rawsock->pFile, sizeof(magic));
+	if (magic == PCAPNG_BLOCK_SHB) {
+		// Blocks, starting with the section header, are read as they come
+		rawsock->bPcapng = TRUE;
+		rawsock->fileStart = 0;
+	}
+	else {
+		rawsock->bSwapped = magic == __builtin_bswap32(PCAP_MAGIC_USEC) || magic == __builtin_bswap32(PCAP_MAGIC_NSEC);
+		magic = x_pcapRd32(rawsock, 0);
+		if ((magic != PCAP_MAGIC_USEC && magic != PCAP_MAGIC_NSEC)
+			|| (x_pcapRd32(rawsock, 20) & 0xFFFF) != PCAP_LINKTYPE_ETHERNET) {
+			AVB_LOGF_ERROR("%s is not an Ethernet pcap or pcapng capture", fileName);
+			munmap(rawsock->pFile, rawsock->fileSize);
+			rawsock->pFile = NULL;
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return FALSE;
+		}
+		rawsock->bPcapng = FALSE;
+		rawsock->fileStart = PCAP_FILE_HDR_LEN;
+		rawsock->tsMul[0] = magic == PCAP_MAGIC_NSEC ? 1 : 1000;
+		rawsock->tsDiv[0] = 1;
+	}
+	rawsock->filePos = rawsock->fileStart;
+	rawsock->speedPct = speedPct;
+	rawsock->loops = loops;
+
+	if (speedPct) {
+		AVB_LOGF_INFO("Replaying %s at %u%% of the captured rate, passes=%u", fileName, speedPct, loops);
+	}
+	else {
+		AVB_LOGF_INFO("Replaying %s as fast as frames are taken, passes=%u", fileName, loops);
+	}
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
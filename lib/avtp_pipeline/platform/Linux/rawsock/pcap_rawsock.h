@@ -34,10 +34,67 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "rawsock_impl.h"
 #include <pcap/pcap.h>
 
+#include <stdio.h>
+
+// Interface name that opens the pcap rawsock on capture files instead of a
+// network device ("pcap:file")
+#define PCAP_RAWSOCK_FILE_IFNAME	"file"
+
+// Interfaces of a pcapng section that replay keeps timestamp units for
+#define PCAP_RAWSOCK_MAX_IFS		8
+
+// Frames handed out by replay and not yet released; one more batch than
+// the client holds at once
+#define PCAP_RAWSOCK_REPLAY_SLOTS	(2 * OPENAVB_RAWSOCK_RX_BURST_MAX)
+
 typedef struct {
 	base_rawsock_t base;
 	pcap_t* handle;
 	U8 txBuffer[1518];
+
+	// Replay: the capture file, mapped read only
+	U8 *pFile;
+	size_t fileSize;
+	// Offset of the next record, and where the first one starts
+	size_t filePos;
+	size_t fileStart;
+	// pcapng, else classic pcap
+	bool bPcapng;
+	// Capture written in the other byte order
+	bool bSwapped;
+	// Timestamp units of classic pcap, or of each pcapng interface:
+	// ns = units * tsMul / tsDiv (tsShift instead of tsDiv for binary units)
+	U64 tsMul[PCAP_RAWSOCK_MAX_IFS];
+	U64 tsDiv[PCAP_RAWSOCK_MAX_IFS];
+	U8 tsShift[PCAP_RAWSOCK_MAX_IFS];
+	U32 nIfs;
+	// Capture time of the last record read (simple packet blocks have none)
+	U64 lastCapNS;
+	// Pacing, in percent of the capture rate; 0 for as fast as possible
+	U32 speedPct;
+	// Passes left over the file (0 for endless) and passes done
+	U32 loops;
+	U32 passes;
+	// Capture time of the first frame and local time it was delivered, per pass
+	U64 passCapNS;
+	U64 passStartNS;
+	bool bPassStarted;
+	bool bReplayDone;
+	// Frame the next call picks up, read but not yet due
+	U8 *pPending;
+	U32 pendingLen;
+	U64 pendingCapNS;
+	// Frames handed out, copied so the AVTP timestamps can be moved to now
+	U8 *pSlotMem;
+	U32 nextSlot;
+	// Filters the live handle gets from BPF
+	U8 rxDestAddr[ETH_ALEN];
+	bool bRxDestAddr;
+	U8 rxStreamID[8];
+	bool bRxStreamID;
+
+	// Recording of sent frames
+	FILE *pRecord;
 } pcap_rawsock_t;
 
 void *pcapRawsockOpen(pcap_rawsock_t* rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames);
@@ -52,4 +109,19 @@ U8 *pcapRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, un
 
 bool pcapRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN]);
 
+bool pcapRawsockRxStreamID(void *pvRawsock, const U8 streamID[8]);
+
+// Check the capture file interface name, filling in made-up interface info
+bool pcapAvbCheckInterface(const char *ifname, if_info_t *info);
+
+// Replay a pcap or pcapng capture file (rawsock opened on "pcap:file" only)
+bool pcapRawsockRxReplay(void *pvRawsock, const char *fileName, U32 speedPct, U32 loops);
+
+int pcapRawsockGetRxFrames(void *pvRawsock, U32 usecTimeout, U8 **pFrames, U32 *offsets, U32 *lens, U32 count);
+
+bool pcapRawsockRelRxFrame(void *pvRawsock, U8 *pFrame);
+
+// Record sent frames to a pcapng file
+bool pcapRawsockTxRecord(void *pvRawsock, const char *fileName);
+
 #endif
@@ -30,13 +30,17 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include "ring_rawsock.h"
 #include "simple_rawsock.h"
+#include "txtime_rawsock.h"
+#include "openavb_prefault.h"
 #include <linux/if_packet.h>
+#include <poll.h>
 
 #include "openavb_trace.h"
 
 #define	AVB_LOG_COMPONENT	"Raw Socket"
 #include "openavb_log.h"
 
+static int x_ringSend(ring_rawsock_t *rawsock, U64 txtime);
 
 // Open a rawsock for TX or RX
 void* ringRawsockOpen(ring_rawsock_t *rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames)
@@ -158,13 +162,22 @@ void* ringRawsockOpen(ring_rawsock_t *rawsock, const char *ifname, bool rx_mode,
 	cb->relTxFrame = ringRawsockRelTxFrame;
 	cb->txFrameReady = ringRawsockTxFrameReady;
 	cb->send = ringRawsockSend;
+	cb->getTxFrames = ringRawsockGetTxFrames;
+	cb->txFramesSend = ringRawsockTxFramesSend;
+	cb->txSetLaunchTime = ringRawsockTxSetLaunchTime;
+	// Frames leave through the TX ring, not with a control message
+	cb->txTimestampNext = baseRawsockTxTimestampNext;
+	cb->txTimestampGet = baseRawsockTxTimestampGet;
 	cb->txBufLevel = ringRawsockTxBufLevel;
 	cb->rxBufLevel = ringRawsockRxBufLevel;
 	cb->getRxFrame = ringRawsockGetRxFrame;
 	cb->rxParseHdr = ringRawsockRxParseHdr;
 	cb->relRxFrame = ringRawsockRelRxFrame;
+	cb->getRxFrames = ringRawsockGetRxFrames;
+	cb->rxSetBlockTimeout = ringRawsockRxSetBlockTimeout;
 	cb->getTXOutOfBuffers = ringRawsockGetTXOutOfBuffers;
 	cb->getTXOutOfBuffersCyclic = ringRawsockGetTXOutOfBuffersCyclic;
+	cb->prefault = ringRawsockPrefault;
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
 	return rawsock;
@@ -182,6 +195,8 @@ void ringRawsockClose(void *pvRawsock)
 			munmap(rawsock->pMem, rawsock->memSize);
 			rawsock->pMem = (void*)(-1);
 		}
+		free(rawsock->pBlockOut);
+		rawsock->pBlockOut = NULL;
 	}
 
 	simpleRawsockClose(pvRawsock);
@@ -189,6 +204,30 @@ void ringRawsockClose(void *pvRawsock)
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
 }
 
+// Send frames with their launch time, using SO_TXTIME
+bool ringRawsockTxSetLaunchTime(void *pvRawsock, bool enable)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	ring_rawsock_t *rawsock = (ring_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Setting launch time; invalid argument passed");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	// SO_TXTIME can't be turned off again; we just stop passing times
+	if (enable && !rawsock->bTxTime) {
+		rawsock->bTxTime = txtimeRawsockEnable(rawsock->sock);
+	}
+	else if (!enable) {
+		rawsock->bTxTime = FALSE;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock->bTxTime == enable;
+}
+
 // Get a buffer from the ring to use for TX
 U8* ringRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len)
 {
@@ -335,8 +374,8 @@ bool ringRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64
 		return FALSE;
 	}
 
-	if (timeNsec) {
-		IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is unsupported in ring_rawsock");
+	if (timeNsec && !rawsock->bTxTime) {
+		IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is not enabled in ring_rawsock");
 	}
 
 
@@ -344,11 +383,22 @@ bool ringRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64
 	AVB_LOGF_VERBOSE("pBuffer=%p, pHdr=%p szFrame=%d, len=%d", pBuffer, pHdr, rawsock->base.frameSize, len);
 
 	assert(len <= rawsock->bufferSize);
+	if (rawsock->pShaper)
+		cbsRawsockTxWait(rawsock->pShaper, rawsock->txMark, len);
 	pHdr->tp_len = len;
 	pHdr->tp_status = TP_STATUS_SEND_REQUEST;
 	rawsock->buffersReady += 1;
 
-	if (rawsock->buffersReady >= rawsock->frameCount) {
+	if (rawsock->bTxTime && timeNsec) {
+		// The launch time applies to the whole send, so the frame
+		// goes out on its own right away
+		x_ringSend(rawsock, timeNsec + txtimeRawsockTaiOffset());
+	}
+	else if (rawsock->pShaper) {
+		// Sent when the shaper lets it go, not with the next batch
+		x_ringSend(rawsock, 0);
+	}
+	else if (rawsock->buffersReady >= rawsock->frameCount) {
 		AVB_LOG_WARNING("All buffers in ready/unsent state, calling send");
 		ringRawsockSend(pvRawsock);
 	}
@@ -368,10 +418,30 @@ int ringRawsockSend(void *pvRawsock)
 		return -1;
 	}
 
+	int sent = x_ringSend(rawsock, 0);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return sent;
+}
+
+// Have the kernel send the ready packets; a non-zero txtime (CLOCK_TAI)
+// is passed as their launch time
+static int x_ringSend(ring_rawsock_t *rawsock, U64 txtime)
+{
 	// Linux does something dumb to wait for frames to be sent.
 	// Without MSG_DONTWAIT, CPU usage is bad.
 	int flags = MSG_DONTWAIT;
-	int sent = send(rawsock->sock, NULL, 0, flags);
+	int sent;
+	if (txtime) {
+		U8 cbuf[TXTIME_CMSG_SPACE];
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		txtimeRawsockSetCmsg(&msg, cbuf, txtime);
+		sent = sendmsg(rawsock->sock, &msg, flags);
+	}
+	else {
+		sent = send(rawsock->sock, NULL, 0, flags);
+	}
 	if (errno == EINTR) {
 		// ignore
 	}
@@ -385,10 +455,87 @@ int ringRawsockSend(void *pvRawsock)
 		rawsock->buffersReady = 0;
 	}
 
-	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
 	return sent;
 }
 
+// Get a burst of consecutive buffers from the ring to use for TX
+int ringRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	ring_rawsock_t *rawsock = (ring_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || len == NULL) {
+		AVB_LOG_ERROR("Getting TX frames; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	// Only wait for the first buffer; hand back whatever else is free.
+	U32 i;
+	for (i = 0; i < count && rawsock->buffersOut < rawsock->frameCount; i++) {
+		pFrames[i] = ringRawsockGetTxFrame(pvRawsock, blocking && i == 0, len);
+		if (!pFrames[i])
+			break;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return i;
+}
+
+// Mark a burst of TX frames ready and hand them to the kernel with one send()
+int ringRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	ring_rawsock_t *rawsock = (ring_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || lens == NULL) {
+		AVB_LOG_ERROR("Sending TX frames; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	if ((rawsock->bTxTime && timeNsec) || rawsock->pShaper) {
+		// One send per frame, each carrying its own launch time or
+		// let go by the shaper
+		bool bLaunch = rawsock->bTxTime && timeNsec;
+		S64 taiOffset = bLaunch ? txtimeRawsockTaiOffset() : 0;
+		U32 i;
+		for (i = 0; i < count; i++) {
+			volatile struct tpacket2_hdr *pHdr = (struct tpacket2_hdr*)(pFrames[i] - rawsock->bufHdrSize);
+			assert(lens[i] <= rawsock->bufferSize);
+			if (rawsock->pShaper)
+				cbsRawsockTxWait(rawsock->pShaper, rawsock->txMark, lens[i]);
+			pHdr->tp_len = lens[i];
+			pHdr->tp_status = TP_STATUS_SEND_REQUEST;
+			rawsock->buffersReady += 1;
+			x_ringSend(rawsock, (bLaunch && timeNsec[i]) ? timeNsec[i] + taiOffset : 0);
+		}
+
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return count;
+	}
+
+	U32 i;
+	for (i = 0; i < count; i++) {
+		if (timeNsec && timeNsec[i]) {
+			IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is not enabled in ring_rawsock");
+		}
+
+		volatile struct tpacket2_hdr *pHdr = (struct tpacket2_hdr*)(pFrames[i] - rawsock->bufHdrSize);
+		assert(lens[i] <= rawsock->bufferSize);
+		pHdr->tp_len = lens[i];
+		pHdr->tp_status = TP_STATUS_SEND_REQUEST;
+	}
+	rawsock->buffersReady += count;
+
+	// Frames left pending by a failed send go out with the next one
+	if (count > 0)
+		ringRawsockSend(pvRawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return count;
+}
+
 // Count used TX buffers in ring
 int ringRawsockTxBufLevel(void *pvRawsock)
 {
@@ -443,6 +590,16 @@ int ringRawsockRxBufLevel(void *pvRawsock)
 		return FALSE;
 	}
 
+	if (rawsock->bBlockMode) {
+		for (iBlock = 0; iBlock < rawsock->blockCount; iBlock++) {
+			struct tpacket_block_desc *pBlock = (struct tpacket_block_desc*)(rawsock->pMem + (iBlock * rawsock->blockSize));
+			if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&pBlock->hdr.bh1.block_status) & TP_STATUS_USER)
+				nInUse += pBlock->hdr.bh1.num_pkts;
+		}
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return nInUse;
+	}
+
 	for (iBlock = 0; iBlock < rawsock->blockCount; iBlock++) {
 		for (iBuffer = 0; iBuffer < buffersPerBlock; iBuffer++) {
 
@@ -461,6 +618,101 @@ int ringRawsockRxBufLevel(void *pvRawsock)
 	return nInUse;
 }
 
+// Hand a TPACKET_V3 block back to the kernel
+static void x_ringBlockRelease(ring_rawsock_t *rawsock, int iBlock)
+{
+	struct tpacket_block_desc *pBlock = (struct tpacket_block_desc*)(rawsock->pMem + (iBlock * rawsock->blockSize));
+	OPENAVB_ATOMIC_STORE_RELEASE(&pBlock->hdr.bh1.block_status, TP_STATUS_KERNEL);
+}
+
+// Get RX frames from the TPACKET_V3 ring; all frames come from the same block
+static int x_ringBlockGetRxFrames(ring_rawsock_t *rawsock, U32 timeout, U8 **pFrames, unsigned int *offsets, unsigned int *lens, U32 count)
+{
+	if (rawsock->rxBlockLeft == 0) {
+		struct tpacket_block_desc *pBlock =
+			(struct tpacket_block_desc*)(rawsock->pMem + (rawsock->blockIndex * rawsock->blockSize));
+
+		if (rawsock->pBlockOut[rawsock->blockIndex] > 0) {
+			// The client still holds frames from a full turn of the ring
+			AVB_LOG_ERROR("Too many RX buffers in use");
+			return 0;
+		}
+
+		if ((OPENAVB_ATOMIC_LOAD_ACQUIRE(&pBlock->hdr.bh1.block_status) & TP_STATUS_USER) == 0) {
+			struct timespec ts, *pts = NULL;
+			struct pollfd pfd;
+
+			if (timeout != OPENAVB_RAWSOCK_BLOCK) {
+				ts.tv_sec = timeout / MICROSECONDS_PER_SECOND;
+				ts.tv_nsec = (timeout % MICROSECONDS_PER_SECOND) * NANOSECONDS_PER_USEC;
+				pts = &ts;
+			}
+
+			pfd.fd = rawsock->sock;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+
+			int ret = ppoll(&pfd, 1, pts, NULL);
+			if (ret < 0) {
+				if (errno != EINTR) {
+					AVB_LOGF_ERROR("Getting RX frame; poll failed: %s", strerror(errno));
+				}
+				return 0;
+			}
+			if ((OPENAVB_ATOMIC_LOAD_ACQUIRE(&pBlock->hdr.bh1.block_status) & TP_STATUS_USER) == 0) {
+				// timeout
+				return 0;
+			}
+		}
+
+		// Check the "losing" flag.  That indicates that the ring is full,
+		// and the kernel had to toss some frames.
+		if (pBlock->hdr.bh1.block_status & TP_STATUS_LOSING) {
+			if (!rawsock->bLosing) {
+				AVB_LOG_WARNING("Getting RX frame; mmap buffers full");
+				rawsock->bLosing = TRUE;
+			}
+		}
+		else {
+			rawsock->bLosing = FALSE;
+		}
+
+		rawsock->rxBlock = rawsock->blockIndex;
+		rawsock->rxBlockLeft = pBlock->hdr.bh1.num_pkts;
+		rawsock->pRxNext = (U8*)pBlock + pBlock->hdr.bh1.offset_to_first_pkt;
+		if (++(rawsock->blockIndex) >= rawsock->blockCount) {
+			rawsock->blockIndex = 0;
+		}
+		AVB_LOGF_VERBOSE("block=%d, frames=%u", rawsock->rxBlock, rawsock->rxBlockLeft);
+	}
+
+	U32 n = 0;
+	while (n < count && rawsock->rxBlockLeft > 0) {
+		struct tpacket3_hdr *pHdr = (struct tpacket3_hdr*)rawsock->pRxNext;
+		rawsock->pRxNext += pHdr->tp_next_offset;
+		rawsock->rxBlockLeft--;
+
+		if (pHdr->tp_snaplen < pHdr->tp_len) {
+			IF_LOG_INTERVAL(1000) AVB_LOGF_WARNING("Getting RX frame; partial frame ignored (len %d, snaplen %d)", pHdr->tp_len, pHdr->tp_snaplen);
+			continue;
+		}
+
+		// The frame buffer is the packet header; the frame follows at tp_mac
+		pFrames[n] = (U8*)pHdr;
+		offsets[n] = pHdr->tp_mac;
+		lens[n] = pHdr->tp_snaplen;
+		n++;
+	}
+	rawsock->pBlockOut[rawsock->rxBlock] += n;
+	rawsock->buffersOut += n;
+
+	if (rawsock->rxBlockLeft == 0 && rawsock->pBlockOut[rawsock->rxBlock] == 0) {
+		x_ringBlockRelease(rawsock, rawsock->rxBlock);
+	}
+
+	return n;
+}
+
 // Get a RX frame
 U8* ringRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len)
 {
@@ -471,6 +723,12 @@ U8* ringRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, un
 		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
 		return NULL;
 	}
+	if (rawsock->bBlockMode) {
+		U8 *pBuffer = NULL;
+		x_ringBlockGetRxFrames(rawsock, timeout, &pBuffer, offset, len, 1);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return pBuffer;
+	}
 	if (rawsock->buffersOut >= rawsock->frameCount) {
 		AVB_LOG_ERROR("Too many RX buffers in use");
 		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
@@ -626,6 +884,28 @@ int ringRawsockRxParseHdr(void *pvRawsock, U8 *pBuffer, hdr_info_t *pInfo)
 		return -1;
 	}
 
+	if (rawsock->bBlockMode) {
+		struct tpacket3_hdr *pHdr3 = (struct tpacket3_hdr*)pBuffer;
+		memset(pInfo, 0, sizeof(hdr_info_t));
+
+		eth_hdr_t *pNoTag = (eth_hdr_t*)(pBuffer + pHdr3->tp_mac);
+		hdrLen = pHdr3->tp_net - pHdr3->tp_mac;
+		pInfo->shost = pNoTag->shost;
+		pInfo->dhost = pNoTag->dhost;
+		pInfo->ethertype = ntohs(pNoTag->ethertype);
+
+		if (pInfo->ethertype == ETHERTYPE_8021Q) {
+			pInfo->vlan = TRUE;
+			pInfo->vlan_vid = pHdr3->hv1.tp_vlan_tci & 0x0FFF;
+			pInfo->vlan_pcp = (pHdr3->hv1.tp_vlan_tci >> 13) & 0x0007;
+			pInfo->ethertype = ntohs(*(U16*)( ((U8*)(&pNoTag->ethertype)) + 4));
+			hdrLen += 4;
+		}
+
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return hdrLen;
+	}
+
 	volatile struct tpacket2_hdr *pHdr = (struct tpacket2_hdr*)(pBuffer - rawsock->bufHdrSize);
 	AVB_LOGF_VERBOSE("pBuffer=%p, pHdr=%p", pBuffer, pHdr);
 
@@ -661,6 +941,22 @@ bool ringRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer)
 		return FALSE;
 	}
 
+	if (rawsock->bBlockMode) {
+		int iBlock = (pBuffer - rawsock->pMem) / rawsock->blockSize;
+		if (pBuffer < rawsock->pMem || iBlock >= rawsock->blockCount || rawsock->pBlockOut[iBlock] == 0) {
+			AVB_LOG_ERROR("Releasing RX frame; not a held frame");
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return FALSE;
+		}
+		rawsock->buffersOut -= 1;
+		if (--rawsock->pBlockOut[iBlock] == 0
+			&& !(iBlock == rawsock->rxBlock && rawsock->rxBlockLeft > 0)) {
+			x_ringBlockRelease(rawsock, iBlock);
+		}
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return TRUE;
+	}
+
 	volatile struct tpacket2_hdr *pHdr = (struct tpacket2_hdr*)(pBuffer - rawsock->bufHdrSize);
 	AVB_LOGF_VERBOSE("pBuffer=%p, pHdr=%p", pBuffer, pHdr);
 
@@ -699,3 +995,146 @@ unsigned long ringRawsockGetTXOutOfBuffersCyclic(void *pvRawsock)
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
 	return counter;
 }
+
+// The ring is shared with the kernel, which may be filling RX frames, so its
+// pages are only read.
+size_t ringRawsockPrefault(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	ring_rawsock_t *rawsock = (ring_rawsock_t*)pvRawsock;
+	size_t bytes = 0;
+
+	if (VALID_RAWSOCK(rawsock)) {
+		bytes = openavbPrefault(rawsock->pMem, rawsock->memSize, FALSE);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return bytes;
+}
+
+// Get up to count RX frames; in block mode a whole block can be handed out at once
+int ringRawsockGetRxFrames(void *pvRawsock, U32 timeout, U8 **pFrames, unsigned int *offsets, unsigned int *lens, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	ring_rawsock_t *rawsock = (ring_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || pFrames == NULL || offsets == NULL || lens == NULL) {
+		AVB_LOG_ERROR("Getting RX frames; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	int ret;
+	if (rawsock->bBlockMode) {
+		ret = x_ringBlockGetRxFrames(rawsock, timeout, pFrames, offsets, lens, count);
+	}
+	else {
+		ret = baseRawsockGetRxFrames(pvRawsock, timeout, pFrames, offsets, lens, count);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
+// Create the RX ring with the given TPACKET version and map it
+static bool x_ringCreateRxRing(ring_rawsock_t *rawsock, int version, U32 usecTimeout)
+{
+	int val = version;
+	if (setsockopt(rawsock->sock, SOL_PACKET, PACKET_VERSION, &val, sizeof(val)) < 0) {
+		AVB_LOGF_ERROR("Setting PACKET_VERSION %d: %s", version, strerror(errno));
+		return FALSE;
+	}
+
+	struct tpacket_req3 s_packet_req;
+	memset(&s_packet_req, 0, sizeof(s_packet_req));
+	s_packet_req.tp_block_size = rawsock->blockSize;
+	s_packet_req.tp_frame_size = rawsock->bufferSize;
+	s_packet_req.tp_block_nr = rawsock->blockCount;
+	s_packet_req.tp_frame_nr = rawsock->frameCount;
+	if (version == TPACKET_V3) {
+		// The kernel counts the retire timeout in msec
+		s_packet_req.tp_retire_blk_tov = (usecTimeout + MICROSECONDS_PER_MSEC - 1) / MICROSECONDS_PER_MSEC;
+		if (s_packet_req.tp_retire_blk_tov == 0)
+			s_packet_req.tp_retire_blk_tov = 1;
+	}
+
+	if (setsockopt(rawsock->sock, SOL_PACKET, PACKET_RX_RING,
+				   (char*)&s_packet_req, version == TPACKET_V3 ? sizeof(struct tpacket_req3) : sizeof(struct tpacket_req)) < 0) {
+		AVB_LOGF_ERROR("Creating rawsock, RX_RING: %s", strerror(errno));
+		return FALSE;
+	}
+
+	rawsock->pMem = mmap((void*)0, rawsock->memSize, PROT_READ|PROT_WRITE, MAP_SHARED, rawsock->sock, (off_t)0);
+	if (rawsock->pMem == (void*)(-1)) {
+		AVB_LOGF_ERROR("Creating rawsock; MMAP: %s", strerror(errno));
+		return FALSE;
+	}
+	AVB_LOGF_DEBUG("TPACKET_V%d RX ring: %d blocks of %d, retire %u msec", version + 1,
+				   rawsock->blockCount, rawsock->blockSize, s_packet_req.tp_retire_blk_tov);
+	return TRUE;
+}
+
+// Drop the RX ring so it can be created again
+static void x_ringDestroyRxRing(ring_rawsock_t *rawsock)
+{
+	if (rawsock->pMem != (void*)(-1)) {
+		munmap(rawsock->pMem, rawsock->memSize);
+		rawsock->pMem = (void*)(-1);
+	}
+	struct tpacket_req s_packet_req;
+	memset(&s_packet_req, 0, sizeof(s_packet_req));
+	setsockopt(rawsock->sock, SOL_PACKET, PACKET_RX_RING, (char*)&s_packet_req, sizeof(s_packet_req));
+}
+
+// Switch the RX ring to TPACKET_V3 blocks retired after usecTimeout
+bool ringRawsockRxSetBlockTimeout(void *pvRawsock, U32 usecTimeout)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	ring_rawsock_t *rawsock = (ring_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || rawsock->base.txMode || rawsock->buffersOut) {
+		AVB_LOG_ERROR("Setting RX block timeout; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+	if (rawsock->bBlockMode) {
+		AVB_LOG_ERROR("Setting RX block timeout; already in block mode");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	rawsock->pBlockOut = calloc(rawsock->blockCount, sizeof(U32));
+	if (!rawsock->pBlockOut) {
+		AVB_LOG_ERROR("Setting RX block timeout; malloc failed");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	// The version can only be changed while there is no ring
+	x_ringDestroyRxRing(rawsock);
+	if (!x_ringCreateRxRing(rawsock, TPACKET_V3, usecTimeout)) {
+		// Go back to frame by frame receive
+		free(rawsock->pBlockOut);
+		rawsock->pBlockOut = NULL;
+		x_ringDestroyRxRing(rawsock);
+		if (!x_ringCreateRxRing(rawsock, TPACKET_V2, 0)) {
+			AVB_LOG_ERROR("Setting RX block timeout; RX ring lost");
+		}
+		else {
+			memset(rawsock->pMem, 0, rawsock->memSize);
+		}
+		rawsock->blockIndex = 0;
+		rawsock->bufferIndex = 0;
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	rawsock->bBlockMode = TRUE;
+	rawsock->blockIndex = 0;
+	rawsock->rxBlock = 0;
+	rawsock->rxBlockLeft = 0;
+	rawsock->pRxNext = NULL;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
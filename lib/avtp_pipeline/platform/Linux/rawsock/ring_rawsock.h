@@ -32,6 +32,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define RING_RAWSOCK_H
 
 #include "rawsock_impl.h"
+#include "cbs_rawsock.h"
 
 // State information for raw socket
 //
@@ -41,6 +42,10 @@ typedef struct {
 	// the underlying socket
 	int sock;
 
+	// software shaper and fwmark, as in simple_rawsock_t
+	cbs_rawsock_t *pShaper;
+	U16 txMark;
+
 	// number of frames that the ring can hold
 	int frameCount;
 
@@ -69,6 +74,20 @@ typedef struct {
 	// Are we losing RX packets?
 	bool bLosing;
 
+	// Send frames with their launch time (SO_TXTIME)
+	bool bTxTime;
+
+	// RX ring uses TPACKET_V3 blocks (see ringRawsockRxSetBlockTimeout)
+	bool bBlockMode;
+	// Block whose frames are being handed out, how many of them are left,
+	// and the next one. blockIndex is the next block to wait for.
+	int rxBlock;
+	U32 rxBlockLeft;
+	U8 *pRxNext;
+	// Frames held by the client, per block. A block goes back to the
+	// kernel once all its frames have been handed out and released.
+	U32 *pBlockOut;
+
 	// Number of TX buffers we experienced problems with
 	unsigned long txOutOfBuffer;
 	// Number of TX buffers we experienced problems with from the time when last stats being displayed
@@ -81,6 +100,9 @@ void* ringRawsockOpen(ring_rawsock_t *rawsock, const char *ifname, bool rx_mode,
 // Close the rawsock
 void ringRawsockClose(void *pvRawsock);
 
+// Send frames with their launch time, using SO_TXTIME
+bool ringRawsockTxSetLaunchTime(void *pvRawsock, bool enable);
+
 // Get a buffer from the ring to use for TX
 U8* ringRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len);
 
@@ -93,6 +115,12 @@ bool ringRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64
 // Send all packets that are ready (i.e. tell kernel to send them)
 int ringRawsockSend(void *pvRawsock);
 
+// Get a burst of buffers from the ring to use for TX
+int ringRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len);
+
+// Mark a burst of TX frames ready and send them with a single syscall
+int ringRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count);
+
 // Count used TX buffers in ring
 int ringRawsockTxBufLevel(void *pvRawsock);
 
@@ -108,8 +136,16 @@ int ringRawsockRxParseHdr(void *pvRawsock, U8 *pBuffer, hdr_info_t *pInfo);
 // Release a RX frame held by the client
 bool ringRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer);
 
+// Get up to count RX frames; in block mode a whole block can be handed out at once
+int ringRawsockGetRxFrames(void *pvRawsock, U32 timeout, U8 **pFrames, unsigned int *offsets, unsigned int *lens, U32 count);
+
+// Switch the RX ring to TPACKET_V3 blocks retired after usecTimeout
+bool ringRawsockRxSetBlockTimeout(void *pvRawsock, U32 usecTimeout);
+
 unsigned long ringRawsockGetTXOutOfBuffers(void *pvRawsock);
 
 unsigned long ringRawsockGetTXOutOfBuffersCyclic(void *pvRawsock);
 
+size_t ringRawsockPrefault(void *pvRawsock);
+
 #endif
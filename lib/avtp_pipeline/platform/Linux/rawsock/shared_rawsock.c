@@ -0,0 +1,885 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Shared RX engine for many listener streams on one interface.
+*
+* A single underlying rawsock (ring by default) receives all frames for an
+* interface/ethertype pair. An engine thread demultiplexes them by destination
+* MAC and stream ID into small per-stream queues, so the kernel only copies
+* each frame once no matter how many listeners are running.
+*/
+
+#include "shared_rawsock.h"
+#include "simple_rawsock.h"
+#include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <sched.h>
+#include "openavb_prefault.h"
+
+#include "openavb_trace.h"
+
+#define	AVB_LOG_COMPONENT	"Raw Socket"
+#include "openavb_log.h"
+
+// Offset of the stream_id within an AVTP stream PDU
+#define SHARED_RAWSOCK_STREAM_ID_OFFSET	4
+#define SHARED_RAWSOCK_STREAM_ID_LEN	8
+
+// Default per-stream queue depth if the client doesn't ask for one
+#define SHARED_RAWSOCK_DEFAULT_SLOTS	64
+
+struct shared_rx_engine;
+
+// One socket of an engine and the thread draining it. Each lane has its own
+// lock over the demultiplexing tables, so lanes never contend with each other
+// on the data path; changing the tables takes every lane's lock.
+typedef struct {
+	struct shared_rx_engine *engine;
+	int index;
+
+	// the underlying rawsock
+	void *rawsock;
+
+	// thread pulling frames from the underlying rawsock
+	pthread_t thread;
+	bool bThread;
+
+	pthread_mutex_t lock;
+
+	U8 pad[OPENAVB_CACHE_LINE_SIZE];
+} shared_rx_lane_t;
+
+typedef struct shared_rx_engine {
+	// interface (including underlying implementation and lane count) and ethertype served
+	char ifname[IFNAMSIZ * 2];
+	U16 ethertype;
+
+	// size of frames the underlying rawsocks receive
+	U32 frameSize;
+
+	// number of shared rawsocks attached
+	int users;
+
+	volatile bool bRunning;
+
+	// demultiplexing tables, protected by the lane locks
+	shared_rawsock_t *buckets[SHARED_RAWSOCK_HASH_SIZE];
+	// clients without a full destination/stream ID key
+	shared_rawsock_t *wildcards;
+
+	int nLanes;
+	shared_rx_lane_t lane[SHARED_RAWSOCK_MAX_LANES];
+
+	struct shared_rx_engine *pNext;
+} shared_rx_engine_t;
+
+static shared_rx_engine_t *gEngines = NULL;
+static pthread_mutex_t gEnginesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// FNV-1a over destination MAC and stream ID
+static U32 x_sharedHash(const U8 *pDestAddr, const U8 *pStreamID)
+{
+	U32 hash = 2166136261u;
+	int i;
+	for (i = 0; i < ETH_ALEN; i++) {
+		hash = (hash ^ pDestAddr[i]) * 16777619u;
+	}
+	for (i = 0; i < SHARED_RAWSOCK_STREAM_ID_LEN; i++) {
+		hash = (hash ^ pStreamID[i]) * 16777619u;
+	}
+	return hash & (SHARED_RAWSOCK_HASH_SIZE - 1);
+}
+
+// Lane the fan-out program sends a stream to; must match x_sharedFanoutProg
+static int x_sharedLaneOf(shared_rx_engine_t *engine, const U8 *pDestAddr, const U8 *pStreamID)
+{
+	U32 dest = ((U32)pDestAddr[2] << 24) | ((U32)pDestAddr[3] << 16) | ((U32)pDestAddr[4] << 8) | pDestAddr[5];
+	U32 sid = ((U32)pStreamID[4] << 24) | ((U32)pStreamID[5] << 16) | ((U32)pStreamID[6] << 8) | pStreamID[7];
+	return (dest + sid) % engine->nLanes;
+}
+
+// Take the tables for changing them
+static void x_sharedLockAll(shared_rx_engine_t *engine)
+{
+	int i;
+	for (i = 0; i < engine->nLanes; i++) {
+		pthread_mutex_lock(&engine->lane[i].lock);
+	}
+}
+
+static void x_sharedUnlockAll(shared_rx_engine_t *engine)
+{
+	int i;
+	for (i = engine->nLanes - 1; i >= 0; i--) {
+		pthread_mutex_unlock(&engine->lane[i].lock);
+	}
+}
+
+// Queue a copy of the frame for a client. Called from the engine thread only.
+static void x_sharedPush(shared_rawsock_t *rawsock, const U8 *pFrame, U32 len)
+{
+	U32 head = rawsock->head;
+	U32 next = head + 1;
+	if (next == rawsock->slotCount)
+		next = 0;
+
+	if (next == OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->tail)) {
+		rawsock->rxDropped++;
+		IF_LOG_INTERVAL(1000) AVB_LOGF_WARNING("Shared RX queue full; frame dropped (rawsock=%p)", rawsock);
+		return;
+	}
+	if (len > rawsock->slotSize) {
+		IF_LOG_INTERVAL(1000) AVB_LOGF_WARNING("Shared RX frame too big for receive buffer (len %u)", len);
+		return;
+	}
+
+	memcpy(rawsock->pSlotMem + (head * rawsock->slotSize), pFrame, len);
+	rawsock->pSlotLen[head] = len;
+	OPENAVB_ATOMIC_STORE_RELEASE(&rawsock->head, next);
+
+	// Only wake the client if it may have seen an empty queue. Pairs with
+	// the fence in sharedRawsockRelRxFrame().
+	OPENAVB_ATOMIC_FENCE();
+	if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->tail) == head) {
+		U64 one = 1;
+		if (write(rawsock->eventFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+			IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("Shared RX signal failed: %s", strerror(errno));
+		}
+	}
+}
+
+static void x_sharedDispatch(shared_rx_lane_t *lane, const U8 *pFrame, U32 len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	shared_rx_engine_t *engine = lane->engine;
+
+	if (len < ETH_HLEN) {
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return;
+	}
+
+	U32 hdrLen = ETH_HLEN;
+	if (ntohs(((eth_hdr_t *)pFrame)->ethertype) == ETHERTYPE_8021Q)
+		hdrLen += VLAN_HLEN;
+
+	const U8 *pStreamID = NULL;
+	if (len >= hdrLen + SHARED_RAWSOCK_STREAM_ID_OFFSET + SHARED_RAWSOCK_STREAM_ID_LEN)
+		pStreamID = pFrame + hdrLen + SHARED_RAWSOCK_STREAM_ID_OFFSET;
+
+	shared_rawsock_t *pClient;
+
+	pthread_mutex_lock(&lane->lock);
+
+	if (pStreamID) {
+		pClient = engine->buckets[x_sharedHash(pFrame, pStreamID)];
+		for (; pClient; pClient = pClient->pNext) {
+			if (memcmp(pClient->streamID, pStreamID, SHARED_RAWSOCK_STREAM_ID_LEN) == 0
+				&& memcmp(pClient->destAddr, pFrame, ETH_ALEN) == 0) {
+				x_sharedPush(pClient, pFrame, len);
+			}
+		}
+	}
+
+	for (pClient = engine->wildcards; pClient; pClient = pClient->pNext) {
+		if (!pClient->bDestAddr || memcmp(pClient->destAddr, pFrame, ETH_ALEN) == 0) {
+			if (engine->nLanes > 1) {
+				pthread_mutex_lock(&pClient->pushLock);
+				x_sharedPush(pClient, pFrame, len);
+				pthread_mutex_unlock(&pClient->pushLock);
+			}
+			else {
+				x_sharedPush(pClient, pFrame, len);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&lane->lock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+}
+
+static void *x_sharedEngineThread(void *pv)
+{
+	shared_rx_lane_t *lane = (shared_rx_lane_t *)pv;
+	shared_rx_engine_t *engine = lane->engine;
+
+	while (engine->bRunning) {
+		U32 offset, len;
+		U8 *pBuf = openavbRawsockGetRxFrame(lane->rawsock, SHARED_RAWSOCK_ENGINE_POLL_USEC, &offset, &len);
+		if (pBuf) {
+			x_sharedDispatch(lane, pBuf + offset, len);
+			openavbRawsockRelRxFrame(lane->rawsock, pBuf);
+		}
+	}
+
+	return NULL;
+}
+
+// Join the lane sockets into one fan-out group steered by a classic BPF
+// program. The program runs with the packet at the network (AVTP) header:
+// it adds the last four bytes of the destination MAC to the last four bytes
+// of the stream ID, and the kernel takes that modulo the group size.
+static bool x_sharedFanoutJoin(shared_rx_engine_t *engine)
+{
+	static U16 nextGroup = 0;
+	struct sock_filter x_sharedFanoutProg[] = {
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_LL_OFF + 2),
+		BPF_STMT(BPF_ST, 0),
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SHARED_RAWSOCK_STREAM_ID_OFFSET + 4),
+		BPF_STMT(BPF_LDX | BPF_W | BPF_MEM, 0),
+		BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+		BPF_STMT(BPF_RET | BPF_A, 0),
+	};
+	struct sock_fprog fprog = { sizeof(x_sharedFanoutProg) / sizeof(x_sharedFanoutProg[0]), x_sharedFanoutProg };
+
+	// Group IDs are per network namespace; keep ours apart from other processes'
+	U16 group = (U16)(getpid() * 97 + nextGroup++);
+	int fanout = group | (PACKET_FANOUT_CBPF << 16);
+	int i;
+
+	for (i = 0; i < engine->nLanes; i++) {
+		int sock = openavbRawsockGetSocket(engine->lane[i].rawsock);
+		if (sock < 0) {
+			AVB_LOGF_ERROR("Shared RX engine on %s: lanes need packet sockets", engine->ifname);
+			return FALSE;
+		}
+		if (setsockopt(sock, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) {
+			AVB_LOGF_ERROR("Shared RX engine on %s: PACKET_FANOUT failed: %s", engine->ifname, strerror(errno));
+			return FALSE;
+		}
+		if (i == 0 && setsockopt(sock, SOL_PACKET, PACKET_FANOUT_DATA, &fprog, sizeof(fprog)) < 0) {
+			AVB_LOGF_ERROR("Shared RX engine on %s: PACKET_FANOUT_DATA failed: %s", engine->ifname, strerror(errno));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// Run lane i on the i-th CPU the opening thread may use, when there are enough
+static void x_sharedLanePin(shared_rx_engine_t *engine, shared_rx_lane_t *lane)
+{
+	cpu_set_t allowed;
+	if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) != 0
+		|| CPU_COUNT(&allowed) < engine->nLanes) {
+		return;
+	}
+
+	int cpu, n = 0;
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed) && n++ == lane->index) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			if (pthread_setaffinity_np(lane->thread, sizeof(set), &set) == 0) {
+				AVB_LOGF_INFO("Shared RX engine on %s: lane %d on CPU %d", engine->ifname, lane->index, cpu);
+			}
+			return;
+		}
+	}
+}
+
+// Stop and close every lane of an engine
+static void x_sharedEngineStop(shared_rx_engine_t *engine)
+{
+	int i;
+
+	engine->bRunning = FALSE;
+	for (i = 0; i < engine->nLanes; i++) {
+		shared_rx_lane_t *lane = &engine->lane[i];
+		if (lane->bThread) {
+			pthread_join(lane->thread, NULL);
+			lane->bThread = FALSE;
+		}
+	}
+	for (i = 0; i < engine->nLanes; i++) {
+		shared_rx_lane_t *lane = &engine->lane[i];
+		if (lane->rawsock) {
+			openavbRawsockClose(lane->rawsock);
+			lane->rawsock = NULL;
+		}
+		pthread_mutex_destroy(&lane->lock);
+	}
+}
+
+// Find (or create) the engine for an interface and take a reference on it
+static shared_rx_engine_t *x_sharedEngineAcquire(const char *ifname, U16 ethertype, U32 frame_size)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	pthread_mutex_lock(&gEnginesMutex);
+
+	shared_rx_engine_t *engine;
+	for (engine = gEngines; engine; engine = engine->pNext) {
+		if (engine->ethertype == ethertype && strcmp(engine->ifname, ifname) == 0)
+			break;
+	}
+
+	if (engine) {
+		if (frame_size > engine->frameSize) {
+			AVB_LOGF_WARNING("Shared RX engine on %s receives frames up to %u bytes only", ifname, engine->frameSize);
+		}
+		engine->users++;
+		pthread_mutex_unlock(&gEnginesMutex);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return engine;
+	}
+
+	engine = calloc(1, sizeof(shared_rx_engine_t));
+	if (!engine) {
+		AVB_LOG_ERROR("Creating shared RX engine; malloc failed");
+		pthread_mutex_unlock(&gEnginesMutex);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+	strncpy(engine->ifname, ifname, sizeof(engine->ifname) - 1);
+	engine->ethertype = ethertype;
+
+	// Split off the lane count
+	char devname[IFNAMSIZ * 2] = {0};
+	const char *at = strchr(ifname, '@');
+	size_t nameLen = at ? (size_t)(at - ifname) : strlen(ifname);
+	if (nameLen >= sizeof(devname)) {
+		nameLen = sizeof(devname) - 1;
+	}
+	memcpy(devname, ifname, nameLen);
+	engine->nLanes = at ? atoi(at + 1) : 1;
+	if (engine->nLanes < 1 || engine->nLanes > SHARED_RAWSOCK_MAX_LANES) {
+		AVB_LOGF_ERROR("Creating shared RX engine; %s: 1 to %d lanes", ifname, SHARED_RAWSOCK_MAX_LANES);
+		free(engine);
+		pthread_mutex_unlock(&gEnginesMutex);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Use the ring implementation unless the caller picked one
+	char underlying[IFNAMSIZ * 2 + 8];
+	if (strchr(devname, ':'))
+		snprintf(underlying, sizeof(underlying), "%s", devname);
+	else
+		snprintf(underlying, sizeof(underlying), "ring:%s", devname);
+	if (engine->nLanes > 1 && strncmp(underlying, "ring:", 5) != 0) {
+		AVB_LOGF_WARNING("Shared RX engine on %s: lanes need the ring implementation; using one", ifname);
+		engine->nLanes = 1;
+	}
+
+	int i;
+	for (i = 0; i < engine->nLanes; i++) {
+		shared_rx_lane_t *lane = &engine->lane[i];
+		lane->engine = engine;
+		lane->index = i;
+		pthread_mutex_init(&lane->lock, NULL);
+	}
+
+	// The first stream sets the frame size for the engine
+	for (i = 0; i < engine->nLanes; i++) {
+		shared_rx_lane_t *lane = &engine->lane[i];
+		lane->rawsock = openavbRawsockOpen(underlying, TRUE, FALSE, ethertype, frame_size, SHARED_RAWSOCK_ENGINE_FRAMES);
+		if (!lane->rawsock) {
+			AVB_LOGF_ERROR("Creating shared RX engine; failed to open %s", underlying);
+			break;
+		}
+	}
+	if (i < engine->nLanes || (engine->nLanes > 1 && !x_sharedFanoutJoin(engine))) {
+		x_sharedEngineStop(engine);
+		free(engine);
+		pthread_mutex_unlock(&gEnginesMutex);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	engine->frameSize = ((base_rawsock_t *)engine->lane[0].rawsock)->frameSize;
+	engine->users = 1;
+	engine->bRunning = TRUE;
+
+	// The threads inherit the scheduling policy of the (listener) thread opening it
+	for (i = 0; i < engine->nLanes; i++) {
+		shared_rx_lane_t *lane = &engine->lane[i];
+		int err = pthread_create(&lane->thread, NULL, x_sharedEngineThread, lane);
+		if (err) {
+			AVB_LOGF_ERROR("Creating shared RX engine; thread create failed: %s", strerror(err));
+			x_sharedEngineStop(engine);
+			free(engine);
+			pthread_mutex_unlock(&gEnginesMutex);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
+		lane->bThread = TRUE;
+		if (engine->nLanes > 1) {
+			x_sharedLanePin(engine, lane);
+		}
+	}
+
+	engine->pNext = gEngines;
+	gEngines = engine;
+
+	AVB_LOGF_INFO("Shared RX engine started on %s with %d lane(s)", underlying, engine->nLanes);
+
+	pthread_mutex_unlock(&gEnginesMutex);
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return engine;
+}
+
+// Drop a reference on an engine, stopping it when the last user is gone
+static void x_sharedEngineRelease(shared_rx_engine_t *engine)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	pthread_mutex_lock(&gEnginesMutex);
+
+	if (--engine->users > 0) {
+		pthread_mutex_unlock(&gEnginesMutex);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return;
+	}
+
+	shared_rx_engine_t **ppEngine;
+	for (ppEngine = &gEngines; *ppEngine; ppEngine = &(*ppEngine)->pNext) {
+		if (*ppEngine == engine) {
+			*ppEngine = engine->pNext;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&gEnginesMutex);
+
+	x_sharedEngineStop(engine);
+	free(engine);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+}
+
+// Join or leave a multicast group on the underlying socket.
+// The per-rawsock implementations also attach a BPF filter for the group,
+// which would hide every other stream's frames from the engine, so go to
+// the socket directly; the kernel counts memberships for us. Membership is
+// for the device, so the first lane's socket serves every lane.
+static bool x_sharedEngineMembership(shared_rx_engine_t *engine, if_info_t *pIfInfo, bool add_membership, const U8 addr[ETH_ALEN])
+{
+	void *rawsock = engine->lane[0].rawsock;
+	int sock = openavbRawsockGetSocket(rawsock);
+	if (sock < 0) {
+		// Not a packet socket; let the implementation deal with it
+		return openavbRawsockRxMulticast(rawsock, add_membership, addr);
+	}
+
+	struct packet_mreq mreq;
+	memset(&mreq, 0, sizeof(struct packet_mreq));
+	mreq.mr_ifindex = pIfInfo->index;
+	mreq.mr_type = PACKET_MR_MULTICAST;
+	mreq.mr_alen = ETH_ALEN;
+	memcpy(&mreq.mr_address, addr, ETH_ALEN);
+
+	int action = (add_membership ? PACKET_ADD_MEMBERSHIP : PACKET_DROP_MEMBERSHIP);
+	if (setsockopt(sock, SOL_PACKET, action, (void*)&mreq, sizeof(struct packet_mreq)) < 0) {
+		AVB_LOGF_ERROR("Setting multicast; setsockopt(%s) failed: %s",
+					   (add_membership ? "PACKET_ADD_MEMBERSHIP" : "PACKET_DROP_MEMBERSHIP"),
+					   strerror(errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Remove a client from the engine's tables. Caller holds every lane lock.
+static void x_sharedUnlink(shared_rawsock_t *rawsock)
+{
+	if (!rawsock->bLinked)
+		return;
+
+	shared_rx_engine_t *engine = rawsock->engine;
+	shared_rawsock_t **ppClient = &engine->wildcards;
+	if (rawsock->bDestAddr && rawsock->bStreamID)
+		ppClient = &engine->buckets[x_sharedHash(rawsock->destAddr, rawsock->streamID)];
+
+	for (; *ppClient; ppClient = &(*ppClient)->pNext) {
+		if (*ppClient == rawsock) {
+			*ppClient = rawsock->pNext;
+			break;
+		}
+	}
+	rawsock->pNext = NULL;
+	rawsock->bLinked = FALSE;
+}
+
+// Add a client to the engine's tables. Caller holds every lane lock.
+static void x_sharedLink(shared_rawsock_t *rawsock)
+{
+	shared_rx_engine_t *engine = rawsock->engine;
+	shared_rawsock_t **ppClient = &engine->wildcards;
+	if (rawsock->bDestAddr && rawsock->bStreamID)
+		ppClient = &engine->buckets[x_sharedHash(rawsock->destAddr, rawsock->streamID)];
+
+	rawsock->pNext = *ppClient;
+	*ppClient = rawsock;
+	rawsock->bLinked = TRUE;
+}
+
+// Tell which lane (and so which CPU) a fully keyed stream is served from,
+// so the listener thread can be given the same thread_affinity
+static void x_sharedLogLane(shared_rawsock_t *rawsock)
+{
+	shared_rx_engine_t *engine = rawsock->engine;
+	if (engine->nLanes > 1 && rawsock->bDestAddr && rawsock->bStreamID) {
+		AVB_LOGF_INFO("Shared RX engine on %s: stream "ETH_FORMAT"/%u on lane %d",
+			engine->ifname, ETH_OCTETS(rawsock->streamID),
+			((U32)rawsock->streamID[6] << 8) | rawsock->streamID[7],
+			x_sharedLaneOf(engine, rawsock->destAddr, rawsock->streamID));
+	}
+}
+
+// Open a rawsock attached to the shared engine
+void* sharedRawsockOpen(shared_rawsock_t *rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	AVB_LOGF_DEBUG("Open, rx=%d, tx=%d, ethertype=%x size=%d, num=%d", rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
+	baseRawsockOpen(&rawsock->base, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
+	rawsock->eventFd = -1;
+	pthread_mutex_init(&rawsock->pushLock, NULL);
+
+	if (tx_mode || !rx_mode) {
+		AVB_LOG_ERROR("Creating rawsock; shared implementation only supports RX");
+		sharedRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Get info about the network device (without any implementation prefix or lane count)
+	const char *colon = strchr(ifname, ':');
+	char devname[IFNAMSIZ] = {0};
+	strncpy(devname, colon ? colon + 1 : ifname, sizeof(devname) - 1);
+	char *at = strchr(devname, '@');
+	if (at)
+		*at = '\0';
+	if (!simpleAvbCheckInterface(devname, &(rawsock->base.ifInfo))) {
+		AVB_LOGF_ERROR("Creating rawsock; bad interface name: %s", ifname);
+		sharedRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Deal with frame size.
+	if (rawsock->base.frameSize == 0) {
+		// use interface MTU as max frames size, if none specified
+		rawsock->base.frameSize = rawsock->base.ifInfo.mtu + ETH_HLEN + VLAN_HLEN;
+	}
+
+	// Allocate our frame queue
+	rawsock->slotCount = (num_frames ? num_frames : SHARED_RAWSOCK_DEFAULT_SLOTS) + 1;
+	rawsock->slotSize = TPACKET_ALIGN(rawsock->base.frameSize);
+	rawsock->pSlotMem = malloc(rawsock->slotCount * rawsock->slotSize);
+	rawsock->pSlotLen = calloc(rawsock->slotCount, sizeof(U32));
+	if (!rawsock->pSlotMem || !rawsock->pSlotLen) {
+		AVB_LOG_ERROR("Creating rawsock; malloc failed");
+		sharedRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	rawsock->eventFd = eventfd(0, EFD_NONBLOCK);
+	if (rawsock->eventFd == -1) {
+		AVB_LOGF_ERROR("Creating rawsock; eventfd: %s", strerror(errno));
+		sharedRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	rawsock->engine = x_sharedEngineAcquire(ifname, ethertype, frame_size);
+	if (!rawsock->engine) {
+		sharedRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Until a destination and stream ID are set, receive everything
+	x_sharedLockAll(rawsock->engine);
+	x_sharedLink(rawsock);
+	x_sharedUnlockAll(rawsock->engine);
+
+	// fill virtual functions table
+	rawsock_cb_t *cb = &rawsock->base.cb;
+	cb->close = sharedRawsockClose;
+	cb->getSocket = sharedRawsockGetSocket;
+	cb->getRxFrame = sharedRawsockGetRxFrame;
+	cb->relRxFrame = sharedRawsockRelRxFrame;
+	cb->rxMulticast = sharedRawsockRxMulticast;
+	cb->rxStreamID = sharedRawsockRxStreamID;
+	cb->rxBufLevel = sharedRawsockRxBufLevel;
+	cb->prefault = sharedRawsockPrefault;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock;
+}
+
+// Close the rawsock
+void sharedRawsockClose(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+
+	if (rawsock) {
+		if (rawsock->engine) {
+			x_sharedLockAll(rawsock->engine);
+			x_sharedUnlink(rawsock);
+			x_sharedUnlockAll(rawsock->engine);
+
+			if (rawsock->bDestAddr)
+				x_sharedEngineMembership(rawsock->engine, &rawsock->base.ifInfo, FALSE, rawsock->destAddr);
+
+			x_sharedEngineRelease(rawsock->engine);
+			rawsock->engine = NULL;
+		}
+
+		if (rawsock->eventFd != -1) {
+			close(rawsock->eventFd);
+			rawsock->eventFd = -1;
+		}
+
+		free(rawsock->pSlotMem);
+		rawsock->pSlotMem = NULL;
+		free(rawsock->pSlotLen);
+		rawsock->pSlotLen = NULL;
+
+		pthread_mutex_destroy(&rawsock->pushLock);
+	}
+
+	baseRawsockClose(rawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+}
+
+// Get the eventfd used for this rawsock; can be used for poll/select
+int sharedRawsockGetSocket(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+	if (!rawsock) {
+		AVB_LOG_ERROR("Getting socket; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return -1;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock->eventFd;
+}
+
+// Get a RX frame
+U8* sharedRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock) || offset == NULL || len == NULL) {
+		AVB_LOG_ERROR("Getting RX frame; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return NULL;
+	}
+
+	while (1) {
+		U32 tail = rawsock->tail;
+		if (tail != OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->head)) {
+			// Frames are stored from the start of the slot
+			*offset = 0;
+			*len = rawsock->pSlotLen[tail];
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return rawsock->pSlotMem + (tail * rawsock->slotSize);
+		}
+
+		if (timeout == OPENAVB_RAWSOCK_NONBLOCK) {
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+
+		struct pollfd pfd;
+		struct timespec ts, *pts = NULL;
+		if (timeout != OPENAVB_RAWSOCK_BLOCK) {
+			ts.tv_sec = timeout / MICROSECONDS_PER_SECOND;
+			ts.tv_nsec = (timeout % MICROSECONDS_PER_SECOND) * NANOSECONDS_PER_USEC;
+			pts = &ts;
+		}
+
+		pfd.fd = rawsock->eventFd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		int ret = ppoll(&pfd, 1, pts, NULL);
+		if (ret < 0) {
+			if (errno != EINTR) {
+				AVB_LOGF_ERROR("Getting RX frame; poll failed: %s", strerror(errno));
+			}
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+		if ((pfd.revents & POLLIN) == 0) {
+			// timeout
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+
+		// Reset the eventfd counter, then look at the queue again
+		U64 count;
+		if (read(rawsock->eventFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+			AVB_LOGF_ERROR("Getting RX frame; eventfd read failed: %s", strerror(errno));
+		}
+	}
+}
+
+// Release a RX frame held by the client
+bool sharedRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Releasing RX frame; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	U32 tail = rawsock->tail;
+	if (tail == OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->head)
+		|| pBuffer != rawsock->pSlotMem + (tail * rawsock->slotSize)) {
+		AVB_LOG_ERROR("Releasing RX frame; frame not held");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	if (++tail == rawsock->slotCount)
+		tail = 0;
+	OPENAVB_ATOMIC_STORE_RELEASE(&rawsock->tail, tail);
+
+	// Pairs with the fence in x_sharedPush(), so a frame queued while we
+	// release this one either shows up to us or signals the eventfd.
+	OPENAVB_ATOMIC_FENCE();
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Setup the rawsock to receive multicast packets
+bool sharedRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock) || addr == NULL) {
+		AVB_LOG_ERROR("Setting multicast; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	bool ret = TRUE;
+	if (add_membership && rawsock->bDestAddr) {
+		if (memcmp(rawsock->destAddr, addr, ETH_ALEN) != 0) {
+			// Only one group is kept per client, so leave the old one first
+			x_sharedEngineMembership(rawsock->engine, &rawsock->base.ifInfo, FALSE, rawsock->destAddr);
+			ret = x_sharedEngineMembership(rawsock->engine, &rawsock->base.ifInfo, TRUE, addr);
+		}
+	}
+	else {
+		ret = x_sharedEngineMembership(rawsock->engine, &rawsock->base.ifInfo, add_membership, addr);
+	}
+
+	x_sharedLockAll(rawsock->engine);
+	x_sharedUnlink(rawsock);
+	if (add_membership) {
+		memcpy(rawsock->destAddr, addr, ETH_ALEN);
+		rawsock->bDestAddr = TRUE;
+	}
+	else if (rawsock->bDestAddr && memcmp(rawsock->destAddr, addr, ETH_ALEN) == 0) {
+		rawsock->bDestAddr = FALSE;
+	}
+	x_sharedLink(rawsock);
+	x_sharedUnlockAll(rawsock->engine);
+	x_sharedLogLane(rawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
+
+// Deliver only frames of the given stream to this rawsock
+bool sharedRawsockRxStreamID(void *pvRawsock, const U8 streamID[8])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock) || streamID == NULL) {
+		AVB_LOG_ERROR("Setting stream ID; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	x_sharedLockAll(rawsock->engine);
+	x_sharedUnlink(rawsock);
+	memcpy(rawsock->streamID, streamID, SHARED_RAWSOCK_STREAM_ID_LEN);
+	rawsock->bStreamID = TRUE;
+	x_sharedLink(rawsock);
+	x_sharedUnlockAll(rawsock->engine);
+	x_sharedLogLane(rawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
+// Count used RX buffers in our queue
+int sharedRawsockRxBufLevel(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("getting buffer level; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return 0;
+	}
+
+	U32 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->head);
+	U32 tail = OPENAVB_ATOMIC_LOAD_ACQUIRE(&rawsock->tail);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return (head + rawsock->slotCount - tail) % rawsock->slotCount;
+}
+
+// Fault in our frame queue; the engine thread may already be filling it
+size_t sharedRawsockPrefault(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	shared_rawsock_t *rawsock = (shared_rawsock_t*)pvRawsock;
+	size_t bytes = 0;
+
+	if (VALID_RX_RAWSOCK(rawsock)) {
+		bytes = openavbPrefault(rawsock->pSlotMem, (size_t)rawsock->slotCount * rawsock->slotSize, TRUE)
+			+ openavbPrefault(rawsock->pSlotLen, rawsock->slotCount * sizeof(U32), TRUE);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return bytes;
+}
@@ -0,0 +1,127 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+#ifndef SHARED_RAWSOCK_H
+#define SHARED_RAWSOCK_H
+
+#include "rawsock_impl.h"
+#include <pthread.h>
+
+// Number of hash buckets used to demultiplex received frames
+#define SHARED_RAWSOCK_HASH_SIZE		64
+
+// Number of frames in the RX ring of the underlying rawsock
+#define SHARED_RAWSOCK_ENGINE_FRAMES	1024
+
+// How long the engine thread blocks on the underlying rawsock
+// before re-checking whether it should stop
+#define SHARED_RAWSOCK_ENGINE_POLL_USEC	(100 * MICROSECONDS_PER_MSEC)
+
+// Most RX lanes (sockets and threads) an engine can spread streams across
+#define SHARED_RAWSOCK_MAX_LANES		16
+
+struct shared_rx_engine;
+
+// State information for a listener attached to a shared RX engine
+//
+typedef struct shared_rawsock {
+	base_rawsock_t base;
+
+	// engine delivering frames to us
+	struct shared_rx_engine *engine;
+
+	// eventfd signalled when frames are queued; used for poll
+	int eventFd;
+
+	// demultiplexing key
+	U8 destAddr[ETH_ALEN];
+	bool bDestAddr;
+	U8 streamID[8];
+	bool bStreamID;
+
+	// linkage in the engine's hash bucket (or wildcard list)
+	bool bLinked;
+	struct shared_rawsock *pNext;
+
+	// Serializes pushes when frames for us can come from more than one
+	// lane, which is only the case without a full destination/stream ID key
+	pthread_mutex_t pushLock;
+
+	// per-stream frame queue, filled by the engine thread and drained
+	// by the listener. One slot is always left empty.
+	U8 *pSlotMem;
+	U32 *pSlotLen;
+	U32 slotCount;
+	U32 slotSize;
+
+	// queue indexes on separate cache lines; the engine thread owns
+	// head and the listener owns tail
+	U8 pad0[OPENAVB_CACHE_LINE_SIZE];
+	U32 head;
+	U8 pad1[OPENAVB_CACHE_LINE_SIZE - sizeof(U32)];
+	U32 tail;
+	U8 pad2[OPENAVB_CACHE_LINE_SIZE - sizeof(U32)];
+
+	// frames dropped because our queue was full
+	unsigned long rxDropped;
+} shared_rawsock_t;
+
+// Open a rawsock that receives through the shared engine for ifname.
+// ifname may carry the underlying implementation (ie: "igb:eth0");
+// the ring implementation is used when none is given. A "@N" suffix
+// (ie: "eth0@4") spreads the streams over N ring sockets joined in a
+// PACKET_FANOUT group, each drained by its own thread. A stream always
+// lands on the same lane, picked from its destination MAC and stream ID.
+void* sharedRawsockOpen(shared_rawsock_t *rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames);
+
+// Close the rawsock, and release the engine once its last user is gone
+void sharedRawsockClose(void *pvRawsock);
+
+// Get the eventfd used for this rawsock; can be used for poll/select
+int sharedRawsockGetSocket(void *pvRawsock);
+
+// Get a RX frame
+U8* sharedRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len);
+
+// Release a RX frame held by the client
+bool sharedRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer);
+
+// Setup the rawsock to receive multicast packets
+bool sharedRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN]);
+
+// Deliver only frames of the given stream to this rawsock
+bool sharedRawsockRxStreamID(void *pvRawsock, const U8 streamID[8]);
+
+// Count used RX buffers in our queue
+int sharedRawsockRxBufLevel(void *pvRawsock);
+
+size_t sharedRawsockPrefault(void *pvRawsock);
+
+#endif
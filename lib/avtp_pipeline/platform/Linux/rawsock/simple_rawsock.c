@@ -29,10 +29,21 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 *************************************************************************************************************/
 
 #include "simple_rawsock.h"
+#include "txtime_rawsock.h"
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <linux/if_packet.h>
 #include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL			46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL		69
+#endif
 
 #include "openavb_trace.h"
 
@@ -199,10 +210,17 @@ void* simpleRawsockOpen(simple_rawsock_t* rawsock, const char *ifname, bool rx_m
 	cb->close = simpleRawsockClose;
 	cb->getTxFrame = simpleRawsockGetTxFrame;
 	cb->txSetMark = simpleRawsockTxSetMark;
+	cb->txSetLaunchTime = simpleRawsockTxSetLaunchTime;
+	cb->txTimestampNext = simpleRawsockTxTimestampNext;
+	cb->txTimestampGet = simpleRawsockTxTimestampGet;
 	cb->txSetHdr = simpleRawsockTxSetHdr;
 	cb->txFrameReady = simpleRawsockTxFrameReady;
+	cb->getTxFrames = simpleRawsockGetTxFrames;
+	cb->txFramesSend = simpleRawsockTxFramesSend;
 	cb->getRxFrame = simpleRawsockGetRxFrame;
+	cb->getRxFrames = simpleRawsockGetRxFrames;
 	cb->rxMulticast = simpleRawsockRxMulticast;
+	cb->rxSetBusyPoll = simpleRawsockRxSetBusyPoll;
 	cb->getSocket = simpleRawsockGetSocket;
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
@@ -221,6 +239,8 @@ void simpleRawsockClose(void *pvRawsock)
 			close(rawsock->sock);
 			rawsock->sock = -1;
 		}
+		cbsRawsockClose(rawsock->pShaper);
+		rawsock->pShaper = NULL;
 	}
 
 	baseRawsockClose(rawsock);
@@ -276,12 +296,143 @@ bool simpleRawsockTxSetMark(void *pvRawsock, int mark)
 	else {
 		AVB_LOGF_DEBUG("SO_MARK=%d OK", mark);
 		retval = TRUE;
+
+		// Without Qav hardware, share the class credit with the other
+		// talkers on the interface if the queue manager shapes it
+		rawsock->txMark = mark;
+		if (!rawsock->pShaper)
+			rawsock->pShaper = cbsRawsockAttach(rawsock->base.ifInfo.name);
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
 	return retval;
 }
 
+// Send frames with their launch time, using SO_TXTIME
+bool simpleRawsockTxSetLaunchTime(void *pvRawsock, bool enable)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	simple_rawsock_t *rawsock = (simple_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Setting launch time; invalid argument passed");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	// SO_TXTIME can't be turned off again; we just stop passing times
+	if (enable && !rawsock->bTxTime) {
+		rawsock->bTxTime = txtimeRawsockEnable(rawsock->sock);
+	}
+	else if (!enable) {
+		rawsock->bTxTime = FALSE;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock->bTxTime == enable;
+}
+
+// Space for the control message asking for a TX timestamp
+#define TXTS_CMSG_SPACE		CMSG_SPACE(sizeof(U32))
+
+// Have the NIC timestamp the next frame sent. Only that frame asks for a
+// timestamp, with a control message, so gptp's own event messages on the
+// same NIC rarely find the timestamp unit busy.
+bool simpleRawsockTxTimestampNext(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	simple_rawsock_t *rawsock = (simple_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Asking for TX timestamp; invalid argument passed");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	if (!rawsock->bTxTsOn) {
+		// Report hardware timestamps, without the frame
+		int flags = SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_OPT_TSONLY;
+		if (setsockopt(rawsock->sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+			AVB_LOGF_WARNING("TX timestamps not available: %s", strerror(errno));
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return FALSE;
+		}
+		rawsock->bTxTsOn = TRUE;
+	}
+
+	if (rawsock->bTxTsPending) {
+		// Given up on; drop it should it still come back
+		U8 cbuf[256];
+		struct msghdr msg;
+		do {
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_control = cbuf;
+			msg.msg_controllen = sizeof(cbuf);
+		} while (recvmsg(rawsock->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0);
+		rawsock->bTxTsPending = FALSE;
+	}
+	rawsock->bTxTsNext = TRUE;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
+// Read the hardware TX timestamp asked for from the socket error queue
+bool simpleRawsockTxTimestampGet(void *pvRawsock, U64 *pLocalNsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	simple_rawsock_t *rawsock = (simple_rawsock_t*)pvRawsock;
+	bool ret = FALSE;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || !rawsock->bTxTsPending) {
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	U8 cbuf[256];
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+	if (recvmsg(rawsock->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0) {
+		struct cmsghdr *cmsg;
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+				// ts[2] is the raw hardware timestamp
+				struct timespec *ts = (struct timespec *)CMSG_DATA(cmsg);
+				if (ts[2].tv_sec || ts[2].tv_nsec) {
+					*pLocalNsec = (U64)ts[2].tv_sec * NANOSECONDS_PER_SECOND + ts[2].tv_nsec;
+					ret = TRUE;
+				}
+			}
+		}
+		rawsock->bTxTsPending = FALSE;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
+// Add the control message asking for a TX timestamp of the frame, after
+// any already in cbuf
+static void x_simpleTxTsCmsg(simple_rawsock_t *rawsock, struct msghdr *msg, U8 *cbuf)
+{
+	if (!msg->msg_control) {
+		msg->msg_control = cbuf;
+		msg->msg_controllen = 0;
+	}
+	struct cmsghdr *cmsg = (struct cmsghdr *)((U8 *)msg->msg_control + msg->msg_controllen);
+	memset(cmsg, 0, TXTS_CMSG_SPACE);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SO_TIMESTAMPING;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(U32));
+	*(U32 *)CMSG_DATA(cmsg) = SOF_TIMESTAMPING_TX_HARDWARE;
+	msg->msg_controllen += TXTS_CMSG_SPACE;
+
+	rawsock->bTxTsNext = FALSE;
+	rawsock->bTxTsPending = TRUE;
+}
+
 // Pre-set the ethernet header information that will be used on TX frames
 bool simpleRawsockTxSetHdr(void *pvRawsock, hdr_info_t *pHdr)
 {
@@ -316,17 +467,132 @@ bool simpleRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U
 		return FALSE;
 	}
 
-	if (timeNsec) {
-		IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is unsupported in simple_rawsock");
-	}
+	if (rawsock->pShaper)
+		cbsRawsockTxWait(rawsock->pShaper, rawsock->txMark, len);
 
 	int flags = MSG_DONTWAIT;
-	send(rawsock->sock, pBuffer, len, flags);
+	if ((rawsock->bTxTime && timeNsec) || rawsock->bTxTsNext) {
+		U8 cbuf[TXTIME_CMSG_SPACE + TXTS_CMSG_SPACE];
+		struct iovec iov = { pBuffer, len };
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		if (rawsock->bTxTime && timeNsec)
+			txtimeRawsockSetCmsg(&msg, cbuf, timeNsec + txtimeRawsockTaiOffset());
+		if (rawsock->bTxTsNext)
+			x_simpleTxTsCmsg(rawsock, &msg, cbuf);
+		sendmsg(rawsock->sock, &msg, flags);
+	}
+	else {
+		if (timeNsec) {
+			IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is not enabled in simple_rawsock");
+		}
+		send(rawsock->sock, pBuffer, len, flags);
+	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
 	return TRUE;
 }
 
+// Get a burst of buffers to use for TX
+//
+// Buffers are handed out in turn round the burst buffers, so the ones a
+// caller kept unfilled from the previous call (the last it was given) are
+// not handed out again while it holds no more than
+// OPENAVB_RAWSOCK_TX_BURST_MAX in all.
+int simpleRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	simple_rawsock_t *rawsock = (simple_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL) {
+		AVB_LOG_ERROR("Getting TX frames; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	if (count > OPENAVB_RAWSOCK_TX_BURST_MAX)
+		count = OPENAVB_RAWSOCK_TX_BURST_MAX;
+
+	U32 i;
+	for (i = 0; i < count; i++) {
+		pFrames[i] = rawsock->txBurstBuffer[rawsock->txBurstNext];
+		if (++rawsock->txBurstNext >= OPENAVB_RAWSOCK_TX_BURST_MAX)
+			rawsock->txBurstNext = 0;
+	}
+
+	// Remind client how big the frame buffer is
+	if (len)
+		*len = rawsock->base.frameSize;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return count;
+}
+
+// Send a burst of TX frames with a single sendmmsg()
+int simpleRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	simple_rawsock_t *rawsock = (simple_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || lens == NULL || count > OPENAVB_RAWSOCK_TX_BURST_MAX) {
+		AVB_LOG_ERROR("Sending TX frames; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	struct mmsghdr msgs[OPENAVB_RAWSOCK_TX_BURST_MAX];
+	struct iovec iovs[OPENAVB_RAWSOCK_TX_BURST_MAX];
+	U8 cbufs[OPENAVB_RAWSOCK_TX_BURST_MAX][TXTIME_CMSG_SPACE + TXTS_CMSG_SPACE];
+	S64 taiOffset = 0;
+	U32 i;
+
+	if (rawsock->bTxTime && timeNsec)
+		taiOffset = txtimeRawsockTaiOffset();
+
+	memset(msgs, 0, count * sizeof(struct mmsghdr));
+	for (i = 0; i < count; i++) {
+		iovs[i].iov_base = pFrames[i];
+		iovs[i].iov_len = lens[i];
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		if (timeNsec && timeNsec[i]) {
+			if (rawsock->bTxTime) {
+				txtimeRawsockSetCmsg(&msgs[i].msg_hdr, cbufs[i], timeNsec[i] + taiOffset);
+			}
+			else {
+				IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is not enabled in simple_rawsock");
+			}
+		}
+		if (i == 0 && rawsock->bTxTsNext) {
+			x_simpleTxTsCmsg(rawsock, &msgs[i].msg_hdr, cbufs[i]);
+		}
+	}
+
+	int flags = MSG_DONTWAIT;
+	int sent;
+	if (rawsock->pShaper) {
+		// The shaper spaces the frames, so each goes out on its own
+		for (sent = 0; sent < (int)count; sent++) {
+			cbsRawsockTxWait(rawsock->pShaper, rawsock->txMark, lens[sent]);
+			if (sendmsg(rawsock->sock, &msgs[sent].msg_hdr, flags) < 0)
+				break;
+		}
+		if (sent == 0 && count > 0)
+			sent = -1;
+	}
+	else {
+		sent = sendmmsg(rawsock->sock, msgs, count, flags);
+	}
+	if (sent < 0) {
+		IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("sendmmsg failed: %s", strerror(errno));
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return sent;
+}
+
 // Get a RX frame
 U8* simpleRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len)
 {
@@ -359,6 +625,112 @@ U8* simpleRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset,
 	return pBuffer;
 }
 
+// Get a burst of RX frames with a single recvmmsg()
+//
+// The timeout only applies to the first frame; whatever else is already
+// queued on the socket is picked up in the same call.  The buffers stay
+// valid until the next call, as with simpleRawsockGetRxFrame.
+int simpleRawsockGetRxFrames(void *pvRawsock, U32 timeout, U8 **pFrames, unsigned int *offsets, unsigned int *lens, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	simple_rawsock_t *rawsock = (simple_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || pFrames == NULL || offsets == NULL || lens == NULL) {
+		AVB_LOG_ERROR("Getting RX frames; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	if (count > OPENAVB_RAWSOCK_RX_BURST_MAX)
+		count = OPENAVB_RAWSOCK_RX_BURST_MAX;
+	if (count == 0) {
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return 0;
+	}
+
+	if (timeout != OPENAVB_RAWSOCK_BLOCK) {
+		struct timespec ts;
+		struct pollfd pfd;
+
+		ts.tv_sec = timeout / MICROSECONDS_PER_SECOND;
+		ts.tv_nsec = (timeout % MICROSECONDS_PER_SECOND) * NANOSECONDS_PER_USEC;
+		pfd.fd = rawsock->sock;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		int ret = ppoll(&pfd, 1, &ts, NULL);
+		if (ret <= 0) {
+			if (ret < 0 && errno != EINTR) {
+				AVB_LOGF_ERROR("Getting RX frames; poll failed: %s", strerror(errno));
+			}
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return 0;
+		}
+	}
+
+	struct mmsghdr msgs[OPENAVB_RAWSOCK_RX_BURST_MAX];
+	struct iovec iovs[OPENAVB_RAWSOCK_RX_BURST_MAX];
+	U32 i;
+
+	memset(msgs, 0, count * sizeof(struct mmsghdr));
+	for (i = 0; i < count; i++) {
+		iovs[i].iov_base = rawsock->rxBurstBuffer[i];
+		iovs[i].iov_len = rawsock->base.frameSize;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	// Block for the first frame only, then take what is already queued
+	int flags = (timeout == OPENAVB_RAWSOCK_BLOCK) ? MSG_WAITFORONE : MSG_DONTWAIT;
+	int rcvd = recvmmsg(rawsock->sock, msgs, count, flags, NULL);
+	if (rcvd < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("recvmmsg failed: %s", strerror(errno));
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return -1;
+		}
+		rcvd = 0;
+	}
+
+	for (i = 0; i < (U32)rcvd; i++) {
+		pFrames[i] = rawsock->rxBurstBuffer[i];
+		offsets[i] = 0;
+		lens[i] = msgs[i].msg_len;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return rcvd;
+}
+
+// Busy poll the NIC queue when receiving
+bool simpleRawsockRxSetBusyPoll(void *pvRawsock, U32 usecBusyPoll)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	simple_rawsock_t *rawsock = (simple_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Setting busy poll; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	int val = usecBusyPoll;
+	if (setsockopt(rawsock->sock, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)) < 0) {
+		AVB_LOGF_WARNING("Setting busy poll; setsockopt(SO_BUSY_POLL) failed: %s", strerror(errno));
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	// Keep the NIC interrupts masked while we poll (kernel 5.11+)
+	val = (usecBusyPoll != 0);
+	if (setsockopt(rawsock->sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &val, sizeof(val)) < 0) {
+		AVB_LOGF_DEBUG("setsockopt(SO_PREFER_BUSY_POLL) failed: %s", strerror(errno));
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+}
+
 // Setup the rawsock to receive multicast packets
 bool simpleRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN])
 {
@@ -32,6 +32,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define SIMPLE_RAWSOCK_H
 
 #include "rawsock_impl.h"
+#include "cbs_rawsock.h"
 
 // State information for raw socket
 //
@@ -41,11 +42,33 @@ typedef struct {
 	// the underlying socket
 	int sock;
 
+	// software shaper, when the queue manager runs one for the interface,
+	// and the fwmark giving our SR class. ring_rawsock_t starts the same.
+	cbs_rawsock_t *pShaper;
+	U16 txMark;
+
 	// buffer for sending frames
 	U8 txBuffer[1518];
 
+	// buffers for sending a burst of frames with sendmmsg(), handed out
+	// in turn from txBurstNext
+	U8 txBurstBuffer[OPENAVB_RAWSOCK_TX_BURST_MAX][1518];
+	U32 txBurstNext;
+
 	// buffer for receiving frames
 	U8 rxBuffer[1518];
+
+	// buffers for receiving a burst of frames with recvmmsg()
+	U8 rxBurstBuffer[OPENAVB_RAWSOCK_RX_BURST_MAX][1518];
+
+	// Send frames with their launch time (SO_TXTIME)
+	bool bTxTime;
+
+	// Hardware TX timestamps: SO_TIMESTAMPING is set up, the next frame
+	// sent asks for one, and one was asked for and not read yet
+	bool bTxTsOn;
+	bool bTxTsNext;
+	bool bTxTsPending;
 } simple_rawsock_t;
 
 bool simpleAvbCheckInterface(const char *ifname, if_info_t *info);
@@ -64,15 +87,36 @@ U8* simpleRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len);
 // FQTSS creates a mark that includes the AVB class and stream index.
 bool simpleRawsockTxSetMark(void *pvRawsock, int mark);
 
+// Send frames with their launch time, using SO_TXTIME
+bool simpleRawsockTxSetLaunchTime(void *pvRawsock, bool enable);
+
+// Have the NIC timestamp the next frame sent
+bool simpleRawsockTxTimestampNext(void *pvRawsock);
+
+// Read the hardware TX timestamp asked for, once it has come back
+bool simpleRawsockTxTimestampGet(void *pvRawsock, U64 *pLocalNsec);
+
 // Pre-set the ethernet header information that will be used on TX frames
 bool simpleRawsockTxSetHdr(void *pvRawsock, hdr_info_t *pHdr);
 
 // Release a TX frame, and mark it as ready to send
 bool simpleRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64 timeNsec);
 
+// Get a burst of buffers to use for TX
+int simpleRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len);
+
+// Send a burst of TX frames with a single sendmmsg()
+int simpleRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count);
+
 // Get a RX frame
 U8* simpleRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len);
 
+// Get a burst of RX frames with a single recvmmsg()
+int simpleRawsockGetRxFrames(void *pvRawsock, U32 timeout, U8 **pFrames, unsigned int *offsets, unsigned int *lens, U32 count);
+
+// Busy poll the NIC queue when receiving
+bool simpleRawsockRxSetBusyPoll(void *pvRawsock, U32 usecBusyPoll);
+
 // Setup the rawsock to receive multicast packets
 bool simpleRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN]);
 
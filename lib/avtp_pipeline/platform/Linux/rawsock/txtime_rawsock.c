@@ -0,0 +1,122 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+#include "txtime_rawsock.h"
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <linux/net_tstamp.h>
+
+#include "openavb_platform.h"
+#include "openavb_time.h"
+#include "openavb_trace.h"
+
+#define	AVB_LOG_COMPONENT	"Raw Socket"
+#include "openavb_log.h"
+
+bool txtimeRawsockEnable(int sock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+#ifndef SO_TXTIME
+	AVB_LOG_WARNING("Enabling launch time; SO_TXTIME not supported by this build");
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return FALSE;
+#else
+	// The ETF qdisc only accepts CLOCK_TAI
+	struct sock_txtime txtime;
+	memset(&txtime, 0, sizeof(txtime));
+	txtime.clockid = CLOCK_TAI;
+	txtime.flags = 0;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) < 0) {
+		AVB_LOGF_WARNING("Enabling launch time; SO_TXTIME failed: %s", strerror(errno));
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return FALSE;
+	}
+
+	AVB_LOG_DEBUG("SO_TXTIME OK");
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return TRUE;
+#endif
+}
+
+// Calls between refreshes of the cached TAI offset when gPTP does not
+// publish update counts
+#define TXTIME_TAI_REFRESH_CALLS 1024
+
+static S64 x_txtimeTaiOffsetRead(void)
+{
+	// gPTP wall time is modelled against CLOCK_REALTIME by the time
+	// osal, so reading the two clocks back to back gives the offset.
+	struct timespec tai;
+	U64 wallNS = 0;
+
+	clock_gettime(CLOCK_TAI, &tai);
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &wallNS);
+	return (S64)((U64)tai.tv_sec * NANOSECONDS_PER_SECOND + tai.tv_nsec) - (S64)wallNS;
+}
+
+S64 txtimeRawsockTaiOffset(void)
+{
+	// The offset only moves when gPTP updates its model or the kernel
+	// steps a clock, so keep it per thread and re-read the clocks on a
+	// gPTP update or every TXTIME_TAI_REFRESH_CALLS calls.
+	static OPENAVB_THREAD_LOCAL S64 taiOffset;
+	static OPENAVB_THREAD_LOCAL U32 taiUpdateCount;
+	static OPENAVB_THREAD_LOCAL U32 taiCalls;
+	U32 updateCount = taiUpdateCount;
+
+	if (!osalAVBTimeGetUpdate(&updateCount, NULL)) {
+		updateCount = taiUpdateCount;
+	}
+	if (taiCalls == 0 || updateCount != taiUpdateCount) {
+		taiOffset = x_txtimeTaiOffsetRead();
+		taiUpdateCount = updateCount;
+		taiCalls = TXTIME_TAI_REFRESH_CALLS;
+	}
+	taiCalls--;
+	return taiOffset;
+}
+
+void txtimeRawsockSetCmsg(struct msghdr *msg, U8 *cbuf, U64 txtime)
+{
+#ifdef SO_TXTIME
+	memset(cbuf, 0, TXTIME_CMSG_SPACE);
+	msg->msg_control = cbuf;
+	msg->msg_controllen = TXTIME_CMSG_SPACE;
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_TXTIME;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(U64));
+	memcpy(CMSG_DATA(cmsg), &txtime, sizeof(U64));
+#endif
+}
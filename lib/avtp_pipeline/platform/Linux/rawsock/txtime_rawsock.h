@@ -0,0 +1,57 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Launch time for packet socket rawsocks using SO_TXTIME.
+* Frames carry their launch time in a SCM_TXTIME control message, and an
+* ETF qdisc on the TX queue holds them back until that time.
+*/
+
+#ifndef TXTIME_RAWSOCK_H
+#define TXTIME_RAWSOCK_H
+
+#include "openavb_types.h"
+#include <sys/socket.h>
+
+// Room for one SCM_TXTIME control message
+#define TXTIME_CMSG_SPACE	CMSG_SPACE(sizeof(U64))
+
+// Turn on SO_TXTIME for the socket; FALSE if the kernel doesn't support it
+bool txtimeRawsockEnable(int sock);
+
+// Offset to add to a gPTP time to get the CLOCK_TAI time the ETF qdisc
+// expects. Cached per thread and refreshed on gPTP updates.
+S64 txtimeRawsockTaiOffset(void);
+
+// Attach a SCM_TXTIME control message to msg using cbuf
+// (TXTIME_CMSG_SPACE bytes) as the control buffer
+void txtimeRawsockSetCmsg(struct msghdr *msg, U8 *cbuf, U64 txtime);
+
+#endif // TXTIME_RAWSOCK_H
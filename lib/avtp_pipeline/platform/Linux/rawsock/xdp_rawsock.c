@@ -0,0 +1,955 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Raw socket implementation on AF_XDP.
+*
+* Frames are sent and received through an XSK socket bound to one device
+* queue. Frame buffers live in a UMEM area shared with the kernel and, on
+* drivers that support it, the NIC itself (zero-copy). For RX a small XDP
+* program, shared by all rawsocks of the process on the same interface,
+* redirects frames of our ethertype to the socket bound to the queue they
+* arrived on. Everything else is passed on to the kernel stack.
+*/
+
+#include "xdp_rawsock.h"
+#include "simple_rawsock.h"
+#include <pthread.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/if_packet.h>
+#include <linux/if_xdp.h>
+#include <linux/bpf.h>
+
+#include "openavb_trace.h"
+
+#define	AVB_LOG_COMPONENT	"Raw Socket"
+#include "openavb_log.h"
+
+#ifndef AF_XDP
+#define AF_XDP	44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP	283
+#endif
+
+// XDP program and XSKMAP for one interface
+typedef struct xdp_prog {
+	struct xdp_prog *pNext;
+	int ifindex;
+	U16 ethertype;
+	int mapFd;
+	int progFd;
+	int linkFd;
+	int refCount;
+} xdp_prog_t;
+
+static xdp_prog_t *gXdpProgs = NULL;
+static pthread_mutex_t gXdpProgsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int x_xdpBpf(int cmd, union bpf_attr *pAttr)
+{
+	return syscall(__NR_bpf, cmd, pAttr, sizeof(*pAttr));
+}
+
+#define XDP_INSN(CODE, DST, SRC, OFF, IMM) \
+	{ .code = (CODE), .dst_reg = (DST), .src_reg = (SRC), .off = (OFF), .imm = (IMM) }
+
+// Load the program that redirects frames of ethertype (plain or VLAN tagged) to the
+// socket in mapFd at the receive queue index, and passes everything else.
+static int x_xdpLoadProg(int mapFd, U16 ethertype)
+{
+	S32 et = htons(ethertype);
+	S32 vlan = htons(ETHERTYPE_8021Q);
+
+	struct bpf_insn insns[] = {
+		/*  0 */ XDP_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0),
+		/*  1 */ XDP_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, data), 0),
+		/*  2 */ XDP_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_3, BPF_REG_6, offsetof(struct xdp_md, data_end), 0),
+		/*  3 */ XDP_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0),
+		/*  4 */ XDP_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, sizeof(eth_vlan_hdr_t)),
+		/*  5 */ XDP_INSN(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 12, 0),		// short frame: pass
+		/*  6 */ XDP_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2, offsetof(eth_hdr_t, ethertype), 0),
+		/*  7 */ XDP_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_5, 0, 2, vlan),				// tagged: check inner
+		/*  8 */ XDP_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_5, 0, 3, et),				// ours: redirect
+		/*  9 */ XDP_INSN(BPF_JMP | BPF_JA, 0, 0, 8, 0),									// pass
+		/* 10 */ XDP_INSN(BPF_LDX | BPF_H | BPF_MEM, BPF_REG_5, BPF_REG_2, offsetof(eth_vlan_hdr_t, ethertype), 0),
+		/* 11 */ XDP_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, 6, et),				// not ours: pass
+		/* 12 */ XDP_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, mapFd),
+		/* 13 */ XDP_INSN(0, 0, 0, 0, 0),
+		/* 14 */ XDP_INSN(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, rx_queue_index), 0),
+		/* 15 */ XDP_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS),		// no socket on the queue: pass
+		/* 16 */ XDP_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),
+		/* 17 */ XDP_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+		/* 18 */ XDP_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS),
+		/* 19 */ XDP_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+	};
+
+	static char log[4096];
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = (U64)(uintptr_t)insns;
+	attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+	attr.license = (U64)(uintptr_t)"Dual BSD/GPL";
+	attr.log_buf = (U64)(uintptr_t)log;
+	attr.log_size = sizeof(log);
+	attr.log_level = 1;
+
+	log[0] = '\0';
+	int fd = x_xdpBpf(BPF_PROG_LOAD, &attr);
+	if (fd < 0) {
+		AVB_LOGF_ERROR("Loading XDP program failed: %s %s", strerror(errno), log);
+	}
+	return fd;
+}
+
+// Get the XDP program of an interface, loading and attaching it on first use
+static xdp_prog_t *x_xdpProgAcquire(int ifindex, U16 ethertype)
+{
+	pthread_mutex_lock(&gXdpProgsMutex);
+
+	xdp_prog_t *pProg;
+	for (pProg = gXdpProgs; pProg; pProg = pProg->pNext) {
+		if (pProg->ifindex == ifindex) {
+			if (pProg->ethertype != ethertype) {
+				AVB_LOGF_ERROR("XDP program on interface %d already serves ethertype %x", ifindex, pProg->ethertype);
+				pthread_mutex_unlock(&gXdpProgsMutex);
+				return NULL;
+			}
+			pProg->refCount++;
+			pthread_mutex_unlock(&gXdpProgsMutex);
+			return pProg;
+		}
+	}
+
+	pProg = calloc(1, sizeof(xdp_prog_t));
+	if (!pProg) {
+		AVB_LOG_ERROR("Creating XDP program; malloc failed");
+		pthread_mutex_unlock(&gXdpProgsMutex);
+		return NULL;
+	}
+	pProg->ifindex = ifindex;
+	pProg->ethertype = ethertype;
+	pProg->progFd = -1;
+	pProg->linkFd = -1;
+
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(U32);
+	attr.value_size = sizeof(int);
+	attr.max_entries = XDP_RAWSOCK_MAX_QUEUES;
+	pProg->mapFd = x_xdpBpf(BPF_MAP_CREATE, &attr);
+	if (pProg->mapFd < 0) {
+		AVB_LOGF_ERROR("Creating XSKMAP failed: %s", strerror(errno));
+		free(pProg);
+		pthread_mutex_unlock(&gXdpProgsMutex);
+		return NULL;
+	}
+
+	pProg->progFd = x_xdpLoadProg(pProg->mapFd, ethertype);
+	if (pProg->progFd >= 0) {
+		// A link detaches the program when the last fd to it is closed,
+		// so nothing is left behind if we crash
+		memset(&attr, 0, sizeof(attr));
+		attr.link_create.prog_fd = pProg->progFd;
+		attr.link_create.target_ifindex = ifindex;
+		attr.link_create.attach_type = BPF_XDP;
+		pProg->linkFd = x_xdpBpf(BPF_LINK_CREATE, &attr);
+		if (pProg->linkFd < 0) {
+			AVB_LOGF_ERROR("Attaching XDP program to interface %d failed: %s", ifindex, strerror(errno));
+		}
+	}
+	if (pProg->linkFd < 0) {
+		if (pProg->progFd >= 0)
+			close(pProg->progFd);
+		close(pProg->mapFd);
+		free(pProg);
+		pthread_mutex_unlock(&gXdpProgsMutex);
+		return NULL;
+	}
+
+	pProg->refCount = 1;
+	pProg->pNext = gXdpProgs;
+	gXdpProgs = pProg;
+
+	pthread_mutex_unlock(&gXdpProgsMutex);
+	return pProg;
+}
+
+static void x_xdpProgRelease(xdp_prog_t *pProg)
+{
+	pthread_mutex_lock(&gXdpProgsMutex);
+
+	if (--pProg->refCount > 0) {
+		pthread_mutex_unlock(&gXdpProgsMutex);
+		return;
+	}
+
+	xdp_prog_t **ppProg;
+	for (ppProg = &gXdpProgs; *ppProg; ppProg = &(*ppProg)->pNext) {
+		if (*ppProg == pProg) {
+			*ppProg = pProg->pNext;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&gXdpProgsMutex);
+
+	close(pProg->linkFd);
+	close(pProg->progFd);
+	close(pProg->mapFd);
+	free(pProg);
+}
+
+static bool x_xdpMapUpdate(xdp_prog_t *pProg, U32 queue, int sock)
+{
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = pProg->mapFd;
+	attr.key = (U64)(uintptr_t)&queue;
+	if (sock >= 0) {
+		attr.value = (U64)(uintptr_t)&sock;
+		attr.flags = BPF_ANY;
+		return x_xdpBpf(BPF_MAP_UPDATE_ELEM, &attr) == 0;
+	}
+	return x_xdpBpf(BPF_MAP_DELETE_ELEM, &attr) == 0;
+}
+
+// Map one of the rings shared with the kernel
+static bool x_xdpMapRing(xdp_rawsock_t *rawsock, xdp_ring_t *pRing, struct xdp_ring_offset *pOff, U32 size, size_t descSize, off_t pgoff)
+{
+	pRing->mapSize = pOff->desc + size * descSize;
+	pRing->pMap = mmap(NULL, pRing->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, rawsock->sock, pgoff);
+	if (pRing->pMap == MAP_FAILED) {
+		AVB_LOGF_ERROR("Creating rawsock; mmap XDP ring failed: %s", strerror(errno));
+		pRing->pMap = NULL;
+		return FALSE;
+	}
+	pRing->pProducer = (U32 *)((U8 *)pRing->pMap + pOff->producer);
+	pRing->pConsumer = (U32 *)((U8 *)pRing->pMap + pOff->consumer);
+	pRing->pFlags = (U32 *)((U8 *)pRing->pMap + pOff->flags);
+	pRing->pDesc = (U8 *)pRing->pMap + pOff->desc;
+	pRing->size = size;
+	pRing->mask = size - 1;
+	return TRUE;
+}
+
+static void x_xdpUnmapRing(xdp_ring_t *pRing)
+{
+	if (pRing->pMap) {
+		munmap(pRing->pMap, pRing->mapSize);
+		pRing->pMap = NULL;
+	}
+}
+
+// Hand RX chunks to the kernel
+static void x_xdpFill(xdp_rawsock_t *rawsock, U64 addr)
+{
+	U32 prod = *rawsock->fill.pProducer;
+	((U64 *)rawsock->fill.pDesc)[prod & rawsock->fill.mask] = addr;
+	OPENAVB_ATOMIC_STORE_RELEASE(rawsock->fill.pProducer, prod + 1);
+}
+
+// Move the TX chunks the kernel is done with back to the free list
+static void x_xdpReclaimTx(xdp_rawsock_t *rawsock)
+{
+	U32 cons = *rawsock->comp.pConsumer;
+	U32 prod = OPENAVB_ATOMIC_LOAD_ACQUIRE(rawsock->comp.pProducer);
+	if (prod == cons)
+		return;
+
+	while (cons != prod) {
+		rawsock->pTxFree[rawsock->txFreeCount++] = ((U64 *)rawsock->comp.pDesc)[cons & rawsock->comp.mask];
+		cons++;
+	}
+	OPENAVB_ATOMIC_STORE_RELEASE(rawsock->comp.pConsumer, cons);
+}
+
+// Tell the kernel to process the TX ring, if it wants to be told
+static int x_xdpKickTx(xdp_rawsock_t *rawsock)
+{
+	if (rawsock->bNeedWakeup && !(OPENAVB_ATOMIC_LOAD_RELAXED(rawsock->tx.pFlags) & XDP_RING_NEED_WAKEUP))
+		return 0;
+
+	int ret = sendto(rawsock->sock, NULL, 0, MSG_DONTWAIT, NULL, 0);
+	if (ret < 0 && errno != EAGAIN && errno != EBUSY && errno != ENOBUFS && errno != EINTR) {
+		IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("Send failed: %s", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+// Queue a frame on the TX ring; published by the caller
+static bool x_xdpQueueTx(xdp_rawsock_t *rawsock, U32 slot, U8 *pBuffer, unsigned int len)
+{
+	U64 addr = pBuffer - rawsock->pUmem;
+	if (pBuffer < rawsock->pUmem || addr >= rawsock->umemSize || len > rawsock->base.frameSize) {
+		AVB_LOG_ERROR("Marking TX frame ready; bad frame");
+		return FALSE;
+	}
+
+	struct xdp_desc *pDesc = &((struct xdp_desc *)rawsock->tx.pDesc)[slot & rawsock->tx.mask];
+	pDesc->addr = addr;
+	pDesc->len = len;
+	pDesc->options = 0;
+	return TRUE;
+}
+
+// Open a rawsock for TX or RX
+void* xdpRawsockOpen(xdp_rawsock_t* rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	AVB_LOGF_DEBUG("Open, rx=%d, tx=%d, ethertype=%x size=%d, num=%d",	rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
+	baseRawsockOpen(&rawsock->base, ifname, rx_mode, tx_mode, ethertype, frame_size, num_frames);
+
+	rawsock->sock = -1;
+	rawsock->mcastSock = -1;
+
+	// Split off the queue number
+	char devname[IFNAMSIZ] = {0};
+	const char *at = strchr(ifname, '@');
+	size_t nameLen = at ? (size_t)(at - ifname) : strlen(ifname);
+	if (nameLen >= IFNAMSIZ) {
+		AVB_LOGF_ERROR("Creating rawsock; bad interface name: %s", ifname);
+		free(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+	memcpy(devname, ifname, nameLen);
+	rawsock->queue = at ? strtoul(at + 1, NULL, 0) : 0;
+	if (rawsock->queue >= XDP_RAWSOCK_MAX_QUEUES) {
+		AVB_LOGF_ERROR("Creating rawsock; queue %u out of range", rawsock->queue);
+		free(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Get info about the network device
+	if (!simpleAvbCheckInterface(devname, &(rawsock->base.ifInfo))) {
+		AVB_LOGF_ERROR("Creating rawsock; bad interface name: %s", devname);
+		free(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Deal with frame size.
+	if (rawsock->base.frameSize == 0) {
+		// use interface MTU as max frames size, if none specified
+		rawsock->base.frameSize = rawsock->base.ifInfo.mtu + ETH_HLEN + VLAN_HLEN;
+	}
+	else if (rawsock->base.frameSize > rawsock->base.ifInfo.mtu + ETH_HLEN + VLAN_HLEN) {
+		AVB_LOG_ERROR("Creating raswsock; requested frame size exceeds MTU");
+		free(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+	if (rawsock->base.frameSize > XDP_RAWSOCK_CHUNK_SIZE - XDP_PACKET_HEADROOM) {
+		AVB_LOG_ERROR("Creating raswsock; frame size exceeds XDP chunk size");
+		free(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Prepare default Ethernet header.
+	rawsock->base.ethHdrLen = sizeof(eth_hdr_t);
+	memset(&(rawsock->base.ethHdr.notag.dhost), 0xFF, ETH_ALEN);
+	memcpy(&(rawsock->base.ethHdr.notag.shost), &(rawsock->base.ifInfo.mac), ETH_ALEN);
+	rawsock->base.ethHdr.notag.ethertype = htons(rawsock->base.ethertype);
+
+	// Ring sizes must be a power of 2; RX and TX each get that many chunks
+	U32 ringSize = 1;
+	while (ringSize < (num_frames ? num_frames : XDP_RAWSOCK_DEFAULT_FRAMES))
+		ringSize <<= 1;
+	U32 rxFrames = rx_mode ? ringSize : 0;
+	rawsock->txFrameCount = tx_mode ? ringSize : 0;
+	rawsock->frameCount = rxFrames + rawsock->txFrameCount;
+
+	// Create socket
+	rawsock->sock = socket(AF_XDP, SOCK_RAW, 0);
+	if (rawsock->sock == -1) {
+		AVB_LOGF_ERROR("Creating rawsock; opening AF_XDP socket: %s", strerror(errno));
+		xdpRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Register the UMEM
+	rawsock->umemSize = (size_t)rawsock->frameCount * XDP_RAWSOCK_CHUNK_SIZE;
+	void *pUmem = NULL;
+	if (posix_memalign(&pUmem, getpagesize(), rawsock->umemSize) != 0) {
+		AVB_LOG_ERROR("Creating rawsock; UMEM allocation failed");
+		xdpRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+	rawsock->pUmem = pUmem;
+	memset(rawsock->pUmem, 0, rawsock->umemSize);
+
+	struct xdp_umem_reg umemReg;
+	memset(&umemReg, 0, sizeof(umemReg));
+	umemReg.addr = (U64)(uintptr_t)rawsock->pUmem;
+	umemReg.len = rawsock->umemSize;
+	umemReg.chunk_size = XDP_RAWSOCK_CHUNK_SIZE;
+	umemReg.headroom = 0;
+	if (setsockopt(rawsock->sock, SOL_XDP, XDP_UMEM_REG, &umemReg, sizeof(umemReg)) < 0) {
+		AVB_LOGF_ERROR("Creating rawsock; XDP_UMEM_REG failed: %s", strerror(errno));
+		xdpRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// Ask for the rings. The kernel wants fill and completion rings even if one direction is unused.
+	if (setsockopt(rawsock->sock, SOL_XDP, XDP_UMEM_FILL_RING, &ringSize, sizeof(ringSize)) < 0
+		|| setsockopt(rawsock->sock, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ringSize, sizeof(ringSize)) < 0
+		|| (rx_mode && setsockopt(rawsock->sock, SOL_XDP, XDP_RX_RING, &ringSize, sizeof(ringSize)) < 0)
+		|| (tx_mode && setsockopt(rawsock->sock, SOL_XDP, XDP_TX_RING, &ringSize, sizeof(ringSize)) < 0)) {
+		AVB_LOGF_ERROR("Creating rawsock; setting XDP ring size failed: %s", strerror(errno));
+		xdpRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	struct xdp_mmap_offsets off;
+	socklen_t optlen = sizeof(off);
+	if (getsockopt(rawsock->sock, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0) {
+		AVB_LOGF_ERROR("Creating rawsock; XDP_MMAP_OFFSETS failed: %s", strerror(errno));
+		xdpRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	if (!x_xdpMapRing(rawsock, &rawsock->fill, &off.fr, ringSize, sizeof(U64), XDP_UMEM_PGOFF_FILL_RING)
+		|| !x_xdpMapRing(rawsock, &rawsock->comp, &off.cr, ringSize, sizeof(U64), XDP_UMEM_PGOFF_COMPLETION_RING)
+		|| (rx_mode && !x_xdpMapRing(rawsock, &rawsock->rx, &off.rx, ringSize, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING))
+		|| (tx_mode && !x_xdpMapRing(rawsock, &rawsock->tx, &off.tx, ringSize, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING))) {
+		xdpRawsockClose(rawsock);
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return NULL;
+	}
+
+	// RX chunks come first in the UMEM, then TX chunks
+	U32 i;
+	for (i = 0; i < rxFrames; i++) {
+		x_xdpFill(rawsock, (U64)i * XDP_RAWSOCK_CHUNK_SIZE);
+	}
+	if (tx_mode) {
+		rawsock->pTxFree = calloc(rawsock->txFrameCount, sizeof(U64));
+		if (!rawsock->pTxFree) {
+			AVB_LOG_ERROR("Creating rawsock; malloc failed");
+			xdpRawsockClose(rawsock);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
+		for (i = 0; i < rawsock->txFrameCount; i++) {
+			rawsock->pTxFree[i] = (U64)(rxFrames + i) * XDP_RAWSOCK_CHUNK_SIZE;
+		}
+		rawsock->txFreeCount = rawsock->txFrameCount;
+	}
+
+	// Bind to the device queue, zero-copy if the driver can do it
+	struct sockaddr_xdp sxdp;
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = rawsock->base.ifInfo.index;
+	sxdp.sxdp_queue_id = rawsock->queue;
+	sxdp.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+	rawsock->bZeroCopy = TRUE;
+	rawsock->bNeedWakeup = TRUE;
+	if (bind(rawsock->sock, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+		AVB_LOGF_DEBUG("Zero-copy bind to %s queue %u failed (%s); trying copy mode", devname, rawsock->queue, strerror(errno));
+		rawsock->bZeroCopy = FALSE;
+		sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+		if (bind(rawsock->sock, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+			rawsock->bNeedWakeup = FALSE;
+			sxdp.sxdp_flags = XDP_COPY;
+			if (bind(rawsock->sock, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+				AVB_LOGF_ERROR("Creating rawsock; bind to %s queue %u failed: %s", devname, rawsock->queue, strerror(errno));
+				xdpRawsockClose(rawsock);
+				AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+				return NULL;
+			}
+		}
+	}
+	AVB_LOGF_INFO("AF_XDP socket on %s queue %u, %s mode", devname, rawsock->queue, rawsock->bZeroCopy ? "zero-copy" : "copy");
+
+	if (rx_mode) {
+		// Steer our ethertype to the socket
+		rawsock->pProg = x_xdpProgAcquire(rawsock->base.ifInfo.index, rawsock->base.ethertype);
+		if (!rawsock->pProg || !x_xdpMapUpdate(rawsock->pProg, rawsock->queue, rawsock->sock)) {
+			AVB_LOGF_ERROR("Creating rawsock; XDP redirect setup failed: %s", strerror(errno));
+			xdpRawsockClose(rawsock);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
+
+		// Packet socket for multicast memberships; protocol 0 so it receives nothing
+		rawsock->mcastSock = socket(PF_PACKET, SOCK_RAW, 0);
+		if (rawsock->mcastSock == -1) {
+			AVB_LOGF_ERROR("Creating rawsock; opening multicast socket: %s", strerror(errno));
+			xdpRawsockClose(rawsock);
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+			return NULL;
+		}
+	}
+
+	// fill virtual functions table
+	rawsock_cb_t *cb = &rawsock->base.cb;
+	cb->close = xdpRawsockClose;
+	cb->getTxFrame = xdpRawsockGetTxFrame;
+	cb->relTxFrame = xdpRawsockRelTxFrame;
+	cb->txFrameReady = xdpRawsockTxFrameReady;
+	cb->send = xdpRawsockSend;
+	cb->getTxFrames = xdpRawsockGetTxFrames;
+	cb->txFramesSend = xdpRawsockTxFramesSend;
+	cb->txSetMark = xdpRawsockTxSetMark;
+	cb->txBufLevel = xdpRawsockTxBufLevel;
+	cb->rxBufLevel = xdpRawsockRxBufLevel;
+	cb->getRxFrame = xdpRawsockGetRxFrame;
+	cb->relRxFrame = xdpRawsockRelRxFrame;
+	cb->rxMulticast = xdpRawsockRxMulticast;
+	cb->getSocket = xdpRawsockGetSocket;
+	cb->getTXOutOfBuffers = xdpRawsockGetTXOutOfBuffers;
+	cb->getTXOutOfBuffersCyclic = xdpRawsockGetTXOutOfBuffersCyclic;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock;
+}
+
+// Close the rawsock
+void xdpRawsockClose(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (rawsock) {
+		if (rawsock->pProg) {
+			x_xdpMapUpdate(rawsock->pProg, rawsock->queue, -1);
+			x_xdpProgRelease(rawsock->pProg);
+			rawsock->pProg = NULL;
+		}
+		if (rawsock->mcastSock != -1) {
+			close(rawsock->mcastSock);
+			rawsock->mcastSock = -1;
+		}
+		x_xdpUnmapRing(&rawsock->fill);
+		x_xdpUnmapRing(&rawsock->comp);
+		x_xdpUnmapRing(&rawsock->rx);
+		x_xdpUnmapRing(&rawsock->tx);
+		// close the socket before the UMEM goes away
+		if (rawsock->sock != -1) {
+			close(rawsock->sock);
+			rawsock->sock = -1;
+		}
+		free(rawsock->pUmem);
+		rawsock->pUmem = NULL;
+		free(rawsock->pTxFree);
+		rawsock->pTxFree = NULL;
+	}
+
+	baseRawsockClose(rawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+}
+
+// Get a buffer from the UMEM to use for TX
+U8* xdpRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || len == NULL) {
+		AVB_LOG_ERROR("Getting TX frame; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return NULL;
+	}
+
+	x_xdpReclaimTx(rawsock);
+	while (rawsock->txFreeCount == 0) {
+		if (!blocking) {
+			++rawsock->txOutOfBuffer;
+			++rawsock->txOutOfBufferCyclic;
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+
+		// Completions only come back once the kernel has been told to send
+		x_xdpKickTx(rawsock);
+		struct pollfd pfd;
+		pfd.fd = rawsock->sock;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		poll(&pfd, 1, 1);
+		x_xdpReclaimTx(rawsock);
+	}
+
+	U8 *pBuffer = rawsock->pUmem + rawsock->pTxFree[--rawsock->txFreeCount];
+
+	// Remind client how big the frame buffer is
+	*len = rawsock->base.frameSize;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return pBuffer;
+}
+
+// Release a TX frame, without marking it as ready to send
+bool xdpRawsockRelTxFrame(void *pvRawsock, U8 *pBuffer)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pBuffer == NULL || rawsock->txFreeCount >= rawsock->txFrameCount) {
+		AVB_LOG_ERROR("Releasing TX frame; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	rawsock->pTxFree[rawsock->txFreeCount++] = pBuffer - rawsock->pUmem;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Release a TX frame, and mark it as ready to send
+bool xdpRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64 timeNsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Marking TX frame ready; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	if (timeNsec) {
+		IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is unsupported in xdp_rawsock");
+	}
+
+	// The TX ring holds all our TX chunks, so there is always a free slot
+	U32 prod = *rawsock->tx.pProducer;
+	if (!x_xdpQueueTx(rawsock, prod, pBuffer, len)) {
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+	OPENAVB_ATOMIC_STORE_RELEASE(rawsock->tx.pProducer, prod + 1);
+	rawsock->txReady++;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Send all packets that are ready (i.e. tell kernel to send them)
+int xdpRawsockSend(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Send; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	int sent = rawsock->txReady;
+	if (sent > 0 && x_xdpKickTx(rawsock) < 0) {
+		sent = -1;
+	}
+	else {
+		AVB_LOGF_VERBOSE("Sent %d frames", sent);
+		rawsock->txReady = 0;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return sent;
+}
+
+// Get a burst of buffers to use for TX
+int xdpRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || len == NULL) {
+		AVB_LOG_ERROR("Getting TX frames; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	// Only wait for the first buffer; hand back whatever else is free.
+	U32 i;
+	for (i = 0; i < count; i++) {
+		if (i > 0 && rawsock->txFreeCount == 0)
+			break;
+		pFrames[i] = xdpRawsockGetTxFrame(pvRawsock, blocking && i == 0, len);
+		if (!pFrames[i])
+			break;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return i;
+}
+
+// Queue a burst of TX frames and send them with a single syscall
+int xdpRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || lens == NULL) {
+		AVB_LOG_ERROR("Sending TX frames; invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	U32 prod = *rawsock->tx.pProducer;
+	U32 i;
+	for (i = 0; i < count; i++) {
+		if (timeNsec && timeNsec[i]) {
+			IF_LOG_INTERVAL(1000) AVB_LOG_WARNING("launch time is unsupported in xdp_rawsock");
+		}
+		if (!x_xdpQueueTx(rawsock, prod + i, pFrames[i], lens[i]))
+			break;
+	}
+
+	// Publish the whole burst at once
+	if (i > 0) {
+		OPENAVB_ATOMIC_STORE_RELEASE(rawsock->tx.pProducer, prod + i);
+		rawsock->txReady += i;
+		xdpRawsockSend(pvRawsock);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return i;
+}
+
+// The firewall mark is not used; AF_XDP frames bypass the qdisc
+bool xdpRawsockTxSetMark(void *pvRawsock, int mark)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Setting TX mark; invalid argument passed");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	// Shaping has to come from the hardware queue the socket is bound to
+	AVB_LOGF_INFO("SO_MARK=%d ignored; AF_XDP frames bypass the qdisc, shape queue %u in hardware", mark, rawsock->queue);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Count used TX buffers
+int xdpRawsockTxBufLevel(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("getting buffer level; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	x_xdpReclaimTx(rawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return rawsock->txFrameCount - rawsock->txFreeCount;
+}
+
+// Count received frames not yet handed to the client
+int xdpRawsockRxBufLevel(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("getting buffer level; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	int level = OPENAVB_ATOMIC_LOAD_ACQUIRE(rawsock->rx.pProducer) - *rawsock->rx.pConsumer;
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return level;
+}
+
+// Get a RX frame
+U8* xdpRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock) || offset == NULL || len == NULL) {
+		AVB_LOG_ERROR("Getting RX frame; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return NULL;
+	}
+
+	U32 cons = *rawsock->rx.pConsumer;
+	if (OPENAVB_ATOMIC_LOAD_ACQUIRE(rawsock->rx.pProducer) == cons) {
+		// Nothing there; wait for the kernel. poll() also wakes the driver
+		// up to refill its queue from the fill ring.
+		struct pollfd pfd;
+		pfd.fd = rawsock->sock;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		int msec = -1;
+		if (timeout != OPENAVB_RAWSOCK_BLOCK) {
+			msec = (timeout + MICROSECONDS_PER_MSEC - 1) / MICROSECONDS_PER_MSEC;
+		}
+		int ret = poll(&pfd, 1, msec);
+		if (ret < 0 && errno != EINTR) {
+			AVB_LOGF_ERROR("Getting RX frame; poll failed: %s", strerror(errno));
+		}
+		if (OPENAVB_ATOMIC_LOAD_ACQUIRE(rawsock->rx.pProducer) == cons) {
+			AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+			return NULL;
+		}
+	}
+
+	struct xdp_desc *pDesc = &((struct xdp_desc *)rawsock->rx.pDesc)[cons & rawsock->rx.mask];
+	U8 *pBuffer = rawsock->pUmem + pDesc->addr;
+	*offset = 0;
+	*len = pDesc->len;
+
+	// The chunk belongs to us until it goes back on the fill ring
+	OPENAVB_ATOMIC_STORE_RELEASE(rawsock->rx.pConsumer, cons + 1);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return pBuffer;
+}
+
+// Release a RX frame held by the client
+bool xdpRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || pBuffer < rawsock->pUmem || pBuffer >= rawsock->pUmem + rawsock->umemSize) {
+		AVB_LOG_ERROR("Releasing RX frame; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	// Frame data starts after the XDP headroom; hand back the whole chunk
+	U64 addr = (pBuffer - rawsock->pUmem) & ~((U64)XDP_RAWSOCK_CHUNK_SIZE - 1);
+	x_xdpFill(rawsock, addr);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Setup the rawsock to receive multicast packets
+bool xdpRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+	if (!VALID_RX_RAWSOCK(rawsock)) {
+		AVB_LOG_ERROR("Setting multicast; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	// The membership only opens the MAC filter of the NIC; which frames
+	// reach us is decided by the queue they are steered to
+	struct packet_mreq mreq;
+	memset(&mreq, 0, sizeof(struct packet_mreq));
+	mreq.mr_ifindex = rawsock->base.ifInfo.index;
+	mreq.mr_type = PACKET_MR_MULTICAST;
+	mreq.mr_alen = ETH_ALEN;
+	memcpy(&mreq.mr_address, addr, ETH_ALEN);
+
+	int action = (add_membership ? PACKET_ADD_MEMBERSHIP : PACKET_DROP_MEMBERSHIP);
+	if (setsockopt(rawsock->mcastSock, SOL_PACKET, action, (void*)&mreq, sizeof(struct packet_mreq)) < 0) {
+		AVB_LOGF_ERROR("Setting multicast; setsockopt(%s) failed: %s",
+					   (add_membership ? "PACKET_ADD_MEMBERSHIP" : "PACKET_DROP_MEMBERSHIP"),
+					   strerror(errno));
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return FALSE;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return TRUE;
+}
+
+// Get the socket used for this rawsock; can be used for poll/select
+int xdpRawsockGetSocket(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+	if (!rawsock) {
+		AVB_LOG_ERROR("Getting socket; invalid arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+		return -1;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return rawsock->sock;
+}
+
+unsigned long xdpRawsockGetTXOutOfBuffers(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	unsigned long counter = 0;
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if(VALID_TX_RAWSOCK(rawsock)) {
+		counter = rawsock->txOutOfBuffer;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return counter;
+}
+
+unsigned long xdpRawsockGetTXOutOfBuffersCyclic(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+	unsigned long counter = 0;
+	xdp_rawsock_t *rawsock = (xdp_rawsock_t*)pvRawsock;
+
+	if(VALID_TX_RAWSOCK(rawsock)) {
+		counter = rawsock->txOutOfBufferCyclic;
+		rawsock->txOutOfBufferCyclic = 0;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return counter;
+}
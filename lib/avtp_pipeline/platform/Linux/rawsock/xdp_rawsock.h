@@ -0,0 +1,155 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+#ifndef XDP_RAWSOCK_H
+#define XDP_RAWSOCK_H
+
+#include "rawsock_impl.h"
+
+// Size of each UMEM chunk. One frame per chunk; must be 2048 or 4096.
+#define XDP_RAWSOCK_CHUNK_SIZE		2048
+
+// Frames used when the caller does not ask for a count
+#define XDP_RAWSOCK_DEFAULT_FRAMES	512
+
+// Queues covered by the XSKMAP of the per interface XDP program
+#define XDP_RAWSOCK_MAX_QUEUES		64
+
+// One of the four rings shared with the kernel
+typedef struct {
+	U32 *pProducer;
+	U32 *pConsumer;
+	U32 *pFlags;
+	void *pDesc;
+	U32 size;
+	U32 mask;
+	void *pMap;
+	size_t mapSize;
+} xdp_ring_t;
+
+struct xdp_prog;
+
+// State information for raw socket
+//
+typedef struct {
+	base_rawsock_t base;
+
+	// the AF_XDP socket
+	int sock;
+
+	// packet socket, only used to join multicast groups
+	int mcastSock;
+
+	// device queue the socket is bound to
+	U32 queue;
+
+	// XDP program redirecting our ethertype to the socket (RX only)
+	struct xdp_prog *pProg;
+
+	// frame memory shared with the kernel (and the NIC in zero-copy mode)
+	U8 *pUmem;
+	size_t umemSize;
+	U32 frameCount;
+
+	xdp_ring_t fill;
+	xdp_ring_t comp;
+	xdp_ring_t rx;
+	xdp_ring_t tx;
+
+	// bound with XDP_ZEROCOPY
+	bool bZeroCopy;
+	// kernel only needs a syscall when it sets XDP_RING_NEED_WAKEUP
+	bool bNeedWakeup;
+
+	// UMEM addresses of the TX frames not owned by the client or the kernel
+	U64 *pTxFree;
+	U32 txFreeCount;
+	U32 txFrameCount;
+	// frames queued on the TX ring since the last send
+	U32 txReady;
+
+	// Number of TX buffers we experienced problems with
+	unsigned long txOutOfBuffer;
+	// Number of TX buffers we experienced problems with from the time when last stats being displayed
+	unsigned long txOutOfBufferCyclic;
+} xdp_rawsock_t;
+
+// Open a rawsock for TX or RX.
+// ifname may carry the device queue to bind to (ie: "eth0@2"), otherwise queue 0 is used.
+// Each rawsock needs a queue of its own; steer the stream to it with an ethtool flow rule.
+void* xdpRawsockOpen(xdp_rawsock_t *rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames);
+
+// Close the rawsock
+void xdpRawsockClose(void *pvRawsock);
+
+// Get a buffer from the UMEM to use for TX
+U8* xdpRawsockGetTxFrame(void *pvRawsock, bool blocking, unsigned int *len);
+
+// Release a TX frame, without marking it as ready to send
+bool xdpRawsockRelTxFrame(void *pvRawsock, U8 *pBuffer);
+
+// Release a TX frame, and mark it as ready to send
+bool xdpRawsockTxFrameReady(void *pvRawsock, U8 *pBuffer, unsigned int len, U64 timeNsec);
+
+// Send all packets that are ready (i.e. tell kernel to send them)
+int xdpRawsockSend(void *pvRawsock);
+
+// Get a burst of buffers to use for TX
+int xdpRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, unsigned int *len);
+
+// Queue a burst of TX frames and send them with a single syscall
+int xdpRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, unsigned int *lens, U64 *timeNsec, U32 count);
+
+// The firewall mark is not used; AF_XDP frames bypass the qdisc
+bool xdpRawsockTxSetMark(void *pvRawsock, int mark);
+
+// Count used TX buffers
+int xdpRawsockTxBufLevel(void *pvRawsock);
+
+// Count received frames not yet handed to the client
+int xdpRawsockRxBufLevel(void *pvRawsock);
+
+// Get a RX frame
+U8* xdpRawsockGetRxFrame(void *pvRawsock, U32 timeout, unsigned int *offset, unsigned int *len);
+
+// Release a RX frame held by the client
+bool xdpRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer);
+
+// Setup the rawsock to receive multicast packets
+bool xdpRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN]);
+
+// Get the socket used for this rawsock; can be used for poll/select
+int xdpRawsockGetSocket(void *pvRawsock);
+
+unsigned long xdpRawsockGetTXOutOfBuffers(void *pvRawsock);
+
+unsigned long xdpRawsockGetTXOutOfBuffersCyclic(void *pvRawsock);
+
+#endif
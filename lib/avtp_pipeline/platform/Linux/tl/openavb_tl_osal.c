@@ -37,6 +37,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <pthread.h>
 #include <signal.h>
 #include <dlfcn.h>
+#include <time.h>
+#include <sys/resource.h>
 #include "ini.h"
 
 #include "openavb_platform.h"
@@ -47,7 +49,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_trace.h"
 #include "openavb_rawsock.h"
 #include "openavb_mediaq.h"
+#include "openavb_avtp_asrc.h"
 #include "openavb_tl.h"
+#include "openavb_plugin.h"
 
 #define	AVB_LOG_COMPONENT	"Talker / Listener"
 #include "openavb_log.h"
@@ -73,6 +77,48 @@ bool parse_mac(const char *str, cfg_mac_t *mac)
 	return FALSE;
 }
 
+// Initialize functions come from the plugin registry. Ones the host didn't register are
+// resolved through the dynamic loader once and added to it, so later streams, and any
+// stream once the registry is sealed, never touch the loader.
+static pthread_mutex_t x_pluginMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *x_pluginLookup(void *libHandle, const char *funcName, openavb_plugin_kind_t kind, const char *pDesc)
+{
+	void *pFn = NULL;
+	char *error;
+
+	if (!libHandle) {
+		pFn = openavbPluginFind(kind, funcName);
+		if (pFn) {
+			return pFn;
+		}
+		if (openavbPluginIsSealed()) {
+			AVB_LOGF_ERROR("%s initialize function %s is not registered", pDesc, funcName);
+			return NULL;
+		}
+	}
+
+	// Serializes registry additions as well as the lookup
+	pthread_mutex_lock(&x_pluginMutex);
+
+	pFn = libHandle ? NULL : openavbPluginFind(kind, funcName);
+	if (!pFn) {
+		AVB_LOGF_INFO("Looking up symbol for function: %s", funcName);
+		dlerror();
+		pFn = dlsym(libHandle ? libHandle : RTLD_DEFAULT, funcName);
+		if ((error = dlerror()) != NULL)  {
+			AVB_LOGF_ERROR("%s initialize function lookup error: %s.", pDesc, error);
+			pFn = NULL;
+		}
+		else if (!libHandle) {
+			openavbPluginRegister(kind, funcName, pFn, OPENAVB_PLUGIN_ABI);
+		}
+	}
+
+	pthread_mutex_unlock(&x_pluginMutex);
+	return pFn;
+}
+
 static bool openMapLib(tl_state_t *pTLState)
 {
 // OpenAVB using static mapping plugins therefore don't attempt to open a library
@@ -94,16 +140,8 @@ static bool openMapLib(tl_state_t *pTLState)
 		return FALSE;
 	}
 
-	char *error;
-	AVB_LOGF_INFO("Looking up symbol for function: %s", pTLState->mapLib.funcName);
-	if (pTLState->mapLib.libHandle) {
-		pTLState->cfg.pMapInitFn = dlsym(pTLState->mapLib.libHandle, pTLState->mapLib.funcName);
-	}
-	else {
-		pTLState->cfg.pMapInitFn = dlsym(RTLD_DEFAULT, pTLState->mapLib.funcName);
-	}
-	if ((error = dlerror()) != NULL)  {
-		AVB_LOGF_ERROR("Mapping initialize function lookup error: %s.", error);
+	pTLState->cfg.pMapInitFn = x_pluginLookup(pTLState->mapLib.libHandle, pTLState->mapLib.funcName, OPENAVB_PLUGIN_MAP, "Mapping");
+	if (!pTLState->cfg.pMapInitFn) {
 		return FALSE;
 	}
 
@@ -131,22 +169,48 @@ static bool openIntfLib(tl_state_t *pTLState)
 		return FALSE;
 	}
 
-	char *error;
-	AVB_LOGF_INFO("Looking up symbol for function: %s", pTLState->intfLib.funcName);
-	if (pTLState->intfLib.libHandle) {
-		pTLState->cfg.pIntfInitFn = dlsym(pTLState->intfLib.libHandle, pTLState->intfLib.funcName);
-	}
-	else {
-		pTLState->cfg.pIntfInitFn = dlsym(RTLD_DEFAULT, pTLState->intfLib.funcName);
-	}
-	if ((error = dlerror()) != NULL)  {
-		AVB_LOGF_ERROR("Interface initialize function lookup error: %s.", error);
+	pTLState->cfg.pIntfInitFn = x_pluginLookup(pTLState->intfLib.libHandle, pTLState->intfLib.funcName, OPENAVB_PLUGIN_INTF, "Interface");
+	if (!pTLState->cfg.pIntfInitFn) {
 		return FALSE;
 	}
 
 	return TRUE;
 }
 
+static bool openFanoutLibs(tl_state_t *pTLState)
+{
+	int i;
+
+	for (i = 0; i < TL_FANOUT_MAX; i++) {
+		if (pTLState->fanoutLib[i].funcName && !pTLState->pFanoutInitFn[i]) {
+			pTLState->pFanoutInitFn[i] = x_pluginLookup(pTLState->fanoutLib[i].libHandle, pTLState->fanoutLib[i].funcName, OPENAVB_PLUGIN_INTF, "Fan-out interface");
+			if (!pTLState->pFanoutInitFn[i]) {
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+// Index of the fan-out interface module named by a fanoutN<suffix> item, or -1
+static int x_fanoutIdx(const char *name, const char *suffix)
+{
+	char *pEnd;
+	long idx;
+
+	if (!MATCH_LEFT(name, "fanout", 6)) {
+		return -1;
+	}
+	idx = strtol(name + 6, &pEnd, 10);
+	if (pEnd == name + 6 || idx < 1 || idx > TL_FANOUT_MAX
+		|| !MATCH_LEFT(pEnd, suffix, strlen(suffix))
+		|| (suffix[strlen(suffix) - 1] != '_' && pEnd[strlen(suffix)] != '\0')) {
+		return -1;
+	}
+	return idx - 1;
+}
+
 // callback function - called for each name/value pair by ini parsing library
 static int openavbTLCfgCallback(void *user, const char *tlSection, const char *name, const char *value)
 {
@@ -275,6 +339,46 @@ static int openavbTLCfgCallback(void *user, const char *tlSection, const char *n
 			&& pCfg->raw_rx_buffers <= UINT32_MAX)
 			valOK = TRUE;
 	}
+	else if (MATCH(name, "rx_block_intervals")) {
+		errno = 0;
+		pCfg->rx_block_intervals = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& pCfg->rx_block_intervals <= 8000)
+			valOK = TRUE;
+	}
+	else if (MATCH(name, "rx_busy_poll_usec")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 0);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= MICROSECONDS_PER_SECOND) {
+			pCfg->rx_busy_poll_usec = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "rx_adapt_permille")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1000) {
+			pCfg->rx_adapt_permille = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "rx_adapt_margin_usec")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= MICROSECONDS_PER_SECOND) {
+			pCfg->rx_adapt_margin_usec = tmp;
+			valOK = TRUE;
+		}
+	}
 	else if (MATCH(name, "report_seconds")) {
 		errno = 0;
 		pCfg->report_seconds = strtol(value, &pEnd, 10);
@@ -300,6 +404,24 @@ static int openavbTLCfgCallback(void *user, const char *tlSection, const char *n
 		strncpy(pCfg->ifname, value, IFNAMSIZ - 1);
 		valOK = TRUE;
 	}
+	else if (MATCH(name, "redundant_ifname")) {
+		strncpy(pCfg->redundant_ifname, value, IFNAMSIZ - 1);
+		valOK = TRUE;
+	}
+	else if (MATCH(name, "redundant_dest_addr")) {
+		valOK = parse_mac(value, &pCfg->redundant_dest_addr);
+	}
+	else if (MATCH(name, "gptp_domain")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 0);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= -1
+			&& tmp <= 127) {
+			pCfg->gptp_domain = tmp;
+			valOK = TRUE;
+		}
+	}
 	else if (MATCH(name, "vlan_id")) {
 		errno = 0;
 		long tmp;
@@ -321,6 +443,27 @@ static int openavbTLCfgCallback(void *user, const char *tlSection, const char *n
 			valOK = TRUE;
 		}
 	}
+	else if (MATCH(name, "launch_lookahead_usec")) {
+		errno = 0;
+		pCfg->launch_lookahead_usec = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& pCfg->launch_lookahead_usec <= UINT32_MAX)
+			valOK = TRUE;
+	}
+	else if (MATCH(name, "batch_adapt_max")) {
+		errno = 0;
+		pCfg->batch_adapt_max = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& pCfg->batch_adapt_max <= INT32_MAX)
+			valOK = TRUE;
+	}
+	else if (MATCH(name, "spin_guard_usec")) {
+		errno = 0;
+		pCfg->spin_guard_usec = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& pCfg->spin_guard_usec <= INT32_MAX)
+			valOK = TRUE;
+	}
 	else if (MATCH(name, "tx_blocking_in_intf")) {
 		errno = 0;
 		long tmp;
@@ -330,6 +473,59 @@ static int openavbTLCfgCallback(void *user, const char *tlSection, const char *n
 			valOK = TRUE;
 		}
 	}
+	else if (MATCH(name, "asrc")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= AVTP_ASRC_OFF
+			&& tmp <= AVTP_ASRC_MCR) {
+			pCfg->asrc = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "asrc_buffer_usec")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 0);
+		if (*pEnd == '\0' && errno == 0 && tmp >= 0) {
+			pCfg->asrc_buffer_usec = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "tx_null_on_underrun")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->tx_null_on_underrun = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "transit_calibrate")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1000000) {
+			pCfg->transit_calibrate = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "transit_margin_usec")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1000000) {
+			pCfg->transit_margin_usec = tmp;
+			valOK = TRUE;
+		}
+	}
 	else if (MATCH(name, "thread_rt_priority")) {
 		errno = 0;
 		long tmp;
@@ -348,6 +544,206 @@ static int openavbTLCfgCallback(void *user, const char *tlSection, const char *n
 			valOK = TRUE;
 		}
 	}
+	else if (MATCH(name, "thread_rt_fifo")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->thread_rt_fifo = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "thread_mlock")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->thread_mlock = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "mem_prefault")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->mem_prefault = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "talker_pool")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->talker_pool = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "listener_pool")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->listener_pool = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "shared_source")) {
+		if (strlen(value) < SHARED_SOURCE_NAMESIZE) {
+			strncpy(pCfg->shared_source, value, SHARED_SOURCE_NAMESIZE - 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "mediaq_lock_free")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->mediaq_lock_free = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "mediaq_arena")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->mediaq_arena = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "mediaq_ring_size")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= INT32_MAX) {
+			pCfg->mediaq_ring_size = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "mediaq_ordered")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->mediaq_ordered = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "mediaq_max_late_usec")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= INT32_MAX) {
+			pCfg->mediaq_max_late_usec = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "mediaq_drop_duplicates")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->mediaq_drop_duplicates = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "latency_hist")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->latency_hist = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "ts_eval")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 1) {
+			pCfg->ts_eval = (tmp == 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "cpu_stats")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= INT32_MAX) {
+			pCfg->cpu_stats = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "latency_trace")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= OPENAVB_LAT_TRACE_MAX_PERIOD
+			&& (tmp & (tmp - 1)) == 0) {
+			pCfg->latency_trace = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "pcap_file")) {
+		if (strlen(value) < PCAP_FILE_NAMESIZE) {
+			strncpy(pCfg->pcap_file, value, PCAP_FILE_NAMESIZE - 1);
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "pcap_replay_speed")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= 10000) {
+			pCfg->pcap_replay_speed = tmp;
+			valOK = TRUE;
+		}
+	}
+	else if (MATCH(name, "pcap_replay_loops")) {
+		errno = 0;
+		long tmp;
+		tmp = strtol(value, &pEnd, 10);
+		if (*pEnd == '\0' && errno == 0
+			&& tmp >= 0
+			&& tmp <= UINT32_MAX) {
+			pCfg->pcap_replay_loops = tmp;
+			valOK = TRUE;
+		}
+	}
 
 	else if (MATCH(name, "map_lib")) {
 		if (pTLState->mapLib.libName)
@@ -375,8 +771,24 @@ static int openavbTLCfgCallback(void *user, const char *tlSection, const char *n
 		valOK = TRUE;
 	}
 
+	else if (x_fanoutIdx(name, "_lib") >= 0) {
+		i = x_fanoutIdx(name, "_lib");
+		if (pTLState->fanoutLib[i].libName)
+			free(pTLState->fanoutLib[i].libName);
+		pTLState->fanoutLib[i].libName = strdup(value);
+		valOK = TRUE;
+	}
+	else if (x_fanoutIdx(name, "_fn") >= 0) {
+		i = x_fanoutIdx(name, "_fn");
+		if (pTLState->fanoutLib[i].funcName)
+			free(pTLState->fanoutLib[i].funcName);
+		pTLState->fanoutLib[i].funcName = strdup(value);
+		valOK = TRUE;
+	}
+
 	else if (MATCH_LEFT(name, "intf_nv_", 8)
-		|| MATCH_LEFT(name, "map_nv_", 7)) {
+		|| MATCH_LEFT(name, "map_nv_", 7)
+		|| x_fanoutIdx(name, "_nv_") >= 0) {
 		// Need to save the interface and mapping module configuration
 		// until later (after those libraries are loaded.)
 
@@ -421,7 +833,9 @@ static int openavbTLCfgCallback(void *user, const char *tlSection, const char *n
 
 bool openavbTLThreadFnOsal(tl_state_t *pTLState)
 {
-	return TRUE;
+	// WALLTIME in this stream thread follows the gPTP domain of its interface
+	return osalAVBTimeSelectIf(pTLState->cfg.ifname)
+		&& osalAVBTimeSelectDomain(pTLState->cfg.gptp_domain);
 }
 
 
@@ -475,6 +889,10 @@ bool openavbTLOpenLinkLibsOsal(tl_state_t *pTLState)
 		}
 	}
 
+	if (!openFanoutLibs(pTLState)) {
+		return FALSE;
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 	return TRUE;
 }
@@ -482,14 +900,34 @@ bool openavbTLOpenLinkLibsOsal(tl_state_t *pTLState)
 bool openavbTLCloseLinkLibsOsal(tl_state_t *pTLState)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+	int i;
 
 	if (pTLState->mapLib.libHandle)
 		dlclose(pTLState->mapLib.libHandle);
 	if (pTLState->intfLib.libHandle)
 		dlclose(pTLState->intfLib.libHandle);
+	for (i = 0; i < TL_FANOUT_MAX; i++) {
+		if (pTLState->fanoutLib[i].libHandle)
+			dlclose(pTLState->fanoutLib[i].libHandle);
+	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 	return TRUE;
 }
 
 
+
+bool openavbTLThreadCpuOsal(U64 *pCpuNS, U64 *pInvolCsw)
+{
+	struct timespec ts;
+	struct rusage ru;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0
+		|| getrusage(RUSAGE_THREAD, &ru) != 0) {
+		return FALSE;
+	}
+
+	*pCpuNS = (U64)ts.tv_sec * NANOSECONDS_PER_SECOND + ts.tv_nsec;
+	*pInvolCsw = ru.ru_nivcsw;
+	return TRUE;
+}
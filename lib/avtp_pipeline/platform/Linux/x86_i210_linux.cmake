@@ -31,3 +31,4 @@ set ( PLATFORM_LINK_LIBRARIES
 
 set ( GSTREAMER_1_0 0 )
 set ( AVB_FEATURE_PCAP 1 )
+set ( AVB_FEATURE_XDP 1 )
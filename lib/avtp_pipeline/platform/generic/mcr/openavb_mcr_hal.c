@@ -33,15 +33,21 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_log.h"
 
 #include "openavb_mcr_hal.h"
+#include "openavb_mcr_sw.h"
 
+// Recovered from the listener's AVTP timestamps. The rate is consumed by the
+// interface module, for example through an ALSA rate control.
+static mcr_sw_t x_mcr;
 
 bool halInitMCR(U32 packetRate, U32 pushInterval, U32 timestampInterval, U32 recoveryInterval)
 {
+	openavbMcrSwInit(&x_mcr, recoveryInterval);
 	return TRUE;
 }
 
 bool halCloseMCR(void)
 {
+	openavbMcrSwReset(&x_mcr);
 	return TRUE;
 }
 
@@ -50,13 +56,44 @@ bool halPushMCR(void)
 	return TRUE;	
 }
 
-void halAdjustMCRNSec(S32 adjNSec)
+bool halPushMCRTimestamp(U32 timestamp, U32 frames, U32 audioRate)
 {
+	openavbMcrSwPush(&x_mcr, timestamp, frames, audioRate);
+	return TRUE;
 }
 
-void halAdjustMCRGranularityNSec(U32 adjGranularityNSec)
+bool halGetMCRRatePpb(S32 *pRatePpb)
+{
+	return openavbMcrSwGetRatePpb(&x_mcr, pRatePpb);
+}
+
+bool halSetMCRClockOutput(const char *pDevice, U32 pin, U32 clockHz)
+{
+	AVB_LOG_ERROR("MCR clock output not supported on this platform");
+	return FALSE;
+}
+
+bool halSetMCRClockInput(const char *pDevice, U32 pin, U32 clockHz)
 {
+	if (!pDevice) {
+		return TRUE;
+	}
+	AVB_LOG_ERROR("MCR clock input not supported on this platform");
+	return FALSE;
 }
 
+bool halGetMCRInputRatePpb(S32 *pRatePpb)
+{
+	return FALSE;
+}
 
+void halAdjustMCRNSec(S32 adjNSec)
+{
+	openavbMcrSwAdjustNSec(&x_mcr, adjNSec);
+}
+
+void halAdjustMCRGranularityNSec(U32 adjGranularityNSec)
+{
+	openavbMcrSwAdjustGranularityNSec(&x_mcr, adjGranularityNSec);
+}
 
@@ -37,4 +37,18 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define OPENAVB_CODE_MODULE_PRI
 #define OPENAVB_DATA_PRI
 
+// Size of a cache line. Used to keep data written by different threads on separate lines.
+#define OPENAVB_CACHE_LINE_SIZE                64
+
+// Atomic access used by lock-free structures shared between threads.
+#define OPENAVB_ATOMIC_LOAD_RELAXED(ptr)         __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define OPENAVB_ATOMIC_LOAD_ACQUIRE(ptr)         __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define OPENAVB_ATOMIC_STORE_RELAXED(ptr, val)   __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#define OPENAVB_ATOMIC_STORE_RELEASE(ptr, val)   __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define OPENAVB_ATOMIC_FETCH_ADD(ptr, val)       __atomic_fetch_add((ptr), (val), __ATOMIC_ACQ_REL)
+#define OPENAVB_ATOMIC_FENCE()                   __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Storage class for variables with one instance per thread.
+#define OPENAVB_THREAD_LOCAL                     __thread
+
 #endif // AVB_TYPES_BASE_TCAL_PUB_H
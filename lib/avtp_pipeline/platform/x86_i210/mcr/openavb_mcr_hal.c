@@ -28,20 +28,182 @@ Complete license and copyright information can be found at
 https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 *************************************************************************************************************/
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/ptp_clock.h>
+
 #define	AVB_LOG_COMPONENT	"MCR"
 #include "openavb_pub.h"
 #include "openavb_log.h"
 
 #include "openavb_mcr_hal.h"
+#include "openavb_mcr_sw.h"
+#include "openavb_igb.h"
+#include "avb_gptp.h"
+
+// The gPTP domain selected by the calling stream thread
+extern const gPtpTimeData *osalAVBTimeData(void);
+
+// Same dynamic clock id encoding as clock_getres(2) for PTP devices
+#define PHC_FD_TO_CLOCKID(fd)	((~(clockid_t)(fd) << 3) | 3)
+
+// Recovered from the listener's AVTP timestamps and optionally driven out of
+// an i210 SDP pin as a periodic output of the gPTP disciplined PHC.
+static mcr_sw_t x_mcr;
+
+static int x_phcFd = -1;
+static U32 x_perout;
+static U64 x_nominalPeriodNSec;
+static U64 x_periodNSec;
+static U64 x_edgeNSec;
+
+// Timestamps from before and after a grandmaster change are on different
+// time bases, so a window spanning one measures nonsense
+static bool x_haveGmCount;
+static U32 x_gmCount;
+
+// External media clock (word clock) whose edges are timestamped on an i210
+// SDP, either by the kernel PTP driver (x_extFd) or by lib/igb (x_extDev).
+// Measured against gPTP time it gives the rate a talker's MCS must follow.
+static mcr_sw_t x_mcrIn;
+static int x_extFd = -1;
+static device_t *x_extDev;
+static U32 x_extHz;
+static bool x_extHaveLast;
+static U64 x_extLastNSec;
+static bool x_extHaveGmCount;
+static U32 x_extGmCount;
+
+static bool x_gmChanged(bool *pHaveGmCount, U32 *pGmCount)
+{
+	U32 updateCount, gmCount;
+	bool changed = FALSE;
+
+	if (osalAVBTimeGetUpdate(&updateCount, &gmCount)) {
+		changed = *pHaveGmCount && gmCount != *pGmCount;
+		*pGmCount = gmCount;
+		*pHaveGmCount = TRUE;
+	}
+	return changed;
+}
+
+static bool x_peroutRequest(U64 startNSec, U64 periodNSec)
+{
+	struct ptp_perout_request req;
+
+	memset(&req, 0, sizeof(req));
+	req.index = x_perout;
+	req.start.sec = startNSec / NANOSECONDS_PER_SECOND;
+	req.start.nsec = startNSec % NANOSECONDS_PER_SECOND;
+	req.period.sec = periodNSec / NANOSECONDS_PER_SECOND;
+	req.period.nsec = periodNSec % NANOSECONDS_PER_SECOND;
+	if (ioctl(x_phcFd, PTP_PEROUT_REQUEST, &req) < 0) {
+		AVB_LOGF_ERROR("PTP_PEROUT_REQUEST failed: %s", strerror(errno));
+		return FALSE;
+	}
+
+	x_edgeNSec = startNSec;
+	x_periodNSec = periodNSec;
+	return TRUE;
+}
 
+// Re-program the output period, continuing from the next edge of the
+// current one so the output phase is not disturbed.
+static void x_peroutUpdate(void)
+{
+	S32 ratePpb;
+	struct timespec now;
+
+	if (x_phcFd < 0 || !openavbMcrSwGetRatePpb(&x_mcr, &ratePpb)) {
+		return;
+	}
+
+	// A fast talker clock means a shorter period
+	U64 periodNSec = x_nominalPeriodNSec - (S64)x_nominalPeriodNSec * ratePpb / 1000000000LL;
+	if (periodNSec == x_periodNSec) {
+		return;
+	}
+
+	if (clock_gettime(PHC_FD_TO_CLOCKID(x_phcFd), &now) < 0) {
+		return;
+	}
+	U64 nowNSec = (U64)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+	U64 edgeNSec = x_edgeNSec;
+	if (edgeNSec <= nowNSec) {
+		edgeNSec += ((nowNSec - edgeNSec) / x_periodNSec + 1) * x_periodNSec;
+	}
+	x_peroutRequest(edgeNSec, periodNSec);
+}
+
+static void x_peroutClose(void)
+{
+	if (x_phcFd >= 0) {
+		// A zero period disables the output
+		x_peroutRequest(0, 0);
+		close(x_phcFd);
+		x_phcFd = -1;
+	}
+}
+
+static void x_extClose(void)
+{
+	if (x_extFd >= 0) {
+		struct ptp_extts_request req;
+		memset(&req, 0, sizeof(req));
+		req.index = 0;
+		ioctl(x_extFd, PTP_EXTTS_REQUEST, &req);
+		close(x_extFd);
+		x_extFd = -1;
+	}
+	if (x_extDev) {
+		igb_extts_enable(x_extDev, 0, 0);
+		igbReleaseDevice(x_extDev);
+		x_extDev = NULL;
+	}
+	x_extHaveLast = FALSE;
+	openavbMcrSwReset(&x_mcrIn);
+}
+
+// Feed one edge, stamped in the NIC clock, to the input clock recovery
+static void x_extEdge(U64 localNSec)
+{
+	U64 ptpNSec;
+
+	// The NIC clock free runs, gPTP time is what the AVTP timestamps use
+	if (!gptplocal2master(osalAVBTimeData(), localNSec, &ptpNSec)) {
+		return;
+	}
+
+	if (x_extHaveLast && ptpNSec > x_extLastNSec) {
+		// Edges are only sampled, not all of them are seen. The number of
+		// periods between two is still exact while the drift over the gap
+		// stays below half a period.
+		U64 periods = ((ptpNSec - x_extLastNSec) * x_extHz + NANOSECONDS_PER_SECOND / 2) / NANOSECONDS_PER_SECOND;
+		if (periods) {
+			openavbMcrSwPush(&x_mcrIn, (U32)ptpNSec, (U32)periods, x_extHz);
+		}
+	}
+	else {
+		openavbMcrSwReset(&x_mcrIn);
+		openavbMcrSwPush(&x_mcrIn, (U32)ptpNSec, 0, x_extHz);
+	}
+	x_extLastNSec = ptpNSec;
+	x_extHaveLast = TRUE;
+}
 
 bool halInitMCR(U32 packetRate, U32 pushInterval, U32 timestampInterval, U32 recoveryInterval)
 {
+	openavbMcrSwInit(&x_mcr, recoveryInterval);
 	return TRUE;
 }
 
 bool halCloseMCR(void)
 {
+	x_peroutClose();
+	openavbMcrSwReset(&x_mcr);
 	return TRUE;
 }
 
@@ -50,13 +212,173 @@ bool halPushMCR(void)
 	return TRUE;	
 }
 
-void halAdjustMCRNSec(S32 adjNSec)
+bool halPushMCRTimestamp(U32 timestamp, U32 frames, U32 audioRate)
 {
+	if (x_gmChanged(&x_haveGmCount, &x_gmCount)) {
+		AVB_LOG_INFO("Grandmaster changed, restarting media clock recovery");
+		openavbMcrSwReset(&x_mcr);
+	}
+
+	if (openavbMcrSwPush(&x_mcr, timestamp, frames, audioRate)) {
+		x_peroutUpdate();
+	}
+	return TRUE;
 }
 
-void halAdjustMCRGranularityNSec(U32 adjGranularityNSec)
+bool halGetMCRRatePpb(S32 *pRatePpb)
+{
+	return openavbMcrSwGetRatePpb(&x_mcr, pRatePpb);
+}
+
+bool halSetMCRClockOutput(const char *pDevice, U32 pin, U32 clockHz)
+{
+	struct timespec now;
+
+	if (!pDevice || !clockHz) {
+		return FALSE;
+	}
+
+	x_peroutClose();
+
+	x_phcFd = open(pDevice, O_RDWR);
+	if (x_phcFd < 0) {
+		AVB_LOGF_ERROR("Failed to open %s: %s", pDevice, strerror(errno));
+		return FALSE;
+	}
+
+#ifdef PTP_PIN_SETFUNC
+	struct ptp_pin_desc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.index = pin;
+	desc.func = PTP_PF_PEROUT;
+	desc.chan = 0;
+	if (ioctl(x_phcFd, PTP_PIN_SETFUNC, &desc) < 0) {
+		// Older drivers hard wire the periodic output to an SDP
+		AVB_LOGF_WARNING("PTP_PIN_SETFUNC for pin %u failed: %s", pin, strerror(errno));
+	}
+#endif
+	x_perout = 0;
+
+	if (clock_gettime(PHC_FD_TO_CLOCKID(x_phcFd), &now) < 0) {
+		AVB_LOGF_ERROR("Failed to read %s: %s", pDevice, strerror(errno));
+		close(x_phcFd);
+		x_phcFd = -1;
+		return FALSE;
+	}
+
+	// Start nominal on the next second until the recovery locks
+	x_nominalPeriodNSec = NANOSECONDS_PER_SECOND / clockHz;
+	if (!x_peroutRequest(((U64)now.tv_sec + 2) * NANOSECONDS_PER_SECOND, x_nominalPeriodNSec)) {
+		close(x_phcFd);
+		x_phcFd = -1;
+		return FALSE;
+	}
+
+	AVB_LOGF_INFO("MCR clock output %u Hz on %s pin %u", clockHz, pDevice, pin);
+	return TRUE;
+}
+
+bool halSetMCRClockInput(const char *pDevice, U32 pin, U32 clockHz)
 {
+	x_extClose();
+	if (!pDevice) {
+		return TRUE;
+	}
+	if (!clockHz) {
+		return FALSE;
+	}
+
+	x_extHz = clockHz;
+
+	if (strncmp(pDevice, "/dev/", 5) == 0) {
+		// The kernel driver owns the NIC, let it queue the edge events
+		x_extFd = open(pDevice, O_RDWR | O_NONBLOCK);
+		if (x_extFd < 0) {
+			AVB_LOGF_ERROR("Failed to open %s: %s", pDevice, strerror(errno));
+			return FALSE;
+		}
+
+#ifdef PTP_PIN_SETFUNC
+		struct ptp_pin_desc desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.index = pin;
+		desc.func = PTP_PF_EXTTS;
+		desc.chan = 0;
+		if (ioctl(x_extFd, PTP_PIN_SETFUNC, &desc) < 0) {
+			AVB_LOGF_WARNING("PTP_PIN_SETFUNC for pin %u failed: %s", pin, strerror(errno));
+		}
+#endif
+
+		struct ptp_extts_request req;
+		memset(&req, 0, sizeof(req));
+		req.index = 0;
+		req.flags = PTP_ENABLE_FEATURE | PTP_RISING_EDGE;
+		if (ioctl(x_extFd, PTP_EXTTS_REQUEST, &req) < 0) {
+			AVB_LOGF_ERROR("PTP_EXTTS_REQUEST failed: %s", strerror(errno));
+			close(x_extFd);
+			x_extFd = -1;
+			return FALSE;
+		}
+	}
+	else {
+		// An interface attached through lib/igb, latch the edges ourselves
+		x_extDev = igbAcquireDeviceIf(pDevice);
+		if (!x_extDev) {
+			AVB_LOGF_ERROR("Failed to attach the igb device of %s", pDevice);
+			return FALSE;
+		}
+		int err = igb_extts_enable(x_extDev, pin, 1);
+		if (err) {
+			AVB_LOGF_ERROR("Failed to capture SDP%u: %s", pin, strerror(err < 0 ? -err : err));
+			igbReleaseDevice(x_extDev);
+			x_extDev = NULL;
+			return FALSE;
+		}
+	}
+
+	x_gmChanged(&x_extHaveGmCount, &x_extGmCount);
+	AVB_LOGF_INFO("MCR clock input %u Hz on %s pin %u", clockHz, pDevice, pin);
+	return TRUE;
 }
 
+bool halGetMCRInputRatePpb(S32 *pRatePpb)
+{
+	if (x_gmChanged(&x_extHaveGmCount, &x_extGmCount)) {
+		AVB_LOG_INFO("Grandmaster changed, restarting media clock input");
+		x_extHaveLast = FALSE;
+		openavbMcrSwReset(&x_mcrIn);
+	}
+
+	if (x_extFd >= 0) {
+		struct ptp_extts_event events[16];
+		ssize_t len;
+		while ((len = read(x_extFd, events, sizeof(events))) > 0) {
+			int i1;
+			for (i1 = 0; i1 < len / (ssize_t)sizeof(events[0]); i1++) {
+				x_extEdge((U64)events[i1].t.sec * NANOSECONDS_PER_SECOND + events[i1].t.nsec);
+			}
+		}
+	}
+	else if (x_extDev) {
+		U64 edgeNSec;
+		if (igb_extts_read(x_extDev, &edgeNSec) == 0) {
+			x_extEdge(edgeNSec);
+		}
+	}
+	else {
+		return FALSE;
+	}
 
+	return openavbMcrSwGetRatePpb(&x_mcrIn, pRatePpb);
+}
+
+void halAdjustMCRNSec(S32 adjNSec)
+{
+	openavbMcrSwAdjustNSec(&x_mcr, adjNSec);
+}
+
+void halAdjustMCRGranularityNSec(U32 adjGranularityNSec)
+{
+	openavbMcrSwAdjustGranularityNSec(&x_mcr, adjGranularityNSec);
+}
 
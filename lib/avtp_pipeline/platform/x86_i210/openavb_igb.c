@@ -28,6 +28,10 @@ Complete license and copyright information can be found at
 https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 *************************************************************************************************************/
 
+#include <limits.h>
+#include <math.h>
+#include <net/if.h>
+
 #include "openavb_igb.h"
 #include "openavb_osal.h"
 #include "avb_igb.h"
@@ -43,14 +47,44 @@ static pthread_mutex_t gIgbDeviceMutex = PTHREAD_MUTEX_INITIALIZER;
 #define LOCK()  	pthread_mutex_lock(&gIgbDeviceMutex)
 #define UNLOCK()	pthread_mutex_unlock(&gIgbDeviceMutex)
 
-static struct igb_dma_alloc g_pages[IGB_PAGES];
-static struct igb_packet *g_free_packets;
+// tx buffers released or reclaimed on a queue go back to that queue's stack
+typedef struct {
+	struct igb_packet *packets;
+	int sinceReclaim;	// frames handed out since the last reclaim
+} igb_tx_free_t;
+
+// One attached NIC. The device_t comes first so the device_t* handed to
+// callers is also the context.
+typedef struct {
+	device_t dev;
+	char ifname[IFNAMSIZ];	// empty for the first device found
+	char devpath[IGB_BIND_NAMESZ];	// PCI address
+	int users;
+
+	struct igb_dma_alloc pages[IGB_PAGES];
+	struct igb_packet *freePackets;
+
+	// tx buffers carved from one contiguous region when the kernel module supports it
+	struct igb_dma_alloc txRegion;
+	struct igb_packet *txSlab;
+
+	igb_tx_free_t txFree[IGB_TX_QUEUES];
+
+	int totalBuffers;
+	int usedBuffers;	// handed out and not yet released or reclaimed
 
-static device_t *igb_dev = NULL;
-static int igb_dev_users = 0; // time uses it
+	// user-space RX queues set up by igb_init_rx on the first claim, so
+	// processes that only transmit leave RX alone; bit n set when queue n is claimed
+	bool rxTried;
+	bool rxAttached;
+	int rxQueues;
+	U32 rxQueuesInUse;
+} igb_ctx_t;
 
-static int g_totalBuffers = 0;
-static int g_usedBuffers = -1;
+#define IGB_CTX(dev) ((igb_ctx_t *)(dev))
+
+// NICs in use by this process, one per interface
+static igb_ctx_t *g_igb[IGB_MAX_DEVICES];
 
 static int count_packets(struct igb_packet *packet)
 {
@@ -101,87 +135,173 @@ static struct igb_packet* alloc_page(device_t* dev, struct igb_dma_alloc *a_page
 	return free_packets;
 }
 
-device_t *igbAcquireDevice()
+// Attach a NIC and set up its TX buffers; NULL on failure
+static igb_ctx_t *x_igbOpen(const char *ifname)
 {
-	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
+	igb_ctx_t *ctx = calloc(1, sizeof(igb_ctx_t));
+	if (!ctx) {
+		AVB_LOGF_ERROR("Cannot allocate memory for device: %s", strerror(errno));
+		return NULL;
+	}
+	device_t *tmp_dev = &ctx->dev;
 
-	LOCK();
-	if (!igb_dev) {
-		device_t *tmp_dev = malloc(sizeof(device_t));
-		if (!tmp_dev) {
-			AVB_LOGF_ERROR("Cannot allocate memory for device: %s", strerror(errno));
-			goto unlock;
-		}
+	int err = pci_connect_if(tmp_dev, ifname);
+	if (err) {
+		AVB_LOGF_ERROR("connect %s failed (%s) - are you running as root?", ifname ? ifname : "", strerror(err));
+		free(ctx);
+		return NULL;
+	}
+	if (ifname)
+		strncpy(ctx->ifname, ifname, IFNAMSIZ - 1);
+	snprintf(ctx->devpath, IGB_BIND_NAMESZ, "%04x:%02x:%02x.%d",
+		tmp_dev->domain, tmp_dev->bus, tmp_dev->dev, tmp_dev->func);
 
-		int err = pci_connect(tmp_dev);
-		if (err) {
-			AVB_LOGF_ERROR("connect failed (%s) - are you running as root?", strerror(err));
-			goto unlock;
+	err = igb_init(tmp_dev);
+	if (err) {
+		AVB_LOGF_ERROR("init failed (%s) - is the driver really loaded?", strerror(err));
+		igb_detach(tmp_dev);
+		free(ctx);
+		return NULL;
+	}
+
+	unsigned int nSlab = 0;
+	if (igb_dma_malloc_huge(tmp_dev, &ctx->txRegion) == 0) {
+		ctx->txSlab = igb_dma_slab_carve(&ctx->txRegion, IGB_MTU, &nSlab);
+		if (ctx->txSlab) {
+			memset(ctx->txRegion.dma_vaddr, 0, ctx->txRegion.mmap_size);
 		}
+		else {
+			igb_dma_free_page(tmp_dev, &ctx->txRegion);
+		}
+	}
+	ctx->freePackets = ctx->txSlab;
 
-		err = igb_init(tmp_dev);
-		if (err) {
-			AVB_LOGF_ERROR("init failed (%s) - is the driver really loaded?", strerror(err));
-			igb_detach(tmp_dev);
-			goto unlock;
+	int i;
+	for (i = 0; i < IGB_PAGES && !ctx->txSlab; i++) {
+		struct igb_packet* free_packets = alloc_page(tmp_dev, &ctx->pages[i]);
+		if (!ctx->freePackets) {
+			ctx->freePackets = free_packets;
+		} else {
+			struct igb_packet* last_packet = ctx->freePackets;
+			while (last_packet->next) {
+				last_packet = last_packet->next;
+			}
+			last_packet->next = free_packets;
 		}
+	}
+
+	ctx->totalBuffers = count_packets(ctx->freePackets);
+	ctx->usedBuffers = 0;
+
+	AVB_LOGF_INFO("%s TX buffers: %d%s", ctx->ifname, ctx->totalBuffers, ctx->txSlab ? " (contiguous DMA region)" : "");
+
+	igbControlLaunchTime(tmp_dev, IGB_LAUNCHTIME_ENABLED);
+
+	AVB_LOGF_INFO("IGB launch time feature is %s", IGB_LAUNCHTIME_ENABLED ? "ENABLED" : "DISABLED");
 
+	return ctx;
+}
 
+static void x_igbClose(igb_ctx_t *ctx)
+{
+	if (ctx->txSlab) {
+		igb_dma_free_page(&ctx->dev, &ctx->txRegion);
+		free(ctx->txSlab);
+	}
+	else {
 		int i;
-		for (i = 0; i < IGB_PAGES; i++) {
-			struct igb_packet* free_packets = alloc_page(tmp_dev, &g_pages[i]);
-			if (!g_free_packets) {
-				g_free_packets = free_packets;
-			} else {
-				struct igb_packet* last_packet = g_free_packets;
-				while (last_packet->next) {
-					last_packet = last_packet->next;
-				}
-				last_packet->next = free_packets;
-			}
-		}
+		for (i = 0; i < IGB_PAGES; i++)
+			igb_dma_free_page(&ctx->dev, &ctx->pages[i]);
+	}
 
-		g_totalBuffers = count_packets(g_free_packets);
+	igb_detach(&ctx->dev);
+	free(ctx);
+}
 
-		AVB_LOGF_INFO("TX buffers: %d", g_totalBuffers);
+device_t *igbAcquireDeviceIf(const char *ifname)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
 
-		igbControlLaunchTime(tmp_dev, IGB_LAUNCHTIME_ENABLED);
+	igb_ctx_t *ctx = NULL;
+	char devpath[IGB_BIND_NAMESZ] = "";
+	int i, slot = -1;
+
+	if (ifname) {
+		// strip a rawsock prefix such as "igb:"
+		const char *colon = strchr(ifname, ':');
+		if (colon)
+			ifname = colon + 1;
+		if (!ifname[0])
+			ifname = NULL;
+	}
+	if (ifname && pci_devpath_of(ifname, devpath) != 0) {
+		// eg: a VLAN or bridge on top of the NIC
+		AVB_LOGF_WARNING("%s is not a PCI network device, using the first igb device", ifname);
+		ifname = NULL;
+	}
 
-		AVB_LOGF_INFO("IGB launch time feature is %s", IGB_LAUNCHTIME_ENABLED ? "ENABLED" : "DISABLED");
+	LOCK();
+	// without a name any attached device will do, as before; a device
+	// first taken without a name is matched by its PCI address
+	for (i = 0; i < IGB_MAX_DEVICES; i++) {
+		if (!g_igb[i]) {
+			if (slot < 0)
+				slot = i;
+		}
+		else if (!ifname || strcmp(g_igb[i]->devpath, devpath) == 0) {
+			ctx = g_igb[i];
+			if (ifname && !ctx->ifname[0])
+				strncpy(ctx->ifname, ifname, IFNAMSIZ - 1);
+			break;
+		}
+	}
 
-		igb_dev = tmp_dev;
-unlock:
-		if (!igb_dev)
-			free(tmp_dev);
+	if (!ctx) {
+		if (slot < 0) {
+			AVB_LOGF_ERROR("No room for igb device %s, %d in use", ifname ? ifname : "", IGB_MAX_DEVICES);
+		}
+		else if ((ctx = x_igbOpen(ifname)) != NULL) {
+			g_igb[slot] = ctx;
+		}
 	}
 
-	if (igb_dev) {
-		igb_dev_users += 1;
-		AVB_LOGF_DEBUG("igb_dev_users %d", igb_dev_users);
+	if (ctx) {
+		ctx->users += 1;
+		AVB_LOGF_DEBUG("igb %s users %d", ctx->ifname, ctx->users);
 	}
 	UNLOCK();
 
 	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
-	return igb_dev;
+	return ctx ? &ctx->dev : NULL;
+}
+
+device_t *igbAcquireDevice()
+{
+	return igbAcquireDeviceIf(NULL);
 }
 
 void igbReleaseDevice(device_t* dev)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
 
+	if (!dev) {
+		AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+		return;
+	}
+
 	LOCK();
 
-	igb_dev_users -= 1;
-	AVB_LOGF_DEBUG("igb_dev_users %d", igb_dev_users);
+	igb_ctx_t *ctx = IGB_CTX(dev);
+	ctx->users -= 1;
+	AVB_LOGF_DEBUG("igb %s users %d", ctx->ifname, ctx->users);
 
-	if (igb_dev && igb_dev_users <= 0) {
+	if (ctx->users <= 0) {
 		int i;
-		for (i = 0; i < IGB_PAGES; i++)
-			igb_dma_free_page(igb_dev, &g_pages[i]);
-
-		igb_detach(igb_dev);
-		free(igb_dev);
-		igb_dev = NULL;
+		for (i = 0; i < IGB_MAX_DEVICES; i++) {
+			if (g_igb[i] == ctx)
+				g_igb[i] = NULL;
+		}
+		x_igbClose(ctx);
 	}
 
 	UNLOCK();
@@ -189,30 +309,61 @@ void igbReleaseDevice(device_t* dev)
 	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
 }
 
-struct igb_packet *igbGetTxPacket(device_t* dev)
+static void igbReclaimTxPackets(device_t *dev, int queue)
+{
+	u_int32_t count = 0;
+
+	igb_ctx_t *ctx = IGB_CTX(dev);
+	int err = igb_clean_queue(dev, queue, &ctx->txFree[queue].packets, &count);
+	if (err) {
+		AVB_LOGF_DEBUG("igb_clean_queue failed: %s", strerror(err < 0 ? -err : err));
+	}
+	ctx->usedBuffers -= count;
+	ctx->txFree[queue].sinceReclaim = 0;
+}
+
+struct igb_packet *igbGetTxPacket(device_t* dev, int queue)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
 
+	if (!dev || queue < 0 || queue >= IGB_TX_QUEUES) {
+		AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+		return NULL;
+	}
+
 	LOCK();
 
-	struct igb_packet* tx_packet = g_free_packets;
+	igb_ctx_t *ctx = IGB_CTX(dev);
+	igb_tx_free_t *txFree = &ctx->txFree[queue];
 
-	if (!tx_packet) {
-		struct igb_packet *cleaned_packets;
-		igb_clean(dev, &cleaned_packets);
-		while (cleaned_packets) {
-			struct igb_packet *tmp_packet = cleaned_packets;
-			cleaned_packets = cleaned_packets->next;
-			tmp_packet->next = g_free_packets;
-			g_free_packets = tmp_packet;
-		}
-		tx_packet = g_free_packets;
+	// reclaim in bursts rather than for every frame
+	if (txFree->sinceReclaim >= IGB_TX_RECLAIM_FRAMES ||
+		(!txFree->packets && !ctx->freePackets)) {
+		igbReclaimTxPackets(dev, queue);
+	}
 
-		g_usedBuffers = g_totalBuffers - count_packets(g_free_packets);
+	struct igb_packet* tx_packet = txFree->packets;
+	if (tx_packet) {
+		txFree->packets = tx_packet->next;
+	}
+	else if (ctx->freePackets) {
+		tx_packet = ctx->freePackets;
+		ctx->freePackets = tx_packet->next;
+	}
+	else {
+		// borrow from a queue that has buffers to spare
+		int i;
+		for (i = 0; i < IGB_TX_QUEUES && !tx_packet; i++) {
+			if (ctx->txFree[i].packets) {
+				tx_packet = ctx->txFree[i].packets;
+				ctx->txFree[i].packets = tx_packet->next;
+			}
+		}
 	}
 
 	if (tx_packet) {
-		g_free_packets = tx_packet->next;
+		txFree->sinceReclaim++;
+		ctx->usedBuffers++;
 	}
 
 	UNLOCK();
@@ -227,8 +378,16 @@ void igbRelTxPacket(device_t* dev, int queue, struct igb_packet *tx_packet)
 
 	LOCK();
 
-	tx_packet->next = g_free_packets;
-	g_free_packets = tx_packet;
+	igb_ctx_t *ctx = IGB_CTX(dev);
+	if (queue >= 0 && queue < IGB_TX_QUEUES) {
+		tx_packet->next = ctx->txFree[queue].packets;
+		ctx->txFree[queue].packets = tx_packet;
+	}
+	else {
+		tx_packet->next = ctx->freePackets;
+		ctx->freePackets = tx_packet;
+	}
+	ctx->usedBuffers--;
 
 	UNLOCK();
 
@@ -239,12 +398,147 @@ int igbTxBufLevel(device_t *dev)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
 	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
-	return g_usedBuffers;
+	return dev ? IGB_CTX(dev)->usedBuffers : 0;
+}
+
+int igbAcquireRxQueue(device_t *dev)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
+
+	int queue = -1;
+
+	LOCK();
+	if (dev && !IGB_CTX(dev)->rxTried) {
+		igb_ctx_t *ctx = IGB_CTX(dev);
+		ctx->rxTried = TRUE;
+		int err = igb_init_rx(dev);
+		if (err) {
+			AVB_LOGF_WARNING("rx attach failed (%s) - igb RX will fall back to pcap", strerror(err < 0 ? -err : err));
+		}
+		ctx->rxAttached = !err;
+		ctx->rxQueues = IGB_RX_QUEUES;
+		struct igb_queue_info queueInfo;
+		if (igb_get_queue_info(dev, &queueInfo) == 0 && queueInfo.user_queues) {
+			ctx->rxQueues = queueInfo.user_queues;
+		}
+	}
+	if (dev && IGB_CTX(dev)->rxAttached) {
+		igb_ctx_t *ctx = IGB_CTX(dev);
+		int i;
+		for (i = 0; i < ctx->rxQueues; i++) {
+			if (!(ctx->rxQueuesInUse & (1 << i))) {
+				ctx->rxQueuesInUse |= (1 << i);
+				queue = i;
+				break;
+			}
+		}
+	}
+	UNLOCK();
+
+	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+	return queue;
+}
+
+void igbReleaseRxQueue(device_t *dev, int queue)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
+
+	LOCK();
+	if (dev && queue >= 0 && queue < IGB_CTX(dev)->rxQueues) {
+		IGB_CTX(dev)->rxQueuesInUse &= ~(1 << queue);
+	}
+	UNLOCK();
+
+	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+}
+
+struct igb_packet *igbAllocRxPackets(device_t *dev, struct igb_dma_alloc *pages, int nPages, int *nPackets)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
+
+	struct igb_packet *packets = NULL;
+	size_t perPage = 0, count, j;
+	int i;
+
+	*nPackets = 0;
+	if (nPages <= 0) {
+		AVB_LOG_ERROR("No RX pages to allocate");
+		AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+		return NULL;
+	}
+
+	for (i = 0; i < nPages; i++) {
+		int err = igb_dma_malloc_page(dev, &pages[i]);
+		if (err) {
+			AVB_LOGF_ERROR("igb_dma_malloc_page failed: %s", strerror(err));
+			goto error;
+		}
+	}
+
+	// one flat array so the caller can free it no matter where the packets are
+	perPage = pages[0].mmap_size / IGB_RX_BUFSZ;
+	count = (size_t)nPages * perPage;
+	if (count == 0 || count > INT_MAX) {
+		AVB_LOGF_ERROR("RX pages of %u bytes hold no usable number of buffers", (unsigned)pages[0].mmap_size);
+		goto error;
+	}
+	packets = calloc(count, sizeof(struct igb_packet));
+	if (!packets) {
+		AVB_LOG_ERROR("failed to allocate igb_packet memory!");
+		goto error;
+	}
+
+	for (i = 0; i < nPages; i++) {
+		for (j = 0; j < perPage; j++) {
+			struct igb_packet *packet = &packets[i * perPage + j];
+			packet->map.paddr = pages[i].dma_paddr;
+			packet->map.mmap_size = pages[i].mmap_size;
+			packet->offset = (j * IGB_RX_BUFSZ);
+			packet->vaddr = pages[i].dma_vaddr + packet->offset;
+			packet->len = IGB_RX_BUFSZ;
+			packet->next = NULL;
+		}
+	}
+
+	*nPackets = (int)count;
+	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+	return packets;
+
+error:
+	while (--i >= 0)
+		igb_dma_free_page(dev, &pages[i]);
+	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+	return NULL;
+}
+
+void igbFreeRxPackets(device_t *dev, struct igb_packet *packets, struct igb_dma_alloc *pages, int nPages)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
+
+	int i;
+	for (i = 0; i < nPages; i++)
+		igb_dma_free_page(dev, &pages[i]);
+	free(packets);
+
+	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
 }
 
 bool igbGetMacAddr(U8 mac_addr[ETH_ALEN])
 {
-	int err = igb_get_mac_addr(igb_dev, mac_addr);
+	device_t *dev = NULL;
+	int i;
+
+	LOCK();
+	for (i = 0; i < IGB_MAX_DEVICES && !dev; i++) {
+		if (g_igb[i])
+			dev = &g_igb[i]->dev;
+	}
+	UNLOCK();
+	if (!dev) {
+		return FALSE;
+	}
+
+	int err = igb_get_mac_addr(dev, mac_addr);
 	if (err) {
 		AVB_LOGF_ERROR("igb_get_mac_addr() failed: %s", strerror(err));
 	}
@@ -281,3 +575,57 @@ error:
 	return !err;
 }
 
+// SYSTIM reads averaged into one cross timestamp
+#define IGB_XTS_SAMPLES 16
+
+// how long a cross timestamp is extrapolated before it is retaken
+#define IGB_XTS_REFRESH_NSEC NANOSECONDS_PER_SECOND
+
+// a rate between cross timestamps further than this from the burst rate
+// means SYSTIM was stepped in between
+#define IGB_XTS_MAX_RATE_DIFF 0.01
+
+static __thread struct igb_crosststamp tXts;
+static __thread bool tXtsValid = FALSE;
+static __thread device_t *tXtsDev;	// NIC tXts was taken on
+
+bool igbGetLocalTime(device_t *dev, U64 *localNsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_HAL_ETHER);
+
+	U64 now;
+	if (tXtsDev != dev) {
+		tXtsValid = FALSE;
+		tXtsDev = dev;
+	}
+	if (tXtsValid && igb_crosststamp_now(&tXts, &now) == 0
+		&& now - tXts.systim < IGB_XTS_REFRESH_NSEC) {
+		*localNsec = now;
+		AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+		return TRUE;
+	}
+
+	struct igb_crosststamp xts;
+	int err = igb_get_crosststamp(dev, IGB_XTS_SAMPLES, &xts);
+	if (err) {
+		IF_LOG_INTERVAL(1000) AVB_LOGF_ERROR("igb_get_crosststamp failed: %s", strerror(-err));
+		AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+		return FALSE;
+	}
+
+	// The burst only spans microseconds; the rate since the previous
+	// cross timestamp is measured over the whole refresh interval.
+	if (tXtsValid && xts.tsc > tXts.tsc) {
+		double rate = (double)(int64_t)(xts.systim - tXts.systim) / (double)(xts.tsc - tXts.tsc);
+		if (xts.rate <= 0 || fabs(rate - xts.rate) < xts.rate * IGB_XTS_MAX_RATE_DIFF)
+			xts.rate = rate;
+	}
+	tXts = xts;
+	tXtsValid = TRUE;
+
+	if (igb_crosststamp_now(&tXts, localNsec) != 0)
+		*localNsec = tXts.systim;
+
+	AVB_TRACE_EXIT(AVB_TRACE_HAL_ETHER);
+	return TRUE;
+}
@@ -41,18 +41,57 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // how many pages to alloc for tx buffers (2 frames fit in one page)
 #define IGB_PAGES 20
 
+// number of tx queues the talkers use (class A and class B)
+#define IGB_TX_QUEUES 2
+
+// reclaim completed tx buffers of a queue once per this many frames
+#define IGB_TX_RECLAIM_FRAMES 16
+
+// user-space RX queues set up by igb_init_rx() when the driver doesn't
+// report its avb_user_queues
+#define IGB_RX_QUEUES 2
+
+// rx buffer size; must match the SRRCTL packet buffer size set by igb_init()
+#define IGB_RX_BUFSZ 2048
+
+// how many pages to alloc for the rx buffers of one queue
+#define IGB_RX_PAGES 32
+
+// how many NICs one process may attach, one per interface
+#define IGB_MAX_DEVICES 4
+
+// Attach the NIC behind ifname, or share it when already attached. Each
+// NIC has its own TX buffers and RX queues; ifname NULL takes the device
+// already in use, else the first one found.
+device_t *igbAcquireDeviceIf(const char *ifname);
+
 device_t *igbAcquireDevice();
 
 void igbReleaseDevice(device_t *igb_dev);
 
-struct igb_packet *igbGetTxPacket(device_t* dev);
+struct igb_packet *igbGetTxPacket(device_t* dev, int queue);
 
 void igbRelTxPacket(device_t* dev, int queue, struct igb_packet *tx_packet);
 
 int igbTxBufLevel(device_t *dev);
 
+// Claim a free user-space RX queue; returns -1 when none is available.
+// The first claim on a device attaches its RX queues.
+int igbAcquireRxQueue(device_t *dev);
+
+void igbReleaseRxQueue(device_t *dev, int queue);
+
+// Allocate nPages DMA pages and split them into an array of RX packets
+struct igb_packet *igbAllocRxPackets(device_t *dev, struct igb_dma_alloc *pages, int nPages, int *nPackets);
+
+void igbFreeRxPackets(device_t *dev, struct igb_packet *packets, struct igb_dma_alloc *pages, int nPages);
+
 bool igbGetMacAddr(U8 mac_addr[ETH_ALEN]);
 
 bool igbControlLaunchTime(device_t *dev, int enable);
 
+// Current time of the NIC clock (SYSTIM, the clock launch times are given
+// in), extrapolated with the TSC from a cross timestamp taken once a second.
+bool igbGetLocalTime(device_t *dev, U64 *localNsec);
+
 #endif	// OPENAVB_IGB_H
@@ -41,6 +41,13 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include "openavb_qmgr.h"
 #include "avb_sched.h"
+#include "rawsock/cbs_rawsock.h"
+
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/pkt_sched.h>
 
 #if (AVB_FEATURE_IGB)
 #include "openavb_igb.h"
@@ -48,6 +55,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #define AVB_DEFAULT_QDISC_MODE AVB_SHAPER_HWQ_PER_CLASS
 
+// Share of the link the SR classes may reserve together (IEEE 802.1Q 34.3.1)
+#define QMGR_SR_MAX_LINK_PERCENT 75
+
 // We have a singleton Qmgr, so we use file-static data here
 
 // Qdisc configuration
@@ -62,6 +72,13 @@ typedef struct {
 	U32 nsrKbit;
 	U32 linkMTU;
 	int ref;
+	// Parent of the ETF qdisc we added for launch time, 0 for none
+	U32 etfParent;
+	// Parents of the CBS qdisc for each class, 0 for none
+	U32 cbsParent[MAX_AVB_SR_CLASSES];
+	bool bCbsOffload;
+	// Class credits shared with the talkers, in AVB_SHAPER_SW mode
+	cbs_rawsock_t *swShaper;
 } qdisc_data_t;
 
 static qdisc_data_t qdisc_data;
@@ -82,6 +99,9 @@ typedef struct {
 	unsigned classRate;
 	unsigned maxIntervalFrames;
 	unsigned maxFrameSize;
+#if (AVB_FEATURE_IGB)
+	int igbStreamId;	// igb shaper reservation, -1 for none
+#endif
 } qmgrStream_t;
 
 // Arrays to hold info for classes and streams
@@ -94,6 +114,35 @@ static qmgrStream_t qmgr_streams[MAX_AVB_STREAMS];
 #error MAX_AVB_STREAMS_PER_CLASS too large for FWMARK encoding
 #endif
 
+static int x_cbsSetup(U32 class_a_bytes_per_sec, U32 class_b_bytes_per_sec);
+
+// Whether another streamBytesPerSec fits in what the SR classes may
+// reserve. The class totals are kept up to date as streams come and go,
+// so this is a sum of the classes, not of the streams.
+static bool x_srBandwidthFits(unsigned long streamBytesPerSec)
+{
+	U64 limitKbit, reservedBytes = streamBytesPerSec;
+	int nClass;
+
+	if (!qdisc_data.linkKbit)
+		return TRUE;	// link speed unknown, leave it to the shaper
+
+	// and leave what is kept for non-SR traffic
+	limitKbit = (U64)qdisc_data.linkKbit * QMGR_SR_MAX_LINK_PERCENT / 100;
+	if (qdisc_data.nsrKbit) {
+		U64 srKbit = qdisc_data.nsrKbit < qdisc_data.linkKbit ? qdisc_data.linkKbit - qdisc_data.nsrKbit : 0;
+		if (srKbit < limitKbit)
+			limitKbit = srKbit;
+	}
+
+	for (nClass = SR_CLASS_A; nClass < MAX_AVB_SR_CLASSES; nClass++)
+		reservedBytes += qmgr_classes[nClass].classBytesPerSec;
+
+	return reservedBytes * 8 <= limitKbit * 1000;
+}
+
+// The igb shaper is adjusted per stream by the callers (see
+// igb_add_stream_bandwidth()); this only reprograms the CBS qdiscs.
 static bool setupHWQueue(int nClass, unsigned classBytesPerSec)
 {
 	int err = 0;
@@ -108,16 +157,217 @@ static bool setupHWQueue(int nClass, unsigned classBytesPerSec)
 		class_a_bytes_per_sec =  qmgr_classes[SR_CLASS_A].classBytesPerSec;
 		class_b_bytes_per_sec = classBytesPerSec;
 	}
-#if (AVB_FEATURE_IGB)
-	err = igb_set_class_bandwidth2(qdisc_data.igb_dev, class_a_bytes_per_sec, class_b_bytes_per_sec);
-	if (err)
-		AVB_LOGF_ERROR("Adding stream; igb_set_class_bandwidth failed: %s", strerror(err));
-#endif
+	if (qdisc_data.cbsParent[SR_CLASS_A] || qdisc_data.cbsParent[SR_CLASS_B]) {
+		err = x_cbsSetup(class_a_bytes_per_sec, class_b_bytes_per_sec);
+	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_QUEUE_MANAGER);
 	return !err;
 }
 
+// Append a netlink attribute to the request
+static struct rtattr *x_nlAddAttr(struct nlmsghdr *pNh, unsigned maxLen, int type, const void *data, unsigned len)
+{
+	struct rtattr *pAttr = (struct rtattr *)(((char *)pNh) + NLMSG_ALIGN(pNh->nlmsg_len));
+	if (NLMSG_ALIGN(pNh->nlmsg_len) + RTA_SPACE(len) > maxLen)
+		return NULL;
+	pAttr->rta_type = type;
+	pAttr->rta_len = RTA_LENGTH(len);
+	if (len)
+		memcpy(RTA_DATA(pAttr), data, len);
+	pNh->nlmsg_len = NLMSG_ALIGN(pNh->nlmsg_len) + RTA_SPACE(len);
+	return pAttr;
+}
+
+// Add or change (RTM_NEWQDISC) or delete (RTM_DELQDISC) a qdisc of the
+// given kind under parent, with its parameters nested in TCA_OPTIONS.
+// Talks rtnetlink directly so we don't depend on tc or libnl.
+static bool x_qdiscRequest(int type, U32 parent, U32 handle, const char *kind, int parmsType, const void *parms, unsigned parmsLen)
+{
+	struct {
+		struct nlmsghdr nh;
+		struct tcmsg tc;
+		char attrs[128];
+	} req;
+	bool ret = FALSE;
+
+	memset(&req, 0, sizeof(req));
+	req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+	req.nh.nlmsg_type = type;
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	if (type == RTM_NEWQDISC)
+		req.nh.nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+	req.tc.tcm_family = AF_UNSPEC;
+	req.tc.tcm_ifindex = qdisc_data.ifindex ? qdisc_data.ifindex : (int)if_nametoindex(qdisc_data.ifname);
+	req.tc.tcm_parent = parent;
+	req.tc.tcm_handle = handle;
+
+	x_nlAddAttr(&req.nh, sizeof(req), TCA_KIND, kind, strlen(kind) + 1);
+	if (parms) {
+		struct rtattr *pOpts = x_nlAddAttr(&req.nh, sizeof(req), TCA_OPTIONS, NULL, 0);
+		x_nlAddAttr(&req.nh, sizeof(req), parmsType, parms, parmsLen);
+		pOpts->rta_len = ((char *)&req) + req.nh.nlmsg_len - (char *)pOpts;
+	}
+
+	int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (sock < 0) {
+		AVB_LOGF_ERROR("%s qdisc; netlink socket failed: %s", kind, strerror(errno));
+		return FALSE;
+	}
+
+	if (send(sock, &req, req.nh.nlmsg_len, 0) < 0) {
+		AVB_LOGF_ERROR("%s qdisc; netlink send failed: %s", kind, strerror(errno));
+	}
+	else {
+		// Wait for the ack, which carries the error code
+		char buf[1024];
+		int len = recv(sock, buf, sizeof(buf), 0);
+		struct nlmsghdr *pNh = (struct nlmsghdr *)buf;
+		if (len < 0) {
+			AVB_LOGF_ERROR("%s qdisc; netlink recv failed: %s", kind, strerror(errno));
+		}
+		else if (NLMSG_OK(pNh, (unsigned)len) && pNh->nlmsg_type == NLMSG_ERROR) {
+			struct nlmsgerr *pErr = (struct nlmsgerr *)NLMSG_DATA(pNh);
+			if (pErr->error) {
+				AVB_LOGF_ERROR("%s qdisc; %s failed: %s", kind,
+					type == RTM_NEWQDISC ? "add" : "delete", strerror(-pErr->error));
+			}
+			else {
+				ret = TRUE;
+			}
+		}
+	}
+
+	close(sock);
+	return ret;
+}
+
+// Add (RTM_NEWQDISC) or delete (RTM_DELQDISC) the ETF qdisc under parent
+static bool x_etfRequest(int type, U32 parent, U32 deltaNsec, bool offload)
+{
+	if (type != RTM_NEWQDISC)
+		return x_qdiscRequest(type, parent, 0, "etf", 0, NULL, 0);
+
+	struct tc_etf_qopt qopt;
+	memset(&qopt, 0, sizeof(qopt));
+	qopt.delta = deltaNsec;
+	qopt.clockid = CLOCK_TAI;
+	if (offload)
+		qopt.flags |= TC_ETF_OFFLOAD_ON;
+
+	return x_qdiscRequest(type, parent, 0, "etf", TCA_ETF_PARMS, &qopt, sizeof(qopt));
+}
+
+// Program the CBS qdiscs from the class reservations, following the
+// credit bounds of IEEE 802.1Q Annex L. Frame sizes are not tracked per
+// class here, so the link MTU is used for both the interfering and the
+// class frames, which gives slightly wider bounds than needed.
+static int x_cbsSetup(U32 class_a_bytes_per_sec, U32 class_b_bytes_per_sec)
+{
+	S64 portKbit = qdisc_data.linkKbit ? qdisc_data.linkKbit : 1000000;
+	S64 maxFrame = (qdisc_data.linkMTU ? qdisc_data.linkMTU : 1500) + OPENAVB_AVTP_ETHER_FRAME_OVERHEAD;
+	S64 idleKbit[MAX_AVB_SR_CLASSES];
+	int err = 0;
+	int nClass;
+
+	memset(idleKbit, 0, sizeof(idleKbit));
+	idleKbit[SR_CLASS_A] = ((S64)class_a_bytes_per_sec * 8 + 999) / 1000;
+	idleKbit[SR_CLASS_B] = ((S64)class_b_bytes_per_sec * 8 + 999) / 1000;
+
+	for (nClass = SR_CLASS_A; nClass < MAX_AVB_SR_CLASSES; nClass++) {
+		if (!qdisc_data.cbsParent[nClass])
+			continue;
+
+		struct tc_cbs_qopt qopt;
+		memset(&qopt, 0, sizeof(qopt));
+		qopt.offload = qdisc_data.bCbsOffload ? 1 : 0;
+		qopt.idleslope = idleKbit[nClass];
+		qopt.sendslope = idleKbit[nClass] - portKbit;
+		if (nClass == SR_CLASS_A || portKbit <= idleKbit[SR_CLASS_A]) {
+			qopt.hicredit = (idleKbit[nClass] * maxFrame + portKbit - 1) / portKbit;
+		}
+		else {
+			// class B is also held back by class A frames
+			qopt.hicredit = (idleKbit[nClass] * maxFrame + portKbit - idleKbit[SR_CLASS_A] - 1) / (portKbit - idleKbit[SR_CLASS_A])
+				+ (idleKbit[nClass] * maxFrame + portKbit - 1) / portKbit;
+		}
+		qopt.locredit = (qopt.sendslope * maxFrame) / portKbit;
+
+		AVB_LOGF_DEBUG("CBS class %c: idleslope=%d sendslope=%d hicredit=%d locredit=%d",
+			AVB_CLASS_LABEL(nClass), qopt.idleslope, qopt.sendslope, qopt.hicredit, qopt.locredit);
+
+		if (!x_qdiscRequest(RTM_NEWQDISC, qdisc_data.cbsParent[nClass], QMGR_CBS_HANDLE(nClass),
+				"cbs", TCA_CBS_PARMS, &qopt, sizeof(qopt))) {
+			err = EINVAL;
+		}
+	}
+
+	return err;
+}
+
+/* Put an ETF qdisc under parent so frames sent with SO_TXTIME are held
+ * back until their launch time.
+ *
+ * 	parent = tc handle of the qdisc class for the SR TX queue (TC_H_ROOT
+ * 	         for single queue devices)
+ * 	deltaUsec = how long before the launch time the qdisc releases a frame
+ * 	offload = let the NIC do the launch (TC_ETF_OFFLOAD_ON)
+ */
+bool openavbQmgrSetupLaunchTime(U32 parent, U32 deltaUsec, bool offload)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_QUEUE_MANAGER);
+	bool ret = FALSE;
+
+	LOCK();
+
+	if (qdisc_data.ref == 0 || parent == 0) {
+		AVB_LOG_ERROR("Setting up ETF qdisc; invalid argument or QMgr not initialized");
+	}
+	else if (x_etfRequest(RTM_NEWQDISC, parent, deltaUsec * NANOSECONDS_PER_USEC, offload)) {
+		AVB_LOGF_INFO("ETF qdisc added on %s parent %x:%x, delta %u usec%s",
+			qdisc_data.ifname, TC_H_MAJ(parent) >> 16, TC_H_MIN(parent), deltaUsec, offload ? ", offload" : "");
+		qdisc_data.etfParent = parent;
+		ret = TRUE;
+	}
+
+	UNLOCK();
+	AVB_TRACE_EXIT(AVB_TRACE_QUEUE_MANAGER);
+	return ret;
+}
+
+/* Shape a class with a CBS qdisc under parent. The qdisc is given the
+ * handle QMGR_CBS_HANDLE(nClass) so an ETF qdisc can be put under it, and
+ * its slopes follow the class reservation as streams are added and removed.
+ */
+bool openavbQmgrSetupCbs(SRClassIdx_t nClass, U32 parent, bool offload)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_QUEUE_MANAGER);
+	bool ret = FALSE;
+
+	LOCK();
+
+	if (qdisc_data.ref == 0 || (int)nClass < 0 || nClass >= MAX_AVB_SR_CLASSES || parent == 0) {
+		AVB_LOG_ERROR("Setting up CBS qdisc; invalid argument or QMgr not initialized");
+	}
+	else {
+		qdisc_data.cbsParent[nClass] = parent;
+		qdisc_data.bCbsOffload = offload;
+		ret = (x_cbsSetup(qmgr_classes[SR_CLASS_A].classBytesPerSec, qmgr_classes[SR_CLASS_B].classBytesPerSec) == 0);
+		if (ret) {
+			AVB_LOGF_INFO("CBS qdisc %x: for class %c added on %s parent %x:%x%s",
+				TC_H_MAJ(QMGR_CBS_HANDLE(nClass)) >> 16, AVB_CLASS_LABEL(nClass), qdisc_data.ifname,
+				TC_H_MAJ(parent) >> 16, TC_H_MIN(parent), offload ? ", offload" : "");
+		}
+		else {
+			qdisc_data.cbsParent[nClass] = 0;
+		}
+	}
+
+	UNLOCK();
+	AVB_TRACE_EXIT(AVB_TRACE_QUEUE_MANAGER);
+	return ret;
+}
+
 /* Add a stream.
  *
  * 	nClass = index of class (A, B, etc.)
@@ -154,10 +404,30 @@ U16 openavbQmgrAddStream(SRClassIdx_t nClass, unsigned classRate, unsigned maxIn
 
 		if (fwmark == INVALID_FWMARK) {
 			AVB_LOGF_ERROR("Adding stream; too many streams in class %d", nClass);
+		} else if (qdisc_data.mode != AVB_SHAPER_DISABLED && !x_srBandwidthFits(streamBytesPerSec)) {
+			AVB_LOGF_ERROR("Adding stream; %lu bytes/sec over the SR bandwidth of the link (class A %u, class B %u reserved)",
+				streamBytesPerSec, qmgr_classes[SR_CLASS_A].classBytesPerSec, qmgr_classes[SR_CLASS_B].classBytesPerSec);
+			fwmark = INVALID_FWMARK;
 		} else {
 
+#if (AVB_FEATURE_IGB)
+			int igbStreamId = -1;
+#endif
 			if (qdisc_data.mode != AVB_SHAPER_DISABLED) {
-				if (!setupHWQueue(nClass, qmgr_classes[nClass].classBytesPerSec + streamBytesPerSec)) {
+#if (AVB_FEATURE_IGB)
+				// only this stream's class is reprogrammed; other streams keep running
+				int err = qdisc_data.igb_dev ? igb_add_stream_bandwidth(qdisc_data.igb_dev, nClass, streamBytesPerSec, &igbStreamId) : 0;
+				if (err) {
+					AVB_LOGF_ERROR("Adding stream; igb_add_stream_bandwidth failed: %s", strerror(err < 0 ? -err : err));
+					fwmark = INVALID_FWMARK;
+				}
+#endif
+				if (fwmark != INVALID_FWMARK
+					&& !setupHWQueue(nClass, qmgr_classes[nClass].classBytesPerSec + streamBytesPerSec)) {
+#if (AVB_FEATURE_IGB)
+					if (igbStreamId >= 0)
+						igb_remove_stream_bandwidth(qdisc_data.igb_dev, igbStreamId);
+#endif
 					fwmark = INVALID_FWMARK;
 				}
 			}
@@ -165,11 +435,15 @@ U16 openavbQmgrAddStream(SRClassIdx_t nClass, unsigned classRate, unsigned maxIn
 			if (fwmark != INVALID_FWMARK) {
 				// good to go - update stream
 				qmgr_streams[idx].streamBytesPerSec = streamBytesPerSec;
+#if (AVB_FEATURE_IGB)
+				qmgr_streams[idx].igbStreamId = igbStreamId;
+#endif
 				qmgr_streams[idx].classRate = classRate;
 				qmgr_streams[idx].maxIntervalFrames = maxIntervalFrames;
 				qmgr_streams[idx].maxFrameSize = maxFrameSize;
 				// and class
 				qmgr_classes[nClass].classBytesPerSec += streamBytesPerSec;
+				cbsRawsockSetStream(qdisc_data.swShaper, fwmark, streamBytesPerSec);
 
 				AVB_LOGF_DEBUG("Added stream; classBPS=%u, streamBPS=%u", qmgr_classes[nClass].classBytesPerSec, qmgr_streams[idx].streamBytesPerSec);
 			}
@@ -209,11 +483,19 @@ void openavbQmgrRemoveStream(U16 fwmark)
 	}
 	else {
 		if (qdisc_data.mode != AVB_SHAPER_DISABLED) {
+#if (AVB_FEATURE_IGB)
+			if (qmgr_streams[idx].igbStreamId >= 0) {
+				int err = igb_remove_stream_bandwidth(qdisc_data.igb_dev, qmgr_streams[idx].igbStreamId);
+				if (err)
+					AVB_LOGF_ERROR("Removing stream; igb_remove_stream_bandwidth failed: %s", strerror(err < 0 ? -err : err));
+			}
+#endif
 			setupHWQueue(nClass, qmgr_classes[nClass].classBytesPerSec - qmgr_streams[idx].streamBytesPerSec);
 		}
 
 		// update class
 		qmgr_classes[nClass].classBytesPerSec -= qmgr_streams[idx].streamBytesPerSec;
+		cbsRawsockSetStream(qdisc_data.swShaper, fwmark, 0);
 		AVB_LOGF_DEBUG("Removed strea; classBPS=%u, streamBPS=%u", qmgr_classes[nClass].classBytesPerSec, qmgr_streams[idx].streamBytesPerSec);
 		// and stream
 		memset(&qmgr_streams[idx], 0, sizeof(qmgrStream_t));
@@ -253,8 +535,10 @@ bool openavbQmgrInitialize(int mode, int ifindex, const char* ifname, unsigned m
 				   qdisc_data.mode, ifindex, mtu, link_kbit, nsr_kbit);
 
 #if (AVB_FEATURE_IGB)
+	// AVB_SHAPER_SW is for NICs without Qav hardware, so no igb device
 	if ( qdisc_data.mode != AVB_SHAPER_DISABLED
-	     && (qdisc_data.igb_dev = igbAcquireDevice()) == 0)
+	     && qdisc_data.mode != AVB_SHAPER_SW
+	     && (qdisc_data.igb_dev = igbAcquireDeviceIf(ifname)) == 0)
 	{
 		AVB_LOG_ERROR("Initializing QMgr; unable to acquire igb device");
 	}
@@ -275,6 +559,11 @@ bool openavbQmgrInitialize(int mode, int ifindex, const char* ifname, unsigned m
 
 		if (qdisc_data.mode == AVB_SHAPER_DISABLED) {
 			ret = TRUE;
+		} else if (qdisc_data.mode == AVB_SHAPER_SW) {
+			// Talkers on the simple and ring rawsocks pick this up
+			// when they set their fwmark
+			qdisc_data.swShaper = cbsRawsockCreate(qdisc_data.ifname, link_kbit);
+			ret = (qdisc_data.swShaper != NULL);
 		} else {
 			ret = TRUE;
 			// igb device aquired, nothing more to do
@@ -304,9 +593,26 @@ void openavbQmgrFinalize(void)
 		}
 
 #if (AVB_FEATURE_IGB)
-		igbReleaseDevice(qdisc_data.igb_dev);
+		if (qdisc_data.igb_dev)
+			igbReleaseDevice(qdisc_data.igb_dev);
 		qdisc_data.igb_dev = NULL;
 #endif
+		cbsRawsockClose(qdisc_data.swShaper);
+		qdisc_data.swShaper = NULL;
+	}
+
+	if (qdisc_data.ref == 0 && qdisc_data.etfParent) {
+		x_etfRequest(RTM_DELQDISC, qdisc_data.etfParent, 0, FALSE);
+		qdisc_data.etfParent = 0;
+	}
+	if (qdisc_data.ref == 0) {
+		int nClass;
+		for (nClass = SR_CLASS_A; nClass < MAX_AVB_SR_CLASSES; nClass++) {
+			if (qdisc_data.cbsParent[nClass]) {
+				x_qdiscRequest(RTM_DELQDISC, qdisc_data.cbsParent[nClass], QMGR_CBS_HANDLE(nClass), "cbs", 0, NULL, 0);
+				qdisc_data.cbsParent[nClass] = 0;
+			}
+		}
 	}
 
 	UNLOCK();
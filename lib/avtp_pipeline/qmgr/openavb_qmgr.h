@@ -42,6 +42,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #define INVALID_FWMARK (U16)(-1)
 #define DEFAULT_FWMARK (U16)(1)
 
+// tc handle of the CBS qdisc for a class: a0: for class A, b0: for class B
+#define QMGR_CBS_HANDLE(C)	((U32)(0xA0 + ((C) << 4)) << 16)
+
 #define FQTSS_MODE_DISABLED		0
 #define FQTSS_MODE_DROP_ALL		1
 #define FQTSS_MODE_ALL_NONSR	2
@@ -67,6 +70,14 @@ U16 openavbQmgrAddStream(SRClassIdx_t nClass,
 
 void openavbQmgrRemoveStream(U16 fwmark);
 
+// Add an ETF qdisc for SO_TXTIME launch time under the tc handle parent.
+// It is removed again by openavbQmgrFinalize().
+bool openavbQmgrSetupLaunchTime(U32 parent, U32 deltaUsec, bool offload);
+
+// Shape nClass with a CBS qdisc under the tc handle parent, following
+// the reservations of its streams. Removed by openavbQmgrFinalize().
+bool openavbQmgrSetupCbs(SRClassIdx_t nClass, U32 parent, bool offload);
+
 #else
 /* Dummy versions to use if FQTSS is compiled out
  */
@@ -90,6 +101,12 @@ inline U16 openavbQmgrAddStream(SRClassIdx_t nClass,
 inline void openavbQmgrRemoveStream(U16 fwmark)
 
 {}
+
+inline bool openavbQmgrSetupLaunchTime(U32 parent, U32 deltaUsec, bool offload)
+{ return FALSE; }
+
+inline bool openavbQmgrSetupCbs(SRClassIdx_t nClass, U32 parent, bool offload)
+{ return FALSE; }
 #endif // AVB_FEATURE_FQTSS
 
 #endif // AVB_QMGR_H
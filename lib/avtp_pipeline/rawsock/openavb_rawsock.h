@@ -109,6 +109,39 @@ int openavbRawsockRxParseHdr(void* rawsock, U8 *pBuffer, hdr_info_t *pInfo);
 // Release the received frame for re-use.
 bool openavbRawsockRelRxFrame(void *rawsock, U8 *pFrame);
 
+// Maximum number of frames handed out by one openavbRawsockGetRxFrames call
+#define OPENAVB_RAWSOCK_RX_BURST_MAX	32
+
+// Get up to count received frames at once. Each frame is released
+// with openavbRawsockRelRxFrame; backends without batch receive return
+// one frame per call.
+// Returns number of frames placed in pFrames, 0 on timeout (or < 0 for error).
+int openavbRawsockGetRxFrames(void *rawsock,	// rawsock handle
+						   U32 usecTimeout,	// timeout waiting for the first frame (microseconds)
+						   U8 **pFrames,	// array to be filled with frame buffer pointers
+						   U32 *offsets,	// offset of each frame in its frame buffer
+						   U32 *lens,		// length of each received frame
+						   U32 count);		// number of frames wanted (<= OPENAVB_RAWSOCK_RX_BURST_MAX)
+
+// Receive in blocks of frames (ie: TPACKET_V3) instead of frame by frame.
+// A block is handed to the client once it is full or usecTimeout after its
+// first frame arrived, so one wakeup delivers many small frames. Must be
+// called before any frame is received.
+// Returns FALSE if the backend does not support block receive.
+bool openavbRawsockRxSetBlockTimeout(void *rawsock, U32 usecTimeout);
+
+// Have the kernel busy poll the NIC queue for up to usecBusyPoll when
+// receiving (SO_BUSY_POLL / SO_PREFER_BUSY_POLL), instead of waiting for
+// the interrupt. Polling from poll()/ppoll() also needs the
+// net.core.busy_poll sysctl.
+// Returns FALSE if the backend does not support busy polling.
+bool openavbRawsockRxSetBusyPoll(void *rawsock, U32 usecBusyPoll);
+
+// Get the hardware (gPTP clock) receive time of a frame the client still
+// holds, taken by the NIC as the frame arrived.
+// Returns FALSE if the backend or NIC did not timestamp the frame.
+bool openavbRawsockRxGetTimestamp(void *rawsock, U8 *pFrame, U64 *pTimeNsec);
+
 // Add (or drop) membership in link-layer multicast group
 bool openavbRawsockRxMulticast(void *rawsock, bool add_membership, const U8 buf[ETH_ALEN]);
 
@@ -116,6 +149,18 @@ bool openavbRawsockRxMulticast(void *rawsock, bool add_membership, const U8 buf[
 //  delivery the same packet to multiple sockets. 
 bool openavbRawsockRxAVTPSubtype(void *rawsock, U8 subtype);
 
+// Tell the rawsock which stream (network order stream ID) the client wants.
+// Used by rawsock implementations that demultiplex one socket to many streams;
+// others ignore it and return FALSE.
+bool openavbRawsockRxStreamID(void *rawsock, const U8 streamID[8]);
+
+// Receive the frames of a pcap or pcapng capture file instead of frames from
+// the network (pcap rawsock opened on "pcap:file"). Frames are paced at
+// speedPct percent of the captured rate, or handed out as fast as they are
+// asked for with 0. The file is played loops times, or endlessly with 0.
+// Returns FALSE if the backend can't replay or the file can't be read.
+bool openavbRawsockRxReplay(void *rawsock, const char *fileName, U32 speedPct, U32 loops);
+
 // TX FUNCTIONS
 //
 // Setup the header that we'll use on TX Ethernet frames.
@@ -131,6 +176,27 @@ bool openavbRawsockTxFillHdr(void *rawsock,
 // (used to identify packets for FQTSS in kernel)
 bool openavbRawsockTxSetMark(void *rawsock, int prio);
 
+// Have frames launched at the time passed with them instead of as soon
+// as possible. Returns TRUE if the backend honours the launch time
+// (IGB launch time, or SO_TXTIME with an ETF qdisc on the TX queue).
+bool openavbRawsockTxSetLaunchTime(void *rawsock, bool enable);
+
+// Write every sent frame to a pcapng file with nanosecond timestamps (the
+// launch time when there is one, else the gPTP time it was sent).
+// Returns FALSE if the backend can't record or the file can't be created.
+bool openavbRawsockTxRecord(void *rawsock, const char *fileName);
+
+// Have the NIC timestamp the next frame sent on the wire. One timestamp is
+// outstanding at a time; asking again gives up on one that never came back.
+// The interface must have hardware TX timestamping on, as gptp turns it on
+// for its port. Returns FALSE if the backend can't ask for one.
+bool openavbRawsockTxTimestampNext(void *rawsock);
+
+// Read the hardware TX timestamp asked for with openavbRawsockTxTimestampNext,
+// in nanoseconds of the interface's PTP hardware clock. Doesn't wait;
+// returns FALSE until it has come back.
+bool openavbRawsockTxTimestampGet(void *rawsock, U64 *pLocalNsec);
+
 // Get a buffer to hold a frame for transmission.
 // Returns pointer to frame (or NULL).
 U8 *openavbRawsockGetTxFrame(void *rawsock,		// rawsock handle
@@ -150,6 +216,28 @@ bool openavbRawsockTxFrameReady(void *rawsock,	// rawsock handle
 // Returns count of bytes in sent frames - or < 0 for error.
 int openavbRawsockSend(void *rawsock);
 
+// Maximum number of frames handled by one burst call
+#define OPENAVB_RAWSOCK_TX_BURST_MAX	32
+
+// Get up to count buffers to hold frames for transmission.
+// Buffers are returned in transmit order; backends that only have a single
+// TX buffer return one frame per call.
+// Returns number of frames placed in pFrames (or < 0 for error).
+int openavbRawsockGetTxFrames(void *rawsock,	// rawsock handle
+						   bool blocking,	// TRUE blocks until the first frame buffer is available.
+						   U8 **pFrames,	// array to be filled with frame pointers
+						   U32 count,		// number of frames wanted (<= OPENAVB_RAWSOCK_TX_BURST_MAX)
+						   U32 *size);		// size of each frame buffer
+
+// Mark count frames "ready to send" and send them with a single doorbell
+// (one syscall or one descriptor tail update, depending on the backend).
+// Returns number of frames submitted - or < 0 for error.
+int openavbRawsockTxFramesSend(void *rawsock,	// rawsock handle
+							U8 **pFrames,	// frames obtained with openavbRawsockGetTxFrames
+							U32 *lens,		// length of each frame to send
+							U64 *timeNsec,	// launch time of each frame (in gPTP wall clock)
+							U32 count);		// number of frames
+
 // Check Tx buffer level in sockets
 int openavbRawsockTxBufLevel(void *rawsock);
 
@@ -162,4 +250,8 @@ unsigned long openavbRawsockGetTXOutOfBuffers(void *pvRawsock);
 // returns number of TX out of buffer events noticed from the last reporting period
 unsigned long openavbRawsockGetTXOutOfBuffersCyclic(void *pvRawsock);
 
+// Fault in the frame buffers of the rawsock ahead of streaming.
+// Returns the number of bytes touched, 0 if the rawsock has none of its own.
+size_t openavbRawsockPrefault(void *pvRawsock);
+
 #endif // RAWSOCK_H
@@ -38,9 +38,18 @@ void baseRawsockSetRxSignalMode(void *rawsock, bool rxSignalMode) {}
 int baseRawsockGetSocket(void *rawsock) { return -1; }
 U8 *baseRawsockGetRxFrame(void *rawsock, U32 usecTimeout, U32 *offset, U32 *len) { return NULL; }
 bool baseRawsockRelRxFrame(void *rawsock, U8 *pFrame) { return false; }
+bool baseRawsockRxSetBlockTimeout(void *rawsock, U32 usecTimeout) { return false; }
+bool baseRawsockRxSetBusyPoll(void *rawsock, U32 usecBusyPoll) { return false; }
 bool baseRawsockRxMulticast(void *rawsock, bool add_membership, const U8 buf[]) { return false; }
 bool baseRawsockRxAVTPSubtype(void *rawsock, U8 subtype) { return false; }
+bool baseRawsockRxStreamID(void *rawsock, const U8 streamID[]) { return false; }
+bool baseRawsockRxGetTimestamp(void *rawsock, U8 *pFrame, U64 *pTimeNsec) { return false; }
+bool baseRawsockRxReplay(void *rawsock, const char *fileName, U32 speedPct, U32 loops) { return false; }
 bool baseRawsockTxSetMark(void *rawsock, int prio) { return false; }
+bool baseRawsockTxSetLaunchTime(void *rawsock, bool enable) { return false; }
+bool baseRawsockTxRecord(void *rawsock, const char *fileName) { return false; }
+bool baseRawsockTxTimestampNext(void *rawsock) { return false; }
+bool baseRawsockTxTimestampGet(void *rawsock, U64 *pLocalNsec) { return false; }
 U8 *baseRawsockGetTxFrame(void *rawsock, bool blocking, U32 *size) { return NULL; }
 bool baseRawsockRelTxFrame(void *rawsock, U8 *pBuffer) { return false; }
 bool baseRawsockTxFrameReady(void *rawsock, U8 *pFrame, U32 len, U64 timeNsec) { return false; }
@@ -49,6 +58,7 @@ int baseRawsockTxBufLevel(void *rawsock) { return -1; }
 int baseRawsockRxBufLevel(void *rawsock) { return -1; }
 unsigned long baseRawsockGetTXOutOfBuffers(void *pvRawsock) { return 0; }
 unsigned long baseRawsockGetTXOutOfBuffersCyclic(void *pvRawsock) { return 0; }
+size_t baseRawsockPrefault(void *pvRawsock) { return 0; }
 
 void* baseRawsockOpen(base_rawsock_t* rawsock, const char *ifname, bool rx_mode, bool tx_mode, U16 ethertype, U32 frame_size, U32 num_frames)
 {
@@ -58,6 +68,7 @@ void* baseRawsockOpen(base_rawsock_t* rawsock, const char *ifname, bool rx_mode,
 	rawsock->txMode = tx_mode;
 	rawsock->frameSize = frame_size;
 	rawsock->ethertype = ethertype;
+	rawsock->pTxBurstFrame = NULL;
 
 	// fill virtual functions table
 	rawsock_cb_t *cb = &rawsock->cb;
@@ -68,19 +79,32 @@ void* baseRawsockOpen(base_rawsock_t* rawsock, const char *ifname, bool rx_mode,
 	cb->getRxFrame = baseRawsockGetRxFrame;
 	cb->rxParseHdr = baseRawsockRxParseHdr;
 	cb->relRxFrame = baseRawsockRelRxFrame;
+	cb->getRxFrames = baseRawsockGetRxFrames;
+	cb->rxSetBlockTimeout = baseRawsockRxSetBlockTimeout;
+	cb->rxSetBusyPoll = baseRawsockRxSetBusyPoll;
 	cb->rxMulticast = baseRawsockRxMulticast;
 	cb->rxAVTPSubtype = baseRawsockRxAVTPSubtype;
+	cb->rxStreamID = baseRawsockRxStreamID;
+	cb->rxGetTimestamp = baseRawsockRxGetTimestamp;
+	cb->rxReplay = baseRawsockRxReplay;
 	cb->txSetHdr = baseRawsockTxSetHdr;
 	cb->txFillHdr = baseRawsockTxFillHdr;
 	cb->txSetMark = baseRawsockTxSetMark;
+	cb->txSetLaunchTime = baseRawsockTxSetLaunchTime;
+	cb->txRecord = baseRawsockTxRecord;
+	cb->txTimestampNext = baseRawsockTxTimestampNext;
+	cb->txTimestampGet = baseRawsockTxTimestampGet;
 	cb->getTxFrame = baseRawsockGetTxFrame;
 	cb->relTxFrame = baseRawsockRelTxFrame;
 	cb->txFrameReady = baseRawsockTxFrameReady;
 	cb->send = baseRawsockSend;
+	cb->getTxFrames = baseRawsockGetTxFrames;
+	cb->txFramesSend = baseRawsockTxFramesSend;
 	cb->txBufLevel = baseRawsockTxBufLevel;
 	cb->rxBufLevel = baseRawsockRxBufLevel;
 	cb->getTXOutOfBuffers = baseRawsockGetTXOutOfBuffers;
 	cb->getTXOutOfBuffersCyclic = baseRawsockGetTXOutOfBuffersCyclic;
+	cb->prefault = baseRawsockPrefault;
 
 
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
@@ -165,6 +189,83 @@ bool baseRawsockTxFillHdr(void *pvRawsock, U8 *pBuffer, unsigned int *hdrlen)
 	return TRUE;
 }
 
+// Default burst implementation for backends with a single TX buffer:
+// hand out one frame per call through the backend's getTxFrame. The frame
+// is not handed out again until it has been sent.
+int baseRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, U32 *size)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	base_rawsock_t *rawsock = (base_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || size == NULL) {
+		AVB_LOG_ERROR("Getting TX frames; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	int ret = 0;
+	if (count > 0 && !rawsock->pTxBurstFrame) {
+		pFrames[0] = rawsock->cb.getTxFrame(pvRawsock, blocking, size);
+		if (pFrames[0]) {
+			rawsock->pTxBurstFrame = pFrames[0];
+			ret = 1;
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
+// Default burst implementation: mark each frame ready, then send once.
+int baseRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, U32 *lens, U64 *timeNsec, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	base_rawsock_t *rawsock = (base_rawsock_t*)pvRawsock;
+
+	if (!VALID_TX_RAWSOCK(rawsock) || pFrames == NULL || lens == NULL || timeNsec == NULL) {
+		AVB_LOG_ERROR("Sending TX frames; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	U32 i;
+	for (i = 0; i < count; i++) {
+		if (pFrames[i] == rawsock->pTxBurstFrame)
+			rawsock->pTxBurstFrame = NULL;
+		if (!rawsock->cb.txFrameReady(pvRawsock, pFrames[i], lens[i], timeNsec[i]))
+			break;
+	}
+	if (i > 0)
+		rawsock->cb.send(pvRawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return i;
+}
+
+// Default batch receive for backends that deliver frame by frame:
+// hand out one frame per call through the backend's getRxFrame.
+int baseRawsockGetRxFrames(void *pvRawsock, U32 usecTimeout, U8 **pFrames, U32 *offsets, U32 *lens, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+	base_rawsock_t *rawsock = (base_rawsock_t*)pvRawsock;
+
+	if (!VALID_RX_RAWSOCK(rawsock) || pFrames == NULL || offsets == NULL || lens == NULL) {
+		AVB_LOG_ERROR("Getting RX frames; bad arguments");
+		AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+		return -1;
+	}
+
+	int ret = 0;
+	if (count > 0) {
+		pFrames[0] = rawsock->cb.getRxFrame(pvRawsock, usecTimeout, &offsets[0], &lens[0]);
+		if (pFrames[0])
+			ret = 1;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
 // Get the ethernet address of the interface
 bool baseRawsockGetAddr(void *pvRawsock, U8 addr[ETH_ALEN])
 {
@@ -243,6 +344,46 @@ bool openavbRawsockTxSetMark(void *pvRawsock, int mark)
 	return ret;
 }
 
+bool openavbRawsockTxSetLaunchTime(void *pvRawsock, bool enable)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.txSetLaunchTime(pvRawsock, enable);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
+
+bool openavbRawsockTxRecord(void *pvRawsock, const char *fileName)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.txRecord(pvRawsock, fileName);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
+
+bool openavbRawsockTxTimestampNext(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.txTimestampNext(pvRawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
+bool openavbRawsockTxTimestampGet(void *pvRawsock, U64 *pLocalNsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.txTimestampGet(pvRawsock, pLocalNsec);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
 bool openavbRawsockTxSetHdr(void *pvRawsock, hdr_info_t *pHdr)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
@@ -293,6 +434,26 @@ int openavbRawsockSend(void *pvRawsock)
 	return ret;
 }
 
+int openavbRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, U32 *size)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	int ret = ((base_rawsock_t*)pvRawsock)->cb.getTxFrames(pvRawsock, blocking, pFrames, count, size);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
+int openavbRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, U32 *lens, U64 *timeNsec, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	int ret = ((base_rawsock_t*)pvRawsock)->cb.txFramesSend(pvRawsock, pFrames, lens, timeNsec, count);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
 int openavbRawsockTxBufLevel(void *pvRawsock)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
@@ -343,6 +504,56 @@ bool openavbRawsockRelRxFrame(void *pvRawsock, U8 *pBuffer)
 	return ret;
 }
 
+int openavbRawsockGetRxFrames(void *pvRawsock, U32 usecTimeout, U8 **pFrames, U32 *offsets, U32 *lens, U32 count)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	int ret = ((base_rawsock_t*)pvRawsock)->cb.getRxFrames(pvRawsock, usecTimeout, pFrames, offsets, lens, count);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
+bool openavbRawsockRxSetBlockTimeout(void *pvRawsock, U32 usecTimeout)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.rxSetBlockTimeout(pvRawsock, usecTimeout);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
+
+bool openavbRawsockRxSetBusyPoll(void *pvRawsock, U32 usecBusyPoll)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.rxSetBusyPoll(pvRawsock, usecBusyPoll);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
+
+bool openavbRawsockRxReplay(void *pvRawsock, const char *fileName, U32 speedPct, U32 loops)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.rxReplay(pvRawsock, fileName, speedPct, loops);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
+
+bool openavbRawsockRxGetTimestamp(void *pvRawsock, U8 *pFrame, U64 *pTimeNsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK_DETAIL);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.rxGetTimestamp(pvRawsock, pFrame, pTimeNsec);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
+	return ret;
+}
+
 bool openavbRawsockRxMulticast(void *pvRawsock, bool add_membership, const U8 addr[ETH_ALEN])
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
@@ -363,6 +574,16 @@ bool openavbRawsockRxAVTPSubtype(void *pvRawsock, U8 subtype)
 	return ret;
 }
 
+bool openavbRawsockRxStreamID(void *pvRawsock, const U8 streamID[8])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	bool ret = ((base_rawsock_t*)pvRawsock)->cb.rxStreamID(pvRawsock, streamID);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
+
 int openavbRawsockGetSocket(void *pvRawsock)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
@@ -402,3 +623,13 @@ unsigned long openavbRawsockGetTXOutOfBuffersCyclic(void *pvRawsock)
 	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK_DETAIL);
 	return ret;
 }
+
+size_t openavbRawsockPrefault(void *pvRawsock)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_RAWSOCK);
+
+	size_t ret = ((base_rawsock_t*)pvRawsock)->cb.prefault(pvRawsock);
+
+	AVB_TRACE_EXIT(AVB_TRACE_RAWSOCK);
+	return ret;
+}
@@ -68,19 +68,32 @@ typedef struct {
 	U8* (*getRxFrame)(void* rawsock, U32 usecTimeout, U32* offset, U32* len);
 	int (*rxParseHdr)(void* rawsock, U8* pBuffer, hdr_info_t* pInfo);
 	bool (*relRxFrame)(void* rawsock, U8* pFrame);
+	int (*getRxFrames)(void* rawsock, U32 usecTimeout, U8** pFrames, U32* offsets, U32* lens, U32 count);
+	bool (*rxSetBlockTimeout)(void* rawsock, U32 usecTimeout);
+	bool (*rxSetBusyPoll)(void* rawsock, U32 usecBusyPoll);
 	bool (*rxMulticast)(void* rawsock, bool add_membership, const U8 buf[ETH_ALEN]);
 	bool (*rxAVTPSubtype)(void* rawsock, U8 subtype);
+	bool (*rxStreamID)(void* rawsock, const U8 streamID[8]);
+	bool (*rxGetTimestamp)(void* rawsock, U8* pFrame, U64* pTimeNsec);
+	bool (*rxReplay)(void* rawsock, const char* fileName, U32 speedPct, U32 loops);
 	bool (*txSetHdr)(void* rawsock, hdr_info_t* pInfo);
 	bool (*txFillHdr)(void* rawsock, U8* pBuffer, U32* hdrlen);
 	bool (*txSetMark)(void* rawsock, int prio);
+	bool (*txSetLaunchTime)(void* rawsock, bool enable);
+	bool (*txRecord)(void* rawsock, const char* fileName);
+	bool (*txTimestampNext)(void* rawsock);
+	bool (*txTimestampGet)(void* rawsock, U64* pLocalNsec);
 	U8* (*getTxFrame)(void* rawsock, bool blocking, U32* size);
 	bool (*relTxFrame)(void* rawsock, U8* pBuffer);
 	bool (*txFrameReady)(void* rawsock, U8* pFrame, U32 len, U64 timeNsec);
 	int (*send)(void* rawsock);
+	int (*getTxFrames)(void* rawsock, bool blocking, U8** pFrames, U32 count, U32* size);
+	int (*txFramesSend)(void* rawsock, U8** pFrames, U32* lens, U64* timeNsec, U32 count);
 	int (*txBufLevel)(void* rawsock);
 	int (*rxBufLevel)(void* rawsock);
 	unsigned long (*getTXOutOfBuffers)(void* pvRawsock);
 	unsigned long (*getTXOutOfBuffersCyclic)(void* pvRawsock);
+	size_t (*prefault)(void* pvRawsock);
 } rawsock_cb_t;
 
 // State information for raw socket
@@ -111,6 +124,9 @@ typedef struct base_rawsock {
 	// RX usage of the socket
 	bool rxMode;
 
+	// TX frame handed out by baseRawsockGetTxFrames and not yet sent
+	U8 *pTxBurstFrame;
+
 } base_rawsock_t;
 
 // Argument validation
@@ -124,5 +140,10 @@ bool baseRawsockTxSetHdr(void *pvRawsock, hdr_info_t *pHdr);
 bool baseRawsockTxFillHdr(void *pvRawsock, U8 *pBuffer, unsigned int *hdrlen);
 bool baseRawsockGetAddr(void *pvRawsock, U8 addr[ETH_ALEN]);
 int baseRawsockRxParseHdr(void *pvRawsock, U8 *pBuffer, hdr_info_t *pInfo);
+int baseRawsockGetTxFrames(void *pvRawsock, bool blocking, U8 **pFrames, U32 count, U32 *size);
+int baseRawsockTxFramesSend(void *pvRawsock, U8 **pFrames, U32 *lens, U64 *timeNsec, U32 count);
+int baseRawsockGetRxFrames(void *pvRawsock, U32 usecTimeout, U8 **pFrames, U32 *offsets, U32 *lens, U32 count);
+bool baseRawsockTxTimestampNext(void *rawsock);
+bool baseRawsockTxTimestampGet(void *rawsock, U64 *pLocalNsec);
 
 #endif // RAWSOCK_IMPL_H
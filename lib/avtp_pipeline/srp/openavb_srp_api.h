@@ -171,6 +171,13 @@ openavbRC openavbSrpAttachStream     (void* avtpHandle,
 // and, if any, listener declaration for, the indicated stream.
 openavbRC openavbSrpDetachStream     (AVBStreamID_t* streamId);
 
+// Hold back the declarations made by the calls above until the matching
+// openavbSrpBatchFlush(), which hands them to SRP in one go. Lets the
+// endpoint declare all the streams its clients brought up in one service
+// pass together instead of one after another. Calls nest.
+void     openavbSrpBatchBegin       (void);
+openavbRC openavbSrpBatchFlush       (void);
+
 // Get the Priority Code Point (PCP), VLAN Id and 1/classMeasurementInterval
 // (in seconds) for the indicated SR Class
 openavbRC openavbSrpGetClassParams   (SRClassIdx_t SRClassIdx, U8* priority, U16* vid, U32* inverseIntervalSec);
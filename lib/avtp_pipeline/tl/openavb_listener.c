@@ -40,6 +40,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_tl.h"
 #include "openavb_avtp.h"
 #include "openavb_listener.h"
+#include "openavb_listener_pool.h"
 
 // DEBUG Uncomment to turn on logging for just this module.
 //#define AVB_LOG_ON	1
@@ -49,6 +50,125 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include "openavb_debug.h"
 
+// Adaptive buffer depth: fewest margin samples a second to size from, fewest
+// items the queue is limited to, and seconds with drops in a row before it grows
+#define LISTENER_ADAPT_MIN_SAMPLES		100
+#define LISTENER_ADAPT_MIN_DEPTH		4
+#define LISTENER_ADAPT_TROUBLE_SECS		2
+
+static void x_listenerAdaptStart(tl_state_t *pTLState)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	listener_data_t *pListenerData = pTLState->pPvtListenerData;
+	media_q_t *pMediaQ = pTLState->pMediaQ;
+
+	pListenerData->adaptMaxDepth = 0;
+	if (!pCfg->rx_adapt_permille)
+		return;
+
+	int itemCount = 0, itemSize = 0;
+	if (!openavbMediaQGetSize(pMediaQ, &itemCount, &itemSize) || itemCount <= LISTENER_ADAPT_MIN_DEPTH) {
+		AVB_LOG_WARNING("Media queue too small for rx_adapt_permille; ignored");
+		return;
+	}
+
+	pListenerData->adaptMaxDepth = itemCount;
+	pListenerData->adaptDepth = itemCount;
+	pListenerData->adaptStaleUsec = pCfg->max_stale;
+	pListenerData->adaptTroubleSecs = 0;
+	pListenerData->adaptPurged = openavbMediaQPurgedItems(pMediaQ);
+	pListenerData->adaptLimited = openavbMediaQDepthLimitedItems(pMediaQ);
+	openavbHistSnapshot(&pTLState->hist[TL_HIST_RX_MARGIN], &pListenerData->adaptPrevHist);
+	openavbMediaQSetDepthLimit(pMediaQ, 0);
+	openavbMediaQSetMaxStaleTail(pMediaQ, pCfg->max_stale);
+}
+
+// Once a second: the items queued at once are the arrival rate times how long
+// they wait for presentation, so the margin percentile of the last second sets
+// the depth limit. The limit comes down by half the distance at a time and
+// goes straight up to what is needed; drops on the limit or stale purges
+// that go on grow it and the stale tail on top of that.
+static void x_listenerAdapt(tl_state_t *pTLState)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	listener_data_t *pListenerData = pTLState->pPvtListenerData;
+	media_q_t *pMediaQ = pTLState->pMediaQ;
+
+	if (!pListenerData->adaptMaxDepth)
+		return;
+
+	// The last second's share of the margin histogram. A reset one (stats
+	// cleared) counts from zero.
+	openavb_hist_t *pPrev = &pListenerData->adaptPrevHist;
+	openavb_hist_t *pHist = &pListenerData->adaptHist;
+	openavbHistSnapshot(&pTLState->hist[TL_HIST_RX_MARGIN], pHist);
+	U64 nSamples = 0;
+	U32 i1;
+	for (i1 = 0; i1 < OPENAVB_HIST_BUCKETS; i1++) {
+		U32 now = pHist->bucket[i1];
+		U32 prev = pPrev->bucket[i1];
+		pPrev->bucket[i1] = now;
+		pHist->bucket[i1] = now >= prev ? now - prev : now;
+		nSamples += pHist->bucket[i1];
+	}
+	pPrev->count = pHist->count;
+	pHist->count = nSamples;
+
+	U64 purged = openavbMediaQPurgedItems(pMediaQ);
+	U64 limited = openavbMediaQDepthLimitedItems(pMediaQ);
+	bool bTrouble = purged != pListenerData->adaptPurged || limited != pListenerData->adaptLimited;
+	pListenerData->adaptPurged = purged;
+	pListenerData->adaptLimited = limited;
+
+	U32 depth = pListenerData->adaptDepth;
+	U32 staleUsec = pListenerData->adaptStaleUsec;
+	U32 marginUsec = pCfg->rx_adapt_margin_usec;
+	if (bTrouble) {
+		if (++pListenerData->adaptTroubleSecs < LISTENER_ADAPT_TROUBLE_SECS)
+			return;
+		pListenerData->adaptTroubleSecs = 0;
+		depth += depth / 2 + 1;
+		staleUsec = staleUsec * 2 > marginUsec ? staleUsec * 2 : marginUsec;
+	}
+	else {
+		pListenerData->adaptTroubleSecs = 0;
+		if (nSamples < LISTENER_ADAPT_MIN_SAMPLES)
+			return;
+
+		U64 waitNS = openavbHistPercentile(pHist, pCfg->rx_adapt_permille / 10.0)
+			+ (U64)marginUsec * NANOSECONDS_PER_USEC;
+		U32 need = (nSamples * waitNS + NANOSECONDS_PER_SECOND - 1) / NANOSECONDS_PER_SECOND + 2;
+		if (need < depth)
+			depth -= (depth - need + 1) / 2;
+		else
+			depth = need;
+		if (staleUsec > marginUsec)
+			staleUsec -= (staleUsec - marginUsec + 1) / 2;
+	}
+
+	if (depth < LISTENER_ADAPT_MIN_DEPTH)
+		depth = LISTENER_ADAPT_MIN_DEPTH;
+	if (depth > pListenerData->adaptMaxDepth)
+		depth = pListenerData->adaptMaxDepth;
+	if (staleUsec > pCfg->max_stale)
+		staleUsec = pCfg->max_stale;
+
+	if (depth != pListenerData->adaptDepth || staleUsec != pListenerData->adaptStaleUsec) {
+		if (bTrouble) {
+			AVB_LOGF_INFO(STREAMID_FORMAT" drops; media queue depth raised to %u of %u items, max_stale to %uus",
+				STREAMID_ARGS(&pListenerData->streamID), depth, pListenerData->adaptMaxDepth, staleUsec);
+		}
+		else {
+			AVB_LOGF_DEBUG(STREAMID_FORMAT" media queue depth %u of %u items, max_stale %uus",
+				STREAMID_ARGS(&pListenerData->streamID), depth, pListenerData->adaptMaxDepth, staleUsec);
+		}
+		pListenerData->adaptDepth = depth;
+		pListenerData->adaptStaleUsec = staleUsec;
+		openavbMediaQSetDepthLimit(pMediaQ, depth < pListenerData->adaptMaxDepth ? depth : 0);
+		openavbMediaQSetMaxStaleTail(pMediaQ, staleUsec);
+	}
+}
+
 bool listenerStartStream(tl_state_t *pTLState)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_TL);
@@ -72,6 +192,8 @@ bool listenerStartStream(tl_state_t *pTLState)
 		pListenerData->destAddr,
 		pCfg->raw_rx_buffers,
 		pCfg->rx_signal_mode,
+		pCfg->rx_block_intervals * (pCfg->sr_class == SR_CLASS_A ? 125 : 250),
+		pTLState->pAvtpStorage,
 		&pListenerData->avtpHandle);
 	if (IS_OPENAVB_FAILURE(rc)) {
 		AVB_LOG_ERROR("Failed to create AVTP stream");
@@ -79,6 +201,30 @@ bool listenerStartStream(tl_state_t *pTLState)
 		return FALSE;
 	}
 
+	if (pCfg->rx_busy_poll_usec) {
+		openavbAvtpRxSetBusyPoll(pListenerData->avtpHandle, pCfg->rx_busy_poll_usec);
+	}
+
+	if (pCfg->redundant_ifname[0]
+		&& !openavbAvtpSetRedundant(pListenerData->avtpHandle, pCfg->redundant_ifname,
+			pCfg->redundant_dest_addr.mac ? pCfg->redundant_dest_addr.mac->ether_addr_octet : NULL)) {
+		AVB_LOGF_ERROR("Failed to receive on redundant interface %s", pCfg->redundant_ifname);
+		openavbAvtpShutdown(pListenerData->avtpHandle);
+		pListenerData->avtpHandle = NULL;
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	if (pCfg->pcap_file[0]
+		&& !openavbAvtpRxSetReplay(pListenerData->avtpHandle, pCfg->pcap_file,
+			pCfg->pcap_replay_speed, pCfg->pcap_replay_loops)) {
+		AVB_LOGF_ERROR("Failed to replay %s; needs an ifname of pcap:file", pCfg->pcap_file);
+		openavbAvtpShutdown(pListenerData->avtpHandle);
+		pListenerData->avtpHandle = NULL;
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
 	// Setup timers
 	U64 nowNS;
 	CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
@@ -89,12 +235,41 @@ bool listenerStartStream(tl_state_t *pTLState)
 	pListenerData->nReportCalls = 0;
 	pListenerData->nReportFrames = 0;
 
+	openavbTLPrefault(pTLState, ((avtp_stream_t *)pListenerData->avtpHandle)->rawsock, &pListenerData->streamID);
+
+	if (pTLState->bPaused) {
+		openavbAvtpPause(pListenerData->avtpHandle, TRUE);
+	}
+
+	// A pool thread's CPU time is shared by its streams
+	bool bPool = pCfg->listener_pool;
+	if (bPool && pCfg->redundant_ifname[0]) {
+		// The pool waits on one descriptor per stream
+		AVB_LOG_WARNING("Redundant streams don't use the listener pool; using own thread");
+		bPool = FALSE;
+	}
+#if AVB_FEATURE_SIM
+	// The simulation steps each stream itself, on the virtual clock
+	bPool = FALSE;
+#endif
+
 	// Clear stats
 	openavbListenerClearStats(pTLState);
+	openavbTLCpuStart(pTLState, !bPool);
+	openavbTLLatTraceStart(pTLState, pListenerData->avtpHandle);
+	openavbTLTsEvalStart(pTLState, pListenerData->avtpHandle);
+	openavbTLCallTimeStart(pTLState, pListenerData->avtpHandle);
+	x_listenerAdaptStart(pTLState);
 
 	// we're good to go!
 	pTLState->bStreaming = TRUE;
 
+	pListenerData->pPoolGroup = NULL;
+	if (bPool && !openavbListenerPoolAdd(pTLState)) {
+		AVB_LOG_WARNING("Failed to add stream to listener pool; using own thread");
+		openavbTLCpuStart(pTLState, TRUE);
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 	return TRUE;
 }
@@ -116,17 +291,46 @@ void listenerStopStream(tl_state_t *pTLState)
 		return;
 	}
 
+	// make sure no pool thread is still receiving on this stream
+	if (pListenerData->pPoolGroup) {
+		openavbListenerPoolRemove(pTLState);
+	}
+
 	openavbListenerAddStat(pTLState, TL_STAT_RX_CALLS, pListenerData->nReportCalls);
 	openavbListenerAddStat(pTLState, TL_STAT_RX_FRAMES, pListenerData->nReportFrames);
 	openavbListenerAddStat(pTLState, TL_STAT_RX_LOST, openavbAvtpLost(pListenerData->avtpHandle));
 	openavbListenerAddStat(pTLState, TL_STAT_RX_BYTES, openavbAvtpBytes(pListenerData->avtpHandle));
+	openavbListenerAddStat(pTLState, TL_STAT_REDUNDANT, openavbAvtpRedundantCount(pListenerData->avtpHandle));
 
-	AVB_LOGF_INFO("RX "STREAMID_FORMAT", Totals: calls=%" PRIu64 "frames=%" PRIu64 "lost=%" PRIu64 "bytes=%" PRIu64,
+	AVB_LOGF_INFO("RX "STREAMID_FORMAT", Totals: calls=%" PRIu64 "frames=%" PRIu64 "lost=%" PRIu64 "bytes=%" PRIu64 ", purged=%" PRIu64,
 		STREAMID_ARGS(&pListenerData->streamID),
 		openavbListenerGetStat(pTLState, TL_STAT_RX_CALLS),
 		openavbListenerGetStat(pTLState, TL_STAT_RX_FRAMES),
 		openavbListenerGetStat(pTLState, TL_STAT_RX_LOST),
-		openavbListenerGetStat(pTLState, TL_STAT_RX_BYTES));
+		openavbListenerGetStat(pTLState, TL_STAT_RX_BYTES),
+		openavbListenerGetStat(pTLState, TL_STAT_MQ_PURGED));
+	if (pTLState->cfg.mediaq_ordered) {
+		AVB_LOGF_INFO("RX "STREAMID_FORMAT", Media queue order: reordered=%" PRIu64 ", late=%" PRIu64 ", duplicates=%" PRIu64,
+			STREAMID_ARGS(&pListenerData->streamID),
+			openavbListenerGetStat(pTLState, TL_STAT_MQ_REORDERED),
+			openavbListenerGetStat(pTLState, TL_STAT_MQ_LATE),
+			openavbListenerGetStat(pTLState, TL_STAT_MQ_DUPLICATE));
+	}
+	if (pTLState->cfg.redundant_ifname[0]) {
+		AVB_LOGF_INFO("RX "STREAMID_FORMAT", Redundant: duplicates=%" PRIu64,
+			STREAMID_ARGS(&pListenerData->streamID),
+			openavbListenerGetStat(pTLState, TL_STAT_REDUNDANT));
+	}
+	if (pTLState->cfg.cpu_stats) {
+		openavbTLCpuSample(pTLState, pListenerData->avtpHandle);
+		AVB_LOGF_INFO("RX "STREAMID_FORMAT", CPU: total=%" PRIu64 "us, involCsw=%" PRIu64 ", intf=%" PRIu64 "us, map=%" PRIu64 "us, rawsock=%" PRIu64 "us",
+			STREAMID_ARGS(&pListenerData->streamID),
+			openavbListenerGetStat(pTLState, TL_STAT_CPU_NS) / NANOSECONDS_PER_USEC,
+			openavbListenerGetStat(pTLState, TL_STAT_CPU_INVOL_CSW),
+			openavbListenerGetStat(pTLState, TL_STAT_CPU_INTF_NS) / NANOSECONDS_PER_USEC,
+			openavbListenerGetStat(pTLState, TL_STAT_CPU_MAP_NS) / NANOSECONDS_PER_USEC,
+			openavbListenerGetStat(pTLState, TL_STAT_CPU_RAWSOCK_NS) / NANOSECONDS_PER_USEC);
+	}
 
 	if (pTLState->bStreaming) {
 		openavbAvtpShutdown(pListenerData->avtpHandle);
@@ -136,7 +340,74 @@ void listenerStopStream(tl_state_t *pTLState)
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
 
-static inline bool listenerDoStream(tl_state_t *pTLState)
+// The per call bookkeeping after trying to receive.
+// Returns TRUE when it is time to service the endpoint IPC.
+static bool x_listenerAfterRx(tl_state_t *pTLState, bool bFrame)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	listener_data_t *pListenerData = pTLState->pPvtListenerData;
+	bool bRet = FALSE;
+	U64 nowNS;
+
+	pListenerData->nReportCalls++;
+
+	if (bFrame) {
+		pListenerData->nReportFrames++;
+	}
+
+	CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
+
+	if (pCfg->report_seconds > 0) {
+		if (nowNS > pListenerData->nextReportNS) {
+		  
+			U64 lost = openavbAvtpLost(pListenerData->avtpHandle);
+			U64 bytes = openavbAvtpBytes(pListenerData->avtpHandle);
+			U32 rxbuf = openavbAvtpRxBufferLevel(pListenerData->avtpHandle);
+			U32 mqbuf = openavbMediaQCountItems(pTLState->pMediaQ, TRUE);
+			U32 mqrdy = openavbMediaQCountItems(pTLState->pMediaQ, FALSE);
+		
+			AVB_LOGRT_INFO(LOG_RT_BEGIN, LOG_RT_ITEM, FALSE, "RX UID:%d, ", LOG_RT_DATATYPE_U16, &pListenerData->streamID.uniqueID);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "calls=%ld, ", LOG_RT_DATATYPE_U32, &pListenerData->nReportCalls);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "frames=%ld, ", LOG_RT_DATATYPE_U32, &pListenerData->nReportFrames);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "lost=%lld, ", LOG_RT_DATATYPE_U64, &lost);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "bytes=%lld, ", LOG_RT_DATATYPE_U64, &bytes);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "rxbuf=%d, ", LOG_RT_DATATYPE_U32, &rxbuf);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "mqbuf=%d, ", LOG_RT_DATATYPE_U32, &mqbuf);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, LOG_RT_END, "mqrdy=%d", LOG_RT_DATATYPE_U32, &mqrdy);
+
+			openavbListenerAddStat(pTLState, TL_STAT_RX_CALLS, pListenerData->nReportCalls);
+			openavbListenerAddStat(pTLState, TL_STAT_RX_FRAMES, pListenerData->nReportFrames);
+			openavbListenerAddStat(pTLState, TL_STAT_RX_LOST, lost);
+			openavbListenerAddStat(pTLState, TL_STAT_RX_BYTES, bytes);
+			openavbListenerAddStat(pTLState, TL_STAT_REDUNDANT, openavbAvtpRedundantCount(pListenerData->avtpHandle));
+
+			// Sent to the endpoint the next time IPC is serviced, off this path
+			if (pCfg->latency_hist || pCfg->ts_eval) {
+				pTLState->bHistReport = TRUE;
+			}
+
+			pListenerData->nReportCalls = 0;
+			pListenerData->nReportFrames = 0;
+			pListenerData->nextReportNS += (pCfg->report_seconds * NANOSECONDS_PER_SECOND);  
+		}
+	}
+
+	if (nowNS > pListenerData->nextSecondNS) {
+		pListenerData->nextSecondNS += NANOSECONDS_PER_SECOND;
+		bRet = TRUE;
+
+		if (pCfg->cpu_stats) {
+			openavbTLCpuSample(pTLState, pListenerData->avtpHandle);
+		}
+		x_listenerAdapt(pTLState);
+	}
+
+	return bRet;
+}
+
+// Receive and present what is there and do the per call bookkeeping.
+// Returns TRUE when it is time to service the endpoint IPC.
+bool listenerDoStream(tl_state_t *pTLState)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_TL);
 
@@ -150,61 +421,41 @@ static inline bool listenerDoStream(tl_state_t *pTLState)
 	listener_data_t *pListenerData = pTLState->pPvtListenerData;
 	bool bRet = FALSE;
 
-	if (pTLState->bStreaming) {
-		U64 nowNS;
-
-		pListenerData->nReportCalls++;
-
-		// Try to receive a frame
-		if (IS_OPENAVB_SUCCESS(openavbAvtpRx(pListenerData->avtpHandle))) {
-			pListenerData->nReportFrames++;
+	if (pTLState->bStreaming && !pListenerData->pPoolGroup) {
+		if (pCfg->cpu_stats) {
+			openavbTLCpuTick(pTLState, pListenerData->avtpHandle);
 		}
 
-		CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
-
-		if (pCfg->report_seconds > 0) {
-			if (nowNS > pListenerData->nextReportNS) {
-			  
-				U64 lost = openavbAvtpLost(pListenerData->avtpHandle);
-				U64 bytes = openavbAvtpBytes(pListenerData->avtpHandle);
-				U32 rxbuf = openavbAvtpRxBufferLevel(pListenerData->avtpHandle);
-				U32 mqbuf = openavbMediaQCountItems(pTLState->pMediaQ, TRUE);
-				U32 mqrdy = openavbMediaQCountItems(pTLState->pMediaQ, FALSE);
-			
-				AVB_LOGRT_INFO(LOG_RT_BEGIN, LOG_RT_ITEM, FALSE, "RX UID:%d, ", LOG_RT_DATATYPE_U16, &pListenerData->streamID.uniqueID);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "calls=%ld, ", LOG_RT_DATATYPE_U32, &pListenerData->nReportCalls);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "frames=%ld, ", LOG_RT_DATATYPE_U32, &pListenerData->nReportFrames);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "lost=%lld, ", LOG_RT_DATATYPE_U64, &lost);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "bytes=%lld, ", LOG_RT_DATATYPE_U64, &bytes);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "rxbuf=%d, ", LOG_RT_DATATYPE_U32, &rxbuf);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "mqbuf=%d, ", LOG_RT_DATATYPE_U32, &mqbuf);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, LOG_RT_END, "mqrdy=%d", LOG_RT_DATATYPE_U32, &mqrdy);
-
-				openavbListenerAddStat(pTLState, TL_STAT_RX_CALLS, pListenerData->nReportCalls);
-				openavbListenerAddStat(pTLState, TL_STAT_RX_FRAMES, pListenerData->nReportFrames);
-				openavbListenerAddStat(pTLState, TL_STAT_RX_LOST, lost);
-				openavbListenerAddStat(pTLState, TL_STAT_RX_BYTES, bytes);
-
-				pListenerData->nReportCalls = 0;
-				pListenerData->nReportFrames = 0;
-				pListenerData->nextReportNS += (pCfg->report_seconds * NANOSECONDS_PER_SECOND);  
-			}
-		}
-
-		if (nowNS > pListenerData->nextSecondNS) {
-			pListenerData->nextSecondNS += NANOSECONDS_PER_SECOND;
-			bRet = TRUE;
-		}
+		// Try to receive a frame
+		bRet = x_listenerAfterRx(pTLState, IS_OPENAVB_SUCCESS(openavbAvtpRx(pListenerData->avtpHandle)));
 	}
 	else {
-            SLEEP(1);
-            bRet = TRUE;
+		// not streaming, or a listener pool thread is receiving for us.
+		// Time to service the endpoint IPC, which blocks instead of sleeping.
+		bRet = TRUE;
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 	return bRet;
 }
 
+// Called from a listener pool thread: receive what is waiting without
+// blocking, and tell in *pWaitUsec when the stream next needs servicing.
+void listenerDoPoll(tl_state_t *pTLState, U32 *pWaitUsec)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	listener_data_t *pListenerData = pTLState->pPvtListenerData;
+
+	if (pTLState->cfg.cpu_stats) {
+		openavbTLCpuTick(pTLState, pListenerData->avtpHandle);
+	}
+
+	x_listenerAfterRx(pTLState, IS_OPENAVB_SUCCESS(openavbAvtpRxPoll(pListenerData->avtpHandle, pWaitUsec)));
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
 // Called from openavbTLThreadFn() which is started from openavbTLRun() 
 void openavbTLRunListener(tl_state_t *pTLState)
 {
@@ -216,13 +467,13 @@ void openavbTLRunListener(tl_state_t *pTLState)
 		return;
 	}
 
+	// Fault the media queue arena in on this thread's NUMA node
+	openavbMediaQArenaLock(pTLState->pMediaQ);
+	openavbTLLockMemory(pTLState);
+
 	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
 
-	pTLState->pPvtListenerData = calloc(1, sizeof(listener_data_t));
-	if (!pTLState->pPvtListenerData) {
-		AVB_LOG_WARNING("Failed to allocate listener data.");
-		return;
-	}
+	pTLState->pPvtListenerData = memset(pTLState->pRtStorage, 0, sizeof(listener_data_t));
 
 	AVBStreamID_t streamID;
 	memcpy(streamID.addr, pCfg->stream_addr.mac, ETH_ALEN);
@@ -255,12 +506,25 @@ void openavbTLRunListener(tl_state_t *pTLState)
 			bServiceIPC = listenerDoStream(pTLState);
 
 			if (bServiceIPC) {
-				// Look for messages from endpoint.  Don't block (timeout=0)
-				if (!openavbEptClntService(pTLState->endpointHandle, 0)) {
+				if (pTLState->bHistReport) {
+					pTLState->bHistReport = FALSE;
+					openavbTLReportHist(pTLState, &streamID);
+				}
+
+				// Look for messages from endpoint. Don't block while streaming; when idle,
+				// wait on the endpoint so SRP changes it pushes are acted on immediately.
+				int ipcWaitMsec = TL_IDLE_IPC_WAIT_MSEC;
+				if (pTLState->bStreaming && !((listener_data_t *)pTLState->pPvtListenerData)->pPoolGroup)
+					ipcWaitMsec = 0;
+				if (!openavbEptClntService(pTLState->endpointHandle, ipcWaitMsec)) {
 					AVB_LOGF_WARNING("Lost connection to endpoint "STREAMID_FORMAT, STREAMID_ARGS(&streamID));
 					pTLState->bConnected = FALSE;
 					pTLState->endpointHandle = 0;
 				}
+
+				// A controller may have moved the listener to another stream
+				memcpy(streamID.addr, pCfg->stream_addr.mac, ETH_ALEN);
+				streamID.uniqueID = pCfg->stream_uid;
 			}
 		}
 
@@ -281,10 +545,7 @@ void openavbTLRunListener(tl_state_t *pTLState)
 		AVB_LOGF_WARNING("Failed to connect to endpoint "STREAMID_FORMAT, STREAMID_ARGS(&streamID));
 	}
 
-	if (pTLState->pPvtListenerData) {
-		free(pTLState->pPvtListenerData);
-		pTLState->pPvtListenerData = NULL;
-	}
+	pTLState->pPvtListenerData = NULL;
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
@@ -330,7 +591,9 @@ void openavbListenerClearStats(tl_state_t *pTLState)
 
 	LOCK_STATS();
 	memset(&pListenerData->stats, 0, sizeof(pListenerData->stats));
+	memset(&pTLState->cpuStats.total, 0, sizeof(pTLState->cpuStats.total));
 	UNLOCK_STATS();
+	openavbTLResetHist(pTLState);
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
@@ -358,6 +621,7 @@ void openavbListenerAddStat(tl_state_t *pTLState, tl_stat_t stat, U64 val)
 		case TL_STAT_TX_FRAMES:
 		case TL_STAT_TX_LATE:
 		case TL_STAT_TX_BYTES:
+		case TL_STAT_TX_NULL:
 			break;
 		case TL_STAT_RX_CALLS:
 			pListenerData->stats.totalCalls += val;
@@ -371,6 +635,19 @@ void openavbListenerAddStat(tl_state_t *pTLState, tl_stat_t stat, U64 val)
 		case TL_STAT_RX_BYTES:
 			pListenerData->stats.totalBytes += val;
 			break;
+		case TL_STAT_REDUNDANT:
+			pListenerData->stats.totalRedundant += val;
+			break;
+		case TL_STAT_MQ_PURGED:
+		case TL_STAT_MQ_REORDERED:
+		case TL_STAT_MQ_LATE:
+		case TL_STAT_MQ_DUPLICATE:
+		case TL_STAT_CPU_NS:
+		case TL_STAT_CPU_INVOL_CSW:
+		case TL_STAT_CPU_INTF_NS:
+		case TL_STAT_CPU_MAP_NS:
+		case TL_STAT_CPU_RAWSOCK_NS:
+			break;
 	}
 	UNLOCK_STATS();
 
@@ -401,6 +678,7 @@ U64 openavbListenerGetStat(tl_state_t *pTLState, tl_stat_t stat)
 		case TL_STAT_TX_FRAMES:
 		case TL_STAT_TX_LATE:
 		case TL_STAT_TX_BYTES:
+		case TL_STAT_TX_NULL:
 			break;
 		case TL_STAT_RX_CALLS:
 			val = pListenerData->stats.totalCalls;
@@ -414,6 +692,28 @@ U64 openavbListenerGetStat(tl_state_t *pTLState, tl_stat_t stat)
 		case TL_STAT_RX_BYTES:
 			val = pListenerData->stats.totalBytes;
 			break;
+		case TL_STAT_REDUNDANT:
+			val = pListenerData->stats.totalRedundant;
+			break;
+		case TL_STAT_MQ_PURGED:
+			val = openavbMediaQPurgedItems(pTLState->pMediaQ);
+			break;
+		case TL_STAT_MQ_REORDERED:
+			openavbMediaQOrderedStats(pTLState->pMediaQ, &val, NULL, NULL);
+			break;
+		case TL_STAT_MQ_LATE:
+			openavbMediaQOrderedStats(pTLState->pMediaQ, NULL, &val, NULL);
+			break;
+		case TL_STAT_MQ_DUPLICATE:
+			openavbMediaQOrderedStats(pTLState->pMediaQ, NULL, NULL, &val);
+			break;
+		case TL_STAT_CPU_NS:
+		case TL_STAT_CPU_INVOL_CSW:
+		case TL_STAT_CPU_INTF_NS:
+		case TL_STAT_CPU_MAP_NS:
+		case TL_STAT_CPU_RAWSOCK_NS:
+			val = openavbTLCpuStat(pTLState, stat);
+			break;
 	}
 	UNLOCK_STATS();
 
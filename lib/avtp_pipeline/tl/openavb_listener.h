@@ -42,6 +42,7 @@ typedef struct {
 	U64 totalFrames;
 	U64 totalLost;
 	U64 totalBytes;
+	U64 totalRedundant;
 } listener_stats_t;
 
 typedef struct {
@@ -54,11 +55,25 @@ typedef struct {
 
 	// State info for streaming
 	void			*avtpHandle;
+	// Listener pool group servicing this stream, NULL when on its own thread
+	void			*pPoolGroup;
 	unsigned long	nReportFrames;
 	unsigned long	nReportCalls;
 	U64 			nextReportNS;
 	U64				nextSecondNS;
 	listener_stats_t stats;
+
+	// Adaptive buffer depth (rx_adapt_permille). The previous margin histogram
+	// snapshot, the last second's share of it, the depth and stale tail in use
+	// and the drop counters at the last check.
+	openavb_hist_t	adaptPrevHist;
+	openavb_hist_t	adaptHist;
+	U32				adaptMaxDepth;
+	U32				adaptDepth;
+	U32				adaptStaleUsec;
+	U32				adaptTroubleSecs;
+	U64				adaptPurged;
+	U64				adaptLimited;
 } listener_data_t;
 
 void openavbTLRunListener(tl_state_t *pTLState);
@@ -67,7 +82,10 @@ void openavbListenerClearStats(tl_state_t *pTLState);
 void openavbListenerAddStat(tl_state_t *pTLState, tl_stat_t stat, U64 val);
 U64 openavbListenerGetStat(tl_state_t *pTLState, tl_stat_t stat);
 bool openavbTLRunListenerInit(int h, AVBStreamID_t *streamID);
+void openavbTLListenerSwitchStream(tl_state_t *pTLState, AVBStreamID_t *streamID, U8 destAddr[]);
 bool listenerStartStream(tl_state_t *pTLState);
 void listenerStopStream(tl_state_t *pTLState);
+bool listenerDoStream(tl_state_t *pTLState);
+void listenerDoPoll(tl_state_t *pTLState, U32 *pWaitUsec);
 
 #endif  // OPENAVB_TL_LISTENER_H
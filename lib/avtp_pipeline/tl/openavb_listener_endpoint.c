@@ -137,3 +137,48 @@ bool openavbTLRunListenerInit(int h, AVBStreamID_t *streamID)
 {
 	return(openavbEptClntAttachStream(h, streamID, openavbSrp_LDSt_Interest));
 }
+
+/* A controller connected the listener to a talker through the endpoint's
+ * AVDECC entity. If that talker's stream is not the one the listener waits
+ * on, leave it and attach to the new one instead.
+ */
+void openavbTLListenerSwitchStream(tl_state_t *pTLState, AVBStreamID_t *streamID, U8 destAddr[])
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	static const U8 emptyMAC[ETH_ALEN] = { 0, 0, 0, 0, 0, 0 };
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	AVBStreamID_t oldStreamID;
+
+	memcpy(oldStreamID.addr, pCfg->stream_addr.mac, ETH_ALEN);
+	oldStreamID.uniqueID = pCfg->stream_uid;
+
+	if (memcmp(oldStreamID.addr, streamID->addr, ETH_ALEN) == 0
+		&& oldStreamID.uniqueID == streamID->uniqueID) {
+		// Already attached; resuming is all it takes
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+
+	AVB_LOGF_INFO("Switching stream: "STREAMID_FORMAT" to "STREAMID_FORMAT,
+		STREAMID_ARGS(&oldStreamID), STREAMID_ARGS(streamID));
+
+	if (pTLState->bStreaming) {
+		listenerStopStream(pTLState);
+	}
+	openavbEptClntStopStream(pTLState->endpointHandle, &oldStreamID);
+
+	memcpy(pCfg->stream_addr.buffer.ether_addr_octet, streamID->addr, ETH_ALEN);
+	pCfg->stream_addr.mac = &pCfg->stream_addr.buffer;
+	pCfg->stream_uid = streamID->uniqueID;
+	if (destAddr && memcmp(destAddr, emptyMAC, ETH_ALEN) != 0) {
+		// Used in place of SRP's when streams are preconfigured
+		memcpy(pCfg->dest_addr.buffer.ether_addr_octet, destAddr, ETH_ALEN);
+		pCfg->dest_addr.mac = &pCfg->dest_addr.buffer;
+	}
+
+	// Streaming starts again once the talker is seen, as at startup
+	openavbEptClntAttachStream(pTLState->endpointHandle, streamID, openavbSrp_LDSt_Interest);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
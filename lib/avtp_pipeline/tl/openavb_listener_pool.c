@@ -0,0 +1,433 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Listener pool implementation
+*
+* Each pool group owns one thread waiting in epoll on the rawsock
+* descriptors of its streams, plus a timerfd armed for the earliest
+* media queue item due. On a wake it services, without blocking, each
+* stream whose descriptor fired or whose item has come due. Descriptors
+* are edge triggered; a serviced stream is always drained, so no frames
+* are left behind an edge.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "openavb_platform.h"
+#include "openavb_trace.h"
+#include "openavb_tl.h"
+#include "openavb_avtp.h"
+#include "openavb_rawsock.h"
+#include "openavb_listener.h"
+#include "openavb_listener_pool.h"
+
+#define	AVB_LOG_COMPONENT	"Listener"
+#include "openavb_log.h"
+
+THREAD_TYPE(listenerPoolThread);
+
+typedef struct {
+	// Stream in this slot, NULL when free
+	tl_state_t *pTLState;
+	// Descriptor fired since the stream was last serviced
+	bool bReady;
+	// Timer clock time the stream next needs servicing
+	U64 dueNS;
+} listener_pool_slot_t;
+
+typedef struct listener_pool_group {
+	// Grouping key
+	U32 affinity;
+	U32 rtPriority;
+	bool bRtFifo;
+
+	// Prefault the pool thread stack (thread_mlock)
+	bool bMemLock;
+
+	// Streams of one group share the interface and gPTP domain
+	char ifname[IFNAMSIZE];
+	S32 gptpDomain;
+
+	listener_pool_slot_t slots[LISTENER_POOL_MAX_STREAMS];
+	U32 nStreams;
+
+	int epollFd;
+	int timerFd;
+
+	bool bRunning;
+	MUTEX_HANDLE(lock);
+	THREAD_DEFINITON(listenerPoolThread);
+
+	struct listener_pool_group *pNext;
+} listener_pool_group_t;
+
+static listener_pool_group_t *gListenerPoolGroups = NULL;
+MUTEX_HANDLE(gListenerPoolMutex);
+
+#define POOL_LOCK() { MUTEX_CREATE_ERR(); MUTEX_LOCK(gListenerPoolMutex); MUTEX_LOG_ERR("Mutex lock failure"); }
+#define POOL_UNLOCK() { MUTEX_CREATE_ERR(); MUTEX_UNLOCK(gListenerPoolMutex); MUTEX_LOG_ERR("Mutex unlock failure"); }
+#define GROUP_LOCK(g) { MUTEX_CREATE_ERR(); MUTEX_LOCK((g)->lock); MUTEX_LOG_ERR("Mutex lock failure"); }
+#define GROUP_UNLOCK(g) { MUTEX_CREATE_ERR(); MUTEX_UNLOCK((g)->lock); MUTEX_LOG_ERR("Mutex unlock failure"); }
+
+// Wake the pool thread at timer clock time dueNS, or right away when 0
+static void listenerPoolArm(listener_pool_group_t *pGroup, U64 dueNS)
+{
+	struct itimerspec its;
+	memset(&its, 0, sizeof(its));
+	if (dueNS) {
+		its.it_value.tv_sec = dueNS / NANOSECONDS_PER_SECOND;
+		its.it_value.tv_nsec = dueNS % NANOSECONDS_PER_SECOND;
+		timerfd_settime(pGroup->timerFd, TFD_TIMER_ABSTIME, &its, NULL);
+	}
+	else {
+		its.it_value.tv_nsec = 1;
+		timerfd_settime(pGroup->timerFd, 0, &its, NULL);
+	}
+}
+
+static void *listenerPoolThreadFn(void *pv)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	listener_pool_group_t *pGroup = (listener_pool_group_t *)pv;
+	struct epoll_event events[LISTENER_POOL_MAX_STREAMS + 1];
+
+	if (pGroup->bMemLock) {
+		openavbTLPrefaultStack();
+	}
+	osalAVBTimeSelectIf(pGroup->ifname);
+	osalAVBTimeSelectDomain(pGroup->gptpDomain);
+
+	while (pGroup->bRunning) {
+		int nEvents = epoll_wait(pGroup->epollFd, events, LISTENER_POOL_MAX_STREAMS + 1, -1);
+		int i1;
+
+		GROUP_LOCK(pGroup);
+		for (i1 = 0; i1 < nEvents; i1++) {
+			if (events[i1].data.ptr) {
+				// May be a slot emptied since; servicing a free slot is skipped below
+				((listener_pool_slot_t *)events[i1].data.ptr)->bReady = TRUE;
+			}
+			else {
+				U64 expirations;
+				if (read(pGroup->timerFd, &expirations, sizeof(expirations)) < 0) {
+					// Nothing to do; the timer is re-armed below
+				}
+			}
+		}
+
+		U64 nowNS, nextNS = 0;
+		CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
+
+		for (i1 = 0; i1 < LISTENER_POOL_MAX_STREAMS; i1++) {
+			listener_pool_slot_t *pSlot = &pGroup->slots[i1];
+			if (!pSlot->pTLState) {
+				continue;
+			}
+
+			if (pSlot->bReady || pSlot->dueNS <= nowNS) {
+				U32 waitUsec;
+				pSlot->bReady = FALSE;
+				listenerDoPoll(pSlot->pTLState, &waitUsec);
+				pSlot->dueNS = nowNS + (U64)waitUsec * NANOSECONDS_PER_USEC;
+			}
+
+			if (!nextNS || pSlot->dueNS < nextNS) {
+				nextNS = pSlot->dueNS;
+			}
+		}
+
+		if (pGroup->bRunning && nextNS) {
+			listenerPoolArm(pGroup, nextNS);
+		}
+		GROUP_UNLOCK(pGroup);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return NULL;
+}
+
+static void listenerPoolGroupClose(listener_pool_group_t *pGroup)
+{
+	if (pGroup->epollFd >= 0) {
+		close(pGroup->epollFd);
+	}
+	if (pGroup->timerFd >= 0) {
+		close(pGroup->timerFd);
+	}
+
+	MUTEX_CREATE_ERR();
+	MUTEX_DESTROY(pGroup->lock);
+	MUTEX_LOG_ERR("Error destroying mutex");
+
+	free(pGroup);
+}
+
+static listener_pool_group_t *listenerPoolGroupCreate(tl_state_t *pTLState)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+
+	listener_pool_group_t *pGroup = calloc(1, sizeof(listener_pool_group_t));
+	if (!pGroup) {
+		AVB_LOG_ERROR("Unable to allocate listener pool group");
+		return NULL;
+	}
+
+	pGroup->affinity = pCfg->thread_affinity;
+	pGroup->rtPriority = pCfg->thread_rt_priority;
+	pGroup->bRtFifo = pCfg->thread_rt_fifo;
+	pGroup->bMemLock = pCfg->thread_mlock;
+	snprintf(pGroup->ifname, sizeof(pGroup->ifname), "%s", pCfg->ifname);
+	pGroup->gptpDomain = pCfg->gptp_domain;
+
+	{
+		MUTEX_ATTR_HANDLE(mta);
+		MUTEX_ATTR_INIT(mta);
+		MUTEX_ATTR_SET_TYPE(mta, MUTEX_ATTR_TYPE_DEFAULT);
+		MUTEX_ATTR_SET_NAME(mta, "ListenerPoolGroupMutex");
+		MUTEX_CREATE_ERR();
+		MUTEX_CREATE(pGroup->lock, mta);
+		MUTEX_LOG_ERR("Could not create/initialize 'ListenerPoolGroupMutex' mutex");
+		if (MUTEX_IS_ERR) {
+			free(pGroup);
+			return NULL;
+		}
+	}
+
+	// The timer is the one event with no slot
+	struct epoll_event ev;
+	pGroup->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	pGroup->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (pGroup->epollFd < 0 || pGroup->timerFd < 0
+		|| epoll_ctl(pGroup->epollFd, EPOLL_CTL_ADD, pGroup->timerFd, &ev) < 0) {
+		AVB_LOGF_ERROR("Unable to set up listener pool wait: %s", strerror(errno));
+		listenerPoolGroupClose(pGroup);
+		return NULL;
+	}
+
+	bool errResult;
+	pGroup->bRunning = TRUE;
+	THREAD_CREATE(listenerPoolThread, pGroup->listenerPoolThread, NULL, listenerPoolThreadFn, pGroup);
+	THREAD_CHECK_ERROR(pGroup->listenerPoolThread, "Thread / task creation failed", errResult);
+	if (errResult) {
+		listenerPoolGroupClose(pGroup);
+		return NULL;
+	}
+
+	THREAD_SET_RT_POLICY(pGroup->listenerPoolThread, pGroup->bRtFifo ? SCHED_FIFO : SCHED_RR, pGroup->rtPriority);
+	THREAD_PIN(pGroup->listenerPoolThread, pGroup->affinity);
+
+	AVB_LOGF_INFO("Started listener pool thread, affinity=0x%x", pGroup->affinity);
+	return pGroup;
+}
+
+static void listenerPoolGroupDelete(listener_pool_group_t *pGroup)
+{
+	GROUP_LOCK(pGroup);
+	pGroup->bRunning = FALSE;
+	listenerPoolArm(pGroup, 0);
+	GROUP_UNLOCK(pGroup);
+	THREAD_JOIN(pGroup->listenerPoolThread, NULL);
+
+	listenerPoolGroupClose(pGroup);
+}
+
+bool openavbListenerPoolInit(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	gListenerPoolGroups = NULL;
+
+	MUTEX_ATTR_HANDLE(mta);
+	MUTEX_ATTR_INIT(mta);
+	MUTEX_ATTR_SET_TYPE(mta, MUTEX_ATTR_TYPE_DEFAULT);
+	MUTEX_ATTR_SET_NAME(mta, "gListenerPoolMutex");
+	MUTEX_CREATE_ERR();
+	MUTEX_CREATE(gListenerPoolMutex, mta);
+	MUTEX_LOG_ERR("Error creating mutex");
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return !MUTEX_IS_ERR;
+}
+
+void openavbListenerPoolCleanup(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	// Groups go away with their last stream; anything left here was not stopped
+	POOL_LOCK();
+	while (gListenerPoolGroups) {
+		listener_pool_group_t *pGroup = gListenerPoolGroups;
+		gListenerPoolGroups = pGroup->pNext;
+		AVB_LOGF_WARNING("Listener pool group still has %u streams", pGroup->nStreams);
+		listenerPoolGroupDelete(pGroup);
+	}
+	POOL_UNLOCK();
+
+	MUTEX_CREATE_ERR();
+	MUTEX_DESTROY(gListenerPoolMutex);
+	MUTEX_LOG_ERR("Error destroying mutex");
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+bool openavbListenerPoolAdd(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	listener_data_t *pListenerData = pTLState->pPvtListenerData;
+	listener_pool_group_t *pGroup;
+	U32 i1;
+
+	int fd = openavbRawsockGetSocket(((avtp_stream_t *)pListenerData->avtpHandle)->rawsock);
+	if (fd < 0) {
+		AVB_LOG_WARNING("Listener pool needs a rawsock with a descriptor to wait on");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	POOL_LOCK();
+	for (pGroup = gListenerPoolGroups; pGroup; pGroup = pGroup->pNext) {
+		if (pGroup->affinity == pCfg->thread_affinity
+			&& pGroup->rtPriority == pCfg->thread_rt_priority
+			&& pGroup->bRtFifo == pCfg->thread_rt_fifo
+			&& strncmp(pGroup->ifname, pCfg->ifname, IFNAMSIZE) == 0
+			&& pGroup->gptpDomain == pCfg->gptp_domain
+			&& pGroup->nStreams < LISTENER_POOL_MAX_STREAMS) {
+			break;
+		}
+	}
+
+	if (!pGroup) {
+		pGroup = listenerPoolGroupCreate(pTLState);
+		if (!pGroup) {
+			POOL_UNLOCK();
+			AVB_TRACE_EXIT(AVB_TRACE_TL);
+			return FALSE;
+		}
+		pGroup->pNext = gListenerPoolGroups;
+		gListenerPoolGroups = pGroup;
+	}
+
+	GROUP_LOCK(pGroup);
+	listener_pool_slot_t *pSlot = NULL;
+	for (i1 = 0; i1 < LISTENER_POOL_MAX_STREAMS; i1++) {
+		if (!pGroup->slots[i1].pTLState) {
+			pSlot = &pGroup->slots[i1];
+			break;
+		}
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.ptr = pSlot;
+	if (epoll_ctl(pGroup->epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		AVB_LOGF_ERROR("Listener pool; epoll_ctl failed: %s", strerror(errno));
+		bool bEmpty = (pGroup->nStreams == 0);
+		GROUP_UNLOCK(pGroup);
+		if (bEmpty) {
+			gListenerPoolGroups = pGroup->pNext;
+			listenerPoolGroupDelete(pGroup);
+		}
+		POOL_UNLOCK();
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	// Service it on the next wake, which is right away
+	pSlot->pTLState = pTLState;
+	pSlot->bReady = TRUE;
+	pSlot->dueNS = 0;
+	pGroup->nStreams++;
+	pListenerData->pPoolGroup = pGroup;
+	listenerPoolArm(pGroup, 0);
+	GROUP_UNLOCK(pGroup);
+	POOL_UNLOCK();
+
+	AVB_LOGF_INFO("Listener "STREAMID_FORMAT" added to pool (%u streams)", STREAMID_ARGS(&pListenerData->streamID), pGroup->nStreams);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return TRUE;
+}
+
+void openavbListenerPoolRemove(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	listener_data_t *pListenerData = pTLState->pPvtListenerData;
+	listener_pool_group_t *pGroup = (listener_pool_group_t *)pListenerData->pPoolGroup;
+	listener_pool_group_t **ppGroup;
+	U32 i1;
+
+	if (!pGroup) {
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+
+	POOL_LOCK();
+
+	// Taking the group lock waits out a wake that may be servicing this stream
+	GROUP_LOCK(pGroup);
+	int fd = openavbRawsockGetSocket(((avtp_stream_t *)pListenerData->avtpHandle)->rawsock);
+	epoll_ctl(pGroup->epollFd, EPOLL_CTL_DEL, fd, NULL);
+	for (i1 = 0; i1 < LISTENER_POOL_MAX_STREAMS; i1++) {
+		if (pGroup->slots[i1].pTLState == pTLState) {
+			pGroup->slots[i1].pTLState = NULL;
+			pGroup->nStreams--;
+			break;
+		}
+	}
+	pListenerData->pPoolGroup = NULL;
+	bool bEmpty = (pGroup->nStreams == 0);
+	GROUP_UNLOCK(pGroup);
+
+	if (bEmpty) {
+		for (ppGroup = &gListenerPoolGroups; *ppGroup; ppGroup = &(*ppGroup)->pNext) {
+			if (*ppGroup == pGroup) {
+				*ppGroup = pGroup->pNext;
+				break;
+			}
+		}
+	}
+	POOL_UNLOCK();
+
+	if (bEmpty) {
+		listenerPoolGroupDelete(pGroup);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
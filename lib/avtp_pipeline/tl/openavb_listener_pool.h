@@ -0,0 +1,56 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* HEADER SUMMARY : Listener pool. Streams are received by a shared thread
+* waiting on all of their rawsocks instead of a thread per stream.
+*/
+
+#ifndef OPENAVB_TL_LISTENER_POOL_H
+#define OPENAVB_TL_LISTENER_POOL_H 1
+
+#include "openavb_tl.h"
+
+// Maximum number of streams serviced by one pool thread
+#define LISTENER_POOL_MAX_STREAMS	16
+
+bool openavbListenerPoolInit(void);
+void openavbListenerPoolCleanup(void);
+
+// Hand a streaming listener to a pool thread of matching interface,
+// affinity and priority, starting a new one if needed. Fails if the
+// stream's rawsock has no descriptor to wait on.
+bool openavbListenerPoolAdd(tl_state_t *pTLState);
+
+// Take a listener out of its pool. Once this returns the pool thread
+// no longer touches the stream.
+void openavbListenerPoolRemove(tl_state_t *pTLState);
+
+#endif  // OPENAVB_TL_LISTENER_POOL_H
@@ -38,6 +38,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_tl.h"
 #include "openavb_avtp.h"
 #include "openavb_talker.h"
+#include "openavb_talker_pool.h"
 // #include "openavb_time.h"
 
 // DEBUG Uncomment to turn on logging for just this module.
@@ -94,6 +95,7 @@ bool talkerStartStream(tl_state_t *pTLState)
 		pTalkerData->vlanID,
 		pTalkerData->vlanPCP,
 		pTalkerData->wakeFrames * pCfg->raw_tx_buffers,
+		pTLState->pAvtpStorage,
 		&pTalkerData->avtpHandle);
 	if (IS_OPENAVB_FAILURE(rc)) {
 		AVB_LOG_ERROR("Failed to create AVTP stream");
@@ -101,8 +103,30 @@ bool talkerStartStream(tl_state_t *pTLState)
 		return FALSE;
 	}
 
+	if (pCfg->pcap_file[0]
+		&& !openavbAvtpTxSetRecord(pTalkerData->avtpHandle, pCfg->pcap_file)) {
+		AVB_LOGF_ERROR("Failed to record to %s; needs a pcap ifname", pCfg->pcap_file);
+		openavbAvtpShutdown(pTalkerData->avtpHandle);
+		pTalkerData->avtpHandle = NULL;
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	if (pCfg->redundant_ifname[0]
+		&& !openavbAvtpSetRedundant(pTalkerData->avtpHandle, pCfg->redundant_ifname,
+			pCfg->redundant_dest_addr.mac ? pCfg->redundant_dest_addr.mac->ether_addr_octet : NULL)) {
+		AVB_LOGF_ERROR("Failed to send on redundant interface %s", pCfg->redundant_ifname);
+		openavbAvtpShutdown(pTalkerData->avtpHandle);
+		pTalkerData->avtpHandle = NULL;
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
 	avtp_stream_t *pStream = (avtp_stream_t *)(pTalkerData->avtpHandle);
 
+	// With launch time, the frames of one item leave a frame time apart
+	openavbAvtpTxSetLaunchSpacing(pTalkerData->avtpHandle, transmitInterval * pCfg->max_interval_frames);
+
 	pTalkerData->wakeRate = transmitInterval / pCfg->batch_factor;
 
 	pTalkerData->sleepUsec = MICROSECONDS_PER_SECOND / pTalkerData->wakeRate;
@@ -139,12 +163,98 @@ bool talkerStartStream(tl_state_t *pTLState)
 	pTalkerData->nextSecondNS = nowNS + NANOSECONDS_PER_SECOND;
 	pTalkerData->nextCycleNS = nowNS + pTalkerData->intervalNS;
 
+	pTalkerData->lookaheadNS = 0;
+	if (pCfg->launch_lookahead_usec) {
+		if (!pCfg->fixed_timestamp || pCfg->tx_blocking_in_intf) {
+			AVB_LOG_WARNING("launch_lookahead_usec needs fixed_timestamp and no tx_blocking_in_intf; ignored");
+		}
+		else if (!openavbAvtpTxSetLaunchTime(pTalkerData->avtpHandle, TRUE)) {
+			AVB_LOG_WARNING("launch_lookahead_usec needs IGB launch time or SO_TXTIME support; ignored");
+		}
+		else {
+			pTalkerData->lookaheadNS = (U64)pCfg->launch_lookahead_usec * NANOSECONDS_PER_USEC;
+			if (pTalkerData->lookaheadNS / pTalkerData->intervalNS >= pCfg->raw_tx_buffers) {
+				AVB_LOGF_WARNING("launch_lookahead_usec %u needs more than raw_tx_buffers %u intervals",
+					pCfg->launch_lookahead_usec, pCfg->raw_tx_buffers);
+			}
+		}
+	}
+
+	pTalkerData->batchCur = 1;
+	pTalkerData->batchMax = 1;
+	pTalkerData->batchLate = FALSE;
+	if (pCfg->batch_adapt_max > 1) {
+		// Wake periods that fit in the TX buffers beside the lookahead window
+		U32 fit = pCfg->raw_tx_buffers - (U32)(pTalkerData->lookaheadNS / pTalkerData->intervalNS);
+		if (pCfg->tx_blocking_in_intf) {
+			AVB_LOG_WARNING("batch_adapt_max can't be used with tx_blocking_in_intf; ignored");
+		}
+		else if (pCfg->raw_tx_buffers <= pTalkerData->lookaheadNS / pTalkerData->intervalNS + 1) {
+			AVB_LOGF_WARNING("batch_adapt_max needs more than raw_tx_buffers %u intervals; ignored", pCfg->raw_tx_buffers);
+		}
+		else if (pCfg->batch_adapt_max > fit) {
+			AVB_LOGF_WARNING("batch_adapt_max %u limited to %u by raw_tx_buffers", pCfg->batch_adapt_max, fit);
+			pTalkerData->batchMax = fit;
+		}
+		else {
+			pTalkerData->batchMax = pCfg->batch_adapt_max;
+		}
+	}
+
+	if (pCfg->asrc != AVTP_ASRC_OFF) {
+		if (pCfg->tx_blocking_in_intf) {
+			AVB_LOG_WARNING("asrc can't be used with tx_blocking_in_intf; ignored");
+		}
+		else if (!openavbAvtpTxSetAsrc(pTalkerData->avtpHandle, pCfg->asrc, pCfg->asrc_buffer_usec)) {
+			AVB_LOG_WARNING("asrc not supported by this stream; ignored");
+		}
+	}
+
+	if (pCfg->tx_null_on_underrun) {
+		// Each wake must send only the intervals that are due
+		if (pCfg->tx_blocking_in_intf || pTalkerData->lookaheadNS || pTalkerData->batchMax > 1) {
+			AVB_LOG_WARNING("tx_null_on_underrun can't be used with tx_blocking_in_intf, launch_lookahead_usec or batch_adapt_max; ignored");
+		}
+		else if (!openavbAvtpTxSetNullFill(pTalkerData->avtpHandle, TRUE)) {
+			AVB_LOG_WARNING("tx_null_on_underrun not supported by this mapping module; ignored");
+		}
+	}
+
+	if (pCfg->transit_calibrate) {
+		if (!openavbAvtpTxSetCalibration(pTalkerData->avtpHandle, pCfg->transit_calibrate, pCfg->transit_margin_usec)) {
+			AVB_LOG_WARNING("transit_calibrate not supported by this stream's subtype; ignored");
+		}
+	}
+
+	openavbTLPrefault(pTLState, pStream->rawsock, &pTalkerData->streamID);
+
+	if (pTLState->bPaused) {
+		openavbAvtpPause(pTalkerData->avtpHandle, TRUE);
+	}
+
 	// Clear stats
 	openavbTalkerClearStats(pTLState);
 
+	// A pool thread's CPU time is shared by its streams
+	bool bPool = pCfg->talker_pool && !pTalkerData->lookaheadNS && !pCfg->tx_blocking_in_intf;
+	openavbTLCpuStart(pTLState, !bPool);
+	openavbTLLatTraceStart(pTLState, pTalkerData->avtpHandle);
+	openavbTLTsEvalStart(pTLState, pTalkerData->avtpHandle);
+	openavbTLCallTimeStart(pTLState, pTalkerData->avtpHandle);
+
 	// we're good to go!
 	pTLState->bStreaming = TRUE;
 
+	pTalkerData->pPoolGroup = NULL;
+	if (pCfg->talker_pool) {
+		if (!bPool) {
+			AVB_LOG_WARNING("talker_pool can't be used with launch_lookahead_usec or tx_blocking_in_intf; using own thread");
+		}
+		else if (!openavbTalkerPoolAdd(pTLState)) {
+			AVB_LOG_WARNING("Failed to add stream to talker pool; using own thread");
+		}
+	}
+
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 	return TRUE;
 }
@@ -166,6 +276,11 @@ void talkerStopStream(tl_state_t *pTLState)
 		return;
 	}
 
+	// make sure no pool thread is still sending on this stream
+	if (pTalkerData->pPoolGroup) {
+		openavbTalkerPoolRemove(pTLState);
+	}
+
 	void *rawsock = NULL;
 	if (pTalkerData->avtpHandle) {
 		rawsock = ((avtp_stream_t*)pTalkerData->avtpHandle)->rawsock;
@@ -175,15 +290,29 @@ void talkerStopStream(tl_state_t *pTLState)
 	openavbTalkerAddStat(pTLState, TL_STAT_TX_FRAMES, pTalkerData->cntFrames);
 //	openavbTalkerAddStat(pTLState, TL_STAT_TX_LATE, 0);		// Can't calulate at this time
 	openavbTalkerAddStat(pTLState, TL_STAT_TX_BYTES, openavbAvtpBytes(pTalkerData->avtpHandle));
+	openavbTalkerAddStat(pTLState, TL_STAT_TX_NULL, openavbAvtpTxNullFrames(pTalkerData->avtpHandle));
+	openavbTalkerAddStat(pTLState, TL_STAT_REDUNDANT, openavbAvtpRedundantCount(pTalkerData->avtpHandle));
 
-	AVB_LOGF_INFO("TX "STREAMID_FORMAT", Totals: calls=%" PRIu64 ", frames=%" PRIu64 ", late=%" PRIu64 ", bytes=%" PRIu64 ", TXOutOfBuffs=%ld",
+	AVB_LOGF_INFO("TX "STREAMID_FORMAT", Totals: calls=%" PRIu64 ", frames=%" PRIu64 ", late=%" PRIu64 ", bytes=%" PRIu64 ", null=%" PRIu64 ", redundantMissed=%" PRIu64 ", TXOutOfBuffs=%ld",
 		STREAMID_ARGS(&pTalkerData->streamID),
 		openavbTalkerGetStat(pTLState, TL_STAT_TX_CALLS),
 		openavbTalkerGetStat(pTLState, TL_STAT_TX_FRAMES),
 		openavbTalkerGetStat(pTLState, TL_STAT_TX_LATE),
 		openavbTalkerGetStat(pTLState, TL_STAT_TX_BYTES),
+		openavbTalkerGetStat(pTLState, TL_STAT_TX_NULL),
+		openavbTalkerGetStat(pTLState, TL_STAT_REDUNDANT),
 		rawsock ? openavbRawsockGetTXOutOfBuffers(rawsock) : 0
 		);
+	if (pTLState->cfg.cpu_stats) {
+		openavbTLCpuSample(pTLState, pTalkerData->avtpHandle);
+		AVB_LOGF_INFO("TX "STREAMID_FORMAT", CPU: total=%" PRIu64 "us, involCsw=%" PRIu64 ", intf=%" PRIu64 "us, map=%" PRIu64 "us, rawsock=%" PRIu64 "us",
+			STREAMID_ARGS(&pTalkerData->streamID),
+			openavbTalkerGetStat(pTLState, TL_STAT_CPU_NS) / NANOSECONDS_PER_USEC,
+			openavbTalkerGetStat(pTLState, TL_STAT_CPU_INVOL_CSW),
+			openavbTalkerGetStat(pTLState, TL_STAT_CPU_INTF_NS) / NANOSECONDS_PER_USEC,
+			openavbTalkerGetStat(pTLState, TL_STAT_CPU_MAP_NS) / NANOSECONDS_PER_USEC,
+			openavbTalkerGetStat(pTLState, TL_STAT_CPU_RAWSOCK_NS) / NANOSECONDS_PER_USEC);
+	}
 
 	if (pTLState->bStreaming) {
 		openavbAvtpShutdown(pTalkerData->avtpHandle);
@@ -193,110 +322,296 @@ void talkerStopStream(tl_state_t *pTLState)
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
 
-static inline bool talkerDoStream(tl_state_t *pTLState)
+// Adaptive batching. Send more wake periods per wake-up while wake-ups run
+// late, as the host is too loaded to keep to the period, and fewer when the
+// media queue can't supply them that far ahead. Once a second without a late
+// wake-up the count drops back by one, in talkerDoInterval().
+static void talkerBatchAdapt(talker_data_t *pTalkerData, S64 lateNS, bool bStarved)
 {
-	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+	if (bStarved) {
+		if (pTalkerData->batchCur > 1) {
+			pTalkerData->batchCur /= 2;
+			AVB_LOGF_DEBUG("Batch down to %u, media not ready ahead", pTalkerData->batchCur);
+		}
+	}
+	else if (lateNS > (S64)(pTalkerData->intervalNS / 2)) {
+		pTalkerData->batchLate = TRUE;
+		if (pTalkerData->batchCur < pTalkerData->batchMax) {
+			pTalkerData->batchCur *= 2;
+			if (pTalkerData->batchCur > pTalkerData->batchMax)
+				pTalkerData->batchCur = pTalkerData->batchMax;
+			AVB_LOGF_DEBUG("Batch up to %u, wake-up %" PRId64 "ns late", pTalkerData->batchCur, lateNS);
+		}
+	}
+}
 
-	if (!pTLState) {
-		AVB_LOG_ERROR("Invalid TLState");
-		AVB_TRACE_EXIT(AVB_TRACE_TL);
-		return FALSE;
+// Tell the interface how much media is already queued for transmit, so it
+// can size its reads. Without a lookahead window that is the TX ring level.
+static void talkerTxAheadFeedback(tl_state_t *pTLState, U64 nowNS)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
+	U64 aheadNS = 0;
+
+	if (pTalkerData->lookaheadNS) {
+		if (pTalkerData->nextCycleNS > nowNS)
+			aheadNS = pTalkerData->nextCycleNS - nowNS;
 	}
+	else {
+		int level = openavbAvtpTxBufferLevel(pTalkerData->avtpHandle);
+		if (level < 0)
+			return;		// rawsock can't tell
+		aheadNS = (U64)level * pTalkerData->intervalNS / pTalkerData->wakeFrames;
+	}
+
+	pCfg->intf_cb.intf_tx_ahead_cb(pTLState->pMediaQ, (U32)(aheadNS / NANOSECONDS_PER_USEC));
+}
+
+// Lookahead window, widened by the wake periods of an adaptive batch
+static inline U64 talkerLookaheadNS(talker_data_t *pTalkerData)
+{
+	return pTalkerData->lookaheadNS + (pTalkerData->batchCur - 1) * pTalkerData->intervalNS;
+}
+
+// Queue every interval that starts inside the lookahead window, then sleep
+// until half of it has gone out. The NIC launches each frame at the time
+// taken from its media queue item, so the wake-up itself need not be precise.
+static void talkerTxLookahead(tl_state_t *pTLState)
+{
+	talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
+	U64 nowNS, timerNS, wakeNS;
+	bool bStarved = FALSE;
+
+	CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+
+	if (pTLState->cfg.intf_cb.intf_tx_ahead_cb) {
+		talkerTxAheadFeedback(pTLState, nowNS);
+	}
+
+	// Planned wake-up, from the window it was set with
+	wakeNS = pTalkerData->nextCycleNS - (talkerLookaheadNS(pTalkerData) / 2);
+
+	while (pTalkerData->nextCycleNS < nowNS + talkerLookaheadNS(pTalkerData)) {
+		if (((avtp_stream_t *)pTalkerData->avtpHandle)->bPause) {
+			// keep the window moving so a resume doesn't catch up
+			pTalkerData->cntWakes++;
+			pTalkerData->nextCycleNS += pTalkerData->intervalNS;
+			continue;
+		}
+		int nFrames = openavbAvtpTxBurst(pTalkerData->avtpHandle, pTalkerData->wakeFrames, FALSE);
+		if (nFrames <= 0) {
+			// no TX buffers or no media yet; retry on the next wake
+			bStarved = TRUE;
+			break;
+		}
+		pTalkerData->cntFrames += nFrames;
+		pTalkerData->cntWakes++;
+		pTalkerData->nextCycleNS += pTalkerData->intervalNS;
+	}
+
+	if (pTalkerData->batchMax > 1) {
+		talkerBatchAdapt(pTalkerData, (S64)(nowNS - wakeNS), bStarved);
+	}
+
+	wakeNS = pTalkerData->nextCycleNS - (talkerLookaheadNS(pTalkerData) / 2);
+	if (wakeNS > nowNS) {
+		// SLEEP_UNTIL_NSEC runs on the timer clock, not gPTP wall time
+		CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &timerNS);
+		SLEEP_UNTIL_NSEC(timerNS + (wakeNS - nowNS));
+	}
+	else {
+		SLEEP_NSEC(pTalkerData->intervalNS);
+	}
+}
+
+// Send one interval's frames and do the per interval bookkeeping. The
+// caller is responsible for waiting until nextCycleNS. Returns TRUE
+// when it is time to service the endpoint IPC.
+bool talkerDoInterval(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
 
 	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
 	talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
 	bool bRet = FALSE;
+	U64 nowNS;
+	U64 txStartNS = 0;
+	int txFrames = 0;
+	U32 batches = 1;
 
-	if (pTLState->bStreaming) {
-		U64 nowNS;
+	if (pCfg->cpu_stats) {
+		openavbTLCpuTick(pTLState, pTalkerData->avtpHandle);
+	}
 
-		if (!pCfg->tx_blocking_in_intf) {
+	if (pTalkerData->lookaheadNS) {
+		// intervals are counted and nextCycleNS advanced as they are queued
+		talkerTxLookahead(pTLState);
+	}
+	else if (!pCfg->tx_blocking_in_intf) {
+		//AVB_DBG_INTERVAL(8000, TRUE);
 
+		if (pCfg->latency_hist || pTalkerData->batchMax > 1) {
+			// Same clock as nextCycleNS
 			if (!pCfg->fixed_timestamp) {
-				// sleep until the next interval
-				SLEEP_UNTIL_NSEC(pTalkerData->nextCycleNS);
+				CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &txStartNS);
 			} else {
-#if !IGB_LAUNCHTIME_ENABLED
-				SPIN_UNTIL_NSEC(pTalkerData->nextCycleNS);
-#endif
+				CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &txStartNS);
+			}
+			if (pCfg->latency_hist) {
+				openavbHistRecordDelta(&pTLState->hist[TL_HIST_TX_WAKE_LATE], (S64)(txStartNS - pTalkerData->nextCycleNS));
 			}
+		}
 
-			//AVB_DBG_INTERVAL(8000, TRUE);
+		if (pCfg->intf_cb.intf_tx_ahead_cb) {
+			talkerTxAheadFeedback(pTLState, 0);
+		}
 
-			// send the frames for this interval
-			int i;
-			for (i = pTalkerData->wakeFrames; i > 0; i--) {
-				if (IS_OPENAVB_SUCCESS(openavbAvtpTx(pTalkerData->avtpHandle, i == 1, pCfg->tx_blocking_in_intf)))
-					pTalkerData->cntFrames++;
-				else
+		if (pTalkerData->batchMax > 1) {
+			// send the frames for each wake period of the batch, stopping
+			// at one the media queue has nothing for yet
+			bool bStarved = FALSE;
+			for (batches = 0; batches < pTalkerData->batchCur; ) {
+				int nFrames = openavbAvtpTxBurst(pTalkerData->avtpHandle, pTalkerData->wakeFrames, FALSE);
+				batches++;
+				if (nFrames <= 0) {
+					bStarved = batches > 1;
 					break;
+				}
+				txFrames += nFrames;
 			}
+			talkerBatchAdapt(pTalkerData, (S64)(txStartNS - pTalkerData->nextCycleNS), bStarved);
 		}
 		else {
-			// Interface module block option
-			if (IS_OPENAVB_SUCCESS(openavbAvtpTx(pTalkerData->avtpHandle, TRUE, pCfg->tx_blocking_in_intf)))
-				pTalkerData->cntFrames++;
+			// send the frames for this interval
+			txFrames = openavbAvtpTxBurst(pTalkerData->avtpHandle, pTalkerData->wakeFrames, pCfg->tx_blocking_in_intf);
 		}
+		pTalkerData->cntFrames += txFrames;
+	}
+	else {
+		// Interface module block option
+		if (IS_OPENAVB_SUCCESS(openavbAvtpTx(pTalkerData->avtpHandle, TRUE, pCfg->tx_blocking_in_intf)))
+			pTalkerData->cntFrames++;
+	}
 
-		if (pTalkerData->cntWakes++ % pTalkerData->wakeRate == 0) {
-			// time to service the endpoint IPC
+	if (pTalkerData->lookaheadNS) {
+		// IPC is serviced by the once per second check below
+	}
+	else {
+		// time to service the endpoint IPC once every wakeRate wake periods
+		unsigned long phase = pTalkerData->cntWakes % pTalkerData->wakeRate;
+		if (phase == 0 || phase + batches > pTalkerData->wakeRate) {
 			bRet = TRUE;
 		}
+		pTalkerData->cntWakes += batches;
+	}
 
-		if (!pCfg->fixed_timestamp) {
-			CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
-		} else {
-			CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
-		}
+	if (!pCfg->fixed_timestamp) {
+		CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &nowNS);
+	} else {
+		CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+	}
 
-		if (pCfg->report_seconds > 0) {
-			if (nowNS > pTalkerData->nextReportNS) {
-			  
-				S32 late = pTalkerData->wakesPerReport - pTalkerData->cntWakes;
-				U64 bytes = openavbAvtpBytes(pTalkerData->avtpHandle);
-				if (late < 0) late = 0;
-				U32 txbuf = openavbAvtpTxBufferLevel(pTalkerData->avtpHandle);
-				U32 mqbuf = openavbMediaQCountItems(pTLState->pMediaQ, TRUE);
-			
-				AVB_LOGRT_INFO(LOG_RT_BEGIN, LOG_RT_ITEM, FALSE, "TX UID:%d, ", LOG_RT_DATATYPE_U16, &pTalkerData->streamID.uniqueID);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "calls=%ld, ", LOG_RT_DATATYPE_U32, &pTalkerData->cntWakes);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "frames=%ld, ", LOG_RT_DATATYPE_U32, &pTalkerData->cntFrames);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "late=%d, ", LOG_RT_DATATYPE_U32, &late);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "bytes=%lld, ", LOG_RT_DATATYPE_U64, &bytes);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "txbuf=%d, ", LOG_RT_DATATYPE_U32, &txbuf);
-				AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, LOG_RT_END, "mqbuf=%d, ", LOG_RT_DATATYPE_U32, &mqbuf);
-
-				openavbTalkerAddStat(pTLState, TL_STAT_TX_CALLS, pTalkerData->cntWakes);
-				openavbTalkerAddStat(pTLState, TL_STAT_TX_FRAMES, pTalkerData->cntFrames);
-				openavbTalkerAddStat(pTLState, TL_STAT_TX_LATE, late);
-				openavbTalkerAddStat(pTLState, TL_STAT_TX_BYTES, bytes);
-
-				pTalkerData->cntFrames = 0;
-				pTalkerData->cntWakes = 0;
-				pTalkerData->nextReportNS = nowNS + (pCfg->report_seconds * NANOSECONDS_PER_SECOND);  
+	if (txStartNS && txFrames > 0) {
+		openavbHistRecord(&pTLState->hist[TL_HIST_TX_PATH], (U32)((nowNS - txStartNS) / txFrames));
+	}
+
+	if (pCfg->report_seconds > 0) {
+		if (nowNS > pTalkerData->nextReportNS) {
+		  
+			S32 late = pTalkerData->wakesPerReport - pTalkerData->cntWakes;
+			U64 bytes = openavbAvtpBytes(pTalkerData->avtpHandle);
+			if (late < 0) late = 0;
+			U32 txbuf = openavbAvtpTxBufferLevel(pTalkerData->avtpHandle);
+			U32 mqbuf = openavbMediaQCountItems(pTLState->pMediaQ, TRUE);
+		
+			AVB_LOGRT_INFO(LOG_RT_BEGIN, LOG_RT_ITEM, FALSE, "TX UID:%d, ", LOG_RT_DATATYPE_U16, &pTalkerData->streamID.uniqueID);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "calls=%ld, ", LOG_RT_DATATYPE_U32, &pTalkerData->cntWakes);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "frames=%ld, ", LOG_RT_DATATYPE_U32, &pTalkerData->cntFrames);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "late=%d, ", LOG_RT_DATATYPE_U32, &late);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "bytes=%lld, ", LOG_RT_DATATYPE_U64, &bytes);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, FALSE, "txbuf=%d, ", LOG_RT_DATATYPE_U32, &txbuf);
+			AVB_LOGRT_INFO(FALSE, LOG_RT_ITEM, LOG_RT_END, "mqbuf=%d, ", LOG_RT_DATATYPE_U32, &mqbuf);
+
+			openavbTalkerAddStat(pTLState, TL_STAT_TX_CALLS, pTalkerData->cntWakes);
+			openavbTalkerAddStat(pTLState, TL_STAT_TX_FRAMES, pTalkerData->cntFrames);
+			openavbTalkerAddStat(pTLState, TL_STAT_TX_LATE, late);
+			openavbTalkerAddStat(pTLState, TL_STAT_TX_BYTES, bytes);
+			openavbTalkerAddStat(pTLState, TL_STAT_TX_NULL, openavbAvtpTxNullFrames(pTalkerData->avtpHandle));
+			openavbTalkerAddStat(pTLState, TL_STAT_REDUNDANT, openavbAvtpRedundantCount(pTalkerData->avtpHandle));
+
+			// Sent to the endpoint the next time IPC is serviced, off this path
+			if (pCfg->latency_hist || pCfg->ts_eval) {
+				pTLState->bHistReport = TRUE;
 			}
+
+			pTalkerData->cntFrames = 0;
+			pTalkerData->cntWakes = 0;
+			pTalkerData->nextReportNS = nowNS + (pCfg->report_seconds * NANOSECONDS_PER_SECOND);  
 		}
+	}
 
-		if (nowNS > pTalkerData->nextSecondNS) {
-			pTalkerData->nextSecondNS += NANOSECONDS_PER_SECOND;
-			bRet = TRUE;
+	if (nowNS > pTalkerData->nextSecondNS) {
+		pTalkerData->nextSecondNS += NANOSECONDS_PER_SECOND;
+		bRet = TRUE;
+
+		if (!pTalkerData->batchLate && pTalkerData->batchCur > 1) {
+			pTalkerData->batchCur--;
 		}
+		pTalkerData->batchLate = FALSE;
 
-		if (!pCfg->tx_blocking_in_intf) {
-			pTalkerData->nextCycleNS += pTalkerData->intervalNS;
+		if (pCfg->cpu_stats) {
+			openavbTLCpuSample(pTLState, pTalkerData->avtpHandle);
+		}
+	}
+
+	if (!pCfg->tx_blocking_in_intf) {
+		if (!pTalkerData->lookaheadNS)
+			pTalkerData->nextCycleNS += pTalkerData->intervalNS * batches;
+
+		if ((pTalkerData->nextCycleNS + (pCfg->max_transmit_deficit_usec * 1000)) < nowNS) {
+			// Hit max deficit time. Something must be wrong. Reset the cycle timer.	
+			// Align clock : allows for some performance gain
+			nowNS = ((nowNS + (pTalkerData->intervalNS)) / pTalkerData->intervalNS) * pTalkerData->intervalNS;
+			pTalkerData->nextCycleNS = nowNS + pTalkerData->intervalNS;
+		}				
+	}
 
-			if ((pTalkerData->nextCycleNS + (pCfg->max_transmit_deficit_usec * 1000)) < nowNS) {
-				// Hit max deficit time. Something must be wrong. Reset the cycle timer.	
-				// Align clock : allows for some performance gain
-				nowNS = ((nowNS + (pTalkerData->intervalNS)) / pTalkerData->intervalNS) * pTalkerData->intervalNS;
-				pTalkerData->nextCycleNS = nowNS + pTalkerData->intervalNS;
-			}				
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return bRet;
+}
+
+static inline bool talkerDoStream(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	if (!pTLState) {
+		AVB_LOG_ERROR("Invalid TLState");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
+	bool bRet = FALSE;
+
+	if (pTLState->bStreaming && !pTalkerData->pPoolGroup) {
+		if (!pTalkerData->lookaheadNS && !pCfg->tx_blocking_in_intf) {
+			if (!pCfg->fixed_timestamp) {
+				// sleep until the next interval
+				SLEEP_UNTIL_NSEC(pTalkerData->nextCycleNS);
+			} else {
+				// frames with a launch time need no precise wake-up
+				if (!((avtp_stream_t *)pTalkerData->avtpHandle)->bLaunchTime)
+					SLEEP_SPIN_UNTIL_NSEC(pTalkerData->nextCycleNS, (U64)pCfg->spin_guard_usec * NANOSECONDS_PER_USEC);
+			}
 		}
+
+		bRet = talkerDoInterval(pTLState);
 	}
 	else {
-            SLEEP(1);
-	    // time to service the endpoint IPC
-	    bRet = TRUE;
+		// not streaming, or a talker pool thread is streaming for us.
+		// Time to service the endpoint IPC, which blocks instead of sleeping.
+		bRet = TRUE;
 	}
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
@@ -315,11 +630,11 @@ void openavbTLRunTalker(tl_state_t *pTLState)
 		return;
 	}
 
-	pTLState->pPvtTalkerData = calloc(1, sizeof(talker_data_t));
-	if (!pTLState->pPvtTalkerData) {
-		AVB_LOG_WARNING("Failed to allocate talker data.");
-		return;
-	}
+	// Fault the media queue arena in on this thread's NUMA node
+	openavbMediaQArenaLock(pTLState->pMediaQ);
+	openavbTLLockMemory(pTLState);
+
+	pTLState->pPvtTalkerData = memset(pTLState->pRtStorage, 0, sizeof(talker_data_t));
 
 	// Create Stats Mutex
 	{
@@ -348,8 +663,17 @@ void openavbTLRunTalker(tl_state_t *pTLState)
 			// TalkerDoStream() returns TRUE once per second,
 			// so that we can service our IPC at that low rate.
 			if (bServiceIPC) {
-				// Look for messages from endpoint.  Don't block (timeout=0)
-				if (!openavbEptClntService(pTLState->endpointHandle, 0)) {
+				if (pTLState->bHistReport) {
+					pTLState->bHistReport = FALSE;
+					openavbTLReportHist(pTLState, &(((talker_data_t *)pTLState->pPvtTalkerData)->streamID));
+				}
+
+				// Look for messages from endpoint. Don't block while streaming; when idle,
+				// wait on the endpoint so SRP changes it pushes are acted on immediately.
+				int ipcWaitMsec = TL_IDLE_IPC_WAIT_MSEC;
+				if (pTLState->bStreaming && !((talker_data_t *)pTLState->pPvtTalkerData)->pPoolGroup)
+					ipcWaitMsec = 0;
+				if (!openavbEptClntService(pTLState->endpointHandle, ipcWaitMsec)) {
 					AVB_LOGF_WARNING("Lost connection to endpoint, will retry "STREAMID_FORMAT, STREAMID_ARGS(&(((talker_data_t *)pTLState->pPvtTalkerData)->streamID)));
 					pTLState->bConnected = FALSE;
 					pTLState->endpointHandle = 0;
@@ -376,10 +700,7 @@ void openavbTLRunTalker(tl_state_t *pTLState)
 		AVB_LOGF_WARNING("Failed to connect to endpoint"STREAMID_FORMAT, STREAMID_ARGS(&(((talker_data_t *)pTLState->pPvtTalkerData)->streamID)));
 	}
 
-	if (pTLState->pPvtTalkerData) {
-		free(pTLState->pPvtTalkerData);
-		pTLState->pPvtTalkerData = NULL;
-	}
+	pTLState->pPvtTalkerData = NULL;
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
@@ -425,7 +746,9 @@ void openavbTalkerClearStats(tl_state_t *pTLState)
 
 	LOCK_STATS();
 	memset(&pTalkerData->stats, 0, sizeof(pTalkerData->stats));
+	memset(&pTLState->cpuStats.total, 0, sizeof(pTLState->cpuStats.total));
 	UNLOCK_STATS();
+	openavbTLResetHist(pTLState);
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
@@ -461,10 +784,25 @@ void openavbTalkerAddStat(tl_state_t *pTLState, tl_stat_t stat, U64 val)
 		case TL_STAT_TX_BYTES:
 			pTalkerData->stats.totalBytes += val;
 			break;
+		case TL_STAT_TX_NULL:
+			pTalkerData->stats.totalNull += val;
+			break;
+		case TL_STAT_REDUNDANT:
+			pTalkerData->stats.totalRedundant += val;
+			break;
 		case TL_STAT_RX_CALLS:
 		case TL_STAT_RX_FRAMES:
 		case TL_STAT_RX_LOST:
 		case TL_STAT_RX_BYTES:
+		case TL_STAT_MQ_PURGED:
+		case TL_STAT_MQ_REORDERED:
+		case TL_STAT_MQ_LATE:
+		case TL_STAT_MQ_DUPLICATE:
+		case TL_STAT_CPU_NS:
+		case TL_STAT_CPU_INVOL_CSW:
+		case TL_STAT_CPU_INTF_NS:
+		case TL_STAT_CPU_MAP_NS:
+		case TL_STAT_CPU_RAWSOCK_NS:
 			break;
 	}
 	UNLOCK_STATS();
@@ -504,11 +842,31 @@ U64 openavbTalkerGetStat(tl_state_t *pTLState, tl_stat_t stat)
 		case TL_STAT_TX_BYTES:
 			val = pTalkerData->stats.totalBytes;
 			break;
+		case TL_STAT_TX_NULL:
+			val = pTalkerData->stats.totalNull;
+			break;
+		case TL_STAT_REDUNDANT:
+			val = pTalkerData->stats.totalRedundant;
+			break;
 		case TL_STAT_RX_CALLS:
 		case TL_STAT_RX_FRAMES:
 		case TL_STAT_RX_LOST:
 		case TL_STAT_RX_BYTES:
 			break;
+		case TL_STAT_MQ_PURGED:
+			val = openavbMediaQPurgedItems(pTLState->pMediaQ);
+			break;
+		case TL_STAT_MQ_REORDERED:
+		case TL_STAT_MQ_LATE:
+		case TL_STAT_MQ_DUPLICATE:
+			break;
+		case TL_STAT_CPU_NS:
+		case TL_STAT_CPU_INVOL_CSW:
+		case TL_STAT_CPU_INTF_NS:
+		case TL_STAT_CPU_MAP_NS:
+		case TL_STAT_CPU_RAWSOCK_NS:
+			val = openavbTLCpuStat(pTLState, stat);
+			break;
 	}
 	UNLOCK_STATS();
 
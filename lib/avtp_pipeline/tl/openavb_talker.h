@@ -60,6 +60,13 @@ typedef struct {
 	U64 			intervalNS;
 	U64 			nextReportNS;
 	U64				nextSecondNS;
+	U64				lookaheadNS;
+	// Adaptive batching: wake periods sent per wake-up, from 1 to batchMax
+	U32				batchCur;
+	U32				batchMax;
+	bool			batchLate;
+	// Talker pool group servicing this stream, NULL when on its own thread
+	void			*pPoolGroup;
 	talker_stats_t	stats;
 } talker_data_t;
 
@@ -71,6 +78,7 @@ void openavbTalkerAddStat(tl_state_t *pTLState, tl_stat_t stat, U64 val);
 U64 openavbTalkerGetStat(tl_state_t *pTLState, tl_stat_t stat);
 bool talkerStartStream(tl_state_t *pTLState);
 void talkerStopStream(tl_state_t *pTLState);
+bool talkerDoInterval(tl_state_t *pTLState);
 bool openavbTLRunTalkerInit(tl_state_t *pTLState);
 void openavbTLRunTalkerFinish(tl_state_t *pTLState);
 
@@ -0,0 +1,343 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Talker pool implementation
+*
+* Each pool group owns one thread. Every wake it services, once, each of
+* its streams whose nextCycleNS has passed, then sleeps until the
+* earliest deadline. The starting stream rotates every wake, so a slow
+* interface module does not always delay the same peers. A stream that
+* has fallen behind catches up one interval per wake instead of
+* monopolizing the thread.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "openavb_platform.h"
+#include "openavb_trace.h"
+#include "openavb_tl.h"
+#include "openavb_talker.h"
+#include "openavb_talker_pool.h"
+
+#define	AVB_LOG_COMPONENT	"Talker"
+#include "openavb_log.h"
+
+THREAD_TYPE(talkerPoolThread);
+
+typedef struct talker_pool_group {
+	// Grouping key
+	U64 intervalNS;
+	bool bWallTime;
+	U32 affinity;
+	U32 rtPriority;
+	bool bRtFifo;
+
+	// Prefault the pool thread stack (thread_mlock)
+	bool bMemLock;
+
+	// Streams of one group share the interface and gPTP domain
+	char ifname[IFNAMSIZE];
+	S32 gptpDomain;
+
+	tl_state_t *pStreams[TALKER_POOL_MAX_STREAMS];
+	U32 nStreams;
+	// First stream serviced on the next wake
+	U32 firstStream;
+
+	bool bRunning;
+	MUTEX_HANDLE(lock);
+	THREAD_DEFINITON(talkerPoolThread);
+
+	struct talker_pool_group *pNext;
+} talker_pool_group_t;
+
+static talker_pool_group_t *gTalkerPoolGroups = NULL;
+MUTEX_HANDLE(gTalkerPoolMutex);
+
+#define POOL_LOCK() { MUTEX_CREATE_ERR(); MUTEX_LOCK(gTalkerPoolMutex); MUTEX_LOG_ERR("Mutex lock failure"); }
+#define POOL_UNLOCK() { MUTEX_CREATE_ERR(); MUTEX_UNLOCK(gTalkerPoolMutex); MUTEX_LOG_ERR("Mutex unlock failure"); }
+#define GROUP_LOCK(g) { MUTEX_CREATE_ERR(); MUTEX_LOCK((g)->lock); MUTEX_LOG_ERR("Mutex lock failure"); }
+#define GROUP_UNLOCK(g) { MUTEX_CREATE_ERR(); MUTEX_UNLOCK((g)->lock); MUTEX_LOG_ERR("Mutex unlock failure"); }
+
+static void *talkerPoolThreadFn(void *pv)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	talker_pool_group_t *pGroup = (talker_pool_group_t *)pv;
+	openavb_clockId_t clockId = pGroup->bWallTime ? OPENAVB_CLOCK_WALLTIME : OPENAVB_TIMER_CLOCK;
+
+	if (pGroup->bMemLock) {
+		openavbTLPrefaultStack();
+	}
+	osalAVBTimeSelectIf(pGroup->ifname);
+	osalAVBTimeSelectDomain(pGroup->gptpDomain);
+
+	while (pGroup->bRunning) {
+		U64 nowNS, nextNS = 0;
+		U32 i1;
+
+		GROUP_LOCK(pGroup);
+		CLOCK_GETTIME64(clockId, &nowNS);
+
+		U32 nStreams = pGroup->nStreams;
+		for (i1 = 0; i1 < nStreams; i1++) {
+			tl_state_t *pTLState = pGroup->pStreams[(pGroup->firstStream + i1) % nStreams];
+			talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
+
+			if (pTalkerData->nextCycleNS <= nowNS) {
+				talkerDoInterval(pTLState);
+			}
+
+			if (!nextNS || pTalkerData->nextCycleNS < nextNS) {
+				nextNS = pTalkerData->nextCycleNS;
+			}
+		}
+		if (nStreams) {
+			pGroup->firstStream = (pGroup->firstStream + 1) % nStreams;
+		}
+		GROUP_UNLOCK(pGroup);
+
+		if (!nextNS) {
+			nextNS = nowNS + pGroup->intervalNS;
+		}
+
+		if (!pGroup->bWallTime) {
+			SLEEP_UNTIL_NSEC(nextNS);
+		}
+		else {
+			// SLEEP_UNTIL_NSEC runs on the timer clock, not gPTP wall time
+			CLOCK_GETTIME64(OPENAVB_CLOCK_WALLTIME, &nowNS);
+			if (nextNS > nowNS) {
+				U64 timerNS;
+				CLOCK_GETTIME64(OPENAVB_TIMER_CLOCK, &timerNS);
+				SLEEP_UNTIL_NSEC(timerNS + (nextNS - nowNS));
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return NULL;
+}
+
+static talker_pool_group_t *talkerPoolGroupCreate(tl_state_t *pTLState)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
+
+	talker_pool_group_t *pGroup = calloc(1, sizeof(talker_pool_group_t));
+	if (!pGroup) {
+		AVB_LOG_ERROR("Unable to allocate talker pool group");
+		return NULL;
+	}
+
+	pGroup->intervalNS = pTalkerData->intervalNS;
+	pGroup->bWallTime = (pCfg->fixed_timestamp != 0);
+	pGroup->affinity = pCfg->thread_affinity;
+	pGroup->rtPriority = pCfg->thread_rt_priority;
+	pGroup->bRtFifo = pCfg->thread_rt_fifo;
+	pGroup->bMemLock = pCfg->thread_mlock;
+	snprintf(pGroup->ifname, sizeof(pGroup->ifname), "%s", pCfg->ifname);
+	pGroup->gptpDomain = pCfg->gptp_domain;
+
+	{
+		MUTEX_ATTR_HANDLE(mta);
+		MUTEX_ATTR_INIT(mta);
+		MUTEX_ATTR_SET_TYPE(mta, MUTEX_ATTR_TYPE_DEFAULT);
+		MUTEX_ATTR_SET_NAME(mta, "TalkerPoolGroupMutex");
+		MUTEX_CREATE_ERR();
+		MUTEX_CREATE(pGroup->lock, mta);
+		MUTEX_LOG_ERR("Could not create/initialize 'TalkerPoolGroupMutex' mutex");
+		if (MUTEX_IS_ERR) {
+			free(pGroup);
+			return NULL;
+		}
+	}
+
+	bool errResult;
+	pGroup->bRunning = TRUE;
+	THREAD_CREATE(talkerPoolThread, pGroup->talkerPoolThread, NULL, talkerPoolThreadFn, pGroup);
+	THREAD_CHECK_ERROR(pGroup->talkerPoolThread, "Thread / task creation failed", errResult);
+	if (errResult) {
+		MUTEX_CREATE_ERR();
+		MUTEX_DESTROY(pGroup->lock);
+		MUTEX_LOG_ERR("Error destroying mutex");
+		free(pGroup);
+		return NULL;
+	}
+
+	THREAD_SET_RT_POLICY(pGroup->talkerPoolThread, pGroup->bRtFifo ? SCHED_FIFO : SCHED_RR, pGroup->rtPriority);
+	THREAD_PIN(pGroup->talkerPoolThread, pGroup->affinity);
+
+	AVB_LOGF_INFO("Started talker pool thread, interval=%" PRIu64 "ns, affinity=0x%x", pGroup->intervalNS, pGroup->affinity);
+	return pGroup;
+}
+
+static void talkerPoolGroupDelete(talker_pool_group_t *pGroup)
+{
+	pGroup->bRunning = FALSE;
+	THREAD_JOIN(pGroup->talkerPoolThread, NULL);
+
+	MUTEX_CREATE_ERR();
+	MUTEX_DESTROY(pGroup->lock);
+	MUTEX_LOG_ERR("Error destroying mutex");
+
+	free(pGroup);
+}
+
+bool openavbTalkerPoolInit(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	gTalkerPoolGroups = NULL;
+
+	MUTEX_ATTR_HANDLE(mta);
+	MUTEX_ATTR_INIT(mta);
+	MUTEX_ATTR_SET_TYPE(mta, MUTEX_ATTR_TYPE_DEFAULT);
+	MUTEX_ATTR_SET_NAME(mta, "gTalkerPoolMutex");
+	MUTEX_CREATE_ERR();
+	MUTEX_CREATE(gTalkerPoolMutex, mta);
+	MUTEX_LOG_ERR("Error creating mutex");
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return !MUTEX_IS_ERR;
+}
+
+void openavbTalkerPoolCleanup(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	// Groups go away with their last stream; anything left here was not stopped
+	POOL_LOCK();
+	while (gTalkerPoolGroups) {
+		talker_pool_group_t *pGroup = gTalkerPoolGroups;
+		gTalkerPoolGroups = pGroup->pNext;
+		AVB_LOGF_WARNING("Talker pool group still has %u streams", pGroup->nStreams);
+		talkerPoolGroupDelete(pGroup);
+	}
+	POOL_UNLOCK();
+
+	MUTEX_CREATE_ERR();
+	MUTEX_DESTROY(gTalkerPoolMutex);
+	MUTEX_LOG_ERR("Error destroying mutex");
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+bool openavbTalkerPoolAdd(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
+	talker_pool_group_t *pGroup;
+
+	POOL_LOCK();
+	for (pGroup = gTalkerPoolGroups; pGroup; pGroup = pGroup->pNext) {
+		if (pGroup->intervalNS == pTalkerData->intervalNS
+			&& pGroup->bWallTime == (pCfg->fixed_timestamp != 0)
+			&& pGroup->affinity == pCfg->thread_affinity
+			&& pGroup->rtPriority == pCfg->thread_rt_priority
+			&& pGroup->bRtFifo == pCfg->thread_rt_fifo
+			&& strncmp(pGroup->ifname, pCfg->ifname, IFNAMSIZE) == 0
+			&& pGroup->gptpDomain == pCfg->gptp_domain
+			&& pGroup->nStreams < TALKER_POOL_MAX_STREAMS) {
+			break;
+		}
+	}
+
+	if (!pGroup) {
+		pGroup = talkerPoolGroupCreate(pTLState);
+		if (!pGroup) {
+			POOL_UNLOCK();
+			AVB_TRACE_EXIT(AVB_TRACE_TL);
+			return FALSE;
+		}
+		pGroup->pNext = gTalkerPoolGroups;
+		gTalkerPoolGroups = pGroup;
+	}
+
+	GROUP_LOCK(pGroup);
+	pGroup->pStreams[pGroup->nStreams++] = pTLState;
+	pTalkerData->pPoolGroup = pGroup;
+	GROUP_UNLOCK(pGroup);
+	POOL_UNLOCK();
+
+	AVB_LOGF_INFO("Talker "STREAMID_FORMAT" added to pool (%u streams)", STREAMID_ARGS(&pTalkerData->streamID), pGroup->nStreams);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return TRUE;
+}
+
+void openavbTalkerPoolRemove(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	talker_data_t *pTalkerData = pTLState->pPvtTalkerData;
+	talker_pool_group_t *pGroup = (talker_pool_group_t *)pTalkerData->pPoolGroup;
+	talker_pool_group_t **ppGroup;
+	U32 i1;
+
+	if (!pGroup) {
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+
+	POOL_LOCK();
+
+	// Taking the group lock waits out a wake that may be servicing this stream
+	GROUP_LOCK(pGroup);
+	for (i1 = 0; i1 < pGroup->nStreams; i1++) {
+		if (pGroup->pStreams[i1] == pTLState) {
+			pGroup->pStreams[i1] = pGroup->pStreams[--pGroup->nStreams];
+			break;
+		}
+	}
+	pGroup->firstStream = 0;
+	pTalkerData->pPoolGroup = NULL;
+	bool bEmpty = (pGroup->nStreams == 0);
+	GROUP_UNLOCK(pGroup);
+
+	if (bEmpty) {
+		for (ppGroup = &gTalkerPoolGroups; *ppGroup; ppGroup = &(*ppGroup)->pNext) {
+			if (*ppGroup == pGroup) {
+				*ppGroup = pGroup->pNext;
+				break;
+			}
+		}
+	}
+	POOL_UNLOCK();
+
+	if (bEmpty) {
+		talkerPoolGroupDelete(pGroup);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
@@ -35,12 +35,19 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
 #include "openavb_tl.h"
 #include "openavb_trace.h"
 #include "openavb_mediaq.h"
 #include "openavb_talker.h"
 #include "openavb_listener.h"
-// #include "openavb_avtp.h"
+#include "openavb_talker_pool.h"
+#include "openavb_listener_pool.h"
+#include "openavb_tl_fanout.h"
+#include "openavb_tl_shared_source.h"
+#include "openavb_rawsock.h"
+#include "openavb_avtp.h"
 #include "openavb_platform.h"
 
 #define	AVB_LOG_COMPONENT	"Talker / Listener"
@@ -298,6 +305,18 @@ EXTERN_DLL_EXPORT bool openavbTLInitialize(U32 maxTL)
 		MUTEX_LOG_ERR("Error creating mutex");
 	}
 
+	if (!openavbTalkerPoolInit()) {
+		AVB_LOG_ERROR("Failed to initialize talker pool");
+	}
+
+	if (!openavbListenerPoolInit()) {
+		AVB_LOG_ERROR("Failed to initialize listener pool");
+	}
+
+	if (!openavbTLSharedSourceInitialize()) {
+		AVB_LOG_ERROR("Failed to initialize shared sources");
+	}
+
 	gTLHandleList = calloc(1, sizeof(tl_handle_t) * gMaxTL);
 	if (gTLHandleList) {
 		AVB_TRACE_EXIT(AVB_TRACE_TL);
@@ -321,6 +340,10 @@ EXTERN_DLL_EXPORT bool openavbTLCleanup()
 		return FALSE;
 	}
 
+	openavbTalkerPoolCleanup();
+	openavbListenerPoolCleanup();
+	openavbTLSharedSourceCleanup();
+
 	{
 		MUTEX_CREATE_ERR();
 		MUTEX_DESTROY(gTLStateMutex);
@@ -343,17 +366,34 @@ EXTERN_DLL_EXPORT bool openavbGetVersion(U8 *major, U8 *minor, U8 *revision)
 	return TRUE;
 }
 
+#define TL_CACHE_ALIGN(x)	(((x) + OPENAVB_CACHE_LINE_SIZE - 1) & ~((size_t)OPENAVB_CACHE_LINE_SIZE - 1))
+
+// Every stream lives in one block: its tl_state_t (configuration, control and
+// stats), then the talker or listener data, AVTP stream and media queue its
+// thread works on. Each part starts on a cache line of its own and the block
+// is a whole number of lines, so the counters a stream thread writes never
+// share a line with another stream's state, or with the configuration other
+// threads read, as separate small callocs would.
 EXTERN_DLL_EXPORT tl_handle_t openavbTLOpen(void)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_TL);
 
-	tl_state_t *pTLState = calloc(1, sizeof(tl_state_t));
+	size_t rtSize = sizeof(talker_data_t) > sizeof(listener_data_t) ? sizeof(talker_data_t) : sizeof(listener_data_t);
+	size_t offRt = TL_CACHE_ALIGN(sizeof(tl_state_t));
+	size_t offAvtp = offRt + TL_CACHE_ALIGN(rtSize);
+	size_t offMediaQ = offAvtp + TL_CACHE_ALIGN(openavbAvtpStreamSize());
+	size_t blockSize = offMediaQ + TL_CACHE_ALIGN(openavbMediaQStorageSize());
 
-	if (!pTLState) {
+	tl_state_t *pTLState = NULL;
+	if (posix_memalign((void **)&pTLState, OPENAVB_CACHE_LINE_SIZE, blockSize) != 0) {
 		AVB_LOG_ERROR("Unable to allocate talker listener state data.");
 		AVB_TRACE_EXIT(AVB_TRACE_TL);
 		return NULL;
 	}
+	memset(pTLState, 0, blockSize);
+	pTLState->pRtStorage = (U8 *)pTLState + offRt;
+	pTLState->pAvtpStorage = (U8 *)pTLState + offAvtp;
+	pTLState->pMediaQStorage = (U8 *)pTLState + offMediaQ;
 
 	if (!TLHandleListAdd(pTLState)) {
 		AVB_LOG_ERROR("To many talker listeners open.");
@@ -391,14 +431,46 @@ EXTERN_DLL_EXPORT void openavbTLInitCfg(openavb_tl_cfg_t *pCfg)
 	pCfg->sr_rank = SR_RANK_REGULAR;
 	pCfg->raw_tx_buffers = 8;
 	pCfg->raw_rx_buffers = 100;
+	pCfg->rx_block_intervals = 0;
+	pCfg->rx_busy_poll_usec = 0;
+	pCfg->rx_adapt_permille = 0;
+	pCfg->rx_adapt_margin_usec = 1000;
 	pCfg->tx_blocking_in_intf =  0;
 	pCfg->rx_signal_mode = 1;
 	pCfg->pMapInitFn = NULL;
 	pCfg->pIntfInitFn = NULL;
 	pCfg->vlan_id = VLAN_NULL;
+	pCfg->gptp_domain = -1;
 	pCfg->fixed_timestamp = 0;
+	pCfg->launch_lookahead_usec = 0;
+	pCfg->batch_adapt_max = 0;
+	pCfg->spin_guard_usec = 100;
+	pCfg->asrc = 0;
+	pCfg->asrc_buffer_usec = 0;
+	pCfg->tx_null_on_underrun = FALSE;
+	pCfg->transit_calibrate = 0;
+	pCfg->transit_margin_usec = 2000;
 	pCfg->thread_rt_priority = 0;
 	pCfg->thread_affinity = 0xFFFFFFFF;
+	pCfg->thread_rt_fifo = FALSE;
+	pCfg->thread_mlock = FALSE;
+	pCfg->mem_prefault = FALSE;
+	pCfg->mediaq_lock_free = FALSE;
+	pCfg->mediaq_arena = FALSE;
+	pCfg->mediaq_ring_size = 0;
+	pCfg->mediaq_ordered = FALSE;
+	pCfg->mediaq_max_late_usec = 0;
+	pCfg->mediaq_drop_duplicates = FALSE;
+	pCfg->talker_pool = FALSE;
+	pCfg->listener_pool = FALSE;
+	pCfg->latency_hist = FALSE;
+	pCfg->ts_eval = FALSE;
+	pCfg->cpu_stats = 0;
+	pCfg->latency_trace = 0;
+	pCfg->redundant_ifname[0] = '\0';
+	pCfg->pcap_file[0] = '\0';
+	pCfg->pcap_replay_speed = 100;
+	pCfg->pcap_replay_loops = 1;
 
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
@@ -416,7 +488,7 @@ EXTERN_DLL_EXPORT bool openavbTLConfigure(tl_handle_t handle, openavb_tl_cfg_t *
 	}
 
 	// Create the mediaQ
-	pTLState->pMediaQ = openavbMediaQCreate();
+	pTLState->pMediaQ = openavbMediaQCreateIn(pTLState->pMediaQStorage);
 	if (!pTLState->pMediaQ) {
 		AVB_LOG_ERROR("Unable to create media queue");
 		AVB_TRACE_EXIT(AVB_TRACE_TL);
@@ -429,6 +501,8 @@ EXTERN_DLL_EXPORT bool openavbTLConfigure(tl_handle_t handle, openavb_tl_cfg_t *
 	memcpy(&pTLState->cfg, pCfgIn, sizeof(openavb_tl_cfg_t));
 	pTLState->cfg.dest_addr.mac = &pTLState->cfg.dest_addr.buffer;
 	pTLState->cfg.stream_addr.mac = &pTLState->cfg.stream_addr.buffer;
+	if (pCfgIn->redundant_dest_addr.mac)
+		pTLState->cfg.redundant_dest_addr.mac = &pTLState->cfg.redundant_dest_addr.buffer;
 
 	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
 
@@ -443,6 +517,27 @@ EXTERN_DLL_EXPORT bool openavbTLConfigure(tl_handle_t handle, openavb_tl_cfg_t *
 	}
 
 	openavbMediaQSetMaxStaleTail(pTLState->pMediaQ, pCfg->max_stale);
+	if (pCfg->mediaq_lock_free) {
+		openavbMediaQLockFreeOn(pTLState->pMediaQ);
+	}
+	if (pCfg->mediaq_arena) {
+		openavbMediaQArenaOn(pTLState->pMediaQ);
+	}
+	if (pCfg->mediaq_ring_size) {
+		openavbMediaQRingOn(pTLState->pMediaQ, pCfg->mediaq_ring_size);
+	}
+	if (pCfg->mediaq_ordered && pCfg->role == AVB_ROLE_LISTENER) {
+		openavbMediaQOrderedOn(pTLState->pMediaQ, pCfg->mediaq_max_late_usec, pCfg->mediaq_drop_duplicates);
+	}
+	if (pCfg->latency_hist) {
+		openavbMediaQSetHistograms(pTLState->pMediaQ, &pTLState->hist[TL_HIST_MQ_RESIDENCY],
+			pCfg->role == AVB_ROLE_LISTENER ? &pTLState->hist[TL_HIST_RX_MARGIN] : NULL);
+		openavbMediaQSetInstrument(pTLState->pMediaQ, &pTLState->mqInstr);
+	}
+	else if (pCfg->rx_adapt_permille && pCfg->role == AVB_ROLE_LISTENER) {
+		// The adaptive buffer depth is driven by the presentation margin
+		openavbMediaQSetHistograms(pTLState->pMediaQ, NULL, &pTLState->hist[TL_HIST_RX_MARGIN]);
+	}
 
 	if (!openavbTLOpenLinkLibsOsal(pTLState)) {
 		AVB_LOG_ERROR("Failed to open mapping / interface library");
@@ -457,7 +552,19 @@ EXTERN_DLL_EXPORT bool openavbTLConfigure(tl_handle_t handle, openavb_tl_cfg_t *
 		return FALSE;
 	}
 
-	if (pCfg->pIntfInitFn && pCfg->pIntfInitFn(pTLState->pMediaQ, &pCfg->intf_cb)) {
+	if (openavbTLFanoutConfigured(pTLState)) {
+		if (!openavbTLFanoutInit(pTLState)) {
+			AVB_LOG_ERROR("Fan-out interface initialize error.");
+			return FALSE;
+		}
+	}
+	else if (pCfg->shared_source[0]) {
+		if (!openavbTLSharedSourceInit(pTLState)) {
+			AVB_LOG_ERROR("Shared source initialize error.");
+			return FALSE;
+		}
+	}
+	else if (pCfg->pIntfInitFn && pCfg->pIntfInitFn(pTLState->pMediaQ, &pCfg->intf_cb)) {
 		checkIntfCallbacks(&pTLState->cfg);
 	}
 	else {
@@ -468,7 +575,8 @@ EXTERN_DLL_EXPORT bool openavbTLConfigure(tl_handle_t handle, openavb_tl_cfg_t *
 	// Submit configuration values to mapping and interface modules
 	int i;
 	for (i = 0; i < pNVCfg->nLibCfgItems; i++) {
-		if (MATCH_LEFT(pNVCfg->libCfgNames[i], "intf_nv_", 8)) {
+		if (MATCH_LEFT(pNVCfg->libCfgNames[i], "intf_nv_", 8)
+			|| MATCH_LEFT(pNVCfg->libCfgNames[i], "fanout", 6)) {
 			if (pCfg->intf_cb.intf_cfg_cb) {
 				pCfg->intf_cb.intf_cfg_cb(pTLState->pMediaQ, pNVCfg->libCfgNames[i], pNVCfg->libCfgValues[i]);
 			}
@@ -512,14 +620,15 @@ EXTERN_DLL_EXPORT bool openavbTLRun(tl_handle_t handle)
 		pTLState->bRunning = TRUE;
 		if (pTLState->cfg.role == AVB_ROLE_TALKER) {
 			THREAD_CREATE_TALKER();
-
-			THREAD_SET_RT_PRIORITY(pTLState->TLThread, pTLState->cfg.thread_rt_priority);
-			THREAD_PIN(pTLState->TLThread, pTLState->cfg.thread_affinity);
 		}
 		else if (pTLState->cfg.role == AVB_ROLE_LISTENER) {
 			THREAD_CREATE_LISTENER();
 		}
 
+		THREAD_SET_RT_POLICY(pTLState->TLThread,
+			pTLState->cfg.thread_rt_fifo ? SCHED_FIFO : SCHED_RR, pTLState->cfg.thread_rt_priority);
+		THREAD_PIN(pTLState->TLThread, pTLState->cfg.thread_affinity);
+
 		retVal = TRUE;
 
 	} while (0);
@@ -585,6 +694,9 @@ EXTERN_DLL_EXPORT bool openavbTLClose(tl_handle_t handle)
 		pTLState->pMediaQ = NULL;
 	}
 
+	openavbLatTraceDelete(pTLState->pLatRing);
+	pTLState->pLatRing = NULL;
+
 	// Free TLState
 	free(pTLState);
 	pTLState = NULL;
@@ -714,6 +826,265 @@ EXTERN_DLL_EXPORT U64 openavbTLStat(tl_handle_t handle, tl_stat_t stat)
 	return val;
 }
 
+EXTERN_DLL_EXPORT bool openavbTLHistogram(tl_handle_t handle, tl_hist_t hist, openavb_hist_t *pHist)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	tl_state_t *pTLState = (tl_state_t *)handle;
+
+	if (!pTLState || !pHist || hist >= TL_HIST_COUNT) {
+		AVB_LOG_ERROR("Invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	openavbHistSnapshot(&pTLState->hist[hist], pHist);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return TRUE;
+}
+
+EXTERN_DLL_EXPORT bool openavbTLMediaQInstr(tl_handle_t handle, media_q_instr_t *pInstr, bool bRestartMarks)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	tl_state_t *pTLState = (tl_state_t *)handle;
+
+	if (!pTLState || !pInstr) {
+		AVB_LOG_ERROR("Invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	openavbMediaQInstrSnapshot(&pTLState->mqInstr, pInstr, bRestartMarks);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return TRUE;
+}
+
+EXTERN_DLL_EXPORT U32 openavbTLLatencyTrace(tl_handle_t handle, openavb_lat_sample_t *pSamples, U32 max)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	tl_state_t *pTLState = (tl_state_t *)handle;
+
+	if (!pTLState || !pSamples) {
+		AVB_LOG_ERROR("Invalid argument");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return 0;
+	}
+
+	U32 n = openavbLatTraceRead(pTLState->pLatRing, pSamples, max);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return n;
+}
+
+void openavbTLLatTraceStart(tl_state_t *pTLState, void *avtpHandle)
+{
+	if (!pTLState->cfg.latency_trace)
+		return;
+
+	if (!pTLState->pLatRing) {
+		pTLState->pLatRing = openavbLatTraceNew(pTLState->cfg.latency_trace);
+		if (!pTLState->pLatRing) {
+			AVB_LOGF_ERROR("latency_trace must be a power of two up to %d; not tracing", OPENAVB_LAT_TRACE_MAX_PERIOD);
+			return;
+		}
+	}
+	openavbAvtpSetLatencyTrace(avtpHandle, pTLState->pLatRing);
+}
+
+void openavbTLTsEvalStart(tl_state_t *pTLState, void *avtpHandle)
+{
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	if (!pCfg->ts_eval)
+		return;
+
+	// Every frame carries a timestamp: frames per interval times intervals per second
+	U32 intervals = pCfg->map_cb.map_transmit_interval_cb(pTLState->pMediaQ);
+	if (!intervals) {
+		intervals = pCfg->sr_class == SR_CLASS_A ? 8000 : 4000;
+	}
+	U32 tsPerSecond = intervals * (pCfg->max_interval_frames ? pCfg->max_interval_frames : 1);
+
+	openavbAvtpConfigTimsstampEval(avtpHandle, tsPerSecond,
+		&pTLState->hist[TL_HIST_TS_JITTER], &pTLState->hist[TL_HIST_TS_DRIFT], FALSE, 0, 0);
+}
+
+void openavbTLCallTimeStart(tl_state_t *pTLState, void *avtpHandle)
+{
+	if (!pTLState->cfg.cpu_stats)
+		return;
+
+	openavbAvtpSetCallHistograms(avtpHandle,
+		&pTLState->hist[TL_HIST_INTF_CALL], &pTLState->hist[TL_HIST_MAP_CALL]);
+}
+
+// Indexed by tl_hist_t
+static const char *x_histNames[TL_HIST_COUNT] = {
+	"tx_wake_late",
+	"tx_path",
+	"mq_residency",
+	"rx_margin",
+	"ts_jitter",
+	"ts_drift",
+	"intf_call",
+	"map_call",
+};
+
+// Touch the top of the calling thread's stack so its pages are present
+// (and, after mlockall(MCL_FUTURE), locked) before the first interval.
+void openavbTLPrefaultStack(void)
+{
+	U8 stack[TL_STACK_PREFAULT_BYTES];
+	volatile U8 *pStack = stack;
+	U32 i1;
+	for (i1 = 0; i1 < sizeof(stack); i1 += 4096) {
+		pStack[i1] = 0;
+	}
+}
+
+void openavbTLLockMemory(tl_state_t *pTLState)
+{
+	if (!pTLState->cfg.thread_mlock)
+		return;
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		AVB_LOGF_WARNING("mlockall failed: %s", strerror(errno));
+	}
+	else {
+		pTLState->bMemLocked = TRUE;
+	}
+	openavbTLPrefaultStack();
+}
+
+// Memory mapped after openavbTLLockMemory() is locked by MCL_FUTURE, so what
+// is touched here is also locked when thread_mlock is set.
+void openavbTLPrefault(tl_state_t *pTLState, void *rawsock, AVBStreamID_t *streamID)
+{
+	if (!pTLState->cfg.mem_prefault)
+		return;
+
+	size_t mqBytes = openavbMediaQPrefault(pTLState->pMediaQ);
+	size_t rsBytes = rawsock ? openavbRawsockPrefault(rawsock) : 0;
+	openavbTLPrefaultStack();
+
+	AVB_LOGF_INFO(STREAMID_FORMAT" prefaulted %zu KB (mediaq=%zu KB, rawsock=%zu KB, stack=%u KB), %s",
+		STREAMID_ARGS(streamID), (mqBytes + rsBytes + TL_STACK_PREFAULT_BYTES) / 1024,
+		mqBytes / 1024, rsBytes / 1024, TL_STACK_PREFAULT_BYTES / 1024,
+		pTLState->bMemLocked ? "locked" : "not locked");
+}
+
+void openavbTLCpuStart(tl_state_t *pTLState, bool bOwnThread)
+{
+	tl_cpu_stats_t *pCpu = &pTLState->cpuStats;
+
+	pCpu->bOwnThread = FALSE;
+	pCpu->tickCnt = 0;
+	if (!pTLState->cfg.cpu_stats)
+		return;
+
+	if (bOwnThread) {
+		if (openavbTLThreadCpuOsal(&pCpu->lastCpuNS, &pCpu->lastInvolCsw)) {
+			pCpu->bOwnThread = TRUE;
+		}
+		else {
+			AVB_LOG_WARNING("Thread CPU time not available; cpu_stats only splits the phases");
+		}
+	}
+}
+
+void openavbTLCpuTick(tl_state_t *pTLState, void *avtpHandle)
+{
+	tl_cpu_stats_t *pCpu = &pTLState->cpuStats;
+
+	if (pCpu->tickCnt == 0)
+		pCpu->tickCnt = pTLState->cfg.cpu_stats;
+	openavbAvtpPhaseTimeOn(avtpHandle, --pCpu->tickCnt == 0);
+}
+
+// The thread CPU time and context switch count are read with system calls,
+// so this is only done once a second and at stream stop, never per call.
+void openavbTLCpuSample(tl_state_t *pTLState, void *avtpHandle)
+{
+	tl_cpu_stats_t *pCpu = &pTLState->cpuStats;
+	U64 scale = pTLState->cfg.cpu_stats;
+	U64 cpuNS = 0, involCsw = 0, intfNS, mapNS, rawsockNS;
+
+	if (!scale)
+		return;
+
+	openavbAvtpPhaseTimeTake(avtpHandle, &intfNS, &mapNS, &rawsockNS);
+
+	if (pCpu->bOwnThread && openavbTLThreadCpuOsal(&cpuNS, &involCsw)) {
+		U64 lastCpuNS = pCpu->lastCpuNS, lastInvolCsw = pCpu->lastInvolCsw;
+		pCpu->lastCpuNS = cpuNS;
+		pCpu->lastInvolCsw = involCsw;
+		cpuNS -= lastCpuNS;
+		involCsw -= lastInvolCsw;
+	}
+
+	LOCK_STATS();
+	pCpu->total.cpuNS += cpuNS;
+	pCpu->total.involCsw += involCsw;
+	pCpu->total.intfNS += intfNS * scale;
+	pCpu->total.mapNS += mapNS * scale;
+	pCpu->total.rawsockNS += rawsockNS * scale;
+	UNLOCK_STATS();
+}
+
+U64 openavbTLCpuStat(tl_state_t *pTLState, tl_stat_t stat)
+{
+	tl_cpu_totals_t *pTotal = &pTLState->cpuStats.total;
+
+	switch (stat) {
+		case TL_STAT_CPU_NS:
+			return pTotal->cpuNS;
+		case TL_STAT_CPU_INVOL_CSW:
+			return pTotal->involCsw;
+		case TL_STAT_CPU_INTF_NS:
+			return pTotal->intfNS;
+		case TL_STAT_CPU_MAP_NS:
+			return pTotal->mapNS;
+		case TL_STAT_CPU_RAWSOCK_NS:
+			return pTotal->rawsockNS;
+		default:
+			return 0;
+	}
+}
+
+void openavbTLResetHist(tl_state_t *pTLState)
+{
+	int i1;
+	for (i1 = 0; i1 < TL_HIST_COUNT; i1++) {
+		openavbHistReset(&pTLState->hist[i1]);
+	}
+}
+
+void openavbTLReportHist(tl_state_t *pTLState, AVBStreamID_t *streamID)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	openavb_hist_t snap;
+	openavb_hist_summary_t summary[TL_HIST_COUNT];
+	int i1;
+
+	for (i1 = 0; i1 < TL_HIST_COUNT; i1++) {
+		openavbHistSnapshot(&pTLState->hist[i1], &snap);
+		openavbHistSummarize(&snap, &summary[i1]);
+		if (summary[i1].count) {
+			AVB_LOGF_INFO(STREAMID_FORMAT" %s: count=%" PRIu64 ", mean=%u, p50=%u, p99=%u, p99.9=%u, max=%u ns",
+				STREAMID_ARGS(streamID), x_histNames[i1], summary[i1].count, summary[i1].mean,
+				summary[i1].p50, summary[i1].p99, summary[i1].p999, summary[i1].max);
+		}
+	}
+
+	openavbEptClntSendStats(pTLState->endpointHandle, streamID, summary);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
 EXTERN_DLL_EXPORT void openavbTLPauseStream(tl_handle_t handle, bool bPause)
 {
 	AVB_TRACE_ENTRY(AVB_TRACE_TL);
@@ -726,6 +1097,14 @@ EXTERN_DLL_EXPORT void openavbTLPauseStream(tl_handle_t handle, bool bPause)
 		return;
 	}
 
+	pTLState->bPaused = bPause;
+
+	// Not streaming yet; applied when the stream starts
+	if (!pTLState->bStreaming) {
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+
 	if (pTLState->cfg.role == AVB_ROLE_TALKER) {
 		openavbTLPauseTalker(pTLState, bPause);
 	}
@@ -736,5 +1115,11 @@ EXTERN_DLL_EXPORT void openavbTLPauseStream(tl_handle_t handle, bool bPause)
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
 
+EXTERN_DLL_EXPORT bool openavbTLIsStreamPaused(tl_handle_t handle)
+{
+	tl_state_t *pTLState = (tl_state_t *)handle;
+	return pTLState && pTLState->bPaused;
+}
+
 
 
@@ -52,10 +52,35 @@ typedef struct {
 	U64 totalFrames;
 	U64 totalLate;
 	U64 totalBytes;
+	U64 totalNull;
+	U64 totalRedundant;
 } talker_stats_t;
 
 THREAD_TYPE(TLThread);
 
+// Interface modules a listener can feed besides its own (fanout1 .. fanoutN)
+#define TL_FANOUT_MAX		4
+
+// CPU accounting totals (cpu_stats). Guarded by the stats mutex.
+typedef struct {
+	U64 cpuNS;
+	U64 involCsw;
+	U64 intfNS;
+	U64 mapNS;
+	U64 rawsockNS;
+} tl_cpu_totals_t;
+
+typedef struct {
+	tl_cpu_totals_t total;
+	// The stream has a thread of its own, so that thread's CPU time is the stream's
+	bool bOwnThread;
+	// Thread CPU time and involuntary context switches at the last sample
+	U64 lastCpuNS;
+	U64 lastInvolCsw;
+	// Calls until the phases are timed again
+	U32 tickCnt;
+} tl_cpu_stats_t;
+
 typedef struct {
 	// Running flag. (assumed atomic)
 	bool bRunning;
@@ -66,6 +91,10 @@ typedef struct {
 	// Streaming data flag. (assumed atomic)
 	bool bStreaming;
 
+	// Warm standby requested with openavbTLPauseStream(); kept across
+	// stream starts so a stream can also start out paused
+	bool bPaused;
+
 	// The status of the version check to make sure endpoint and TL are running the same version.
 	openavbTLAVBVerState_t AVBVerState;
 
@@ -84,15 +113,43 @@ typedef struct {
 	// Private listener data.
 	void *pPvtListenerData;
 
+	// Storage for the talker or listener data, AVTP stream and media queue,
+	// in the same cache line aligned block as this state (see openavbTLOpen()).
+	void *pRtStorage;
+	void *pAvtpStorage;
+	void *pMediaQStorage;
+
 	// Thread for talker or listener
 	THREAD_DEFINITON(TLThread);
 
 	// Per stream Stats Mutex
 	MUTEX_HANDLE(statsMutex);
 
+	// Latency histograms. Each one is recorded from a single thread.
+	openavb_hist_t hist[TL_HIST_COUNT];
+
+	// Media queue occupancy instrumentation (latency_hist)
+	media_q_instr_t mqInstr;
+
+	// Set by the stream thread when the histograms should be sent to the endpoint.
+	bool bHistReport;
+
+	// Set once mlockall() has succeeded for this stream (thread_mlock)
+	bool bMemLocked;
+
+	// CPU accounting (cpu_stats)
+	tl_cpu_stats_t cpuStats;
+
+	// Latency trace ring (latency_trace), kept until close so it can be read after the stream stops
+	openavb_lat_ring_t *pLatRing;
+
 	LINK_LIB(mapLib);
 
 	LINK_LIB(intfLib);
+
+	// Fan-out interface modules (listener only)
+	LINK_LIB(fanoutLib[TL_FANOUT_MAX]);
+	openavb_intf_initialize_fn_t pFanoutInitFn[TL_FANOUT_MAX];
 } tl_state_t;
 
 // Clock that we use for all timers in TL
@@ -149,16 +206,64 @@ bool openavbTLAVDECCStopTalker(tl_handle_t handle, U16 configIdx, void *pVoidTal
 bool openavbTLAVDECCGetTalkerStreamInfo(tl_handle_t handle, U16 configIdx, void *pVoidTalkerStreamInfo);
 
 
+////////////////
+// Latency histogram functions
+////////////////
+// Clear the latency histograms of a stream.
+void openavbTLResetHist(tl_state_t *pTLState);
+// Summarize the latency histograms of a stream and send them to the endpoint.
+void openavbTLReportHist(tl_state_t *pTLState, AVBStreamID_t *streamID);
+
+////////////////
+// Memory locking
+////////////////
+// Stack touched up front by openavbTLPrefaultStack(); well inside THREAD_STACK_SIZE.
+#define TL_STACK_PREFAULT_BYTES		(32 * 1024)
+// Fault in the top of the calling thread's stack.
+void openavbTLPrefaultStack(void);
+// With thread_mlock set, mlockall() the process and prefault the calling thread's stack.
+void openavbTLLockMemory(tl_state_t *pTLState);
+// With mem_prefault set, fault in the media queue, the rawsock buffers and the
+// calling thread's stack before the stream starts, and log the footprint.
+void openavbTLPrefault(tl_state_t *pTLState, void *rawsock, AVBStreamID_t *streamID);
+
+////////////////
+// CPU accounting (cpu_stats)
+////////////////
+// Start accounting at stream start. bOwnThread is FALSE when another thread
+// (the talker pool) does the stream's work, so only the phase split is kept.
+void openavbTLCpuStart(tl_state_t *pTLState, bool bOwnThread);
+// Call before each TX or RX call; times the phases of one call in cpu_stats.
+void openavbTLCpuTick(tl_state_t *pTLState, void *avtpHandle);
+// Add the CPU time used since the last sample to the totals.
+void openavbTLCpuSample(tl_state_t *pTLState, void *avtpHandle);
+
+// Hook the stream up to the latency trace ring, allocating it on first use
+void openavbTLLatTraceStart(tl_state_t *pTLState, void *avtpHandle);
+// Evaluate the stream's AVTP timestamps into the TL_HIST_TS_* histograms (ts_eval)
+void openavbTLTsEvalStart(tl_state_t *pTLState, void *avtpHandle);
+// Time each timed interface and mapping module call into the TL_HIST_*_CALL histograms (cpu_stats)
+void openavbTLCallTimeStart(tl_state_t *pTLState, void *avtpHandle);
+// Value of a TL_STAT_CPU_* stat. The caller holds the stats mutex.
+U64 openavbTLCpuStat(tl_state_t *pTLState, tl_stat_t stat);
+
+// How long an idle talker or listener blocks waiting for the endpoint.
+#define TL_IDLE_IPC_WAIT_MSEC		1000
+
 ////////////////
 // OSAL implementation functions
 ////////////////
 bool openavbTLThreadFnOsal(tl_state_t *pTLState);
 bool openavbTLOpenLinkLibsOsal(tl_state_t *pTLState);
 bool openavbTLCloseLinkLibsOsal(tl_state_t *pTLState);
+// CPU time and involuntary context switches of the calling thread.
+bool openavbTLThreadCpuOsal(U64 *pCpuNS, U64 *pInvolCsw);
 
 /* These were in openavb_endpoint.h, but was moved here
  * for implementations that do not have endpoint */
+// Wait up to timeout msec for endpoint messages and handle all that are queued.
 bool openavbEptClntService(int h, int timeout);
 bool openavbEptClntStopStream(int h, AVBStreamID_t *streamID);
+bool openavbEptClntSendStats(int h, AVBStreamID_t *streamID, openavb_hist_summary_t hist[TL_HIST_COUNT]);
 
 #endif  // OPENAVB_TL_H
@@ -65,6 +65,31 @@ void openavbEptClntCheckVerMatchesSrvr(int endpointHandle, U32 AVBVersion)
 	AVB_TRACE_EXIT(AVB_TRACE_TL);
 }
 
+/* ACMP callback comes from the endpoint's AVDECC entity when a controller
+ * connects or disconnects the stream. Until connected the stream waits paused.
+ */
+void openavbEptClntNotifyOfAcmpCb(int endpointHandle, AVBStreamID_t *streamID, U8 destAddr[], bool connect)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	tl_state_t *pTLState = TLHandleListGet(endpointHandle);
+
+	if (!pTLState) {
+		AVB_LOG_WARNING("Unable to get talker/listener from endpoint handle.");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+
+	AVB_LOGF_INFO("%s "STREAMID_FORMAT, connect ? "Connect" : "Disconnect", STREAMID_ARGS(streamID));
+
+	if (connect && pTLState->cfg.role == AVB_ROLE_LISTENER) {
+		openavbTLListenerSwitchStream(pTLState, streamID, destAddr);
+	}
+	openavbTLPauseStream(pTLState, !connect);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
 /* Talker Listener thread function that talks primarily with the endpoint
  */
 void* openavbTLThreadFn(void *pv)
@@ -73,6 +98,8 @@ void* openavbTLThreadFn(void *pv)
 
 	tl_state_t *pTLState = (tl_state_t *)pv;
 
+	openavbTLThreadFnOsal(pTLState);
+
 	while (pTLState->bRunning) {
 		AVB_TRACE_LINE(AVB_TRACE_TL_DETAIL);
 
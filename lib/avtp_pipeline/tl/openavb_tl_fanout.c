@@ -0,0 +1,430 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Listener fan-out implementation
+*
+* Every interface module of the stream gets a media queue of its own that
+* shares the mapping module's public info. When an item of the stream's
+* media queue comes due it is taken out of the queue and shared, without
+* copying, into the queue of each interface module with room for it. A
+* reference count per item drops as the interface modules pull it; the item
+* is given back to the stream's media queue once it reaches zero. Items are
+* given back in the order they were taken, always from the listener thread,
+* so release callbacks from interface module threads only touch the count.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "openavb_platform.h"
+#include "openavb_trace.h"
+#include "openavb_tl.h"
+#include "openavb_tl_fanout.h"
+
+#define	AVB_LOG_COMPONENT	"Listener"
+#include "openavb_log.h"
+
+// Per item interface data of the stream's media queue
+typedef struct {
+	// Interface modules holding the item, plus one while it is being shared out
+	S32 refCount;
+} fanout_item_t;
+
+typedef struct {
+	// NULL if this interface module isn't configured
+	media_q_t *pMediaQ;
+	openavb_intf_cb_t intfCB;
+	// Items missed because the media queue of the interface module was full
+	U64 dropped;
+} fanout_consumer_t;
+
+typedef struct {
+	// The listener's own interface module first, then fanout1 .. fanoutN
+	fanout_consumer_t consumer[TL_FANOUT_MAX + 1];
+
+	// Items taken from the stream's media queue, oldest first
+	media_q_item_t **ppTaken;
+	int nTakenSlots;
+	int takenFirst;
+	int nTaken;
+} fanout_info_t;
+
+static void x_fanoutRelease(void *pReleaseArg)
+{
+	fanout_item_t *pRef = (fanout_item_t *)pReleaseArg;
+	OPENAVB_ATOMIC_FETCH_ADD(&pRef->refCount, -1);
+}
+
+// Give the oldest taken items back to the stream's media queue while no
+// interface module holds them.
+static void x_fanoutGiveBack(media_q_t *pMediaQ, fanout_info_t *pInfo)
+{
+	while (pInfo->nTaken > 0) {
+		media_q_item_t *pItem = pInfo->ppTaken[pInfo->takenFirst];
+		fanout_item_t *pRef = (fanout_item_t *)pItem->pPvtIntfData;
+
+		if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&pRef->refCount) > 0) {
+			break;
+		}
+		openavbMediaQTailItemGive(pMediaQ, pItem);
+		pInfo->takenFirst = (pInfo->takenFirst + 1) % pInfo->nTakenSlots;
+		pInfo->nTaken--;
+	}
+}
+
+// Share a taken item into the media queue of every interface module
+static void x_fanoutShare(fanout_info_t *pInfo, media_q_item_t *pItem)
+{
+	fanout_item_t *pRef = (fanout_item_t *)pItem->pPvtIntfData;
+	int i;
+
+	pRef->refCount = 1;
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (!pConsumer->pMediaQ) {
+			continue;
+		}
+
+		if (!openavbMediaQHeadLockAttach(pConsumer->pMediaQ)) {
+			pConsumer->dropped++;
+			continue;
+		}
+		OPENAVB_ATOMIC_FETCH_ADD(&pRef->refCount, 1);
+		if (openavbMediaQHeadShare(pConsumer->pMediaQ, pItem, x_fanoutRelease, pRef)) {
+			openavbMediaQHeadPush(pConsumer->pMediaQ);
+		}
+		else {
+			OPENAVB_ATOMIC_FETCH_ADD(&pRef->refCount, -1);
+			openavbMediaQHeadUnlock(pConsumer->pMediaQ);
+			pConsumer->dropped++;
+		}
+	}
+	OPENAVB_ATOMIC_FETCH_ADD(&pRef->refCount, -1);
+}
+
+static void openavbTLFanoutCfgCB(media_q_t *pMediaQ, const char *name, const char *value)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	fanout_info_t *pInfo = (fanout_info_t *)pMediaQ->pPvtIntfInfo;
+	char intfName[64];
+	long idx = 0;
+
+	if (strncasecmp(name, "fanout", 6) == 0) {
+		// fanoutN_nv_<name> goes to interface module N as intf_nv_<name>
+		char *pEnd;
+		idx = strtol(name + 6, &pEnd, 10);
+		if (idx < 1 || idx > TL_FANOUT_MAX || strncasecmp(pEnd, "_nv_", 4) != 0) {
+			AVB_LOGF_ERROR("Unrecognized fan-out configuration item: name=%s", name);
+			AVB_TRACE_EXIT(AVB_TRACE_TL);
+			return;
+		}
+		snprintf(intfName, sizeof(intfName), "intf_nv_%s", pEnd + 4);
+		name = intfName;
+	}
+
+	fanout_consumer_t *pConsumer = &pInfo->consumer[idx];
+	if (!pConsumer->pMediaQ) {
+		AVB_LOGF_ERROR("No fan-out interface module %ld; ignoring %s", idx, name);
+	}
+	else if (pConsumer->intfCB.intf_cfg_cb) {
+		pConsumer->intfCB.intf_cfg_cb(pConsumer->pMediaQ, name, value);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLFanoutGenInitCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	fanout_info_t *pInfo = (fanout_info_t *)pMediaQ->pPvtIntfInfo;
+	int itemCount, itemSize;
+	int i;
+
+	if (!openavbMediaQGetSize(pMediaQ, &itemCount, &itemSize)
+		|| !openavbMediaQAllocItemIntfData(pMediaQ, sizeof(fanout_item_t))) {
+		AVB_LOG_ERROR("Fan-out unable to set up the stream's media queue");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+
+	pInfo->ppTaken = calloc(itemCount, sizeof(media_q_item_t *));
+	if (!pInfo->ppTaken) {
+		AVB_LOG_ERROR("Unable to allocate fan-out item list");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+	pInfo->nTakenSlots = itemCount;
+
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (!pConsumer->pMediaQ) {
+			continue;
+		}
+
+		// Item data is always shared in, so the items need no storage of their own
+		if (!openavbMediaQSetSize(pConsumer->pMediaQ, itemCount, 1)) {
+			AVB_LOGF_ERROR("Unable to size the media queue of fan-out interface module %d", i);
+		}
+		if (pConsumer->intfCB.intf_gen_init_cb) {
+			pConsumer->intfCB.intf_gen_init_cb(pConsumer->pMediaQ);
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLFanoutAVDECCInitCB(media_q_t *pMediaQ, U16 configIdx, U16 descriptorType, U16 descriptorIdx)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	fanout_info_t *pInfo = (fanout_info_t *)pMediaQ->pPvtIntfInfo;
+	int i;
+
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (pConsumer->pMediaQ && pConsumer->intfCB.intf_avdecc_init_cb) {
+			pConsumer->intfCB.intf_avdecc_init_cb(pConsumer->pMediaQ, configIdx, descriptorType, descriptorIdx);
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLFanoutRxInitCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	fanout_info_t *pInfo = (fanout_info_t *)pMediaQ->pPvtIntfInfo;
+	int i;
+
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (pConsumer->pMediaQ) {
+			pConsumer->dropped = 0;
+			if (pConsumer->intfCB.intf_rx_init_cb) {
+				pConsumer->intfCB.intf_rx_init_cb(pConsumer->pMediaQ);
+			}
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static bool openavbTLFanoutRxCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL_DETAIL);
+
+	fanout_info_t *pInfo = (fanout_info_t *)pMediaQ->pPvtIntfInfo;
+	media_q_item_t *pItem;
+	int i;
+
+	if (!pInfo->ppTaken) {
+		AVB_TRACE_EXIT(AVB_TRACE_TL_DETAIL);
+		return FALSE;
+	}
+
+	x_fanoutGiveBack(pMediaQ, pInfo);
+
+	// Only items that are due are shared out, so the listener keeps calling
+	// here at their presentation times just as it would a single module.
+	while (pInfo->nTaken < pInfo->nTakenSlots
+		&& (pItem = openavbMediaQTailLock(pMediaQ, FALSE)) != NULL) {
+		if (pItem->dataLen == 0) {
+			// An item given back while newer ones were queued comes round empty
+			openavbMediaQTailPull(pMediaQ);
+			continue;
+		}
+		if (!openavbMediaQTailItemTake(pMediaQ, pItem)) {
+			openavbMediaQTailUnlock(pMediaQ);
+			break;
+		}
+		pInfo->ppTaken[(pInfo->takenFirst + pInfo->nTaken) % pInfo->nTakenSlots] = pItem;
+		pInfo->nTaken++;
+		x_fanoutShare(pInfo, pItem);
+	}
+
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (pConsumer->pMediaQ && pConsumer->intfCB.intf_rx_cb) {
+			pConsumer->intfCB.intf_rx_cb(pConsumer->pMediaQ);
+		}
+	}
+
+	x_fanoutGiveBack(pMediaQ, pInfo);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL_DETAIL);
+	return TRUE;
+}
+
+static void openavbTLFanoutEndCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	fanout_info_t *pInfo = (fanout_info_t *)pMediaQ->pPvtIntfInfo;
+	int i;
+
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (!pConsumer->pMediaQ) {
+			continue;
+		}
+
+		if (pConsumer->intfCB.intf_end_cb) {
+			pConsumer->intfCB.intf_end_cb(pConsumer->pMediaQ);
+		}
+
+		// Release whatever the interface module left queued
+		while (openavbMediaQTailLock(pConsumer->pMediaQ, TRUE)) {
+			openavbMediaQTailPull(pConsumer->pMediaQ);
+		}
+
+		if (pConsumer->dropped) {
+			AVB_LOGF_INFO("Fan-out interface module %d dropped %" PRIu64 " items", i, pConsumer->dropped);
+		}
+	}
+
+	if (pInfo->ppTaken) {
+		x_fanoutGiveBack(pMediaQ, pInfo);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLFanoutGenEndCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	fanout_info_t *pInfo = (fanout_info_t *)pMediaQ->pPvtIntfInfo;
+	int i;
+
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (!pConsumer->pMediaQ) {
+			continue;
+		}
+
+		if (pConsumer->intfCB.intf_gen_end_cb) {
+			pConsumer->intfCB.intf_gen_end_cb(pConsumer->pMediaQ);
+		}
+
+		// The mapping module's data is only borrowed
+		pConsumer->pMediaQ->pMediaQDataFormat = NULL;
+		pConsumer->pMediaQ->pPubMapInfo = NULL;
+		openavbMediaQDelete(pConsumer->pMediaQ);
+		pConsumer->pMediaQ = NULL;
+	}
+
+	if (pInfo->ppTaken) {
+		free(pInfo->ppTaken);
+		pInfo->ppTaken = NULL;
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+bool openavbTLFanoutConfigured(tl_state_t *pTLState)
+{
+	int i;
+
+	for (i = 0; i < TL_FANOUT_MAX; i++) {
+		if (pTLState->fanoutLib[i].funcName) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+bool openavbTLFanoutInit(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	media_q_t *pMediaQ = pTLState->pMediaQ;
+	int i;
+
+	if (pCfg->role != AVB_ROLE_LISTENER) {
+		AVB_LOG_ERROR("Fan-out interface modules are only supported on a listener");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+	if (pCfg->mediaq_lock_free || pCfg->mediaq_ring_size) {
+		// Both modes hand items back strictly in order, which taking items breaks
+		AVB_LOG_ERROR("Fan-out can't be used with mediaq_lock_free or mediaq_ring_size");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	fanout_info_t *pInfo = calloc(1, sizeof(fanout_info_t));
+	if (!pInfo) {
+		AVB_LOG_ERROR("Unable to allocate fan-out data");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+	pMediaQ->pPvtIntfInfo = pInfo;
+
+	// The fan-out stands in for the interface module from here on, so the
+	// interface modules set up so far are cleaned up even if a later one fails.
+	memset(&pCfg->intf_cb, 0, sizeof(pCfg->intf_cb));
+	pCfg->intf_cb.intf_cfg_cb = openavbTLFanoutCfgCB;
+	pCfg->intf_cb.intf_gen_init_cb = openavbTLFanoutGenInitCB;
+	pCfg->intf_cb.intf_avdecc_init_cb = openavbTLFanoutAVDECCInitCB;
+	pCfg->intf_cb.intf_rx_init_cb = openavbTLFanoutRxInitCB;
+	pCfg->intf_cb.intf_rx_cb = openavbTLFanoutRxCB;
+	pCfg->intf_cb.intf_end_cb = openavbTLFanoutEndCB;
+	pCfg->intf_cb.intf_gen_end_cb = openavbTLFanoutGenEndCB;
+
+	for (i = 0; i <= TL_FANOUT_MAX; i++) {
+		openavb_intf_initialize_fn_t pInitFn = i == 0 ? pCfg->pIntfInitFn : pTLState->pFanoutInitFn[i - 1];
+		fanout_consumer_t *pConsumer = &pInfo->consumer[i];
+		if (!pInitFn) {
+			continue;
+		}
+
+		pConsumer->pMediaQ = openavbMediaQCreate();
+		if (!pConsumer->pMediaQ) {
+			AVB_LOG_ERROR("Unable to create fan-out media queue");
+			AVB_TRACE_EXIT(AVB_TRACE_TL);
+			return FALSE;
+		}
+		pConsumer->pMediaQ->pMediaQDataFormat = pMediaQ->pMediaQDataFormat;
+		pConsumer->pMediaQ->pPubMapInfo = pMediaQ->pPubMapInfo;
+
+		if (!pInitFn(pConsumer->pMediaQ, &pConsumer->intfCB) || !pConsumer->intfCB.intf_rx_cb) {
+			AVB_LOGF_ERROR("Fan-out interface module %d initialize function error.", i);
+			AVB_TRACE_EXIT(AVB_TRACE_TL);
+			return FALSE;
+		}
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return TRUE;
+}
@@ -127,8 +127,16 @@ bool openavbEptClntStopStream(int h, AVBStreamID_t *streamID)
 	return TRUE;
 }
 
+bool openavbEptClntSendStats(int h, AVBStreamID_t *streamID, openavb_hist_summary_t hist[TL_HIST_COUNT])
+{
+	return TRUE;
+}
+
 bool openavbEptClntService(int h, int timeout)
 {
+	// Nothing will ever arrive; keep the caller's idle pacing
+	if (timeout > 0)
+		SLEEP_MSEC(timeout);
 	return TRUE;
 }
 
@@ -40,6 +40,8 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_map_pub.h"
 #include "openavb_intf_pub.h"
 #include "openavb_avtp_time_pub.h"
+#include "openavb_histogram_pub.h"
+#include "openavb_lat_trace_pub.h"
 
 /** \file
  * Talker Listener Public Interface.
@@ -66,8 +68,53 @@ typedef enum {
 	TL_STAT_RX_LOST,
 	/// Number of bytes received
 	TL_STAT_RX_BYTES,
+	/// Number of stale media queue items purged
+	TL_STAT_MQ_PURGED,
+	/// Number of media queue items moved into presentation time order
+	TL_STAT_MQ_REORDERED,
+	/// Number of media queue items dropped as too late to be put in order
+	TL_STAT_MQ_LATE,
+	/// Number of media queue items dropped as duplicates
+	TL_STAT_MQ_DUPLICATE,
+	/// Stream thread CPU time in nanoseconds (cpu_stats, not for talker_pool or listener_pool streams)
+	TL_STAT_CPU_NS,
+	/// Involuntary context switches of the stream thread (cpu_stats, not for talker_pool or listener_pool streams)
+	TL_STAT_CPU_INVOL_CSW,
+	/// Estimated CPU time in the interface module in nanoseconds (cpu_stats)
+	TL_STAT_CPU_INTF_NS,
+	/// Estimated CPU time in the mapping module in nanoseconds (cpu_stats)
+	TL_STAT_CPU_MAP_NS,
+	/// Estimated CPU time in the rawsock in nanoseconds (cpu_stats)
+	TL_STAT_CPU_RAWSOCK_NS,
+	/// Number of TX frames sent with null content because there was no data (tx_null_on_underrun)
+	TL_STAT_TX_NULL,
+	/// Frames not sent on redundant_ifname for lack of a buffer (talker), or dropped
+	/// as already received on the other interface (listener)
+	TL_STAT_REDUNDANT,
 } tl_stat_t;
 
+/// Latency histograms kept per stream when latency_hist (or ts_eval for the timestamp ones) is set. All values are in nanoseconds.
+typedef enum {
+	/// Talker wake up lateness: time the interval started being serviced minus its scheduled start
+	TL_HIST_TX_WAKE_LATE,
+	/// Talker TX path time per frame
+	TL_HIST_TX_PATH,
+	/// Time items spend in the media queue, from head push to tail pull
+	TL_HIST_MQ_RESIDENCY,
+	/// Listener presentation margin: presentation time minus arrival time, 0 when late
+	TL_HIST_RX_MARGIN,
+	/// AVTP timestamp jitter: distance of each timestamp interval from the nominal one (ts_eval)
+	TL_HIST_TS_JITTER,
+	/// AVTP timestamp drift: distance from the nominal time since the first timestamp (ts_eval)
+	TL_HIST_TS_DRIFT,
+	/// Thread CPU time of one interface module TX or RX call (cpu_stats, timed calls only)
+	TL_HIST_INTF_CALL,
+	/// Thread CPU time of one mapping module TX or RX call (cpu_stats, timed calls only)
+	TL_HIST_MAP_CALL,
+	/// Number of histograms
+	TL_HIST_COUNT
+} tl_hist_t;
+
 /// Maximum number of configuration parameters inside INI file a host can have
 #define MAX_LIB_CFG_ITEMS 64
 
@@ -75,6 +122,12 @@ typedef enum {
 /// Maximum size of interface name
 #define IFNAMSIZE 16
 
+/// Maximum size of shared source name
+#define SHARED_SOURCE_NAMESIZE 32
+
+/// Maximum size of a pcap capture file name
+#define PCAP_FILE_NAMESIZE 256
+
 /// Indicatates that VLAN ID is not set in configuration
 #define VLAN_NULL UINT16_MAX
 
@@ -121,20 +174,99 @@ typedef struct {
 	U32 raw_tx_buffers;
 	/// Number of raw rx buffers (listener only)
 	U32 raw_rx_buffers;
+	/// Class intervals after which a partly filled RX block is handed over,
+	/// 0 to receive frame by frame (listener only)
+	U32 rx_block_intervals;
+	/// Spin up to this many usec waiting for each frame before blocking, with
+	/// kernel busy polling where the rawsock supports it; 0 to block (listener only)
+	U32 rx_busy_poll_usec;
+	/// Percentile in per mille of the presentation margin the media queue depth
+	/// and stale tail are sized to; 0 keeps them fixed (listener only)
+	U32 rx_adapt_permille;
+	/// Added to the presentation margin percentile (listener only)
+	U32 rx_adapt_margin_usec;
 	/// Is the interface module blocking in the TX CB.
 	bool tx_blocking_in_intf;
 	/// Network interface name. Not used on all platforms.
 	char ifname[IFNAMSIZE];
+	/// Second interface the stream is sent on, or received from with duplicates
+	/// dropped by AVTP sequence number; empty for none
+	char redundant_ifname[IFNAMSIZE];
+	/// Destination MAC address on redundant_ifname; dest_addr when not set
+	cfg_mac_t redundant_dest_addr;
+	/// gPTP domain the stream's clock follows, one of those the gptp of the
+	/// interface publishes; -1 for the domain gptp disciplines its clock to
+	S32 gptp_domain;
 	/// VLAN ID
 	U16 vlan_id;
 	/// When set incoming packets will trigger a signal to the stream task to wakeup.
 	bool rx_signal_mode;
 	/// Enable fixed timestamping in interface
 	U32 fixed_timestamp;
+	/// With launch time and fixed timestamps, how far ahead of the wire in usec
+	/// frames are queued to the NIC; 0 wakes once per interval (talker only)
+	U32 launch_lookahead_usec;
+	/// Adapt the batches of batch_factor intervals sent per wake-up between 1 and
+	/// this many to the host load and the media available ahead; 0 is off (talker only)
+	U32 batch_adapt_max;
+	/// With fixed_timestamp and no launch time, spin for this many usec before
+	/// each interval and sleep before that (talker only)
+	U32 spin_guard_usec;
+	/// Resample the interface data to the nominal (1) or recovered media clock (2)
+	/// rate before mapping, 0 for no conversion (talker only)
+	U32 asrc;
+	/// Interface data buffered ahead of the sample rate converter (talker only)
+	U32 asrc_buffer_usec;
+	/// Send a frame of null content (silence, NULL packets) for each frame
+	/// the interface module has no data for (talker only)
+	bool tx_null_on_underrun;
+	/// Frames to time from capture to the wire before the presentation offset
+	/// is lowered from max_transit_usec; 0 is off (talker only)
+	U32 transit_calibrate;
+	/// Added to the longest capture to wire time seen (talker only)
+	U32 transit_margin_usec;
 	/// Bit mask used for CPU pinning
 	U32 thread_affinity;
 	/// Real time priority of thread.
 	U32 thread_rt_priority;
+	/// Use SCHED_FIFO instead of SCHED_RR for the real time priority
+	bool thread_rt_fifo;
+	/// Lock the process memory (mlockall) and prefault the stream thread stack
+	bool thread_mlock;
+	/// Fault in the media queue, rawsock buffers and stack when the stream starts
+	bool mem_prefault;
+	/// Use the lock-free single producer / single consumer media queue mode
+	bool mediaq_lock_free;
+	/// Allocate the media queue items from one locked, huge page backed arena
+	bool mediaq_arena;
+	/// Size in bytes of the media queue byte ring for variable size items (0 = off)
+	U32 mediaq_ring_size;
+	/// Keep the media queue in presentation time order (listener only)
+	bool mediaq_ordered;
+	/// With mediaq_ordered, drop items this many microseconds past their presentation time (0 = no limit)
+	U32 mediaq_max_late_usec;
+	/// With mediaq_ordered, drop items repeating a presentation time
+	bool mediaq_drop_duplicates;
+	/// Stream from a shared talker pool thread instead of a thread per stream (talker only)
+	bool talker_pool;
+	/// Receive on a shared listener pool thread instead of a thread per stream (listener only)
+	bool listener_pool;
+	/// Name of a shared source feeding this and other talkers; empty for none (talker only)
+	char shared_source[SHARED_SOURCE_NAMESIZE];
+	/// Keep per stream latency histograms (see tl_hist_t)
+	bool latency_hist;
+	/// Evaluate the AVTP timestamp of every frame against the stream rate (see TL_HIST_TS_JITTER)
+	bool ts_eval;
+	/// Account the stream's CPU time, timing the intf/map/rawsock phases on one call in this many (0 = off)
+	U32 cpu_stats;
+	/// Trace one AVTP frame in this many end to end, a power of two up to 256 (0 = off)
+	U32 latency_trace;
+	/// Capture file the listener replays instead of the network, or the talker records to; empty for none
+	char pcap_file[PCAP_FILE_NAMESIZE];
+	/// Replay speed in percent of the captured rate (0 = as fast as possible)
+	U32 pcap_replay_speed;
+	/// Number of times to replay the capture file (0 = endless)
+	U32 pcap_replay_loops;
 
 	/// Initialization function in mapper
 	openavb_map_initialize_fn_t pMapInitFn;
@@ -237,7 +369,11 @@ bool openavbTLStop(tl_handle_t handle);
 
 /** Pause or resume as stream.
  *
- * A paused stream will do everything except will toss both tx and rx packets
+ * A paused stream will do everything except will toss both tx and rx packets.
+ * It is a warm standby: the media queue, rawsock or igb queue, mapping and
+ * interface state and the SRP declarations are all kept, so a resumed stream
+ * is back within one interval. Media that comes due while paused is dropped.
+ * A stream paused before it starts streaming starts out paused.
  *
  * \param handle The handle return from openavbTLOpen()
  * \param bPause TRUE to pause, FALSE to resume
@@ -245,6 +381,13 @@ bool openavbTLStop(tl_handle_t handle);
  */
 void openavbTLPauseStream(tl_handle_t handle, bool bPause);
 
+/** Check if a stream is paused.
+ *
+ * \param handle The handle return from openavbTLOpen()
+ * \return TRUE if paused with openavbTLPauseStream()
+ */
+bool openavbTLIsStreamPaused(tl_handle_t handle);
+
 /** Close the talker or listener.
  *
  * The talker or listener indicated by handle that was previously loaded with
@@ -330,6 +473,42 @@ avb_role_t openavbTLGetRole(tl_handle_t handle);
  */
 U64 openavbTLStat(tl_handle_t handle, tl_stat_t stat);
 
+/** Copy one of the latency histograms of a running stream.
+ *
+ * Histograms are only recorded when latency_hist is set in the configuration.
+ * Recording is lock-free; the copy may be taken from any thread.
+ *
+ * \param handle The handle return from openavbTLOpen()
+ * \param hist Which histogram to retrieve
+ * \param pHist Receives a snapshot of the histogram
+ * \return TRUE on success otherwise FALSE
+ */
+bool openavbTLHistogram(tl_handle_t handle, tl_hist_t hist, openavb_hist_t *pHist);
+
+/** Copy the media queue occupancy instrumentation of a stream.
+ *
+ * Only recorded when latency_hist is set in the configuration. Only one thread
+ * should restart the water marks.
+ *
+ * \param handle The handle return from openavbTLOpen()
+ * \param pInstr Receives a snapshot of the instrumentation
+ * \param bRestartMarks Start a new high and low water mark period
+ * \return TRUE on success otherwise FALSE
+ */
+bool openavbTLMediaQInstr(tl_handle_t handle, media_q_instr_t *pInstr, bool bRestartMarks);
+
+/** Take the latency trace samples a stream has recorded since the last call.
+ *
+ * Samples are only recorded when latency_trace is set in the configuration.
+ * Only one thread may read a stream's samples.
+ *
+ * \param handle The handle return from openavbTLOpen()
+ * \param pSamples Receives the samples, oldest first
+ * \param max Room in pSamples
+ * \return Number of samples copied
+ */
+U32 openavbTLLatencyTrace(tl_handle_t handle, openavb_lat_sample_t *pSamples, U32 max);
+
 /** Read an ini file. 
  *
  * Parses an input configuration file tp populate configuration structures, and
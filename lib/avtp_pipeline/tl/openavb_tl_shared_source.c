@@ -0,0 +1,586 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Shared source implementation
+*
+* Talker streams with the same shared_source name form a group. The interface
+* module of the first stream to join fills a media queue owned by the group,
+* and each item pushed there is taken out of it and shared, without copying,
+* into the media queue of every streaming talker of the group. A reference
+* count per item drops as the talkers' mapping modules pull it; the item is
+* given back to the source once it reaches zero. An item is only shared once
+* every streaming talker has room for it, so the slowest talker holds the
+* source back just as a full media queue holds back a single stream.
+*
+* Whichever talker comes first in a round of transmit intervals drives the
+* source's TX callback for that round, so the interface module is called as
+* often as it would be for a single stream however many talkers share it.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "openavb_platform.h"
+#include "openavb_trace.h"
+#include "openavb_tl.h"
+#include "openavb_tl_shared_source.h"
+
+#define	AVB_LOG_COMPONENT	"Talker"
+#include "openavb_log.h"
+
+typedef struct {
+	media_q_item_t *pItem;
+	// Talkers holding the item, plus one while it is being shared out
+	S32 refCount;
+} shared_item_t;
+
+struct shared_source_group;
+
+// Interface private data of each talker's media queue
+typedef struct {
+	struct shared_source_group *pGroup;
+	media_q_t *pMediaQ;
+	// Number of items the talker's media queue holds
+	int itemCount;
+	// True for the talker whose interface module is the source
+	bool bOwner;
+	bool bStarted;
+	// Source TX generation seen on the last TX callback
+	U32 txGen;
+} shared_member_t;
+
+typedef struct shared_source_group {
+	char name[SHARED_SOURCE_NAMESIZE];
+
+	// Media queue filled by the source interface module
+	media_q_t *pMediaQ;
+	openavb_intf_cb_t intfCB;
+	// Talker media queue whose mapping module data the source borrows
+	media_q_t *pMapMediaQ;
+
+	shared_member_t *pMembers[SHARED_SOURCE_MAX_STREAMS];
+	U32 nMembers;
+	U32 nStarted;
+
+	// Bumped each time the source's TX callback is called
+	U32 txGen;
+
+	// Items taken from the source media queue, oldest first
+	shared_item_t *pTaken;
+	int nTakenSlots;
+	int takenFirst;
+	int nTaken;
+
+	MUTEX_HANDLE(lock);
+	struct shared_source_group *pNext;
+} shared_source_group_t;
+
+static shared_source_group_t *gSharedSourceGroups = NULL;
+MUTEX_HANDLE(gSharedSourceMutex);
+
+#define SHARED_LOCK() { MUTEX_CREATE_ERR(); MUTEX_LOCK(gSharedSourceMutex); MUTEX_LOG_ERR("Mutex lock failure"); }
+#define SHARED_UNLOCK() { MUTEX_CREATE_ERR(); MUTEX_UNLOCK(gSharedSourceMutex); MUTEX_LOG_ERR("Mutex unlock failure"); }
+#define GROUP_LOCK(g) { MUTEX_CREATE_ERR(); MUTEX_LOCK((g)->lock); MUTEX_LOG_ERR("Mutex lock failure"); }
+#define GROUP_UNLOCK(g) { MUTEX_CREATE_ERR(); MUTEX_UNLOCK((g)->lock); MUTEX_LOG_ERR("Mutex unlock failure"); }
+
+static void x_sharedRelease(void *pReleaseArg)
+{
+	shared_item_t *pShared = (shared_item_t *)pReleaseArg;
+	OPENAVB_ATOMIC_FETCH_ADD(&pShared->refCount, -1);
+}
+
+// Give the oldest taken items back to the source while no talker holds them.
+// Called with the group locked.
+static void x_sharedGiveBack(shared_source_group_t *pGroup)
+{
+	while (pGroup->nTaken > 0) {
+		shared_item_t *pShared = &pGroup->pTaken[pGroup->takenFirst];
+
+		if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&pShared->refCount) > 0) {
+			break;
+		}
+		openavbMediaQTailItemGive(pGroup->pMediaQ, pShared->pItem);
+		pShared->pItem = NULL;
+		pGroup->takenFirst = (pGroup->takenFirst + 1) % pGroup->nTakenSlots;
+		pGroup->nTaken--;
+	}
+}
+
+// True if every streaming talker has room for another item. Only the group
+// pushes to the talkers' media queues, so room found here doesn't go away.
+static bool x_sharedHaveRoom(shared_source_group_t *pGroup)
+{
+	U32 i;
+
+	for (i = 0; i < pGroup->nMembers; i++) {
+		shared_member_t *pMember = pGroup->pMembers[i];
+		if (pMember->bStarted
+			&& openavbMediaQCountItems(pMember->pMediaQ, TRUE) >= (U32)pMember->itemCount) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// Share the items pushed to the source with every streaming talker.
+// Called with the group locked.
+static void x_sharedShare(shared_source_group_t *pGroup)
+{
+	media_q_item_t *pItem;
+	U32 i;
+
+	while (pGroup->nTaken < pGroup->nTakenSlots
+		&& (pItem = openavbMediaQTailLock(pGroup->pMediaQ, TRUE)) != NULL) {
+		if (pItem->dataLen == 0) {
+			// An item given back while newer ones were queued comes round empty
+			openavbMediaQTailPull(pGroup->pMediaQ);
+			continue;
+		}
+		if (!x_sharedHaveRoom(pGroup) || !openavbMediaQTailItemTake(pGroup->pMediaQ, pItem)) {
+			openavbMediaQTailUnlock(pGroup->pMediaQ);
+			break;
+		}
+
+		shared_item_t *pShared = &pGroup->pTaken[(pGroup->takenFirst + pGroup->nTaken) % pGroup->nTakenSlots];
+		pGroup->nTaken++;
+		pShared->pItem = pItem;
+		pShared->refCount = 1;
+
+		for (i = 0; i < pGroup->nMembers; i++) {
+			shared_member_t *pMember = pGroup->pMembers[i];
+			if (!pMember->bStarted || !openavbMediaQHeadLockAttach(pMember->pMediaQ)) {
+				continue;
+			}
+			OPENAVB_ATOMIC_FETCH_ADD(&pShared->refCount, 1);
+			if (openavbMediaQHeadShare(pMember->pMediaQ, pItem, x_sharedRelease, pShared)) {
+				openavbMediaQHeadPush(pMember->pMediaQ);
+			}
+			else {
+				OPENAVB_ATOMIC_FETCH_ADD(&pShared->refCount, -1);
+				openavbMediaQHeadUnlock(pMember->pMediaQ);
+			}
+		}
+		OPENAVB_ATOMIC_FETCH_ADD(&pShared->refCount, -1);
+	}
+}
+
+static void x_sharedGroupDelete(shared_source_group_t *pGroup)
+{
+	if (pGroup->pMediaQ) {
+		// The mapping module's data is only borrowed
+		pGroup->pMediaQ->pMediaQDataFormat = NULL;
+		pGroup->pMediaQ->pPubMapInfo = NULL;
+		openavbMediaQDelete(pGroup->pMediaQ);
+	}
+	if (pGroup->pTaken) {
+		free(pGroup->pTaken);
+	}
+
+	MUTEX_CREATE_ERR();
+	MUTEX_DESTROY(pGroup->lock);
+	MUTEX_LOG_ERR("Error destroying mutex");
+
+	free(pGroup);
+}
+
+static void openavbTLSharedSourceCfgCB(media_q_t *pMediaQ, const char *name, const char *value)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	shared_member_t *pMember = (shared_member_t *)pMediaQ->pPvtIntfInfo;
+	shared_source_group_t *pGroup = pMember->pGroup;
+
+	if (!pMember->bOwner) {
+		AVB_LOGF_WARNING("Shared source %s is configured by its first stream; ignoring %s", pGroup->name, name);
+	}
+	else if (pGroup->intfCB.intf_cfg_cb) {
+		pGroup->intfCB.intf_cfg_cb(pGroup->pMediaQ, name, value);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLSharedSourceGenInitCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	shared_member_t *pMember = (shared_member_t *)pMediaQ->pPvtIntfInfo;
+	shared_source_group_t *pGroup = pMember->pGroup;
+	int itemCount, itemSize;
+
+	if (!openavbMediaQGetSize(pMediaQ, &itemCount, &itemSize)) {
+		AVB_LOGF_ERROR("Shared source %s: talker media queue not sized", pGroup->name);
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return;
+	}
+
+	GROUP_LOCK(pGroup);
+	pMember->itemCount = itemCount;
+
+	if (pMember->bOwner) {
+		// The source is sized like the first stream's media queue, with room
+		// for the public map data the interface module fills in per item.
+		int itemPubMapSize = openavbMediaQGetItemPubMapSize(pMediaQ);
+		if (!openavbMediaQSetSize(pGroup->pMediaQ, itemCount, itemSize)
+			|| (itemPubMapSize && !openavbMediaQAllocItemMapData(pGroup->pMediaQ, itemPubMapSize, 0))) {
+			AVB_LOGF_ERROR("Unable to size the media queue of shared source %s", pGroup->name);
+		}
+		else if (!(pGroup->pTaken = calloc(itemCount, sizeof(shared_item_t)))) {
+			AVB_LOG_ERROR("Unable to allocate shared source item list");
+		}
+		else {
+			pGroup->nTakenSlots = itemCount;
+			if (pGroup->intfCB.intf_gen_init_cb) {
+				pGroup->intfCB.intf_gen_init_cb(pGroup->pMediaQ);
+			}
+		}
+	}
+	else if (openavbMediaQGetItemPubMapSize(pMediaQ) != openavbMediaQGetItemPubMapSize(pGroup->pMediaQ)) {
+		AVB_LOGF_ERROR("Shared source %s: mapping module differs from the first stream's", pGroup->name);
+	}
+
+	GROUP_UNLOCK(pGroup);
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLSharedSourceAVDECCInitCB(media_q_t *pMediaQ, U16 configIdx, U16 descriptorType, U16 descriptorIdx)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	shared_member_t *pMember = (shared_member_t *)pMediaQ->pPvtIntfInfo;
+	shared_source_group_t *pGroup = pMember->pGroup;
+
+	if (pMember->bOwner && pGroup->intfCB.intf_avdecc_init_cb) {
+		pGroup->intfCB.intf_avdecc_init_cb(pGroup->pMediaQ, configIdx, descriptorType, descriptorIdx);
+	}
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLSharedSourceTxInitCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	shared_member_t *pMember = (shared_member_t *)pMediaQ->pPvtIntfInfo;
+	shared_source_group_t *pGroup = pMember->pGroup;
+
+	GROUP_LOCK(pGroup);
+	if (!pMember->bStarted) {
+		pMember->bStarted = TRUE;
+		pMember->txGen = pGroup->txGen;
+		// The source runs while any talker of the group streams
+		if (pGroup->nStarted++ == 0 && pGroup->intfCB.intf_tx_init_cb) {
+			pGroup->intfCB.intf_tx_init_cb(pGroup->pMediaQ);
+		}
+	}
+	GROUP_UNLOCK(pGroup);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static bool openavbTLSharedSourceTxCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL_DETAIL);
+
+	shared_member_t *pMember = (shared_member_t *)pMediaQ->pPvtIntfInfo;
+	shared_source_group_t *pGroup = pMember->pGroup;
+	bool bRet = TRUE;
+
+	GROUP_LOCK(pGroup);
+	if (pGroup->pTaken && pMember->bStarted) {
+		x_sharedGiveBack(pGroup);
+
+		// Drive the source unless another talker already did since this
+		// one last came round
+		if (pMember->txGen == pGroup->txGen) {
+			bRet = pGroup->intfCB.intf_tx_cb(pGroup->pMediaQ);
+			pGroup->txGen++;
+		}
+		pMember->txGen = pGroup->txGen;
+
+		x_sharedShare(pGroup);
+	}
+	GROUP_UNLOCK(pGroup);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL_DETAIL);
+	return bRet;
+}
+
+static void openavbTLSharedSourceEndCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	shared_member_t *pMember = (shared_member_t *)pMediaQ->pPvtIntfInfo;
+	shared_source_group_t *pGroup = pMember->pGroup;
+
+	GROUP_LOCK(pGroup);
+	if (pMember->bStarted) {
+		pMember->bStarted = FALSE;
+
+		// Release whatever the mapping module left queued
+		while (openavbMediaQTailLock(pMediaQ, TRUE)) {
+			openavbMediaQTailPull(pMediaQ);
+		}
+
+		if (--pGroup->nStarted == 0) {
+			if (pGroup->intfCB.intf_end_cb) {
+				pGroup->intfCB.intf_end_cb(pGroup->pMediaQ);
+			}
+			// Don't start the next run with stale items
+			while (openavbMediaQTailLock(pGroup->pMediaQ, TRUE)) {
+				openavbMediaQTailPull(pGroup->pMediaQ);
+			}
+		}
+
+		if (pGroup->pTaken) {
+			x_sharedGiveBack(pGroup);
+		}
+	}
+	GROUP_UNLOCK(pGroup);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+static void openavbTLSharedSourceGenEndCB(media_q_t *pMediaQ)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	shared_member_t *pMember = (shared_member_t *)pMediaQ->pPvtIntfInfo;
+	shared_source_group_t *pGroup = pMember->pGroup;
+	bool bLast;
+	U32 i;
+
+	SHARED_LOCK();
+	GROUP_LOCK(pGroup);
+
+	for (i = 0; i < pGroup->nMembers; i++) {
+		if (pGroup->pMembers[i] == pMember) {
+			pGroup->pMembers[i] = pGroup->pMembers[--pGroup->nMembers];
+			break;
+		}
+	}
+
+	bLast = pGroup->nMembers == 0;
+	if (!bLast && pGroup->pMapMediaQ == pMediaQ) {
+		// This talker's mapping module data is about to go; the others
+		// use the same mapping so borrow theirs instead.
+		pGroup->pMapMediaQ = pGroup->pMembers[0]->pMediaQ;
+		pGroup->pMediaQ->pMediaQDataFormat = pGroup->pMapMediaQ->pMediaQDataFormat;
+		pGroup->pMediaQ->pPubMapInfo = pGroup->pMapMediaQ->pPubMapInfo;
+	}
+
+	GROUP_UNLOCK(pGroup);
+
+	if (bLast) {
+		shared_source_group_t **ppGroup = &gSharedSourceGroups;
+		while (*ppGroup && *ppGroup != pGroup) {
+			ppGroup = &(*ppGroup)->pNext;
+		}
+		if (*ppGroup) {
+			*ppGroup = pGroup->pNext;
+		}
+	}
+
+	SHARED_UNLOCK();
+
+	if (bLast) {
+		if (pGroup->pTaken && pGroup->intfCB.intf_gen_end_cb) {
+			pGroup->intfCB.intf_gen_end_cb(pGroup->pMediaQ);
+		}
+		x_sharedGroupDelete(pGroup);
+	}
+
+	pMediaQ->pPvtIntfInfo = NULL;
+	free(pMember);
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+bool openavbTLSharedSourceInitialize(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	gSharedSourceGroups = NULL;
+
+	MUTEX_ATTR_HANDLE(mta);
+	MUTEX_ATTR_INIT(mta);
+	MUTEX_ATTR_SET_TYPE(mta, MUTEX_ATTR_TYPE_DEFAULT);
+	MUTEX_ATTR_SET_NAME(mta, "gSharedSourceMutex");
+	MUTEX_CREATE_ERR();
+	MUTEX_CREATE(gSharedSourceMutex, mta);
+	MUTEX_LOG_ERR("Error creating mutex");
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return !MUTEX_IS_ERR;
+}
+
+void openavbTLSharedSourceCleanup(void)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	// Groups go away with their last stream; anything left here was not closed
+	SHARED_LOCK();
+	while (gSharedSourceGroups) {
+		shared_source_group_t *pGroup = gSharedSourceGroups;
+		gSharedSourceGroups = pGroup->pNext;
+		AVB_LOGF_WARNING("Shared source %s still has %u streams", pGroup->name, pGroup->nMembers);
+		x_sharedGroupDelete(pGroup);
+	}
+	SHARED_UNLOCK();
+
+	MUTEX_CREATE_ERR();
+	MUTEX_DESTROY(gSharedSourceMutex);
+	MUTEX_LOG_ERR("Error destroying mutex");
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+}
+
+bool openavbTLSharedSourceInit(tl_state_t *pTLState)
+{
+	AVB_TRACE_ENTRY(AVB_TRACE_TL);
+
+	openavb_tl_cfg_t *pCfg = &pTLState->cfg;
+	media_q_t *pMediaQ = pTLState->pMediaQ;
+	shared_source_group_t *pGroup;
+
+	if (pCfg->role != AVB_ROLE_TALKER) {
+		AVB_LOG_ERROR("A shared source can only feed talkers");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+	if (pCfg->mediaq_lock_free || pCfg->mediaq_ring_size || pCfg->asrc) {
+		// The talker's media queue is filled from another thread with items
+		// of the source's own format
+		AVB_LOG_ERROR("A shared source can't be used with mediaq_lock_free, mediaq_ring_size or asrc");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+
+	shared_member_t *pMember = calloc(1, sizeof(shared_member_t));
+	if (!pMember) {
+		AVB_LOG_ERROR("Unable to allocate shared source data");
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+	pMember->pMediaQ = pMediaQ;
+
+	SHARED_LOCK();
+
+	for (pGroup = gSharedSourceGroups; pGroup; pGroup = pGroup->pNext) {
+		if (strncmp(pGroup->name, pCfg->shared_source, SHARED_SOURCE_NAMESIZE) == 0) {
+			break;
+		}
+	}
+
+	if (!pGroup) {
+		pGroup = calloc(1, sizeof(shared_source_group_t));
+		if (!pGroup) {
+			SHARED_UNLOCK();
+			free(pMember);
+			AVB_LOG_ERROR("Unable to allocate shared source data");
+			AVB_TRACE_EXIT(AVB_TRACE_TL);
+			return FALSE;
+		}
+		snprintf(pGroup->name, sizeof(pGroup->name), "%s", pCfg->shared_source);
+
+		MUTEX_ATTR_HANDLE(mta);
+		MUTEX_ATTR_INIT(mta);
+		MUTEX_ATTR_SET_TYPE(mta, MUTEX_ATTR_TYPE_DEFAULT);
+		MUTEX_ATTR_SET_NAME(mta, "sharedSourceMutex");
+		MUTEX_CREATE_ERR();
+		MUTEX_CREATE(pGroup->lock, mta);
+		MUTEX_LOG_ERR("Error creating mutex");
+
+		// The source media queue carries items in the format of this
+		// talker's mapping module
+		pGroup->pMediaQ = openavbMediaQCreate();
+		if (pGroup->pMediaQ) {
+			pGroup->pMapMediaQ = pMediaQ;
+			pGroup->pMediaQ->pMediaQDataFormat = pMediaQ->pMediaQDataFormat;
+			pGroup->pMediaQ->pPubMapInfo = pMediaQ->pPubMapInfo;
+		}
+
+		if (MUTEX_IS_ERR || !pGroup->pMediaQ || !pCfg->pIntfInitFn
+			|| !pCfg->pIntfInitFn(pGroup->pMediaQ, &pGroup->intfCB) || !pGroup->intfCB.intf_tx_cb) {
+			SHARED_UNLOCK();
+			x_sharedGroupDelete(pGroup);
+			free(pMember);
+			AVB_LOGF_ERROR("Shared source %s interface initialize function error.", pCfg->shared_source);
+			AVB_TRACE_EXIT(AVB_TRACE_TL);
+			return FALSE;
+		}
+
+		pMember->bOwner = TRUE;
+		pGroup->pNext = gSharedSourceGroups;
+		gSharedSourceGroups = pGroup;
+	}
+	else if (pGroup->nMembers >= SHARED_SOURCE_MAX_STREAMS) {
+		SHARED_UNLOCK();
+		free(pMember);
+		AVB_LOGF_ERROR("Shared source %s already feeds %u streams", pCfg->shared_source, SHARED_SOURCE_MAX_STREAMS);
+		AVB_TRACE_EXIT(AVB_TRACE_TL);
+		return FALSE;
+	}
+	else {
+		// This talker's own interface settings are ignored, so take the
+		// format the source's interface module put in the first stream's
+		// public map data
+		int pubMapInfoSize = openavbMediaQGetPubMapInfoSize(pMediaQ);
+		if (pubMapInfoSize && pubMapInfoSize == openavbMediaQGetPubMapInfoSize(pGroup->pMapMediaQ)) {
+			memcpy(pMediaQ->pPubMapInfo, pGroup->pMapMediaQ->pPubMapInfo, pubMapInfoSize);
+		}
+	}
+
+	GROUP_LOCK(pGroup);
+	pMember->pGroup = pGroup;
+	pGroup->pMembers[pGroup->nMembers++] = pMember;
+	GROUP_UNLOCK(pGroup);
+
+	SHARED_UNLOCK();
+
+	pMediaQ->pPvtIntfInfo = pMember;
+	openavbMediaQThreadSafeOn(pMediaQ);
+
+	// Items arrive with the source's data attached, so the interface can't
+	// write payloads straight into the frame.
+	pCfg->map_cb.map_tx_payload_cb = NULL;
+
+	memset(&pCfg->intf_cb, 0, sizeof(pCfg->intf_cb));
+	pCfg->intf_cb.intf_cfg_cb = openavbTLSharedSourceCfgCB;
+	pCfg->intf_cb.intf_gen_init_cb = openavbTLSharedSourceGenInitCB;
+	pCfg->intf_cb.intf_avdecc_init_cb = openavbTLSharedSourceAVDECCInitCB;
+	pCfg->intf_cb.intf_tx_init_cb = openavbTLSharedSourceTxInitCB;
+	pCfg->intf_cb.intf_tx_cb = openavbTLSharedSourceTxCB;
+	pCfg->intf_cb.intf_end_cb = openavbTLSharedSourceEndCB;
+	pCfg->intf_cb.intf_gen_end_cb = openavbTLSharedSourceGenEndCB;
+
+	AVB_TRACE_EXIT(AVB_TRACE_TL);
+	return TRUE;
+}
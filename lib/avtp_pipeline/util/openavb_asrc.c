@@ -0,0 +1,444 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Polyphase asynchronous sample rate converter
+*
+* A windowed sinc filter is tabulated at ASRC_PHASES fractional positions and
+* linearly interpolated between neighbouring phases, so any ratio can be
+* followed without recomputing coefficients. Input is kept per channel so that
+* each output sample is one contiguous dot product, which is what the SIMD
+* kernels speed up.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "openavb_platform.h"
+#include "openavb_types.h"
+#include "openavb_asrc.h"
+
+#define	AVB_LOG_COMPONENT	"ASRC"
+#include "openavb_log.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ASRC_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__ARM_ARCH)
+#define ASRC_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Filter length; the SIMD kernels rely on this being a multiple of 8
+#define ASRC_TAPS		32
+#define ASRC_HALF		(ASRC_TAPS / 2)
+// Tabulated fractional positions, a power of 2
+#define ASRC_PHASE_BITS	7
+#define ASRC_PHASES		(1 << ASRC_PHASE_BITS)
+
+// Cutoff as a fraction of the input rate and Kaiser window shape
+#define ASRC_CUTOFF		0.45
+#define ASRC_KAISER_BETA	8.0
+
+typedef void (*asrc_coefs_fn_t)(float *pCoefs, const float *pH0, const float *pH1, float frac);
+typedef float (*asrc_dot_fn_t)(const float *pIn, const float *pCoefs);
+
+typedef struct {
+	const char *name;
+	asrc_coefs_fn_t coefs;
+	asrc_dot_fn_t dot;
+} asrc_kernels_t;
+
+struct openavb_asrc {
+	const asrc_kernels_t *pKernels;
+	U32 channels;
+
+	// (ASRC_PHASES + 1) rows of ASRC_TAPS coefficients
+	float *pTable;
+
+	// Planar input, capacity frames per channel
+	float *pFifo;
+	U32 capacity;
+	U32 fifoLen;
+
+	// Fifo index and Q32 fraction of the next output frame
+	U32 posIdx;
+	U32 posFrac;
+	// Input frames per output frame in Q32
+	U64 stepQ32;
+
+	// Input frames dropped from the front of the fifo since the reset
+	U64 dropped;
+};
+
+/////////////
+// Scalar
+/////////////
+
+static void x_coefs(float *pCoefs, const float *pH0, const float *pH1, float frac)
+{
+	int t;
+	for (t = 0; t < ASRC_TAPS; t++) {
+		pCoefs[t] = pH0[t] + frac * (pH1[t] - pH0[t]);
+	}
+}
+
+static float x_dot(const float *pIn, const float *pCoefs)
+{
+	float acc = 0.0f;
+	int t;
+	for (t = 0; t < ASRC_TAPS; t++) {
+		acc += pIn[t] * pCoefs[t];
+	}
+	return acc;
+}
+
+static const asrc_kernels_t x_scalarKernels = {
+	"scalar", x_coefs, x_dot,
+};
+
+#if ASRC_X86
+
+/////////////
+// SSE2
+/////////////
+
+__attribute__((target("sse2")))
+static void x_coefsSse2(float *pCoefs, const float *pH0, const float *pH1, float frac)
+{
+	__m128 f = _mm_set1_ps(frac);
+	int t;
+	for (t = 0; t < ASRC_TAPS; t += 4) {
+		__m128 h0 = _mm_loadu_ps(pH0 + t);
+		__m128 h1 = _mm_loadu_ps(pH1 + t);
+		_mm_storeu_ps(pCoefs + t, _mm_add_ps(h0, _mm_mul_ps(f, _mm_sub_ps(h1, h0))));
+	}
+}
+
+__attribute__((target("sse2")))
+static float x_dotSse2(const float *pIn, const float *pCoefs)
+{
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	int t;
+	for (t = 0; t < ASRC_TAPS; t += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(pIn + t), _mm_loadu_ps(pCoefs + t)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(pIn + t + 4), _mm_loadu_ps(pCoefs + t + 4)));
+	}
+	acc0 = _mm_add_ps(acc0, acc1);
+	acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+	acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+	return _mm_cvtss_f32(acc0);
+}
+
+static const asrc_kernels_t x_sse2Kernels = {
+	"SSE2", x_coefsSse2, x_dotSse2,
+};
+
+/////////////
+// AVX2 + FMA
+/////////////
+
+__attribute__((target("avx2,fma")))
+static void x_coefsAvx2(float *pCoefs, const float *pH0, const float *pH1, float frac)
+{
+	__m256 f = _mm256_set1_ps(frac);
+	int t;
+	for (t = 0; t < ASRC_TAPS; t += 8) {
+		__m256 h0 = _mm256_loadu_ps(pH0 + t);
+		__m256 h1 = _mm256_loadu_ps(pH1 + t);
+		_mm256_storeu_ps(pCoefs + t, _mm256_fmadd_ps(f, _mm256_sub_ps(h1, h0), h0));
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static float x_dotAvx2(const float *pIn, const float *pCoefs)
+{
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	int t;
+	for (t = 0; t < ASRC_TAPS; t += 16) {
+		acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(pIn + t), _mm256_loadu_ps(pCoefs + t), acc0);
+		acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(pIn + t + 8), _mm256_loadu_ps(pCoefs + t + 8), acc1);
+	}
+	acc0 = _mm256_add_ps(acc0, acc1);
+	__m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+	return _mm_cvtss_f32(acc);
+}
+
+static const asrc_kernels_t x_avx2Kernels = {
+	"AVX2", x_coefsAvx2, x_dotAvx2,
+};
+
+#endif // ASRC_X86
+
+#if ASRC_NEON
+
+/////////////
+// NEON
+/////////////
+
+static void x_coefsNeon(float *pCoefs, const float *pH0, const float *pH1, float frac)
+{
+	float32x4_t f = vdupq_n_f32(frac);
+	int t;
+	for (t = 0; t < ASRC_TAPS; t += 4) {
+		float32x4_t h0 = vld1q_f32(pH0 + t);
+		float32x4_t h1 = vld1q_f32(pH1 + t);
+		vst1q_f32(pCoefs + t, vmlaq_f32(h0, f, vsubq_f32(h1, h0)));
+	}
+}
+
+static float x_dotNeon(const float *pIn, const float *pCoefs)
+{
+	float32x4_t acc0 = vdupq_n_f32(0.0f);
+	float32x4_t acc1 = vdupq_n_f32(0.0f);
+	int t;
+	for (t = 0; t < ASRC_TAPS; t += 8) {
+		acc0 = vmlaq_f32(acc0, vld1q_f32(pIn + t), vld1q_f32(pCoefs + t));
+		acc1 = vmlaq_f32(acc1, vld1q_f32(pIn + t + 4), vld1q_f32(pCoefs + t + 4));
+	}
+	acc0 = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__)
+	return vaddvq_f32(acc0);
+#else
+	float32x2_t sum = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+	return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#endif
+}
+
+static const asrc_kernels_t x_neonKernels = {
+	"NEON", x_coefsNeon, x_dotNeon,
+};
+
+#endif // ASRC_NEON
+
+static const asrc_kernels_t *x_asrcKernels(void)
+{
+	const asrc_kernels_t *pKernels = &x_scalarKernels;
+#if ASRC_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		pKernels = &x_avx2Kernels;
+	}
+	else if (__builtin_cpu_supports("sse2")) {
+		pKernels = &x_sse2Kernels;
+	}
+#elif ASRC_NEON
+	pKernels = &x_neonKernels;
+#endif
+	return pKernels;
+}
+
+// Zeroth order modified Bessel function of the first kind
+static double x_besselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+	for (k = 1; k < 50; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12) {
+			break;
+		}
+	}
+	return sum;
+}
+
+// Row r holds the taps for an output at fraction r / ASRC_PHASES past the
+// centre frame, with tap t weighting input frame (centre - (ASRC_HALF - 1) + t).
+static void x_buildTable(float *pTable)
+{
+	double i0Beta = x_besselI0(ASRC_KAISER_BETA);
+	int r, t;
+
+	for (r = 0; r <= ASRC_PHASES; r++) {
+		double h[ASRC_TAPS];
+		double sum = 0.0;
+		double frac = (double)r / ASRC_PHASES;
+
+		for (t = 0; t < ASRC_TAPS; t++) {
+			double x = (double)t - (ASRC_HALF - 1) - frac;
+			double arg = 2.0 * ASRC_CUTOFF * x;
+			double sinc = (arg == 0.0) ? 1.0 : sin(M_PI * arg) / (M_PI * arg);
+			double w = x / ASRC_HALF;
+			w = (w * w < 1.0) ? x_besselI0(ASRC_KAISER_BETA * sqrt(1.0 - w * w)) / i0Beta : 0.0;
+			h[t] = sinc * w;
+			sum += h[t];
+		}
+
+		// Unity gain at DC for every phase
+		for (t = 0; t < ASRC_TAPS; t++) {
+			pTable[r * ASRC_TAPS + t] = (float)(h[t] / sum);
+		}
+	}
+}
+
+openavb_asrc_t openavbAsrcNew(U32 channels, U32 capacityFrames)
+{
+	if (!channels || !capacityFrames) {
+		AVB_LOG_ERROR("Invalid ASRC size");
+		return NULL;
+	}
+
+	openavb_asrc_t asrc = calloc(1, sizeof(struct openavb_asrc));
+	if (!asrc) {
+		return NULL;
+	}
+
+	asrc->channels = channels;
+	asrc->capacity = capacityFrames + ASRC_TAPS;
+	asrc->pTable = malloc((ASRC_PHASES + 1) * ASRC_TAPS * sizeof(float));
+	asrc->pFifo = malloc((size_t)asrc->capacity * channels * sizeof(float));
+	if (!asrc->pTable || !asrc->pFifo) {
+		openavbAsrcDelete(asrc);
+		return NULL;
+	}
+
+	x_buildTable(asrc->pTable);
+	asrc->pKernels = x_asrcKernels();
+	AVB_LOGF_INFO("Using %s ASRC kernels", asrc->pKernels->name);
+
+	openavbAsrcSetRatio(asrc, 1.0);
+	openavbAsrcReset(asrc);
+	return asrc;
+}
+
+void openavbAsrcDelete(openavb_asrc_t asrc)
+{
+	if (asrc) {
+		free(asrc->pTable);
+		free(asrc->pFifo);
+		free(asrc);
+	}
+}
+
+void openavbAsrcReset(openavb_asrc_t asrc)
+{
+	// Silent history so the first frames can be interpolated
+	memset(asrc->pFifo, 0, (size_t)asrc->capacity * asrc->channels * sizeof(float));
+	asrc->fifoLen = ASRC_HALF - 1;
+	asrc->posIdx = ASRC_HALF - 1;
+	asrc->posFrac = 0;
+	asrc->dropped = 0;
+}
+
+void openavbAsrcSetRatio(openavb_asrc_t asrc, double ratio)
+{
+	asrc->stepQ32 = (U64)(ratio * 4294967296.0 + 0.5);
+}
+
+U32 openavbAsrcWrite(openavb_asrc_t asrc, const float *pIn, U32 frames)
+{
+	U32 ch, i;
+
+	if (asrc->fifoLen + frames > asrc->capacity) {
+		// Drop the frames that have left the filter history
+		U32 drop = asrc->posIdx - (ASRC_HALF - 1);
+		if (drop) {
+			for (ch = 0; ch < asrc->channels; ch++) {
+				float *pCh = asrc->pFifo + (size_t)ch * asrc->capacity;
+				memmove(pCh, pCh + drop, (asrc->fifoLen - drop) * sizeof(float));
+			}
+			asrc->fifoLen -= drop;
+			asrc->posIdx -= drop;
+			asrc->dropped += drop;
+		}
+	}
+
+	if (asrc->fifoLen + frames > asrc->capacity) {
+		frames = asrc->capacity - asrc->fifoLen;
+	}
+
+	for (ch = 0; ch < asrc->channels; ch++) {
+		float *pDst = asrc->pFifo + (size_t)ch * asrc->capacity + asrc->fifoLen;
+		const float *pSrc = pIn + ch;
+		for (i = 0; i < frames; i++) {
+			pDst[i] = *pSrc;
+			pSrc += asrc->channels;
+		}
+	}
+	asrc->fifoLen += frames;
+	return frames;
+}
+
+U32 openavbAsrcAvailable(openavb_asrc_t asrc)
+{
+	// The last output needs ASRC_HALF frames after its centre frame
+	if (asrc->fifoLen <= asrc->posIdx + ASRC_HALF || !asrc->stepQ32) {
+		return 0;
+	}
+	U64 pos = ((U64)asrc->posIdx << 32) | asrc->posFrac;
+	U64 end = (U64)(asrc->fifoLen - ASRC_HALF) << 32;
+	return (U32)((end - 1 - pos) / asrc->stepQ32) + 1;
+}
+
+U32 openavbAsrcRead(openavb_asrc_t asrc, float *pOut, U32 frames)
+{
+	const asrc_kernels_t *pKernels = asrc->pKernels;
+	float coefs[ASRC_TAPS];
+	U32 available = openavbAsrcAvailable(asrc);
+	U32 i, ch;
+
+	if (frames > available) {
+		frames = available;
+	}
+
+	U64 pos = ((U64)asrc->posIdx << 32) | asrc->posFrac;
+	for (i = 0; i < frames; i++) {
+		U32 idx = (U32)(pos >> 32);
+		U32 frac = (U32)pos;
+		U32 row = frac >> (32 - ASRC_PHASE_BITS);
+		float rowFrac = (float)((frac << ASRC_PHASE_BITS) >> 8) * (1.0f / 16777216.0f);
+		const float *pH0 = asrc->pTable + row * ASRC_TAPS;
+
+		pKernels->coefs(coefs, pH0, pH0 + ASRC_TAPS, rowFrac);
+		for (ch = 0; ch < asrc->channels; ch++) {
+			const float *pIn = asrc->pFifo + (size_t)ch * asrc->capacity + idx - (ASRC_HALF - 1);
+			*pOut++ = pKernels->dot(pIn, coefs);
+		}
+		pos += asrc->stepQ32;
+	}
+	asrc->posIdx = (U32)(pos >> 32);
+	asrc->posFrac = (U32)pos;
+	return frames;
+}
+
+double openavbAsrcFill(openavb_asrc_t asrc)
+{
+	return (double)asrc->fifoLen - asrc->posIdx - asrc->posFrac / 4294967296.0;
+}
+
+double openavbAsrcPosition(openavb_asrc_t asrc)
+{
+	return (double)asrc->dropped + asrc->posIdx - (ASRC_HALF - 1) + asrc->posFrac / 4294967296.0;
+}
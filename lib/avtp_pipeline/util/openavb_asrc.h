@@ -0,0 +1,78 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Header for the polyphase asynchronous sample rate converter.
+*
+* The converter is meant for clock drift correction: ratios within a few
+* hundred ppm of 1.0, such as a sound card crystal against gPTP. It is not a
+* general purpose rate converter.
+*/
+
+#ifndef OPENAVB_ASRC_H
+#define OPENAVB_ASRC_H 1
+
+#include "openavb_types.h"
+
+typedef struct openavb_asrc * openavb_asrc_t;
+
+// Create a converter for channels channels that can hold capacityFrames
+// input frames that haven't been consumed yet.
+openavb_asrc_t openavbAsrcNew(U32 channels, U32 capacityFrames);
+
+// Delete a converter.
+void openavbAsrcDelete(openavb_asrc_t asrc);
+
+// Drop all buffered input and restart the filter history.
+void openavbAsrcReset(openavb_asrc_t asrc);
+
+// Set the number of input frames consumed per output frame.
+void openavbAsrcSetRatio(openavb_asrc_t asrc, double ratio);
+
+// Append interleaved float input frames. Returns the number of frames that
+// fit, less than frames when the converter overflows.
+U32 openavbAsrcWrite(openavb_asrc_t asrc, const float *pIn, U32 frames);
+
+// Number of output frames that can be produced from the buffered input at the
+// current ratio.
+U32 openavbAsrcAvailable(openavb_asrc_t asrc);
+
+// Produce up to frames interleaved float output frames. Returns the number of
+// frames produced.
+U32 openavbAsrcRead(openavb_asrc_t asrc, float *pOut, U32 frames);
+
+// Buffered input frames ahead of the next output frame.
+double openavbAsrcFill(openavb_asrc_t asrc);
+
+// Input frame position, counted from the first frame written after the last
+// reset, that the next output frame will be interpolated at.
+double openavbAsrcPosition(openavb_asrc_t asrc);
+
+#endif // OPENAVB_ASRC_H
@@ -0,0 +1,788 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Audio sample format conversion kernels
+*
+* Scalar kernels work on bytes and are correct on any host. The SIMD
+* versions assume a little endian host, which holds for every x86 and for
+* the ARM configurations we build NEON for.
+*/
+
+#include <string.h>
+#include "openavb_platform.h"
+#include "openavb_types.h"
+#include "openavb_audio_conv_pub.h"
+
+#define	AVB_LOG_COMPONENT	"Audio Conv"
+#include "openavb_log.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AUDIO_CONV_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__ARM_ARCH) && !defined(__ARMEB__)
+#define AUDIO_CONV_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef void (*audio_conv_fn_t)(void *pDst, const void *pSrc, U32 count);
+typedef void (*audio_conv_label_fn_t)(void *pDst, const void *pSrc, U32 count, U32 label);
+typedef void (*audio_mix_fn_t)(float *pAcc, const float *pSrc, float gain, U32 count);
+
+typedef struct {
+	const char *name;
+	audio_conv_fn_t swap16;
+	audio_conv_fn_t swap24;
+	audio_conv_fn_t swap32;
+	audio_conv_label_fn_t int16ToAM824;
+	audio_conv_label_fn_t int24ToAM824;
+	audio_conv_fn_t am824ToInt16;
+	audio_conv_fn_t am824ToInt24;
+	audio_mix_fn_t mixF32;
+} audio_conv_kernels_t;
+
+static const audio_conv_kernels_t *gAudioConv = NULL;
+
+/////////////
+// Scalar
+/////////////
+
+static void x_swap16(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i;
+	for (i = 0; i < count; i++, s += 2, d += 2) {
+		U8 b0 = s[0];
+		d[0] = s[1];
+		d[1] = b0;
+	}
+}
+
+static void x_swap24(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i;
+	for (i = 0; i < count; i++, s += 3, d += 3) {
+		U8 b0 = s[0];
+		d[1] = s[1];
+		d[0] = s[2];
+		d[2] = b0;
+	}
+}
+
+static void x_swap32(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i;
+	for (i = 0; i < count; i++, s += 4, d += 4) {
+		U8 b0 = s[0], b1 = s[1];
+		d[0] = s[3];
+		d[1] = s[2];
+		d[2] = b1;
+		d[3] = b0;
+	}
+}
+
+static void x_int16ToAM824(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i;
+	for (i = 0; i < count; i++, s += 2, d += 4) {
+		S16 sample;
+		memcpy(&sample, s, sizeof(sample));
+		d[0] = label >> 24;
+		d[1] = (U16)sample >> 8;
+		d[2] = (U16)sample & 0xff;
+		d[3] = 0;
+	}
+}
+
+static void x_int24ToAM824(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i;
+	for (i = 0; i < count; i++, s += 3, d += 4) {
+		d[0] = label >> 24;
+		d[1] = s[2];
+		d[2] = s[1];
+		d[3] = s[0];
+	}
+}
+
+static void x_am824ToInt16(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i;
+	for (i = 0; i < count; i++, s += 4, d += 2) {
+		S16 sample = (S16)((s[1] << 8) | s[2]);
+		memcpy(d, &sample, sizeof(sample));
+	}
+}
+
+static void x_am824ToInt24(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i;
+	for (i = 0; i < count; i++, s += 4, d += 3) {
+		d[0] = s[3];
+		d[1] = s[2];
+		d[2] = s[1];
+	}
+}
+
+static void x_mixF32(float *pAcc, const float *pSrc, float gain, U32 count)
+{
+	U32 i;
+	for (i = 0; i < count; i++) {
+		pAcc[i] += pSrc[i] * gain;
+	}
+}
+
+static const audio_conv_kernels_t x_scalarKernels = {
+	"scalar",
+	x_swap16, x_swap24, x_swap32,
+	x_int16ToAM824, x_int24ToAM824,
+	x_am824ToInt16, x_am824ToInt24,
+	x_mixF32,
+};
+
+#if AUDIO_CONV_X86
+
+/////////////
+// SSE2
+/////////////
+
+__attribute__((target("sse2")))
+static void x_swap16Sse2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 8 <= count; i += 8, s += 16, d += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)s);
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i *)d, v);
+	}
+	x_swap16(d, s, count - i);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i x_bswap32Sse2(__m128i v)
+{
+	// swap the 16 bit halves, then the bytes within them
+	v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+__attribute__((target("sse2")))
+static void x_swap32Sse2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 4 <= count; i += 4, s += 16, d += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)s);
+		_mm_storeu_si128((__m128i *)d, x_bswap32Sse2(v));
+	}
+	x_swap32(d, s, count - i);
+}
+
+__attribute__((target("sse2")))
+static void x_int16ToAM824Sse2(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lbl = _mm_set1_epi32(label >> 24);
+	for (; i + 8 <= count; i += 8, s += 16, d += 32) {
+		__m128i v = _mm_loadu_si128((const __m128i *)s);
+		// network order sample in bits 23..8 of a little endian quadlet
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		__m128i lo = _mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(v, zero), 8), lbl);
+		__m128i hi = _mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(v, zero), 8), lbl);
+		_mm_storeu_si128((__m128i *)d, lo);
+		_mm_storeu_si128((__m128i *)(d + 16), hi);
+	}
+	x_int16ToAM824(d, s, count - i, label);
+}
+
+__attribute__((target("sse2")))
+static void x_am824ToInt16Sse2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 8 <= count; i += 8, s += 32, d += 16) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)s);
+		__m128i hi = _mm_loadu_si128((const __m128i *)(s + 16));
+		// bytes 1 and 2 of each quadlet, sign extended so the pack doesn't saturate
+		lo = _mm_srai_epi32(_mm_slli_epi32(_mm_srli_epi32(lo, 8), 16), 16);
+		hi = _mm_srai_epi32(_mm_slli_epi32(_mm_srli_epi32(hi, 8), 16), 16);
+		__m128i v = _mm_packs_epi32(lo, hi);
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i *)d, v);
+	}
+	x_am824ToInt16(d, s, count - i);
+}
+
+__attribute__((target("sse2")))
+static void x_mixF32Sse2(float *pAcc, const float *pSrc, float gain, U32 count)
+{
+	__m128 g = _mm_set1_ps(gain);
+	U32 i;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(pSrc + i), g);
+		_mm_storeu_ps(pAcc + i, _mm_add_ps(_mm_loadu_ps(pAcc + i), v));
+	}
+	x_mixF32(pAcc + i, pSrc + i, gain, count - i);
+}
+
+static const audio_conv_kernels_t x_sse2Kernels = {
+	"SSE2",
+	x_swap16Sse2, x_swap24, x_swap32Sse2,
+	x_int16ToAM824Sse2, x_int24ToAM824,
+	x_am824ToInt16Sse2, x_am824ToInt24,
+	x_mixF32Sse2,
+};
+
+/////////////
+// AVX2
+/////////////
+
+__attribute__((target("avx2")))
+static void x_swap16Avx2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m256i mask = _mm256_setr_epi8(
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	for (; i + 16 <= count; i += 16, s += 32, d += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)s);
+		_mm256_storeu_si256((__m256i *)d, _mm256_shuffle_epi8(v, mask));
+	}
+	x_swap16Sse2(d, s, count - i);
+}
+
+__attribute__((target("avx2")))
+static void x_swap32Avx2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m256i mask = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for (; i + 8 <= count; i += 8, s += 32, d += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)s);
+		_mm256_storeu_si256((__m256i *)d, _mm256_shuffle_epi8(v, mask));
+	}
+	x_swap32Sse2(d, s, count - i);
+}
+
+// Store the low 12 bytes of v
+__attribute__((target("avx2")))
+static inline void x_store12(U8 *d, __m128i v)
+{
+	U32 last = (U32)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+	_mm_storel_epi64((__m128i *)d, v);
+	memcpy(d + 8, &last, sizeof(last));
+}
+
+// The 24 bit kernels read 16 bytes for every 12 they use, so the loops stop
+// while at least 6 samples remain to stay inside the source buffer.
+__attribute__((target("avx2")))
+static void x_swap24Avx2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, -1, -1, -1, -1);
+	for (; i + 6 <= count; i += 4, s += 12, d += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i *)s);
+		x_store12(d, _mm_shuffle_epi8(v, mask));
+	}
+	x_swap24(d, s, count - i);
+}
+
+__attribute__((target("avx2")))
+static void x_int16ToAM824Avx2(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m256i mask = _mm256_setr_epi8(
+		-1, 1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1,
+		-1, 1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1);
+	const __m256i lbl = _mm256_set1_epi32(label >> 24);
+	for (; i + 8 <= count; i += 8, s += 16, d += 32) {
+		__m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)s));
+		v = _mm256_or_si256(_mm256_shuffle_epi8(v, mask), lbl);
+		_mm256_storeu_si256((__m256i *)d, v);
+	}
+	x_int16ToAM824Sse2(d, s, count - i, label);
+}
+
+__attribute__((target("avx2")))
+static void x_int24ToAM824Avx2(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m128i mask = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+	const __m128i lbl = _mm_set1_epi32(label >> 24);
+	for (; i + 6 <= count; i += 4, s += 12, d += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)s);
+		_mm_storeu_si128((__m128i *)d, _mm_or_si128(_mm_shuffle_epi8(v, mask), lbl));
+	}
+	x_int24ToAM824(d, s, count - i, label);
+}
+
+__attribute__((target("avx2")))
+static void x_am824ToInt16Avx2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m256i mask = _mm256_setr_epi8(
+		2, 1, 6, 5, 10, 9, 14, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+		2, 1, 6, 5, 10, 9, 14, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+	for (; i + 8 <= count; i += 8, s += 32, d += 16) {
+		__m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)s), mask);
+		// gather the low 8 bytes of each 128 bit lane
+		v = _mm256_permute4x64_epi64(v, 0x08);
+		_mm_storeu_si128((__m128i *)d, _mm256_castsi256_si128(v));
+	}
+	x_am824ToInt16Sse2(d, s, count - i);
+}
+
+__attribute__((target("avx2")))
+static void x_am824ToInt24Avx2(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, -1, -1, -1, -1);
+	for (; i + 4 <= count; i += 4, s += 16, d += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i *)s);
+		x_store12(d, _mm_shuffle_epi8(v, mask));
+	}
+	x_am824ToInt24(d, s, count - i);
+}
+
+__attribute__((target("avx2")))
+static void x_mixF32Avx2(float *pAcc, const float *pSrc, float gain, U32 count)
+{
+	__m256 g = _mm256_set1_ps(gain);
+	U32 i;
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		__m256 v = _mm256_mul_ps(_mm256_loadu_ps(pSrc + i), g);
+		_mm256_storeu_ps(pAcc + i, _mm256_add_ps(_mm256_loadu_ps(pAcc + i), v));
+	}
+	x_mixF32(pAcc + i, pSrc + i, gain, count - i);
+}
+
+static const audio_conv_kernels_t x_avx2Kernels = {
+	"AVX2",
+	x_swap16Avx2, x_swap24Avx2, x_swap32Avx2,
+	x_int16ToAM824Avx2, x_int24ToAM824Avx2,
+	x_am824ToInt16Avx2, x_am824ToInt24Avx2,
+	x_mixF32Avx2,
+};
+
+#endif // AUDIO_CONV_X86
+
+#if AUDIO_CONV_NEON
+
+/////////////
+// NEON
+/////////////
+
+static void x_swap16Neon(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 8 <= count; i += 8, s += 16, d += 16) {
+		vst1q_u8(d, vrev16q_u8(vld1q_u8(s)));
+	}
+	x_swap16(d, s, count - i);
+}
+
+static void x_swap24Neon(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 16 <= count; i += 16, s += 48, d += 48) {
+		uint8x16x3_t v = vld3q_u8(s);
+		uint8x16_t b0 = v.val[0];
+		v.val[0] = v.val[2];
+		v.val[2] = b0;
+		vst3q_u8(d, v);
+	}
+	x_swap24(d, s, count - i);
+}
+
+static void x_swap32Neon(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 4 <= count; i += 4, s += 16, d += 16) {
+		vst1q_u8(d, vrev32q_u8(vld1q_u8(s)));
+	}
+	x_swap32(d, s, count - i);
+}
+
+static void x_int16ToAM824Neon(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const uint32x4_t lbl = vdupq_n_u32(label >> 24);
+	for (; i + 8 <= count; i += 8, s += 16, d += 32) {
+		uint16x8_t v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(s)));
+		uint32x4_t lo = vorrq_u32(vshlq_n_u32(vmovl_u16(vget_low_u16(v)), 8), lbl);
+		uint32x4_t hi = vorrq_u32(vshlq_n_u32(vmovl_u16(vget_high_u16(v)), 8), lbl);
+		vst1q_u8(d, vreinterpretq_u8_u32(lo));
+		vst1q_u8(d + 16, vreinterpretq_u8_u32(hi));
+	}
+	x_int16ToAM824(d, s, count - i, label);
+}
+
+static void x_int24ToAM824Neon(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	const uint8x16_t lbl = vdupq_n_u8(label >> 24);
+	for (; i + 16 <= count; i += 16, s += 48, d += 64) {
+		uint8x16x3_t v = vld3q_u8(s);
+		uint8x16x4_t q;
+		q.val[0] = lbl;
+		q.val[1] = v.val[2];
+		q.val[2] = v.val[1];
+		q.val[3] = v.val[0];
+		vst4q_u8(d, q);
+	}
+	x_int24ToAM824(d, s, count - i, label);
+}
+
+static void x_am824ToInt16Neon(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 8 <= count; i += 8, s += 32, d += 16) {
+		uint32x4_t lo = vshrq_n_u32(vreinterpretq_u32_u8(vld1q_u8(s)), 8);
+		uint32x4_t hi = vshrq_n_u32(vreinterpretq_u32_u8(vld1q_u8(s + 16)), 8);
+		uint16x8_t v = vcombine_u16(vmovn_u32(lo), vmovn_u32(hi));
+		vst1q_u8(d, vrev16q_u8(vreinterpretq_u8_u16(v)));
+	}
+	x_am824ToInt16(d, s, count - i);
+}
+
+static void x_am824ToInt24Neon(void *pDst, const void *pSrc, U32 count)
+{
+	const U8 *s = pSrc;
+	U8 *d = pDst;
+	U32 i = 0;
+	for (; i + 16 <= count; i += 16, s += 64, d += 48) {
+		uint8x16x4_t q = vld4q_u8(s);
+		uint8x16x3_t v;
+		v.val[0] = q.val[3];
+		v.val[1] = q.val[2];
+		v.val[2] = q.val[1];
+		vst3q_u8(d, v);
+	}
+	x_am824ToInt24(d, s, count - i);
+}
+
+static void x_mixF32Neon(float *pAcc, const float *pSrc, float gain, U32 count)
+{
+	U32 i;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		vst1q_f32(pAcc + i, vmlaq_n_f32(vld1q_f32(pAcc + i), vld1q_f32(pSrc + i), gain));
+	}
+	x_mixF32(pAcc + i, pSrc + i, gain, count - i);
+}
+
+static const audio_conv_kernels_t x_neonKernels = {
+	"NEON",
+	x_swap16Neon, x_swap24Neon, x_swap32Neon,
+	x_int16ToAM824Neon, x_int24ToAM824Neon,
+	x_am824ToInt16Neon, x_am824ToInt24Neon,
+	x_mixF32Neon,
+};
+
+#endif // AUDIO_CONV_NEON
+
+// Pick the kernels for this CPU. Racing callers all pick the same table.
+static const audio_conv_kernels_t *x_audioConvKernels(void)
+{
+	const audio_conv_kernels_t *pKernels = gAudioConv;
+
+	if (!pKernels) {
+		pKernels = &x_scalarKernels;
+#if AUDIO_CONV_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			pKernels = &x_avx2Kernels;
+		}
+		else if (__builtin_cpu_supports("sse2")) {
+			pKernels = &x_sse2Kernels;
+		}
+#elif AUDIO_CONV_NEON
+		pKernels = &x_neonKernels;
+#endif
+		AVB_LOGF_INFO("Using %s audio conversion kernels", pKernels->name);
+		gAudioConv = pKernels;
+	}
+	return pKernels;
+}
+
+void openavbAudioConvSwap16(void *pDst, const void *pSrc, U32 count)
+{
+	x_audioConvKernels()->swap16(pDst, pSrc, count);
+}
+
+void openavbAudioConvSwap24(void *pDst, const void *pSrc, U32 count)
+{
+	x_audioConvKernels()->swap24(pDst, pSrc, count);
+}
+
+void openavbAudioConvSwap32(void *pDst, const void *pSrc, U32 count)
+{
+	x_audioConvKernels()->swap32(pDst, pSrc, count);
+}
+
+void openavbAudioConvInt16ToAM824(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	x_audioConvKernels()->int16ToAM824(pDst, pSrc, count, label);
+}
+
+void openavbAudioConvInt24ToAM824(void *pDst, const void *pSrc, U32 count, U32 label)
+{
+	x_audioConvKernels()->int24ToAM824(pDst, pSrc, count, label);
+}
+
+void openavbAudioConvAM824ToInt16(void *pDst, const void *pSrc, U32 count)
+{
+	x_audioConvKernels()->am824ToInt16(pDst, pSrc, count);
+}
+
+void openavbAudioConvAM824ToInt24(void *pDst, const void *pSrc, U32 count)
+{
+	x_audioConvKernels()->am824ToInt24(pDst, pSrc, count);
+}
+
+void openavbAudioMixF32(float *pAcc, const float *pSrc, float gain, U32 count)
+{
+	x_audioConvKernels()->mixF32(pAcc, pSrc, gain, count);
+}
+
+/////////////
+// Format conversions
+/////////////
+
+// Samples are loaded into a left justified S32 and stored from one, so each
+// pair of formats below is its own loop with the formats known at compile
+// time.
+
+#define CONV_LOAD_S16LE(s)	((S32)((U32)(s)[1] << 24 | (U32)(s)[0] << 16))
+#define CONV_LOAD_S16BE(s)	((S32)((U32)(s)[0] << 24 | (U32)(s)[1] << 16))
+#define CONV_LOAD_S24LE(s)	((S32)((U32)(s)[2] << 24 | (U32)(s)[1] << 16 | (U32)(s)[0] << 8))
+#define CONV_LOAD_S24BE(s)	((S32)((U32)(s)[0] << 24 | (U32)(s)[1] << 16 | (U32)(s)[2] << 8))
+#define CONV_LOAD_S32LE(s)	((S32)((U32)(s)[3] << 24 | (U32)(s)[2] << 16 | (U32)(s)[1] << 8 | (U32)(s)[0]))
+#define CONV_LOAD_S32BE(s)	((S32)((U32)(s)[0] << 24 | (U32)(s)[1] << 16 | (U32)(s)[2] << 8 | (U32)(s)[3]))
+#define CONV_LOAD_F32LE(s)	x_floatToS32((U32)CONV_LOAD_S32LE(s))
+#define CONV_LOAD_F32BE(s)	x_floatToS32((U32)CONV_LOAD_S32BE(s))
+
+#define CONV_STORE_S16LE(d, v)	((d)[0] = (U32)(v) >> 16, (d)[1] = (U32)(v) >> 24)
+#define CONV_STORE_S16BE(d, v)	((d)[0] = (U32)(v) >> 24, (d)[1] = (U32)(v) >> 16)
+#define CONV_STORE_S24LE(d, v)	((d)[0] = (U32)(v) >> 8, (d)[1] = (U32)(v) >> 16, (d)[2] = (U32)(v) >> 24)
+#define CONV_STORE_S24BE(d, v)	((d)[0] = (U32)(v) >> 24, (d)[1] = (U32)(v) >> 16, (d)[2] = (U32)(v) >> 8)
+#define CONV_STORE_S32LE(d, v)	((d)[0] = (U32)(v), (d)[1] = (U32)(v) >> 8, (d)[2] = (U32)(v) >> 16, (d)[3] = (U32)(v) >> 24)
+#define CONV_STORE_S32BE(d, v)	((d)[0] = (U32)(v) >> 24, (d)[1] = (U32)(v) >> 16, (d)[2] = (U32)(v) >> 8, (d)[3] = (U32)(v))
+#define CONV_STORE_F32LE(d, v)	do { U32 f = x_s32ToFloat(v); CONV_STORE_S32LE(d, f); } while (0)
+#define CONV_STORE_F32BE(d, v)	do { U32 f = x_s32ToFloat(v); CONV_STORE_S32BE(d, f); } while (0)
+
+#define CONV_SIZE_S16	2
+#define CONV_SIZE_S24	3
+#define CONV_SIZE_S32	4
+#define CONV_SIZE_F32	4
+
+static inline S32 x_floatToS32(U32 bits)
+{
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	f *= 2147483648.0f;
+	if (f >= 2147483647.0f)
+		return 0x7fffffff;
+	if (f <= -2147483648.0f)
+		return (S32)0x80000000;
+	return (S32)f;
+}
+
+static inline U32 x_s32ToFloat(S32 v)
+{
+	float f = (float)v * (1.0f / 2147483648.0f);
+	U32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+#define CONV_KERNEL(SRC, SRCE, DST, DSTE) \
+static void x_conv##SRC##SRCE##To##DST##DSTE(void *pDst, const void *pSrc, U32 count) \
+{ \
+	const U8 *s = pSrc; \
+	U8 *d = pDst; \
+	U32 i; \
+	for (i = 0; i < count; i++, s += CONV_SIZE_##SRC, d += CONV_SIZE_##DST) { \
+		S32 v = CONV_LOAD_##SRC##SRCE(s); \
+		CONV_STORE_##DST##DSTE(d, v); \
+	} \
+}
+
+#define CONV_KERNELS_FROM(SRC, SRCE) \
+	CONV_KERNEL(SRC, SRCE, S16, LE) CONV_KERNEL(SRC, SRCE, S16, BE) \
+	CONV_KERNEL(SRC, SRCE, S24, LE) CONV_KERNEL(SRC, SRCE, S24, BE) \
+	CONV_KERNEL(SRC, SRCE, S32, LE) CONV_KERNEL(SRC, SRCE, S32, BE) \
+	CONV_KERNEL(SRC, SRCE, F32, LE) CONV_KERNEL(SRC, SRCE, F32, BE)
+
+CONV_KERNELS_FROM(S16, LE) CONV_KERNELS_FROM(S16, BE)
+CONV_KERNELS_FROM(S24, LE) CONV_KERNELS_FROM(S24, BE)
+CONV_KERNELS_FROM(S32, LE) CONV_KERNELS_FROM(S32, BE)
+CONV_KERNELS_FROM(F32, LE) CONV_KERNELS_FROM(F32, BE)
+
+#define CONV_ROW(SRC, SRCE) { \
+	x_conv##SRC##SRCE##ToS16LE, x_conv##SRC##SRCE##ToS16BE, \
+	x_conv##SRC##SRCE##ToS24LE, x_conv##SRC##SRCE##ToS24BE, \
+	x_conv##SRC##SRCE##ToS32LE, x_conv##SRC##SRCE##ToS32BE, \
+	x_conv##SRC##SRCE##ToF32LE, x_conv##SRC##SRCE##ToF32BE }
+
+// Indexed by format * 2 + big endian, formats ordered as in x_convFormat()
+static const openavb_audio_conv_fn_t x_convKernels[8][8] = {
+	CONV_ROW(S16, LE), CONV_ROW(S16, BE),
+	CONV_ROW(S24, LE), CONV_ROW(S24, BE),
+	CONV_ROW(S32, LE), CONV_ROW(S32, BE),
+	CONV_ROW(F32, LE), CONV_ROW(F32, BE),
+};
+
+static void x_copy16(void *pDst, const void *pSrc, U32 count)
+{
+	memcpy(pDst, pSrc, count * 2);
+}
+
+static void x_copy24(void *pDst, const void *pSrc, U32 count)
+{
+	memcpy(pDst, pSrc, count * 3);
+}
+
+static void x_copy32(void *pDst, const void *pSrc, U32 count)
+{
+	memcpy(pDst, pSrc, count * 4);
+}
+
+// Index of the format in x_convKernels, or -1 if not supported
+static int x_convFormat(avb_audio_type_t type, avb_audio_bit_depth_t bitDepth, avb_audio_endian_t endian)
+{
+	int format;
+
+	if (type == AVB_AUDIO_TYPE_FLOAT) {
+		if (bitDepth != AVB_AUDIO_BIT_DEPTH_32BIT)
+			return -1;
+		format = 3;
+	}
+	else if (type == AVB_AUDIO_TYPE_INT || type == AVB_AUDIO_TYPE_UNSPEC) {
+		switch (bitDepth) {
+			case AVB_AUDIO_BIT_DEPTH_16BIT:
+				format = 0;
+				break;
+			case AVB_AUDIO_BIT_DEPTH_24BIT:
+				format = 1;
+				break;
+			case AVB_AUDIO_BIT_DEPTH_32BIT:
+				format = 2;
+				break;
+			default:
+				return -1;
+		}
+	}
+	else {
+		return -1;
+	}
+
+	if (endian == AVB_AUDIO_ENDIAN_UNSPEC) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		endian = AVB_AUDIO_ENDIAN_BIG;
+#else
+		endian = AVB_AUDIO_ENDIAN_LITTLE;
+#endif
+	}
+	return format * 2 + (endian == AVB_AUDIO_ENDIAN_BIG ? 1 : 0);
+}
+
+openavb_audio_conv_fn_t openavbAudioConvSelect(avb_audio_type_t srcType, avb_audio_bit_depth_t srcBitDepth, avb_audio_endian_t srcEndian,
+	avb_audio_type_t dstType, avb_audio_bit_depth_t dstBitDepth, avb_audio_endian_t dstEndian)
+{
+	int src = x_convFormat(srcType, srcBitDepth, srcEndian);
+	int dst = x_convFormat(dstType, dstBitDepth, dstEndian);
+
+	if (src < 0 || dst < 0) {
+		return NULL;
+	}
+
+	if (src / 2 == dst / 2) {
+		const audio_conv_kernels_t *pKernels = x_audioConvKernels();
+		switch (src / 2) {
+			case 0:
+				return src == dst ? x_copy16 : pKernels->swap16;
+			case 1:
+				return src == dst ? x_copy24 : pKernels->swap24;
+			default:
+				return src == dst ? x_copy32 : pKernels->swap32;
+		}
+	}
+	return x_convKernels[src][dst];
+}
@@ -0,0 +1,124 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Log-linear latency histograms
+*/
+
+#include <string.h>
+#include "openavb_platform.h"
+#include "openavb_types.h"
+#include "openavb_histogram_pub.h"
+
+// Largest value that lands in a bucket
+static U32 x_bucketUpper(U32 idx)
+{
+	if (idx < OPENAVB_HIST_SUB_COUNT) {
+		return idx;
+	}
+	U32 shift = (idx >> OPENAVB_HIST_SUB_BITS) - 1;
+	U64 low = (U64)(OPENAVB_HIST_SUB_COUNT + (idx & (OPENAVB_HIST_SUB_COUNT - 1))) << shift;
+	U64 upper = low + ((U64)1 << shift) - 1;
+	return upper > 0xFFFFFFFF ? 0xFFFFFFFF : (U32)upper;
+}
+
+void openavbHistReset(openavb_hist_t *pHist)
+{
+	if (pHist) {
+		memset(pHist, 0, sizeof(*pHist));
+	}
+}
+
+void openavbHistSnapshot(const openavb_hist_t *pHist, openavb_hist_t *pSnap)
+{
+	if (!pHist || !pSnap) {
+		return;
+	}
+
+	U64 count = 0;
+	U32 i;
+	for (i = 0; i < OPENAVB_HIST_BUCKETS; i++) {
+		pSnap->bucket[i] = OPENAVB_ATOMIC_LOAD_RELAXED(&pHist->bucket[i]);
+		count += pSnap->bucket[i];
+	}
+	pSnap->count = count;
+	pSnap->sum = OPENAVB_ATOMIC_LOAD_RELAXED(&pHist->sum);
+	pSnap->max = OPENAVB_ATOMIC_LOAD_RELAXED(&pHist->max);
+}
+
+U32 openavbHistPercentile(const openavb_hist_t *pHist, double percentile)
+{
+	if (!pHist || pHist->count == 0) {
+		return 0;
+	}
+
+	if (percentile < 0.0) {
+		percentile = 0.0;
+	}
+	else if (percentile > 100.0) {
+		percentile = 100.0;
+	}
+
+	// Rank of the wanted value, counting from 1
+	U64 rank = (U64)((percentile / 100.0) * pHist->count + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	}
+
+	U64 seen = 0;
+	U32 i;
+	for (i = 0; i < OPENAVB_HIST_BUCKETS; i++) {
+		seen += pHist->bucket[i];
+		if (seen >= rank) {
+			U32 upper = x_bucketUpper(i);
+			return upper < pHist->max ? upper : pHist->max;
+		}
+	}
+	return pHist->max;
+}
+
+void openavbHistSummarize(const openavb_hist_t *pHist, openavb_hist_summary_t *pSummary)
+{
+	if (!pSummary) {
+		return;
+	}
+
+	memset(pSummary, 0, sizeof(*pSummary));
+	if (!pHist || pHist->count == 0) {
+		return;
+	}
+
+	pSummary->count = pHist->count;
+	pSummary->mean = (U32)(pHist->sum / pHist->count);
+	pSummary->p50 = openavbHistPercentile(pHist, 50.0);
+	pSummary->p99 = openavbHistPercentile(pHist, 99.0);
+	pSummary->p999 = openavbHistPercentile(pHist, 99.9);
+	pSummary->max = pHist->max;
+}
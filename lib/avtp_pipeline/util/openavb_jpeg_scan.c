@@ -0,0 +1,190 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : JPEG marker scanner
+*
+* A marker is an 0xFF byte followed by a code in 0xD0..0xD9. The vector
+* versions compare each byte and the one after it at once, so a step reads
+* one byte past the block and runs while that byte is within the data.
+*/
+
+#include <string.h>
+#include "openavb_platform.h"
+#include "openavb_types.h"
+#include "openavb_jpeg_scan_pub.h"
+
+#define	AVB_LOG_COMPONENT	"JPEG Scan"
+#include "openavb_log.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JPEG_SCAN_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__ARM_ARCH)
+#define JPEG_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Number of marker codes starting at JPEG_MARKER_RST0 (RST0..RST7, SOI, EOI)
+#define JPEG_SCAN_CODES		(JPEG_MARKER_EOI - JPEG_MARKER_RST0 + 1)
+
+typedef U32 (*jpeg_scan_fn_t)(const U8 *pData, U32 len, U32 pos);
+
+static jpeg_scan_fn_t gJpegScan = NULL;
+
+/////////////
+// Scalar
+/////////////
+
+static U32 x_scanNext(const U8 *pData, U32 len, U32 pos)
+{
+	while (pos + 1 < len) {
+		const U8 *p = memchr(pData + pos, 0xFF, len - 1 - pos);
+		if (!p) {
+			break;
+		}
+		pos = p - pData;
+		if ((U8)(pData[pos + 1] - JPEG_MARKER_RST0) < JPEG_SCAN_CODES) {
+			return pos;
+		}
+		pos++;
+	}
+	return len;
+}
+
+#if JPEG_SCAN_X86
+
+/////////////
+// SSE2
+/////////////
+
+__attribute__((target("sse2")))
+static U32 x_scanNextSse2(const U8 *pData, U32 len, U32 pos)
+{
+	const __m128i ff = _mm_set1_epi8((char)0xFF);
+	const __m128i rst0 = _mm_set1_epi8((char)JPEG_MARKER_RST0);
+	const __m128i last = _mm_set1_epi8(JPEG_SCAN_CODES - 1);
+	for (; pos + 17 <= len; pos += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(pData + pos));
+		__m128i code = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(pData + pos + 1)), rst0);
+		// code - RST0 <= last, unsigned
+		__m128i m = _mm_and_si128(_mm_cmpeq_epi8(v, ff), _mm_cmpeq_epi8(_mm_min_epu8(code, last), code));
+		U32 bits = (U32)_mm_movemask_epi8(m);
+		if (bits) {
+			return pos + __builtin_ctz(bits);
+		}
+	}
+	return x_scanNext(pData, len, pos);
+}
+
+/////////////
+// AVX2
+/////////////
+
+__attribute__((target("avx2")))
+static U32 x_scanNextAvx2(const U8 *pData, U32 len, U32 pos)
+{
+	const __m256i ff = _mm256_set1_epi8((char)0xFF);
+	const __m256i rst0 = _mm256_set1_epi8((char)JPEG_MARKER_RST0);
+	const __m256i last = _mm256_set1_epi8(JPEG_SCAN_CODES - 1);
+	for (; pos + 33 <= len; pos += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(pData + pos));
+		__m256i code = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)(pData + pos + 1)), rst0);
+		__m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(v, ff), _mm256_cmpeq_epi8(_mm256_min_epu8(code, last), code));
+		U32 bits = (U32)_mm256_movemask_epi8(m);
+		if (bits) {
+			return pos + __builtin_ctz(bits);
+		}
+	}
+	return x_scanNextSse2(pData, len, pos);
+}
+
+#endif // JPEG_SCAN_X86
+
+#if JPEG_SCAN_NEON
+
+/////////////
+// NEON
+/////////////
+
+static U32 x_scanNextNeon(const U8 *pData, U32 len, U32 pos)
+{
+	const uint8x16_t ff = vdupq_n_u8(0xFF);
+	const uint8x16_t rst0 = vdupq_n_u8(JPEG_MARKER_RST0);
+	const uint8x16_t last = vdupq_n_u8(JPEG_SCAN_CODES - 1);
+	for (; pos + 17 <= len; pos += 16) {
+		uint8x16_t code = vsubq_u8(vld1q_u8(pData + pos + 1), rst0);
+		uint8x16_t m = vandq_u8(vceqq_u8(vld1q_u8(pData + pos), ff), vcleq_u8(code, last));
+		uint64x2_t m64 = vreinterpretq_u64_u8(m);
+		if (vgetq_lane_u64(m64, 0) | vgetq_lane_u64(m64, 1)) {
+			// No movemask on NEON; find the marker within the block
+			return x_scanNext(pData, pos + 17, pos);
+		}
+	}
+	return x_scanNext(pData, len, pos);
+}
+
+#endif // JPEG_SCAN_NEON
+
+// Pick the scanner for this CPU. Racing callers all pick the same one.
+static jpeg_scan_fn_t x_jpegScanFn(void)
+{
+	jpeg_scan_fn_t fn = gJpegScan;
+
+	if (!fn) {
+		const char *name = "scalar";
+		fn = x_scanNext;
+#if JPEG_SCAN_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			fn = x_scanNextAvx2;
+			name = "AVX2";
+		}
+		else if (__builtin_cpu_supports("sse2")) {
+			fn = x_scanNextSse2;
+			name = "SSE2";
+		}
+#elif JPEG_SCAN_NEON
+		fn = x_scanNextNeon;
+		name = "NEON";
+#endif
+		AVB_LOGF_INFO("Using %s JPEG marker scanner", name);
+		gJpegScan = fn;
+	}
+	return fn;
+}
+
+U32 openavbJpegScanNext(const U8 *pData, U32 len, U32 pos)
+{
+	if (pos >= len) {
+		return len;
+	}
+	return x_jpegScanFn()(pData, len, pos);
+}
@@ -0,0 +1,74 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Sampled end-to-end latency trace
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "openavb_platform.h"
+#include "openavb_types.h"
+#include "openavb_lat_trace_pub.h"
+
+openavb_lat_ring_t *openavbLatTraceNew(U32 period)
+{
+	if (period == 0 || period > OPENAVB_LAT_TRACE_MAX_PERIOD || (period & (period - 1))) {
+		return NULL;
+	}
+
+	openavb_lat_ring_t *pRing = calloc(1, sizeof(*pRing));
+	if (pRing) {
+		pRing->mask = period - 1;
+	}
+	return pRing;
+}
+
+void openavbLatTraceDelete(openavb_lat_ring_t *pRing)
+{
+	free(pRing);
+}
+
+U32 openavbLatTraceRead(openavb_lat_ring_t *pRing, openavb_lat_sample_t *pSamples, U32 max)
+{
+	if (!pRing || !pSamples) {
+		return 0;
+	}
+
+	U32 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pRing->head);
+	U32 tail = pRing->tail;
+	U32 n = 0;
+	while (tail != head && n < max) {
+		pSamples[n++] = pRing->ring[tail % OPENAVB_LAT_TRACE_RING_LEN];
+		tail++;
+	}
+	OPENAVB_ATOMIC_STORE_RELEASE(&pRing->tail, tail);
+	return n;
+}
@@ -32,6 +32,9 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 #include "openavb_platform_pub.h"
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include "openavb_queue.h"
 #include "openavb_tcal_pub.h"
@@ -43,19 +46,21 @@ typedef struct {
   	bool bRT;						// TRUE = Details are in RT queue
 } log_queue_item_t;
 
+typedef union {
+	struct timespec nowTS;
+	U16 unsignedShortVar;
+	S16 signedShortVar;
+	U32 unsignedLongVar;
+	S32 signedLongVar;
+	U64 unsignedLongLongVar;
+	S64 signedLongLongVar;
+	float floatVar;
+} log_rt_data_t;
+
 typedef struct {
 	char *pFormat;
 	log_rt_datatype_t dataType;
-	union {
-		struct timespec nowTS;
-		U16 unsignedShortVar;
-		S16 signedShortVar;
-		U32 unsignedLongVar;
-		S32 signedLongVar;
-		U64 unsignedLongLongVar;
-		S64 signedLongLongVar;
-		float floatVar;
-	} data;
+	log_rt_data_t data;
 	bool bEnd;
 } log_rt_queue_item_t;
 
@@ -81,6 +86,543 @@ static MUTEX_HANDLE_ALT(gLogMutex);
 #define LOG_LOCK() MUTEX_LOCK_ALT(gLogMutex)
 #define LOG_UNLOCK() MUTEX_UNLOCK_ALT(gLogMutex)
 
+/////////////
+// Per thread log rings
+//
+// Each thread that logs gets a single producer / single consumer ring of fixed
+// size records. The owning thread fills the record at head and publishes it
+// with a release store; the logging thread (or avbLogGetMsg()) is the only
+// consumer. Rings are claimed under gLogMutex once per thread and handed back
+// when the thread exits and its ring has been drained.
+/////////////
+
+// Argument classes of avbLogFn() records, from the printf length modifier and conversion
+typedef enum {
+	LOG_RING_ARG_NONE,
+	LOG_RING_ARG_INT,
+	LOG_RING_ARG_LONG,
+	LOG_RING_ARG_LLONG,
+	LOG_RING_ARG_INTMAX,
+	LOG_RING_ARG_SIZE,
+	LOG_RING_ARG_PTRDIFF,
+	LOG_RING_ARG_DOUBLE,
+	LOG_RING_ARG_PTR,
+	LOG_RING_ARG_STR,
+} log_ring_arg_type_t;
+
+typedef struct {
+	const char *pFormat;			// RT items only
+	U8 type;						// log_ring_arg_type_t, or log_rt_datatype_t for RT items
+	union {
+		S64 intVar;
+		double doubleVar;
+		const void *ptrVar;
+		U32 strOffset;				// Offset of the copy in str[]
+		log_rt_data_t rt;
+	} data;
+} log_ring_arg_t;
+
+typedef struct {
+	bool bRT;						// avbLogRT() record
+	bool bTimestamp;				// RT record started with bBegin
+	U8 argCnt;
+	U16 strLen;
+	int line;
+	struct timespec nowTS;
+	unsigned long thread;
+	const char *tag;
+	const char *company;
+	const char *component;
+	const char *path;
+	const char *fmt;
+	log_ring_arg_t arg[LOG_RING_ARG_CNT];
+	char str[LOG_RING_STR_LEN];
+} log_ring_rec_t;
+
+typedef struct {
+	// Written by the owning thread
+	U32 head;
+	U32 dropped;
+	bool bOpen;						// RT record being filled
+	bool bOpenDrop;					// RT record being dropped, ring was full
+	bool bExited;					// Owning thread has exited
+	U8 pad1[OPENAVB_CACHE_LINE_SIZE];
+
+	// Written by the consumer
+	U32 tail;
+	U32 droppedReported;
+	U8 pad2[OPENAVB_CACHE_LINE_SIZE];
+
+	bool bInUse;					// Claimed by a thread. Changed under gLogMutex
+	log_ring_rec_t rec[LOG_RING_REC_CNT];
+} log_ring_t;
+
+static log_ring_t *gLogRings[LOG_RING_THREAD_CNT];
+static OPENAVB_THREAD_LOCAL log_ring_t *tLogRing = NULL;
+static OPENAVB_THREAD_LOCAL bool tLogRingFailed = FALSE;
+static THREAD_KEY_HANDLE(gLogRingKey);
+static bool gLogRingKeyOK = FALSE;
+
+static char ring_msg[LOG_MSG_LEN] = "";
+static char ring_spec[64] = "";
+static char ring_item[LOG_RT_MSG_LEN] = "";
+static char ring_full_msg[LOG_FULL_MSG_LEN] = "";
+
+static void x_logRingThreadExit(void *pv)
+{
+	log_ring_t *pRing = (log_ring_t *)pv;
+	// The consumer hands the ring back once it has drained it
+	OPENAVB_ATOMIC_STORE_RELEASE(&pRing->bExited, TRUE);
+}
+
+// Ring of the calling thread, claiming one on first use. NULL if rings are not in use.
+static log_ring_t *x_logRingGet(void)
+{
+	if (tLogRing) {
+		return tLogRing;
+	}
+	if (tLogRingFailed || !OPENAVB_LOG_RING || !gLogRingKeyOK) {
+		return NULL;
+	}
+	if (!(OPENAVB_LOG_FROM_THREAD ? loggingThreadRunning : OPENAVB_LOG_PULL_MODE)) {
+		return NULL;
+	}
+
+	LOG_LOCK();
+	int i1;
+	for (i1 = 0; i1 < LOG_RING_THREAD_CNT && !tLogRing; i1++) {
+		log_ring_t *pRing = gLogRings[i1];
+		if (!pRing) {
+			pRing = calloc(1, sizeof(log_ring_t));
+			if (!pRing) {
+				break;
+			}
+			pRing->bInUse = TRUE;
+			OPENAVB_ATOMIC_STORE_RELEASE(&gLogRings[i1], pRing);
+			tLogRing = pRing;
+		}
+		else if (!pRing->bInUse) {
+			// head == tail here; the new owner carries on from there
+			pRing->bInUse = TRUE;
+			pRing->bOpen = FALSE;
+			OPENAVB_ATOMIC_STORE_RELEASE(&pRing->bExited, FALSE);
+			tLogRing = pRing;
+		}
+	}
+	if (tLogRing) {
+		THREAD_KEY_SET(gLogRingKey, tLogRing);
+	}
+	else {
+		tLogRingFailed = TRUE;
+	}
+	LOG_UNLOCK();
+
+	return tLogRing;
+}
+
+// Next free record of a ring, NULL when full
+static log_ring_rec_t *x_logRingClaim(log_ring_t *pRing)
+{
+	U32 tail = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pRing->tail);
+	if (pRing->head - tail >= LOG_RING_REC_CNT) {
+		OPENAVB_ATOMIC_STORE_RELAXED(&pRing->dropped, pRing->dropped + 1);
+		return NULL;
+	}
+	return &pRing->rec[pRing->head & (LOG_RING_REC_CNT - 1)];
+}
+
+static void x_logRingPublish(log_ring_t *pRing)
+{
+	OPENAVB_ATOMIC_STORE_RELEASE(&pRing->head, pRing->head + 1);
+}
+
+// Parse one printf conversion. p points just past the '%'. Returns the position after the
+// conversion and sets the argument class and number of '*' fields, or NULL if the
+// conversion is not supported.
+static const char *x_logRingParseSpec(const char *p, log_ring_arg_type_t *pType, int *pStars)
+{
+	log_ring_arg_type_t lenType = LOG_RING_ARG_INT;
+	int longs = 0;
+
+	*pStars = 0;
+	if (*p == '%') {
+		*pType = LOG_RING_ARG_NONE;
+		return p + 1;
+	}
+
+	// flags, width and precision
+	while (*p && strchr("-+ #0'", *p)) p++;
+	while ((*p >= '0' && *p <= '9') || *p == '*') {
+		if (*p++ == '*') (*pStars)++;
+	}
+	if (*p == '.') {
+		p++;
+		while ((*p >= '0' && *p <= '9') || *p == '*') {
+			if (*p++ == '*') (*pStars)++;
+		}
+	}
+
+	// length modifier
+	for (;;) {
+		if (*p == 'h') { p++; }
+		else if (*p == 'l') { p++; longs++; }
+		else if (*p == 'q') { p++; longs = 2; }
+		else if (*p == 'j') { p++; lenType = LOG_RING_ARG_INTMAX; }
+		else if (*p == 'z') { p++; lenType = LOG_RING_ARG_SIZE; }
+		else if (*p == 't') { p++; lenType = LOG_RING_ARG_PTRDIFF; }
+		else if (*p == 'L') { return NULL; }
+		else break;
+	}
+	if (longs == 1) lenType = LOG_RING_ARG_LONG;
+	else if (longs >= 2) lenType = LOG_RING_ARG_LLONG;
+
+	switch (*p) {
+		case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+			*pType = lenType;
+			break;
+		case 'c':
+			if (longs) return NULL;
+			*pType = LOG_RING_ARG_INT;
+			break;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			*pType = LOG_RING_ARG_DOUBLE;
+			break;
+		case 's':
+			if (longs) return NULL;
+			*pType = LOG_RING_ARG_STR;
+			break;
+		case 'p':
+			*pType = LOG_RING_ARG_PTR;
+			break;
+		default:
+			// %n, wide characters and anything unknown
+			return NULL;
+	}
+	return p + 1;
+}
+
+// Capture an avbLogFn() call into the ring of the calling thread. Returns FALSE if the
+// message has to be formatted the old way.
+static bool x_logRingFn(const char *tag, const char *company, const char *component,
+	const char *path, int line, const char *fmt, va_list args)
+{
+	log_ring_t *pRing = x_logRingGet();
+	if (!pRing || !fmt) {
+		return FALSE;
+	}
+
+	log_ring_rec_t *pRec = x_logRingClaim(pRing);
+	if (!pRec) {
+		// Ring full, the message is dropped and counted
+		return TRUE;
+	}
+
+	pRec->bRT = FALSE;
+	pRec->argCnt = 0;
+	pRec->strLen = 0;
+
+	const char *p = fmt;
+	while (*p) {
+		if (*p++ != '%') {
+			continue;
+		}
+		log_ring_arg_type_t type;
+		int stars;
+		p = x_logRingParseSpec(p, &type, &stars);
+		if (!p || pRec->argCnt + stars + 1 > LOG_RING_ARG_CNT) {
+			return FALSE;
+		}
+		if (type == LOG_RING_ARG_NONE) {
+			continue;
+		}
+		while (stars--) {
+			log_ring_arg_t *pArg = &pRec->arg[pRec->argCnt++];
+			pArg->type = LOG_RING_ARG_INT;
+			pArg->data.intVar = va_arg(args, int);
+		}
+
+		log_ring_arg_t *pArg = &pRec->arg[pRec->argCnt++];
+		pArg->type = type;
+		switch (type) {
+			case LOG_RING_ARG_INT:		pArg->data.intVar = va_arg(args, int); break;
+			case LOG_RING_ARG_LONG:		pArg->data.intVar = va_arg(args, long); break;
+			case LOG_RING_ARG_LLONG:	pArg->data.intVar = va_arg(args, long long); break;
+			case LOG_RING_ARG_INTMAX:	pArg->data.intVar = va_arg(args, intmax_t); break;
+			case LOG_RING_ARG_SIZE:		pArg->data.intVar = va_arg(args, size_t); break;
+			case LOG_RING_ARG_PTRDIFF:	pArg->data.intVar = va_arg(args, ptrdiff_t); break;
+			case LOG_RING_ARG_DOUBLE:	pArg->data.doubleVar = va_arg(args, double); break;
+			case LOG_RING_ARG_PTR:		pArg->data.ptrVar = va_arg(args, void *); break;
+			case LOG_RING_ARG_STR:
+				{
+					const char *pStr = va_arg(args, const char *);
+					if (!pStr) {
+						pStr = "(null)";
+					}
+					size_t room = LOG_RING_STR_LEN - pRec->strLen;
+					size_t len = strnlen(pStr, room - 1);
+					memcpy(&pRec->str[pRec->strLen], pStr, len);
+					pRec->str[pRec->strLen + len] = '\0';
+					pArg->data.strOffset = pRec->strLen;
+					pRec->strLen += len + 1;
+					if (pRec->strLen >= LOG_RING_STR_LEN) {
+						// Later strings are empty
+						pRec->strLen = LOG_RING_STR_LEN - 1;
+					}
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	pRec->line = line;
+	pRec->tag = tag;
+	pRec->company = company;
+	pRec->component = component;
+	pRec->path = path;
+	pRec->fmt = fmt;
+	pRec->thread = (unsigned long)THREAD_SELF();
+	CLOCK_GETTIME(OPENAVB_CLOCK_REALTIME, &pRec->nowTS);
+	x_logRingPublish(pRing);
+	return TRUE;
+}
+
+// Capture an avbLogRT() call into the ring of the calling thread. Returns FALSE if the
+// item has to go through the shared RT queue.
+static bool x_logRingRT(bool bBegin, bool bItem, bool bEnd, char *pFormat, log_rt_datatype_t dataType, void *pVar)
+{
+	log_ring_t *pRing = x_logRingGet();
+	if (!pRing) {
+		return FALSE;
+	}
+
+	if (bBegin || !pRing->bOpen) {
+		log_ring_rec_t *pRec = x_logRingClaim(pRing);
+		pRing->bOpen = TRUE;
+		pRing->bOpenDrop = (pRec == NULL);
+		if (pRec) {
+			pRec->bRT = TRUE;
+			pRec->bTimestamp = bBegin;
+			pRec->argCnt = 0;
+			// Always stamped so records from different rings merge in order
+			CLOCK_GETTIME(OPENAVB_CLOCK_REALTIME, &pRec->nowTS);
+		}
+	}
+
+	log_ring_rec_t *pRec = &pRing->rec[pRing->head & (LOG_RING_REC_CNT - 1)];
+	if (bItem && !pRing->bOpenDrop && pRec->argCnt < LOG_RING_ARG_CNT) {
+		log_ring_arg_t *pArg = &pRec->arg[pRec->argCnt++];
+		pArg->pFormat = pFormat;
+		pArg->type = dataType;
+		switch (dataType) {
+			case LOG_RT_DATATYPE_U16:	pArg->data.rt.unsignedShortVar = *(U16 *)pVar; break;
+			case LOG_RT_DATATYPE_S16:	pArg->data.rt.signedShortVar = *(S16 *)pVar; break;
+			case LOG_RT_DATATYPE_U32:	pArg->data.rt.unsignedLongVar = *(U32 *)pVar; break;
+			case LOG_RT_DATATYPE_S32:	pArg->data.rt.signedLongVar = *(S32 *)pVar; break;
+			case LOG_RT_DATATYPE_U64:	pArg->data.rt.unsignedLongLongVar = *(U64 *)pVar; break;
+			case LOG_RT_DATATYPE_S64:	pArg->data.rt.signedLongLongVar = *(S64 *)pVar; break;
+			case LOG_RT_DATATYPE_FLOAT:	pArg->data.rt.floatVar = *(float *)pVar; break;
+			default:
+				break;
+		}
+	}
+
+	if (bEnd) {
+		if (!pRing->bOpenDrop) {
+			x_logRingPublish(pRing);
+		}
+		pRing->bOpen = FALSE;
+	}
+	return TRUE;
+}
+
+static void x_logAppend(char *pBuf, size_t bufSize, const char *pStr)
+{
+	size_t len = strlen(pBuf);
+	if (len + 1 < bufSize) {
+		strncat(pBuf, pStr, bufSize - len - 1);
+	}
+}
+
+// Format the message of an avbLogFn() record one conversion at a time
+static void x_logRingFormatFn(log_ring_rec_t *pRec, char *pBuf, size_t bufSize)
+{
+	const char *p = pRec->fmt;
+	U8 argIdx = 0;
+	size_t len = 0;
+
+	pBuf[0] = '\0';
+	while (*p && len + 1 < bufSize) {
+		if (*p != '%') {
+			pBuf[len++] = *p++;
+			pBuf[len] = '\0';
+			continue;
+		}
+
+		const char *pStart = p++;
+		log_ring_arg_type_t type;
+		int stars;
+		p = x_logRingParseSpec(p, &type, &stars);
+		if (type == LOG_RING_ARG_NONE) {
+			pBuf[len++] = '%';
+			pBuf[len] = '\0';
+			continue;
+		}
+
+		// Copy the conversion with any '*' replaced by its recorded value
+		size_t specLen = 0;
+		const char *q;
+		for (q = pStart; q < p && specLen + 12 < sizeof(ring_spec); q++) {
+			if (*q == '*') {
+				specLen += sprintf(&ring_spec[specLen], "%d", (int)pRec->arg[argIdx++].data.intVar);
+			}
+			else {
+				ring_spec[specLen++] = *q;
+			}
+		}
+		ring_spec[specLen] = '\0';
+
+		log_ring_arg_t *pArg = &pRec->arg[argIdx++];
+		char *pOut = &pBuf[len];
+		size_t room = bufSize - len;
+		switch (type) {
+			case LOG_RING_ARG_INT:		snprintf(pOut, room, ring_spec, (int)pArg->data.intVar); break;
+			case LOG_RING_ARG_LONG:		snprintf(pOut, room, ring_spec, (long)pArg->data.intVar); break;
+			case LOG_RING_ARG_LLONG:	snprintf(pOut, room, ring_spec, (long long)pArg->data.intVar); break;
+			case LOG_RING_ARG_INTMAX:	snprintf(pOut, room, ring_spec, (intmax_t)pArg->data.intVar); break;
+			case LOG_RING_ARG_SIZE:		snprintf(pOut, room, ring_spec, (size_t)pArg->data.intVar); break;
+			case LOG_RING_ARG_PTRDIFF:	snprintf(pOut, room, ring_spec, (ptrdiff_t)pArg->data.intVar); break;
+			case LOG_RING_ARG_DOUBLE:	snprintf(pOut, room, ring_spec, pArg->data.doubleVar); break;
+			case LOG_RING_ARG_PTR:		snprintf(pOut, room, ring_spec, pArg->data.ptrVar); break;
+			case LOG_RING_ARG_STR:		snprintf(pOut, room, ring_spec, &pRec->str[pArg->data.strOffset]); break;
+			default:
+				break;
+		}
+		len += strlen(pOut);
+	}
+}
+
+// Render a ring record the same way avbLogFn() and avbLogRTRender() would
+static void x_logRingRender(log_ring_rec_t *pRec, char *pBuf, size_t bufSize)
+{
+	pBuf[0] = '\0';
+
+	if (pRec->bRT) {
+		U8 i1;
+		if (pRec->bTimestamp) {
+			snprintf(ring_item, sizeof(ring_item), "[%lu:%09lu] ", pRec->nowTS.tv_sec, pRec->nowTS.tv_nsec);
+			x_logAppend(pBuf, bufSize, ring_item);
+		}
+		for (i1 = 0; i1 < pRec->argCnt; i1++) {
+			log_ring_arg_t *pArg = &pRec->arg[i1];
+			ring_item[0] = '\0';
+			switch (pArg->type) {
+				case LOG_RT_DATATYPE_CONST_STR:	snprintf(ring_item, sizeof(ring_item), "%s", pArg->pFormat); break;
+				case LOG_RT_DATATYPE_U16:	snprintf(ring_item, sizeof(ring_item), pArg->pFormat, pArg->data.rt.unsignedShortVar); break;
+				case LOG_RT_DATATYPE_S16:	snprintf(ring_item, sizeof(ring_item), pArg->pFormat, pArg->data.rt.signedShortVar); break;
+				case LOG_RT_DATATYPE_U32:	snprintf(ring_item, sizeof(ring_item), pArg->pFormat, pArg->data.rt.unsignedLongVar); break;
+				case LOG_RT_DATATYPE_S32:	snprintf(ring_item, sizeof(ring_item), pArg->pFormat, pArg->data.rt.signedLongVar); break;
+				case LOG_RT_DATATYPE_U64:	snprintf(ring_item, sizeof(ring_item), pArg->pFormat, pArg->data.rt.unsignedLongLongVar); break;
+				case LOG_RT_DATATYPE_S64:	snprintf(ring_item, sizeof(ring_item), pArg->pFormat, pArg->data.rt.signedLongLongVar); break;
+				case LOG_RT_DATATYPE_FLOAT:	snprintf(ring_item, sizeof(ring_item), pArg->pFormat, pArg->data.rt.floatVar); break;
+				default:
+					break;
+			}
+			x_logAppend(pBuf, bufSize, ring_item);
+		}
+		if (OPENAVB_TCAL_LOG_EXTRA_NEWLINE)
+			x_logAppend(pBuf, bufSize, "\n");
+		return;
+	}
+
+	x_logRingFormatFn(pRec, ring_msg, sizeof(ring_msg));
+
+	char file_info[LOG_FILE_LEN] = "";
+	char proc_info[LOG_PROC_LEN] = "";
+	char thread_info[LOG_THREAD_LEN] = "";
+	char time_info[LOG_TIME_LEN] = "";
+	char timestamp_info[LOG_TIMESTAMP_LEN] = "";
+
+	if (OPENAVB_LOG_FILE_INFO && pRec->path) {
+		const char* file = strrchr(pRec->path, '/');
+		if (!file)
+			file = strrchr(pRec->path, '\\');
+		if (file)
+			file += 1;
+		else
+			file = pRec->path;
+		snprintf(file_info, sizeof(file_info), " %s:%d", file, pRec->line);
+	}
+	if (OPENAVB_LOG_PROC_INFO) {
+		snprintf(proc_info, sizeof(proc_info), " P:%5.5d", GET_PID());
+	}
+	if (OPENAVB_LOG_THREAD_INFO) {
+		snprintf(thread_info, sizeof(thread_info), " T:%lu", pRec->thread);
+	}
+	if (OPENAVB_LOG_TIME_INFO) {
+		time_t tNow = pRec->nowTS.tv_sec;
+		struct tm tmNow;
+		localtime_r(&tNow, &tmNow);
+		snprintf(time_info, sizeof(time_info), "%2.2d:%2.2d:%2.2d", tmNow.tm_hour, tmNow.tm_min, tmNow.tm_sec);
+	}
+	if (OPENAVB_LOG_TIMESTAMP_INFO) {
+		snprintf(timestamp_info, sizeof(timestamp_info), "%lu:%09lu", pRec->nowTS.tv_sec, pRec->nowTS.tv_nsec);
+	}
+
+	snprintf(pBuf, bufSize, "[%s%s%s%s %s %s%s] %s: %s%s", time_info, timestamp_info, proc_info, thread_info,
+		pRec->company, pRec->component, file_info, pRec->tag, ring_msg,
+		OPENAVB_TCAL_LOG_EXTRA_NEWLINE ? "\n" : "");
+}
+
+// Render the oldest record across all rings. Returns FALSE when all rings are empty.
+static bool x_logRingNext(char *pBuf, size_t bufSize)
+{
+	log_ring_t *pOldest = NULL;
+	log_ring_rec_t *pOldestRec = NULL;
+	int i1;
+
+	for (i1 = 0; i1 < LOG_RING_THREAD_CNT; i1++) {
+		log_ring_t *pRing = OPENAVB_ATOMIC_LOAD_ACQUIRE(&gLogRings[i1]);
+		if (!pRing) {
+			break;
+		}
+
+		U32 dropped = OPENAVB_ATOMIC_LOAD_RELAXED(&pRing->dropped);
+		if (dropped != pRing->droppedReported) {
+			snprintf(pBuf, bufSize, "[log] %u messages dropped, log ring full%s",
+				dropped - pRing->droppedReported, OPENAVB_TCAL_LOG_EXTRA_NEWLINE ? "\n" : "");
+			pRing->droppedReported = dropped;
+			return TRUE;
+		}
+
+		U32 head = OPENAVB_ATOMIC_LOAD_ACQUIRE(&pRing->head);
+		if (head == pRing->tail) {
+			if (OPENAVB_ATOMIC_LOAD_ACQUIRE(&pRing->bExited) && pRing->bInUse) {
+				LOG_LOCK();
+				pRing->bInUse = FALSE;
+				LOG_UNLOCK();
+			}
+			continue;
+		}
+
+		log_ring_rec_t *pRec = &pRing->rec[pRing->tail & (LOG_RING_REC_CNT - 1)];
+		if (!pOldestRec
+			|| pRec->nowTS.tv_sec < pOldestRec->nowTS.tv_sec
+			|| (pRec->nowTS.tv_sec == pOldestRec->nowTS.tv_sec && pRec->nowTS.tv_nsec < pOldestRec->nowTS.tv_nsec)) {
+			pOldest = pRing;
+			pOldestRec = pRec;
+		}
+	}
+
+	if (!pOldest) {
+		return FALSE;
+	}
+
+	x_logRingRender(pOldestRec, pBuf, bufSize);
+	OPENAVB_ATOMIC_STORE_RELEASE(&pOldest->tail, pOldest->tail + 1);
+	return TRUE;
+}
+
 void avbLogRTRender(log_queue_item_t *pLogItem)
 {
 	if (logRTQueue) {
@@ -163,13 +705,21 @@ extern U32 DLL_EXPORT avbLogGetMsg(U8 *pBuf, U32 bufSize)
 			return dataLen;
 		}
 	}
+	if (OPENAVB_LOG_RING && x_logRingNext(ring_full_msg, sizeof(ring_full_msg))) {
+		dataLen = strlen(ring_full_msg);
+		memcpy(pBuf, (U8 *)ring_full_msg, dataLen <= bufSize ? dataLen : bufSize);
+	}
 	return dataLen;
 }
 
 void *loggingThreadFn(void *pv)
 {
-	while (loggingThreadRunning) {
-		SLEEP_MSEC(LOG_QUEUE_SLEEP_MSEC);
+	bool bRunning = TRUE;
+	while (bRunning) {
+		bRunning = loggingThreadRunning;
+		if (bRunning) {
+			SLEEP_MSEC(LOG_QUEUE_SLEEP_MSEC);
+		}
 
 		bool more = TRUE;
 
@@ -187,6 +737,11 @@ void *loggingThreadFn(void *pv)
 				more = TRUE;
 			}
 		}
+
+		// Per thread rings, formatted here rather than on the logging threads
+		while (OPENAVB_LOG_RING && x_logRingNext(ring_full_msg, sizeof(ring_full_msg))) {
+			fputs(ring_full_msg, AVB_LOG_OUTPUT_FD);
+		}
 	}
 
 	return NULL;
@@ -195,6 +750,10 @@ void *loggingThreadFn(void *pv)
 extern void DLL_EXPORT avbLogInit(void)
 {
 	MUTEX_CREATE_ALT(gLogMutex);
+
+	if (OPENAVB_LOG_RING) {
+		gLogRingKeyOK = (THREAD_KEY_CREATE(gLogRingKey, x_logRingThreadExit) == 0);
+	}
   
 	logQueue = openavbQueueNewQueue(sizeof(log_queue_item_t), LOG_QUEUE_MSG_CNT);
 	if (!logQueue) {
@@ -238,6 +797,17 @@ extern void DLL_EXPORT avbLogFn(
 		va_list args;
 		va_start(args, fmt);
 
+		if (OPENAVB_LOG_RING) {
+			va_list ringArgs;
+			va_copy(ringArgs, args);
+			bool bDone = x_logRingFn(tag, company, component, path, line, fmt, ringArgs);
+			va_end(ringArgs);
+			if (bDone) {
+				va_end(args);
+				return;
+			}
+		}
+
 		LOG_LOCK();
 
 		vsprintf(msg, fmt, args);
@@ -302,6 +872,9 @@ extern void DLL_EXPORT avbLogFn(
 extern void DLL_EXPORT avbLogRT(int level, bool bBegin, bool bItem, bool bEnd, char *pFormat, log_rt_datatype_t dataType, void *pVar)
 {
 	if (level <= AVB_LOG_LEVEL) {
+		if (OPENAVB_LOG_RING && x_logRingRT(bBegin, bItem, bEnd, pFormat, dataType, pVar)) {
+			return;
+		}
 		if (logRTQueue) {
 			if (bBegin) {
 				LOG_LOCK();
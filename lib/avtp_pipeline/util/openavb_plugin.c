@@ -34,42 +34,91 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include "openavb_types_pub.h"
 #include "openavb_trace_pub.h"
-#include "openavb_array.h"
 #include "openavb_plugin.h"
 
 #define	AVB_LOG_COMPONENT	"Plugin"
 #include "openavb_log_pub.h" 
 
-openavb_array_t staticMapModeleArray;
-openavb_array_t staticIntfModeleArray;
+typedef struct {
+	openavb_plugin_kind_t kind;
+	char name[OPENAVB_PLUGIN_NAME_LEN];
+	void *pFn;
+} plugin_entry_t;
 
-bool registerStaticMapModule(openavb_map_initialize_fn_t fn)
+// Entries are filled in before x_pluginCount is raised past them and never change afterwards,
+// so readers only need an acquire load of the count.
+static plugin_entry_t x_plugins[OPENAVB_PLUGIN_MAX];
+static U32 x_pluginCount;
+static bool x_pluginSealed;
+
+static const char *x_kindName(openavb_plugin_kind_t kind)
 {
-	if (!staticMapModeleArray) {
-		staticMapModeleArray = openavbArrayNewArray(sizeof(openavb_map_initialize_fn_t));
-		if (!staticMapModeleArray)
-			return FALSE;
-		if (!openavbArraySetInitSize(staticMapModeleArray, 8))
+	return kind == OPENAVB_PLUGIN_MAP ? "Mapping" : "Interface";
+}
+
+bool openavbPluginRegister(openavb_plugin_kind_t kind, const char *name, void *pFn, U32 abi)
+{
+	if (!name || !pFn) {
+		return FALSE;
+	}
+
+	if (abi != OPENAVB_PLUGIN_ABI) {
+		AVB_LOGF_ERROR("%s module %s built for plugin ABI 0x%x, not 0x%x; not registered",
+			x_kindName(kind), name, abi, (U32)OPENAVB_PLUGIN_ABI);
+		return FALSE;
+	}
+
+	if (strlen(name) >= OPENAVB_PLUGIN_NAME_LEN) {
+		AVB_LOGF_ERROR("%s module name too long: %s", x_kindName(kind), name);
+		return FALSE;
+	}
+
+	void *pFound = openavbPluginFind(kind, name);
+	if (pFound) {
+		if (pFound != pFn) {
+			AVB_LOGF_ERROR("%s module %s already registered", x_kindName(kind), name);
 			return FALSE;
+		}
+		return TRUE;
 	}
 
-	openavbArrayAdd(staticMapModeleArray, fn);
+	U32 count = OPENAVB_ATOMIC_LOAD_RELAXED(&x_pluginCount);
+	if (count >= OPENAVB_PLUGIN_MAX) {
+		AVB_LOGF_ERROR("Plugin registry full; %s module %s not registered", x_kindName(kind), name);
+		return FALSE;
+	}
+
+	x_plugins[count].kind = kind;
+	strcpy(x_plugins[count].name, name);
+	x_plugins[count].pFn = pFn;
+	OPENAVB_ATOMIC_STORE_RELEASE(&x_pluginCount, count + 1);
 	return TRUE;
 }
 
-bool registerStaticIntfModule(openavb_intf_initialize_fn_t fn)
+void *openavbPluginFind(openavb_plugin_kind_t kind, const char *name)
 {
-	if (!staticIntfModeleArray) {
-		staticIntfModeleArray = openavbArrayNewArray(sizeof(openavb_intf_initialize_fn_t));
-		if (!staticIntfModeleArray)
-			return FALSE;
-		if (!openavbArraySetInitSize(staticIntfModeleArray, 8))
-			return FALSE;
+	U32 count = OPENAVB_ATOMIC_LOAD_ACQUIRE(&x_pluginCount);
+	U32 i;
+
+	if (!name) {
+		return NULL;
 	}
 
-	openavbArrayAdd(staticIntfModeleArray, fn);
-	return TRUE;
+	for (i = 0; i < count; i++) {
+		if (x_plugins[i].kind == kind && strcmp(x_plugins[i].name, name) == 0) {
+			return x_plugins[i].pFn;
+		}
+	}
+	return NULL;
 }
 
+void openavbPluginSeal(void)
+{
+	OPENAVB_ATOMIC_STORE_RELEASE(&x_pluginSealed, TRUE);
+	AVB_LOGF_INFO("Plugin registry sealed with %u modules", OPENAVB_ATOMIC_LOAD_RELAXED(&x_pluginCount));
+}
 
-
+bool openavbPluginIsSealed(void)
+{
+	return OPENAVB_ATOMIC_LOAD_ACQUIRE(&x_pluginSealed);
+}
@@ -40,8 +40,43 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 // There isn't good cross-platform linker support to force non-referenced functions from being removed 
 // from a final image. Therefore these functions exist to ensure the initizlation function for
 // interface and mapping modules can have a reference as far as the linker is concerned.
+//
+// The modules also go into a process wide registry by the name of their initialize function, the name
+// used for map_fn and intf_fn in the stream configuration. Streams find their modules there without
+// going through the dynamic loader. Registering is meant for host start up and must not race another
+// registration; looking up takes no lock and is safe from any thread at any time.
 
-bool registerStaticMapModule(openavb_map_initialize_fn_t fn);
-bool registerStaticIntfModule(openavb_intf_initialize_fn_t fn);
+// Maximum number of registered modules
+#define OPENAVB_PLUGIN_MAX			64
+// Maximum length of a module initialize function name
+#define OPENAVB_PLUGIN_NAME_LEN		64
+
+// Changes whenever the initialize function or callback table layout changes. A module compiled against
+// different headers than the registry registers with a different value and is refused.
+#define OPENAVB_PLUGIN_ABI_VERSION	1
+#define OPENAVB_PLUGIN_ABI			((OPENAVB_PLUGIN_ABI_VERSION << 24) ^ (sizeof(openavb_map_cb_t) << 12) ^ sizeof(openavb_intf_cb_t))
+
+typedef enum {
+	OPENAVB_PLUGIN_MAP,
+	OPENAVB_PLUGIN_INTF,
+} openavb_plugin_kind_t;
+
+// Add a module initialize function to the registry under name. abi is OPENAVB_PLUGIN_ABI as the module
+// saw it. Registering a name again with the same function is harmless.
+bool openavbPluginRegister(openavb_plugin_kind_t kind, const char *name, void *pFn, U32 abi);
+
+// Initialize function registered under name, or NULL.
+void *openavbPluginFind(openavb_plugin_kind_t kind, const char *name);
+
+// Stop streams from resolving modules any other way than from the registry. Once every stream the host
+// runs has been configured (and so has its modules in the registry), sealing makes sure reconfiguring
+// a stream later never waits on the dynamic loader.
+void openavbPluginSeal(void);
+bool openavbPluginIsSealed(void);
+
+#define registerStaticMapModule(fn) \
+	openavbPluginRegister(OPENAVB_PLUGIN_MAP, #fn, (void *)(openavb_map_initialize_fn_t)(fn), OPENAVB_PLUGIN_ABI)
+#define registerStaticIntfModule(fn) \
+	openavbPluginRegister(OPENAVB_PLUGIN_INTF, #fn, (void *)(openavb_intf_initialize_fn_t)(fn), OPENAVB_PLUGIN_ABI)
 
 #endif // OPENAVB_PLUGIN_H
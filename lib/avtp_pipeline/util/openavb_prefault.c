@@ -0,0 +1,66 @@
+/*************************************************************************************************************
+Copyright (c) 2012-2015, Symphony Teleca Corporation, a Harman International Industries, Incorporated company
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS LISTED "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS LISTED BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+Attributions: The inih library portion of the source code is licensed from
+Brush Technology and Ben Hoyt - Copyright (c) 2009, Brush Technology and Copyright (c) 2009, Ben Hoyt.
+Complete license and copyright information can be found at
+https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
+*************************************************************************************************************/
+
+/*
+* MODULE SUMMARY : Fault memory in ahead of streaming
+*/
+
+#include <unistd.h>
+#include "openavb_platform.h"
+#include "openavb_prefault.h"
+
+size_t openavbPrefault(void *p, size_t len, bool bWrite)
+{
+	static size_t pageSize = 0;
+	U8 *pByte = p;
+	size_t i1;
+
+	if (!p || len == 0)
+		return 0;
+
+	if (!pageSize) {
+		long size = sysconf(_SC_PAGESIZE);
+		pageSize = size > 0 ? (size_t)size : 4096;
+	}
+
+	// First byte of each page, and the last in case p isn't page aligned
+	for (i1 = 0; i1 < len; i1 += pageSize) {
+		if (bWrite)
+			OPENAVB_ATOMIC_FETCH_ADD(&pByte[i1], 0);
+		else
+			(void)*(volatile U8 *)&pByte[i1];
+	}
+	if (bWrite)
+		OPENAVB_ATOMIC_FETCH_ADD(&pByte[len - 1], 0);
+	else
+		(void)*(volatile U8 *)&pByte[len - 1];
+
+	return len;
+}
@@ -205,5 +205,7 @@ char* openavbUtilRCCodeToString(openavbRC rc);
 #define AVB_RC_TRACE_RET(_rc_, _trace_)			AVB_TRACE_EXIT(_trace_); return (_rc_)
 #define AVB_RC_FAIL_RET(_rc_)					if (IS_OPENAVB_FAILURE(_rc_)) return (_rc_)
 #define AVB_RC_FAIL_TRACE_RET(_rc_, _trace_)	if (IS_OPENAVB_FAILURE(_rc_)) {AVB_TRACE_EXIT(_trace_); return (_rc_);}
+#define AVB_RC_LOG_HOT_TRACE_RET(_rc_, _trace_)	AVB_LOGF_ERROR("%s", openavbUtilRCCodeToString(_rc_)); AVB_HOT_TRACE_EXIT(_trace_); return (_rc_)
+#define AVB_RC_HOT_TRACE_RET(_rc_, _trace_)		AVB_HOT_TRACE_EXIT(_trace_); return (_rc_)
 
 #endif // AVB_RESULT_CODES_H
@@ -30,47 +30,58 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 /*
 * MODULE SUMMARY : Implementation of Timestamp evaluation useful for reporting and smoothing jitter.
+*
+* The nominal interval is kept as fixed point nanoseconds with
+* OPENAVB_TIMESTAMP_FRAC_BITS fraction bits, so rates that don't divide a
+* second evenly (44.1kHz audio) don't show up as drift. Evaluating a timestamp
+* is a handful of adds, shifts and compares: no divides and no formatting.
+* Jitter and drift go into histograms that other threads snapshot and report.
 */
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "openavb_printbuf.h"
+#include "openavb_platform.h"
 #include "openavb_timestamp.h"
 
 OPENAVB_CODE_MODULE_PRI
 
-#define OPENAVB_TIMESTAMP_PRINT_BUFFER_SIZE 		2048
-#define OPENAVB_TIMESTAMP_DUMP_PRINTBUF_INTERVAL 	30
-
 // CORE_TODO: This should be enhanced to account for dropped packet detection and perhaps PTP time adjusts
 
+#define OPENAVB_TIMESTAMP_FRAC_BITS		16
+#define OPENAVB_TIMESTAMP_FRAC_HALF		((S64)1 << (OPENAVB_TIMESTAMP_FRAC_BITS - 1))
+
 struct openavb_timestamp_eval {
 	// Flags
 	bool started;
 
 	// Settings
-	U32 tsRateInterval;
+	// Nominal timestamp interval, fixed point nanoseconds
+	U64 tsRateIntervalFP;
 	bool smoothing;
 	U32 tsSmoothingMaxJitter;
 	U32 tsSmoothingMaxDrift;
-	U32 reportInterval;
+	openavb_hist_t *pJitterHist;
+	openavb_hist_t *pDriftHist;
 
 	// Data
-	U32 tsCnt;
 	U32 tsPrev;
-	U32 tsInterval;
-	U32 tsJitter;
-	U64 tsAccumJitter;
-	U32 tsDrift;
-	U64 tsTtlReal;
-	U64 tsTtlCalc;
-	U32 tsMaxJitter;
-	U32 tsMaxDrift;
-	openavb_printbuf_t printbuf;
+	// Intervals skipped since the last timestamp
+	U32 tsSkip;
+	// Real minus nominal time since the first timestamp, fixed point nanoseconds
+	S64 tsDriftFP;
 };
 
+// Fixed point nanoseconds to whole nanoseconds, rounded, clamped to the U32 range
+static inline U32 x_fpToNs(S64 valueFP)
+{
+	if (valueFP < 0) {
+		valueFP = -valueFP;
+	}
+	U64 ns = ((U64)valueFP + OPENAVB_TIMESTAMP_FRAC_HALF) >> OPENAVB_TIMESTAMP_FRAC_BITS;
+	return ns > 0xFFFFFFFF ? 0xFFFFFFFF : (U32)ns;
+}
+
 
 openavb_timestamp_eval_t openavbTimestampEvalNew(void)
 {
@@ -89,15 +100,25 @@ void openavbTimestampEvalInitialize(openavb_timestamp_eval_t tsEval, U32 tsRateI
 {
     if (tsEval) {
 		tsEval->started = FALSE;
-		tsEval->tsRateInterval = tsRateInterval;
-		tsEval->printbuf = openavbPrintbufNew(OPENAVB_TIMESTAMP_PRINT_BUFFER_SIZE, OPENAVB_TIMESTAMP_DUMP_PRINTBUF_INTERVAL);
+		tsEval->tsRateIntervalFP = (U64)tsRateInterval << OPENAVB_TIMESTAMP_FRAC_BITS;
+		tsEval->tsSkip = 0;
+		tsEval->tsDriftFP = 0;
     }
 }
 
-void openavbTimestampEvalSetReport(openavb_timestamp_eval_t tsEval, U32 reportInterval)
+void openavbTimestampEvalInitializeRate(openavb_timestamp_eval_t tsEval, U32 tsPerSecond)
+{
+    if (tsEval && tsPerSecond) {
+		openavbTimestampEvalInitialize(tsEval, 0);
+		tsEval->tsRateIntervalFP = (((U64)NANOSECONDS_PER_SECOND << OPENAVB_TIMESTAMP_FRAC_BITS) + tsPerSecond / 2) / tsPerSecond;
+    }
+}
+
+void openavbTimestampEvalSetHistograms(openavb_timestamp_eval_t tsEval, openavb_hist_t *pJitterHist, openavb_hist_t *pDriftHist)
 {
     if (tsEval) {
-		tsEval->reportInterval = reportInterval;
+		tsEval->pJitterHist = pJitterHist;
+		tsEval->pDriftHist = pDriftHist;
     }
 }
 
@@ -115,47 +136,32 @@ U32 openavbTimestampEvalTimestamp(openavb_timestamp_eval_t tsEval, U32 ts)
 	U32 tsRet = ts;
 
     if (tsEval) {
-		// Determine the Jitter
-		if (tsEval->tsPrev > ts) {
-			tsEval->tsInterval = (((U32)-1) - tsEval->tsPrev) + ts;
-		}
-		else {
-			tsEval->tsInterval = ts - tsEval->tsPrev;
-		}
-
-		// Save real ts for not interval
+		// Modulo 2^32 difference, correct across the timestamp wrap
+		U32 tsInterval = ts - tsEval->tsPrev;
 		tsEval->tsPrev = ts;
 
-		// Increment the main timestamp counter
-		tsEval->tsCnt++;
-
-		// Accumulate totals
 		if (!tsEval->started) {
-			// First timestamp interval
-			tsEval->tsTtlCalc = 0;
-			tsEval->tsTtlReal = 0;
+			// First timestamp only sets the reference
 			tsEval->started = TRUE;
+			tsEval->tsSkip = 0;
+			tsEval->tsDriftFP = 0;
+			return tsRet;
 		}
-		else {
-			// All but first timestamp
-			tsEval->tsTtlCalc += tsEval->tsRateInterval;
-			tsEval->tsTtlReal += tsEval->tsInterval;
-
-			tsEval->tsJitter = abs(tsEval->tsRateInterval - tsEval->tsInterval);
-			if (tsEval->tsJitter > tsEval->tsMaxJitter) {
-				tsEval->tsMaxJitter = tsEval->tsJitter;
-			}
-			tsEval->tsAccumJitter += tsEval->tsJitter;
-
-			tsEval->tsDrift = abs(tsEval->tsTtlCalc - tsEval->tsTtlReal);
-
-			// Reporting
-			if (tsEval->reportInterval) {
-				if ((tsEval->tsCnt % tsEval->reportInterval) == 0) {
-					//printf("Jitter:%9u   AvgJitter:%9u   MaxJitter:%9u   Drift:%9u\n", tsEval->tsJitter, (U32)(tsEval->tsAccumJitter / tsEval->tsCnt), tsEval->tsMaxJitter, tsEval->tsDrift); 
-					openavbPrintbufPrintf(tsEval->printbuf, "Jitter:%9u   AvgJitter:%9u   MaxJitter:%9u   Drift:%9u\n", tsEval->tsJitter, (U32)(tsEval->tsAccumJitter / tsEval->tsCnt), tsEval->tsMaxJitter, tsEval->tsDrift);
-				}
-			}
+
+		S64 tsExpectFP = tsEval->tsRateIntervalFP;
+		if (tsEval->tsSkip) {
+			tsExpectFP += tsEval->tsRateIntervalFP * tsEval->tsSkip;
+			tsEval->tsSkip = 0;
+		}
+
+		S64 tsErrorFP = ((S64)tsInterval << OPENAVB_TIMESTAMP_FRAC_BITS) - tsExpectFP;
+		tsEval->tsDriftFP += tsErrorFP;
+
+		if (tsEval->pJitterHist) {
+			openavbHistRecord(tsEval->pJitterHist, x_fpToNs(tsErrorFP));
+		}
+		if (tsEval->pDriftHist) {
+			openavbHistRecord(tsEval->pDriftHist, x_fpToNs(tsEval->tsDriftFP));
 		}
     }
 
@@ -166,6 +172,6 @@ U32 openavbTimestampEvalTimestamp(openavb_timestamp_eval_t tsEval, U32 ts)
 void openavbTimestampEvalTimestampSkip(openavb_timestamp_eval_t tsEval, U32 cnt)
 {
     if (tsEval) {
+		tsEval->tsSkip += cnt;
     }
 }
-
@@ -37,6 +37,7 @@ https://github.com/benhoyt/inih/commit/74d2ca064fb293bc60a77b0bd068075b293cf175.
 
 #include <stdlib.h>
 #include "openavb_types.h"
+#include "openavb_histogram_pub.h"
 
 typedef struct openavb_timestamp_eval * openavb_timestamp_eval_t;
 
@@ -50,8 +51,16 @@ void openavbTimestampEvalDelete(openavb_timestamp_eval_t tsEval);
 // Set timestamp interval.
 void openavbTimestampEvalInitialize(openavb_timestamp_eval_t tsEval, U32 tsRateInterval);
 
-// Set the report interval. If not set there will be no reporting.
-void openavbTimestampEvalSetReport(openavb_timestamp_eval_t tsEval, U32 reportInterval);
+// Set the timestamp interval from the number of timestamps per second. Keeps
+// the fraction of a nanosecond that tsRateInterval would round off.
+void openavbTimestampEvalInitializeRate(openavb_timestamp_eval_t tsEval, U32 tsPerSecond);
+
+// Set the histograms each timestamp records its jitter (distance from the
+// nominal interval) and drift (distance from the nominal time since the first
+// timestamp) into, in nanoseconds. Either may be NULL. They are recorded from
+// the thread evaluating timestamps and are meant to be snapshotted and
+// reported from another one.
+void openavbTimestampEvalSetHistograms(openavb_timestamp_eval_t tsEval, openavb_hist_t *pJitterHist, openavb_hist_t *pDriftHist);
 
 // Set the timestamp smoothing parameters.
 void openavbTimestampEvalSetSmoothing(openavb_timestamp_eval_t tsEval, U32 tsMaxJitter, U32 tsMaxDrift);
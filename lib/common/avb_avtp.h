@@ -2,6 +2,7 @@
 #define __AVB_AVTP_H__
 
 #include <inttypes.h>
+#include <string.h>
 
 #define MAX_SAMPLE_VALUE ((1U << ((sizeof(int32_t)*8)-1))-1)
 
@@ -63,77 +64,491 @@ typedef struct {
 	uint8_t value[3];
 } six1883_sample;
 
-void avb_set_1722_cd_indicator(seventeen22_header *h1722, uint64_t cd_indicator);
-uint64_t avb_get_1722_cd_indicator(seventeen22_header *h1722);
-void avb_set_1722_subtype(seventeen22_header *h1722, uint64_t subtype);
-uint64_t avb_get_1722_subtype(seventeen22_header *h1722);
-void avb_set_1722_sid_valid(seventeen22_header *h1722, uint64_t sid_valid);
-uint64_t avb_get_1722_sid_valid(seventeen22_header *h1722);
-void avb_set_1722_version(seventeen22_header *h1722, uint64_t version);
-uint64_t avb_get_1722_version(seventeen22_header *h1722);
-void avb_set_1722_reset(seventeen22_header *h1722, uint64_t reset);
-uint64_t avb_get_1722_reset(seventeen22_header *h1722);
-void avb_set_1722_reserved0(seventeen22_header *h1722, uint64_t reserved0);
-uint64_t avb_get_1722_reserved0(seventeen22_header *h1722);
-void avb_set_1722_reserved1(seventeen22_header *h1722, uint64_t reserved1);
-uint64_t avb_get_1722_reserved1(seventeen22_header *h1722);
-void avb_set_1722_timestamp_uncertain(seventeen22_header *h1722, uint64_t timestamp_uncertain);
-uint64_t avb_get_1722_timestamp_uncertain(seventeen22_header *h1722);
-void avb_set_1722_timestamp(seventeen22_header *h1722, uint64_t timestamp);
-uint64_t avb_get_1722_reset(seventeen22_header *h1722);
-void avb_set_1722_reserved0(seventeen22_header *h1722, uint64_t reserved0);
-uint64_t avb_get_1722_reserved0(seventeen22_header *h1722);
-void avb_set_1722_gateway_valid(seventeen22_header *h1722, uint64_t gateway_valid);
-uint64_t avb_get_1722_gateway_valid(seventeen22_header *h1722);
-void avb_set_1722_timestamp_valid(seventeen22_header *h1722, uint64_t timestamp_valid);
-uint64_t avb_get_1722_timestamp_valid(seventeen22_header *h1722);
-void avb_set_1722_reserved1(seventeen22_header *h1722, uint64_t reserved1);
-uint64_t avb_get_1722_reserved1(seventeen22_header *h1722);
-void avb_set_1722_timestamp_uncertain(seventeen22_header *h1722, uint64_t timestamp_uncertain);
-uint64_t avb_get_1722_timestamp_uncertain(seventeen22_header *h1722);
-void avb_set_1722_timestamp(seventeen22_header *h1722, uint64_t timestamp);
-uint64_t avb_get_1722_timestamp(seventeen22_header *h1722);
-void avb_set_1722_gateway_info(seventeen22_header *h1722, uint64_t gateway_info);
-uint64_t avb_get_1722_gateway_info(seventeen22_header *h1722);
-void avb_set_1722_length(seventeen22_header *h1722, uint64_t length);
-uint64_t avb_get_1722_length(seventeen22_header *h1722);
-void avb_set_1722_stream_id(seventeen22_header *h1722, uint64_t stream_id);
-uint64_t avb_get_1722_stream_id(seventeen22_header *h1722);
-void avb_set_1722_seq_number(seventeen22_header *h1722, uint64_t seq_number);
-uint64_t avb_get_1722_seq_number(seventeen22_header *h1722);
-
-void avb_set_61883_packet_channel(six1883_header *h61883, uint16_t packet_channel);
-uint16_t avb_get_61883_length(six1883_header *h61883);
-void avb_set_61883_format_tag(six1883_header *h61883, uint16_t format_tag);
-uint16_t avb_get_61883_format_tag(six1883_header *h61883);
-void avb_set_61883_app_control(six1883_header *h61883, uint16_t app_control);
-uint16_t avb_get_61883_app_control(six1883_header *h61883);
-void avb_set_61883_packet_tcode(six1883_header *h61883, uint16_t packet_tcode);
-uint16_t avb_get_61883_packet_tcode(six1883_header *h61883);
-void avb_set_61883_source_id(six1883_header *h61883, uint16_t source_id);
-uint16_t avb_get_61883_source_id(six1883_header *h61883);
-void avb_set_61883_reserved0(six1883_header *h61883, uint16_t reserved0);
-uint16_t avb_get_61883_reserved0(six1883_header *h61883);
-void avb_set_61883_data_block_size(six1883_header *h61883, uint16_t data_block_size);
-uint16_t avb_get_61883_data_block_size(six1883_header *h61883);
-void avb_set_61883_reserved1(six1883_header *h61883, uint16_t reserved1);
-uint16_t avb_get_61883_reserved1(six1883_header *h61883);
-void avb_set_61883_source_packet_header(six1883_header *h61883, uint16_t source_packet_header);
-uint16_t avb_get_61883_source_packet_header(six1883_header *h61883);
-void avb_set_61883_quadlet_padding_count(six1883_header *h61883, uint16_t quadlet_padding_count);
-uint16_t avb_get_61883_quadlet_padding_count(six1883_header *h61883);
-void avb_set_61883_fraction_number(six1883_header *h61883, uint16_t fraction_number);
-uint16_t avb_get_61883_fraction_number(six1883_header *h61883);
-void avb_set_61883_data_block_continuity(six1883_header *h61883, uint16_t data_block_continuity);
-uint16_t avb_get_61883_data_block_continuity(six1883_header *h61883);
-void avb_set_61883_format_id(six1883_header *h61883, uint16_t format_id);
-uint16_t avb_get_61883_format_id(six1883_header *h61883);
-void avb_set_61883_eoh(six1883_header *h61883, uint16_t eoh);
-uint16_t avb_get_61883_eoh(six1883_header *h61883);
-void avb_set_61883_format_dependent_field(six1883_header *h61883, uint16_t format_dependent_field);
-uint16_t avb_get_61883_format_dependent_field(six1883_header *h61883);
-void avb_set_61883_syt(six1883_header *h61883, uint16_t syt);
-uint16_t avb_get_61883_syt(six1883_header *h61883);
+/* setters & getters for seventeen22_header */
+static inline void avb_set_1722_cd_indicator(seventeen22_header *h1722, uint64_t cd_indicator)
+{
+	h1722->cd_indicator = cd_indicator;
+}
+
+static inline uint64_t avb_get_1722_cd_indicator(seventeen22_header *h1722)
+{
+	return h1722->cd_indicator;
+}
+
+static inline void avb_set_1722_subtype(seventeen22_header *h1722, uint64_t subtype)
+{
+	h1722->subtype = subtype;
+}
+
+static inline uint64_t avb_get_1722_subtype(seventeen22_header *h1722)
+{
+	return h1722->subtype;
+}
+
+static inline void avb_set_1722_sid_valid(seventeen22_header *h1722, uint64_t sid_valid)
+{
+	h1722->sid_valid = sid_valid;
+}
+
+static inline uint64_t avb_get_1722_sid_valid(seventeen22_header *h1722)
+{
+	return h1722->sid_valid;
+}
+
+static inline void avb_set_1722_version(seventeen22_header *h1722, uint64_t version)
+{
+	h1722->version = version;
+}
+
+static inline uint64_t avb_get_1722_version(seventeen22_header *h1722)
+{
+	return h1722->version;
+}
+
+static inline void avb_set_1722_reset(seventeen22_header *h1722, uint64_t reset)
+{
+	h1722->reset = reset;
+}
+
+static inline uint64_t avb_get_1722_reset(seventeen22_header *h1722)
+{
+	return h1722->reset;
+}
+
+static inline void avb_set_1722_reserved0(seventeen22_header *h1722, uint64_t reserved0)
+{
+	h1722->reserved0 = reserved0;
+}
+
+static inline uint64_t avb_get_1722_reserved0(seventeen22_header *h1722)
+{
+	return h1722->reserved0;
+}
+
+static inline void avb_set_1722_gateway_valid(seventeen22_header *h1722, uint64_t gateway_valid)
+{
+	h1722->gateway_valid = gateway_valid;
+}
+
+static inline uint64_t avb_get_1722_gateway_valid(seventeen22_header *h1722)
+{
+	return h1722->gateway_valid;
+}
+
+static inline void avb_set_1722_timestamp_valid(seventeen22_header *h1722, uint64_t timestamp_valid)
+{
+	h1722->timestamp_valid = timestamp_valid;
+}
+
+static inline uint64_t avb_get_1722_timestamp_valid(seventeen22_header *h1722)
+{
+	return h1722->timestamp_valid;
+}
+
+static inline void avb_set_1722_reserved1(seventeen22_header *h1722, uint64_t reserved1)
+{
+	h1722->reserved1 = reserved1;
+}
+
+static inline uint64_t avb_get_1722_reserved1(seventeen22_header *h1722)
+{
+	return h1722->reserved1;
+}
+
+static inline void avb_set_1722_stream_id(seventeen22_header *h1722, uint64_t stream_id)
+{
+	h1722->stream_id = stream_id;
+}
+
+static inline uint64_t avb_get_1722_stream_id(seventeen22_header *h1722)
+{
+	return h1722->stream_id;
+}
+
+static inline void avb_set_1722_seq_number(seventeen22_header *h1722, uint64_t seq_number)
+{
+	h1722->seq_number = seq_number;
+}
+
+static inline uint64_t avb_get_1722_seq_number(seventeen22_header *h1722)
+{
+	return h1722->seq_number;
+}
+
+static inline void avb_set_1722_timestamp_uncertain(seventeen22_header *h1722, uint64_t timestamp_uncertain)
+{
+	h1722->timestamp_uncertain = timestamp_uncertain;
+}
+
+static inline uint64_t avb_get_1722_timestamp_uncertain(seventeen22_header *h1722)
+{
+	return h1722->timestamp_uncertain;
+}
+
+static inline void avb_set_1722_timestamp(seventeen22_header *h1722, uint64_t timestamp)
+{
+	h1722->timestamp = timestamp;
+}
+
+static inline uint64_t avb_get_1722_timestamp(seventeen22_header *h1722)
+{
+	return h1722->timestamp;
+}
+
+static inline void avb_set_1722_gateway_info(seventeen22_header *h1722, uint64_t gateway_info)
+{
+	h1722->gateway_info = gateway_info;
+}
+
+static inline uint64_t avb_get_1722_gateway_info(seventeen22_header *h1722)
+{
+	return h1722->gateway_info;
+}
+
+static inline void avb_set_1722_length(seventeen22_header *h1722, uint64_t length)
+{
+	h1722->length = length;
+}
+
+static inline uint64_t avb_get_1722_length(seventeen22_header *h1722)
+{
+	return h1722->length;
+}
+
+/* setters & getters for six1883_header */
+static inline void avb_set_61883_packet_channel(six1883_header *h61883, uint16_t packet_channel)
+{
+	h61883->packet_channel = packet_channel;
+}
+
+static inline uint16_t avb_get_61883_length(six1883_header *h61883)
+{
+	return h61883->packet_channel;
+}
+
+static inline void avb_set_61883_format_tag(six1883_header *h61883, uint16_t format_tag)
+{
+	h61883->format_tag = format_tag;
+}
+
+static inline uint16_t avb_get_61883_format_tag(six1883_header *h61883)
+{
+	return h61883->format_tag;
+}
+
+static inline void avb_set_61883_app_control(six1883_header *h61883, uint16_t app_control)
+{
+	h61883->app_control = app_control;
+}
+
+static inline uint16_t avb_get_61883_app_control(six1883_header *h61883)
+{
+	return h61883->app_control;
+}
+
+static inline void avb_set_61883_packet_tcode(six1883_header *h61883, uint16_t packet_tcode)
+{
+	h61883->packet_tcode = packet_tcode;
+}
+
+static inline uint16_t avb_get_61883_packet_tcode(six1883_header *h61883)
+{
+	return h61883->packet_tcode;
+}
+
+static inline void avb_set_61883_source_id(six1883_header *h61883, uint16_t source_id)
+{
+	h61883->source_id = source_id;
+}
+
+static inline uint16_t avb_get_61883_source_id(six1883_header *h61883)
+{
+	return h61883->source_id;
+}
+
+static inline void avb_set_61883_reserved0(six1883_header *h61883, uint16_t reserved0)
+{
+	h61883->reserved0 = reserved0;
+}
+
+static inline uint16_t avb_get_61883_reserved0(six1883_header *h61883)
+{
+	return h61883->reserved0;
+}
+
+static inline void avb_set_61883_data_block_size(six1883_header *h61883, uint16_t data_block_size)
+{
+	h61883->data_block_size = data_block_size;
+}
+
+static inline uint16_t avb_get_61883_data_block_size(six1883_header *h61883)
+{
+	return h61883->data_block_size;
+}
+
+static inline void avb_set_61883_reserved1(six1883_header *h61883, uint16_t reserved1)
+{
+	h61883->reserved1 = reserved1;
+}
+
+static inline uint16_t avb_get_61883_reserved1(six1883_header *h61883)
+{
+	return h61883->reserved1;
+}
+
+static inline void avb_set_61883_source_packet_header(six1883_header *h61883, uint16_t source_packet_header)
+{
+	h61883->source_packet_header = source_packet_header;
+}
+
+static inline uint16_t avb_get_61883_source_packet_header(six1883_header *h61883)
+{
+	return h61883->source_packet_header;
+}
+
+static inline void avb_set_61883_quadlet_padding_count(six1883_header *h61883, uint16_t quadlet_padding_count)
+{
+	h61883->quadlet_padding_count = quadlet_padding_count;
+}
+
+static inline uint16_t avb_get_61883_quadlet_padding_count(six1883_header *h61883)
+{
+	return h61883->quadlet_padding_count;
+}
+
+static inline void avb_set_61883_fraction_number(six1883_header *h61883, uint16_t fraction_number)
+{
+	h61883->fraction_number = fraction_number;
+}
+
+static inline uint16_t avb_get_61883_fraction_number(six1883_header *h61883)
+{
+	return h61883->fraction_number;
+}
+
+static inline void avb_set_61883_data_block_continuity(six1883_header *h61883, uint16_t data_block_continuity)
+{
+	h61883->data_block_continuity = data_block_continuity;
+}
+
+static inline uint16_t avb_get_61883_data_block_continuity(six1883_header *h61883)
+{
+	return h61883->data_block_continuity;
+}
+
+static inline void avb_set_61883_format_id(six1883_header *h61883, uint16_t format_id)
+{
+	h61883->format_id = format_id;
+}
+
+static inline uint16_t avb_get_61883_format_id(six1883_header *h61883)
+{
+	return h61883->format_id;
+}
+
+static inline void avb_set_61883_eoh(six1883_header *h61883, uint16_t eoh)
+{
+	h61883->eoh = eoh;
+}
+
+static inline uint16_t avb_get_61883_eoh(six1883_header *h61883)
+{
+	return h61883->eoh;
+}
+
+static inline void avb_set_61883_format_dependent_field(six1883_header *h61883, uint16_t format_dependent_field)
+{
+	h61883->format_dependent_field = format_dependent_field;
+}
+
+static inline uint16_t avb_get_61883_format_dependent_field(six1883_header *h61883)
+{
+	return h61883->format_dependent_field;
+}
+
+static inline void avb_set_61883_syt(six1883_header *h61883, uint16_t syt)
+{
+	h61883->syt = syt;
+}
+
+static inline uint16_t avb_get_61883_syt(six1883_header *h61883)
+{
+	return h61883->syt;
+}
+
+/*
+ * Big endian loads and stores for the wire format. The byte swap, if any,
+ * is picked at compile time and folds into a single load or store.
+ */
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define AVB_BE16(x) __builtin_bswap16(x)
+#define AVB_BE32(x) __builtin_bswap32(x)
+#define AVB_BE64(x) __builtin_bswap64(x)
+#else
+#define AVB_BE16(x) (x)
+#define AVB_BE32(x) (x)
+#define AVB_BE64(x) (x)
+#endif
+
+static inline uint16_t avb_get_be16(const void *p)
+{
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return AVB_BE16(v);
+}
+
+static inline uint32_t avb_get_be32(const void *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return AVB_BE32(v);
+}
+
+static inline uint64_t avb_get_be64(const void *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return AVB_BE64(v);
+}
+
+static inline void avb_put_be16(void *p, uint16_t v)
+{
+	v = AVB_BE16(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void avb_put_be32(void *p, uint32_t v)
+{
+	v = AVB_BE32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void avb_put_be64(void *p, uint64_t v)
+{
+	v = AVB_BE64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+/* 1722 stream header followed by the 61883 CIP header */
+#define AVB_61883_HDR_LEN (sizeof(seventeen22_header) + sizeof(six1883_header))
+
+/*
+ * All fields of an IEC 61883 stream's headers, in host order. The per
+ * frame ones are seq_number, timestamp_valid, timestamp, length and
+ * data_block_continuity; the others usually stay as set up once.
+ */
+struct avb_61883_hdr {
+	/* 1722 */
+	uint8_t subtype;
+	uint8_t cd_indicator;
+	uint8_t sid_valid;
+	uint8_t version;
+	uint8_t reset;
+	uint8_t gateway_valid;
+	uint8_t timestamp_valid;
+	uint8_t seq_number;
+	uint8_t timestamp_uncertain;
+	uint64_t stream_id;
+	uint32_t timestamp;
+	uint32_t gateway_info;
+	uint16_t length;	/* stream data length, CIP header included */
+	/* 61883 */
+	uint8_t format_tag;
+	uint8_t packet_channel;
+	uint8_t packet_tcode;
+	uint8_t app_control;
+	uint8_t source_id;
+	uint8_t data_block_size;
+	uint8_t fraction_number;
+	uint8_t quadlet_padding_count;
+	uint8_t source_packet_header;
+	uint8_t data_block_continuity;
+	uint8_t eoh;
+	uint8_t format_id;
+	uint8_t format_dependent_field;
+	uint16_t syt;
+};
+
+/* Write both headers, AVB_61883_HDR_LEN bytes, in one pass */
+static inline void avb_61883_hdr_compose(void *hdr, const struct avb_61883_hdr *f)
+{
+	uint8_t *p = (uint8_t *)hdr;
+
+	p[0] = (f->cd_indicator << 7) | (f->subtype & 0x7f);
+	p[1] = (f->sid_valid << 7) | ((f->version & 0x7) << 4) | (f->reset << 3) |
+		(f->gateway_valid << 1) | f->timestamp_valid;
+	p[2] = f->seq_number;
+	p[3] = f->timestamp_uncertain;
+	avb_put_be64(p + 4, f->stream_id);
+	avb_put_be32(p + 12, f->timestamp);
+	avb_put_be32(p + 16, f->gateway_info);
+	avb_put_be16(p + 20, f->length);
+	p[22] = (f->format_tag << 6) | (f->packet_channel & 0x3f);
+	p[23] = (f->packet_tcode << 4) | (f->app_control & 0xf);
+	p[24] = f->source_id & 0x3f;
+	p[25] = f->data_block_size;
+	p[26] = (f->fraction_number << 6) | ((f->quadlet_padding_count & 0x7) << 3) |
+		(f->source_packet_header << 2);
+	p[27] = f->data_block_continuity;
+	p[28] = (f->eoh << 6) | (f->format_id & 0x3f);
+	p[29] = f->format_dependent_field;
+	avb_put_be16(p + 30, f->syt);
+}
+
+/* Read both headers into host order fields */
+static inline void avb_61883_hdr_parse(const void *hdr, struct avb_61883_hdr *f)
+{
+	const uint8_t *p = (const uint8_t *)hdr;
+
+	f->cd_indicator = p[0] >> 7;
+	f->subtype = p[0] & 0x7f;
+	f->sid_valid = p[1] >> 7;
+	f->version = (p[1] >> 4) & 0x7;
+	f->reset = (p[1] >> 3) & 0x1;
+	f->gateway_valid = (p[1] >> 1) & 0x1;
+	f->timestamp_valid = p[1] & 0x1;
+	f->seq_number = p[2];
+	f->timestamp_uncertain = p[3] & 0x1;
+	f->stream_id = avb_get_be64(p + 4);
+	f->timestamp = avb_get_be32(p + 12);
+	f->gateway_info = avb_get_be32(p + 16);
+	f->length = avb_get_be16(p + 20);
+	f->format_tag = p[22] >> 6;
+	f->packet_channel = p[22] & 0x3f;
+	f->packet_tcode = p[23] >> 4;
+	f->app_control = p[23] & 0xf;
+	f->source_id = p[24] & 0x3f;
+	f->data_block_size = p[25];
+	f->fraction_number = p[26] >> 6;
+	f->quadlet_padding_count = (p[26] >> 3) & 0x7;
+	f->source_packet_header = (p[26] >> 2) & 0x1;
+	f->data_block_continuity = p[27];
+	f->eoh = p[28] >> 6;
+	f->format_id = p[28] & 0x3f;
+	f->format_dependent_field = p[29];
+	f->syt = avb_get_be16(p + 30);
+}
+
+/*
+ * Fill in the per frame fields. With tmpl set (headers composed once with
+ * avb_61883_hdr_compose()), the rest of the headers is copied from it
+ * first; without, the headers at hdr are expected to be set up already.
+ */
+static inline void avb_61883_hdr_stamp(void *hdr, const void *tmpl,
+				       uint8_t seq_number, int timestamp_valid,
+				       uint32_t timestamp, uint16_t length,
+				       uint8_t data_block_continuity)
+{
+	uint8_t *p = (uint8_t *)hdr;
+
+	if (tmpl)
+		memcpy(p, tmpl, AVB_61883_HDR_LEN);
+	p[1] = (p[1] & ~0x1) | (timestamp_valid ? 0x1 : 0x0);
+	p[2] = seq_number;
+	avb_put_be32(p + 12, timestamp);
+	avb_put_be16(p + 20, length);
+	p[27] = data_block_continuity;
+}
 
 void * avb_create_packet(uint32_t payload_len);
 
@@ -3,11 +3,16 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 /**
  * @brief Open the memory mapping used for IPC
@@ -15,13 +20,28 @@
  * @param shm_map [inout] Pointer to mapping
  * @return 0 for success, negative for failure
  */
-
 int gptpinit(int *shm_fd, char **shm_map)
+{
+	return gptpinitname(SHM_NAME, shm_fd, shm_map);
+}
+
+/**
+ * @brief Open the memory mapping of a gptp started with -SHM <name>,
+ * one per network when a host drives several interfaces
+ * @param shm_name [in] Shared memory name, NULL for SHM_NAME
+ * @param shm_fd [inout] File descriptor for mapping
+ * @param shm_map [inout] Pointer to mapping
+ * @return 0 for success, negative for failure
+ */
+int gptpinitname(const char *shm_name, int *shm_fd, char **shm_map)
 {
 	if (NULL == shm_fd || NULL == shm_map) {
 		return -1;
 	}
-	*shm_fd = shm_open(SHM_NAME, O_RDWR, 0);
+	if (NULL == shm_name) {
+		shm_name = SHM_NAME;
+	}
+	*shm_fd = shm_open(shm_name, O_RDWR, 0);
 	if (*shm_fd == -1) {
 		perror("shm_open()");
 		return -1;
@@ -31,7 +51,7 @@ int gptpinit(int *shm_fd, char **shm_map)
 	if ((char*)-1 == *shm_map) {
 		perror("mmap()");
 		*shm_map = NULL;
-		shm_unlink(SHM_NAME);
+		shm_unlink(shm_name);
 		return -1;
 	}
 	return 0;
@@ -69,6 +89,266 @@ int gptpdeinit(int *shm_fd, char **shm_map)
 	return ret;
 }
 
+/**
+ * @brief Read the ptp data from the seqlock block without blocking gptp
+ * @param sl [in] Seqlock block in the mapping
+ * @param td [inout] Struct to read the data into
+ */
+
+static uint32_t gptpgetdata_seqlock(const gPtpSeqlockData *sl, gPtpTimeData *td)
+{
+	size_t size = sizeof(*td);
+	uint32_t seq;
+
+	if (sl->data_size < size)
+		size = sl->data_size;
+
+	for (;;) {
+		seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			/* gptp is in the middle of an update */
+			sched_yield();
+			continue;
+		}
+		memcpy(td, &sl->data, size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&sl->seq, __ATOMIC_RELAXED) == seq)
+			break;
+	}
+	return seq;
+}
+
+static const gPtpSeqlockData *gptpseqlock(const char *shm_map)
+{
+	const gPtpSeqlockData *sl;
+
+	sl = (const gPtpSeqlockData *)(shm_map + GPTP_SHM_SEQLOCK_OFFSET);
+	if (__atomic_load_n(&sl->magic, __ATOMIC_ACQUIRE) == GPTP_SHM_SEQLOCK_MAGIC
+	    && sl->version == GPTP_SHM_SEQLOCK_VERSION)
+		return sl;
+	return NULL;
+}
+
+/**
+ * @brief Read the current gPTP update counter
+ * @param shm_map [in] Pointer to mapping
+ * @param seq [out] Counter; changes whenever gptp publishes new data
+ * @return 0 for success, negative if gptp has no seqlock block
+ */
+
+int gptpgetseq(char *shm_map, uint32_t *seq)
+{
+	const gPtpSeqlockData *sl;
+
+	if (NULL == shm_map || NULL == seq) {
+		return -1;
+	}
+	if ((sl = gptpseqlock(shm_map)) == NULL) {
+		return -1;
+	}
+	*seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE) & ~1u;
+	return 0;
+}
+
+/**
+ * @brief Read the ptp data and the update counter it belongs to
+ * @param shm_map [in] Pointer to mapping
+ * @param td [inout] Struct to read the data into
+ * @param seq [out] Update counter, see gptpgetseq()
+ * @return 0 for success, negative for failure or no seqlock block
+ */
+
+int gptpgetdataseq(char *shm_map, gPtpTimeData *td, uint32_t *seq)
+{
+	const gPtpSeqlockData *sl;
+
+	if (NULL == shm_map || NULL == td || NULL == seq) {
+		return -1;
+	}
+	if ((sl = gptpseqlock(shm_map)) == NULL) {
+		return -1;
+	}
+	*seq = gptpgetdata_seqlock(sl, td);
+	return 0;
+}
+
+/**
+ * @brief Read the system to gPTP time model without blocking gptp
+ * @param shm_map [in] Pointer to mapping
+ * @param model [out] Model copy
+ * @return 0 for success, negative if gptp publishes no valid model
+ */
+
+int gptpgetsysmodel(char *shm_map, gPtpSysModel *model)
+{
+	const gPtpSysModel *sm;
+	uint32_t seq;
+
+	if (NULL == shm_map || NULL == model) {
+		return -1;
+	}
+	sm = (const gPtpSysModel *)(shm_map + GPTP_SHM_MODEL_OFFSET);
+	if (__atomic_load_n(&sm->magic, __ATOMIC_ACQUIRE) != GPTP_SHM_MODEL_MAGIC
+	    || sm->version != GPTP_SHM_MODEL_VERSION) {
+		return -1;
+	}
+
+	for (;;) {
+		seq = __atomic_load_n(&sm->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+		memcpy(model, sm, sizeof(*model));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&sm->seq, __ATOMIC_RELAXED) == seq)
+			break;
+	}
+
+	return model->valid ? 0 : -1;
+}
+
+/**
+ * @brief Read the ptp data of one gPTP domain without blocking gptp
+ * @param shm_map [in] Pointer to mapping
+ * @param domain [in] gPTP domain number
+ * @param td [inout] Struct to read the data into
+ * @param seq [out] Changes whenever gptp publishes new data of the domain, may be NULL
+ * @return 0 for success, negative if gptp has no sync result of the domain
+ */
+
+int gptpgetdomaindata(char *shm_map, uint8_t domain, gPtpTimeData *td, uint32_t *seq)
+{
+	const gPtpDomainRegion *region;
+	const gPtpDomainSlot *slot;
+	size_t size = sizeof(*td);
+	uint32_t count, i, s;
+	int found;
+
+	if (NULL == shm_map || NULL == td) {
+		return -1;
+	}
+	region = (const gPtpDomainRegion *)(shm_map + GPTP_SHM_DOMAIN_OFFSET);
+	if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != GPTP_SHM_DOMAIN_MAGIC
+	    || region->version != GPTP_SHM_DOMAIN_VERSION
+	    || region->slot_size < offsetof(gPtpDomainSlot, data)) {
+		return -1;
+	}
+	if (region->slot_size - offsetof(gPtpDomainSlot, data) < size)
+		size = region->slot_size - offsetof(gPtpDomainSlot, data);
+
+	count = __atomic_load_n(&region->domain_count, __ATOMIC_ACQUIRE);
+	if (count > GPTP_SHM_MAX_DOMAINS)
+		count = GPTP_SHM_MAX_DOMAINS;
+	for (i = 0; i < count; i++) {
+		/* slots follow the header at gptp's stride */
+		slot = (const gPtpDomainSlot *)((const char *)(region + 1)
+			+ i * region->slot_size);
+		for (;;) {
+			s = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+			if (s & 1) {
+				sched_yield();
+				continue;
+			}
+			found = slot->valid && slot->data.gptp_domain_number == domain;
+			if (found)
+				memcpy(td, &slot->data, size);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == s)
+				break;
+		}
+		if (found) {
+			if (seq != NULL)
+				*seq = s;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static gPtpNotify *gptpnotify(char *shm_map)
+{
+	gPtpNotify *n;
+
+	n = (gPtpNotify *)(shm_map + GPTP_SHM_NOTIFY_OFFSET);
+	if (__atomic_load_n(&n->magic, __ATOMIC_ACQUIRE) == GPTP_SHM_NOTIFY_MAGIC
+	    && n->version == GPTP_SHM_NOTIFY_VERSION)
+		return n;
+	return NULL;
+}
+
+/**
+ * @brief Read the gPTP update counters
+ * @param shm_map [in] Pointer to mapping
+ * @param update_count [out] Goes up with every new sync result and grandmaster change
+ * @param gm_count [out] Goes up with every grandmaster change, may be NULL
+ * @return 0 for success, negative if gptp publishes no counters
+ */
+
+int gptpgetupdate(char *shm_map, uint32_t *update_count, uint32_t *gm_count)
+{
+	const gPtpNotify *n;
+
+	if (NULL == shm_map || NULL == update_count) {
+		return -1;
+	}
+	if ((n = gptpnotify(shm_map)) == NULL) {
+		return -1;
+	}
+	if (gm_count != NULL) {
+		*gm_count = __atomic_load_n(&n->gm_count, __ATOMIC_ACQUIRE);
+	}
+	*update_count = __atomic_load_n(&n->update_count, __ATOMIC_ACQUIRE);
+	return 0;
+}
+
+/**
+ * @brief Sleep until gptp publishes an update
+ * @param shm_map [in] Pointer to mapping
+ * @param last [in] Update count the caller already has
+ * @param timeout_usec [in] Longest wait, 0 waits forever
+ * @param update_count [out] Current update count, equal to last on timeout
+ * @return 0 for success, negative if gptp publishes no counters
+ */
+
+int gptpwaitupdate(char *shm_map, uint32_t last, uint32_t timeout_usec, uint32_t *update_count)
+{
+	gPtpNotify *n;
+	struct timespec timeout, *ptimeout = NULL;
+	uint32_t count;
+
+	if (NULL == shm_map || NULL == update_count) {
+		return -1;
+	}
+	if ((n = gptpnotify(shm_map)) == NULL) {
+		return -1;
+	}
+	if (timeout_usec) {
+		timeout.tv_sec = timeout_usec / 1000000;
+		timeout.tv_nsec = (timeout_usec % 1000000) * 1000;
+		ptimeout = &timeout;
+	}
+
+	/* gptp only wakes the futex when it sees a waiter, so announce
+	 * ourselves before the last look at the counter */
+	__atomic_add_fetch(&n->waiters, 1, __ATOMIC_SEQ_CST);
+	count = __atomic_load_n(&n->update_count, __ATOMIC_SEQ_CST);
+	if (count == last) {
+		/* EAGAIN: it moved meanwhile, EINTR: let the caller look again */
+		if (syscall(SYS_futex, &n->update_count, FUTEX_WAIT, last,
+			    ptimeout, NULL, 0) == -1 && errno != EAGAIN
+		    && errno != ETIMEDOUT && errno != EINTR) {
+			__atomic_sub_fetch(&n->waiters, 1, __ATOMIC_SEQ_CST);
+			return -1;
+		}
+		count = __atomic_load_n(&n->update_count, __ATOMIC_ACQUIRE);
+	}
+	__atomic_sub_fetch(&n->waiters, 1, __ATOMIC_SEQ_CST);
+
+	*update_count = count;
+	return 0;
+}
+
 /**
  * @brief Read the ptp data from IPC memory
  * @param shm_map [in] Pointer to mapping
@@ -78,9 +358,18 @@ int gptpdeinit(int *shm_fd, char **shm_map)
 
 int gptpgetdata(char *shm_map, gPtpTimeData *td)
 {
+	const gPtpSeqlockData *sl;
+
 	if (NULL == shm_map || NULL == td) {
 		return -1;
 	}
+
+	if ((sl = gptpseqlock(shm_map)) != NULL) {
+		gptpgetdata_seqlock(sl, td);
+		return 0;
+	}
+
+	/* older gptp: fall back to the shared mutex */
 	pthread_mutex_lock((pthread_mutex_t *) shm_map);
 	memcpy(td, shm_map + sizeof(pthread_mutex_t), sizeof(*td));
 	pthread_mutex_unlock((pthread_mutex_t *) shm_map);
@@ -147,3 +436,31 @@ bool gptpmaster2local(const gPtpTimeData *td, const uint64_t master, uint64_t *l
 
 	return true;
 }
+
+bool gptplocal2master(const gPtpTimeData *td, const uint64_t local, uint64_t *master)
+{
+	int64_t delta_local;
+	int64_t delta_8021as;
+
+	if (!td || !master)
+		return false;
+
+	delta_local = local - td->local_time;
+	delta_8021as = td->ml_freqoffset * delta_local;
+	*master = td->local_time - td->ml_phoffset + delta_8021as;
+
+	return true;
+}
+
+bool gptpsys2ptp(const gPtpSysModel *model, const uint64_t sys, uint64_t *ptp)
+{
+	int64_t delta_system;
+
+	if (!model || !ptp || !model->valid)
+		return false;
+
+	delta_system = sys - model->sys_base;
+	*ptp = model->ptp_base + (int64_t)(model->rate * delta_system);
+
+	return true;
+}
@@ -3,9 +3,13 @@
 
 #include <inttypes.h>
 
-#define SHM_SIZE (4*8 + sizeof(pthread_mutex_t)) /* 3 - 64 bit and 2 - 32 bits */
 #define SHM_NAME  "/ptp"
 
+/* Lock free copy of the time data published by gptp (see linux_ipc.hpp) */
+#define GPTP_SHM_SEQLOCK_OFFSET		512
+#define GPTP_SHM_SEQLOCK_MAGIC		0x67505453
+#define GPTP_SHM_SEQLOCK_VERSION	1
+
 typedef long double FrequencyRatio;
 
 typedef struct {
@@ -35,16 +39,87 @@ typedef struct {
 	uint16_t port_number;					/* The portNumber field of the interface, or 0x0000 if not supported */
 } gPtpTimeData;
 
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;			/* odd while gptp is writing */
+	uint32_t data_size;		/* sizeof(gPtpTimeData) in gptp, may be larger than ours */
+	gPtpTimeData data;
+} gPtpSeqlockData;
+
+/* Filtered CLOCK_REALTIME to gPTP time model published by gptp:
+ * ptp ~= ptp_base + (realtime - sys_base) * rate */
+#define GPTP_SHM_MODEL_OFFSET		1024
+#define GPTP_SHM_MODEL_MAGIC		0x6750544D
+#define GPTP_SHM_MODEL_VERSION		1
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;			/* odd while gptp is writing */
+	uint32_t interval_us;	/* update period */
+	int64_t sys_base;		/* CLOCK_REALTIME at the model base (ns) */
+	int64_t ptp_base;		/* gPTP time at sys_base (ns) */
+	FrequencyRatio rate;	/* gPTP time elapsed per system time */
+	uint32_t valid;			/* non-zero once synchronized */
+} gPtpSysModel;
+
+/* Update counters published by gptp; a client may FUTEX_WAIT on update_count
+ * after incrementing waiters, see gptpwaitupdate() */
+#define GPTP_SHM_NOTIFY_OFFSET		1536
+#define GPTP_SHM_NOTIFY_MAGIC		0x6750544E
+#define GPTP_SHM_NOTIFY_VERSION		1
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t update_count;	/* new sync result published */
+	uint32_t gm_count;		/* grandmaster changed */
+	uint32_t waiters;		/* clients blocked on update_count */
+} gPtpNotify;
+
+/* Time data of every gPTP domain gptp follows, slot 0 being the one its
+ * clock is disciplined to; see gptpgetdomaindata() */
+#define GPTP_SHM_DOMAIN_OFFSET		2048
+#define GPTP_SHM_DOMAIN_MAGIC		0x67505444
+#define GPTP_SHM_DOMAIN_VERSION		1
+#define GPTP_SHM_MAX_DOMAINS		4
+
+typedef struct {
+	uint32_t seq;			/* odd while gptp is writing */
+	uint32_t valid;			/* non-zero once the domain has a sync result */
+	gPtpTimeData data;		/* gptp_domain_number identifies the domain */
+} gPtpDomainSlot;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t domain_count;	/* slots in use */
+	uint32_t slot_size;		/* sizeof(gPtpDomainSlot) in gptp, may be larger than ours */
+} gPtpDomainRegion;			/* followed by the slots */
+
+/* Map the first page, which holds every block up to the domain region; this is safe even with an older gptp */
+#define SHM_SIZE 4096
+
 /*TODO fix this*/
 #ifndef false
 typedef enum { false = 0, true = 1 } bool;
 #endif
 
 int gptpinit(int *shm_fd, char **shm_map);
+int gptpinitname(const char *shm_name, int *shm_fd, char **shm_map);
 int gptpdeinit(int *shm_fd, char **shm_map);
 int gptpgetdata(char *shm_mmap, gPtpTimeData *td);
+int gptpgetseq(char *shm_mmap, uint32_t *seq);
+int gptpgetdataseq(char *shm_mmap, gPtpTimeData *td, uint32_t *seq);
 int gptpscaling(char *shm_mmap, gPtpTimeData *td);
+int gptpgetsysmodel(char *shm_mmap, gPtpSysModel *model);
+int gptpgetdomaindata(char *shm_mmap, uint8_t domain, gPtpTimeData *td, uint32_t *seq);
+int gptpgetupdate(char *shm_mmap, uint32_t *update_count, uint32_t *gm_count);
+int gptpwaitupdate(char *shm_mmap, uint32_t last, uint32_t timeout_usec, uint32_t *update_count);
 bool gptplocaltime(const gPtpTimeData * td, uint64_t* now_local);
+bool gptpsys2ptp(const gPtpSysModel *model, const uint64_t sys, uint64_t *ptp);
 bool gptpmaster2local(const gPtpTimeData *td, const uint64_t master, uint64_t *local);
+bool gptplocal2master(const gPtpTimeData *td, const uint64_t local, uint64_t *master);
 
 #endif
@@ -21,15 +21,42 @@
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
 #include <pci/pci.h>
 
 /**
- * @brief Connect to the network card
+ * @brief Find the PCI address of a network interface
+ * @param ifname [in] Network interface name
+ * @param devpath [out] PCI address, "dddd:bb:dd.f"
+ * @return 0 for success, errno for failure
+ */
+int pci_devpath_of(const char *ifname, char devpath[IGB_BIND_NAMESZ])
+{
+	char link[256], target[256];
+	ssize_t len;
+	char *base;
+
+	snprintf(link, sizeof(link), "/sys/class/net/%s/device", ifname);
+	len = readlink(link, target, sizeof(target) - 1);
+	if (len < 0)
+		return errno;
+	target[len] = '\0';
+
+	base = strrchr(target, '/');
+	base = base ? base + 1 : target;
+	if (strlen(base) >= IGB_BIND_NAMESZ)
+		return ENAMETOOLONG;
+	strcpy(devpath, base);
+	return 0;
+}
+
+/**
+ * @brief Connect to the first network card, or the one at a PCI address
  * @param igb_dev [inout] Device handle
+ * @param match [in] PCI address to attach to, NULL for any
  * @return 0 for success, ENXIO for failure
  */
-
-int pci_connect(device_t *igb_dev)
+static int pci_connect_match(device_t *igb_dev, const char *match)
 {
 	char devpath[IGB_BIND_NAMESZ];
 	struct pci_access *pacc;
@@ -51,6 +78,9 @@ int pci_connect(device_t *igb_dev)
 		igb_dev->func = dev->func;
 		snprintf(devpath, IGB_BIND_NAMESZ, "%04x:%02x:%02x.%d",
 				dev->domain, dev->bus, dev->dev, dev->func);
+		if (match && strcmp(devpath, match) != 0) {
+			continue;
+		}
 		err = igb_probe(igb_dev);
 		if (err) {
 			continue;
@@ -75,3 +105,35 @@ out:
 	pci_cleanup(pacc);
 	return 0;
 }
+
+/**
+ * @brief Connect to the network card
+ * @param igb_dev [inout] Device handle
+ * @return 0 for success, ENXIO for failure
+ */
+int pci_connect(device_t *igb_dev)
+{
+	return pci_connect_match(igb_dev, NULL);
+}
+
+/**
+ * @brief Connect to the network card behind a network interface
+ * @param igb_dev [inout] Device handle
+ * @param ifname [in] Network interface name, NULL for the first card found
+ * @return 0 for success, errno for failure
+ */
+int pci_connect_if(device_t *igb_dev, const char *ifname)
+{
+	char devpath[IGB_BIND_NAMESZ];
+	int err;
+
+	if (!ifname || !ifname[0])
+		return pci_connect_match(igb_dev, NULL);
+
+	err = pci_devpath_of(ifname, devpath);
+	if (err) {
+		printf("no PCI device for %s (%s)\n", ifname, strerror(err));
+		return err;
+	}
+	return pci_connect_match(igb_dev, devpath);
+}
@@ -6,5 +6,7 @@
 #define IGB_BIND_NAMESZ 24
 
 int pci_connect(device_t * igb_dev);
+int pci_connect_if(device_t * igb_dev, const char *ifname);
+int pci_devpath_of(const char *ifname, char devpath[IGB_BIND_NAMESZ]);
 
 #endif
@@ -0,0 +1,401 @@
+#include "avb_tonegen.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Short periods are repeated in the table up to at least this many frames so
+ * a fill still moves large blocks at a time.
+ */
+#define TONEGEN_MIN_FRAMES 256
+
+static unsigned gcd(unsigned a, unsigned b)
+{
+	while (b) {
+		unsigned t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static void encode(uint8_t *dst, avb_tonegen_format format, double x)
+{
+	uint32_t q;
+	int32_t s32;
+	int16_t s16;
+	float f;
+
+	if (x > 1.0)
+		x = 1.0;
+	else if (x < -1.0)
+		x = -1.0;
+	s32 = (int32_t)(x * 2147483647.0);
+
+	switch (format) {
+	case AVB_TONEGEN_AM824:
+		q = htonl(0x40000000 | ((uint32_t)s32 >> 8));
+		memcpy(dst, &q, 4);
+		break;
+	case AVB_TONEGEN_S32_BE:
+		q = htonl((uint32_t)s32);
+		memcpy(dst, &q, 4);
+		break;
+	case AVB_TONEGEN_S24_BE:
+		q = htonl((uint32_t)s32);
+		memcpy(dst, &q, 3);
+		break;
+	case AVB_TONEGEN_S16_BE:
+		s16 = (int16_t)(x * 32767.0);
+		s16 = htons(s16);
+		memcpy(dst, &s16, 2);
+		break;
+	case AVB_TONEGEN_FLOAT_BE:
+		f = (float)x;
+		memcpy(&q, &f, 4);
+		q = htonl(q);
+		memcpy(dst, &q, 4);
+		break;
+	}
+}
+
+/**
+ * @brief Build the table for a sine of hz at the given sample rate
+ * @param tg [out] Generator to initialize
+ * @param format [in] Encoding of each sample
+ * @param rate [in] Sample rate in Hz
+ * @param hz [in] Tone frequency, 0 for silence
+ * @param channels [in] Number of interleaved channels, all carrying the tone
+ * @param gain [in] Amplitude as a fraction of full scale
+ * @param phase_step [in] Phase lead of each channel over the previous one,
+ *	in radians
+ * @return 0 for success, negative for failure
+ */
+int avb_tonegen_init(struct avb_tonegen *tg, avb_tonegen_format format,
+		     unsigned rate, unsigned hz, unsigned channels,
+		     double gain, double phase_step)
+{
+	unsigned frames, i, c;
+	uint8_t *p;
+	uint8_t sample[4];
+
+	memset(tg, 0, sizeof(*tg));
+	if (rate == 0 || channels == 0)
+		return -EINVAL;
+
+	switch (format) {
+	case AVB_TONEGEN_S24_BE:
+		tg->width = 3;
+		break;
+	case AVB_TONEGEN_S16_BE:
+		tg->width = 2;
+		break;
+	case AVB_TONEGEN_AM824:
+	case AVB_TONEGEN_S32_BE:
+	case AVB_TONEGEN_FLOAT_BE:
+		tg->width = 4;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* sin(2 pi n hz / rate) repeats exactly every rate / gcd(rate, hz) */
+	tg->period = hz ? rate / gcd(rate, hz) : 1;
+	tg->format = format;
+	tg->hz = hz;
+	tg->channels = channels;
+	tg->frame_bytes = channels * tg->width;
+
+	frames = tg->period;
+	if (frames < TONEGEN_MIN_FRAMES)
+		frames *= (TONEGEN_MIN_FRAMES + tg->period - 1) / tg->period;
+
+	tg->table = malloc((size_t)frames * tg->frame_bytes);
+	if (NULL == tg->table)
+		return -ENOMEM;
+
+	p = tg->table;
+	for (i = 0; i < tg->period; ++i) {
+		double phase = 2 * M_PI * i * (double)hz / rate;
+
+		if (phase_step == 0)
+			encode(sample, format, gain * sin(phase));
+		for (c = 0; c < channels; ++c) {
+			if (phase_step != 0)
+				encode(sample, format,
+				       gain * sin(phase + c * phase_step));
+			memcpy(p, sample, tg->width);
+			p += tg->width;
+		}
+	}
+	for (; i < frames; i += tg->period) {
+		memcpy(p, tg->table, (size_t)tg->period * tg->frame_bytes);
+		p += tg->period * tg->frame_bytes;
+	}
+	tg->table_frames = frames;
+
+	return 0;
+}
+
+void avb_tonegen_free(struct avb_tonegen *tg)
+{
+	free(tg->table);
+	tg->table = NULL;
+}
+
+/**
+ * @brief Copy frames of the tone out of the table
+ * @param tg [in] Initialized generator
+ * @param index [in] Position in the period to start from
+ * @param dst [out] First frame to write
+ * @param frames [in] Number of frames to write
+ * @param stride [in] Bytes from one frame to the next in dst, at least
+ *	tg->frame_bytes; anything past frame_bytes is left untouched
+ * @return Position in the period following the last frame written
+ */
+unsigned avb_tonegen_fill(const struct avb_tonegen *tg, unsigned index,
+			  void *dst, unsigned frames, unsigned stride)
+{
+	uint8_t *out = dst;
+	unsigned run;
+
+	index %= tg->period;
+
+	if (stride == tg->frame_bytes) {
+		while (frames) {
+			run = tg->table_frames - index;
+			if (run > frames)
+				run = frames;
+			memcpy(out, tg->table + (size_t)index * tg->frame_bytes,
+			       (size_t)run * tg->frame_bytes);
+			out += (size_t)run * tg->frame_bytes;
+			frames -= run;
+			index = (index + run) % tg->period;
+		}
+		return index;
+	}
+
+	while (frames--) {
+		memcpy(out, tg->table + (size_t)index * tg->frame_bytes,
+		       tg->frame_bytes);
+		out += stride;
+		if (++index == tg->period)
+			index = 0;
+	}
+	return index;
+}
+
+static unsigned sample_bits(avb_tonegen_format format)
+{
+	switch (format) {
+	case AVB_TONEGEN_S32_BE:
+		return 32;
+	case AVB_TONEGEN_AM824:
+	case AVB_TONEGEN_S24_BE:
+		return 24;
+	case AVB_TONEGEN_S16_BE:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+/* Sample value of the integrity pattern, right aligned in 'bits' */
+static inline uint32_t pattern_value(unsigned bits, unsigned channel,
+				     uint32_t seq)
+{
+	uint32_t mask = (1U << (bits - 8)) - 1;
+
+	return ((uint32_t)(channel & 0xFF) << (bits - 8)) | (seq & mask);
+}
+
+static inline void put_sample(uint8_t *p, avb_tonegen_format format,
+			      uint32_t v)
+{
+	switch (format) {
+	case AVB_TONEGEN_AM824:
+		p[0] = 0x40;
+		p[1] = v >> 16;
+		p[2] = v >> 8;
+		p[3] = v;
+		break;
+	case AVB_TONEGEN_S32_BE:
+		p[0] = v >> 24;
+		p[1] = v >> 16;
+		p[2] = v >> 8;
+		p[3] = v;
+		break;
+	case AVB_TONEGEN_S24_BE:
+		p[0] = v >> 16;
+		p[1] = v >> 8;
+		p[2] = v;
+		break;
+	default:
+		p[0] = v >> 8;
+		p[1] = v;
+		break;
+	}
+}
+
+static inline uint32_t get_sample(const uint8_t *p, avb_tonegen_format format)
+{
+	switch (format) {
+	case AVB_TONEGEN_AM824:
+		return (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+	case AVB_TONEGEN_S32_BE:
+		return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+			(uint32_t)p[2] << 8 | p[3];
+	case AVB_TONEGEN_S24_BE:
+		return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+	default:
+		return (uint32_t)p[0] << 8 | p[1];
+	}
+}
+
+/**
+ * @brief Write frames of the integrity pattern
+ * @param format [in] Integer or AM824 encoding; float is not supported
+ * @param channels [in] Channels per frame
+ * @param seq [in] Frame counter of the first frame
+ * @param dst [out] First frame to write
+ * @param frames [in] Number of frames to write
+ * @param stride [in] Bytes from one frame to the next in dst
+ * @return Frame counter following the last frame written
+ */
+uint32_t avb_tonegen_pattern(avb_tonegen_format format, unsigned channels,
+			     uint32_t seq, void *dst, unsigned frames,
+			     unsigned stride)
+{
+	unsigned bits = sample_bits(format);
+	unsigned width = format == AVB_TONEGEN_AM824 ? 4 : bits / 8;
+	uint8_t *out = dst;
+	unsigned c;
+
+	if (bits == 0)
+		return seq;
+
+	for (; frames; --frames, ++seq, out += stride)
+		for (c = 0; c < channels; ++c)
+			put_sample(out + c * width, format,
+				   pattern_value(bits, c, seq));
+	return seq;
+}
+
+/**
+ * @brief Verify frames written by avb_tonegen_pattern()
+ * @param format [in] Encoding the pattern was written in
+ * @param channels [in] Channels per frame
+ * @param seq [inout] Expected frame counter, advanced past the frames
+ *	checked and resynchronized to the received counter on a mismatch;
+ *	AVB_TONEGEN_PATTERN_SYNC to take it from the first frame
+ * @param src [in] First frame to check
+ * @param frames [in] Number of frames to check
+ * @param stride [in] Bytes from one frame to the next in src
+ * @return Number of frames that did not match
+ */
+unsigned avb_tonegen_pattern_check(avb_tonegen_format format,
+				   unsigned channels, uint32_t *seq,
+				   const void *src, unsigned frames,
+				   unsigned stride)
+{
+	unsigned bits = sample_bits(format);
+	unsigned width = format == AVB_TONEGEN_AM824 ? 4 : bits / 8;
+	uint32_t mask, expect = *seq;
+	const uint8_t *in = src;
+	unsigned c, errors = 0;
+
+	if (bits == 0 || frames == 0)
+		return 0;
+	mask = (1U << (bits - 8)) - 1;
+	if (expect == AVB_TONEGEN_PATTERN_SYNC)
+		expect = get_sample(in, format) & mask;
+
+	for (; frames; --frames, in += stride) {
+		int bad = 0;
+
+		for (c = 0; c < channels; ++c)
+			if (get_sample(in + c * width, format) !=
+			    pattern_value(bits, c, expect))
+				bad = 1;
+		if (bad) {
+			errors++;
+			/* pick up the sender's count from channel 0 */
+			expect = get_sample(in, format) & mask;
+		}
+		expect++;
+	}
+	*seq = expect & mask;
+	return errors;
+}
+
+/* Largest frame avb_tonegen_pattern_verify() builds its reference in */
+#define PATTERN_MAX_CHANNELS 256
+
+/**
+ * @brief Verify frames written by avb_tonegen_pattern() and classify errors
+ * @param format [in] Encoding the pattern was written in
+ * @param channels [in] Channels per frame carrying the pattern, at most 256
+ * @param seq [inout] Expected frame counter as for
+ *	avb_tonegen_pattern_check()
+ * @param src [in] First frame to check
+ * @param frames [in] Number of frames to check
+ * @param stride [in] Bytes from one frame to the next in src
+ * @param stats [inout] Counters to add the results to
+ *
+ * Each frame is compared whole against a reference frame. Only on a
+ * mismatch is it decoded to tell a jump in the counter (gap or duplicate,
+ * after which the check follows the new count) from a frame that does not
+ * hold the pattern at all (corrupt, after which the old count continues).
+ */
+void avb_tonegen_pattern_verify(avb_tonegen_format format, unsigned channels,
+				uint32_t *seq, const void *src, unsigned frames,
+				unsigned stride,
+				struct avb_tonegen_pattern_stats *stats)
+{
+	unsigned bits = sample_bits(format);
+	unsigned width = format == AVB_TONEGEN_AM824 ? 4 : bits / 8;
+	uint8_t ref[PATTERN_MAX_CHANNELS * 4];
+	const uint8_t *in = src;
+	uint32_t mask, expect = *seq, rx, delta;
+	unsigned c, frame_bytes = channels * width;
+	int consistent;
+
+	if (bits == 0 || frames == 0 || channels > PATTERN_MAX_CHANNELS)
+		return;
+	mask = (1U << (bits - 8)) - 1;
+	if (expect == AVB_TONEGEN_PATTERN_SYNC)
+		expect = get_sample(in, format) & mask;
+
+	stats->frames += frames;
+	for (; frames; --frames, in += stride) {
+		avb_tonegen_pattern(format, channels, expect, ref, 1, frame_bytes);
+		if (memcmp(in, ref, frame_bytes) == 0) {
+			expect = (expect + 1) & mask;
+			continue;
+		}
+
+		rx = get_sample(in, format) & mask;
+		consistent = 1;
+		for (c = 0; c < channels && consistent; ++c)
+			consistent = get_sample(in + c * width, format) ==
+				pattern_value(bits, c, rx);
+		if (!consistent || rx == expect) {
+			stats->corrupt++;
+			expect = (expect + 1) & mask;
+			continue;
+		}
+
+		delta = (rx - expect) & mask;
+		if (delta <= mask / 2) {
+			stats->gaps++;
+			stats->lost += delta;
+		} else {
+			stats->dups++;
+		}
+		expect = (rx + 1) & mask;
+	}
+	*seq = expect;
+}
@@ -0,0 +1,71 @@
+#ifndef __AVB_TONEGEN_H__
+#define __AVB_TONEGEN_H__
+
+#include <inttypes.h>
+
+/* Wire formats a tone can be encoded in, all big endian */
+typedef enum {
+	AVB_TONEGEN_AM824,	/* IEC 61883-6 label 0x40 + 24 bit sample */
+	AVB_TONEGEN_S32_BE,
+	AVB_TONEGEN_S24_BE,
+	AVB_TONEGEN_S16_BE,
+	AVB_TONEGEN_FLOAT_BE
+} avb_tonegen_format;
+
+/*
+ * One period of a sine, already encoded and interleaved across all
+ * channels, so producing samples is a block copy out of the table.
+ */
+struct avb_tonegen {
+	uint8_t *table;
+	avb_tonegen_format format;
+	unsigned hz;
+	unsigned period;	/* frames in one period of the tone */
+	unsigned table_frames;	/* whole periods held in the table */
+	unsigned channels;
+	unsigned width;		/* bytes per encoded sample */
+	unsigned frame_bytes;	/* channels * width */
+};
+
+int avb_tonegen_init(struct avb_tonegen *tg, avb_tonegen_format format,
+		     unsigned rate, unsigned hz, unsigned channels,
+		     double gain, double phase_step);
+
+void avb_tonegen_free(struct avb_tonegen *tg);
+
+unsigned avb_tonegen_fill(const struct avb_tonegen *tg, unsigned index,
+			  void *dst, unsigned frames, unsigned stride);
+
+/*
+ * Integrity pattern: the top 8 bits of every sample hold its channel number
+ * and the remaining bits a frame counter, so a receiver can spot dropped,
+ * repeated, reordered or swapped samples with one compare per sample.
+ * A checker starting with AVB_TONEGEN_PATTERN_SYNC locks onto the first
+ * frame it sees.
+ */
+#define AVB_TONEGEN_PATTERN_SYNC 0xFFFFFFFF
+
+uint32_t avb_tonegen_pattern(avb_tonegen_format format, unsigned channels,
+			     uint32_t seq, void *dst, unsigned frames,
+			     unsigned stride);
+
+unsigned avb_tonegen_pattern_check(avb_tonegen_format format,
+				   unsigned channels, uint32_t *seq,
+				   const void *src, unsigned frames,
+				   unsigned stride);
+
+/* What avb_tonegen_pattern_verify() found, accumulated across calls */
+struct avb_tonegen_pattern_stats {
+	uint64_t frames;	/* frames checked */
+	uint64_t gaps;		/* jumps forward in the counter */
+	uint64_t lost;		/* frames skipped by those jumps */
+	uint64_t dups;		/* jumps back: repeated or reordered frames */
+	uint64_t corrupt;	/* frames not matching the pattern at all */
+};
+
+void avb_tonegen_pattern_verify(avb_tonegen_format format, unsigned channels,
+				uint32_t *seq, const void *src, unsigned frames,
+				unsigned stride,
+				struct avb_tonegen_pattern_stats *stats);
+
+#endif				/* __AVB_TONEGEN_H__ */
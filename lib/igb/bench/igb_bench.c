@@ -0,0 +1,863 @@
+/******************************************************************************
+
+  Copyright (c) 2001-2017, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   3. Neither the name of the Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+/*
+ * User space igb driver benchmark.
+ *
+ * Times the driver's hot calls on a real device:
+ *
+ *   xmit   igb_xmit / igb_xmit_batch and igb_clean_queue (or igb_clean)
+ *          per call, and the frame rate, for each number of queues and
+ *          each batch size
+ *   rx     igb_receive and igb_refresh_buffers per call on queue 0, with
+ *          a flex filter for the bench frames. Needs a loopback plug or a
+ *          peer sending them; with -x the bench sends them itself.
+ *   lock   igb_lock wait and hold time with 1, 2, 4 ... processes, each
+ *          attached to the device on its own
+ *   clock  igb_get_wallclock cost, and the jitter of its readings against
+ *          CLOCK_MONOTONIC_RAW
+ *
+ * The device is shared with everything else attached to it, so run on an
+ * idle port. The queues used for xmit run at strict priority for the run
+ * and get their class back afterwards. Bench frames go to the 802.1
+ * link local address with the local experimental ethertype, so a bridge
+ * doesn't forward them.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "igb.h"
+#include "avb_igb.h"
+
+#define BENCH_QUEUE_MAX		4
+#define BENCH_BATCH_MAX		256
+#define BENCH_BATCH_SIZES	8
+#define BENCH_RX_BUF_SIZE	2048
+#define BENCH_RX_BUFS		256
+#define BENCH_ETHERTYPE		0x88B5
+#define BENCH_LOCK_SAMPLES	(1 << 18)	/* per process and quantity */
+#define BENCH_DRAIN_NS		1000000000ULL
+
+static const u_int8_t bench_dest[6] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E };
+
+/* Command line options */
+struct bench_opts {
+	const char *ifname;
+	int xmit, rx, lock, clock;
+	unsigned queues;
+	unsigned batch[BENCH_BATCH_SIZES];
+	unsigned nbatch;
+	unsigned frames;
+	unsigned frame_size;
+	unsigned procs;
+	unsigned hold_ns;
+	unsigned seconds;
+	unsigned reads;
+	int legacy_clean;
+	int rx_send;
+};
+
+/* Distribution of a time in ns */
+struct samples {
+	u_int64_t *v;
+	unsigned n;
+	unsigned max;
+	u_int64_t sum;
+};
+
+/* TX frames and their free list */
+struct tx_pool {
+	struct igb_dma_alloc region;
+	int huge;
+	struct igb_packet *packets;
+	unsigned count;
+	struct igb_packet **free;
+	unsigned nfree;
+};
+
+/* What one lock process recorded, in memory shared with the parent */
+struct lock_result {
+	unsigned n;
+	u_int32_t wait[BENCH_LOCK_SAMPLES];
+	u_int32_t hold[BENCH_LOCK_SAMPLES];
+};
+
+static struct bench_opts opts;
+static device_t igb_dev;
+static volatile int halt;
+
+static void sigint_handler(int signum)
+{
+	(void)signum;
+	halt = 1;
+}
+
+static inline u_int64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (u_int64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void spin_ns(u_int64_t ns)
+{
+	u_int64_t end = now_ns() + ns;
+
+	while (now_ns() < end)
+		;
+}
+
+static int samples_init(struct samples *s, unsigned max)
+{
+	s->v = malloc(max * sizeof(*s->v));
+	s->n = 0;
+	s->max = max;
+	s->sum = 0;
+	return s->v ? 0 : ENOMEM;
+}
+
+static void samples_free(struct samples *s)
+{
+	free(s->v);
+	s->v = NULL;
+}
+
+static inline void samples_add(struct samples *s, u_int64_t ns)
+{
+	s->sum += ns;
+	if (s->n < s->max)
+		s->v[s->n++] = ns;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u_int64_t x = *(const u_int64_t *)a, y = *(const u_int64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u_int64_t samples_pct(const struct samples *s, double pct)
+{
+	unsigned i;
+
+	if (s->n == 0)
+		return 0;
+	i = (unsigned)(pct / 100.0 * (s->n - 1) + 0.5);
+	return s->v[i];
+}
+
+/* sorts the samples */
+static void samples_print(const char *name, struct samples *s)
+{
+	if (s->n == 0) {
+		printf("  %-16s -\n", name);
+		return;
+	}
+	qsort(s->v, s->n, sizeof(*s->v), cmp_u64);
+	printf("  %-16s n=%-8u mean=%-7" PRIu64 " p50=%-7" PRIu64
+	       " p99=%-7" PRIu64 " p99.9=%-7" PRIu64 " max=%" PRIu64 " ns\n",
+	       name, s->n, s->sum / s->n, samples_pct(s, 50.0),
+	       samples_pct(s, 99.0), samples_pct(s, 99.9), s->v[s->n - 1]);
+}
+
+static void tx_pool_close(struct tx_pool *pool)
+{
+	if (pool->region.dma_vaddr)
+		igb_dma_free_page(&igb_dev, &pool->region);
+	free(pool->packets);
+	free(pool->free);
+	memset(pool, 0, sizeof(*pool));
+}
+
+static int tx_pool_open(struct tx_pool *pool, unsigned frame_size)
+{
+	u_int8_t src[6];
+	unsigned i;
+	int err;
+
+	memset(pool, 0, sizeof(*pool));
+	err = igb_dma_malloc_huge(&igb_dev, &pool->region);
+	if (err == 0) {
+		pool->huge = 1;
+	} else {
+		err = igb_dma_malloc_page(&igb_dev, &pool->region);
+		if (err) {
+			printf("DMA allocation failed (%s)\n", strerror(abs(err)));
+			return err;
+		}
+	}
+	pool->packets = igb_dma_slab_carve(&pool->region, frame_size,
+					   &pool->count);
+	pool->free = calloc(pool->count, sizeof(*pool->free));
+	if (!pool->packets || !pool->free) {
+		printf("out of memory\n");
+		tx_pool_close(pool);
+		return ENOMEM;
+	}
+
+	memset(src, 0, sizeof(src));
+	igb_get_mac_addr(&igb_dev, src);
+	for (i = 0; i < pool->count; i++) {
+		u_int8_t *frame = pool->packets[i].vaddr;
+
+		memset(frame, 0, frame_size);
+		memcpy(frame, bench_dest, 6);
+		memcpy(frame + 6, src, 6);
+		frame[12] = BENCH_ETHERTYPE >> 8;
+		frame[13] = BENCH_ETHERTYPE & 0xFF;
+		pool->packets[i].len = frame_size;
+		pool->packets[i].flags = 0;
+		pool->packets[i].attime = 0;
+		pool->free[pool->nfree++] = &pool->packets[i];
+	}
+	return 0;
+}
+
+/* Give frames the hardware is done with back to the pool */
+static unsigned tx_pool_clean(struct tx_pool *pool, unsigned queue,
+			      struct samples *clean)
+{
+	struct igb_packet *done = NULL;
+	u_int32_t count = 0;
+	u_int64_t t0, t1;
+
+	t0 = now_ns();
+	if (opts.legacy_clean)
+		igb_clean(&igb_dev, &done);
+	else
+		igb_clean_queue(&igb_dev, queue, &done, &count);
+	t1 = now_ns();
+
+	count = 0;
+	while (done) {
+		pool->free[pool->nfree++] = done;
+		done = done->next;
+		count++;
+	}
+	if (count && clean)
+		samples_add(clean, t1 - t0);
+	return count;
+}
+
+/* Hand up to n frames to a queue; returns the number queued */
+static unsigned tx_pool_send(struct tx_pool *pool, unsigned queue, unsigned n,
+			     struct samples *xmit)
+{
+	struct igb_packet *batch[BENCH_BATCH_MAX];
+	u_int32_t count;
+	u_int64_t t0, t1;
+	unsigned i;
+	int err;
+
+	if (n > pool->nfree)
+		n = pool->nfree;
+	if (n == 0)
+		return 0;
+	for (i = 0; i < n; i++)
+		batch[i] = pool->free[--pool->nfree];
+
+	count = n;
+	t0 = now_ns();
+	if (n == 1) {
+		err = igb_xmit(&igb_dev, queue, batch[0]);
+		count = err ? 0 : 1;
+	} else {
+		err = igb_xmit_batch(&igb_dev, queue, batch, &count);
+	}
+	t1 = now_ns();
+
+	/* frames the ring had no room for go back */
+	for (i = n; i > count; i--)
+		pool->free[pool->nfree++] = batch[i - 1];
+	if (count && xmit)
+		samples_add(xmit, t1 - t0);
+	return count;
+}
+
+static unsigned tx_ring_level(unsigned queues)
+{
+	unsigned q, level = 0;
+
+	for (q = 0; q < queues; q++) {
+		int l = igb_tx_ring_level(&igb_dev, q);
+
+		if (l > 0)
+			level += l;
+	}
+	return level;
+}
+
+static void bench_xmit_run(struct tx_pool *pool, unsigned queues,
+			   unsigned batch)
+{
+	struct samples xmit, clean;
+	u_int64_t start, end, sent = 0, frames = opts.frames;
+	unsigned calls = 0, q = 0;
+
+	if (samples_init(&xmit, frames) || samples_init(&clean, frames)) {
+		printf("out of memory\n");
+		goto out;
+	}
+
+	start = now_ns();
+	while (sent < frames && !halt) {
+		unsigned n = batch;
+		unsigned done;
+
+		if (n > frames - sent)
+			n = frames - sent;
+		done = tx_pool_send(pool, q, n, &xmit);
+		sent += done;
+		calls++;
+		tx_pool_clean(pool, q, &clean);
+		if (done < n) {
+			/* ring or pool full: reclaim on every queue */
+			unsigned i;
+
+			for (i = 0; i < queues; i++)
+				tx_pool_clean(pool, i, &clean);
+		}
+		q = (q + 1) % queues;
+	}
+
+	/* the rate counts until the last frame left */
+	end = now_ns() + BENCH_DRAIN_NS;
+	while (tx_ring_level(queues) && now_ns() < end)
+		;
+	end = now_ns();
+	for (q = 0; q < queues; q++)
+		while (tx_pool_clean(pool, q, NULL))
+			;
+
+	printf("xmit queues=%u batch=%u: %" PRIu64 " frames in %u calls, "
+	       "%.0f frames/s, %.1f ns per frame in xmit\n",
+	       queues, batch, sent, calls,
+	       sent * 1e9 / (double)(end - start),
+	       sent ? (double)xmit.sum / sent : 0.0);
+	samples_print(batch == 1 ? "igb_xmit" : "igb_xmit_batch", &xmit);
+	samples_print(opts.legacy_clean ? "igb_clean" : "igb_clean_queue",
+		      &clean);
+out:
+	samples_free(&xmit);
+	samples_free(&clean);
+}
+
+static int bench_xmit(void)
+{
+	struct igb_queue_info info;
+	struct tx_pool pool;
+	unsigned queues, q, b;
+	int have_info, err;
+
+	memset(&info, 0, sizeof(info));
+	have_info = igb_get_queue_info(&igb_dev, &info) == 0;
+	if (!have_info)
+		info.user_queues = IGB_DEFAULT_USER_QUEUES;
+	queues = info.user_queues;
+	if (queues > BENCH_QUEUE_MAX)
+		queues = BENCH_QUEUE_MAX;
+	if (opts.queues && opts.queues < queues)
+		queues = opts.queues;
+
+	err = tx_pool_open(&pool, opts.frame_size);
+	if (err)
+		return err;
+	printf("xmit: %u frames of %u bytes in %s DMA memory, %u queues\n",
+	       pool.count, opts.frame_size, pool.huge ? "huge page" : "page",
+	       queues);
+
+	/* no credit shaper in the way of the rate */
+	for (q = 0; q < queues; q++)
+		igb_set_queue_class(&igb_dev, q, IGB_QUEUE_CLASS_STRICT);
+
+	for (q = 1; q <= queues && !halt; q++)
+		for (b = 0; b < opts.nbatch && !halt; b++)
+			bench_xmit_run(&pool, q, opts.batch[b]);
+
+	if (have_info)
+		for (q = 0; q < queues; q++)
+			igb_set_queue_class(&igb_dev, q, info.queue_class[q]);
+	tx_pool_close(&pool);
+	return 0;
+}
+
+static int bench_rx(void)
+{
+	struct igb_dma_alloc pages[BENCH_RX_BUFS];
+	struct igb_packet *bufs;
+	struct samples empty, busy, refresh;
+	struct tx_pool pool;
+	u_int8_t filter[16], mask[16];
+	unsigned filter_id = IGB_FLEX_ANY;
+	unsigned per_page, npages = 0, nbufs = 0, i;
+	u_int64_t start, end, frames = 0;
+	int err;
+
+	memset(&pool, 0, sizeof(pool));
+	err = igb_attach_rx(&igb_dev);
+	if (err) {
+		printf("attach_rx failed (%s)\n", strerror(abs(err)));
+		return err;
+	}
+
+	bufs = calloc(BENCH_RX_BUFS, sizeof(*bufs));
+	if (!bufs)
+		return ENOMEM;
+	while (nbufs < BENCH_RX_BUFS) {
+		err = igb_dma_malloc_page(&igb_dev, &pages[npages]);
+		if (err) {
+			printf("DMA allocation failed (%s)\n",
+			       strerror(abs(err)));
+			goto out;
+		}
+		per_page = pages[npages].mmap_size / BENCH_RX_BUF_SIZE;
+		for (i = 0; i < per_page && nbufs < BENCH_RX_BUFS; i++) {
+			struct igb_packet *pkt = &bufs[nbufs++];
+
+			pkt->map.paddr = pages[npages].dma_paddr;
+			pkt->map.mmap_size = pages[npages].mmap_size;
+			pkt->offset = i * BENCH_RX_BUF_SIZE;
+			pkt->vaddr = (u_int8_t *)pages[npages].dma_vaddr +
+				     pkt->offset;
+			pkt->len = BENCH_RX_BUF_SIZE;
+			igb_refresh_buffers(&igb_dev, 0, &pkt, 1);
+		}
+		npages++;
+	}
+
+	memset(filter, 0, sizeof(filter));
+	memset(mask, 0, sizeof(mask));
+	memcpy(filter, bench_dest, 6);
+	filter[12] = BENCH_ETHERTYPE >> 8;
+	filter[13] = BENCH_ETHERTYPE & 0xFF;
+	mask[0] = 0x3F;		/* destination address */
+	mask[1] = 0x30;		/* ethertype */
+	err = igb_alloc_flex_filter(&igb_dev, &filter_id);
+	if (err == 0)
+		err = igb_setup_flex_filter(&igb_dev, 0, filter_id,
+					    sizeof(filter), filter, mask);
+	if (err) {
+		printf("flex filter setup failed (%s)\n", strerror(abs(err)));
+		goto out;
+	}
+
+	if (opts.rx_send) {
+		err = tx_pool_open(&pool, opts.frame_size);
+		if (err)
+			goto out_filter;
+		igb_set_queue_class(&igb_dev, 0, IGB_QUEUE_CLASS_STRICT);
+	}
+
+	if (samples_init(&empty, 1 << 20) || samples_init(&busy, 1 << 20) ||
+	    samples_init(&refresh, 1 << 20)) {
+		printf("out of memory\n");
+		goto out_pool;
+	}
+
+	start = now_ns();
+	end = start + opts.seconds * 1000000000ULL;
+	while (now_ns() < end && !halt) {
+		struct igb_packet *rx = NULL;
+		u_int32_t count = BENCH_RX_BUFS;
+		u_int64_t t0, t1;
+
+		if (opts.rx_send) {
+			tx_pool_clean(&pool, 0, NULL);
+			tx_pool_send(&pool, 0, opts.batch[0], NULL);
+		}
+
+		t0 = now_ns();
+		err = igb_receive(&igb_dev, 0, &rx, &count);
+		t1 = now_ns();
+		if (err || !rx || count == 0) {
+			samples_add(&empty, t1 - t0);
+			continue;
+		}
+		samples_add(&busy, t1 - t0);
+
+		while (rx) {
+			struct igb_packet *next = rx->next;
+
+			frames++;
+			t0 = now_ns();
+			igb_refresh_buffers(&igb_dev, 0, &rx, 1);
+			t1 = now_ns();
+			samples_add(&refresh, t1 - t0);
+			rx = next;
+		}
+	}
+	end = now_ns();
+
+	printf("rx: %" PRIu64 " frames in %.1f s, %.0f frames/s\n", frames,
+	       (end - start) / 1e9, frames * 1e9 / (double)(end - start));
+	samples_print("igb_receive idle", &empty);
+	samples_print("igb_receive", &busy);
+	samples_print("igb_refresh_bufs", &refresh);
+	if (frames == 0)
+		printf("  no frames: needs a loopback plug, or a peer sending"
+		       " them (-x sends them from here)\n");
+	samples_free(&empty);
+	samples_free(&busy);
+	samples_free(&refresh);
+out_pool:
+	if (opts.rx_send) {
+		end = now_ns() + BENCH_DRAIN_NS;
+		while (tx_ring_level(1) && now_ns() < end)
+			;
+		tx_pool_close(&pool);
+	}
+out_filter:
+	igb_clear_flex_filter(&igb_dev, filter_id);
+	igb_free_flex_filter(&igb_dev, filter_id);
+out:
+	for (i = 0; i < npages; i++)
+		igb_dma_free_page(&igb_dev, &pages[i]);
+	free(bufs);
+	return err;
+}
+
+/* One lock process: attach on its own and take the lock until the end */
+static void lock_child(struct lock_result *res, volatile unsigned *ready,
+		       volatile u_int64_t *start)
+{
+	device_t dev;
+	u_int64_t end;
+
+	if (pci_connect_if(&dev, opts.ifname) || igb_init(&dev)) {
+		__sync_fetch_and_add(ready, 1);
+		_exit(1);
+	}
+	__sync_fetch_and_add(ready, 1);
+	while (*start == 0)
+		;
+	end = *start + opts.seconds * 1000000000ULL;
+
+	res->n = 0;
+	while (now_ns() < end && res->n < BENCH_LOCK_SAMPLES) {
+		u_int64_t t0, t1, t2;
+
+		t0 = now_ns();
+		if (igb_lock(&dev) != 0)
+			break;
+		t1 = now_ns();
+		spin_ns(opts.hold_ns);
+		igb_unlock(&dev);
+		t2 = now_ns();
+		res->wait[res->n] = t1 - t0;
+		res->hold[res->n] = t2 - t1;
+		res->n++;
+		/* as long again outside the lock */
+		spin_ns(opts.hold_ns);
+	}
+
+	igb_detach(&dev);
+	_exit(0);
+}
+
+static int bench_lock_run(unsigned procs)
+{
+	struct lock_result *res;
+	struct samples waits, holds;
+	size_t size = procs * sizeof(*res) + 64;
+	volatile unsigned *ready;
+	volatile u_int64_t *start;
+	unsigned i, failed = 0;
+	void *shm;
+
+	shm = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shm == MAP_FAILED)
+		return errno;
+	ready = shm;
+	start = (volatile u_int64_t *)((u_int8_t *)shm + 8);
+	res = (struct lock_result *)((u_int8_t *)shm + 64);
+
+	for (i = 0; i < procs; i++) {
+		pid_t pid = fork();
+
+		if (pid == 0)
+			lock_child(&res[i], ready, start);
+		if (pid < 0)
+			failed++;
+	}
+	while (*ready < procs - failed)
+		usleep(1000);
+	*start = now_ns();
+	while (wait(NULL) > 0)
+		;
+
+	if (samples_init(&waits, procs * BENCH_LOCK_SAMPLES) ||
+	    samples_init(&holds, procs * BENCH_LOCK_SAMPLES)) {
+		printf("out of memory\n");
+		goto out;
+	}
+	for (i = 0; i < procs; i++) {
+		unsigned j;
+
+		for (j = 0; j < res[i].n; j++) {
+			samples_add(&waits, res[i].wait[j]);
+			samples_add(&holds, res[i].hold[j]);
+		}
+	}
+	printf("lock processes=%u hold=%u ns: %.0f acquisitions/s\n", procs,
+	       opts.hold_ns, waits.n / (double)opts.seconds);
+	samples_print("igb_lock wait", &waits);
+	samples_print("held", &holds);
+out:
+	samples_free(&waits);
+	samples_free(&holds);
+	munmap(shm, size);
+	return 0;
+}
+
+static int bench_lock(void)
+{
+	unsigned procs;
+
+	for (procs = 1; procs <= opts.procs && !halt; procs *= 2)
+		bench_lock_run(procs);
+	return 0;
+}
+
+static int bench_clock(void)
+{
+	struct samples cost, jitter;
+	int64_t prev = 0;
+	unsigned i, fails = 0;
+
+	if (samples_init(&cost, opts.reads) ||
+	    samples_init(&jitter, opts.reads)) {
+		printf("out of memory\n");
+		return ENOMEM;
+	}
+
+	for (i = 0; i < opts.reads && !halt; i++) {
+		u_int64_t systim, tsc, t0, t1;
+		int64_t offset;
+
+		t0 = now_ns();
+		if (igb_get_wallclock(&igb_dev, &systim, &tsc) != 0) {
+			fails++;
+			continue;
+		}
+		t1 = now_ns();
+		samples_add(&cost, t1 - t0);
+
+		/*
+		 * SYSTIM against the middle of the call; both clocks run
+		 * within ppm of each other, so between back to back reads
+		 * the change of the offset is the read jitter.
+		 */
+		offset = (int64_t)(systim - (t0 + (t1 - t0) / 2));
+		if (i > 0)
+			samples_add(&jitter, llabs(offset - prev));
+		prev = offset;
+	}
+
+	printf("clock: %u reads, %u failed\n", cost.n, fails);
+	samples_print("igb_get_wallclock", &cost);
+	samples_print("jitter", &jitter);
+	samples_free(&cost);
+	samples_free(&jitter);
+	return 0;
+}
+
+static int parse_tests(const char *arg)
+{
+	char buf[64], *tok, *save = NULL;
+
+	opts.xmit = opts.rx = opts.lock = opts.clock = 0;
+	snprintf(buf, sizeof(buf), "%s", arg);
+	for (tok = strtok_r(buf, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (strcmp(tok, "xmit") == 0)
+			opts.xmit = 1;
+		else if (strcmp(tok, "rx") == 0)
+			opts.rx = 1;
+		else if (strcmp(tok, "lock") == 0)
+			opts.lock = 1;
+		else if (strcmp(tok, "clock") == 0)
+			opts.clock = 1;
+		else
+			return EINVAL;
+	}
+	return 0;
+}
+
+static int parse_batches(const char *arg)
+{
+	char buf[64], *tok, *save = NULL;
+
+	opts.nbatch = 0;
+	snprintf(buf, sizeof(buf), "%s", arg);
+	for (tok = strtok_r(buf, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		unsigned b = strtoul(tok, NULL, 0);
+
+		if (b == 0 || b > BENCH_BATCH_MAX ||
+		    opts.nbatch == BENCH_BATCH_SIZES)
+			return EINVAL;
+		opts.batch[opts.nbatch++] = b;
+	}
+	return opts.nbatch ? 0 : EINVAL;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: igb_bench [-h] -i interface [options]\n"
+		"  -t tests    comma separated: xmit,rx,lock,clock"
+		" (default xmit,lock,clock)\n"
+		"  -q queues   most TX queues to spread frames over"
+		" (default all user queues)\n"
+		"  -b batches  comma separated batch sizes (default 1,4,16,64)\n"
+		"  -n frames   frames per xmit run (default 100000)\n"
+		"  -s bytes    frame size (default 64)\n"
+		"  -L          reclaim with igb_clean instead of"
+		" igb_clean_queue\n"
+		"  -x          send the frames rx receives (loopback plug)\n"
+		"  -p procs    most lock processes, doubling from 1"
+		" (default 4)\n"
+		"  -H ns       time the lock is held, and left, each time"
+		" (default 1000)\n"
+		"  -d seconds  length of the rx and lock runs (default 2)\n"
+		"  -w reads    igb_get_wallclock reads (default 10000)\n"
+		"Run as root on an idle port; TX queues are set to strict"
+		" priority while in use.\n");
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	int c, err;
+
+	opts.xmit = opts.lock = opts.clock = 1;
+	opts.batch[0] = 1;
+	opts.batch[1] = 4;
+	opts.batch[2] = 16;
+	opts.batch[3] = 64;
+	opts.nbatch = 4;
+	opts.frames = 100000;
+	opts.frame_size = 64;
+	opts.procs = 4;
+	opts.hold_ns = 1000;
+	opts.seconds = 2;
+	opts.reads = 10000;
+
+	while ((c = getopt(argc, argv, "hi:t:q:b:n:s:Lxp:H:d:w:")) != -1) {
+		switch (c) {
+		case 'i':
+			opts.ifname = optarg;
+			break;
+		case 't':
+			if (parse_tests(optarg))
+				usage();
+			break;
+		case 'q':
+			opts.queues = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			if (parse_batches(optarg))
+				usage();
+			break;
+		case 'n':
+			opts.frames = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			opts.frame_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'L':
+			opts.legacy_clean = 1;
+			break;
+		case 'x':
+			opts.rx_send = 1;
+			break;
+		case 'p':
+			opts.procs = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			opts.hold_ns = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			opts.seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			opts.reads = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+		default:
+			usage();
+		}
+	}
+	if (!opts.ifname || optind != argc || opts.frames == 0 ||
+	    opts.frame_size < 60 || opts.frame_size > 1514 ||
+	    opts.seconds == 0 || opts.reads == 0)
+		usage();
+
+	err = pci_connect_if(&igb_dev, opts.ifname);
+	if (err) {
+		printf("connect failed (%s) - are you running as root?\n",
+		       strerror(err));
+		return EXIT_FAILURE;
+	}
+	err = igb_init(&igb_dev);
+	if (err) {
+		printf("init failed (%s) - is the driver really loaded?\n",
+		       strerror(abs(err)));
+		igb_detach(&igb_dev);
+		return EXIT_FAILURE;
+	}
+	signal(SIGINT, sigint_handler);
+
+	if (opts.clock && !halt)
+		bench_clock();
+	if (opts.lock && !halt)
+		bench_lock();
+	if (opts.xmit && !halt)
+		bench_xmit();
+	if (opts.rx && !halt)
+		bench_rx();
+
+	igb_detach(&igb_dev);
+	return EXIT_SUCCESS;
+}
@@ -1807,5 +1807,16 @@
 
 
 #define E1000_TSAUXC_SAMP_AUTO		0x00000008 /* sample current ts */
+#define E1000_TSAUXC_EN_TS1		0x00000400 /* enable aux timestamp 1 */
+#define E1000_TSAUXC_AUTT1		0x00000800 /* aux timestamp 1 taken */
+
+/* TSSDP: routing of the SDP pins to the timesync unit */
+#define E1000_TSSDP_AUX1_SEL_SDP(_n)	(((_n) & 0x3) << 3) /* SDP to AUX1 */
+#define E1000_TSSDP_AUX1_TS_SDP_EN	0x00000020 /* SDP edge latches AUX1 */
+#define E1000_TSSDP_TS_SDP_EN(_n)	(0x00000100 << ((_n) * 3)) /* SDP out */
+
+#define E1000_CTRL_SDP0_DIR		0x00400000 /* SDP0 0=in 1=out */
+#define E1000_CTRL_SDP1_DIR		0x00800000 /* SDP1 0=in 1=out */
+#define E1000_CTRL_EXT_SDP2_DIR		E1000_CTRL_EXT_SDP6_DIR
 
 #endif /* _E1000_DEFINES_H_ */
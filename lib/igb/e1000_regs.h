@@ -535,6 +535,9 @@
 #define E1000_SYSTIMR	0x0B6F8 /* System time register Residue */
 #define E1000_AUXSTMPL0 0x0B65C /* Auxiliary Time Stamp 0 Reg - Low */
 #define E1000_AUXSTMPH0 0x0B660 /* Auxiliary Time Stamp 0 Reg - Low */
+#define E1000_AUXSTMPL1 0x0B664 /* Auxiliary Time Stamp 1 Reg - Low */
+#define E1000_AUXSTMPH1 0x0B668 /* Auxiliary Time Stamp 1 Reg - High */
+#define E1000_TSSDP	0x0003C /* Time Sync SDP Configuration - RW */
 
 #define E1000_TQAVCTRL      0x03570
 #define E1000_DTXMXPKTSZ    0x0355C
@@ -48,6 +48,7 @@
 #include <sys/user.h>
 #include <sys/stat.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <semaphore.h>
 #include <pthread.h>
 
@@ -97,11 +98,16 @@ static void igb_setup_receive_structures(struct adapter *adapter);
 static void igb_setup_transmit_ring(struct tx_ring *txr);
 static void igb_initialize_transmit_units(struct adapter *adapter);
 static void igb_initialize_receive_units(struct adapter *adapter);
+static u32 igb_rx_srrctl(struct rx_ring *rxr);
 static void igb_free_transmit_structures(struct adapter *adapter);
 static void igb_free_receive_structures(struct adapter *adapter);
 static void igb_tx_ctx_setup(struct tx_ring *txr, struct igb_packet *packet);
 static void igb_free_receive_buffers(struct rx_ring *rxr);
 static int  igb_create_lock(struct adapter *adapter);
+static int  igb_lock_tx(struct adapter *adapter, unsigned int queue_index);
+static int  igb_unlock_tx(struct adapter *adapter, unsigned int queue_index);
+static void igb_lock_all_tx(struct adapter *adapter);
+static void igb_unlock_all_tx(struct adapter *adapter);
 
 int igb_probe(device_t *dev)
 {
@@ -128,6 +134,36 @@ int igb_probe(device_t *dev)
 
 #define IGB_SEM "/igb_sem"
 
+/*
+ * Layout of the IGB_SEM shared memory. memlock protects register
+ * programming and ring setup; each txlock only protects its own tx ring,
+ * so processes transmitting on different queues never contend.
+ * New members must only ever be appended: the file may have been
+ * created by an older library.
+ */
+#define IGB_MAX_TX_QUEUES 4
+
+/* bandwidth reserved by one stream through igb_add_stream_bandwidth() */
+struct igb_stream_bw {
+	pid_t owner;		/* 0 when the slot is free */
+	u_int32_t sr_class;
+	u_int32_t bytes_per_second;
+};
+
+struct igb_shared {
+	pthread_mutex_t memlock;
+	pthread_mutex_t txlock[IGB_MAX_TX_QUEUES];
+	/* per-stream Qav reservations, protected by memlock */
+	struct igb_stream_bw streams[IGB_MAX_SHAPED_STREAMS];
+	/*
+	 * Running sum of streams[] per class, kept up to date as streams
+	 * are added and removed. Zero-filled by the extension from an older
+	 * library, so it is only trusted once class_bw_valid is set.
+	 */
+	u_int32_t class_bw[2];
+	u_int32_t class_bw_valid;
+};
+
 int igb_attach(char *dev_path, device_t *pdev)
 {
 	struct adapter *adapter;
@@ -231,8 +267,10 @@ err_bind:
 	if (locked)
 		(void) igb_unlock(pdev);
 	if (adapter && adapter->memlock) {
-		(void) munmap(adapter->memlock, sizeof(pthread_mutex_t));
+		(void) munmap(adapter->memlock, sizeof(struct igb_shared));
 		adapter->memlock = NULL;
+		adapter->txlock = NULL;
+		adapter->shared = NULL;
 	}
 	close(adapter->ldev);
 err_prebind:
@@ -243,6 +281,19 @@ err_gen:
 	return error;
 }
 
+/* queues the driver leaves to user space, avb_user_queues of igb_avb */
+static u16 igb_user_queues(struct adapter *adapter)
+{
+	struct igb_queue_cmd req;
+
+	memset(&req, 0, sizeof(req));
+	if (ioctl(adapter->ldev, IGB_GET_QUEUES, &req) < 0 ||
+	    req.user_queues == 0 || req.user_queues > IGB_MAX_TX_QUEUES)
+		return IGB_DEFAULT_USER_QUEUES;
+
+	return req.user_queues;
+}
+
 int igb_attach_tx(device_t *pdev)
 {
 	int error;
@@ -260,7 +311,7 @@ int igb_attach_tx(device_t *pdev)
 		return -errno;
 
 	/* Allocate and Setup Queues */
-	adapter->num_queues = 2;  /* XXX parameterize this */
+	adapter->num_queues = igb_user_queues(adapter);
 	error = igb_allocate_queues(adapter);
 	if (error) {
 		adapter->num_queues = 0;
@@ -300,7 +351,7 @@ int igb_attach_rx(device_t *pdev)
 	/*
 	 * Allocate and Setup Rx Queues
 	 */
-	adapter->num_queues = 2;  /* XXX parameterize this */
+	adapter->num_queues = igb_user_queues(adapter);
 	error = igb_allocate_rx_queues(adapter);
 	if (error) {
 		adapter->num_queues = 0;
@@ -338,6 +389,10 @@ int igb_detach(device_t *dev)
 
 	igb_unlock(dev);
 
+	/* wait out any igb_xmit()/igb_clean() still working on a tx ring */
+	igb_lock_all_tx(adapter);
+	igb_unlock_all_tx(adapter);
+
 	igb_free_pci_resources(adapter);
 
 	if (adapter->tx_rings)
@@ -364,6 +419,8 @@ err_nolock:
 		 * the process termination.
 		 */
 		adapter->memlock = NULL;
+		adapter->txlock = NULL;
+		adapter->shared = NULL;
 	}
 
 	close(adapter->ldev);
@@ -379,7 +436,7 @@ int igb_suspend(device_t *dev)
 	struct tx_ring *txr;
 	struct rx_ring *rxr;
 	struct e1000_hw *hw;
-	u32 txdctl, srrctl = 0;
+	u32 txdctl;
 	int i;
 
 	if (dev == NULL)
@@ -406,9 +463,6 @@ int igb_suspend(device_t *dev)
 		txr->queue_status = IGB_QUEUE_IDLE;
 	}
 
-	srrctl |= 2048 >> E1000_SRRCTL_BSIZEPKT_SHIFT;
-	srrctl |= E1000_SRRCTL_DESCTYPE_ADV_ONEBUF;
-
 	for (i = 0; i < adapter->num_queues; i++, rxr++) {
 		u64 bus_addr = rxr->rxdma.paddr;
 		u32 rxdctl;
@@ -420,7 +474,7 @@ int igb_suspend(device_t *dev)
 				(uint32_t)(bus_addr >> 32));
 		E1000_WRITE_REG(hw, E1000_RDBAL(i),
 				(uint32_t)bus_addr);
-		E1000_WRITE_REG(hw, E1000_SRRCTL(i), srrctl);
+		E1000_WRITE_REG(hw, E1000_SRRCTL(i), igb_rx_srrctl(rxr));
 		/* Enable this Queue */
 		rxdctl = E1000_READ_REG(hw, E1000_RXDCTL(i));
 		rxdctl |= E1000_RXDCTL_QUEUE_ENABLE;
@@ -443,7 +497,7 @@ int igb_resume(device_t *dev)
 	struct tx_ring *txr;
 	struct rx_ring *rxr;
 	struct e1000_hw *hw;
-	u32 txdctl, srrctl = 0;
+	u32 txdctl;
 	int i;
 
 	if (dev == NULL)
@@ -473,9 +527,6 @@ int igb_resume(device_t *dev)
 		txr->queue_status = IGB_QUEUE_WORKING;
 	}
 
-	srrctl |= 2048 >> E1000_SRRCTL_BSIZEPKT_SHIFT;
-	srrctl |= E1000_SRRCTL_DESCTYPE_ADV_ONEBUF;
-
 	for (i = 0; i < adapter->num_queues; i++, rxr++) {
 		u64 bus_addr = rxr->rxdma.paddr;
 		u32 rxdctl;
@@ -487,7 +538,7 @@ int igb_resume(device_t *dev)
 				(uint32_t)(bus_addr >> 32));
 		E1000_WRITE_REG(hw, E1000_RDBAL(i),
 				(uint32_t)bus_addr);
-		E1000_WRITE_REG(hw, E1000_SRRCTL(i), srrctl);
+		E1000_WRITE_REG(hw, E1000_SRRCTL(i), igb_rx_srrctl(rxr));
 		/* Enable this Queue */
 		rxdctl = E1000_READ_REG(hw, E1000_RXDCTL(i));
 		rxdctl |= E1000_RXDCTL_QUEUE_ENABLE;
@@ -521,8 +572,10 @@ int igb_init(device_t *dev)
 
 	/* Prepare transmit descriptors and buffers */
 	if (adapter->tx_rings) {
+		igb_lock_all_tx(adapter);
 		igb_setup_transmit_structures(adapter);
 		igb_initialize_transmit_units(adapter);
+		igb_unlock_all_tx(adapter);
 	}
 
 	if (adapter->rx_rings) {
@@ -536,16 +589,42 @@ int igb_init(device_t *dev)
 	return 0;
 }
 
+/*
+ * Attach the RX queues of a device igb_init() already set up and start
+ * them, leaving the TX rings alone. Lets a process that only transmits
+ * skip RX until it first receives.
+ */
+int igb_init_rx(device_t *dev)
+{
+	struct adapter *adapter;
+	int error;
+
+	error = igb_attach_rx(dev);
+	if (error)
+		return error;
+	adapter = (struct adapter *)dev->private_data;
+
+	if (igb_lock(dev) != 0)
+		return errno;
+
+	igb_setup_receive_structures(adapter);
+	igb_initialize_receive_units(adapter);
+
+	if (igb_unlock(dev) != 0)
+		return errno;
+
+	return 0;
+}
+
 static void
 igb_reset(struct adapter *adapter)
 {
 	struct tx_ring *txr = adapter->tx_rings;
 	struct rx_ring *rxr = adapter->rx_rings;
 	struct e1000_hw *hw = &adapter->hw;
-	u32 txdctl, srrctl;
+	u32 txdctl;
 	int i;
 
-	srrctl = 0;
 	txdctl = 0;
 
 	/* Set up the Tx Descriptor Rings, leave queues idle */
@@ -565,7 +644,7 @@ igb_reset(struct adapter *adapter)
 
 			/* reset the descriptor head/tail */
 			E1000_WRITE_REG(hw, E1000_TDLEN(i),
-					adapter->num_tx_desc *
+					txr->num_desc *
 					sizeof(struct e1000_tx_desc));
 			E1000_WRITE_REG(hw, E1000_TDBAH(i),
 					(u_int32_t)(bus_addr >> 32));
@@ -580,9 +659,6 @@ igb_reset(struct adapter *adapter)
 		}
 	}
 
-	srrctl |= 2048 >> E1000_SRRCTL_BSIZEPKT_SHIFT;
-	srrctl |= E1000_SRRCTL_DESCTYPE_ADV_ONEBUF;
-
 	/* Setup the Base and Length of the Rx Descriptor Rings */
 	if (adapter->rx_rings == NULL) {
 #if DEBUG
@@ -604,7 +680,8 @@ igb_reset(struct adapter *adapter)
 					(uint32_t)(bus_addr >> 32));
 			E1000_WRITE_REG(hw, E1000_RDBAL(i),
 					(uint32_t)bus_addr);
-			E1000_WRITE_REG(hw, E1000_SRRCTL(i), srrctl);
+			E1000_WRITE_REG(hw, E1000_SRRCTL(i),
+					igb_rx_srrctl(rxr));
 
 			/* Enable this Queue */
 			rxdctl = E1000_READ_REG(hw, E1000_RXDCTL(i));
@@ -662,7 +739,8 @@ static void igb_free_pci_resources(struct adapter *adapter)
 /*
  * Manage DMA'able memory.
  */
-int igb_dma_malloc_page(device_t *dev, struct igb_dma_alloc *dma)
+static int igb_dma_malloc(device_t *dev, struct igb_dma_alloc *dma,
+			  unsigned long cmd)
 {
 	struct adapter *adapter;
 	int error = 0;
@@ -681,7 +759,7 @@ int igb_dma_malloc_page(device_t *dev, struct igb_dma_alloc *dma)
 		error = errno;
 		goto err;
 	}
-	error = ioctl(adapter->ldev, IGB_MAPBUF, &ubuf);
+	error = ioctl(adapter->ldev, cmd, &ubuf);
 	if (igb_unlock(dev) != 0) {
 		error = errno;
 		goto err;
@@ -707,6 +785,91 @@ err:
 	return error;
 }
 
+int igb_dma_malloc_page(device_t *dev, struct igb_dma_alloc *dma)
+{
+	return igb_dma_malloc(dev, dma, IGB_MAPBUF);
+}
+
+/*
+ * Map one physically contiguous IGB_DMA_HUGE_SIZE region. A single
+ * mapping replaces hundreds of igb_dma_malloc_page() calls, and buffers
+ * carved from it never straddle a page boundary. Release it with
+ * igb_dma_free_page(). Fails with -ENOMEM when the kernel module lacks
+ * IGB_MAPBUF_HUGE or has no contiguous memory left, so callers can fall
+ * back to individual pages.
+ */
+int igb_dma_malloc_huge(device_t *dev, struct igb_dma_alloc *region)
+{
+	return igb_dma_malloc(dev, region, IGB_MAPBUF_HUGE);
+}
+
+/*
+ * Split a DMA region into equally sized packet buffers. buf_size is
+ * rounded up to a cache line. The returned array holds *count packets,
+ * chained through next in address order; free() it once the region
+ * has been released.
+ */
+struct igb_packet *igb_dma_slab_carve(struct igb_dma_alloc *region,
+				      unsigned int buf_size,
+				      unsigned int *count)
+{
+	struct igb_packet *packets;
+	unsigned int i, n;
+
+	if (region == NULL || count == NULL || buf_size == 0)
+		return NULL;
+
+	*count = 0;
+
+	buf_size = (buf_size + 63) & ~63U;
+	n = region->mmap_size / buf_size;
+	if (n == 0)
+		return NULL;
+
+	packets = calloc(n, sizeof(struct igb_packet));
+	if (packets == NULL)
+		return NULL;
+
+	for (i = 0; i < n; i++) {
+		packets[i].map.paddr = region->dma_paddr;
+		packets[i].map.mmap_size = region->mmap_size;
+		packets[i].offset = i * buf_size;
+		packets[i].vaddr = (u_int8_t *)region->dma_vaddr +
+				   packets[i].offset;
+		packets[i].len = buf_size;
+		packets[i].next = (i + 1 < n) ? &packets[i + 1] : NULL;
+	}
+
+	*count = n;
+	return packets;
+}
+
+/*
+ * Give the packets chained from packets a header buffer each for a ring
+ * set up with header split, carving hdr_size (rounded up to a cache line)
+ * buffers from region. Several rings' worth of headers fit in one page.
+ * Returns how many packets got a header buffer.
+ */
+unsigned int igb_dma_slab_carve_hdr(struct igb_dma_alloc *region,
+				    unsigned int hdr_size,
+				    struct igb_packet *packets)
+{
+	unsigned int n, offset;
+
+	if (region == NULL || hdr_size == 0)
+		return 0;
+
+	hdr_size = (hdr_size + 63) & ~63U;
+	for (n = 0, offset = 0; packets != NULL &&
+	     offset + hdr_size <= region->mmap_size;
+	     n++, offset += hdr_size, packets = packets->next) {
+		packets->hdr_paddr = region->dma_paddr + offset;
+		packets->hdr_vaddr = (u_int8_t *)region->dma_vaddr + offset;
+	}
+
+	return n;
+}
+
 void igb_dma_free_page(device_t *dev, struct igb_dma_alloc *dma)
 {
 	struct adapter *adapter;
@@ -794,22 +957,26 @@ static int igb_allocate_queues(struct adapter *adapter)
 		adapter->tx_rings[i].adapter = adapter;
 		adapter->tx_rings[i].me = i;
 		/* XXX Initialize a TX lock ?? */
-		adapter->num_tx_desc = ubuf.mmap_size /
-				       sizeof(union e1000_adv_tx_desc);
+		/*
+		 * Each ring has its own size, the driver may give the AVB
+		 * queues deeper rings (avb_tx_size) than the others.
+		 */
+		adapter->tx_rings[i].num_desc = ubuf.mmap_size /
+					sizeof(union e1000_adv_tx_desc);
 
 		/*
-		 * num_tx_desc must be always a multiple of 8 because the value of
+		 * num_desc must be always a multiple of 8 because the value of
 		 * TDLEN must be a multipe of 128 and each descriptor has 16 bytes.
 		 */
-		if (adapter->num_tx_desc % 8)
-			printf("warning: num_tx_desc(%d) is not a multiple of 8\n",
-				adapter->num_tx_desc);
+		if (adapter->tx_rings[i].num_desc % 8)
+			printf("warning: num_desc(%d) is not a multiple of 8\n",
+				adapter->tx_rings[i].num_desc);
 
 		memset((void *)adapter->tx_rings[i].tx_base, 0, ubuf.mmap_size);
 		adapter->tx_rings[i].tx_buffers =
 			(struct igb_tx_buffer *)
 				malloc(sizeof(struct igb_tx_buffer) *
-				       adapter->num_tx_desc);
+				       adapter->tx_rings[i].num_desc);
 
 		if (adapter->tx_rings[i].tx_buffers == NULL) {
 			error = -ENOMEM;
@@ -817,7 +984,8 @@ static int igb_allocate_queues(struct adapter *adapter)
 		}
 
 		memset(adapter->tx_rings[i].tx_buffers, 0,
-		       sizeof(struct igb_tx_buffer) * adapter->num_tx_desc);
+		       sizeof(struct igb_tx_buffer) *
+		       adapter->tx_rings[i].num_desc);
 	}
 
 	return 0;
@@ -839,21 +1007,22 @@ tx_fail:
 /* Initialize a transmit ring. */
 static void igb_setup_transmit_ring(struct tx_ring *txr)
 {
-	struct adapter *adapter = txr->adapter;
-
 	/* Clear the old descriptor contents */
 	memset((void *)txr->tx_base,  0,
-	       (sizeof(union e1000_adv_tx_desc)) * adapter->num_tx_desc);
+	       (sizeof(union e1000_adv_tx_desc)) * txr->num_desc);
 
 	memset(txr->tx_buffers, 0, sizeof(struct igb_tx_buffer) *
-				   txr->adapter->num_tx_desc);
+				   txr->num_desc);
 
 	/* Reset indices */
 	txr->next_avail_desc = 0;
 	txr->next_to_clean = 0;
 
+	/* The hardware context is lost along with the ring contents */
+	txr->ctx_valid = false;
+
 	/* Set number of descriptors available */
-	txr->tx_avail = adapter->num_tx_desc;
+	txr->tx_avail = txr->num_desc;
 }
 
 /*  Initialize all transmit rings. */
@@ -919,13 +1088,25 @@ static void igb_free_transmit_structures(struct adapter *adapter)
 /* Context Descriptor setup for VLAN or CSUM */
 static void igb_tx_ctx_setup(struct tx_ring *txr, struct igb_packet *packet)
 {
-	struct adapter *adapter = txr->adapter;
 	struct e1000_adv_tx_context_desc *TXD;
 	struct igb_tx_buffer *tx_buffer;
 	u32 type_tucmd_mlhl;
 	int ctxd;
 	u_int64_t remapped_time;
 
+	/* remap the 64-bit nsec time to the value represented in the desc */
+	remapped_time = packet->attime - ((packet->attime / 1000000000) *
+					  1000000000);
+
+	remapped_time /= 32; /* scale to 32 nsec increments */
+
+	/*
+	 * The queue keeps the last context descriptor, so a packet with
+	 * the same LaunchTime can reuse it and save a descriptor write.
+	 */
+	if (txr->ctx_valid && txr->ctx_launch_time == (u32)remapped_time)
+		return;
+
 	ctxd = txr->next_avail_desc;
 	tx_buffer = &txr->tx_buffers[ctxd];
 	TXD = (struct e1000_adv_tx_context_desc *) &txr->tx_base[ctxd];
@@ -936,21 +1117,17 @@ static void igb_tx_ctx_setup(struct tx_ring *txr, struct igb_packet *packet)
 	TXD->vlan_macip_lens = 0;
 	TXD->type_tucmd_mlhl = htole32(type_tucmd_mlhl);
 	TXD->mss_l4len_idx = 0;
-
-	/* remap the 64-bit nsec time to the value represented in the desc */
-	remapped_time = packet->attime - ((packet->attime / 1000000000) *
-					  1000000000);
-
-	remapped_time /= 32; /* scale to 32 nsec increments */
-
 	TXD->seqnum_seed = remapped_time;
 
+	txr->ctx_valid = true;
+	txr->ctx_launch_time = (u32)remapped_time;
+
 	tx_buffer->packet = NULL;
 	tx_buffer->next_eop = -1;
 
 
 	/* We've consumed the first desc, adjust counters */
-	if (++ctxd == adapter->num_tx_desc)
+	if (++ctxd == txr->num_desc)
 		ctxd = 0;
 	txr->next_avail_desc = ctxd;
 	--txr->tx_avail;
@@ -963,40 +1140,17 @@ static void igb_tx_ctx_setup(struct tx_ring *txr, struct igb_packet *packet)
  *  returns ENOSPC if we run low on tx descriptors and the app needs to
  *  cleanup descriptors.
  *
- *  this is a simplified routine which doesn't do LSO, checksum offloads,
- *  multiple fragments, etc. The provided buffers are assumed to have
- *  been previously mapped with the provided dma_malloc_page routines.
+ *  The caller must hold the adapter lock. The Transmit Descriptor Tail
+ *  is not advanced here, so several packets can be queued and handed to
+ *  the hardware with a single register write.
  *
  **********************************************************************/
-int igb_xmit(device_t *dev, unsigned int queue_index, struct igb_packet *packet)
+static int igb_xmit_queue(struct tx_ring *txr, struct igb_packet *packet)
 {
-	struct adapter *adapter;
-	struct tx_ring *txr;
 	struct igb_tx_buffer *tx_buffer;
 	union e1000_adv_tx_desc *txd = NULL;
 	u32 cmd_type_len, olinfo_status = 0;
 	int i, first, last = 0;
-	int error = 0;
-
-	if (dev == NULL)
-		return -EINVAL;
-
-	adapter = (struct adapter *)dev->private_data;
-	if (adapter == NULL)
-		return -ENXIO;
-
-	txr = &adapter->tx_rings[queue_index];
-	if (!txr)
-		return -EINVAL;
-
-	if (queue_index > adapter->num_queues)
-		return -EINVAL;
-
-	if (packet == NULL)
-		return -EINVAL;
-
-	if (igb_lock(dev) != 0)
-		return errno;
 
 	packet->next = NULL; /* used for cleanup */
 
@@ -1023,14 +1177,13 @@ int igb_xmit(device_t *dev, unsigned int queue_index, struct igb_packet *packet)
 	 * the context descriptor used for the
 	 * offloads.
 	 */
-	if (txr->tx_avail <= 2) {
-		error = ENOSPC;
-		goto unlock;
-	}
+	if (txr->tx_avail <= 2)
+		return ENOSPC;
 
 	/*
 	 * Set up the context descriptor to specify
-	 * launchtimes for the packet.
+	 * launchtimes for the packet, unless the one
+	 * already on the queue carries the same time.
 	 */
 	igb_tx_ctx_setup(txr, packet);
 
@@ -1054,7 +1207,7 @@ int igb_xmit(device_t *dev, unsigned int queue_index, struct igb_packet *packet)
 	txd->read.cmd_type_len = htole32(cmd_type_len | packet->len);
 	txd->read.olinfo_status = htole32(olinfo_status);
 	last = i;
-	if (++i == adapter->num_tx_desc)
+	if (++i == txr->num_desc)
 		i = 0;
 	tx_buffer->packet = NULL;
 	tx_buffer->next_eop = -1;
@@ -1078,16 +1231,86 @@ int igb_xmit(device_t *dev, unsigned int queue_index, struct igb_packet *packet)
 	tx_buffer = &txr->tx_buffers[first];
 	tx_buffer->next_eop = last;
 
+	++txr->tx_packets;
+
+	return 0;
+}
+
+/*********************************************************************
+ *
+ *  this is a simplified routine which doesn't do LSO, checksum offloads,
+ *  multiple fragments, etc. The provided buffers are assumed to have
+ *  been previously mapped with the provided dma_malloc_page routines.
+ *
+ **********************************************************************/
+int igb_xmit(device_t *dev, unsigned int queue_index, struct igb_packet *packet)
+{
+	u_int32_t count = 1;
+
+	if (packet == NULL)
+		return -EINVAL;
+
+	return igb_xmit_batch(dev, queue_index, &packet, &count);
+}
+
+/*********************************************************************
+ *
+ *  Queue up to *count packets on a transmit ring and advance the
+ *  Transmit Descriptor Tail once for the whole burst. On return *count
+ *  holds the number of packets handed to the hardware; ENOSPC is
+ *  returned if the ring filled up before all of them were queued.
+ *
+ **********************************************************************/
+int igb_xmit_batch(device_t *dev, unsigned int queue_index,
+		   struct igb_packet **packets, u_int32_t *count)
+{
+	struct adapter *adapter;
+	struct tx_ring *txr;
+	u_int32_t queued = 0;
+	int error = 0;
+
+	if (dev == NULL)
+		return -EINVAL;
+
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (queue_index >= adapter->num_queues)
+		return -EINVAL;
+
+	txr = &adapter->tx_rings[queue_index];
+	if (!txr)
+		return -EINVAL;
+
+	if (packets == NULL || count == NULL)
+		return -EINVAL;
+
+	if (igb_lock_tx(adapter, queue_index) != 0)
+		return errno;
+
+	while (queued < *count) {
+		if (packets[queued] == NULL) {
+			error = -EINVAL;
+			break;
+		}
+		error = igb_xmit_queue(txr, packets[queued]);
+		if (error)
+			break;
+		queued++;
+	}
+
 	/*
 	 * Advance the Transmit Descriptor Tail (TDT), this tells the E1000
-	 * that this frame is available to transmit.
+	 * that these frames are available to transmit.
 	 */
+	if (queued)
+		E1000_WRITE_REG(&adapter->hw, E1000_TDT(txr->me),
+				txr->next_avail_desc);
 
-	E1000_WRITE_REG(&adapter->hw, E1000_TDT(txr->me), i);
-	++txr->tx_packets;
+	*count = queued;
 
-unlock:
-	if (igb_unlock(dev) != 0)
+	if (igb_unlock_tx(adapter, queue_index) != 0)
 		return errno;
 
 	return error;
@@ -1143,31 +1366,20 @@ void igb_readreg(device_t *dev, u_int32_t reg, u_int32_t *data)
 	*data = E1000_READ_REG(&(adapter->hw), reg);
 }
 
-int igb_lock(device_t *dev)
+static int igb_lock_mutex(struct adapter *adapter, pthread_mutex_t *mutex)
 {
-	struct adapter *adapter;
-	int error = -1;
-
-	if (dev == NULL)
-		return -ENODEV;
-
-	adapter = (struct adapter *)dev->private_data;
-	if (adapter == NULL)
-		return -ENXIO;
+	int error;
 
 	if (adapter->active != 1)	// detach in progress
 		return -ENXIO;
 
-	if (!adapter->memlock)
-		return -ENXIO;
-
-	error = pthread_mutex_lock(adapter->memlock);
+	error = pthread_mutex_lock(mutex);
 	switch (error) {
 		case 0:
 			break;
 		case EOWNERDEAD:
 			// some process terminated without unlocking the mutex
-			if (pthread_mutex_consistent(adapter->memlock) != 0)
+			if (pthread_mutex_consistent(mutex) != 0)
 				return -errno;
 			break;
 		default:
@@ -1176,13 +1388,30 @@ int igb_lock(device_t *dev)
 	}
 
 	if (adapter->active != 1) {
-		(void) pthread_mutex_unlock(adapter->memlock);
+		(void) pthread_mutex_unlock(mutex);
 		return -ENXIO;
 	}
 
 	return 0;
 }
 
+int igb_lock(device_t *dev)
+{
+	struct adapter *adapter;
+
+	if (dev == NULL)
+		return -ENODEV;
+
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (!adapter->memlock)
+		return -ENXIO;
+
+	return igb_lock_mutex(adapter, adapter->memlock);
+}
+
 int igb_unlock(device_t *dev)
 {
 	struct adapter *adapter;
@@ -1200,20 +1429,153 @@ int igb_unlock(device_t *dev)
 	return pthread_mutex_unlock(adapter->memlock);
 }
 
+/* Serialize access to a single tx ring, independent of igb_lock(). */
+static int igb_lock_tx(struct adapter *adapter, unsigned int queue_index)
+{
+	if (!adapter->txlock || queue_index >= IGB_MAX_TX_QUEUES)
+		return -ENXIO;
+
+	return igb_lock_mutex(adapter, &adapter->txlock[queue_index]);
+}
+
+static int igb_unlock_tx(struct adapter *adapter, unsigned int queue_index)
+{
+	if (!adapter->txlock || queue_index >= IGB_MAX_TX_QUEUES)
+		return -ENXIO;
+
+	return pthread_mutex_unlock(&adapter->txlock[queue_index]);
+}
+
+/*
+ * Take every tx ring lock regardless of the adapter state, for ring
+ * setup and teardown. Always taken after igb_lock(), never before.
+ */
+static void igb_lock_all_tx(struct adapter *adapter)
+{
+	int i;
+
+	if (!adapter->txlock)
+		return;
+
+	for (i = 0; i < adapter->num_queues && i < IGB_MAX_TX_QUEUES; i++) {
+		if (pthread_mutex_lock(&adapter->txlock[i]) == EOWNERDEAD)
+			(void) pthread_mutex_consistent(&adapter->txlock[i]);
+	}
+}
+
+static void igb_unlock_all_tx(struct adapter *adapter)
+{
+	int i;
+
+	if (!adapter->txlock)
+		return;
+
+	for (i = 0; i < adapter->num_queues && i < IGB_MAX_TX_QUEUES; i++)
+		(void) pthread_mutex_unlock(&adapter->txlock[i]);
+}
+
 /**********************************************************************
  *
  *  Examine each tx_buffer in the used queue. If the hardware is done
  *  processing the packet then return the linked list of associated resources.
  *
  **********************************************************************/
-void igb_clean(device_t *dev, struct igb_packet **cleaned_packets)
+/*
+ * Reclaim the completed descriptors of one tx ring, appending the
+ * packets to the list given by head and tail. The caller holds the
+ * ring's txlock.
+ * Returns the number of packets reclaimed.
+ */
+static u_int32_t igb_clean_ring(struct adapter *adapter, struct tx_ring *txr,
+				struct igb_packet **head,
+				struct igb_packet **tail)
 {
 	struct e1000_tx_desc *tx_desc, *eop_desc;
-	struct igb_packet *last_reclaimed;
 	struct igb_tx_buffer *tx_buffer;
+	int first, last, done;
+	u_int32_t reclaimed = 0;
+
+	if (txr->tx_avail == txr->num_desc) {
+		txr->queue_status = IGB_QUEUE_IDLE;
+		return 0;
+	}
+
+	first = txr->next_to_clean;
+	tx_desc = &txr->tx_base[first];
+	tx_buffer = &txr->tx_buffers[first];
+	last = tx_buffer->next_eop;
+	eop_desc = &txr->tx_base[last];
+
+	/*
+	 * What this does is get the index of the
+	 * first descriptor AFTER the EOP of the
+	 * first packet, that way we can do the
+	 * simple comparison on the inner while loop.
+	 */
+	if (++last == txr->num_desc)
+		last = 0;
+	done = last;
+
+	while (eop_desc->upper.fields.status & E1000_TXD_STAT_DD) {
+		/* We clean the range of the packet */
+		while (first != done) {
+			if (tx_buffer->packet) {
+				tx_buffer->packet->dmatime =
+					(0xffffffff) &
+					 tx_desc->buffer_addr;
+				/* tx_buffer->packet->dmatime +=
+				 *	(tx_desc->buffer_addr >> 32) *
+				 *	 1000000000;
+				 */
+				txr->bytes += tx_buffer->packet->len;
+				tx_buffer->packet->next = NULL;
+				if (*head == NULL)
+					*head = tx_buffer->packet;
+				else
+					(*tail)->next = tx_buffer->packet;
+				*tail = tx_buffer->packet;
+				++reclaimed;
+
+				tx_buffer->packet = NULL;
+			}
+			tx_buffer->next_eop = -1;
+			tx_desc->upper.data = 0;
+			tx_desc->lower.data = 0;
+			tx_desc->buffer_addr = 0;
+			++txr->tx_avail;
+
+			if (++first == txr->num_desc)
+				first = 0;
+
+			tx_buffer = &txr->tx_buffers[first];
+			tx_desc = &txr->tx_base[first];
+		}
+		++txr->packets;
+		/* See if we can continue to the next packet */
+		last = tx_buffer->next_eop;
+		if (last != -1) {
+			eop_desc = &txr->tx_base[last];
+			/* Get new done point */
+			if (++last == txr->num_desc)
+				last = 0;
+			done = last;
+		} else
+			break;
+	}
+
+	txr->next_to_clean = first;
+
+	if (txr->tx_avail >= IGB_QUEUE_THRESHOLD)
+		txr->queue_status &= ~IGB_QUEUE_DEPLETED;
+
+	return reclaimed;
+}
+
+void igb_clean(device_t *dev, struct igb_packet **cleaned_packets)
+{
+	struct igb_packet *last_reclaimed = NULL;
 	struct adapter *adapter;
-	struct tx_ring *txr;
-	int first, last, done, processed, i;
+	int i;
 
 	if (dev == NULL)
 		return;
@@ -1227,92 +1589,113 @@ void igb_clean(device_t *dev, struct igb_packet **cleaned_packets)
 
 	*cleaned_packets = NULL; /* nothing reclaimed yet */
 
-	if (igb_lock(dev) != 0)
-		return;
-
 	for (i = 0; i < adapter->num_queues; i++) {
-		txr = &adapter->tx_rings[i];
+		if (igb_lock_tx(adapter, i) != 0)
+			return;
 
-		if (txr->tx_avail == adapter->num_tx_desc) {
-			txr->queue_status = IGB_QUEUE_IDLE;
-			continue;
-		}
+		igb_clean_ring(adapter, &adapter->tx_rings[i],
+			       cleaned_packets, &last_reclaimed);
 
-		processed = 0;
-		first = txr->next_to_clean;
-		tx_desc = &txr->tx_base[first];
-		tx_buffer = &txr->tx_buffers[first];
-		last = tx_buffer->next_eop;
-		eop_desc = &txr->tx_base[last];
+		igb_unlock_tx(adapter, i);
+	}
+}
 
-		/*
-		 * What this does is get the index of the
-		 * first descriptor AFTER the EOP of the
-		 * first packet, that way we can do the
-		 * simple comparison on the inner while loop.
-		 */
-		if (++last == adapter->num_tx_desc)
-			last = 0;
-		done = last;
-
-		while (eop_desc->upper.fields.status & E1000_TXD_STAT_DD) {
-			if (tx_buffer->packet)
-				last_reclaimed = tx_buffer->packet;
-
-			/* We clean the range of the packet */
-			while (first != done) {
-				if (tx_buffer->packet) {
-					tx_buffer->packet->dmatime =
-						(0xffffffff) &
-						 tx_desc->buffer_addr;
-					/* tx_buffer->packet->dmatime +=
-					 *	(tx_desc->buffer_addr >> 32) *
-					 *	 1000000000;
-					 */
-					txr->bytes += tx_buffer->packet->len;
-					if (*cleaned_packets == NULL) {
-						*cleaned_packets =
-							tx_buffer->packet;
-					} else {
-						last_reclaimed->next =
-							tx_buffer->packet;
-					}
-					last_reclaimed = tx_buffer->packet;
-
-					tx_buffer->packet = NULL;
-				}
-				tx_buffer->next_eop = -1;
-				tx_desc->upper.data = 0;
-				tx_desc->lower.data = 0;
-				tx_desc->buffer_addr = 0;
-				++txr->tx_avail;
-				++processed;
-
-				if (++first == adapter->num_tx_desc)
-					first = 0;
-
-				tx_buffer = &txr->tx_buffers[first];
-				tx_desc = &txr->tx_base[first];
-			}
-			++txr->packets;
-			/* See if we can continue to the next packet */
-			last = tx_buffer->next_eop;
-			if (last != -1) {
-				eop_desc = &txr->tx_base[last];
-				/* Get new done point */
-				if (++last == adapter->num_tx_desc)
-					last = 0;
-				done = last;
-			} else
-				break;
-		}
+/*********************************************************************
+ *
+ *  Reclaim the completed packets of a single tx queue and push them
+ *  onto *free_packets in one step, so a caller keeping per-queue free
+ *  lists can return a whole burst at once. *count receives the number
+ *  of packets reclaimed.
+ *
+ **********************************************************************/
+int igb_clean_queue(device_t *dev, unsigned int queue_index,
+		    struct igb_packet **free_packets, u_int32_t *count)
+{
+	struct igb_packet *head = NULL, *tail = NULL;
+	struct adapter *adapter;
+	u_int32_t reclaimed;
+	int error;
+
+	if (dev == NULL)
+		return -EINVAL;
+
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (queue_index >= adapter->num_queues)
+		return -EINVAL;
+
+	if (free_packets == NULL || count == NULL)
+		return -EINVAL;
+
+	*count = 0;
+
+	error = igb_lock_tx(adapter, queue_index);
+	if (error)
+		return error;
 
-		txr->next_to_clean = first;
+	reclaimed = igb_clean_ring(adapter, &adapter->tx_rings[queue_index],
+				   &head, &tail);
 
-		if (txr->tx_avail >= IGB_QUEUE_THRESHOLD)
-			txr->queue_status &= ~IGB_QUEUE_DEPLETED;
+	igb_unlock_tx(adapter, queue_index);
+
+	if (reclaimed) {
+		tail->next = *free_packets;
+		*free_packets = head;
 	}
-	igb_unlock(dev);
+	*count = reclaimed;
+
+	return 0;
+}
+
+/*********************************************************************
+ *
+ *  Size of a tx ring in descriptors, as set up by the driver (tx_size,
+ *  or avb_tx_size for the AVB queues). A launch time frame takes a
+ *  context and a data descriptor, so IGB_TX_DESC_PER_FRAME divides it
+ *  into the number of frames a buffer pool needs to fill the ring.
+ *
+ **********************************************************************/
+int igb_tx_ring_size(device_t *dev, unsigned int queue_index)
+{
+	struct adapter *adapter;
+
+	if (dev == NULL)
+		return -EINVAL;
+
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (queue_index >= adapter->num_queues || adapter->tx_rings == NULL)
+		return -EINVAL;
+
+	return adapter->tx_rings[queue_index].num_desc;
+}
+
+/*********************************************************************
+ *
+ *  Number of tx descriptors currently owned by the hardware (queued
+ *  and not yet reclaimed). This only reads the ring bookkeeping.
+ *
+ **********************************************************************/
+int igb_tx_ring_level(device_t *dev, unsigned int queue_index)
+{
+	struct adapter *adapter;
+
+	if (dev == NULL)
+		return -EINVAL;
+
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (queue_index >= adapter->num_queues || adapter->tx_rings == NULL)
+		return -EINVAL;
+
+	return adapter->tx_rings[queue_index].num_desc -
+	       adapter->tx_rings[queue_index].tx_avail;
 }
 
 /*********************************************************************
@@ -1376,6 +1759,7 @@ static int igb_allocate_rx_queues(struct adapter *adapter)
 
 		adapter->rx_rings[i].adapter = adapter;
 		adapter->rx_rings[i].me = i;
+		adapter->rx_rings[i].buf_size = IGB_RX_BUF_SIZE;
 
 		adapter->num_rx_desc = ubuf.mmap_size /
 				       sizeof(union e1000_adv_rx_desc);
@@ -1475,12 +1859,34 @@ static void igb_setup_receive_structures(struct adapter *adapter)
 		igb_setup_receive_ring(rxr);
 }
 
+/*
+ * Buffer layout of a ring in SRRCTL terms. With header split the i210
+ * places the headers it parses in the header buffer and the rest in the
+ * packet buffer; frames it does not parse past L2, such as AVTP, are cut
+ * at the header buffer size.
+ */
+static u32 igb_rx_srrctl(struct rx_ring *rxr)
+{
+	u32 srrctl;
+
+	srrctl = rxr->buf_size >> E1000_SRRCTL_BSIZEPKT_SHIFT;
+	if (rxr->hdr_split) {
+		srrctl |= (rxr->hdr_size << E1000_SRRCTL_BSIZEHDRSIZE_SHIFT) &
+			  E1000_SRRCTL_BSIZEHDRSIZE_MASK;
+		srrctl |= E1000_SRRCTL_DESCTYPE_HDR_SPLIT_ALWAYS;
+	} else {
+		srrctl |= E1000_SRRCTL_DESCTYPE_ADV_ONEBUF;
+	}
+
+	return srrctl;
+}
+
 /* Enable receive unit. */
 static void igb_initialize_receive_units(struct adapter *adapter)
 {
 	struct rx_ring *rxr = adapter->rx_rings;
 	struct e1000_hw *hw = &adapter->hw;
-	u32 rctl, rxcsum, srrctl = 0;
+	u32 rctl, rxcsum, tsyncrxctl, srrctl = 0;
 	int i;
 
 	/*
@@ -1491,10 +1897,22 @@ static void igb_initialize_receive_units(struct adapter *adapter)
 	E1000_WRITE_REG(hw, E1000_RCTL, rctl & ~E1000_RCTL_EN);
 
 	rctl &= ~E1000_RCTL_LPE;
-	srrctl |= 2048 >> E1000_SRRCTL_BSIZEPKT_SHIFT;
-	srrctl |= E1000_SRRCTL_DESCTYPE_ADV_ONEBUF;
+	/* have the i210 put the SYSTIM RX timestamp in front of each frame */
+	srrctl |= E1000_SRRCTL_TIMESTAMP;
 	rctl |= E1000_RCTL_SZ_2048;
 
+	/*
+	 * Buffer timestamps need RX time sync enabled. Leave the type alone
+	 * when the kernel driver already enabled it for the PTP daemon.
+	 */
+	tsyncrxctl = E1000_READ_REG(hw, E1000_TSYNCRXCTL);
+	if (!(tsyncrxctl & E1000_TSYNCRXCTL_ENABLED)) {
+		tsyncrxctl &= ~E1000_TSYNCRXCTL_TYPE_MASK;
+		tsyncrxctl |= E1000_TSYNCRXCTL_ENABLED |
+			      E1000_TSYNCRXCTL_TYPE_ALL;
+		E1000_WRITE_REG(hw, E1000_TSYNCRXCTL, tsyncrxctl);
+	}
+
 	/* Setup the Base and Length of the Rx Descriptor Rings */
 	for (i = 0; i < adapter->num_queues; i++, rxr++) {
 		u64 bus_addr = rxr->rxdma.paddr;
@@ -1510,7 +1928,8 @@ static void igb_initialize_receive_units(struct adapter *adapter)
 				(uint32_t)(bus_addr >> 32));
 		E1000_WRITE_REG(hw, E1000_RDBAL(i),
 				(uint32_t)bus_addr);
-		E1000_WRITE_REG(hw, E1000_SRRCTL(i), srrctl);
+		E1000_WRITE_REG(hw, E1000_SRRCTL(i),
+				srrctl | igb_rx_srrctl(rxr));
 
 		/* Enable this Queue */
 		rxdctl = E1000_READ_REG(hw, E1000_RXDCTL(i));
@@ -1619,6 +2038,7 @@ int igb_refresh_buffers(device_t *dev, u_int32_t idx,
 	struct rx_ring *rxr;
 	u_int32_t i, j, bufs_used;
 	bool refreshed = FALSE;
+	int error = 0;
 
 	if (dev == NULL)
 		return -EINVAL;
@@ -1664,8 +2084,15 @@ int igb_refresh_buffers(device_t *dev, u_int32_t idx,
 	while (bufs_used < num_bufs) {
 		if (!cur_pkt)
 			break;
+		/* a split ring needs a header buffer with every packet */
+		if (rxr->hdr_split && cur_pkt->hdr_paddr == 0) {
+			error = -EINVAL;
+			break;
+		}
 		rxr->rx_base[i].read.pkt_addr =
 			htole64(cur_pkt->map.paddr + cur_pkt->offset);
+		rxr->rx_base[i].read.hdr_addr =
+			rxr->hdr_split ? htole64(cur_pkt->hdr_paddr) : 0;
 		rxr->rx_buffers[i].packet = cur_pkt;
 
 		refreshed = TRUE; /* I feel wefreshed :) */
@@ -1685,7 +2112,7 @@ int igb_refresh_buffers(device_t *dev, u_int32_t idx,
 	if (sem_post(&rxr->lock) != 0)
 		return errno;
 
-	return 0;
+	return error;
 }
 
 
@@ -1790,6 +2217,39 @@ int igb_receive(device_t *dev, unsigned int queue_index,
 				 */
 				curr_pkt = rxr->rx_buffers[desc].packet;
 				curr_pkt->len = cur->wb.upper.length;
+				curr_pkt->rxoffset = 0;
+				curr_pkt->rxtime = 0;
+				curr_pkt->hdrlen = 0;
+				if (rxr->hdr_split) {
+					u16 hdr = le16toh(cur->wb.lower.lo_dword.hs_rss.hdr_info);
+
+					curr_pkt->hdrlen =
+						(hdr & E1000_RXDADV_HDRBUFLEN_MASK) >>
+						E1000_RXDADV_HDRBUFLEN_SHIFT;
+					if (curr_pkt->hdrlen > rxr->hdr_size)
+						curr_pkt->hdrlen = rxr->hdr_size;
+					if (hdr & E1000_RXDADV_SPH)
+						++rxr->rx_split_packets;
+				}
+				if (staterr & E1000_RXDADV_STAT_TSIP) {
+					/*
+					 * 8 reserved bytes, then SYSTIML
+					 * (ns) and SYSTIMH (seconds), in
+					 * the first buffer written
+					 */
+					u32 *ts = (u32 *)(curr_pkt->hdrlen ?
+						curr_pkt->hdr_vaddr :
+						curr_pkt->vaddr);
+
+					curr_pkt->rxtime =
+						(u64)le32toh(ts[3]) * 1000000000ULL +
+						le32toh(ts[2]);
+					curr_pkt->rxoffset = IGB_TS_HDR_LEN;
+					if (curr_pkt->hdrlen)
+						curr_pkt->hdrlen -= IGB_TS_HDR_LEN;
+					else
+						curr_pkt->len -= IGB_TS_HDR_LEN;
+				}
 
 				if (*received_packets == NULL)
 					*received_packets = curr_pkt;
@@ -1912,6 +2372,108 @@ err:
 	return error;
 }
 
+/*
+ * Take a burst of SYSTIM samples, each bracketed by two RDTSC reads like
+ * igb_get_wallclock(). Samples whose bracket is more than twice the
+ * tightest one are dropped as MMIO stalls; a least squares line through
+ * the rest gives the rate and the SYSTIM at the middle of the tightest
+ * bracket, so the MMIO jitter of a single read averages out.
+ */
+int igb_get_crosststamp(device_t *dev, unsigned int samples,
+			struct igb_crosststamp *xts)
+{
+	u_int64_t tsc[IGB_CROSSTSTAMP_MAX_SAMPLES];
+	u_int64_t systim[IGB_CROSSTSTAMP_MAX_SAMPLES];
+	u_int32_t window[IGB_CROSSTSTAMP_MAX_SAMPLES];
+	u_int32_t timh, timl, tsauxc;
+	u_int32_t best = 0;
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	double dx, dy;
+	struct adapter *adapter;
+	struct e1000_hw *hw;
+	unsigned int i, n = 0;
+
+	if (dev == NULL || xts == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (samples == 0 || samples > IGB_CROSSTSTAMP_MAX_SAMPLES)
+		return -EINVAL;
+
+	hw = &adapter->hw;
+
+	if (igb_lock(dev) != 0)
+		return -errno;
+
+	for (i = 0; i < samples; i++) {
+		u_int64_t t0, t1;
+
+		tsauxc = E1000_READ_REG(hw, E1000_TSAUXC);
+		tsauxc |= E1000_TSAUXC_SAMP_AUTO;
+
+		/* Invalidate AUXSTMPH/L0 */
+		E1000_READ_REG(hw, E1000_AUXSTMPH0);
+		rdtscpll(&t0);
+		E1000_WRITE_REG(hw, E1000_TSAUXC, tsauxc);
+		rdtscpll(&t1);
+
+		timl = E1000_READ_REG(hw, E1000_AUXSTMPL0);
+		timh = E1000_READ_REG(hw, E1000_AUXSTMPH0);
+
+		tsc[i] = (t1 - t0) / 2 + t0;
+		systim[i] = (u_int64_t)timh * 1000000000 + (u_int64_t)timl;
+		window[i] = t1 - t0;
+		if (window[i] < window[best])
+			best = i;
+	}
+
+	if (igb_unlock(dev) != 0)
+		return -errno;
+
+	/* fit relative to the best sample to keep the doubles exact */
+	for (i = 0; i < samples; i++) {
+		if (window[i] > 2 * window[best])
+			continue;
+		dx = (double)(int64_t)(tsc[i] - tsc[best]);
+		dy = (double)(int64_t)(systim[i] - systim[best]);
+		sx += dx;
+		sy += dy;
+		sxx += dx * dx;
+		sxy += dx * dy;
+		n++;
+	}
+
+	xts->tsc = tsc[best];
+	xts->window = window[best];
+	xts->rate = 0;
+	xts->systim = systim[best];
+	if (n > 1 && n * sxx - sx * sx > 0) {
+		xts->rate = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+		/* the line through the mean, evaluated at the best sample */
+		xts->systim += (int64_t)(sy / n - xts->rate * sx / n);
+	}
+
+	return 0;
+}
+
+/* Current SYSTIM extrapolated from a cross timestamp without touching the NIC */
+int igb_crosststamp_now(const struct igb_crosststamp *xts,
+			u_int64_t *curtime)
+{
+	u_int64_t now;
+
+	if (xts == NULL || curtime == NULL || xts->rate <= 0)
+		return -EINVAL;
+
+	rdtscpll(&now);
+	*curtime = xts->systim +
+		   (int64_t)((double)(int64_t)(now - xts->tsc) * xts->rate);
+
+	return 0;
+}
+
 struct timespec timespec_subtract(struct timespec *a, struct timespec *b)
 {
 	a->tv_nsec = a->tv_nsec - b->tv_nsec;
@@ -2007,6 +2569,18 @@ err:
 	return error;
 }
 
+/*
+ * The driver decides whether queue 0/1 is shaped (igb_set_queue_class()),
+ * so only the idle slope of a new TQAVCC value is ours.
+ */
+static u_int32_t igb_keep_queue_mode(struct e1000_hw *hw, int queue,
+				     u_int32_t tqavcc)
+{
+	return (tqavcc & ~E1000_TQAVCC_QUEUEMODE) |
+	       (E1000_READ_REG(hw, E1000_TQAVCC(queue)) &
+		E1000_TQAVCC_QUEUEMODE);
+}
+
 int igb_set_class_bandwidth(device_t *dev, u_int32_t class_a, u_int32_t class_b,
 			    u_int32_t tpktsz_a, u_int32_t tpktsz_b)
 {
@@ -2143,6 +2717,9 @@ int igb_set_class_bandwidth(device_t *dev, u_int32_t class_a, u_int32_t class_b,
 	tqavhc1 = 0x80000000 + (class_b_idle * ((1522 + tpktsz_a) /
 						(linkrate - class_a_idle)));
 
+	tqavcc0 = igb_keep_queue_mode(hw, 0, tqavcc0);
+	tqavcc1 = igb_keep_queue_mode(hw, 1, tqavcc1);
+
 	/* implicitly enable the Qav shaper */
 	tqavctrl |= E1000_TQAVCTRL_TX_ARB;
 	E1000_WRITE_REG(hw, E1000_TQAVHC(0), tqavhc0);
@@ -2158,62 +2735,21 @@ unlock:
 	return error;
 }
 
-int igb_set_class_bandwidth2(device_t *dev, u_int32_t class_a_bytes_per_second,
-			     u_int32_t class_b_bytes_per_second)
+/*
+ * Compute the Qav credit-based shaper settings for both SR classes.
+ * Returns -EINVAL if the classes would take more than 75% of the link.
+ */
+static int igb_qav_compute(u_int32_t link_speed,
+			   u_int32_t class_a_bytes_per_second,
+			   u_int32_t class_b_bytes_per_second,
+			   u_int32_t *tqavcc0, u_int32_t *tqavcc1,
+			   u_int32_t *tqavhc0, u_int32_t *tqavhc1)
 {
-	u_int32_t tqavctrl;
-	u_int32_t tqavcc0, tqavcc1;
-	u_int32_t tqavhc0, tqavhc1;
 	u_int32_t class_a_idle, class_b_idle;
 	u_int32_t linkrate;
 	u_int32_t tpktsz_a;
 	int temp;
-	struct adapter *adapter;
-	struct e1000_hw *hw;
-	struct igb_link_cmd link;
-	int err;
 	float class_a_percent, class_b_percent;
-	int error = 0;
-
-	if (dev == NULL)
-		return -EINVAL;
-
-	adapter = (struct adapter *)dev->private_data;
-	if (adapter == NULL)
-		return -ENXIO;
-
-	hw = &adapter->hw;
-
-	/* get current link speed */
-
-	err = ioctl(adapter->ldev, IGB_LINKSPEED, &link);
-
-	if (err)
-		return -ENXIO;
-
-	if (link.up == 0)
-		return -EINVAL;
-
-	if (link.speed < 100)
-		return -EINVAL;
-
-	if (link.duplex != FULL_DUPLEX)
-		return -EINVAL;
-
-	if (igb_lock(dev) != 0)
-		return errno;
-
-	tqavctrl = E1000_READ_REG(hw, E1000_TQAVCTRL);
-
-	if ((class_a_bytes_per_second + class_b_bytes_per_second) == 0) {
-		/* disable the Qav shaper */
-		tqavctrl &= ~E1000_TQAVCTRL_TX_ARB;
-		E1000_WRITE_REG(hw, E1000_TQAVCTRL, tqavctrl);
-		goto unlock;
-	}
-
-	tqavcc0 = E1000_TQAVCC_QUEUEMODE;
-	tqavcc1 = E1000_TQAVCC_QUEUEMODE;
 
 	linkrate = E1000_TQAVCC_LINKRATE;
 
@@ -2235,7 +2771,7 @@ int igb_set_class_bandwidth2(device_t *dev, u_int32_t class_a_bytes_per_second,
 	class_a_percent = class_a_bytes_per_second;
 	class_b_percent = class_b_bytes_per_second;
 
-	if (link.speed == 100) {
+	if (link_speed == 100) {
 		/* bytes-per-sec @ 100Mbps */
 		class_a_percent /= (100000000.0 / 8);
 		class_b_percent /= (100000000.0 / 8);
@@ -2253,12 +2789,11 @@ int igb_set_class_bandwidth2(device_t *dev, u_int32_t class_a_bytes_per_second,
 				(float)linkrate + 0.5);
 	}
 
-	if ((class_a_percent + class_b_percent) > 0.75) {
-		error = -EINVAL;
-		goto unlock;
-	}
-	tqavcc0 |= class_a_idle;
-	tqavcc1 |= class_b_idle;
+	if ((class_a_percent + class_b_percent) > 0.75)
+		return -EINVAL;
+
+	*tqavcc0 = E1000_TQAVCC_QUEUEMODE | class_a_idle;
+	*tqavcc1 = E1000_TQAVCC_QUEUEMODE | class_b_idle;
 
 	/*
 	 * hiCredit is the number of idleslope credits accumulated due to delay
@@ -2267,7 +2802,7 @@ int igb_set_class_bandwidth2(device_t *dev, u_int32_t class_a_bytes_per_second,
 	 * Note: if EEE is enabled, we should use for maxInterferenceSize
 	 * the overhead of link recovery (a media-specific quantity).
 	 */
-	tqavhc0 = 0x80000000 + (class_a_idle * 1522 / linkrate); /* L.10 */
+	*tqavhc0 = 0x80000000 + (class_a_idle * 1522 / linkrate); /* L.10 */
 
 	/*
 	 * Class B high credit is is the same, except the delay
@@ -2278,44 +2813,663 @@ int igb_set_class_bandwidth2(device_t *dev, u_int32_t class_a_bytes_per_second,
 	 * max Class B delay = (1522 + tpktsz_a) / (linkrate - class_a_idle)
 	 */
 
-	tqavhc1 = 0x80000000 + (class_b_idle * ((1522 + tpktsz_a) /
-				(linkrate - class_a_idle)));
+	*tqavhc1 = 0x80000000 + (class_b_idle * ((1522 + tpktsz_a) /
+				 (linkrate - class_a_idle)));
 
-	/* implicitly enable the Qav shaper */
-	tqavctrl |= E1000_TQAVCTRL_TX_ARB;
-	E1000_WRITE_REG(hw, E1000_TQAVHC(0), tqavhc0);
-	E1000_WRITE_REG(hw, E1000_TQAVCC(0), tqavcc0);
-	E1000_WRITE_REG(hw, E1000_TQAVHC(1), tqavhc1);
-	E1000_WRITE_REG(hw, E1000_TQAVCC(1), tqavcc1);
-	E1000_WRITE_REG(hw, E1000_TQAVCTRL, tqavctrl);
+	return 0;
+}
 
-unlock:
-	if (igb_unlock(dev) != 0)
-		error = errno;
+/* The Qav shaper is only usable on a full duplex link of 100M or more. */
+static int igb_qav_link(struct adapter *adapter, struct igb_link_cmd *link)
+{
+	if (ioctl(adapter->ldev, IGB_LINKSPEED, link))
+		return -ENXIO;
 
-	return error;
+	if (link->up == 0)
+		return -EINVAL;
+
+	if (link->speed < 100)
+		return -EINVAL;
+
+	if (link->duplex != FULL_DUPLEX)
+		return -EINVAL;
+
+	return 0;
 }
 
-int igb_get_mac_addr(device_t *dev, u_int8_t mac_addr[ETH_ADDR_LEN])
+int igb_set_class_bandwidth2(device_t *dev, u_int32_t class_a_bytes_per_second,
+			     u_int32_t class_b_bytes_per_second)
 {
+	u_int32_t tqavctrl;
+	u_int32_t tqavcc0, tqavcc1;
+	u_int32_t tqavhc0, tqavhc1;
 	struct adapter *adapter;
 	struct e1000_hw *hw;
+	struct igb_link_cmd link;
+	int error = 0;
 
 	if (dev == NULL)
 		return -EINVAL;
+
 	adapter = (struct adapter *)dev->private_data;
 	if (adapter == NULL)
 		return -ENXIO;
 
 	hw = &adapter->hw;
 
-	memcpy(mac_addr, hw->mac.addr, ETH_ADDR_LEN);
-	return 0;
-}
+	/* get current link speed */
+	error = igb_qav_link(adapter, &link);
+	if (error)
+		return error;
 
-int igb_setup_flex_filter(device_t *dev, unsigned int queue_id,
-			  unsigned int filter_id, unsigned int filter_len,
-			  u_int8_t *filter, u_int8_t *mask)
+	if (igb_lock(dev) != 0)
+		return errno;
+
+	tqavctrl = E1000_READ_REG(hw, E1000_TQAVCTRL);
+
+	if ((class_a_bytes_per_second + class_b_bytes_per_second) == 0) {
+		/* disable the Qav shaper */
+		tqavctrl &= ~E1000_TQAVCTRL_TX_ARB;
+		E1000_WRITE_REG(hw, E1000_TQAVCTRL, tqavctrl);
+		goto unlock;
+	}
+
+	error = igb_qav_compute(link.speed, class_a_bytes_per_second,
+				class_b_bytes_per_second,
+				&tqavcc0, &tqavcc1, &tqavhc0, &tqavhc1);
+	if (error)
+		goto unlock;
+
+	tqavcc0 = igb_keep_queue_mode(hw, 0, tqavcc0);
+	tqavcc1 = igb_keep_queue_mode(hw, 1, tqavcc1);
+
+	/* implicitly enable the Qav shaper */
+	tqavctrl |= E1000_TQAVCTRL_TX_ARB;
+	E1000_WRITE_REG(hw, E1000_TQAVHC(0), tqavhc0);
+	E1000_WRITE_REG(hw, E1000_TQAVCC(0), tqavcc0);
+	E1000_WRITE_REG(hw, E1000_TQAVHC(1), tqavhc1);
+	E1000_WRITE_REG(hw, E1000_TQAVCC(1), tqavcc1);
+	E1000_WRITE_REG(hw, E1000_TQAVCTRL, tqavctrl);
+
+unlock:
+	if (igb_unlock(dev) != 0)
+		error = errno;
+
+	return error;
+}
+
+/*
+ * Release the slots left behind by processes that have exited and sum
+ * the class totals again from what is left. This costs a kill() per
+ * slot, so it is only done when the running totals can't be trusted or
+ * a reservation doesn't fit without it. Returns the number of slots
+ * released. Caller holds memlock.
+ */
+static int igb_stream_bw_reap(struct igb_shared *shared)
+{
+	struct igb_stream_bw *stream;
+	int i, reaped = 0;
+
+	shared->class_bw[0] = shared->class_bw[1] = 0;
+
+	for (i = 0; i < IGB_MAX_SHAPED_STREAMS; i++) {
+		stream = &shared->streams[i];
+		if (stream->owner == 0)
+			continue;
+
+		if (stream->owner != getpid() &&
+		    kill(stream->owner, 0) != 0 && errno == ESRCH) {
+			memset(stream, 0, sizeof(*stream));
+			reaped++;
+			continue;
+		}
+
+		shared->class_bw[stream->sr_class] += stream->bytes_per_second;
+	}
+	shared->class_bw_valid = 1;
+
+	return reaped;
+}
+
+/*
+ * Reprogram the shaper after the reservations of sr_class changed.
+ * Only the registers that depend on that class are written, so the
+ * other class keeps running undisturbed: a class B change touches
+ * queue 1 only; a class A change also refreshes the class B hiCredit,
+ * which depends on the class A idleSlope. Caller holds memlock.
+ */
+static int igb_update_class_shaper(struct adapter *adapter,
+				   u_int32_t link_speed,
+				   unsigned int sr_class)
+{
+	struct e1000_hw *hw = &adapter->hw;
+	u_int32_t tqavctrl;
+	u_int32_t tqavcc0, tqavcc1;
+	u_int32_t tqavhc0, tqavhc1;
+	u_int32_t *totals = adapter->shared->class_bw;
+	int error;
+
+	tqavctrl = E1000_READ_REG(hw, E1000_TQAVCTRL);
+
+	if ((totals[0] + totals[1]) == 0) {
+		/* disable the Qav shaper */
+		tqavctrl &= ~E1000_TQAVCTRL_TX_ARB;
+		E1000_WRITE_REG(hw, E1000_TQAVCTRL, tqavctrl);
+		return 0;
+	}
+
+	error = igb_qav_compute(link_speed, totals[0], totals[1],
+				&tqavcc0, &tqavcc1, &tqavhc0, &tqavhc1);
+	if (error)
+		return error;
+
+	tqavcc0 = igb_keep_queue_mode(hw, 0, tqavcc0);
+	tqavcc1 = igb_keep_queue_mode(hw, 1, tqavcc1);
+
+	if (!(tqavctrl & E1000_TQAVCTRL_TX_ARB)) {
+		/* shaper was off, nothing to disturb */
+		E1000_WRITE_REG(hw, E1000_TQAVHC(0), tqavhc0);
+		E1000_WRITE_REG(hw, E1000_TQAVCC(0), tqavcc0);
+		E1000_WRITE_REG(hw, E1000_TQAVHC(1), tqavhc1);
+		E1000_WRITE_REG(hw, E1000_TQAVCC(1), tqavcc1);
+		tqavctrl |= E1000_TQAVCTRL_TX_ARB;
+		E1000_WRITE_REG(hw, E1000_TQAVCTRL, tqavctrl);
+	} else if (sr_class == 0) {
+		E1000_WRITE_REG(hw, E1000_TQAVHC(0), tqavhc0);
+		E1000_WRITE_REG(hw, E1000_TQAVCC(0), tqavcc0);
+		E1000_WRITE_REG(hw, E1000_TQAVHC(1), tqavhc1);
+	} else {
+		E1000_WRITE_REG(hw, E1000_TQAVHC(1), tqavhc1);
+		E1000_WRITE_REG(hw, E1000_TQAVCC(1), tqavcc1);
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ *
+ *  Reserve shaper bandwidth for one stream of SR class sr_class
+ *  (0 = class A on queue 0, 1 = class B on queue 1). Reservations are
+ *  kept in the shared memory so every process attached to the device
+ *  contributes to the same class totals, and only the changed class is
+ *  reprogrammed. *stream_id receives the handle for
+ *  igb_remove_stream_bandwidth(). Do not mix with
+ *  igb_set_class_bandwidth2(), which programs absolute totals.
+ *
+ **********************************************************************/
+int igb_add_stream_bandwidth(device_t *dev, unsigned int sr_class,
+			     u_int32_t bytes_per_second, int *stream_id)
+{
+	struct igb_stream_bw *stream = NULL;
+	struct adapter *adapter;
+	struct igb_link_cmd link;
+	int reaped = 0;
+	int error, i;
+
+	if (dev == NULL || stream_id == NULL)
+		return -EINVAL;
+
+	if (sr_class > 1 || bytes_per_second == 0)
+		return -EINVAL;
+
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	error = igb_qav_link(adapter, &link);
+	if (error)
+		return error;
+
+	if (igb_lock(dev) != 0)
+		return errno;
+
+	if (adapter->shared == NULL) {
+		error = -ENXIO;
+		goto unlock;
+	}
+
+	if (!adapter->shared->class_bw_valid)
+		igb_stream_bw_reap(adapter->shared);
+
+retry:
+	for (i = 0; i < IGB_MAX_SHAPED_STREAMS; i++) {
+		if (adapter->shared->streams[i].owner == 0) {
+			stream = &adapter->shared->streams[i];
+			break;
+		}
+	}
+
+	if (stream == NULL) {
+		/* stale slots may be holding the table */
+		if (!reaped++ && igb_stream_bw_reap(adapter->shared))
+			goto retry;
+		error = -ENOSPC;
+		goto unlock;
+	}
+
+	stream->owner = getpid();
+	stream->sr_class = sr_class;
+	stream->bytes_per_second = bytes_per_second;
+	adapter->shared->class_bw[sr_class] += bytes_per_second;
+
+	error = igb_update_class_shaper(adapter, link.speed, sr_class);
+	if (error) {
+		/* over-subscribed; the registers were left untouched */
+		adapter->shared->class_bw[sr_class] -= bytes_per_second;
+		memset(stream, 0, sizeof(*stream));
+		stream = NULL;
+		/* unless stale slots were holding bandwidth */
+		if (!reaped++ && igb_stream_bw_reap(adapter->shared))
+			goto retry;
+		goto unlock;
+	}
+
+	*stream_id = i;
+
+unlock:
+	if (igb_unlock(dev) != 0)
+		error = errno;
+
+	return error;
+}
+
+/*********************************************************************
+ *
+ *  Release a reservation made by igb_add_stream_bandwidth() and shrink
+ *  its class accordingly.
+ *
+ **********************************************************************/
+int igb_remove_stream_bandwidth(device_t *dev, int stream_id)
+{
+	struct igb_stream_bw *stream;
+	struct adapter *adapter;
+	struct igb_link_cmd link;
+	unsigned int sr_class;
+	int error;
+
+	if (dev == NULL)
+		return -EINVAL;
+
+	if (stream_id < 0 || stream_id >= IGB_MAX_SHAPED_STREAMS)
+		return -EINVAL;
+
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (igb_lock(dev) != 0)
+		return errno;
+
+	if (adapter->shared == NULL) {
+		error = -ENXIO;
+		goto unlock;
+	}
+
+	stream = &adapter->shared->streams[stream_id];
+	if (stream->owner != getpid()) {
+		error = -EINVAL;
+		goto unlock;
+	}
+
+	sr_class = stream->sr_class;
+	if (adapter->shared->class_bw_valid)
+		adapter->shared->class_bw[sr_class] -= stream->bytes_per_second;
+	memset(stream, 0, sizeof(*stream));
+	if (!adapter->shared->class_bw_valid)
+		igb_stream_bw_reap(adapter->shared);
+
+	/*
+	 * Shrinking a class can't over-subscribe the link; if the link is
+	 * down the slot is still released and the next reservation
+	 * reprograms the shaper from the remaining totals.
+	 */
+	error = igb_qav_link(adapter, &link);
+	if (!error)
+		error = igb_update_class_shaper(adapter, link.speed, sr_class);
+
+unlock:
+	if (igb_unlock(dev) != 0)
+		error = errno;
+
+	return error;
+}
+
+int igb_get_mac_addr(device_t *dev, u_int8_t mac_addr[ETH_ADDR_LEN])
+{
+	struct adapter *adapter;
+	struct e1000_hw *hw;
+
+	if (dev == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	hw = &adapter->hw;
+
+	memcpy(mac_addr, hw->mac.addr, ETH_ADDR_LEN);
+	return 0;
+}
+
+/*
+ * Mask the interrupts of the AVB queues; their rings are then only
+ * serviced by the user space pollers (igb_receive/igb_clean_queue).
+ */
+int igb_set_polled(device_t *dev, int enable)
+{
+	struct adapter *adapter;
+	struct igb_poll_cmd poll;
+
+	if (dev == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	poll.enable = enable ? 1 : 0;
+	if (ioctl(adapter->ldev, IGB_SET_POLLED, &poll) < 0)
+		return -errno;
+
+	return 0;
+}
+
+/*
+ * Pin the interrupt interval of a queue left to the kernel driver;
+ * usecs 0 hands it back to the driver's adaptive moderation.
+ */
+int igb_set_queue_itr(device_t *dev, unsigned int queue_index,
+		      u_int32_t usecs)
+{
+	struct adapter *adapter;
+	struct igb_itr_cmd itr;
+
+	if (dev == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	itr.queue = queue_index;
+	itr.usecs = usecs;
+	if (ioctl(adapter->ldev, IGB_SET_ITR, &itr) < 0)
+		return -errno;
+
+	return 0;
+}
+
+int igb_get_queue_info(device_t *dev, struct igb_queue_info *info)
+{
+	struct adapter *adapter;
+	struct igb_queue_cmd req;
+
+	if (dev == NULL || info == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	memset(&req, 0, sizeof(req));
+	if (ioctl(adapter->ldev, IGB_GET_QUEUES, &req) < 0)
+		return -errno;
+
+	info->user_queues = req.user_queues;
+	info->tx_in_use = req.tx_in_use;
+	info->rx_in_use = req.rx_in_use;
+	info->flex_in_use = req.flex_in_use;
+	memcpy(info->queue_class, req.queue_class, sizeof(info->queue_class));
+
+	return 0;
+}
+
+/*
+ * Switch the credit based shaper of queue 0 (class A) or 1 (class B) on
+ * or off, or label a further user queue; IGB_QUEUE_CLASS_STRICT runs the
+ * queue at strict priority. Holds for every process sharing the device.
+ */
+/*
+ * Choose the RX buffer layout of a user queue: packet buffers of
+ * buf_size bytes (a multiple of IGB_RX_BUF_UNIT) and, with hdr_size not
+ * zero, header split into header buffers of hdr_size bytes (a multiple
+ * of IGB_RX_HDR_UNIT). Small packet buffers let igb_dma_slab_carve() put
+ * several in a page; header split keeps the stream headers together in
+ * a few cache lines. Buffers posted with igb_refresh_buffers() must be
+ * that large, and carry hdr_paddr on a split ring. Only an empty ring
+ * can be changed; the layout survives igb_init(), suspend and resume.
+ */
+int igb_set_rx_buffers(device_t *dev, unsigned int queue_index,
+		       u_int32_t buf_size, u_int32_t hdr_size)
+{
+	struct adapter *adapter;
+	struct e1000_hw *hw;
+	struct rx_ring *rxr;
+	u32 rxdctl;
+	int i, error = 0;
+
+	if (dev == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	if (adapter->active != 1)	// detach in progress
+		return -ENXIO;
+
+	if (queue_index >= adapter->num_queues || adapter->rx_rings == NULL)
+		return -EINVAL;
+
+	if (buf_size == 0 || buf_size % IGB_RX_BUF_UNIT ||
+	    buf_size > IGB_RX_BUF_MAX)
+		return -EINVAL;
+	if (hdr_size % IGB_RX_HDR_UNIT || hdr_size > IGB_RX_HDR_MAX)
+		return -EINVAL;
+
+	rxr = &adapter->rx_rings[queue_index];
+	hw = &adapter->hw;
+
+	if (sem_trywait(&rxr->lock) != 0)
+		return errno; /* EAGAIN */
+
+	/* posted buffers were sized for the old layout */
+	if (rxr->next_to_check != rxr->next_to_refresh) {
+		error = -EBUSY;
+		goto out;
+	}
+
+	rxr->buf_size = buf_size;
+	rxr->hdr_size = hdr_size;
+	rxr->hdr_split = (hdr_size != 0);
+
+	/* SRRCTL may only change while the queue is disabled */
+	rxdctl = E1000_READ_REG(hw, E1000_RXDCTL(queue_index));
+	E1000_WRITE_REG(hw, E1000_RXDCTL(queue_index),
+			rxdctl & ~E1000_RXDCTL_QUEUE_ENABLE);
+	for (i = 0; i < 10; i++) {
+		usleep(1000);
+		if (!(E1000_READ_REG(hw, E1000_RXDCTL(queue_index)) &
+		      E1000_RXDCTL_QUEUE_ENABLE))
+			break;
+	}
+
+	E1000_WRITE_REG(hw, E1000_SRRCTL(queue_index),
+			(E1000_READ_REG(hw, E1000_SRRCTL(queue_index)) &
+			 E1000_SRRCTL_TIMESTAMP) | igb_rx_srrctl(rxr));
+
+	E1000_WRITE_REG(hw, E1000_RXDCTL(queue_index),
+			rxdctl | E1000_RXDCTL_QUEUE_ENABLE);
+	E1000_WRITE_REG(hw, E1000_RDH(queue_index), rxr->next_to_check);
+	E1000_WRITE_REG(hw, E1000_RDT(queue_index), rxr->next_to_refresh);
+
+out:
+	if (sem_post(&rxr->lock) != 0)
+		return errno;
+
+	return error;
+}
+
+int igb_set_queue_class(device_t *dev, unsigned int queue,
+			unsigned int queue_class)
+{
+	struct adapter *adapter;
+	struct igb_class_cmd req;
+
+	if (dev == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	req.queue = queue;
+	req.queue_class = queue_class;
+	if (ioctl(adapter->ldev, IGB_SET_QUEUE_CLASS, &req) < 0)
+		return -errno;
+
+	return 0;
+}
+
+/*
+ * Reserve a flex filter for igb_setup_flex_filter(), so processes sharing
+ * the device don't overwrite each other's. *filter_id IGB_FLEX_ANY takes
+ * the lowest free one and returns it. The driver frees the filters of a
+ * process that exits.
+ */
+int igb_alloc_flex_filter(device_t *dev, unsigned int *filter_id)
+{
+	struct adapter *adapter;
+	struct igb_flex_cmd req;
+
+	if (dev == NULL || filter_id == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	req.filter_id = *filter_id;
+	if (ioctl(adapter->ldev, IGB_ALLOC_FLEX, &req) < 0)
+		return -errno;
+
+	*filter_id = req.filter_id;
+	return 0;
+}
+
+int igb_free_flex_filter(device_t *dev, unsigned int filter_id)
+{
+	struct adapter *adapter;
+	struct igb_flex_cmd req;
+
+	if (dev == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	req.filter_id = filter_id;
+	if (ioctl(adapter->ldev, IGB_FREE_FLEX, &req) < 0)
+		return -errno;
+
+	return 0;
+}
+
+/*
+ * Route SDP0..3 as an input to auxiliary timestamp 1, so each rising edge
+ * on the pin latches SYSTIM. Aux timestamp 0 stays with igb_get_wallclock().
+ * Only one pin can be captured at a time; enable 0 releases it.
+ */
+int igb_extts_enable(device_t *dev, unsigned int sdp, int enable)
+{
+	struct adapter *adapter;
+	struct e1000_hw *hw;
+	u_int32_t ctrl, ctrl_ext, tssdp, tsauxc;
+
+	if (dev == NULL || sdp > 3)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	hw = &adapter->hw;
+
+	if (igb_lock(dev) != 0)
+		return errno;
+
+	tsauxc = E1000_READ_REG(hw, E1000_TSAUXC);
+	tssdp = E1000_READ_REG(hw, E1000_TSSDP);
+	tssdp &= ~(E1000_TSSDP_AUX1_SEL_SDP(3) | E1000_TSSDP_AUX1_TS_SDP_EN);
+
+	if (enable) {
+		/* the pin is an input and not driven by the timesync unit */
+		ctrl = E1000_READ_REG(hw, E1000_CTRL);
+		ctrl_ext = E1000_READ_REG(hw, E1000_CTRL_EXT);
+		switch (sdp) {
+		case 0:
+			ctrl &= ~E1000_CTRL_SDP0_DIR;
+			break;
+		case 1:
+			ctrl &= ~E1000_CTRL_SDP1_DIR;
+			break;
+		case 2:
+			ctrl_ext &= ~E1000_CTRL_EXT_SDP2_DIR;
+			break;
+		case 3:
+			ctrl_ext &= ~E1000_CTRL_EXT_SDP3_DIR;
+			break;
+		}
+		E1000_WRITE_REG(hw, E1000_CTRL, ctrl);
+		E1000_WRITE_REG(hw, E1000_CTRL_EXT, ctrl_ext);
+
+		tssdp &= ~E1000_TSSDP_TS_SDP_EN(sdp);
+		tssdp |= E1000_TSSDP_AUX1_SEL_SDP(sdp) |
+			 E1000_TSSDP_AUX1_TS_SDP_EN;
+		tsauxc |= E1000_TSAUXC_EN_TS1;
+	} else {
+		tsauxc &= ~E1000_TSAUXC_EN_TS1;
+	}
+
+	E1000_WRITE_REG(hw, E1000_TSSDP, tssdp);
+	E1000_WRITE_REG(hw, E1000_TSAUXC, tsauxc);
+
+	/* drop any edge latched before the pin was routed */
+	E1000_READ_REG(hw, E1000_AUXSTMPL1);
+	E1000_READ_REG(hw, E1000_AUXSTMPH1);
+
+	if (igb_unlock(dev) != 0)
+		return errno;
+
+	return 0;
+}
+
+/*
+ * Fetch the SYSTIM of the last edge latched by igb_extts_enable(), in ns.
+ * The latch holds a single edge until read, so poll at least once per
+ * period of the input; -EAGAIN when no new edge has been taken.
+ */
+int igb_extts_read(device_t *dev, u_int64_t *edgetime)
+{
+	struct adapter *adapter;
+	struct e1000_hw *hw;
+	u_int32_t timh, timl;
+
+	if (dev == NULL || edgetime == NULL)
+		return -EINVAL;
+	adapter = (struct adapter *)dev->private_data;
+	if (adapter == NULL)
+		return -ENXIO;
+
+	hw = &adapter->hw;
+
+	if (!(E1000_READ_REG(hw, E1000_TSAUXC) & E1000_TSAUXC_AUTT1))
+		return -EAGAIN;
+
+	/* reading the high half re-arms the latch */
+	timl = E1000_READ_REG(hw, E1000_AUXSTMPL1);
+	timh = E1000_READ_REG(hw, E1000_AUXSTMPH1);
+	*edgetime = (u_int64_t)timh * 1000000000 + (u_int64_t)timl;
+
+	return 0;
+}
+
+int igb_setup_flex_filter(device_t *dev, unsigned int queue_id,
+			  unsigned int filter_id, unsigned int filter_len,
+			  u_int8_t *filter, u_int8_t *mask)
 {
 	struct adapter *adapter;
 	struct e1000_hw *hw;
@@ -2460,6 +3614,8 @@ static int igb_create_lock(struct adapter *adapter)
 
 	bool attr_allocated = false;
 	pthread_mutexattr_t attr;
+	struct igb_shared *shared;
+	int i;
 
 	if (!adapter) {
 		errno = EINVAL;
@@ -2490,12 +3646,17 @@ static int igb_create_lock(struct adapter *adapter)
 
 	(void) fchmod(fd, fmode); // just to make sure fmode is applied
 
-	// shared memory holding the mutex instance
-	adapter->memlock = (pthread_mutex_t*) mmap(NULL, sizeof(pthread_mutex_t),
-							PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-	if (!adapter->memlock)
+	// shared memory holding the mutex instances
+	shared = (struct igb_shared *) mmap(NULL,
+				sizeof(struct igb_shared),
+				PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (shared == MAP_FAILED)
 		goto err;
 
+	adapter->shared = shared;
+	adapter->memlock = &shared->memlock;
+	adapter->txlock = shared->txlock;
+
 	/*
 	 * Exclusive access lock
 	 *
@@ -2524,12 +3685,16 @@ static int igb_create_lock(struct adapter *adapter)
 	if (fstat(fd, &stat) != 0)
 		goto err;
 
-	if (stat.st_size == 0) { // file is empty, do initialization
+	if (stat.st_size < sizeof(struct igb_shared)) {
 		/*
 		 * file-size becomes non-zero and given that when other processes
 		 * attach lib igb we can skip the initialization code for the mutex.
+		 * A shorter file was left by an older library; keep the members
+		 * it already has and only initialize the ones appended since.
+		 * ftruncate() zero-fills the extension, which leaves the stream
+		 * table empty.
 		 */
-		if (ftruncate(fd, sizeof(pthread_mutex_t)) != 0)
+		if (ftruncate(fd, sizeof(struct igb_shared)) != 0)
 			goto err;
 
 		if (pthread_mutexattr_init(&attr) != 0)
@@ -2545,8 +3710,15 @@ static int igb_create_lock(struct adapter *adapter)
 		if (pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) != 0)
 			goto err;
 
-		if (pthread_mutex_init(adapter->memlock, &attr) != 0)
+		if (stat.st_size == 0 &&
+		    pthread_mutex_init(&shared->memlock, &attr) != 0)
 			goto err;
+
+		for (i = 0; i < IGB_MAX_TX_QUEUES &&
+		     stat.st_size < offsetof(struct igb_shared, streams); i++) {
+			if (pthread_mutex_init(&shared->txlock[i], &attr) != 0)
+				goto err;
+		}
 	}
 
 	error = 0;
@@ -2558,8 +3730,11 @@ err:
 	if (error != 0) {
 		error = -errno;
 		if (adapter && adapter->memlock) {
-			(void) munmap(adapter->memlock, sizeof(pthread_mutex_t));
+			(void) munmap(adapter->memlock,
+				      sizeof(struct igb_shared));
 			adapter->memlock = NULL;
+			adapter->txlock = NULL;
+			adapter->shared = NULL;
 		}
 	}
 
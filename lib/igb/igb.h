@@ -55,6 +55,16 @@ struct igb_packet {
 	u_int64_t attime;	/* launchtime */
 	u_int64_t dmatime;	/* when dma tx desc wb*/
 	struct igb_packet *next;	/* used in the clean routine */
+	u_int64_t rxtime;	/* hw RX timestamp (ns), 0 if none */
+	u_int32_t rxoffset;	/* start of the frame past vaddr (RX) */
+	/*
+	 * RX header split, see igb_set_rx_buffers(). When hdrlen is not
+	 * zero the frame starts at hdr_vaddr + rxoffset with hdrlen bytes
+	 * and continues with len bytes at vaddr.
+	 */
+	u_int64_t hdr_paddr;	/* header buffer, 0 if none */
+	void *hdr_vaddr;
+	u_int32_t hdrlen;	/* bytes placed in the header buffer */
 };
 
 typedef struct _device_t {
@@ -77,6 +87,52 @@ struct igb_dma_alloc {
 	unsigned int mmap_size;
 };
 
+/* SYSTIM against TSC, fitted over a burst of bracketed samples */
+struct igb_crosststamp {
+	u_int64_t tsc;		/* reference TSC (middle of tightest bracket) */
+	u_int64_t systim;	/* fitted SYSTIM (ns) at tsc */
+	double rate;		/* SYSTIM ns per TSC cycle, 0 if unknown */
+	u_int32_t window;	/* tightest bracket (cycles) */
+};
+
+/* most samples igb_get_crosststamp() takes in one call */
+#define IGB_CROSSTSTAMP_MAX_SAMPLES	64
+
+/* number of streams igb_add_stream_bandwidth() can track per device */
+#define IGB_MAX_SHAPED_STREAMS	64
+
+/* size of the contiguous region mapped by igb_dma_malloc_huge() */
+#define IGB_DMA_HUGE_SIZE	(2 * 1024 * 1024)
+
+/* tx descriptors a launch time frame takes, see igb_tx_ring_size() */
+#define IGB_TX_DESC_PER_FRAME	2
+
+/* queues owned by user space when the driver can't tell (older igb_avb) */
+#define IGB_DEFAULT_USER_QUEUES	2
+
+/* traffic class of a TX queue, see igb_set_queue_class() */
+#define IGB_QUEUE_CLASS_STRICT	0	/* strict priority, no credit shaper */
+#define IGB_QUEUE_CLASS_A	1	/* SR class A, queue 0 only */
+#define IGB_QUEUE_CLASS_B	2	/* SR class B, queue 1 only */
+
+/* limits of igb_set_rx_buffers() */
+#define IGB_RX_BUF_UNIT		1024	/* packet buffer granularity */
+#define IGB_RX_BUF_MAX		16384
+#define IGB_RX_HDR_UNIT		64	/* header buffer granularity */
+#define IGB_RX_HDR_MAX		960
+
+/* let igb_alloc_flex_filter() pick the filter */
+#define IGB_FLEX_ANY		0xFFFFFFFF
+
+/* queue layout of the device, shared by every process attached to it */
+struct igb_queue_info {
+	u_int32_t user_queues;	/* queues 0..user_queues-1 are user space's */
+	u_int32_t tx_in_use;	/* TX rings mapped by some process, bit per queue */
+	u_int32_t rx_in_use;	/* RX rings mapped by some process, bit per queue */
+	u_int32_t flex_in_use;	/* flex filters allocated, bit per filter */
+	u_int32_t queue_class[4]; /* IGB_QUEUE_CLASS_* of each TX queue */
+};
+
 int igb_probe(device_t *dev);
 int igb_attach(char *dev_path, device_t *pdev);
 int igb_attach_rx(device_t *pdev);
@@ -85,23 +141,44 @@ int igb_detach(device_t *dev);
 int igb_suspend(device_t *dev);
 int igb_resume(device_t *dev);
 int igb_init(device_t *dev);
+int igb_init_rx(device_t *dev);
 int igb_dma_malloc_page(device_t *dev, struct igb_dma_alloc *page);
 void igb_dma_free_page(device_t *dev, struct igb_dma_alloc *page);
+int igb_dma_malloc_huge(device_t *dev, struct igb_dma_alloc *region);
+struct igb_packet *igb_dma_slab_carve(struct igb_dma_alloc *region,
+				      unsigned int buf_size,
+				      unsigned int *count);
+unsigned int igb_dma_slab_carve_hdr(struct igb_dma_alloc *region,
+				    unsigned int hdr_size,
+				    struct igb_packet *packets);
 int igb_xmit(device_t *dev, unsigned int queue_index,
 	     struct igb_packet *packet);
+int igb_xmit_batch(device_t *dev, unsigned int queue_index,
+		   struct igb_packet **packets, u_int32_t *count);
 int igb_refresh_buffers(device_t *dev, u_int32_t idx,
 			 struct igb_packet **rxbuf_packets,
 			 u_int32_t num_bufs);
 int igb_receive(device_t *dev, unsigned int queue_index, 
 	     struct igb_packet **received_packets, u_int32_t *count);
 void igb_clean(device_t *dev, struct igb_packet **cleaned_packets);
+int igb_clean_queue(device_t *dev, unsigned int queue_index,
+		    struct igb_packet **free_packets, u_int32_t *count);
+int igb_tx_ring_level(device_t *dev, unsigned int queue_index);
+int igb_tx_ring_size(device_t *dev, unsigned int queue_index);
 int igb_get_wallclock(device_t *dev, u_int64_t *curtime, u_int64_t *rdtsc);
+int igb_get_crosststamp(device_t *dev, unsigned int samples,
+			struct igb_crosststamp *xts);
+int igb_crosststamp_now(const struct igb_crosststamp *xts,
+			u_int64_t *curtime);
 int igb_gettime(device_t *dev, clockid_t clk_id, u_int64_t *curtime,
 		struct timespec *system_time);
 int igb_set_class_bandwidth(device_t *dev, u_int32_t class_a, u_int32_t class_b,
 			    u_int32_t tpktsz_a, u_int32_t tpktsz_b);
 int igb_set_class_bandwidth2(device_t *dev, u_int32_t class_a_bytes_per_second,
 			     u_int32_t class_b_bytes_per_second);
+int igb_add_stream_bandwidth(device_t *dev, unsigned int sr_class,
+			     u_int32_t bytes_per_second, int *stream_id);
+int igb_remove_stream_bandwidth(device_t *dev, int stream_id);
 int igb_setup_flex_filter(device_t *dev, unsigned int queue_id,
 			  unsigned int filter_id, unsigned int filter_len,
 			  u_int8_t *filter, u_int8_t *mask);
@@ -115,4 +192,19 @@ int igb_unlock(device_t *dev);
 
 int igb_get_mac_addr(device_t *dev, u_int8_t mac_addr[6]);
 
+int igb_set_polled(device_t *dev, int enable);
+int igb_set_queue_itr(device_t *dev, unsigned int queue_index,
+		      u_int32_t usecs);
+
+int igb_get_queue_info(device_t *dev, struct igb_queue_info *info);
+int igb_set_rx_buffers(device_t *dev, unsigned int queue_index,
+		       u_int32_t buf_size, u_int32_t hdr_size);
+int igb_set_queue_class(device_t *dev, unsigned int queue,
+			unsigned int queue_class);
+int igb_alloc_flex_filter(device_t *dev, unsigned int *filter_id);
+int igb_free_flex_filter(device_t *dev, unsigned int filter_id);
+
+int igb_extts_enable(device_t *dev, unsigned int sdp, int enable);
+int igb_extts_read(device_t *dev, u_int64_t *edgetime);
+
 #endif /* _IGB_H_DEFINED_ */
@@ -53,6 +53,12 @@
 #define IGB_RX_HTHRESH		8
 #define IGB_RX_WTHRESH          4
 
+/* timestamp header the i210 places ahead of the frame (SRRCTL.Timestamp) */
+#define IGB_TS_HDR_LEN		16
+
+/* RX packet buffer size a ring starts with, see igb_set_rx_buffers() */
+#define IGB_RX_BUF_SIZE		2048
+
 #define IGB_TX_PTHRESH		8
 #define IGB_TX_HTHRESH		1
 #define IGB_TX_WTHRESH		16
@@ -87,7 +93,7 @@
  * This parameter controls when the driver calls the routine to reclaim
  * transmit descriptors. Cleaning earlier seems a win.
  **/
-#define IGB_TX_CLEANUP_THRESHOLD        (adapter->num_tx_desc / 2)
+#define IGB_TX_CLEANUP_THRESHOLD        (txr->num_desc / 2)
 #define IGB_QUEUE_THRESHOLD		(2)
 
 /* Precision Time Sync (IEEE 1588) defines */
@@ -112,6 +118,7 @@ struct tx_ring {
 	u32 next_avail_desc;
 	u32 next_to_clean;
 
+	u16 num_desc;	/* ring size, set by the driver per queue */
 	u16 tx_avail;
 
 	u32 bytes;
@@ -122,6 +129,10 @@ struct tx_ring {
 	u64 no_desc_avail;
 	u64 tx_packets;
 	int queue_status;
+
+	/* launch time programmed by the last context descriptor */
+	bool ctx_valid;
+	u32 ctx_launch_time;
 };
 
 struct igb_rx_buffer {
@@ -138,6 +149,8 @@ struct rx_ring {
 	struct resource rxdma;
 	union e1000_adv_rx_desc *rx_base;
 	bool hdr_split;
+	u32 buf_size;	/* packet buffer bytes (SRRCTL.BSIZEPKT) */
+	u32 hdr_size;	/* header buffer bytes, 0 unless hdr_split */
 	u32 next_to_refresh;
 	u32 next_to_check;
 	struct igb_rx_buffer *rx_buffers;
@@ -155,10 +168,14 @@ struct rx_ring {
 	sem_t lock;
 };
 
+struct igb_shared;
+
 struct adapter {
 	struct e1000_hw hw;
 
 	pthread_mutex_t *memlock;
+	pthread_mutex_t *txlock; /* one per tx queue, shared like memlock */
+	struct igb_shared *shared; /* the IGB_SEM region holding both */
 
 	int ldev; /* file descriptor to igb */
 
@@ -175,7 +192,6 @@ struct adapter {
 	 * rings
 	 */
 	struct tx_ring *tx_rings;
-	u16 num_tx_desc;
 	struct rx_ring *rx_rings;
 	u16 num_rx_desc;
 #ifdef IGB_IEEE1588
@@ -215,6 +231,13 @@ typedef struct _igb_vendor_info_t {
 #define IGB_LINKSPEED  _IOW('E', 206, int)
 #define IGB_MAP_RX_RING    _IOW('E', 207, int)
 #define IGB_UNMAP_RX_RING  _IOW('E', 208, int)
+#define IGB_MAPBUF_HUGE    _IOW('E', 209, int)
+#define IGB_SET_POLLED     _IOW('E', 210, int)
+#define IGB_SET_ITR        _IOW('E', 211, int)
+#define IGB_GET_QUEUES     _IOW('E', 212, int)
+#define IGB_SET_QUEUE_CLASS _IOW('E', 213, int)
+#define IGB_ALLOC_FLEX     _IOW('E', 214, int)
+#define IGB_FREE_FLEX      _IOW('E', 215, int)
 
 #define IGB_BIND_NAMESZ 24
 
@@ -235,6 +258,32 @@ struct igb_link_cmd {
 	u_int32_t duplex;
 };
 
+struct igb_poll_cmd {
+	u_int32_t enable;
+};
+
+struct igb_itr_cmd {
+	u_int32_t queue;
+	u_int32_t usecs;
+};
+
+struct igb_queue_cmd {
+	u_int32_t user_queues;
+	u_int32_t tx_in_use;
+	u_int32_t rx_in_use;
+	u_int32_t flex_in_use;
+	u_int32_t queue_class[4];
+};
+
+struct igb_class_cmd {
+	u_int32_t queue;
+	u_int32_t queue_class;
+};
+
+struct igb_flex_cmd {
+	u_int32_t filter_id;
+};
+
 
 #endif /* _IGB_H_DEFINED_ */
 